@@ -0,0 +1,306 @@
+/**
+ * @file contention.cpp
+ * @brief Throughput and contention of concurrent transactions.
+ *
+ * Replays the workloads of the stress tests, which only validate the outcomes, measuring
+ * how the commits, conflicts and tail latencies scale with the number of threads, the size
+ * of transactions and the skew of the keys, which are drawn from a Zipfian distribution.
+ *
+ * Results can be exported with `--benchmark_out=contention.json --benchmark_out_format=json`.
+ */
+#include <algorithm> // `std::sort`
+#include <chrono>    // `std::chrono::steady_clock`
+#include <cmath>     // `std::pow`
+#include <cstdio>    // `std::printf`
+#include <mutex>     // `std::mutex`
+#include <numeric>   // `std::iota`
+#include <random>    // `std::random_device` for each thread
+#include <string>    //
+#include <vector>    //
+
+#include <fmt/format.h> // `fmt::format`
+#include <benchmark/benchmark.h>
+
+#include <argparse/argparse.hpp>
+
+#include <ustore/ustore.hpp>
+
+#include "stress.hpp" // `consecutive_batch_t`, `operation_t`
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+using namespace unum::ustore::stress;
+
+struct settings_t {
+    std::size_t threads_count;
+    std::size_t keys_count;
+    std::size_t min_seconds;
+    std::size_t max_transaction_size;
+};
+
+static settings_t settings;
+static database_t db;
+
+void parse_args(int argc, char* argv[], settings_t& settings) {
+    argparse::ArgumentParser program(argv[0]);
+    program.add_argument("-t", "--threads").default_value("128").help("Maximum threads count");
+    program.add_argument("-k", "--keys_count").default_value("100000").help("Entries in the collection");
+    program.add_argument("-n", "--min_seconds").default_value("10").help("Minimal seconds");
+    program.add_argument("-b", "--max_transaction_size").default_value("64").help("Largest transaction size");
+
+    program.parse_known_args(argc, argv);
+
+    settings.threads_count = std::stoi(program.get("threads"));
+    settings.keys_count = std::stoi(program.get("keys_count"));
+    settings.min_seconds = std::stoi(program.get("min_seconds"));
+    settings.max_transaction_size = std::stoi(program.get("max_transaction_size"));
+
+    if (settings.threads_count == 0) {
+        fmt::print("-threads: Zero threads count specified\n");
+        exit(1);
+    }
+    if (settings.keys_count == 0) {
+        fmt::print("-keys_count: Collection can't be empty\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Zipfian distribution over `[0, count)`, where smaller keys are hotter.
+ * Follows "Quickly Generating Billion-Record Synthetic Databases" by Gray et al., like YCSB.
+ * The `skew` must be smaller than one, and zero makes the distribution uniform.
+ */
+class zipfian_keys_t {
+    std::uniform_real_distribution<double> uniform_ {0, 1};
+    std::size_t count_;
+    double skew_;
+    double alpha_;
+    double zeta_n_;
+    double eta_;
+
+    static double zeta(std::size_t count, double skew) noexcept {
+        double sum = 0;
+        for (std::size_t i = 1; i <= count; ++i)
+            sum += 1 / std::pow(double(i), skew);
+        return sum;
+    }
+
+  public:
+    zipfian_keys_t(std::size_t count, double skew) noexcept
+        : count_(count), skew_(skew), alpha_(1 / (1 - skew)), zeta_n_(zeta(count, skew)) {
+        eta_ = (1 - std::pow(2.0 / count, 1 - skew)) / (1 - zeta(2, skew) / zeta_n_);
+    }
+
+    template <typename generator_at>
+    ustore_key_t operator()(generator_at& generator) noexcept {
+        double u = uniform_(generator);
+        double uz = u * zeta_n_;
+        if (uz < 1)
+            return 0;
+        if (uz < 1 + std::pow(0.5, skew_))
+            return 1;
+        auto rank = static_cast<std::size_t>(count_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+        return static_cast<ustore_key_t>(std::min(rank, count_ - 1));
+    }
+};
+
+/**
+ * @brief Collects the outcomes of all the threads of a run. Google Benchmark synchronizes
+ * the threads, once they leave the loop, so the last one to report sees all the latencies,
+ * and exports the global percentiles, instead of averaging the ones of separate threads.
+ */
+class outcomes_t {
+    std::mutex mutex_;
+    std::vector<double> latencies_;
+    std::size_t commits_ = 0;
+    std::size_t aborts_ = 0;
+    std::size_t reported_threads_ = 0;
+
+    double percentile(double fraction) const noexcept {
+        if (latencies_.empty())
+            return 0;
+        auto idx = static_cast<std::size_t>(fraction * (latencies_.size() - 1));
+        return latencies_[idx];
+    }
+
+  public:
+    void reset() {
+        latencies_.clear();
+        commits_ = aborts_ = reported_threads_ = 0;
+    }
+
+    void report(bm::State& state, std::vector<double> const& latencies, std::size_t commits, std::size_t aborts) {
+        std::unique_lock _ {mutex_};
+        latencies_.insert(latencies_.end(), latencies.begin(), latencies.end());
+        commits_ += commits;
+        aborts_ += aborts;
+        if (++reported_threads_ != static_cast<std::size_t>(state.threads()))
+            return;
+
+        std::sort(latencies_.begin(), latencies_.end());
+        std::size_t const attempts = commits_ + aborts_;
+        state.counters["commits/s"] = bm::Counter(commits_, bm::Counter::kIsRate);
+        state.counters["aborts,%"] = attempts ? aborts_ * 100.0 / attempts : 0;
+        state.counters["p50,us"] = percentile(0.5);
+        state.counters["p99,us"] = percentile(0.99);
+        state.counters["p999,us"] = percentile(0.999);
+    }
+};
+
+static outcomes_t outcomes;
+
+/**
+ * @brief Runs the `transaction` once per iteration, timing it from the first write to the commit.
+ * Conflicting transactions aren't retried, but reported as aborts.
+ */
+template <typename transaction_at>
+void run_transactions(bm::State& state, transaction_at transaction) {
+
+    if (state.thread_index() == 0)
+        outcomes.reset();
+
+    std::vector<double> latencies;
+    std::size_t commits = 0;
+    std::size_t aborts = 0;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        bool committed = transaction();
+        auto finish = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(finish - start).count());
+        committed ? ++commits : ++aborts;
+    }
+
+    outcomes.report(state, latencies, commits, aborts);
+}
+
+/**
+ * @brief Engines without ACID transactions, like LevelDB, apply the same writes as plain batches.
+ */
+static status_t commit(transaction_t& txn) noexcept {
+    return ustore_supports_transactions_k ? txn.commit() : status_t {};
+}
+
+static transaction_t transact() {
+    return ustore_supports_transactions_k ? db.transact().throw_or_release() : transaction_t {db};
+}
+
+/**
+ * @brief Workload of the atomicity test: overwrites ranges of consecutive keys, picking hot ranges more often.
+ * @param state.range(0) Number of keys in every range.
+ * @param state.range(1) Skew of the Zipfian distribution in percents.
+ */
+static void consecutive_batches(bm::State& state) {
+    auto const batch_size = static_cast<std::size_t>(state.range(0));
+    auto const skew = state.range(1) / 100.0;
+    std::mt19937 generator(std::random_device {}());
+    zipfian_keys_t choose_range(std::max<std::size_t>(settings.keys_count / batch_size, 1), skew);
+    consecutive_batch_t batch(batch_size);
+    transaction_t txn = transact();
+
+    run_transactions(state, [&] {
+        ustore_key_t const first_key = choose_range(generator) * static_cast<ustore_key_t>(batch_size);
+        batch.prepare(first_key, generator(), false);
+        if (ustore_supports_transactions_k && !txn.reset())
+            return false;
+        auto collection = txn.main();
+        return batch.apply(collection) && commit(txn);
+    });
+}
+
+/**
+ * @brief Workload of the linearizability test: inserts and removes scattered keys, picking hot keys more often.
+ * @param state.range(0) Number of operations in every transaction.
+ * @param state.range(1) Skew of the Zipfian distribution in percents.
+ */
+static void scattered_operations(bm::State& state) {
+    auto const transaction_size = static_cast<std::size_t>(state.range(0));
+    auto const skew = state.range(1) / 100.0;
+    std::mt19937 generator(std::random_device {}());
+    zipfian_keys_t choose_key(settings.keys_count, skew);
+    std::vector<operation_t> operations(transaction_size);
+    transaction_t txn = transact();
+
+    run_transactions(state, [&] {
+        if (ustore_supports_transactions_k && !txn.reset())
+            return false;
+        for (operation_t& op : operations) {
+            auto code = generator() % 2 ? operation_code_t::insert_k : operation_code_t::remove_k;
+            op.randomize(code, generator, choose_key);
+            if (!op.apply(txn))
+                return false;
+        }
+        return bool(commit(txn));
+    });
+}
+
+#pragma region - Preparation
+
+/**
+ * @brief Fills the collection, so that the transactions update and remove existing keys.
+ */
+static void fill_collection() {
+    blobs_collection_t collection = db.main();
+    std::vector<ustore_key_t> keys(1024);
+    std::size_t value = 0;
+    value_view_t value_view {reinterpret_cast<byte_t const*>(&value), sizeof(value)};
+    for (std::size_t offset = 0; offset < settings.keys_count; offset += keys.size()) {
+        std::size_t const count = std::min(keys.size(), settings.keys_count - offset);
+        keys.resize(count);
+        std::iota(keys.begin(), keys.end(), static_cast<ustore_key_t>(offset));
+        collection[keys].assign(value_view).throw_unhandled();
+    }
+}
+
+static void register_sweep(char const* name, void (*function)(bm::State&)) {
+    std::vector<std::int64_t> transaction_sizes;
+    for (std::size_t size = 1; size <= settings.max_transaction_size; size *= 4)
+        transaction_sizes.push_back(static_cast<std::int64_t>(size));
+    bm::RegisterBenchmark(name, function) //
+        ->MinTime(settings.min_seconds)
+        ->UseRealTime()
+        ->ThreadRange(1, settings.threads_count)
+        ->ArgNames({"txn_size", "skew,%"})
+        ->ArgsProduct({transaction_sizes, {0, 50, 90, 99}});
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    parse_args(argc, argv, settings);
+
+#if defined(USTORE_DEBUG)
+    settings.keys_count = 10'000;
+    settings.threads_count = 4;
+    settings.min_seconds = 1;
+#endif
+    settings.max_transaction_size = std::min(settings.max_transaction_size, settings.keys_count);
+
+#if defined(USTORE_ENGINE_IS_LEVELDB)
+    db.open(R"({"version": "1.0", "directory": "./tmp/contention/LevelDB"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_ROCKSDB)
+    db.open(R"({"version": "1.0", "directory": "./tmp/contention/RocksDB"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_TIERED)
+    db.open(R"({"version": "1.0", "directory": "./tmp/contention/Tiered"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_UDISK)
+    db.open(R"({"version": "1.0", "directory": "./tmp/contention/UnumDB"})").throw_unhandled();
+#else
+    db.open(config().c_str()).throw_unhandled();
+#endif
+
+    std::printf("Will fill the collection with %zu entries...\n", settings.keys_count);
+    fill_collection();
+
+    // Describe the setup in the JSON output, to compare runs on different machines
+    bm::AddCustomContext("keys_count", std::to_string(settings.keys_count));
+    bm::AddCustomContext("transactions", ustore_supports_transactions_k ? "true" : "false");
+
+    std::printf("Will benchmark...\n");
+    register_sweep("consecutive_batches", &consecutive_batches);
+    register_sweep("scattered_operations", &scattered_operations);
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+
+    // Clear DB after benchmark
+    db.clear().throw_unhandled();
+    return 0;
+}
@@ -0,0 +1,695 @@
+/**
+ * @file micro.cpp
+ * @brief Micro-benchmarks of individual operations across all the modalities.
+ *
+ * Unlike the Twitter benchmark, doesn't depend on any dataset. Every collection is
+ * pre-filled with synthetic entries, after which point reads and writes, scans,
+ * samples, transaction commits and YCSB-like mixes are measured in isolation,
+ * sweeping over the batch size and the number of threads.
+ *
+ * Results can be exported with `--benchmark_out=micro.json --benchmark_out_format=json`.
+ */
+#include <string>  //
+#include <vector>  //
+#include <thread>  //
+#include <random>  // `std::random_device` for each thread
+#include <numeric> // `std::iota`
+
+#include <fmt/format.h> // `fmt::format`
+#include <benchmark/benchmark.h>
+
+#include <argparse/argparse.hpp>
+
+#include <ustore/ustore.hpp>
+
+namespace bm = benchmark;
+using namespace unum::ustore;
+using uniform_key_t = std::uniform_int_distribution<ustore_key_t>;
+using uniform_percent_t = std::uniform_int_distribution<std::size_t>;
+
+constexpr ustore_char_t path_separator_k = '/';
+
+struct settings_t {
+    std::size_t threads_count;
+    std::size_t keys_count;
+    std::size_t value_size;
+    std::size_t dimensions;
+    std::size_t index_connectivity;
+    std::size_t min_seconds;
+    std::size_t small_batch_size;
+    std::size_t mid_batch_size;
+    std::size_t big_batch_size;
+};
+
+static settings_t settings;
+static database_t db;
+static ustore_collection_t collection_blobs_k = ustore_collection_main_k;
+static ustore_collection_t collection_docs_k = ustore_collection_main_k;
+static ustore_collection_t collection_graph_k = ustore_collection_main_k;
+static ustore_collection_t collection_paths_k = ustore_collection_main_k;
+static ustore_collection_t collection_vectors_k = ustore_collection_main_k;
+
+static std::string value_content;
+static std::vector<std::string> docs_content;
+static std::vector<std::string> paths_content;
+static std::vector<float> vectors_content;
+
+void parse_args(int argc, char* argv[], settings_t& settings) {
+    argparse::ArgumentParser program(argv[0]);
+    program.add_argument("-t", "--threads")
+        .default_value(std::to_string((std::thread::hardware_concurrency() / 2)))
+        .help("Maximum threads count");
+    program.add_argument("-k", "--keys_count").default_value("100000").help("Entries per collection");
+    program.add_argument("-v", "--value_size").default_value("100").help("Size of binary values");
+    program.add_argument("-d", "--dimensions").default_value("64").help("Dimensions of vectors");
+    program.add_argument("-c", "--connectivity").default_value("0").help("Vector index connectivity");
+    program.add_argument("-n", "--min_seconds").default_value("10").help("Minimal seconds");
+    program.add_argument("-s", "--small_batch_size").default_value("32").help("Small batch size");
+    program.add_argument("-m", "--mid_batch_size").default_value("256").help("Middle batch size");
+    program.add_argument("-b", "--big_batch_size").default_value("1024").help("Big batch size");
+
+    program.parse_known_args(argc, argv);
+
+    settings.threads_count = std::stoi(program.get("threads"));
+    settings.keys_count = std::stoi(program.get("keys_count"));
+    settings.value_size = std::stoi(program.get("value_size"));
+    settings.dimensions = std::stoi(program.get("dimensions"));
+    settings.index_connectivity = std::stoi(program.get("connectivity"));
+    settings.min_seconds = std::stoi(program.get("min_seconds"));
+    settings.small_batch_size = std::stoi(program.get("small_batch_size"));
+    settings.mid_batch_size = std::stoi(program.get("mid_batch_size"));
+    settings.big_batch_size = std::stoi(program.get("big_batch_size"));
+
+    if (settings.threads_count == 0) {
+        fmt::print("-threads: Zero threads count specified\n");
+        exit(1);
+    }
+    if (settings.keys_count == 0) {
+        fmt::print("-keys_count: Collections can't be empty\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Batch of random keys from the pre-filled range, regenerated on every iteration.
+ * Every thread has its own generator, so the threads don't contend.
+ */
+class random_keys_t {
+    std::mt19937 generator_;
+    uniform_key_t choose_key_;
+    std::vector<ustore_key_t> keys_;
+
+  public:
+    random_keys_t(std::size_t count)
+        : generator_(std::random_device {}()), choose_key_(0, settings.keys_count - 1), keys_(count) {}
+
+    ustore_key_t const* refill() noexcept {
+        for (ustore_key_t& key : keys_)
+            key = choose_key_(generator_);
+        return keys_.data();
+    }
+
+    std::mt19937& generator() noexcept { return generator_; }
+    ustore_key_t const* data() const noexcept { return keys_.data(); }
+    std::size_t size() const noexcept { return keys_.size(); }
+};
+
+/**
+ * @brief Runs the `callback` once per iteration and exports the throughput.
+ * Failed batches, like conflicting transactions or operations unsupported
+ * by the engine, are counted instead of aborting the whole suite.
+ */
+template <typename callback_at>
+void run_batches(bm::State& state, callback_at callback) {
+
+    auto const batch_size = static_cast<ustore_size_t>(state.range(0));
+    std::size_t iterations = 0;
+    std::size_t successes = 0;
+    for (auto _ : state) {
+        successes += callback();
+        iterations++;
+    }
+
+    state.counters["items/s"] = bm::Counter(iterations * batch_size, bm::Counter::kIsRate);
+    state.counters["batches/s"] = bm::Counter(iterations, bm::Counter::kIsRate);
+    state.counters["fails,%"] = bm::Counter((iterations - successes) * 100.0, bm::Counter::kAvgThreads);
+}
+
+static bool succeeded(status_t& status) noexcept {
+    if (status)
+        return true;
+    ustore_error_free(status.release_error());
+    return false;
+}
+
+#pragma region - Binary Operations
+
+static bool blobs_read(arena_t& arena, ustore_transaction_t txn, ustore_key_t const* keys, ustore_size_t count) {
+    status_t status;
+    ustore_length_t* lengths = nullptr;
+    ustore_read_t read {};
+    read.db = db;
+    read.error = status.member_ptr();
+    read.transaction = txn;
+    read.arena = arena.member_ptr();
+    read.tasks_count = count;
+    read.collections = &collection_blobs_k;
+    read.keys = keys;
+    read.keys_stride = sizeof(ustore_key_t);
+    read.lengths = &lengths;
+    ustore_read(&read);
+    return succeeded(status);
+}
+
+static bool blobs_write(arena_t& arena, ustore_transaction_t txn, ustore_key_t const* keys, ustore_size_t count) {
+    status_t status;
+    auto value_begin = reinterpret_cast<ustore_bytes_cptr_t>(value_content.data());
+    auto value_length = static_cast<ustore_length_t>(value_content.size());
+    ustore_write_t write {};
+    write.db = db;
+    write.error = status.member_ptr();
+    write.transaction = txn;
+    write.arena = arena.member_ptr();
+    write.tasks_count = count;
+    write.collections = &collection_blobs_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.values = &value_begin;
+    write.lengths = &value_length;
+    ustore_write(&write);
+    return succeeded(status);
+}
+
+static bool txn_begin(ustore_transaction_t& txn) {
+    status_t status;
+    ustore_transaction_init_t transaction_init {};
+    transaction_init.db = db;
+    transaction_init.error = status.member_ptr();
+    transaction_init.transaction = &txn;
+    ustore_transaction_init(&transaction_init);
+    return succeeded(status);
+}
+
+static bool txn_commit(ustore_transaction_t txn) {
+    status_t status;
+    ustore_transaction_commit_t transaction_commit {};
+    transaction_commit.db = db;
+    transaction_commit.error = status.member_ptr();
+    transaction_commit.transaction = txn;
+    ustore_transaction_commit(&transaction_commit);
+    return succeeded(status);
+}
+
+static void blobs_read(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    run_batches(state, [&] { return blobs_read(arena, nullptr, keys.refill(), keys.size()); });
+}
+
+static void blobs_write(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    run_batches(state, [&] { return blobs_write(arena, nullptr, keys.refill(), keys.size()); });
+}
+
+/**
+ * @brief Scans a batch of consecutive keys, starting from a random one.
+ */
+static void blobs_scan(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t start_keys(1);
+    auto const count_limit = static_cast<ustore_length_t>(state.range(0));
+    run_batches(state, [&] {
+        status_t status;
+        ustore_length_t* counts = nullptr;
+        ustore_key_t* keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = status.member_ptr();
+        scan.arena = arena.member_ptr();
+        scan.tasks_count = 1;
+        scan.collections = &collection_blobs_k;
+        scan.start_keys = start_keys.refill();
+        scan.count_limits = &count_limit;
+        scan.counts = &counts;
+        scan.keys = &keys;
+        ustore_scan(&scan);
+        return succeeded(status);
+    });
+}
+
+static void blobs_sample(bm::State& state) {
+    arena_t arena(db);
+    auto const count_limit = static_cast<ustore_length_t>(state.range(0));
+    run_batches(state, [&] {
+        status_t status;
+        ustore_length_t* counts = nullptr;
+        ustore_key_t* keys = nullptr;
+        ustore_sample_t sample {};
+        sample.db = db;
+        sample.error = status.member_ptr();
+        sample.arena = arena.member_ptr();
+        sample.tasks_count = 1;
+        sample.collections = &collection_blobs_k;
+        sample.count_limits = &count_limit;
+        sample.counts = &counts;
+        sample.keys = &keys;
+        ustore_sample(&sample);
+        return succeeded(status);
+    });
+}
+
+/**
+ * @brief Writes a batch in a new transaction and commits it,
+ * so the difference with `blobs_write` is the cost of isolation.
+ */
+static void blobs_txn_commit(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    ustore_transaction_t txn = nullptr;
+    run_batches(state, [&] {
+        return txn_begin(txn) && blobs_write(arena, txn, keys.refill(), keys.size()) && txn_commit(txn);
+    });
+    ustore_transaction_free(txn);
+}
+
+/**
+ * @brief YCSB-like mix, where every batch is either read or updated,
+ * in `read_percent` to `100 - read_percent` proportion. With `read_modify_write`
+ * the updates are preceded by reads of same keys, in a single transaction.
+ */
+static void blobs_ycsb(bm::State& state, std::size_t read_percent, bool read_modify_write) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    uniform_percent_t choose_percent(0, 99);
+    ustore_transaction_t txn = nullptr;
+    run_batches(state, [&] {
+        keys.refill();
+        if (choose_percent(keys.generator()) < read_percent)
+            return blobs_read(arena, nullptr, keys.data(), keys.size());
+        if (!read_modify_write)
+            return blobs_write(arena, nullptr, keys.data(), keys.size());
+        return txn_begin(txn) && blobs_read(arena, txn, keys.data(), keys.size()) &&
+               blobs_write(arena, txn, keys.data(), keys.size()) && txn_commit(txn);
+    });
+    ustore_transaction_free(txn);
+}
+
+static void blobs_ycsb_a(bm::State& state) {
+    blobs_ycsb(state, 50, false);
+}
+static void blobs_ycsb_b(bm::State& state) {
+    blobs_ycsb(state, 95, false);
+}
+static void blobs_ycsb_c(bm::State& state) {
+    blobs_ycsb(state, 100, false);
+}
+static void blobs_ycsb_f(bm::State& state) {
+    blobs_ycsb(state, 50, true);
+}
+
+#pragma region - Modalities
+
+static bool docs_write(arena_t& arena, ustore_key_t const* keys, ustore_size_t count) {
+    status_t status;
+    std::vector<value_view_t> values(count);
+    for (std::size_t idx = 0; idx != count; ++idx)
+        values[idx] = value_view_t {docs_content[keys[idx]].c_str()};
+
+    ustore_docs_write_t docs_write {};
+    docs_write.db = db;
+    docs_write.error = status.member_ptr();
+    docs_write.arena = arena.member_ptr();
+    docs_write.type = ustore_doc_field_json_k;
+    docs_write.modification = ustore_doc_modify_upsert_k;
+    docs_write.tasks_count = count;
+    docs_write.collections = &collection_docs_k;
+    docs_write.keys = keys;
+    docs_write.keys_stride = sizeof(ustore_key_t);
+    docs_write.lengths = values.front().member_length();
+    docs_write.lengths_stride = sizeof(value_view_t);
+    docs_write.values = values.front().member_ptr();
+    docs_write.values_stride = sizeof(value_view_t);
+    ustore_docs_write(&docs_write);
+    return succeeded(status);
+}
+
+static void docs_write(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    run_batches(state, [&] { return docs_write(arena, keys.refill(), keys.size()); });
+}
+
+/**
+ * @brief Gathers a single field from random documents, which implies parsing them.
+ */
+static void docs_read(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    ustore_str_view_t field = "score";
+    run_batches(state, [&] {
+        status_t status;
+        ustore_bytes_ptr_t values = nullptr;
+        ustore_docs_read_t docs_read {};
+        docs_read.db = db;
+        docs_read.error = status.member_ptr();
+        docs_read.arena = arena.member_ptr();
+        docs_read.type = ustore_doc_field_json_k;
+        docs_read.tasks_count = keys.size();
+        docs_read.collections = &collection_docs_k;
+        docs_read.keys = keys.refill();
+        docs_read.keys_stride = sizeof(ustore_key_t);
+        docs_read.fields = &field;
+        docs_read.values = &values;
+        ustore_docs_read(&docs_read);
+        return succeeded(status);
+    });
+}
+
+/**
+ * @brief Connects random pairs of vertices, using sources as edge IDs.
+ */
+static bool graph_upsert(arena_t& arena, ustore_key_t const* sources, ustore_key_t const* targets, std::size_t count) {
+    status_t status;
+    ustore_graph_upsert_edges_t graph_upsert_edges {};
+    graph_upsert_edges.db = db;
+    graph_upsert_edges.error = status.member_ptr();
+    graph_upsert_edges.arena = arena.member_ptr();
+    graph_upsert_edges.tasks_count = count;
+    graph_upsert_edges.collections = &collection_graph_k;
+    graph_upsert_edges.edges_ids = sources;
+    graph_upsert_edges.edges_stride = sizeof(ustore_key_t);
+    graph_upsert_edges.sources_ids = sources;
+    graph_upsert_edges.sources_stride = sizeof(ustore_key_t);
+    graph_upsert_edges.targets_ids = targets;
+    graph_upsert_edges.targets_stride = sizeof(ustore_key_t);
+    ustore_graph_upsert_edges(&graph_upsert_edges);
+    return succeeded(status);
+}
+
+static void graph_upsert(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t sources(state.range(0));
+    random_keys_t targets(state.range(0));
+    run_batches(state, [&] { return graph_upsert(arena, sources.refill(), targets.refill(), sources.size()); });
+}
+
+static void graph_find(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t vertices(state.range(0));
+    ustore_vertex_role_t const role = ustore_vertex_role_any_k;
+    std::size_t received_edges = 0;
+    run_batches(state, [&] {
+        status_t status;
+        ustore_vertex_degree_t* degrees = nullptr;
+        ustore_key_t* edges = nullptr;
+        ustore_graph_find_edges_t graph_find_edges {};
+        graph_find_edges.db = db;
+        graph_find_edges.error = status.member_ptr();
+        graph_find_edges.arena = arena.member_ptr();
+        graph_find_edges.tasks_count = vertices.size();
+        graph_find_edges.collections = &collection_graph_k;
+        graph_find_edges.vertices = vertices.refill();
+        graph_find_edges.vertices_stride = sizeof(ustore_key_t);
+        graph_find_edges.roles = &role;
+        graph_find_edges.degrees_per_vertex = &degrees;
+        graph_find_edges.edges_per_vertex = &edges;
+        ustore_graph_find_edges(&graph_find_edges);
+        if (!succeeded(status))
+            return false;
+        for (std::size_t idx = 0; idx != vertices.size(); ++idx)
+            if (degrees[idx] != ustore_vertex_degree_missing_k)
+                received_edges += degrees[idx];
+        return true;
+    });
+    state.counters["edges/s"] = bm::Counter(received_edges, bm::Counter::kIsRate);
+}
+
+static bool paths_write(arena_t& arena, ustore_key_t const* keys, ustore_size_t count) {
+    status_t status;
+    std::vector<ustore_str_view_t> paths(count);
+    for (std::size_t idx = 0; idx != count; ++idx)
+        paths[idx] = paths_content[keys[idx]].c_str();
+    auto value_begin = reinterpret_cast<ustore_bytes_cptr_t>(value_content.data());
+    auto value_length = static_cast<ustore_length_t>(value_content.size());
+
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = count;
+    paths_write.path_separator = path_separator_k;
+    paths_write.collections = &collection_paths_k;
+    paths_write.paths = paths.data();
+    paths_write.paths_stride = sizeof(ustore_str_view_t);
+    paths_write.values_bytes = &value_begin;
+    paths_write.values_lengths = &value_length;
+    ustore_paths_write(&paths_write);
+    return succeeded(status);
+}
+
+static void paths_write(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    run_batches(state, [&] { return paths_write(arena, keys.refill(), keys.size()); });
+}
+
+static void paths_read(bm::State& state) {
+    arena_t arena(db);
+    random_keys_t keys(state.range(0));
+    std::vector<ustore_str_view_t> paths(keys.size());
+    run_batches(state, [&] {
+        keys.refill();
+        for (std::size_t idx = 0; idx != keys.size(); ++idx)
+            paths[idx] = paths_content[keys.data()[idx]].c_str();
+
+        status_t status;
+        ustore_length_t* lengths = nullptr;
+        ustore_paths_read_t paths_read {};
+        paths_read.db = db;
+        paths_read.error = status.member_ptr();
+        paths_read.arena = arena.member_ptr();
+        paths_read.tasks_count = keys.size();
+        paths_read.path_separator = path_separator_k;
+        paths_read.collections = &collection_paths_k;
+        paths_read.paths = paths.data();
+        paths_read.paths_stride = sizeof(ustore_str_view_t);
+        paths_read.lengths = &lengths;
+        ustore_paths_read(&paths_read);
+        return succeeded(status);
+    });
+}
+
+/**
+ * @brief Writes vectors into consecutive keys, starting from `first_key`.
+ * The content of the vectors is taken from the pre-generated matrix.
+ */
+static bool vectors_write(arena_t& arena, ustore_key_t first_key, ustore_size_t count) {
+    status_t status;
+    std::vector<ustore_key_t> keys(count);
+    std::iota(keys.begin(), keys.end(), first_key);
+    auto vectors_begin =
+        reinterpret_cast<ustore_bytes_cptr_t>(vectors_content.data() + first_key * settings.dimensions);
+
+    ustore_vectors_write_t vectors_write {};
+    vectors_write.db = db;
+    vectors_write.error = status.member_ptr();
+    vectors_write.arena = arena.member_ptr();
+    vectors_write.tasks_count = count;
+    vectors_write.dimensions = static_cast<ustore_length_t>(settings.dimensions);
+    vectors_write.scalar_type = ustore_vector_scalar_f32_k;
+    vectors_write.collections = &collection_vectors_k;
+    vectors_write.keys = keys.data();
+    vectors_write.keys_stride = sizeof(ustore_key_t);
+    vectors_write.vectors_starts = &vectors_begin;
+    vectors_write.vectors_stride = sizeof(float) * settings.dimensions;
+    vectors_write.index_connectivity = static_cast<ustore_length_t>(settings.index_connectivity);
+    vectors_write.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_write(&vectors_write);
+    return succeeded(status);
+}
+
+static void vectors_write(bm::State& state) {
+    arena_t arena(db);
+    auto const batch_size = static_cast<ustore_size_t>(state.range(0));
+    random_keys_t first_keys(1);
+    run_batches(state, [&] {
+        ustore_key_t first_key = *first_keys.refill();
+        first_key = std::min<ustore_key_t>(first_key, settings.keys_count - batch_size);
+        return vectors_write(arena, first_key, batch_size);
+    });
+}
+
+/**
+ * @brief Searches the ten closest neighbors for a batch of vectors,
+ * already present in the collection, taken from a random offset.
+ */
+static void vectors_search(bm::State& state) {
+    arena_t arena(db);
+    auto const batch_size = static_cast<ustore_size_t>(state.range(0));
+    random_keys_t first_keys(1);
+    ustore_length_t const match_limit = 10;
+    run_batches(state, [&] {
+        ustore_key_t first_key = *first_keys.refill();
+        first_key = std::min<ustore_key_t>(first_key, settings.keys_count - batch_size);
+        auto queries_begin =
+            reinterpret_cast<ustore_bytes_cptr_t>(vectors_content.data() + first_key * settings.dimensions);
+
+        status_t status;
+        ustore_length_t* match_counts = nullptr;
+        ustore_key_t* match_keys = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.error = status.member_ptr();
+        search.arena = arena.member_ptr();
+        search.tasks_count = batch_size;
+        search.dimensions = static_cast<ustore_length_t>(settings.dimensions);
+        search.scalar_type = ustore_vector_scalar_f32_k;
+        search.metric = ustore_vector_metric_cos_k;
+        search.collections = &collection_vectors_k;
+        search.match_counts_limits = &match_limit;
+        search.queries_starts = &queries_begin;
+        search.queries_stride = sizeof(float) * settings.dimensions;
+        search.match_counts = &match_counts;
+        search.match_keys = &match_keys;
+        ustore_vectors_search(&search);
+        return succeeded(status);
+    });
+}
+
+#pragma region - Preparation
+
+/**
+ * @brief Fills every collection with `settings.keys_count` entries,
+ * so that reads hit existing keys and writes become updates.
+ */
+static void fill_collections() {
+    std::mt19937 generator(std::random_device {}());
+    uniform_key_t choose_key(0, settings.keys_count - 1);
+    std::uniform_real_distribution<float> choose_scalar(-1, 1);
+
+    value_content.assign(settings.value_size, '*');
+    docs_content.resize(settings.keys_count);
+    paths_content.resize(settings.keys_count);
+    vectors_content.resize(settings.keys_count * settings.dimensions);
+    for (std::size_t idx = 0; idx != settings.keys_count; ++idx) {
+        docs_content[idx] = fmt::format(R"({{"id":{},"score":{}}})", idx, choose_key(generator));
+        paths_content[idx] = fmt::format("micro{}{}", path_separator_k, idx);
+    }
+    for (float& scalar : vectors_content)
+        scalar = choose_scalar(generator);
+
+    arena_t arena(db);
+    bool is_filled = true;
+    std::vector<ustore_key_t> keys(settings.big_batch_size);
+    std::vector<ustore_key_t> targets(settings.big_batch_size);
+    for (std::size_t offset = 0; offset < settings.keys_count; offset += keys.size()) {
+        std::size_t const count = std::min(keys.size(), settings.keys_count - offset);
+        std::iota(keys.begin(), keys.begin() + count, static_cast<ustore_key_t>(offset));
+        for (std::size_t idx = 0; idx != count; ++idx)
+            targets[idx] = choose_key(generator);
+
+        is_filled &= blobs_write(arena, nullptr, keys.data(), count);
+        is_filled &= docs_write(arena, keys.data(), count);
+        is_filled &= graph_upsert(arena, keys.data(), targets.data(), count);
+        is_filled &= paths_write(arena, keys.data(), count);
+        is_filled &= vectors_write(arena, static_cast<ustore_key_t>(offset), count);
+    }
+    if (!is_filled)
+        std::printf("- some modalities failed to fill, they will report failures\n");
+}
+
+static void create_collection(char const* name, ustore_collection_t& collection) {
+    if (!ustore_supports_named_collections_k)
+        return;
+    status_t status;
+    ustore_collection_create_t collection_init {};
+    collection_init.db = db;
+    collection_init.error = status.member_ptr();
+    collection_init.name = name;
+    collection_init.config = "";
+    collection_init.id = &collection;
+    ustore_collection_create(&collection_init);
+    status.throw_unhandled();
+}
+
+static void register_sweep(char const* name, void (*function)(bm::State&)) {
+    bm::RegisterBenchmark(name, function) //
+        ->MinTime(settings.min_seconds)
+        ->UseRealTime()
+        ->ThreadRange(1, settings.threads_count)
+        ->Arg(1)
+        ->Arg(settings.small_batch_size)
+        ->Arg(settings.mid_batch_size)
+        ->Arg(settings.big_batch_size);
+}
+
+int main(int argc, char** argv) {
+    bm::Initialize(&argc, argv);
+    parse_args(argc, argv, settings);
+
+#if defined(USTORE_DEBUG)
+    settings.keys_count = 10'000;
+    settings.threads_count = 1;
+    settings.min_seconds = 1;
+#endif
+    settings.big_batch_size = std::min(settings.big_batch_size, settings.keys_count);
+    settings.mid_batch_size = std::min(settings.mid_batch_size, settings.keys_count);
+    settings.small_batch_size = std::min(settings.small_batch_size, settings.keys_count);
+
+#if defined(USTORE_ENGINE_IS_LEVELDB)
+    db.open(R"({"version": "1.0", "directory": "./tmp/micro/LevelDB"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_ROCKSDB)
+    db.open(R"({"version": "1.0", "directory": "./tmp/micro/RocksDB"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_TIERED)
+    db.open(R"({"version": "1.0", "directory": "./tmp/micro/Tiered"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_UDISK)
+    db.open(R"({"version": "1.0", "directory": "./tmp/micro/UnumDB"})").throw_unhandled();
+#else
+    db.open().throw_unhandled();
+#endif
+
+    create_collection("micro.blobs", collection_blobs_k);
+    create_collection("micro.docs", collection_docs_k);
+    create_collection("micro.graph", collection_graph_k);
+    create_collection("micro.paths", collection_paths_k);
+    create_collection("micro.vectors", collection_vectors_k);
+
+    std::printf("Will fill collections with %zu entries...\n", settings.keys_count);
+    fill_collections();
+
+    // Describe the setup in the JSON output, to compare runs on different machines
+    bm::AddCustomContext("keys_count", std::to_string(settings.keys_count));
+    bm::AddCustomContext("value_size", std::to_string(settings.value_size));
+    bm::AddCustomContext("dimensions", std::to_string(settings.dimensions));
+    bm::AddCustomContext("transactions", ustore_supports_transactions_k ? "true" : "false");
+
+    std::printf("Will benchmark...\n");
+    register_sweep("blobs_read", &blobs_read);
+    register_sweep("blobs_write", &blobs_write);
+    register_sweep("blobs_scan", &blobs_scan);
+    register_sweep("blobs_sample", &blobs_sample);
+    register_sweep("blobs_ycsb_a", &blobs_ycsb_a);
+    register_sweep("blobs_ycsb_b", &blobs_ycsb_b);
+    register_sweep("blobs_ycsb_c", &blobs_ycsb_c);
+    if (ustore_supports_transactions_k) {
+        register_sweep("blobs_txn_commit", &blobs_txn_commit);
+        register_sweep("blobs_ycsb_f", &blobs_ycsb_f);
+    }
+
+    register_sweep("docs_write", &docs_write);
+    register_sweep("docs_read", &docs_read);
+    register_sweep("graph_upsert", &graph_upsert);
+    register_sweep("graph_find", &graph_find);
+    register_sweep("paths_write", &paths_write);
+    register_sweep("paths_read", &paths_read);
+    register_sweep("vectors_write", &vectors_write);
+    register_sweep("vectors_search", &vectors_search);
+
+    bm::RunSpecifiedBenchmarks();
+    bm::Shutdown();
+
+    // Clear DB after benchmark
+    db.clear().throw_unhandled();
+    return 0;
+}
@@ -10,6 +10,8 @@
  * - Integer column for target node ID.
  * - Optional integer column for document/edge ID.
  * If the last one isn't provided, the row number is used as the document ID.
+ * With `--source` and `--target`, the same files are also imported as a plain graph,
+ * streaming through an external sort of the edge list.
  *
  * https://arrow.apache.org/docs/cpp/dataset.html#dataset-discovery
  * https://arrow.apache.org/docs/cpp/parquet.html
@@ -49,6 +51,9 @@ struct args_t {
     std::string config_path;
 
     std::string id;
+    std::string source;
+    std::string target;
+    std::string edge;
 
     size_t threads_count;
     size_t files_count;
@@ -60,6 +65,9 @@ void parse_args(int argc, char* argv[], args_t& args) {
     program.add_argument("-e", "--ext").required().help("File extension for exporting");
     program.add_argument("-c", "--cfg").default_value(std::string("")).help("Config path");
     program.add_argument("-i", "--id").required().help("Id field");
+    program.add_argument("-s", "--source").default_value(std::string("")).help("Source ID field for graph import");
+    program.add_argument("-t", "--target").default_value(std::string("")).help("Target ID field for graph import");
+    program.add_argument("-d", "--edge").default_value(std::string("")).help("Optional edge ID field for graph import");
     program.add_argument("-th", "--threads").default_value(std::string("1")).help("Threads count");
     program.add_argument("-m", "--max_input_files").default_value(std::string("10")).help("Max input files count");
 
@@ -69,6 +77,9 @@ void parse_args(int argc, char* argv[], args_t& args) {
     args.extension = program.get("ext");
     args.config_path = program.get("cfg");
     args.id = program.get("id");
+    args.source = program.get("source");
+    args.target = program.get("target");
+    args.edge = program.get("edge");
     args.threads_count = std::stoi(program.get("threads"));
     args.files_count = std::stoi(program.get("max_input_files"));
 
@@ -169,6 +180,43 @@ static void bench_docs_export(bm::State& state, args_t const& args) {
     db.clear().throw_unhandled();
 }
 
+static void bench_graph_import(bm::State& state, args_t const& args) {
+    auto collection = db.main();
+    status_t status;
+    arena_t arena(db);
+
+    size_t size = 0;
+    size_t idx = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto _ : state) {
+        ustore_graph_import_t graph {};
+        graph.db = db;
+        graph.error = status.member_ptr();
+        graph.arena = arena.member_ptr();
+        graph.options = ustore_option_write_bulk_k;
+        graph.collection = collection;
+        graph.paths_pattern = source_files[idx].c_str();
+        graph.max_batch_size = max_batch_size_k;
+        graph.source_id_field = args.source.c_str();
+        graph.target_id_field = args.target.c_str();
+        graph.edge_id_field = args.edge.empty() ? nullptr : args.edge.c_str();
+        ustore_graph_import(&graph);
+
+        if (status)
+            size += source_sizes[idx];
+        else
+            status.release_error();
+        ++idx;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double duration = std::chrono::duration<double, std::milli>(end - start).count() / 1000;
+    state.counters["bytes/s"] = bm::Counter(size / duration);
+    state.counters["duration"] = bm::Counter(duration);
+    state.counters["imported"] = bm::Counter(size);
+    db.clear().throw_unhandled();
+}
+
 void parse_paths(args_t& args) {
     fmt::print("Will search for {} files...\n", args.extension);
     auto dataset_path = args.path;
@@ -198,6 +246,15 @@ void bench_docs(args_t const& args) {
                           [&](bm::State& s) { bench_docs_export(s, args); });
 }
 
+void bench_graph(args_t const& args) {
+    if (args.source.empty() || args.target.empty() || args.extension == ".ndjson" || source_files.empty())
+        return;
+    // Every vertex is written once per file, so the files are imported by a single thread
+    bm::RegisterBenchmark(fmt::format("graph_import_{}", args.extension.substr(1)).c_str(),
+                          [&](bm::State& s) { bench_graph_import(s, args); })
+        ->Iterations(std::min(source_files.size(), args.files_count));
+}
+
 int main(int argc, char** argv) {
 
     args_t args {};
@@ -207,6 +264,7 @@ int main(int argc, char** argv) {
     db.open(args.config_path.c_str()).throw_unhandled();
 
     bench_docs(args);
+    bench_graph(args);
 
     bm::RunSpecifiedBenchmarks();
     bm::Shutdown();
@@ -732,6 +732,8 @@ int main(int argc, char** argv) {
     db.open(R"({"version": "1.0", "directory": "/mnt/md0/Twitter/LevelDB"})").throw_unhandled();
 #elif defined(USTORE_ENGINE_IS_ROCKSDB)
     db.open(R"({"version": "1.0", "directory": "/mnt/md0/Twitter/RocksDB"})").throw_unhandled();
+#elif defined(USTORE_ENGINE_IS_TIERED)
+    db.open(R"({"version": "1.0", "directory": "/mnt/md0/Twitter/Tiered"})").throw_unhandled();
 #elif defined(USTORE_ENGINE_IS_UDISK)
     db.open(R"({"version": "1.0", "directory": "/mnt/md0/Twitter/UnumDB"})").throw_unhandled();
 #else
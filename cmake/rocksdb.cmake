@@ -13,7 +13,7 @@ FetchContent_GetProperties(rocksdb)
 
 if(NOT rocksdb_POPULATED)
     # Fetch the content using previously declared details
-    set(WITH_LIBURING OFF CACHE INTERNAL "")
+    set(WITH_LIBURING ON CACHE INTERNAL "") # Only used, if `liburing` is found
     set(FAIL_ON_WARNINGS OFF CACHE INTERNAL "")
     set(WITH_BENCHMARK_TOOLS OFF CACHE INTERNAL "")
     set(WITH_SNAPPY OFF CACHE INTERNAL "")
@@ -4,6 +4,7 @@
 
 from multiprocessing import Process
 from typing import Optional
+import json
 import os
 import time
 import pytest
@@ -68,11 +69,89 @@ def one(col: Optional[str] = None, txn: Optional[int] = None):
         assert del_result.status_code == 200, 'Failed to delete'
 
 
+def batch(col: Optional[str] = None):
+    # More than fits into a single slice of engine calls
+    keys_count = 10_000
+
+    params = {}
+    if col:
+        params['col'] = col
+    headers = {
+        'Content-Type': 'application/x-ndjson'
+    }
+
+    docs = '\n'.join(json.dumps({'_id': index, 'value': index * 2})
+                     for index in range(keys_count))
+    put_result = r.put(
+        'http://0.0.0.0:8080/batch/',
+        data=docs,
+        params=params,
+        headers=headers,
+    )
+    assert put_result.status_code == 200, 'Failed to upsert'
+
+    # The last key was never written
+    keys = '\n'.join(str(index) for index in range(keys_count + 1))
+    get_result = r.get(
+        'http://0.0.0.0:8080/batch/',
+        data=keys,
+        params=params,
+        headers=headers,
+    )
+    assert get_result.status_code == 200, 'Failed to get'
+    lines = get_result.text.splitlines()
+    assert len(lines) == keys_count + 1, 'Expected one line per key'
+    for index, line in enumerate(lines[:keys_count]):
+        assert json.loads(line)['value'] == index * 2, 'Got wrong document'
+    assert json.loads(lines[-1]) is None, 'Missing documents must be nulls'
+
+    removed = '\n'.join(str(index) for index in range(0, keys_count, 2))
+    del_result = r.delete(
+        'http://0.0.0.0:8080/batch/',
+        data=removed,
+        params=params,
+        headers=headers,
+    )
+    assert del_result.status_code == 200, 'Failed to delete'
+
+    get_result = r.get(
+        'http://0.0.0.0:8080/batch/',
+        data=keys,
+        params=params,
+        headers=headers,
+    )
+    lines = get_result.text.splitlines()
+    for index, line in enumerate(lines[:keys_count]):
+        doc = json.loads(line)
+        assert (doc is None) == (index % 2 == 0), 'Removed wrong documents'
+
+    malformed_result = r.get(
+        'http://0.0.0.0:8080/batch/',
+        data='1\nnot-a-key\n',
+        params=params,
+        headers=headers,
+    )
+    assert malformed_result.status_code == 400, 'Accepted malformed keys'
+
+    binary_result = r.get(
+        'http://0.0.0.0:8080/batch/',
+        data=keys,
+        params=params,
+        headers={'Content-Type': 'application/octet-stream'},
+    )
+    assert binary_result.status_code == 415, 'Accepted unsupported format'
+
+
 def test_write():
     one(None, None)
     one('main', None)
 
 
+def test_batch():
+    batch(None)
+    batch('batched')
+
+
 def serve():
     os.system('./build/bin/ustore_beast_server 0.0.0.0 8080 1')
 
@@ -87,5 +166,6 @@ if __name__ == '__main__':
     server.start()
     time.sleep(1)  # Sleep until the server wakes up
     test_write()
+    test_batch()
     server.kill()
     killall()
@@ -0,0 +1,201 @@
+/**
+ * @file async.h
+ * @author Ashot Vardanian
+ * @date 15 Oct 2026
+ * @addtogroup C
+ *
+ * @brief Binary Interface Standard for @b asynchronous submission of requests.
+ *
+ * Every function of the synchronous interface blocks the calling thread until
+ * the engine is done, potentially waiting for disk or network IO. Completion
+ * queues let the caller submit the same argument structs, like `ustore_read_t`,
+ * and overlap their execution with other work.
+ *
+ * ## Execution
+ *
+ * Every queue owns a pool of threads, that execute the submitted requests in
+ * the order of submission. Once a request is done, either its callback is invoked
+ * on one of those threads, or its payload is queued for `ustore_async_poll()`.
+ * On RocksDB, combine it with "ReadOptions.async_io" in the configuration
+ * to also let the engine overlap the IO within a single batch.
+ *
+ * ## Lifetimes
+ *
+ * Requests are executed by reference. The submitted struct and everything it
+ * points to, including the output and error pointers, must remain valid until
+ * completion. Requests executing concurrently must not share arenas or transactions.
+ */
+
+#pragma once
+
+#include "db.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Opaque multi-threaded completion queue.
+ * @see `ustore_async_queue_init()`, `ustore_async_queue_free()`.
+ */
+typedef void* ustore_async_queue_t;
+
+/**
+ * @brief Type of the argument struct passed to `ustore_async_submit()`.
+ */
+typedef enum {
+
+    ustore_async_read_k = 0,
+    ustore_async_write_k = 1,
+    ustore_async_scan_k = 2,
+    ustore_async_sample_k = 3,
+    ustore_async_measure_k = 4,
+    ustore_async_docs_read_k = 5,
+    ustore_async_docs_write_k = 6,
+    ustore_async_docs_gather_k = 7,
+    ustore_async_graph_find_edges_k = 8,
+    ustore_async_graph_upsert_edges_k = 9,
+    ustore_async_vectors_read_k = 10,
+    ustore_async_vectors_write_k = 11,
+    ustore_async_vectors_search_k = 12,
+
+} ustore_async_kind_t;
+
+/**
+ * @brief Starts a completion queue with a pool of worker threads.
+ * @see `ustore_async_queue_init()`.
+ */
+typedef struct ustore_async_queue_init_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /**
+     * @brief Number of threads executing the requests.
+     * Zero picks the number of hardware threads.
+     */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief The initialized queue handle. */
+    ustore_async_queue_t* queue;
+
+    /// @}
+
+} ustore_async_queue_init_t;
+
+/**
+ * @brief Starts a completion queue with a pool of worker threads.
+ * @see `ustore_async_queue_init_t`.
+ */
+void ustore_async_queue_init(ustore_async_queue_init_t*);
+
+/**
+ * @brief Submits a request for asynchronous execution.
+ * @see `ustore_async_submit()`.
+ *
+ * The `error` of this struct only reports failures to enqueue the request.
+ * Failures of the request itself are exported into its own `error` pointer.
+ */
+typedef struct ustore_async_submit_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Initialized completion queue. */
+    ustore_async_queue_t queue;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Type of the struct in `request`. */
+    ustore_async_kind_t kind;
+    /** @brief Pointer to an argument struct, like `ustore_read_t`, of the given `kind`. */
+    void* request;
+    /**
+     * @brief Optional function, called on a worker thread once the request is done.
+     * If NULL, the `callback_payload` is reported by `ustore_async_poll()` instead.
+     */
+    ustore_callback_t callback;
+    /** @brief Argument for the `callback`, or the tag reported by `ustore_async_poll()`. */
+    ustore_callback_payload_t callback_payload;
+
+    /// @}
+
+} ustore_async_submit_t;
+
+/**
+ * @brief Submits a request for asynchronous execution.
+ * @see `ustore_async_submit_t`.
+ */
+void ustore_async_submit(ustore_async_submit_t*);
+
+/**
+ * @brief Collects the completed requests, that were submitted without callbacks.
+ * @see `ustore_async_poll()`.
+ */
+typedef struct ustore_async_poll_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Initialized completion queue. */
+    ustore_async_queue_t queue;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Maximum number of completions to export. */
+    ustore_size_t count_limit;
+    /**
+     * @brief Time to wait for at least one completion.
+     * Zero returns immediately, even if nothing is completed.
+     */
+    ustore_size_t timeout_microseconds;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Buffer for at least `count_limit` payloads of the completed requests. */
+    ustore_callback_payload_t* payloads;
+    /** @brief Number of exported completions. */
+    ustore_size_t* count;
+
+    /// @}
+
+} ustore_async_poll_t;
+
+/**
+ * @brief Collects the completed requests, that were submitted without callbacks.
+ * @see `ustore_async_poll_t`.
+ */
+void ustore_async_poll(ustore_async_poll_t*);
+
+/**
+ * @brief Waits for all the submitted requests, stops the threads and deallocates the queue.
+ * Uncollected completions are dropped. Passing NULLs is safe.
+ */
+void ustore_async_queue_free(ustore_async_queue_t);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
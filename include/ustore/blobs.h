@@ -223,6 +223,26 @@ typedef struct ustore_write_t {
      * Is @b optional.
      */
     ustore_size_t values_stride;
+    /**
+     * @brief Byte offsets within the stored values, at which the contents are written.
+     *
+     * Instead of replacing the values, contents overwrite their parts, extending the
+     * values with zeros, if those are shorter than the offset. `::ustore_length_missing_k`
+     * appends to the end of the value. Missing values are created, and missing contents
+     * still remove the values. Engines apply such writes atomically with their merge operators,
+     * so those can't be combined with `::ustore_option_write_merge_k`, bulk writes or
+     * collections with a TTL, and aren't supported by LevelDB.
+     * Is @b optional.
+     */
+    ustore_length_t const* positions;
+    /**
+     * @brief Step between `positions`.
+     *
+     * The number of bytes separating entries in the `positions` array.
+     * Zero stride would reuse the same address for all tasks.
+     * Is @b optional.
+     */
+    ustore_size_t positions_stride;
 
     /// @}
 
@@ -286,6 +306,7 @@ typedef struct ustore_read_t {
      * - `::ustore_option_read_shared_memory_k`: Exports to shared memory to accelerate inter-process communication.
      * - `::ustore_option_scan_bulk_k`: Suggests that the list of keys was received from a bulk scan.
      * - `::ustore_option_dont_discard_memory_k`: Won't reset the `arena` before the operation begins.
+     * - `::ustore_option_read_deduplicate_k`: Fetches repeated keys once, in sorted order.
      */
     ustore_options_t options;
 
@@ -332,6 +353,48 @@ typedef struct ustore_read_t {
      * Is @b optional.
      */
     ustore_size_t keys_stride;
+    /**
+     * @brief Upper bound for the number of bytes exported from every value.
+     *
+     * Useful when only a fixed-size header of every value is needed.
+     * Zero exports entire values. The exported `offsets` and `lengths`
+     * describe the truncated parts. It's just a hint, as some engines
+     * may ignore it, so longer values must be tolerated.
+     * Is @b optional.
+     */
+    ustore_length_t values_limit;
+    /**
+     * @brief Byte offsets, from which every value is exported.
+     *
+     * Together with `slices_lengths`, allows reading a header of a large value, or any other
+     * byte range, without exporting the whole value. Ranges are clamped to the stored values.
+     * Unlike `values_limit`, those are always respected, and are applied before it.
+     * Is @b optional, as values are exported from the start by default.
+     */
+    ustore_length_t const* slices_starts;
+    /**
+     * @brief Step between `slices_starts`.
+     *
+     * The number of bytes separating entries in the `slices_starts` array.
+     * Zero stride would reuse the same address for all tasks.
+     * Is @b optional.
+     */
+    ustore_size_t slices_starts_stride;
+    /**
+     * @brief Number of bytes exported from every value, starting from `slices_starts`.
+     *
+     * `::ustore_length_missing_k` exports the rest of the value.
+     * Is @b optional, as the rest of every value is exported by default.
+     */
+    ustore_length_t const* slices_lengths;
+    /**
+     * @brief Step between `slices_lengths`.
+     *
+     * The number of bytes separating entries in the `slices_lengths` array.
+     * Zero stride would reuse the same address for all tasks.
+     * Is @b optional.
+     */
+    ustore_size_t slices_lengths_stride;
 
     /// @}
     /// @name Outputs
@@ -398,8 +461,8 @@ void ustore_read(ustore_read_t*);
  *
  * Retrieves the following (upto) `count_limits[i]` keys starting
  * from `start_key[i]` or the smallest following key in each collection.
- * Values are not exported, for that - follow up with a `ustore_read()` or
- * a higher-level interface for Graphs, Docs or other modalities.
+ * Values are only exported on request, with `values`, saving the
+ * follow-up `ustore_read()` of the same keys.
  *
  * ## Scans vs Iterators
  *
@@ -539,6 +602,28 @@ typedef struct ustore_scan_t {
      * runtime- or library-specific implementations.
      */
     ustore_key_t** keys;
+    /**
+     * @brief Output content offsets within `values`.
+     *
+     * Will contain a pointer to an array of integer offsets, one for every exported key,
+     * in the same order as the `keys` tape, with one more entry at the end, like in Arrow.
+     * Is @b optional and only filled, if `values` are requested.
+     */
+    ustore_length_t** values_offsets;
+    /**
+     * @brief Output content lengths within `values`, one for every exported key.
+     * Is @b optional and only filled, if `values` are requested.
+     */
+    ustore_length_t** values_lengths;
+    /**
+     * @brief Output content tape for all the exported keys.
+     *
+     * If requested, values are fetched in the same pass as the keys.
+     * Engines that can't do that leave `values_offsets` set to `NULL`,
+     * in which case a follow-up `ustore_read()` is needed.
+     * Is @b optional.
+     */
+    ustore_byte_t** values;
     /// @}
 
 } ustore_scan_t;
@@ -0,0 +1,123 @@
+/**
+ * @file async.hpp
+ * @author Ashot Vardanian
+ * @date 15 Oct 2026
+ * @addtogroup Cpp
+ *
+ * @brief C++ bindings for "ustore/async.h".
+ */
+
+#pragma once
+#include <future>  // `std::future`
+#include <memory>  // `std::unique_ptr`
+#include <utility> // `std::exchange`
+
+#include "ustore/ustore.h"
+#include "ustore/cpp/status.hpp"
+
+namespace unum::ustore {
+
+/**
+ * @brief Submits the argument structs of the C interface for asynchronous
+ * execution, returning futures of their statuses.
+ *
+ * The `error` field of every submitted struct is overwritten to point into
+ * the shared state of the future. Everything else it references must outlive
+ * the completion, the same way as with `ustore_async_submit()`.
+ *
+ * ## Class Specs
+ * - Concurrency: @b Thread-Safe, except for `open`, `close`.
+ * - Lifetime: Waits for all the submitted requests on destruction.
+ * - Copyable: No.
+ * - Exceptions: Only `std::bad_alloc` on submission.
+ */
+class completion_queue_t {
+    ustore_async_queue_t queue_ = nullptr;
+
+    struct promised_t {
+        std::promise<status_t> promise;
+        status_t status;
+    };
+
+    static void fulfill(ustore_callback_payload_t payload) noexcept {
+        auto promised = std::unique_ptr<promised_t>(reinterpret_cast<promised_t*>(payload));
+        promised->promise.set_value(std::move(promised->status));
+    }
+
+  public:
+    completion_queue_t() = default;
+    completion_queue_t(completion_queue_t const&) = delete;
+    completion_queue_t(completion_queue_t&& other) noexcept : queue_(std::exchange(other.queue_, nullptr)) {}
+    operator ustore_async_queue_t() const noexcept { return queue_; }
+
+    status_t open(ustore_database_t db, std::size_t threads_count = 0) noexcept {
+        status_t status;
+        ustore_async_queue_init_t queue_init {};
+        queue_init.db = db;
+        queue_init.error = status.member_ptr();
+        queue_init.threads_count = threads_count;
+        queue_init.queue = &queue_;
+        ustore_async_queue_init(&queue_init);
+        return status;
+    }
+
+    void close() noexcept {
+        ustore_async_queue_free(queue_);
+        queue_ = nullptr;
+    }
+
+    ~completion_queue_t() noexcept {
+        if (queue_)
+            close();
+    }
+
+    template <typename request_at>
+    std::future<status_t> submit(ustore_async_kind_t kind, request_at& request) {
+        auto promised = std::make_unique<promised_t>();
+        std::future<status_t> future = promised->promise.get_future();
+        request.error = promised->status.member_ptr();
+
+        status_t status;
+        ustore_async_submit_t submit {};
+        submit.queue = queue_;
+        submit.error = status.member_ptr();
+        submit.kind = kind;
+        submit.request = &request;
+        submit.callback = &fulfill;
+        submit.callback_payload = promised.get();
+        ustore_async_submit(&submit);
+        if (status)
+            promised.release();
+        else
+            promised->promise.set_value(std::move(status));
+        return future;
+    }
+
+    std::future<status_t> read(ustore_read_t& request) { return submit(ustore_async_read_k, request); }
+    std::future<status_t> write(ustore_write_t& request) { return submit(ustore_async_write_k, request); }
+    std::future<status_t> scan(ustore_scan_t& request) { return submit(ustore_async_scan_k, request); }
+    std::future<status_t> sample(ustore_sample_t& request) { return submit(ustore_async_sample_k, request); }
+    std::future<status_t> measure(ustore_measure_t& request) { return submit(ustore_async_measure_k, request); }
+    std::future<status_t> read(ustore_docs_read_t& request) { return submit(ustore_async_docs_read_k, request); }
+    std::future<status_t> write(ustore_docs_write_t& request) { return submit(ustore_async_docs_write_k, request); }
+    std::future<status_t> gather(ustore_docs_gather_t& request) {
+        return submit(ustore_async_docs_gather_k, request);
+    }
+    std::future<status_t> find(ustore_graph_find_edges_t& request) {
+        return submit(ustore_async_graph_find_edges_k, request);
+    }
+    std::future<status_t> upsert(ustore_graph_upsert_edges_t& request) {
+        return submit(ustore_async_graph_upsert_edges_k, request);
+    }
+    std::future<status_t> read(ustore_vectors_read_t& request) {
+        return submit(ustore_async_vectors_read_k, request);
+    }
+    std::future<status_t> write(ustore_vectors_write_t& request) {
+        return submit(ustore_async_vectors_write_k, request);
+    }
+    std::future<status_t> search(ustore_vectors_search_t& request) {
+        return submit(ustore_async_vectors_search_k, request);
+    }
+};
+
+} // namespace unum::ustore
@@ -8,6 +8,8 @@
  */
 
 #pragma once
+#include <future> // `std::async`
+
 #include "ustore/ustore.h"
 #include "ustore/cpp/ranges.hpp" // `indexed_range_gt`
 
@@ -28,6 +30,13 @@ struct size_estimates_t;
  * Unlike classical iterators, keeps an internal state,
  * which makes it @b non copy-constructible!
  *
+ * ## Prefetching
+ *
+ * With `prefetch_in_background`, the next batch is fetched on a separate thread
+ * into a second arena, while the current one is being consumed. So the consumer
+ * and the storage overlap, instead of taking turns. The transaction, if any,
+ * must not be used by anyone else, while the stream is alive.
+ *
  * ## Class Specs
  * - Concurrency: Must be used from a single thread!
  * - Lifetime: @b Must live shorter then the collection it belongs to.
@@ -36,49 +45,120 @@ struct size_estimates_t;
  */
 class keys_stream_t {
 
+    struct batch_t {
+        status_t status;
+        arena_t arena;
+        ptr_range_gt<ustore_key_t> keys;
+    };
+
     ustore_database_t db_ {nullptr};
     ustore_collection_t collection_ {ustore_collection_main_k};
     ustore_transaction_t txn_ {nullptr};
 
     arena_t arena_ {nullptr};
+    arena_t spare_arena_ {nullptr};
     ustore_length_t read_ahead_ {0};
+    bool background_ {false};
+    std::future<batch_t> pending_ {};
+    ustore_key_t pending_key_ {ustore_key_unknown_k};
 
     ustore_key_t next_min_key_ {std::numeric_limits<ustore_key_t>::min()};
+    ustore_key_t max_key_ {ustore_key_unknown_k};
     ptr_range_gt<ustore_key_t> fetched_keys_ {};
     std::size_t fetched_offset_ {0};
 
-    status_t prefetch() noexcept {
-
-        if (next_min_key_ == ustore_key_unknown_k) {
-            ++fetched_offset_;
-            return {};
-        }
+    static batch_t fetch(ustore_database_t db,
+                         ustore_collection_t collection,
+                         ustore_transaction_t txn,
+                         ustore_key_t start_key,
+                         ustore_length_t read_ahead,
+                         arena_t arena) noexcept {
 
+        batch_t batch {status_t {}, std::move(arena), {}};
         ustore_length_t* found_counts = nullptr;
         ustore_key_t* found_keys = nullptr;
 
-        status_t status;
         ustore_scan_t scan {};
-        scan.db = db_;
-        scan.error = status.member_ptr();
-        scan.transaction = txn_;
-        scan.arena = arena_.member_ptr();
+        scan.db = db;
+        scan.error = batch.status.member_ptr();
+        scan.transaction = txn;
+        scan.arena = batch.arena.member_ptr();
         scan.tasks_count = 1;
-        scan.collections = &collection_;
-        scan.start_keys = &next_min_key_;
-        scan.count_limits = &read_ahead_;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
         scan.counts = &found_counts;
         scan.keys = &found_keys;
 
         ustore_scan(&scan);
-        if (!status)
-            return status;
+        if (batch.status)
+            batch.keys = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
+        return batch;
+    }
+
+    /**
+     * @brief Returns the arena, that doesn't back the current batch,
+     * waiting for the background fetch, that may be using it.
+     */
+    arena_t reclaim_spare_arena() noexcept {
+        if (pending_.valid())
+            return std::move(pending_.get().arena);
+        return std::move(spare_arena_);
+    }
+
+    status_t prefetch() noexcept {
 
-        fetched_keys_ = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
+        if (next_min_key_ == ustore_key_unknown_k) {
+            ++fetched_offset_;
+            return {};
+        }
+
+        batch_t batch = pending_.valid() && pending_key_ == next_min_key_
+                            ? pending_.get()
+                            : fetch(db_,
+                                    collection_,
+                                    txn_,
+                                    next_min_key_,
+                                    read_ahead_,
+                                    background_ ? reclaim_spare_arena() : std::move(arena_));
+        arena_t previous_arena = std::exchange(arena_, std::move(batch.arena));
+        if (background_)
+            spare_arena_ = std::move(previous_arena);
+        if (!batch.status)
+            return std::move(batch.status);
+
+        fetched_keys_ = batch.keys;
         fetched_offset_ = 0;
 
         auto count = static_cast<ustore_length_t>(fetched_keys_.size());
         next_min_key_ = count < read_ahead_ ? ustore_key_unknown_k : fetched_keys_[count - 1] + 1;
+
+        // Keys past the (exclusive) upper bound are dropped, ending the stream
+        if (max_key_ != ustore_key_unknown_k) {
+            auto bounded_end = std::lower_bound(fetched_keys_.begin(), fetched_keys_.end(), max_key_);
+            if (bounded_end != fetched_keys_.end()) {
+                fetched_keys_ = ptr_range_gt<ustore_key_t> {fetched_keys_.begin(), bounded_end};
+                next_min_key_ = ustore_key_unknown_k;
+            }
+        }
+
+        if (background_ && next_min_key_ != ustore_key_unknown_k) {
+            pending_key_ = next_min_key_;
+            try {
+                pending_ = std::async(std::launch::async,
+                                      &keys_stream_t::fetch,
+                                      db_,
+                                      collection_,
+                                      txn_,
+                                      next_min_key_,
+                                      read_ahead_,
+                                      std::move(spare_arena_));
+            }
+            catch (...) {
+                // No threads available, continue synchronously
+                background_ = false;
+            }
+        }
         return {};
     }
 
@@ -94,8 +174,12 @@ class keys_stream_t {
     keys_stream_t(ustore_database_t db,
                   ustore_collection_t collection = ustore_collection_main_k,
                   std::size_t read_ahead = keys_stream_t::default_read_ahead_k,
-                  ustore_transaction_t txn = nullptr) noexcept
-        : db_(db), collection_(collection), txn_(txn), arena_(db), read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
+                  ustore_transaction_t txn = nullptr,
+                  ustore_key_t max_key = ustore_key_unknown_k,
+                  bool prefetch_in_background = false) noexcept
+        : db_(db), collection_(collection), txn_(txn), arena_(db), spare_arena_(db),
+          read_ahead_(static_cast<ustore_size_t>(read_ahead)), background_(prefetch_in_background),
+          max_key_(max_key) {}
 
     keys_stream_t(keys_stream_t&&) = default;
     keys_stream_t& operator=(keys_stream_t&&) = default;
@@ -170,14 +254,29 @@ class keys_stream_t {
     }
 };
 
+/**
+ * @brief Iterator (almost) over the key-value pairs in a single collection.
+ * Supports background prefetching the same way as the `keys_stream_t`.
+ */
 class pairs_stream_t {
 
+    struct batch_t {
+        status_t status;
+        arena_t arena;
+        ptr_range_gt<ustore_key_t> keys;
+        joined_blobs_t values;
+    };
+
     ustore_database_t db_ {nullptr};
     ustore_collection_t collection_ {ustore_collection_main_k};
     ustore_transaction_t txn_ {nullptr};
 
     arena_t arena_ {nullptr};
+    arena_t spare_arena_ {nullptr};
     ustore_length_t read_ahead_ {0};
+    bool background_ {false};
+    std::future<batch_t> pending_ {};
+    ustore_key_t pending_key_ {ustore_key_unknown_k};
 
     ustore_key_t next_min_key_ {std::numeric_limits<ustore_key_t>::min()};
     ptr_range_gt<ustore_key_t> fetched_keys_ {};
@@ -185,58 +284,109 @@ class pairs_stream_t {
     joined_blobs_iterator_t values_iterator_ {};
     std::size_t fetched_offset_ {0};
 
-    status_t prefetch() noexcept {
-
-        if (next_min_key_ == ustore_key_unknown_k) {
-            ++fetched_offset_;
-            return {};
-        }
+    static batch_t fetch(ustore_database_t db,
+                         ustore_collection_t collection,
+                         ustore_transaction_t txn,
+                         ustore_key_t start_key,
+                         ustore_length_t read_ahead,
+                         arena_t arena) noexcept {
 
+        batch_t batch {status_t {}, std::move(arena), {}, {}};
         ustore_length_t* found_counts = nullptr;
         ustore_key_t* found_keys = nullptr;
-        status_t status;
+
         ustore_scan_t scan {};
-        scan.db = db_;
-        scan.error = status.member_ptr();
-        scan.transaction = txn_;
-        scan.arena = arena_.member_ptr();
+        scan.db = db;
+        scan.error = batch.status.member_ptr();
+        scan.transaction = txn;
+        scan.arena = batch.arena.member_ptr();
         scan.tasks_count = 1;
-        scan.collections = &collection_;
-        scan.start_keys = &next_min_key_;
-        scan.count_limits = &read_ahead_;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
         scan.counts = &found_counts;
         scan.keys = &found_keys;
 
         ustore_scan(&scan);
-        if (!status)
-            return status;
-
-        fetched_keys_ = ptr_range_gt<ustore_key_t> {found_keys, found_keys + *found_counts};
-        fetched_offset_ = 0;
-        auto count = static_cast<ustore_size_t>(fetched_keys_.size());
+        if (!batch.status)
+            return batch;
 
+        auto count = static_cast<ustore_size_t>(*found_counts);
         ustore_bytes_ptr_t found_vals {};
         ustore_length_t* found_offs {};
         ustore_read_t read {};
-        read.db = db_;
-        read.error = status.member_ptr();
-        read.transaction = txn_;
-        read.arena = arena_.member_ptr();
+        read.db = db;
+        read.error = batch.status.member_ptr();
+        read.transaction = txn;
+        read.arena = batch.arena.member_ptr();
         read.options = ustore_option_dont_discard_memory_k;
         read.tasks_count = count;
-        read.collections = &collection_;
+        read.collections = &collection;
         read.keys = found_keys;
         read.keys_stride = sizeof(ustore_key_t);
         read.offsets = &found_offs;
         read.values = &found_vals;
 
         ustore_read(&read);
-        if (!status)
-            return status;
+        if (!batch.status)
+            return batch;
+
+        batch.keys = ptr_range_gt<ustore_key_t> {found_keys, found_keys + count};
+        batch.values = joined_blobs_t {count, found_offs, found_vals};
+        return batch;
+    }
+
+    arena_t reclaim_spare_arena() noexcept {
+        if (pending_.valid())
+            return std::move(pending_.get().arena);
+        return std::move(spare_arena_);
+    }
 
-        values_view_ = joined_blobs_t {count, found_offs, found_vals};
+    status_t prefetch() noexcept {
+
+        if (next_min_key_ == ustore_key_unknown_k) {
+            ++fetched_offset_;
+            return {};
+        }
+
+        batch_t batch = pending_.valid() && pending_key_ == next_min_key_
+                            ? pending_.get()
+                            : fetch(db_,
+                                    collection_,
+                                    txn_,
+                                    next_min_key_,
+                                    read_ahead_,
+                                    background_ ? reclaim_spare_arena() : std::move(arena_));
+        arena_t previous_arena = std::exchange(arena_, std::move(batch.arena));
+        if (background_)
+            spare_arena_ = std::move(previous_arena);
+        if (!batch.status)
+            return std::move(batch.status);
+
+        fetched_keys_ = batch.keys;
+        fetched_offset_ = 0;
+        auto count = static_cast<ustore_size_t>(fetched_keys_.size());
+        values_view_ = batch.values;
         values_iterator_ = values_view_.begin();
         next_min_key_ = count < read_ahead_ ? ustore_key_unknown_k : fetched_keys_[count - 1] + 1;
+
+        if (background_ && next_min_key_ != ustore_key_unknown_k) {
+            pending_key_ = next_min_key_;
+            try {
+                pending_ = std::async(std::launch::async,
+                                      &pairs_stream_t::fetch,
+                                      db_,
+                                      collection_,
+                                      txn_,
+                                      next_min_key_,
+                                      read_ahead_,
+                                      std::move(spare_arena_));
+            }
+            catch (...) {
+                // No threads available, continue synchronously
+                background_ = false;
+            }
+        }
         return {};
     }
 
@@ -251,8 +401,10 @@ class pairs_stream_t {
         ustore_database_t db,
         ustore_collection_t collection = ustore_collection_main_k,
         std::size_t read_ahead = pairs_stream_t::default_read_ahead_k,
-        ustore_transaction_t txn = nullptr) noexcept
-        : db_(db), collection_(collection), txn_(txn), arena_(db_), read_ahead_(static_cast<ustore_size_t>(read_ahead)) {}
+        ustore_transaction_t txn = nullptr,
+        bool prefetch_in_background = false) noexcept
+        : db_(db), collection_(collection), txn_(txn), arena_(db), spare_arena_(db),
+          read_ahead_(static_cast<ustore_size_t>(read_ahead)), background_(prefetch_in_background) {}
 
     pairs_stream_t(pairs_stream_t&&) = default;
     pairs_stream_t& operator=(pairs_stream_t&&) = default;
@@ -365,12 +517,14 @@ class blobs_range_t {
     ustore_collection_t collection_;
     ustore_key_t min_key_;
     ustore_key_t max_key_;
+    bool background_ = false;
 
     template <typename stream_at>
     expected_gt<stream_at> make_stream( //
         ustore_key_t target,
-        std::size_t read_ahead = keys_stream_t::default_read_ahead_k) noexcept {
-        stream_at stream {db_, collection_, read_ahead, txn_};
+        std::size_t read_ahead = keys_stream_t::default_read_ahead_k,
+        bool prefetch_in_background = false) noexcept {
+        stream_at stream {db_, collection_, read_ahead, txn_, prefetch_in_background};
         status_t status = stream.seek(target);
         return {std::move(status), std::move(stream)};
     }
@@ -395,15 +549,19 @@ class blobs_range_t {
     ustore_collection_t collection() const noexcept { return collection_; }
 
     expected_gt<keys_stream_t> keys_begin(std::size_t read_ahead = keys_stream_t::default_read_ahead_k) noexcept {
-        return make_stream<keys_stream_t>(min_key_, read_ahead);
+        keys_stream_t stream {db_, collection_, read_ahead, txn_, max_key_, background_};
+        status_t status = stream.seek(min_key_);
+        return {std::move(status), std::move(stream)};
     }
 
     expected_gt<keys_stream_t> keys_end() noexcept {
-        return make_stream<keys_stream_t>(max_key_, max_key_ == std::numeric_limits<ustore_key_t>::max() ? 0u : 1u);
+        keys_stream_t stream {db_, collection_, 1u, txn_, max_key_};
+        status_t status = stream.seek(max_key_);
+        return {std::move(status), std::move(stream)};
     }
 
     expected_gt<pairs_stream_t> pairs_begin(std::size_t read_ahead = pairs_stream_t::default_read_ahead_k) noexcept {
-        return make_stream<pairs_stream_t>(min_key_, read_ahead);
+        return make_stream<pairs_stream_t>(min_key_, read_ahead, background_);
     }
 
     expected_gt<pairs_stream_t> pairs_end() noexcept {
@@ -454,6 +612,14 @@ class blobs_range_t {
         max_key_ = max_key;
         return *this;
     }
+    /**
+     * @brief Makes the streams fetch the next batch in the background,
+     * while the current one is being consumed.
+     */
+    blobs_range_t& prefetch_in_background(bool background = true) noexcept {
+        background_ = background;
+        return *this;
+    }
 
     ustore_key_t min_key() noexcept { return min_key_; }
     ustore_key_t max_key() noexcept { return max_key_; }
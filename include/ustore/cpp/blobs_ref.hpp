@@ -8,6 +8,8 @@
  */
 
 #pragma once
+#include <future> // `std::async`
+
 #include "ustore/ustore.h"
 #include "ustore/cpp/types.hpp"      // `arena_t`
 #include "ustore/cpp/status.hpp"     // `status_t`
@@ -48,7 +50,7 @@ class blobs_ref_gt;
  *
  * ## Class Specs
  * - Copyable: Yes.
- * - Exceptions: Never.
+ * - Exceptions: Never, unless `value_async` fails to start a thread.
  */
 template <typename locations_at>
 class blobs_ref_gt {
@@ -73,10 +75,12 @@ class blobs_ref_gt {
     locations_store_t locations_ {};
 
     template <typename contents_arg_at>
-    status_t any_assign(contents_arg_at&&, ustore_options_t) noexcept;
+    status_t any_assign(contents_arg_at&&, ustore_options_t, ustore_length_t const* position = nullptr) noexcept;
 
     template <typename expected_at = value_t>
-    expected_gt<expected_at> any_get(ustore_options_t) noexcept;
+    expected_gt<expected_at> any_get(ustore_options_t,
+                                     ustore_length_t slice_start = 0,
+                                     ustore_length_t slice_length = ustore_length_missing_k) noexcept;
 
     template <typename expected_at, typename contents_arg_at>
     expected_gt<expected_at> any_gather(contents_arg_at&&, ustore_options_t) noexcept;
@@ -105,6 +109,26 @@ class blobs_ref_gt {
 
     operator expected_gt<value_t>() noexcept { return value(); }
 
+    /**
+     * @brief Exports at most `length` bytes of every value, starting from `start`,
+     * like the header of a large blob, without exporting the rest of it.
+     */
+    expected_gt<value_t> slice(ustore_length_t start, ustore_length_t length, bool watch = true) noexcept {
+        auto options = !watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k;
+        return any_get<value_t>(options, start, length);
+    }
+
+    /**
+     * @brief Starts the lookup on a separate thread, so that many of them can be in flight at once.
+     * Most useful with remote clients, where every request waits for a round-trip. The `arena`
+     * must not be shared with other requests, and the locations must outlive the result.
+     */
+    std::future<expected_gt<value_t>> value_async(arena_t& arena, bool watch = true) noexcept(false) {
+        blobs_ref_gt ref = *this;
+        ref.on(arena);
+        return std::async(std::launch::async, [ref, watch]() mutable { return ref.value(watch); });
+    }
+
     expected_gt<length_t> length(bool watch = true) noexcept {
         return any_get<length_t>(!watch ? ustore_option_transaction_dont_watch_k : ustore_options_default_k);
     }
@@ -154,6 +178,28 @@ class blobs_ref_gt {
         return assign(arg, flush);
     }
 
+    /**
+     * @brief Overwrites parts of the values, starting from the `position`, instead of replacing them.
+     * Values are extended with zeros, if they are shorter, and are created, if missing.
+     * @param position Offset in bytes, or `ustore_length_missing_k` to append.
+     * @param flush Pass true, if you need the data to be persisted before returning.
+     */
+    template <typename contents_arg_at>
+    status_t assign_at(ustore_length_t position, contents_arg_at&& vals, bool flush = false) noexcept {
+        return any_assign(std::forward<contents_arg_at>(vals),
+                          flush ? ustore_option_write_flush_k : ustore_options_default_k,
+                          &position);
+    }
+
+    /**
+     * @brief Appends the contents to the ends of the values, creating the missing ones.
+     * @param flush Pass true, if you need the data to be persisted before returning.
+     */
+    template <typename contents_arg_at>
+    status_t append(contents_arg_at&& vals, bool flush = false) noexcept {
+        return assign_at(ustore_length_missing_k, std::forward<contents_arg_at>(vals), flush);
+    }
+
     template <typename contents_arg_at>
     blobs_ref_gt& operator=(contents_arg_at&& vals) noexcept(false) {
         auto status = assign(std::forward<contents_arg_at>(vals));
@@ -178,7 +224,9 @@ static_assert(!blobs_ref_gt<places_arg_t>::is_one_k);
 
 template <typename locations_at>
 template <typename expected_at>
-expected_gt<expected_at> blobs_ref_gt<locations_at>::any_get(ustore_options_t options) noexcept {
+expected_gt<expected_at> blobs_ref_gt<locations_at>::any_get(ustore_options_t options,
+                                                             ustore_length_t slice_start,
+                                                             ustore_length_t slice_length) noexcept {
 
     status_t status;
     ustore_length_t* found_offsets = nullptr;
@@ -205,6 +253,8 @@ expected_gt<expected_at> blobs_ref_gt<locations_at>::any_get(ustore_options_t op
     read.collections_stride = collections.stride();
     read.keys = keys.get();
     read.keys_stride = keys.stride();
+    read.slices_starts = slice_start ? &slice_start : nullptr;
+    read.slices_lengths = slice_length != ustore_length_missing_k ? &slice_length : nullptr;
     read.presences = wants_present ? &found_presences : nullptr;
     read.offsets = wants_value ? &found_offsets : nullptr;
     read.lengths = wants_value || wants_length ? &found_lengths : nullptr;
@@ -240,7 +290,9 @@ expected_gt<expected_at> blobs_ref_gt<locations_at>::any_get(ustore_options_t op
 
 template <typename locations_at>
 template <typename contents_arg_at>
-status_t blobs_ref_gt<locations_at>::any_assign(contents_arg_at&& vals_ref, ustore_options_t options) noexcept {
+status_t blobs_ref_gt<locations_at>::any_assign(contents_arg_at&& vals_ref,
+                                                ustore_options_t options,
+                                                ustore_length_t const* position) noexcept {
     status_t status;
     using value_extractor_t = contents_arg_extractor_gt<std::remove_reference_t<contents_arg_at>>;
 
@@ -271,6 +323,7 @@ status_t blobs_ref_gt<locations_at>::any_assign(contents_arg_at&& vals_ref, usto
     write.lengths_stride = lengths.stride();
     write.values = contents.get();
     write.values_stride = contents.stride();
+    write.positions = position;
 
     ustore_write(&write);
     return status;
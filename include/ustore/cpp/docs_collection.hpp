@@ -149,6 +149,60 @@ class docs_collection_t {
         return status;
     }
 
+    /**
+     * @brief Declares a secondary index on the `field`, stored in the `index` collection.
+     * Passing `::ustore_doc_field_null_k` as the `type` drops it. @see `ustore_docs_index()`.
+     */
+    status_t index(ustore_str_view_t field, ustore_doc_field_type_t type, ustore_collection_t index) noexcept {
+        status_t status;
+        ustore_docs_index_t docs_index {};
+        docs_index.db = db_;
+        docs_index.error = status.member_ptr();
+        docs_index.transaction = txn_;
+        docs_index.arena = arena_.member_ptr();
+        docs_index.collection = collection_;
+        docs_index.field = field;
+        docs_index.type = type;
+        docs_index.index = index;
+        ustore_docs_index(&docs_index);
+        return status;
+    }
+
+    /**
+     * @brief Finds the keys of documents, which indexed `field` is within the inclusive bounds.
+     * Bounds are JSON scalars, and NULL ones are open. @see `ustore_docs_find()`.
+     */
+    expected_gt<ptr_range_gt<ustore_key_t>> find( //
+        ustore_str_view_t field,
+        ustore_str_view_t min_value,
+        ustore_str_view_t max_value,
+        ustore_length_t count_limit = std::numeric_limits<ustore_length_t>::max()) noexcept {
+        status_t status;
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_docs_find_t docs_find {};
+        docs_find.db = db_;
+        docs_find.error = status.member_ptr();
+        docs_find.transaction = txn_;
+        docs_find.arena = arena_.member_ptr();
+        docs_find.tasks_count = 1;
+        docs_find.collections = &collection_;
+        docs_find.fields = &field;
+        docs_find.min_values = &min_value;
+        docs_find.max_values = &max_value;
+        docs_find.count_limits = &count_limit;
+        docs_find.counts = &found_counts;
+        docs_find.keys = &found_keys;
+        ustore_docs_find(&docs_find);
+        if (!status)
+            return std::move(status);
+        return ptr_range_gt<ustore_key_t> {found_keys, found_keys + found_counts[0]};
+    }
+
+    expected_gt<ptr_range_gt<ustore_key_t>> find(ustore_str_view_t field, ustore_str_view_t value) noexcept {
+        return find(field, value, value);
+    }
+
     inline docs_ref_gt<places_arg_t> operator[](std::initializer_list<ustore_key_t> keys) noexcept { return at(keys); }
     inline docs_ref_gt<places_arg_t> at(std::initializer_list<ustore_key_t> keys) noexcept { //
         return at(strided_range(keys));
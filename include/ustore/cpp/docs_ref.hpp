@@ -215,6 +215,17 @@ class docs_ref_gt {
                          flush ? ustore_option_write_flush_k : ustore_options_default_k);
     }
 
+    /**
+     * @brief Atomically adds numbers to the numeric fields of documents.
+     */
+    template <typename contents_arg_at>
+    status_t increment(contents_arg_at&& vals, bool flush = false) noexcept {
+        return any_write(std::forward<contents_arg_at>(vals),
+                         ustore_doc_modify_increment_k,
+                         type_,
+                         flush ? ustore_option_write_flush_k : ustore_options_default_k);
+    }
+
     template <typename contents_arg_at>
     status_t insert(contents_arg_at&& vals, bool flush = false) noexcept {
         return any_write(std::forward<contents_arg_at>(vals),
@@ -58,7 +58,7 @@ class graph_collection_t {
         return status;
     }
 
-    status_t upsert_edges(edges_view_t const& edges) noexcept {
+    status_t upsert_edges(edges_view_t const& edges, bool compact = false) noexcept {
         status_t status;
 
         ustore_graph_upsert_edges_t graph_upsert_edges {};
@@ -66,6 +66,7 @@ class graph_collection_t {
         graph_upsert_edges.error = status.member_ptr();
         graph_upsert_edges.transaction = transaction_;
         graph_upsert_edges.arena = arena_;
+        graph_upsert_edges.options = compact ? ustore_option_graph_compact_k : ustore_options_default_k;
         graph_upsert_edges.tasks_count = edges.size();
         graph_upsert_edges.collections = &collection_;
         graph_upsert_edges.edges_ids = edges.edge_ids.begin().get();
@@ -82,10 +83,13 @@ class graph_collection_t {
     status_t remove_vertices( //
         strided_range_gt<ustore_key_t const> vertices,
         strided_range_gt<ustore_vertex_role_t const> roles = {},
-        bool flush = false) noexcept {
+        bool flush = false,
+        bool lazy = false) noexcept {
 
         status_t status;
         ustore_options_t options = flush ? ustore_option_write_flush_k : ustore_options_default_k;
+        if (lazy)
+            options = ustore_options_t(options | ustore_option_graph_lazy_k);
 
         ustore_graph_remove_vertices_t graph_remove_vertices {};
         graph_remove_vertices.db = db_;
@@ -17,6 +17,8 @@ namespace unum::ustore {
 /**
  * @brief A stream of all @c edge_t's in a graph.
  * No particular order is guaranteed.
+ * With `prefetch_in_background`, the next batch of vertices is scanned,
+ * while the edges of the current one are being gathered and consumed.
  */
 class graph_stream_t {
 
@@ -82,9 +84,10 @@ class graph_stream_t {
                    ustore_transaction_t txn = nullptr,
                    ustore_snapshot_t snap = 0,
                    std::size_t read_ahead_vertices = keys_stream_t::default_read_ahead_k,
-                   ustore_vertex_role_t role = ustore_vertex_role_any_k) noexcept
+                   ustore_vertex_role_t role = ustore_vertex_role_any_k,
+                   bool prefetch_in_background = false) noexcept
         : db_(db), collection_(collection), transaction_(txn), snapshot_(snap), role_(role), arena_(db),
-          vertex_stream_(db, collection, read_ahead_vertices, txn) {}
+          vertex_stream_(db, collection, read_ahead_vertices, txn, ustore_key_unknown_k, prefetch_in_background) {}
 
     graph_stream_t(graph_stream_t&&) = default;
     graph_stream_t& operator=(graph_stream_t&&) = default;
@@ -26,6 +26,72 @@ struct place_t {
     inline collection_key_t collection_key() const noexcept { return {collection, key}; }
     inline collection_key_field_t collection_key_field() const noexcept { return {collection, key, field}; }
 };
+/**
+ * @brief Memory layouts of strided arguments, common enough to deserve dedicated loops.
+ */
+enum class layout_t {
+    missing_k,    ///< NULL argument, replaced with the default value.
+    broadcast_k,  ///< Zero stride, the same element for every task.
+    contiguous_k, ///< Densely packed elements, like a plain C array.
+    strided_k,    ///< Any other stride.
+};
+
+/**
+ * @brief Strided iterator with its layout known at compile time.
+ * The generic `strided_iterator_gt` multiplies the stride on every access, which
+ * keeps the compilers from unrolling and vectorizing the loops over batches.
+ */
+template <layout_t layout_ak, typename element_at>
+class laid_out_gt {
+    element_at* raw_ {nullptr};
+    ustore_size_t stride_ {0};
+
+  public:
+    static constexpr layout_t layout_k = layout_ak;
+
+    laid_out_gt(strided_iterator_gt<element_at> const& it) noexcept : raw_(it.get()), stride_(it.stride()) {}
+
+    element_at& operator[](ustore_size_t idx) const noexcept {
+        if constexpr (layout_ak == layout_t::broadcast_k)
+            return *raw_;
+        else if constexpr (layout_ak == layout_t::contiguous_k)
+            return raw_[idx];
+        else
+            return *(element_at*)((char*)raw_ + stride_ * idx);
+    }
+
+    explicit operator bool() const noexcept { return layout_ak != layout_t::missing_k; }
+};
+
+/**
+ * @brief Compile-time specialized alternative to `places_arg_t`, produced by its `dispatch()`.
+ */
+template <typename collections_at, typename keys_at>
+struct places_gt {
+    using value_type = place_t;
+    collections_at collections_begin;
+    keys_at keys_begin;
+    strided_iterator_gt<ustore_str_view_t const> fields_begin;
+    ustore_size_t count {0};
+
+    inline std::size_t size() const noexcept { return count; }
+    inline place_t operator[](std::size_t i) const noexcept {
+        ustore_collection_t collection = collections_begin ? collections_begin[i] : ustore_collection_main_k;
+        ustore_key_t const& key = keys_begin[i];
+        ustore_str_view_t field = fields_begin ? fields_begin[i] : nullptr;
+        return {collection, key, field};
+    }
+
+    bool same_collection() const noexcept {
+        if constexpr (collections_at::layout_k != layout_t::strided_k)
+            return true;
+        for (std::size_t i = 1; i < count; ++i)
+            if (collections_begin[i] != collections_begin[0])
+                return false;
+        return true;
+    }
+};
+
 /**
  * Working with batched data is ugly in C++.
  * This handle doesn't help in the general case,
@@ -49,6 +115,31 @@ struct places_arg_t {
     bool same_collection() const noexcept {
         return strided_range_gt<ustore_collection_t const>(collections_begin, count).same_elements();
     }
+
+    /**
+     * @brief Inspects the strides once, passing an equivalent `places_gt` to the `callback`,
+     * specialized for missing or broadcast collections and contiguous keys. Only the most common
+     * combinations get their own instantiations, the rest fall back to strided accesses.
+     */
+    template <typename callback_at>
+    void dispatch(callback_at&& callback) const {
+        using collection_t = ustore_collection_t const;
+        auto with_keys = [&](auto collections) {
+            using collections_t = decltype(collections);
+            using contiguous_t = laid_out_gt<layout_t::contiguous_k, ustore_key_t const>;
+            using strided_t = laid_out_gt<layout_t::strided_k, ustore_key_t const>;
+            if (keys_begin.is_continuous())
+                callback(places_gt<collections_t, contiguous_t> {collections, keys_begin, fields_begin, count});
+            else
+                callback(places_gt<collections_t, strided_t> {collections, keys_begin, fields_begin, count});
+        };
+        if (!collections_begin)
+            with_keys(laid_out_gt<layout_t::missing_k, collection_t> {collections_begin});
+        else if (collections_begin.repeats())
+            with_keys(laid_out_gt<layout_t::broadcast_k, collection_t> {collections_begin});
+        else
+            with_keys(laid_out_gt<layout_t::strided_k, collection_t> {collections_begin});
+    }
 };
 
 /**
@@ -100,6 +191,23 @@ struct contents_arg_t {
     }
 };
 
+/**
+ * @brief Byte ranges of the values, exported by `ustore_read()`.
+ * Is used by engines to cut the values right before exporting them.
+ */
+struct slices_arg_t {
+    strided_iterator_gt<ustore_length_t const> starts_begin;
+    strided_iterator_gt<ustore_length_t const> lengths_begin;
+    ustore_length_t limit {0};
+
+    inline value_view_t apply(std::size_t i, value_view_t value) const noexcept {
+        if (starts_begin || lengths_begin)
+            value = value.slice(starts_begin ? starts_begin[i] : 0u,
+                                lengths_begin ? lengths_begin[i] : ustore_length_missing_k);
+        return limit ? value.prefix(limit) : value;
+    }
+};
+
 struct scan_t {
     ustore_collection_t collection;
     ustore_key_t min_key;
@@ -264,8 +372,18 @@ inline void validate_write(ustore_transaction_t const c_txn,
     auto allowed_options =                       //
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
-        ustore_option_write_flush_k;
+        ustore_option_write_flush_k |            //
+        ustore_option_write_bulk_k |             //
+        ustore_option_write_merge_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
+    return_error_if_m(!c_txn || !(c_options & ustore_option_write_bulk_k),
+                      c_error,
+                      args_combo_k,
+                      "Bulk writes can't be transactional!");
+    return_error_if_m(!(c_options & ustore_option_write_bulk_k) || !(c_options & ustore_option_write_merge_k),
+                      c_error,
+                      args_combo_k,
+                      "Bulk writes can't be merged!");
 
     return_error_if_m(places.keys_begin, c_error, args_wrong_k, "No keys were provided!");
 
@@ -297,7 +415,9 @@ inline void validate_read(ustore_transaction_t const c_txn,
     auto allowed_options =                       //
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
-        ustore_option_read_shared_memory_k;
+        ustore_option_read_shared_memory_k |     //
+        ustore_option_read_deduplicate_k |       //
+        ustore_option_write_bulk_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
 
     return_error_if_m(places.keys_begin, c_error, args_wrong_k, "No keys were provided!");
@@ -324,7 +444,8 @@ inline void validate_scan(ustore_transaction_t const c_txn,
         ustore_option_transaction_dont_watch_k | //
         ustore_option_dont_discard_memory_k |    //
         ustore_option_read_shared_memory_k |     //
-        ustore_option_scan_bulk_k;
+        ustore_option_scan_bulk_k |              //
+        ustore_option_write_bulk_k;
     return_error_if_m(enum_is_subset(c_options, allowed_options), c_error, args_wrong_k, "Invalid options!");
 
     return_error_if_m(args.limits, c_error, args_wrong_k, "Full scans aren't supported - paginate!");
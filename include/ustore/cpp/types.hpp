@@ -8,6 +8,7 @@
  */
 
 #pragma once
+#include <algorithm>   // `std::min`
 #include <functional>  // `std::hash`
 #include <utility>     // `std::exchange`
 #include <cstring>     // `std::strlen`
@@ -183,6 +184,19 @@ class value_view_t {
     inline bool empty() const noexcept { return !size(); }
     operator std::string_view() const noexcept { return {c_str(), size()}; }
 
+    /// Keeps at most `n` leading bytes, while missing values stay missing.
+    inline value_view_t prefix(std::size_t n) const noexcept {
+        return *this && n < length_ ? value_view_t {ptr_, static_cast<ustore_length_t>(n)} : *this;
+    }
+
+    /// Keeps at most `n` bytes, skipping the first `start`, while missing values stay missing.
+    inline value_view_t slice(std::size_t start, std::size_t n) const noexcept {
+        if (!*this)
+            return *this;
+        start = std::min<std::size_t>(start, length_);
+        return value_view_t {ptr_ + start, static_cast<ustore_length_t>(std::min<std::size_t>(n, length_ - start))};
+    }
+
     ustore_bytes_cptr_t const* member_ptr() const noexcept { return &ptr_; }
     ustore_length_t const* member_length() const noexcept { return &length_; }
 
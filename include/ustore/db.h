@@ -192,8 +192,61 @@ typedef enum {
      * to do further transformations without any copies.
      * Is relevant for standalone distributions used with drivers supporting
      * Apache Arrow buffers or standardized Tensor representations.
+     * With the Flight client, lets a server on the same host leave the read
+     * contents in named shared memory, which the client maps instead of receiving.
      */
     ustore_option_read_shared_memory_k = 1 << 5,
+    /**
+     * @brief Hints that the write is a part of a large initial load. Engines may
+     * then bypass their logs and memory tables, staging the batch into sorted
+     * files and attaching them directly. Such writes aren't atomic across
+     * collections and can't be transactional. Reads ignore this flag, so
+     * it can be passed through read-modify-write modalities.
+     */
+    ustore_option_write_bulk_k = 1 << 6,
+    /**
+     * @brief Consumed by the Graph modality on updates. Stores the touched
+     * vertices with delta- and varint-encoded neighbor lists, dropping edge IDs
+     * if all of them are default. Vertices, that are already stored this way,
+     * remain compact on further updates. Isn't accepted by the engines directly.
+     */
+    ustore_option_graph_compact_k = 1 << 7,
+    /**
+     * @brief Consumed by the Docs modality on field reads. Keeps the extracted
+     * fields of recently read documents in a bounded process-wide cache,
+     * validated against the fingerprint of the stored document, so that hot
+     * documents aren't parsed again until they change. Isn't accepted by the engines directly.
+     */
+    ustore_option_docs_cache_k = 1 << 8,
+    /**
+     * @brief Passes the values to the merge operator of the engine, instead of
+     * replacing the stored ones. Used by modalities, like Docs, to apply their
+     * modifications at the storage layer, without read-then-write round-trips
+     * and conflicts between concurrent writers. Can't be combined with bulk writes.
+     * Engines without merge operators, like LevelDB, reject it.
+     */
+    ustore_option_write_merge_k = 1 << 9,
+    /**
+     * @brief Backs the newly allocated parts of the arena with huge pages.
+     * Private memory prefers the pages reserved for `MAP_HUGETLB`, falling back to
+     * Transparent Huge Pages, which are the only option for shared memory.
+     * Reduces TLB misses on large batches, at the cost of coarser allocations.
+     */
+    ustore_option_huge_pages_k = 1 << 10,
+    /**
+     * @brief Consumed by the Graph modality on vertex removals. Instead of updating
+     * every neighbor, the entries of removed vertices are moved aside and marked with
+     * tombstones, which reads skip. The neighbors are purged by the next update touching
+     * the vertex, or by removing it again without this flag. Isn't accepted by the engines directly.
+     */
+    ustore_option_graph_lazy_k = 1 << 11,
+    /**
+     * @brief Sorts and deduplicates the keys of batched reads, before they reach the engine,
+     * scattering the results back into the original positions. Fetches every entry once,
+     * and in the order of keys. Repeated keys may share the exported values, if both
+     * `offsets` and `lengths` are requested. Reads of slices are passed to the engine as is.
+     */
+    ustore_option_read_deduplicate_k = 1 << 12,
     /**
      * @brief When set, the underlying engine may avoid strict keys ordering
      * and may include irrelevant (deleted & duplicate) keys in order to maximize
@@ -250,9 +303,16 @@ typedef struct ustore_database_init_t {
      * @see `db_config.json` file.
      *
      * For embedded distributions should be a json string containing DB options.
+     * Builds with `USTORE_USE_CUDA` accept `"accelerator": "cuda"`, to run exact vector
+     * searches on the GPU, keeping the quantized vectors of searched collections in its memory.
      *
      * Special:
-     * - Flight API Client: `grpc://0.0.0.0:38709`.
+     * - Flight API Client: `grpc://0.0.0.0:38709`. Concurrent calls are spread
+     *   across a pool of connections, which size can be set with `?channels=4`.
+     *   Reads from a replica server fail, if it lags more than `?max_staleness=500` milliseconds.
+     *   Keys can be sharded between several servers with a JSON config, like:
+     *   `{"partitioning": "range", "shards": [{"url": "grpc://...", "start_key": 0}, ...]}`,
+     *   or `"hash"` partitioning, that doesn't need start keys.
      */
     ustore_str_view_t config;
     /** @brief A pointer to the opened KVS, unless `error` is filled. */
@@ -418,7 +478,19 @@ typedef struct ustore_collection_create_t {
     ustore_error_t* error;
     /** @brief Unique name for the new collection. */
     ustore_str_view_t name;
-    /** @brief Optional configuration JSON string. */
+    /**
+     * @brief Optional configuration JSON string.
+     *
+     * RocksDB and UCSet engines accept a time-to-live in seconds, like `{"ttl": 3600}`.
+     * Values of such collections are reported missing by all reads once they expire,
+     * and are removed in the background. Merges into them are rejected.
+     *
+     * RocksDB, UCSet and Tiered engines can store the paths of a collection natively,
+     * instead of hashing them into integer keys, if created with `{"keys": "strings"}`.
+     * Such collections are only accessible through the Paths modality and can't expire.
+     * LevelDB has no collections, so the main one gets string keys with the engine
+     * config `{"string_keys": true}`.
+     */
     ustore_str_view_t config;
     /** @brief Output for the collection handle. */
     ustore_collection_t* id;
@@ -467,8 +539,12 @@ void ustore_collection_drop(ustore_collection_drop_t*);
  * - "clear":   Removes all the data from DB, while keeping collection names.
  * - "reset":   Removes all the data from DB, including collection names.
  * - "compact": Flushes and compacts all the data in LSM-tree implementations.
+ *              In-memory implementations relocate values out of sparse slabs, returning those to the system.
+ * - "compaction": Progress of the past and running in-memory compactions, as JSON.
  * - "info":    Metadata about the current software version, used for debugging.
  * - "usage":   Metadata about approximate collection sizes, RAM and disk usage.
+ * - "metrics": Calls, failures, latency histograms of public functions and arena usage, as JSON.
+ *              With "metrics.prometheus" the same is exported in Prometheus text format.
  */
 typedef struct ustore_database_control_t {
     /** @brief Already open database instance. */
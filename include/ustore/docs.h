@@ -93,6 +93,11 @@ typedef enum ustore_doc_modification_t {
     ustore_doc_modify_insert_k = 2,
     ustore_doc_modify_patch_k = 3,
     ustore_doc_modify_merge_k = 4,
+    /**
+     * @brief Adds the number to the one in the field, creating it if missing.
+     * Integers remain integers, unless either of the numbers is real.
+     */
+    ustore_doc_modify_increment_k = 5,
 } ustore_doc_modification_t;
 
 /*********************************************************/
@@ -125,7 +130,11 @@ typedef struct ustore_docs_write_t {
     ustore_transaction_t transaction;
     /** @brief Reusable memory handle. */
     ustore_arena_t* arena;
-    /** @brief Write or Read+Write options for Read-Modify-Write operations. @see `ustore_write_t`. */
+    /**
+     * @brief Write or Read+Write options for Read-Modify-Write operations. @see `ustore_write_t`.
+     * With `::ustore_option_write_merge_k` modifications are passed to the engine as merge
+     * operands, instead of being read, applied and written back. Inserts can't be merged.
+     */
     ustore_options_t options;
 
     /// @}
@@ -188,7 +197,7 @@ typedef struct ustore_docs_read_t {
     ustore_snapshot_t snapshot;
     /** @brief Reusable memory handle. */
     ustore_arena_t* arena;
-    /** @brief Read options. @see `ustore_read_t`. */
+    /** @brief Read options, including `::ustore_option_docs_cache_k`. @see `ustore_read_t`. */
     ustore_options_t options;
 
     /// @}
@@ -308,6 +317,7 @@ void ustore_docs_gist(ustore_docs_gist_t*);
  *
  * - Number of columns will be `== fields_count`.
  * - Number of entries in each column will be `>= docs_count`.
+ * - Every bitmap and column will start at a 64-byte boundary, as Apache Arrow recommends.
  *
  * ## Strings Layout
  *
@@ -334,7 +344,7 @@ typedef struct ustore_docs_gather_t {
     ustore_snapshot_t snapshot;
     /** @brief Reusable memory handle. */
     ustore_arena_t* arena;
-    /** @brief Read options. @see `ustore_read_t`. */
+    /** @brief Read options, including `::ustore_option_docs_cache_k`. @see `ustore_read_t`. */
     ustore_options_t options;
 
     /// @}
@@ -356,10 +366,29 @@ typedef struct ustore_docs_gather_t {
     ustore_doc_field_type_t const* types;
     ustore_size_t types_stride;
 
+    /**
+     * @brief Number of threads to split the documents between.
+     * Zero uses the "threads_count" from the database config, which defaults to one.
+     */
+    ustore_size_t threads_count;
+
+    /**
+     * @brief Optional predicate, like `price > 100 AND category == "x"`, evaluated before
+     * the documents are exported. The columns will only contain the matching documents, in
+     * the order of the inputs, and `fields_count` may be zero, if only the matches are needed.
+     * @see "Filters" in `ustore_docs_scan_t` for the syntax.
+     */
+    ustore_str_view_t filter;
+
     /// @}
     /// @name Outputs
     /// @{
 
+    /** @brief Optional output for the number of documents matching the `filter`. */
+    ustore_length_t* matches_count;
+    /** @brief Optional output for the indexes of the documents matching the `filter` within the inputs. */
+    ustore_length_t** matches;
+
     ustore_octet_t*** columns_validities;
     ustore_octet_t*** columns_conversions;
     ustore_octet_t*** columns_collisions;
@@ -381,6 +410,363 @@ typedef struct ustore_docs_gather_t {
  */
 void ustore_docs_gather(ustore_docs_gather_t*);
 
+/**
+ * @brief Scans a collection of documents, exporting the keys of the ones matching a predicate.
+ * @see `ustore_docs_scan()`.
+ *
+ * ## Filters
+ *
+ * Predicates compare fields of documents with literals, combined with `&&`, `||`, `!`
+ * and parentheses, or with the `AND`, `OR` and `NOT` keywords:
+ *
+ * - `price > 100 AND category == "x"`
+ * - `/user/followers_count >= 1000 || !(/user/verified == true)`
+ *
+ * Fields are names or JSON-Pointers, compared with `==`, `!=`, `<`, `<=`, `>` or `>=` to numbers,
+ * JSON strings or booleans. Fields are extracted, just like in `ustore_docs_gather()`, using the
+ * columns of collections in the "columnar" mode. Numbers are compared as reals, so integers and
+ * strings holding numbers match numeric literals. Strings and booleans must match the type of the
+ * literal. Missing fields, and the ones that can't be compared, don't match anything, even `!=`.
+ *
+ * When connected to a remote server, the filter is evaluated there,
+ * and only the keys of the matching documents are sent back.
+ */
+typedef struct ustore_docs_scan_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Collection of documents to scan. */
+    ustore_collection_t collection;
+    /** @brief Smallest key to scan. */
+    ustore_key_t start_key;
+    /**
+     * @brief Largest number of matching keys to export.
+     * Fewer keys are exported only at the end of the collection.
+     */
+    ustore_length_t count_limit;
+    /** @brief Predicate, that the documents must match. */
+    ustore_str_view_t filter;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Output for the number of exported keys. */
+    ustore_length_t* count;
+    /** @brief Output for the keys of the matching documents, in ascending order. */
+    ustore_key_t** keys;
+
+    /// @}
+
+} ustore_docs_scan_t;
+
+/**
+ * @brief Scans a collection of documents, filtering them on the side of the data.
+ * @see `ustore_docs_scan_t`.
+ */
+void ustore_docs_scan(ustore_docs_scan_t*);
+
+/**
+ * @brief Key, under which collections in the "columnar" mode or with secondary indexes
+ * keep their schema. The schema is a regular JSON document listing the columns and indexes,
+ * so it will be visible to scans. @see `ustore_docs_columns()`, `ustore_docs_index()`.
+ */
+extern ustore_key_t ustore_docs_schema_key_k;
+
+/**
+ * @brief Switches a collection of documents into the "columnar" mode.
+ * @see `ustore_docs_columns()`.
+ *
+ * Every declared field is shredded into a separate sibling collection,
+ * which stores one typed cell per document under the same key. The cells
+ * are backfilled for the existing documents and are updated on every
+ * `ustore_docs_write()` into the collection afterwards.
+ *
+ * When all of the documents passed into `ustore_docs_gather()` come from
+ * the same collection, the fields requested with the same types as their
+ * columns are exported from the cells, without fetching or parsing the documents.
+ *
+ * Fields to declare can be listed with `ustore_docs_gist()`. Missing types are
+ * inferred from the first documents, that have a scalar value in that field.
+ */
+typedef struct ustore_docs_columns_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /**
+     * @brief The transaction in which the operation will be watched.
+     * Recommended, to avoid missing the documents written concurrently with the backfill.
+     */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options. @see `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Collection of documents to shred. */
+    ustore_collection_t collection;
+    /** @brief Number of columns. Zero switches the collection back into the row-only mode. */
+    ustore_size_t fields_count;
+
+    ustore_str_view_t const* fields;
+    ustore_size_t fields_stride;
+
+    /** @brief Optional types of columns. `::ustore_doc_field_null_k` entries will be inferred. */
+    ustore_doc_field_type_t const* types;
+    ustore_size_t types_stride;
+
+    /**
+     * @brief Existing collections to store the columns in, one for every field.
+     * Their previous contents are not cleared.
+     */
+    ustore_collection_t const* columns;
+    ustore_size_t columns_stride;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Optional output for the declared or inferred types of all columns. */
+    ustore_doc_field_type_t** columns_types;
+
+    /// @}
+
+} ustore_docs_columns_t;
+
+/**
+ * @brief Shreds the documents of a collection into per-field columns,
+ * that will accelerate the `ustore_docs_gather()` of those fields.
+ * @see `ustore_docs_columns_t`.
+ */
+void ustore_docs_columns(ustore_docs_columns_t*);
+
+/**
+ * @brief Declares or drops a secondary index on a field of documents.
+ * @see `ustore_docs_index()`.
+ *
+ * The index maps the values of the field to the keys of the documents,
+ * and is stored in a separate collection. It is backfilled for the existing
+ * documents and is updated on every `ustore_docs_write()` into the collection.
+ * If such a write isn't a part of a transaction, it is wrapped into one, so
+ * that the documents and the index entries change atomically, unless the
+ * engine has no transactions or the write is a `::ustore_option_write_bulk_k`.
+ *
+ * Integer, real and string fields can be indexed. Documents, where the field
+ * is missing or has a different type, are skipped. Close numbers and strings
+ * with the same 7-byte prefix share keys in the index collection. Keys, that
+ * collect too many documents, like those of low-cardinality fields, are split
+ * into pages by document keys, so that every write updates a single page.
+ */
+typedef struct ustore_docs_index_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /**
+     * @brief The transaction in which the operation will be watched.
+     * Recommended, to avoid missing the documents written concurrently with the backfill.
+     */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options. @see `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Collection of documents to index. */
+    ustore_collection_t collection;
+    /** @brief Field to index, replacing its previous index, if any. */
+    ustore_str_view_t field;
+    /**
+     * @brief Type of the indexed values: `::ustore_doc_field_i64_k`, `::ustore_doc_field_f64_k`
+     * or `::ustore_doc_field_str_k`. Passing `::ustore_doc_field_null_k` drops the index.
+     */
+    ustore_doc_field_type_t type;
+    /**
+     * @brief Existing empty collection to store the index in.
+     * Dropped indexes keep their collections, which can be cleared with `ustore_collection_drop()`.
+     */
+    ustore_collection_t index;
+
+    /// @}
+
+} ustore_docs_index_t;
+
+/**
+ * @brief Declares or drops a secondary index on a field of documents,
+ * that will accelerate the `ustore_docs_find()` of documents by that field.
+ * @see `ustore_docs_index_t`.
+ */
+void ustore_docs_index(ustore_docs_index_t*);
+
+/**
+ * @brief Finds the documents, which indexed field values are within the given bounds.
+ * @see `ustore_docs_find()`.
+ *
+ * Every task looks up one field of one collection, which must have been indexed
+ * with `ustore_docs_index()`. Bounds are JSON scalars of the type of the index,
+ * like `42`, `3.14` or `"user@example.com"`, and both of them are inclusive.
+ * Equality lookups pass the same value as both bounds.
+ *
+ * Keys of the found documents are exported in the order of their values,
+ * and then in the order of the keys, if the values are equal.
+ */
+typedef struct ustore_docs_find_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Number of separate lookups. */
+    ustore_size_t tasks_count;
+
+    /** @brief Sequence of collections of documents. */
+    ustore_collection_t const* collections;
+    ustore_size_t collections_stride;
+
+    /** @brief Sequence of indexed fields. */
+    ustore_str_view_t const* fields;
+    ustore_size_t fields_stride;
+
+    /** @brief Optional sequence of inclusive lower bounds. NULL entries are unbounded. */
+    ustore_str_view_t const* min_values;
+    ustore_size_t min_values_stride;
+
+    /** @brief Optional sequence of inclusive upper bounds. NULL entries are unbounded. */
+    ustore_str_view_t const* max_values;
+    ustore_size_t max_values_stride;
+
+    /** @brief Optional sequence of limits on the number of found keys per task. */
+    ustore_length_t const* count_limits;
+    ustore_size_t count_limits_stride;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    /** @brief Optional output for the number of found keys in every task. */
+    ustore_length_t** counts;
+    /** @brief Optional output for the offsets of every task in `keys`, with one extra entry in the end. */
+    ustore_length_t** offsets;
+    /** @brief Output for the concatenated keys of the found documents. */
+    ustore_key_t** keys;
+
+    /// @}
+
+} ustore_docs_find_t;
+
+/**
+ * @brief Finds the keys of documents by the values of their indexed fields.
+ * @see `ustore_docs_find_t`.
+ */
+void ustore_docs_find(ustore_docs_find_t*);
+
+/**
+ * @brief Compresses the documents of a collection with Zstandard and a dictionary.
+ * @see `ustore_docs_compress()`.
+ *
+ * The dictionary is trained on a random sample of the documents and is stored
+ * in the schema of the collection, so that the small documents, that share most
+ * of their structure, compress well one by one. The existing documents are
+ * re-compressed in batches, and the following writes into the collection are
+ * compressed on arrival. Calling it again re-trains the dictionary.
+ *
+ * Compression is applied above the engine, so it is the same on every engine,
+ * but @b merge-writes into compressed collections fall back to reading the documents.
+ */
+typedef struct ustore_docs_compress_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /**
+     * @brief The transaction in which the operation will be watched.
+     * Recommended, to avoid overwriting the documents written concurrently with the re-compression.
+     */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Write options. @see `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief Collection of documents to compress. */
+    ustore_collection_t collection;
+    /** @brief Zstandard compression level. Zero picks the default of 3. */
+    ustore_length_t level;
+    /** @brief Number of documents to sample for training. Zero picks the default of 4096. */
+    ustore_length_t samples_count;
+    /**
+     * @brief Upper bound for the size of the dictionary in bytes. Zero picks the default of 16 KB.
+     * If the samples are too few to train on, documents are compressed without a dictionary.
+     */
+    ustore_length_t dictionary_capacity;
+
+    /// @}
+
+} ustore_docs_compress_t;
+
+/**
+ * @brief Compresses the documents of a collection with Zstandard and a dictionary.
+ * @see `ustore_docs_compress_t`.
+ */
+void ustore_docs_compress(ustore_docs_compress_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
@@ -213,6 +213,16 @@ typedef struct ustore_graph_upsert_edges_t {
     ustore_key_t const* targets_ids;
     ustore_size_t targets_stride;
 
+    /**
+     * @brief Which of the vertices of every edge to update.
+     * With `::ustore_vertex_source_k` only the outgoing neighborship of the source is stored,
+     * letting bulk loaders, that group edges by vertex, write every entry once.
+     * If `NULL` is passed, both vertices are updated. Is @b optional.
+     */
+    ustore_vertex_role_t const* roles;
+    /** @brief Step between `roles`. */
+    ustore_size_t roles_stride;
+
     /// @}
 
 } ustore_graph_upsert_edges_t;
@@ -360,6 +370,273 @@ typedef struct ustore_graph_remove_vertices_t { //
  */
 void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t*);
 
+/**
+ * @brief Expands the multi-hop neighborhood of given vertices in a Breadth-First order.
+ * @see `ustore_graph_traverse()`.
+ *
+ * ## Output Form
+ *
+ * Visited vertices are exported hop-by-hop, starting with the deduplicated
+ * `starts` at distance zero. The vertices first reached at distance @b `d`
+ * are `vertices[vertices_offsets[d] : vertices_offsets[d + 1]]`, sorted by ID.
+ * The `vertices_offsets` array has `hops + 2` entries.
+ *
+ * Edges are exported similar to `ustore_graph_find_edges()`, as triplets of
+ * source, target and edge IDs. Those are the edges of vertices expanded on
+ * every hop, matching the `role`. Edges found on hop @b `h`, counting from one,
+ * are `edges[edges_offsets[h - 1] : edges_offsets[h]]` triplets, and the
+ * `edges_offsets` array has `hops + 1` entries.
+ *
+ * ## Frontier Limits
+ *
+ * When `frontier_limit` is non-zero, only that many newly reached vertices
+ * with the smallest IDs will be visited and expanded on every hop.
+ */
+typedef struct ustore_graph_traverse_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph to traverse. */
+    ustore_collection_t collection;
+
+    ustore_size_t starts_count;
+    ustore_key_t const* starts;
+    ustore_size_t starts_stride;
+
+    /** @brief The number of hops to make from the `starts`. */
+    ustore_size_t hops;
+    /**
+     * @brief The role of expanded vertices within the followed edges.
+     * Pass `::ustore_vertex_source_k` to follow outgoing edges,
+     * `::ustore_vertex_target_k` for incoming, or `::ustore_vertex_role_any_k` for both.
+     */
+    ustore_vertex_role_t role;
+    /** @brief The maximum number of vertices to visit on every hop, or zero for no limit. */
+    ustore_size_t frontier_limit;
+    /**
+     * @brief By default every vertex is visited once, like in a classical BFS.
+     * When set, only the vertices of the current hop are deduplicated,
+     * and the ones reached again on further hops are expanded again.
+     */
+    bool revisit;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    ustore_length_t** vertices_offsets;
+    ustore_key_t** vertices;
+    /** @brief Optional. Skipped if `NULL`, together with the `edges`. */
+    ustore_length_t** edges_offsets;
+    ustore_key_t** edges;
+
+    /// @}
+
+} ustore_graph_traverse_t;
+
+/**
+ * @brief Expands the multi-hop neighborhood of given vertices in a Breadth-First order.
+ * @see `ustore_graph_traverse_t`.
+ */
+void ustore_graph_traverse(ustore_graph_traverse_t*);
+
+/*********************************************************/
+/*****************	 Graph Analytics	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Whole-graph algorithms, supported by `ustore_graph_analyze()`.
+ */
+typedef enum ustore_graph_algorithm_t {
+    /** @brief PageRank, following the edges from sources to targets. */
+    ustore_graph_pagerank_k = 0,
+    /** @brief Weakly Connected Components, ignoring edge directions. */
+    ustore_graph_components_k = 1,
+    /** @brief Louvain Communities maximizing modularity, ignoring edge directions. */
+    ustore_graph_communities_k = 2,
+} ustore_graph_algorithm_t;
+
+/**
+ * @brief Runs an analytical algorithm over the entire graph collection.
+ * @see `ustore_graph_analyze()`.
+ *
+ * The adjacency is streamed in batches into a compact in-memory snapshot
+ * in the Compressed Sparse Row format, where vertices are addressed by
+ * 32-bit offsets. That snapshot lives only until the function returns.
+ *
+ * ## Output Form
+ *
+ * All the `count` vertices of the graph are exported in ascending order.
+ * PageRank fills the `scores` array, summing up to one.
+ * Components and Communities fill the `labels` array, where every group
+ * is labeled by the smallest vertex ID within it.
+ */
+typedef struct ustore_graph_analyze_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph to analyze. */
+    ustore_collection_t collection;
+    ustore_graph_algorithm_t algorithm;
+
+    /** @brief Upper bound for PageRank iterations or Louvain levels. Zero defaults to 100. */
+    ustore_size_t iterations;
+    /** @brief PageRank damping factor. Zero defaults to 0.85. */
+    ustore_float_t damping;
+    /**
+     * @brief Zero picks the defaults. For PageRank it bounds the total change of scores
+     * between iterations, defaulting to 1e-6. For Louvain it is the minimal modularity
+     * growth, for which the next level is computed, defaulting to 1e-7.
+     */
+    ustore_float_t tolerance;
+    /**
+     * @brief Number of threads to split PageRank and Components between.
+     * Zero uses the "threads_count" from the database config, which defaults to one.
+     */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    ustore_size_t* count;
+    ustore_key_t** vertices;
+    /** @brief Only for `::ustore_graph_pagerank_k`. */
+    ustore_float_t** scores;
+    /** @brief Only for `::ustore_graph_components_k` and `::ustore_graph_communities_k`. */
+    ustore_key_t** labels;
+
+    /// @}
+
+} ustore_graph_analyze_t;
+
+/**
+ * @brief Runs an analytical algorithm over the entire graph collection.
+ * @see `ustore_graph_analyze_t`.
+ */
+void ustore_graph_analyze(ustore_graph_analyze_t*);
+
+/**
+ * @brief Exports the adjacency of a graph or its induced subgraph
+ * in the Compressed Sparse Row format.
+ * @see `ustore_graph_export_csr()`.
+ *
+ * Built the same way as the snapshots of `ustore_graph_analyze()`, but
+ * exported into the arena. Later changes of the graph aren't reflected in it.
+ *
+ * ## Output Form
+ *
+ * The `count` vertices are exported in ascending order of IDs. The vertex
+ * at offset `i` neighbors the ones at offsets `neighbors[offsets[i] : offsets[i + 1]]`,
+ * linked with the edges `edges_ids[offsets[i] : offsets[i + 1]]`.
+ * The `offsets` array has `count + 1` entries, where the last one is the number
+ * of exported edges. With `::ustore_vertex_role_any_k` every edge, except for
+ * self-loops, is exported twice - in the adjacency of each of its members.
+ */
+typedef struct ustore_graph_export_csr_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief A snapshot captures a point-in-time view of the DB at the time it's created. */
+    ustore_snapshot_t snapshot;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read options. @see `ustore_read_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    /** @brief The graph to export. */
+    ustore_collection_t collection;
+    /**
+     * @brief Role of the exported vertices in their edges.
+     * `::ustore_vertex_source_k` exports the successors of every vertex,
+     * `::ustore_vertex_target_k` its predecessors, `::ustore_vertex_role_any_k` both.
+     */
+    ustore_vertex_role_t role;
+
+    /**
+     * @brief Optional vertices of an induced subgraph, in any order.
+     * Edges leading outside of it and missing vertices are skipped.
+     * If NULL, the entire graph is exported.
+     */
+    ustore_key_t const* vertices;
+    ustore_size_t vertices_count;
+    ustore_size_t vertices_stride;
+
+    /**
+     * @brief Number of threads to map the neighbors into offsets.
+     * Zero uses the "threads_count" from the database config, which defaults to one.
+     */
+    ustore_size_t threads_count;
+
+    /// @}
+    /// @name Outputs
+    /// @{
+
+    ustore_size_t* count;
+    ustore_key_t** vertices_ids;
+    ustore_size_t** offsets;
+    ustore_length_t** neighbors;
+    /** @brief Optional IDs of the edges, aligned with `neighbors`. */
+    ustore_key_t** edges_ids;
+
+    /// @}
+
+} ustore_graph_export_csr_t;
+
+/**
+ * @brief Exports the adjacency of a graph or its induced subgraph
+ * in the Compressed Sparse Row format.
+ * @see `ustore_graph_export_csr_t`.
+ */
+void ustore_graph_export_csr(ustore_graph_export_csr_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
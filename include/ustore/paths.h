@@ -16,6 +16,9 @@
  * Strings keys often represent hierarchical paths. The character used as
  * delimeter/separator can be passed together with the queries to add transparent
  * indexes, that on prefix scan - would narrow down the search space.
+ * Writes with a `path_separator` also maintain a listing for every parent directory,
+ * so prefix matches with the same separator only visit the matching subtree.
+ * Paths starting with a NULL character are reserved for those listings.
  *
  * ## Allowed Characters
  *
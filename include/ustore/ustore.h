@@ -50,3 +50,4 @@
 #include "ustore/docs.h"
 #include "ustore/graph.h"
 #include "ustore/vectors.h"
+#include "ustore/async.h"
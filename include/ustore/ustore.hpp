@@ -11,3 +11,4 @@
 
 #pragma once
 #include "ustore/cpp/db.hpp"
+#include "ustore/cpp/async.hpp"
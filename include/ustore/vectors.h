@@ -79,6 +79,21 @@ typedef struct ustore_vectors_write_t {
     ustore_length_t const* offsets;
     ustore_size_t offsets_stride;
 
+    /**
+     * @brief Maximum number of neighbors per vector in the approximate
+     * search index of the collection, built as a Navigable Small World graph.
+     * Zero means the index won't be created, but if it already exists, it
+     * will still be incrementally updated with the original connectivity.
+     * If the collection already has vectors, the first indexed write inserts
+     * all of them into the graph, which is as expensive as a full scan.
+     */
+    ustore_length_t index_connectivity;
+    /**
+     * @brief Metric used to organize the index. Only searches with
+     * the same metric will be able to use it.
+     */
+    ustore_vector_metric_t metric;
+
     // @}
 
 } ustore_vectors_write_t;
@@ -175,6 +190,40 @@ typedef struct ustore_vectors_search_t {
     ustore_vector_metric_t metric;
     ustore_float_t metric_threshold;
 
+    /**
+     * @brief Width of the beam in the approximate search over the index,
+     * also known as "ef_search", trading latency for recall. Zero, or a
+     * collection without a compatible index, falls back to an exact full scan.
+     */
+    ustore_length_t index_expansion;
+    /**
+     * @brief Number of threads to split the exact scan of a collection between.
+     * Zero uses the "threads_count" from the database config, which defaults to one.
+     * Ignored inside of transactions.
+     */
+    ustore_size_t threads_count;
+    /**
+     * @brief Number of best candidates per query, re-scored against the full-precision
+     * originals, when searching in collections compressed with Product Quantization.
+     * Zero exports the approximate metrics, estimated from the compressed codes,
+     * which are also exported for collections, that didn't keep their originals.
+     */
+    ustore_length_t rerank_count;
+
+    /**
+     * @brief Inclusive range of keys to search among, applied before any distances are computed.
+     * Zero lifts the corresponding bound. Filtered searches never use the approximate index.
+     */
+    ustore_key_t keys_min;
+    ustore_key_t keys_max;
+    /**
+     * @brief Optional allow-list of `allowed_keys_count` keys to search among, shared by all queries.
+     * Instead of scanning the collection, only the allowed entries are read, so the cost of search
+     * is proportional to the size of the list. Can be combined with the range of keys.
+     */
+    ustore_key_t const* allowed_keys;
+    ustore_size_t allowed_keys_count;
+
     ustore_collection_t const* collections;
     ustore_size_t collections_stride;
 
@@ -205,6 +254,77 @@ typedef struct ustore_vectors_search_t {
  */
 void ustore_vectors_search(ustore_vectors_search_t*);
 
+/**
+ * @brief Compresses the quantized copies of vectors in a collection with Product Quantization.
+ * @see `ustore_vectors_compress()`.
+ *
+ * Every vector is split into `subspaces` parts of identical dimensionality, and every
+ * part is replaced with a one-byte identifier of the closest of 256 centroids. Those
+ * codebooks are trained on a random sample of the collection, and stored in its schema.
+ * Vectors written later into the same collection are compressed on arrival.
+ *
+ * By default, the original vectors are dropped, and only the codes remain, so reads export
+ * `::ustore_vector_scalar_f32_k` approximations, reconstructed from the centroids. Pass
+ * `keep_originals` to preserve them, and re-rank the search results against them.
+ *
+ * ## Concurrency
+ *
+ * Outside of transactions, the collection is locked for the duration of the compression,
+ * and the concurrent writes into it fail. If the compression is interrupted, the lock is
+ * only released by compressing the collection again. Inside of a transaction, or on engines
+ * without them, the writes, that race with the compression, may keep the old quantization.
+ *
+ * The originals themselves can be compressed losslessly: bytes of their scalars are
+ * grouped by significance and passed through LZ4. It doesn't affect the search, and
+ * can be requested without re-training the codebooks, by passing zero `subspaces`.
+ */
+typedef struct ustore_vectors_compress_t {
+
+    /// @name Context
+    /// @{
+
+    /** @brief Already open database instance. */
+    ustore_database_t db;
+    /** @brief Pointer to exported error message. */
+    ustore_error_t* error;
+    /** @brief The transaction in which the operation will be watched. */
+    ustore_transaction_t transaction;
+    /** @brief Reusable memory handle. */
+    ustore_arena_t* arena;
+    /** @brief Read and Write options. @see `ustore_read_t`, `ustore_write_t`. */
+    ustore_options_t options;
+
+    /// @}
+    /// @name Inputs
+    /// @{
+
+    ustore_collection_t collection;
+    /**
+     * @brief Number of parts every vector is split into. Must divide its dimensions.
+     * Zero keeps the quantized copies as they are, and only compresses the `originals`.
+     */
+    ustore_length_t subspaces;
+    /** @brief Number of vectors to sample for training. Zero picks the default of 4096. */
+    ustore_length_t samples_count;
+    /** @brief Compresses the original vectors with byte-shuffling and LZ4. */
+    bool originals;
+    /**
+     * @brief Keeps the full-precision originals beside the codes, to re-rank the search results.
+     * Only affects the compressions with non-zero `subspaces`, that otherwise drop the originals.
+     */
+    bool keep_originals;
+
+    /// @}
+
+} ustore_vectors_compress_t;
+
+/**
+ * @brief Compresses the quantized copies of vectors in a collection with Product Quantization,
+ * and optionally the original vectors.
+ * @see `ustore_vectors_compress_t`.
+ */
+void ustore_vectors_compress(ustore_vectors_compress_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
\ No newline at end of file
@@ -3,6 +3,10 @@ package cloud.unum.ustore;
 import java.io.File;
 import java.io.IOException;
 import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.nio.LongBuffer;
 import java.nio.file.Files;
 import java.nio.file.StandardCopyOption;
 import java.util.Map; // Map abstract class
@@ -51,6 +55,11 @@ import java.util.Arrays; // Arrays.equals
  * - rollback: To reset the state of the transaction.
  * - commit: To submit the transaction to underlying DBMS.
  *
+ * For bulk ingestion and lookups there are `putBatch` and `getBatch`,
+ * which exchange direct buffers with the native layer without copies.
+ * Every `Batch` returned by `getBatch` owns the native memory of its buffers,
+ * which remain valid until the batch is closed.
+ *
  * ## Alternatives
  *
  * Aside from classical C/C++ implementations of RocksDB, WiredTiger,
@@ -91,6 +100,58 @@ public abstract class DataBase {
         }
     }
 
+    /**
+     * Values of a batch read, mapped over the native memory of the batch,
+     * without copying them into Java arrays. That memory is released on `close`,
+     * after which none of the buffers, including the ones returned by `get`, may be accessed.
+     */
+    public static class Batch implements AutoCloseable {
+
+        /** Values packed back to back. */
+        public final ByteBuffer values;
+        /** Offsets of every value within `values`. */
+        public final IntBuffer offsets;
+        /** Lengths of every value, or -1 for the missing ones. */
+        public final IntBuffer lengths;
+
+        /** Address of the native arena, holding the values. */
+        private long arena;
+
+        Batch(ByteBuffer values, ByteBuffer offsets, ByteBuffer lengths, long arena) {
+            this.values = values;
+            this.offsets = offsets.order(ByteOrder.nativeOrder()).asIntBuffer();
+            this.lengths = lengths.order(ByteOrder.nativeOrder()).asIntBuffer();
+            this.arena = arena;
+        }
+
+        @Override
+        public void close() {
+            if (arena != 0) {
+                free_(arena);
+                arena = 0;
+            }
+        }
+
+        private static native void free_(long arena);
+
+        public int size() {
+            return lengths.capacity();
+        }
+
+        /**
+         * @return A view of the `i`-th value, or null if it's missing.
+         */
+        public ByteBuffer get(int i) {
+            int length = lengths.get(i);
+            if (length < 0)
+                return null;
+            ByteBuffer value = values.duplicate();
+            value.position(offsets.get(i));
+            value.limit(offsets.get(i) + length);
+            return value.slice();
+        }
+    }
+
     public static class Transaction implements AutoCloseable {
 
         public long transactionAddress = 0;
@@ -147,6 +208,47 @@ public abstract class DataBase {
             return get(null, key);
         }
 
+        /**
+         * Maps a batch of keys to values, passed in direct buffers without copies.
+         * The `i`-th value spans bytes from `offsets[i]` to `offsets[i + 1]` of `values`,
+         * so there must be one more offset than keys. Buffers are read from their start,
+         * and numbers must be in `ByteOrder.nativeOrder()`.
+         */
+        public void putBatch(String collection, LongBuffer keys, IntBuffer offsets, ByteBuffer values) {
+            if (!keys.isDirect() || !offsets.isDirect() || !values.isDirect())
+                throw new IllegalArgumentException("Batches must be passed in direct buffers");
+            if (keys.order() != ByteOrder.nativeOrder() || offsets.order() != ByteOrder.nativeOrder())
+                throw new IllegalArgumentException("Keys and offsets must be in native byte order");
+            if (offsets.limit() != keys.limit() + 1)
+                throw new IllegalArgumentException("Expected one more offset than keys");
+            putBatch_(collection, keys, offsets, values, keys.limit());
+        }
+
+        public void putBatch(LongBuffer keys, IntBuffer offsets, ByteBuffer values) {
+            putBatch(null, keys, offsets, values);
+        }
+
+        private native void putBatch_(String collection, LongBuffer keys, IntBuffer offsets, ByteBuffer values,
+                int count);
+
+        /**
+         * Reads the values of a batch of keys, passed in a direct buffer,
+         * mapping the results over native memory instead of copying them.
+         */
+        public Batch getBatch(String collection, LongBuffer keys) {
+            if (!keys.isDirect())
+                throw new IllegalArgumentException("Batches must be passed in direct buffers");
+            if (keys.order() != ByteOrder.nativeOrder())
+                throw new IllegalArgumentException("Keys must be in native byte order");
+            return getBatch_(collection, keys, keys.limit());
+        }
+
+        public Batch getBatch(LongBuffer keys) {
+            return getBatch(null, keys);
+        }
+
+        private native Batch getBatch_(String collection, LongBuffer keys, int count);
+
         /**
          * Removes the key (and its corresponding value) from this collection.
          */
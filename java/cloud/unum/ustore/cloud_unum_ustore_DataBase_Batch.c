@@ -0,0 +1,10 @@
+#include "cloud_unum_ustore_Shared.h"
+#include "cloud_unum_ustore_DataBase_Batch.h"
+
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Batch_free_1( //
+    JNIEnv* env_java,
+    jclass batch_class_java,
+    jlong arena_java) {
+
+    ustore_arena_free((ustore_arena_t)arena_java);
+}
@@ -0,0 +1,20 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class cloud_unum_ustore_DataBase_Batch */
+
+#ifndef _Included_cloud_unum_ustore_DataBase_Batch
+#define _Included_cloud_unum_ustore_DataBase_Batch
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     cloud_unum_ustore_DataBase_Batch
+ * Method:    free_
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Batch_free_1(JNIEnv*, jclass, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
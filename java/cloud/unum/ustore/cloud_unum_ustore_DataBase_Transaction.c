@@ -33,14 +33,13 @@ JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_put( //
     ustore_length_t value_off_c = 0;
     ustore_length_t value_len_c = (ustore_length_t)value_len_java;
     ustore_options_t options_c = ustore_options_default_k;
-    ustore_arena_t arena_c = NULL;
     ustore_error_t error_c = NULL;
 
     struct ustore_write_t write = {
         .db = db_ptr_c,
         .error = &error_c,
         .transaction = txn_ptr_c,
-        .arena = &arena_c,
+        .arena = thread_arena(),
         .options = options_c,
         .tasks_count = 1,
         .collections = &collection_ptr_c,
@@ -51,7 +50,6 @@ JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_put( //
     };
 
     ustore_write(&write);
-    ustore_arena_free(arena_c);
 
     if (value_is_copy_java == JNI_TRUE)
         (*env_java)->ReleaseByteArrayElements(env_java, value_java, value_ptr_java, 0);
@@ -78,13 +76,12 @@ JNIEXPORT jboolean JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_cont
     ustore_key_t key_c = (ustore_key_t)key_java;
     ustore_options_t options_c = ustore_options_default_k;
     ustore_octet_t* found_presences_c = NULL;
-    ustore_arena_t arena_c = NULL;
     ustore_error_t error_c = NULL;
     struct ustore_read_t read = {
         .db = db_ptr_c,
         .error = &error_c,
         .transaction = txn_ptr_c,
-        .arena = &arena_c,
+        .arena = thread_arena(),
         .options = options_c,
         .tasks_count = 1,
         .collections = &collection_ptr_c,
@@ -95,12 +92,10 @@ JNIEXPORT jboolean JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_cont
     ustore_read(&read);
 
     if (forward_error(env_java, error_c)) {
-        ustore_arena_free(arena_c);
         return JNI_FALSE;
     }
 
     jboolean result = found_presences_c[0] != 0 ? JNI_TRUE : JNI_FALSE;
-    ustore_arena_free(arena_c);
     return result;
 }
 
@@ -126,13 +121,12 @@ JNIEXPORT jbyteArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_ge
     ustore_length_t* found_offsets_c = NULL;
     ustore_length_t* found_lengths_c = NULL;
     ustore_bytes_ptr_t found_values_c = NULL;
-    ustore_arena_t arena_c = NULL;
     ustore_error_t error_c = NULL;
     struct ustore_read_t read = {
         .db = db_ptr_c,
         .error = &error_c,
         .transaction = txn_ptr_c,
-        .arena = &arena_c,
+        .arena = thread_arena(),
         .options = options_c,
         .tasks_count = 1,
         .collections = &collection_ptr_c,
@@ -145,7 +139,6 @@ JNIEXPORT jbyteArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_ge
     ustore_read(&read);
 
     if (forward_ustore_error(env_java, error_c)) {
-        ustore_arena_free(arena_c);
         return NULL;
     }
 
@@ -165,7 +158,6 @@ JNIEXPORT jbyteArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_ge
                                             (jbyte const*)(found_values_c + found_offsets_c[0]));
     }
 
-    ustore_arena_free(arena_c);
     return result_java;
 }
 
@@ -188,14 +180,13 @@ JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_erase( /
 
     ustore_key_t key_c = (ustore_key_t)key_java;
     ustore_options_t options_c = ustore_options_default_k;
-    ustore_arena_t arena_c = NULL;
     ustore_error_t error_c = NULL;
 
     struct ustore_write_t write = {
         .db = db_ptr_c,
         .error = &error_c,
         .transaction = txn_ptr_c,
-        .arena = &arena_c,
+        .arena = thread_arena(),
         .options = options_c,
         .tasks_count = 1,
         .collections = &collection_ptr_c,
@@ -203,7 +194,6 @@ JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_erase( /
     };
 
     ustore_write(&write);
-    ustore_arena_free(arena_c);
     forward_ustore_error(env_java, error_c);
 }
 
@@ -261,4 +251,152 @@ JNIEXPORT jboolean JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_comm
 
     ustore_transaction_commit(&txn_commit);
     return error_c ? JNI_FALSE : JNI_TRUE;
-}
\ No newline at end of file
+}
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_putBatch_1( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jobject keys_java,
+    jobject offsets_java,
+    jobject values_java,
+    jint count_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return;
+
+    // Direct buffers are addressed in-place, without pinning or copying Java arrays
+    ustore_key_t const* keys_c = (ustore_key_t const*)(*env_java)->GetDirectBufferAddress(env_java, keys_java);
+    ustore_length_t const* offsets_c =
+        (ustore_length_t const*)(*env_java)->GetDirectBufferAddress(env_java, offsets_java);
+    ustore_bytes_cptr_t values_c = (ustore_bytes_cptr_t)(*env_java)->GetDirectBufferAddress(env_java, values_java);
+    if (!keys_c || !offsets_c || !values_c) {
+        forward_error(env_java, "Batches must be passed in direct buffers!");
+        return;
+    }
+
+    // Lengths are inferred from consecutive offsets, like in Apache Arrow
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_error_t error_c = NULL;
+    struct ustore_write_t write = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = thread_arena(),
+        .options = options_c,
+        .tasks_count = (ustore_size_t)count_java,
+        .collections = &collection_ptr_c,
+        .keys = keys_c,
+        .keys_stride = sizeof(ustore_key_t),
+        .offsets = offsets_c,
+        .offsets_stride = sizeof(ustore_length_t),
+        .values = &values_c,
+    };
+
+    ustore_write(&write);
+    forward_ustore_error(env_java, error_c);
+}
+
+JNIEXPORT jobject JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_getBatch_1( //
+    JNIEnv* env_java,
+    jobject txn_java,
+    jstring collection_java,
+    jobject keys_java,
+    jint count_java) {
+
+    ustore_database_t db_ptr_c = db_ptr(env_java, txn_java);
+    if (!db_ptr_c) {
+        forward_error(env_java, "Database is closed!");
+        return NULL;
+    }
+
+    ustore_transaction_t txn_ptr_c = txn_ptr(env_java, txn_java);
+    ustore_collection_t collection_ptr_c = collection_ptr(env_java, db_ptr_c, collection_java);
+    if ((*env_java)->ExceptionCheck(env_java))
+        return NULL;
+
+    ustore_key_t const* keys_c = (ustore_key_t const*)(*env_java)->GetDirectBufferAddress(env_java, keys_java);
+    if (!keys_c) {
+        forward_error(env_java, "Batches must be passed in direct buffers!");
+        return NULL;
+    }
+
+    // Unlike other requests, the batch gets an arena of its own, as the results
+    // are mapped into Java and must outlive the following requests of this thread
+    ustore_size_t count_c = (ustore_size_t)count_java;
+    ustore_options_t options_c = ustore_options_default_k;
+    ustore_length_t* found_offsets_c = NULL;
+    ustore_length_t* found_lengths_c = NULL;
+    ustore_bytes_ptr_t found_values_c = NULL;
+    ustore_arena_t arena_c = NULL;
+    ustore_error_t error_c = NULL;
+    struct ustore_read_t read = {
+        .db = db_ptr_c,
+        .error = &error_c,
+        .transaction = txn_ptr_c,
+        .arena = &arena_c,
+        .options = options_c,
+        .tasks_count = count_c,
+        .collections = &collection_ptr_c,
+        .keys = keys_c,
+        .keys_stride = sizeof(ustore_key_t),
+        .offsets = &found_offsets_c,
+        .lengths = &found_lengths_c,
+        .values = &found_values_c,
+    };
+
+    ustore_read(&read);
+    if (forward_ustore_error(env_java, error_c)) {
+        ustore_arena_free(arena_c);
+        return NULL;
+    }
+
+    // The tape ends with the last present value
+    jlong values_length_c = 0;
+    for (ustore_size_t i = 0; i != count_c; ++i)
+        if (found_lengths_c[i] != ustore_length_missing_k &&
+            found_offsets_c[i] + found_lengths_c[i] > values_length_c)
+            values_length_c = found_offsets_c[i] + found_lengths_c[i];
+
+    // Instead of copying, wrap the outputs in the arena into direct buffers,
+    // valid until the batch is closed
+    static ustore_byte_t empty_c = 0;
+    jlong arrays_length_c = (jlong)(count_c * sizeof(ustore_length_t));
+    jobject values_java = (*env_java)->NewDirectByteBuffer(env_java,
+                                                           values_length_c ? found_values_c : &empty_c,
+                                                           values_length_c);
+    jobject offsets_java = (*env_java)->NewDirectByteBuffer(env_java,
+                                                            count_c ? (void*)found_offsets_c : &empty_c,
+                                                            arrays_length_c);
+    jobject lengths_java = (*env_java)->NewDirectByteBuffer(env_java,
+                                                            count_c ? (void*)found_lengths_c : &empty_c,
+                                                            arrays_length_c);
+    if ((*env_java)->ExceptionCheck(env_java)) {
+        ustore_arena_free(arena_c);
+        return NULL;
+    }
+
+    jclass batch_class_java = (*env_java)->FindClass(env_java, "cloud/unum/ustore/DataBase$Batch");
+    jmethodID batch_constructor_java =
+        (*env_java)->GetMethodID(env_java,
+                                 batch_class_java,
+                                 "<init>",
+                                 "(Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;J)V");
+    jobject batch_java = (*env_java)->NewObject(env_java, //
+                                                batch_class_java,
+                                                batch_constructor_java,
+                                                values_java,
+                                                offsets_java,
+                                                lengths_java,
+                                                (long int)arena_c);
+    if (!batch_java)
+        ustore_arena_free(arena_c);
+    return batch_java;
+}
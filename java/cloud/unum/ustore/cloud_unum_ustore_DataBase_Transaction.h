@@ -49,6 +49,20 @@ JNIEXPORT jbyteArray JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_ge
  */
 JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_erase(JNIEnv*, jobject, jstring, jlong);
 
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    putBatch_
+ * Signature: (Ljava/lang/String;Ljava/nio/LongBuffer;Ljava/nio/IntBuffer;Ljava/nio/ByteBuffer;I)V
+ */
+JNIEXPORT void JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_putBatch_1(JNIEnv*, jobject, jstring, jobject, jobject, jobject, jint);
+
+/*
+ * Class:     cloud_unum_ustore_DataBase_Transaction
+ * Method:    getBatch_
+ * Signature: (Ljava/lang/String;Ljava/nio/LongBuffer;I)Lcloud/unum/ustore/DataBase/Batch;
+ */
+JNIEXPORT jobject JNICALL Java_cloud_unum_ustore_DataBase_00024Transaction_getBatch_1(JNIEnv*, jobject, jstring, jobject, jint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <string.h>
 
 #include "cloud_unum_ustore_Shared.h"
@@ -52,13 +53,12 @@ ustore_collection_t collection_ptr(JNIEnv* env_java, ustore_database_t db_ptr, j
     ustore_str_span_t names = NULL;
     ustore_collection_t* ids = NULL;
     ustore_error_t error_c = NULL;
-    ustore_arena_t arena_c = NULL;
 
     // Try find collection in existing collections
     struct ustore_collection_list_t collection_list = {
         .db = db_ptr,
         .error = &error_c,
-        .arena = &arena_c,
+        .arena = thread_arena(),
         .count = &count,
         .ids = &ids,
         .names = &names,
@@ -95,6 +95,30 @@ ustore_collection_t collection_ptr(JNIEnv* env_java, ustore_database_t db_ptr, j
     return collection_c;
 }
 
+static pthread_key_t thread_arena_key;
+static pthread_once_t thread_arena_once = PTHREAD_ONCE_INIT;
+
+static void free_thread_arena(void* arena_ptr_c) {
+    ustore_arena_free(*(ustore_arena_t*)arena_ptr_c);
+}
+
+static void create_thread_arena_key(void) {
+    pthread_key_create(&thread_arena_key, &free_thread_arena);
+}
+
+ustore_arena_t* thread_arena(void) {
+    // The handle is lazily allocated by the first request, so the key
+    // references the handle itself, which outlives the key destructors
+    static _Thread_local ustore_arena_t arena_c = NULL;
+    static _Thread_local bool registered = false;
+    if (!registered) {
+        pthread_once(&thread_arena_once, &create_thread_arena_key);
+        pthread_setspecific(thread_arena_key, &arena_c);
+        registered = true;
+    }
+    return &arena_c;
+}
+
 bool forward_error(JNIEnv* env_java, char const* error_c) {
     if (!error_c)
         return false;
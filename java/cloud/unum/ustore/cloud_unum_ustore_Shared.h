@@ -19,6 +19,13 @@ ustore_transaction_t txn_ptr(JNIEnv* env_java, jobject txn_java);
 
 ustore_collection_t collection_ptr(JNIEnv* env_java, ustore_database_t db_ptr, jstring name_java);
 
+/**
+ * @brief Arena of the calling thread, reused by all of its requests, instead of
+ * allocating a new one every time. Freed, once the thread exits.
+ * Memory exported by the previous request is invalidated by the next one.
+ */
+ustore_arena_t* thread_arena(void);
+
 /**
  * @return true  If error was detected.
  * @return false If no error appeared.
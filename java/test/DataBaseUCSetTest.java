@@ -2,6 +2,10 @@
 import cloud.unum.ustore.DataBaseUCSet;
 import org.junit.Test;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.nio.LongBuffer;
 import java.util.Arrays;
 
 public class DataBaseUCSetTest {
@@ -20,6 +24,24 @@ public class DataBaseUCSetTest {
         txn.commit();
         assert Arrays.equals(ctx.get("any", 42), "meaning of life".getBytes()) : "Accepted wrong philosophy";
 
+        LongBuffer keys = ByteBuffer.allocateDirect(8 * 3).order(ByteOrder.nativeOrder()).asLongBuffer();
+        IntBuffer offsets = ByteBuffer.allocateDirect(4 * 4).order(ByteOrder.nativeOrder()).asIntBuffer();
+        ByteBuffer values = ByteBuffer.allocateDirect(9);
+        keys.put(0, 1).put(1, 2).put(2, 3);
+        offsets.put(0, 0).put(1, 3).put(2, 6).put(3, 9);
+        values.put("onetwosix".getBytes());
+        ctx.putBatch("batch", keys, offsets, values);
+
+        keys.put(2, 4);
+        try (DataBaseUCSet.Batch batch = ctx.getBatch("batch", keys)) {
+            // Later requests of the same thread must not overwrite the batch
+            ctx.put("batch", 2, "overwritten".getBytes());
+            assert Arrays.equals(ctx.get("batch", 1), "one".getBytes()) : "Wrong value";
+            assert batch.size() == 3 : "Wrong batch size";
+            assert batch.get(1).equals(ByteBuffer.wrap("two".getBytes())) : "Wrong batch value";
+            assert batch.get(2) == null : "Missing value was found";
+        }
+
         ctx.close();
         System.out.println("Success!");
     }
@@ -1,6 +1,9 @@
 
 #pragma once
-#include <vector> // `std::vector`
+#include <vector>     // `std::vector`
+#include <thread>     // `std::thread`
+#include <algorithm>  // `std::min`
+#include <functional> // `std::ref`
 
 #include <pybind11/pybind11.h> // `gil_scoped_release`
 #include <Python.h>            // `PyObject`
@@ -230,6 +233,7 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
     ustore_length_t* found_lengths = nullptr;
     ustore_bytes_ptr_t found_values = nullptr;
     bool const export_arrow = collection.export_into_arrow();
+    py_arena_ptr_t kept_arena = export_arrow ? std::make_shared<arena_t>(collection.db()) : nullptr;
 
     parsed_places_t parsed_places {keys_py, collection.native};
     places_arg_t places = parsed_places;
@@ -240,7 +244,7 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
         read.db = collection.db();
         read.error = status.member_ptr();
         read.transaction = collection.txn();
-        read.arena = collection.member_arena();
+        read.arena = export_arrow ? kept_arena->member_ptr() : collection.member_arena();
         read.options = collection.options();
         read.tasks_count = places.count;
         read.collections = collection.member_collection();
@@ -256,17 +260,18 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
         status.throw_unhandled();
     }
 
+    // The Arrow array views the arena directly, keeping it alive
     if (export_arrow) {
         auto shared_length = static_cast<int64_t>(places.count);
-        auto shared_offsets = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_offsets),
-            (shared_length + 1) * sizeof(ustore_length_t));
-        auto shared_data = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_values),
-            static_cast<int64_t>(found_offsets[places.count]));
-        auto shared_bitmap = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_presences),
-            divide_round_up<int64_t>(shared_length, CHAR_BIT));
+        auto shared_offsets = py_arena_buffer( //
+            found_offsets,
+            (shared_length + 1) * sizeof(ustore_length_t),
+            kept_arena);
+        auto shared_data = py_arena_buffer(found_values, found_offsets[places.count], kept_arena);
+        auto shared_bitmap = py_arena_buffer( //
+            found_presences,
+            divide_round_up<int64_t>(shared_length, CHAR_BIT),
+            kept_arena);
         auto shared = std::make_shared<arrow::BinaryArray>(shared_length, shared_offsets, shared_data, shared_bitmap);
         PyObject* obj_ptr = arrow::py::wrap_array(std::static_pointer_cast<arrow::Array>(shared));
         return py::reinterpret_steal<py::object>(obj_ptr);
@@ -283,6 +288,118 @@ static py::object read_many_binaries(py_blobs_collection_t& collection, PyObject
     }
 }
 
+/**
+ * @brief Reads a large batch of keys on multiple cores, splitting it into contiguous
+ * shards, each exported into a separate arena. With Arrow exports enabled, returns
+ * a `pyarrow.ChunkedArray` with a chunk per shard, otherwise a `tuple` of `bytes`.
+ * Transactions can't be shared between threads, so those are read on a single one.
+ */
+static py::object read_many_binaries_parallel(py_blobs_collection_t& collection,
+                                              py::object keys_py,
+                                              std::size_t threads_count) {
+
+    constexpr std::size_t min_keys_per_thread_k = 1024;
+
+    struct shard_t {
+        py_arena_ptr_t arena;
+        status_t status;
+        std::size_t first = 0;
+        std::size_t count = 0;
+        ustore_octet_t* presences = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_length_t* lengths = nullptr;
+        ustore_bytes_ptr_t values = nullptr;
+    };
+
+    bool const export_arrow = collection.export_into_arrow();
+    parsed_places_t parsed_places {keys_py.ptr(), collection.native};
+    places_arg_t places = parsed_places;
+
+    threads_count = threads_count ? threads_count : std::thread::hardware_concurrency();
+    threads_count = std::min(threads_count, divide_round_up<std::size_t>(places.count, min_keys_per_thread_k));
+    threads_count = collection.txn() ? 1 : std::max<std::size_t>(threads_count, 1);
+
+    std::vector<shard_t> shards(threads_count);
+    for (std::size_t shard_idx = 0; shard_idx != threads_count; ++shard_idx) {
+        shard_t& shard = shards[shard_idx];
+        shard.arena = std::make_shared<arena_t>(collection.db());
+        shard.first = places.count * shard_idx / threads_count;
+        shard.count = places.count * (shard_idx + 1) / threads_count - shard.first;
+    }
+
+    auto read_shard = [&](shard_t& shard) noexcept {
+        ustore_read_t read {};
+        read.db = collection.db();
+        read.error = shard.status.member_ptr();
+        read.transaction = collection.txn();
+        read.arena = shard.arena->member_ptr();
+        read.options = collection.options();
+        read.tasks_count = shard.count;
+        read.collections = collection.member_collection();
+        read.collections_stride = 0;
+        read.keys = (places.keys_begin + shard.first).get();
+        read.keys_stride = places.keys_begin.stride();
+        read.presences = export_arrow ? &shard.presences : nullptr;
+        read.offsets = &shard.offsets;
+        read.lengths = !export_arrow ? &shard.lengths : nullptr;
+        read.values = &shard.values;
+        ustore_read(&read);
+    };
+
+    {
+        // The calling thread reads the first shard itself
+        [[maybe_unused]] py::gil_scoped_release release;
+        std::vector<std::thread> threads;
+        threads.reserve(threads_count - 1);
+        for (std::size_t shard_idx = 1; shard_idx != threads_count; ++shard_idx)
+            threads.emplace_back(read_shard, std::ref(shards[shard_idx]));
+        read_shard(shards[0]);
+        for (std::thread& thread : threads)
+            thread.join();
+        for (shard_t& shard : shards)
+            shard.status.throw_unhandled();
+    }
+
+    // Every chunk views its own arena directly, keeping it alive
+    if (export_arrow) {
+        arrow::ArrayVector chunks;
+        chunks.reserve(threads_count);
+        for (shard_t& shard : shards) {
+            if (!shard.count)
+                continue;
+            auto shared_length = static_cast<int64_t>(shard.count);
+            auto shared_offsets = py_arena_buffer( //
+                shard.offsets,
+                (shared_length + 1) * sizeof(ustore_length_t),
+                shard.arena);
+            auto shared_data = py_arena_buffer(shard.values, shard.offsets[shard.count], shard.arena);
+            auto shared_bitmap = py_arena_buffer( //
+                shard.presences,
+                divide_round_up<int64_t>(shared_length, CHAR_BIT),
+                shard.arena);
+            chunks.push_back(
+                std::make_shared<arrow::BinaryArray>(shared_length, shared_offsets, shared_data, shared_bitmap));
+        }
+        auto maybe_chunked = arrow::ChunkedArray::Make(std::move(chunks), arrow::binary());
+        if (!maybe_chunked.ok())
+            throw std::runtime_error(maybe_chunked.status().ToString());
+        PyObject* obj_ptr = arrow::py::wrap_chunked_array(maybe_chunked.ValueOrDie());
+        return py::reinterpret_steal<py::object>(obj_ptr);
+    }
+    else {
+        PyObject* tuple_ptr = PyTuple_New(places.size());
+        for (shard_t& shard : shards) {
+            embedded_blobs_t bins {shard.count, shard.offsets, shard.lengths, shard.values};
+            for (std::size_t i = 0; i != shard.count; ++i) {
+                value_view_t val = bins[i];
+                PyObject* obj_ptr = val ? PyBytes_FromStringAndSize(val.c_str(), val.size()) : Py_None;
+                PyTuple_SetItem(tuple_ptr, shard.first + i, obj_ptr);
+            }
+        }
+        return py::reinterpret_steal<py::object>(tuple_ptr);
+    }
+}
+
 template <typename collection_at>
 static py::object has_binary(py_collection_gt<collection_at>& collection, py::object key_py) {
     auto is_single = !PySequence_Check(key_py.ptr());
@@ -360,11 +477,12 @@ static py::array_t<ustore_key_t> scan_binary( //
     ustore_length_t* found_lengths = nullptr;
     ustore_key_t* found_keys = nullptr;
     bool const export_arrow = collection.export_into_arrow();
+    py_arena_ptr_t kept_arena = std::make_shared<arena_t>(collection.db());
     ustore_scan_t scan {};
     scan.db = collection.db();
     scan.error = status.member_ptr();
     scan.transaction = collection.txn();
-    scan.arena = collection.member_arena();
+    scan.arena = kept_arena->member_ptr();
     scan.options = collection.options();
     scan.tasks_count = 1;
     scan.collections = collection.member_collection();
@@ -373,22 +491,20 @@ static py::array_t<ustore_key_t> scan_binary( //
     scan.counts = &found_lengths;
     scan.keys = &found_keys;
 
-    ustore_scan(&scan);
-
+    py_without_gil([&] { ustore_scan(&scan); });
     status.throw_unhandled();
 
+    // Both NumPy and Arrow arrays view the arena directly, keeping it alive
     if (export_arrow) {
         auto shared_length = static_cast<int64_t>(found_lengths[0]);
-        auto shared_data = std::make_shared<arrow::Buffer>( //
-            reinterpret_cast<uint8_t*>(found_keys),
-            shared_length * sizeof(ustore_key_t));
+        auto shared_data = py_arena_buffer(found_keys, shared_length * sizeof(ustore_key_t), kept_arena);
         static_assert(std::is_same_v<ustore_key_t, int64_t>, "Change the following line!");
         auto shared = std::make_shared<arrow::NumericArray<arrow::Int64Type>>(shared_length, shared_data);
         PyObject* obj_ptr = arrow::py::wrap_array(std::static_pointer_cast<arrow::Array>(shared));
         return py::reinterpret_steal<py::object>(obj_ptr);
     }
     else
-        return py::array_t<ustore_key_t>(found_lengths[0], found_keys);
+        return py_arena_array(found_keys, found_lengths[0], kept_arena);
 }
 
 template <typename collection_at>
@@ -69,7 +69,8 @@ range_at& until(range_at& range, ustore_key_t key) {
 py::object sample(py_blobs_collection_t& py_collection, std::size_t count) {
     blobs_range_t members(py_collection.db(), py_collection.txn(), *py_collection.member_collection());
     keys_range_t range {members};
-    ptr_range_gt<ustore_key_t> samples = range.sample(count, py_collection.member_arena()).throw_or_release();
+    py_arena_ptr_t kept_arena = std::make_shared<arena_t>(py_collection.db());
+    ptr_range_gt<ustore_key_t> samples = range.sample(count, kept_arena->member_ptr()).throw_or_release();
 
     status_t status;
     ArrowSchema c_arrow_schema;
@@ -86,7 +87,7 @@ py::object sample(py_blobs_collection_t& py_collection, std::size_t count) {
                         status.member_ptr());
 
     arrow::Result<std::shared_ptr<arrow::Array>> array = arrow::ImportArray(&c_arrow_array, &c_arrow_schema);
-    PyObject* array_python = arrow::py::wrap_array(array.ValueOrDie());
+    PyObject* array_python = arrow::py::wrap_array(py_arena_attach(array.ValueOrDie(), kept_arena));
     return py::reinterpret_steal<py::object>(array_python);
 }
 
@@ -134,6 +135,7 @@ void ustore::wrap_database(py::module& m) {
     py_collection.def("pop", &remove_binary<blobs_collection_t>);  // Unlike Python, won't return the result
     py_collection.def("has_key", &has_binary<blobs_collection_t>); // Similar to Python 2
     py_collection.def("get", &read_binary);
+    py_collection.def("get_parallel", &read_many_binaries_parallel, py::arg("keys"), py::arg("threads") = 0);
     py_collection.def("sample_keys", &sample);
     py_collection.def("update", &update_binary);
     py_collection.def("broadcast", &broadcast_binary);
@@ -48,7 +48,7 @@ class docs_pairs_stream_t {
         scan.counts = &found_counts;
         scan.keys = &found_keys;
 
-        ustore_scan(&scan);
+        py_without_gil([&] { ustore_scan(&scan); });
         if (!status)
             return status;
 
@@ -72,7 +72,7 @@ class docs_pairs_stream_t {
         docs_read.lengths = &found_lengths;
         docs_read.values = &found_values;
 
-        ustore_docs_read(&docs_read);
+        py_without_gil([&] { ustore_docs_read(&docs_read); });
         if (!status)
             return status;
 
@@ -167,7 +167,7 @@ static void write_one_doc(py_docs_collection_t& py_collection, PyObject* key_py,
     std::string json_str;
     to_string(val_py, json_str);
     ustore_key_t key = py_to_scalar<ustore_key_t>(key_py);
-    py_collection.native[key].assign(value_view_t(json_str)).throw_unhandled();
+    py_without_gil([&] { return py_collection.native[key].assign(value_view_t(json_str)); }).throw_unhandled();
 }
 
 struct dummy_iterator_t {
@@ -205,7 +205,7 @@ static void write_many_docs(py_docs_collection_t& py_collection, PyObject* keys_
     values.count = keys_count;
 
     auto ref = py_collection.native[keys];
-    ref.assign(values).throw_unhandled();
+    py_without_gil([&] { return ref.assign(values); }).throw_unhandled();
 }
 
 static void write_same_doc(py_docs_collection_t& py_collection, PyObject* keys_py, PyObject* val_py) {
@@ -215,7 +215,7 @@ static void write_same_doc(py_docs_collection_t& py_collection, PyObject* keys_p
     py_transform_n(keys_py, &py_to_scalar<ustore_key_t>, keys.begin());
     std::string json_str;
     to_string(val_py, json_str);
-    py_collection.native[keys].assign(value_view_t(json_str)).throw_unhandled();
+    py_without_gil([&] { return py_collection.native[keys].assign(value_view_t(json_str)); }).throw_unhandled();
 }
 
 static void write_doc(py_docs_collection_t& py_collection, py::object key_py, py::object val_py) {
@@ -230,7 +230,7 @@ static void broadcast_doc(py_docs_collection_t& py_collection, py::object key_py
 
 static py::object read_one_doc(py_docs_collection_t& py_collection, PyObject* key_py) {
     ustore_key_t key = py_to_scalar<ustore_key_t>(key_py);
-    auto value = py_collection.native[key].value();
+    auto value = py_without_gil([&] { return py_collection.native[key].value(); });
     return value->empty() ? py::none {} : py::reinterpret_steal<py::object>(from_json(json_t::parse(*value)));
 }
 
@@ -241,7 +241,7 @@ static py::object read_many_docs(py_docs_collection_t& py_collection, PyObject*
     py_transform_n(keys_py, &py_to_scalar<ustore_key_t>, keys.begin());
     py::list values(keys.size());
 
-    auto maybe_retrieved = py_collection.native[keys].value();
+    auto maybe_retrieved = py_without_gil([&] { return py_collection.native[keys].value(); });
     auto const& retrieved = maybe_retrieved.throw_or_ref();
     auto it = retrieved.begin();
     for (std::size_t i = 0; i != retrieved.size(); ++i)
@@ -273,14 +273,14 @@ static void merge(py_docs_collection_t& py_collection, py::object key_py, py::ob
     ustore_key_t key = py_to_scalar<ustore_key_t>(key_py.ptr());
     std::string json_str;
     to_string(val_py.ptr(), json_str);
-    py_collection.native[key].merge(value_view_t(json_str));
+    py_without_gil([&] { return py_collection.native[key].merge(value_view_t(json_str)); }).throw_unhandled();
 }
 
 static void patch(py_docs_collection_t& py_collection, py::object key_py, py::object val_py) {
     ustore_key_t key = py_to_scalar<ustore_key_t>(key_py.ptr());
     std::string json_str;
     to_string(val_py.ptr(), json_str);
-    py_collection.native[key].patch(value_view_t(json_str));
+    py_without_gil([&] { return py_collection.native[key].patch(value_view_t(json_str)); }).throw_unhandled();
 }
 
 void ustore::wrap_document(py::module& m) {
@@ -1,15 +1,68 @@
-#include <charconv>
+#include <charconv>  // `std::from_chars`
+#include <numeric>   // `std::adjacent_difference`
+#include <optional>  // `std::optional`
+#include <algorithm> // `std::lower_bound`
 
 #include "pybind.hpp"
 #include "crud.hpp"
 #include "nlohmann.hpp"
 #include "cast_args.hpp"
-#include "algorithms/louvain.cpp"
 
 using namespace unum::ustore::pyb;
 using namespace unum::ustore;
 using namespace unum;
 
+/**
+ * @brief Runs a whole-graph algorithm natively, exporting two NumPy arrays:
+ * the sorted vertex IDs and their scores or labels.
+ */
+template <typename value_at>
+py::tuple analyze_graph(py_graph_t& g,
+                        ustore_graph_algorithm_t algorithm,
+                        ustore_size_t iterations = 0,
+                        ustore_float_t damping = 0,
+                        ustore_float_t tolerance = 0) {
+
+    status_t status;
+    ustore_size_t count = 0;
+    ustore_key_t* found_vertices = nullptr;
+    ustore_float_t* found_scores = nullptr;
+    ustore_key_t* found_labels = nullptr;
+
+    ustore_graph_analyze_t analyze {};
+    analyze.db = g.index.db();
+    analyze.error = status.member_ptr();
+    analyze.transaction = g.index.txn();
+    analyze.snapshot = g.index.snap();
+    analyze.arena = g.index.member_arena();
+    analyze.collection = g.index;
+    analyze.algorithm = algorithm;
+    analyze.iterations = iterations;
+    analyze.damping = damping;
+    analyze.tolerance = tolerance;
+    analyze.count = &count;
+    analyze.vertices = &found_vertices;
+    analyze.scores = &found_scores;
+    analyze.labels = &found_labels;
+    {
+        [[maybe_unused]] py::gil_scoped_release release;
+        ustore_graph_analyze(&analyze);
+    }
+    status.throw_unhandled();
+
+    value_at const* found_values;
+    if constexpr (std::is_same_v<value_at, ustore_float_t>)
+        found_values = found_scores;
+    else
+        found_values = found_labels;
+
+    py::array_t<ustore_key_t> vertices_array(count);
+    py::array_t<value_at> values_array(count);
+    std::copy(found_vertices, found_vertices + count, vertices_array.mutable_data());
+    std::copy(found_values, found_values + count, values_array.mutable_data());
+    return py::make_tuple(vertices_array, values_array);
+}
+
 embedded_blobs_t read_attributes( //
     docs_collection_t& collection,
     strided_range_gt<ustore_key_t const> keys,
@@ -38,7 +91,7 @@ embedded_blobs_t read_attributes( //
     docs_read.lengths = &found_lengths;
     docs_read.values = &found_values;
 
-    ustore_docs_read(&docs_read);
+    py_without_gil([&] { ustore_docs_read(&docs_read); });
     status.throw_unhandled();
     return embedded_blobs_t {count, found_offsets, found_lengths, found_values};
 }
@@ -66,7 +119,7 @@ void compute_degrees(py_graph_t& graph,
     graph_find_edges.degrees_per_vertex = degrees;
     graph_find_edges.edges_per_vertex = &edges_per_vertex;
 
-    ustore_graph_find_edges(&graph_find_edges);
+    py_without_gil([&] { ustore_graph_find_edges(&graph_find_edges); });
     status.throw_unhandled();
     if (!weight)
         return;
@@ -270,6 +323,63 @@ struct degree_view_t {
     std::string weight = "";
 };
 
+/**
+ * @brief Read-only Compressed Sparse Row snapshot of a graph or its induced subgraph.
+ * All the arrays are exported into a single arena, which the NumPy views keep alive.
+ */
+struct csr_snapshot_t {
+    py_arena_ptr_t arena;
+    ustore_size_t count = 0;
+    ustore_key_t* ids = nullptr;
+    ustore_size_t* offsets = nullptr;
+    ustore_length_t* neighbors = nullptr;
+    ustore_key_t* edges_ids = nullptr;
+
+    ustore_size_t edges_count() const noexcept { return offsets[count]; }
+
+    std::optional<std::size_t> find(ustore_key_t id) const noexcept {
+        auto it = std::lower_bound(ids, ids + count, id);
+        return it != ids + count && *it == id ? std::optional<std::size_t>(it - ids) : std::nullopt;
+    }
+};
+
+static std::shared_ptr<csr_snapshot_t> export_csr(py_graph_t& g, py::object nodes, bool reverse) {
+
+    status_t status;
+    auto snapshot = std::make_shared<csr_snapshot_t>();
+    snapshot->arena = std::make_shared<arena_t>(g.index.db());
+
+    std::optional<parsed_places_t> parsed_places;
+    places_arg_t places;
+    if (!nodes.is_none()) {
+        parsed_places.emplace(nodes.ptr(), std::nullopt);
+        places = *parsed_places;
+    }
+
+    ustore_graph_export_csr_t export_csr {};
+    export_csr.db = g.index.db();
+    export_csr.error = status.member_ptr();
+    export_csr.transaction = g.index.txn();
+    export_csr.snapshot = g.index.snap();
+    export_csr.arena = snapshot->arena->member_ptr();
+    export_csr.collection = g.index;
+    export_csr.role = !g.is_directed ? ustore_vertex_role_any_k
+                      : reverse      ? ustore_vertex_target_k
+                                     : ustore_vertex_source_k;
+    export_csr.vertices = parsed_places ? places.keys_begin.get() : nullptr;
+    export_csr.vertices_count = places.count;
+    export_csr.vertices_stride = places.keys_begin.stride();
+    export_csr.count = &snapshot->count;
+    export_csr.vertices_ids = &snapshot->ids;
+    export_csr.offsets = &snapshot->offsets;
+    export_csr.neighbors = &snapshot->neighbors;
+    export_csr.edges_ids = &snapshot->edges_ids;
+
+    py_without_gil([&] { ustore_graph_export_csr(&export_csr); });
+    status.throw_unhandled();
+    return snapshot;
+}
+
 template <typename element_at>
 py::object wrap_into_buffer(py_graph_t& g, strided_range_gt<element_at> range) {
 
@@ -904,30 +1014,31 @@ void ustore::wrap_networkx(py::module& m) {
             if (!can_cast_internal_scalars<ustore_key_t>(buf))
                 throw std::invalid_argument("Expecting @c ustore_key_t scalars in zero-copy interface");
             auto vertices = py_strided_range<ustore_key_t const>(buf);
-            g.ref().upsert_vertices(vertices).throw_unhandled();
+            py_without_gil([&] { return g.ref().upsert_vertices(vertices); }).throw_unhandled();
             if (!attrs.size())
                 return;
             std::string json_str;
             to_string(attrs.ptr(), json_str);
-            g.vertices_attrs[vertices].assign(value_view_t(json_str)).throw_unhandled();
+            py_without_gil([&] { return g.vertices_attrs[vertices].assign(value_view_t(json_str)); }).throw_unhandled();
         }
         else {
             if (!PySequence_Check(vs.ptr()))
                 throw std::invalid_argument("Nodes Must Be Sequence");
             std::vector<ustore_key_t> vertices(PySequence_Size(vs.ptr()));
             py_transform_n(vs.ptr(), &py_to_scalar<ustore_key_t>, vertices.begin());
-            g.ref().upsert_vertices(vertices).throw_unhandled();
+            py_without_gil([&] { return g.ref().upsert_vertices(vertices); }).throw_unhandled();
             if (!attrs.size())
                 return;
             std::string json_str;
             to_string(attrs.ptr(), json_str);
-            g.vertices_attrs[vertices].assign(value_view_t(json_str)).throw_unhandled();
+            py_without_gil([&] { return g.vertices_attrs[vertices].assign(value_view_t(json_str)); }).throw_unhandled();
         }
     });
     g.def(
         "add_edges_from",
         [](py_graph_t& g, py::object adjacency_list) {
-            g.ref().upsert_edges(parsed_adjacency_list_t(adjacency_list.ptr())).throw_unhandled();
+            parsed_adjacency_list_t parsed(adjacency_list.ptr());
+            py_without_gil([&] { return g.ref().upsert_edges(parsed); }).throw_unhandled();
         },
         py::arg("ebunch_to_add"),
         "Adds an adjacency list (in a form of 2 or 3 columnar matrix) to the graph.");
@@ -937,24 +1048,25 @@ void ustore::wrap_networkx(py::module& m) {
             if (!can_cast_internal_scalars<ustore_key_t>(buf))
                 throw std::invalid_argument("Expecting @c ustore_key_t scalars in zero-copy interface");
             auto vertices = py_strided_range<ustore_key_t const>(buf);
-            g.ref().remove_vertices(vertices).throw_unhandled();
+            py_without_gil([&] { return g.ref().remove_vertices(vertices); }).throw_unhandled();
             if (g.vertices_attrs.db())
-                g.vertices_attrs[vertices].clear().throw_unhandled();
+                py_without_gil([&] { return g.vertices_attrs[vertices].clear(); }).throw_unhandled();
         }
         else {
             if (!PySequence_Check(vs.ptr()))
                 throw std::invalid_argument("Nodes Must Be Sequence");
             std::vector<ustore_key_t> vertices(PySequence_Size(vs.ptr()));
             py_transform_n(vs.ptr(), &py_to_scalar<ustore_key_t>, vertices.begin());
-            g.ref().remove_vertices(vertices).throw_unhandled();
+            py_without_gil([&] { return g.ref().remove_vertices(vertices); }).throw_unhandled();
             if (g.vertices_attrs.db())
-                g.vertices_attrs[vertices].clear().throw_unhandled();
+                py_without_gil([&] { return g.vertices_attrs[vertices].clear(); }).throw_unhandled();
         }
     });
     g.def(
         "remove_edges_from",
         [](py_graph_t& g, py::object adjacency_list) {
-            g.ref().remove_edges(parsed_adjacency_list_t(adjacency_list.ptr())).throw_unhandled();
+            parsed_adjacency_list_t parsed(adjacency_list.ptr());
+            py_without_gil([&] { return g.ref().remove_edges(parsed); }).throw_unhandled();
         },
         py::arg("ebunch"),
         "Removes all edges in supplied adjacency list (in a form of 2 or 3 columnar matrix) from the graph.");
@@ -962,7 +1074,8 @@ void ustore::wrap_networkx(py::module& m) {
     g.def(
         "add_edges_from",
         [](py_graph_t& g, py::object v1s, py::object v2s, py::object es, py::kwargs const& attrs) {
-            g.ref().upsert_edges(parsed_adjacency_list_t(v1s.ptr(), v2s.ptr(), es.ptr())).throw_unhandled();
+            parsed_adjacency_list_t parsed(v1s.ptr(), v2s.ptr(), es.ptr());
+            py_without_gil([&] { return g.ref().upsert_edges(parsed); }).throw_unhandled();
 
             if (!attrs.size())
                 return;
@@ -974,14 +1087,16 @@ void ustore::wrap_networkx(py::module& m) {
                 if (!can_cast_internal_scalars<ustore_key_t>(buf))
                     throw std::invalid_argument("Expecting @c ustore_key_t scalars in zero-copy interface");
                 auto edge_ids = py_strided_range<ustore_key_t const>(buf);
-                g.relations_attrs[edge_ids].assign(value_view_t(json_str)).throw_unhandled();
+                py_without_gil([&] { return g.relations_attrs[edge_ids].assign(value_view_t(json_str)); })
+                    .throw_unhandled();
             }
             else {
                 if (!PySequence_Check(es.ptr()))
                     throw std::invalid_argument("Edge Ids Must Be Sequence");
                 std::vector<ustore_key_t> edge_ids(PySequence_Size(es.ptr()));
                 py_transform_n(es.ptr(), &py_to_scalar<ustore_key_t>, edge_ids.begin());
-                g.relations_attrs[edge_ids].assign(value_view_t(json_str)).throw_unhandled();
+                py_without_gil([&] { return g.relations_attrs[edge_ids].assign(value_view_t(json_str)); })
+                    .throw_unhandled();
             }
         },
         py::arg("us"),
@@ -991,7 +1106,8 @@ void ustore::wrap_networkx(py::module& m) {
     g.def(
         "remove_edges_from",
         [](py_graph_t& g, py::object v1s, py::object v2s, py::object es) {
-            g.ref().remove_edges(parsed_adjacency_list_t(v1s.ptr(), v2s.ptr(), es.ptr())).throw_unhandled();
+            parsed_adjacency_list_t parsed(v1s.ptr(), v2s.ptr(), es.ptr());
+            py_without_gil([&] { return g.ref().remove_edges(parsed); }).throw_unhandled();
 
             if (!g.relations_attrs.db())
                 return;
@@ -1001,14 +1117,14 @@ void ustore::wrap_networkx(py::module& m) {
                 if (!can_cast_internal_scalars<ustore_key_t>(buf))
                     throw std::invalid_argument("Expecting @c ustore_key_t scalars in zero-copy interface");
                 auto edge_ids = py_strided_range<ustore_key_t const>(buf);
-                g.relations_attrs[edge_ids].clear().throw_unhandled();
+                py_without_gil([&] { return g.relations_attrs[edge_ids].clear(); }).throw_unhandled();
             }
             else {
                 if (!PySequence_Check(es.ptr()))
                     throw std::invalid_argument("Edge Ids Must Be Sequence");
                 std::vector<ustore_key_t> edge_ids(PySequence_Size(es.ptr()));
                 py_transform_n(es.ptr(), &py_to_scalar<ustore_key_t>, edge_ids.begin());
-                g.relations_attrs[edge_ids].clear().throw_unhandled();
+                py_without_gil([&] { return g.relations_attrs[edge_ids].clear(); }).throw_unhandled();
             }
         },
         py::arg("us"),
@@ -1035,14 +1151,88 @@ void ustore::wrap_networkx(py::module& m) {
         },
         "Removes both vertices and edges from the graph.");
 
+    // Algorithms
+    // https://networkx.org/documentation/stable/reference/algorithms/index.html
+    g.def(
+        "pagerank",
+        [](py_graph_t& g, float alpha, std::size_t max_iter, float tol) {
+            return analyze_graph<ustore_float_t>(g, ustore_graph_pagerank_k, max_iter, alpha, tol);
+        },
+        py::arg("alpha") = 0.85f,
+        py::arg("max_iter") = 100,
+        py::arg("tol") = 1e-6f,
+        "Returns the sorted vertex IDs and their PageRank scores as two arrays.");
+    g.def(
+        "connected_components",
+        [](py_graph_t& g) { return analyze_graph<ustore_key_t>(g, ustore_graph_components_k); },
+        "Returns the sorted vertex IDs and their weakly connected component labels as two arrays. "
+        "Every component is labeled by the smallest vertex ID within it.");
     g.def(
         "community_louvain",
-        [](py_graph_t& g) {
-            graph_collection_t graph = g.ref();
-            auto partition = best_partition(graph);
-            return py::cast(partition);
+        [](py_graph_t& g, std::size_t max_level, float threshold) {
+            py::tuple found = analyze_graph<ustore_key_t>(g, ustore_graph_communities_k, max_level, 0, threshold);
+            auto vertices = found[0].cast<py::array_t<ustore_key_t>>();
+            auto communities = found[1].cast<py::array_t<ustore_key_t>>();
+            py::dict partition;
+            for (py::ssize_t i = 0; i != vertices.size(); ++i)
+                partition[py::int_(vertices.at(i))] = py::int_(communities.at(i));
+            return partition;
+        },
+        py::arg("max_level") = 100,
+        py::arg("threshold") = 1e-7f,
+        "Returns a dictionary mapping every vertex ID to its Louvain community label. "
+        "Every community is labeled by the smallest vertex ID within it.");
+
+    g.def(
+        "to_csr",
+        &export_csr,
+        py::arg("nodes") = py::none(),
+        py::arg("reverse") = false,
+        "Freezes the graph or the subgraph induced by `nodes` into a read-only CSR snapshot. "
+        "Directed graphs export successors, or predecessors if `reverse`, undirected ones - both.");
+
+    auto csr = py::class_<csr_snapshot_t, std::shared_ptr<csr_snapshot_t>>(m, "GraphCSR", py::module_local());
+    csr.def_property_readonly(
+        "nodes",
+        [](csr_snapshot_t& csr) { return py_arena_array(csr.ids, csr.count, csr.arena); },
+        "Sorted vertex IDs.");
+    csr.def_property_readonly(
+        "indptr",
+        [](csr_snapshot_t& csr) { return py_arena_array(csr.offsets, csr.count + 1, csr.arena); },
+        "Offsets of the adjacency of every vertex in `indices`.");
+    csr.def_property_readonly(
+        "indices",
+        [](csr_snapshot_t& csr) { return py_arena_array(csr.neighbors, csr.edges_count(), csr.arena); },
+        "Offsets of neighbors in `nodes`.");
+    csr.def_property_readonly(
+        "edge_ids",
+        [](csr_snapshot_t& csr) { return py_arena_array(csr.edges_ids, csr.edges_count(), csr.arena); },
+        "IDs of edges, aligned with `indices`.");
+    csr.def("__len__", [](csr_snapshot_t& csr) { return csr.count; });
+    csr.def("__contains__", [](csr_snapshot_t& csr, ustore_key_t v) { return csr.find(v).has_value(); });
+    csr.def("number_of_edges", [](csr_snapshot_t& csr) { return csr.edges_count(); });
+    csr.def(
+        "degree",
+        [](csr_snapshot_t& csr) {
+            py::array_t<ustore_size_t> degrees(csr.count);
+            // The first offset is always zero
+            std::adjacent_difference(csr.offsets + 1, csr.offsets + csr.count + 1, degrees.mutable_data());
+            return degrees;
+        },
+        "Returns the degrees of all vertices, aligned with `nodes`.");
+    csr.def(
+        "neighbors",
+        [](csr_snapshot_t& csr, ustore_key_t v) {
+            auto offset = csr.find(v);
+            if (!offset)
+                throw py::key_error("Missing vertex");
+            auto begin = csr.neighbors + csr.offsets[*offset];
+            auto end = csr.neighbors + csr.offsets[*offset + 1];
+            py::array_t<ustore_key_t> neighbors(end - begin);
+            std::transform(begin, end, neighbors.mutable_data(), [&](ustore_length_t i) { return csr.ids[i]; });
+            return neighbors;
         },
-        "Community Louvain.");
+        "Returns the IDs of the neighbors of a vertex without querying the database.");
 
     // Making copies and subgraphs
     // https://networkx.org/documentation/stable/reference/classes/multidigraph.html#making-copies-and-subgraphs
@@ -118,16 +118,16 @@ void correct_table(docs_table_t& table) {
     // Correctly write contents and offsets in temporary buffers
     ustore_length_t offset = 0;
     auto contents_begin = table.column(0).contents();
-    char buffer[contents_length];
+    std::vector<ustore_byte_t> buffer(contents_length);
     for (std::size_t idx = 0; idx != lens.size(); ++idx) {
-        std::memcpy(buffer + offset, contents_begin + offs[idx], lens[idx]);
+        std::memcpy(buffer.data() + offset, contents_begin + offs[idx], lens[idx]);
         offs[idx] = offset;
         offset += lens[idx];
     }
 
     // Rewrite contents and offsets on arena
     offset_index = 0;
-    std::memcpy(contents_begin, buffer, contents_length);
+    std::memcpy(contents_begin, buffer.data(), contents_length);
     for (std::size_t column_idx : binary_column_indexes) {
         column_view_t column = table.column(column_idx);
         std::memcpy(column.offsets(), offs.data() + offset_index, offsets_per_column * sizeof(ustore_length_t));
@@ -168,8 +168,10 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
         keys_found.resize(keys_count);
     }
 
+    // The exported columns will view this arena directly, keeping it alive
+    py_arena_ptr_t kept_arena = std::make_shared<arena_t>(df.binary.db());
     auto collection =
-        docs_collection_t(df.binary.db(), df.binary, df.binary.txn(), df.binary.snap(), df.binary.member_arena());
+        docs_collection_t(df.binary.db(), df.binary, df.binary.txn(), df.binary.snap(), kept_arena->member_ptr());
     auto members = collection[keys_found];
 
     // Extract the present fields
@@ -228,7 +230,11 @@ static std::shared_ptr<arrow::RecordBatch> materialize(py_table_collection_t& df
     }
 
     // https://github.com/apache/arrow/blob/e0e740bd7a24de68262c0b7e47eeed62a6cbd2a0/cpp/src/arrow/c/bridge.h#L163
-    return arrow::ImportRecordBatch(&c_arrow_array, &c_arrow_schema).ValueOrDie();
+    std::shared_ptr<arrow::RecordBatch> batch = arrow::ImportRecordBatch(&c_arrow_array, &c_arrow_schema).ValueOrDie();
+    std::vector<std::shared_ptr<arrow::Array>> columns(batch->num_columns());
+    for (int column_idx = 0; column_idx != batch->num_columns(); ++column_idx)
+        columns[column_idx] = py_arena_attach(batch->column(column_idx), kept_arena);
+    return arrow::RecordBatch::Make(batch->schema(), batch->num_rows(), std::move(columns));
 }
 
 template <typename array_type_at>
@@ -6,6 +6,8 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 
+#include <arrow/buffer.h> // `arrow::Buffer`
+#include <arrow/array.h>  // `arrow::ArrayData`
 #include <arrow/python/pyarrow.h>
 
 #include "ustore/ustore.hpp"
@@ -105,6 +107,73 @@ struct py_collection_gt {
 using py_blobs_collection_t = py_collection_gt<blobs_collection_t>;
 using py_docs_collection_t = py_collection_gt<docs_collection_t>;
 
+/**
+ * @brief Arena, that outlives the call, that filled it, for as long as any NumPy
+ * or Arrow object references its memory. Zero-copy exports read into a fresh
+ * one, instead of the arena of the collection, that the next call would reuse.
+ */
+using py_arena_ptr_t = std::shared_ptr<arena_t>;
+
+/**
+ * @brief Arrow buffer, viewing the memory of a kept-alive arena.
+ */
+class py_arena_buffer_t : public arrow::Buffer {
+    py_arena_ptr_t arena_;
+
+  public:
+    py_arena_buffer_t(void const* data, std::size_t size, py_arena_ptr_t arena) noexcept
+        : arrow::Buffer(reinterpret_cast<std::uint8_t const*>(data), static_cast<std::int64_t>(size)),
+          arena_(std::move(arena)) {}
+    py_arena_buffer_t(std::shared_ptr<arrow::Buffer> const& parent, py_arena_ptr_t arena) noexcept
+        : arrow::Buffer(parent, 0, parent->size()), arena_(std::move(arena)) {}
+};
+
+inline std::shared_ptr<arrow::Buffer> py_arena_buffer(void const* data, std::size_t size, py_arena_ptr_t arena) {
+    return std::make_shared<py_arena_buffer_t>(data, size, std::move(arena));
+}
+
+/**
+ * @brief Attaches the arena to every buffer of an array, imported through
+ * the Arrow C Data Interface, so that its memory stays valid in Python.
+ */
+inline void py_arena_attach(arrow::ArrayData& data, py_arena_ptr_t const& arena) {
+    for (std::shared_ptr<arrow::Buffer>& buffer : data.buffers)
+        if (buffer)
+            buffer = std::make_shared<py_arena_buffer_t>(buffer, arena);
+    for (std::shared_ptr<arrow::ArrayData>& child : data.child_data) {
+        child = child->Copy();
+        py_arena_attach(*child, arena);
+    }
+}
+
+inline std::shared_ptr<arrow::Array> py_arena_attach(std::shared_ptr<arrow::Array> const& array,
+                                                     py_arena_ptr_t const& arena) {
+    std::shared_ptr<arrow::ArrayData> data = array->data()->Copy();
+    py_arena_attach(*data, arena);
+    return arrow::MakeArray(data);
+}
+
+/**
+ * @brief Wraps the memory of a kept-alive arena into a NumPy array without copies.
+ * The array holds a capsule, which releases the arena, once garbage-collected.
+ */
+template <typename scalar_at>
+py::array_t<scalar_at> py_arena_array(scalar_at const* data, std::size_t count, py_arena_ptr_t const& arena) {
+    py::capsule owner(new py_arena_ptr_t(arena), [](void* ptr) { delete reinterpret_cast<py_arena_ptr_t*>(ptr); });
+    return py::array_t<scalar_at>(count, data, owner);
+}
+
+/**
+ * @brief Calls into the native library without holding the GIL, so that other
+ * Python threads can run meanwhile. The arguments must already be converted
+ * from Python objects, and the objects themselves must stay referenced.
+ */
+template <typename callable_at>
+auto py_without_gil(callable_at&& callable) {
+    [[maybe_unused]] py::gil_scoped_release release;
+    return callable();
+}
+
 struct py_buffer_memory_t {
     Py_buffer raw;
     /// The memory that `raw.shape` points to.
@@ -119,6 +119,20 @@ def scan(col):
     assert np.array_equal(keys, [60])
 
 
+def parallel_read(col):
+    col.clear()
+    count_keys: int = 10_000
+    keys = np.arange(count_keys, dtype=np.int64)
+    col.set(keys, [f'{i}'.encode() for i in range(count_keys)])
+
+    expected = [f'{i}'.encode() for i in range(count_keys)] + [None]
+    keys = np.append(keys, count_keys)
+    for threads in (0, 1, 3):
+        values = col.get_parallel(keys, threads=threads)
+        values = values if isinstance(values, tuple) else values.to_pylist()
+        assert list(values) == expected
+
+
 def iterate(col):
     col.clear()
     col[1] = b'a'
@@ -176,6 +190,7 @@ def test_main_collection():
     only_operators(main)
     batch_insert(main)
     scan(main)
+    parallel_read(main)
     iterate(main)
 
 
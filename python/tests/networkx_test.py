@@ -519,3 +519,59 @@ def test_conflicting_transactions():
     txn1.commit()
     with pytest.raises(Exception):
         txn2.commit()
+
+
+def test_csr():
+    net = ustore.DataBase().main.graph
+
+    # 1 - 2 - 3 - 1
+    net.add_edge(1, 2)
+    net.add_edge(2, 3)
+    net.add_edge(3, 1)
+
+    csr = net.to_csr()
+    assert len(csr) == 3
+    assert csr.number_of_edges() == 6
+    assert np.array_equal(csr.nodes, [1, 2, 3])
+    assert np.array_equal(csr.indptr, [0, 2, 4, 6])
+    assert np.array_equal(csr.degree(), [2, 2, 2])
+    assert sorted(csr.neighbors(1)) == [2, 3]
+    assert len(csr.edge_ids) == len(csr.indices)
+
+    sub = net.to_csr(nodes=[1, 2, 42])
+    assert 42 not in sub
+    assert np.array_equal(sub.nodes, [1, 2])
+    assert np.array_equal(sub.indptr, [0, 1, 2])
+    assert np.array_equal(sub.indices, [1, 0])
+
+    net.clear()
+
+
+def test_algorithms():
+    net = ustore.DataBase().main.graph
+    reference = nx.DiGraph()
+
+    # Two cliques, joined by a bridge, and an isolated vertex
+    edges = [(1, 2), (1, 3), (1, 4), (2, 3), (2, 4),
+             (3, 4), (4, 11), (11, 12), (11, 13), (11, 14),
+             (12, 13), (12, 14), (13, 14)]
+    for v1, v2 in edges:
+        net.add_edge(v1, v2)
+    net.add_node(20)
+    reference.add_edges_from(edges)
+    reference.add_node(20)
+
+    vertices, scores = net.pagerank()
+    expected = nx.pagerank(reference)
+    assert np.array_equal(vertices, sorted(expected))
+    assert np.allclose(scores, [expected[v] for v in vertices], atol=1e-4)
+
+    vertices, labels = net.connected_components()
+    assert np.array_equal(vertices, [1, 2, 3, 4, 11, 12, 13, 14, 20])
+    assert np.array_equal(labels, [1, 1, 1, 1, 1, 1, 1, 1, 20])
+
+    partition = net.community_louvain()
+    assert partition == {1: 1, 2: 1, 3: 1, 4: 1,
+                         11: 11, 12: 11, 13: 11, 14: 11, 20: 20}
+
+    net.clear()
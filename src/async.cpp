@@ -0,0 +1,183 @@
+/**
+ * @file async.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Completion queues on top of any @see "ustore.h"-compatible system.
+ *
+ * Requests are executed by a pool of threads, calling the synchronous interface.
+ * The embedded engines block those threads on disk IO and the Flight client
+ * blocks them on network round-trips, but never the thread, that submitted them.
+ */
+
+#include <thread>             // `std::thread`
+#include <mutex>              // `std::unique_lock`
+#include <condition_variable> // `std::condition_variable`
+#include <deque>              // `std::deque`
+#include <vector>             // `std::vector`
+#include <chrono>             // `std::chrono::microseconds`
+#include <memory>             // `std::unique_ptr`
+#include <algorithm>          // `std::max`
+
+#include "ustore/async.h"
+#include "ustore/blobs.h"
+#include "ustore/docs.h"
+#include "ustore/graph.h"
+#include "ustore/vectors.h"
+
+#include "helpers/linked_memory.hpp" // `safe_section`
+
+using namespace unum::ustore;
+using namespace unum;
+
+struct async_task_t {
+    ustore_async_kind_t kind;
+    void* request;
+    ustore_callback_t callback;
+    ustore_callback_payload_t callback_payload;
+};
+
+/**
+ * @brief Pool of threads, popping tasks from a shared FIFO, and a second FIFO
+ * of completions, that weren't delivered through callbacks.
+ */
+struct async_queue_t {
+    std::mutex mutex;
+    std::condition_variable tasks_ready;
+    std::condition_variable completions_ready;
+    std::condition_variable drained;
+    std::deque<async_task_t> tasks;
+    std::deque<ustore_callback_payload_t> completions;
+    std::vector<std::thread> threads;
+    std::size_t executing = 0;
+    bool stopping = false;
+
+    ~async_queue_t() noexcept {
+        {
+            std::unique_lock lock {mutex};
+            stopping = true;
+        }
+        tasks_ready.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void work() noexcept {
+        std::unique_lock lock {mutex};
+        while (true) {
+            tasks_ready.wait(lock, [&] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+
+            async_task_t task = tasks.front();
+            tasks.pop_front();
+            ++executing;
+            lock.unlock();
+            execute(task);
+            if (task.callback)
+                task.callback(task.callback_payload);
+            lock.lock();
+
+            --executing;
+            if (!task.callback) {
+                completions.push_back(task.callback_payload);
+                completions_ready.notify_one();
+            }
+            if (tasks.empty() && !executing)
+                drained.notify_all();
+        }
+    }
+
+    static void execute(async_task_t const& task) noexcept {
+        switch (task.kind) {
+        case ustore_async_read_k: ustore_read(static_cast<ustore_read_t*>(task.request)); break;
+        case ustore_async_write_k: ustore_write(static_cast<ustore_write_t*>(task.request)); break;
+        case ustore_async_scan_k: ustore_scan(static_cast<ustore_scan_t*>(task.request)); break;
+        case ustore_async_sample_k: ustore_sample(static_cast<ustore_sample_t*>(task.request)); break;
+        case ustore_async_measure_k: ustore_measure(static_cast<ustore_measure_t*>(task.request)); break;
+        case ustore_async_docs_read_k: ustore_docs_read(static_cast<ustore_docs_read_t*>(task.request)); break;
+        case ustore_async_docs_write_k: ustore_docs_write(static_cast<ustore_docs_write_t*>(task.request)); break;
+        case ustore_async_docs_gather_k: ustore_docs_gather(static_cast<ustore_docs_gather_t*>(task.request)); break;
+        case ustore_async_graph_find_edges_k:
+            ustore_graph_find_edges(static_cast<ustore_graph_find_edges_t*>(task.request));
+            break;
+        case ustore_async_graph_upsert_edges_k:
+            ustore_graph_upsert_edges(static_cast<ustore_graph_upsert_edges_t*>(task.request));
+            break;
+        case ustore_async_vectors_read_k:
+            ustore_vectors_read(static_cast<ustore_vectors_read_t*>(task.request));
+            break;
+        case ustore_async_vectors_write_k:
+            ustore_vectors_write(static_cast<ustore_vectors_write_t*>(task.request));
+            break;
+        case ustore_async_vectors_search_k:
+            ustore_vectors_search(static_cast<ustore_vectors_search_t*>(task.request));
+            break;
+        }
+    }
+};
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
+
+void ustore_async_queue_init(ustore_async_queue_init_t* c_ptr) {
+
+    ustore_async_queue_init_t& c = *c_ptr;
+    return_error_if_m(c.queue, c.error, args_wrong_k, "Queue output is uninitialized");
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    safe_section("Starting threads", c.error, [&] {
+        auto queue = std::make_unique<async_queue_t>();
+        std::size_t threads_count = c.threads_count ? c.threads_count : std::thread::hardware_concurrency();
+        threads_count = std::max<std::size_t>(threads_count, 1);
+        for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+            queue->threads.emplace_back(&async_queue_t::work, queue.get());
+        *c.queue = queue.release();
+    });
+}
+
+void ustore_async_submit(ustore_async_submit_t* c_ptr) {
+
+    ustore_async_submit_t& c = *c_ptr;
+    return_error_if_m(c.queue, c.error, uninitialized_state_k, "Queue is uninitialized");
+    return_error_if_m(c.request, c.error, args_wrong_k, "Request is missing");
+    return_error_if_m(c.kind <= ustore_async_vectors_search_k, c.error, args_wrong_k, "Unknown request kind");
+
+    async_queue_t& queue = *reinterpret_cast<async_queue_t*>(c.queue);
+    safe_section("Enqueuing request", c.error, [&] {
+        std::unique_lock lock {queue.mutex};
+        queue.tasks.push_back({c.kind, c.request, c.callback, c.callback_payload});
+        queue.tasks_ready.notify_one();
+    });
+}
+
+void ustore_async_poll(ustore_async_poll_t* c_ptr) {
+
+    ustore_async_poll_t& c = *c_ptr;
+    return_error_if_m(c.queue, c.error, uninitialized_state_k, "Queue is uninitialized");
+    return_error_if_m(c.count, c.error, args_wrong_k, "Count output is uninitialized");
+    return_error_if_m(c.payloads || !c.count_limit, c.error, args_wrong_k, "Payloads output is uninitialized");
+
+    async_queue_t& queue = *reinterpret_cast<async_queue_t*>(c.queue);
+    std::unique_lock lock {queue.mutex};
+    if (c.timeout_microseconds)
+        queue.completions_ready.wait_for(lock, std::chrono::microseconds(c.timeout_microseconds), [&] {
+            return !queue.completions.empty();
+        });
+
+    std::size_t count = 0;
+    for (; count != c.count_limit && !queue.completions.empty(); ++count) {
+        c.payloads[count] = queue.completions.front();
+        queue.completions.pop_front();
+    }
+    *c.count = count;
+}
+
+void ustore_async_queue_free(ustore_async_queue_t c_queue) {
+    if (!c_queue)
+        return;
+
+    auto queue = std::unique_ptr<async_queue_t>(reinterpret_cast<async_queue_t*>(c_queue));
+    std::unique_lock lock {queue->mutex};
+    queue->drained.wait(lock, [&] { return queue->tasks.empty() && !queue->executing; });
+}
@@ -7,6 +7,7 @@
  */
 #include <mutex>
 #include <fstream>
+#include <numeric> // `std::iota`
 
 #include <leveldb/db.h>
 #include <leveldb/comparator.h>
@@ -19,6 +20,12 @@
 #include "helpers/linked_array.hpp"  // `uninitialized_array_gt`
 #include "helpers/full_scan.hpp"     // `reservoir_sample_iterator`
 #include "helpers/config_loader.hpp" // `config_loader_t`
+#include "helpers/threads.hpp"       // `threads_registry_t`
+#include "helpers/metrics.hpp"       // `operation_timer_t`
+#include "helpers/read_cache.hpp"    // `read_cache_t`
+#include "helpers/key_encoding.hpp"  // `encode_key`
+#include "helpers/string_keys.hpp"   // `read_strings`
+#include "helpers/algorithm.hpp"     // `deduplicate_gather_join_scatter`
 
 using namespace unum::ustore;
 using namespace unum;
@@ -42,6 +49,10 @@ using level_status_t = leveldb::Status;
 using level_options_t = leveldb::Options;
 using level_iter_uptr_t = std::unique_ptr<leveldb::Iterator>;
 
+/**
+ * @brief Orders the keys of databases, created before the `key_encoding_t::ordered_k`,
+ * which are stored in the native byte order. The newer ones use the built-in bytewise comparator.
+ */
 struct key_comparator_t final : public leveldb::Comparator {
 
     inline int Compare(leveldb::Slice const& a, leveldb::Slice const& b) const override {
@@ -64,37 +75,107 @@ struct key_comparator_t final : public leveldb::Comparator {
 
 static key_comparator_t const key_comparator_k = {};
 
+/**
+ * @brief Iterators over a snapshot never observe newer writes, so unlike the HEAD ones,
+ * they can be reused between requests instead of being re-created every time.
+ * Separate pools are kept for iterators that do and don't populate the block cache.
+ */
 struct level_snapshot_t {
     leveldb::Snapshot const* snapshot = nullptr;
+    std::mutex iterators_mutex;
+    std::vector<level_iter_uptr_t> iterators[2];
 };
 
 struct level_db_t {
     std::unordered_map<ustore_size_t, level_snapshot_t*> snapshots;
     std::unique_ptr<level_native_t> native;
+    /** @brief Paths of the main collection, if it was opened with native string keys. */
+    std::unique_ptr<level_native_t> strings;
+    /** @brief Optional cache of hot values, that lookups outside of snapshots go through. */
+    std::unique_ptr<read_cache_t> read_cache;
+    /** @brief Databases, created with the custom `key_comparator_t`, keep using the native encoding. */
+    key_encoding_t key_encoding = key_encoding_t::ordered_k;
     std::mutex mutex;
+
+    encoded_key_t encode(ustore_key_t key) const noexcept { return encode_key(key, key_encoding); }
+    ustore_key_t decode(leveldb::Slice const& key) const noexcept { return decode_key(key.data(), key_encoding); }
 };
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
 /*********************************************************/
 
-inline leveldb::Slice to_slice(ustore_key_t const& key) noexcept {
-    return {reinterpret_cast<char const*>(&key), sizeof(ustore_key_t)};
+inline leveldb::Slice to_slice(encoded_key_t const& key) noexcept {
+    return {key.data(), key.size()};
 }
 
 inline leveldb::Slice to_slice(value_view_t value) noexcept {
     return {reinterpret_cast<const char*>(value.begin()), value.size()};
 }
 
-inline std::unique_ptr<std::string> make_value(ustore_error_t* c_error) noexcept {
-    std::unique_ptr<std::string> value_uptr;
-    try {
-        value_uptr = std::make_unique<std::string>();
+/**
+ * @brief Borrows an iterator for the lifetime of a request.
+ * For snapshots, takes it from the pool and puts it back on destruction.
+ */
+class level_iterator_lease_t {
+    level_snapshot_t* snapshot_ = nullptr;
+    level_iter_uptr_t iterator_;
+    bool fill_cache_ = true;
+
+  public:
+    level_iterator_lease_t(level_db_t& db, level_snapshot_t* snapshot, leveldb::ReadOptions const& options) noexcept
+        : snapshot_(snapshot), fill_cache_(options.fill_cache) {
+        if (snapshot_) {
+            std::lock_guard<std::mutex> locker(snapshot_->iterators_mutex);
+            auto& pool = snapshot_->iterators[fill_cache_];
+            if (!pool.empty()) {
+                iterator_ = std::move(pool.back());
+                pool.pop_back();
+                return;
+            }
+        }
+        try {
+            iterator_ = level_iter_uptr_t(db.native->NewIterator(options));
+        }
+        catch (...) {
+        }
     }
-    catch (...) {
-        *c_error = "Fail to allocate value";
+
+    ~level_iterator_lease_t() noexcept {
+        if (!snapshot_ || !iterator_)
+            return;
+        std::lock_guard<std::mutex> locker(snapshot_->iterators_mutex);
+        try {
+            snapshot_->iterators[fill_cache_].push_back(std::move(iterator_));
+        }
+        catch (...) {
+        }
+    }
+
+    explicit operator bool() const noexcept { return iterator_ != nullptr; }
+    leveldb::Iterator* operator->() const noexcept { return iterator_.get(); }
+};
+
+/**
+ * @brief Sets the snapshot in read `options`, if one was requested.
+ * @return Snapshot handle or NULL for HEAD reads.
+ */
+level_snapshot_t* read_snapshot( //
+    level_db_t& db,
+    ustore_snapshot_t c_snapshot,
+    leveldb::ReadOptions& options,
+    ustore_error_t* c_error) noexcept {
+
+    if (!c_snapshot)
+        return nullptr;
+    std::lock_guard<std::mutex> locker(db.mutex);
+    auto it = db.snapshots.find(c_snapshot);
+    if (it == db.snapshots.end()) {
+        log_error_m(c_error, args_wrong_k, "The snapshot does'nt exist!");
+        return nullptr;
     }
-    return value_uptr;
+    options.snapshot = it->second->snapshot;
+    return it->second;
 }
 
 bool export_error(level_status_t const& status, ustore_error_t* c_error) {
@@ -112,12 +193,49 @@ bool export_error(level_status_t const& status, ustore_error_t* c_error) {
     return true;
 }
 
+/**
+ * @brief Size of the write batches, that copy the contents of a database during migrations.
+ */
+constexpr std::size_t migration_batch_bytes_k = 16 * 1024 * 1024;
+
+/**
+ * @brief Copies a database with the `key_encoding_t::native_k` into a new one in the `target`
+ * directory, re-encoding the keys, to be opened with the bytewise comparator.
+ */
+level_status_t migrate_keys(level_native_t& legacy, stdfs::path const& target, level_options_t options) {
+
+    options.comparator = leveldb::BytewiseComparator();
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    level_native_t* target_db = nullptr;
+    level_status_t status = leveldb::DB::Open(options, target.string(), &target_db);
+    if (!status.ok())
+        return status;
+
+    leveldb::WriteBatch batch;
+    level_iter_uptr_t it(legacy.NewIterator(leveldb::ReadOptions()));
+    for (it->SeekToFirst(); status.ok() && it->Valid(); it->Next()) {
+        batch.Put(to_slice(migrate_key(it->key().data())), it->value());
+        if (batch.ApproximateSize() < migration_batch_bytes_k)
+            continue;
+        status = target_db->Write(leveldb::WriteOptions(), &batch);
+        batch.Clear();
+    }
+    if (status.ok())
+        status = it->status();
+    if (status.ok())
+        status = target_db->Write(leveldb::WriteOptions(), &batch);
+
+    it.reset();
+    delete target_db;
+    return status;
+}
+
 void ustore_database_init(ustore_database_init_t* c_ptr) {
 
     ustore_database_init_t& c = *c_ptr;
     try {
         level_options_t options;
-        options.comparator = &key_comparator_k;
         options.compression = leveldb::kNoCompression;
         options.create_if_missing = true;
 
@@ -141,7 +259,11 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         // Engine config
         return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
 
-        auto fill_options = [](json_t const& js, level_options_t& options) {
+        std::size_t read_cache_size = 0;
+        bool string_keys = false;
+        bool migrate = false;
+        bool keep_legacy = false;
+        auto fill_options = [&](json_t const& js, level_options_t& options) {
             if (js.contains("write_buffer_size"))
                 options.write_buffer_size = js["write_buffer_size"];
             if (js.contains("max_file_size"))
@@ -150,6 +272,14 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
                 options.max_open_files = js["max_open_files"];
             if (js.contains("cache_size"))
                 options.block_cache = leveldb::NewLRUCache(js["cache_size"]);
+            if (js.contains("read_cache_size"))
+                read_cache_size = js["read_cache_size"];
+            if (js.contains("string_keys"))
+                string_keys = js["string_keys"];
+            if (js.contains("migrate_keys"))
+                migrate = js["migrate_keys"];
+            if (js.contains("legacy_keys"))
+                keep_legacy = js["legacy_keys"];
             if (js.contains("create_if_missing"))
                 options.create_if_missing = js["create_if_missing"];
             if (js.contains("error_if_exists"))
@@ -172,15 +302,87 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         if (!config.engine.config.empty())
             fill_options(config.engine.config, options);
 
-        level_db_t* db_ptr = new level_db_t;
+        return_error_if_m(!migrate || !keep_legacy,
+                          c.error,
+                          args_combo_k,
+                          "Can't both migrate and keep the legacy key encoding");
+
+        // Both are only handed off on success, so any early return or exception releases them
+        auto db_ptr = std::make_unique<level_db_t>();
         level_native_t* native_db = nullptr;
-        level_status_t status = leveldb::DB::Open(options, root, &native_db);
+        std::unique_ptr<level_native_t> native_owner;
+        level_status_t status;
+        bool legacy = keep_legacy;
+        if (!legacy) {
+            status = leveldb::DB::Open(options, root, &native_db);
+            native_owner.reset(native_db);
+            legacy = status.IsInvalidArgument() && status.ToString().find(key_comparator_k.Name()) != std::string::npos;
+            if (legacy && !migrate)
+                log_warning_m("LevelDB in %s uses the legacy key encoding, migrate to avoid the custom comparator\n",
+                              root.c_str());
+        }
+
+        // Databases, created with the integer comparator, are opened in compatibility mode,
+        // unless the `migrate_keys` option asks to rewrite them with the ordered encoding.
+        if (legacy) {
+            db_ptr->key_encoding = key_encoding_t::native_k;
+            options.comparator = &key_comparator_k;
+            status = leveldb::DB::Open(options, root, &native_db);
+            native_owner.reset(native_db);
+        }
         if (!status.ok()) {
             *c.error = "Couldn't open LevelDB";
             return;
         }
-        db_ptr->native = std::unique_ptr<level_native_t>(native_db);
-        *c.db = db_ptr;
+
+        if (legacy && migrate) {
+            key_migration_t migration(root);
+            return_error_if_m(!stdfs::exists(migration.backup),
+                              c.error,
+                              args_wrong_k,
+                              "Remove the backup of the previous migration first");
+            stdfs::remove_all(migration.staging);
+            log_warning_m("Migrating LevelDB in %s to the ordered key encoding\n", root.c_str());
+            status = migrate_keys(*native_db, migration.staging, options);
+            native_owner.reset();
+            native_db = nullptr;
+            if (!status.ok()) {
+                *c.error = "Couldn't migrate LevelDB keys";
+                return;
+            }
+
+            // Native string keys are already ordered bytewise, so they are copied as is
+            if (stdfs::exists(root / "strings"))
+                stdfs::copy(root / "strings", migration.staging / "strings", stdfs::copy_options::recursive);
+            migration.commit();
+            log_warning_m("The legacy LevelDB is kept in %s, remove it once the migration is verified\n",
+                          migration.backup.c_str());
+
+            db_ptr->key_encoding = key_encoding_t::ordered_k;
+            options.comparator = leveldb::BytewiseComparator();
+            status = leveldb::DB::Open(options, root, &native_db);
+            native_owner.reset(native_db);
+            if (!status.ok()) {
+                *c.error = "Couldn't open migrated LevelDB";
+                return;
+            }
+        }
+        db_ptr->native = std::move(native_owner);
+        if (string_keys) {
+            level_options_t strings_options = options;
+            strings_options.comparator = leveldb::BytewiseComparator();
+            level_native_t* strings_db = nullptr;
+            status = leveldb::DB::Open(strings_options, root / "strings", &strings_db);
+            db_ptr->strings = std::unique_ptr<level_native_t>(strings_db);
+            if (!status.ok()) {
+                *c.error = "Couldn't open LevelDB for string keys";
+                return;
+            }
+        }
+        if (read_cache_size)
+            db_ptr->read_cache = std::make_unique<read_cache_t>(read_cache_size);
+        register_threads(db_ptr.get(), config);
+        *c.db = db_ptr.release();
     }
     catch (json_t::type_error const&) {
         *c.error = "Unsupported type in LevelDB configuration key";
@@ -247,6 +449,11 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
     if (!snap.snapshot)
         return;
 
+    {
+        std::lock_guard<std::mutex> locker(snap.iterators_mutex);
+        for (auto& pool : snap.iterators)
+            pool.clear();
+    }
     db.native->ReleaseSnapshot(snap.snapshot);
     snap.snapshot = nullptr;
 
@@ -265,15 +472,17 @@ void write_one( //
 
     auto place = places[0];
     auto content = contents[0];
-    auto key = to_slice(place.key);
+    auto encoded = db.encode(place.key);
+    auto key = to_slice(encoded);
     level_status_t status =
         !content ? db.native->Delete(options, key) : db.native->Put(options, key, to_slice(content));
     export_error(status, c_error);
 }
 
+template <typename places_at>
 void write_many( //
     level_db_t& db,
-    places_arg_t const& places,
+    places_at const& places,
     contents_arg_t const& contents,
     leveldb::WriteOptions const& options,
     ustore_error_t* c_error) {
@@ -283,7 +492,8 @@ void write_many( //
         auto place = places[i];
         auto content = contents[i];
 
-        auto key = to_slice(place.key);
+        auto encoded = db.encode(place.key);
+        auto key = to_slice(encoded);
         if (!content)
             batch.Delete(key);
         else
@@ -297,6 +507,7 @@ void write_many( //
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::write_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
@@ -312,14 +523,26 @@ void ustore_write(ustore_write_t* c_ptr) {
 
     validate_write(c.transaction, places, contents, c.options, c.error);
     return_if_error_m(c.error);
+    return_error_if_m(!(c.options & ustore_option_write_merge_k),
+                      c.error,
+                      missing_feature_k,
+                      "LevelDB has no merge operators!");
+    return_error_if_m(!c.positions,
+                      c.error,
+                      missing_feature_k,
+                      "LevelDB has no merge operators for positional writes!");
 
     leveldb::WriteOptions options;
     if (c.options & ustore_option_write_flush_k)
         options.sync = true;
 
     try {
-        auto func = c.tasks_count == 1 ? &write_one : &write_many;
-        func(db, places, contents, options, c.error);
+        if (c.tasks_count == 1)
+            write_one(db, places, contents, options, c.error);
+        else
+            places.dispatch([&](auto const& places) { write_many(db, places, contents, options, c.error); });
+        for (std::size_t i = 0; db.read_cache && i != places.size(); ++i)
+            db.read_cache->invalidate(ustore_collection_main_k, places[i].key);
     }
     catch (...) {
         *c.error = "Write Failure";
@@ -337,7 +560,7 @@ void read_enumerate( //
 
     for (std::size_t i = 0; i != tasks.size(); ++i) {
         place_t place = tasks[i];
-        level_status_t status = db.native->Get(options, to_slice(place.key), &value);
+        level_status_t status = db.native->Get(options, to_slice(db.encode(place.key)), &value);
         if (!status.IsNotFound()) {
             if (export_error(status, c_error))
                 return;
@@ -350,22 +573,79 @@ void read_enumerate( //
     }
 }
 
+/**
+ * @brief How many times to advance the iterator with `Next` before
+ * falling back to a `Seek`, which searches through every level of the tree.
+ */
+constexpr std::size_t dense_steps_k = 4;
+
+inline ustore_key_t iterator_key(level_db_t const& db, level_iterator_lease_t const& it) noexcept {
+    return db.decode(it->key());
+}
+
+/**
+ * @brief Serves a batch of keys with a single iterator, visiting them in the sorted `order`.
+ * When the requested keys are dense, the iterator is just advanced to the next entries.
+ * The `enumerator` is called in the same sorted order, as the values are only valid
+ * until the iterator moves.
+ */
+template <typename places_at, typename value_enumerator_at>
+void read_sorted( //
+    level_db_t const& db,
+    level_iterator_lease_t& it,
+    places_at const& tasks,
+    ptr_range_gt<std::size_t const> order,
+    value_enumerator_at enumerator,
+    ustore_error_t* c_error) {
+
+    bool positioned = false;
+    for (std::size_t i : order) {
+        ustore_key_t const key = tasks[i].key;
+        std::size_t steps = 0;
+        if (positioned)
+            while (it->Valid() && iterator_key(db, it) < key && steps != dense_steps_k)
+                it->Next(), ++steps;
+        if (!positioned || (it->Valid() && iterator_key(db, it) < key)) {
+            it->Seek(to_slice(db.encode(key)));
+            positioned = true;
+        }
+
+        if (it->Valid() && iterator_key(db, it) == key) {
+            auto value = it->value();
+            auto length = static_cast<ustore_length_t>(value.size());
+            enumerator(i, value_view_t {reinterpret_cast<ustore_bytes_cptr_t>(value.data()), length});
+        }
+        else
+            enumerator(i, value_view_t {});
+    }
+    export_error(it->status(), c_error);
+}
+
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    if (deduplicates_reads(c))
+        return deduplicate_gather_join_scatter(c, [](ustore_read_t& unique) { ustore_read(&unique); });
+    operation_timer_t timer {operation_t::read_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
-    level_snapshot_t& snap = *reinterpret_cast<level_snapshot_t*>(c.snapshot);
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     places_arg_t places {{}, keys, {}, c.tasks_count};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
+    slices_arg_t slices {slices_starts, slices_lengths, c.values_limit};
 
     validate_read(c.transaction, places, c.options, c.error);
     return_if_error_m(c.error);
 
+    leveldb::ReadOptions options;
+    level_snapshot_t* snap = read_snapshot(db, c.snapshot, options, c.error);
+    return_if_error_m(c.error);
+
     // 1. Allocate a tape for all the values to be pulled
     auto offs = arena.alloc_or_dummy(places.count + 1, c.error, c.offsets);
     return_if_error_m(c.error);
@@ -376,29 +656,119 @@ void ustore_read(ustore_read_t* c_ptr) {
     bool const needs_export = c.values != nullptr;
 
     uninitialized_array_gt<byte_t> contents(arena);
+    auto export_value = [&](std::size_t i, value_view_t value) {
+        value = slices.apply(i, value);
+        presences[i] = bool(value);
+        lens[i] = value ? value.size() : ustore_length_missing_k;
+        offs[i] = contents.size();
+        if (needs_export)
+            contents.insert(contents.size(), value.begin(), value.end(), c.error);
+    };
+
+    // Values fetched from the engine are cached on the way out
+    read_cache_t* cache = !snap ? db.read_cache.get() : nullptr;
+    read_cache_t::tickets_t tickets;
+    auto cache_value = [&](std::size_t i, value_view_t value) {
+        if (cache && value)
+            cache->insert(ustore_collection_main_k, places[i].key, value, tickets);
+    };
 
     // 2. Pull metadata & data in one run, as reading from disk is expensive
     try {
-        leveldb::ReadOptions options;
-        if (c.snapshot) {
-            auto it = db.snapshots.find(c.snapshot);
-            return_error_if_m(it != db.snapshots.end(), c.error, args_wrong_k, "The snapshot does'nt exist!");
-            options.snapshot = snap.snapshot;
+        if (places.count == 1) {
+            bool const hit = cache && cache->find(ustore_collection_main_k, places[0].key, [&](value_view_t value) {
+                export_value(0, value);
+            });
+            if (cache) {
+                read_cache_t::account(hit, !hit);
+                tickets = cache->tickets();
+            }
+            std::string value_buffer;
+            auto data_enumerator = [&](std::size_t i, value_view_t value) {
+                cache_value(i, value);
+                export_value(i, value);
+            };
+            if (!hit)
+                read_enumerate(db, places, options, value_buffer, data_enumerator, c.error);
+            offs[places.count] = contents.size();
+            if (needs_export)
+                *c.values = reinterpret_cast<ustore_bytes_ptr_t>(contents.begin());
+            return;
+        }
+
+        // Cached values are exported first, in the order of requests
+        std::size_t* order = arena.alloc<std::size_t>(places.count, c.error).begin();
+        return_if_error_m(c.error);
+        std::size_t misses = 0;
+        if (cache) {
+            tickets = cache->tickets();
+            for (std::size_t i = 0; i != places.count; ++i)
+                if (!cache->find(ustore_collection_main_k, places[i].key, [&](value_view_t value) {
+                        export_value(i, value);
+                    }))
+                    order[misses++] = i;
+            read_cache_t::account(places.count - misses, misses);
         }
+        else {
+            std::iota(order, order + places.count, 0);
+            misses = places.count;
+        }
+
+        // Visit the remaining keys in sorted order, so that the iterator only moves forward
+        auto less = [&](std::size_t a, std::size_t b) noexcept { return places[a].key < places[b].key; };
+        bool const is_sorted = std::is_sorted(order, order + misses, less);
+        if (!is_sorted)
+            std::sort(order, order + misses, less);
+        bool const in_order = misses == 0 || (misses == places.count && is_sorted);
 
-        std::string value_buffer;
-        ustore_length_t progress_in_tape = 0;
+        // If the input was unordered, the values are collected in sorted order
+        // and reordered later. Repeated keys share one copy until then.
+        std::size_t previous = places.count;
         auto data_enumerator = [&](std::size_t i, value_view_t value) {
-            presences[i] = bool(value);
-            lens[i] = value ? value.size() : ustore_length_missing_k;
-            offs[i] = contents.size();
-            if (needs_export)
-                contents.insert(contents.size(), value.begin(), value.end(), c.error);
+            if (previous != places.count && places[previous].key == places[i].key) {
+                presences[i] = presences[previous];
+                lens[i] = lens[previous];
+                offs[i] = offs[previous];
+                previous = i;
+                return;
+            }
+            previous = i;
+            cache_value(i, value);
+            export_value(i, value);
         };
-        read_enumerate(db, places, options, value_buffer, data_enumerator, c.error);
-        offs[places.count] = contents.size();
-        if (needs_export)
+        if (misses) {
+            level_iterator_lease_t it(db, snap, options);
+            return_error_if_m(it, c.error, error_unknown_k, "Fail To Create Iterator");
+            places.dispatch([&](auto const& places) {
+                read_sorted(db, it, places, {order, order + misses}, data_enumerator, c.error);
+            });
+            return_if_error_m(c.error);
+        }
+        if (!needs_export) {
+            offs[places.count] = contents.size();
+            return;
+        }
+        if (in_order) {
+            offs[places.count] = contents.size();
             *c.values = reinterpret_cast<ustore_bytes_ptr_t>(contents.begin());
+            return;
+        }
+
+        // 3. Restore the original order of values on the exported tape
+        std::size_t total_length = 0;
+        for (std::size_t i = 0; i != places.count; ++i)
+            total_length += presences[i] ? lens[i] : 0;
+        uninitialized_array_gt<byte_t> reordered(arena);
+        reordered.reserve(total_length, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i) {
+            ustore_length_t const offset = offs[i];
+            offs[i] = reordered.size();
+            if (presences[i])
+                reordered.insert(reordered.size(), contents.begin() + offset, contents.begin() + offset + lens[i], c.error);
+        }
+        offs[places.count] = reordered.size();
+        *c.values = reinterpret_cast<ustore_bytes_ptr_t>(reordered.begin());
     }
     catch (...) {
         *c.error = "Read Failure";
@@ -408,13 +778,13 @@ void ustore_read(ustore_read_t* c_ptr) {
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::scan_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
-    level_snapshot_t& snap = *reinterpret_cast<level_snapshot_t*>(c.snapshot);
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
     scans_arg_t scans {{}, start_keys, limits, c.tasks_count};
@@ -431,31 +801,35 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Values are copied while the keys are visited
+    bool const export_values = c.values;
+    growing_tape_t tape(arena);
+    if (export_values) {
+        tape.reserve(total_keys, c.error);
+        return_if_error_m(c.error);
+    }
+
     // 2. Fetch the data
     leveldb::ReadOptions options;
     options.fill_cache = false;
-    if (c.snapshot) {
-        auto it = db.snapshots.find(c.snapshot);
-        return_error_if_m(it != db.snapshots.end(), c.error, args_wrong_k, "The snapshot does'nt exist!");
-        options.snapshot = snap.snapshot;
-    }
+    level_snapshot_t* snap = read_snapshot(db, c.snapshot, options, c.error);
+    return_if_error_m(c.error);
 
-    level_iter_uptr_t it;
-    try {
-        it = level_iter_uptr_t(db.native->NewIterator(options));
-    }
-    catch (...) {
-        *c.error = "Fail To Create Iterator";
-        return;
-    }
+    level_iterator_lease_t it(db, snap, options);
+    return_error_if_m(it, c.error, error_unknown_k, "Fail To Create Iterator");
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         scan_t task = scans[i];
-        it->Seek(to_slice(task.min_key));
+        it->Seek(to_slice(db.encode(task.min_key)));
         offsets[i] = keys_output - *c.keys;
 
         ustore_size_t j = 0;
         while (it->Valid() && j != task.limit) {
-            std::memcpy(keys_output, it->key().data(), sizeof(ustore_key_t));
+            *keys_output = db.decode(it->key());
+            if (export_values) {
+                auto value = it->value();
+                tape.push_back(value_view_t {reinterpret_cast<byte_t const*>(value.data()), value.size()}, c.error);
+                return_if_error_m(c.error);
+            }
             ++keys_output;
             ++j;
             it->Next();
@@ -465,11 +839,21 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     }
 
     offsets[scans.size()] = keys_output - *c.keys;
+
+    // 3. Export the values
+    if (export_values) {
+        *c.values = (ustore_bytes_ptr_t)tape.contents().begin().get();
+        if (c.values_offsets)
+            *c.values_offsets = tape.offsets().begin().get();
+        if (c.values_lengths)
+            *c.values_lengths = tape.lengths().begin().get();
+    }
 }
 
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::sample_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -478,7 +862,6 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     return_if_error_m(c.error);
 
     level_db_t& db = *reinterpret_cast<level_db_t*>(c.db);
-    level_snapshot_t& snap = *reinterpret_cast<level_snapshot_t*>(c.snapshot);
     strided_iterator_gt<ustore_length_t const> lens {c.count_limits, c.count_limits_stride};
     sample_args_t samples {{}, lens, c.tasks_count};
 
@@ -495,27 +878,23 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     // 2. Fetch the data
     leveldb::ReadOptions options;
     options.fill_cache = false;
-    if (c.snapshot) {
-        auto it = db.snapshots.find(c.snapshot);
-        return_error_if_m(it != db.snapshots.end(), c.error, args_wrong_k, "The snapshot does'nt exist!");
-        options.snapshot = snap.snapshot;
-    }
+    level_snapshot_t* snap = read_snapshot(db, c.snapshot, options, c.error);
+    return_if_error_m(c.error);
+
+    // Every task restarts from the first key, so one iterator serves all of them
+    level_iterator_lease_t it(db, snap, options);
+    return_error_if_m(it, c.error, error_unknown_k, "Fail To Create Iterator");
 
     for (std::size_t task_idx = 0; task_idx != samples.count; ++task_idx) {
         sample_arg_t task = samples[task_idx];
         offsets[task_idx] = keys_output - *c.keys;
 
-        level_iter_uptr_t it;
-        safe_section("Creating a LevelDB iterator", c.error, [&] {
-            it = level_iter_uptr_t(db.native->NewIterator(options));
-        });
-        return_if_error_m(c.error);
-
         ptr_range_gt<ustore_key_t> sampled_keys(keys_output, task.limit);
-        reservoir_sample_iterator(it, sampled_keys, c.error);
+        std::size_t const sampled = reservoir_sample_iterator(it, sampled_keys, db.key_encoding, c.error);
+        return_if_error_m(c.error);
 
-        counts[task_idx] = task.limit;
-        keys_output += task.limit;
+        counts[task_idx] = static_cast<ustore_length_t>(sampled);
+        keys_output += sampled;
     }
     offsets[samples.count] = keys_output - *c.keys;
 }
@@ -523,6 +902,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::measure_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -540,8 +920,19 @@ void ustore_measure(ustore_measure_t* c_ptr) {
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
     uint64_t approximate_size = 0;
-    std::optional<std::string> memory_usage;
-    level_status_t status;
+    uint64_t memory_usage = 0;
+
+    // The memory usage is shared by all ranges, so it's read once per call
+    std::string memory_usage_property;
+    if (db.native->GetProperty("leveldb.approximate-memory-usage", &memory_usage_property)) {
+        try {
+            memory_usage = std::stoull(memory_usage_property);
+        }
+        catch (...) {
+            *c.error = "Property Read Failure";
+            return;
+        }
+    }
 
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         min_cardinalities[i] = static_cast<ustore_size_t>(0);
@@ -549,21 +940,110 @@ void ustore_measure(ustore_measure_t* c_ptr) {
         min_value_bytes[i] = static_cast<ustore_size_t>(0);
         max_value_bytes[i] = static_cast<ustore_size_t>(0);
 
-        ustore_key_t const min_key = start_keys[i];
-        ustore_key_t const max_key = end_keys[i];
+        encoded_key_t const min_key = db.encode(start_keys[i]);
+        encoded_key_t const max_key = db.encode(end_keys[i]);
         leveldb::Range range(to_slice(min_key), to_slice(max_key));
-        try {
-            db.native->GetApproximateSizes(&range, 1, &approximate_size);
-            min_space_usages[i] = approximate_size;
+        db.native->GetApproximateSizes(&range, 1, &approximate_size);
+        min_space_usages[i] = approximate_size;
+        max_space_usages[i] = memory_usage;
+    }
+}
+
+/*********************************************************/
+/*****************   Native String Keys   ****************/
+/*********************************************************/
 
-            memory_usage = "0";
-            db.native->GetProperty("leveldb.approximate-memory-usage", &memory_usage.value());
-            max_space_usages[i] = std::stoi(memory_usage.value());
+/**
+ * @brief With the "string_keys" option, the main collection gets native string keys for the paths,
+ * which are kept in a separate database, as the integer keys use the same bytewise order.
+ * Its own snapshots aren't tracked, so the snapshots of the integer keys don't cover it.
+ */
+bool unum::ustore::has_string_keys(ustore_database_t c_db, ustore_collection_t collection) noexcept {
+    level_db_t& db = *reinterpret_cast<level_db_t*>(c_db);
+    return db.strings && collection == ustore_collection_main_k;
+}
+
+void unum::ustore::read_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_snapshot_t c_snapshot,
+    strided_iterator_gt<ustore_collection_t const>,
+    contents_arg_t const& keys,
+    ustore_options_t,
+    growing_tape_t& values,
+    ustore_error_t* c_error) noexcept {
+
+    level_db_t& db = *reinterpret_cast<level_db_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, args_wrong_k, "Current engine does not support transactions!");
+    return_error_if_m(!c_snapshot, c_error, missing_feature_k, "LevelDB snapshots don't cover string keys!");
+
+    safe_section("Reading strings from LevelDB", c_error, [&] {
+        std::string value;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            level_status_t status = db.strings->Get(leveldb::ReadOptions(), to_slice(keys[i]), &value);
+            if (!status.IsNotFound() && export_error(status, c_error))
+                return;
+            values.push_back(status.IsNotFound() ? value_view_t {} : value_view_t {std::string_view(value)}, c_error);
+            return_if_error_m(c_error);
         }
-        catch (...) {
-            *c.error = "Property Read Failure";
+    });
+}
+
+void unum::ustore::write_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    strided_iterator_gt<ustore_collection_t const>,
+    contents_arg_t const& keys,
+    contents_arg_t const& values,
+    ustore_options_t c_options,
+    ustore_error_t* c_error) noexcept {
+
+    level_db_t& db = *reinterpret_cast<level_db_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, args_wrong_k, "Current engine does not support transactions!");
+
+    leveldb::WriteOptions options;
+    options.sync = c_options & ustore_option_write_flush_k;
+
+    safe_section("Writing strings into LevelDB", c_error, [&] {
+        leveldb::WriteBatch batch;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            value_view_t value = values[i];
+            if (value)
+                batch.Put(to_slice(keys[i]), to_slice(value));
+            else
+                batch.Delete(to_slice(keys[i]));
         }
-    }
+        export_error(db.strings->Write(options, &batch), c_error);
+    });
+}
+
+void unum::ustore::scan_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_collection_t,
+    std::string_view start_key,
+    ustore_length_t count_limit,
+    ustore_options_t,
+    growing_tape_t& keys,
+    ustore_error_t* c_error) noexcept {
+
+    level_db_t& db = *reinterpret_cast<level_db_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, args_wrong_k, "Current engine does not support transactions!");
+
+    leveldb::ReadOptions options;
+    options.fill_cache = false;
+
+    safe_section("Scanning strings in LevelDB", c_error, [&] {
+        level_iter_uptr_t it {db.strings->NewIterator(options)};
+        ustore_length_t count = 0;
+        for (it->Seek(leveldb::Slice(start_key.data(), start_key.size())); it->Valid() && count != count_limit;
+             it->Next(), ++count) {
+            auto key = it->key();
+            keys.push_back(value_view_t {reinterpret_cast<byte_t const*>(key.data()), key.size()}, c_error);
+            return_if_error_m(c_error);
+        }
+        export_error(it->status(), c_error);
+    });
 }
 
 /*********************************************************/
@@ -606,6 +1086,8 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     options.sync = true;
     level_status_t status = db.native->Write(options, &batch);
     export_error(status, c.error);
+    if (db.read_cache)
+        db.read_cache->clear();
 }
 
 void ustore_collection_list(ustore_collection_list_t* c_ptr) {
@@ -629,7 +1111,10 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
         return;
 
     *c.response = NULL;
-    *c.error = "Controls aren't supported in this implementation!";
+    if (control_metrics(c))
+        return;
+
+    *c.error = "Only \"metrics\" controls are supported in this implementation!";
 }
 
 /*********************************************************/
@@ -662,7 +1147,15 @@ void ustore_transaction_free(ustore_transaction_t) {
 void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
+    threads_registry_t::global().forget(c_db);
     level_db_t* db = reinterpret_cast<level_db_t*>(c_db);
+    // Pooled iterators must be destroyed before the DB itself
+    for (auto& [id, snap] : db->snapshots) {
+        for (auto& pool : snap->iterators)
+            pool.clear();
+        db->native->ReleaseSnapshot(snap->snapshot);
+        delete snap;
+    }
     delete db;
 }
 
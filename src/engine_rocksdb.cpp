@@ -18,10 +18,20 @@
  */
 
 #include <mutex>
+#include <atomic>  // `std::atomic`
+#include <cstring> // `std::memcpy`
+#include <numeric> // `std::iota`
 #include <fstream>
 #include <filesystem>
 
 #include <rocksdb/db.h>
+#include <rocksdb/cache.h>
+#include <rocksdb/comparator.h>
+#include <rocksdb/table.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/utilities/options_util.h>
 #include <rocksdb/utilities/transaction.h>
 #include <rocksdb/utilities/optimistic_transaction_db.h>
@@ -31,6 +41,15 @@
 #include "helpers/linked_array.hpp"   // `uninitialized_array_gt`
 #include "helpers/full_scan.hpp"      // `reservoir_sample_iterator`
 #include "helpers/config_loader.hpp"  // `config_loader_t`
+#include "helpers/threads.hpp"        // `threads_registry_t`
+#include "helpers/merge.hpp"          // `write_spliced`
+#include "helpers/metrics.hpp"        // `operation_timer_t`
+#include "helpers/read_cache.hpp"     // `read_cache_t`
+#include "helpers/key_encoding.hpp"   // `encode_key`
+#include "helpers/expiration.hpp"     // `stamp_deadlines`
+#include "helpers/rocksdb.hpp"        // `merge_operator_t`
+#include "helpers/string_keys.hpp"    // `string_keyed_gt`
+#include "helpers/algorithm.hpp"      // `deduplicate_gather_join_scatter`
 
 namespace stdfs = std::filesystem;
 using namespace unum::ustore;
@@ -53,6 +72,10 @@ using rocks_value_t = rocksdb::PinnableSlice;
 using rocks_txn_t = rocksdb::Transaction;
 using rocks_collection_t = rocksdb::ColumnFamilyHandle;
 
+/**
+ * @brief Orders the keys of databases, created before the `key_encoding_t::ordered_k`,
+ * which are stored in the native byte order. The newer ones use the built-in bytewise comparator.
+ */
 struct key_comparator_t final : public rocksdb::Comparator {
     inline int Compare(rocksdb::Slice const& a, rocksdb::Slice const& b) const override {
         auto ai = *reinterpret_cast<ustore_key_t const*>(a.data());
@@ -83,24 +106,46 @@ struct rocks_db_t {
     std::unordered_map<ustore_size_t, rocks_snapshot_t*> snapshots;
     std::unique_ptr<rocks_native_t> native;
     std::mutex mutex;
+
+    /** @brief Shared between all the collections, if configured. */
+    std::shared_ptr<rocksdb::Cache> block_cache;
+    std::shared_ptr<rocksdb::Statistics> statistics;
+    /** @brief Applied to the newly created collections. */
+    rocksdb::ColumnFamilyOptions collection_options;
+    /** @brief Only makes a difference, if RocksDB was compiled with io_uring. */
+    bool async_io = true;
+    /** @brief Optional cache of hot values, that lookups outside of transactions and snapshots go through. */
+    std::unique_ptr<read_cache_t> read_cache;
+    /** @brief Databases, created with the custom `key_comparator_t`, keep using the native encoding. */
+    key_encoding_t key_encoding = key_encoding_t::ordered_k;
+
+    encoded_key_t encode(ustore_key_t key) const noexcept { return encode_key(key, key_encoding); }
+    ustore_key_t decode(rocksdb::Slice const& key) const noexcept { return decode_key(key.data(), key_encoding); }
+
+    /** @brief TTLs of collections by their column family IDs, also persisted with `save_ttls`. */
+    ttls_gt<std::uint32_t> ttls;
+    /** @brief Column families with native string keys, also persisted with `save_string_keyed`. */
+    string_keyed_gt<std::uint32_t> string_keyed;
+
+    /** @brief Where the files for bulk ingestion are staged. */
+    stdfs::path directory;
+    std::atomic<std::size_t> staged_files {0};
 };
 
-inline rocksdb::Slice to_slice(ustore_key_t const& key) noexcept {
-    return {reinterpret_cast<char const*>(&key), sizeof(ustore_key_t)};
+/**
+ * @brief Smaller bulk writes go through the regular path, to avoid flooding
+ * the first level of the LSM tree with tiny files.
+ */
+constexpr std::size_t bulk_write_min_entries_k = 16 * 1024;
+
+inline rocksdb::Slice to_slice(encoded_key_t const& key) noexcept {
+    return {key.data(), key.size()};
 }
 
 inline rocksdb::Slice to_slice(value_view_t value) noexcept {
     return {reinterpret_cast<const char*>(value.begin()), value.size()};
 }
 
-inline std::unique_ptr<rocks_value_t> make_value(ustore_error_t* c_error) noexcept {
-    std::unique_ptr<rocks_value_t> value_uptr;
-    safe_section("Allocating RocksDB-compatible value buffer", c_error, [&] {
-        value_uptr = std::make_unique<rocks_value_t>();
-    });
-    return value_uptr;
-}
-
 bool export_error(rocks_status_t const& status, ustore_error_t* c_error) {
     if (status.ok())
         return false;
@@ -121,6 +166,318 @@ rocks_collection_t* rocks_collection(rocks_db_t& db, ustore_collection_t collect
                                                   : reinterpret_cast<rocks_collection_t*>(collection);
 }
 
+/**
+ * @brief Drops the written keys from the read cache, once they reach the engine.
+ * Cached entries are addressed by column family IDs, which transactions also report.
+ */
+void invalidate_cached(rocks_db_t& db, places_arg_t const& places) noexcept {
+    if (!db.read_cache)
+        return;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        place_t place = places[i];
+        db.read_cache->invalidate(rocks_collection(db, place.collection)->GetID(), place.key);
+    }
+}
+
+/*********************************************************/
+/*****************	 Table Configuration  ****************/
+/*********************************************************/
+
+/**
+ * @brief Creates the block cache, shared by all collections, from a config like:
+ * `{"type": "hyper_clock", "capacity": "8GB", "estimated_entry_charge": "16KB", "num_shard_bits": -1}`.
+ * The "lru" type additionally accepts a "high_pri_pool_ratio" for index and filter blocks.
+ */
+std::shared_ptr<rocksdb::Cache> make_block_cache(json_t const& j_cache,
+                                                 std::size_t block_size,
+                                                 ustore_error_t* c_error) noexcept(false) {
+    std::size_t capacity = 0;
+    std::size_t estimated_entry_charge = block_size;
+    if (!config_loader_t::parse_volume(j_cache, "capacity", capacity) ||
+        !config_loader_t::parse_volume(j_cache, "estimated_entry_charge", estimated_entry_charge)) {
+        log_error_m(c_error, args_wrong_k, "Block cache sizes must be numbers or strings, like \"8GB\"");
+        return {};
+    }
+    if (!capacity) {
+        log_error_m(c_error, args_wrong_k, "Block cache capacity must be positive");
+        return {};
+    }
+
+    std::string type = j_cache.value("type", std::string("lru"));
+    int num_shard_bits = j_cache.value("num_shard_bits", -1);
+    if (type == "hyper_clock")
+        return rocksdb::HyperClockCacheOptions(capacity, estimated_entry_charge, num_shard_bits).MakeSharedCache();
+    if (type == "lru")
+        return rocksdb::NewLRUCache(capacity, num_shard_bits, false, j_cache.value("high_pri_pool_ratio", 0.5));
+
+    log_error_m(c_error, args_wrong_k, "Block cache type must be \"lru\" or \"hyper_clock\"");
+    return {};
+}
+
+/**
+ * @brief Parses the "TableOptions" section of the engine config into `BlockBasedTableOptions`.
+ * Filters are configured with `{"filter_policy": {"type": "bloom", "bits_per_key": 10}}`,
+ * where the type can also be "ribbon". With "partition_filters" both the filter and
+ * index blocks are partitioned, so only their top-level blocks have to stay in memory.
+ */
+void load_table_options(json_t const& j_table,
+                        rocks_db_t& db,
+                        rocksdb::BlockBasedTableOptions& table_options,
+                        ustore_error_t* c_error) noexcept(false) {
+
+    std::size_t block_size = table_options.block_size;
+    std::size_t metadata_block_size = table_options.metadata_block_size;
+    return_error_if_m(config_loader_t::parse_volume(j_table, "block_size", block_size) &&
+                          config_loader_t::parse_volume(j_table, "metadata_block_size", metadata_block_size),
+                      c_error,
+                      args_wrong_k,
+                      "Block sizes must be numbers or strings, like \"16KB\"");
+    table_options.block_size = block_size;
+    table_options.metadata_block_size = metadata_block_size;
+
+    if (j_table.contains("block_cache")) {
+        db.block_cache = make_block_cache(j_table["block_cache"], block_size, c_error);
+        return_if_error_m(c_error);
+        table_options.block_cache = db.block_cache;
+    }
+
+    if (j_table.contains("filter_policy")) {
+        auto const& j_filter = j_table["filter_policy"];
+        std::string type = j_filter.value("type", std::string("bloom"));
+        double bits_per_key = j_filter.value("bits_per_key", 10.0);
+        if (type == "bloom")
+            table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(bits_per_key));
+        else if (type == "ribbon")
+            table_options.filter_policy.reset(rocksdb::NewRibbonFilterPolicy(bits_per_key));
+        else {
+            log_error_m(c_error, args_wrong_k, "Filter policy must be \"bloom\" or \"ribbon\"");
+            return;
+        }
+    }
+
+    if (j_table.value("partition_filters", false)) {
+        return_error_if_m(table_options.filter_policy,
+                          c_error,
+                          args_combo_k,
+                          "Partitioned filters require a filter policy");
+        table_options.partition_filters = true;
+        table_options.index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+    }
+
+    table_options.cache_index_and_filter_blocks =
+        j_table.value("cache_index_and_filter_blocks", table_options.cache_index_and_filter_blocks);
+    table_options.cache_index_and_filter_blocks_with_high_priority =
+        j_table.value("cache_index_and_filter_blocks_with_high_priority",
+                      table_options.cache_index_and_filter_blocks_with_high_priority);
+    table_options.pin_l0_filter_and_index_blocks_in_cache =
+        j_table.value("pin_l0_filter_and_index_blocks_in_cache", table_options.pin_l0_filter_and_index_blocks_in_cache);
+    table_options.pin_top_level_index_and_filter =
+        j_table.value("pin_top_level_index_and_filter", table_options.pin_top_level_index_and_filter);
+    table_options.whole_key_filtering = j_table.value("whole_key_filtering", table_options.whole_key_filtering);
+}
+
+/**
+ * @brief Exports a string into the `arena` as the response of `ustore_database_control`.
+ */
+void export_response(std::string const& str, ustore_database_control_t& c) noexcept {
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto response = arena.alloc<char>(str.size() + 1, c.error).begin();
+    return_if_error_m(c.error);
+    std::memcpy(response, str.c_str(), str.size() + 1);
+    *c.response = response;
+}
+
+/**
+ * @brief Size of the write batches, that copy the contents of a database during migrations.
+ */
+constexpr std::size_t migration_batch_bytes_k = 16 * 1024 * 1024;
+
+/**
+ * @brief Copies every collection of a database with the `key_encoding_t::native_k` into a new one
+ * in the `target` directory, re-encoding the integer keys, to be opened with the bytewise comparator.
+ * The `columns` must match the `column_descriptors`, that the `legacy` database was opened with.
+ */
+rocks_status_t migrate_keys( //
+    rocks_native_t& legacy,
+    std::vector<rocks_collection_t*> const& columns,
+    std::set<std::string> const& string_keyed,
+    stdfs::path const& target,
+    rocksdb::Options options,
+    std::vector<rocksdb::ColumnFamilyDescriptor> column_descriptors) {
+
+    options.comparator = rocksdb::BytewiseComparator();
+    options.create_if_missing = true;
+    options.error_if_exists = true;
+    options.create_missing_column_families = true;
+    for (auto& column_descriptor : column_descriptors)
+        column_descriptor.options.comparator = rocksdb::BytewiseComparator();
+
+    rocksdb::DB* target_db = nullptr;
+    std::vector<rocks_collection_t*> target_columns;
+    rocks_status_t status = rocksdb::DB::Open(options, target.string(), column_descriptors, &target_columns, &target_db);
+    if (!status.ok())
+        return status;
+
+    // Merge operands are resolved by the iterators, and expiring values keep their deadlines
+    rocksdb::WriteBatch batch;
+    for (std::size_t i = 0; status.ok() && i != columns.size(); ++i) {
+        bool const string_keys = string_keyed.count(columns[i]->GetName());
+        auto it = std::unique_ptr<rocksdb::Iterator>(legacy.NewIterator(rocksdb::ReadOptions(), columns[i]));
+        for (it->SeekToFirst(); status.ok() && it->Valid(); it->Next()) {
+            if (string_keys)
+                status = batch.Put(target_columns[i], it->key(), it->value());
+            else
+                status = batch.Put(target_columns[i], to_slice(migrate_key(it->key().data())), it->value());
+            if (!status.ok() || batch.GetDataSize() < migration_batch_bytes_k)
+                continue;
+            status = target_db->Write(rocksdb::WriteOptions(), &batch);
+            batch.Clear();
+        }
+        if (status.ok())
+            status = it->status();
+        if (status.ok())
+            status = target_db->Write(rocksdb::WriteOptions(), &batch);
+        batch.Clear();
+    }
+    if (status.ok())
+        status = target_db->Flush(rocksdb::FlushOptions(), target_columns);
+
+    for (rocks_collection_t* column : target_columns)
+        target_db->DestroyColumnFamilyHandle(column);
+    delete target_db;
+    return status;
+}
+
+/*********************************************************/
+/*****************   Native String Keys   ****************/
+/*********************************************************/
+
+inline value_view_t string_key_view(rocksdb::Slice const& slice) noexcept {
+    return {reinterpret_cast<byte_t const*>(slice.data()), slice.size()};
+}
+
+bool unum::ustore::has_string_keys(ustore_database_t c_db, ustore_collection_t collection) noexcept {
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
+    return db.string_keyed.any() && db.string_keyed.contains(rocks_collection(db, collection)->GetID());
+}
+
+void unum::ustore::read_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_snapshot_t c_snapshot,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    ustore_options_t c_options,
+    growing_tape_t& values,
+    ustore_error_t* c_error) noexcept {
+
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
+    rocks_txn_t* txn_ptr = reinterpret_cast<rocks_txn_t*>(c_transaction);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c_snapshot);
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+
+    rocksdb::ReadOptions options;
+    if (snap_ptr) {
+        auto it = db.snapshots.find(reinterpret_cast<std::size_t>(snap_ptr));
+        return_error_if_m(it != db.snapshots.end(), c_error, args_wrong_k, "The snapshot does'nt exist!");
+        options.snapshot = snap_ptr->snapshot;
+    }
+
+    safe_section("Reading strings from RocksDB", c_error, [&] {
+        rocks_value_t value;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            auto collection = rocks_collection(db, collections ? collections[i] : ustore_collection_main_k);
+            auto key = to_slice(keys[i]);
+            value.Reset();
+            rocks_status_t status = //
+                txn_ptr             //
+                    ? watch         //
+                          ? txn_ptr->GetForUpdate(options, collection, key, &value)
+                          : txn_ptr->Get(options, collection, key, &value)
+                    : db.native->Get(options, collection, key, &value);
+            if (!status.IsNotFound() && export_error(status, c_error))
+                return;
+            values.push_back(status.IsNotFound() ? value_view_t {} : string_key_view(value), c_error);
+            return_if_error_m(c_error);
+        }
+    });
+}
+
+void unum::ustore::write_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    contents_arg_t const& values,
+    ustore_options_t c_options,
+    ustore_error_t* c_error) noexcept {
+
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
+    rocks_txn_t* txn_ptr = reinterpret_cast<rocks_txn_t*>(c_transaction);
+    bool const safe = c_options & ustore_option_write_flush_k;
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+
+    rocksdb::WriteOptions options;
+    options.sync = safe;
+    options.disableWAL = !safe;
+
+    safe_section("Writing strings into RocksDB", c_error, [&] {
+        rocksdb::WriteBatch batch;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            auto collection = rocks_collection(db, collections ? collections[i] : ustore_collection_main_k);
+            auto key = to_slice(keys[i]);
+            value_view_t value = values[i];
+            rocks_status_t status;
+            if (!txn_ptr)
+                status = !value ? batch.Delete(collection, key) : batch.Put(collection, key, to_slice(value));
+            else if (!value)
+                status = watch ? txn_ptr->Delete(collection, key) : txn_ptr->DeleteUntracked(collection, key);
+            else
+                status = watch ? txn_ptr->Put(collection, key, to_slice(value))
+                               : txn_ptr->PutUntracked(collection, key, to_slice(value));
+            if (export_error(status, c_error))
+                return;
+        }
+        if (!txn_ptr)
+            export_error(db.native->Write(options, &batch), c_error);
+    });
+}
+
+void unum::ustore::scan_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_collection_t c_collection,
+    std::string_view start_key,
+    ustore_length_t count_limit,
+    ustore_options_t,
+    growing_tape_t& keys,
+    ustore_error_t* c_error) noexcept {
+
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
+    rocks_txn_t* txn_ptr = reinterpret_cast<rocks_txn_t*>(c_transaction);
+
+    // Configured prefix extractors apply to these collections too, but the seeks must ignore them
+    rocksdb::ReadOptions options;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+    options.async_io = db.async_io;
+
+    safe_section("Scanning strings in RocksDB", c_error, [&] {
+        auto collection = rocks_collection(db, c_collection);
+        auto it = txn_ptr //
+                      ? std::unique_ptr<rocksdb::Iterator>(txn_ptr->GetIterator(options, collection))
+                      : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
+        ustore_length_t count = 0;
+        for (it->Seek(rocksdb::Slice(start_key.data(), start_key.size())); it->Valid() && count != count_limit;
+             it->Next(), ++count) {
+            keys.push_back(string_key_view(it->key()), c_error);
+            return_if_error_m(c_error);
+        }
+        export_error(it->status(), c_error);
+    });
+}
+
 /*********************************************************/
 /*****************	    C Interface 	  ****************/
 /*********************************************************/
@@ -153,6 +510,9 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         rocksdb::Options options;
         options.compression = rocksdb::kNoCompression;
         auto cf_options = rocksdb::ColumnFamilyOptions();
+        bool configured_collections = false;
+        bool migrate = false;
+        bool keep_legacy = false;
         std::vector<rocksdb::ColumnFamilyDescriptor> column_descriptors;
         return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
 
@@ -180,6 +540,8 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
                     options.max_open_files = j_db["max_open_files"];
                 if (j_db.contains("max_file_opening_threads"))
                     options.max_file_opening_threads = j_db["max_file_opening_threads"];
+                if (j_db.value("statistics", false))
+                    db_ptr->statistics = rocksdb::CreateDBStatistics();
             }
 
             if (js.contains("CFOptions")) {
@@ -205,6 +567,50 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
                         log_warning_m(
                             "We discourage general-purpose compression in favour "
                             "of modality-aware compression in UStore\n");
+                if (j_cf.contains("optimize_filters_for_hits"))
+                    cf_options.optimize_filters_for_hits = j_cf["optimize_filters_for_hits"];
+                // Keys are encoded in big-endian, so fixed-size prefixes group the numerically close ones
+                if (j_cf.contains("prefix_extractor")) {
+                    status = rocksdb::SliceTransform::CreateFromString(rocksdb::ConfigOptions(),
+                                                                       j_cf["prefix_extractor"].get<std::string>(),
+                                                                       &cf_options.prefix_extractor);
+                    return_error_if_m(status.ok(), c.error, args_wrong_k, "Unknown prefix extractor");
+                    configured_collections = true;
+                }
+                configured_collections |= j_cf.contains("optimize_filters_for_hits");
+            }
+
+            if (js.contains("ReadOptions"))
+                db_ptr->async_io = js["ReadOptions"].value("async_io", db_ptr->async_io);
+
+            // Databases with the legacy key encoding are rewritten on open, if requested,
+            // or new ones are created with it, to stay readable by the older releases
+            if (js.contains("KeyEncoding")) {
+                migrate = js["KeyEncoding"].value("migrate", false);
+                keep_legacy = js["KeyEncoding"].value("legacy", false);
+                return_error_if_m(!migrate || !keep_legacy,
+                                  c.error,
+                                  args_combo_k,
+                                  "Can't both migrate and keep the legacy key encoding");
+            }
+
+            // Unlike the block cache, holds the exact values of hot keys, skipping the lookups in the LSM tree
+            if (js.contains("ReadCache")) {
+                std::size_t capacity = 0;
+                return_error_if_m(config_loader_t::parse_volume(js["ReadCache"], "capacity", capacity),
+                                  c.error,
+                                  args_wrong_k,
+                                  "Read cache capacity must be a number or a string, like \"1GB\"");
+                if (capacity)
+                    db_ptr->read_cache = std::make_unique<read_cache_t>(capacity);
+            }
+
+            if (js.contains("TableOptions")) {
+                rocksdb::BlockBasedTableOptions table_options;
+                load_table_options(js["TableOptions"], *db_ptr, table_options, c.error);
+                return_if_error_m(c.error);
+                cf_options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+                configured_collections = true;
             }
         }
 
@@ -212,16 +618,37 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         status = rocksdb::LoadLatestOptions(config_options, root, &options, &column_descriptors);
         return_error_if_m(status.ok() || status.IsNotFound(), c.error, error_unknown_k, "Recovering RocksDB state");
 
-        cf_options.comparator = &key_comparator_k;
+        cf_options.comparator = rocksdb::BytewiseComparator();
+        cf_options.merge_operator = std::make_shared<merge_operator_t>();
+        db_ptr->collection_options = cf_options;
         if (column_descriptors.empty())
             column_descriptors.push_back({rocksdb::kDefaultColumnFamilyName, std::move(cf_options)});
         else {
-            for (auto& column_descriptor : column_descriptors)
-                column_descriptor.options.comparator = &key_comparator_k;
+            // Caches aren't persisted in the options files, so the configured tables override the recovered
+            for (auto& column_descriptor : column_descriptors) {
+                column_descriptor.options.comparator = rocksdb::BytewiseComparator();
+                column_descriptor.options.merge_operator = cf_options.merge_operator;
+                if (!configured_collections)
+                    continue;
+                column_descriptor.options.table_factory = cf_options.table_factory;
+                column_descriptor.options.prefix_extractor = cf_options.prefix_extractor;
+                column_descriptor.options.optimize_filters_for_hits = cf_options.optimize_filters_for_hits;
+            }
+        }
+
+        // Compaction filters aren't restored from the options files, so they are reinstalled for TTLs
+        auto ttls = load_ttls(root);
+        auto string_keyed = load_string_keyed(root);
+        for (auto& column_descriptor : column_descriptors) {
+            auto ttl_it = ttls.find(column_descriptor.name);
+            if (ttl_it == ttls.end())
+                continue;
+            expire_on_compaction(column_descriptor.options, ttl_it->second);
         }
 
         options.create_if_missing = true;
-        options.comparator = &key_comparator_k;
+        options.comparator = rocksdb::BytewiseComparator();
+        options.statistics = db_ptr->statistics;
 
         // Storage paths
         for (auto const& disk : config.data_directories)
@@ -229,10 +656,74 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
 
         rocks_native_t* native_db = nullptr;
         rocksdb::OptimisticTransactionDBOptions txn_options;
-        status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+        bool legacy = keep_legacy;
+        if (!legacy) {
+            status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+            legacy = status.IsInvalidArgument() && status.ToString().find(key_comparator_k.Name()) != std::string::npos;
+            if (legacy && !migrate)
+                log_warning_m("RocksDB in %s uses the legacy key encoding, migrate to avoid the custom comparator\n",
+                              root.c_str());
+        }
+
+        // Databases, created with the integer comparator, are opened in compatibility mode,
+        // unless the `KeyEncoding.migrate` option asks to rewrite them with the ordered encoding.
+        if (legacy) {
+            options.comparator = &key_comparator_k;
+            for (auto& column_descriptor : column_descriptors)
+                if (!string_keyed.count(column_descriptor.name))
+                    column_descriptor.options.comparator = &key_comparator_k;
+            db_ptr->columns.clear();
+            status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+        }
         return_error_if_m(status.ok(), c.error, error_unknown_k, "Opening RocksDB with options");
 
+        if (legacy && migrate) {
+            return_error_if_m(config.data_directories.empty(),
+                              c.error,
+                              args_wrong_k,
+                              "Can't migrate databases, spread across data directories");
+            key_migration_t migration(root);
+            return_error_if_m(!stdfs::exists(migration.backup),
+                              c.error,
+                              args_wrong_k,
+                              "Remove the backup of the previous migration first");
+            stdfs::remove_all(migration.staging);
+            log_warning_m("Migrating RocksDB in %s to the ordered key encoding\n", root.c_str());
+            status = migrate_keys(*native_db, db_ptr->columns, string_keyed, migration.staging, options, column_descriptors);
+            for (rocks_collection_t* column : db_ptr->columns)
+                native_db->DestroyColumnFamilyHandle(column);
+            db_ptr->columns.clear();
+            delete native_db;
+            native_db = nullptr;
+            return_error_if_m(status.ok(), c.error, error_unknown_k, "Migrating RocksDB keys");
+
+            for (stdfs::path const& path : {ttls_path(root), string_keyed_path(root)})
+                if (stdfs::exists(path))
+                    stdfs::copy_file(path, migration.staging / path.filename());
+            migration.commit();
+            log_warning_m("The legacy RocksDB is kept in %s, remove it once the migration is verified\n",
+                          migration.backup.c_str());
+
+            options.comparator = rocksdb::BytewiseComparator();
+            for (auto& column_descriptor : column_descriptors)
+                column_descriptor.options.comparator = rocksdb::BytewiseComparator();
+            status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+            return_error_if_m(status.ok(), c.error, error_unknown_k, "Opening migrated RocksDB");
+        }
+        else if (legacy) {
+            db_ptr->key_encoding = key_encoding_t::native_k;
+            db_ptr->collection_options.comparator = &key_comparator_k;
+        }
+
         db_ptr->native = std::unique_ptr<rocks_native_t>(native_db);
+        db_ptr->directory = root;
+        for (rocks_collection_t* column : db_ptr->columns) {
+            if (auto ttl_it = ttls.find(column->GetName()); ttl_it != ttls.end())
+                db_ptr->ttls.set(column->GetID(), ttl_it->second);
+            if (string_keyed.count(column->GetName()))
+                db_ptr->string_keyed.set(column->GetID(), true);
+        }
+        register_threads(db_ptr, config);
         *c.db = db_ptr;
     });
 }
@@ -316,6 +807,7 @@ void write_one( //
 
     bool const safe = c_options & ustore_option_write_flush_k;
     bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+    bool const merge = c_options & ustore_option_write_merge_k;
 
     rocksdb::WriteOptions options;
     options.sync = safe;
@@ -324,37 +816,43 @@ void write_one( //
     auto place = places[0];
     auto content = contents[0];
     auto collection = rocks_collection(db, place.collection);
-    auto key = to_slice(place.key);
+    auto encoded = db.encode(place.key);
+    auto key = to_slice(encoded);
     rocks_status_t status;
 
     if (txn_ptr)
-        status =        //
-            !content    //
-                ? watch //
-                      ? txn_ptr->Delete(collection, key)
-                      : txn_ptr->DeleteUntracked(collection, key)
-                : watch //
-                      ? txn_ptr->Put(collection, key, to_slice(content))
-                      : txn_ptr->PutUntracked(collection, key, to_slice(content));
+        status = !content ? watch //
+                                ? txn_ptr->Delete(collection, key)
+                                : txn_ptr->DeleteUntracked(collection, key)
+                 : merge  ? watch //
+                                ? txn_ptr->Merge(collection, key, to_slice(content))
+                                : txn_ptr->MergeUntracked(collection, key, to_slice(content))
+                 : watch //
+                     ? txn_ptr->Put(collection, key, to_slice(content))
+                     : txn_ptr->PutUntracked(collection, key, to_slice(content));
     else
-        status =     //
-            !content //
-                ? db.native->Delete(options, collection, key)
-                : db.native->Put(options, collection, key, to_slice(content));
+        status = !content ? db.native->Delete(options, collection, key)
+                 : merge  ? db.native->Merge(options, collection, key, to_slice(content))
+                          : db.native->Put(options, collection, key, to_slice(content));
 
     export_error(status, c_error);
 }
 
+/**
+ * @brief Writes a batch of entries, with the layout of `places` resolved by `places_arg_t::dispatch()`.
+ */
+template <typename places_at>
 void write_many( //
     rocks_db_t& db,
     rocks_txn_t* txn_ptr,
-    places_arg_t const& places,
+    places_at const& places,
     contents_arg_t const& contents,
     ustore_options_t const c_options,
     ustore_error_t* c_error) noexcept(false) {
 
     bool const safe = c_options & ustore_option_write_flush_k;
     bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+    bool const merge = c_options & ustore_option_write_merge_k;
 
     rocksdb::WriteOptions options;
     options.sync = safe;
@@ -365,15 +863,17 @@ void write_many( //
             auto place = places[i];
             auto content = contents[i];
             auto collection = rocks_collection(db, place.collection);
-            auto key = to_slice(place.key);
-            auto status =   //
-                !content    //
-                    ? watch //
-                          ? txn_ptr->Delete(collection, key)
-                          : txn_ptr->DeleteUntracked(collection, key)
-                    : watch //
-                          ? txn_ptr->Put(collection, key, to_slice(content))
-                          : txn_ptr->PutUntracked(collection, key, to_slice(content));
+            auto encoded = db.encode(place.key);
+            auto key = to_slice(encoded);
+            auto status = !content ? watch //
+                                         ? txn_ptr->Delete(collection, key)
+                                         : txn_ptr->DeleteUntracked(collection, key)
+                          : merge  ? watch //
+                                         ? txn_ptr->Merge(collection, key, to_slice(content))
+                                         : txn_ptr->MergeUntracked(collection, key, to_slice(content))
+                          : watch //
+                              ? txn_ptr->Put(collection, key, to_slice(content))
+                              : txn_ptr->PutUntracked(collection, key, to_slice(content));
             export_error(status, c_error);
             return_if_error_m(c_error);
         }
@@ -384,10 +884,11 @@ void write_many( //
             auto place = places[i];
             auto content = contents[i];
             auto collection = rocks_collection(db, place.collection);
-            auto key = to_slice(place.key);
-            auto status = !content //
-                              ? batch.Delete(collection, key)
-                              : batch.Put(collection, key, to_slice(content));
+            auto encoded = db.encode(place.key);
+            auto key = to_slice(encoded);
+            auto status = !content ? batch.Delete(collection, key)
+                          : merge  ? batch.Merge(collection, key, to_slice(content))
+                                   : batch.Put(collection, key, to_slice(content));
             export_error(status, c_error);
         }
 
@@ -396,13 +897,78 @@ void write_many( //
     }
 }
 
+/**
+ * @brief Sorts the entries of every collection into a standalone SST file and ingests it,
+ * moving the file into the LSM tree without passing through the WAL and the memtables.
+ * If a key is repeated, its last update is kept, matching the regular batched writes.
+ */
+void write_bulk( //
+    rocks_db_t& db,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_error_t* c_error) noexcept(false) {
+
+    std::vector<std::size_t> order(places.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) noexcept {
+        place_t place_a = places[a], place_b = places[b];
+        rocks_collection_t* col_a = rocks_collection(db, place_a.collection);
+        rocks_collection_t* col_b = rocks_collection(db, place_b.collection);
+        return col_a != col_b ? col_a < col_b : place_a.key < place_b.key;
+    });
+
+    rocksdb::IngestExternalFileOptions ingest_options;
+    ingest_options.move_files = true;
+    for (std::size_t run_begin = 0; run_begin != order.size();) {
+        rocks_collection_t* collection = rocks_collection(db, places[order[run_begin]].collection);
+        std::size_t run_end = run_begin + 1;
+        while (run_end != order.size() && rocks_collection(db, places[order[run_end]].collection) == collection)
+            ++run_end;
+
+        std::string path = (db.directory / ("bulk-" + std::to_string(db.staged_files++) + ".sst")).string();
+        rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), db.native->GetOptions(collection), collection);
+        rocks_status_t status = writer.Open(path);
+        for (std::size_t i = run_begin; i != run_end && status.ok(); ++i) {
+            place_t place = places[order[i]];
+            if (i + 1 != run_end && places[order[i + 1]].key == place.key)
+                continue;
+            auto content = contents[order[i]];
+            auto encoded = db.encode(place.key);
+            auto key = to_slice(encoded);
+            status = !content ? writer.Delete(key) : writer.Put(key, to_slice(content));
+        }
+        if (status.ok())
+            status = writer.Finish();
+        if (status.ok())
+            status = db.native->IngestExternalFile(collection, {path}, ingest_options);
+
+        if (!status.ok()) {
+            std::error_code ignored;
+            stdfs::remove(path, ignored);
+            export_error(status, c_error);
+            return;
+        }
+        run_begin = run_end;
+    }
+}
+
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    if (c.positions) {
+        // Positional writes come back here as merges of splice operands
+        linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+        return_if_error_m(c.error);
+        return write_spliced(c, arena);
+    }
+    operation_timer_t timer {operation_t::write_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
 
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
     rocks_txn_t& txn = *reinterpret_cast<rocks_txn_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
@@ -418,19 +984,56 @@ void ustore_write(ustore_write_t* c_ptr) {
     validate_write(c.transaction, places, contents, c.options, c.error);
     return_if_error_m(c.error);
 
+    // Values of collections with a TTL are stored with their deadlines appended
+    growing_tape_t stamped(arena);
+    ustore_bytes_cptr_t stamped_begin = nullptr;
+    if (db.ttls.any()) {
+        bool expiring = false;
+        for (std::size_t i = 0; i != places.size() && !expiring; ++i)
+            expiring = ttl_of(db, places[i].collection);
+        return_error_if_m(!expiring || !(c.options & ustore_option_write_merge_k),
+                          c.error,
+                          args_combo_k,
+                          "Can't merge into collections with a TTL");
+        if (expiring)
+            safe_section("Stamping deadlines", c.error, [&] {
+                auto ttl = [&](ustore_collection_t collection) noexcept {
+                    return ttl_of(db, collection);
+                };
+                stamp_deadlines(places, contents, ttl, stamped, stamped_begin, c.error);
+            });
+        return_if_error_m(c.error);
+    }
+
+    bool const bulk = (c.options & ustore_option_write_bulk_k) && c.tasks_count >= bulk_write_min_entries_k;
     safe_section("Writing into RocksDB", c.error, [&] {
-        auto func = c.tasks_count == 1 ? &write_one : &write_many;
-        func(db, &txn, places, contents, c.options, c.error);
+        if (bulk)
+            write_bulk(db, places, contents, c.error);
+        else if (c.tasks_count == 1)
+            write_one(db, &txn, places, contents, c.options, c.error);
+        else
+            places.dispatch([&](auto const& places) { //
+                write_many(db, &txn, places, contents, c.options, c.error);
+            });
+        // Transactional writes are invalidated on commit
+        if (!c.transaction)
+            invalidate_cached(db, places);
     });
 }
 
-template <typename value_enumerator_at>
+/**
+ * @brief Reads values into `PinnableSlice`s, that reference the block cache directly, when possible.
+ * Once all of them are fetched, their total size is reported to `reserve`, so that the
+ * `enumerator` can copy every value into the output tape exactly once, without regrowing it.
+ */
+template <typename reserve_at, typename value_enumerator_at>
 void read_one( //
     rocks_db_t& db,
     rocks_txn_t* txn_ptr,
     rocks_snapshot_t* snap_ptr,
     places_arg_t places,
     ustore_options_t const c_options,
+    reserve_at reserve,
     value_enumerator_at enumerator,
     ustore_error_t* c_error) noexcept(false) {
 
@@ -445,11 +1048,32 @@ void read_one( //
 
     place_t place = places[0];
     auto col = rocks_collection(db, place.collection);
-    auto key = to_slice(place.key);
-    auto value_uptr = make_value(c_error);
-    return_if_error_m(c_error);
+    auto encoded = db.encode(place.key);
+    auto key = to_slice(encoded);
+
+    // Expired values are reported missing, until a compaction drops them
+    std::uint64_t const ttl = ttl_of(db, place.collection);
+    deadline_t const now = ttl ? now_ms() : 0;
+    auto visible = [&](value_view_t stored) noexcept {
+        return ttl ? unexpired(stored, now) : stored;
+    };
+
+    read_cache_t* cache = !txn_ptr && !snap_ptr ? db.read_cache.get() : nullptr;
+    read_cache_t::tickets_t tickets;
+    if (cache) {
+        bool const hit = cache->find(col->GetID(), place.key, [&](value_view_t cached) {
+            cached = visible(cached);
+            reserve(cached.size());
+            if (!*c_error)
+                enumerator(0, cached);
+        });
+        read_cache_t::account(hit, !hit);
+        if (hit)
+            return;
+        tickets = cache->tickets();
+    }
 
-    rocks_value_t& value = *value_uptr.get();
+    rocks_value_t value;
     rocks_status_t status = //
         txn_ptr             //
             ? watch         //
@@ -461,52 +1085,181 @@ void read_one( //
             return;
         auto begin = reinterpret_cast<ustore_bytes_cptr_t>(value.data());
         auto length = static_cast<ustore_length_t>(value.size());
-        enumerator(0, value_view_t {begin, length});
+        if (cache)
+            cache->insert(col->GetID(), place.key, value_view_t {begin, length}, tickets);
+        value_view_t exported = visible(value_view_t {begin, length});
+        reserve(exported.size());
+        return_if_error_m(c_error);
+        enumerator(0, exported);
     }
     else
         enumerator(0, value_view_t {});
 }
 
-template <typename value_enumerator_at>
+/**
+ * @brief Constructs RocksDB objects in arena memory, destroying them when leaving the scope.
+ * Unlike `initialized_range_gt`, accepts types with constructors not marked `noexcept`.
+ */
+template <typename element_at>
+class arena_objects_gt {
+    element_at* begin_ = nullptr;
+    std::size_t count_ = 0;
+
+  public:
+    arena_objects_gt(linked_memory_lock_t& arena, std::size_t count, ustore_error_t* c_error) noexcept(false) {
+        begin_ = arena.alloc<element_at>(count, c_error).begin();
+        if (*c_error)
+            return;
+        std::uninitialized_default_construct_n(begin_, count);
+        count_ = count;
+    }
+    arena_objects_gt(arena_objects_gt const&) = delete;
+    ~arena_objects_gt() noexcept { std::destroy_n(begin_, count_); }
+    element_at& operator[](std::size_t i) noexcept { return begin_[i]; }
+    element_at* begin() noexcept { return begin_; }
+};
+
+/**
+ * @brief Outside of transactions, uses the batched `MultiGet`, that pins the values.
+ * Requests are sorted by collection and key, so that every sorted run is passed to
+ * a separate `MultiGet` with `sorted_input`. It lets RocksDB coalesce lookups into
+ * the same blocks and, with `async_io`, read different files in parallel.
+ * Transactions only expose pinning in point lookups, which their `MultiGet*` loop over anyways.
+ * @see `read_one`.
+ */
+template <typename places_at, typename reserve_at, typename value_enumerator_at>
 void read_many( //
     rocks_db_t& db,
     rocks_txn_t* txn_ptr,
     rocks_snapshot_t* snap_ptr,
-    places_arg_t places,
+    places_at const& places,
     ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    reserve_at reserve,
     value_enumerator_at enumerator,
     ustore_error_t* c_error) noexcept(false) {
 
     rocksdb::ReadOptions options;
+    options.async_io = db.async_io;
     if (snap_ptr) {
         auto it = db.snapshots.find(reinterpret_cast<std::size_t>(snap_ptr));
         return_error_if_m(it != db.snapshots.end(), c_error, args_wrong_k, "The snapshot does'nt exist!");
         options.snapshot = snap_ptr->snapshot;
     }
 
+    // Temporary arrays are placed in the arena, so their memory is reused between calls
     bool watch = !(c_options & ustore_option_transaction_dont_watch_k);
-    std::vector<rocks_collection_t*> cols(places.count);
-    std::vector<rocksdb::Slice> keys(places.count);
-    std::vector<std::string> vals(places.count);
-    for (std::size_t i = 0; i != places.size(); ++i) {
-        place_t place = places[i];
-        cols[i] = rocks_collection(db, place.collection);
-        keys[i] = to_slice(place.key);
-    }
+    std::size_t const count = places.count;
+    auto cols = arena.alloc<rocks_collection_t*>(count, c_error).begin();
+    return_if_error_m(c_error);
+    auto keys = arena.alloc<rocksdb::Slice>(count, c_error).begin();
+    return_if_error_m(c_error);
+    auto encoded = arena.alloc<encoded_key_t>(count, c_error).begin();
+    return_if_error_m(c_error);
+    auto positions = arena.alloc<std::size_t>(count, c_error).begin();
+    return_if_error_m(c_error);
+    arena_objects_gt<rocks_value_t> vals(arena, count, c_error);
+    return_if_error_m(c_error);
+    arena_objects_gt<rocks_status_t> statuses(arena, count, c_error);
+    return_if_error_m(c_error);
 
-    std::vector<rocks_status_t> statuses = //
-        txn_ptr                            //
-            ? watch                        //
-                  ? txn_ptr->MultiGetForUpdate(options, cols, keys, &vals)
-                  : txn_ptr->MultiGet(options, cols, keys, &vals)
-            : db.native->MultiGet(options, cols, keys, &vals);
-    for (std::size_t i = 0; i != places.size(); ++i) {
-        if (!statuses[i].IsNotFound()) {
-            if (export_error(statuses[i], c_error))
-                return;
+    if (!txn_ptr) {
+        auto order = arena.alloc<std::size_t>(count, c_error).begin();
+        return_if_error_m(c_error);
+
+        // Cached values are copied into the tail of `vals`, the remaining keys are fetched into its head
+        read_cache_t* cache = !snap_ptr ? db.read_cache.get() : nullptr;
+        read_cache_t::tickets_t tickets;
+        std::size_t misses = 0;
+        if (cache) {
+            tickets = cache->tickets();
+            for (std::size_t i = 0; i != count; ++i) {
+                place_t place = places[i];
+                std::size_t const slot = count - (i - misses) - 1;
+                auto copy = [&](value_view_t value) { vals[slot].PinSelf(to_slice(value)); };
+                if (cache->find(rocks_collection(db, place.collection)->GetID(), place.key, copy))
+                    positions[i] = slot;
+                else
+                    order[misses++] = i;
+            }
+            read_cache_t::account(count - misses, misses);
+        }
+        else {
+            std::iota(order, order + count, 0);
+            misses = count;
+        }
+
+        auto less = [&](std::size_t a, std::size_t b) noexcept {
+            place_t place_a = places[a], place_b = places[b];
+            rocks_collection_t* col_a = rocks_collection(db, place_a.collection);
+            rocks_collection_t* col_b = rocks_collection(db, place_b.collection);
+            return col_a != col_b ? col_a < col_b : place_a.key < place_b.key;
+        };
+        if (!std::is_sorted(order, order + misses, less))
+            std::sort(order, order + misses, less);
+
+        for (std::size_t i = 0; i != misses; ++i) {
+            place_t place = places[order[i]];
+            cols[i] = rocks_collection(db, place.collection);
+            encoded[i] = db.encode(place.key);
+            keys[i] = to_slice(encoded[i]);
+            positions[order[i]] = i;
+        }
+
+        for (std::size_t run_begin = 0; run_begin != misses;) {
+            std::size_t run_end = run_begin + 1;
+            while (run_end != misses && cols[run_end] == cols[run_begin])
+                ++run_end;
+            db.native->MultiGet(options,
+                                cols[run_begin],
+                                run_end - run_begin,
+                                keys + run_begin,
+                                vals.begin() + run_begin,
+                                statuses.begin() + run_begin,
+                                true);
+            run_begin = run_end;
+        }
+
+        for (std::size_t i = 0; cache && i != misses; ++i) {
+            if (!statuses[i].ok())
+                continue;
             auto begin = reinterpret_cast<ustore_bytes_cptr_t>(vals[i].data());
             auto length = static_cast<ustore_length_t>(vals[i].size());
-            enumerator(i, value_view_t {begin, length});
+            cache->insert(cols[i]->GetID(), places[order[i]].key, value_view_t {begin, length}, tickets);
+        }
+    }
+    else
+        for (std::size_t i = 0; i != count; ++i) {
+            place_t place = places[i];
+            cols[i] = rocks_collection(db, place.collection);
+            encoded[i] = db.encode(place.key);
+            keys[i] = to_slice(encoded[i]);
+            positions[i] = i;
+            statuses[i] = watch //
+                              ? txn_ptr->GetForUpdate(options, cols[i], keys[i], &vals[i])
+                              : txn_ptr->Get(options, cols[i], keys[i], &vals[i]);
+        }
+
+    std::size_t total_length = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        if (statuses[i].IsNotFound())
+            continue;
+        if (export_error(statuses[i], c_error))
+            return;
+        total_length += vals[i].size();
+    }
+    reserve(total_length);
+    return_if_error_m(c_error);
+
+    // Export in the order of requests, reporting the expired values missing
+    deadline_t const now = db.ttls.any() ? now_ms() : 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        std::size_t position = positions[i];
+        if (!statuses[position].IsNotFound()) {
+            auto begin = reinterpret_cast<ustore_bytes_cptr_t>(vals[position].data());
+            auto length = static_cast<ustore_length_t>(vals[position].size());
+            value_view_t value {begin, length};
+            enumerator(i, now && ttl_of(db, places[i].collection) ? unexpired(value, now) : value);
         }
         else
             enumerator(i, value_view_t {});
@@ -516,6 +1269,9 @@ void read_many( //
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    if (deduplicates_reads(c))
+        return deduplicate_gather_join_scatter(c, [](ustore_read_t& unique) { ustore_read(&unique); });
+    operation_timer_t timer {operation_t::read_k, c.tasks_count, c.error};
 
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
@@ -531,6 +1287,9 @@ void ustore_read(ustore_read_t* c_ptr) {
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     places_arg_t places {collections, keys, {}, c.tasks_count};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
+    slices_arg_t slices {slices_starts, slices_lengths, c.values_limit};
     validate_read(c.transaction, places, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -545,7 +1304,12 @@ void ustore_read(ustore_read_t* c_ptr) {
 
     // 2. Pull metadata & data in one run, as reading from disk is expensive
     bool const needs_export = c.values != nullptr;
+    auto reserve_values = [&](std::size_t total_length) {
+        if (needs_export)
+            contents.reserve(total_length, c.error);
+    };
     auto data_enumerator = [&](std::size_t i, value_view_t value) {
+        value = slices.apply(i, value);
         presences[i] = bool(value);
         lens[i] = value ? value.size() : ustore_length_missing_k;
         if (needs_export) {
@@ -555,9 +1319,12 @@ void ustore_read(ustore_read_t* c_ptr) {
     };
 
     safe_section("Reading from RocksDB", c.error, [&] {
-        c.tasks_count == 1 //
-            ? read_one(db, &txn, &snap, places, c.options, data_enumerator, c.error)
-            : read_many(db, &txn, &snap, places, c.options, data_enumerator, c.error);
+        if (c.tasks_count == 1)
+            read_one(db, &txn, &snap, places, c.options, reserve_values, data_enumerator, c.error);
+        else
+            places.dispatch([&](auto const& places) {
+                read_many(db, &txn, &snap, places, c.options, arena, reserve_values, data_enumerator, c.error);
+            });
         offs[places.count] = contents.size();
 
         if (needs_export)
@@ -568,6 +1335,7 @@ void ustore_read(ustore_read_t* c_ptr) {
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::scan_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -594,9 +1362,20 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Values are copied while the keys are visited
+    bool const export_values = c.values;
+    growing_tape_t tape(arena);
+    if (export_values) {
+        tape.reserve(total_keys, c.error);
+        return_if_error_m(c.error);
+    }
+
     // 2. Fetch the data
+    // Prefixes of little-endian integers don't follow the keys order, so prefix seeks are disabled
     rocksdb::ReadOptions options;
     options.fill_cache = false;
+    options.total_order_seek = true;
+    options.async_io = db.async_io;
 
     if (c.snapshot)
         options.snapshot = snap.snapshot;
@@ -615,10 +1394,24 @@ void ustore_scan(ustore_scan_t* c_ptr) {
 
         offsets[i] = keys_output - *c.keys;
 
+        // Expired entries are skipped, until a compaction drops them
+        std::uint64_t const ttl = ttl_of(db, task.collection);
+        deadline_t const now = ttl ? now_ms() : 0;
+
         ustore_size_t j = 0;
-        it->Seek(to_slice(task.min_key));
+        it->Seek(to_slice(db.encode(task.min_key)));
         while (it->Valid() && j != task.limit) {
-            std::memcpy(keys_output, it->key().data(), sizeof(ustore_key_t));
+            auto slice = it->value();
+            value_view_t value {reinterpret_cast<byte_t const*>(slice.data()), slice.size()};
+            if (ttl && !(value = unexpired(value, now))) {
+                it->Next();
+                continue;
+            }
+            *keys_output = db.decode(it->key());
+            if (export_values) {
+                tape.push_back(value, c.error);
+                return_if_error_m(c.error);
+            }
             ++keys_output;
             ++j;
             it->Next();
@@ -628,11 +1421,21 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     }
 
     offsets[tasks.size()] = keys_output - *c.keys;
+
+    // 3. Export the values
+    if (export_values) {
+        *c.values = (ustore_bytes_ptr_t)tape.contents().begin().get();
+        if (c.values_offsets)
+            *c.values_offsets = tape.offsets().begin().get();
+        if (c.values_lengths)
+            *c.values_lengths = tape.lengths().begin().get();
+    }
 }
 
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::sample_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -658,8 +1461,11 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     return_if_error_m(c.error);
 
     // 2. Fetch the data
+    // Prefixes of little-endian integers don't follow the keys order, so prefix seeks are disabled
     rocksdb::ReadOptions options;
     options.fill_cache = false;
+    options.total_order_seek = true;
+    options.async_io = db.async_io;
 
     if (c.snapshot)
         options.snapshot = snap.snapshot;
@@ -678,10 +1484,21 @@ void ustore_sample(ustore_sample_t* c_ptr) {
         return_if_error_m(c.error);
 
         ptr_range_gt<ustore_key_t> sampled_keys(keys_output, task.limit);
-        reservoir_sample_iterator(it, sampled_keys, c.error);
+        std::size_t sampled = 0;
+        if (std::uint64_t const ttl = ttl_of(db, task.collection); ttl) {
+            deadline_t const now = now_ms();
+            auto is_visible = [&](auto const& iterator) noexcept {
+                auto slice = iterator->value();
+                return !is_expired(value_view_t {reinterpret_cast<byte_t const*>(slice.data()), slice.size()}, now);
+            };
+            sampled = reservoir_sample_iterator(it, sampled_keys, db.key_encoding, c.error, is_visible);
+        }
+        else
+            sampled = reservoir_sample_iterator(it, sampled_keys, db.key_encoding, c.error);
+        return_if_error_m(c.error);
 
-        counts[task_idx] = task.limit;
-        keys_output += task.limit;
+        counts[task_idx] = static_cast<ustore_length_t>(sampled);
+        keys_output += sampled;
     }
     offsets[samples.count] = keys_output - *c.keys;
 }
@@ -689,6 +1506,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::measure_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
@@ -716,8 +1534,8 @@ void ustore_measure(ustore_measure_t* c_ptr) {
 
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
         auto collection = rocks_collection(db, collections[i]);
-        ustore_key_t const min_key = start_keys[i];
-        ustore_key_t const max_key = end_keys[i];
+        encoded_key_t const min_key = db.encode(start_keys[i]);
+        encoded_key_t const max_key = db.encode(end_keys[i]);
         range = rocksdb::Range(to_slice(min_key), to_slice(max_key));
         safe_section("Retrieving properties from RocksDB", c.error, [&] {
             status = db.native->GetApproximateSizes(options, collection, &range, 1, &approximate_size);
@@ -751,14 +1569,45 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
             return_error_if_m(handle->GetName() != c.name, c.error, args_wrong_k, "Such collection already exists!");
     }
 
+    std::uint64_t ttl_ms = 0;
+    parse_ttl(c.config, ttl_ms, c.error);
+    return_if_error_m(c.error);
+    bool string_keys = false;
+    parse_string_keys(c.config, string_keys, c.error);
+    return_if_error_m(c.error);
+    return_error_if_m(!ttl_ms || !string_keys, c.error, args_combo_k, "Collections with string keys can't expire");
+
+    // Expired values are dropped by compactions, which are also triggered by the age of files
+    rocksdb::ColumnFamilyOptions options = db.collection_options;
+    if (ttl_ms)
+        expire_on_compaction(options, ttl_ms);
+    // Legacy databases order the integer keys with a custom comparator, but never the strings
+    if (string_keys)
+        options.comparator = rocksdb::BytewiseComparator();
+
     rocks_collection_t* collection = nullptr;
-    auto cf_options = rocksdb::ColumnFamilyOptions();
-    cf_options.comparator = &key_comparator_k;
-    rocks_status_t status = db.native->CreateColumnFamily(std::move(cf_options), c.name, &collection);
-    if (!export_error(status, c.error)) {
-        db.columns.push_back(collection);
-        *c.id = reinterpret_cast<ustore_collection_t>(collection);
-    }
+    rocks_status_t status = db.native->CreateColumnFamily(options, c.name, &collection);
+    if (export_error(status, c.error))
+        return;
+    db.columns.push_back(collection);
+    *c.id = reinterpret_cast<ustore_collection_t>(collection);
+
+    if (ttl_ms)
+        safe_section("Persisting the TTL", c.error, [&] {
+            std::unique_lock _ {db.mutex};
+            db.ttls.set(collection->GetID(), ttl_ms);
+            auto ttls = load_ttls(db.directory);
+            ttls[c.name] = ttl_ms;
+            save_ttls(db.directory, ttls);
+        });
+    if (string_keys)
+        safe_section("Persisting the kind of keys", c.error, [&] {
+            std::unique_lock _ {db.mutex};
+            db.string_keyed.set(collection->GetID(), true);
+            auto string_keyed = load_string_keyed(db.directory);
+            string_keyed.insert(c.name);
+            save_string_keyed(db.directory, string_keyed);
+        });
 }
 
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
@@ -792,10 +1641,30 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     if (c.mode == ustore_drop_keys_vals_handle_k) {
         for (auto it = db.columns.begin(); it != db.columns.end(); it++) {
             if (collection_ptr_to_clear == *it) {
+                std::string name = collection_ptr_to_clear->GetName();
+                std::uint32_t const id = collection_ptr_to_clear->GetID();
                 rocks_status_t status = db.native->DropColumnFamily(collection_ptr_to_clear);
                 if (export_error(status, c.error))
                     return;
                 db.columns.erase(it);
+                if (db.read_cache)
+                    db.read_cache->clear();
+                if (db.ttls.find(id))
+                    safe_section("Forgetting the TTL", c.error, [&] {
+                        std::unique_lock _ {db.mutex};
+                        db.ttls.set(id, 0);
+                        auto ttls = load_ttls(db.directory);
+                        ttls.erase(name);
+                        save_ttls(db.directory, ttls);
+                    });
+                if (db.string_keyed.contains(id))
+                    safe_section("Forgetting the kind of keys", c.error, [&] {
+                        std::unique_lock _ {db.mutex};
+                        db.string_keyed.set(id, false);
+                        auto string_keyed = load_string_keyed(db.directory);
+                        string_keyed.erase(name);
+                        save_string_keyed(db.directory, string_keyed);
+                    });
                 break;
             }
         }
@@ -809,6 +1678,8 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
             batch.Delete(collection_ptr_to_clear, it->key());
         rocks_status_t status = db.native->Write(options, &batch);
         export_error(status, c.error);
+        if (db.read_cache)
+            db.read_cache->clear();
         return;
     }
 
@@ -820,6 +1691,8 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
             batch.Put(collection_ptr_to_clear, it->key(), rocksdb::Slice());
         rocks_status_t status = db.native->Write(options, &batch);
         export_error(status, c.error);
+        if (db.read_cache)
+            db.read_cache->clear();
         return;
     }
 }
@@ -871,8 +1744,69 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
 void ustore_database_control(ustore_database_control_t* c_ptr) {
 
     ustore_database_control_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
+
     *c.response = NULL;
-    *c.error = "Controls aren't supported in this implementation!";
+    if (control_metrics(c))
+        return;
+
+    rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
+    std::string_view request {c.request};
+    std::string response;
+
+    // Native properties, like "rocksdb.stats" or "rocksdb.levelstats"
+    if (request.rfind("rocksdb.", 0) == 0) {
+        bool found = false;
+        safe_section("Querying RocksDB property", c.error, [&] {
+            found = db.native->GetProperty(rocksdb::Slice(request.data(), request.size()), &response);
+        });
+        return_if_error_m(c.error);
+        return_error_if_m(found, c.error, args_wrong_k, "Unknown RocksDB property");
+        return export_response(response, c);
+    }
+
+    if (request == "statistics") {
+        return_error_if_m(db.statistics, c.error, args_wrong_k, "Statistics are disabled, enable in \"DBOptions\"");
+        safe_section("Printing statistics", c.error, [&] { response = db.statistics->ToString(); });
+        return_if_error_m(c.error);
+        return export_response(response, c);
+    }
+
+    if (request == "usage") {
+        safe_section("Measuring usage", c.error, [&] {
+            json_t usage = json_t::object();
+            std::uint64_t value = 0;
+            if (db.native->GetAggregatedIntProperty("rocksdb.estimate-table-readers-mem", &value))
+                usage["estimate-table-readers-mem"] = value;
+            if (db.native->GetAggregatedIntProperty("rocksdb.cur-size-all-mem-tables", &value))
+                usage["cur-size-all-mem-tables"] = value;
+            // The cache is shared, so aggregating its usage over collections would overcount it
+            if (db.block_cache) {
+                usage["block-cache-capacity"] = db.block_cache->GetCapacity();
+                usage["block-cache-usage"] = db.block_cache->GetUsage();
+                usage["block-cache-pinned-usage"] = db.block_cache->GetPinnedUsage();
+            }
+            if (db.statistics)
+                for (auto [name, ticker] : {
+                         std::pair {"block-cache-hit", rocksdb::BLOCK_CACHE_HIT},
+                         std::pair {"block-cache-miss", rocksdb::BLOCK_CACHE_MISS},
+                         std::pair {"bloom-filter-useful", rocksdb::BLOOM_FILTER_USEFUL},
+                         std::pair {"bloom-filter-full-positive", rocksdb::BLOOM_FILTER_FULL_POSITIVE},
+                         std::pair {"bloom-filter-full-true-positive", rocksdb::BLOOM_FILTER_FULL_TRUE_POSITIVE},
+                         std::pair {"bloom-filter-prefix-useful", rocksdb::BLOOM_FILTER_PREFIX_USEFUL},
+                     })
+                    usage[name] = db.statistics->getTickerCount(ticker);
+            response = usage.dump();
+        });
+        return_if_error_m(c.error);
+        return export_response(response, c);
+    }
+
+    log_error_m(c.error,
+                missing_feature_k,
+                "Only \"usage\", \"statistics\", \"metrics\" and \"rocksdb.*\" controls are supported in this "
+                "implementation!");
 }
 
 void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
@@ -899,6 +1833,7 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 
 void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     ustore_transaction_commit_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::commit_k, 1, c.error};
     if (!c.transaction)
         return;
 
@@ -908,6 +1843,15 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c.db);
     rocks_txn_t& txn = *reinterpret_cast<rocks_txn_t*>(c.transaction);
 
+    // The write batch is cleared on commit, so the updated keys are collected beforehand
+    written_keys_gt<rocks_db_t> written {db};
+    if (db.read_cache) {
+        safe_section("Collecting written keys", c.error, [&] {
+            export_error(txn.GetWriteBatch()->GetWriteBatch()->Iterate(&written), c.error);
+        });
+        return_if_error_m(c.error);
+    }
+
     if (c.sequence_number)
         db.mutex.lock();
     rocks_status_t status = txn.Commit();
@@ -917,6 +1861,8 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
             *c.sequence_number = db.native->GetLatestSequenceNumber();
         db.mutex.unlock();
     }
+    for (auto const& [collection_id, key] : written.keys)
+        db.read_cache->invalidate(collection_id, key);
 }
 
 void ustore_arena_free(ustore_arena_t c_arena) {
@@ -932,6 +1878,7 @@ void ustore_transaction_free(ustore_transaction_t c_transaction) {
 void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
+    threads_registry_t::global().forget(c_db);
     rocks_db_t& db = *reinterpret_cast<rocks_db_t*>(c_db);
     for (rocks_collection_t* cf : db.columns)
         db.native->DestroyColumnFamilyHandle(cf);
@@ -0,0 +1,1827 @@
+/**
+ * @file engine_tiered.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Embedded Persistent Key-Value Store, that keeps the recently used keys
+ * in an in-memory @b UCSet tier in front of a @b RocksDB tier.
+ *
+ * RocksDB holds the complete dataset and stays the source of truth for ordered scans,
+ * snapshots and transactions, so those keep the exact semantics of the RocksDB engine.
+ * The hot tier caches the values of point lookups, including the missing ones.
+ * Keys are promoted into it on access, and the least recently used ones are demoted
+ * once the hot tier exceeds its `memory_limit`.
+ *
+ * ## Write Policies
+ * - "through": every write reaches RocksDB first, and then updates the hot tier.
+ * - "back": writes only mark the values dirty in the hot tier, and a background thread
+ *   flushes them into RocksDB in batches. Dirty values are flushed before being demoted,
+ *   and before any operation, that reads RocksDB directly, may observe them. Writes with
+ *   `ustore_option_write_flush_k` are flushed before returning. Others may be lost on a crash.
+ *
+ * ## Consistency
+ * Writers of the same keys are serialized by striped mutexes, held from the RocksDB write
+ * until the hot tier is updated. Lookups, that miss the hot tier, only promote the fetched
+ * values, if no writer has touched their stripe in between.
+ * Transactions and snapshots bypass the hot tier, so RocksDB detects their conflicts.
+ * On commit, the keys they have written are dropped from the hot tier, and with write-back,
+ * the dirty values of the keys they have read or written are flushed first.
+ */
+
+#include <mutex>
+#include <list>
+#include <array>
+#include <atomic>             // `std::atomic`
+#include <thread>             // `std::thread`
+#include <vector>
+#include <cstring>            // `std::memcpy`
+#include <numeric>            // `std::iota`
+#include <algorithm>          // `std::stable_sort`
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+#include <condition_variable> // Waking up the flusher thread
+
+#include <rocksdb/db.h>
+#include <rocksdb/comparator.h>
+#include <rocksdb/utilities/options_util.h>
+#include <rocksdb/utilities/transaction.h>
+#include <rocksdb/utilities/optimistic_transaction_db.h>
+
+#include <ucset/consistent_set.hpp> // `ucset::consistent_set_gt`
+#include <ucset/locked.hpp>         // `ucset::locked_gt`
+
+#include "ustore/db.h"
+#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+#include "helpers/linked_array.hpp"   // `growing_tape_t`
+#include "helpers/full_scan.hpp"      // `reservoir_sample_iterator`
+#include "helpers/config_loader.hpp"  // `config_loader_t`
+#include "helpers/threads.hpp"        // `threads_registry_t`
+#include "helpers/merge.hpp"          // `write_spliced`
+#include "helpers/metrics.hpp"        // `operation_timer_t`
+#include "helpers/key_encoding.hpp"   // `encode_key`
+#include "helpers/expiration.hpp"     // `stamp_deadlines`
+#include "helpers/rocksdb.hpp"        // `merge_operator_t`
+#include "helpers/string_keys.hpp"    // `string_keyed_gt`
+#include "helpers/algorithm.hpp"      // `deduplicate_gather_join_scatter`
+
+namespace stdfs = std::filesystem;
+using namespace unum::ucset;
+using namespace unum::ustore;
+using namespace unum;
+
+/*********************************************************/
+/*****************   Structures & Consts  ****************/
+/*********************************************************/
+
+ustore_collection_t const ustore_collection_main_k = 0;
+ustore_length_t const ustore_length_missing_k = std::numeric_limits<ustore_length_t>::max();
+ustore_key_t const ustore_key_unknown_k = std::numeric_limits<ustore_key_t>::max();
+bool const ustore_supports_transactions_k = true;
+bool const ustore_supports_named_collections_k = true;
+bool const ustore_supports_snapshots_k = true;
+
+using rocks_native_t = rocksdb::OptimisticTransactionDB;
+using rocks_status_t = rocksdb::Status;
+using rocks_value_t = rocksdb::PinnableSlice;
+using rocks_txn_t = rocksdb::Transaction;
+using rocks_collection_t = rocksdb::ColumnFamilyHandle;
+
+enum write_policy_t {
+    /** @brief Acknowledge writes once they reach RocksDB. */
+    write_through_k,
+    /** @brief Acknowledge writes once they reach the hot tier, flushing them in the background. */
+    write_back_k,
+};
+
+struct tiered_options_t {
+    /** @brief Bytes occupied by the hot tier, past which the least recently used keys are demoted. */
+    std::size_t memory_limit = 256ul * 1024ul * 1024ul;
+    write_policy_t write_policy = write_through_k;
+    /** @brief How often the dirty values are flushed with the "back" policy. */
+    std::size_t flush_interval_ms = 100;
+    /** @brief Bytes of dirty values, that wake up the flusher before its interval. */
+    std::size_t flush_threshold = 16ul * 1024ul * 1024ul;
+};
+
+/**
+ * @brief Cached value of a key. Missing keys and deletions are cached as well,
+ * so that repeated lookups of absent keys don't reach RocksDB either.
+ */
+struct hot_entry_t {
+    collection_key_t collection_key;
+    std::string value;
+    bool present = false;
+    /** @brief Only with the "back" policy: the value is yet to be flushed into RocksDB. */
+    bool dirty = false;
+    /** @brief Distinguishes the rewrites of the same key, that happen during a flush. */
+    std::uint64_t version = 0;
+
+    hot_entry_t() = default;
+    hot_entry_t(collection_key_t collection_key) noexcept : collection_key(collection_key) {}
+    hot_entry_t(collection_key_t collection_key, value_view_t value) noexcept(false)
+        : collection_key(collection_key), present(bool(value)) {
+        if (value)
+            this->value.assign(value.c_str(), value.size());
+    }
+
+    value_view_t view() const noexcept { return present ? value_view_t {std::string_view(value)} : value_view_t {}; }
+
+    /** @brief Memory occupied by the entry, including its bookkeeping in the `recency_t`. */
+    std::size_t space_usage() const noexcept { return sizeof(hot_entry_t) + value.capacity() + 64; }
+
+    operator collection_key_t() const noexcept { return collection_key; }
+};
+
+struct hot_compare_t {
+    using value_type = collection_key_t;
+    bool operator()(collection_key_t const& a, collection_key_t const& b) const noexcept { return a < b; }
+    bool operator()(collection_key_t const& a, ustore_collection_t b) const noexcept { return a.collection < b; }
+    bool operator()(ustore_collection_t a, collection_key_t const& b) const noexcept { return a < b.collection; }
+};
+
+using hot_set_t = locked_gt<consistent_set_gt<hot_entry_t, hot_compare_t>, std::shared_mutex>;
+
+/**
+ * @brief Number of mutexes, serializing the writers of keys with the same hash.
+ * Also shards the `recency_t`, so that the lookups of different keys don't contend.
+ */
+constexpr std::size_t stripes_k = 64;
+static_assert(stripes_k <= 64, "Stripes must fit into a bitmask");
+
+inline std::size_t stripe_of(collection_key_t const& key) noexcept {
+    return collection_key_hash_t {}(key) % stripes_k;
+}
+
+inline collection_key_t successor(collection_key_t key) noexcept {
+    return key.key != std::numeric_limits<ustore_key_t>::max()
+               ? collection_key_t {key.collection, key.key + 1}
+               : collection_key_t {key.collection + 1, std::numeric_limits<ustore_key_t>::min()};
+}
+
+/**
+ * @brief Least recently used order of the keys in the hot tier, with their sizes.
+ * Every stripe has its own list, and demotion takes the oldest key of every stripe
+ * in turns, so the order is only approximately global.
+ */
+class recency_t {
+    using order_t = std::list<collection_key_t>;
+    struct shard_t {
+        std::mutex mutex;
+        order_t order;
+        std::unordered_map<collection_key_t, std::pair<std::size_t, order_t::iterator>, collection_key_hash_t> spaces;
+    };
+
+    std::array<shard_t, stripes_k> shards_;
+    std::atomic<std::size_t> bytes_ {0};
+    std::atomic<std::size_t> next_shard_ {0};
+
+  public:
+    std::size_t bytes() const noexcept { return bytes_.load(std::memory_order_relaxed); }
+
+    void touch(collection_key_t key) noexcept {
+        shard_t& shard = shards_[stripe_of(key)];
+        std::unique_lock _ {shard.mutex};
+        auto it = shard.spaces.find(key);
+        if (it != shard.spaces.end())
+            shard.order.splice(shard.order.begin(), shard.order, it->second.second);
+    }
+
+    void admit(collection_key_t key, std::size_t space) noexcept(false) {
+        shard_t& shard = shards_[stripe_of(key)];
+        std::unique_lock _ {shard.mutex};
+        auto it = shard.spaces.find(key);
+        if (it == shard.spaces.end()) {
+            shard.order.push_front(key);
+            shard.spaces.emplace(key, std::make_pair(space, shard.order.begin()));
+            bytes_ += space;
+            return;
+        }
+        bytes_ += space;
+        bytes_ -= it->second.first;
+        it->second.first = space;
+        shard.order.splice(shard.order.begin(), shard.order, it->second.second);
+    }
+
+    void forget(collection_key_t key) noexcept {
+        shard_t& shard = shards_[stripe_of(key)];
+        std::unique_lock _ {shard.mutex};
+        auto it = shard.spaces.find(key);
+        if (it == shard.spaces.end())
+            return;
+        bytes_ -= it->second.first;
+        shard.order.erase(it->second.second);
+        shard.spaces.erase(it);
+    }
+
+    void forget(ustore_collection_t collection) noexcept {
+        for (shard_t& shard : shards_) {
+            std::unique_lock _ {shard.mutex};
+            for (auto it = shard.spaces.begin(); it != shard.spaces.end();) {
+                if (it->first.collection != collection) {
+                    ++it;
+                    continue;
+                }
+                bytes_ -= it->second.first;
+                shard.order.erase(it->second.second);
+                it = shard.spaces.erase(it);
+            }
+        }
+    }
+
+    /**
+     * @brief Stops tracking up to `count` of the least recently used keys, appending them to `popped`.
+     */
+    void pop_coldest(std::size_t count, std::vector<collection_key_t>& popped) noexcept(false) {
+        std::size_t empty_shards = 0;
+        while (count && empty_shards != stripes_k) {
+            shard_t& shard = shards_[next_shard_++ % stripes_k];
+            std::unique_lock _ {shard.mutex};
+            if (shard.order.empty()) {
+                ++empty_shards;
+                continue;
+            }
+            empty_shards = 0;
+            auto it = shard.spaces.find(shard.order.back());
+            popped.push_back(it->first);
+            bytes_ -= it->second.first;
+            shard.spaces.erase(it);
+            shard.order.pop_back();
+            --count;
+        }
+    }
+};
+
+/**
+ * @brief Keys are demoted in batches of this size, once the hot tier exceeds its limit,
+ * until it shrinks by a slack of 1/8 of the limit, so that demotions don't follow every write.
+ */
+constexpr std::size_t demotion_batch_k = 256;
+constexpr std::size_t demotion_slack_k = 8;
+
+struct rocks_snapshot_t {
+    rocksdb::Snapshot const* snapshot = nullptr;
+};
+
+struct tiered_txn_t {
+    rocks_txn_t* native = nullptr;
+    /** @brief Keys read with a watch, flushed before the commit with the "back" policy. */
+    std::vector<collection_key_t> watched;
+
+    ~tiered_txn_t() noexcept { delete native; }
+};
+
+struct tiered_db_t {
+    /** @brief Cold tier. `columns` are protected by the `mutex`, as well as the `snapshots`. */
+    std::vector<rocks_collection_t*> columns;
+    std::unordered_map<ustore_size_t, rocks_snapshot_t*> snapshots;
+    std::unique_ptr<rocks_native_t> native;
+    std::mutex mutex;
+    rocksdb::ColumnFamilyOptions collection_options;
+    key_encoding_t key_encoding = key_encoding_t::ordered_k;
+    stdfs::path directory;
+    /** @brief TTLs of collections by their column family IDs, also persisted with `save_ttls`. */
+    ttls_gt<std::uint32_t> ttls;
+    /** @brief Column families with native string keys, also persisted with `save_string_keyed`. */
+    string_keyed_gt<std::uint32_t> string_keyed;
+
+    encoded_key_t encode(ustore_key_t key) const noexcept { return encode_key(key, key_encoding); }
+    ustore_key_t decode(rocksdb::Slice const& key) const noexcept { return decode_key(key.data(), key_encoding); }
+
+    /** @brief Hot tier, addressed by the same collection handles, as the cold one. */
+    tiered_options_t options;
+    hot_set_t hot;
+    recency_t recency;
+    std::array<std::mutex, stripes_k> stripes;
+    /** @brief Advanced by the writers of every stripe, so that lookups can detect them. */
+    std::array<std::atomic<std::uint64_t>, stripes_k> generations {};
+    std::atomic<std::uint64_t> versions {0};
+    /** @brief Allows only one thread to demote keys at a time. */
+    std::mutex demotion_mutex;
+
+    /**
+     * @brief Serializes the flushes of dirty values, so that an older version is never written
+     * over a newer one. Taken after the `stripes`, if both are needed.
+     */
+    std::mutex flush_mutex;
+    /** @brief Keys, that were written with the "back" policy, repeated if rewritten. */
+    std::vector<collection_key_t> dirty;
+    std::size_t dirty_bytes = 0;
+    std::mutex dirty_mutex;
+    std::thread flusher;
+    std::mutex flusher_mutex;
+    std::condition_variable flusher_wakeup;
+    bool flusher_stopping = false;
+
+    std::atomic<std::size_t> hits {0};
+    std::atomic<std::size_t> misses {0};
+    std::atomic<std::size_t> promotions {0};
+    std::atomic<std::size_t> demotions {0};
+    std::atomic<std::size_t> flushes {0};
+
+    tiered_db_t(hot_set_t&& hot) noexcept : hot(std::move(hot)) {}
+    bool writes_back() const noexcept { return options.write_policy == write_back_k; }
+};
+
+inline rocksdb::Slice to_slice(encoded_key_t const& key) noexcept {
+    return {key.data(), key.size()};
+}
+
+inline rocksdb::Slice to_slice(value_view_t value) noexcept {
+    return {reinterpret_cast<const char*>(value.begin()), value.size()};
+}
+
+bool export_error(rocks_status_t const& status, ustore_error_t* c_error) {
+    if (status.ok())
+        return false;
+
+    if (status.IsCorruption())
+        *c_error = "Failure: DB Corruption";
+    else if (status.IsIOError())
+        *c_error = "Failure: IO  Error";
+    else if (status.IsInvalidArgument())
+        *c_error = "Failure: Invalid Argument";
+    else
+        *c_error = "Failure";
+    return true;
+}
+
+void export_error_code(ucset::status_t code, ustore_error_t* c_error) noexcept {
+    if (!code)
+        *c_error = "Faced error!";
+}
+
+rocks_collection_t* rocks_collection(tiered_db_t& db, ustore_collection_t collection) {
+    return collection == ustore_collection_main_k ? db.native->DefaultColumnFamily()
+                                                  : reinterpret_cast<rocks_collection_t*>(collection);
+}
+
+/**
+ * @brief Transactions report the updated collections by their column family IDs.
+ */
+ustore_collection_t collection_with_id(tiered_db_t& db, std::uint32_t id) noexcept {
+    std::unique_lock _ {db.mutex};
+    for (rocks_collection_t* column : db.columns)
+        if (column->GetID() == id && column != db.native->DefaultColumnFamily())
+            return reinterpret_cast<ustore_collection_t>(column);
+    return ustore_collection_main_k;
+}
+
+/*********************************************************/
+/*****************	   Hot Tier Upkeep	  ****************/
+/*********************************************************/
+
+template <typename keys_at>
+std::uint64_t stripes_of(keys_at const& keys, std::size_t count) noexcept {
+    std::uint64_t stripes = 0;
+    for (std::size_t i = 0; i != count; ++i)
+        stripes |= std::uint64_t(1) << stripe_of(keys[i]);
+    return stripes;
+}
+
+constexpr std::uint64_t all_stripes_k = ~std::uint64_t(0);
+
+/**
+ * @brief Locks the stripes of the given bitmask in ascending order, so that
+ * the writers of overlapping sets of keys never deadlock.
+ */
+class stripes_lock_t {
+    tiered_db_t& db_;
+    std::uint64_t stripes_ = 0;
+
+  public:
+    stripes_lock_t(tiered_db_t& db, std::uint64_t stripes) noexcept : db_(db), stripes_(stripes) {
+        for (std::size_t stripe = 0; stripe != stripes_k; ++stripe)
+            if (stripes_ & (std::uint64_t(1) << stripe))
+                db_.stripes[stripe].lock();
+    }
+    stripes_lock_t(stripes_lock_t const&) = delete;
+
+    /** @brief Signals the concurrent lookups, that their fetched values may be outdated. */
+    void advance_generations() noexcept {
+        for (std::size_t stripe = 0; stripe != stripes_k; ++stripe)
+            if (stripes_ & (std::uint64_t(1) << stripe))
+                db_.generations[stripe].fetch_add(1, std::memory_order_release);
+    }
+
+    ~stripes_lock_t() noexcept {
+        for (std::size_t stripe = 0; stripe != stripes_k; ++stripe)
+            if (stripes_ & (std::uint64_t(1) << stripe))
+                db_.stripes[stripe].unlock();
+    }
+};
+
+/**
+ * @brief Writes the dirty values of the given keys into RocksDB and marks them clean,
+ * unless they were rewritten in the meantime. Clean and absent keys are skipped.
+ */
+void flush_keys(tiered_db_t& db,
+                collection_key_t const* begin,
+                collection_key_t const* end,
+                bool sync,
+                ustore_error_t* c_error) noexcept(false) {
+
+    if (!db.writes_back() || begin == end)
+        return;
+
+    std::unique_lock flush_lock {db.flush_mutex};
+    rocksdb::WriteBatch batch;
+    std::vector<std::pair<collection_key_t, std::uint64_t>> flushed;
+    for (auto it = begin; it != end; ++it) {
+        auto status = db.hot.find(
+            *it,
+            [&](hot_entry_t const& entry) noexcept(false) {
+                if (!entry.dirty)
+                    return;
+                rocks_collection_t* collection = rocks_collection(db, entry.collection_key.collection);
+                encoded_key_t encoded = db.encode(entry.collection_key.key);
+                auto status = entry.present ? batch.Put(collection, to_slice(encoded), to_slice(entry.view()))
+                                            : batch.Delete(collection, to_slice(encoded));
+                export_error(status, c_error);
+                flushed.emplace_back(entry.collection_key, entry.version);
+            },
+            []() noexcept {});
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+    }
+    if (flushed.empty())
+        return;
+
+    rocksdb::WriteOptions options;
+    options.sync = sync;
+    rocks_status_t status = db.native->Write(options, &batch);
+    if (export_error(status, c_error))
+        return;
+
+    for (auto const& [key, version] : flushed) {
+        auto status = db.hot.range(key, successor(key), [&](hot_entry_t& entry) noexcept {
+            if (entry.version == version)
+                entry.dirty = false;
+        });
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+    }
+    db.flushes += flushed.size();
+}
+
+/**
+ * @brief Flushes all the dirty values, returning their keys to the queue on failure.
+ */
+void flush_all(tiered_db_t& db, bool sync, ustore_error_t* c_error) noexcept(false) {
+    if (!db.writes_back())
+        return;
+
+    std::vector<collection_key_t> keys;
+    {
+        std::unique_lock _ {db.dirty_mutex};
+        std::swap(keys, db.dirty);
+        db.dirty_bytes = 0;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    flush_keys(db, keys.data(), keys.data() + keys.size(), sync, c_error);
+    if (*c_error) {
+        std::unique_lock _ {db.dirty_mutex};
+        db.dirty.insert(db.dirty.end(), keys.begin(), keys.end());
+    }
+}
+
+void run_flushes(tiered_db_t& db) noexcept {
+    std::unique_lock lock {db.flusher_mutex};
+    auto const period = std::chrono::milliseconds(db.options.flush_interval_ms);
+    while (true) {
+        db.flusher_wakeup.wait_for(lock, period, [&] {
+            std::unique_lock _ {db.dirty_mutex};
+            return db.flusher_stopping || db.dirty_bytes >= db.options.flush_threshold;
+        });
+        if (db.flusher_stopping)
+            return;
+
+        lock.unlock();
+        ustore_error_t c_error = nullptr;
+        safe_section("Flushing dirty values", &c_error, [&] { flush_all(db, false, &c_error); });
+        lock.lock();
+    }
+}
+
+void stop_flushes(tiered_db_t& db) noexcept {
+    if (!db.flusher.joinable())
+        return;
+    {
+        std::unique_lock _ {db.flusher_mutex};
+        db.flusher_stopping = true;
+    }
+    db.flusher_wakeup.notify_all();
+    db.flusher.join();
+}
+
+/**
+ * @brief Queues the keys, written with the "back" policy, for the flusher.
+ */
+void mark_dirty(tiered_db_t& db, places_arg_t const& places, std::size_t bytes) noexcept(false) {
+    bool wake_up = false;
+    {
+        std::unique_lock _ {db.dirty_mutex};
+        for (std::size_t i = 0; i != places.size(); ++i)
+            db.dirty.push_back(places[i].collection_key());
+        db.dirty_bytes += bytes;
+        wake_up = db.dirty_bytes >= db.options.flush_threshold;
+    }
+    if (wake_up)
+        db.flusher_wakeup.notify_one();
+}
+
+/**
+ * @brief Removes the least recently used keys from the hot tier, until it fits into
+ * the `memory_limit` with some slack. Dirty values are flushed before their keys are
+ * removed, and the keys, that were rewritten right after the flush, stay hot.
+ */
+void demote(tiered_db_t& db, ustore_error_t* c_error) noexcept(false) {
+    std::size_t const limit = db.options.memory_limit;
+    if (db.recency.bytes() <= limit)
+        return;
+    std::unique_lock demotion_lock {db.demotion_mutex, std::try_to_lock};
+    if (!demotion_lock)
+        return;
+
+    std::size_t const target = limit - limit / demotion_slack_k;
+    std::vector<collection_key_t> coldest;
+    std::vector<std::pair<collection_key_t, std::size_t>> kept;
+    while (db.recency.bytes() > target) {
+        coldest.clear();
+        db.recency.pop_coldest(demotion_batch_k, coldest);
+        if (coldest.empty())
+            break;
+
+        flush_keys(db, coldest.data(), coldest.data() + coldest.size(), false, c_error);
+        return_if_error_m(c_error);
+
+        kept.clear();
+        {
+            stripes_lock_t lock {db, stripes_of(coldest, coldest.size())};
+            for (collection_key_t const& key : coldest) {
+                std::size_t dirty_space = 0;
+                auto status = db.hot.find(
+                    key,
+                    [&](hot_entry_t const& entry) noexcept {
+                        if (entry.dirty)
+                            dirty_space = entry.space_usage();
+                    },
+                    []() noexcept {});
+                if (status && !dirty_space)
+                    status = db.hot.erase_range(key, successor(key), no_op_t {});
+                export_error_code(status, c_error);
+                return_if_error_m(c_error);
+                if (dirty_space)
+                    kept.emplace_back(key, dirty_space);
+            }
+        }
+        db.demotions += coldest.size() - kept.size();
+        for (auto const& [key, space] : kept)
+            db.recency.admit(key, space);
+        if (kept.size() == coldest.size())
+            break;
+    }
+}
+
+/**
+ * @brief Caches a value, fetched from RocksDB, unless a writer has touched its stripe
+ * since the `generation` was observed. Skipped, if the stripe is being written into.
+ */
+void promote(tiered_db_t& db, collection_key_t key, std::uint64_t generation, hot_entry_t&& entry) noexcept(false) {
+    std::size_t const stripe = stripe_of(key);
+    std::unique_lock lock {db.stripes[stripe], std::try_to_lock};
+    if (!lock || db.generations[stripe].load(std::memory_order_acquire) != generation)
+        return;
+    std::size_t const space = entry.space_usage();
+    if (!db.hot.upsert(std::move(entry)))
+        return;
+    lock.unlock();
+    db.recency.admit(key, space);
+    ++db.promotions;
+}
+
+/**
+ * @brief Drops the keys from the hot tier, while their stripes are locked.
+ */
+void invalidate(tiered_db_t& db, collection_key_t const* begin, collection_key_t const* end, ustore_error_t* c_error) {
+    for (auto it = begin; it != end; ++it) {
+        auto status = db.hot.erase_range(*it, successor(*it), no_op_t {});
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        db.recency.forget(*it);
+    }
+}
+
+/*********************************************************/
+/*****************   Native String Keys   ****************/
+/*********************************************************/
+
+/**
+ * @brief Collections with string keys only live in the cold tier, as the hot one is keyed by integers.
+ * They are never written back, so RocksDB alone serves them, with the semantics of its own engine.
+ */
+bool unum::ustore::has_string_keys(ustore_database_t c_db, ustore_collection_t collection) noexcept {
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c_db);
+    return db.string_keyed.any() && db.string_keyed.contains(rocks_collection(db, collection)->GetID());
+}
+
+void unum::ustore::read_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_snapshot_t c_snapshot,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    ustore_options_t c_options,
+    growing_tape_t& values,
+    ustore_error_t* c_error) noexcept {
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c_db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c_transaction);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c_snapshot);
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+
+    rocksdb::ReadOptions options;
+    if (snap_ptr) {
+        std::unique_lock _ {db.mutex};
+        auto it = db.snapshots.find(reinterpret_cast<std::size_t>(snap_ptr));
+        return_error_if_m(it != db.snapshots.end(), c_error, args_wrong_k, "The snapshot does'nt exist!");
+        options.snapshot = snap_ptr->snapshot;
+    }
+
+    safe_section("Reading strings from RocksDB", c_error, [&] {
+        rocks_value_t value;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            auto collection = rocks_collection(db, collections ? collections[i] : ustore_collection_main_k);
+            auto key = to_slice(keys[i]);
+            value.Reset();
+            rocks_status_t status = //
+                txn_ptr             //
+                    ? watch         //
+                          ? txn_ptr->native->GetForUpdate(options, collection, key, &value)
+                          : txn_ptr->native->Get(options, collection, key, &value)
+                    : db.native->Get(options, collection, key, &value);
+            if (!status.IsNotFound() && export_error(status, c_error))
+                return;
+            values.push_back(status.IsNotFound() ? value_view_t {} : to_view(value), c_error);
+            return_if_error_m(c_error);
+        }
+    });
+}
+
+void unum::ustore::write_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    contents_arg_t const& values,
+    ustore_options_t c_options,
+    ustore_error_t* c_error) noexcept {
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c_db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c_transaction);
+    bool const safe = c_options & ustore_option_write_flush_k;
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+
+    rocksdb::WriteOptions options;
+    options.sync = safe;
+    options.disableWAL = !safe;
+
+    safe_section("Writing strings into RocksDB", c_error, [&] {
+        rocksdb::WriteBatch batch;
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            auto collection = rocks_collection(db, collections ? collections[i] : ustore_collection_main_k);
+            auto key = to_slice(keys[i]);
+            value_view_t value = values[i];
+            rocks_status_t status;
+            if (!txn_ptr)
+                status = !value ? batch.Delete(collection, key) : batch.Put(collection, key, to_slice(value));
+            else if (!value)
+                status = watch ? txn_ptr->native->Delete(collection, key)
+                               : txn_ptr->native->DeleteUntracked(collection, key);
+            else
+                status = watch ? txn_ptr->native->Put(collection, key, to_slice(value))
+                               : txn_ptr->native->PutUntracked(collection, key, to_slice(value));
+            if (export_error(status, c_error))
+                return;
+        }
+        if (!txn_ptr)
+            export_error(db.native->Write(options, &batch), c_error);
+    });
+}
+
+void unum::ustore::scan_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_collection_t c_collection,
+    std::string_view start_key,
+    ustore_length_t count_limit,
+    ustore_options_t,
+    growing_tape_t& keys,
+    ustore_error_t* c_error) noexcept {
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c_db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c_transaction);
+
+    rocksdb::ReadOptions options;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+
+    safe_section("Scanning strings in RocksDB", c_error, [&] {
+        auto collection = rocks_collection(db, c_collection);
+        auto it = txn_ptr //
+                      ? std::unique_ptr<rocksdb::Iterator>(txn_ptr->native->GetIterator(options, collection))
+                      : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
+        ustore_length_t count = 0;
+        for (it->Seek(rocksdb::Slice(start_key.data(), start_key.size())); it->Valid() && count != count_limit;
+             it->Next(), ++count) {
+            keys.push_back(to_view(it->key()), c_error);
+            return_if_error_m(c_error);
+        }
+        export_error(it->status(), c_error);
+    });
+}
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
+
+void ustore_database_init(ustore_database_init_t* c_ptr) {
+
+    ustore_database_init_t& c = *c_ptr;
+    safe_section("Opening tiered storage", c.error, [&] {
+        return_error_if_m(c.config, c.error, args_wrong_k, "Null config specified");
+        config_t config;
+        auto st = config_loader_t::load_from_json_string(c.config, config);
+        return_error_if_m(st, c.error, args_wrong_k, st.message());
+
+        stdfs::path root = config.directory;
+        stdfs::file_status root_status = stdfs::status(root);
+        return_error_if_m(root_status.type() == stdfs::file_type::directory,
+                          c.error,
+                          args_wrong_k,
+                          "Root isn't a directory");
+        return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
+
+        auto maybe_hot = hot_set_t::make();
+        return_error_if_m(maybe_hot, c.error, error_unknown_k, "Couldn't build consistent set");
+        auto db_ptr = std::make_unique<tiered_db_t>(std::move(maybe_hot).value());
+
+        // RocksDB options follow the same layout, as in the RocksDB engine,
+        // while the hot tier is configured with the top-level fields
+        rocksdb::Options options;
+        options.compression = rocksdb::kNoCompression;
+        rocksdb::ColumnFamilyOptions cf_options;
+        std::vector<rocksdb::ColumnFamilyDescriptor> column_descriptors;
+        rocks_status_t status;
+        if (!config.engine.config_file_path.empty()) {
+            status = rocksdb::LoadOptionsFromFile(config.engine.config_file_path,
+                                                  rocksdb::Env::Default(),
+                                                  &options,
+                                                  &column_descriptors);
+            return_error_if_m(status.ok(), c.error, error_unknown_k, "Couldn't parse RocksDB config");
+        }
+
+        tiered_options_t& hot_options = db_ptr->options;
+        if (!config.engine.config.empty()) {
+            auto const& js = config.engine.config;
+            return_error_if_m(config_loader_t::parse_volume(js, "memory_limit", hot_options.memory_limit) &&
+                                  config_loader_t::parse_volume(js, "flush_threshold", hot_options.flush_threshold),
+                              c.error,
+                              args_wrong_k,
+                              "Hot tier sizes must be numbers or strings, like \"1GB\"");
+            std::string policy = js.value("write_policy", std::string("through"));
+            return_error_if_m(policy == "through" || policy == "back",
+                              c.error,
+                              args_wrong_k,
+                              "Write policy can be either \"through\" or \"back\"");
+            hot_options.write_policy = policy == "back" ? write_back_k : write_through_k;
+            hot_options.flush_interval_ms = js.value("flush_interval", hot_options.flush_interval_ms);
+            return_error_if_m(hot_options.flush_interval_ms, c.error, args_wrong_k, "Flush interval must be positive");
+
+            if (js.contains("DBOptions")) {
+                auto j_db = js["DBOptions"];
+                options.max_open_files = j_db.value("max_open_files", options.max_open_files);
+                options.writable_file_max_buffer_size =
+                    j_db.value("writable_file_max_buffer_size", options.writable_file_max_buffer_size);
+            }
+            if (js.contains("CFOptions")) {
+                auto j_cf = js["CFOptions"];
+                cf_options.write_buffer_size = j_cf.value("write_buffer_size", cf_options.write_buffer_size);
+                cf_options.max_write_buffer_number =
+                    j_cf.value("max_write_buffer_number", cf_options.max_write_buffer_number);
+                cf_options.target_file_size_base =
+                    j_cf.value("target_file_size_base", cf_options.target_file_size_base);
+            }
+        }
+
+        rocksdb::ConfigOptions config_options;
+        status = rocksdb::LoadLatestOptions(config_options, root, &options, &column_descriptors);
+        return_error_if_m(status.ok() || status.IsNotFound(), c.error, error_unknown_k, "Recovering RocksDB state");
+
+        cf_options.comparator = rocksdb::BytewiseComparator();
+        cf_options.merge_operator = std::make_shared<merge_operator_t>();
+        db_ptr->collection_options = cf_options;
+        if (column_descriptors.empty())
+            column_descriptors.push_back({rocksdb::kDefaultColumnFamilyName, std::move(cf_options)});
+        for (auto& column_descriptor : column_descriptors) {
+            column_descriptor.options.comparator = rocksdb::BytewiseComparator();
+            column_descriptor.options.merge_operator = db_ptr->collection_options.merge_operator;
+        }
+
+        auto ttls = load_ttls(root);
+        for (auto& column_descriptor : column_descriptors) {
+            auto ttl_it = ttls.find(column_descriptor.name);
+            if (ttl_it == ttls.end())
+                continue;
+            expire_on_compaction(column_descriptor.options, ttl_it->second);
+        }
+
+        options.create_if_missing = true;
+        options.comparator = rocksdb::BytewiseComparator();
+        for (auto const& disk : config.data_directories)
+            options.db_paths.push_back({disk.path, disk.max_size});
+
+        rocks_native_t* native_db = nullptr;
+        rocksdb::OptimisticTransactionDBOptions txn_options;
+        status = rocks_native_t::Open(options, txn_options, root, column_descriptors, &db_ptr->columns, &native_db);
+        return_error_if_m(status.ok(), c.error, error_unknown_k, "Opening RocksDB with options");
+
+        db_ptr->native = std::unique_ptr<rocks_native_t>(native_db);
+        db_ptr->directory = root;
+        auto string_keyed = load_string_keyed(root);
+        for (rocks_collection_t* column : db_ptr->columns) {
+            if (auto ttl_it = ttls.find(column->GetName()); ttl_it != ttls.end())
+                db_ptr->ttls.set(column->GetID(), ttl_it->second);
+            if (string_keyed.count(column->GetName()))
+                db_ptr->string_keyed.set(column->GetID(), true);
+        }
+        if (db_ptr->writes_back())
+            db_ptr->flusher = std::thread(run_flushes, std::ref(*db_ptr));
+
+        register_threads(db_ptr.get(), config);
+        *c.db = db_ptr.release();
+    });
+}
+
+void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
+
+    ustore_snapshot_list_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count && c.ids, c.error, args_combo_k, "Need outputs!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    std::lock_guard<std::mutex> locker(db.mutex);
+    std::size_t snapshots_count = db.snapshots.size();
+    *c.count = static_cast<ustore_size_t>(snapshots_count);
+
+    auto ids = arena.alloc_or_dummy(snapshots_count, c.error, c.ids);
+    return_if_error_m(c.error);
+
+    std::size_t i = 0;
+    for (const auto& [id, _] : db.snapshots)
+        ids[i++] = id;
+}
+
+void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
+
+    ustore_snapshot_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    // Snapshots only cover the cold tier, so the preceding writes must reach it
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    safe_section("Flushing dirty values", c.error, [&] { flush_all(db, false, c.error); });
+    return_if_error_m(c.error);
+
+    std::lock_guard<std::mutex> locker(db.mutex);
+    rocks_snapshot_t* rocks_snapshot = nullptr;
+    safe_section("Allocating snapshot handle", c.error, [&] { rocks_snapshot = new rocks_snapshot_t(); });
+    return_if_error_m(c.error);
+
+    rocks_snapshot->snapshot = db.native->GetSnapshot();
+    if (!rocks_snapshot->snapshot)
+        *c.error = "Couldn't get a snapshot!";
+
+    *c.id = reinterpret_cast<std::size_t>(rocks_snapshot);
+    db.snapshots[*c.id] = rocks_snapshot;
+}
+
+void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
+
+    if (!c_ptr)
+        return;
+
+    ustore_snapshot_drop_t& c = *c_ptr;
+    if (!c.id)
+        return;
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c.id);
+    std::lock_guard<std::mutex> locker(db.mutex);
+    if (!db.snapshots.erase(reinterpret_cast<std::size_t>(c.id)))
+        return;
+    db.native->ReleaseSnapshot(snap_ptr->snapshot);
+    delete snap_ptr;
+}
+
+/**
+ * @brief Writes outside of transactions. With the "through" policy, or with merges, the batch
+ * reaches RocksDB first. Then the hot tier is updated under the same stripe locks.
+ * Merged keys are dropped from the hot tier, as their values are only resolved by RocksDB.
+ */
+void write_tiered( //
+    tiered_db_t& db,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_options_t const c_options,
+    ustore_error_t* c_error) noexcept(false) {
+
+    bool const safe = c_options & ustore_option_write_flush_k;
+    bool const merge = c_options & ustore_option_write_merge_k;
+    bool const back = db.writes_back() && !merge;
+
+    // Only the last update of a repeated key is kept, matching the RocksDB batches
+    std::vector<hot_entry_t> entries;
+    std::vector<collection_key_t> keys(places.size());
+    for (std::size_t i = 0; i != places.size(); ++i)
+        keys[i] = places[i].collection_key();
+    if (!merge) {
+        std::vector<std::size_t> order(places.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) noexcept {
+            return keys[a] < keys[b];
+        });
+        entries.reserve(places.size());
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            if (i + 1 != order.size() && keys[order[i + 1]] == keys[order[i]])
+                continue;
+            entries.emplace_back(keys[order[i]], contents[order[i]]);
+            entries.back().dirty = back;
+        }
+    }
+
+    std::vector<std::size_t> spaces(entries.size());
+    std::size_t dirty_bytes = 0;
+    {
+        stripes_lock_t lock {db, stripes_of(keys, keys.size())};
+        if (!back) {
+            // Merge operands apply on top of the flushed values
+            if (merge)
+                flush_keys(db, keys.data(), keys.data() + keys.size(), false, c_error);
+            return_if_error_m(c_error);
+
+            rocksdb::WriteOptions options;
+            options.sync = safe;
+            options.disableWAL = !safe;
+            rocksdb::WriteBatch batch;
+            for (std::size_t i = 0; i != places.size(); ++i) {
+                place_t place = places[i];
+                value_view_t content = contents[i];
+                auto collection = rocks_collection(db, place.collection);
+                auto encoded = db.encode(place.key);
+                auto key = to_slice(encoded);
+                auto status = !content ? batch.Delete(collection, key)
+                              : merge  ? batch.Merge(collection, key, to_slice(content))
+                                       : batch.Put(collection, key, to_slice(content));
+                if (export_error(status, c_error))
+                    return;
+            }
+            rocks_status_t status = db.native->Write(options, &batch);
+            if (export_error(status, c_error))
+                return;
+        }
+
+        if (merge)
+            invalidate(db, keys.data(), keys.data() + keys.size(), c_error);
+        else {
+            for (std::size_t i = 0; i != entries.size(); ++i) {
+                entries[i].version = ++db.versions;
+                spaces[i] = entries[i].space_usage();
+                dirty_bytes += back ? entries[i].value.size() : 0;
+            }
+            auto status = db.hot.upsert(std::make_move_iterator(entries.begin()),
+                                        std::make_move_iterator(entries.end()));
+            // RocksDB already has the new values, so the outdated cached ones must go
+            if (!status && !back) {
+                ustore_error_t ignored = nullptr;
+                invalidate(db, keys.data(), keys.data() + keys.size(), &ignored);
+            }
+            export_error_code(status, c_error);
+        }
+        lock.advance_generations();
+    }
+    return_if_error_m(c_error);
+
+    for (std::size_t i = 0; i != entries.size(); ++i)
+        db.recency.admit(entries[i].collection_key, spaces[i]);
+    if (back) {
+        mark_dirty(db, places, dirty_bytes);
+        if (safe)
+            flush_keys(db, keys.data(), keys.data() + keys.size(), true, c_error);
+        return_if_error_m(c_error);
+    }
+    demote(db, c_error);
+}
+
+void write_transactional( //
+    tiered_db_t& db,
+    tiered_txn_t& txn,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_options_t const c_options,
+    ustore_error_t* c_error) noexcept(false) {
+
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+    bool const merge = c_options & ustore_option_write_merge_k;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        place_t place = places[i];
+        value_view_t content = contents[i];
+        auto collection = rocks_collection(db, place.collection);
+        auto encoded = db.encode(place.key);
+        auto key = to_slice(encoded);
+        auto status = !content ? watch //
+                                     ? txn.native->Delete(collection, key)
+                                     : txn.native->DeleteUntracked(collection, key)
+                      : merge  ? watch //
+                                     ? txn.native->Merge(collection, key, to_slice(content))
+                                     : txn.native->MergeUntracked(collection, key, to_slice(content))
+                      : watch //
+                          ? txn.native->Put(collection, key, to_slice(content))
+                          : txn.native->PutUntracked(collection, key, to_slice(content));
+        if (export_error(status, c_error))
+            return;
+    }
+}
+
+void ustore_write(ustore_write_t* c_ptr) {
+
+    ustore_write_t& c = *c_ptr;
+    if (c.positions) {
+        // Positional writes come back here as merges of splice operands
+        linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+        return_if_error_m(c.error);
+        return write_spliced(c, arena);
+    }
+    operation_timer_t timer {operation_t::write_k, c.tasks_count, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    if (!c.tasks_count)
+        return;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
+    bits_view_t presences {c.presences};
+
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+
+    validate_write(c.transaction, places, contents, c.options, c.error);
+    return_if_error_m(c.error);
+
+    growing_tape_t stamped(arena);
+    ustore_bytes_cptr_t stamped_begin = nullptr;
+    if (db.ttls.any()) {
+        bool expiring = false;
+        for (std::size_t i = 0; i != places.size() && !expiring; ++i)
+            expiring = ttl_of(db, places[i].collection);
+        return_error_if_m(!expiring || !(c.options & ustore_option_write_merge_k),
+                          c.error,
+                          args_combo_k,
+                          "Can't merge into collections with a TTL");
+        if (expiring)
+            safe_section("Stamping deadlines", c.error, [&] {
+                auto ttl = [&](ustore_collection_t collection) noexcept {
+                    return ttl_of(db, collection);
+                };
+                stamp_deadlines(places, contents, ttl, stamped, stamped_begin, c.error);
+            });
+        return_if_error_m(c.error);
+    }
+
+    safe_section("Writing into tiers", c.error, [&] {
+        if (c.transaction)
+            write_transactional(db, *reinterpret_cast<tiered_txn_t*>(c.transaction), places, contents, c.options, c.error);
+        else
+            write_tiered(db, places, contents, c.options, c.error);
+    });
+}
+
+/**
+ * @brief Serves the lookups from the hot tier, fetching and promoting the missing keys from RocksDB.
+ */
+template <typename value_enumerator_at>
+void read_tiered( //
+    tiered_db_t& db,
+    places_arg_t const& places,
+    value_enumerator_at enumerator,
+    ustore_error_t* c_error) noexcept(false) {
+
+    rocksdb::ReadOptions options;
+    deadline_t const now = db.ttls.any() ? now_ms() : 0;
+    auto visible = [&](std::size_t i, value_view_t stored) noexcept {
+        return now && ttl_of(db, places[i].collection) ? unexpired(stored, now) : stored;
+    };
+
+    std::size_t hits = 0;
+    std::string fetched;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        collection_key_t key = places[i].collection_key();
+
+        // Observed before the lookup, so that no write can slip in between the two tiers
+        std::uint64_t const generation = db.generations[stripe_of(key)].load(std::memory_order_acquire);
+        bool hit = false;
+        auto status = db.hot.find(
+            key,
+            [&](hot_entry_t const& entry) noexcept(false) {
+                hit = true;
+                enumerator(i, visible(i, entry.view()));
+            },
+            []() noexcept {});
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        if (hit) {
+            db.recency.touch(key);
+            ++hits;
+            continue;
+        }
+
+        auto encoded = db.encode(key.key);
+        rocks_status_t rocks_status =
+            db.native->Get(options, rocks_collection(db, key.collection), to_slice(encoded), &fetched);
+        bool const found = !rocks_status.IsNotFound();
+        if (found && export_error(rocks_status, c_error))
+            return;
+
+        value_view_t value = found ? value_view_t {std::string_view(fetched)} : value_view_t {};
+        enumerator(i, visible(i, value));
+        return_if_error_m(c_error);
+        promote(db, key, generation, hot_entry_t {key, value});
+    }
+
+    db.hits += hits;
+    db.misses += places.size() - hits;
+    demote(db, c_error);
+}
+
+/**
+ * @brief Reads straight from RocksDB, within a transaction or a snapshot.
+ */
+template <typename value_enumerator_at>
+void read_cold( //
+    tiered_db_t& db,
+    tiered_txn_t* txn_ptr,
+    rocks_snapshot_t* snap_ptr,
+    places_arg_t const& places,
+    ustore_options_t const c_options,
+    value_enumerator_at enumerator,
+    ustore_error_t* c_error) noexcept(false) {
+
+    rocksdb::ReadOptions options;
+    if (snap_ptr) {
+        std::unique_lock _ {db.mutex};
+        auto it = db.snapshots.find(reinterpret_cast<std::size_t>(snap_ptr));
+        return_error_if_m(it != db.snapshots.end(), c_error, args_wrong_k, "The snapshot does'nt exist!");
+        options.snapshot = snap_ptr->snapshot;
+    }
+
+    bool const watch = !(c_options & ustore_option_transaction_dont_watch_k);
+    std::vector<collection_key_t> keys(places.size());
+    for (std::size_t i = 0; i != places.size(); ++i)
+        keys[i] = places[i].collection_key();
+
+    // Transactions must observe the values, acknowledged before them
+    if (txn_ptr) {
+        flush_keys(db, keys.data(), keys.data() + keys.size(), false, c_error);
+        return_if_error_m(c_error);
+        if (watch && db.writes_back())
+            txn_ptr->watched.insert(txn_ptr->watched.end(), keys.begin(), keys.end());
+    }
+
+    deadline_t const now = db.ttls.any() ? now_ms() : 0;
+    rocks_value_t value;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        place_t place = places[i];
+        auto col = rocks_collection(db, place.collection);
+        auto encoded = db.encode(place.key);
+        auto key = to_slice(encoded);
+        value.Reset();
+        rocks_status_t status = //
+            txn_ptr             //
+                ? watch         //
+                      ? txn_ptr->native->GetForUpdate(options, col, key, &value)
+                      : txn_ptr->native->Get(options, col, key, &value)
+                : db.native->Get(options, col, key, &value);
+        if (status.IsNotFound()) {
+            enumerator(i, value_view_t {});
+            continue;
+        }
+        if (export_error(status, c_error))
+            return;
+        value_view_t stored = to_view(value);
+        enumerator(i, now && ttl_of(db, place.collection) ? unexpired(stored, now) : stored);
+        return_if_error_m(c_error);
+    }
+}
+
+void ustore_read(ustore_read_t* c_ptr) {
+
+    ustore_read_t& c = *c_ptr;
+    if (deduplicates_reads(c))
+        return deduplicate_gather_join_scatter(c, [](ustore_read_t& unique) { ustore_read(&unique); });
+    operation_timer_t timer {operation_t::read_k, c.tasks_count, c.error};
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    if (!c.tasks_count)
+        return;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c.transaction);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c.snapshot);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
+    slices_arg_t slices {slices_starts, slices_lengths, c.values_limit};
+    validate_read(c.transaction, places, c.options, c.error);
+    return_if_error_m(c.error);
+
+    growing_tape_t tape(arena);
+    tape.reserve(places.size(), c.error);
+    return_if_error_m(c.error);
+    auto enumerator = [&](std::size_t i, value_view_t value) {
+        tape.push_back(slices.apply(i, value), c.error);
+    };
+
+    safe_section("Reading from tiers", c.error, [&] {
+        if (txn_ptr || snap_ptr)
+            read_cold(db, txn_ptr, snap_ptr, places, c.options, enumerator, c.error);
+        else
+            read_tiered(db, places, enumerator, c.error);
+    });
+    return_if_error_m(c.error);
+
+    if (c.presences)
+        *c.presences = tape.presences().get();
+    if (c.offsets)
+        *c.offsets = tape.offsets().begin().get();
+    if (c.lengths)
+        *c.lengths = tape.lengths().begin().get();
+    if (c.values)
+        *c.values = (ustore_bytes_ptr_t)tape.contents().begin().get();
+}
+
+void ustore_scan(ustore_scan_t* c_ptr) {
+
+    ustore_scan_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::scan_k, c.tasks_count, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c.transaction);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c.snapshot);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    scans_arg_t tasks {collections, start_keys, limits, c.tasks_count};
+
+    validate_scan(c.transaction, tasks, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Only RocksDB keeps the keys ordered, so the dirty ones are flushed into it first
+    if (!snap_ptr)
+        safe_section("Flushing dirty values", c.error, [&] { flush_all(db, false, c.error); });
+    return_if_error_m(c.error);
+
+    auto offsets = arena.alloc_or_dummy(tasks.count + 1, c.error, c.offsets);
+    return_if_error_m(c.error);
+    auto counts = arena.alloc_or_dummy(tasks.count, c.error, c.counts);
+    return_if_error_m(c.error);
+
+    auto total_keys = reduce_n(tasks.limits, tasks.count, 0ul);
+    auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
+    return_if_error_m(c.error);
+
+    bool const export_values = c.values;
+    growing_tape_t tape(arena);
+    if (export_values) {
+        tape.reserve(total_keys, c.error);
+        return_if_error_m(c.error);
+    }
+
+    // Scans are not promoted, to keep the hot tier from being flushed by a single traversal
+    rocksdb::ReadOptions options;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+    if (snap_ptr)
+        options.snapshot = snap_ptr->snapshot;
+
+    for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
+        scan_t task = tasks[i];
+        auto collection = rocks_collection(db, task.collection);
+
+        std::unique_ptr<rocksdb::Iterator> it;
+        safe_section("Creating a RocksDB iterator", c.error, [&] {
+            it = txn_ptr ? std::unique_ptr<rocksdb::Iterator>(txn_ptr->native->GetIterator(options, collection))
+                         : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
+        });
+        return_if_error_m(c.error);
+
+        offsets[i] = keys_output - *c.keys;
+        std::uint64_t const ttl = ttl_of(db, task.collection);
+        deadline_t const now = ttl ? now_ms() : 0;
+
+        ustore_size_t j = 0;
+        it->Seek(to_slice(db.encode(task.min_key)));
+        while (it->Valid() && j != task.limit) {
+            value_view_t value = to_view(it->value());
+            if (ttl && !(value = unexpired(value, now))) {
+                it->Next();
+                continue;
+            }
+            *keys_output = db.decode(it->key());
+            if (export_values) {
+                tape.push_back(value, c.error);
+                return_if_error_m(c.error);
+            }
+            ++keys_output;
+            ++j;
+            it->Next();
+        }
+
+        counts[i] = j;
+    }
+
+    offsets[tasks.size()] = keys_output - *c.keys;
+
+    if (export_values) {
+        *c.values = (ustore_bytes_ptr_t)tape.contents().begin().get();
+        if (c.values_offsets)
+            *c.values_offsets = tape.offsets().begin().get();
+        if (c.values_lengths)
+            *c.values_lengths = tape.lengths().begin().get();
+    }
+}
+
+void ustore_sample(ustore_sample_t* c_ptr) {
+
+    ustore_sample_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::sample_k, c.tasks_count, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    if (!c.tasks_count)
+        return;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    tiered_txn_t* txn_ptr = reinterpret_cast<tiered_txn_t*>(c.transaction);
+    rocks_snapshot_t* snap_ptr = reinterpret_cast<rocks_snapshot_t*>(c.snapshot);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.count_limits, c.count_limits_stride};
+    sample_args_t samples {collections, lens, c.tasks_count};
+
+    if (!snap_ptr)
+        safe_section("Flushing dirty values", c.error, [&] { flush_all(db, false, c.error); });
+    return_if_error_m(c.error);
+
+    auto offsets = arena.alloc_or_dummy(samples.count + 1, c.error, c.offsets);
+    return_if_error_m(c.error);
+    auto counts = arena.alloc_or_dummy(samples.count, c.error, c.counts);
+    return_if_error_m(c.error);
+
+    auto total_keys = reduce_n(samples.limits, samples.count, 0ul);
+    auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
+    return_if_error_m(c.error);
+
+    rocksdb::ReadOptions options;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+    if (snap_ptr)
+        options.snapshot = snap_ptr->snapshot;
+
+    for (std::size_t task_idx = 0; task_idx != samples.count; ++task_idx) {
+        sample_arg_t task = samples[task_idx];
+        auto collection = rocks_collection(db, task.collection);
+        offsets[task_idx] = keys_output - *c.keys;
+
+        std::unique_ptr<rocksdb::Iterator> it;
+        safe_section("Creating a RocksDB iterator", c.error, [&] {
+            it = txn_ptr ? std::unique_ptr<rocksdb::Iterator>(txn_ptr->native->GetIterator(options, collection))
+                         : std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(options, collection));
+        });
+        return_if_error_m(c.error);
+
+        ptr_range_gt<ustore_key_t> sampled_keys(keys_output, task.limit);
+        std::size_t sampled = 0;
+        if (std::uint64_t const ttl = ttl_of(db, task.collection); ttl) {
+            deadline_t const now = now_ms();
+            auto is_visible = [&](auto const& iterator) noexcept {
+                return !is_expired(to_view(iterator->value()), now);
+            };
+            sampled = reservoir_sample_iterator(it, sampled_keys, db.key_encoding, c.error, is_visible);
+        }
+        else
+            sampled = reservoir_sample_iterator(it, sampled_keys, db.key_encoding, c.error);
+        return_if_error_m(c.error);
+
+        counts[task_idx] = static_cast<ustore_length_t>(sampled);
+        keys_output += sampled;
+    }
+    offsets[samples.count] = keys_output - *c.keys;
+}
+
+void ustore_measure(ustore_measure_t* c_ptr) {
+
+    ustore_measure_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::measure_k, c.tasks_count, c.error};
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    auto min_cardinalities = arena.alloc_or_dummy(c.tasks_count, c.error, c.min_cardinalities);
+    auto max_cardinalities = arena.alloc_or_dummy(c.tasks_count, c.error, c.max_cardinalities);
+    auto min_value_bytes = arena.alloc_or_dummy(c.tasks_count, c.error, c.min_value_bytes);
+    auto max_value_bytes = arena.alloc_or_dummy(c.tasks_count, c.error, c.max_value_bytes);
+    auto min_space_usages = arena.alloc_or_dummy(c.tasks_count, c.error, c.min_space_usages);
+    auto max_space_usages = arena.alloc_or_dummy(c.tasks_count, c.error, c.max_space_usages);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+    rocksdb::SizeApproximationOptions options;
+
+    for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
+        auto collection = rocks_collection(db, collections[i]);
+        encoded_key_t const min_key = db.encode(start_keys[i]);
+        encoded_key_t const max_key = db.encode(end_keys[i]);
+        rocksdb::Range range(to_slice(min_key), to_slice(max_key));
+        std::uint64_t approximate_size = 0;
+        std::uint64_t keys_count = 0;
+        std::uint64_t sst_files_size = 0;
+        safe_section("Retrieving properties from RocksDB", c.error, [&] {
+            rocks_status_t status = db.native->GetApproximateSizes(options, collection, &range, 1, &approximate_size);
+            if (export_error(status, c.error))
+                return;
+            db.native->GetIntProperty(collection, "rocksdb.estimate-num-keys", &keys_count);
+            db.native->GetIntProperty(collection, "rocksdb.total-sst-files-size", &sst_files_size);
+        });
+        return_if_error_m(c.error);
+
+        // Dirty values may not have reached RocksDB yet
+        min_cardinalities[i] = static_cast<ustore_size_t>(0);
+        max_cardinalities[i] = static_cast<ustore_size_t>(keys_count);
+        min_value_bytes[i] = static_cast<ustore_size_t>(0);
+        max_value_bytes[i] = std::numeric_limits<ustore_size_t>::max();
+        min_space_usages[i] = approximate_size;
+        max_space_usages[i] = sst_files_size + db.recency.bytes();
+    }
+}
+
+void ustore_collection_create(ustore_collection_create_t* c_ptr) {
+
+    ustore_collection_create_t& c = *c_ptr;
+    auto name_len = c.name ? std::strlen(c.name) : 0;
+    return_error_if_m(name_len, c.error, args_wrong_k, "Default collection is always present");
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    std::uint64_t ttl_ms = 0;
+    parse_ttl(c.config, ttl_ms, c.error);
+    return_if_error_m(c.error);
+    bool string_keys = false;
+    parse_string_keys(c.config, string_keys, c.error);
+    return_if_error_m(c.error);
+    return_error_if_m(!ttl_ms || !string_keys, c.error, args_combo_k, "Collections with string keys can't expire");
+
+    std::unique_lock _ {db.mutex};
+    for (auto handle : db.columns)
+        return_error_if_m(handle->GetName() != c.name, c.error, args_wrong_k, "Such collection already exists!");
+
+    rocksdb::ColumnFamilyOptions options = db.collection_options;
+    if (ttl_ms)
+        expire_on_compaction(options, ttl_ms);
+
+    rocks_collection_t* collection = nullptr;
+    rocks_status_t status = db.native->CreateColumnFamily(options, c.name, &collection);
+    if (export_error(status, c.error))
+        return;
+    safe_section("Registering the collection", c.error, [&] { db.columns.push_back(collection); });
+    return_if_error_m(c.error);
+    *c.id = reinterpret_cast<ustore_collection_t>(collection);
+
+    if (ttl_ms)
+        safe_section("Persisting the TTL", c.error, [&] {
+            db.ttls.set(collection->GetID(), ttl_ms);
+            auto ttls = load_ttls(db.directory);
+            ttls[c.name] = ttl_ms;
+            save_ttls(db.directory, ttls);
+        });
+    if (string_keys)
+        safe_section("Persisting the kind of keys", c.error, [&] {
+            db.string_keyed.set(collection->GetID(), true);
+            auto string_keyed = load_string_keyed(db.directory);
+            string_keyed.insert(c.name);
+            save_string_keyed(db.directory, string_keyed);
+        });
+}
+
+/**
+ * @brief Removes the entries of a collection from both tiers, holding all the stripes,
+ * so that no lookup can promote their older values back.
+ */
+void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
+
+    ustore_collection_drop_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    bool const drop_handle = c.mode == ustore_drop_keys_vals_handle_k;
+    return_error_if_m(c.id != ustore_collection_main_k || !drop_handle,
+                      c.error,
+                      args_combo_k,
+                      "Default collection can't be invalidated.");
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    rocks_collection_t* collection = rocks_collection(db, c.id);
+
+    stripes_lock_t lock {db, all_stripes_k};
+    std::unique_lock flush_lock {db.flush_mutex};
+    auto status = db.hot.erase_range(c.id, c.id + 1, no_op_t {});
+    export_error_code(status, c.error);
+    return_if_error_m(c.error);
+    db.recency.forget(c.id);
+    lock.advance_generations();
+
+    rocksdb::WriteOptions options;
+    options.sync = true;
+
+    if (drop_handle) {
+        std::unique_lock _ {db.mutex};
+        auto it = std::find(db.columns.begin(), db.columns.end(), collection);
+        if (it == db.columns.end())
+            return;
+        std::string name = collection->GetName();
+        std::uint32_t const id = collection->GetID();
+        rocks_status_t status = db.native->DropColumnFamily(collection);
+        if (export_error(status, c.error))
+            return;
+        db.columns.erase(it);
+        if (db.ttls.find(id))
+            safe_section("Forgetting the TTL", c.error, [&] {
+                db.ttls.set(id, 0);
+                auto ttls = load_ttls(db.directory);
+                ttls.erase(name);
+                save_ttls(db.directory, ttls);
+            });
+        if (db.string_keyed.contains(id))
+            safe_section("Forgetting the kind of keys", c.error, [&] {
+                db.string_keyed.set(id, false);
+                auto string_keyed = load_string_keyed(db.directory);
+                string_keyed.erase(name);
+                save_string_keyed(db.directory, string_keyed);
+            });
+        return;
+    }
+
+    rocksdb::WriteBatch batch;
+    auto it = std::unique_ptr<rocksdb::Iterator>(db.native->NewIterator(rocksdb::ReadOptions(), collection));
+    for (it->SeekToFirst(); it->Valid(); it->Next())
+        c.mode == ustore_drop_keys_vals_k ? batch.Delete(collection, it->key())
+                                          : batch.Put(collection, it->key(), rocksdb::Slice());
+    export_error(db.native->Write(options, &batch), c.error);
+}
+
+void ustore_collection_list(ustore_collection_list_t* c_ptr) {
+
+    ustore_collection_list_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count && c.names, c.error, args_combo_k, "Need names and outputs!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    std::unique_lock _ {db.mutex};
+    std::size_t collections_count = db.columns.size() - 1;
+    *c.count = static_cast<ustore_size_t>(collections_count);
+
+    std::size_t strings_length = 0;
+    for (auto const& column : db.columns)
+        strings_length += column->GetName().size() + 1;
+
+    auto names = arena.alloc<char>(strings_length, c.error).begin();
+    *c.names = names;
+    return_if_error_m(c.error);
+
+    auto ids = arena.alloc_or_dummy(collections_count, c.error, c.ids);
+    return_if_error_m(c.error);
+    auto offs = arena.alloc_or_dummy(collections_count + 1, c.error, c.offsets);
+    return_if_error_m(c.error);
+
+    std::size_t i = 0;
+    for (auto const& column : db.columns) {
+        if (column->GetName() == rocksdb::kDefaultColumnFamilyName)
+            continue;
+
+        auto len = column->GetName().size();
+        std::memcpy(names, column->GetName().data(), len);
+        names[len] = '\0';
+        ids[i] = reinterpret_cast<ustore_collection_t>(column);
+        offs[i] = static_cast<ustore_length_t>(names - *c.names);
+        names += len + 1;
+        ++i;
+    }
+    offs[i] = static_cast<ustore_length_t>(names - *c.names);
+}
+
+void export_response(std::string const& str, ustore_database_control_t& c) noexcept {
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+    auto response = arena.alloc<char>(str.size() + 1, c.error).begin();
+    return_if_error_m(c.error);
+    std::memcpy(response, str.c_str(), str.size() + 1);
+    *c.response = response;
+}
+
+void ustore_database_control(ustore_database_control_t* c_ptr) {
+
+    ustore_database_control_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
+
+    *c.response = NULL;
+    if (control_metrics(c))
+        return;
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    std::string_view request {c.request};
+    std::string response;
+
+    if (request.rfind("rocksdb.", 0) == 0) {
+        bool found = false;
+        safe_section("Querying RocksDB property", c.error, [&] {
+            found = db.native->GetProperty(rocksdb::Slice(request.data(), request.size()), &response);
+        });
+        return_if_error_m(c.error);
+        return_error_if_m(found, c.error, args_wrong_k, "Unknown RocksDB property");
+        return export_response(response, c);
+    }
+
+    if (request == "flush") {
+        safe_section("Flushing dirty values", c.error, [&] { flush_all(db, true, c.error); });
+        return;
+    }
+
+    if (request == "usage") {
+        safe_section("Measuring usage", c.error, [&] {
+            json_t usage = json_t::object();
+            usage["hot-bytes"] = db.recency.bytes();
+            usage["hot-capacity"] = db.options.memory_limit;
+            usage["hot-hits"] = db.hits.load();
+            usage["hot-misses"] = db.misses.load();
+            usage["promotions"] = db.promotions.load();
+            usage["demotions"] = db.demotions.load();
+            usage["flushes"] = db.flushes.load();
+            std::uint64_t value = 0;
+            if (db.native->GetAggregatedIntProperty("rocksdb.cur-size-all-mem-tables", &value))
+                usage["cur-size-all-mem-tables"] = value;
+            response = usage.dump();
+        });
+        return_if_error_m(c.error);
+        return export_response(response, c);
+    }
+
+    log_error_m(c.error,
+                missing_feature_k,
+                "Only \"usage\", \"flush\", \"metrics\" and \"rocksdb.*\" controls are supported in this "
+                "implementation!");
+}
+
+void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
+
+    ustore_transaction_init_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    validate_transaction_begin(c.transaction, c.options, c.error);
+    return_if_error_m(c.error);
+
+    bool const safe = c.options & ustore_option_write_flush_k;
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    tiered_txn_t* txn_ptr = *reinterpret_cast<tiered_txn_t**>(c.transaction);
+    if (!txn_ptr) {
+        safe_section("Allocating transaction handle", c.error, [&] { txn_ptr = new tiered_txn_t; });
+        return_if_error_m(c.error);
+    }
+
+    rocksdb::OptimisticTransactionOptions txn_options;
+    txn_options.set_snapshot = false;
+    rocksdb::WriteOptions options;
+    options.sync = safe;
+    options.disableWAL = !safe;
+    txn_ptr->native = db.native->BeginTransaction(options, txn_options, txn_ptr->native);
+    txn_ptr->watched.clear();
+    *c.transaction = txn_ptr;
+    if (!txn_ptr->native)
+        *c.error = "Couldn't start a transaction!";
+}
+
+void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
+    ustore_transaction_commit_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::commit_k, 1, c.error};
+    if (!c.transaction)
+        return;
+
+    validate_transaction_commit(c.transaction, c.options, c.error);
+    return_if_error_m(c.error);
+
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c.db);
+    tiered_txn_t& txn = *reinterpret_cast<tiered_txn_t*>(c.transaction);
+
+    // The write batch is cleared on commit, so the updated keys are collected beforehand
+    std::vector<collection_key_t> written;
+    std::vector<collection_key_t> touched;
+    safe_section("Collecting written keys", c.error, [&] {
+        written_keys_gt<tiered_db_t> handler {db};
+        if (export_error(txn.native->GetWriteBatch()->GetWriteBatch()->Iterate(&handler), c.error))
+            return;
+        written.reserve(handler.keys.size());
+        for (auto const& [collection_id, key] : handler.keys)
+            written.emplace_back(collection_with_id(db, collection_id), key);
+        touched = written;
+        touched.insert(touched.end(), txn.watched.begin(), txn.watched.end());
+    });
+    return_if_error_m(c.error);
+
+    // With the "back" policy, RocksDB only detects the conflicts with the flushed values,
+    // so the dirty ones are flushed, while the stripes keep new writes from racing the commit
+    stripes_lock_t lock {db, stripes_of(touched, touched.size())};
+    safe_section("Flushing dirty values", c.error, [&] {
+        flush_keys(db, touched.data(), touched.data() + touched.size(), false, c.error);
+    });
+    return_if_error_m(c.error);
+
+    if (c.sequence_number)
+        db.mutex.lock();
+    rocks_status_t status = txn.native->Commit();
+    export_error(status, c.error);
+    if (c.sequence_number) {
+        if (status.ok())
+            *c.sequence_number = db.native->GetLatestSequenceNumber();
+        db.mutex.unlock();
+    }
+    if (!status.ok())
+        return;
+
+    invalidate(db, written.data(), written.data() + written.size(), c.error);
+    lock.advance_generations();
+}
+
+void ustore_arena_free(ustore_arena_t c_arena) {
+    clear_linked_memory(c_arena);
+}
+
+void ustore_transaction_free(ustore_transaction_t c_transaction) {
+    if (!c_transaction)
+        return;
+    delete reinterpret_cast<tiered_txn_t*>(c_transaction);
+}
+
+void ustore_database_free(ustore_database_t c_db) {
+    if (!c_db)
+        return;
+    threads_registry_t::global().forget(c_db);
+    tiered_db_t& db = *reinterpret_cast<tiered_db_t*>(c_db);
+    stop_flushes(db);
+    ustore_error_t c_error = nullptr;
+    safe_section("Flushing dirty values", &c_error, [&] { flush_all(db, true, &c_error); });
+    if (c_error)
+        log_warning_m("Dirty values were lost on close: %s\n", c_error);
+    for (auto& [id, snap_ptr] : db.snapshots) {
+        db.native->ReleaseSnapshot(snap_ptr->snapshot);
+        delete snap_ptr;
+    }
+    for (rocks_collection_t* cf : db.columns)
+        db.native->DestroyColumnFamilyHandle(cf);
+    db.native.reset();
+    delete &db;
+}
+
+void ustore_error_free(ustore_error_t const) {
+}
@@ -7,10 +7,17 @@
  * It keeps all the pairs sorted and is pretty fast for a BST-based container.
  */
 
-#include <stdio.h> // Saving/reading from disk
+#include <stdio.h>    // Saving/reading from disk
+#include <fcntl.h>    // `open` sealed collections
+#include <sys/mman.h> // `mmap` sealed collections
+#include <sys/stat.h> // `fstat` to size the mappings
+#include <unistd.h>   // `close` files
 
 #include <map>
+#include <array>
 #include <vector>
+#include <optional>
+#include <algorithm>  // `std::sort`
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -21,6 +28,8 @@
 #include <atomic>     // Thread-safe generation counters
 #include <filesystem> // Enumerating the directory
 #include <fstream>    // Passing file contents to JSON parser
+#include <thread>     // Persisting collections in parallel
+#include <condition_variable> // Waking up the checkpoints thread
 
 // TODO: These alternative containers need further testing:
 // #include <ucset/consistent_avl.hpp> // `ucset::consistent_avl_gt`
@@ -29,15 +38,26 @@
 #include <ucset/locked.hpp>         // `ucset::locked_gt`
 
 #include <nlohmann/json.hpp>       // `nlohmann::json`
+#include <arrow/api.h>             // `arrow::Table`
 #include <arrow/io/file.h>         // `arrow::io::ReadableFile`
-#include <parquet/stream_reader.h> // `parquet::StreamReader`
-#include <parquet/stream_writer.h> // `parquet::StreamWriter`
+#include <parquet/arrow/reader.h>  // `parquet::arrow::FileReader`
+#include <parquet/arrow/writer.h>  // `parquet::arrow::FileWriter`
 
 #include "ustore/db.h"
 #include "helpers/file.hpp"
 #include "helpers/linked_memory.hpp" // `linked_memory_t`
 #include "helpers/linked_array.hpp"  // `unintialized_vector_gt`
+#include "helpers/slab_allocator.hpp" // `slab_allocator_t`
+#include "helpers/sampling.hpp"       // `reservoir_sampler_gt`
+#include "helpers/write_ahead_log.hpp" // `write_ahead_log_t`
 #include "helpers/config_loader.hpp" // `config_loader_t`
+#include "helpers/threads.hpp"       // `threads_registry_t`
+#include "helpers/merge.hpp"         // `merge_operand`
+#include "helpers/metrics.hpp"       // `operation_timer_t`
+#include "helpers/expiration.hpp"    // `expiration_wheel_gt`
+#include "helpers/statistics.hpp"    // `statistics_gt`
+#include "helpers/string_keys.hpp"   // `read_strings`
+#include "helpers/algorithm.hpp"     // `deduplicate_gather_join_scatter`
 #include "ustore/cpp/ranges_args.hpp"   // `places_arg_t`
 
 /*********************************************************/
@@ -49,7 +69,7 @@ ustore_length_t const ustore_length_missing_k = std::numeric_limits<ustore_lengt
 ustore_key_t const ustore_key_unknown_k = std::numeric_limits<ustore_key_t>::max();
 bool const ustore_supports_transactions_k = true;
 bool const ustore_supports_named_collections_k = true;
-bool const ustore_supports_snapshots_k = false;
+bool const ustore_supports_snapshots_k = true;
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -62,17 +82,50 @@ using namespace unum;
 namespace stdfs = std::filesystem;
 using json_t = nlohmann::json;
 
-using blob_allocator_t = std::allocator<byte_t>;
+/**
+ * @brief What to do with writes, that would exceed the `memory_limit`.
+ */
+enum memory_policy_t {
+    /** @brief Fail the write with an "out of memory" error. */
+    memory_policy_reject_k,
+    /** @brief Persist the least recently used collections and release them from memory. */
+    memory_policy_evict_k,
+};
 
 struct ucset_options_t {
     bool encryption = false;
     bool compression = false;
+    /** @brief Maximum number of bytes used by the values, zero means unlimited. */
     size_t memory_limit = 0;
+    memory_policy_t memory_policy = memory_policy_reject_k;
+    /** @brief Number of independently locked hash-partitions of the pairs. */
+    size_t partitions = 1;
+    /** @brief Log every update before acknowledging it, instead of only dumping the state on close. */
+    bool write_ahead_log = true;
+    /** @brief Size of the log, after which the modified collections are persisted and the log is truncated. */
+    size_t checkpoint_interval = 64ul * 1024ul * 1024ul;
+    /**
+     * @brief Persist collections as sealed files instead of Parquet, and serve reads straight
+     * from their memory mappings, until the first update. Files of the other format are ignored.
+     */
+    bool sealed_files = false;
+    /**
+     * @brief Periodically relocate the values out of sparsely occupied slabs in the background,
+     * returning those to the system. The "compact" control runs the same pass on demand.
+     */
+    bool compaction = false;
 };
 
+/**
+ * @brief Values up to this size are stored inside the `pair_t` itself,
+ * avoiding the allocation and the pointer chase.
+ */
+constexpr std::size_t pair_inline_capacity_k = 16;
+
 struct pair_t {
     collection_key_t collection_key;
     value_view_t range;
+    byte_t inline_value[pair_inline_capacity_k];
 
     pair_t() = default;
     pair_t(pair_t const&) = delete;
@@ -80,33 +133,68 @@ struct pair_t {
 
     pair_t(collection_key_t collection_key) noexcept : collection_key(collection_key) {}
 
-    pair_t(collection_key_t collection_key, value_view_t other, ustore_error_t* c_error) noexcept
+    /**
+     * @brief Copies the `other` value into memory of the `allocator` of the database.
+     * Pairs don't keep a reference to it, as the allocator is found by the address of the value.
+     */
+    pair_t(collection_key_t collection_key,
+           value_view_t other,
+           slab_allocator_t& allocator,
+           ustore_error_t* c_error) noexcept
         : collection_key(collection_key) {
-        if (other.size()) {
-            auto begin = blob_allocator_t {}.allocate(other.size());
+        if (other.size() > pair_inline_capacity_k) {
+            auto begin = allocator.allocate(other.size());
             return_error_if_m(begin != nullptr, c_error, out_of_memory_k, "Failed to copy a blob");
             range = {begin, other.size()};
             std::memcpy(begin, other.begin(), other.size());
         }
+        else if (other.size()) {
+            std::memcpy(inline_value, other.begin(), other.size());
+            range = {inline_value, other.size()};
+        }
         else
             range = other;
     }
 
     ~pair_t() noexcept {
-        if (range.size())
-            blob_allocator_t {}.deallocate((byte_t*)range.data(), range.size());
+        if (range.size() && !is_inline())
+            slab_allocator_t::owner_of(range.data(), range.size()).deallocate((byte_t*)range.data(), range.size());
         range = {};
     }
 
     pair_t(pair_t&& other) noexcept
-        : collection_key(other.collection_key), range(std::exchange(other.range, value_view_t {})) {}
+        : collection_key(other.collection_key), range(std::exchange(other.range, value_view_t {})) {
+        if (range.data() == other.inline_value) {
+            std::memcpy(inline_value, other.inline_value, range.size());
+            range = {inline_value, range.size()};
+        }
+    }
 
     pair_t& operator=(pair_t&& other) noexcept {
+        bool const was_inline = is_inline();
+        bool const other_was_inline = other.is_inline();
         std::swap(collection_key, other.collection_key);
         std::swap(range, other.range);
+        std::swap(inline_value, other.inline_value);
+        if (other_was_inline)
+            range = {inline_value, range.size()};
+        if (was_inline)
+            other.range = {other.inline_value, other.range.size()};
         return *this;
     }
 
+    bool is_inline() const noexcept { return range.size() && range.data() == inline_value; }
+
+    /** @brief Memory occupied by the pair, including the value and its rounding to slab classes. */
+    std::size_t space_usage() const noexcept {
+        return sizeof(pair_t) + (range.size() && !is_inline() ? slab_allocator_t::capacity_for(range.size()) : 0);
+    }
+
+    /** @brief Memory, that a pair with a value of this `length` would occupy. */
+    static std::size_t space_usage_for(std::size_t length) noexcept {
+        return sizeof(pair_t) + (length > pair_inline_capacity_k ? slab_allocator_t::capacity_for(length) : 0);
+    }
+
     operator collection_key_t() const noexcept { return collection_key; }
     explicit operator bool() const noexcept { return range; }
 };
@@ -124,14 +212,592 @@ struct pair_compare_t {
 
 // using ucset_t = ucset_gt<pair_t, pair_compare_t>;
 // using ucset_t = consistent_avl_gt<pair_t, pair_compare_t>;
-// using ucset_t = partitioned_gt< //
-//     ucset_gt<pair_t, pair_compare_t>,
-//     std::hash<collection_key_t>,
-//     std::shared_mutex,
-//     64>;
-using ucset_t = locked_gt<consistent_set_gt<pair_t, pair_compare_t>, std::shared_mutex>;
-using transaction_t = typename ucset_t::transaction_t;
-using generation_t = typename ucset_t::generation_t;
+using partition_t = locked_gt<consistent_set_gt<pair_t, pair_compare_t>, std::shared_mutex>;
+using partition_transaction_t = typename partition_t::transaction_t;
+using generation_t = typename partition_t::generation_t;
+
+inline std::size_t partition_of(collection_key_t const& key, std::size_t partitions_count) noexcept {
+    return partitions_count == 1 ? 0 : collection_key_hash_t {}(key) % partitions_count;
+}
+
+/**
+ * @brief Finds the smallest entry past `previous` among all the partitions.
+ * Entries removed between two lookups are skipped.
+ */
+template <typename partitions_at, typename callback_found_at, typename callback_missing_at>
+ucset::status_t merged_upper_bound(partitions_at& partitions,
+                                   collection_key_t previous,
+                                   callback_found_at&& callback_found,
+                                   callback_missing_at&& callback_missing) noexcept {
+
+    if (partitions.size() == 1)
+        return partitions[0].upper_bound(previous, callback_found, callback_missing);
+
+    while (true) {
+        std::optional<collection_key_t> next;
+        for (auto& partition : partitions) {
+            auto status = partition.upper_bound(
+                previous,
+                [&](pair_t const& pair) noexcept {
+                    if (!next || pair.collection_key < *next)
+                        next = pair.collection_key;
+                },
+                []() noexcept {});
+            if (!status)
+                return status;
+        }
+        if (!next) {
+            callback_missing();
+            return {};
+        }
+
+        bool still_present = false;
+        auto found = [&](pair_t const& pair) noexcept {
+            still_present = true;
+            callback_found(pair);
+        };
+        auto status = partitions[partition_of(*next, partitions.size())].find(*next, found, []() noexcept {});
+        if (!status || still_present)
+            return status;
+        previous = *next;
+    }
+}
+
+/**
+ * @brief Visits entries starting from `start` in sorted order, while the `callback` returns true.
+ * Every partition keeps its own "head", so a step costs two lookups, regardless of the number of partitions.
+ */
+template <typename partitions_at, typename callback_at>
+ucset::status_t merged_scan(partitions_at& partitions, collection_key_t start, callback_at&& callback) noexcept {
+
+    bool should_continue = true;
+    auto deliver = [&](pair_t const& pair) noexcept {
+        should_continue = callback(pair);
+    };
+    if (partitions.size() == 1) {
+        bool reached_end = false;
+        collection_key_t previous = start;
+        auto deliver_and_remember = [&](pair_t const& pair) noexcept {
+            previous = pair.collection_key;
+            deliver(pair);
+        };
+        auto status = partitions[0].find(start, deliver_and_remember, []() noexcept {});
+        while (status && should_continue && !reached_end)
+            status = partitions[0].upper_bound(previous, deliver_and_remember, [&]() noexcept { reached_end = true; });
+        return status;
+    }
+
+    std::vector<std::optional<collection_key_t>> heads(partitions.size());
+    auto advance = [&](std::size_t partition_idx, collection_key_t previous) noexcept {
+        heads[partition_idx].reset();
+        return partitions[partition_idx].upper_bound(
+            previous,
+            [&](pair_t const& pair) noexcept { heads[partition_idx] = pair.collection_key; },
+            []() noexcept {});
+    };
+    for (std::size_t partition_idx = 0; partition_idx != partitions.size(); ++partition_idx) {
+        auto status = partitions[partition_idx].find(
+            start,
+            [&](pair_t const& pair) noexcept { heads[partition_idx] = pair.collection_key; },
+            []() noexcept {});
+        if (status && !heads[partition_idx])
+            status = advance(partition_idx, start);
+        if (!status)
+            return status;
+    }
+
+    while (should_continue) {
+        std::size_t min_idx = partitions.size();
+        for (std::size_t partition_idx = 0; partition_idx != partitions.size(); ++partition_idx)
+            if (heads[partition_idx] && (min_idx == partitions.size() || *heads[partition_idx] < *heads[min_idx]))
+                min_idx = partition_idx;
+        if (min_idx == partitions.size())
+            break;
+
+        collection_key_t const head = *heads[min_idx];
+        auto status = partitions[min_idx].find(head, deliver, []() noexcept {});
+        if (status)
+            status = advance(min_idx, head);
+        if (!status)
+            return status;
+    }
+    return {};
+}
+
+/**
+ * @brief Visits entries starting from `start` in sorted order, while the `callback` returns true.
+ * Instead of descending the tree for every key, the key space is traversed in windows
+ * with a single `range()` call each. Windows start at the expected number of entries,
+ * as keys are unique integers, and grow geometrically over sparse regions.
+ * Empty windows are skipped with a single `upper_bound()`.
+ *
+ * With multiple partitions, the keys of every window are sorted and
+ * the entries are delivered with point lookups. That requires memory,
+ * so this function can throw.
+ */
+template <typename partitions_at, typename callback_at>
+ucset::status_t windowed_scan(partitions_at& partitions,
+                              collection_key_t start,
+                              std::size_t expected_count,
+                              callback_at&& callback) noexcept(false) {
+
+    constexpr std::size_t max_window_k = 1024 * 1024;
+    std::size_t window = std::clamp<std::size_t>(expected_count, 1, max_window_k);
+    std::vector<collection_key_t> window_keys;
+    bool const single = partitions.size() == 1;
+    bool should_continue = true;
+    auto deliver = [&](pair_t const& pair) noexcept {
+        should_continue = callback(pair);
+    };
+
+    while (should_continue) {
+        // Compute the window bounds in the unsigned space to avoid overflows
+        auto const first = static_cast<std::uint64_t>(start.key);
+        auto const last = static_cast<std::uint64_t>(std::numeric_limits<ustore_key_t>::max());
+        bool const is_last_window = last - first < window;
+        collection_key_t window_end = is_last_window //
+                                          ? collection_key_t {start.collection, std::numeric_limits<ustore_key_t>::max()}
+                                          : collection_key_t {start.collection, static_cast<ustore_key_t>(first + window)};
+
+        std::size_t window_count = 0;
+        if (single) {
+            auto status = partitions[0].range(start, window_end, [&](pair_t const& pair) noexcept {
+                if (should_continue)
+                    deliver(pair);
+                ++window_count;
+            });
+            if (!status)
+                return status;
+        }
+        else {
+            window_keys.clear();
+            for (auto& partition : partitions) {
+                auto status = partition.range(start, window_end, [&](pair_t const& pair) noexcept(false) {
+                    window_keys.push_back(pair.collection_key);
+                });
+                if (!status)
+                    return status;
+            }
+            std::sort(window_keys.begin(), window_keys.end());
+            for (auto it = window_keys.begin(); it != window_keys.end() && should_continue; ++it) {
+                auto& partition = partitions[partition_of(*it, partitions.size())];
+                auto status = partition.find(*it, deliver, []() noexcept {});
+                if (!status)
+                    return status;
+            }
+            window_count = window_keys.size();
+        }
+
+        // The right bound of the range is exclusive
+        if (is_last_window) {
+            if (should_continue) {
+                auto status = partitions[partition_of(window_end, partitions.size())].find( //
+                    window_end,
+                    deliver,
+                    []() noexcept {});
+                if (!status)
+                    return status;
+            }
+            break;
+        }
+        if (!should_continue)
+            break;
+
+        // Skip the gap until the next present entry
+        start = window_end;
+        if (!window_count) {
+            bool found = false;
+            collection_key_t previous {start.collection, static_cast<ustore_key_t>(first + window - 1)};
+            auto status = merged_upper_bound(
+                partitions,
+                previous,
+                [&](pair_t const& pair) noexcept {
+                    found = pair.collection_key.collection == start.collection;
+                    start = pair.collection_key;
+                },
+                []() noexcept {});
+            if (!status)
+                return status;
+            if (!found)
+                break;
+        }
+        window = std::min(window * 2, max_window_k);
+    }
+    return {};
+}
+
+/**
+ * @brief Splits the pairs between a configurable number of independently locked sets,
+ * by the hash of the key. So writes into different partitions don't contend for the same
+ * mutex. Point operations touch just one partition, while ordered traversals merge them.
+ *
+ * Writes spanning several partitions, like batches and transaction commits, are applied
+ * under an exclusive "commits" lock, while every other write holds it shared. Readers of
+ * multiple entries take it shared with @c lock_reads(), so they never observe such a write half-applied.
+ * With a single partition, the behavior matches a plain @c locked_gt and no extra lock is taken.
+ */
+class partitioned_t {
+    std::vector<partition_t> partitions_;
+    std::unique_ptr<std::shared_mutex> commits_mutex_ = std::make_unique<std::shared_mutex>();
+
+  public:
+    class transaction_t;
+    using shared_lock_t = std::shared_lock<std::shared_mutex>;
+    using unique_lock_t = std::unique_lock<std::shared_mutex>;
+
+    static std::optional<partitioned_t> make(std::size_t partitions_count) noexcept(false) {
+        partitioned_t result;
+        partitions_count = std::max<std::size_t>(partitions_count, 1);
+        result.partitions_.reserve(partitions_count);
+        for (std::size_t i = 0; i != partitions_count; ++i) {
+            auto maybe_partition = partition_t::make();
+            if (!maybe_partition)
+                return std::nullopt;
+            result.partitions_.push_back(std::move(maybe_partition).value());
+        }
+        return result;
+    }
+
+    std::size_t partitions_count() const noexcept { return partitions_.size(); }
+    partition_t& partition(collection_key_t const& key) noexcept {
+        return partitions_[partition_of(key, partitions_.size())];
+    }
+
+    /**
+     * @brief Blocks the writes spanning multiple partitions for the lifetime of the returned lock.
+     * Must not be held, while writing into the same set from the same thread.
+     */
+    shared_lock_t lock_reads() const noexcept {
+        return partitions_.size() == 1 ? shared_lock_t {} : shared_lock_t {*commits_mutex_};
+    }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t find(collection_key_t const& key,
+                         callback_found_at&& callback_found,
+                         callback_missing_at&& callback_missing) noexcept {
+        return partition(key).find(key, callback_found, callback_missing);
+    }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t upper_bound(collection_key_t const& key,
+                                callback_found_at&& callback_found,
+                                callback_missing_at&& callback_missing) noexcept {
+        return merged_upper_bound(partitions_, key, callback_found, callback_missing);
+    }
+
+    template <typename callback_at>
+    ucset::status_t scan(collection_key_t const& start, std::size_t expected_count, callback_at&& callback) noexcept(false) {
+        return windowed_scan(partitions_, start, expected_count, callback);
+    }
+
+    /**
+     * @brief Visits all the entries in the range, partition by partition, so not in sorted order.
+     */
+    template <typename lower_at, typename upper_at, typename callback_at>
+    ucset::status_t range(lower_at&& lower, upper_at&& upper, callback_at&& callback) noexcept {
+        for (partition_t& partition : partitions_)
+            if (auto status = partition.range(lower, upper, callback); !status)
+                return status;
+        return {};
+    }
+
+    template <typename lower_at, typename upper_at, typename callback_at>
+    ucset::status_t range(lower_at&& lower, upper_at&& upper, callback_at&& callback) const noexcept {
+        for (partition_t const& partition : partitions_)
+            if (auto status = partition.range(lower, upper, callback); !status)
+                return status;
+        return {};
+    }
+
+    template <typename lower_at, typename upper_at, typename callback_at>
+    ucset::status_t erase_range(lower_at&& lower, upper_at&& upper, callback_at&& callback) noexcept {
+        unique_lock_t lock = lock_commits(partitions_.size() > 1);
+        for (partition_t& partition : partitions_)
+            if (auto status = partition.erase_range(lower, upper, callback); !status)
+                return status;
+        return {};
+    }
+
+    ucset::status_t upsert(pair_t&& pair) noexcept {
+        shared_lock_t lock = lock_reads();
+        return partition(pair.collection_key).upsert(std::move(pair));
+    }
+
+    /**
+     * @brief Groups the pairs by partitions, submitting every group at once.
+     * The regrouping is stable, so the last of repeated keys still wins.
+     */
+    ucset::status_t upsert(pair_t* begin, pair_t* end) noexcept {
+        if (partitions_.size() == 1)
+            return partitions_[0].upsert(std::make_move_iterator(begin), std::make_move_iterator(end));
+
+        std::size_t const count = partitions_.size();
+        std::stable_sort(begin, end, [=](pair_t const& a, pair_t const& b) noexcept {
+            return partition_of(a.collection_key, count) < partition_of(b.collection_key, count);
+        });
+        bool const spans_partitions = begin != end && partition_of(begin->collection_key, count) !=
+                                                          partition_of(end[-1].collection_key, count);
+        shared_lock_t shared_lock = spans_partitions ? shared_lock_t {} : lock_reads();
+        unique_lock_t unique_lock = lock_commits(spans_partitions);
+        while (begin != end) {
+            std::size_t const partition_idx = partition_of(begin->collection_key, count);
+            pair_t* group_end = std::find_if(begin, end, [=](pair_t const& pair) noexcept {
+                return partition_of(pair.collection_key, count) != partition_idx;
+            });
+            auto status = partitions_[partition_idx].upsert(std::make_move_iterator(begin),
+                                                            std::make_move_iterator(group_end));
+            if (!status)
+                return status;
+            begin = group_end;
+        }
+        return {};
+    }
+
+    ucset::status_t clear() noexcept {
+        unique_lock_t lock = lock_commits(partitions_.size() > 1);
+        for (partition_t& partition : partitions_)
+            if (auto status = partition.clear(); !status)
+                return status;
+        return {};
+    }
+
+    std::optional<transaction_t> transaction() noexcept(false);
+
+    /**
+     * @brief Excludes all the readers and other writers, if the write spans several partitions.
+     */
+    unique_lock_t lock_commits(bool spans_partitions) noexcept {
+        return spans_partitions ? unique_lock_t {*commits_mutex_} : unique_lock_t {};
+    }
+};
+
+/**
+ * @brief Keeps a separate transaction for every partition, staging all of the
+ * touched ones before committing any, so conflicts are detected across partitions.
+ * Commits touching several partitions hold the exclusive lock of the @c partitioned_t,
+ * so they are atomic for the readers, that hold it shared.
+ */
+class partitioned_t::transaction_t {
+    partitioned_t* set_;
+    std::vector<partition_transaction_t> partitions_;
+    std::vector<bool> touched_;
+
+    partition_transaction_t& touch(collection_key_t const& key) noexcept {
+        std::size_t partition_idx = partition_of(key, partitions_.size());
+        touched_[partition_idx] = true;
+        return partitions_[partition_idx];
+    }
+
+  public:
+    transaction_t(partitioned_t& set, std::vector<partition_transaction_t>&& partitions) noexcept(false)
+        : set_(&set), partitions_(std::move(partitions)), touched_(partitions_.size()) {}
+
+    ucset::status_t watch(collection_key_t const& key) noexcept { return touch(key).watch(key); }
+    ucset::status_t watch(pair_t const& pair) noexcept { return touch(pair.collection_key).watch(pair); }
+    ucset::status_t upsert(pair_t&& pair) noexcept { return touch(pair.collection_key).upsert(std::move(pair)); }
+    ucset::status_t erase(collection_key_t const& key) noexcept { return touch(key).erase(key); }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t find(collection_key_t const& key,
+                         callback_found_at&& callback_found,
+                         callback_missing_at&& callback_missing) noexcept {
+        return partitions_[partition_of(key, partitions_.size())].find(key, callback_found, callback_missing);
+    }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t upper_bound(collection_key_t const& key,
+                                callback_found_at&& callback_found,
+                                callback_missing_at&& callback_missing) noexcept {
+        return merged_upper_bound(partitions_, key, callback_found, callback_missing);
+    }
+
+    /**
+     * @brief Merges the staged changes with the partitions, so can't use batched range visits.
+     */
+    template <typename callback_at>
+    ucset::status_t scan(collection_key_t const& start, std::size_t, callback_at&& callback) noexcept {
+        return merged_scan(partitions_, start, callback);
+    }
+
+    ucset::status_t reset() noexcept {
+        for (partition_transaction_t& partition : partitions_)
+            if (auto status = partition.reset(); !status)
+                return status;
+        std::fill(touched_.begin(), touched_.end(), false);
+        return {};
+    }
+
+    ucset::status_t stage() noexcept {
+        for (std::size_t i = 0; i != partitions_.size(); ++i) {
+            if (!touched_[i])
+                continue;
+            if (auto status = partitions_[i].stage(); !status) {
+                // Roll back the partitions staged so far
+                for (std::size_t j = 0; j != i; ++j)
+                    if (touched_[j])
+                        partitions_[j].reset();
+                return status;
+            }
+        }
+        return {};
+    }
+
+    ucset::status_t commit() noexcept {
+        bool const spans_partitions = std::count(touched_.begin(), touched_.end(), true) > 1;
+        shared_lock_t shared_lock = spans_partitions ? shared_lock_t {} : set_->lock_reads();
+        unique_lock_t unique_lock = set_->lock_commits(spans_partitions);
+        for (std::size_t i = 0; i != partitions_.size(); ++i)
+            if (touched_[i])
+                if (auto status = partitions_[i].commit(); !status)
+                    return status;
+        return {};
+    }
+
+    /**
+     * @brief Every partition counts generations separately, so the latest one among the touched is reported.
+     */
+    generation_t generation() const noexcept {
+        generation_t result {};
+        for (std::size_t i = 0; i != partitions_.size(); ++i)
+            if (touched_[i])
+                result = std::max(result, partitions_[i].generation());
+        return result;
+    }
+};
+
+std::optional<partitioned_t::transaction_t> partitioned_t::transaction() noexcept(false) {
+    std::vector<partition_transaction_t> transactions;
+    transactions.reserve(partitions_.size());
+    for (partition_t& partition : partitions_) {
+        auto maybe_transaction = partition.transaction();
+        if (!maybe_transaction)
+            return std::nullopt;
+        transactions.push_back(std::move(maybe_transaction).value());
+    }
+    return transaction_t {*this, std::move(transactions)};
+}
+
+using ucset_t = partitioned_t;
+
+struct transaction_t : public ucset_t::transaction_t {
+    /** @brief Serialized updates, that will be appended to the write-ahead log on commit. */
+    std::string redo;
+    /** @brief Keys to be updated on commit, whose current versions snapshots may need. */
+    std::vector<collection_key_t> updated_keys;
+
+    transaction_t(ucset_t::transaction_t&& base) noexcept : ucset_t::transaction_t(std::move(base)) {}
+};
+
+/**
+ * @brief Point-in-time view of the pairs, that neither copies the dataset nor blocks writers.
+ * The sets only keep the latest version of every pair, so before modifying a pair, writers
+ * preserve its current version in every snapshot, that doesn't have one yet.
+ */
+struct snapshot_t {
+    std::mutex mutex;
+    /** @brief Pairs as they were when the snapshot was created. Ones with NULL `range` were missing. */
+    std::map<collection_key_t, pair_t> versions;
+};
+
+/**
+ * @brief Exposes the same lookup interface as sets and transactions, preferring the versions
+ * preserved in a `snapshot_t` to the HEAD state. Those are checked while the HEAD partition
+ * is still locked, so the writers can't modify a pair in between.
+ */
+class snapshot_view_t {
+    ucset_t& head_;
+    snapshot_t& snapshot_;
+
+  public:
+    snapshot_view_t(ucset_t& head, snapshot_t& snapshot) noexcept : head_(head), snapshot_(snapshot) {}
+
+    ucset::status_t watch(collection_key_t const&) noexcept { return {}; }
+    ucset::status_t watch(pair_t const&) noexcept { return {}; }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t find(collection_key_t const& key,
+                         callback_found_at&& callback_found,
+                         callback_missing_at&& callback_missing) noexcept {
+        auto resolve = [&](pair_t const* head_pair) noexcept {
+            std::unique_lock _ {snapshot_.mutex};
+            auto it = snapshot_.versions.find(key);
+            pair_t const* visible = it != snapshot_.versions.end() ? &it->second : head_pair;
+            if (visible && *visible)
+                callback_found(*visible);
+            else
+                callback_missing();
+        };
+        return head_.find(
+            key,
+            [&](pair_t const& pair) noexcept { resolve(&pair); },
+            [&]() noexcept { resolve(nullptr); });
+    }
+
+    template <typename callback_found_at, typename callback_missing_at>
+    ucset::status_t upper_bound(collection_key_t previous,
+                                callback_found_at&& callback_found,
+                                callback_missing_at&& callback_missing) noexcept {
+        bool resolved = false;
+        // Picks the closest of the next HEAD entry and the next preserved version,
+        // skipping the versions of pairs, that were missing in the snapshot
+        auto resolve = [&](pair_t const* head_pair) noexcept {
+            std::unique_lock _ {snapshot_.mutex};
+            auto it = snapshot_.versions.upper_bound(previous);
+            pair_t const* visible = head_pair;
+            if (it != snapshot_.versions.end() && (!head_pair || it->first <= head_pair->collection_key))
+                visible = &it->second;
+            if (!visible)
+                resolved = true, callback_missing();
+            else if (*visible)
+                resolved = true, callback_found(*visible);
+            else
+                previous = visible->collection_key;
+        };
+        while (true) {
+            auto status = head_.upper_bound(
+                previous,
+                [&](pair_t const& pair) noexcept { resolve(&pair); },
+                [&]() noexcept { resolve(nullptr); });
+            if (!status || resolved)
+                return status;
+        }
+    }
+
+    template <typename callback_at>
+    ucset::status_t scan(collection_key_t const& start, std::size_t expected_count, callback_at&& callback) noexcept(false) {
+        bool should_continue = true;
+        std::optional<collection_key_t> passed;
+        auto& versions = snapshot_.versions;
+
+        // Delivers the preserved versions preceding the `bound`, including ones removed from HEAD
+        auto catch_up = [&](collection_key_t const* bound) noexcept {
+            auto it = passed ? versions.upper_bound(*passed) : versions.lower_bound(start);
+            for (; it != versions.end() && should_continue && (!bound || it->first < *bound); ++it) {
+                passed = it->first;
+                if (it->second)
+                    should_continue = callback(it->second);
+            }
+        };
+
+        auto status = head_.scan(start, expected_count, [&](pair_t const& pair) noexcept {
+            std::unique_lock _ {snapshot_.mutex};
+            catch_up(&pair.collection_key);
+            if (!should_continue)
+                return false;
+            passed = pair.collection_key;
+            auto it = versions.find(pair.collection_key);
+            pair_t const& visible = it != versions.end() ? it->second : pair;
+            if (visible)
+                should_continue = callback(visible);
+            return should_continue;
+        });
+        if (status && should_continue) {
+            std::unique_lock _ {snapshot_.mutex};
+            catch_up(nullptr);
+        }
+        return status;
+    }
+};
 
 template <typename set_or_transaction_at, typename callback_at>
 ucset::status_t find_and_watch(set_or_transaction_at& set_or_transaction,
@@ -153,78 +819,145 @@ ucset::status_t find_and_watch(set_or_transaction_at& set_or_transaction,
     return find_status;
 }
 
+/**
+ * @brief Visits up to `range_limit` entries of the collection. The `callback` returns false
+ * for the entries, that don't count towards the limit, like the expired ones.
+ */
 template <typename set_or_transaction_at, typename callback_at>
 ucset::status_t scan_and_watch(set_or_transaction_at& set_or_transaction,
                                collection_key_t start,
                                std::size_t range_limit,
                                ustore_options_t options,
-                               callback_at&& callback) noexcept {
+                               callback_at&& callback) noexcept(false) {
 
     std::size_t match_idx = 0;
-    collection_key_t previous = start;
-    bool reached_end = false;
     auto watch_status = ucset::status_t();
     auto callback_pair = [&](pair_t const& pair) noexcept {
-        reached_end = pair.collection_key.collection != previous.collection;
-        if (reached_end)
-            return;
+        if (match_idx == range_limit || pair.collection_key.collection != start.collection)
+            return false;
 
         if constexpr (!std::is_same<set_or_transaction_at, ucset_t>()) {
             bool dont_watch = options & ustore_option_transaction_dont_watch_k;
             if (!dont_watch)
                 if (watch_status = set_or_transaction.watch(pair); !watch_status)
-                    return;
+                    return false;
         }
 
-        callback(pair);
-        previous.key = pair.collection_key.key;
-        ++match_idx;
+        if (callback(pair))
+            ++match_idx;
+        return match_idx != range_limit;
     };
 
-    auto find_status = set_or_transaction.find(start, callback_pair, {});
-    if (!find_status)
-        return find_status;
-    if (!watch_status)
-        return watch_status;
+    auto scan_status = set_or_transaction.scan(start, range_limit, callback_pair);
+    if (!scan_status)
+        return scan_status;
+    return watch_status;
+}
+
+/*********************************************************/
+/*****************	 Sealed Collections	  ****************/
+/*********************************************************/
+
+constexpr char sealed_magic_k[8] = {'u', 'c', 's', 'e', 'a', 'l', 'e', 'd'};
 
-    while (match_idx != range_limit && !reached_end) {
-        find_status = set_or_transaction.upper_bound(previous, callback_pair, [&]() noexcept { reached_end = true; });
-        if (!find_status)
-            return find_status;
-        if (!watch_status)
-            return watch_status;
+/**
+ * @brief Sealed collection files start with this header, followed by the values heap,
+ * padded to 8 bytes, `count` sorted keys and `count + 1` offsets of values in the heap.
+ */
+struct sealed_header_t {
+    char magic[8];
+    std::uint64_t count;
+    std::uint64_t heap_size;
+};
+
+/**
+ * @brief Immutable collection, memory-mapped from a sealed file instead of being parsed.
+ * So opening it is instant, and the OS page cache decides which parts stay in RAM.
+ * Keys are located with a binary search and values are exported without copies.
+ */
+class sealed_collection_t {
+    void* mapping_ = MAP_FAILED;
+    std::size_t mapping_length_ = 0;
+    std::size_t count_ = 0;
+    ustore_key_t const* keys_ = nullptr;
+    std::uint64_t const* offsets_ = nullptr;
+    byte_t const* heap_ = nullptr;
+
+  public:
+    sealed_collection_t() = default;
+    sealed_collection_t(sealed_collection_t const&) = delete;
+    sealed_collection_t& operator=(sealed_collection_t const&) = delete;
+    ~sealed_collection_t() noexcept {
+        if (mapping_ != MAP_FAILED)
+            munmap(mapping_, mapping_length_);
     }
 
-    return {};
-}
+    static std::unique_ptr<sealed_collection_t> open(std::string const& path, ustore_error_t* c_error) noexcept(false) {
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            log_error_m(c_error, error_unknown_k, "Can't open a sealed collection");
+            return {};
+        }
 
-template <typename set_or_transaction_at, typename callback_at>
-ucset::status_t scan_full(set_or_transaction_at& set_or_transaction, callback_at&& callback) noexcept {
+        auto sealed = std::make_unique<sealed_collection_t>();
+        struct stat file_stat {};
+        if (fstat(descriptor, &file_stat) == 0 && file_stat.st_size >= std::int64_t(sizeof(sealed_header_t))) {
+            sealed->mapping_length_ = static_cast<std::size_t>(file_stat.st_size);
+            sealed->mapping_ = mmap(nullptr, sealed->mapping_length_, PROT_READ, MAP_SHARED, descriptor, 0);
+        }
+        close(descriptor);
+        if (sealed->mapping_ == MAP_FAILED) {
+            log_error_m(c_error, error_unknown_k, "Can't map a sealed collection");
+            return {};
+        }
 
-    collection_key_t previous {
-        std::numeric_limits<ustore_collection_t>::min(),
-        std::numeric_limits<ustore_key_t>::min(),
-    };
-    while (true) {
-        auto callback_pair = [&](pair_t const& pair) noexcept {
-            callback(pair);
-            previous = pair.collection_key;
-        };
+        // Only the sizes are validated, so that opening doesn't touch the whole file
+        auto begin = reinterpret_cast<byte_t const*>(sealed->mapping_);
+        sealed_header_t header;
+        std::memcpy(&header, begin, sizeof(header));
+        bool const is_sane = std::memcmp(header.magic, sealed_magic_k, sizeof(sealed_magic_k)) == 0 &&
+                             header.heap_size <= sealed->mapping_length_ && header.count <= sealed->mapping_length_;
+        std::size_t const keys_offset = divide_round_up<std::size_t>(sizeof(header) + header.heap_size, 8) * 8;
+        std::size_t const expected_length = keys_offset + header.count * sizeof(ustore_key_t) +
+                                            (header.count + 1) * sizeof(std::uint64_t);
+        if (!is_sane || expected_length != sealed->mapping_length_) {
+            log_error_m(c_error, consistency_k, "Damaged sealed collection");
+            return {};
+        }
 
-        auto reached_end = false;
-        auto callback_nothing = [&]() noexcept {
-            reached_end = true;
-        };
+        sealed->count_ = header.count;
+        sealed->heap_ = begin + sizeof(header);
+        sealed->keys_ = reinterpret_cast<ustore_key_t const*>(begin + keys_offset);
+        sealed->offsets_ = reinterpret_cast<std::uint64_t const*>(sealed->keys_ + header.count);
+        if (sealed->offsets_[header.count] != header.heap_size) {
+            log_error_m(c_error, consistency_k, "Damaged sealed collection");
+            return {};
+        }
+        return sealed;
+    }
 
-        auto status = set_or_transaction.upper_bound(previous, callback_pair, callback_nothing);
-        if (reached_end)
-            break;
-        if (!status)
-            return status;
+    std::size_t size() const noexcept { return count_; }
+    std::size_t space_usage() const noexcept { return mapping_length_; }
+    ustore_key_t key(std::size_t i) const noexcept { return keys_[i]; }
+    value_view_t value(std::size_t i) const noexcept {
+        return value_view_t {heap_ + offsets_[i], static_cast<std::size_t>(offsets_[i + 1] - offsets_[i])};
     }
 
-    return {};
-}
+    /** @brief Bytes of values of the entries in `[begin, end)`. */
+    std::size_t value_bytes(std::size_t begin, std::size_t end) const noexcept {
+        return static_cast<std::size_t>(offsets_[end] - offsets_[begin]);
+    }
+
+    std::size_t lower_bound(ustore_key_t key) const noexcept {
+        return std::lower_bound(keys_, keys_ + count_, key) - keys_;
+    }
+
+    /** @return Index of the `key`, or `size()`, if it's missing. */
+    std::size_t find(ustore_key_t key) const noexcept {
+        std::size_t i = lower_bound(key);
+        return i != count_ && keys_[i] == key ? i : count_;
+    }
+};
 
 /*********************************************************/
 /***************** Collections Management ****************/
@@ -247,6 +980,36 @@ struct string_less_t : public std::less<std::string_view> {
     using is_transparent = void;
 };
 
+using string_pairs_t = std::map<std::string, std::string, string_less_t>;
+
+/**
+ * @brief Number of striped locks, serializing the `ustore_option_write_merge_k` updates,
+ * and all the updates of collections with `statistics`.
+ */
+constexpr std::size_t merge_stripes_k = 64;
+
+/**
+ * @brief Transaction, queued for a group commit, with the outputs of its request.
+ */
+struct commit_request_t {
+    transaction_t* transaction = nullptr;
+    ustore_options_t options = ustore_options_default_k;
+    ustore_sequence_number_t* sequence_number = nullptr;
+    ustore_error_t* error = nullptr;
+    bool done = false;
+};
+
+/**
+ * @brief Progress of the compactions, reported by the "compaction" control.
+ */
+struct compaction_progress_t {
+    std::atomic<bool> running {false};
+    std::atomic<std::size_t> passes {0};
+    std::atomic<std::size_t> visited_pairs {0};
+    std::atomic<std::size_t> relocated_values {0};
+    std::atomic<std::size_t> relocated_bytes {0};
+};
+
 struct database_t {
     /**
      * @brief Rarely-used mutex for global reorganizations, like:
@@ -255,6 +1018,12 @@ struct database_t {
      */
     std::shared_mutex restructuring_mutex;
 
+    /**
+     * @brief Memory of the values of this database, that don't fit into the pairs. Kept on the heap,
+     * as every slab references its allocator, and declared first, to outlive all the pairs.
+     */
+    std::unique_ptr<slab_allocator_t> values = std::make_unique<slab_allocator_t>();
+
     /**
      * @brief Primary database state.
      */
@@ -273,24 +1042,132 @@ struct database_t {
      */
     std::string persisted_directory;
 
-    database_t(ucset_t&& set) noexcept(false) : pairs(std::move(set)) {}
+    ucset_options_t options;
 
-    database_t(database_t&& other) noexcept
-        : pairs(std::move(other.pairs)), names(std::move(other.names)),
-          persisted_directory(std::move(other.persisted_directory)) {}
-};
+    /**
+     * @brief Collections persisted in `persisted_directory` and released from memory,
+     * to respect the `memory_limit`. They are reloaded on first access.
+     * Protected by the `restructuring_mutex`.
+     */
+    std::unordered_set<ustore_collection_t> evicted;
 
-ustore_collection_t new_collection(database_t& db) noexcept {
-    bool is_new = false;
-    ustore_collection_t new_handle = ustore_collection_main_k;
-    while (!is_new) {
-        auto top = static_cast<std::uint64_t>(std::rand());
-        auto bottom = static_cast<std::uint64_t>(std::rand());
-        new_handle = static_cast<ustore_collection_t>((top << 32) | bottom);
-        is_new = new_handle != ustore_collection_main_k;
-        for (auto const& [name, existing_handle] : db.names)
-            is_new &= new_handle != existing_handle;
-    }
+    /**
+     * @brief Collections, that weren't modified since they were mapped from `persisted_directory`.
+     * Regular reads are served from the mappings, while any other operation moves them into `pairs`.
+     * They are never present in `pairs` at the same time. Protected by the `restructuring_mutex`.
+     */
+    std::unordered_map<ustore_collection_t, std::unique_ptr<sealed_collection_t>> sealed;
+
+    /**
+     * @brief Logical timestamps of the last access to every collection,
+     * used to pick eviction candidates. Only tracked with `memory_policy_evict_k`.
+     */
+    std::unordered_map<ustore_collection_t, std::size_t> last_access;
+    std::size_t access_clock = 0;
+    std::mutex access_mutex;
+
+    /**
+     * @brief Log of all the updates since the last checkpoint, stored in `persisted_directory`
+     * as numbered segments. Its mutex orders the updates in memory the same way as in the log,
+     * and protects the `wal_segment`, `dirty` and `dropped` members.
+     */
+    write_ahead_log_t wal;
+    std::size_t wal_segment = 0;
+    /** @brief Collections modified since the last checkpoint. */
+    std::unordered_set<ustore_collection_t> dirty;
+    /** @brief Names of collections removed since the last checkpoint. */
+    std::unordered_set<std::string> dropped;
+
+    /** @brief Allows only one checkpoint at a time. */
+    std::mutex checkpoint_mutex;
+    /** @brief Background thread, that starts checkpoints once the log reaches `checkpoint_interval`. */
+    std::thread checkpointer;
+    std::condition_variable checkpoint_wakeup;
+    bool checkpointer_stopping = false;
+
+    /**
+     * @brief Open snapshots by their IDs. Writers lock the mutex in shared mode, while
+     * preserving the versions and applying the updates, so snapshots are only created
+     * and dropped in between the updates.
+     */
+    std::shared_mutex snapshots_mutex;
+    std::unordered_map<ustore_snapshot_t, std::unique_ptr<snapshot_t>> snapshots;
+
+    /**
+     * @brief Striped by the hashes of keys. Held by merges from reading the current values
+     * until the merged ones are applied, so that concurrent merges of the same keys are serialized.
+     * Updates of collections with `statistics` hold them from reading the replaced pairs.
+     */
+    std::array<std::mutex, merge_stripes_k> merge_mutexes;
+
+    /**
+     * @brief Statistics of the collections, that were measured at least once, maintained by
+     * every update afterwards. Built under the exclusive `snapshots_mutex`, that the updates
+     * hold in shared mode, so that none of them is missed or counted twice.
+     */
+    statistics_gt<ustore_collection_t> statistics;
+
+    /**
+     * @brief Transactions, waiting for their commit. The first committer to find no `committing`
+     * leader becomes one, and applies everything queued so far under a single acquisition of the
+     * log and snapshot locks, while the others wait for `commits_done`.
+     */
+    std::mutex commits_mutex;
+    std::condition_variable commits_done;
+    std::vector<commit_request_t*> commits;
+    bool committing = false;
+
+    /** @brief TTLs of collections in milliseconds, also persisted with `save_ttls`. */
+    ttls_gt<ustore_collection_t> ttls;
+    /** @brief Keys of collections with a TTL, by the deadlines of their latest writes. */
+    expiration_wheel_gt<collection_key_t> expirations;
+    /** @brief Background thread, that removes the expired keys, once their buckets are due. */
+    std::thread sweeper;
+    std::mutex sweeper_mutex;
+    std::condition_variable sweeper_wakeup;
+    bool sweeper_stopping = false;
+
+    /**
+     * @brief Pairs of the collections with native string keys, ordered by the keys.
+     * Unlike the `pairs`, they aren't partitioned or versioned. With the write-ahead log, their updates
+     * are logged and persisted by checkpoints, otherwise only on close.
+     * The `strings_mutex` protects both the set of such collections and their pairs.
+     */
+    std::unordered_map<ustore_collection_t, string_pairs_t> strings;
+    std::shared_mutex strings_mutex;
+
+    /** @brief Allows only one compaction at a time. */
+    std::mutex compaction_mutex;
+    compaction_progress_t compaction;
+    /** @brief Background thread, that starts compactions once too much memory is wasted. */
+    std::thread compactor;
+    std::mutex compactor_mutex;
+    std::condition_variable compactor_wakeup;
+    /** @brief Also interrupts the running compaction between its slices. */
+    std::atomic<bool> compactor_stopping {false};
+
+    database_t(ucset_t&& set, ucset_options_t const& options) noexcept(false)
+        : pairs(std::move(set)), options(options) {}
+
+    database_t(database_t&& other) noexcept
+        : values(std::move(other.values)), pairs(std::move(other.pairs)), names(std::move(other.names)),
+          persisted_directory(std::move(other.persisted_directory)), options(other.options),
+          evicted(std::move(other.evicted)), sealed(std::move(other.sealed)), last_access(std::move(other.last_access)),
+          access_clock(other.access_clock), wal_segment(other.wal_segment), dirty(std::move(other.dirty)),
+          dropped(std::move(other.dropped)), snapshots(std::move(other.snapshots)), strings(std::move(other.strings)) {}
+};
+
+ustore_collection_t new_collection(database_t& db) noexcept {
+    bool is_new = false;
+    ustore_collection_t new_handle = ustore_collection_main_k;
+    while (!is_new) {
+        auto top = static_cast<std::uint64_t>(std::rand());
+        auto bottom = static_cast<std::uint64_t>(std::rand());
+        new_handle = static_cast<ustore_collection_t>((top << 32) | bottom);
+        is_new = new_handle != ustore_collection_main_k;
+        for (auto const& [name, existing_handle] : db.names)
+            is_new &= new_handle != existing_handle;
+    }
     return new_handle;
 }
 
@@ -303,59 +1180,186 @@ void export_error_code(ucset::status_t code, ustore_error_t* c_error) noexcept {
 /*****************	 Writing to Disk	  ****************/
 /*********************************************************/
 
+/**
+ * @brief Number of entries in every row group of persisted collections.
+ * Bigger groups compress better, while smaller ones need less memory during IO.
+ */
+constexpr std::size_t persisted_row_group_k = 64 * 1024;
+
+std::shared_ptr<arrow::Schema> persisted_schema() {
+    return arrow::schema({
+        arrow::field("key", arrow::int64(), false),
+        arrow::field("value", arrow::binary(), true),
+    });
+}
+
+void throw_if_error(arrow::Status const& status) noexcept(false) {
+    if (!status.ok())
+        throw std::runtime_error(status.ToString());
+}
+
+char const* persisted_extension(database_t const& db) noexcept {
+    return db.options.sealed_files ? ".sealed" : ".parquet";
+}
+
+/**
+ * @brief Persists a collection in the sealed format, described in `sealed_header_t`.
+ * Entries are visited in sorted order, so values are streamed into the heap,
+ * while only the keys and offsets are accumulated in memory.
+ */
+void write_sealed_collection( //
+    database_t& db,
+    ustore_collection_t collection_id,
+    std::string const& collection_path,
+    ustore_error_t* c_error) noexcept(false) {
+
+    file_handle_t handle;
+    if ((*c_error = handle.open(collection_path.c_str(), "wb").release_error()))
+        return;
+
+    // The header is rewritten at the end, once the sizes are known
+    sealed_header_t header {};
+    std::memcpy(header.magic, sealed_magic_k, sizeof(sealed_magic_k));
+    bool is_written = std::fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    std::vector<ustore_key_t> keys;
+    std::vector<std::uint64_t> offsets;
+    collection_key_t start(collection_id, std::numeric_limits<ustore_key_t>::min());
+    auto status = db.pairs.scan(start, persisted_row_group_k, [&](pair_t const& pair) noexcept {
+        if (pair.collection_key.collection != collection_id || !is_written || *c_error)
+            return false;
+        if (!pair)
+            return true;
+        safe_section("Sealing collection", c_error, [&] {
+            keys.push_back(pair.collection_key.key);
+            offsets.push_back(header.heap_size);
+        });
+        is_written = std::fwrite(pair.range.data(), 1, pair.range.size(), handle) == pair.range.size();
+        header.heap_size += pair.range.size();
+        return true;
+    });
+    export_error_code(status, c_error);
+    return_if_error_m(c_error);
+    offsets.push_back(header.heap_size);
+    header.count = keys.size();
+
+    std::uint64_t const padding = 0;
+    std::size_t const padding_length = divide_round_up<std::size_t>(header.heap_size, 8) * 8 - header.heap_size;
+    is_written = is_written && std::fwrite(&padding, 1, padding_length, handle) == padding_length;
+    is_written = is_written && std::fwrite(keys.data(), sizeof(ustore_key_t), keys.size(), handle) == keys.size();
+    is_written = is_written && std::fwrite(offsets.data(), sizeof(std::uint64_t), offsets.size(), handle) == offsets.size();
+    is_written = is_written && std::fseek(handle, 0, SEEK_SET) == 0;
+    is_written = is_written && std::fwrite(&header, sizeof(header), 1, handle) == 1;
+    return_error_if_m(is_written, c_error, error_unknown_k, "Write partially failed on sealed collection");
+    log_error_m(c_error, error_unknown_k, handle.close().release_error());
+}
+
 void write_collection( //
-    database_t const& db,
+    database_t& db,
     ustore_collection_t collection_id,
     std::string const& collection_path,
     ustore_error_t* c_error) noexcept(false) {
 
+    if (db.options.sealed_files)
+        return write_sealed_collection(db, collection_id, collection_path, c_error);
+
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
     std::shared_ptr<arrow::io::FileOutputStream> out_file;
     PARQUET_ASSIGN_OR_THROW(out_file, arrow::io::FileOutputStream::Open(collection_path));
 
-    parquet::schema::NodeVector columns {};
-    columns.push_back(parquet::schema::PrimitiveNode::Make( //
-        "key",
-        parquet::Repetition::REQUIRED,
-        parquet::Type::INT64,
-        parquet::ConvertedType::INT_64));
-    columns.push_back(parquet::schema::PrimitiveNode::Make( //
-        "value",
-        parquet::Repetition::OPTIONAL,
-        parquet::Type::BYTE_ARRAY,
-        parquet::ConvertedType::UTF8));
-    auto schema = std::static_pointer_cast<parquet::schema::GroupNode>(
-        parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, columns));
+    auto schema = persisted_schema();
+    std::unique_ptr<parquet::arrow::FileWriter> writer;
     parquet::WriterProperties::Builder builder;
-    parquet::StreamWriter os {parquet::ParquetFileWriter::Open(out_file, schema, builder.build())};
+    throw_if_error(parquet::arrow::FileWriter::Open(*schema, pool, out_file, builder.build(), &writer));
+
+    // Entries are accumulated in columnar builders and flushed as whole row groups
+    arrow::Int64Builder keys_builder(pool);
+    arrow::BinaryBuilder values_builder(pool);
+    arrow::Status arrow_status;
+    auto flush = [&]() noexcept {
+        std::shared_ptr<arrow::Array> keys_array, values_array;
+        if (arrow_status.ok())
+            arrow_status = keys_builder.Finish(&keys_array);
+        if (arrow_status.ok())
+            arrow_status = values_builder.Finish(&values_array);
+        if (arrow_status.ok() && keys_array->length())
+            arrow_status = writer->WriteTable(*arrow::Table::Make(schema, {keys_array, values_array}),
+                                              keys_array->length());
+    };
 
     collection_key_t min(collection_id, std::numeric_limits<ustore_key_t>::min());
     collection_key_t max(collection_id, std::numeric_limits<ustore_key_t>::max());
     auto status = db.pairs.range(min, max, [&](pair_t& pair) noexcept {
-        std::optional<std::string_view> value;
-        if (pair.range.size())
-            value = std::string_view(pair.range);
-        os << pair.collection_key.key << value << parquet::EndRow;
+        if (!arrow_status.ok())
+            return;
+        arrow_status = keys_builder.Append(pair.collection_key.key);
+        if (arrow_status.ok())
+            arrow_status = pair.range.size() ? values_builder.Append(std::string_view(pair.range))
+                                             : values_builder.AppendNull();
+        if (static_cast<std::size_t>(keys_builder.length()) == persisted_row_group_k)
+            flush();
     });
     export_error_code(status, c_error);
     return_if_error_m(c_error);
+    flush();
+    throw_if_error(arrow_status);
+    throw_if_error(writer->Close());
+}
+
+/**
+ * @brief Runs `task(i)` for every `i` in `[0, count)` on a few threads,
+ * reporting the first of the errors.
+ */
+template <typename task_at>
+void parallel_for(std::size_t count, ustore_error_t* c_error, task_at&& task) noexcept(false) {
+
+    std::size_t threads_count = std::min<std::size_t>(count, std::max(std::thread::hardware_concurrency(), 1u));
+    std::atomic<std::size_t> next_task {0};
+    std::vector<ustore_error_t> errors(threads_count, nullptr);
+    auto worker = [&](std::size_t thread_idx) noexcept {
+        ustore_error_t* thread_error = &errors[thread_idx];
+        for (std::size_t i = next_task++; i < count && !*thread_error; i = next_task++)
+            safe_section("Persisting collections", thread_error, [&] { task(i, thread_error); });
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threads_count);
+    for (std::size_t thread_idx = 1; thread_idx < threads_count; ++thread_idx)
+        threads.emplace_back(worker, thread_idx);
+    if (threads_count)
+        worker(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (ustore_error_t error : errors)
+        if (error && !*c_error)
+            *c_error = error;
 }
 
-void write(database_t const& db, std::string const& dir_path, ustore_error_t* c_error) noexcept(false) {
+void write(database_t& db, std::string const& dir_path, ustore_error_t* c_error) noexcept(false) {
 
     // Check if the source directory even exists
     if (!std::filesystem::is_directory(dir_path))
         return;
 
-    auto main_path = stdfs::path(dir_path) / ".parquet";
-    write_collection(db, ustore_collection_main_k, main_path, c_error);
-    return_if_error_m(c_error);
-
+    // Evicted and sealed collections are already on disk and are missing in memory
+    auto is_on_disk = [&](ustore_collection_t collection) {
+        return db.evicted.count(collection) || db.sealed.count(collection);
+    };
+    std::vector<std::pair<ustore_collection_t, stdfs::path>> collections;
+    if (!is_on_disk(ustore_collection_main_k))
+        collections.emplace_back(ustore_collection_main_k, stdfs::path(dir_path) / persisted_extension(db));
     for (auto const& collection : db.names) {
+        if (is_on_disk(collection.second))
+            continue;
         auto const& collection_name = collection.first;
-        auto const collection_path = stdfs::path(dir_path) / (collection_name + ".parquet");
-        write_collection(db, collection.second, collection_path, c_error);
-        return_if_error_m(c_error);
+        collections.emplace_back(collection.second,
+                                 stdfs::path(dir_path) / (collection_name + persisted_extension(db)));
     }
+
+    parallel_for(collections.size(), c_error, [&](std::size_t i, ustore_error_t* thread_error) {
+        write_collection(db, collections[i].first, collections[i].second, thread_error);
+    });
 }
 
 bool ends_with(std::string_view str, std::string_view suffix) noexcept {
@@ -363,10 +1367,136 @@ bool ends_with(std::string_view str, std::string_view suffix) noexcept {
            0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix.data(), suffix.size());
 }
 
+/**
+ * @brief Copies the entries of a sealed collection into the sets.
+ * @param keep_existing Skips the entries already present in memory, as they are fresher.
+ */
+void import_sealed( //
+    database_t& db,
+    ustore_collection_t collection_id,
+    sealed_collection_t const& sealed,
+    bool keep_existing,
+    ustore_error_t* c_error) noexcept(false) {
+
+    std::vector<pair_t> pairs;
+    pairs.reserve(std::min(sealed.size(), persisted_row_group_k));
+    for (std::size_t i = 0; i != sealed.size(); ++i) {
+        collection_key_t collection_key {collection_id, sealed.key(i)};
+        bool exists = false;
+        if (keep_existing) {
+            auto status = db.pairs.find(
+                collection_key,
+                [&](pair_t const&) noexcept { exists = true; },
+                []() noexcept {});
+            export_error_code(status, c_error);
+            return_if_error_m(c_error);
+        }
+        if (!exists) {
+            pairs.emplace_back(collection_key, sealed.value(i), *db.values, c_error);
+            return_if_error_m(c_error);
+        }
+        if (pairs.size() != persisted_row_group_k && i + 1 != sealed.size())
+            continue;
+
+        auto status = db.pairs.upsert(pairs.data(), pairs.data() + pairs.size());
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        pairs.clear();
+    }
+}
+
+/**
+ * @brief Moves a sealed collection into the sets, so that it can be modified,
+ * or accessed through transactions and snapshots, which only track the sets.
+ * Expects the `restructuring_mutex` to be exclusively locked.
+ */
+void unseal_collection(database_t& db, ustore_collection_t collection_id, ustore_error_t* c_error) noexcept {
+    auto it = db.sealed.find(collection_id);
+    if (it == db.sealed.end())
+        return;
+    safe_section("Unsealing collection", c_error, [&] {
+        import_sealed(db, collection_id, *it->second, false, c_error);
+    });
+    return_if_error_m(c_error);
+    db.sealed.erase(it);
+}
+
+/**
+ * @brief Imports a single persisted collection, one row group at a time.
+ * Values are copied straight from Arrow buffers into the pairs.
+ * @param keep_existing Skips the entries already present in memory, as they are fresher.
+ */
+void read_collection( //
+    database_t& db,
+    ustore_collection_t collection_id,
+    std::string const& collection_path,
+    bool keep_existing,
+    ustore_error_t* c_error) noexcept(false) {
+
+    if (db.options.sealed_files) {
+        auto sealed = sealed_collection_t::open(collection_path, c_error);
+        return_if_error_m(c_error);
+        return import_sealed(db, collection_id, *sealed, keep_existing, c_error);
+    }
+
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+    std::shared_ptr<arrow::io::ReadableFile> in_file;
+    PARQUET_ASSIGN_OR_THROW(in_file, arrow::io::ReadableFile::Open(collection_path));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    throw_if_error(parquet::arrow::OpenFile(in_file, pool, &reader));
+    reader->set_use_threads(true);
+
+    std::vector<pair_t> pairs;
+    for (int row_group_idx = 0; row_group_idx != reader->num_row_groups(); ++row_group_idx) {
+        std::shared_ptr<arrow::Table> table;
+        throw_if_error(reader->ReadRowGroup(row_group_idx, &table));
+        return_error_if_m(table->num_columns() == 2, c_error, consistency_k, "Unknown persisted collection format");
+
+        pairs.clear();
+        pairs.reserve(static_cast<std::size_t>(table->num_rows()));
+        auto const& keys_chunks = table->column(0)->chunks();
+        auto const& values_chunks = table->column(1)->chunks();
+        return_error_if_m(keys_chunks.size() == values_chunks.size(),
+                          c_error,
+                          consistency_k,
+                          "Misaligned persisted columns");
+
+        for (std::size_t chunk_idx = 0; chunk_idx != keys_chunks.size(); ++chunk_idx) {
+            // Older files annotate values as UTF8 strings, which share the layout of binary arrays
+            auto keys = std::static_pointer_cast<arrow::Int64Array>(keys_chunks[chunk_idx]);
+            auto values = std::static_pointer_cast<arrow::BinaryArray>(values_chunks[chunk_idx]);
+            for (std::int64_t i = 0; i != keys->length(); ++i) {
+                collection_key_t collection_key {collection_id, keys->Value(i)};
+                if (keep_existing) {
+                    bool exists = false;
+                    auto status = db.pairs.find(
+                        collection_key,
+                        [&](pair_t const&) noexcept { exists = true; },
+                        []() noexcept {});
+                    export_error_code(status, c_error);
+                    return_if_error_m(c_error);
+                    if (exists)
+                        continue;
+                }
+
+                value_view_t value = values->IsNull(i) ? value_view_t::make_empty() : value_view_t {values->GetView(i)};
+                pairs.emplace_back(collection_key, value, *db.values, c_error);
+                return_if_error_m(c_error);
+            }
+        }
+
+        auto status = db.pairs.upsert(pairs.data(), pairs.data() + pairs.size());
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
 void read(database_t& db, std::string const& path, ustore_error_t* c_error) noexcept(false) {
 
     // Clear the DB, before refilling it
     db.names.clear();
+    db.evicted.clear();
+    db.sealed.clear();
     auto status = db.pairs.clear();
     export_error_code(status, c_error);
     return_if_error_m(c_error);
@@ -375,47 +1505,1538 @@ void read(database_t& db, std::string const& path, ustore_error_t* c_error) noex
     if (!std::filesystem::is_directory(path))
         return;
 
-    // Loop over all persisted collections, reading them one by one
-    std::string_view extension {".parquet"};
+    // Register all persisted collections first, as that isn't thread-safe
+    std::vector<std::pair<ustore_collection_t, stdfs::path>> collections;
+    std::string_view extension {persisted_extension(db)};
     for (auto const& dir_entry : std::filesystem::directory_iterator {path}) {
         auto const& collection_path = dir_entry.path();
         std::string collection_name = collection_path.filename();
         if (!ends_with(collection_name, extension))
             continue;
 
-        collection_name.resize(collection_name.size() - extension.size());
-        ustore_collection_t collection_id = collection_name.empty() ? ustore_collection_main_k : new_collection(db);
-        if (!collection_name.empty())
-            db.names.emplace(collection_name, collection_id);
+        collection_name.resize(collection_name.size() - extension.size());
+        ustore_collection_t collection_id = collection_name.empty() ? ustore_collection_main_k : new_collection(db);
+        if (!collection_name.empty())
+            db.names.emplace(collection_name, collection_id);
+        collections.emplace_back(collection_id, collection_path);
+    }
+
+    // Sealed files are only mapped, and their pages are loaded on first access
+    if (db.options.sealed_files) {
+        for (auto const& [collection_id, collection_path] : collections) {
+            auto sealed = sealed_collection_t::open(collection_path, c_error);
+            return_if_error_m(c_error);
+            db.sealed.emplace(collection_id, std::move(sealed));
+        }
+        return;
+    }
+
+    // Then load them in parallel
+    parallel_for(collections.size(), c_error, [&](std::size_t i, ustore_error_t* thread_error) {
+        read_collection(db, collections[i].first, collections[i].second, false, thread_error);
+    });
+}
+
+constexpr char const* strings_extension_k = ".strings";
+
+stdfs::path strings_path(database_t const& db, std::string const& name) noexcept(false) {
+    return stdfs::path(db.persisted_directory) / (name + strings_extension_k);
+}
+
+/**
+ * @brief Dumps the pairs of a collection with string keys, prefixing every key and value with its length.
+ * Replaces the file atomically, so that a crash never leaves a half-written one.
+ */
+void save_strings(database_t const& db, std::string const& name, string_pairs_t const& pairs) noexcept(false) {
+    stdfs::path path = strings_path(db, name);
+    stdfs::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream ofs(temporary_path, std::ios::binary | std::ios::trunc);
+        auto put = [&](std::string const& str) {
+            auto length = static_cast<ustore_length_t>(str.size());
+            ofs.write(reinterpret_cast<char const*>(&length), sizeof(length));
+            ofs.write(str.data(), str.size());
+        };
+        for (auto const& [key, value] : pairs) {
+            put(key);
+            put(value);
+        }
+    }
+    stdfs::rename(temporary_path, path);
+}
+
+void load_strings(database_t const& db, std::string const& name, string_pairs_t& pairs) noexcept(false) {
+    std::ifstream ifs(strings_path(db, name), std::ios::binary);
+    auto get = [&](std::string& str) {
+        ustore_length_t length = 0;
+        if (!ifs.read(reinterpret_cast<char*>(&length), sizeof(length)))
+            return false;
+        str.resize(length);
+        return bool(ifs.read(str.data(), length));
+    };
+    for (std::string key, value; get(key) && get(value);)
+        pairs.insert_or_assign(std::move(key), std::move(value));
+}
+
+/**
+ * @brief Persists every collection with string keys, expecting the `strings_mutex` to be locked.
+ */
+void save_all_strings(database_t const& db) noexcept(false) {
+    for (auto const& [name, collection] : db.names)
+        if (auto it = db.strings.find(collection); it != db.strings.end())
+            save_strings(db, name, it->second);
+}
+
+/**
+ * @brief Expects the `strings_mutex` to be locked.
+ * @return NULL, if the collection doesn't have string keys.
+ */
+string_pairs_t* find_strings(database_t& db, ustore_collection_t collection) noexcept {
+    auto it = db.strings.find(collection);
+    return it != db.strings.end() ? &it->second : nullptr;
+}
+
+/**
+ * @brief Loads the persisted collections with string keys, that aren't in memory yet.
+ * With the write-ahead log, it runs again after the replay, to cover the collections created since the checkpoint.
+ */
+void load_all_strings(database_t& db) noexcept(false) {
+    for (auto const& name : load_string_keyed(db.persisted_directory)) {
+        auto name_it = db.names.find(name);
+        if (name_it == db.names.end() || db.strings.count(name_it->second))
+            continue;
+        load_strings(db, name, db.strings[name_it->second]);
+    }
+}
+
+/**
+ * @brief Shared by `ustore_collection_drop` and the log replay.
+ * Expects the `strings_mutex` to be locked.
+ */
+void drop_strings(database_t& db, ustore_collection_t id, ustore_drop_mode_t mode) noexcept {
+    string_pairs_t* pairs = find_strings(db, id);
+    if (!pairs)
+        return;
+    if (mode == ustore_drop_vals_k) {
+        for (auto& [key, value] : *pairs)
+            value.clear();
+        return;
+    }
+    pairs->clear();
+    if (mode == ustore_drop_keys_vals_handle_k)
+        db.strings.erase(id);
+}
+
+/*********************************************************/
+/*****************	   Memory Limits	  ****************/
+/*********************************************************/
+
+std::size_t parse_bytes(json_t const& js, ustore_error_t* c_error) noexcept {
+    if (js.is_number_unsigned())
+        return js.get<std::size_t>();
+    if (!js.is_string()) {
+        log_error_m(c_error, args_wrong_k, "Memory limit must be a number or a string, like \"100GB\"");
+        return 0;
+    }
+
+    std::string const& str = js.get_ref<std::string const&>();
+    char* suffix = nullptr;
+    double number = std::strtod(str.c_str(), &suffix);
+    std::string_view unit {suffix};
+    while (unit.size() && unit.front() == ' ')
+        unit.remove_prefix(1);
+
+    std::size_t multiplier = 0;
+    if (unit.empty() || unit == "B")
+        multiplier = 1;
+    else if (unit == "KB")
+        multiplier = 1ul << 10;
+    else if (unit == "MB")
+        multiplier = 1ul << 20;
+    else if (unit == "GB")
+        multiplier = 1ul << 30;
+    else if (unit == "TB")
+        multiplier = 1ul << 40;
+    if (!multiplier || number < 0 || suffix == str.c_str()) {
+        log_error_m(c_error, args_wrong_k, "Unrecognized memory limit format");
+        return 0;
+    }
+    return static_cast<std::size_t>(number * multiplier);
+}
+
+stdfs::path collection_path(database_t const& db, ustore_collection_t collection_id) noexcept(false) {
+    auto root = stdfs::path(db.persisted_directory);
+    if (collection_id == ustore_collection_main_k)
+        return root / persisted_extension(db);
+    for (auto const& collection : db.names)
+        if (collection.second == collection_id)
+            return root / (collection.first + persisted_extension(db));
+    return {};
+}
+
+/**
+ * @brief Replaces missing collections with the main one and skips repetitions.
+ */
+void normalize_collections(strided_iterator_gt<ustore_collection_t const>& collections, std::size_t& count) noexcept {
+    if (!collections)
+        collections = strided_iterator_gt<ustore_collection_t const> {&ustore_collection_main_k, 0};
+    if (collections.repeats())
+        count = std::min<std::size_t>(count, 1);
+}
+
+/**
+ * @brief Makes sure all the `collections` of a batch are in memory, and marks them as recently used.
+ * @param keep_sealed Whether sealed collections can be read in place, instead of being moved into memory.
+ * @return Shared lock, that prevents them from being evicted or sealed until the end of the operation.
+ * It's empty, unless the `memory_policy_evict_k` or sealed files are used.
+ */
+
+std::shared_lock<std::shared_mutex> lock_resident( //
+    database_t& db,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    std::size_t count,
+    bool keep_sealed,
+    ustore_error_t* c_error) noexcept {
+
+    bool const tracks_access = db.options.memory_policy == memory_policy_evict_k && db.options.memory_limit;
+    if (!tracks_access && !db.options.sealed_files)
+        return {};
+    normalize_collections(collections, count);
+
+    auto is_resident = [&](ustore_collection_t collection) {
+        return !db.evicted.count(collection) && (keep_sealed || !db.sealed.count(collection));
+    };
+    while (true) {
+        std::shared_lock lock {db.restructuring_mutex};
+        bool all_resident = true;
+        for (std::size_t i = 0; i != count && all_resident; ++i)
+            all_resident = is_resident(collections[i]);
+
+        if (all_resident && tracks_access) {
+            std::unique_lock _ {db.access_mutex};
+            ++db.access_clock;
+            for (std::size_t i = 0; i != count; ++i)
+                if (!i || collections[i] != collections[i - 1])
+                    db.last_access[collections[i]] = db.access_clock;
+        }
+        if (all_resident)
+            return lock;
+
+        // Reimport the missing collections and retry
+        lock.unlock();
+        std::unique_lock _ {db.restructuring_mutex};
+        for (std::size_t i = 0; i != count; ++i) {
+            ustore_collection_t collection = collections[i];
+            if (!keep_sealed)
+                unseal_collection(db, collection, c_error);
+            if (*c_error)
+                return {};
+            if (!db.evicted.count(collection))
+                continue;
+            safe_section("Reloading evicted collection", c_error, [&] {
+                read_collection(db, collection, collection_path(db, collection), true, c_error);
+            });
+            if (*c_error)
+                return {};
+            db.evicted.erase(collection);
+        }
+    }
+}
+
+/**
+ * @brief Expects the `restructuring_mutex` to be locked, like by `lock_resident`.
+ * @return NULL, if the collection isn't sealed.
+ */
+sealed_collection_t const* find_sealed(database_t const& db, ustore_collection_t collection) noexcept {
+    if (db.sealed.empty())
+        return nullptr;
+    auto it = db.sealed.find(collection);
+    return it != db.sealed.end() ? it->second.get() : nullptr;
+}
+
+/**
+ * @brief Holds the merge locks of all the stripes touched by a batch.
+ * They are acquired in ascending order, so that overlapping batches can't deadlock.
+ */
+class merge_lock_t {
+    std::mutex* mutexes_ = nullptr;
+    std::uint64_t stripes_ = 0;
+    static_assert(merge_stripes_k <= 64, "Stripes must fit into a bitmask");
+
+  public:
+    merge_lock_t() = default;
+    merge_lock_t(merge_lock_t const&) = delete;
+    merge_lock_t& operator=(merge_lock_t const&) = delete;
+    merge_lock_t& operator=(merge_lock_t&& other) noexcept {
+        std::swap(mutexes_, other.mutexes_);
+        std::swap(stripes_, other.stripes_);
+        return *this;
+    }
+
+    merge_lock_t(database_t& db, std::uint64_t stripes) noexcept
+        : mutexes_(db.merge_mutexes.data()), stripes_(stripes) {
+        for (std::size_t stripe = 0; stripe != merge_stripes_k; ++stripe)
+            if (stripes_ & (std::uint64_t(1) << stripe))
+                mutexes_[stripe].lock();
+    }
+
+    merge_lock_t(database_t& db, places_arg_t const& places) noexcept
+        : merge_lock_t(db, stripes_of(places.size(), [&](std::size_t i) { return places[i].collection_key(); })) {}
+
+    /**
+     * @param keys Callable, returning the `collection_key_t` of the i-th of `count` pairs.
+     */
+    template <typename keys_at>
+    static std::uint64_t stripes_of(std::size_t count, keys_at&& keys) noexcept {
+        std::uint64_t stripes = 0;
+        for (std::size_t i = 0; i != count; ++i)
+            stripes |= std::uint64_t(1) << partition_of(keys(i), merge_stripes_k);
+        return stripes;
+    }
+
+    explicit operator bool() const noexcept { return stripes_; }
+
+    ~merge_lock_t() noexcept {
+        for (std::size_t stripe = 0; stripe != merge_stripes_k; ++stripe)
+            if (stripes_ & (std::uint64_t(1) << stripe))
+                mutexes_[stripe].unlock();
+    }
+};
+
+/**
+ * @brief Combines the merge operands with the current values, exporting the merged ones.
+ * Repeated keys see the results of the earlier operands in the same batch.
+ */
+template <typename set_or_transaction_at>
+void merge_values( //
+    set_or_transaction_at& set_or_transaction,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_options_t const c_options,
+    growing_tape_t& merged,
+    ustore_error_t* c_error) noexcept {
+
+    std::string buffer;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        value_view_t operand = contents[i];
+        if (!operand) {
+            merged.push_back(value_view_t {}, c_error);
+            return_if_error_m(c_error);
+            continue;
+        }
+
+        collection_key_t key = places[i].collection_key();
+        std::size_t previous = i;
+        while (previous != 0 && places[previous - 1].collection_key() != key)
+            --previous;
+
+        auto merge = [&](value_view_t stored) noexcept {
+            safe_section("Merging values", c_error, [&] {
+                *c_error = merge_operand(stored, operand, buffer);
+                if (!*c_error)
+                    merged.push_back(value_view_t {std::string_view(buffer)}, c_error);
+            });
+        };
+        if (previous != 0)
+            merge(embedded_blobs_t(merged)[previous - 1]);
+        else
+            export_error_code(find_and_watch(set_or_transaction, key, c_options, merge), c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Checks if `incoming_bytes` fit into the `memory_limit`,
+ * evicting cold collections, if the policy allows that.
+ * The `collections` about to be written into are never evicted.
+ */
+void respect_memory_limit( //
+    database_t& db,
+    std::size_t incoming_bytes,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    std::size_t count,
+    ustore_error_t* c_error) noexcept {
+
+    std::size_t const limit = db.options.memory_limit;
+    auto fits = [&] {
+        return db.values->used_bytes() + incoming_bytes <= limit;
+    };
+    if (!limit || fits())
+        return;
+
+    return_error_if_m(db.options.memory_policy == memory_policy_evict_k && !db.persisted_directory.empty(),
+                      c_error,
+                      out_of_memory_k,
+                      "Memory limit exceeded");
+    normalize_collections(collections, count);
+
+    std::unique_lock _ {db.restructuring_mutex};
+    while (!fits()) {
+        // Pick the least recently used collection, that isn't a part of this batch
+        std::optional<ustore_collection_t> coldest;
+        std::size_t coldest_access = std::numeric_limits<std::size_t>::max();
+        auto consider = [&](ustore_collection_t collection) {
+            if (db.evicted.count(collection) || db.sealed.count(collection))
+                return;
+            for (std::size_t i = 0; i != count; ++i)
+                if (collections[i] == collection)
+                    return;
+            std::unique_lock _ {db.access_mutex};
+            auto it = db.last_access.find(collection);
+            std::size_t access = it != db.last_access.end() ? it->second : 0;
+            if (access < coldest_access)
+                coldest = collection, coldest_access = access;
+        };
+        consider(ustore_collection_main_k);
+        for (auto const& collection : db.names)
+            consider(collection.second);
+        return_error_if_m(coldest, c_error, out_of_memory_k, "Memory limit exceeded, nothing to evict");
+
+        // Sealed files can keep serving the reads, while their pages are managed by the OS
+        safe_section("Evicting collection", c_error, [&] {
+            std::string path = collection_path(db, *coldest);
+            write_collection(db, *coldest, path, c_error);
+            if (*c_error)
+                return;
+            if (!db.options.sealed_files)
+                db.evicted.insert(*coldest);
+            else if (auto sealed = sealed_collection_t::open(path, c_error); sealed)
+                db.sealed.emplace(*coldest, std::move(sealed));
+        });
+        return_if_error_m(c_error);
+        auto status = db.pairs.erase_range(*coldest, *coldest + 1, no_op_t {});
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/*********************************************************/
+/*****************	     Snapshots  	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Expects the `snapshots_mutex` to be locked.
+ * @return NULL, if there is no such snapshot.
+ */
+snapshot_t* find_snapshot(database_t& db, ustore_snapshot_t id) noexcept {
+    auto it = db.snapshots.find(id);
+    return it != db.snapshots.end() ? it->second.get() : nullptr;
+}
+
+/**
+ * @brief Saves the current version of a pair in all the snapshots, that don't have one yet.
+ * Expects the `snapshots_mutex` to be shared-locked, and the pair to be still unmodified.
+ */
+void preserve_version(database_t& db, collection_key_t key, value_view_t value, ustore_error_t* c_error) noexcept {
+    for (auto& [id, snapshot] : db.snapshots) {
+        std::unique_lock _ {snapshot->mutex};
+        if (snapshot->versions.count(key))
+            continue;
+        pair_t pair {key, value, *db.values, c_error};
+        return_if_error_m(c_error);
+        safe_section("Preserving version", c_error, [&] { snapshot->versions.emplace(key, std::move(pair)); });
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Preserves the versions of pairs, that are about to be modified.
+ * @param keys Callable, returning the `collection_key_t` of the i-th of `count` pairs.
+ */
+template <typename keys_at>
+void preserve_versions(database_t& db, keys_at&& keys, std::size_t count, ustore_error_t* c_error) noexcept {
+    for (std::size_t i = 0; i != count; ++i) {
+        collection_key_t key = keys(i);
+        auto status = db.pairs.find(
+            key,
+            [&](pair_t const& pair) noexcept { preserve_version(db, key, pair.range, c_error); },
+            [&]() noexcept { preserve_version(db, key, value_view_t {}, c_error); });
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Preserves the versions of all pairs in a collection, that is about to be dropped or cleared.
+ */
+void preserve_collection(database_t& db, ustore_collection_t collection, ustore_error_t* c_error) noexcept {
+    auto status = db.pairs.range(collection, collection + 1, [&](pair_t& pair) noexcept {
+        if (!*c_error)
+            preserve_version(db, pair.collection_key, pair.range, c_error);
+    });
+    export_error_code(status, c_error);
+}
+
+/*********************************************************/
+/*****************	     Statistics  	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Pairs of a collection with `statistics`, replaced by an update, and the ones replacing them.
+ * Collected before the update is applied, while the merge stripes of its keys are locked,
+ * and applied to the statistics once it succeeds.
+ */
+class replacements_t {
+    struct replacement_t {
+        std::shared_ptr<collection_stats_t> stats;
+        collection_key_t key;
+        entry_summary_t replaced;
+        entry_summary_t replacing;
+    };
+
+    std::vector<replacement_t> replacements_;
+    std::unordered_map<collection_key_t, std::size_t, collection_key_hash_t> indices_;
+
+  public:
+    /**
+     * @brief Remembers the pair, currently stored under the `key`, if its collection has `statistics`.
+     * Later updates of the same key in a batch replace the earlier ones, rather than the stored pair.
+     */
+    void collect(database_t& db, collection_key_t key, entry_summary_t replacing, ustore_error_t* c_error) noexcept(false) {
+        if (auto it = indices_.find(key); it != indices_.end()) {
+            replacements_[it->second].replacing = replacing;
+            return;
+        }
+        std::shared_ptr<collection_stats_t> stats = db.statistics.find(key.collection);
+        if (!stats)
+            return;
+
+        entry_summary_t replaced;
+        auto status = db.pairs.find(
+            key,
+            [&](pair_t const& pair) noexcept { replaced = summarize(pair.range, pair.space_usage()); },
+            []() noexcept {});
+        export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        indices_.emplace(key, replacements_.size());
+        replacements_.push_back({std::move(stats), key, replaced, replacing});
+    }
+
+    void apply() noexcept {
+        for (replacement_t const& replacement : replacements_)
+            replacement.stats->replace(replacement.key.key, replacement.replaced, replacement.replacing);
+        clear();
+    }
+
+    void clear() noexcept {
+        replacements_.clear();
+        indices_.clear();
+    }
+};
+
+/**
+ * @brief Checks if any of the `count` keys belongs to a collection with `statistics`.
+ * @param keys Callable, returning the `collection_key_t` of the i-th of `count` pairs.
+ */
+template <typename keys_at>
+bool has_statistics(database_t const& db, std::size_t count, keys_at&& keys) noexcept {
+    if (!db.statistics.any())
+        return false;
+    for (std::size_t i = 0; i != count; ++i)
+        if ((!i || keys(i).collection != keys(i - 1).collection) && db.statistics.find(keys(i).collection))
+            return true;
+    return false;
+}
+
+/**
+ * @brief Starts maintaining the statistics of a resident collection, with a full pass over it.
+ * Expects the `snapshots_mutex` to be exclusively locked.
+ */
+void build_statistics(database_t& db, ustore_collection_t collection, ustore_error_t* c_error) noexcept {
+    std::shared_ptr<collection_stats_t> stats;
+    safe_section("Allocating statistics", c_error, [&] { stats = std::make_shared<collection_stats_t>(); });
+    return_if_error_m(c_error);
+    auto status = db.pairs.range(collection, collection + 1, [&](pair_t const& pair) noexcept {
+        stats->replace(pair.collection_key.key, {}, summarize(pair.range, pair.space_usage()));
+    });
+    export_error_code(status, c_error);
+    return_if_error_m(c_error);
+    safe_section("Registering statistics", c_error, [&] { db.statistics.track(collection, std::move(stats)); });
+}
+
+/*********************************************************/
+/*****************	  Write-Ahead Log	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Types of records in the write-ahead log, followed by their contents.
+ * Every log segment starts with `wal_collection_k` records for all the named collections,
+ * as collection IDs aren't persisted in checkpoints and differ between sessions.
+ */
+enum wal_record_t : std::uint8_t {
+    /** @brief Binds a logged collection ID to its name: `[id][name...]`. */
+    wal_collection_k = 1,
+    /** @brief Drops a collection: `[id][mode]`. */
+    wal_drop_k = 2,
+    /** @brief Batch of updates: `[[id][key][length][value...]]...`, missing values have no contents. */
+    wal_write_k = 3,
+    /** @brief Batch of updates with string keys: `[[id][length][key...][length][value...]]...`. */
+    wal_strings_k = 4,
+};
+
+bool is_logged(database_t const& db) noexcept {
+    return db.options.write_ahead_log && !db.persisted_directory.empty();
+}
+
+template <typename scalar_at>
+void wal_put(std::string& record, scalar_at scalar) noexcept(false) {
+    record.append(reinterpret_cast<char const*>(&scalar), sizeof(scalar_at));
+}
+
+template <typename scalar_at>
+bool wal_get(std::string_view& record, scalar_at& scalar) noexcept {
+    if (record.size() < sizeof(scalar_at))
+        return false;
+    std::memcpy(&scalar, record.data(), sizeof(scalar_at));
+    record.remove_prefix(sizeof(scalar_at));
+    return true;
+}
+
+void wal_put_update(std::string& record, collection_key_t key, value_view_t value) noexcept(false) {
+    if (record.empty())
+        wal_put(record, wal_write_k);
+    wal_put(record, key.collection);
+    wal_put(record, key.key);
+    wal_put(record, value ? static_cast<ustore_length_t>(value.size()) : ustore_length_missing_k);
+    if (value.size())
+        record.append(reinterpret_cast<char const*>(value.data()), value.size());
+}
+
+bool wal_get_update(std::string_view& record, collection_key_t& key, value_view_t& value) noexcept {
+    ustore_length_t length = 0;
+    if (!wal_get(record, key.collection) || !wal_get(record, key.key) || !wal_get(record, length))
+        return false;
+    if (length == ustore_length_missing_k) {
+        value = value_view_t {};
+        return true;
+    }
+    if (record.size() < length)
+        return false;
+    value = value_view_t {reinterpret_cast<byte_t const*>(record.data()), length};
+    record.remove_prefix(length);
+    return true;
+}
+
+void wal_put_string_update(std::string& record,
+                           ustore_collection_t collection,
+                           std::string_view key,
+                           value_view_t value) noexcept(false) {
+    if (record.empty())
+        wal_put(record, wal_strings_k);
+    wal_put(record, collection);
+    wal_put(record, static_cast<ustore_length_t>(key.size()));
+    record.append(key);
+    wal_put(record, value ? static_cast<ustore_length_t>(value.size()) : ustore_length_missing_k);
+    if (value.size())
+        record.append(reinterpret_cast<char const*>(value.data()), value.size());
+}
+
+bool wal_get_string_update(std::string_view& record,
+                           ustore_collection_t& collection,
+                           std::string_view& key,
+                           value_view_t& value) noexcept {
+    ustore_length_t length = 0;
+    if (!wal_get(record, collection) || !wal_get(record, length) || record.size() < length)
+        return false;
+    key = record.substr(0, length);
+    record.remove_prefix(length);
+    if (!wal_get(record, length))
+        return false;
+    if (length == ustore_length_missing_k) {
+        value = value_view_t {};
+        return true;
+    }
+    if (record.size() < length)
+        return false;
+    value = value_view_t {reinterpret_cast<byte_t const*>(record.data()), length};
+    record.remove_prefix(length);
+    return true;
+}
+
+stdfs::path wal_path(database_t const& db, std::size_t segment) {
+    return stdfs::path(db.persisted_directory) / ("journal." + std::to_string(segment) + ".wal");
+}
+
+/**
+ * @brief Lists the log segments in the `persisted_directory` in the order they were written.
+ */
+std::vector<std::pair<std::size_t, stdfs::path>> wal_segments(database_t const& db) noexcept(false) {
+    std::vector<std::pair<std::size_t, stdfs::path>> segments;
+    std::string_view prefix {"journal."}, suffix {".wal"};
+    for (auto const& dir_entry : stdfs::directory_iterator {db.persisted_directory}) {
+        std::string file_name = dir_entry.path().filename();
+        if (file_name.size() <= prefix.size() + suffix.size() || file_name.compare(0, prefix.size(), prefix) != 0 ||
+            !ends_with(file_name, suffix))
+            continue;
+        std::string number = file_name.substr(prefix.size(), file_name.size() - prefix.size() - suffix.size());
+        if (number.find_first_not_of("0123456789") != std::string::npos)
+            continue;
+        segments.emplace_back(std::stoull(number), dir_entry.path());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+/**
+ * @brief Switches the log to the next segment, durably closing the current one.
+ * Requires the `restructuring_mutex` to be held, as the new segment starts with collection names.
+ */
+void open_wal_segment(database_t& db, std::unique_lock<std::mutex>& log_lock, ustore_error_t* c_error) noexcept(false) {
+    db.wal.open(log_lock, wal_path(db, db.wal_segment + 1).c_str(), c_error);
+    return_if_error_m(c_error);
+    ++db.wal_segment;
+
+    std::string record;
+    for (auto const& [name, collection_id] : db.names) {
+        record.clear();
+        wal_put(record, wal_collection_k);
+        wal_put(record, collection_id);
+        record.append(name);
+        db.wal.append(record, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Appends a `record`, already applied in memory under the `log_lock`, and waits
+ * for it to reach the disk, if `ustore_option_write_flush_k` is set.
+ */
+void log_record( //
+    database_t& db,
+    std::unique_lock<std::mutex>& log_lock,
+    std::string_view record,
+    ustore_options_t options,
+    ustore_error_t* c_error) noexcept {
+
+    std::uint64_t sequence_number = db.wal.append(record, c_error);
+    return_if_error_m(c_error);
+    if (db.wal.size() >= db.options.checkpoint_interval)
+        db.checkpoint_wakeup.notify_one();
+    db.wal.commit(log_lock, sequence_number, options & ustore_option_write_flush_k, c_error);
+}
+
+/**
+ * @brief Marks the collections, touched by a batch of updates serialized with `wal_put_update`,
+ * for the next checkpoint. Must be called under the log lock.
+ */
+void mark_dirty(database_t& db, std::string_view record, ustore_error_t* c_error) noexcept {
+
+    std::string_view updates = record.substr(1);
+    collection_key_t key;
+    value_view_t value;
+    ustore_collection_t last_collection = ustore_collection_main_k;
+    bool first = true;
+    safe_section("Marking dirty collections", c_error, [&] {
+        while (wal_get_update(updates, key, value)) {
+            if (first || key.collection != last_collection)
+                db.dirty.insert(key.collection);
+            last_collection = key.collection, first = false;
+        }
+    });
+}
+
+/**
+ * @brief Logs a batch of updates, serialized with `wal_put_update`,
+ * marking the collections they touch for the next checkpoint.
+ */
+void log_updates( //
+    database_t& db,
+    std::unique_lock<std::mutex>& log_lock,
+    std::string_view record,
+    ustore_options_t options,
+    ustore_error_t* c_error) noexcept {
+
+    mark_dirty(db, record, c_error);
+    return_if_error_m(c_error);
+    log_record(db, log_lock, record, options, c_error);
+}
+
+void save_collection(database_t& db, ustore_collection_t collection_id, ustore_error_t* c_error) noexcept(false) {
+    // Half-written files must never replace the previous checkpoint
+    stdfs::path path = collection_path(db, collection_id);
+    stdfs::path temporary_path = path;
+    temporary_path += ".tmp";
+    write_collection(db, collection_id, temporary_path, c_error);
+    return_if_error_m(c_error);
+    stdfs::rename(temporary_path, path);
+}
+
+/**
+ * @brief Persists the collections modified since the last checkpoint, and removes the log
+ * segments, that become obsolete. Writes go into a new log segment meanwhile.
+ */
+void checkpoint(database_t& db, ustore_error_t* c_error) noexcept(false) {
+
+    std::unique_lock checkpoint_lock {db.checkpoint_mutex};
+    std::shared_lock restructuring_lock {db.restructuring_mutex};
+
+    // 1. Switch to a new segment, so everything in the older ones is in memory
+    std::unordered_set<ustore_collection_t> dirty;
+    std::unordered_set<std::string> dropped;
+    std::size_t obsolete_segment = 0;
+    {
+        auto log_lock = db.wal.lock();
+        obsolete_segment = db.wal_segment;
+        open_wal_segment(db, log_lock, c_error);
+        return_if_error_m(c_error);
+        std::swap(dirty, db.dirty);
+        std::swap(dropped, db.dropped);
+    }
+
+    // 2. Persist the modified collections, unless they were dropped since.
+    // Evicted and sealed ones are already on disk.
+    std::vector<ustore_collection_t> collections;
+    for (ustore_collection_t collection : dirty)
+        if (!db.evicted.count(collection) && !db.sealed.count(collection) &&
+            !collection_path(db, collection).empty())
+            collections.push_back(collection);
+    parallel_for(collections.size(), c_error, [&](std::size_t i, ustore_error_t* thread_error) {
+        save_collection(db, collections[i], thread_error);
+    });
+    for (auto const& name : dropped)
+        if (!*c_error && !db.names.count(name))
+            stdfs::remove(stdfs::path(db.persisted_directory) / (name + persisted_extension(db)));
+    if (!*c_error) {
+        std::shared_lock strings_lock {db.strings_mutex};
+        for (auto const& [name, collection] : db.names)
+            if (auto it = db.strings.find(collection); it != db.strings.end() && dirty.count(collection))
+                save_strings(db, name, it->second);
+    }
+
+    // 3. On failure, keep the old segments and retry with the next checkpoint
+    if (*c_error) {
+        auto log_lock = db.wal.lock();
+        db.dirty.insert(dirty.begin(), dirty.end());
+        db.dropped.insert(dropped.begin(), dropped.end());
+        return;
+    }
+    for (auto const& [segment, path] : wal_segments(db))
+        if (segment <= obsolete_segment)
+            stdfs::remove(path);
+}
+
+void run_checkpoints(database_t& db) noexcept {
+    auto log_lock = db.wal.lock();
+    while (true) {
+        db.checkpoint_wakeup.wait(log_lock, [&] {
+            return db.checkpointer_stopping || db.wal.size() >= db.options.checkpoint_interval;
+        });
+        if (db.checkpointer_stopping)
+            return;
+
+        log_lock.unlock();
+        ustore_error_t c_error = nullptr;
+        safe_section("Checkpointing", &c_error, [&] { checkpoint(db, &c_error); });
+        log_lock.lock();
+
+        // Don't spin, if the disk is failing
+        if (c_error)
+            db.checkpoint_wakeup.wait_for(log_lock, std::chrono::seconds(1), [&] { return db.checkpointer_stopping; });
+    }
+}
+
+void stop_checkpoints(database_t& db) noexcept {
+    if (!db.checkpointer.joinable())
+        return;
+    {
+        auto log_lock = db.wal.lock();
+        db.checkpointer_stopping = true;
+    }
+    db.checkpoint_wakeup.notify_all();
+    db.checkpointer.join();
+}
+
+/**
+ * @brief Shared by `ustore_collection_drop` and the log replay.
+ * Expects the `restructuring_mutex` to be exclusively locked.
+ */
+void drop_collection(database_t& db, ustore_collection_t id, ustore_drop_mode_t mode, ustore_error_t* c_error) noexcept {
+
+    // Statistics are rebuilt on the next measurement
+    db.statistics.forget(id);
+
+    // Evicted contents are either discarded, or reloaded to be modified
+    if (db.evicted.count(id)) {
+        if (mode == ustore_drop_vals_k)
+            safe_section("Reloading evicted collection", c_error, [&] {
+                read_collection(db, id, collection_path(db, id), true, c_error);
+            });
+        return_if_error_m(c_error);
+        db.evicted.erase(id);
+    }
+
+    // Sealed contents are either discarded, or moved into memory to be modified
+    if (mode == ustore_drop_vals_k)
+        unseal_collection(db, id, c_error);
+    else
+        db.sealed.erase(id);
+    return_if_error_m(c_error);
+
+    if (mode == ustore_drop_keys_vals_handle_k) {
+        auto status = db.pairs.erase_range(id, id + 1, no_op_t {});
+        if (!status)
+            return export_error_code(status, c_error);
+
+        for (auto it = db.names.begin(); it != db.names.end(); ++it) {
+            if (id != it->second)
+                continue;
+            db.names.erase(it);
+            break;
+        }
+    }
+
+    else if (mode == ustore_drop_keys_vals_k) {
+        auto status = db.pairs.erase_range(id, id + 1, no_op_t {});
+        return export_error_code(status, c_error);
+    }
+
+    else if (mode == ustore_drop_vals_k) {
+        auto status = db.pairs.range(id, id + 1, [&](pair_t& pair) noexcept {
+            pair = pair_t {pair.collection_key, value_view_t::make_empty(), *db.values, nullptr};
+        });
+        return export_error_code(status, c_error);
+    }
+}
+
+/**
+ * @brief Reapplies the updates logged after the last checkpoint, on top of the loaded collections.
+ * Replay of a segment stops at the first damaged record, which happens if the process crashed mid-write.
+ */
+void replay(database_t& db, ustore_error_t* c_error) noexcept(false) {
+
+    std::vector<pair_t> pairs;
+    for (auto const& [segment, path] : wal_segments(db)) {
+        std::ifstream ifs(path, std::ios::binary);
+        std::string contents {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+
+        // Logged IDs are only valid within a segment
+        std::unordered_map<ustore_collection_t, ustore_collection_t> ids;
+        ids.emplace(ustore_collection_main_k, ustore_collection_main_k);
+
+        std::string_view log {contents};
+        std::string_view payload;
+        while (write_ahead_log_t::next(log, payload)) {
+            wal_record_t type;
+            if (!wal_get(payload, type))
+                break;
+
+            if (type == wal_collection_k) {
+                ustore_collection_t logged_id;
+                if (!wal_get(payload, logged_id))
+                    break;
+                std::string name {payload};
+                auto name_it = db.names.find(name);
+                if (name_it == db.names.end())
+                    name_it = db.names.emplace(name, new_collection(db)).first;
+                ids[logged_id] = name_it->second;
+                db.dirty.insert(name_it->second);
+            }
+
+            else if (type == wal_drop_k) {
+                ustore_collection_t logged_id;
+                std::uint8_t mode;
+                if (!wal_get(payload, logged_id) || !wal_get(payload, mode))
+                    break;
+                auto id_it = ids.find(logged_id);
+                if (id_it == ids.end())
+                    continue;
+                for (auto const& [name, collection_id] : db.names)
+                    if (collection_id == id_it->second && mode == ustore_drop_keys_vals_handle_k)
+                        db.dropped.insert(name);
+                drop_collection(db, id_it->second, static_cast<ustore_drop_mode_t>(mode), c_error);
+                return_if_error_m(c_error);
+                drop_strings(db, id_it->second, static_cast<ustore_drop_mode_t>(mode));
+                if (mode == ustore_drop_keys_vals_handle_k)
+                    ids.erase(id_it);
+                else
+                    db.dirty.insert(id_it->second);
+            }
+
+            else if (type == wal_write_k) {
+                pairs.clear();
+                collection_key_t key;
+                value_view_t value;
+                while (wal_get_update(payload, key, value)) {
+                    auto id_it = ids.find(key.collection);
+                    if (id_it == ids.end())
+                        continue;
+                    key.collection = id_it->second;
+                    db.dirty.insert(key.collection);
+                    unseal_collection(db, key.collection, c_error);
+                    return_if_error_m(c_error);
+                    pairs.emplace_back(key, value, *db.values, c_error);
+                    return_if_error_m(c_error);
+                }
+                auto status = db.pairs.upsert(pairs.data(), pairs.data() + pairs.size());
+                export_error_code(status, c_error);
+                return_if_error_m(c_error);
+            }
+
+            else if (type == wal_strings_k) {
+                ustore_collection_t logged_id;
+                std::string_view key;
+                value_view_t value;
+                while (wal_get_string_update(payload, logged_id, key, value)) {
+                    auto id_it = ids.find(logged_id);
+                    if (id_it == ids.end())
+                        continue;
+                    db.dirty.insert(id_it->second);
+                    string_pairs_t& string_pairs = db.strings[id_it->second];
+                    if (!value) {
+                        if (auto it = string_pairs.find(key); it != string_pairs.end())
+                            string_pairs.erase(it);
+                        continue;
+                    }
+                    string_pairs.insert_or_assign(std::string(key), std::string(value.c_str(), value.size()));
+                }
+            }
+        }
+        db.wal_segment = segment;
+    }
+}
+
+/**
+ * @brief Applies a group of queued transactions one after another, taking the snapshots
+ * and log locks once. Their records are appended to the log together, and a single flush
+ * covers every transaction, that requested one.
+ */
+void commit_group(database_t& db, std::vector<commit_request_t*> const& group) noexcept {
+
+    bool const logged = is_logged(db);
+    bool const needs_log = logged && std::any_of(group.begin(), group.end(), [](commit_request_t const* request) {
+        return !request->transaction->redo.empty();
+    });
+
+    // Same as the batch writes, the stripes are held, if some collection has statistics
+    std::uint64_t stripes = 0;
+    for (commit_request_t* request : group) {
+        std::vector<collection_key_t> const& keys = request->transaction->updated_keys;
+        stripes |= merge_lock_t::stripes_of(keys.size(), [&](std::size_t i) noexcept { return keys[i]; });
+    }
+    auto has_tracked_keys = [&] {
+        return std::any_of(group.begin(), group.end(), [&](commit_request_t const* request) {
+            std::vector<collection_key_t> const& keys = request->transaction->updated_keys;
+            return has_statistics(db, keys.size(), [&](std::size_t i) noexcept { return keys[i]; });
+        });
+    };
+    merge_lock_t merge_lock;
+    if (db.statistics.any())
+        merge_lock = merge_lock_t(db, stripes);
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (!merge_lock && stripes && has_tracked_keys()) {
+        snapshots_lock.unlock();
+        merge_lock = merge_lock_t(db, stripes);
+        snapshots_lock.lock();
+    }
+    std::unique_lock<std::mutex> log_lock;
+    if (needs_log)
+        log_lock = db.wal.lock();
+
+    std::uint64_t last_logged = 0;
+    bool sync = false;
+    replacements_t replacements;
+    for (commit_request_t* request : group) {
+        transaction_t& txn = *request->transaction;
+        ustore_error_t* c_error = request->error;
+        if (!db.snapshots.empty()) {
+            auto keys = [&](std::size_t i) noexcept {
+                return txn.updated_keys[i];
+            };
+            preserve_versions(db, keys, txn.updated_keys.size(), c_error);
+            if (*c_error)
+                continue;
+        }
+
+        // Pairs, replaced by this transaction, may have been committed by the earlier members of the group
+        replacements.clear();
+        if (merge_lock && db.statistics.any())
+            safe_section("Collecting replaced pairs", c_error, [&] {
+                for (collection_key_t const& key : txn.updated_keys) {
+                    entry_summary_t replacing;
+                    auto status = txn.find(
+                        key,
+                        [&](pair_t const& pair) noexcept { replacing = summarize(pair.range, pair.space_usage()); },
+                        []() noexcept {});
+                    export_error_code(status, c_error);
+                    if (!*c_error)
+                        replacements.collect(db, key, replacing, c_error);
+                    if (*c_error)
+                        return;
+                }
+            });
+        if (*c_error)
+            continue;
+
+        // Watches are validated while staging, against the generations of pairs committed
+        // by the earlier members of the group, so conflicts between them are still detected
+        auto status = txn.stage();
+        if (!status) {
+            export_error_code(status, c_error);
+            continue;
+        }
+        status = txn.commit();
+        if (!status) {
+            export_error_code(status, c_error);
+            continue;
+        }
+        replacements.apply();
+
+        if (request->sequence_number)
+            *request->sequence_number = txn.generation();
+        txn.updated_keys.clear();
+        if (!log_lock || txn.redo.empty())
+            continue;
+
+        mark_dirty(db, txn.redo, c_error);
+        if (*c_error)
+            continue;
+        std::uint64_t sequence_number = db.wal.append(txn.redo, c_error);
+        txn.redo.clear();
+        if (*c_error)
+            continue;
+        last_logged = sequence_number;
+        sync |= request->options & ustore_option_write_flush_k;
+    }
+
+    if (last_logged) {
+        if (db.wal.size() >= db.options.checkpoint_interval)
+            db.checkpoint_wakeup.notify_one();
+        ustore_error_t log_error = nullptr;
+        db.wal.commit(log_lock, last_logged, sync, &log_error);
+        for (commit_request_t* request : group)
+            if (log_error && !*request->error)
+                *request->error = log_error;
+        return;
+    }
+
+    // TODO: Degrade the lock to "shared" state before starting expensive IO
+    bool const needs_save = !logged && std::any_of(group.begin(), group.end(), [](commit_request_t const* request) {
+        return !*request->error && (request->options & ustore_option_write_flush_k);
+    });
+    if (!needs_save)
+        return;
+    ustore_error_t save_error = nullptr;
+    safe_section("Saving to disk", &save_error, [&] { write(db, db.persisted_directory, &save_error); });
+    for (commit_request_t* request : group)
+        if (save_error && !*request->error && (request->options & ustore_option_write_flush_k))
+            *request->error = save_error;
+}
+
+/*********************************************************/
+/*****************	     Expiration  	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Schedules every present key of a collection with a TTL, like after loading it from disk.
+ */
+void schedule_expirations(database_t& db, ustore_collection_t collection, ustore_error_t* c_error) noexcept(false) {
+    auto status = db.pairs.range(collection, collection + 1, [&](pair_t const& pair) noexcept(false) {
+        if (pair.range.size() >= deadline_bytes_k)
+            db.expirations.schedule(stored_deadline(pair.range), pair.collection_key);
+    });
+    export_error_code(status, c_error);
+}
+
+/**
+ * @brief Schedules the keys, just written with `stamp_deadlines`.
+ */
+void schedule_expirations( //
+    database_t& db,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_error_t* c_error) noexcept {
+
+    safe_section("Scheduling expirations", c_error, [&] {
+        for (std::size_t i = 0; i != places.size(); ++i)
+            if (value_view_t content = contents[i]; content && db.ttls.find(places[i].collection))
+                db.expirations.schedule(stored_deadline(content), places[i].collection_key());
+    });
+}
+
+/**
+ * @brief Removes the due keys in a single transaction, so that the concurrent rewrites
+ * conflict with it, instead of being lost. On conflicts, retries with one transaction per key.
+ * Removals aren't logged: the expired values, that were persisted, are hidden and scheduled again on load.
+ */
+void sweep_expired(database_t& db) noexcept(false) {
+    std::vector<collection_key_t> due;
+    deadline_t const now = now_ms();
+    db.expirations.pop_due(now, due);
+    if (due.empty())
+        return;
+
+    // Removals are reflected in the statistics, same as the regular updates
+    auto due_keys = [&](std::size_t i) noexcept {
+        return due[i];
+    };
+    merge_lock_t merge_lock;
+    if (db.statistics.any())
+        merge_lock = merge_lock_t(db, merge_lock_t::stripes_of(due.size(), due_keys));
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (!merge_lock && has_statistics(db, due.size(), due_keys)) {
+        snapshots_lock.unlock();
+        merge_lock = merge_lock_t(db, merge_lock_t::stripes_of(due.size(), due_keys));
+        snapshots_lock.lock();
+    }
+
+    std::unordered_set<ustore_collection_t> swept;
+    replacements_t replacements;
+    auto erase_expired = [&](collection_key_t const* begin, collection_key_t const* end) {
+        auto maybe_txn = db.pairs.transaction();
+        if (!maybe_txn)
+            return false;
+        ucset_t::transaction_t& txn = *maybe_txn;
+        ustore_error_t c_error = nullptr;
+        replacements.clear();
+        for (auto it = begin; it != end; ++it) {
+            bool expired = false;
+            if (!txn.watch(*it))
+                return false;
+            auto status = txn.find(
+                *it,
+                [&](pair_t const& pair) noexcept { expired = is_expired(pair.range, now); },
+                []() noexcept {});
+            if (!status || (expired && !txn.erase(*it)))
+                return false;
+            if (expired && merge_lock)
+                replacements.collect(db, *it, {}, &c_error);
+            if (c_error)
+                return false;
+        }
+        if (!txn.stage() || !txn.commit())
+            return false;
+        replacements.apply();
+        for (auto it = begin; it != end; ++it)
+            swept.insert(it->collection);
+        return true;
+    };
+    if (!erase_expired(due.data(), due.data() + due.size()))
+        for (collection_key_t const& key : due)
+            erase_expired(&key, &key + 1);
+
+    // The next checkpoint will rewrite the swept collections without the expired keys
+    if (is_logged(db)) {
+        auto log_lock = db.wal.lock();
+        db.dirty.insert(swept.begin(), swept.end());
+    }
+}
+
+void run_sweeps(database_t& db) noexcept {
+    std::unique_lock lock {db.sweeper_mutex};
+    auto const period = std::chrono::milliseconds(expiration_wheel_gt<collection_key_t>::bucket_ms_k);
+    while (true) {
+        db.sweeper_wakeup.wait_for(lock, period, [&] { return db.sweeper_stopping; });
+        if (db.sweeper_stopping)
+            return;
+
+        lock.unlock();
+        ustore_error_t c_error = nullptr;
+        safe_section("Sweeping expired keys", &c_error, [&] { sweep_expired(db); });
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Starts the sweeper with the first collection with a TTL.
+ * Expects the `restructuring_mutex` to be exclusively locked.
+ */
+void start_sweeps(database_t& db) noexcept(false) {
+    if (!db.sweeper.joinable())
+        db.sweeper = std::thread(run_sweeps, std::ref(db));
+}
+
+void stop_sweeps(database_t& db) noexcept {
+    if (!db.sweeper.joinable())
+        return;
+    {
+        std::unique_lock _ {db.sweeper_mutex};
+        db.sweeper_stopping = true;
+    }
+    db.sweeper_wakeup.notify_all();
+    db.sweeper.join();
+}
+
+/*********************************************************/
+/*****************       Compaction       ****************/
+/*********************************************************/
+
+/** @brief Slabs, where live values occupy at most this share of space, are evacuated. */
+constexpr double compaction_occupancy_k = 0.25;
+/** @brief Share of the reserved memory, that may stay unused, before the background compaction starts. */
+constexpr double compaction_waste_k = 0.25;
+/** @brief Number of pairs visited at once, between which the writers can proceed. */
+constexpr std::size_t compaction_slice_k = 256;
+constexpr std::size_t compaction_period_ms_k = 1000;
+
+bool is_evacuating(database_t& db, pair_t const& pair) noexcept {
+    if (!pair.range.size() || pair.is_inline())
+        return false;
+    return db.values->evacuating(pair.range.data(), pair.range.size());
+}
+
+/**
+ * @brief Copies the evacuated values of the `keys` into fresh memory within a transaction, so that the
+ * pairs modified in the meantime are skipped, instead of being reverted. The contents don't change,
+ * so nothing is logged and the snapshots don't need the replaced versions. Transactions, watching
+ * those keys, will still see a conflict, like after any other write.
+ */
+void relocate(database_t& db,
+              ucset_t::transaction_t& txn,
+              std::vector<collection_key_t> const& keys,
+              ustore_error_t* c_error) noexcept {
+
+    auto status = txn.reset();
+    if (!status)
+        return export_error_code(status, c_error);
+
+    std::size_t relocated_values = 0;
+    std::size_t relocated_bytes = 0;
+    for (collection_key_t const& key : keys) {
+        if (status = txn.watch(key); !status)
+            return export_error_code(status, c_error);
+        pair_t copy;
+        status = txn.find(
+            key,
+            [&](pair_t const& pair) noexcept { copy = pair_t {key, pair.range, *db.values, c_error}; },
+            []() noexcept {});
+        if (!status)
+            return export_error_code(status, c_error);
+        return_if_error_m(c_error);
+        if (!copy)
+            continue;
+        relocated_values += 1;
+        relocated_bytes += copy.range.size();
+        if (status = txn.upsert(std::move(copy)); !status)
+            return export_error_code(status, c_error);
+    }
+
+    // Failures mean, that some of the pairs were replaced, releasing the evacuated values anyway
+    std::shared_lock _ {db.snapshots_mutex};
+    if (!txn.stage() || !txn.commit())
+        return;
+    db.compaction.relocated_values += relocated_values;
+    db.compaction.relocated_bytes += relocated_bytes;
+}
+
+/**
+ * @brief Relocates the evacuated versions, preserved in snapshots. Those aren't removed,
+ * until the snapshot is dropped, so the visits are resumed after the `snapshot->mutex` is released.
+ */
+void relocate_snapshots(database_t& db, ustore_error_t* c_error) noexcept {
+    std::shared_lock _ {db.snapshots_mutex};
+    for (auto& [id, snapshot] : db.snapshots) {
+        std::unique_lock snapshot_lock {snapshot->mutex};
+        std::size_t visited = 0;
+        for (auto& [key, pair] : snapshot->versions) {
+            if (is_evacuating(db, pair)) {
+                pair_t copy {key, pair.range, *db.values, c_error};
+                return_if_error_m(c_error);
+                db.compaction.relocated_values += 1;
+                db.compaction.relocated_bytes += copy.range.size();
+                pair = std::move(copy);
+            }
+            if (++visited % compaction_slice_k == 0) {
+                snapshot_lock.unlock();
+                std::this_thread::yield();
+                snapshot_lock.lock();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Evacuates the sparsely occupied slabs of the values allocator of this database,
+ * relocating its values in short slices, so that the writers are never stalled for long.
+ */
+void compact(database_t& db, ustore_error_t* c_error) noexcept(false) {
+    std::unique_lock compaction_lock {db.compaction_mutex};
+    db.compaction.running = true;
+    auto stop_running = [&] {
+        db.compaction.running = false;
+        db.compaction.passes += 1;
+    };
+
+    if (!db.values->evacuate(compaction_occupancy_k))
+        return stop_running();
+
+    auto maybe_txn = db.pairs.transaction();
+    if (!maybe_txn) {
+        stop_running();
+        log_error_m(c_error, error_unknown_k, "Couldn't start a transaction");
+        return;
+    }
+    ucset_t::transaction_t txn = std::move(maybe_txn).value();
+
+    collection_key_t previous {
+        std::numeric_limits<ustore_collection_t>::min(),
+        std::numeric_limits<ustore_key_t>::min(),
+    };
+    std::vector<collection_key_t> keys;
+    keys.reserve(compaction_slice_k);
+    auto collect = [&](pair_t const& pair) noexcept {
+        if (is_evacuating(db, pair))
+            keys.push_back(pair.collection_key);
+    };
+    auto status = db.pairs.find(previous, collect, []() noexcept {});
+
+    bool reached_end = false;
+    while (status && !reached_end && !*c_error && !db.compactor_stopping) {
+        std::size_t visited = 0;
+        while (status && !reached_end && visited != compaction_slice_k) {
+            status = db.pairs.upper_bound(
+                previous,
+                [&](pair_t const& pair) noexcept {
+                    collect(pair);
+                    previous = pair.collection_key;
+                },
+                [&]() noexcept { reached_end = true; });
+            visited += !reached_end;
+        }
+        db.compaction.visited_pairs += visited;
+        if (!keys.empty())
+            relocate(db, txn, keys, c_error);
+        keys.clear();
+        std::this_thread::yield();
+    }
+    export_error_code(status, c_error);
+
+    if (!*c_error && !db.compactor_stopping)
+        relocate_snapshots(db, c_error);
+    stop_running();
+}
+
+void run_compactions(database_t& db) noexcept {
+    std::unique_lock lock {db.compactor_mutex};
+    auto const period = std::chrono::milliseconds(compaction_period_ms_k);
+    while (true) {
+        db.compactor_wakeup.wait_for(lock, period, [&] { return db.compactor_stopping.load(); });
+        if (db.compactor_stopping)
+            return;
+
+        slab_allocator_t const& allocator = *db.values;
+        std::size_t const reserved = allocator.reserved_bytes();
+        std::size_t const used = allocator.used_bytes();
+        std::size_t const wasted = reserved - std::min(reserved, used);
+        if (wasted < slab_allocator_t::slab_size_k || wasted < compaction_waste_k * reserved)
+            continue;
+
+        lock.unlock();
+        ustore_error_t c_error = nullptr;
+        safe_section("Compacting", &c_error, [&] { compact(db, &c_error); });
+        lock.lock();
+    }
+}
+
+void stop_compactions(database_t& db) noexcept {
+    if (!db.compactor.joinable())
+        return;
+    {
+        std::unique_lock _ {db.compactor_mutex};
+        db.compactor_stopping = true;
+    }
+    db.compactor_wakeup.notify_all();
+    db.compactor.join();
+}
+
+/*********************************************************/
+/*****************   Native String Keys   ****************/
+/*********************************************************/
+
+bool unum::ustore::has_string_keys(ustore_database_t c_db, ustore_collection_t collection) noexcept {
+    database_t& db = *reinterpret_cast<database_t*>(c_db);
+    std::shared_lock _ {db.strings_mutex};
+    return db.strings.count(collection) != 0;
+}
+
+void unum::ustore::read_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_snapshot_t c_snapshot,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    ustore_options_t,
+    growing_tape_t& values,
+    ustore_error_t* c_error) noexcept {
+
+    database_t& db = *reinterpret_cast<database_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, missing_feature_k, "UCSet transactions don't cover string keys!");
+    return_error_if_m(!c_snapshot, c_error, missing_feature_k, "UCSet snapshots don't cover string keys!");
+
+    std::shared_lock _ {db.strings_mutex};
+    for (std::size_t i = 0; i != keys.count; ++i) {
+        string_pairs_t const* pairs = find_strings(db, collections ? collections[i] : ustore_collection_main_k);
+        return_error_if_m(pairs, c_error, args_wrong_k, "Collection has no string keys!");
+        auto it = pairs->find(std::string_view(keys[i]));
+        values.push_back(it != pairs->end() ? value_view_t {std::string_view(it->second)} : value_view_t {}, c_error);
+        return_if_error_m(c_error);
+    }
+}
 
-        std::shared_ptr<arrow::io::ReadableFile> in_file;
-        PARQUET_ASSIGN_OR_THROW(in_file, arrow::io::ReadableFile::Open(collection_path));
-        parquet::StreamReader os {parquet::ParquetFileReader::Open(in_file)};
-
-        ustore_key_t key;
-        std::optional<std::string> value;
-        while (!os.eof()) {
-            os >> key >> value >> parquet::EndRow;
-
-            pair_t pair;
-            pair.collection_key.collection = collection_id;
-            pair.collection_key.key = key;
-
-            // Converting to our internal representation would require a copy
-            if (value) {
-                auto buf_len = value->size();
-                auto buf_ptr = blob_allocator_t {}.allocate(buf_len);
-                return_error_if_m(buf_ptr != nullptr, c_error, out_of_memory_k, "Failed to allocate a blob");
-                pair.range = value_view_t {buf_ptr, buf_len};
-                std::memcpy(buf_ptr, value->data(), value->size());
-            }
-            else
-                pair.range = value_view_t::make_empty();
+void unum::ustore::write_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    contents_arg_t const& values,
+    ustore_options_t options,
+    ustore_error_t* c_error) noexcept {
 
-            auto status = db.pairs.upsert(std::move(pair));
-            export_error_code(status, c_error);
-            return_if_error_m(c_error);
+    database_t& db = *reinterpret_cast<database_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, missing_feature_k, "UCSet transactions don't cover string keys!");
+
+    // Like other writes, updates are applied in memory under the log lock, and logged right after
+    std::string record;
+    std::shared_lock restructuring_lock {db.restructuring_mutex};
+    std::unique_lock _ {db.strings_mutex};
+    std::unique_lock<std::mutex> log_lock;
+    bool const logged = is_logged(db);
+    if (logged)
+        log_lock = db.wal.lock();
+    safe_section("Updating string keys", c_error, [&] {
+        for (std::size_t i = 0; i != keys.count; ++i) {
+            ustore_collection_t const collection = collections ? collections[i] : ustore_collection_main_k;
+            string_pairs_t* pairs = find_strings(db, collection);
+            return_error_if_m(pairs, c_error, args_wrong_k, "Collection has no string keys!");
+            std::string_view key = keys[i];
+            value_view_t value = values[i];
+            if (logged) {
+                wal_put_string_update(record, collection, key, value);
+                db.dirty.insert(collection);
+            }
+            if (!value) {
+                if (auto it = pairs->find(key); it != pairs->end())
+                    pairs->erase(it);
+                continue;
+            }
+            pairs->insert_or_assign(std::string(key), std::string(value.c_str(), value.size()));
         }
+    });
+    return_if_error_m(c_error);
+    if (!record.empty())
+        log_record(db, log_lock, record, options, c_error);
+}
+
+void unum::ustore::scan_strings( //
+    ustore_database_t c_db,
+    ustore_transaction_t c_transaction,
+    ustore_collection_t collection,
+    std::string_view start_key,
+    ustore_length_t count_limit,
+    ustore_options_t,
+    growing_tape_t& keys,
+    ustore_error_t* c_error) noexcept {
+
+    database_t& db = *reinterpret_cast<database_t*>(c_db);
+    return_error_if_m(!c_transaction, c_error, missing_feature_k, "UCSet transactions don't cover string keys!");
+
+    std::shared_lock _ {db.strings_mutex};
+    string_pairs_t const* pairs = find_strings(db, collection);
+    return_error_if_m(pairs, c_error, args_wrong_k, "Collection has no string keys!");
+    auto it = pairs->lower_bound(start_key);
+    for (ustore_length_t count = 0; it != pairs->end() && count != count_limit; ++it, ++count) {
+        keys.push_back(value_view_t {std::string_view(it->first)}, c_error);
+        return_if_error_m(c_error);
     }
 }
 
@@ -427,14 +3048,10 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
 
     ustore_database_init_t& c = *c_ptr;
     safe_section("Initializing DBMS", c.error, [&] {
-        auto maybe_pairs = ucset_t::make();
-        return_error_if_m(maybe_pairs, c.error, error_unknown_k, "Couldn't build consistent set");
-        auto db = database_t(std::move(maybe_pairs).value());
-        auto db_ptr = std::make_unique<database_t>(std::move(db)).release();
-
+        config_t config;
+        ucset_options_t options;
         if (c.config && std::strlen(c.config) > 0) {
             // Load config
-            config_t config;
             auto status = config_loader_t::load_from_json_string(c.config, config);
             return_error_if_m(status, c.error, args_wrong_k, status.message());
 
@@ -451,54 +3068,148 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
 
             // Engine config
             return_error_if_m(config.engine.config_url.empty(), c.error, args_wrong_k, "Doesn't support URL configs");
-            return_error_if_m(config.engine.config.empty(), c.error, args_wrong_k, "Doesn't support nested configs");
 
-            auto fill_options = [](json_t const& js, ucset_options_t& options) {
+            auto fill_options = [&](json_t const& js, ucset_options_t& options) {
                 if (js.contains("encryption"))
                     options.encryption = js["encryption"];
                 if (js.contains("compression"))
                     options.compression = js["compression"];
                 if (js.contains("memory_limit"))
-                    options.memory_limit = js["memory_limit"];
+                    options.memory_limit = parse_bytes(js["memory_limit"], c.error);
+                if (js.contains("memory_policy")) {
+                    std::string policy = js["memory_policy"];
+                    return_error_if_m(policy == "reject" || policy == "evict",
+                                      c.error,
+                                      args_wrong_k,
+                                      "Memory policy can be either \"reject\" or \"evict\"");
+                    options.memory_policy = policy == "evict" ? memory_policy_evict_k : memory_policy_reject_k;
+                }
+                if (js.contains("partitions"))
+                    options.partitions = js["partitions"];
+                if (js.contains("write_ahead_log"))
+                    options.write_ahead_log = js["write_ahead_log"];
+                if (js.contains("checkpoint_interval"))
+                    options.checkpoint_interval = parse_bytes(js["checkpoint_interval"], c.error);
+                if (js.contains("sealed_files"))
+                    options.sealed_files = js["sealed_files"];
+                if (js.contains("compaction"))
+                    options.compaction = js["compaction"];
             };
 
             // Load from file
-            ucset_options_t options;
             if (!config.engine.config_file_path.empty()) {
                 std::ifstream ifs(config.engine.config_file_path);
                 return_error_if_m(ifs, c.error, args_wrong_k, "Config file not found");
                 auto js = json_t::parse(ifs);
                 fill_options(js, options);
+                return_if_error_m(c.error);
             }
             // Override with nested
             if (!config.engine.config.empty())
                 fill_options(config.engine.config, options);
+            return_if_error_m(c.error);
+            return_error_if_m(options.partitions > 0, c.error, args_wrong_k, "At least one partition is needed");
+        }
+
+        auto maybe_pairs = ucset_t::make(options.partitions);
+        return_error_if_m(maybe_pairs, c.error, error_unknown_k, "Couldn't build consistent set");
+        auto db = database_t(std::move(maybe_pairs).value(), options);
+        auto db_ptr = std::make_unique<database_t>(std::move(db)).release();
 
+        if (c.config && std::strlen(c.config) > 0) {
+            stdfs::path root = config.directory;
             db_ptr->persisted_directory = root;
             read(*db_ptr, db_ptr->persisted_directory, c.error);
+            return_if_error_m(c.error);
+            load_all_strings(*db_ptr);
+            if (is_logged(*db_ptr)) {
+                replay(*db_ptr, c.error);
+                return_if_error_m(c.error);
+                load_all_strings(*db_ptr);
+                checkpoint(*db_ptr, c.error);
+                return_if_error_m(c.error);
+                db_ptr->checkpointer = std::thread(run_checkpoints, std::ref(*db_ptr));
+            }
+
+            // Expired values, that were persisted, are scheduled for removal again
+            for (auto const& [name, ttl_ms] : load_ttls(root)) {
+                auto name_it = db_ptr->names.find(name);
+                if (name_it == db_ptr->names.end())
+                    continue;
+                db_ptr->ttls.set(name_it->second, ttl_ms);
+                schedule_expirations(*db_ptr, name_it->second, c.error);
+                return_if_error_m(c.error);
+            }
+            if (db_ptr->ttls.any())
+                start_sweeps(*db_ptr);
         }
+        register_threads(db_ptr, config);
+        if (options.compaction)
+            db_ptr->compactor = std::thread(run_compactions, std::ref(*db_ptr));
         *c.db = db_ptr;
     });
 }
 
 void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
+
     ustore_snapshot_list_t& c = *c_ptr;
-    *c.count = 0;
-    if (c.ids)
-        *c.ids = nullptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count && c.ids, c.error, args_combo_k, "Need outputs!");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::shared_lock _ {db.snapshots_mutex};
+    std::size_t snapshots_count = db.snapshots.size();
+    *c.count = static_cast<ustore_size_t>(snapshots_count);
+
+    // For every snapshot we also need to export IDs
+    auto ids = arena.alloc_or_dummy(snapshots_count, c.error, c.ids);
+    return_if_error_m(c.error);
+
+    std::size_t i = 0;
+    for (auto const& [id, _] : db.snapshots)
+        ids[i++] = id;
 }
 
-void ustore_snapshot_create(ustore_snapshot_create_t*) {
-    // TODO
+void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
+
+    ustore_snapshot_create_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.id, c.error, args_wrong_k, "Need an output for the snapshot ID");
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::unique_lock _ {db.snapshots_mutex};
+    safe_section("Allocating snapshot handle", c.error, [&] {
+        auto snapshot = std::make_unique<snapshot_t>();
+        auto id = reinterpret_cast<ustore_snapshot_t>(snapshot.get());
+        db.snapshots.emplace(id, std::move(snapshot));
+        *c.id = id;
+    });
 }
 
-void ustore_snapshot_drop(ustore_snapshot_drop_t*) {
-    // TODO
+void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
+
+    if (!c_ptr)
+        return;
+
+    ustore_snapshot_drop_t& c = *c_ptr;
+    if (!c.id)
+        return;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    std::unique_lock _ {db.snapshots_mutex};
+    db.snapshots.erase(c.id);
 }
 
 void ustore_read(ustore_read_t* c_ptr) {
 
     ustore_read_t& c = *c_ptr;
+    if (deduplicates_reads(c))
+        return deduplicate_gather_join_scatter(c, [](ustore_read_t& unique) { ustore_read(&unique); });
+    operation_timer_t timer {operation_t::read_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -511,27 +3222,52 @@ void ustore_read(ustore_read_t* c_ptr) {
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     places_arg_t places {collections, keys, {}, c.tasks_count};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
+    slices_arg_t slices {slices_starts, slices_lengths, c.values_limit};
     validate_read(c.transaction, places, c.options, c.error);
     return_if_error_m(c.error);
+    bool const keep_sealed = !c.transaction && !c.snapshot;
+    auto resident_lock = lock_resident(db, collections, places.size(), keep_sealed, c.error);
+    return_if_error_m(c.error);
+    std::shared_lock<std::shared_mutex> snapshots_lock;
+    std::optional<snapshot_view_t> snapshot;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_t* snapshot_ptr = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_ptr, c.error, args_wrong_k, "The snapshot doesn't exist!");
+        snapshot.emplace(db.pairs, *snapshot_ptr);
+    }
 
     // 1. Allocate a tape for all the values to be pulled
     growing_tape_t tape(arena);
     tape.reserve(places.size(), c.error);
     return_if_error_m(c.error);
-    auto back_inserter = [&](value_view_t value) noexcept {
-        tape.push_back(value, c.error);
-    };
 
-    // 2. Pull the data
-    for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
-        place_t place = places[task_idx];
-        collection_key_t key = place.collection_key();
-        auto status = c.transaction //
-                          ? find_and_watch(txn, key, c.options, back_inserter)
-                          : find_and_watch(db.pairs, key, c.options, back_inserter);
-        if (!status)
-            return export_error_code(status, c.error);
-    }
+    // 2. Pull the data, reporting the expired values missing
+    deadline_t const now = db.ttls.any() ? now_ms() : 0;
+    auto pairs_lock = db.pairs.lock_reads();
+    places.dispatch([&](auto const& places) {
+        for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
+            place_t place = places[task_idx];
+            collection_key_t key = place.collection_key();
+            std::uint64_t const ttl = now ? db.ttls.find(key.collection) : 0;
+            auto deliver = [&](value_view_t value) noexcept {
+                tape.push_back(slices.apply(task_idx, ttl ? unexpired(value, now) : value), c.error);
+            };
+            if (sealed_collection_t const* sealed = find_sealed(db, key.collection)) {
+                std::size_t idx = sealed->find(key.key);
+                deliver(idx != sealed->size() ? sealed->value(idx) : value_view_t {});
+                continue;
+            }
+            auto status = snapshot        ? find_and_watch(*snapshot, key, c.options, deliver)
+                          : c.transaction ? find_and_watch(txn, key, c.options, deliver)
+                                          : find_and_watch(db.pairs, key, c.options, deliver);
+            if (!status)
+                return export_error_code(status, c.error);
+        }
+    });
+    return_if_error_m(c.error);
 
     // 3. Export the results
     if (c.presences)
@@ -547,6 +3283,13 @@ void ustore_read(ustore_read_t* c_ptr) {
 void ustore_write(ustore_write_t* c_ptr) {
 
     ustore_write_t& c = *c_ptr;
+    if (c.positions) {
+        // Positional writes come back here as merges of splice operands
+        linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+        return_if_error_m(c.error);
+        return write_spliced(c, arena);
+    }
+    operation_timer_t timer {operation_t::write_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -569,12 +3312,64 @@ void ustore_write(ustore_write_t* c_ptr) {
     validate_write(c.transaction, places, contents, c.options, c.error);
     return_if_error_m(c.error);
 
+    // Estimate the memory needed for the new values, ignoring the ones being replaced
+    if (db.options.memory_limit) {
+        std::size_t incoming_bytes = 0;
+        for (std::size_t i = 0; i != places.size(); ++i)
+            if (std::size_t length = contents[i].size(); length > pair_inline_capacity_k)
+                incoming_bytes += slab_allocator_t::capacity_for(length);
+        respect_memory_limit(db, incoming_bytes, collections, places.size(), c.error);
+        return_if_error_m(c.error);
+    }
+    auto resident_lock = lock_resident(db, collections, places.size(), false, c.error);
+    return_if_error_m(c.error);
+
+    // Values of collections with a TTL are stored with their deadlines appended
+    growing_tape_t stamped(arena);
+    ustore_bytes_cptr_t stamped_begin = nullptr;
+    bool expiring = false;
+    if (db.ttls.any()) {
+        for (std::size_t i = 0; i != places.size() && !expiring; ++i)
+            expiring = db.ttls.find(places[i].collection);
+        return_error_if_m(!expiring || !(c.options & ustore_option_write_merge_k),
+                          c.error,
+                          args_combo_k,
+                          "Can't merge into collections with a TTL");
+        if (expiring)
+            safe_section("Stamping deadlines", c.error, [&] {
+                auto ttl = [&](ustore_collection_t collection) noexcept {
+                    return db.ttls.find(collection);
+                };
+                stamp_deadlines(places, contents, ttl, stamped, stamped_begin, c.error);
+            });
+        return_if_error_m(c.error);
+    }
+
+    // Merge operands are replaced with the merged values, before the regular write path
+    merge_lock_t merge_lock;
+    growing_tape_t merged(arena);
+    ustore_bytes_cptr_t merged_begin = nullptr;
+    if (c.options & ustore_option_write_merge_k) {
+        merge_lock = merge_lock_t(db, places);
+        if (c.transaction)
+            merge_values(txn, places, contents, c.options, merged, c.error);
+        else
+            merge_values(db.pairs, places, contents, c.options, merged, c.error);
+        return_if_error_m(c.error);
+        merged_begin = reinterpret_cast<ustore_bytes_cptr_t>(merged.contents().begin().get());
+        contents.presences_begin = {};
+        contents.offsets_begin = {merged.offsets().begin().get(), sizeof(ustore_length_t)};
+        contents.lengths_begin = {merged.lengths().begin().get(), sizeof(ustore_length_t)};
+        contents.contents_begin = {&merged_begin, 0};
+    }
+
     // Writes are the only operations that significantly differ
     // in terms of transactional and batch operations.
     // The latter will also differ depending on the number
     // pairs you are working with - one or more.
     if (c.transaction) {
         bool dont_watch = c.options & ustore_option_transaction_dont_watch_k;
+        bool const logged = is_logged(db);
         for (std::size_t i = 0; i != places.size(); ++i) {
             place_t place = places[i];
             value_view_t content = contents[i];
@@ -582,10 +3377,16 @@ void ustore_write(ustore_write_t* c_ptr) {
             if (!dont_watch)
                 if (auto watch_status = txn.watch(key); !watch_status)
                     return export_error_code(watch_status, c.error);
+            safe_section("Logging transaction", c.error, [&] {
+                txn.updated_keys.push_back(key);
+                if (logged)
+                    wal_put_update(txn.redo, key, content);
+            });
+            return_if_error_m(c.error);
 
             ucset::status_t status;
             if (content) {
-                pair_t pair {key, content, c.error};
+                pair_t pair {key, content, *db.values, c.error};
                 return_if_error_m(c.error);
                 status = txn.upsert(std::move(pair));
             }
@@ -595,28 +3396,76 @@ void ustore_write(ustore_write_t* c_ptr) {
             if (!status)
                 return export_error_code(status, c.error);
         }
+        if (expiring)
+            schedule_expirations(db, places, contents, c.error);
         return;
     }
 
+    // Updates are serialized ahead of time, to hold the log only while applying them
+    std::string redo;
+    std::unique_lock<std::mutex> log_lock;
+    if (is_logged(db)) {
+        safe_section("Logging updates", c.error, [&] {
+            redo.reserve(places.size() * (sizeof(collection_key_t) + sizeof(ustore_length_t)) + 1);
+            for (std::size_t i = 0; i != places.size(); ++i)
+                wal_put_update(redo, places[i].collection_key(), contents[i]);
+        });
+        return_if_error_m(c.error);
+    }
+
+    // Snapshots can't be created, until the updates are applied.
+    // Neither can the statistics be built, which also need the stripes of the keys to be locked.
+    auto collection_keys = [&](std::size_t i) noexcept {
+        return places[i].collection_key();
+    };
+    if (!merge_lock && db.statistics.any())
+        merge_lock = merge_lock_t(db, places);
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (!merge_lock && has_statistics(db, places.size(), collection_keys)) {
+        snapshots_lock.unlock();
+        merge_lock = merge_lock_t(db, places);
+        snapshots_lock.lock();
+    }
+    if (!db.snapshots.empty()) {
+        preserve_versions(db, collection_keys, places.size(), c.error);
+        return_if_error_m(c.error);
+    }
+
+    replacements_t replacements;
+    if (merge_lock && db.statistics.any())
+        safe_section("Collecting replaced pairs", c.error, [&] {
+            for (std::size_t i = 0; i != places.size() && !*c.error; ++i) {
+                value_view_t content = contents[i];
+                auto replacing = summarize(content, pair_t::space_usage_for(content.size()));
+                replacements.collect(db, places[i].collection_key(), replacing, c.error);
+            }
+        });
+    return_if_error_m(c.error);
+
     // Non-transactional but atomic batch-write operation.
     // It requires producing a copy of input data.
-    else if (c.tasks_count > 1) {
+    if (c.tasks_count > 1) {
         uninitialized_array_gt<pair_t> copies(places.count, arena, c.error);
         return_if_error_m(c.error);
         initialized_range_gt<pair_t> copies_constructed(copies);
 
-        for (std::size_t i = 0; i != places.size(); ++i) {
-            place_t place = places[i];
-            value_view_t content = contents[i];
-            collection_key_t key = place.collection_key();
+        places.dispatch([&](auto const& places) {
+            for (std::size_t i = 0; i != places.size(); ++i) {
+                place_t place = places[i];
+                value_view_t content = contents[i];
+                collection_key_t key = place.collection_key();
 
-            pair_t pair {key, content, c.error};
-            return_if_error_m(c.error);
-            copies[i] = std::move(pair);
-        }
+                pair_t pair {key, content, *db.values, c.error};
+                return_if_error_m(c.error);
+                copies[i] = std::move(pair);
+            }
+        });
+        return_if_error_m(c.error);
 
-        auto status = db.pairs.upsert(std::make_move_iterator(copies.begin()), std::make_move_iterator(copies.end()));
-        return export_error_code(status, c.error);
+        if (!redo.empty())
+            log_lock = db.wal.lock();
+        auto status = db.pairs.upsert(copies.begin(), copies.end());
+        export_error_code(status, c.error);
     }
 
     // Just a single non-batch write
@@ -625,16 +3474,26 @@ void ustore_write(ustore_write_t* c_ptr) {
         value_view_t content = contents[0];
         collection_key_t key = place.collection_key();
 
-        pair_t pair {key, content, c.error};
+        pair_t pair {key, content, *db.values, c.error};
         return_if_error_m(c.error);
+        if (!redo.empty())
+            log_lock = db.wal.lock();
         auto status = db.pairs.upsert(std::move(pair));
-        return export_error_code(status, c.error);
+        export_error_code(status, c.error);
     }
+
+    return_if_error_m(c.error);
+    replacements.apply();
+    if (expiring)
+        schedule_expirations(db, places, contents, c.error);
+    if (log_lock)
+        log_updates(db, log_lock, redo, c.options, c.error);
 }
 
 void ustore_scan(ustore_scan_t* c_ptr) {
 
     ustore_scan_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::scan_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -651,6 +3510,17 @@ void ustore_scan(ustore_scan_t* c_ptr) {
 
     validate_scan(c.transaction, scans, c.options, c.error);
     return_if_error_m(c.error);
+    bool const keep_sealed = !c.transaction && !c.snapshot;
+    auto resident_lock = lock_resident(db, collections, scans.count, keep_sealed, c.error);
+    return_if_error_m(c.error);
+    std::shared_lock<std::shared_mutex> snapshots_lock;
+    std::optional<snapshot_view_t> snapshot;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_t* snapshot_ptr = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_ptr, c.error, args_wrong_k, "The snapshot doesn't exist!");
+        snapshot.emplace(db.pairs, *snapshot_ptr);
+    }
 
     // 1. Allocate a tape for all the values to be fetched
     auto offsets = arena.alloc_or_dummy(scans.count + 1, c.error, c.offsets);
@@ -662,56 +3532,79 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Values are copied while the keys are visited
+    bool const export_values = c.values;
+    growing_tape_t tape(arena);
+    if (export_values) {
+        tape.reserve(total_keys, c.error);
+        return_if_error_m(c.error);
+    }
+
     // 2. Fetch the data
+    auto pairs_lock = db.pairs.lock_reads();
     for (std::size_t task_idx = 0; task_idx != scans.count; ++task_idx) {
         scan_t scan = scans[task_idx];
         offsets[task_idx] = keys_output - *c.keys;
 
+        // Expired entries are skipped, without counting towards the limit
+        std::uint64_t const ttl = db.ttls.find(scan.collection);
+        deadline_t const now = ttl ? now_ms() : 0;
         ustore_length_t matched_pairs_count = 0;
-        auto found_pair = [&](pair_t const& pair) noexcept {
-            *keys_output = pair.collection_key.key;
+        auto found = [&](ustore_key_t key, value_view_t value) noexcept {
+            if (ttl && !(value = unexpired(value, now)))
+                return false;
+            *keys_output = key;
             ++keys_output;
             ++matched_pairs_count;
+            if (export_values)
+                tape.push_back(value, c.error);
+            return true;
         };
+        auto found_pair = [&](pair_t const& pair) noexcept {
+            return found(pair.collection_key.key, pair.range);
+        };
+
+        // Sealed keys are already sorted, so the matches are continuous
+        if (sealed_collection_t const* sealed = find_sealed(db, scan.collection)) {
+            std::size_t idx = sealed->lower_bound(scan.min_key);
+            for (; idx != sealed->size() && matched_pairs_count != scan.limit; ++idx)
+                found(sealed->key(idx), sealed->value(idx));
+            return_if_error_m(c.error);
+            counts[task_idx] = matched_pairs_count;
+            continue;
+        }
 
         auto previous_key = collection_key_t {scan.collection, scan.min_key};
-        auto status = c.transaction //
-                          ? scan_and_watch(txn, previous_key, scan.limit, c.options, found_pair)
-                          : scan_and_watch(db.pairs, previous_key, scan.limit, c.options, found_pair);
+        auto status = ucset::status_t();
+        safe_section("Scanning", c.error, [&] {
+            status = snapshot        ? scan_and_watch(*snapshot, previous_key, scan.limit, c.options, found_pair)
+                     : c.transaction ? scan_and_watch(txn, previous_key, scan.limit, c.options, found_pair)
+                                     : scan_and_watch(db.pairs, previous_key, scan.limit, c.options, found_pair);
+        });
+        return_if_error_m(c.error);
         if (!status)
             return export_error_code(status, c.error);
 
+        return_if_error_m(c.error);
         counts[task_idx] = matched_pairs_count;
     }
     offsets[scans.count] = keys_output - *c.keys;
-}
-
-struct key_from_pair_t {
-    ustore_key_t* key_ptr;
-    key_from_pair_t(ustore_key_t* key) : key_ptr(key) {}
-    key_from_pair_t& operator=(pair_t const& pair) {
-        *key_ptr = pair.collection_key.key;
-        return *this;
-    };
-};
 
-struct key_iterator_t {
-    using value_type = ustore_key_t;
-    using pointer = value_type*;
-    using reference = value_type&;
-    using difference_type = std::ptrdiff_t;
-    using iterator_category = std::random_access_iterator_tag;
-
-    ustore_key_t* begin_;
-    key_iterator_t(ustore_key_t* key) : begin_(key) {}
-    key_from_pair_t operator[](std::size_t idx) { return &begin_[idx]; };
-};
+    // 3. Export the values
+    if (export_values) {
+        *c.values = (ustore_bytes_ptr_t)tape.contents().begin().get();
+        if (c.values_offsets)
+            *c.values_offsets = tape.offsets().begin().get();
+        if (c.values_lengths)
+            *c.values_lengths = tape.lengths().begin().get();
+    }
+}
 
 void ustore_sample(ustore_sample_t* c_ptr) {
 
     ustore_sample_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::sample_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
-    return_error_if_m(!c.transaction, c.error, uninitialized_state_k, "Transaction sampling aren't supported!");
     if (!c.tasks_count)
         return;
 
@@ -719,9 +3612,21 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     return_if_error_m(c.error);
 
     database_t& db = *reinterpret_cast<database_t*>(c.db);
+    transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_length_t const> lens {c.count_limits, c.count_limits_stride};
     sample_args_t samples {collections, lens, c.tasks_count};
+    bool const keep_sealed = !c.transaction && !c.snapshot;
+    auto resident_lock = lock_resident(db, collections, samples.count, keep_sealed, c.error);
+    return_if_error_m(c.error);
+    std::shared_lock<std::shared_mutex> snapshots_lock;
+    std::optional<snapshot_view_t> snapshot;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_t* snapshot_ptr = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_ptr, c.error, args_wrong_k, "The snapshot doesn't exist!");
+        snapshot.emplace(db.pairs, *snapshot_ptr);
+    }
 
     auto offsets = arena.alloc_or_dummy(samples.count + 1, c.error, c.offsets);
     return_if_error_m(c.error);
@@ -732,23 +3637,61 @@ void ustore_sample(ustore_sample_t* c_ptr) {
     auto keys_output = *c.keys = arena.alloc<ustore_key_t>(total_keys, c.error).begin();
     return_if_error_m(c.error);
 
+    // Sampled keys are watched separately, instead of every visited one
+    bool const dont_watch = c.options & ustore_option_transaction_dont_watch_k;
+    auto const scan_options = ustore_options_t(c.options | ustore_option_transaction_dont_watch_k);
+    random_generator_t& random_generator = thread_random_generator();
     for (std::size_t task_idx = 0; task_idx != samples.count; ++task_idx) {
         sample_arg_t task = samples[task_idx];
         offsets[task_idx] = keys_output - *c.keys;
 
-        std::random_device random_device;
-        std::mt19937 random_generator(random_device());
-        std::size_t seen = 0;
-        key_iterator_t iter(keys_output);
+        reservoir_sampler_gt<ustore_key_t> sampler(keys_output, task.limit, random_generator);
+        std::uint64_t const ttl = db.ttls.find(task.collection);
+        deadline_t const now = ttl ? now_ms() : 0;
+        auto is_visible = [&](value_view_t value) noexcept {
+            return !ttl || !is_expired(value, now);
+        };
+        auto sample_pair = [&](pair_t const& pair) noexcept {
+            bool const visible = pair && is_visible(pair.range);
+            if (visible)
+                sampler(pair.collection_key.key);
+            return visible;
+        };
+        auto sample_range = [&](pair_t const& pair) noexcept {
+            sample_pair(pair);
+        };
         collection_key_t min(task.collection, std::numeric_limits<ustore_key_t>::min());
         collection_key_t max(task.collection, std::numeric_limits<ustore_key_t>::max());
-
-        auto status = db.pairs.sample_range(min, max, random_generator, seen, task.limit, iter);
+        std::size_t const unlimited = std::numeric_limits<std::size_t>::max();
+
+        auto status = ucset::status_t();
+        sealed_collection_t const* sealed = find_sealed(db, task.collection);
+        if (sealed) {
+            for (std::size_t idx = 0; idx != sealed->size() && task.limit; ++idx)
+                if (is_visible(sealed->value(idx)))
+                    sampler(sealed->key(idx));
+        }
+        else if (task.limit) {
+            safe_section("Sampling", c.error, [&] {
+                status = snapshot        ? scan_and_watch(*snapshot, min, unlimited, scan_options, sample_pair)
+                         : c.transaction ? scan_and_watch(txn, min, unlimited, scan_options, sample_pair)
+                                         : db.pairs.range(min, max, sample_range);
+            });
+        }
+        return_if_error_m(c.error);
         export_error_code(status, c.error);
         return_if_error_m(c.error);
 
-        counts[task_idx] = task.limit;
-        keys_output += task.limit;
+        ustore_length_t const sampled = static_cast<ustore_length_t>(sampler.size());
+        if (c.transaction && !snapshot && !dont_watch)
+            for (ustore_length_t i = 0; i != sampled; ++i) {
+                status = txn.watch(collection_key_t {task.collection, keys_output[i]});
+                export_error_code(status, c.error);
+                return_if_error_m(c.error);
+            }
+
+        counts[task_idx] = sampled;
+        keys_output += sampled;
     }
     offsets[samples.count] = keys_output - *c.keys;
 }
@@ -756,6 +3699,7 @@ void ustore_sample(ustore_sample_t* c_ptr) {
 void ustore_measure(ustore_measure_t* c_ptr) {
 
     ustore_measure_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::measure_k, c.tasks_count, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     if (!c.tasks_count)
         return;
@@ -776,23 +3720,84 @@ void ustore_measure(ustore_measure_t* c_ptr) {
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
     strided_iterator_gt<ustore_key_t const> end_keys {c.end_keys, c.end_keys_stride};
+    bool const keep_sealed = !c.transaction && !c.snapshot;
+    auto resident_lock = lock_resident(db, collections, c.tasks_count, keep_sealed, c.error);
+    return_if_error_m(c.error);
+    std::shared_lock<std::shared_mutex> snapshots_lock;
+    std::optional<snapshot_view_t> snapshot;
+    if (c.snapshot) {
+        snapshots_lock = std::shared_lock {db.snapshots_mutex};
+        snapshot_t* snapshot_ptr = find_snapshot(db, c.snapshot);
+        return_error_if_m(snapshot_ptr, c.error, args_wrong_k, "The snapshot doesn't exist!");
+        snapshot.emplace(db.pairs, *snapshot_ptr);
+    }
+    auto collection_at = [&](std::size_t i) noexcept {
+        return collections ? collections[i] : ustore_collection_main_k;
+    };
+
+    // Collections, measured for the first time, are walked entirely once, and their statistics
+    // are maintained by the updates afterwards. Those are paused, so that none is missed.
+    if (!snapshot) {
+        auto lacks_statistics = [&](ustore_collection_t collection) noexcept {
+            return !find_sealed(db, collection) && !db.statistics.find(collection);
+        };
+        bool lacking = false;
+        for (std::size_t i = 0; i != c.tasks_count && !lacking; ++i)
+            lacking = lacks_statistics(collection_at(i));
+        if (lacking) {
+            std::unique_lock _ {db.snapshots_mutex};
+            for (std::size_t i = 0; i != c.tasks_count; ++i)
+                if (ustore_collection_t collection = collection_at(i); lacks_statistics(collection))
+                    build_statistics(db, collection, c.error);
+            return_if_error_m(c.error);
+        }
+    }
 
     for (ustore_size_t i = 0; i != c.tasks_count; ++i) {
-        auto collection = collections[i];
+        auto collection = collection_at(i);
         ustore_key_t const min_key = start_keys[i];
         ustore_key_t const max_key = end_keys[i];
 
         collection_key_t min(collection, min_key);
         collection_key_t max(collection, max_key);
 
+        // Ranges, that cover all the entries of a collection, are measured exactly in constant time
+        std::shared_ptr<collection_stats_t> stats = snapshot ? nullptr : db.statistics.find(collection);
+        if (stats && stats->within(min_key, max_key)) {
+            min_cardinalities[i] = max_cardinalities[i] = static_cast<ustore_size_t>(stats->keys.load());
+            min_value_bytes[i] = max_value_bytes[i] = static_cast<ustore_size_t>(stats->value_bytes.load());
+            min_space_usages[i] = max_space_usages[i] = static_cast<ustore_size_t>(stats->space_usage.load());
+            continue;
+        }
+
         std::size_t cardinality = 0;
         std::size_t value_bytes = 0;
         std::size_t space_usage = 0;
-        auto status = db.pairs.range(min, max, [&](pair_t& pair) noexcept {
-            ++cardinality;
+        auto measure = [&](pair_t const& pair) noexcept {
+            cardinality += bool(pair);
             value_bytes += pair.range.size();
-            space_usage += pair.range.size() + sizeof(pair_t);
-        });
+            space_usage += pair.space_usage();
+        };
+        auto status = ucset::status_t();
+        if (sealed_collection_t const* sealed = find_sealed(db, collection)) {
+            std::size_t const begin = sealed->lower_bound(min_key);
+            std::size_t const end = std::max(begin, sealed->lower_bound(max_key));
+            cardinality = end - begin;
+            value_bytes = sealed->value_bytes(begin, end);
+            space_usage = value_bytes + cardinality * (sizeof(ustore_key_t) + sizeof(std::uint64_t));
+        }
+        else if (snapshot)
+            safe_section("Measuring snapshot", c.error, [&] {
+                status = snapshot->scan(min, 1, [&](pair_t const& pair) noexcept {
+                    if (!(pair.collection_key < max))
+                        return false;
+                    measure(pair);
+                    return true;
+                });
+            });
+        else
+            status = db.pairs.range(min, max, measure);
+        return_if_error_m(c.error);
         export_error_code(status, c.error);
         return_if_error_m(c.error);
 
@@ -822,9 +3827,53 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
     auto collection_it = db.names.find(collection_name);
     return_error_if_m(collection_it == db.names.end(), c.error, args_wrong_k, "Such collection already exists!");
 
+    std::uint64_t ttl_ms = 0;
+    parse_ttl(c.config, ttl_ms, c.error);
+    return_if_error_m(c.error);
+    bool string_keys = false;
+    parse_string_keys(c.config, string_keys, c.error);
+    return_if_error_m(c.error);
+    return_error_if_m(!ttl_ms || !string_keys, c.error, args_combo_k, "Collections with string keys can't expire");
+
     auto new_collection_id = new_collection(db);
     safe_section("Inserting new collection", c.error, [&] { db.names.emplace(collection_name, new_collection_id); });
+    return_if_error_m(c.error);
     *c.id = new_collection_id;
+
+    if (ttl_ms)
+        safe_section("Persisting the TTL", c.error, [&] {
+            db.ttls.set(new_collection_id, ttl_ms);
+            if (!db.persisted_directory.empty()) {
+                auto ttls = load_ttls(db.persisted_directory);
+                ttls[std::string(collection_name)] = ttl_ms;
+                save_ttls(db.persisted_directory, ttls);
+            }
+            start_sweeps(db);
+        });
+    return_if_error_m(c.error);
+
+    if (string_keys)
+        safe_section("Persisting the kind of keys", c.error, [&] {
+            std::unique_lock strings_lock {db.strings_mutex};
+            db.strings[new_collection_id];
+            if (!db.persisted_directory.empty()) {
+                auto string_keyed = load_string_keyed(db.persisted_directory);
+                string_keyed.insert(std::string(collection_name));
+                save_string_keyed(db.persisted_directory, string_keyed);
+            }
+        });
+    return_if_error_m(c.error);
+
+    if (is_logged(db))
+        safe_section("Logging new collection", c.error, [&] {
+            std::string record;
+            wal_put(record, wal_collection_k);
+            wal_put(record, new_collection_id);
+            record.append(collection_name);
+            auto log_lock = db.wal.lock();
+            db.dirty.insert(new_collection_id);
+            log_record(db, log_lock, record, ustore_options_default_k, c.error);
+        });
 }
 
 void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
@@ -841,30 +3890,71 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     database_t& db = *reinterpret_cast<database_t*>(c.db);
     std::unique_lock _ {db.restructuring_mutex};
 
-    if (c.mode == ustore_drop_keys_vals_handle_k) {
-        auto status = db.pairs.erase_range(c.id, c.id + 1, no_op_t {});
-        if (!status)
-            return export_error_code(status, c.error);
+    std::optional<std::string> dropped_name;
+    if (c.mode == ustore_drop_keys_vals_handle_k)
+        for (auto const& [name, collection_id] : db.names)
+            if (collection_id == c.id)
+                safe_section("Remembering dropped collection", c.error, [&] { dropped_name = name; });
+    return_if_error_m(c.error);
 
-        for (auto it = db.names.begin(); it != db.names.end(); ++it) {
-            if (c.id != it->second)
-                continue;
-            db.names.erase(it);
-            break;
+    // Evicted collections must be brought back to preserve their versions
+    std::shared_lock snapshots_lock {db.snapshots_mutex};
+    if (!db.snapshots.empty()) {
+        if (db.evicted.count(c.id)) {
+            safe_section("Reloading evicted collection", c.error, [&] {
+                read_collection(db, c.id, collection_path(db, c.id), true, c.error);
+            });
+            return_if_error_m(c.error);
+            db.evicted.erase(c.id);
         }
+        unseal_collection(db, c.id, c.error);
+        return_if_error_m(c.error);
+        preserve_collection(db, c.id, c.error);
+        return_if_error_m(c.error);
     }
+    drop_collection(db, c.id, c.mode, c.error);
+    return_if_error_m(c.error);
 
-    else if (c.mode == ustore_drop_keys_vals_k) {
-        auto status = db.pairs.erase_range(c.id, c.id + 1, no_op_t {});
-        return export_error_code(status, c.error);
-    }
+    if (dropped_name && db.ttls.find(c.id))
+        safe_section("Forgetting the TTL", c.error, [&] {
+            db.ttls.set(c.id, 0);
+            if (!db.persisted_directory.empty()) {
+                auto ttls = load_ttls(db.persisted_directory);
+                ttls.erase(*dropped_name);
+                save_ttls(db.persisted_directory, ttls);
+            }
+        });
+    return_if_error_m(c.error);
+
+    safe_section("Dropping string keys", c.error, [&] {
+        std::unique_lock strings_lock {db.strings_mutex};
+        if (!find_strings(db, c.id))
+            return;
+        drop_strings(db, c.id, c.mode);
+        if (!dropped_name)
+            return;
+        if (!db.persisted_directory.empty()) {
+            auto string_keyed = load_string_keyed(db.persisted_directory);
+            string_keyed.erase(*dropped_name);
+            save_string_keyed(db.persisted_directory, string_keyed);
+            stdfs::remove(strings_path(db, *dropped_name));
+        }
+    });
+    return_if_error_m(c.error);
 
-    else if (c.mode == ustore_drop_vals_k) {
-        auto status = db.pairs.range(c.id, c.id + 1, [&](pair_t& pair) noexcept {
-            pair = pair_t {pair.collection_key, value_view_t::make_empty(), nullptr};
+    if (is_logged(db))
+        safe_section("Logging dropped collection", c.error, [&] {
+            std::string record;
+            wal_put(record, wal_drop_k);
+            wal_put(record, c.id);
+            wal_put(record, static_cast<std::uint8_t>(c.mode));
+            auto log_lock = db.wal.lock();
+            if (dropped_name)
+                db.dropped.insert(*dropped_name);
+            else
+                db.dirty.insert(c.id);
+            log_record(db, log_lock, record, ustore_options_default_k, c.error);
         });
-        return export_error_code(status, c.error);
-    }
 }
 
 void ustore_collection_list(ustore_collection_list_t* c_ptr) {
@@ -915,7 +4005,109 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
     return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
 
     *c.response = NULL;
-    log_error_m(c.error, missing_feature_k, "Controls aren't supported in this implementation!");
+    if (control_metrics(c))
+        return;
+
+    database_t& db = *reinterpret_cast<database_t*>(c.db);
+    if (std::strcmp(c.request, "usage") == 0) {
+        linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+        return_if_error_m(c.error);
+
+        std::size_t sealed_bytes = 0;
+        {
+            std::shared_lock _ {db.restructuring_mutex};
+            for (auto const& [collection, sealed] : db.sealed)
+                sealed_bytes += sealed->space_usage();
+        }
+
+        slab_allocator_t const& allocator = *db.values;
+        json_t usage = {
+            {"memory_limit", db.options.memory_limit},
+            {"used_bytes", allocator.used_bytes()},
+            {"reserved_bytes", allocator.reserved_bytes()},
+            {"sealed_bytes", sealed_bytes},
+        };
+        std::string usage_str = usage.dump();
+        auto response = arena.alloc<char>(usage_str.size() + 1, c.error).begin();
+        return_if_error_m(c.error);
+        std::memcpy(response, usage_str.c_str(), usage_str.size() + 1);
+        *c.response = response;
+        return;
+    }
+
+    // Only the collections, that were measured at least once, have statistics
+    if (std::strcmp(c.request, "statistics") == 0) {
+        linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+        return_if_error_m(c.error);
+
+        std::string statistics_str;
+        safe_section("Exporting statistics", c.error, [&] {
+            json_t statistics = json_t::object();
+            std::shared_lock _ {db.restructuring_mutex};
+            db.statistics.for_each([&](ustore_collection_t collection, collection_stats_t const& stats) {
+                std::string name;
+                for (auto const& [collection_name, collection_id] : db.names)
+                    if (collection_id == collection)
+                        name = collection_name;
+                if (collection != ustore_collection_main_k && name.empty())
+                    return;
+                json_t& exported = statistics[name];
+                exported["keys"] = stats.keys.load();
+                exported["value_bytes"] = stats.value_bytes.load();
+                exported["space_usage"] = stats.space_usage.load();
+                exported["distinct_values"] = static_cast<std::uint64_t>(stats.distinct_values.estimate());
+                if (!stats.empty()) {
+                    exported["min_key"] = stats.min_key.load();
+                    exported["max_key"] = stats.max_key.load();
+                }
+            });
+            statistics_str = statistics.dump();
+        });
+        return_if_error_m(c.error);
+        auto response = arena.alloc<char>(statistics_str.size() + 1, c.error).begin();
+        return_if_error_m(c.error);
+        std::memcpy(response, statistics_str.c_str(), statistics_str.size() + 1);
+        *c.response = response;
+        return;
+    }
+
+    if (std::strcmp(c.request, "checkpoint") == 0) {
+        return_error_if_m(is_logged(db), c.error, args_wrong_k, "Write-ahead log is disabled");
+        safe_section("Checkpointing", c.error, [&] { checkpoint(db, c.error); });
+        return;
+    }
+
+    if (std::strcmp(c.request, "compact") == 0) {
+        safe_section("Compacting", c.error, [&] { compact(db, c.error); });
+        return;
+    }
+
+    if (std::strcmp(c.request, "compaction") == 0) {
+        linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+        return_if_error_m(c.error);
+
+        slab_allocator_t const& allocator = *db.values;
+        json_t progress = {
+            {"running", db.compaction.running.load()},
+            {"passes", db.compaction.passes.load()},
+            {"visited_pairs", db.compaction.visited_pairs.load()},
+            {"relocated_values", db.compaction.relocated_values.load()},
+            {"relocated_bytes", db.compaction.relocated_bytes.load()},
+            {"evacuating_slabs", allocator.evacuating_slabs()},
+            {"released_bytes", allocator.released_bytes()},
+        };
+        std::string progress_str = progress.dump();
+        auto response = arena.alloc<char>(progress_str.size() + 1, c.error).begin();
+        return_if_error_m(c.error);
+        std::memcpy(response, progress_str.c_str(), progress_str.size() + 1);
+        *c.response = response;
+        return;
+    }
+
+    log_error_m(c.error,
+                missing_feature_k,
+                "Only \"usage\", \"statistics\", \"checkpoint\", \"compact\", \"compaction\" and \"metrics\" "
+                "controls are supported in this implementation!");
 }
 
 /*********************************************************/
@@ -941,6 +4133,8 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
     return_if_error_m(c.error);
 
     transaction_t& txn = *reinterpret_cast<transaction_t*>(*c.transaction);
+    txn.redo.clear();
+    txn.updated_keys.clear();
     auto status = txn.reset();
     return export_error_code(status, c.error);
 }
@@ -948,25 +4142,39 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
 void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
 
     ustore_transaction_commit_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::commit_k, 1, c.error};
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     database_t& db = *reinterpret_cast<database_t*>(c.db);
 
     validate_transaction_commit(c.transaction, c.options, c.error);
     return_if_error_m(c.error);
     transaction_t& txn = *reinterpret_cast<transaction_t*>(c.transaction);
-    auto status = txn.stage();
-    if (!status)
-        return export_error_code(status, c.error);
-    status = txn.commit();
-    if (!status)
-        return export_error_code(status, c.error);
 
-    if (c.sequence_number)
-        *c.sequence_number = txn.generation();
+    // Wait for the current leader to commit this transaction, or become the next one
+    commit_request_t request;
+    request.transaction = &txn;
+    request.options = c.options;
+    request.sequence_number = c.sequence_number;
+    request.error = c.error;
+    std::vector<commit_request_t*> group;
+    {
+        std::unique_lock commits_lock {db.commits_mutex};
+        safe_section("Queueing the commit", c.error, [&] { db.commits.push_back(&request); });
+        return_if_error_m(c.error);
+        db.commits_done.wait(commits_lock, [&] { return request.done || !db.committing; });
+        if (request.done)
+            return;
+        db.committing = true;
+        group.swap(db.commits);
+    }
+
+    commit_group(db, group);
 
-    // TODO: Degrade the lock to "shared" state before starting expensive IO
-    if (c.options & ustore_option_write_flush_k)
-        safe_section("Saving to disk", c.error, [&] { write(db, db.persisted_directory, c.error); });
+    std::unique_lock commits_lock {db.commits_mutex};
+    for (commit_request_t* member : group)
+        member->done = true;
+    db.committing = false;
+    db.commits_done.notify_all();
 }
 
 /*********************************************************/
@@ -988,10 +4196,20 @@ void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
 
+    threads_registry_t::global().forget(c_db);
     database_t& db = *reinterpret_cast<database_t*>(c_db);
+    stop_compactions(db);
+    stop_sweeps(db);
     if (!db.persisted_directory.empty()) {
         ustore_error_t c_error = nullptr;
-        safe_section("Saving to disk", &c_error, [&] { write(db, db.persisted_directory, &c_error); });
+        if (is_logged(db)) {
+            stop_checkpoints(db);
+            safe_section("Saving to disk", &c_error, [&] { checkpoint(db, &c_error); });
+        }
+        else {
+            safe_section("Saving to disk", &c_error, [&] { write(db, db.persisted_directory, &c_error); });
+            safe_section("Saving string keys", &c_error, [&] { save_all_strings(db); });
+        }
     }
 
     delete &db;
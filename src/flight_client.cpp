@@ -7,20 +7,36 @@
  * Understanding the costs of remote communication, might keep a cache.
  */
 
-#include <thread>      // `std::this_thread`
-#include <mutex>       // `std::mutex`
-#include <string_view> // `std::string_view`
+#include <thread>        // `std::this_thread`
+#include <mutex>         // `std::mutex`
+#include <array>         // `std::array`
+#include <atomic>        // `std::atomic`
+#include <charconv>      // `std::from_chars`
+#include <optional>      // `std::optional`
+#include <random>        // `std::mt19937_64`
+#include <string_view>   // `std::string_view`
+#include <unordered_map> // `std::unordered_map`
+
+#include <sys/stat.h> // `fstat`
 
 #include <fmt/core.h> // `fmt::format_to`
+#include <nlohmann/json.hpp>
 #include <arrow/c/abi.h>
 #include <arrow/flight/client.h>
 #include <arrow/array/array_binary.h>
 #include <arrow/array/array_primitive.h>
+#include <arrow/array/array_nested.h>
 
 #include "ustore/db.h"
+#include "ustore/docs.h"
+#include "ustore/graph.h"
+#include "ustore/vectors.h"
 #include "ustore/arrow.h"
 #include "ustore/cpp/types.hpp" // `ustore_doc_field()`
 #include "helpers/arrow.hpp"
+#include "helpers/threads.hpp" // `parallel_for`
+#include "helpers/merge.hpp"   // `write_spliced`
+#include "helpers/algorithm.hpp" // `deduplicate_gather_join_scatter`
 
 /*********************************************************/
 /*****************   Structures & Consts  ****************/
@@ -40,11 +56,112 @@ bool const ustore_supports_snapshots_k = true;
 using namespace unum::ustore;
 using namespace unum;
 
-struct rpc_client_t {
+/**
+ * @brief Default count of gRPC channels, unless the `channels` URI parameter overrides it.
+ * Calls on different channels don't share a connection, so they don't queue behind each other.
+ */
+constexpr std::size_t rpc_channels_default_k = 4;
+inline static std::string const kParamChannels = "channels";
+
+struct rpc_channel_t {
     std::unique_ptr<arf::FlightClient> flight;
-    std::vector<std::unique_ptr<arf::FlightStreamReader>> readers;
+    std::atomic<std::size_t> active_calls {0};
+};
+
+struct rpc_router_t;
+
+struct rpc_client_t {
+    std::vector<std::unique_ptr<rpc_channel_t>> channels;
+    std::atomic<std::size_t> next_channel {0};
+    /// Streams, that own the memory of exported results, until their arena is reused.
+    std::unordered_map<ustore_arena_t*, std::vector<std::unique_ptr<arf::FlightStreamReader>>> readers;
+    /// Shared memory segments of the server, mapped into exported results, until their arena is reused.
+    std::unordered_map<ustore_arena_t*, std::vector<ptr_range_gt<byte_t>>> mappings;
+    std::mutex readers_lock;
     linked_memory_t arena;
     std::mutex arena_lock;
+    /// Owned clients of other servers, if this one only routes requests to them.
+    rpc_router_t* router = nullptr;
+    /// Longest delay in milliseconds, that reads tolerate, if the server is a replica.
+    std::optional<std::size_t> max_staleness;
+
+    /**
+     * @brief Picks the channel with the fewest calls in progress.
+     * Scanning starts from a rotating offset, so ties are broken round-robin.
+     */
+    rpc_channel_t& least_loaded_channel() noexcept {
+        std::size_t const offset = next_channel.fetch_add(1, std::memory_order_relaxed);
+        rpc_channel_t* best = nullptr;
+        for (std::size_t i = 0; i != channels.size(); ++i) {
+            rpc_channel_t& channel = *channels[(offset + i) % channels.size()];
+            if (!best || channel.active_calls.load(std::memory_order_relaxed) <
+                             best->active_calls.load(std::memory_order_relaxed))
+                best = &channel;
+        }
+        return *best;
+    }
+
+    ~rpc_client_t() noexcept {
+        for (auto& [c_arena, segments] : mappings)
+            for (ptr_range_gt<byte_t> segment : segments)
+                munmap(segment.begin(), segment.size());
+    }
+
+    void discard_results(ustore_arena_t* c_arena) {
+        std::lock_guard<std::mutex> lk(readers_lock);
+        readers.erase(c_arena);
+        auto it = mappings.find(c_arena);
+        if (it == mappings.end())
+            return;
+        for (ptr_range_gt<byte_t> segment : it->second)
+            munmap(segment.begin(), segment.size());
+        mappings.erase(it);
+    }
+
+    /**
+     * @brief Maps a shared memory segment, handed off by the server, until the `c_arena` is reused.
+     * The name is immediately unlinked, so the memory is reclaimed, once it is unmapped.
+     */
+    ptr_range_gt<byte_t const> map_shared(ustore_arena_t* c_arena, std::string const& name, ustore_error_t* c_error) {
+        int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+        if (descriptor < 0) {
+            log_error_m(c_error, network_k, "Can't open shared memory, the server may be on another host");
+            return {};
+        }
+
+        struct stat segment_stat {};
+        void* begin = MAP_FAILED;
+        if (fstat(descriptor, &segment_stat) == 0)
+            begin = mmap(nullptr, std::size_t(segment_stat.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        shm_unlink(name.c_str());
+        if (begin == MAP_FAILED) {
+            log_error_m(c_error, error_unknown_k, "Can't map shared memory");
+            return {};
+        }
+
+        ptr_range_gt<byte_t> segment {reinterpret_cast<byte_t*>(begin), std::size_t(segment_stat.st_size)};
+        std::lock_guard<std::mutex> lk(readers_lock);
+        mappings[c_arena].push_back(segment);
+        return {segment.begin(), segment.size()};
+    }
+
+    void hold_reader(ustore_arena_t* c_arena, std::unique_ptr<arf::FlightStreamReader> reader) {
+        std::lock_guard<std::mutex> lk(readers_lock);
+        readers[c_arena].push_back(std::move(reader));
+    }
+};
+
+/**
+ * @brief Marks a channel as busy for the duration of a call.
+ */
+class rpc_lease_t {
+    rpc_channel_t& channel_;
+
+  public:
+    rpc_lease_t(rpc_client_t& db) noexcept : channel_(db.least_loaded_channel()) { ++channel_.active_calls; }
+    ~rpc_lease_t() noexcept { --channel_.active_calls; }
+    arf::FlightClient* operator->() const noexcept { return channel_.flight.get(); }
 };
 
 arf::FlightCallOptions arrow_call_options(arrow_mem_pool_t& pool) {
@@ -55,7 +172,9 @@ arf::FlightCallOptions arrow_call_options(arrow_mem_pool_t& pool) {
     return options;
 }
 
-void export_options(ustore_options_t options, std::string& cmd) {
+void export_options(rpc_client_t const& db, ustore_options_t options, std::string& cmd) {
+    if (db.max_staleness)
+        fmt::format_to(std::back_inserter(cmd), "{}={}&", kParamMaxStaleness, *db.max_staleness);
     if (options & ustore_option_read_shared_memory_k)
         fmt::format_to(std::back_inserter(cmd), "{}&", kParamFlagSharedMemRead);
     if (options & ustore_option_transaction_dont_watch_k)
@@ -67,6 +186,677 @@ void export_options(ustore_options_t options, std::string& cmd) {
     //     fmt::format_to(std::back_inserter(cmd), "{}&", kParamFlagDontDiscard);
 }
 
+/*********************************************************/
+/*****************	       Sharding	      ****************/
+/*********************************************************/
+
+/**
+ * @brief Splits the keys of every collection between multiple servers, either by the
+ * ranges they fall into, or by their hashes. Batched reads, writes and scans are split
+ * by shard, sent in parallel, and their results are merged back in the original order.
+ * Modalities, implemented on top of those calls, are sharded transparently.
+ *
+ * Collections and transactions have different identifiers on every shard, so the
+ * router exports the ones of the first shard, translating them for the others.
+ * Commits aren't atomic across shards, while snapshots and server-side operations,
+ * like paths, graph traversals or vector search, aren't supported.
+ */
+enum class partitioning_t {
+    hash_k,
+    range_k,
+};
+
+/**
+ * @brief Where the tasks of a batch must be sent: to the single shard owning the key,
+ * or to every shard, that may contain the following keys, as scans and samples do.
+ */
+enum class routing_t {
+    owner_k,
+    following_k,
+};
+
+/**
+ * @brief Part of a batched request, addressed to one shard, with the positions
+ * of its tasks in the original batch, and the outputs of the shard.
+ */
+struct shard_request_t {
+    std::vector<std::size_t> tasks;
+    std::vector<ustore_collection_t> collections;
+    std::vector<ustore_key_t> keys;
+    std::vector<ustore_bytes_cptr_t> values;
+    std::vector<ustore_length_t> lengths;
+    ustore_transaction_t transaction = nullptr;
+    ustore_arena_t arena = nullptr;
+    ustore_error_t error = nullptr;
+
+    ustore_octet_t* found_presences = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_byte_t* found_values = nullptr;
+    ustore_key_t* found_keys = nullptr;
+};
+
+/**
+ * @brief Mixes the bits of the key, so that sequential keys are spread evenly between shards.
+ */
+inline std::uint64_t shard_hash(ustore_key_t key) noexcept {
+    std::uint64_t bits = static_cast<std::uint64_t>(key);
+    bits = (bits ^ (bits >> 30)) * 0xbf58476d1ce4e5b9ull;
+    bits = (bits ^ (bits >> 27)) * 0x94d049bb133111ebull;
+    return bits ^ (bits >> 31);
+}
+
+struct rpc_router_t {
+    /// Clients of every shard, sorted by their `start_keys`, if partitioned by ranges.
+    std::vector<ustore_database_t> shards;
+    /// Smallest key of every shard, except the first one, that owns all the smaller keys.
+    std::vector<ustore_key_t> start_keys;
+    partitioning_t partitioning = partitioning_t::hash_k;
+
+    std::mutex mutex;
+    /// Identifiers of named collections on every shard, addressed by the one on the first shard.
+    std::unordered_map<ustore_collection_t, std::vector<ustore_collection_t>> collections;
+    /// Identifiers of transactions on every shard, addressed by the one, exported by the router.
+    std::unordered_map<std::uintptr_t, std::vector<ustore_transaction_t>> transactions;
+    std::uintptr_t last_transaction = 0;
+
+    ~rpc_router_t() noexcept {
+        for (ustore_database_t shard : shards)
+            ustore_database_free(shard);
+    }
+
+    std::size_t shard_of(ustore_key_t key) const noexcept {
+        if (partitioning == partitioning_t::hash_k)
+            return shard_hash(key) % shards.size();
+        return std::upper_bound(start_keys.begin() + 1, start_keys.end(), key) - start_keys.begin() - 1;
+    }
+
+    /**
+     * @brief Lists the collections of all shards, matching them by names.
+     * Needed for collections, created by other clients, or before this one connected.
+     */
+    void refresh_collections(ustore_error_t* c_error) noexcept(false) {
+        std::vector<std::unordered_map<std::string, ustore_collection_t>> named(shards.size());
+        for (std::size_t shard_idx = 0; shard_idx != shards.size(); ++shard_idx) {
+            ustore_arena_t arena = nullptr;
+            ustore_size_t count = 0;
+            ustore_collection_t* ids = nullptr;
+            ustore_length_t* offsets = nullptr;
+            ustore_str_span_t names = nullptr;
+            ustore_collection_list_t list {};
+            list.db = shards[shard_idx];
+            list.error = c_error;
+            list.arena = &arena;
+            list.count = &count;
+            list.ids = &ids;
+            list.offsets = &offsets;
+            list.names = &names;
+            ustore_collection_list(&list);
+            for (std::size_t i = 0; !*c_error && i != count; ++i)
+                named[shard_idx].emplace(std::string(names + offsets[i], offsets[i + 1] - offsets[i]), ids[i]);
+            reinterpret_cast<rpc_client_t*>(shards[shard_idx])->discard_results(&arena);
+            ustore_arena_free(arena);
+            return_if_error_m(c_error);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto const& [name, id] : named[0]) {
+            std::vector<ustore_collection_t> ids {id};
+            for (std::size_t shard_idx = 1; shard_idx != shards.size(); ++shard_idx) {
+                auto it = named[shard_idx].find(name);
+                if (it == named[shard_idx].end())
+                    break;
+                ids.push_back(it->second);
+            }
+            if (ids.size() == shards.size())
+                collections[id] = std::move(ids);
+        }
+    }
+
+    /**
+     * @brief Exports the identifiers of the `collection` on every shard.
+     */
+    void collection_ids(ustore_collection_t collection,
+                        std::vector<ustore_collection_t>& ids,
+                        ustore_error_t* c_error) noexcept(false) {
+        if (collection == ustore_collection_main_k) {
+            ids.assign(shards.size(), ustore_collection_main_k);
+            return;
+        }
+        for (bool refreshed = false;; refreshed = true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = collections.find(collection);
+                if (it != collections.end()) {
+                    ids = it->second;
+                    return;
+                }
+            }
+            return_error_if_m(!refreshed, c_error, args_wrong_k, "Collection isn't present on every shard");
+            refresh_collections(c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+    /**
+     * @brief Exports the identifiers of the `transaction` on every shard.
+     */
+    void transaction_ids(ustore_transaction_t transaction,
+                         std::vector<ustore_transaction_t>& ids,
+                         ustore_error_t* c_error) noexcept(false) {
+        if (!transaction) {
+            ids.assign(shards.size(), nullptr);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = transactions.find(reinterpret_cast<std::uintptr_t>(transaction));
+        return_error_if_m(it != transactions.end(), c_error, args_wrong_k, "Unknown transaction");
+        ids = it->second;
+    }
+
+    /**
+     * @brief Distributes the tasks of a batch between shards, translating their collections and transaction.
+     */
+    void split(places_arg_t const& places,
+               ustore_transaction_t transaction,
+               routing_t routing,
+               std::vector<shard_request_t>& requests,
+               ustore_error_t* c_error) noexcept(false) {
+
+        std::vector<ustore_transaction_t> transaction_per_shard;
+        transaction_ids(transaction, transaction_per_shard, c_error);
+        return_if_error_m(c_error);
+        requests.resize(shards.size());
+        for (std::size_t shard_idx = 0; shard_idx != shards.size(); ++shard_idx)
+            requests[shard_idx].transaction = transaction_per_shard[shard_idx];
+
+        std::vector<ustore_collection_t> collection_per_shard;
+        ustore_collection_t last_collection = ustore_collection_main_k;
+        collection_ids(last_collection, collection_per_shard, c_error);
+        for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
+            place_t place = places[task_idx];
+            if (place.collection != last_collection) {
+                collection_ids(place.collection, collection_per_shard, c_error);
+                return_if_error_m(c_error);
+                last_collection = place.collection;
+            }
+
+            std::size_t first_shard = shard_of(place.key);
+            std::size_t end_shard = first_shard + 1;
+            if (routing == routing_t::following_k) {
+                first_shard = partitioning == partitioning_t::hash_k ? 0 : first_shard;
+                end_shard = shards.size();
+            }
+            for (std::size_t shard_idx = first_shard; shard_idx != end_shard; ++shard_idx) {
+                shard_request_t& request = requests[shard_idx];
+                request.tasks.push_back(task_idx);
+                request.collections.push_back(collection_per_shard[shard_idx]);
+                request.keys.push_back(place.key);
+            }
+        }
+    }
+
+    /**
+     * @brief Calls `callback(request, shard)` for every shard with any tasks, each on a separate thread.
+     * The first error of any shard is exported.
+     */
+    template <typename callback_at>
+    void fan_out(std::vector<shard_request_t>& requests, ustore_error_t* c_error, callback_at&& callback) noexcept {
+        safe_section("Fanning out to shards", c_error, [&] {
+            parallel_for(shards.size(), shards.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t shard_idx = begin; shard_idx != end; ++shard_idx)
+                    if (!requests[shard_idx].tasks.empty())
+                        callback(requests[shard_idx], shards[shard_idx]);
+            });
+        });
+        for (shard_request_t const& request : requests)
+            if (request.error && !*c_error)
+                *c_error = request.error;
+    }
+
+    /**
+     * @brief Releases the results of the `requests`, once they are merged into the arena of the caller.
+     */
+    void release(std::vector<shard_request_t>& requests) noexcept {
+        for (std::size_t shard_idx = 0; shard_idx != requests.size(); ++shard_idx) {
+            reinterpret_cast<rpc_client_t*>(shards[shard_idx])->discard_results(&requests[shard_idx].arena);
+            ustore_arena_free(requests[shard_idx].arena);
+        }
+    }
+};
+
+/**
+ * @brief Opens the clients of all the shards, listed in a JSON `config`:
+ * `{"partitioning": "range", "shards": [{"url": "grpc://...", "start_key": 0}, ...]}`.
+ * Shards, partitioned by hashes, don't need the `start_key`.
+ */
+void router_init(std::string_view config, rpc_router_t& router, ustore_error_t* c_error) noexcept(false) {
+    nlohmann::json json = nlohmann::json::parse(config, nullptr, false);
+    return_error_if_m(json.is_object() && json.contains("shards") && json["shards"].is_array(),
+                      c_error,
+                      args_wrong_k,
+                      "Sharded config must list the shards");
+    std::string partitioning = json.value("partitioning", "hash");
+    return_error_if_m(partitioning == "hash" || partitioning == "range",
+                      c_error,
+                      args_wrong_k,
+                      "Shards are partitioned by hash or by range");
+    router.partitioning = partitioning == "hash" ? partitioning_t::hash_k : partitioning_t::range_k;
+
+    std::vector<std::pair<ustore_key_t, std::string>> shards;
+    for (nlohmann::json const& shard : json["shards"]) {
+        return_error_if_m(shard.is_object() && shard.contains("url"), c_error, args_wrong_k, "Shard must have a URL");
+        return_error_if_m(router.partitioning == partitioning_t::hash_k || shard.contains("start_key"),
+                          c_error,
+                          args_wrong_k,
+                          "Shards, partitioned by range, must have a start key");
+        shards.emplace_back(shard.value("start_key", ustore_key_t(0)), shard["url"].get<std::string>());
+    }
+    return_error_if_m(!shards.empty(), c_error, args_wrong_k, "Sharded config must list the shards");
+    if (router.partitioning == partitioning_t::range_k) {
+        std::sort(shards.begin(), shards.end());
+        auto same_start = [](auto const& a, auto const& b) { return a.first == b.first; };
+        return_error_if_m(std::adjacent_find(shards.begin(), shards.end(), same_start) == shards.end(),
+                          c_error,
+                          args_wrong_k,
+                          "Shards must start from different keys");
+    }
+
+    for (auto const& [start_key, url] : shards) {
+        ustore_database_t shard = nullptr;
+        ustore_database_init_t init {};
+        init.config = url.c_str();
+        init.db = &shard;
+        init.error = c_error;
+        ustore_database_init(&init);
+        return_if_error_m(c_error);
+        router.shards.push_back(shard);
+        router.start_keys.push_back(start_key);
+    }
+}
+
+void route_read(rpc_router_t& router, ustore_read_t& c) {
+
+    return_error_if_m(!c.snapshot, c.error, missing_feature_k, "Snapshots can't span shards");
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+
+    std::vector<shard_request_t> requests;
+    safe_section("Splitting the batch", c.error, [&] {
+        router.split(places, c.transaction, routing_t::owner_k, requests, c.error);
+    });
+    return_if_error_m(c.error);
+
+    bool const request_only_presences = c.presences && !c.lengths && !c.values;
+    bool const request_only_lengths = c.lengths && !c.values;
+    router.fan_out(requests, c.error, [&](shard_request_t& request, ustore_database_t shard) {
+        std::vector<ustore_length_t> starts, lengths;
+        for (std::size_t task_idx : request.tasks) {
+            if (slices_starts)
+                starts.push_back(slices_starts[task_idx]);
+            if (slices_lengths)
+                lengths.push_back(slices_lengths[task_idx]);
+        }
+
+        ustore_read_t read {};
+        read.db = shard;
+        read.error = &request.error;
+        read.transaction = request.transaction;
+        read.arena = &request.arena;
+        read.options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+        read.tasks_count = request.tasks.size();
+        read.collections = request.collections.data();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = request.keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.values_limit = c.values_limit;
+        read.slices_starts = slices_starts ? starts.data() : nullptr;
+        read.slices_starts_stride = sizeof(ustore_length_t);
+        read.slices_lengths = slices_lengths ? lengths.data() : nullptr;
+        read.slices_lengths_stride = sizeof(ustore_length_t);
+        read.presences = request_only_presences ? &request.found_presences : nullptr;
+        read.lengths = request_only_presences ? nullptr : &request.found_lengths;
+        read.offsets = request_only_presences || request_only_lengths ? nullptr : &request.found_offsets;
+        read.values = request_only_presences || request_only_lengths ? nullptr : &request.found_values;
+        ustore_read(&read);
+    });
+
+    // Gather the lengths in the original order, to later join the values
+    auto presences = arena.alloc<ustore_octet_t>(divide_round_up<std::size_t>(places.count, CHAR_BIT), c.error);
+    auto lengths = arena.alloc<ustore_length_t>(places.count, c.error);
+    auto offsets = arena.alloc<ustore_length_t>(places.count + 1, c.error);
+    if (*c.error)
+        return router.release(requests);
+    std::memset(presences.begin(), 0, presences.size());
+    bits_span_t presences_bits {presences.begin()};
+    for (shard_request_t const& request : requests) {
+        for (std::size_t i = 0; i != request.tasks.size(); ++i) {
+            std::size_t const task_idx = request.tasks[i];
+            lengths[task_idx] = request_only_presences
+                                    ? (bits_view_t {request.found_presences}[i] ? 0 : ustore_length_missing_k)
+                                    : request.found_lengths[i];
+            presences_bits[task_idx] = lengths[task_idx] != ustore_length_missing_k;
+        }
+    }
+
+    ustore_length_t total_length = 0;
+    for (std::size_t task_idx = 0; task_idx != places.count; ++task_idx) {
+        offsets[task_idx] = total_length;
+        total_length += lengths[task_idx] != ustore_length_missing_k ? lengths[task_idx] : 0;
+    }
+    offsets[places.count] = total_length;
+
+    if (c.values) {
+        auto values = arena.alloc<ustore_byte_t>(total_length, c.error);
+        if (*c.error)
+            return router.release(requests);
+        for (shard_request_t const& request : requests)
+            for (std::size_t i = 0; i != request.tasks.size(); ++i)
+                if (request.found_lengths[i] != ustore_length_missing_k)
+                    std::memcpy(values.begin() + offsets[request.tasks[i]],
+                                request.found_values + request.found_offsets[i],
+                                request.found_lengths[i]);
+        *c.values = values.begin();
+    }
+    router.release(requests);
+
+    if (c.presences)
+        *c.presences = presences.begin();
+    if (c.offsets)
+        *c.offsets = offsets.begin();
+    if (c.lengths)
+        *c.lengths = lengths.begin();
+}
+
+void route_write(rpc_router_t& router, ustore_write_t& c) {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
+    bits_view_t presences {c.presences};
+    places_arg_t places {collections, keys, {}, c.tasks_count};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+
+    // Values are passed to shards as separate pointers, while missing ones remove the entries
+    std::vector<shard_request_t> requests;
+    safe_section("Splitting the batch", c.error, [&] {
+        router.split(places, c.transaction, routing_t::owner_k, requests, c.error);
+        for (shard_request_t& request : requests) {
+            for (std::size_t task_idx : request.tasks) {
+                value_view_t value = vals ? contents[task_idx] : value_view_t {};
+                request.values.push_back(reinterpret_cast<ustore_bytes_cptr_t>(value.data()));
+                request.lengths.push_back(value ? static_cast<ustore_length_t>(value.size()) : ustore_length_missing_k);
+            }
+        }
+    });
+    return_if_error_m(c.error);
+
+    router.fan_out(requests, c.error, [&](shard_request_t& request, ustore_database_t shard) {
+        ustore_write_t write {};
+        write.db = shard;
+        write.error = &request.error;
+        write.transaction = request.transaction;
+        write.arena = &request.arena;
+        write.options = c.options;
+        write.tasks_count = request.tasks.size();
+        write.collections = request.collections.data();
+        write.collections_stride = sizeof(ustore_collection_t);
+        write.keys = request.keys.data();
+        write.keys_stride = sizeof(ustore_key_t);
+        write.values = vals ? request.values.data() : nullptr;
+        write.values_stride = sizeof(ustore_bytes_cptr_t);
+        write.lengths = vals ? request.lengths.data() : nullptr;
+        write.lengths_stride = sizeof(ustore_length_t);
+        ustore_write(&write);
+    });
+    router.release(requests);
+}
+
+/**
+ * @brief Merges the keys, that shards exported for the same tasks, into a single tape,
+ * keeping up to `limits[i]` of them, either the smallest or a random subset.
+ */
+void merge_found_keys(std::vector<shard_request_t> const& requests,
+                      strided_iterator_gt<ustore_length_t const> limits,
+                      std::size_t tasks_count,
+                      bool randomize,
+                      ustore_length_t** c_offsets,
+                      ustore_length_t** c_counts,
+                      ustore_key_t** c_keys,
+                      linked_memory_lock_t& arena,
+                      ustore_error_t* c_error) noexcept {
+
+    auto offsets = arena.alloc<ustore_length_t>(tasks_count + 1, c_error);
+    return_if_error_m(c_error);
+    auto counts = arena.alloc<ustore_length_t>(tasks_count, c_error);
+    return_if_error_m(c_error);
+    uninitialized_array_gt<ustore_key_t> found_keys(arena);
+    uninitialized_array_gt<ustore_key_t> task_keys(arena);
+    std::vector<std::size_t> cursors(requests.size());
+    thread_local std::mt19937_64 random_generator(std::random_device {}());
+    for (std::size_t task_idx = 0; task_idx != tasks_count; ++task_idx) {
+        task_keys.clear();
+        for (std::size_t shard_idx = 0; shard_idx != requests.size(); ++shard_idx) {
+            shard_request_t const& request = requests[shard_idx];
+            std::size_t& i = cursors[shard_idx];
+            if (i == request.tasks.size() || request.tasks[i] != task_idx)
+                continue;
+            if (request.found_offsets) {
+                ustore_key_t const* begin = request.found_keys + request.found_offsets[i];
+                ustore_key_t const* end = request.found_keys + request.found_offsets[i + 1];
+                task_keys.insert(task_keys.size(), begin, end, c_error);
+                return_if_error_m(c_error);
+            }
+            ++i;
+        }
+
+        std::size_t const count = std::min<std::size_t>(task_keys.size(), limits[task_idx]);
+        if (randomize)
+            for (std::size_t i = 0; i != count; ++i)
+                std::swap(task_keys[i], task_keys[i + random_generator() % (task_keys.size() - i)]);
+        else
+            std::partial_sort(task_keys.begin(), task_keys.begin() + count, task_keys.end());
+        offsets[task_idx] = static_cast<ustore_length_t>(found_keys.size());
+        counts[task_idx] = static_cast<ustore_length_t>(count);
+        found_keys.insert(found_keys.size(), task_keys.begin(), task_keys.begin() + count, c_error);
+        return_if_error_m(c_error);
+    }
+    offsets[tasks_count] = static_cast<ustore_length_t>(found_keys.size());
+
+    if (c_offsets)
+        *c_offsets = offsets.begin();
+    if (c_counts)
+        *c_counts = counts.begin();
+    if (c_keys)
+        *c_keys = found_keys.begin();
+}
+
+void route_scan(rpc_router_t& router, ustore_scan_t& c) {
+
+    return_error_if_m(!c.snapshot, c.error, missing_feature_k, "Snapshots can't span shards");
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    places_arg_t places {collections, start_keys, {}, c.tasks_count};
+
+    // Every shard, that may contain the following keys, is asked for the whole limit
+    std::vector<shard_request_t> requests;
+    safe_section("Splitting the batch", c.error, [&] {
+        router.split(places, c.transaction, routing_t::following_k, requests, c.error);
+        for (shard_request_t& request : requests)
+            for (std::size_t task_idx : request.tasks)
+                request.lengths.push_back(limits[task_idx]);
+    });
+    return_if_error_m(c.error);
+
+    router.fan_out(requests, c.error, [&](shard_request_t& request, ustore_database_t shard) {
+        ustore_scan_t scan {};
+        scan.db = shard;
+        scan.error = &request.error;
+        scan.transaction = request.transaction;
+        scan.arena = &request.arena;
+        scan.options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+        scan.tasks_count = request.tasks.size();
+        scan.collections = request.collections.data();
+        scan.collections_stride = sizeof(ustore_collection_t);
+        scan.start_keys = request.keys.data();
+        scan.start_keys_stride = sizeof(ustore_key_t);
+        scan.count_limits = request.lengths.data();
+        scan.count_limits_stride = sizeof(ustore_length_t);
+        scan.offsets = &request.found_offsets;
+        scan.keys = &request.found_keys;
+        ustore_scan(&scan);
+    });
+    if (!*c.error)
+        merge_found_keys(requests, limits, c.tasks_count, false, c.offsets, c.counts, c.keys, arena, c.error);
+    router.release(requests);
+}
+
+void route_sample(rpc_router_t& router, ustore_sample_t& c) {
+
+    return_error_if_m(!c.snapshot, c.error, missing_feature_k, "Snapshots can't span shards");
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    ustore_key_t const any_key = std::numeric_limits<ustore_key_t>::min();
+    places_arg_t places {collections, {&any_key, 0}, {}, c.tasks_count};
+
+    // Every shard is sampled, and the union is sampled again
+    std::vector<shard_request_t> requests;
+    safe_section("Splitting the batch", c.error, [&] {
+        router.split(places, c.transaction, routing_t::following_k, requests, c.error);
+        for (shard_request_t& request : requests)
+            for (std::size_t task_idx : request.tasks)
+                request.lengths.push_back(limits[task_idx]);
+    });
+    return_if_error_m(c.error);
+
+    router.fan_out(requests, c.error, [&](shard_request_t& request, ustore_database_t shard) {
+        ustore_sample_t sample {};
+        sample.db = shard;
+        sample.error = &request.error;
+        sample.transaction = request.transaction;
+        sample.arena = &request.arena;
+        sample.options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+        sample.tasks_count = request.tasks.size();
+        sample.collections = request.collections.data();
+        sample.collections_stride = sizeof(ustore_collection_t);
+        sample.count_limits = request.lengths.data();
+        sample.count_limits_stride = sizeof(ustore_length_t);
+        sample.offsets = &request.found_offsets;
+        sample.keys = &request.found_keys;
+        ustore_sample(&sample);
+    });
+    if (!*c.error)
+        merge_found_keys(requests, limits, c.tasks_count, true, c.offsets, c.counts, c.keys, arena, c.error);
+    router.release(requests);
+}
+
+void route_collection_create(rpc_router_t& router, ustore_collection_create_t& c) {
+    std::vector<ustore_collection_t> ids(router.shards.size());
+    for (std::size_t shard_idx = 0; shard_idx != router.shards.size(); ++shard_idx) {
+        ustore_collection_create_t create = c;
+        create.db = router.shards[shard_idx];
+        create.id = &ids[shard_idx];
+        ustore_collection_create(&create);
+        return_if_error_m(c.error);
+    }
+    std::lock_guard<std::mutex> lock(router.mutex);
+    *c.id = ids[0];
+    router.collections[ids[0]] = std::move(ids);
+}
+
+void route_collection_drop(rpc_router_t& router, ustore_collection_drop_t& c) {
+    std::vector<ustore_collection_t> ids;
+    router.collection_ids(c.id, ids, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t shard_idx = 0; shard_idx != router.shards.size(); ++shard_idx) {
+        ustore_collection_drop_t drop = c;
+        drop.db = router.shards[shard_idx];
+        drop.id = ids[shard_idx];
+        ustore_collection_drop(&drop);
+        return_if_error_m(c.error);
+    }
+    if (c.mode != ustore_drop_keys_vals_handle_k)
+        return;
+    std::lock_guard<std::mutex> lock(router.mutex);
+    router.collections.erase(c.id);
+}
+
+void route_collection_list(rpc_router_t& router, ustore_collection_list_t& c) {
+    return_error_if_m(!c.snapshot, c.error, missing_feature_k, "Snapshots can't span shards");
+    std::vector<ustore_transaction_t> ids;
+    router.transaction_ids(c.transaction, ids, c.error);
+    return_if_error_m(c.error);
+
+    // Collections are created on every shard, and the first one exports their identifiers
+    ustore_collection_list_t list = c;
+    list.db = router.shards[0];
+    list.transaction = ids[0];
+    ustore_collection_list(&list);
+}
+
+void route_database_control(rpc_router_t& router, ustore_database_control_t& c) {
+    // Every response is exported into the same arena, so the first shard goes last
+    for (std::size_t shard_idx = router.shards.size(); shard_idx != 0; --shard_idx) {
+        ustore_database_control_t control = c;
+        control.db = router.shards[shard_idx - 1];
+        ustore_database_control(&control);
+        return_if_error_m(c.error);
+    }
+}
+
+void route_transaction_init(rpc_router_t& router, ustore_transaction_init_t& c) {
+    std::vector<ustore_transaction_t> ids(router.shards.size(), nullptr);
+    if (*c.transaction) {
+        std::lock_guard<std::mutex> lock(router.mutex);
+        auto it = router.transactions.find(reinterpret_cast<std::uintptr_t>(*c.transaction));
+        if (it != router.transactions.end())
+            ids = it->second;
+    }
+    for (std::size_t shard_idx = 0; shard_idx != router.shards.size(); ++shard_idx) {
+        ustore_transaction_init_t init = c;
+        init.db = router.shards[shard_idx];
+        init.transaction = &ids[shard_idx];
+        ustore_transaction_init(&init);
+        return_if_error_m(c.error);
+    }
+    std::lock_guard<std::mutex> lock(router.mutex);
+    std::uintptr_t id = reinterpret_cast<std::uintptr_t>(*c.transaction);
+    if (!router.transactions.count(id))
+        id = ++router.last_transaction;
+    router.transactions[id] = std::move(ids);
+    *c.transaction = reinterpret_cast<ustore_transaction_t>(id);
+}
+
+void route_transaction_commit(rpc_router_t& router, ustore_transaction_commit_t& c) {
+    std::vector<ustore_transaction_t> ids;
+    router.transaction_ids(c.transaction, ids, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t shard_idx = 0; shard_idx != router.shards.size(); ++shard_idx) {
+        ustore_transaction_commit_t commit = c;
+        commit.db = router.shards[shard_idx];
+        commit.transaction = ids[shard_idx];
+        ustore_transaction_commit(&commit);
+        return_if_error_m(c.error);
+    }
+    std::lock_guard<std::mutex> lock(router.mutex);
+    router.transactions.erase(reinterpret_cast<std::uintptr_t>(c.transaction));
+}
+
 /*********************************************************/
 /*****************	    C Interface 	  ****************/
 /*********************************************************/
@@ -79,17 +869,60 @@ void ustore_database_init(ustore_database_init_t* c_ptr) {
         if (!c.config || !std::strlen(c.config))
             c.config = "grpc://0.0.0.0:38709";
 
-        auto db_ptr = new rpc_client_t {};
-        auto maybe_location = arf::Location::Parse(c.config);
+        // Sharded configs list the servers, each of which gets its own client
+        if (c.config[0] == '{') {
+            auto db_ptr = std::make_unique<rpc_client_t>();
+            db_ptr->router = new rpc_router_t;
+            router_init(c.config, *db_ptr->router, c.error);
+            if (!*c.error)
+                linked_memory(reinterpret_cast<ustore_arena_t*>(&db_ptr->arena), ustore_option_dont_discard_memory_k, c.error);
+            if (*c.error) {
+                delete db_ptr->router;
+                return;
+            }
+            *c.db = db_ptr.release();
+            return;
+        }
+
+        // The `channels` and `max_staleness` parameters are ours, and aren't forwarded to gRPC
+        std::string_view uri = c.config;
+        std::size_t channels_count = rpc_channels_default_k;
+        std::optional<std::size_t> max_staleness;
+        if (auto params_offs = uri.find('?'); params_offs != std::string_view::npos) {
+            std::string_view params = uri.substr(params_offs + 1);
+            while (!params.empty()) {
+                std::string_view param = params.substr(0, params.find('&'));
+                params.remove_prefix(std::min(params.size(), param.size() + 1));
+                std::string_view value = param.substr(std::min(param.size(), param.find('=') + 1));
+                if (param.substr(0, kParamChannels.size() + 1) == kParamChannels + "=")
+                    std::from_chars(value.data(), value.data() + value.size(), channels_count);
+                else if (param.substr(0, kParamMaxStaleness.size() + 1) == kParamMaxStaleness + "=")
+                    std::from_chars(value.data(), value.data() + value.size(), max_staleness.emplace());
+            }
+            uri = uri.substr(0, params_offs);
+        }
+        return_error_if_m(channels_count, c.error, args_wrong_k, "At least one channel is needed");
+
+        auto maybe_location = arf::Location::Parse(std::string(uri));
         return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Server URI");
 
-        auto maybe_flight_ptr = arf::FlightClient::Connect(*maybe_location);
-        return_error_if_m(maybe_flight_ptr.ok(), c.error, network_k, "Flight Client Connection");
+        // By default gRPC shares connections between channels with identical arguments
+        arf::FlightClientOptions client_options = arf::FlightClientOptions::Defaults();
+        client_options.generic_options.emplace_back("grpc.use_local_subchannel_pool", 1);
+
+        auto db_ptr = std::make_unique<rpc_client_t>();
+        db_ptr->max_staleness = max_staleness;
+        for (std::size_t i = 0; i != channels_count; ++i) {
+            auto maybe_flight_ptr = arf::FlightClient::Connect(*maybe_location, client_options);
+            return_error_if_m(maybe_flight_ptr.ok(), c.error, network_k, "Flight Client Connection");
+            auto channel = std::make_unique<rpc_channel_t>();
+            channel->flight = maybe_flight_ptr.MoveValueUnsafe();
+            db_ptr->channels.push_back(std::move(channel));
+        }
 
         linked_memory(reinterpret_cast<ustore_arena_t*>(&db_ptr->arena), ustore_option_dont_discard_memory_k, c.error);
-        return_error_if_m(maybe_location.ok(), c.error, args_wrong_k, "Failed to allocate default arena.");
-        db_ptr->flight = maybe_flight_ptr.MoveValueUnsafe();
-        *c.db = db_ptr;
+        return_if_error_m(c.error);
+        *c.db = db_ptr.release();
     });
 }
 
@@ -98,14 +931,24 @@ void ustore_read(ustore_read_t* c_ptr) {
     ustore_read_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (deduplicates_reads(c)) {
+        if (!(c.options & ustore_option_dont_discard_memory_k))
+            db.discard_results(c.arena);
+        return deduplicate_gather_join_scatter(c, [](ustore_read_t& unique) { ustore_read(&unique); });
+    }
+    if (db.router)
+        return route_read(*db.router, c);
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_length_t const> slices_starts {c.slices_starts, c.slices_starts_stride};
+    strided_iterator_gt<ustore_length_t const> slices_lengths {c.slices_lengths, c.slices_lengths_stride};
     places_arg_t places {collections, keys, {}, c.tasks_count};
 
     ar::Status ar_status;
@@ -136,10 +979,12 @@ void ustore_read(ustore_read_t* c_ptr) {
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
     if (partial_mode)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
     constexpr bool has_keys_column = true;
+    bool const has_starts_column = bool(slices_starts);
+    bool const has_lengths_column = bool(slices_lengths);
 
     // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
@@ -157,10 +1002,25 @@ void ustore_read(ustore_read_t* c_ptr) {
         keys = {continuous.begin(), sizeof(ustore_key_t)};
     }
 
+    // Byte ranges are only sent, if requested, so that the server cuts the values before sending
+    if (has_starts_column && !slices_starts.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.count, c.error);
+        return_if_error_m(c.error);
+        transform_n(slices_starts, places.count, continuous.begin());
+        slices_starts = {continuous.begin(), sizeof(ustore_length_t)};
+    }
+
+    if (has_lengths_column && !slices_lengths.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.count, c.error);
+        return_if_error_m(c.error);
+        transform_n(slices_lengths, places.count, continuous.begin());
+        slices_lengths = {continuous.begin(), sizeof(ustore_length_t)};
+    }
+
     // Now build-up the Arrow representation
     ArrowArray input_array_c, output_array_c;
     ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_keys_column;
+    auto count_collections = has_collections_column + has_keys_column + has_starts_column + has_lengths_column;
     ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
@@ -190,6 +1050,32 @@ void ustore_read(ustore_read_t* c_ptr) {
             c.error);
     return_if_error_m(c.error);
 
+    if (has_starts_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgSliceStarts.c_str(),
+            ustore_doc_field<ustore_length_t>(),
+            nullptr,
+            nullptr,
+            slices_starts.get(),
+            input_schema_c.children[has_collections_column + has_keys_column],
+            input_array_c.children[has_collections_column + has_keys_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_lengths_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgSliceLengths.c_str(),
+            ustore_doc_field<ustore_length_t>(),
+            nullptr,
+            nullptr,
+            slices_lengths.get(),
+            input_schema_c.children[has_collections_column + has_keys_column + has_starts_column],
+            input_array_c.children[has_collections_column + has_keys_column + has_starts_column],
+            c.error);
+    return_if_error_m(c.error);
+
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
@@ -197,7 +1083,7 @@ void ustore_read(ustore_read_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
-    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
@@ -217,30 +1103,13 @@ void ustore_read(ustore_read_t* c_ptr) {
     auto maybe_table = result->reader->ToTable();
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
-    return_error_if_m(table->num_columns() == 1, c.error, error_unknown_k, "Expecting one column");
 
-    if (request_only_presences) {
-        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt8Type>>(table->column(0)->chunk(0));
-        *c.presences = (ustore_octet_t*)array->raw_values();
-    }
-    else if (request_only_lengths) {
-        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
-        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
-        auto lens_ptr = (ustore_length_t*)array->value_offsets()->data();
-        if (c.lengths)
-            *c.lengths =
-                presences_ptr //
-                    ? arrow_replace_missing_scalars(presences_ptr, lens_ptr, table->num_rows(), ustore_length_missing_k)
-                    : lens_ptr;
-        if (c.presences)
-            *c.presences = presences_ptr;
-    }
-    else {
-        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
-        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
-        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
-        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
+    // Servers on the same host may leave the content in shared memory, describing
+    // the segments and positions of presences, offsets and values in three rows
+    bool const is_shared = table->num_columns() == 3 && table->schema()->field(0)->name() == kArgSharedNames;
+    return_error_if_m(is_shared || table->num_columns() == 1, c.error, error_unknown_k, "Expecting one column");
 
+    auto export_contents = [&](ustore_octet_t* presences_ptr, ustore_length_t* offs_ptr, ustore_bytes_ptr_t data_ptr) {
         if (c.presences)
             *c.presences = presences_ptr;
         if (c.offsets)
@@ -261,20 +1130,101 @@ void ustore_read(ustore_read_t* c_ptr) {
                     lens[i] = offs_ptr[i + 1] - offs_ptr[i];
             }
         }
-    }
+    };
 
-    db.readers.push_back(std::move(result->reader));
-}
-
-void ustore_write(ustore_write_t* c_ptr) {
-
-    ustore_write_t& c = *c_ptr;
-    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
-
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    if (request_only_presences) {
+        auto array = std::static_pointer_cast<ar::NumericArray<ar::UInt8Type>>(table->column(0)->chunk(0));
+        *c.presences = (ustore_octet_t*)array->raw_values();
+    }
+    else if (request_only_lengths) {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto lens_ptr = (ustore_length_t*)array->value_offsets()->data();
+        if (c.lengths)
+            *c.lengths =
+                presences_ptr //
+                    ? arrow_replace_missing_scalars(presences_ptr, lens_ptr, table->num_rows(), ustore_length_missing_k)
+                    : lens_ptr;
+        if (c.presences)
+            *c.presences = presences_ptr;
+    }
+    else if (is_shared) {
+        auto names = std::static_pointer_cast<ar::StringArray>(table->column(0)->chunk(0));
+        auto positions = std::static_pointer_cast<ar::UInt64Array>(table->column(1)->chunk(0));
+        auto lengths = std::static_pointer_cast<ar::UInt64Array>(table->column(2)->chunk(0));
+        return_error_if_m(names->length() == 3, c.error, error_unknown_k, "Expecting three shared buffers");
+
+        // Every distinct segment is mapped once, as its name is unlinked right after
+        constexpr std::size_t buffers_count_k = 3;
+        std::array<std::string, buffers_count_k> mapped_names;
+        std::array<ptr_range_gt<byte_t const>, buffers_count_k> mapped_segments;
+        std::array<byte_t const*, buffers_count_k> buffers {};
+        for (std::size_t i = 0; i != buffers_count_k; ++i) {
+            std::string_view name = names->GetView(i);
+            if (name.empty())
+                continue;
+
+            std::size_t mapped_idx = 0;
+            while (mapped_idx != i && mapped_names[mapped_idx] != name)
+                ++mapped_idx;
+            if (mapped_idx == i) {
+                mapped_names[i] = std::string(name);
+                mapped_segments[i] = db.map_shared(c.arena, mapped_names[i], c.error);
+                return_if_error_m(c.error);
+            }
+
+            ptr_range_gt<byte_t const> segment = mapped_segments[mapped_idx];
+            std::uint64_t position = positions->Value(i);
+            std::uint64_t length = lengths->Value(i);
+            return_error_if_m(position <= segment.size() && length <= segment.size() - position,
+                              c.error,
+                              error_unknown_k,
+                              "Shared buffer exceeds its segment");
+            buffers[i] = segment.begin() + position;
+        }
+
+        std::size_t const offsets_length = (places.count + 1) * sizeof(ustore_length_t);
+        return_error_if_m(buffers[1] && lengths->Value(1) >= offsets_length,
+                          c.error,
+                          error_unknown_k,
+                          "Shared offsets are missing");
+        return_error_if_m(!buffers[0] || lengths->Value(0) >= divide_round_up<std::size_t>(places.count, CHAR_BIT),
+                          c.error,
+                          error_unknown_k,
+                          "Shared presences are incomplete");
+
+        auto presences_ptr = (ustore_octet_t*)buffers[0];
+        auto offs_ptr = (ustore_length_t*)buffers[1];
+        auto data_ptr = (ustore_bytes_ptr_t)buffers[2];
+        export_contents(presences_ptr, offs_ptr, data_ptr);
+    }
+    else {
+        auto array = std::static_pointer_cast<ar::BinaryArray>(table->column(0)->chunk(0));
+        auto presences_ptr = (ustore_octet_t*)array->null_bitmap_data();
+        auto offs_ptr = (ustore_length_t*)array->value_offsets()->data();
+        auto data_ptr = (ustore_bytes_ptr_t)array->value_data()->data();
+        export_contents(presences_ptr, offs_ptr, data_ptr);
+    }
+
+    db.hold_reader(c.arena, std::move(result->reader));
+}
+
+void ustore_write(ustore_write_t* c_ptr) {
+
+    ustore_write_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
+    // Positions are packed into merge operands, that the server applies atomically
+    if (c.positions)
+        return write_spliced(c, arena);
+
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_write(*db.router, c);
+    rpc_lease_t flight(db);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
     strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
@@ -288,6 +1238,7 @@ void ustore_write(ustore_write_t* c_ptr) {
     bool const same_collection = places.same_collection();
     bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
     bool const write_flush = c.options & ustore_option_write_flush_k;
+    bool const write_merge = c.options & ustore_option_write_merge_k;
 
     bool const has_collections_column = collections && !same_collection;
     constexpr bool has_keys_column = true;
@@ -427,13 +1378,15 @@ void ustore_write(ustore_write_t* c_ptr) {
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
     if (write_flush)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagFlushWrite);
+    if (write_merge)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagMergeWrite);
 
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    ar::Result<arf::FlightClient::DoPutResult> result = flight->DoPut(options, descriptor, batch_ptr->schema());
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     // This writer has already been started!
@@ -462,6 +1415,8 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     return_if_error_m(c.error);
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
     strided_iterator_gt<ustore_length_t const> path_offs {c.paths_offsets, c.paths_offsets_stride};
     strided_iterator_gt<ustore_length_t const> path_lens {c.paths_lengths, c.paths_lengths_stride};
@@ -590,7 +1545,7 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    ar::Result<arf::FlightClient::DoPutResult> result = db.flight->DoPut(options, descriptor, batch_ptr->schema());
+    ar::Result<arf::FlightClient::DoPutResult> result = flight->DoPut(options, descriptor, batch_ptr->schema());
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     // This writer has already been started!
@@ -615,8 +1570,10 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
     ustore_paths_match_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
@@ -662,7 +1619,7 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
     if (partial_mode)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
     bool const has_previous_column = previous != nullptr;
@@ -775,7 +1732,7 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
-    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
@@ -811,7 +1768,7 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
             *c.paths_strings = reinterpret_cast<ustore_char_t*>(data_ptr);
     }
 
-    db.readers.push_back(std::move(result->reader));
+    db.hold_reader(c.arena, std::move(result->reader));
 }
 
 void ustore_paths_read(ustore_paths_read_t* c_ptr) {
@@ -819,8 +1776,10 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     ustore_paths_read_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
@@ -862,7 +1821,7 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
     if (partial_mode)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamReadPart, partial_mode);
-    export_options(c.options, descriptor.cmd);
+    export_options(db, c.options, descriptor.cmd);
 
     bool const has_collections_column = collections && !same_collection;
     constexpr bool has_paths_column = true;
@@ -930,7 +1889,7 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
     if (batch_ptr->num_rows() == 0)
         return;
-    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
@@ -996,7 +1955,7 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
         }
     }
 
-    db.readers.push_back(std::move(result->reader));
+    db.hold_reader(c.arena, std::move(result->reader));
 }
 
 void ustore_scan(ustore_scan_t* c_ptr) {
@@ -1004,90 +1963,538 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     ustore_scan_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_scan(*db.router, c);
+    rpc_lease_t flight(db);
+    if (!(c.options & ustore_option_dont_discard_memory_k))
+        db.discard_results(c.arena);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    scans_arg_t scans {collections, start_keys, limits, c.tasks_count};
+    places_arg_t places {collections, start_keys, {}, c.tasks_count};
+
+    bool const same_collection = places.same_collection();
+    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+    bool const write_flush = c.options & ustore_option_write_flush_k;
+
+    bool const has_collections_column = !same_collection;
+    constexpr bool has_start_keys_column = true;
+    constexpr bool has_lens_column = true;
+
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(collections, places.size(), continuous.begin());
+        collections = {continuous.begin(), places.size()};
+    }
+
+    if (has_start_keys_column && !start_keys.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(start_keys, places.size(), continuous.begin());
+        start_keys = {continuous.begin(), places.size()};
+    }
+
+    if (has_lens_column && !limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(limits, places.size(), continuous.begin());
+        limits = {continuous.begin(), places.size()};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c, output_array_c;
+    ArrowSchema input_schema_c, output_schema_c;
+    auto count_collections = has_collections_column + has_start_keys_column + has_lens_column;
+    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    if (has_collections_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
+            nullptr,
+            nullptr,
+            collections.get(),
+            input_schema_c.children[0],
+            input_array_c.children[0],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_start_keys_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgScanStarts.c_str(),
+            ustore_doc_field<ustore_key_t>(),
+            nullptr,
+            nullptr,
+            start_keys.get(),
+            input_schema_c.children[has_collections_column],
+            input_array_c.children[has_collections_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_lens_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCountLimits.c_str(),
+            ustore_doc_field<ustore_length_t>(),
+            nullptr,
+            nullptr,
+            limits.get(),
+            input_schema_c.children[has_collections_column + has_start_keys_column],
+            input_array_c.children[has_collections_column + has_start_keys_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightScan);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (same_named_collection)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    export_options(db, c.options, descriptor.cmd);
+
+    // Send the request to server
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    if (batch_ptr->num_rows() == 0)
+        return;
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+
+    ar_status = result->writer->Begin(batch_ptr->schema());
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+
+    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
+    ar_status = result->writer->WriteTable(*input_table);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+
+    ar_status = result->writer->DoneWriting();
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+
+    // Fetch the responses
+    // Requesting `ToTable` might be more efficient than concatenating and
+    // reallocating directly from our arena, as the underlying Arrow implementation
+    // may know the length of the entire dataset.
+    auto maybe_table = result->reader->ToTable();
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+
+    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
+    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
+    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
+    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+
+    if (c.offsets)
+        *c.offsets = offs_ptr;
+    if (c.keys)
+        *c.keys = data_ptr;
+    if (c.counts) {
+        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i)
+            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+    }
+
+    db.hold_reader(c.arena, std::move(result->reader));
+}
+
+void ustore_sample(ustore_sample_t* c_ptr) {
+
+    ustore_sample_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_sample(*db.router, c);
+    rpc_lease_t flight(db);
+    if (!(c.options & ustore_option_dont_discard_memory_k))
+        db.discard_results(c.arena);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+
+    places_arg_t places {collections, {}, {}, c.tasks_count};
+
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    bool const same_collection = places.same_collection();
+    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
+
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightSample);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (same_named_collection)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    export_options(db, c.options, descriptor.cmd);
+
+    bool const has_collections_column = collections && !same_collection;
+    bool const has_limits_column = true;
+
+    // If all requests map to the same collection, we can avoid passing its ID
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
+        return_if_error_m(c.error);
+        transform_n(collections, places.count, continuous.begin());
+        collections = {continuous.begin(), sizeof(ustore_collection_t)};
+    }
+
+    if (has_limits_column && !limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+        return_if_error_m(c.error);
+        transform_n(limits, places.size(), continuous.begin());
+        limits = {continuous.begin(), places.size()};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c, output_array_c;
+    ArrowSchema input_schema_c, output_schema_c;
+    auto count_collections = has_collections_column + has_limits_column;
+    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    if (has_collections_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
+            nullptr,
+            nullptr,
+            collections.get(),
+            input_schema_c.children[0],
+            input_array_c.children[0],
+            c.error);
+    return_if_error_m(c.error);
+
+    if (has_limits_column)
+        ustore_to_arrow_column( //
+            c.tasks_count,
+            kArgCountLimits.c_str(),
+            ustore_doc_field<ustore_length_t>(),
+            nullptr,
+            nullptr,
+            limits.get(),
+            input_schema_c.children[has_collections_column],
+            input_array_c.children[has_collections_column],
+            c.error);
+    return_if_error_m(c.error);
+
+    // Send the request to server
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    if (batch_ptr->num_rows() == 0)
+        return;
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to Get with Arrow server");
+
+    ar_status = result->writer->Begin(batch_ptr->schema());
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+
+    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
+    ar_status = result->writer->WriteTable(*input_table);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+
+    ar_status = result->writer->DoneWriting();
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+
+    // Fetch the responses
+    // Requesting `ToTable` might be more efficient than concatenating and
+    // reallocating directly from our arena, as the underlying Arrow implementation
+    // may know the length of the entire dataset.
+    auto maybe_table = result->reader->ToTable();
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+
+    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
+    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
+    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
+    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
+
+    if (c.offsets)
+        *c.offsets = offs_ptr;
+    if (c.keys)
+        *c.keys = data_ptr;
+    if (c.counts) {
+        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
+        return_if_error_m(c.error);
+        for (std::size_t i = 0; i != places.count; ++i)
+            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+    }
+
+    db.hold_reader(c.arena, std::move(result->reader));
+}
+
+void ustore_measure(ustore_measure_t* c_ptr) {
+
+    ustore_measure_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+}
+
+/*********************************************************/
+/*****************	   Graph Traversals	  ****************/
+/*********************************************************/
+
+void ustore_graph_traverse(ustore_graph_traverse_t* c_ptr) {
+
+    ustore_graph_traverse_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.vertices_offsets && c.vertices, c.error, args_combo_k, "Visited vertices must be exported");
+    return_error_if_m(!c.edges_offsets == !c.edges, c.error, args_combo_k, "Edges need both offsets and IDs");
+    return_error_if_m(c.role != ustore_vertex_role_unknown_k, c.error, args_wrong_k, "Role must be specified");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
+    auto vertices_offsets = arena.alloc<ustore_length_t>(c.hops + 2, c.error);
+    return_if_error_m(c.error);
+    auto edges_offsets = arena.alloc_or_dummy(c.hops + 1, c.error, c.edges_offsets);
+    return_if_error_m(c.error);
+    *c.vertices_offsets = vertices_offsets.begin();
+    if (!c.starts_count) {
+        std::fill(vertices_offsets.begin(), vertices_offsets.end(), 0);
+        std::fill(edges_offsets.begin(), edges_offsets.end(), 0);
+        return;
+    }
+
+    strided_iterator_gt<ustore_key_t const> starts {c.starts, c.starts_stride};
+    if (!starts.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(c.starts_count, c.error);
+        return_if_error_m(c.error);
+        transform_n(starts, c.starts_count, continuous.begin());
+        starts = {continuous.begin(), sizeof(ustore_key_t)};
+    }
+
+    // Now build-up the Arrow representation
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    ustore_to_arrow_schema(c.starts_count, 1, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    ustore_to_arrow_column( //
+        c.starts_count,
+        kArgKeys.c_str(),
+        ustore_doc_field<ustore_key_t>(),
+        nullptr,
+        nullptr,
+        starts.get(),
+        input_schema_c.children[0],
+        input_array_c.children[0],
+        c.error);
+    return_if_error_m(c.error);
+
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightGraphTraverse);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (c.collection != ustore_collection_main_k)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, c.collection);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamHops, c.hops);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamRole, static_cast<int>(c.role));
+    if (c.frontier_limit)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamFrontierLimit, c.frontier_limit);
+    if (c.revisit)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagRevisit);
+    export_options(db, c.options, descriptor.cmd);
+
+    // Send the request to server
+    ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
+    return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
+
+    std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
+
+    ar_status = result->writer->Begin(batch_ptr->schema());
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
+
+    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), batch_ptr->num_rows());
+    ar_status = result->writer->WriteTable(*input_table);
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
+
+    ar_status = result->writer->DoneWriting();
+    return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
+
+    // Fetch the responses
+    auto maybe_table = result->reader->ToTable();
+    return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
+    auto table = maybe_table.ValueUnsafe();
+
+    // The server packs everything into a single column:
+    // offsets of vertices per hop, offsets of edges per hop, vertices and edge triplets
+    auto traversal_array = std::static_pointer_cast<ar::NumericArray<ar::Int64Type>>(table->column(0)->chunk(0));
+    auto traversal_ptr = (ustore_key_t const*)traversal_array->raw_values();
+    std::size_t const traversal_length = static_cast<std::size_t>(traversal_array->length());
+    return_error_if_m(traversal_length >= (c.hops + 2) + (c.hops + 1), c.error, error_unknown_k, "Malformed response");
+
+    std::copy(traversal_ptr, traversal_ptr + c.hops + 2, vertices_offsets.begin());
+    std::copy(traversal_ptr + c.hops + 2, traversal_ptr + c.hops + 2 + c.hops + 1, edges_offsets.begin());
+    ustore_key_t const* found_vertices = traversal_ptr + (c.hops + 2) + (c.hops + 1);
+    *c.vertices = const_cast<ustore_key_t*>(found_vertices);
+    if (c.edges)
+        *c.edges = const_cast<ustore_key_t*>(found_vertices + vertices_offsets[c.hops + 1]);
+
+    db.hold_reader(c.arena, std::move(result->reader));
+}
+
+/*********************************************************/
+/*****************	    Vectors Search	  ****************/
+/*********************************************************/
+
+void ustore_vectors_search(ustore_vectors_search_t* c_ptr) {
+
+    ustore_vectors_search_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.queries_starts, c.error, args_wrong_k, "Query vectors must be provided");
+    return_error_if_m(c.match_counts_limits, c.error, args_wrong_k, "Count limits must be provided");
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
+    if (!(c.options & ustore_option_dont_discard_memory_k))
+        db.discard_results(c.arena);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    auto found_counts = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_counts);
+    return_if_error_m(c.error);
+    auto found_offsets = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_offsets);
+    return_if_error_m(c.error);
+
+    // An empty allow-list can't match anything, so there is no need to ask the server
+    if (!c.tasks_count || (c.allowed_keys && !c.allowed_keys_count)) {
+        for (std::size_t i = 0; i != c.tasks_count; ++i)
+            found_counts[i] = 0, found_offsets[i] = 0;
+        return;
+    }
+
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_key_t const> start_keys {c.start_keys, c.start_keys_stride};
-    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
-    scans_arg_t scans {collections, start_keys, limits, c.tasks_count};
-    places_arg_t places {collections, start_keys, {}, c.tasks_count};
-
-    bool const same_collection = places.same_collection();
-    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-    bool const write_flush = c.options & ustore_option_write_flush_k;
+    strided_iterator_gt<ustore_length_t const> limits {c.match_counts_limits, c.match_counts_limits_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> starts {c.queries_starts, c.queries_starts_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.queries_offsets, c.queries_offsets_stride};
 
-    bool const has_collections_column = !same_collection;
-    constexpr bool has_start_keys_column = true;
-    constexpr bool has_lens_column = true;
+    // Queries are exported into a continuous binary column
+    std::size_t const query_length = c.dimensions * vector_scalar_size_bytes(c.scalar_type);
+    return_error_if_m(query_length, c.error, args_wrong_k, "Dimensions and scalar type must be provided");
 
-    if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.size(), c.error);
-        return_if_error_m(c.error);
-        transform_n(collections, places.size(), continuous.begin());
-        collections = {continuous.begin(), places.size()};
+    auto queries = arena.alloc<byte_t>(c.tasks_count * query_length, c.error);
+    return_if_error_m(c.error);
+    auto queries_offsets = arena.alloc<ustore_length_t>(c.tasks_count + 1, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto query_begin = reinterpret_cast<byte_t const*>(starts[i]) + (offs ? offs[i] : 0u) + c.queries_stride * i;
+        std::memcpy(queries.begin() + i * query_length, query_begin, query_length);
+        queries_offsets[i] = static_cast<ustore_length_t>(i * query_length);
     }
+    queries_offsets[c.tasks_count] = static_cast<ustore_length_t>(c.tasks_count * query_length);
 
-    if (has_start_keys_column && !start_keys.is_continuous()) {
-        auto continuous = arena.alloc<ustore_key_t>(places.size(), c.error);
+    if (!limits.is_continuous()) {
+        auto continuous = arena.alloc<ustore_length_t>(c.tasks_count, c.error);
         return_if_error_m(c.error);
-        transform_n(start_keys, places.size(), continuous.begin());
-        start_keys = {continuous.begin(), places.size()};
+        transform_n(limits, c.tasks_count, continuous.begin());
+        limits = {continuous.begin(), sizeof(ustore_length_t)};
     }
 
-    if (has_lens_column && !limits.is_continuous()) {
-        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+    // If all requests map to the same collection, we can avoid passing its ID
+    bool const same_collection =
+        !collections || strided_range_gt<ustore_collection_t const>(collections, c.tasks_count).same_elements();
+    bool const has_collections_column = collections && !same_collection;
+    if (has_collections_column && !collections.is_continuous()) {
+        auto continuous = arena.alloc<ustore_collection_t>(c.tasks_count, c.error);
         return_if_error_m(c.error);
-        transform_n(limits, places.size(), continuous.begin());
-        limits = {continuous.begin(), places.size()};
+        transform_n(collections, c.tasks_count, continuous.begin());
+        collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
 
     // Now build-up the Arrow representation
-    ArrowArray input_array_c, output_array_c;
-    ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_start_keys_column + has_lens_column;
-    ustore_to_arrow_schema(c.tasks_count, count_collections, &input_schema_c, &input_array_c, c.error);
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    ustore_to_arrow_schema(c.tasks_count, 2 + has_collections_column, &input_schema_c, &input_array_c, c.error);
     return_if_error_m(c.error);
 
-    if (has_collections_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgCols.c_str(),
-            ustore_doc_field<ustore_collection_t>(),
-            nullptr,
-            nullptr,
-            collections.get(),
-            input_schema_c.children[0],
-            input_array_c.children[0],
-            c.error);
+    ustore_to_arrow_column( //
+        c.tasks_count,
+        kArgVals.c_str(),
+        ustore_doc_field_bin_k,
+        nullptr,
+        queries_offsets.begin(),
+        queries.begin(),
+        input_schema_c.children[0],
+        input_array_c.children[0],
+        c.error);
     return_if_error_m(c.error);
 
-    if (has_start_keys_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgScanStarts.c_str(),
-            ustore_doc_field<ustore_key_t>(),
-            nullptr,
-            nullptr,
-            start_keys.get(),
-            input_schema_c.children[has_collections_column],
-            input_array_c.children[has_collections_column],
-            c.error);
+    ustore_to_arrow_column( //
+        c.tasks_count,
+        kArgCountLimits.c_str(),
+        ustore_doc_field<ustore_length_t>(),
+        nullptr,
+        nullptr,
+        limits.get(),
+        input_schema_c.children[1],
+        input_array_c.children[1],
+        c.error);
     return_if_error_m(c.error);
 
-    if (has_lens_column)
+    if (has_collections_column)
         ustore_to_arrow_column( //
             c.tasks_count,
-            kArgCountLimits.c_str(),
-            ustore_doc_field<ustore_length_t>(),
+            kArgCols.c_str(),
+            ustore_doc_field<ustore_collection_t>(),
             nullptr,
             nullptr,
-            limits.get(),
-            input_schema_c.children[has_collections_column + has_start_keys_column],
-            input_array_c.children[has_collections_column + has_start_keys_column],
+            collections.get(),
+            input_schema_c.children[2],
+            input_array_c.children[2],
             c.error);
     return_if_error_m(c.error);
 
@@ -1098,206 +2505,342 @@ void ustore_scan(ustore_scan_t* c_ptr) {
     // Configure the `cmd` descriptor
     arf::FlightDescriptor descriptor;
     descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightScan);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightVectorsSearch);
     if (c.transaction)
         fmt::format_to(std::back_inserter(descriptor.cmd),
                        "{}=0x{:0>16x}&",
                        kParamTransactionID,
                        std::uintptr_t(c.transaction));
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
-    if (same_named_collection)
+    if (collections && same_collection && collections[0] != ustore_collection_main_k)
         fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    export_options(c.options, descriptor.cmd);
-
-    // Send the request to server
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamDimensions, c.dimensions);
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamScalarType, static_cast<int>(c.scalar_type));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamMetric, static_cast<int>(c.metric));
+    if (c.metric_threshold != 0)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamMetricThreshold, c.metric_threshold);
+    if (c.index_expansion)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamIndexExpansion, c.index_expansion);
+    if (c.rerank_count)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamRerankCount, c.rerank_count);
+    if (c.keys_min)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamKeysMin, c.keys_min);
+    if (c.keys_max)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamKeysMax, c.keys_max);
+    export_options(db, c.options, descriptor.cmd);
+
+    // Send the request to server, passing the allow-list in the metadata, as it has a different length
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    if (batch_ptr->num_rows() == 0)
-        return;
-    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
     return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
 
-    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*input_table);
+    ar_status = c.allowed_keys //
+                    ? result->writer->WriteWithMetadata(*batch_ptr,
+                                                        ar::Buffer::Wrap(c.allowed_keys, c.allowed_keys_count))
+                    : result->writer->WriteRecordBatch(*batch_ptr);
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
 
     ar_status = result->writer->DoneWriting();
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
 
-    // Fetch the responses
-    // Requesting `ToTable` might be more efficient than concatenating and
-    // reallocating directly from our arena, as the underlying Arrow implementation
-    // may know the length of the entire dataset.
+    // Fetch the responses: a row per query, with lists of matched keys and metrics
     auto maybe_table = result->reader->ToTable();
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
-
-    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
-    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
-    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
-    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
-
-    if (c.offsets)
-        *c.offsets = offs_ptr;
-    if (c.keys)
-        *c.keys = data_ptr;
-    if (c.counts) {
-        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
-        return_if_error_m(c.error);
-        for (std::size_t i = 0; i != places.count; ++i)
-            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+    return_error_if_m(table->num_columns() == 2 && table->num_rows() == static_cast<int64_t>(c.tasks_count),
+                      c.error,
+                      error_unknown_k,
+                      "Malformed response");
+
+    auto keys_array = std::static_pointer_cast<ar::ListArray>(table->column(0)->chunk(0));
+    auto metrics_array = std::static_pointer_cast<ar::ListArray>(table->column(1)->chunk(0));
+    auto keys_values = std::static_pointer_cast<ar::NumericArray<ar::Int64Type>>(keys_array->values());
+    auto metrics_values = std::static_pointer_cast<ar::NumericArray<ar::FloatType>>(metrics_array->values());
+    auto offsets_ptr = keys_array->raw_value_offsets();
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        found_counts[i] = static_cast<ustore_length_t>(offsets_ptr[i + 1] - offsets_ptr[i]);
+        found_offsets[i] = static_cast<ustore_length_t>(offsets_ptr[i]);
     }
+    if (c.match_keys)
+        *c.match_keys = const_cast<ustore_key_t*>(keys_values->raw_values());
+    if (c.match_metrics)
+        *c.match_metrics = const_cast<ustore_float_t*>(metrics_values->raw_values());
 
-    db.readers.push_back(std::move(result->reader));
+    db.hold_reader(c.arena, std::move(result->reader));
 }
 
-void ustore_sample(ustore_sample_t* c_ptr) {
+/*********************************************************/
+/*****************	     Docs Gather	  ****************/
+/*********************************************************/
+
+void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
+
+    ustore_docs_gather_t& c = *c_ptr;
+    if (c.filter && c.matches_count)
+        *c.matches_count = 0;
+    if (!c.docs_count || (!c.fields_count && !c.filter))
+        return;
 
-    ustore_sample_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.keys, c.error, args_wrong_k, "Keys must be provided");
+    return_error_if_m(!c.fields_count || (c.fields && c.types),
+                      c.error,
+                      args_wrong_k,
+                      "Fields and types must be provided");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
-
-    places_arg_t places {collections, {}, {}, c.tasks_count};
-
-    ar::Status ar_status;
-    arrow_mem_pool_t pool(arena);
-    arf::FlightCallOptions options = arrow_call_options(pool);
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+    places_arg_t places {collections, keys, {}, c.docs_count};
+
+    // Requested fields are packed into the metadata, each as a type byte and a NULL-terminated name.
+    // The filter follows them, marked with the `null` type, to be evaluated on the server.
+    std::size_t const filter_length = c.filter ? std::strlen(c.filter) + 1 : 0;
+    std::size_t metadata_length = c.filter ? 1 + filter_length : 0;
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+        metadata_length += 1 + std::strlen(fields[field_idx]) + 1;
+    auto metadata = arena.alloc<byte_t>(metadata_length, c.error);
+    return_if_error_m(c.error);
+    std::size_t progress = 0;
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        std::size_t const name_length = std::strlen(fields[field_idx]) + 1;
+        metadata[progress] = static_cast<byte_t>(types[field_idx]);
+        std::memcpy(metadata.begin() + progress + 1, fields[field_idx], name_length);
+        progress += 1 + name_length;
+    }
+    if (c.filter) {
+        metadata[progress] = static_cast<byte_t>(ustore_doc_field_null_k);
+        std::memcpy(metadata.begin() + progress + 1, c.filter, filter_length);
+    }
 
-    // Configure the `cmd` descriptor
+    // If all requests map to the same collection, we can avoid passing its ID
     bool const same_collection = places.same_collection();
-    bool const same_named_collection = same_collection && same_collections_are_named(places.collections_begin);
-
-    arf::FlightDescriptor descriptor;
-    descriptor.type = arf::FlightDescriptor::UNKNOWN;
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightSample);
-    if (c.transaction)
-        fmt::format_to(std::back_inserter(descriptor.cmd),
-                       "{}=0x{:0>16x}&",
-                       kParamTransactionID,
-                       std::uintptr_t(c.transaction));
-    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
-    if (same_named_collection)
-        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
-    export_options(c.options, descriptor.cmd);
-
     bool const has_collections_column = collections && !same_collection;
-    bool const has_limits_column = true;
-
-    // If all requests map to the same collection, we can avoid passing its ID
     if (has_collections_column && !collections.is_continuous()) {
-        auto continuous = arena.alloc<ustore_collection_t>(places.count, c.error);
+        auto continuous = arena.alloc<ustore_collection_t>(c.docs_count, c.error);
         return_if_error_m(c.error);
-        transform_n(collections, places.count, continuous.begin());
+        transform_n(collections, c.docs_count, continuous.begin());
         collections = {continuous.begin(), sizeof(ustore_collection_t)};
     }
 
-    if (has_limits_column && !limits.is_continuous()) {
-        auto continuous = arena.alloc<ustore_length_t>(places.size(), c.error);
+    if (!keys.is_continuous()) {
+        auto continuous = arena.alloc<ustore_key_t>(c.docs_count, c.error);
         return_if_error_m(c.error);
-        transform_n(limits, places.size(), continuous.begin());
-        limits = {continuous.begin(), places.size()};
+        transform_n(keys, c.docs_count, continuous.begin());
+        keys = {continuous.begin(), sizeof(ustore_key_t)};
     }
 
     // Now build-up the Arrow representation
-    ArrowArray input_array_c, output_array_c;
-    ArrowSchema input_schema_c, output_schema_c;
-    auto count_collections = has_collections_column + has_limits_column;
-    ustore_to_arrow_schema(places.count, count_collections, &input_schema_c, &input_array_c, c.error);
+    ArrowArray input_array_c;
+    ArrowSchema input_schema_c;
+    ustore_to_arrow_schema(c.docs_count, 1 + has_collections_column, &input_schema_c, &input_array_c, c.error);
+    return_if_error_m(c.error);
+
+    ustore_to_arrow_column( //
+        c.docs_count,
+        kArgKeys.c_str(),
+        ustore_doc_field<ustore_key_t>(),
+        nullptr,
+        nullptr,
+        keys.get(),
+        input_schema_c.children[0],
+        input_array_c.children[0],
+        c.error);
     return_if_error_m(c.error);
 
     if (has_collections_column)
         ustore_to_arrow_column( //
-            c.tasks_count,
+            c.docs_count,
             kArgCols.c_str(),
             ustore_doc_field<ustore_collection_t>(),
             nullptr,
             nullptr,
             collections.get(),
-            input_schema_c.children[0],
-            input_array_c.children[0],
+            input_schema_c.children[1],
+            input_array_c.children[1],
             c.error);
     return_if_error_m(c.error);
 
-    if (has_limits_column)
-        ustore_to_arrow_column( //
-            c.tasks_count,
-            kArgCountLimits.c_str(),
-            ustore_doc_field<ustore_length_t>(),
-            nullptr,
-            nullptr,
-            limits.get(),
-            input_schema_c.children[has_collections_column],
-            input_array_c.children[has_collections_column],
-            c.error);
-    return_if_error_m(c.error);
+    ar::Status ar_status;
+    arrow_mem_pool_t pool(arena);
+    arf::FlightCallOptions options = arrow_call_options(pool);
+
+    // Configure the `cmd` descriptor
+    bool const wants_conversions = c.columns_conversions;
+    bool const wants_collisions = c.columns_collisions;
+    arf::FlightDescriptor descriptor;
+    descriptor.type = arf::FlightDescriptor::UNKNOWN;
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}?", kFlightDocsGather);
+    if (c.transaction)
+        fmt::format_to(std::back_inserter(descriptor.cmd),
+                       "{}=0x{:0>16x}&",
+                       kParamTransactionID,
+                       std::uintptr_t(c.transaction));
+    fmt::format_to(std::back_inserter(descriptor.cmd), "{}={}&", kParamSnapshotID, c.snapshot);
+    if (collections && same_collection && collections[0] != ustore_collection_main_k)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}=0x{:0>16x}&", kParamCollectionID, collections[0]);
+    if (wants_conversions)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagConversions);
+    if (wants_collisions)
+        fmt::format_to(std::back_inserter(descriptor.cmd), "{}&", kParamFlagCollisions);
+    export_options(db, c.options, descriptor.cmd);
 
     // Send the request to server
     ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch = ar::ImportRecordBatch(&input_array_c, &input_schema_c);
     return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't pack RecordBatch");
 
     std::shared_ptr<ar::RecordBatch> batch_ptr = maybe_batch.ValueUnsafe();
-    if (batch_ptr->num_rows() == 0)
-        return;
-    ar::Result<arf::FlightClient::DoExchangeResult> result = db.flight->DoExchange(options, descriptor);
-    return_error_if_m(result.ok(), c.error, network_k, "Failed to Get with Arrow server");
+    ar::Result<arf::FlightClient::DoExchangeResult> result = flight->DoExchange(options, descriptor);
+    return_error_if_m(result.ok(), c.error, network_k, "Failed to exchange with Arrow server");
 
     ar_status = result->writer->Begin(batch_ptr->schema());
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing schema");
 
-    auto input_table = ar::Table::Make(batch_ptr->schema(), batch_ptr->columns(), static_cast<int64_t>(places.size()));
-    ar_status = result->writer->WriteTable(*input_table);
+    auto metadata_buffer = ar::Buffer::Wrap(metadata.begin(), metadata_length);
+    ar_status = result->writer->WriteWithMetadata(*batch_ptr, metadata_buffer);
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Serializing request");
 
     ar_status = result->writer->DoneWriting();
     return_error_if_m(ar_status.ok(), c.error, error_unknown_k, "Submitting request");
 
-    // Fetch the responses
-    // Requesting `ToTable` might be more efficient than concatenating and
-    // reallocating directly from our arena, as the underlying Arrow implementation
-    // may know the length of the entire dataset.
+    // Fetch the responses: a column per field, followed by the optional bitmaps of conversions and collisions,
+    // and the indexes of the matching documents, if filtered
     auto maybe_table = result->reader->ToTable();
     return_error_if_m(maybe_table.ok(), c.error, error_unknown_k, "Failed to create table");
     auto table = maybe_table.ValueUnsafe();
+    std::size_t const bitmaps_count = c.fields_count * (wants_conversions + wants_collisions);
+    std::size_t const columns_count = c.fields_count + bitmaps_count + (c.filter != nullptr);
+    std::size_t const docs_count = static_cast<std::size_t>(table->num_rows());
+    return_error_if_m(table->num_columns() == static_cast<int>(columns_count) &&
+                          (c.filter ? docs_count <= c.docs_count : docs_count == c.docs_count),
+                      c.error,
+                      error_unknown_k,
+                      "Malformed response");
+    if (!docs_count)
+        // None of the documents matched the filter
+        return;
 
-    auto keys_array = std::static_pointer_cast<ar::NumericArray<ar::Int32Type>>(table->column(0)->chunk(0));
-    auto offs_array = std::static_pointer_cast<ar::NumericArray<ar::UInt32Type>>(table->column(1)->chunk(0));
-    auto data_ptr = (ustore_key_t*)keys_array->raw_values();
-    auto offs_ptr = (ustore_length_t*)offs_array->raw_values();
-
-    if (c.offsets)
-        *c.offsets = offs_ptr;
-    if (c.keys)
-        *c.keys = data_ptr;
-    if (c.counts) {
-        auto lens = *c.counts = arena.alloc<ustore_length_t>(places.count, c.error).begin();
-        return_if_error_m(c.error);
-        for (std::size_t i = 0; i != places.count; ++i)
-            lens[i] = offs_ptr ? offs_ptr[i + 1] - offs_ptr[i] : 0;
+    // Indexes of the matching documents are exported in-place
+    if (c.filter) {
+        auto matches = table->column(static_cast<int>(columns_count - 1))->chunk(0);
+        if (c.matches_count)
+            *c.matches_count = static_cast<ustore_length_t>(docs_count);
+        if (c.matches)
+            *c.matches = const_cast<ustore_length_t*>(matches->data()->GetValues<ustore_length_t>(1, 0));
+        if (!c.fields_count)
+            return db.hold_reader(c.arena, std::move(result->reader));
     }
 
-    db.readers.push_back(std::move(result->reader));
-}
+    // Addresses of columns are exported in the same order, as in the standalone builds
+    auto addresses = arena.alloc<void*>(c.fields_count * 6, c.error);
+    return_if_error_m(c.error);
+    auto validities = reinterpret_cast<ustore_octet_t**>(addresses.begin());
+    auto conversions = reinterpret_cast<ustore_octet_t**>(addresses.begin() + c.fields_count);
+    auto collisions = reinterpret_cast<ustore_octet_t**>(addresses.begin() + c.fields_count * 2);
+    auto offsets = reinterpret_cast<ustore_length_t**>(addresses.begin() + c.fields_count * 3);
+    auto lengths = reinterpret_cast<ustore_length_t**>(addresses.begin() + c.fields_count * 4);
+    auto scalars = reinterpret_cast<ustore_byte_t**>(addresses.begin() + c.fields_count * 5);
+    if (c.columns_validities)
+        *c.columns_validities = validities;
+    if (c.columns_conversions)
+        *c.columns_conversions = conversions;
+    if (c.columns_collisions)
+        *c.columns_collisions = collisions;
+    if (c.columns_offsets)
+        *c.columns_offsets = offsets;
+    if (c.columns_lengths)
+        *c.columns_lengths = lengths;
+    if (c.columns_scalars)
+        *c.columns_scalars = scalars;
+
+    // Arrow omits the validity bitmaps of columns without NULLs, but we always export them
+    auto chunk = [&](std::size_t column_idx) {
+        return table->column(static_cast<int>(column_idx))->chunk(0);
+    };
+    auto bitmap = [&](std::size_t column_idx) {
+        return const_cast<ustore_octet_t*>(chunk(column_idx)->data()->GetValues<ustore_octet_t>(1, 0));
+    };
+    std::size_t const slots_per_bitmap = divide_round_up<std::size_t>(docs_count, CHAR_BIT);
+    std::size_t strings_length = 0;
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        auto array = chunk(field_idx);
+        validities[field_idx] = const_cast<ustore_octet_t*>(array->null_bitmap_data());
+        if (!validities[field_idx]) {
+            auto all_valid = arena.alloc<ustore_octet_t>(slots_per_bitmap, c.error);
+            return_if_error_m(c.error);
+            std::fill(all_valid.begin(), all_valid.end(), 0xFF);
+            validities[field_idx] = all_valid.begin();
+        }
+        conversions[field_idx] = wants_conversions ? bitmap(c.fields_count + field_idx) : nullptr;
+        collisions[field_idx] =
+            wants_collisions ? bitmap(c.fields_count * (1 + wants_conversions) + field_idx) : nullptr;
+
+        // Strings are re-joined below, scalars are exported in-place
+        ustore_doc_field_type_t const type = types[field_idx];
+        if (type == ustore_doc_field_str_k || type == ustore_doc_field_bin_k) {
+            auto strings = std::static_pointer_cast<ar::BinaryArray>(array);
+            strings_length += strings->total_values_length() + (type == ustore_doc_field_str_k) * docs_count;
+            scalars[field_idx] = nullptr;
+        }
+        else {
+            scalars[field_idx] = const_cast<ustore_byte_t*>(array->data()->GetValues<ustore_byte_t>(1, 0));
+            offsets[field_idx] = nullptr;
+            lengths[field_idx] = nullptr;
+        }
+    }
 
-void ustore_measure(ustore_measure_t* c_ptr) {
+    // Strings arrive column by column, but are exported in the order of documents,
+    // with NULL-terminators after texts, same as in the standalone builds
+    auto joined_strings = arena.alloc<byte_t>(strings_length, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        ustore_doc_field_type_t const type = types[field_idx];
+        if (type != ustore_doc_field_str_k && type != ustore_doc_field_bin_k)
+            continue;
+        auto column_offsets = arena.alloc<ustore_length_t>(docs_count * 2 + 1, c.error);
+        return_if_error_m(c.error);
+        offsets[field_idx] = column_offsets.begin();
+        lengths[field_idx] = column_offsets.begin() + docs_count + 1;
+    }
 
-    ustore_measure_t& c = *c_ptr;
-    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    std::size_t strings_progress = 0;
+    for (std::size_t doc_idx = 0; doc_idx != docs_count; ++doc_idx) {
+        for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+            ustore_doc_field_type_t const type = types[field_idx];
+            if (type != ustore_doc_field_str_k && type != ustore_doc_field_bin_k)
+                continue;
+            auto strings = std::static_pointer_cast<ar::BinaryArray>(chunk(field_idx));
+            std::int32_t length = 0;
+            std::uint8_t const* begin = strings->GetValue(static_cast<int64_t>(doc_idx), &length);
+            offsets[field_idx][doc_idx] = static_cast<ustore_length_t>(strings_progress);
+            lengths[field_idx][doc_idx] = static_cast<ustore_length_t>(length);
+            std::memcpy(joined_strings.begin() + strings_progress, begin, static_cast<std::size_t>(length));
+            strings_progress += static_cast<std::size_t>(length);
+            if (type == ustore_doc_field_str_k)
+                joined_strings[strings_progress++] = byte_t {0};
+        }
+    }
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+        if (types[field_idx] == ustore_doc_field_str_k || types[field_idx] == ustore_doc_field_bin_k)
+            offsets[field_idx][docs_count] = static_cast<ustore_length_t>(strings_progress);
+    if (c.joined_strings)
+        *c.joined_strings = reinterpret_cast<ustore_byte_t*>(joined_strings.begin());
 
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+    db.hold_reader(c.arena, std::move(result->reader));
 }
 
 /*********************************************************/
@@ -1312,6 +2855,9 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
     return_error_if_m(name_len, c.error, args_wrong_k, "Default collection is always present");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_collection_create(*db.router, c);
+    rpc_lease_t flight(db);
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}?{}={}", kFlightColCreate, kParamCollectionName, c.name);
@@ -1323,7 +2869,7 @@ void ustore_collection_create(ustore_collection_create_t* c_ptr) {
         std::lock_guard<std::mutex> lk(db.arena_lock);
         arrow_mem_pool_t pool(db.arena);
         arf::FlightCallOptions options = arrow_call_options(pool);
-        maybe_stream = db.flight->DoAction(options, action);
+        maybe_stream = flight->DoAction(options, action);
     }
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
     auto& stream_ptr = maybe_stream.ValueUnsafe();
@@ -1351,6 +2897,9 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     }
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_collection_drop(*db.router, c);
+    rpc_lease_t flight(db);
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type),
@@ -1364,7 +2913,7 @@ void ustore_collection_drop(ustore_collection_drop_t* c_ptr) {
     std::lock_guard<std::mutex> lk(db.arena_lock);
     arrow_mem_pool_t pool(db.arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
-    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = flight->DoAction(options, action);
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
@@ -1373,8 +2922,11 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
     ustore_collection_list_t& c = *c_ptr;
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_collection_list(*db.router, c);
+    rpc_lease_t flight(db);
     if (!(c.options & ustore_option_dont_discard_memory_k))
-        db.readers.clear();
+        db.discard_results(c.arena);
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
@@ -1390,7 +2942,7 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
                        kParamTransactionID,
                        std::uintptr_t(c.transaction));
 
-    auto maybe_stream = db.flight->DoGet(options, ticket);
+    auto maybe_stream = flight->DoGet(options, ticket);
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
     auto& stream_ptr = maybe_stream.ValueUnsafe();
 
@@ -1413,7 +2965,7 @@ void ustore_collection_list(ustore_collection_list_t* c_ptr) {
         *c.ids = (ustore_collection_t*)array->raw_values();
     }
 
-    db.readers.push_back(std::move(stream_ptr));
+    db.hold_reader(c.arena, std::move(stream_ptr));
 }
 
 void ustore_database_control(ustore_database_control_t* c_ptr) {
@@ -1422,8 +2974,39 @@ void ustore_database_control(ustore_database_control_t* c_ptr) {
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
     return_error_if_m(c.request, c.error, uninitialized_state_k, "Request is uninitialized");
 
+    rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_database_control(*db.router, c);
+
     *c.response = NULL;
-    log_error_m(c.error, missing_feature_k, "Controls aren't supported in this implementation!");
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    return_if_error_m(c.error);
+
+    // The request is forwarded to the engine behind the server
+    rpc_lease_t flight(db);
+
+    arf::Action action;
+    action.type = kFlightControl;
+    action.body = std::make_shared<ar::Buffer>(std::string_view {c.request});
+
+    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream;
+    {
+        std::lock_guard<std::mutex> lk(db.arena_lock);
+        arrow_mem_pool_t pool(db.arena);
+        arf::FlightCallOptions options = arrow_call_options(pool);
+        maybe_stream = flight->DoAction(options, action);
+    }
+    return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
+    auto& stream_ptr = maybe_stream.ValueUnsafe();
+    ar::Result<std::unique_ptr<arf::Result>> maybe_result = stream_ptr->Next();
+    return_error_if_m(maybe_result.ok() && maybe_result.ValueUnsafe(), c.error, network_k, "No response received");
+
+    auto const& body = maybe_result.ValueUnsafe()->body;
+    auto response = arena.alloc<char>(body->size() + 1, c.error).begin();
+    return_if_error_m(c.error);
+    std::memcpy(response, body->data(), body->size());
+    response[body->size()] = 0;
+    *c.response = response;
 }
 
 /*********************************************************/
@@ -1440,10 +3023,19 @@ void ustore_snapshot_list(ustore_snapshot_list_t* c_ptr) {
     arrow_mem_pool_t pool(arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
 
+    // Snapshots can't be created across shards, so there is nothing to list
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router) {
+        if (c.count)
+            *c.count = 0;
+        if (c.ids)
+            *c.ids = nullptr;
+        return;
+    }
+    rpc_lease_t flight(db);
 
     arf::Ticket ticket {kFlightListSnap};
-    ar::Result<std::unique_ptr<arf::FlightStreamReader>> maybe_stream = db.flight->DoGet(options, ticket);
+    ar::Result<std::unique_ptr<arf::FlightStreamReader>> maybe_stream = flight->DoGet(options, ticket);
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 
     auto& stream_ptr = maybe_stream.ValueUnsafe();
@@ -1468,6 +3060,8 @@ void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}", kFlightSnapCreate);
@@ -1477,7 +3071,7 @@ void ustore_snapshot_create(ustore_snapshot_create_t* c_ptr) {
         std::lock_guard<std::mutex> lk(db.arena_lock);
         arrow_mem_pool_t pool(db.arena);
         arf::FlightCallOptions options = arrow_call_options(pool);
-        maybe_stream = db.flight->DoAction(options, action);
+        maybe_stream = flight->DoAction(options, action);
     }
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
     auto& stream_ptr = maybe_stream.ValueUnsafe();
@@ -1497,6 +3091,8 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    return_error_if_m(!db.router, c.error, missing_feature_k, "Not supported across shards");
+    rpc_lease_t flight(db);
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type), "{}?{}={}", kFlightSnapCreate, kParamSnapshotID, c.id);
@@ -1504,7 +3100,7 @@ void ustore_snapshot_drop(ustore_snapshot_drop_t* c_ptr) {
     std::lock_guard<std::mutex> lk(db.arena_lock);
     arrow_mem_pool_t pool(db.arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
-    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = flight->DoAction(options, action);
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
@@ -1519,6 +3115,9 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
     return_error_if_m(c.transaction, c.error, uninitialized_state_k, "Transaction is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_transaction_init(*db.router, c);
+    rpc_lease_t flight(db);
 
     arf::Action action;
     ustore_size_t txn_id = *reinterpret_cast<ustore_size_t*>(c.transaction);
@@ -1533,7 +3132,7 @@ void ustore_transaction_init(ustore_transaction_init_t* c_ptr) {
         std::lock_guard<std::mutex> lk(db.arena_lock);
         arrow_mem_pool_t pool(db.arena);
         arf::FlightCallOptions options = arrow_call_options(pool);
-        maybe_stream = db.flight->DoAction(options, action);
+        maybe_stream = flight->DoAction(options, action);
     }
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 
@@ -1555,6 +3154,9 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     return_error_if_m(c.transaction, c.error, uninitialized_state_k, "Transaction is uninitialized");
 
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c.db);
+    if (db.router)
+        return route_transaction_commit(*db.router, c);
+    rpc_lease_t flight(db);
 
     arf::Action action;
     fmt::format_to(std::back_inserter(action.type),
@@ -1568,7 +3170,7 @@ void ustore_transaction_commit(ustore_transaction_commit_t* c_ptr) {
     std::lock_guard<std::mutex> lk(db.arena_lock);
     arrow_mem_pool_t pool(db.arena);
     arf::FlightCallOptions options = arrow_call_options(pool);
-    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = db.flight->DoAction(options, action);
+    ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = flight->DoAction(options, action);
     return_error_if_m(maybe_stream.ok(), c.error, network_k, "Failed to act on Arrow server");
 }
 
@@ -1589,6 +3191,7 @@ void ustore_database_free(ustore_database_t c_db) {
     if (!c_db)
         return;
     rpc_client_t& db = *reinterpret_cast<rpc_client_t*>(c_db);
+    delete db.router;
     db.arena.release_all();
     delete &db;
 }
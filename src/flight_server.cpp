@@ -9,17 +9,26 @@
  * https://arrow.apache.org/cookbook/cpp/flight.html
  */
 
+#include <map>
+#include <array>
 #include <mutex>
+#include <atomic>
+#include <memory>
 #include <fstream>    // `std::ifstream`
 #include <charconv>   // `std::from_chars`
 #include <chrono>     // `std::time_point`
 #include <cstdio>     // `std::printf`
 #include <iostream>   // `std::cerr`
 #include <filesystem> // Enumerating and creating directories
+#include <deque>
+#include <random> // `std::random_device`
+#include <thread> // `std::thread`
 #include <unordered_map>
 #include <unordered_set>
 
+#include <arrow/flight/client.h> // Replicas follow the primary
 #include <arrow/flight/server.h> // RPC Server Implementation
+#include <fmt/core.h>            // `fmt::format_to`
 #include <clipp.h>               // Command Line Interface
 
 #include "ustore/cpp/db.hpp"
@@ -42,6 +51,8 @@ inline static arf::ActionType const kActionSnapOpen {kFlightSnapCreate, "Find a
 inline static arf::ActionType const kActionSnapDrop {kFlightSnapDrop, "Delete a named snapshot."};
 inline static arf::ActionType const kActionTxnBegin {kFlightTxnBegin, "Starts an ACID transaction and returns its ID."};
 inline static arf::ActionType const kActionTxnCommit {kFlightTxnCommit, "Commit a previously started transaction."};
+inline static arf::ActionType const kActionControl {kFlightControl, "Passes a free-form request to the engine."};
+inline static arf::ActionType const kActionReplicate {kFlightReplicate, "Exports the changes after a sequence number."};
 
 /**
  * @brief Searches for a "value" among key-value pairs passed in URI after path.
@@ -165,6 +176,16 @@ std::unique_ptr<arf::ResultStream> return_empty() {
     return std::unique_ptr<arf::ResultStream>(results.release());
 }
 
+/**
+ * @brief Copies a string into a Arrow-compatible `ResultStream`.
+ */
+std::unique_ptr<arf::ResultStream> return_string(std::string_view str) {
+    auto result = std::make_unique<arf::Result>();
+    result->body = ar::Buffer::FromString(std::string(str));
+    auto results = std::make_unique<SingleResultStream>(std::move(result));
+    return std::unique_ptr<arf::ResultStream>(results.release());
+}
+
 using base_id_t = std::uint64_t;
 enum client_id_t : base_id_t {};
 enum txn_id_t : base_id_t {};
@@ -197,6 +218,25 @@ base_id_t parse_snap_id(std::string_view str, base_id_t default_ = 0) {
     return result;
 }
 
+std::size_t parse_count(std::optional<std::string_view> str, std::size_t default_ = 0) {
+    std::size_t result = default_;
+    if (str)
+        std::from_chars(str->data(), str->data() + str->size(), result);
+    return result;
+}
+
+ustore_key_t parse_key(std::optional<std::string_view> str, ustore_key_t default_ = 0) {
+    ustore_key_t result = default_;
+    if (str)
+        std::from_chars(str->data(), str->data() + str->size(), result);
+    return result;
+}
+
+ustore_float_t parse_real(std::optional<std::string_view> str, ustore_float_t default_ = 0) {
+    // Numbers in the URI are followed by `&` or the end of the null-terminated `cmd`
+    return str ? std::strtof(str->data(), nullptr) : default_;
+}
+
 struct session_id_t {
     client_id_t client_id {0};
     txn_id_t txn_id {0};
@@ -233,13 +273,101 @@ struct running_txn_t {
     bool executing {};
 };
 
-using client_to_txn_t = std::unordered_map<session_id_t, running_txn_t, session_id_hash_t>;
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer queue of reusable handles,
+ * following the design of Dmitry Vyukov. Every cell carries a sequence number, so
+ * producers and consumers only contend on their own cursor, and never block each other.
+ */
+template <typename handle_at>
+class handles_pool_gt {
+    struct cell_t {
+        std::atomic<std::size_t> sequence;
+        handle_at handle;
+    };
+
+    std::unique_ptr<cell_t[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> push_position_ {0};
+    alignas(64) std::atomic<std::size_t> pop_position_ {0};
+
+  public:
+    handles_pool_gt(std::size_t capacity) {
+        std::size_t cells_count = 2;
+        while (cells_count < capacity)
+            cells_count *= 2;
+        cells_ = std::make_unique<cell_t[]>(cells_count);
+        mask_ = cells_count - 1;
+        for (std::size_t i = 0; i != cells_count; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(handle_at handle) noexcept {
+        cell_t* cell = nullptr;
+        std::size_t position = push_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+            if (difference == 0) {
+                if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false;
+            else
+                position = push_position_.load(std::memory_order_relaxed);
+        }
+        cell->handle = handle;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(handle_at& handle) noexcept {
+        cell_t* cell = nullptr;
+        std::size_t position = pop_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position + 1);
+            if (difference == 0) {
+                if (pop_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false;
+            else
+                position = pop_position_.load(std::memory_order_relaxed);
+        }
+        handle = cell->handle;
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/**
+ * @brief Idle transactions ordered by the time of their last access,
+ * so the oldest one is found in constant time, and updated in `log2(n)`.
+ */
+using idle_txns_t = std::multimap<sys_time_t, session_id_t>;
 
-struct aging_txn_order_t {
-    client_to_txn_t const& sessions;
+struct held_txn_t {
+    running_txn_t running;
+    idle_txns_t::iterator idle_it;
+};
 
-    bool operator()(session_id_t const& a, session_id_t const& b) const noexcept {
-        return sessions.at(a).last_access > sessions.at(b).last_access;
+/**
+ * @brief One of the independently locked parts of the sessions table.
+ * Concurrent clients mostly land in different shards and don't contend.
+ */
+struct sessions_shard_t {
+    std::mutex mutex;
+    std::unordered_map<session_id_t, held_txn_t, session_id_hash_t> client_to_txn;
+    idle_txns_t idle_txns;
+
+    void erase(std::unordered_map<session_id_t, held_txn_t, session_id_hash_t>::iterator it) noexcept {
+        if (it->second.idle_it != idle_txns.end())
+            idle_txns.erase(it->second.idle_it);
+        client_to_txn.erase(it);
     }
 };
 
@@ -249,6 +377,7 @@ struct session_lock_t {
     session_id_t session_id;
     ustore_transaction_t txn = nullptr;
     ustore_arena_t arena = nullptr;
+    bool is_locked = false;
 
     bool is_txn() const noexcept { return txn; }
     ~session_lock_t() noexcept;
@@ -259,161 +388,192 @@ struct session_lock_t {
  * holds ownership of any "transaction handle" or "memory arena" for too long. So if
  * a client goes mute or disconnects, we can reuse same memory for other connections
  * and clients.
+ *
+ * Sessions are spread across shards by the hash of their ID, each with its own mutex,
+ * while the unused handles live in lock-free pools. Only evictions visit all the shards.
  */
 class sessions_t {
-    std::mutex mutex_;
+    static constexpr std::size_t shards_count_k = 64;
+
+    std::array<sessions_shard_t, shards_count_k> shards_;
     // Reusable object handles:
-    std::vector<ustore_arena_t> free_arenas_;
-    std::vector<ustore_transaction_t> free_txns_;
-    /// Links each session to memory used for its operations:
-    client_to_txn_t client_to_txn_;
+    handles_pool_gt<ustore_arena_t> free_arenas_;
+    handles_pool_gt<ustore_transaction_t> free_txns_;
     ustore_database_t db_ = nullptr;
     // On Postgre 9.6+ is set to same 30 seconds.
-    std::size_t milliseconds_timeout = 30'000;
+    std::chrono::milliseconds timeout_ {30'000};
 
+    sessions_shard_t& shard(session_id_t const& session_id) noexcept {
+        return shards_[session_id_hash_t {}(session_id) % shards_count_k];
+    }
+
+    /**
+     * @brief Evicts the transaction, that stayed idle for the longest time,
+     * if it exceeded the timeout. Only the heads of shards are compared.
+     */
     running_txn_t pop(ustore_error_t* c_error) noexcept {
 
-        auto it = std::min_element(client_to_txn_.begin(), client_to_txn_.end(), [](auto left, auto right) {
-            return left.second.last_access < right.second.last_access && !left.second.executing;
-        });
+        sessions_shard_t* oldest_shard = nullptr;
+        sys_time_t oldest_access = sys_clock_t::now() - timeout_;
+        for (sessions_shard_t& shard : shards_) {
+            std::unique_lock _ {shard.mutex};
+            if (!shard.idle_txns.empty() && shard.idle_txns.begin()->first <= oldest_access) {
+                oldest_access = shard.idle_txns.begin()->first;
+                oldest_shard = &shard;
+            }
+        }
+        if (!oldest_shard) {
+            log_error_m(c_error, error_unknown_k, "Too many concurrent sessions");
+            return {};
+        }
 
-        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(it->second.last_access - sys_clock_t::now());
-        if (age.count() < milliseconds_timeout || it->second.executing) {
+        // The shard could have changed, since we have checked it
+        std::unique_lock _ {oldest_shard->mutex};
+        if (oldest_shard->idle_txns.empty() ||
+            oldest_shard->idle_txns.begin()->first > sys_clock_t::now() - timeout_) {
             log_error_m(c_error, error_unknown_k, "Too many concurrent sessions");
             return {};
         }
 
-        running_txn_t released = it->second;
-        client_to_txn_.erase(it);
+        auto it = oldest_shard->client_to_txn.find(oldest_shard->idle_txns.begin()->second);
+        running_txn_t released = it->second.running;
+        oldest_shard->erase(it);
         released.executing = false;
         return released;
     }
 
-    void submit(session_id_t session_id, running_txn_t running_txn) noexcept {
-        running_txn.executing = false;
-        auto res = client_to_txn_.insert_or_assign(session_id, running_txn);
-    }
-
   public:
-    sessions_t(ustore_database_t db, std::size_t n) : db_(db), free_arenas_(n), free_txns_(n), client_to_txn_(n) {
-        std::fill_n(free_arenas_.begin(), n, nullptr);
-        std::fill_n(free_txns_.begin(), n, nullptr);
+    sessions_t(ustore_database_t db, std::size_t n) : free_arenas_(n), free_txns_(n), db_(db) {
+        for (std::size_t i = 0; i != n; ++i) {
+            free_arenas_.push(nullptr);
+            free_txns_.push(nullptr);
+        }
     }
 
     ~sessions_t() noexcept {
-        for (auto a : free_arenas_)
-            ustore_arena_free(a);
-        for (auto t : free_txns_)
-            ustore_transaction_free(t);
+        ustore_arena_t arena = nullptr;
+        while (free_arenas_.pop(arena))
+            ustore_arena_free(arena);
+        ustore_transaction_t txn = nullptr;
+        while (free_txns_.pop(txn))
+            ustore_transaction_free(txn);
+        for (sessions_shard_t& shard : shards_)
+            for (auto& [session_id, held] : shard.client_to_txn) {
+                ustore_arena_free(held.running.arena);
+                ustore_transaction_free(held.running.txn);
+            }
     }
 
     running_txn_t continue_txn(session_id_t session_id, ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
+        sessions_shard_t& shard = this->shard(session_id);
+        std::unique_lock _ {shard.mutex};
 
-        auto it = client_to_txn_.find(session_id);
-        if (it == client_to_txn_.end()) {
+        auto it = shard.client_to_txn.find(session_id);
+        if (it == shard.client_to_txn.end()) {
             log_error_m(c_error, args_wrong_k, "Transaction was terminated, start a new one");
             return {};
         }
 
-        running_txn_t& running = it->second;
+        running_txn_t& running = it->second.running;
         if (running.executing) {
             log_error_m(c_error, args_wrong_k, "Transaction can't be modified concurrently.");
             return {};
         }
 
+        // Executing transactions can't be evicted
         running.executing = true;
         running.last_access = sys_clock_t::now();
-
-        // Update the heap order.
-        // With a single change shouldn't take more than `log2(n)` operations.
+        shard.idle_txns.erase(it->second.idle_it);
+        it->second.idle_it = shard.idle_txns.end();
         return running;
     }
 
     running_txn_t request_txn(session_id_t session_id, ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
-
-        auto it = client_to_txn_.find(session_id);
-        if (it != client_to_txn_.end()) {
-            log_error_m(c_error, args_wrong_k, "Such transaction is already running, just continue using it.");
-            return {};
+        {
+            sessions_shard_t& shard = this->shard(session_id);
+            std::unique_lock _ {shard.mutex};
+            if (shard.client_to_txn.count(session_id)) {
+                log_error_m(c_error, args_wrong_k, "Such transaction is already running, just continue using it.");
+                return {};
+            }
         }
 
         // Consider evicting some of the old sessions, if there are no more empty slots
-        if (free_txns_.empty() || free_arenas_.empty()) {
-            running_txn_t running = pop(c_error);
+        running_txn_t running {};
+        bool has_arena = free_arenas_.pop(running.arena);
+        bool has_txn = has_arena && free_txns_.pop(running.txn);
+        if (!has_txn) {
+            if (has_arena)
+                free_arenas_.push(running.arena);
+            running = pop(c_error);
             if (*c_error)
                 return {};
-            running.executing = true;
-            running.last_access = sys_clock_t::now();
-            return running;
         }
 
-        // If we have free slots
-        running_txn_t running {};
-        running.arena = free_arenas_.back();
-        running.txn = free_txns_.back();
         running.executing = true;
         running.last_access = sys_clock_t::now();
-        free_arenas_.pop_back();
-        free_txns_.pop_back();
         return running;
     }
 
     void hold_txn(session_id_t session_id, running_txn_t running_txn) noexcept {
-        std::unique_lock _ {mutex_};
-        submit(session_id, running_txn);
+        sessions_shard_t& shard = this->shard(session_id);
+        std::unique_lock _ {shard.mutex};
+        running_txn.executing = false;
+        auto [it, inserted] = shard.client_to_txn.try_emplace(session_id);
+        if (!inserted && it->second.idle_it != shard.idle_txns.end())
+            shard.idle_txns.erase(it->second.idle_it);
+        it->second.running = running_txn;
+        it->second.idle_it = shard.idle_txns.emplace(running_txn.last_access, session_id);
     }
 
     void release_txn(running_txn_t running_txn) noexcept {
-        std::unique_lock _ {mutex_};
-        free_arenas_.push_back(running_txn.arena);
-        free_txns_.push_back(running_txn.txn);
+        free_arenas_.push(running_txn.arena);
+        free_txns_.push(running_txn.txn);
     }
 
     void release_txn(session_id_t session_id) noexcept {
-        std::unique_lock _ {mutex_};
-        auto it = client_to_txn_.find(session_id);
-        if (it == client_to_txn_.end())
-            return;
-        it->second.executing = false;
-        free_arenas_.push_back(it->second.arena);
-        free_txns_.push_back(it->second.txn);
-        client_to_txn_.erase(it);
+        running_txn_t running;
+        {
+            sessions_shard_t& shard = this->shard(session_id);
+            std::unique_lock _ {shard.mutex};
+            auto it = shard.client_to_txn.find(session_id);
+            if (it == shard.client_to_txn.end())
+                return;
+            running = it->second.running;
+            shard.erase(it);
+        }
+        release_txn(running);
     }
 
     ustore_arena_t request_arena(ustore_error_t* c_error) noexcept {
-        std::unique_lock _ {mutex_};
-        // Consider evicting some of the old sessions, if there are no more empty slots
-        if (free_arenas_.empty()) {
-            running_txn_t running = pop(c_error);
-            if (*c_error)
-                return nullptr;
-            free_txns_.push_back(running.txn);
-            return running.arena;
-        }
+        ustore_arena_t arena = nullptr;
+        if (free_arenas_.pop(arena))
+            return arena;
 
-        ustore_arena_t arena = free_arenas_.back();
-        free_arenas_.pop_back();
-        return arena;
+        // Consider evicting some of the old sessions, if there are no more empty slots
+        running_txn_t running = pop(c_error);
+        if (*c_error)
+            return nullptr;
+        free_txns_.push(running.txn);
+        return running.arena;
     }
 
-    void release_arena(ustore_arena_t arena) noexcept {
-        std::unique_lock _ {mutex_};
-        free_arenas_.push_back(arena);
-    }
+    void release_arena(ustore_arena_t arena) noexcept { free_arenas_.push(arena); }
 
     session_lock_t lock(session_id_t id, ustore_error_t* c_error) noexcept {
         if (id.is_txn()) {
             running_txn_t running = continue_txn(id, c_error);
-            return {*this, id, running.txn, running.arena};
+            return {*this, id, running.txn, running.arena, !*c_error};
         }
-        else
-            return {*this, id, nullptr, request_arena(c_error)};
+        ustore_arena_t arena = request_arena(c_error);
+        return {*this, id, nullptr, arena, !*c_error};
     }
 };
 
 session_lock_t::~session_lock_t() noexcept {
+    // Failed locks own nothing, and must not return any handles to the pools
+    if (!is_locked)
+        return;
     if (is_txn())
         sessions.hold_txn( //
             session_id,
@@ -430,12 +590,29 @@ struct session_params_t {
     std::optional<std::string_view> collection_id;
     std::optional<std::string_view> collection_drop_mode;
     std::optional<std::string_view> read_part;
+    std::optional<std::string_view> hops;
+    std::optional<std::string_view> role;
+    std::optional<std::string_view> frontier_limit;
+    std::optional<std::string_view> dimensions;
+    std::optional<std::string_view> scalar_type;
+    std::optional<std::string_view> metric;
+    std::optional<std::string_view> metric_threshold;
+    std::optional<std::string_view> index_expansion;
+    std::optional<std::string_view> rerank_count;
+    std::optional<std::string_view> keys_min;
+    std::optional<std::string_view> keys_max;
+    std::optional<std::string_view> sequence;
+    std::optional<std::string_view> max_staleness;
 
     std::optional<std::string_view> opt_snapshot;
     std::optional<std::string_view> opt_flush;
+    std::optional<std::string_view> opt_merge;
     std::optional<std::string_view> opt_dont_watch;
     std::optional<std::string_view> opt_shared_memory;
     std::optional<std::string_view> opt_dont_discard_memory;
+    std::optional<std::string_view> opt_revisit;
+    std::optional<std::string_view> opt_conversions;
+    std::optional<std::string_view> opt_collisions;
 };
 
 session_params_t session_params(arf::ServerCallContext const& server_call, std::string_view uri) noexcept {
@@ -459,8 +636,25 @@ session_params_t session_params(arf::ServerCallContext const& server_call, std::
 
     result.collection_drop_mode = param_value(params, kParamDropMode);
     result.read_part = param_value(params, kParamReadPart);
+    result.hops = param_value(params, kParamHops);
+    result.role = param_value(params, kParamRole);
+    result.frontier_limit = param_value(params, kParamFrontierLimit);
+    result.opt_revisit = param_value(params, kParamFlagRevisit);
+    result.dimensions = param_value(params, kParamDimensions);
+    result.scalar_type = param_value(params, kParamScalarType);
+    result.metric = param_value(params, kParamMetric);
+    result.metric_threshold = param_value(params, kParamMetricThreshold);
+    result.index_expansion = param_value(params, kParamIndexExpansion);
+    result.rerank_count = param_value(params, kParamRerankCount);
+    result.keys_min = param_value(params, kParamKeysMin);
+    result.keys_max = param_value(params, kParamKeysMax);
+    result.sequence = param_value(params, kParamSequence);
+    result.max_staleness = param_value(params, kParamMaxStaleness);
+    result.opt_conversions = param_value(params, kParamFlagConversions);
+    result.opt_collisions = param_value(params, kParamFlagCollisions);
 
     result.opt_flush = param_value(params, kParamFlagFlushWrite);
+    result.opt_merge = param_value(params, kParamFlagMergeWrite);
     result.opt_dont_watch = param_value(params, kParamFlagDontWatch);
     result.opt_shared_memory = param_value(params, kParamFlagSharedMemRead);
 
@@ -476,8 +670,10 @@ ustore_options_t ustore_options(session_params_t const& params) noexcept {
         result = ustore_options_t(result | ustore_option_transaction_dont_watch_k);
     if (params.opt_flush)
         result = ustore_options_t(result | ustore_option_write_flush_k);
-    if (params.opt_shared_memory)
-        result = ustore_options_t(result | ustore_option_read_shared_memory_k);
+    if (params.opt_merge)
+        result = ustore_options_t(result | ustore_option_write_merge_k);
+    // The `opt_shared_memory` flag isn't forwarded, as only the reads, that explicitly
+    // support it, allocate their results in a separate shared memory arena.
     return result;
 }
 
@@ -491,6 +687,423 @@ ustore_str_view_t get_null_terminated(std::shared_ptr<ar::Buffer> const& buf_ptr
     return buf_ptr ? get_null_terminated(*buf_ptr) : nullptr;
 }
 
+/**
+ * @brief Kinds of changes, that a primary server ships to its replicas.
+ */
+enum class replicated_kind_t : std::uint8_t {
+    write_k = 0,
+    write_path_k = 1,
+    collection_create_k = 2,
+    collection_drop_k = 3,
+};
+
+/**
+ * @brief A single change of the primary server, with the `collection` identifier of the primary.
+ * Writes carry the `key` or the path in the `name`, collections carry the name and the config
+ * in the `value`, while missing values, marked with `present == false`, delete entries.
+ */
+struct replicated_entry_t {
+    std::uint64_t sequence = 0;
+    replicated_kind_t kind = replicated_kind_t::write_k;
+    ustore_drop_mode_t mode = ustore_drop_keys_vals_handle_k;
+    ustore_collection_t collection = ustore_collection_main_k;
+    ustore_key_t key = 0;
+    std::string name;
+    std::string value;
+    bool present = true;
+
+    std::size_t footprint() const noexcept { return sizeof(replicated_entry_t) + name.size() + value.size(); }
+};
+
+template <typename scalar_at>
+void append_scalar(std::string& output, scalar_at scalar) {
+    output.append(reinterpret_cast<char const*>(&scalar), sizeof(scalar_at));
+}
+
+template <typename scalar_at>
+bool consume_scalar(std::string_view& input, scalar_at& scalar) noexcept {
+    if (input.size() < sizeof(scalar_at))
+        return false;
+    std::memcpy(&scalar, input.data(), sizeof(scalar_at));
+    input.remove_prefix(sizeof(scalar_at));
+    return true;
+}
+
+bool consume_string(std::string_view& input, std::string& string, bool& present) {
+    std::uint32_t length = 0;
+    if (!consume_scalar(input, length))
+        return false;
+    present = length != std::numeric_limits<std::uint32_t>::max();
+    length = present ? length : 0;
+    if (input.size() < length)
+        return false;
+    string.assign(input.data(), length);
+    input.remove_prefix(length);
+    return true;
+}
+
+void export_entry(replicated_entry_t const& entry, std::string& output) {
+    append_scalar(output, entry.sequence);
+    append_scalar(output, static_cast<std::uint8_t>(entry.kind));
+    append_scalar(output, static_cast<std::uint8_t>(entry.mode));
+    append_scalar(output, entry.collection);
+    append_scalar(output, entry.key);
+    append_scalar(output, static_cast<std::uint32_t>(entry.name.size()));
+    output.append(entry.name);
+    append_scalar(output,
+                  entry.present ? static_cast<std::uint32_t>(entry.value.size())
+                                : std::numeric_limits<std::uint32_t>::max());
+    output.append(entry.value);
+}
+
+bool import_entry(std::string_view& input, replicated_entry_t& entry) {
+    std::uint8_t kind = 0, mode = 0;
+    bool has_name = true;
+    bool parsed = consume_scalar(input, entry.sequence) && consume_scalar(input, kind) &&
+                  consume_scalar(input, mode) && consume_scalar(input, entry.collection) &&
+                  consume_scalar(input, entry.key) && consume_string(input, entry.name, has_name) &&
+                  consume_string(input, entry.value, entry.present);
+    entry.kind = static_cast<replicated_kind_t>(kind);
+    entry.mode = static_cast<ustore_drop_mode_t>(mode);
+    return parsed && kind <= static_cast<std::uint8_t>(replicated_kind_t::collection_drop_k);
+}
+
+/// Replicas receive the log in parts of roughly this size.
+constexpr std::size_t replication_batch_bytes_k = 4 * 1024 * 1024;
+
+/**
+ * @brief Bounded in-memory log of the changes, applied to the primary, numbered in the order
+ * they were applied. Replicas poll it for the entries following the last one they have seen.
+ *
+ * The log is kept by the server, rather than the engines, so replicas work with every engine,
+ * even those without a write-ahead log. Writes of transactions are staged until their commit.
+ * Changes are ordered by holding `order()` over both the engine call and `append()`.
+ *
+ * The `epoch` is randomly chosen on every start, so replicas detect a restarted primary,
+ * and replicas, that fall behind the oldest retained entry, must be re-seeded from a backup.
+ */
+class replication_log_t {
+    std::uint64_t const epoch_;
+    std::size_t const capacity_bytes_;
+
+    std::mutex order_mutex_;
+    std::mutex mutex_;
+    std::deque<replicated_entry_t> entries_;
+    std::size_t bytes_ = 0;
+    std::uint64_t last_sequence_ = 0;
+    std::unordered_map<session_id_t, std::vector<replicated_entry_t>, session_id_hash_t> staged_;
+
+  public:
+    replication_log_t(std::size_t capacity_bytes)
+        : epoch_(std::random_device {}() | (std::uint64_t(std::random_device {}()) << 32) | 1u),
+          capacity_bytes_(capacity_bytes) {}
+
+    std::uint64_t epoch() const noexcept { return epoch_; }
+    std::unique_lock<std::mutex> order() noexcept { return std::unique_lock<std::mutex> {order_mutex_}; }
+
+    void append(std::vector<replicated_entry_t>& entries) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (replicated_entry_t& entry : entries) {
+            entry.sequence = ++last_sequence_;
+            bytes_ += entry.footprint();
+            entries_.push_back(std::move(entry));
+        }
+        while (bytes_ > capacity_bytes_ && entries_.size() > 1) {
+            bytes_ -= entries_.front().footprint();
+            entries_.pop_front();
+        }
+    }
+
+    void stage(session_id_t session_id, std::vector<replicated_entry_t>& entries) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& staged = staged_[session_id];
+        std::move(entries.begin(), entries.end(), std::back_inserter(staged));
+    }
+
+    void discard(session_id_t session_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        staged_.erase(session_id);
+    }
+
+    /**
+     * @brief Moves the writes of a committed transaction into the log.
+     * Must be called under `order()`, held since before the commit.
+     */
+    void commit(session_id_t session_id) {
+        std::vector<replicated_entry_t> entries;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = staged_.find(session_id);
+            if (it == staged_.end())
+                return;
+            entries = std::move(it->second);
+            staged_.erase(it);
+        }
+        append(entries);
+    }
+
+    /**
+     * @brief Exports the header with the epoch, the first and the last retained sequence numbers,
+     * the `preamble` entries, and then the entries after the `sequence`, until their size exceeds `limit_bytes`.
+     */
+    void export_since(std::uint64_t sequence,
+                      std::size_t limit_bytes,
+                      std::string_view preamble,
+                      std::string& output) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uint64_t const first_sequence = entries_.empty() ? last_sequence_ + 1 : entries_.front().sequence;
+        append_scalar(output, epoch_);
+        append_scalar(output, first_sequence);
+        append_scalar(output, last_sequence_);
+        output.append(preamble);
+        if (sequence + 1 < first_sequence || sequence >= last_sequence_)
+            return;
+        for (auto it = entries_.begin() + (sequence + 1 - first_sequence);
+             it != entries_.end() && output.size() < limit_bytes;
+             ++it)
+            export_entry(*it, output);
+    }
+};
+
+/**
+ * @brief Keeps a replica up to date with its primary, polling the primary for
+ * the changes in the background and applying them to the local database.
+ * The identifiers of collections differ between servers, so they are matched by names.
+ */
+class replica_follower_t {
+    ustore_database_t db_ = nullptr;
+    std::unique_ptr<arf::FlightClient> primary_;
+    std::chrono::milliseconds interval_;
+
+    std::uint64_t epoch_ = 0;
+    std::uint64_t sequence_ = 0;
+    std::unordered_map<ustore_collection_t, ustore_collection_t> collections_;
+
+    bool diverged_ = false;
+    std::atomic<sys_clock_t::rep> synced_ {0};
+    std::atomic<bool> stopping_ {false};
+    std::thread thread_;
+
+    ustore_collection_t local_collection(replicated_entry_t const& entry, ustore_error_t* c_error) {
+        ustore_arena_t arena = nullptr;
+        ustore_size_t count = 0;
+        ustore_collection_t* ids = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_str_span_t names = nullptr;
+        ustore_collection_list_t list {};
+        list.db = db_;
+        list.error = c_error;
+        list.arena = &arena;
+        list.count = &count;
+        list.ids = &ids;
+        list.offsets = &offsets;
+        list.names = &names;
+        ustore_collection_list(&list);
+
+        ustore_collection_t id = ustore_collection_main_k;
+        bool found = false;
+        for (std::size_t i = 0; !*c_error && i != count && !found; ++i)
+            if (std::string_view(names + offsets[i], offsets[i + 1] - offsets[i]) == entry.name)
+                id = ids[i], found = true;
+        ustore_arena_free(arena);
+        if (*c_error || found)
+            return id;
+
+        ustore_collection_create_t create {};
+        create.db = db_;
+        create.error = c_error;
+        create.name = entry.name.c_str();
+        create.config = entry.present && !entry.value.empty() ? entry.value.c_str() : nullptr;
+        create.id = &id;
+        ustore_collection_create(&create);
+        return id;
+    }
+
+    /**
+     * @brief Applies a run of plain writes with a single batched call.
+     */
+    void apply_writes(std::vector<replicated_entry_t> const& entries, ustore_error_t* c_error) {
+        std::vector<ustore_collection_t> collections(entries.size());
+        std::vector<ustore_key_t> keys(entries.size());
+        std::vector<ustore_bytes_cptr_t> values(entries.size());
+        std::vector<ustore_length_t> lengths(entries.size());
+        for (std::size_t i = 0; i != entries.size(); ++i) {
+            auto it = collections_.find(entries[i].collection);
+            return_error_if_m(entries[i].collection == ustore_collection_main_k || it != collections_.end(),
+                              c_error,
+                              consistency_k,
+                              "Replicated write into an unknown collection");
+            collections[i] = entries[i].collection == ustore_collection_main_k ? ustore_collection_main_k : it->second;
+            keys[i] = entries[i].key;
+            values[i] = reinterpret_cast<ustore_bytes_cptr_t>(entries[i].value.data());
+            lengths[i] = entries[i].present ? static_cast<ustore_length_t>(entries[i].value.size())
+                                            : ustore_length_missing_k;
+        }
+
+        ustore_arena_t arena = nullptr;
+        ustore_write_t write {};
+        write.db = db_;
+        write.error = c_error;
+        write.arena = &arena;
+        write.tasks_count = entries.size();
+        write.collections = collections.data();
+        write.collections_stride = sizeof(ustore_collection_t);
+        write.keys = keys.data();
+        write.keys_stride = sizeof(ustore_key_t);
+        write.values = values.data();
+        write.values_stride = sizeof(ustore_bytes_cptr_t);
+        write.lengths = lengths.data();
+        write.lengths_stride = sizeof(ustore_length_t);
+        ustore_write(&write);
+        ustore_arena_free(arena);
+    }
+
+    void apply(replicated_entry_t const& entry, ustore_error_t* c_error) {
+        switch (entry.kind) {
+        case replicated_kind_t::collection_create_k: {
+            ustore_collection_t id = local_collection(entry, c_error);
+            if (!*c_error)
+                collections_[entry.collection] = id;
+            break;
+        }
+        case replicated_kind_t::collection_drop_k: {
+            auto it = collections_.find(entry.collection);
+            if (entry.collection != ustore_collection_main_k && it == collections_.end())
+                break;
+            ustore_collection_drop_t drop {};
+            drop.db = db_;
+            drop.error = c_error;
+            drop.id = entry.collection == ustore_collection_main_k ? ustore_collection_main_k : it->second;
+            drop.mode = entry.mode;
+            ustore_collection_drop(&drop);
+            if (!*c_error && entry.mode == ustore_drop_keys_vals_handle_k && it != collections_.end())
+                collections_.erase(it);
+            break;
+        }
+        case replicated_kind_t::write_path_k: {
+            auto it = collections_.find(entry.collection);
+            ustore_collection_t collection = entry.collection;
+            if (collection != ustore_collection_main_k) {
+                return_error_if_m(it != collections_.end(),
+                                  c_error,
+                                  consistency_k,
+                                  "Replicated write into an unknown collection");
+                collection = it->second;
+            }
+            ustore_str_view_t path = entry.name.c_str();
+            ustore_bytes_cptr_t value = reinterpret_cast<ustore_bytes_cptr_t>(entry.value.data());
+            ustore_length_t length =
+                entry.present ? static_cast<ustore_length_t>(entry.value.size()) : ustore_length_missing_k;
+            ustore_arena_t arena = nullptr;
+            ustore_paths_write_t write {};
+            write.db = db_;
+            write.error = c_error;
+            write.arena = &arena;
+            write.tasks_count = 1;
+            write.collections = &collection;
+            write.paths = &path;
+            write.values_bytes = &value;
+            write.values_lengths = &length;
+            ustore_paths_write(&write);
+            ustore_arena_free(arena);
+            break;
+        }
+        default: break;
+        }
+    }
+
+    /**
+     * @brief Fetches and applies the next part of the log,
+     * reporting if the replica has `caught_up` with the primary.
+     */
+    void poll(bool& caught_up, ustore_error_t* c_error) {
+        arf::Action action;
+        fmt::format_to(std::back_inserter(action.type), "{}?{}={}", kFlightReplicate, kParamSequence, sequence_);
+        ar::Result<std::unique_ptr<arf::ResultStream>> maybe_stream = primary_->DoAction(action);
+        return_error_if_m(maybe_stream.ok(), c_error, network_k, "Failed to reach the primary");
+        ar::Result<std::unique_ptr<arf::Result>> maybe_result = maybe_stream.ValueUnsafe()->Next();
+        return_error_if_m(maybe_result.ok() && maybe_result.ValueUnsafe(), c_error, network_k, "No response received");
+
+        std::shared_ptr<ar::Buffer> const& body = maybe_result.ValueUnsafe()->body;
+        std::string_view input {reinterpret_cast<char const*>(body->data()), static_cast<std::size_t>(body->size())};
+        std::uint64_t epoch = 0, first_sequence = 0, last_sequence = 0;
+        bool parsed = consume_scalar(input, epoch) && consume_scalar(input, first_sequence) &&
+                      consume_scalar(input, last_sequence);
+        return_error_if_m(parsed, c_error, network_k, "Inadequate response");
+
+        // A restarted primary numbers its changes from scratch
+        diverged_ = (epoch_ && epoch_ != epoch) || (sequence_ + 1 < first_sequence && sequence_ < last_sequence);
+        return_error_if_m(!diverged_, c_error, consistency_k, "Replica diverged from the primary, re-seed it");
+        epoch_ = epoch;
+
+        // Consecutive writes are batched, until other kinds of changes break the run
+        std::vector<replicated_entry_t> writes;
+        auto flush_writes = [&] {
+            if (writes.empty())
+                return;
+            apply_writes(writes, c_error);
+            if (!*c_error)
+                sequence_ = std::max(sequence_, writes.back().sequence);
+            writes.clear();
+        };
+
+        replicated_entry_t entry;
+        while (!input.empty()) {
+            return_error_if_m(import_entry(input, entry), c_error, network_k, "Inadequate response");
+            if (entry.kind == replicated_kind_t::write_k) {
+                writes.push_back(std::move(entry));
+                continue;
+            }
+            flush_writes();
+            return_if_error_m(c_error);
+            apply(entry, c_error);
+            return_if_error_m(c_error);
+            sequence_ = std::max(sequence_, entry.sequence);
+        }
+        flush_writes();
+        return_if_error_m(c_error);
+        caught_up = sequence_ >= last_sequence;
+    }
+
+    void follow() {
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            status_t status;
+            bool caught_up = false;
+            poll(caught_up, status.member_ptr());
+            if (caught_up)
+                synced_.store(sys_clock_t::now().time_since_epoch().count(), std::memory_order_relaxed);
+            if (!status) {
+                log_warning_m("Replication failed: %s\n", status.message());
+                if (diverged_)
+                    return;
+            }
+            if (caught_up || !status)
+                std::this_thread::sleep_for(interval_);
+        }
+    }
+
+  public:
+    replica_follower_t(ustore_database_t db,
+                       std::unique_ptr<arf::FlightClient> primary,
+                       std::chrono::milliseconds interval)
+        : db_(db), primary_(std::move(primary)), interval_(interval) {
+        thread_ = std::thread([this] { follow(); });
+    }
+
+    ~replica_follower_t() noexcept {
+        stopping_.store(true, std::memory_order_relaxed);
+        thread_.join();
+    }
+
+    /**
+     * @brief Time passed since the replica has last seen the end of the log of the primary.
+     */
+    std::chrono::milliseconds staleness() const noexcept {
+        sys_time_t synced {sys_clock_t::duration {synced_.load(std::memory_order_relaxed)}};
+        return std::chrono::duration_cast<std::chrono::milliseconds>(sys_clock_t::now() - synced);
+    }
+};
+
 /**
  * @brief Remote Procedure Call implementation on top of Apache Arrow Flight RPC.
  * Currently only implements only the binary interface, which is enough even for
@@ -500,12 +1113,30 @@ ustore_str_view_t get_null_terminated(std::shared_ptr<ar::Buffer> const& buf_ptr
  * ## Endpoints
  *
  * - write?col=x&txn=y&lengths&watch&shared (DoPut)
- * - read?col=x&txn=y&flush (DoExchange)
+ * - read?col=x&txn=y&flush&shared (DoExchange)
+ *   With `shared` the content is left in a shared memory segment, and only its name is sent.
+ * - graph_traverse?col=x&txn=y&hops=h&role=r&frontier_limit=n&revisit (DoExchange)
+ * - vectors_search?col=x&txn=y&dimensions=d&scalar_type=s&metric=m&... (DoExchange)
+ *   Payload metadata: Optional allow-list of keys.
+ * - docs_gather?col=x&txn=y&conversions&collisions (DoExchange)
+ *   Payload metadata: Requested fields, each as a type byte and a NULL-terminated name.
+ *   An entry with the `null` type byte carries a filter instead of a field. Only the matching
+ *   documents are exported then, followed by a column with their indexes in the inputs.
  * - collection_upsert?col=x (DoAction): Returns collection ID
  *   Payload buffer: Collection opening config.
  * - collection_remove?col=x (DoAction): Drops a collection
  * - txn_begin?txn=y (DoAction): Starts a transaction with a potentially custom ID
  * - txn_commit?txn=y (DoAction): Commits a transaction with a given ID
+ * - control (DoAction): Returns the response of `ustore_database_control` to the request
+ *   Payload buffer: Request, like "usage", "metrics" or "metrics.prometheus".
+ * - replicate?sequence=n (DoAction): Returns the changes, that followed the given one
+ *   Payload buffer: Replication log header and entries, serialized by `export_entry`.
+ *
+ * ## Replication
+ *
+ * A primary, started with a replication log, records every change it applies. Replicas
+ * poll it, apply the changes in the same order, and reject writes from clients.
+ * Reads with `max_staleness=ms` fail on replicas, that haven't caught up in that time.
  *
  * ## Concurrency
  *
@@ -515,15 +1146,49 @@ ustore_str_view_t get_null_terminated(std::shared_ptr<ar::Buffer> const& buf_ptr
 class UStoreService : public arf::FlightServerBase {
     database_t db_;
     sessions_t sessions_;
+    std::unique_ptr<replication_log_t> replication_log_;
+    std::unique_ptr<replica_follower_t> follower_;
+
+    /// Shared memory segments, handed off to clients, that are expected to unlink them.
+    /// If the client disappears, the segment is unlinked on its behalf after a timeout.
+    std::deque<std::pair<sys_time_t, std::string>> handed_off_segments_;
+    std::mutex handed_off_segments_lock_;
+    std::chrono::milliseconds handed_off_timeout_ {30'000};
 
   public:
     UStoreService(database_t&& db, std::size_t capacity = 4096) : db_(std::move(db)), sessions_(db_, capacity) {}
+    ~UStoreService() noexcept {
+        follower_.reset();
+        for (auto const& [handed_off_time, name] : handed_off_segments_)
+            shm_unlink(name.c_str());
+    }
+
+    /**
+     * @brief Makes this server a primary, retaining up to `capacity_bytes` of changes for the replicas.
+     */
+    void record_changes(std::size_t capacity_bytes) {
+        replication_log_ = std::make_unique<replication_log_t>(capacity_bytes);
+    }
+
+    /**
+     * @brief Makes this server a read-only replica of the `primary`, polled every `interval`.
+     */
+    void follow(std::unique_ptr<arf::FlightClient> primary, std::chrono::milliseconds interval) {
+        follower_ = std::make_unique<replica_follower_t>(db_, std::move(primary), interval);
+    }
 
     ar::Status ListActions( //
         arf::ServerCallContext const&,
         std::vector<arf::ActionType>* actions) override {
         *actions =
-            {kActionColOpen, kActionColDrop, kActionSnapOpen, kActionSnapDrop, kActionTxnBegin, kActionTxnCommit};
+            {kActionColOpen,
+             kActionColDrop,
+             kActionSnapOpen,
+             kActionSnapDrop,
+             kActionTxnBegin,
+             kActionTxnCommit,
+             kActionControl,
+             kActionReplicate};
         return ar::Status::OK();
     }
 
@@ -580,9 +1245,24 @@ class UStoreService : public arf::FlightServerBase {
             collection_init.config = collection_config;
             collection_init.id = &collection_id;
 
+            // Replicas only list the collections, created by the primary
+            if (follower_)
+                return ar::Status::Invalid("Replicas are read-only");
+
+            std::unique_lock<std::mutex> order;
+            if (replication_log_)
+                order = replication_log_->order();
             ustore_collection_create(&collection_init);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            if (replication_log_) {
+                std::vector<replicated_entry_t> entries(1);
+                entries[0].kind = replicated_kind_t::collection_create_k;
+                entries[0].collection = collection_id;
+                entries[0].name = collection_init.name;
+                entries[0].value = collection_config ? collection_config : "";
+                replication_log_->append(entries);
+            }
 
             *results_ptr = return_scalar<ustore_collection_t>(collection_id);
             return ar::Status::OK();
@@ -610,9 +1290,21 @@ class UStoreService : public arf::FlightServerBase {
             collection_drop.id = c_collection_id;
             collection_drop.mode = mode;
 
+            if (follower_)
+                return ar::Status::Invalid("Replicas are read-only");
+            std::unique_lock<std::mutex> order;
+            if (replication_log_)
+                order = replication_log_->order();
             ustore_collection_drop(&collection_drop);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            if (replication_log_) {
+                std::vector<replicated_entry_t> entries(1);
+                entries[0].kind = replicated_kind_t::collection_drop_k;
+                entries[0].collection = c_collection_id;
+                entries[0].mode = mode;
+                replication_log_->append(entries);
+            }
             *results_ptr = return_empty();
             return ar::Status::OK();
         }
@@ -678,10 +1370,14 @@ class UStoreService : public arf::FlightServerBase {
 
             ustore_transaction_init(&txn_init);
             if (!status) {
-                sessions_.release_txn(params.session_id);
+                sessions_.release_txn(session);
                 return ar::Status::ExecutionError(status.message());
             }
 
+            // Writes, staged by a previous use of the same transaction, are abandoned
+            if (replication_log_)
+                replication_log_->discard(params.session_id);
+
             // Don't forget to add the transaction to active sessions
             sessions_.hold_txn(params.session_id, session);
             *results_ptr = return_scalar<txn_id_t>(params.session_id.txn_id);
@@ -704,7 +1400,12 @@ class UStoreService : public arf::FlightServerBase {
             txn_commit.transaction = session.txn;
             txn_commit.options = ustore_options(params);
 
+            std::unique_lock<std::mutex> order;
+            if (replication_log_)
+                order = replication_log_->order();
             ustore_transaction_commit(&txn_commit);
+            if (replication_log_)
+                status ? replication_log_->commit(params.session_id) : replication_log_->discard(params.session_id);
             if (!status) {
                 sessions_.release_txn(params.session_id);
                 return ar::Status::ExecutionError(status.message());
@@ -715,6 +1416,48 @@ class UStoreService : public arf::FlightServerBase {
             return ar::Status::OK();
         }
 
+        // Free-form requests, like exporting the metrics for Prometheus
+        if (is_query(action.type, kActionControl.type)) {
+            if (!action.body)
+                return ar::Status::Invalid("Missing control request");
+
+            std::string request = action.body->ToString();
+            ustore_str_view_t response = nullptr;
+            ustore_arena_t arena = nullptr;
+            ustore_database_control_t control {};
+            control.db = db_;
+            control.arena = &arena;
+            control.error = status.member_ptr();
+            control.request = request.c_str();
+            control.response = &response;
+
+            // The response is copied out, before the arena is released
+            ustore_database_control(&control);
+            if (status)
+                *results_ptr = return_string(response ? response : "");
+            ustore_arena_free(arena);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            return ar::Status::OK();
+        }
+
+        // Shipping the changes to a replica
+        if (is_query(action.type, kActionReplicate.type)) {
+            if (!replication_log_)
+                return ar::Status::NotImplemented("Replication log is disabled");
+
+            // New replicas learn about the existing collections before any writes into them
+            std::uint64_t sequence = parse_count(params.sequence);
+            std::string collections;
+            if (sequence == 0)
+                if (ar::Status ar_status = export_collections(collections); !ar_status.ok())
+                    return ar_status;
+            std::string exported;
+            replication_log_->export_since(sequence, replication_batch_bytes_k, collections, exported);
+            *results_ptr = return_string(exported);
+            return ar::Status::OK();
+        }
+
         return ar::Status::NotImplemented("Unknown action type: ", action.type);
     }
 
@@ -730,74 +1473,384 @@ class UStoreService : public arf::FlightServerBase {
         session_params_t params = session_params(server_call, desc.cmd);
         status_t status;
 
-        ArrowSchema input_schema_c, output_schema_c;
-        ArrowArray input_batch_c, output_batch_c;
-        if (ar_status = unpack_table(request.ToTable(), input_schema_c, input_batch_c); !ar_status.ok())
-            return ar_status;
+        if (follower_ && params.max_staleness &&
+            follower_->staleness() > std::chrono::milliseconds(parse_count(params.max_staleness)))
+            return ar::Status::IOError("Replica is staler than requested");
 
-        bool is_empty_values = false;
+        // Reserve resources for the execution of this request
+        auto session = sessions_.lock(params.session_id, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
 
-        /// @param `collections`
-        ustore_collection_t c_collection_id = ustore_collection_main_k;
-        strided_iterator_gt<ustore_collection_t> input_collections;
-        if (params.collection_id) {
-            c_collection_id = parse_u64_hex(*params.collection_id, ustore_collection_main_k);
-            input_collections = strided_iterator_gt<ustore_collection_t> {&c_collection_id};
+        // Every incoming batch is answered with a batch of results as soon as it arrives,
+        // so the memory usage is bounded by the size of a batch, rather than the whole stream.
+        // An empty stream is still answered with an empty batch, to pass the schema.
+        // Arguments, that don't fit into columns, arrive as the metadata of the first batch.
+        bool is_response_started = false;
+        std::shared_ptr<ar::Buffer> metadata;
+        auto respond = [&](ar::RecordBatch const& input) {
+            std::shared_ptr<ar::RecordBatch> output;
+            ar::Status batch_status = exchange_batch(desc, params, session, input, metadata.get(), output);
+            if (batch_status.ok() && !is_response_started)
+                batch_status = response.Begin(output->schema());
+            is_response_started = true;
+            return batch_status.ok() ? response.WriteRecordBatch(*output) : batch_status;
+        };
+
+        while (true) {
+            ar::Result<arf::FlightStreamChunk> maybe_chunk = request.Next();
+            if (!maybe_chunk.ok())
+                return maybe_chunk.status();
+            std::shared_ptr<ar::RecordBatch> const& input = maybe_chunk->data;
+            if (!input)
+                break;
+            if (maybe_chunk->app_metadata)
+                metadata = maybe_chunk->app_metadata;
+            if (ar_status = respond(*input); !ar_status.ok())
+                return ar_status;
         }
-        else
-            input_collections = get_collections(input_schema_c, input_batch_c, kArgCols);
 
-        ustore_snapshot_t c_snapshot_id = 0;
-        if (params.snapshot_id)
-            c_snapshot_id = parse_snap_id(*params.snapshot_id);
+        if (!is_response_started) {
+            ar::Result<std::shared_ptr<ar::Schema>> maybe_schema = request.GetSchema();
+            if (!maybe_schema.ok())
+                return maybe_schema.status();
+            ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_empty = ar::RecordBatch::MakeEmpty(*maybe_schema);
+            if (!maybe_empty.ok())
+                return maybe_empty.status();
+            if (ar_status = respond(**maybe_empty); !ar_status.ok())
+                return ar_status;
+        }
 
-        // Reserve resources for the execution of this request
+        return response.Close();
+    }
+
+    ar::Status DoPut( //
+        arf::ServerCallContext const& server_call,
+        std::unique_ptr<arf::FlightMessageReader> request_ptr,
+        std::unique_ptr<arf::FlightMetadataWriter> response_ptr) override {
+
+        ar::Status ar_status;
+        arf::FlightMessageReader& request = *request_ptr;
+        arf::FlightDescriptor const& desc = request.descriptor();
+        session_params_t params = session_params(server_call, desc.cmd);
+        status_t status;
+
+        if (follower_)
+            return ar::Status::Invalid("Replicas are read-only");
         auto session = sessions_.lock(params.session_id, status.member_ptr());
         if (!status)
             return ar::Status::ExecutionError(status.message());
 
-        if (is_query(desc.cmd, kFlightRead)) {
+        // Batches are written as they arrive, overlapping the work with the upload
+        while (true) {
+            ar::Result<arf::FlightStreamChunk> maybe_chunk = request.Next();
+            if (!maybe_chunk.ok())
+                return maybe_chunk.status();
+            std::shared_ptr<ar::RecordBatch> const& input = maybe_chunk->data;
+            if (!input)
+                break;
+            if (ar_status = put_batch(desc, params, session, *input); !ar_status.ok())
+                return ar_status;
+        }
+        return ar::Status::OK();
+    }
 
-            /// @param `keys`
-            auto input_keys = get_keys(input_schema_c, input_batch_c, kArgKeys);
-            if (!input_keys)
-                return ar::Status::Invalid("Keys must have been provided for reads");
+    ar::Status DoGet( //
+        arf::ServerCallContext const& server_call,
+        arf::Ticket const& ticket,
+        std::unique_ptr<arf::FlightDataStream>* response_ptr) override {
 
-            bool const request_only_presences = params.read_part == kParamReadPartPresences;
-            bool const request_only_lengths = params.read_part == kParamReadPartLengths;
-            bool const request_content = !request_only_lengths && !request_only_presences;
+        ar::Status ar_status;
+        session_params_t params = session_params(server_call, ticket.ticket);
+        status_t status;
+
+        if (is_query(ticket.ticket, kFlightListCols)) {
 
+            // We will need some temporary memory for exports
+            auto session = sessions_.lock(params.session_id, status.member_ptr());
             if (!status)
                 return ar::Status::ExecutionError(status.message());
 
-            // As we are immediately exporting in the Arrow format,
-            // we don't need the lengths, just the NULL indicators
-            ustore_bytes_ptr_t found_values = nullptr;
-            ustore_length_t* found_offsets = nullptr;
-            ustore_length_t* found_lengths = nullptr;
-            ustore_octet_t* found_presences = nullptr;
-            ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
-            ustore_read_t read {};
-            read.db = db_;
-            read.error = status.member_ptr();
-            read.transaction = session.txn;
-            read.snapshot = c_snapshot_id;
-            read.arena = &session.arena;
-            read.options = ustore_options(params);
-            read.tasks_count = tasks_count;
-            read.collections = input_collections.get();
-            read.collections_stride = input_collections.stride();
-            read.keys = input_keys.get();
-            read.keys_stride = input_keys.stride();
-            read.presences = &found_presences;
-            read.offsets = request_content ? &found_offsets : nullptr;
-            read.lengths = request_only_lengths ? &found_lengths : nullptr;
-            read.values = request_content ? &found_values : nullptr;
-
-            ustore_read(&read);
+            ustore_size_t count = 0;
+            ustore_collection_t* collections = nullptr;
+            ustore_length_t* offsets = nullptr;
+            ustore_str_span_t names = nullptr;
+            ustore_collection_list_t collection_list {};
+            collection_list.db = db_;
+            collection_list.error = status.member_ptr();
+            collection_list.transaction = session.txn;
+            collection_list.snapshot = {}; // TODO
+            collection_list.arena = &session.arena;
+            collection_list.options = ustore_options(params);
+            collection_list.count = &count;
+            collection_list.ids = &collections;
+            collection_list.offsets = &offsets;
+            collection_list.names = &names;
+
+            ustore_collection_list(&collection_list);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Pack two columns into a Table
+            ArrowSchema schema_c;
+            ArrowArray array_c;
+            ustore_to_arrow_schema(count, 2, &schema_c, &array_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_column( //
+                count,
+                kArgCols.c_str(),
+                ustore_doc_field<ustore_collection_t>(),
+                nullptr,
+                nullptr,
+                ustore_bytes_ptr_t(collections),
+                schema_c.children[0],
+                array_c.children[0],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_column( //
+                count,
+                kArgNames.c_str(),
+                ustore_doc_field_str_k,
+                nullptr,
+                offsets,
+                ustore_bytes_ptr_t(names),
+                schema_c.children[1],
+                array_c.children[1],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            auto maybe_batch = ar::ImportRecordBatch(&array_c, &schema_c);
+            if (!maybe_batch.ok())
+                return maybe_batch.status();
+
+            auto batch = maybe_batch.ValueUnsafe();
+            auto maybe_reader = ar::RecordBatchReader::Make({batch});
+            if (!maybe_reader.ok())
+                return maybe_reader.status();
+
+            // TODO: Pass right IPC options
+            auto stream = std::make_unique<arf::RecordBatchStream>(maybe_reader.ValueUnsafe());
+            *response_ptr = std::move(stream);
+            return ar::Status::OK();
+        }
+        else if (is_query(ticket.ticket, kFlightListSnap)) {
+            // We will need some temporary memory for exports
+            auto session = sessions_.lock(params.session_id, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_size_t count = 0;
+            ustore_snapshot_t* snapshots = nullptr;
+            ustore_snapshot_list_t snapshots_list;
+            snapshots_list.db = db_;
+            snapshots_list.error = status.member_ptr();
+            snapshots_list.arena = &session.arena;
+            snapshots_list.options = ustore_options(params);
+            snapshots_list.count = &count;
+            snapshots_list.ids = &snapshots;
+
+            ustore_snapshot_list(&snapshots_list);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            if (count == 0)
+                return ar::Status::OK();
+
+            // Pack two columns into a Table
+            ArrowSchema schema_c;
+            ArrowArray array_c;
+            ustore_to_arrow_schema(count, 2, &schema_c, &array_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_column( //
+                count,
+                kArgSnaps.c_str(),
+                ustore_doc_field<ustore_snapshot_t>(),
+                nullptr,
+                nullptr,
+                ustore_bytes_ptr_t(snapshots),
+                schema_c.children[0],
+                array_c.children[0],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            auto maybe_batch = ar::ImportRecordBatch(&array_c, &schema_c);
+            if (!maybe_batch.ok())
+                return maybe_batch.status();
+
+            auto batch = maybe_batch.ValueUnsafe();
+            auto maybe_reader = ar::RecordBatchReader::Make({batch});
+            if (!maybe_reader.ok())
+                return maybe_reader.status();
+
+            // TODO: Pass right IPC options
+            auto stream = std::make_unique<arf::RecordBatchStream>(maybe_reader.ValueUnsafe());
+            *response_ptr = std::move(stream);
+            return ar::Status::OK();
+        }
+        return ar::Status::OK();
+    }
+
+  private:
+    /**
+     * @brief Exports every existing collection as a change without a sequence number,
+     * so that a new replica learns about the collections, created before the log.
+     */
+    ar::Status export_collections(std::string& exported) {
+        status_t status;
+        ustore_arena_t arena = nullptr;
+        ustore_size_t count = 0;
+        ustore_collection_t* ids = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_str_span_t names = nullptr;
+        ustore_collection_list_t collection_list {};
+        collection_list.db = db_;
+        collection_list.error = status.member_ptr();
+        collection_list.arena = &arena;
+        collection_list.count = &count;
+        collection_list.ids = &ids;
+        collection_list.offsets = &offsets;
+        collection_list.names = &names;
+        ustore_collection_list(&collection_list);
+
+        replicated_entry_t entry;
+        entry.kind = replicated_kind_t::collection_create_k;
+        for (std::size_t i = 0; status && i != count; ++i) {
+            entry.collection = ids[i];
+            entry.name.assign(names + offsets[i], offsets[i + 1] - offsets[i]);
+            export_entry(entry, exported);
+        }
+        ustore_arena_free(arena);
+        return status ? ar::Status::OK() : ar::Status::ExecutionError(status.message());
+    }
+
+    /**
+     * @brief Logs the writes for the replicas, once they are applied, or staged in a transaction.
+     */
+    void record_changes(session_lock_t const& session, std::vector<replicated_entry_t>& entries) {
+        if (!replication_log_)
+            return;
+        if (session.is_txn())
+            replication_log_->stage(session.session_id, entries);
+        else
+            replication_log_->append(entries);
+    }
+
+    /**
+     * @brief Executes a `DoExchange` query for one batch of arguments.
+     * Results reference the memory of the `session` until its next operation.
+     * The `metadata` holds the arguments, that don't have one entry per row, if any.
+     */
+    ar::Status exchange_batch(arf::FlightDescriptor const& desc,
+                              session_params_t const& params,
+                              session_lock_t& session,
+                              ar::RecordBatch const& input,
+                              ar::Buffer const* metadata,
+                              std::shared_ptr<ar::RecordBatch>& output) {
+
+        status_t status;
+        ArrowSchema input_schema_c, output_schema_c;
+        ArrowArray input_batch_c, output_batch_c;
+        ar::Status ar_status = ar::ExportRecordBatch(input, &input_batch_c, &input_schema_c);
+        if (!ar_status.ok())
+            return ar_status;
+        exported_batch_t exported_input {input_schema_c, input_batch_c};
+
+        bool is_empty_values = false;
+
+        /// @param `collections`
+        ustore_collection_t c_collection_id = ustore_collection_main_k;
+        strided_iterator_gt<ustore_collection_t> input_collections;
+        if (params.collection_id) {
+            c_collection_id = parse_u64_hex(*params.collection_id, ustore_collection_main_k);
+            input_collections = strided_iterator_gt<ustore_collection_t> {&c_collection_id};
+        }
+        else
+            input_collections = get_collections(input_schema_c, input_batch_c, kArgCols);
+
+        ustore_snapshot_t c_snapshot_id = 0;
+        if (params.snapshot_id)
+            c_snapshot_id = parse_snap_id(*params.snapshot_id);
+
+        if (is_query(desc.cmd, kFlightRead)) {
+
+            /// @param `keys`
+            auto input_keys = get_keys(input_schema_c, input_batch_c, kArgKeys);
+            if (!input_keys)
+                return ar::Status::Invalid("Keys must have been provided for reads");
+
+            /// @param `slice_starts`, `slice_lengths`
+            auto input_slices_starts = get_lengths(input_schema_c, input_batch_c, kArgSliceStarts);
+            auto input_slices_lengths = get_lengths(input_schema_c, input_batch_c, kArgSliceLengths);
+
+            bool const request_only_presences = params.read_part == kParamReadPartPresences;
+            bool const request_only_lengths = params.read_part == kParamReadPartLengths;
+            bool const request_content = !request_only_lengths && !request_only_presences;
+
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Clients on the same host may map the results instead of receiving them,
+            // so those are allocated in a separate arena of named shared memory segments
+            bool const request_shared = request_content && params.opt_shared_memory;
+            arena_t shared_arena(db_);
+
+            // As we are immediately exporting in the Arrow format,
+            // we don't need the lengths, just the NULL indicators
+            ustore_bytes_ptr_t found_values = nullptr;
+            ustore_length_t* found_offsets = nullptr;
+            ustore_length_t* found_lengths = nullptr;
+            ustore_octet_t* found_presences = nullptr;
+            ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
+            ustore_read_t read {};
+            read.db = db_;
+            read.error = status.member_ptr();
+            read.transaction = session.txn;
+            read.snapshot = c_snapshot_id;
+            read.arena = request_shared ? shared_arena.member_ptr() : &session.arena;
+            read.options = request_shared //
+                               ? ustore_options_t(ustore_options(params) | ustore_option_read_shared_memory_k)
+                               : ustore_options(params);
+            read.tasks_count = tasks_count;
+            read.collections = input_collections.get();
+            read.collections_stride = input_collections.stride();
+            read.keys = input_keys.get();
+            read.keys_stride = input_keys.stride();
+            read.slices_starts = input_slices_starts.get();
+            read.slices_starts_stride = input_slices_starts.stride();
+            read.slices_lengths = input_slices_lengths.get();
+            read.slices_lengths_stride = input_slices_lengths.stride();
+            read.presences = &found_presences;
+            read.offsets = request_content ? &found_offsets : nullptr;
+            read.lengths = request_only_lengths ? &found_lengths : nullptr;
+            read.values = request_content ? &found_values : nullptr;
+
+            ustore_read(&read);
             if (!status)
                 return ar::Status::ExecutionError(status.message());
 
+            if (request_shared) {
+                ar_status = export_shared( //
+                    *shared_arena.member_ptr(),
+                    tasks_count,
+                    found_presences,
+                    found_offsets,
+                    found_values,
+                    session,
+                    output_schema_c,
+                    output_batch_c);
+                if (!ar_status.ok())
+                    return ar_status;
+                return import_output(output_schema_c, output_batch_c, output);
+            }
+
             is_empty_values = request_content && (found_values == nullptr);
 
             ustore_size_t result_length =
@@ -1170,49 +2223,533 @@ class UStoreService : public arf::FlightServerBase {
                 output_batch_c.children[1],
                 status.member_ptr());
         }
+        else if (is_query(desc.cmd, kFlightGraphTraverse)) {
 
-        if (is_empty_values)
-            output_batch_c.children[0]->buffers[2] = &zero_size_data_k;
-        arrow::Result<std::shared_ptr<arrow::RecordBatch>> maybe_table =
-            ar::ImportRecordBatch(&output_batch_c, &output_schema_c);
-
-        if (!maybe_table.ok())
-            return maybe_table.status();
+            /// @param `keys`
+            auto input_starts = get_keys(input_schema_c, input_batch_c, kArgKeys);
+            if (!input_starts)
+                return ar::Status::Invalid("Starting vertices must have been provided for traversals");
+
+            ustore_length_t* found_vertices_offsets = nullptr;
+            ustore_key_t* found_vertices = nullptr;
+            ustore_length_t* found_edges_offsets = nullptr;
+            ustore_key_t* found_edges = nullptr;
+            ustore_graph_traverse_t traverse {};
+            traverse.db = db_;
+            traverse.error = status.member_ptr();
+            traverse.transaction = session.txn;
+            traverse.snapshot = c_snapshot_id;
+            traverse.arena = &session.arena;
+            traverse.options = ustore_options(params);
+            traverse.collection = c_collection_id;
+            traverse.starts_count = static_cast<ustore_size_t>(input_batch_c.length);
+            traverse.starts = input_starts.get();
+            traverse.starts_stride = input_starts.stride();
+            traverse.hops = parse_count(params.hops, 1);
+            traverse.role = static_cast<ustore_vertex_role_t>(parse_count(params.role, ustore_vertex_role_any_k));
+            traverse.frontier_limit = parse_count(params.frontier_limit);
+            traverse.revisit = params.opt_revisit.has_value();
+            traverse.vertices_offsets = &found_vertices_offsets;
+            traverse.vertices = &found_vertices;
+            traverse.edges_offsets = &found_edges_offsets;
+            traverse.edges = &found_edges;
+
+            ustore_graph_traverse(&traverse);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
 
-        auto table = maybe_table.ValueUnsafe();
-        ar_status = table->ValidateFull();
-        if (!ar_status.ok())
-            return ar_status;
+            // Vertices and edges differ in length, so they are packed into a single column:
+            // offsets of vertices per hop, offsets of edges per hop, vertices and edge triplets
+            auto arena = linked_memory(&session.arena, ustore_option_dont_discard_memory_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
 
-        ar_status = response.Begin(table->schema());
-        if (!ar_status.ok())
-            return ar_status;
+            std::size_t const hops = traverse.hops;
+            std::size_t const count_vertices = found_vertices_offsets[hops + 1];
+            std::size_t const count_edges = found_edges_offsets[hops];
+            std::size_t const result_length = (hops + 2) + (hops + 1) + count_vertices + count_edges * 3;
+            auto traversal = arena.alloc<ustore_key_t>(result_length, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
 
-        ar_status = response.WriteRecordBatch(*table);
-        if (!ar_status.ok())
-            return ar_status;
+            ustore_key_t* traversal_it = traversal.begin();
+            traversal_it = std::copy(found_vertices_offsets, found_vertices_offsets + hops + 2, traversal_it);
+            traversal_it = std::copy(found_edges_offsets, found_edges_offsets + hops + 1, traversal_it);
+            traversal_it = std::copy(found_vertices, found_vertices + count_vertices, traversal_it);
+            std::copy(found_edges, found_edges + count_edges * 3, traversal_it);
 
-        return response.Close();
-    }
+            ustore_to_arrow_schema(result_length, 1, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
 
-    ar::Status DoPut( //
-        arf::ServerCallContext const& server_call,
-        std::unique_ptr<arf::FlightMessageReader> request_ptr,
-        std::unique_ptr<arf::FlightMetadataWriter> response_ptr) override {
+            ustore_to_arrow_column( //
+                result_length,
+                kArgTraversal.c_str(),
+                ustore_doc_field<ustore_key_t>(),
+                nullptr,
+                nullptr,
+                traversal.begin(),
+                output_schema_c.children[0],
+                output_batch_c.children[0],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
+        else if (is_query(desc.cmd, kFlightVectorsSearch)) {
 
-        ar::Status ar_status;
-        arf::FlightMessageReader& request = *request_ptr;
-        arf::FlightMetadataWriter& response = *response_ptr;
-        arf::FlightDescriptor const& desc = request.descriptor();
-        session_params_t params = session_params(server_call, desc.cmd);
-        status_t status;
+            /// @param `values`
+            auto input_queries = get_contents(input_schema_c, input_batch_c, kArgVals);
+            if (!input_queries.contents_begin)
+                return ar::Status::Invalid("Query vectors must have been provided for search");
 
-        ArrowSchema input_schema_c;
-        ArrowArray input_batch_c;
-        if (ar_status = unpack_table(request.ToTable(), input_schema_c, input_batch_c); !ar_status.ok())
-            return ar_status;
+            /// @param `count_limits`
+            auto input_limits = get_lengths(input_schema_c, input_batch_c, kArgCountLimits);
+            if (!input_limits)
+                return ar::Status::Invalid("Count limits must have been provided for search");
+
+            // Every query must be exactly as long as the declared dimensions
+            auto scalar_type = static_cast<ustore_vector_scalar_t>(parse_count(params.scalar_type));
+            std::size_t const dimensions = parse_count(params.dimensions);
+            std::size_t const query_length = dimensions * vector_scalar_size_bytes(scalar_type);
+            std::size_t const tasks_count = static_cast<std::size_t>(input_batch_c.length);
+            if (!query_length)
+                return ar::Status::Invalid("Dimensions and scalar type must have been provided for search");
+            for (std::size_t i = 0; i != tasks_count; ++i)
+                if (input_queries[i].size() != query_length)
+                    return ar::Status::Invalid("Query vectors don't match the dimensions");
+
+            // The optional allow-list is passed in the metadata, as it has a different length
+            std::vector<ustore_key_t> allowed_keys;
+            if (metadata) {
+                allowed_keys.resize(static_cast<std::size_t>(metadata->size()) / sizeof(ustore_key_t));
+                std::memcpy(allowed_keys.data(), metadata->data(), allowed_keys.size() * sizeof(ustore_key_t));
+            }
 
-        if (is_query(desc.cmd, kFlightWrite)) {
+            ustore_length_t* found_counts = nullptr;
+            ustore_length_t* found_offsets = nullptr;
+            ustore_key_t* found_keys = nullptr;
+            ustore_float_t* found_metrics = nullptr;
+            ustore_vectors_search_t search {};
+            search.db = db_;
+            search.error = status.member_ptr();
+            search.transaction = session.txn;
+            search.arena = &session.arena;
+            search.options = ustore_options(params);
+            search.tasks_count = static_cast<ustore_size_t>(tasks_count);
+            search.dimensions = static_cast<ustore_length_t>(dimensions);
+            search.scalar_type = scalar_type;
+            search.metric = static_cast<ustore_vector_metric_t>(parse_count(params.metric));
+            search.metric_threshold = parse_real(params.metric_threshold);
+            search.index_expansion = static_cast<ustore_length_t>(parse_count(params.index_expansion));
+            search.rerank_count = static_cast<ustore_length_t>(parse_count(params.rerank_count));
+            search.keys_min = parse_key(params.keys_min);
+            search.keys_max = parse_key(params.keys_max);
+            search.allowed_keys = metadata ? allowed_keys.data() : nullptr;
+            search.allowed_keys_count = static_cast<ustore_size_t>(allowed_keys.size());
+            search.collections = input_collections.get();
+            search.collections_stride = input_collections.stride();
+            search.match_counts_limits = input_limits.get();
+            search.match_counts_limits_stride = input_limits.stride();
+            search.queries_starts = input_queries.contents_begin.get();
+            search.queries_starts_stride = input_queries.contents_begin.stride();
+            search.queries_offsets = input_queries.offsets_begin.get();
+            search.queries_offsets_stride = input_queries.offsets_begin.stride();
+            search.match_counts = &found_counts;
+            search.match_offsets = &found_offsets;
+            search.match_keys = &found_keys;
+            search.match_metrics = &found_metrics;
+
+            if (tasks_count)
+                ustore_vectors_search(&search);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Every query gets a row with lists of matched keys and metrics, sharing the offsets.
+            // Exported offsets of matches lack the closing entry, which Arrow lists need.
+            auto arena = linked_memory(&session.arena, ustore_option_dont_discard_memory_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            auto offsets = arena.alloc<ustore_length_t>(tasks_count + 1, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            std::copy(found_offsets, found_offsets + tasks_count, offsets.begin());
+            offsets[tasks_count] = tasks_count ? found_offsets[tasks_count - 1] + found_counts[tasks_count - 1] : 0;
+
+            ustore_to_arrow_schema(tasks_count, 2, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_list( //
+                tasks_count,
+                kArgKeys.c_str(),
+                ustore_doc_field<ustore_key_t>(),
+                nullptr,
+                offsets.begin(),
+                found_keys ? (void const*)found_keys : (void const*)&zero_size_data_k,
+                output_schema_c.children[0],
+                output_batch_c.children[0],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            ustore_to_arrow_list( //
+                tasks_count,
+                kArgMetrics.c_str(),
+                ustore_doc_field<ustore_float_t>(),
+                nullptr,
+                offsets.begin(),
+                found_metrics ? (void const*)found_metrics : (void const*)&zero_size_data_k,
+                output_schema_c.children[1],
+                output_batch_c.children[1],
+                status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
+        else if (is_query(desc.cmd, kFlightDocsGather)) {
+
+            /// @param `keys`
+            auto input_keys = get_keys(input_schema_c, input_batch_c, kArgKeys);
+            if (!input_keys)
+                return ar::Status::Invalid("Keys must have been provided for gathering");
+
+            // Requested fields are passed in the metadata, each as a type byte and a NULL-terminated name
+            std::vector<ustore_str_view_t> fields;
+            std::vector<ustore_doc_field_type_t> types;
+            ustore_str_view_t filter = nullptr;
+            char const* fields_it = metadata ? reinterpret_cast<char const*>(metadata->data()) : nullptr;
+            char const* fields_end = metadata ? fields_it + metadata->size() : nullptr;
+            while (fields_it != fields_end) {
+                char const* name_end = std::find(fields_it + 1, fields_end, '\0');
+                if (name_end == fields_end)
+                    return ar::Status::Invalid("Malformed fields in metadata");
+                auto type = static_cast<ustore_doc_field_type_t>(static_cast<unsigned char>(*fields_it));
+                if (type == ustore_doc_field_null_k)
+                    filter = fields_it + 1;
+                else if (!*ustore_doc_field_type_to_arrow_format(type))
+                    return ar::Status::Invalid("Field type can't be gathered into Arrow");
+                else {
+                    types.push_back(type);
+                    fields.push_back(fields_it + 1);
+                }
+                fields_it = name_end + 1;
+            }
+            if (fields.empty() && !filter)
+                return ar::Status::Invalid("Fields must have been provided for gathering");
+
+            std::size_t const inputs_count = static_cast<std::size_t>(input_batch_c.length);
+            std::size_t const fields_count = fields.size();
+            bool const wants_conversions = params.opt_conversions.has_value();
+            bool const wants_collisions = params.opt_collisions.has_value();
+
+            ustore_octet_t** found_validities = nullptr;
+            ustore_octet_t** found_conversions = nullptr;
+            ustore_octet_t** found_collisions = nullptr;
+            ustore_byte_t** found_scalars = nullptr;
+            ustore_length_t** found_offsets = nullptr;
+            ustore_length_t** found_lengths = nullptr;
+            ustore_byte_t* found_strings = nullptr;
+            ustore_length_t found_matches_count = 0;
+            ustore_length_t* found_matches = nullptr;
+            ustore_docs_gather_t gather {};
+            gather.db = db_;
+            gather.error = status.member_ptr();
+            gather.transaction = session.txn;
+            gather.snapshot = c_snapshot_id;
+            gather.arena = &session.arena;
+            gather.options = ustore_options(params);
+            gather.docs_count = static_cast<ustore_size_t>(inputs_count);
+            gather.fields_count = static_cast<ustore_size_t>(fields_count);
+            gather.collections = input_collections.get();
+            gather.collections_stride = input_collections.stride();
+            gather.keys = input_keys.get();
+            gather.keys_stride = input_keys.stride();
+            gather.fields = fields.data();
+            gather.fields_stride = sizeof(ustore_str_view_t);
+            gather.types = types.data();
+            gather.types_stride = sizeof(ustore_doc_field_type_t);
+            gather.columns_validities = &found_validities;
+            gather.columns_conversions = wants_conversions ? &found_conversions : nullptr;
+            gather.columns_collisions = wants_collisions ? &found_collisions : nullptr;
+            gather.columns_scalars = &found_scalars;
+            gather.columns_offsets = &found_offsets;
+            gather.columns_lengths = &found_lengths;
+            gather.joined_strings = &found_strings;
+            gather.filter = filter;
+            gather.matches_count = &found_matches_count;
+            gather.matches = &found_matches;
+
+            ustore_docs_gather(&gather);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // With a filter, only the matching documents are exported
+            std::size_t const docs_count = filter ? found_matches_count : inputs_count;
+
+            // Strings are joined in the order of documents, but Arrow needs every column to be continuous,
+            // so they are compacted column by column into a shared buffer.
+            // Empty batches aren't gathered at all, but Arrow still expects non-NULL buffers.
+            auto arena = linked_memory(&session.arena, ustore_option_dont_discard_memory_k, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            auto is_string = [](ustore_doc_field_type_t type) {
+                return type == ustore_doc_field_str_k || type == ustore_doc_field_bin_k;
+            };
+            auto or_empty = [&](void const* buffer) {
+                return docs_count ? buffer : (void const*)&zero_size_data_k;
+            };
+            auto string_length = [&](std::size_t field_idx, std::size_t doc_idx) {
+                return check_presence(found_validities[field_idx], doc_idx) ? found_lengths[field_idx][doc_idx] : 0u;
+            };
+
+            std::size_t strings_length = 0;
+            for (std::size_t field_idx = 0; field_idx != fields_count && docs_count; ++field_idx)
+                for (std::size_t doc_idx = 0; doc_idx != docs_count && is_string(types[field_idx]); ++doc_idx)
+                    strings_length += string_length(field_idx, doc_idx);
+            auto strings = arena.alloc<byte_t>(strings_length, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            std::size_t const bitmaps_count = fields_count * (wants_conversions + wants_collisions);
+            std::size_t const columns_count = fields_count + bitmaps_count + (filter != nullptr);
+            ustore_to_arrow_schema(docs_count, columns_count, &output_schema_c, &output_batch_c, status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            std::size_t strings_progress = 0;
+            for (std::size_t field_idx = 0; field_idx != fields_count; ++field_idx) {
+                void const* contents = or_empty(docs_count ? found_scalars[field_idx] : nullptr);
+                ustore_length_t* offsets = nullptr;
+                if (is_string(types[field_idx])) {
+                    auto column_offsets = arena.alloc<ustore_length_t>(docs_count + 1, status.member_ptr());
+                    if (!status)
+                        return ar::Status::ExecutionError(status.message());
+                    offsets = column_offsets.begin();
+                    for (std::size_t doc_idx = 0; doc_idx != docs_count; ++doc_idx) {
+                        ustore_length_t const length = string_length(field_idx, doc_idx);
+                        offsets[doc_idx] = static_cast<ustore_length_t>(strings_progress);
+                        std::memcpy(strings.begin() + strings_progress,
+                                    found_strings + found_offsets[field_idx][doc_idx],
+                                    length);
+                        strings_progress += length;
+                    }
+                    offsets[docs_count] = static_cast<ustore_length_t>(strings_progress);
+                    contents = strings_length ? (void const*)strings.begin() : (void const*)&zero_size_data_k;
+                }
+
+                // Booleans are gathered as bytes, not bits, and are sent that way
+                ustore_to_arrow_column( //
+                    docs_count,
+                    fields[field_idx],
+                    types[field_idx] == ustore_doc_field_bool_k ? ustore_doc_field_u8_k : types[field_idx],
+                    docs_count ? found_validities[field_idx] : nullptr,
+                    offsets,
+                    contents,
+                    output_schema_c.children[field_idx],
+                    output_batch_c.children[field_idx],
+                    status.member_ptr());
+                if (!status)
+                    return ar::Status::ExecutionError(status.message());
+            }
+
+            // Conversions and collisions follow the requested fields as boolean columns
+            std::size_t column_idx = fields_count;
+            auto export_bitmaps = [&](ustore_octet_t** bitmaps, std::string const& name) {
+                for (std::size_t field_idx = 0; field_idx != fields_count && status; ++field_idx, ++column_idx)
+                    ustore_to_arrow_column( //
+                        docs_count,
+                        name.c_str(),
+                        ustore_doc_field_bool_k,
+                        nullptr,
+                        nullptr,
+                        or_empty(docs_count ? bitmaps[field_idx] : nullptr),
+                        output_schema_c.children[column_idx],
+                        output_batch_c.children[column_idx],
+                        status.member_ptr());
+            };
+            if (wants_conversions)
+                export_bitmaps(found_conversions, kArgConversions);
+            if (wants_collisions)
+                export_bitmaps(found_collisions, kArgCollisions);
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+
+            // Indexes of the matching documents come last
+            if (filter)
+                ustore_to_arrow_column( //
+                    docs_count,
+                    kArgMatches.c_str(),
+                    ustore_doc_field<ustore_length_t>(),
+                    nullptr,
+                    nullptr,
+                    or_empty(found_matches),
+                    output_schema_c.children[column_idx],
+                    output_batch_c.children[column_idx],
+                    status.member_ptr());
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+        }
+        else
+            return ar::Status::NotImplemented("Unknown exchange type: ", desc.cmd);
+
+        if (is_empty_values)
+            output_batch_c.children[0]->buffers[2] = &zero_size_data_k;
+        return import_output(output_schema_c, output_batch_c, output);
+    }
+
+    static ar::Status import_output(ArrowSchema& output_schema_c,
+                                    ArrowArray& output_batch_c,
+                                    std::shared_ptr<ar::RecordBatch>& output) {
+        ar::Result<std::shared_ptr<ar::RecordBatch>> maybe_batch =
+            ar::ImportRecordBatch(&output_batch_c, &output_schema_c);
+        if (!maybe_batch.ok())
+            return maybe_batch.status();
+
+        output = maybe_batch.ValueUnsafe();
+        return output->ValidateFull();
+    }
+
+    /**
+     * @brief Describes the results of a read, allocated in the `shared_arena`, with three rows:
+     * for presences, offsets and values. Every row names the shared memory segment and the
+     * range of the buffer within it, so that the content itself never crosses the socket.
+     * The referenced segments outlive the arena, until the client maps and unlinks them.
+     */
+    ar::Status export_shared(ustore_arena_t& shared_arena,
+                             ustore_size_t tasks_count,
+                             ustore_octet_t const* presences,
+                             ustore_length_t const* offsets,
+                             ustore_bytes_cptr_t values,
+                             session_lock_t& session,
+                             ArrowSchema& output_schema_c,
+                             ArrowArray& output_batch_c) {
+
+        status_t status;
+        linked_memory_t& shared = reinterpret_cast<linked_memory_t&>(shared_arena);
+        linked_memory_lock_t shared_lock = linked_memory( //
+            &shared_arena,
+            ustore_options_t(ustore_option_read_shared_memory_k | ustore_option_dont_discard_memory_k),
+            status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        constexpr std::size_t buffers_count_k = 3;
+        std::array<std::pair<void const*, std::size_t>, buffers_count_k> buffers {{
+            {presences, divide_round_up<std::size_t>(tasks_count, CHAR_BIT)},
+            {offsets, (tasks_count + 1) * sizeof(ustore_length_t)},
+            {values, offsets ? offsets[tasks_count] : 0},
+        }};
+
+        // Some engines may export buffers, that are not allocated in the arena
+        for (auto& [begin, length] : buffers) {
+            if (!begin || !length || shared.find(begin))
+                continue;
+            auto copy = shared_lock.alloc<byte_t>(length, status.member_ptr(), sizeof(std::uint64_t));
+            if (!status)
+                return ar::Status::ExecutionError(status.message());
+            std::memcpy(copy.begin(), begin, length);
+            begin = copy.begin();
+        }
+
+        linked_memory_lock_t arena =
+            linked_memory(&session.arena, ustore_option_dont_discard_memory_k, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+        auto names_offsets = arena.alloc<ustore_length_t>(buffers_count_k + 1, status.member_ptr());
+        auto names = arena.alloc<char>(buffers_count_k * linked_memory_t::shared_name_length_k, status.member_ptr());
+        auto positions = arena.alloc<std::uint64_t>(buffers_count_k, status.member_ptr());
+        auto lengths = arena.alloc<std::uint64_t>(buffers_count_k, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        // Missing buffers are marked with empty names
+        std::vector<linked_memory_t::arena_header_t*> segments(buffers_count_k);
+        names_offsets[0] = 0;
+        for (std::size_t i = 0; i != buffers_count_k; ++i) {
+            auto [begin, length] = buffers[i];
+            linked_memory_t::arena_header_t* segment = begin && length ? shared.find(begin) : nullptr;
+            std::size_t name_length = segment ? std::strlen(segment->shared_name) : 0;
+            if (segment)
+                std::memcpy(names.begin() + names_offsets[i], segment->shared_name, name_length);
+            names_offsets[i + 1] = static_cast<ustore_length_t>(names_offsets[i] + name_length);
+            positions[i] = segment ? static_cast<std::uint64_t>((byte_t const*)begin - (byte_t const*)segment) : 0;
+            lengths[i] = segment ? length : 0;
+            segments[i] = segment;
+        }
+
+        ustore_to_arrow_schema(buffers_count_k, 3, &output_schema_c, &output_batch_c, status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+        ustore_to_arrow_column( //
+            buffers_count_k,
+            kArgSharedNames.c_str(),
+            ustore_doc_field_str_k,
+            nullptr,
+            names_offsets.begin(),
+            names.begin(),
+            output_schema_c.children[0],
+            output_batch_c.children[0],
+            status.member_ptr());
+        if (status)
+            ustore_to_arrow_column( //
+                buffers_count_k,
+                kArgSharedOffsets.c_str(),
+                ustore_doc_field<std::uint64_t>(),
+                nullptr,
+                nullptr,
+                positions.begin(),
+                output_schema_c.children[1],
+                output_batch_c.children[1],
+                status.member_ptr());
+        if (status)
+            ustore_to_arrow_column( //
+                buffers_count_k,
+                kArgSharedLengths.c_str(),
+                ustore_doc_field<std::uint64_t>(),
+                nullptr,
+                nullptr,
+                lengths.begin(),
+                output_schema_c.children[2],
+                output_batch_c.children[2],
+                status.member_ptr());
+        if (!status)
+            return ar::Status::ExecutionError(status.message());
+
+        // Keep the referenced segments alive after the arena is freed,
+        // while forgetting the ones, that clients have abandoned
+        sys_time_t const now = sys_clock_t::now();
+        std::lock_guard<std::mutex> _ {handed_off_segments_lock_};
+        while (!handed_off_segments_.empty() && handed_off_segments_.front().first < now - handed_off_timeout_) {
+            shm_unlink(handed_off_segments_.front().second.c_str());
+            handed_off_segments_.pop_front();
+        }
+        for (linked_memory_t::arena_header_t* segment : segments) {
+            if (!segment || segment->is_handed_off)
+                continue;
+            segment->is_handed_off = true;
+            handed_off_segments_.emplace_back(now, segment->shared_name);
+        }
+        return ar::Status::OK();
+    }
+
+    /**
+     * @brief Executes a `DoPut` query for one batch of arguments.
+     */
+    ar::Status put_batch(arf::FlightDescriptor const& desc,
+                         session_params_t const& params,
+                         session_lock_t& session,
+                         ar::RecordBatch const& input) {
+
+        status_t status;
+        ArrowSchema input_schema_c;
+        ArrowArray input_batch_c;
+        ar::Status ar_status = ar::ExportRecordBatch(input, &input_batch_c, &input_schema_c);
+        if (!ar_status.ok())
+            return ar_status;
+        exported_batch_t exported_input {input_schema_c, input_batch_c};
+
+        if (is_query(desc.cmd, kFlightWrite)) {
 
             /// @param `keys`
             auto input_keys = get_keys(input_schema_c, input_batch_c, kArgKeys);
@@ -1231,10 +2768,6 @@ class UStoreService : public arf::FlightServerBase {
 
             auto input_vals = get_contents(input_schema_c, input_batch_c, kArgVals);
 
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
             ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
             ustore_write_t write {};
             write.db = db_;
@@ -1255,10 +2788,55 @@ class UStoreService : public arf::FlightServerBase {
             write.values = input_vals.contents_begin.get();
             write.values_stride = input_vals.contents_begin.stride();
 
+            // The changes are copied before the write, as the engine may reuse the input buffers
+            std::vector<replicated_entry_t> entries(replication_log_ ? tasks_count : 0);
+            for (std::size_t i = 0; i != entries.size(); ++i) {
+                value_view_t value = input_vals[i];
+                entries[i].collection = input_collections ? input_collections[i] : ustore_collection_main_k;
+                entries[i].key = input_keys[i];
+                entries[i].present = bool(value);
+                entries[i].value.assign(reinterpret_cast<char const*>(value.data()), value ? value.size() : 0);
+            }
+
+            std::unique_lock<std::mutex> order;
+            if (replication_log_ && !session.is_txn())
+                order = replication_log_->order();
             ustore_write(&write);
 
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+
+            // Replicas receive the merged values, as the operands depend on the state of the leader
+            if (!entries.empty() && (write.options & ustore_option_write_merge_k)) {
+                ustore_octet_t* merged_presences = nullptr;
+                ustore_length_t* merged_offsets = nullptr;
+                ustore_byte_t* merged_values = nullptr;
+                ustore_read_t read {};
+                read.db = db_;
+                read.error = status.member_ptr();
+                read.transaction = session.txn;
+                read.arena = &session.arena;
+                read.options = ustore_option_transaction_dont_watch_k;
+                read.tasks_count = tasks_count;
+                read.collections = input_collections.get();
+                read.collections_stride = input_collections.stride();
+                read.keys = input_keys.get();
+                read.keys_stride = input_keys.stride();
+                read.presences = &merged_presences;
+                read.offsets = &merged_offsets;
+                read.values = &merged_values;
+                ustore_read(&read);
+                if (!status)
+                    return ar::Status::ExecutionError(status.message());
+
+                joined_blobs_t merged {tasks_count, merged_offsets, merged_values};
+                for (std::size_t i = 0; i != entries.size(); ++i) {
+                    value_view_t value = merged[i];
+                    entries[i].present = bits_view_t {merged_presences}[i];
+                    entries[i].value.assign(reinterpret_cast<char const*>(value.data()), value.size());
+                }
+            }
+            record_changes(session, entries);
         }
         else if (is_query(desc.cmd, kFlightWritePath)) {
             /// @param `keys`
@@ -1278,10 +2856,6 @@ class UStoreService : public arf::FlightServerBase {
 
             auto input_vals = get_contents(input_schema_c, input_batch_c, kArgVals);
 
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
             ustore_size_t tasks_count = static_cast<ustore_size_t>(input_batch_c.length);
             ustore_paths_write_t write {};
             write.db = db_;
@@ -1307,159 +2881,41 @@ class UStoreService : public arf::FlightServerBase {
             write.values_bytes = input_vals.contents_begin.get();
             write.values_bytes_stride = input_vals.contents_begin.stride();
 
+            std::vector<replicated_entry_t> entries(replication_log_ ? tasks_count : 0);
+            for (std::size_t i = 0; i != entries.size(); ++i) {
+                value_view_t path = input_paths[i];
+                value_view_t value = input_vals[i];
+                entries[i].kind = replicated_kind_t::write_path_k;
+                entries[i].collection = input_collections ? input_collections[i] : ustore_collection_main_k;
+                entries[i].name.assign(reinterpret_cast<char const*>(path.data()), path ? path.size() : 0);
+                entries[i].present = bool(value);
+                entries[i].value.assign(reinterpret_cast<char const*>(value.data()), value ? value.size() : 0);
+            }
+
+            std::unique_lock<std::mutex> order;
+            if (replication_log_ && !session.is_txn())
+                order = replication_log_->order();
             ustore_paths_write(&write);
 
             if (!status)
                 return ar::Status::ExecutionError(status.message());
+            record_changes(session, entries);
         }
         return ar::Status::OK();
     }
+};
 
-    ar::Status DoGet( //
-        arf::ServerCallContext const& server_call,
-        arf::Ticket const& ticket,
-        std::unique_ptr<arf::FlightDataStream>* response_ptr) override {
-
-        ar::Status ar_status;
-        session_params_t params = session_params(server_call, ticket.ticket);
-        status_t status;
-
-        if (is_query(ticket.ticket, kFlightListCols)) {
-
-            // We will need some temporary memory for exports
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            ustore_size_t count = 0;
-            ustore_collection_t* collections = nullptr;
-            ustore_length_t* offsets = nullptr;
-            ustore_str_span_t names = nullptr;
-            ustore_collection_list_t collection_list {};
-            collection_list.db = db_;
-            collection_list.error = status.member_ptr();
-            collection_list.transaction = session.txn;
-            collection_list.snapshot = {}; // TODO
-            collection_list.arena = &session.arena;
-            collection_list.options = ustore_options(params);
-            collection_list.count = &count;
-            collection_list.ids = &collections;
-            collection_list.offsets = &offsets;
-            collection_list.names = &names;
-
-            ustore_collection_list(&collection_list);
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            // Pack two columns into a Table
-            ArrowSchema schema_c;
-            ArrowArray array_c;
-            ustore_to_arrow_schema(count, 2, &schema_c, &array_c, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            ustore_to_arrow_column( //
-                count,
-                kArgCols.c_str(),
-                ustore_doc_field<ustore_collection_t>(),
-                nullptr,
-                nullptr,
-                ustore_bytes_ptr_t(collections),
-                schema_c.children[0],
-                array_c.children[0],
-                status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            ustore_to_arrow_column( //
-                count,
-                kArgNames.c_str(),
-                ustore_doc_field_str_k,
-                nullptr,
-                offsets,
-                ustore_bytes_ptr_t(names),
-                schema_c.children[1],
-                array_c.children[1],
-                status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            auto maybe_batch = ar::ImportRecordBatch(&array_c, &schema_c);
-            if (!maybe_batch.ok())
-                return maybe_batch.status();
-
-            auto batch = maybe_batch.ValueUnsafe();
-            auto maybe_reader = ar::RecordBatchReader::Make({batch});
-            if (!maybe_reader.ok())
-                return maybe_reader.status();
-
-            // TODO: Pass right IPC options
-            auto stream = std::make_unique<arf::RecordBatchStream>(maybe_reader.ValueUnsafe());
-            *response_ptr = std::move(stream);
-            return ar::Status::OK();
-        }
-        else if (is_query(ticket.ticket, kFlightListSnap)) {
-            // We will need some temporary memory for exports
-            auto session = sessions_.lock(params.session_id, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            ustore_size_t count = 0;
-            ustore_snapshot_t* snapshots = nullptr;
-            ustore_snapshot_list_t snapshots_list;
-            snapshots_list.db = db_;
-            snapshots_list.error = status.member_ptr();
-            snapshots_list.arena = &session.arena;
-            snapshots_list.options = ustore_options(params);
-            snapshots_list.count = &count;
-            snapshots_list.ids = &snapshots;
-
-            ustore_snapshot_list(&snapshots_list);
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            if (count == 0)
-                return ar::Status::OK();
-
-            // Pack two columns into a Table
-            ArrowSchema schema_c;
-            ArrowArray array_c;
-            ustore_to_arrow_schema(count, 2, &schema_c, &array_c, status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            ustore_to_arrow_column( //
-                count,
-                kArgSnaps.c_str(),
-                ustore_doc_field<ustore_snapshot_t>(),
-                nullptr,
-                nullptr,
-                ustore_bytes_ptr_t(snapshots),
-                schema_c.children[0],
-                array_c.children[0],
-                status.member_ptr());
-            if (!status)
-                return ar::Status::ExecutionError(status.message());
-
-            auto maybe_batch = ar::ImportRecordBatch(&array_c, &schema_c);
-            if (!maybe_batch.ok())
-                return maybe_batch.status();
-
-            auto batch = maybe_batch.ValueUnsafe();
-            auto maybe_reader = ar::RecordBatchReader::Make({batch});
-            if (!maybe_reader.ok())
-                return maybe_reader.status();
-
-            // TODO: Pass right IPC options
-            auto stream = std::make_unique<arf::RecordBatchStream>(maybe_reader.ValueUnsafe());
-            *response_ptr = std::move(stream);
-            return ar::Status::OK();
-        }
-        return ar::Status::OK();
-    }
+/**
+ * @brief Role of the server in replication: a primary with a log of `log_bytes`,
+ * a replica of the `primary` server, polled every `interval`, or neither.
+ */
+struct replication_settings_t {
+    std::size_t log_bytes = 0;
+    std::string primary;
+    std::chrono::milliseconds interval {100};
 };
 
-ar::Status run_server(ustore_str_view_t config, int port, bool quiet) {
+ar::Status run_server(ustore_str_view_t config, int port, bool quiet, replication_settings_t const& replication) {
 
     database_t db;
     db.open(config).throw_unhandled();
@@ -1476,6 +2932,13 @@ ar::Status run_server(ustore_str_view_t config, int port, bool quiet) {
     options.memory_manager = ar::CPUDevice::memory_manager(&pool);
 
     auto server = std::make_unique<UStoreService>(std::move(db));
+    if (replication.log_bytes)
+        server->record_changes(replication.log_bytes);
+    if (!replication.primary.empty()) {
+        ARROW_ASSIGN_OR_RAISE(arf::Location primary_location, arf::Location::Parse(replication.primary));
+        ARROW_ASSIGN_OR_RAISE(std::unique_ptr<arf::FlightClient> primary, arf::FlightClient::Connect(primary_location));
+        server->follow(std::move(primary), replication.interval);
+    }
     ARROW_RETURN_NOT_OK(server->Init(options));
     if (!quiet)
         std::printf("Listening on port: %i\n", server->port());
@@ -1492,12 +2955,21 @@ int main(int argc, char* argv[]) {
     int port = 38709;
     bool quiet = false;
     bool help = false;
+    std::size_t replication_log_mb = 0;
+    std::size_t replication_interval_ms = 100;
+    replication_settings_t replication;
 
     auto cli = ( //
         (option("--config") & value("path", config_path))
             .doc("Configuration file path. The default configuration file path is " + config_path),
         (option("-p", "--port") & value("port", port))
             .doc("Port to use for connection. The default connection port is 38709"),
+        (option("--replication-log") & value("megabytes", replication_log_mb))
+            .doc("Retain this many megabytes of recent changes for replicas. Disabled by default"),
+        (option("--replicate-from") & value("url", replication.primary))
+            .doc("Serve as a read-only replica of the primary, like grpc://0.0.0.0:38709"),
+        (option("--replication-interval") & value("milliseconds", replication_interval_ms))
+            .doc("Period of polling the primary for changes. The default period is 100 milliseconds"),
         option("-q", "--quiet").set(quiet).doc("Silence outputs"),
         option("-h", "--help").set(help).doc("Print this help information on this tool and exit"));
 
@@ -1535,5 +3007,7 @@ int main(int argc, char* argv[]) {
         config = std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
     }
 
-    return run_server(config.c_str(), port, quiet).ok() ? EXIT_SUCCESS : EXIT_FAILURE;
+    replication.log_bytes = replication_log_mb * 1024 * 1024;
+    replication.interval = std::chrono::milliseconds(replication_interval_ms);
+    return run_server(config.c_str(), port, quiet, replication).ok() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -9,6 +9,9 @@
 #include <numeric>   // `std::accumulate`
 #include <forward_list>
 
+#include "ustore/blobs.h"
+#include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
+
 namespace unum::ustore {
 
 template <typename range_at, typename comparable_at>
@@ -35,13 +38,121 @@ element_at inplace_inclusive_prefix_sum(element_at* begin, element_at* const end
     return sum;
 }
 
+/**
+ * @brief Checks if a read was requested with `::ustore_option_read_deduplicate_k`, and can be deduplicated.
+ * Slices may differ between the repetitions of the same key, so such reads are passed as is.
+ */
+inline bool deduplicates_reads(ustore_read_t const& c) noexcept {
+    return (c.options & ustore_option_read_deduplicate_k) && c.tasks_count > 1 && !c.slices_starts &&
+           !c.slices_lengths;
+}
+
 /**
  * @brief In many "modality" implementations, we may have batches of requests,
  * where distinct queries map into the same entries. In that case, the trivial
  * "gather+scatter" operation gets two more stages: deduplication and join.
  *
+ * Passes the sorted unique places to the `gather` callback, which forwards them to the engine,
+ * and scatters the results back into the original positions. Engines call it before starting
+ * their timers, so that every read is accounted once.
+ * Values are shared between repetitions, if both `offsets` and `lengths` are requested,
+ * otherwise they are copied, as the tape must preserve the order of the tasks.
  */
-inline void deduplicate_gather_join_scatter() {
+template <typename gather_at>
+void deduplicate_gather_join_scatter(ustore_read_t& c, gather_at&& gather) noexcept {
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    auto places = arena.alloc<collection_key_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i)
+        places[i] = {collections ? collections[i] : ustore_collection_main_k, keys[i]};
+
+    ustore_read_t unique = c;
+    unique.options = ustore_options_t((c.options & ~ustore_option_read_deduplicate_k) |
+                                      ustore_option_dont_discard_memory_k);
+
+    // Batches of sorted unique keys are passed as is
+    auto unique_places = arena.alloc<collection_key_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    std::copy(places.begin(), places.end(), unique_places.begin());
+    std::size_t const unique_count = sort_and_deduplicate(unique_places.begin(), unique_places.end());
+    if (unique_count == c.tasks_count && std::is_sorted(places.begin(), places.end()))
+        return gather(unique);
+
+    ustore_octet_t* unique_presences = nullptr;
+    ustore_length_t* unique_offsets = nullptr;
+    ustore_length_t* unique_lengths = nullptr;
+    ustore_byte_t* unique_values = nullptr;
+    bool const needs_contents = c.values || c.offsets;
+    unique.tasks_count = unique_count;
+    unique.collections = &unique_places.begin()->collection;
+    unique.collections_stride = sizeof(collection_key_t);
+    unique.keys = &unique_places.begin()->key;
+    unique.keys_stride = sizeof(collection_key_t);
+    unique.presences = c.presences ? &unique_presences : nullptr;
+    unique.offsets = needs_contents ? &unique_offsets : nullptr;
+    unique.lengths = needs_contents || c.lengths ? &unique_lengths : nullptr;
+    unique.values = c.values ? &unique_values : nullptr;
+    gather(unique);
+    return_if_error_m(c.error);
+
+    auto slots = arena.alloc<std::size_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    ptr_range_gt<collection_key_t const> sorted {unique_places.begin(), unique_count};
+    for (std::size_t i = 0; i != c.tasks_count; ++i)
+        slots[i] = offset_in_sorted(sorted, places[i]);
+
+    auto presences = arena.alloc_or_dummy(c.tasks_count, c.error, c.presences);
+    return_if_error_m(c.error);
+    auto lengths = arena.alloc_or_dummy(c.tasks_count, c.error, c.lengths);
+    return_if_error_m(c.error);
+    auto offsets = arena.alloc_or_dummy(c.tasks_count + 1, c.error, c.offsets);
+    return_if_error_m(c.error);
+    bits_span_t found_presences {unique_presences};
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        if (c.presences)
+            presences[i] = bool(found_presences[slots[i]]);
+        if (c.lengths)
+            lengths[i] = unique_lengths[slots[i]];
+    }
+    if (!needs_contents)
+        return;
+
+    // With both offsets and lengths, the order of entries on the tape is unspecified
+    if (c.offsets && c.lengths) {
+        for (std::size_t i = 0; i != c.tasks_count; ++i)
+            offsets[i] = unique_offsets[slots[i]];
+        offsets[c.tasks_count] = unique_offsets[unique_count];
+        if (c.values)
+            *c.values = unique_values;
+        return;
+    }
+
+    auto length_of = [&](std::size_t i) {
+        ustore_length_t length = unique_lengths[slots[i]];
+        return length != ustore_length_missing_k ? length : 0u;
+    };
+    std::size_t total_length = 0;
+    for (std::size_t i = 0; i != c.tasks_count; ++i)
+        total_length += length_of(i);
+    auto tape = arena.alloc<byte_t>(total_length, c.error);
+    return_if_error_m(c.error);
+    std::size_t passed_length = 0;
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        if (c.offsets)
+            offsets[i] = static_cast<ustore_length_t>(passed_length);
+        if (c.values)
+            std::memcpy(tape.begin() + passed_length, unique_values + unique_offsets[slots[i]], length_of(i));
+        passed_length += length_of(i);
+    }
+    if (c.offsets)
+        offsets[c.tasks_count] = static_cast<ustore_length_t>(passed_length);
+    if (c.values)
+        *c.values = reinterpret_cast<ustore_byte_t*>(tape.begin());
 }
 
 } // namespace unum::ustore
@@ -47,6 +47,10 @@ inline static std::string const kFlightSnapDrop = "remove_snapshot";   /// `DoAc
 inline static std::string const kFlightTxnBegin = "begin_transaction";   /// `DoAction`
 inline static std::string const kFlightTxnCommit = "commit_transaction"; /// `DoAction`
 
+inline static std::string const kFlightControl = "control"; /// `DoAction`
+
+inline static std::string const kFlightReplicate = "replicate"; /// `DoAction`
+
 inline static std::string const kFlightWrite = "write";          /// `DoPut`
 inline static std::string const kFlightRead = "read";            /// `DoExchange`
 inline static std::string const kFlightWritePath = "write_path"; /// `DoPut`
@@ -54,6 +58,9 @@ inline static std::string const kFlightMatchPath = "match_path"; /// `DoExchange
 inline static std::string const kFlightReadPath = "read_path";   /// `DoExchange`
 inline static std::string const kFlightScan = "scan";            /// `DoExchange`
 inline static std::string const kFlightMeasure = "measure";      /// `DoExchange`
+inline static std::string const kFlightGraphTraverse = "graph_traverse"; /// `DoExchange`
+inline static std::string const kFlightVectorsSearch = "vectors_search"; /// `DoExchange`
+inline static std::string const kFlightDocsGather = "docs_gather";       /// `DoExchange`
 
 inline static std::string const kArgSnaps = "snapshots";
 inline static std::string const kArgCols = "collections";
@@ -64,10 +71,20 @@ inline static std::string const kArgScanStarts = "start_keys";
 inline static std::string const kArgCountLimits = "count_limits";
 inline static std::string const kArgPresences = "fields";
 inline static std::string const kArgLengths = "lengths";
+inline static std::string const kArgSliceStarts = "slice_starts";
+inline static std::string const kArgSliceLengths = "slice_lengths";
 inline static std::string const kArgNames = "names";
 inline static std::string const kArgPaths = "paths";
 inline static std::string const kArgPatterns = "patterns";
 inline static std::string const kArgPrevPatterns = "prev_patterns";
+inline static std::string const kArgTraversal = "traversal";
+inline static std::string const kArgMetrics = "metrics";
+inline static std::string const kArgConversions = "conversions";
+inline static std::string const kArgCollisions = "collisions";
+inline static std::string const kArgMatches = "matches";
+inline static std::string const kArgSharedNames = "shared_names";
+inline static std::string const kArgSharedOffsets = "shared_offsets";
+inline static std::string const kArgSharedLengths = "shared_lengths";
 
 inline static std::string const kParamCollectionID = "collection_id";
 inline static std::string const kParamCollectionName = "collection_name";
@@ -75,8 +92,25 @@ inline static std::string const kParamSnapshotID = "snapshot_id";
 inline static std::string const kParamTransactionID = "transaction_id";
 inline static std::string const kParamReadPart = "part";
 inline static std::string const kParamDropMode = "mode";
+inline static std::string const kParamHops = "hops";
+inline static std::string const kParamRole = "role";
+inline static std::string const kParamFrontierLimit = "frontier_limit";
+inline static std::string const kParamDimensions = "dimensions";
+inline static std::string const kParamScalarType = "scalar_type";
+inline static std::string const kParamMetric = "metric";
+inline static std::string const kParamMetricThreshold = "metric_threshold";
+inline static std::string const kParamIndexExpansion = "index_expansion";
+inline static std::string const kParamRerankCount = "rerank_count";
+inline static std::string const kParamKeysMin = "keys_min";
+inline static std::string const kParamKeysMax = "keys_max";
+inline static std::string const kParamSequence = "sequence";
+inline static std::string const kParamMaxStaleness = "max_staleness";
+inline static std::string const kParamFlagRevisit = "revisit";
+inline static std::string const kParamFlagConversions = "conversions";
+inline static std::string const kParamFlagCollisions = "collisions";
 inline static std::string const kParamFlagFlushWrite = "flush";
 inline static std::string const kParamFlagDontWatch = "dont_watch";
+inline static std::string const kParamFlagMergeWrite = "merge";
 inline static std::string const kParamFlagDontDiscard = "";
 inline static std::string const kParamFlagSharedMemRead = "shared";
 
@@ -185,6 +219,34 @@ ar::Status unpack_table( //
     return ar_status;
 }
 
+/**
+ * @brief Releases the C structs, that a batch was exported into, once they leave the scope.
+ */
+struct exported_batch_t {
+    ArrowSchema& schema_c;
+    ArrowArray& batch_c;
+
+    ~exported_batch_t() noexcept {
+        if (batch_c.release)
+            batch_c.release(&batch_c);
+        if (schema_c.release)
+            schema_c.release(&schema_c);
+    }
+};
+
+/**
+ * @brief Size of a single scalar in vectors passed through `DoExchange` searches.
+ */
+inline std::size_t vector_scalar_size_bytes(ustore_vector_scalar_t scalar_type) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: return sizeof(float);
+    case ustore_vector_scalar_f16_k: return sizeof(std::uint16_t);
+    case ustore_vector_scalar_i8_k: return sizeof(std::int8_t);
+    case ustore_vector_scalar_f64_k: return sizeof(double);
+    default: return 0;
+    }
+}
+
 inline expected_gt<std::size_t> column_idx(ArrowSchema const& schema_c, std::string_view name) {
     auto begin = schema_c.children;
     auto end = begin + schema_c.n_children;
@@ -0,0 +1,255 @@
+/**
+ * @file compression.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Codecs, that modalities apply to their values before passing them to the engines.
+ *
+ * General-purpose compression in the engines has to treat every value as an opaque string.
+ * Modalities know better: small JSON documents of the same collection share most of their
+ * keys and structure, so a dictionary trained on a sample of them makes Zstandard efficient
+ * even on tiny inputs, while the exponents and the high bytes of numeric vectors repeat,
+ * once the bytes of all scalars are grouped by their significance.
+ */
+#pragma once
+#include <cstdint>       // `std::uint32_t`
+#include <cstring>       // `std::memcpy`
+#include <memory>        // `std::shared_ptr`
+#include <mutex>         // `std::mutex`
+#include <string>        // `std::string`
+#include <string_view>   // `std::string_view`
+#include <unordered_map> // `std::unordered_map`
+#include <utility>       // `std::pair`
+#include <vector>        // `std::vector`
+
+#include <lz4.h>
+#include <zdict.h>
+#include <zstd.h>
+
+#include "ustore/db.h"
+#include "ustore/cpp/types.hpp" // `value_view_t`
+
+namespace unum::ustore {
+
+enum class codec_t : std::uint8_t {
+    none_k = 0,
+    /** @brief Zstandard, optionally with a dictionary, trained on the collection. Fits small documents. */
+    zstd_k = 1,
+    /** @brief Bytes of scalars grouped by significance, followed by LZ4. Fits numeric arrays. */
+    shuffle_lz4_k = 2,
+};
+
+static constexpr int zstd_default_level_k = 3;
+
+/**
+ * @brief Trained Zstandard dictionary with its digested forms, which are expensive to prepare
+ * and are shared between all the threads. Compression ones are prepared for every used level.
+ */
+class zstd_dictionary_t {
+    std::string bytes_;
+    ZSTD_DDict* decompression_ = nullptr;
+    std::mutex mutex_;
+    std::vector<std::pair<int, ZSTD_CDict*>> compression_;
+
+  public:
+    zstd_dictionary_t(std::string_view bytes) noexcept(false) : bytes_(bytes) {
+        decompression_ = ZSTD_createDDict(bytes_.data(), bytes_.size());
+    }
+    zstd_dictionary_t(zstd_dictionary_t const&) = delete;
+    ~zstd_dictionary_t() noexcept {
+        ZSTD_freeDDict(decompression_);
+        for (auto& level_and_dict : compression_)
+            ZSTD_freeCDict(level_and_dict.second);
+    }
+
+    std::string_view bytes() const noexcept { return bytes_; }
+    ZSTD_DDict const* decompression() const noexcept { return decompression_; }
+    ZSTD_CDict const* compression(int level) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& level_and_dict : compression_)
+            if (level_and_dict.first == level)
+                return level_and_dict.second;
+        ZSTD_CDict* dict = ZSTD_createCDict(bytes_.data(), bytes_.size(), level);
+        try {
+            if (dict)
+                compression_.emplace_back(level, dict);
+        }
+        catch (...) {
+            ZSTD_freeCDict(dict);
+            dict = nullptr;
+        }
+        return dict;
+    }
+};
+
+/**
+ * @brief Process-wide registry of dictionaries, addressed by the hashes of their contents.
+ * Compressed values only reference their dictionary by that identifier, and modalities
+ * register the dictionaries, when reading the schemas of their collections. As the contents
+ * define the identifier, the same one is safe to share between databases.
+ */
+class zstd_dictionaries_t {
+    std::mutex mutex_;
+    std::unordered_map<std::uint32_t, std::shared_ptr<zstd_dictionary_t>> dictionaries_;
+
+  public:
+    /** @brief FNV-1a hash of the contents, where zero is reserved for the lack of a dictionary. */
+    static std::uint32_t identify(std::string_view bytes) noexcept {
+        std::uint32_t hash = 2166136261u;
+        for (char byte : bytes)
+            hash = (hash ^ static_cast<std::uint8_t>(byte)) * 16777619u;
+        return hash ? hash : 1u;
+    }
+
+    std::uint32_t insert(std::string_view bytes) noexcept(false) {
+        std::uint32_t const id = identify(bytes);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dictionaries_.count(id))
+            dictionaries_.emplace(id, std::make_shared<zstd_dictionary_t>(bytes));
+        return id;
+    }
+
+    std::shared_ptr<zstd_dictionary_t> find(std::uint32_t id) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = dictionaries_.find(id);
+        return it != dictionaries_.end() ? it->second : nullptr;
+    }
+};
+
+inline zstd_dictionaries_t& zstd_dictionaries() noexcept {
+    static zstd_dictionaries_t dictionaries;
+    return dictionaries;
+}
+
+/**
+ * @brief Contexts of Zstandard are reused by every thread between calls.
+ */
+struct zstd_contexts_t {
+    ZSTD_CCtx* compression = ZSTD_createCCtx();
+    ZSTD_DCtx* decompression = ZSTD_createDCtx();
+    ~zstd_contexts_t() noexcept {
+        ZSTD_freeCCtx(compression);
+        ZSTD_freeDCtx(decompression);
+    }
+};
+
+inline zstd_contexts_t& zstd_contexts() noexcept {
+    thread_local zstd_contexts_t contexts;
+    return contexts;
+}
+
+inline std::size_t compress_bound(codec_t codec, std::size_t length) noexcept {
+    switch (codec) {
+    case codec_t::zstd_k: return ZSTD_compressBound(length);
+    case codec_t::shuffle_lz4_k: return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(length)));
+    default: return length;
+    }
+}
+
+/**
+ * @brief Compresses the `input` into the `output` of `capacity` bytes, preferably
+ * fitting `compress_bound()`, using a `dictionary`, if it's provided.
+ * @return Length of the compressed data, or zero on failure.
+ */
+inline std::size_t zstd_compress(value_view_t input,
+                                 byte_t* output,
+                                 std::size_t capacity,
+                                 zstd_dictionary_t* dictionary,
+                                 int level) noexcept {
+    ZSTD_CCtx* context = zstd_contexts().compression;
+    ZSTD_CDict const* digested = dictionary ? dictionary->compression(level) : nullptr;
+    if (dictionary && !digested)
+        return 0;
+    std::size_t result = digested
+                             ? ZSTD_compress_usingCDict(context, output, capacity, input.data(), input.size(), digested)
+                             : ZSTD_compressCCtx(context, output, capacity, input.data(), input.size(), level);
+    return ZSTD_isError(result) ? 0 : result;
+}
+
+/**
+ * @return Length of the decompressed data, or zero on failure.
+ */
+inline std::size_t zstd_decompress(value_view_t input,
+                                   byte_t* output,
+                                   std::size_t capacity,
+                                   zstd_dictionary_t const* dictionary) noexcept {
+    ZSTD_DCtx* context = zstd_contexts().decompression;
+    std::size_t result =
+        dictionary
+            ? ZSTD_decompress_usingDDict(context, output, capacity, input.data(), input.size(), dictionary->decompression())
+            : ZSTD_decompressDCtx(context, output, capacity, input.data(), input.size());
+    return ZSTD_isError(result) ? 0 : result;
+}
+
+/**
+ * @brief Trains a dictionary of up to `capacity` bytes on `count` concatenated `samples`.
+ * @return Empty string, if the samples are too few or too small to train on.
+ */
+inline std::string zstd_train(byte_t const* samples,
+                              std::size_t const* lengths,
+                              std::size_t count,
+                              std::size_t capacity) noexcept(false) {
+    std::string dictionary(capacity, '\0');
+    std::size_t result =
+        ZDICT_trainFromBuffer(dictionary.data(), capacity, samples, lengths, static_cast<unsigned>(count));
+    dictionary.resize(ZDICT_isError(result) ? 0 : result);
+    return dictionary;
+}
+
+/**
+ * @brief Transposes an array of scalars of `scalar_size` bytes into `scalar_size` planes,
+ * the first of which contains the first bytes of all the scalars. Trailing bytes,
+ * that don't form a complete scalar, are copied as is.
+ */
+inline void shuffle(byte_t const* input, std::size_t length, std::size_t scalar_size, byte_t* output) noexcept {
+    std::size_t const count = length / scalar_size;
+    for (std::size_t i = 0; i != count; ++i)
+        for (std::size_t j = 0; j != scalar_size; ++j)
+            output[j * count + i] = input[i * scalar_size + j];
+    std::memcpy(output + count * scalar_size, input + count * scalar_size, length - count * scalar_size);
+}
+
+inline void unshuffle(byte_t const* input, std::size_t length, std::size_t scalar_size, byte_t* output) noexcept {
+    std::size_t const count = length / scalar_size;
+    for (std::size_t i = 0; i != count; ++i)
+        for (std::size_t j = 0; j != scalar_size; ++j)
+            output[i * scalar_size + j] = input[j * count + i];
+    std::memcpy(output + count * scalar_size, input + count * scalar_size, length - count * scalar_size);
+}
+
+/**
+ * @brief Shuffles the `input` into the `scratch` of the same size and compresses it into the `output`.
+ * @return Length of the compressed data, or zero on failure.
+ */
+inline std::size_t shuffle_lz4_compress(value_view_t input,
+                                        std::size_t scalar_size,
+                                        byte_t* output,
+                                        std::size_t capacity,
+                                        byte_t* scratch) noexcept {
+    shuffle(input.data(), input.size(), scalar_size, scratch);
+    int result = LZ4_compress_default(reinterpret_cast<char const*>(scratch),
+                                      reinterpret_cast<char*>(output),
+                                      static_cast<int>(input.size()),
+                                      static_cast<int>(capacity));
+    return result > 0 ? static_cast<std::size_t>(result) : 0;
+}
+
+/**
+ * @brief Decompresses the `input` into the `scratch` and un-shuffles exactly `length` bytes into the `output`.
+ * @return False, if the `input` is corrupted or has a different length.
+ */
+inline bool shuffle_lz4_decompress(value_view_t input,
+                                   std::size_t scalar_size,
+                                   byte_t* output,
+                                   std::size_t length,
+                                   byte_t* scratch) noexcept {
+    int result = LZ4_decompress_safe(reinterpret_cast<char const*>(input.data()),
+                                     reinterpret_cast<char*>(scratch),
+                                     static_cast<int>(input.size()),
+                                     static_cast<int>(length));
+    if (result < 0 || static_cast<std::size_t>(result) != length)
+        return false;
+    unshuffle(scratch, length, scalar_size, output);
+    return true;
+}
+
+} // namespace unum::ustore
@@ -13,6 +13,7 @@
 #include <fmt/format.h>      // `fmt::format`
 
 #include "ustore/cpp/status.hpp" // `status_t`
+#include "helpers/threads.hpp"     // `threads_registry_t`
 
 namespace unum::ustore {
 
@@ -50,11 +51,15 @@ struct engine_config_t {
  * @directory: Main path where DB stores metadata, e.g schema, log, etc.
  * @data_directories: Storage paths where DB stores data.
  * @engine_config_path: Engine specific config.
+ * @threads_count: Threads available to parallel analytical queries, like vector search.
+ * @accelerator: Device for batched kernels of modalities, either "cpu" or "cuda".
  */
 struct config_t {
     std::string directory;
     std::vector<disk_config_t> data_directories;
     engine_config_t engine;
+    std::size_t threads_count = 1;
+    std::string accelerator = "cpu";
 };
 
 /**
@@ -74,13 +79,19 @@ class config_loader_t {
     static inline status_t save_to_json(config_t const& config, json_t& json);
     static inline status_t save_to_json_string(config_t const& config, std::string& str_json);
 
+    /**
+     * @brief Parses an optional size, either a number of bytes or a string like "16KB".
+     * Used by engines for their own nested configs.
+     * @return False if the entry exists, but is invalid. Leaves `bytes` untouched if missing.
+     */
+    static inline bool parse_volume(json_t const& json, std::string const& key, size_t& bytes) noexcept;
+    static inline bool parse_bytes(std::string const& str, size_t& bytes) noexcept;
+
   private:
     static inline std::string current_version() noexcept;
     static inline status_t validate_config(json_t const& json) noexcept;
 
     static inline bool parse_version(std::string const& str_version, uint8_t& major, uint8_t& minor) noexcept;
-    static inline bool parse_volume(json_t const& json, std::string const& key, size_t& bytes) noexcept;
-    static inline bool parse_bytes(std::string const& str, size_t& bytes) noexcept;
 };
 
 inline status_t config_loader_t::load_from_json(json_t const& json, config_t& config) {
@@ -92,6 +103,14 @@ inline status_t config_loader_t::load_from_json(json_t const& json, config_t& co
 
         // Main directory
         config.directory = json.value("directory", "");
+        config.threads_count = json.value("threads_count", std::size_t(1));
+        config.accelerator = json.value("accelerator", std::string("cpu"));
+        if (config.accelerator != "cpu" && config.accelerator != "cuda")
+            return "Unsupported accelerator";
+#if !defined(USTORE_USE_CUDA)
+        if (config.accelerator == "cuda")
+            return "Built without CUDA support";
+#endif
 
         // Storage disks
         if (json.contains("data_directories")) {
@@ -141,6 +160,8 @@ inline status_t config_loader_t::save_to_json(config_t const& config, json_t& js
 
     // Main directory
     json["directory"] = config.directory;
+    json["threads_count"] = config.threads_count;
+    json["accelerator"] = config.accelerator;
 
     // Storage disks
     std::vector<json_t> j_data_directories;
@@ -275,4 +296,12 @@ inline bool config_loader_t::parse_bytes(std::string const& str, size_t& bytes)
     return true;
 }
 
+/**
+ * @brief Shares the concurrency settings of a freshly opened database with the modalities.
+ * Every engine calls it on init, even without a config, to reset the handle, that may be reused.
+ */
+inline void register_threads(ustore_database_t db, config_t const& config) {
+    threads_registry_t::global().set(db, config.threads_count, config.accelerator == "cuda");
+}
+
 } // namespace unum::ustore
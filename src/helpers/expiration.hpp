@@ -0,0 +1,224 @@
+/**
+ * @file expiration.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Time-to-live of values in collections, created with a `{"ttl": seconds}` config.
+ *
+ * Engines append an 8-byte deadline to every value of such collections on write: milliseconds
+ * since the Unix epoch in the host byte order. Values past their deadline are reported missing
+ * by all the reads, while the storage is reclaimed in the background, without client requests.
+ * Values shorter than a deadline, like the ones cleared with `ustore_drop_vals_k`, never expire.
+ */
+#pragma once
+#include <chrono>        // `std::chrono::system_clock`
+#include <cmath>         // `std::ceil`
+#include <cstdint>       // `std::uint64_t`
+#include <cstring>       // `std::memcpy`
+#include <filesystem>    // `std::filesystem::path`
+#include <fstream>       // `std::ifstream`
+#include <map>           // `std::map`
+#include <mutex>         // `std::unique_lock`
+#include <shared_mutex>  // `std::shared_mutex`
+#include <string>        // `std::string`
+#include <unordered_map> // `std::unordered_map`
+#include <vector>        // `std::vector`
+#include <atomic>        // `std::atomic`
+
+#include <nlohmann/json.hpp> // `nlohmann::json`
+
+#include "ustore/db.h"
+#include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
+#include "helpers/linked_array.hpp"   // `growing_tape_t`
+
+namespace unum::ustore {
+
+using deadline_t = std::uint64_t;
+constexpr std::size_t deadline_bytes_k = sizeof(deadline_t);
+
+inline deadline_t now_ms() noexcept {
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<deadline_t>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count());
+}
+
+/**
+ * @brief Extracts the TTL in milliseconds from the config of a collection.
+ * Leaves `ttl_ms` zero, if the config is empty or has no "ttl" field.
+ */
+inline void parse_ttl(ustore_str_view_t config, std::uint64_t& ttl_ms, ustore_error_t* c_error) noexcept {
+    ttl_ms = 0;
+    if (!config || !std::strlen(config))
+        return;
+    auto js = nlohmann::json::parse(config, nullptr, false);
+    if (js.is_discarded() || !js.is_object() || !js.contains("ttl"))
+        return;
+    auto const& j_ttl = js["ttl"];
+    return_error_if_m(j_ttl.is_number() && j_ttl.get<double>() > 0,
+                      c_error,
+                      args_wrong_k,
+                      "TTL must be a positive number of seconds");
+    ttl_ms = static_cast<std::uint64_t>(std::ceil(j_ttl.get<double>() * 1000));
+}
+
+inline deadline_t stored_deadline(value_view_t stored) noexcept {
+    deadline_t deadline;
+    std::memcpy(&deadline, stored.end() - deadline_bytes_k, deadline_bytes_k);
+    return deadline;
+}
+
+inline bool is_expired(value_view_t stored, deadline_t now) noexcept {
+    return stored.size() >= deadline_bytes_k && stored_deadline(stored) <= now;
+}
+
+/**
+ * @brief Strips the deadline from a value of a collection with a TTL.
+ * @return Missing view, if the value has expired.
+ */
+inline value_view_t unexpired(value_view_t stored, deadline_t now) noexcept {
+    if (stored.size() < deadline_bytes_k)
+        return stored;
+    if (stored_deadline(stored) <= now)
+        return value_view_t {};
+    return value_view_t {stored.data(), stored.size() - deadline_bytes_k};
+}
+
+/**
+ * @brief Copies the `contents` into the `stamped` tape, appending the deadlines to the values
+ * of collections with a TTL, and redirects the `contents` to the copies. Deletions stay missing.
+ * @param ttl_of Maps a collection to its TTL in milliseconds, or zero.
+ */
+template <typename ttl_of_at>
+void stamp_deadlines(places_arg_t const& places,
+                     contents_arg_t& contents,
+                     ttl_of_at&& ttl_of,
+                     growing_tape_t& stamped,
+                     ustore_bytes_cptr_t& stamped_begin,
+                     ustore_error_t* c_error) noexcept(false) {
+
+    deadline_t const now = now_ms();
+    std::string buffer;
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        value_view_t content = contents[i];
+        std::uint64_t const ttl = content ? ttl_of(places[i].collection) : 0;
+        if (!ttl) {
+            stamped.push_back(content, c_error);
+            return_if_error_m(c_error);
+            continue;
+        }
+        deadline_t const deadline = now + ttl;
+        buffer.assign(content.c_str(), content.size());
+        buffer.append(reinterpret_cast<char const*>(&deadline), deadline_bytes_k);
+        stamped.push_back(value_view_t {std::string_view(buffer)}, c_error);
+        return_if_error_m(c_error);
+    }
+
+    stamped_begin = reinterpret_cast<ustore_bytes_cptr_t>(stamped.contents().begin().get());
+    contents.presences_begin = {};
+    contents.offsets_begin = {stamped.offsets().begin().get(), sizeof(ustore_length_t)};
+    contents.lengths_begin = {stamped.lengths().begin().get(), sizeof(ustore_length_t)};
+    contents.contents_begin = {&stamped_begin, 0};
+}
+
+/**
+ * @brief TTLs of collections, consulted by every read and write. Lookups only take
+ * a shared lock, and are skipped entirely, until some collection has a TTL.
+ */
+template <typename collection_at>
+class ttls_gt {
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<collection_at, std::uint64_t> ttls_;
+    std::atomic<bool> any_ {false};
+
+  public:
+    bool any() const noexcept { return any_.load(std::memory_order_relaxed); }
+
+    std::uint64_t find(collection_at collection) const noexcept {
+        if (!any())
+            return 0;
+        std::shared_lock _ {mutex_};
+        auto it = ttls_.find(collection);
+        return it != ttls_.end() ? it->second : 0;
+    }
+
+    void set(collection_at collection, std::uint64_t ttl_ms) noexcept(false) {
+        std::unique_lock _ {mutex_};
+        if (ttl_ms)
+            ttls_[collection] = ttl_ms;
+        else
+            ttls_.erase(collection);
+        any_.store(!ttls_.empty(), std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Keys of collections with a TTL, bucketed by the second of their deadlines, so that
+ * the sweeper only visits the keys due for reclamation, instead of scanning the collections.
+ * Rewritten keys stay scheduled for their older deadlines too, so the sweeper must recheck
+ * the stored deadline before removing the key.
+ */
+template <typename key_at>
+class expiration_wheel_gt {
+    std::mutex mutex_;
+    std::map<deadline_t, std::vector<key_at>> buckets_;
+
+  public:
+    static constexpr deadline_t bucket_ms_k = 1000;
+
+    void schedule(deadline_t deadline, key_at key) noexcept(false) {
+        // Buckets are rounded up, to only become due, once all of their keys have expired
+        deadline_t const bucket = deadline / bucket_ms_k + 1;
+        std::unique_lock _ {mutex_};
+        buckets_[bucket].push_back(key);
+    }
+
+    /**
+     * @brief Moves the keys of buckets, that are due by `now`, into `due`.
+     */
+    void pop_due(deadline_t now, std::vector<key_at>& due) noexcept(false) {
+        std::unique_lock _ {mutex_};
+        auto end = buckets_.upper_bound(now / bucket_ms_k);
+        for (auto it = buckets_.begin(); it != end; ++it)
+            due.insert(due.end(), it->second.begin(), it->second.end());
+        buckets_.erase(buckets_.begin(), end);
+    }
+};
+
+/**
+ * @brief TTLs are part of the collection configs, which the engines don't persist on their own.
+ * So they are kept in a small JSON file next to the data, mapping names to milliseconds.
+ */
+inline std::filesystem::path ttls_path(std::filesystem::path const& directory) noexcept(false) {
+    return directory / "ttls.json";
+}
+
+inline std::map<std::string, std::uint64_t> load_ttls(std::filesystem::path const& directory) noexcept(false) {
+    std::map<std::string, std::uint64_t> ttls;
+    std::ifstream ifs(ttls_path(directory));
+    if (!ifs)
+        return ttls;
+    auto js = nlohmann::json::parse(ifs, nullptr, false);
+    if (js.is_object())
+        for (auto const& [name, ttl_ms] : js.items())
+            if (ttl_ms.is_number_unsigned())
+                ttls.emplace(name, ttl_ms.get<std::uint64_t>());
+    return ttls;
+}
+
+/**
+ * @brief Replaces the file atomically, so that a crash never leaves a half-written one.
+ */
+inline void save_ttls(std::filesystem::path const& directory,
+                      std::map<std::string, std::uint64_t> const& ttls) noexcept(false) {
+    nlohmann::json js = nlohmann::json::object();
+    for (auto const& [name, ttl_ms] : ttls)
+        js[name] = ttl_ms;
+    std::filesystem::path path = ttls_path(directory);
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream ofs(temporary_path, std::ios::trunc);
+        ofs << js.dump();
+    }
+    std::filesystem::rename(temporary_path, path);
+}
+
+} // namespace unum::ustore
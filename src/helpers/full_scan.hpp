@@ -5,12 +5,46 @@
  * @brief Callback-based full-scan over BLOB collection.
  */
 #pragma once
-#include <random>
+#include <random>    // `std::uniform_int_distribution`
+#include <algorithm> // `std::lower_bound`
 
 #include "ustore/blobs.h"
+#include "helpers/sampling.hpp"     // `thread_random_generator`
+#include "helpers/key_encoding.hpp" // `decode_key`
 
 namespace unum::ustore {
 
+/**
+ * @brief Fetches the values of the scanned keys, if the engine hasn't exported them during the scan.
+ */
+inline void read_blobs( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    ustore_key_t const* keys,
+    ustore_length_t count,
+    ustore_arena_t* arena,
+    ustore_error_t* error,
+    ustore_length_t*& offsets,
+    ustore_byte_t*& values) noexcept {
+
+    ustore_read_t read {};
+    read.db = db;
+    read.error = error;
+    read.transaction = transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = count;
+    read.collections = &collection;
+    read.collections_stride = 0;
+    read.keys = keys;
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &offsets;
+    read.values = &values;
+    ustore_read(&read);
+}
+
 template <typename callback_should_continue_at>
 void full_scan_collection( //
     ustore_database_t db,
@@ -27,6 +61,8 @@ void full_scan_collection( //
     while (!*error) {
         ustore_length_t* found_blobs_count {};
         ustore_key_t* found_blobs_keys {};
+        ustore_length_t* found_blobs_offsets {};
+        ustore_byte_t* found_blobs_data {};
         ustore_scan_t scan {};
         scan.db = db;
         scan.error = error;
@@ -39,36 +75,113 @@ void full_scan_collection( //
         scan.count_limits = &read_ahead;
         scan.counts = &found_blobs_count;
         scan.keys = &found_blobs_keys;
+        scan.values_offsets = &found_blobs_offsets;
+        scan.values = &found_blobs_data;
 
         ustore_scan(&scan);
         if (*error)
             break;
 
-        if (found_blobs_count[0] <= 1)
+        if (!found_blobs_count[0])
             // We have reached the end of collection
             break;
 
+        // Some engines export values in the same pass
+        if (!found_blobs_offsets)
+            read_blobs(db,
+                       transaction,
+                       collection,
+                       options,
+                       found_blobs_keys,
+                       found_blobs_count[0],
+                       arena,
+                       error,
+                       found_blobs_offsets,
+                       found_blobs_data);
+        if (*error)
+            break;
+
+        ustore_length_t const count_blobs = found_blobs_count[0];
+        joined_blobs_iterator_t found_blobs {found_blobs_offsets, found_blobs_data};
+        for (std::size_t i = 0; i != count_blobs; ++i, ++found_blobs) {
+            value_view_t bucket = *found_blobs;
+            if (!callback_should_continue(found_blobs_keys[i], bucket))
+                return;
+        }
+
+        ustore_key_t const last_key = found_blobs_keys[count_blobs - 1];
+        if (count_blobs < read_ahead || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
+    }
+}
+
+/**
+ * @brief Callback-based scan over the `[start_key, end_key)` range of a collection.
+ * Unlike `full_scan_collection`, uses a separate arena, which is recycled between
+ * batches, bounding the memory usage. Different threads can scan in parallel,
+ * if each has its own arena and the underlying engine is thread-safe.
+ */
+template <typename callback_should_continue_at>
+void scan_range_collection( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    ustore_key_t start_key,
+    ustore_key_t end_key,
+    ustore_length_t read_ahead,
+    ustore_arena_t* arena,
+    ustore_error_t* error,
+    callback_should_continue_at&& callback_should_continue) noexcept {
+
+    read_ahead = std::max<ustore_length_t>(read_ahead, 2u);
+    options = ustore_options_t(options & ~ustore_option_dont_discard_memory_k);
+    while (!*error && start_key < end_key) {
+        ustore_length_t* found_blobs_count {};
+        ustore_key_t* found_blobs_keys {};
         ustore_length_t* found_blobs_offsets {};
         ustore_byte_t* found_blobs_data {};
-        ustore_read_t read {};
-        read.db = db;
-        read.error = error;
-        read.transaction = transaction;
-        read.arena = arena;
-        read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
-        read.tasks_count = found_blobs_count[0];
-        read.collections = &collection;
-        read.collections_stride = 0;
-        read.keys = found_blobs_keys;
-        read.keys_stride = sizeof(ustore_key_t);
-        read.offsets = &found_blobs_offsets;
-        read.values = &found_blobs_data;
-
-        ustore_read(&read);
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = error;
+        scan.transaction = transaction;
+        scan.arena = arena;
+        scan.options = options;
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &read_ahead;
+        scan.counts = &found_blobs_count;
+        scan.keys = &found_blobs_keys;
+        scan.values_offsets = &found_blobs_offsets;
+        scan.values = &found_blobs_data;
+
+        ustore_scan(&scan);
+        if (*error || !found_blobs_count[0])
+            break;
+
+        // Trim the keys outside of the range
+        ustore_length_t const count_scanned = found_blobs_count[0];
+        ustore_length_t const count_blobs = static_cast<ustore_length_t>(
+            std::lower_bound(found_blobs_keys, found_blobs_keys + count_scanned, end_key) - found_blobs_keys);
+        if (!count_blobs)
+            break;
+
+        if (!found_blobs_offsets)
+            read_blobs(db,
+                       transaction,
+                       collection,
+                       options,
+                       found_blobs_keys,
+                       count_blobs,
+                       arena,
+                       error,
+                       found_blobs_offsets,
+                       found_blobs_data);
         if (*error)
             break;
 
-        ustore_length_t const count_blobs = found_blobs_count[0];
         joined_blobs_iterator_t found_blobs {found_blobs_offsets, found_blobs_data};
         for (std::size_t i = 0; i != count_blobs; ++i, ++found_blobs) {
             value_view_t bucket = *found_blobs;
@@ -76,34 +189,57 @@ void full_scan_collection( //
                 return;
         }
 
-        start_key = found_blobs_keys[count_blobs - 1] + 1;
+        ustore_key_t const last_key = found_blobs_keys[count_blobs - 1];
+        if (count_blobs < read_ahead || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
     }
 }
 
+struct all_visible_t {
+    template <typename iterator_at>
+    bool operator()(iterator_at const&) const noexcept {
+        return true;
+    }
+};
+
 /**
  * @brief Implements reservoir sampling for RocksDB or LevelDB collections.
+ * Entries, rejected by the `is_visible` predicate, like expired ones, aren't sampled.
+ * @return The number of keys filled, which is smaller than requested for small collections.
  * @see https://en.wikipedia.org/wiki/Reservoir_sampling
  */
-template <typename level_or_rocks_iterator_at>
-void reservoir_sample_iterator(level_or_rocks_iterator_at&& iterator,
-                               ptr_range_gt<ustore_key_t> sampled_keys,
-                               ustore_error_t* c_error) noexcept {
+template <typename level_or_rocks_iterator_at, typename is_visible_at = all_visible_t>
+std::size_t reservoir_sample_iterator(level_or_rocks_iterator_at&& iterator,
+                                      ptr_range_gt<ustore_key_t> sampled_keys,
+                                      key_encoding_t encoding,
+                                      ustore_error_t* c_error,
+                                      is_visible_at&& is_visible = {}) noexcept {
 
-    std::random_device random_device;
-    std::mt19937 random_generator(random_device());
+    random_generator_t& random_generator = thread_random_generator();
     std::uniform_int_distribution<ustore_key_t> dist(std::numeric_limits<ustore_key_t>::min());
 
     std::size_t i = 0;
-    for (iterator->SeekToFirst(); i < sampled_keys.size(); ++i, iterator->Next()) {
-        return_error_if_m(iterator->Valid(), c_error, 0, "Sample Failure!");
-        std::memcpy(&sampled_keys[i], iterator->key().data(), sizeof(ustore_key_t));
+    for (iterator->SeekToFirst(); i < sampled_keys.size() && iterator->Valid(); iterator->Next()) {
+        if (!is_visible(iterator))
+            continue;
+        sampled_keys[i] = decode_key(iterator->key().data(), encoding);
+        ++i;
     }
+    std::size_t const filled = i;
 
-    for (std::size_t j = 0; iterator->Valid(); ++i, iterator->Next()) {
+    for (std::size_t j = 0; iterator->Valid(); iterator->Next()) {
+        if (!is_visible(iterator))
+            continue;
         j = dist(random_generator) % (i + 1);
         if (j < sampled_keys.size())
-            std::memcpy(&sampled_keys[j], iterator->key().data(), sizeof(ustore_key_t));
+            sampled_keys[j] = decode_key(iterator->key().data(), encoding);
+        ++i;
     }
+
+    if (!iterator->status().ok())
+        *c_error = "Sample Failure!";
+    return filled;
 }
 
 } // namespace unum::ustore
@@ -0,0 +1,111 @@
+/**
+ * @file key_encoding.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Serialization of integer keys for engines, that order keys as byte strings.
+ */
+#pragma once
+#include <cstdint>    // `std::uint64_t`
+#include <cstring>    // `std::memcpy`
+#include <filesystem> // `std::filesystem::path`
+
+#include "ustore/db.h"
+
+namespace unum::ustore {
+
+/**
+ * @brief Layout of the keys, passed to the persistent engines.
+ *
+ * - `native_k`: host byte order, that requires a custom comparator, reinterpreting
+ *   every key as a signed integer. Used by the databases created before the ordered one.
+ * - `ordered_k`: big-endian with a flipped sign bit, so that the bytewise order of encoded
+ *   keys matches the numeric one, and the engines can use their built-in comparators.
+ */
+enum class key_encoding_t {
+    native_k,
+    ordered_k,
+};
+
+/**
+ * @brief Owns the bytes of an encoded key, while the engine references them.
+ */
+struct encoded_key_t {
+    char bytes[sizeof(ustore_key_t)];
+
+    char const* data() const noexcept { return bytes; }
+    std::size_t size() const noexcept { return sizeof(ustore_key_t); }
+};
+
+inline std::uint64_t flip_order(std::uint64_t bits) noexcept {
+    bits ^= std::uint64_t(1) << 63;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    bits = __builtin_bswap64(bits);
+#endif
+    return bits;
+}
+
+inline std::uint64_t unflip_order(std::uint64_t bits) noexcept {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    bits = __builtin_bswap64(bits);
+#endif
+    return bits ^ (std::uint64_t(1) << 63);
+}
+
+inline encoded_key_t encode_key(ustore_key_t key, key_encoding_t encoding) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, &key, sizeof(ustore_key_t));
+    if (encoding == key_encoding_t::ordered_k)
+        bits = flip_order(bits);
+    encoded_key_t encoded;
+    std::memcpy(encoded.bytes, &bits, sizeof(ustore_key_t));
+    return encoded;
+}
+
+inline ustore_key_t decode_key(char const* bytes, key_encoding_t encoding) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, bytes, sizeof(ustore_key_t));
+    if (encoding == key_encoding_t::ordered_k)
+        bits = unflip_order(bits);
+    ustore_key_t key;
+    std::memcpy(&key, &bits, sizeof(ustore_key_t));
+    return key;
+}
+
+/**
+ * @brief Re-encodes a key of a `key_encoding_t::native_k` database for the `key_encoding_t::ordered_k`.
+ */
+inline encoded_key_t migrate_key(char const* bytes) noexcept {
+    return encode_key(decode_key(bytes, key_encoding_t::native_k), key_encoding_t::ordered_k);
+}
+
+/**
+ * @brief Directories, involved in migrating a database to the `key_encoding_t::ordered_k`.
+ * The contents are copied into the `staging` directory, which then replaces the `root`,
+ * while the original one is kept as the `backup`, until the user removes it.
+ */
+struct key_migration_t {
+    std::filesystem::path root;
+    std::filesystem::path staging;
+    std::filesystem::path backup;
+
+    key_migration_t(std::filesystem::path const& directory) noexcept(false) : root(directory) {
+        // With a trailing separator the siblings would become nested directories
+        if (!root.has_filename())
+            root = root.parent_path();
+        staging = root;
+        staging += ".migrating";
+        backup = root;
+        backup += ".legacy";
+    }
+
+    /**
+     * @brief Swaps the directories, once the staging one is complete,
+     * and neither of them is opened by the engine.
+     */
+    void commit() const noexcept(false) {
+        std::filesystem::rename(root, backup);
+        std::filesystem::rename(staging, root);
+    }
+};
+
+} // namespace unum::ustore
@@ -63,7 +63,7 @@ class limited_priority_queue_gt {
     bool empty() const noexcept { return !length_; }
 
     /**
-     * @brief
+     * @brief Inserts an element, evicting the lowest priority one, if the capacity is exhausted.
      *
      * @return true If insertion succeeded.
      * @return false If the priority of the input was to low to keep it.
@@ -75,26 +75,30 @@ class limited_priority_queue_gt {
         auto end = ptr_ + length_;
         auto element_ptr = std::lower_bound(ptr_, end, element, &higher_priority);
         if (element_ptr == end) {
-            if (length_ < capacity_) {
-                new (end) element_t(std::move(element));
-                ++length_;
-                return true;
-            }
-            else
-                return false;
-        }
-        else {
             if (length_ == capacity_)
-                std::destroy_at(ptr_ + capacity_ - 1);
-            auto source_ptr = element_ptr;
-            for (; source_ptr + 1 != end; ++source_ptr)
-                source_ptr[1] = std::move(source_ptr[0]);
-            *element_ptr = std::move(element);
-            length_ += length_ < capacity_;
+                return false;
+            new (end) element_t(std::move(element));
+            ++length_;
             return true;
         }
+
+        // Shift the tail, growing the container if there is still space,
+        // or dropping the lowest priority element otherwise.
+        if (length_ < capacity_) {
+            new (end) element_t(std::move(end[-1]));
+            ++length_;
+        }
+        std::move_backward(element_ptr, end - 1, end);
+        *element_ptr = std::move(element);
+        return true;
     }
 
+    /**
+     * @brief Lowest priority element, that will be the first to be evicted.
+     */
+    element_t const& back() const noexcept { return ptr_[length_ - 1]; }
+    bool full() const noexcept { return length_ == capacity_; }
+
     constexpr static std::size_t implicit_memory_usage(std::size_t capacity) noexcept {
         return sizeof(std::size_t) * 3 + sizeof(element_t) * capacity;
     }
@@ -5,7 +5,11 @@
  * @brief Helper functions Polymorphic Memory Allocators.
  */
 #pragma once
-#include <sys/mman.h> // `mmap`
+#include <sys/mman.h> // `mmap`, `shm_open`
+#include <fcntl.h>    // `O_CREAT`
+#include <unistd.h>   // `ftruncate`, `getpid`
+#include <atomic>     // `std::atomic`
+#include <cstdio>     // `std::snprintf`
 #include <limits.h>   // `CHAR_BIT`
 #include <cstring>    // `std::memcpy`
 #include <stdexcept>  // `std::runtime_error`
@@ -19,20 +23,53 @@
 
 namespace unum::ustore {
 
+/**
+ * @brief Process-wide counters of sub-arena allocations,
+ * reported with the other metrics by `ustore_database_control()`.
+ */
+struct arenas_stats_t {
+    std::atomic<std::size_t> allocations {0};
+    std::atomic<std::size_t> allocated_bytes {0};
+    std::atomic<std::size_t> huge_allocations {0};
+    std::atomic<std::size_t> refits {0};
+    std::atomic<std::size_t> max_peak {0};
+};
+
+inline arenas_stats_t& arenas_stats() noexcept {
+    static arenas_stats_t stats;
+    return stats;
+}
+
 struct linked_memory_t {
     static constexpr std::size_t initial_size_k = 1024ul * 1024ul;
     static constexpr std::size_t growth_factor_k = 2ul;
+    static constexpr std::size_t huge_page_size_k = 2ul * 1024ul * 1024ul;
 
     struct arena_header_t;
     arena_header_t* first_ptr_ = nullptr;
 
+    /**
+     * @brief Shared arenas are named POSIX shared memory objects, so that other
+     * processes on the same host can map them by name. The name is unlinked, when
+     * the arena is released, unless it was handed off to another process.
+     */
+    static constexpr std::size_t shared_name_length_k = 32;
+
     enum class kind_t { sys_k = 0, shared_k, unified_k };
     struct arena_header_t {
         arena_header_t* next = nullptr;
         std::size_t capacity = 0;
         std::size_t used = 0;
+        /// Decaying maximum of the usage between releases, only tracked in the first sub-arena.
+        std::size_t recent_peak = 0;
         kind_t kind = kind_t::sys_k;
         bool can_release_memory = false;
+        bool is_handed_off = false;
+        /// Private sub-arenas, backed by huge pages, are mapped instead of being `malloc`-ed.
+        bool is_mapped = false;
+        /// Requested with `::ustore_option_huge_pages_k`, only tracked in the first sub-arena.
+        bool prefers_huge_pages = false;
+        char shared_name[shared_name_length_k] = {};
 
         void* alloc_internally(std::size_t length, std::size_t alignment) noexcept {
             auto arena_start = std::intptr_t(this);
@@ -47,12 +84,65 @@ struct linked_memory_t {
         }
     };
 
-    static arena_header_t* alloc_arena(std::size_t length, kind_t kind) noexcept {
+    static void* map_shared(std::size_t length, char* name) noexcept {
+        static std::atomic<std::size_t> shared_arenas_count {0};
+        std::snprintf(name, shared_name_length_k, "/ustore-%d-%zu", int(getpid()), shared_arenas_count++);
+        int descriptor = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (descriptor < 0)
+            return nullptr;
+
+        void* begin = MAP_FAILED;
+        if (ftruncate(descriptor, static_cast<off_t>(length)) == 0)
+            begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (begin != MAP_FAILED)
+            return begin;
+        shm_unlink(name);
+        return nullptr;
+    }
+
+    /**
+     * @brief Maps private memory, preferring the pre-reserved `MAP_HUGETLB` pages.
+     * If none are available, falls back to regular pages, advising the kernel
+     * to back them with Transparent Huge Pages.
+     */
+    static void* map_private_huge(std::size_t length, bool& is_huge) noexcept {
+        void* begin = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+        begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        is_huge = begin != MAP_FAILED;
+#endif
+        if (begin == MAP_FAILED)
+            begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (begin == MAP_FAILED)
+            return nullptr;
+#if defined(MADV_HUGEPAGE)
+        if (!is_huge)
+            madvise(begin, length, MADV_HUGEPAGE);
+#endif
+        return begin;
+    }
+
+    static arena_header_t* alloc_arena(std::size_t length, kind_t kind, bool huge_pages = false) noexcept {
         void* begin = nullptr;
+        char shared_name[shared_name_length_k] = {};
+        bool is_mapped = false;
+        bool is_huge = false;
+        if (huge_pages)
+            length = next_multiple(length, huge_page_size_k);
         switch (kind) {
-        case kind_t::sys_k: begin = std::malloc(length); break;
+        case kind_t::sys_k:
+            begin = huge_pages ? map_private_huge(length, is_huge) : std::malloc(length);
+            is_mapped = huge_pages;
+            break;
         case kind_t::shared_k:
-            begin = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+            // POSIX shared memory lives on "tmpfs", which can't use `MAP_HUGETLB`,
+            // but can be backed with Transparent Huge Pages, if the system allows.
+            begin = map_shared(length, shared_name);
+#if defined(MADV_HUGEPAGE)
+            if (begin && huge_pages)
+                madvise(begin, length, MADV_HUGEPAGE);
+#endif
             break;
         case kind_t::unified_k: break;
         }
@@ -61,31 +151,66 @@ struct linked_memory_t {
             return nullptr;
 
         std::memset(header_ptr, 0, sizeof(arena_header_t));
+        std::memcpy(header_ptr->shared_name, shared_name, shared_name_length_k);
         header_ptr->kind = kind;
         header_ptr->capacity = length;
         header_ptr->used = sizeof(arena_header_t);
+        header_ptr->is_mapped = is_mapped;
+
+        arenas_stats_t& stats = arenas_stats();
+        stats.allocations.fetch_add(1, std::memory_order_relaxed);
+        stats.allocated_bytes.fetch_add(length, std::memory_order_relaxed);
+        stats.huge_allocations.fetch_add(is_huge, std::memory_order_relaxed);
         return header_ptr;
     }
 
     static void release_arena(arena_header_t* arena) noexcept {
         switch (arena->kind) {
-        case kind_t::sys_k: std::free(arena); break;
-        case kind_t::shared_k: munmap(arena, arena->capacity); break;
+        case kind_t::sys_k:
+            if (arena->is_mapped)
+                munmap(arena, arena->capacity);
+            else
+                std::free(arena);
+            break;
+        case kind_t::shared_k: {
+            char shared_name[shared_name_length_k];
+            std::memcpy(shared_name, arena->shared_name, shared_name_length_k);
+            bool const should_unlink = !arena->is_handed_off;
+            munmap(arena, arena->capacity);
+            if (should_unlink)
+                shm_unlink(shared_name);
+            break;
+        }
         case kind_t::unified_k: break;
         }
     }
 
     arena_header_t& first_ref() noexcept { return *reinterpret_cast<arena_header_t*>(first_ptr_); }
 
-    bool start_if_null(kind_t kind) noexcept {
+    bool start_if_null(kind_t kind, bool huge_pages) noexcept {
         if (first_ptr_ && first_ptr_->kind == kind)
             return true;
 
-        first_ptr_ = alloc_arena(initial_size_k, kind);
-        first_ptr_->can_release_memory = true;
+        // Switching the kind of memory is only possible, if no one is using the old one
+        if (first_ptr_ && !first_ptr_->can_release_memory)
+            return false;
+        release_all();
+        first_ptr_ = alloc_arena(initial_size_k, kind, huge_pages);
+        if (first_ptr_)
+            first_ptr_->can_release_memory = true;
         return first_ptr_;
     }
 
+    /**
+     * @brief Finds the sub-arena, that contains the `ptr`, if any.
+     */
+    arena_header_t* find(void const* ptr) const noexcept {
+        for (arena_header_t* current = first_ptr_; current; current = current->next)
+            if (ptr >= (void const*)current && ptr < (void const*)((byte_t const*)current + current->capacity))
+                return current;
+        return nullptr;
+    }
+
     bool lock_release_calls() noexcept { return std::exchange(first_ref().can_release_memory, false); }
     void unlock_release_calls() noexcept { first_ref().can_release_memory = true; }
 
@@ -105,7 +230,7 @@ struct linked_memory_t {
 
     void* alloc(std::size_t length, std::size_t alignment) noexcept {
 
-        if (!length)
+        if (!length || !first_ptr_)
             return nullptr;
 
         arena_header_t* current = first_ptr_;
@@ -119,7 +244,7 @@ struct linked_memory_t {
 
         // We need to append a new even bigger bucket.
         auto new_capacity = std::max(last->capacity * growth_factor_k, length + alignment + sizeof(arena_header_t));
-        auto new_arena = alloc_arena(new_capacity, first_ref().kind);
+        auto new_arena = alloc_arena(new_capacity, first_ref().kind, first_ref().prefers_huge_pages);
         if (!new_arena)
             return nullptr;
 
@@ -134,14 +259,60 @@ struct linked_memory_t {
         first_ptr_ = nullptr;
     }
 
+    /**
+     * @brief Total number of bytes allocated from all the sub-arenas.
+     */
+    std::size_t used() const noexcept {
+        std::size_t result = 0;
+        for (arena_header_t* current = first_ptr_; current; current = current->next)
+            result += current->used - sizeof(arena_header_t);
+        return result;
+    }
+
+    /**
+     * @brief Discards all the data, leaving a single sub-arena. It is refitted to the recent
+     * peak usage, if the last workload didn't fit into it, or if it is excessively large.
+     * The peak decays by an eighth on every release, so a single outlier doesn't keep
+     * a huge sub-arena alive for long, while the steady state doesn't touch the allocator.
+     */
     void release_partially() noexcept {
         if (!first_ptr_)
             return;
-        arena_header_t* current = first_ptr_->next;
+
+        arena_header_t& first = first_ref();
+        std::size_t const usage = used();
+        std::size_t const peak = std::max(usage, first.recent_peak - first.recent_peak / 8);
+        std::size_t const fitting = next_power_of_two(std::max(peak + sizeof(arena_header_t), initial_size_k));
+        bool const is_chained = first.next;
+        bool const is_oversized = first.capacity > fitting * 8;
+        update_max(arenas_stats().max_peak, usage);
+
+        if ((is_chained && fitting > first.capacity) || is_oversized) {
+            arena_header_t* refitted = alloc_arena(fitting, first.kind, first.prefers_huge_pages);
+            if (refitted) {
+                refitted->recent_peak = peak;
+                refitted->prefers_huge_pages = first.prefers_huge_pages;
+                refitted->can_release_memory = first.can_release_memory;
+                release_all();
+                first_ptr_ = refitted;
+                arenas_stats().refits.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        arena_header_t* current = first.next;
         while (current != nullptr)
             release_arena(std::exchange(current, current->next));
-        first_ptr_->next = nullptr;
-        first_ptr_->used = sizeof(arena_header_t);
+        first.next = nullptr;
+        first.used = sizeof(arena_header_t);
+        first.recent_peak = peak;
+    }
+
+  private:
+    static void update_max(std::atomic<std::size_t>& max, std::size_t value) noexcept {
+        std::size_t current = max.load(std::memory_order_relaxed);
+        while (current < value && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            ;
     }
 };
 
@@ -166,11 +337,17 @@ struct linked_memory_lock_t {
 
     operator ustore_arena_t*() const noexcept { return (ustore_arena_t*)&memory.first_ptr_; }
 
-    linked_memory_lock_t(linked_memory_t& memory, linked_memory_t::kind_t kind, bool keep_old_data = false) noexcept
+    linked_memory_lock_t(linked_memory_t& memory,
+                         linked_memory_t::kind_t kind,
+                         bool keep_old_data = false,
+                         bool huge_pages = false) noexcept
         : memory(memory) {
-        if (memory.start_if_null(kind))
-            if ((owns_the_lock = memory.lock_release_calls()) && !keep_old_data)
-                memory.release_partially();
+        if (memory.start_if_null(kind, huge_pages))
+            if ((owns_the_lock = memory.lock_release_calls())) {
+                memory.first_ref().prefers_huge_pages = huge_pages;
+                if (!keep_old_data)
+                    memory.release_partially();
+            }
     }
 
     ~linked_memory_lock_t() noexcept {
@@ -247,8 +424,9 @@ inline linked_memory_lock_t linked_memory(ustore_arena_t* c_arena, ustore_option
                                        ? linked_memory_t::kind_t::shared_k
                                        : linked_memory_t::kind_t::sys_k;
     bool keep_old_data = options & ustore_option_dont_discard_memory_k;
+    bool huge_pages = options & ustore_option_huge_pages_k;
 
-    return linked_memory_lock_t(ref, kind, keep_old_data);
+    return linked_memory_lock_t(ref, kind, keep_old_data, huge_pages);
 }
 
 inline void clear_linked_memory(ustore_arena_t& c_arena) noexcept {
@@ -5,7 +5,10 @@
  * @brief Least-Recently Used cache
  */
 #pragma once
-#include "helpers.hpp"
+#include <list>          // `std::list`
+#include <unordered_map> // `std::unordered_map`
+#include <optional>      // `std::optional`
+#include <functional>    // `std::reference_wrapper`
 
 namespace unum::ustore {
 
@@ -56,22 +59,11 @@ class lru_cache_gt {
     value_type const* get_ptr(key_type const& key) {
         auto i = map_.find(key);
         if (i == map_.end())
-            return std::nullopt;
-
-        auto j = i->second.second;
-        if (j != list_.begin()) {
-            list_.erase(j);
-            list_.push_front(key);
-
-            // update iterator in map
-            j = list_.begin();
-            value_type const& value = i->second.first;
-            map_[key] = std::make_pair(value, j);
-            return &value;
-        }
+            return nullptr;
 
-        // the item is already at the front of the most recently
-        // used list so just return it
+        // Move the item to the front of the most recently used list,
+        // without invalidating the iterator stored in the map
+        list_.splice(list_.begin(), list_, i->second.second);
         return &i->second.first;
     }
 
@@ -80,16 +72,8 @@ class lru_cache_gt {
         if (i == map_.end())
             return std::nullopt;
 
-        value_type result;
-        auto j = i->second.second;
-        if (j != list_.begin()) {
-            std::swap(result, i->second.first);
-            list_.erase(j);
-        }
-        else {
-            std::swap(result, list_.front());
-            list_.pop_front();
-        }
+        value_type result = std::move(i->second.first);
+        list_.erase(i->second.second);
         map_.erase(i);
         return result;
     }
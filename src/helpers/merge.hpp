@@ -0,0 +1,120 @@
+/**
+ * @file merge.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Merge operands, that modalities write with `ustore_option_write_merge_k`,
+ * shared by engines and modalities.
+ */
+#pragma once
+#include <cstring> // `std::memcpy`
+#include <string>  // `std::string`
+
+#include "ustore/db.h"
+#include "ustore/blobs.h"
+#include "ustore/cpp/types.hpp"       // `value_view_t`
+#include "ustore/cpp/ranges_args.hpp" // `contents_arg_t`
+#include "linked_array.hpp"           // `growing_tape_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Combines the `stored` value with a merge `operand`, produced by a modality,
+ * or by a positional write. The Docs modality defines this function, handling its own
+ * operands and forwarding the splices to `splice_operand`.
+ * Engines call it while applying the merges atomically, either eagerly on write,
+ * or lazily on reads and compactions, like RocksDB.
+ *
+ * @param stored The current value, or a missing view, if there is no such key.
+ * @param merged Output for the new value, which is cleared beforehand.
+ * @return NULL on success, or the error message, if the operand can't be applied.
+ */
+ustore_error_t merge_operand(value_view_t stored, value_view_t operand, std::string& merged) noexcept;
+
+/**
+ * @brief Leading byte of the operands of positional writes, which Docs modifications never use.
+ * It's followed by the position in the stored value and the written bytes.
+ */
+constexpr byte_t splice_marker_k = byte_t(0x7F);
+constexpr std::size_t splice_header_k = 1 + sizeof(ustore_length_t);
+
+inline bool is_splice_operand(value_view_t operand) noexcept {
+    return operand.size() >= splice_header_k && operand.data()[0] == splice_marker_k;
+}
+
+/**
+ * @brief Overwrites a part of the `stored` value, starting at the position in the `operand`,
+ * extending it with zeros, if needed. `ustore_length_missing_k` appends to the end.
+ */
+inline void splice_operand(value_view_t stored, value_view_t operand, std::string& merged) noexcept(false) {
+    ustore_length_t position;
+    std::memcpy(&position, operand.data() + 1, sizeof(ustore_length_t));
+    value_view_t bytes {operand.data() + splice_header_k, operand.size() - splice_header_k};
+    std::size_t const start = position == ustore_length_missing_k ? stored.size() : position;
+
+    merged.assign(stored.c_str(), stored.size());
+    if (merged.size() < start + bytes.size())
+        merged.resize(start + bytes.size(), '\0');
+    std::memcpy(merged.data() + start, bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Implements the `ustore_write_t::positions` for engines with merge operators,
+ * by passing the positions and the contents as splice operands to their `ustore_write()`.
+ */
+inline void write_spliced(ustore_write_t const& c, linked_memory_lock_t& arena) noexcept {
+
+    return_error_if_m(!(c.options & ustore_option_write_merge_k),
+                      c.error,
+                      args_combo_k,
+                      "Positional writes can't be merged!");
+    return_error_if_m(!(c.options & ustore_option_write_bulk_k),
+                      c.error,
+                      args_combo_k,
+                      "Positional writes can't be bulk!");
+
+    strided_iterator_gt<ustore_length_t const> positions {c.positions, c.positions_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values, c.values_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.lengths, c.lengths_stride};
+    bits_view_t presences {c.presences};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+
+    // Missing contents remain missing, removing the values
+    growing_tape_t operands(arena);
+    operands.reserve(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    safe_section("Packing splices", c.error, [&] {
+        std::string operand;
+        for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
+            value_view_t content = contents[i];
+            if (!content) {
+                operands.push_back(content, c.error);
+                continue;
+            }
+            ustore_length_t const position = positions[i];
+            operand.resize(splice_header_k);
+            operand[0] = static_cast<char>(splice_marker_k);
+            std::memcpy(operand.data() + 1, &position, sizeof(ustore_length_t));
+            operand.append(content.c_str(), content.size());
+            operands.push_back(value_view_t {std::string_view(operand)}, c.error);
+        }
+    });
+    return_if_error_m(c.error);
+
+    auto operands_begin = reinterpret_cast<ustore_bytes_cptr_t>(operands.contents().begin().get());
+    ustore_write_t write = c;
+    write.arena = arena;
+    write.options = ustore_options_t(c.options | ustore_option_write_merge_k | ustore_option_dont_discard_memory_k);
+    write.presences = operands.presences().get();
+    write.offsets = operands.offsets().begin().get();
+    write.offsets_stride = operands.offsets().stride();
+    write.lengths = operands.lengths().begin().get();
+    write.lengths_stride = operands.lengths().stride();
+    write.values = &operands_begin;
+    write.values_stride = 0;
+    write.positions = nullptr;
+    write.positions_stride = 0;
+    ustore_write(&write);
+}
+
+} // namespace unum::ustore
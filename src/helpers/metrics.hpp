@@ -0,0 +1,411 @@
+/**
+ * @file metrics.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Per-operation counters, latency histograms, arena and read cache statistics,
+ * exported through `ustore_database_control()`.
+ */
+#pragma once
+#include <array>     // `std::array`
+#include <atomic>    // `std::atomic`
+#include <chrono>    // `std::chrono::steady_clock`
+#include <mutex>     // `std::mutex`
+#include <vector>    // `std::vector`
+#include <memory>    // `std::unique_ptr`
+#include <string>    // `std::string`
+#include <cstring>   // `std::strcmp`
+#include <algorithm> // `std::find`
+
+#include "ustore/db.h"
+#include "helpers/linked_memory.hpp" // `linked_memory_lock_t`, `arenas_stats()`
+#include "helpers/read_cache.hpp"    // `read_caches_stats()`
+
+namespace unum::ustore {
+
+/**
+ * @brief Public entry points, which calls are timed.
+ * Modalities are implemented on top of the binary interface,
+ * so their calls are also reflected in the binary operations.
+ */
+enum class operation_t : std::size_t {
+    read_k = 0,
+    write_k,
+    scan_k,
+    sample_k,
+    measure_k,
+    commit_k,
+    docs_write_k,
+    docs_read_k,
+    docs_gather_k,
+    docs_find_k,
+    docs_scan_k,
+    graph_find_edges_k,
+    graph_upsert_edges_k,
+    graph_remove_edges_k,
+    graph_traverse_k,
+    paths_write_k,
+    paths_read_k,
+    paths_match_k,
+    vectors_write_k,
+    vectors_read_k,
+    vectors_search_k,
+    count_k,
+};
+
+static constexpr std::size_t operations_count_k = static_cast<std::size_t>(operation_t::count_k);
+
+inline char const* operation_name(std::size_t operation_idx) noexcept {
+    static constexpr char const* names_k[operations_count_k] = {
+        "read",
+        "write",
+        "scan",
+        "sample",
+        "measure",
+        "commit",
+        "docs_write",
+        "docs_read",
+        "docs_gather",
+        "docs_find",
+        "docs_scan",
+        "graph_find_edges",
+        "graph_upsert_edges",
+        "graph_remove_edges",
+        "graph_traverse",
+        "paths_write",
+        "paths_read",
+        "paths_match",
+        "vectors_write",
+        "vectors_read",
+        "vectors_search",
+    };
+    return names_k[operation_idx];
+}
+
+/**
+ * @brief Log-linear buckets of latencies in nanoseconds, like in HDR Histograms.
+ * Every power of two is split into `latency_sub_buckets_k` equal parts, so the
+ * relative error of any percentile is bounded, regardless of the magnitude.
+ * The last bucket absorbs everything longer than an hour.
+ */
+static constexpr std::size_t latency_sub_bits_k = 3;
+static constexpr std::size_t latency_sub_buckets_k = 1ul << latency_sub_bits_k;
+static constexpr std::size_t latency_buckets_k = 40 * latency_sub_buckets_k;
+
+inline std::size_t latency_bucket(std::uint64_t nanoseconds) noexcept {
+    if (nanoseconds < latency_sub_buckets_k)
+        return static_cast<std::size_t>(nanoseconds);
+    std::size_t const magnitude = 63 - __builtin_clzll(nanoseconds);
+    std::size_t const sub_bucket = (nanoseconds >> (magnitude - latency_sub_bits_k)) & (latency_sub_buckets_k - 1);
+    std::size_t const bucket = (magnitude - latency_sub_bits_k + 1) * latency_sub_buckets_k + sub_bucket;
+    return std::min(bucket, latency_buckets_k - 1);
+}
+
+/**
+ * @brief Smallest latency, that falls into the `bucket`.
+ * The exclusive upper bound is the lower bound of the next one.
+ */
+inline std::uint64_t latency_bucket_lower(std::size_t bucket) noexcept {
+    std::size_t const group = bucket / latency_sub_buckets_k;
+    std::uint64_t const sub_bucket = bucket % latency_sub_buckets_k;
+    return group ? (latency_sub_buckets_k + sub_bucket) << (group - 1) : sub_bucket;
+}
+
+/**
+ * @brief Counters of a single operation. Instantiated with atomics for the
+ * thread-local counters, that have a single writer, and with plain integers
+ * for the aggregated results.
+ */
+template <typename counter_at>
+struct operation_stats_gt {
+    counter_at calls {};
+    counter_at failures {};
+    counter_at tasks {};
+    counter_at nanoseconds {};
+    std::array<counter_at, latency_buckets_k> buckets {};
+};
+
+using operation_stats_t = operation_stats_gt<std::uint64_t>;
+using operations_stats_t = std::array<operation_stats_t, operations_count_k>;
+using thread_metrics_t = std::array<operation_stats_gt<std::atomic<std::uint64_t>>, operations_count_k>;
+
+/**
+ * @brief Process-wide list of the thread-local counters. Threads only touch the
+ * registry when they start or exit, and readers merge all the counters on demand.
+ * Counters of exited threads are accumulated separately, to remain monotonic.
+ */
+class metrics_registry_t {
+    std::mutex mutex_;
+    std::vector<thread_metrics_t const*> threads_;
+    operations_stats_t retired_ {};
+
+    static void accumulate(thread_metrics_t const& thread, operations_stats_t& stats) noexcept {
+        for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx) {
+            auto const& from = thread[operation_idx];
+            operation_stats_t& to = stats[operation_idx];
+            to.calls += from.calls.load(std::memory_order_relaxed);
+            to.failures += from.failures.load(std::memory_order_relaxed);
+            to.tasks += from.tasks.load(std::memory_order_relaxed);
+            to.nanoseconds += from.nanoseconds.load(std::memory_order_relaxed);
+            for (std::size_t bucket = 0; bucket != latency_buckets_k; ++bucket)
+                to.buckets[bucket] += from.buckets[bucket].load(std::memory_order_relaxed);
+        }
+    }
+
+  public:
+    void attach(thread_metrics_t const& thread) {
+        std::lock_guard _ {mutex_};
+        threads_.push_back(&thread);
+    }
+
+    void detach(thread_metrics_t const& thread) noexcept {
+        std::lock_guard _ {mutex_};
+        accumulate(thread, retired_);
+        threads_.erase(std::find(threads_.begin(), threads_.end(), &thread));
+    }
+
+    operations_stats_t collect() noexcept {
+        std::lock_guard _ {mutex_};
+        operations_stats_t stats = retired_;
+        for (thread_metrics_t const* thread : threads_)
+            accumulate(*thread, stats);
+        return stats;
+    }
+};
+
+inline metrics_registry_t& metrics_registry() noexcept {
+    static metrics_registry_t registry;
+    return registry;
+}
+
+class thread_metrics_handle_t {
+    std::unique_ptr<thread_metrics_t> metrics_;
+
+  public:
+    thread_metrics_handle_t() : metrics_(std::make_unique<thread_metrics_t>()) { metrics_registry().attach(*metrics_); }
+    ~thread_metrics_handle_t() noexcept { metrics_registry().detach(*metrics_); }
+    thread_metrics_t& operator*() noexcept { return *metrics_; }
+};
+
+inline thread_metrics_t& thread_metrics() {
+    thread_local thread_metrics_handle_t handle;
+    return *handle;
+}
+
+/**
+ * @brief Times the scope of a public function. Failures are detected by
+ * the error, exported by the time the scope is left. Only the current
+ * thread writes into its counters, so no atomic read-modify-writes are needed.
+ */
+class operation_timer_t {
+    using clock_t = std::chrono::steady_clock;
+
+    operation_t operation_;
+    std::size_t tasks_;
+    ustore_error_t* error_;
+    clock_t::time_point start_;
+
+    static void increment(std::atomic<std::uint64_t>& counter, std::uint64_t delta) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+  public:
+    operation_timer_t(operation_t operation, std::size_t tasks, ustore_error_t* c_error) noexcept
+        : operation_(operation), tasks_(tasks), error_(c_error), start_(clock_t::now()) {}
+
+    ~operation_timer_t() noexcept {
+        auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - start_);
+        auto const nanoseconds = static_cast<std::uint64_t>(elapsed.count());
+        auto& stats = thread_metrics()[static_cast<std::size_t>(operation_)];
+        increment(stats.calls, 1);
+        increment(stats.failures, error_ && *error_);
+        increment(stats.tasks, tasks_);
+        increment(stats.nanoseconds, nanoseconds);
+        increment(stats.buckets[latency_bucket(nanoseconds)], 1);
+    }
+};
+
+/**
+ * @brief Estimates the latency, below which the `quantile` of calls complete,
+ * reporting the upper bound of the matching bucket.
+ */
+inline std::uint64_t latency_quantile(operation_stats_t const& stats, double quantile) noexcept {
+    auto const threshold = static_cast<std::uint64_t>(quantile * stats.calls);
+    std::uint64_t passed = 0;
+    for (std::size_t bucket = 0; bucket != latency_buckets_k; ++bucket) {
+        passed += stats.buckets[bucket];
+        if (passed > threshold)
+            return latency_bucket_lower(bucket + 1);
+    }
+    return latency_bucket_lower(latency_buckets_k);
+}
+
+/**
+ * @brief Exports the operations, that were called at least once, as a JSON object.
+ * Non-empty buckets are listed as pairs of their upper bounds and counts.
+ */
+inline std::string metrics_to_json(operations_stats_t const& stats) {
+    std::string json = "{";
+    for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx) {
+        operation_stats_t const& op = stats[operation_idx];
+        if (!op.calls)
+            continue;
+        if (json.size() > 1)
+            json += ',';
+        json += '"';
+        json += operation_name(operation_idx);
+        json += "\":{\"calls\":" + std::to_string(op.calls);
+        json += ",\"failures\":" + std::to_string(op.failures);
+        json += ",\"tasks\":" + std::to_string(op.tasks);
+        json += ",\"nanoseconds\":" + std::to_string(op.nanoseconds);
+        json += ",\"p50\":" + std::to_string(latency_quantile(op, 0.5));
+        json += ",\"p90\":" + std::to_string(latency_quantile(op, 0.9));
+        json += ",\"p99\":" + std::to_string(latency_quantile(op, 0.99));
+        json += ",\"p999\":" + std::to_string(latency_quantile(op, 0.999));
+        json += ",\"buckets\":[";
+        bool is_first_bucket = true;
+        for (std::size_t bucket = 0; bucket != latency_buckets_k; ++bucket) {
+            if (!op.buckets[bucket])
+                continue;
+            json += is_first_bucket ? "[" : ",[";
+            json += std::to_string(latency_bucket_lower(bucket + 1)) + "," + std::to_string(op.buckets[bucket]) + "]";
+            is_first_bucket = false;
+        }
+        json += "]}";
+    }
+
+    arenas_stats_t const& arenas = arenas_stats();
+    if (json.size() > 1)
+        json += ',';
+    json += "\"arena\":{\"allocations\":" + std::to_string(arenas.allocations.load(std::memory_order_relaxed));
+    json += ",\"allocated_bytes\":" + std::to_string(arenas.allocated_bytes.load(std::memory_order_relaxed));
+    json += ",\"huge_allocations\":" + std::to_string(arenas.huge_allocations.load(std::memory_order_relaxed));
+    json += ",\"refits\":" + std::to_string(arenas.refits.load(std::memory_order_relaxed));
+    json += ",\"max_peak\":" + std::to_string(arenas.max_peak.load(std::memory_order_relaxed));
+    json += "}";
+
+    read_caches_stats_t const& caches = read_caches_stats();
+    json += ",\"read_cache\":{\"hits\":" + std::to_string(caches.hits.load(std::memory_order_relaxed));
+    json += ",\"misses\":" + std::to_string(caches.misses.load(std::memory_order_relaxed));
+    json += ",\"insertions\":" + std::to_string(caches.insertions.load(std::memory_order_relaxed));
+    json += ",\"evictions\":" + std::to_string(caches.evictions.load(std::memory_order_relaxed));
+    json += ",\"invalidations\":" + std::to_string(caches.invalidations.load(std::memory_order_relaxed));
+    json += ",\"charged_bytes\":" + std::to_string(caches.charged_bytes.load(std::memory_order_relaxed));
+    json += "}}";
+    return json;
+}
+
+/**
+ * @brief Exports the counters in the Prometheus text format. Histogram buckets
+ * are coarsened to powers of four, from a microsecond to a quarter of a minute,
+ * as every bucket is a separate time series for Prometheus.
+ */
+inline std::string metrics_to_prometheus(operations_stats_t const& stats) {
+    std::string text;
+    text += "# HELP ustore_calls_total Number of calls of a public function.\n";
+    text += "# TYPE ustore_calls_total counter\n";
+    for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx)
+        text += "ustore_calls_total{operation=\"" + std::string(operation_name(operation_idx)) + "\"} " +
+                std::to_string(stats[operation_idx].calls) + "\n";
+
+    text += "# HELP ustore_failures_total Number of calls, that exported an error.\n";
+    text += "# TYPE ustore_failures_total counter\n";
+    for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx)
+        text += "ustore_failures_total{operation=\"" + std::string(operation_name(operation_idx)) + "\"} " +
+                std::to_string(stats[operation_idx].failures) + "\n";
+
+    text += "# HELP ustore_tasks_total Number of tasks in batches passed to a public function.\n";
+    text += "# TYPE ustore_tasks_total counter\n";
+    for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx)
+        text += "ustore_tasks_total{operation=\"" + std::string(operation_name(operation_idx)) + "\"} " +
+                std::to_string(stats[operation_idx].tasks) + "\n";
+
+    text += "# HELP ustore_latency_seconds Latency of a public function.\n";
+    text += "# TYPE ustore_latency_seconds histogram\n";
+    for (std::size_t operation_idx = 0; operation_idx != operations_count_k; ++operation_idx) {
+        operation_stats_t const& op = stats[operation_idx];
+        std::string const label = "operation=\"" + std::string(operation_name(operation_idx)) + "\"";
+        std::uint64_t passed = 0;
+        std::size_t bucket = 0;
+        for (std::size_t power = 10; power <= 34; power += 2) {
+            std::uint64_t const bound = 1ull << power;
+            for (; latency_bucket_lower(bucket + 1) <= bound; ++bucket)
+                passed += op.buckets[bucket];
+            text += "ustore_latency_seconds_bucket{" + label + ",le=\"" + std::to_string(bound / 1e9) + "\"} " +
+                    std::to_string(passed) + "\n";
+        }
+        text += "ustore_latency_seconds_bucket{" + label + ",le=\"+Inf\"} " + std::to_string(op.calls) + "\n";
+        text += "ustore_latency_seconds_sum{" + label + "} " + std::to_string(op.nanoseconds / 1e9) + "\n";
+        text += "ustore_latency_seconds_count{" + label + "} " + std::to_string(op.calls) + "\n";
+    }
+
+    arenas_stats_t const& arenas = arenas_stats();
+    text += "# HELP ustore_arena_allocations_total Number of sub-arenas allocated.\n";
+    text += "# TYPE ustore_arena_allocations_total counter\n";
+    text += "ustore_arena_allocations_total " + std::to_string(arenas.allocations.load(std::memory_order_relaxed)) +
+            "\n";
+    text += "# HELP ustore_arena_allocated_bytes_total Capacity of all the sub-arenas allocated.\n";
+    text += "# TYPE ustore_arena_allocated_bytes_total counter\n";
+    text += "ustore_arena_allocated_bytes_total " +
+            std::to_string(arenas.allocated_bytes.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_arena_huge_allocations_total Number of sub-arenas backed by reserved huge pages.\n";
+    text += "# TYPE ustore_arena_huge_allocations_total counter\n";
+    text += "ustore_arena_huge_allocations_total " +
+            std::to_string(arenas.huge_allocations.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_arena_refits_total Number of arenas refitted to their recent peak usage.\n";
+    text += "# TYPE ustore_arena_refits_total counter\n";
+    text += "ustore_arena_refits_total " + std::to_string(arenas.refits.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_arena_max_peak_bytes Largest usage of a single arena between releases.\n";
+    text += "# TYPE ustore_arena_max_peak_bytes gauge\n";
+    text += "ustore_arena_max_peak_bytes " + std::to_string(arenas.max_peak.load(std::memory_order_relaxed)) + "\n";
+
+    read_caches_stats_t const& caches = read_caches_stats();
+    text += "# HELP ustore_read_cache_lookups_total Number of keys looked up in read caches.\n";
+    text += "# TYPE ustore_read_cache_lookups_total counter\n";
+    text += "ustore_read_cache_lookups_total{result=\"hit\"} " +
+            std::to_string(caches.hits.load(std::memory_order_relaxed)) + "\n";
+    text += "ustore_read_cache_lookups_total{result=\"miss\"} " +
+            std::to_string(caches.misses.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_read_cache_insertions_total Number of values cached after misses.\n";
+    text += "# TYPE ustore_read_cache_insertions_total counter\n";
+    text += "ustore_read_cache_insertions_total " +
+            std::to_string(caches.insertions.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_read_cache_evictions_total Number of values evicted to fit the capacity.\n";
+    text += "# TYPE ustore_read_cache_evictions_total counter\n";
+    text += "ustore_read_cache_evictions_total " +
+            std::to_string(caches.evictions.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_read_cache_invalidations_total Number of cached values dropped on writes.\n";
+    text += "# TYPE ustore_read_cache_invalidations_total counter\n";
+    text += "ustore_read_cache_invalidations_total " +
+            std::to_string(caches.invalidations.load(std::memory_order_relaxed)) + "\n";
+    text += "# HELP ustore_read_cache_charged_bytes Memory charged for the cached values.\n";
+    text += "# TYPE ustore_read_cache_charged_bytes gauge\n";
+    text += "ustore_read_cache_charged_bytes " + std::to_string(caches.charged_bytes.load(std::memory_order_relaxed)) +
+            "\n";
+    return text;
+}
+
+/**
+ * @brief Serves the "metrics" and "metrics.prometheus" requests of `ustore_database_control()`.
+ * @return `false` if the request is unrelated to metrics and must be handled by the engine.
+ */
+inline bool control_metrics(ustore_database_control_t& c) noexcept {
+    bool const is_json = std::strcmp(c.request, "metrics") == 0;
+    bool const is_prometheus = std::strcmp(c.request, "metrics.prometheus") == 0;
+    if (!is_json && !is_prometheus)
+        return false;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, ustore_options_default_k, c.error);
+    if (*c.error)
+        return true;
+    safe_section("Exporting metrics", c.error, [&] {
+        operations_stats_t const stats = metrics_registry().collect();
+        std::string const text = is_json ? metrics_to_json(stats) : metrics_to_prometheus(stats);
+        auto response = arena.alloc<char>(text.size() + 1, c.error).begin();
+        return_if_error_m(c.error);
+        std::memcpy(response, text.c_str(), text.size() + 1);
+        *c.response = response;
+    });
+    return true;
+}
+
+} // namespace unum::ustore
@@ -0,0 +1,280 @@
+/**
+ * @file read_cache.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Concurrent cache of hot values in front of persistent engines.
+ */
+#pragma once
+#include <algorithm>     // `std::stable_partition`
+#include <array>         // `std::array`
+#include <atomic>        // `std::atomic`
+#include <deque>         // `std::deque`
+#include <mutex>         // `std::mutex`
+#include <string>        // `std::string`
+#include <unordered_map> // `std::unordered_map`
+#include <vector>        // `std::vector`
+
+#include "ustore/db.h"
+#include "ustore/cpp/types.hpp" // `value_view_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Process-wide counters of all the read caches.
+ * Lookups are accounted once per batch, not per key.
+ */
+struct read_caches_stats_t {
+    std::atomic<std::size_t> hits {0};
+    std::atomic<std::size_t> misses {0};
+    std::atomic<std::size_t> insertions {0};
+    std::atomic<std::size_t> evictions {0};
+    std::atomic<std::size_t> invalidations {0};
+    std::atomic<std::size_t> charged_bytes {0};
+};
+
+inline read_caches_stats_t& read_caches_stats() noexcept {
+    static read_caches_stats_t stats;
+    return stats;
+}
+
+/**
+ * @brief Sharded cache of values, addressed by collection and key, with a capacity in bytes.
+ * Every shard follows @b S3-FIFO: new entries land in a small probationary queue, and only
+ * the ones hit there are promoted into the main queue, which is swept like a @b CLOCK,
+ * decrementing small saturating frequencies until it finds an entry to evict.
+ * So scans only churn the small queue, while repeatedly hit keys survive multiple sweeps.
+ *
+ * ## Consistency
+ *
+ * Writers update the engine first and invalidate the keys afterwards. Every invalidation
+ * bumps the generation of its shard, so readers take `tickets()` before reading from the
+ * engine, and the values they `insert()` afterwards are dropped, if any write could have
+ * overtaken them. Transactions and snapshots must bypass the cache.
+ */
+class read_cache_t {
+  public:
+    static constexpr std::size_t shards_k = 64;
+    /** @brief Approximate memory usage of an entry besides its value. */
+    static constexpr std::size_t entry_overhead_k = 96;
+    using tickets_t = std::array<std::uint64_t, shards_k>;
+
+  private:
+    static constexpr std::uint8_t frequency_max_k = 3;
+    /** @brief Share of the shard capacity, that the probationary queue is trimmed to. */
+    static constexpr std::size_t small_share_k = 10;
+
+    struct entry_key_t {
+        ustore_collection_t collection;
+        ustore_key_t key;
+        bool operator==(entry_key_t const& other) const noexcept {
+            return collection == other.collection && key == other.key;
+        }
+    };
+
+    struct entry_hash_t {
+        std::size_t operator()(entry_key_t const& entry) const noexcept {
+            std::uint64_t hash = static_cast<std::uint64_t>(entry.key) ^ (entry.collection * 0x9E3779B97F4A7C15ull);
+            hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+            hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+            return static_cast<std::size_t>(hash ^ (hash >> 31));
+        }
+    };
+
+    /**
+     * @brief Invalidated entries stay in their queue, until they are popped from it,
+     * and only then their slots are reused.
+     */
+    struct entry_t {
+        entry_key_t key {};
+        std::string value;
+        std::uint8_t frequency = 0;
+        bool occupied = false;
+        bool in_main = false;
+    };
+
+    struct shard_t {
+        std::mutex mutex;
+        std::unordered_map<entry_key_t, std::size_t, entry_hash_t> index;
+        std::vector<entry_t> entries;
+        std::vector<std::size_t> free_entries;
+        std::deque<std::size_t> small;
+        std::deque<std::size_t> main;
+        std::size_t small_charged = 0;
+        std::size_t charged = 0;
+        std::size_t invalidated = 0;
+        std::atomic<std::uint64_t> generation {0};
+    };
+
+    std::array<shard_t, shards_k> shards_;
+    std::size_t shard_capacity_ = 0;
+
+    static std::size_t shard_idx(entry_key_t const& key) noexcept { return (entry_hash_t {}(key) >> 58) % shards_k; }
+    static std::size_t charge(std::size_t value_length) noexcept { return value_length + entry_overhead_k; }
+
+    static void remove(shard_t& shard, std::size_t entry_idx) noexcept {
+        entry_t& entry = shard.entries[entry_idx];
+        std::size_t const charged = charge(entry.value.size());
+        shard.index.erase(entry.key);
+        shard.charged -= charged;
+        shard.small_charged -= entry.in_main ? 0 : charged;
+        read_caches_stats().charged_bytes -= charged;
+        entry.value = std::string();
+        entry.occupied = false;
+    }
+
+    /**
+     * @brief Drops the invalidated entries from both queues at once, reusing their slots.
+     * Called once they outnumber the cached ones, so that frequent writes to cached keys
+     * don't grow the queues without evictions.
+     */
+    static void purge(shard_t& shard) noexcept(false) {
+        for (std::deque<std::size_t>* queue : {&shard.small, &shard.main}) {
+            auto occupied_end = std::stable_partition(queue->begin(), queue->end(), [&](std::size_t entry_idx) {
+                return shard.entries[entry_idx].occupied;
+            });
+            shard.free_entries.insert(shard.free_entries.end(), occupied_end, queue->end());
+            queue->erase(occupied_end, queue->end());
+        }
+        shard.invalidated = 0;
+    }
+
+    void evict_one(shard_t& shard) noexcept(false) {
+        while (true) {
+            bool const from_small =
+                !shard.small.empty() && (shard.small_charged * small_share_k >= shard_capacity_ || shard.main.empty());
+            std::deque<std::size_t>& queue = from_small ? shard.small : shard.main;
+            std::size_t const entry_idx = queue.front();
+            queue.pop_front();
+
+            entry_t& entry = shard.entries[entry_idx];
+            if (!entry.occupied) {
+                shard.free_entries.push_back(entry_idx);
+                shard.invalidated -= shard.invalidated != 0;
+                continue;
+            }
+            if (entry.frequency) {
+                if (from_small)
+                    shard.small_charged -= charge(entry.value.size()), entry.frequency = 0, entry.in_main = true;
+                else
+                    --entry.frequency;
+                shard.main.push_back(entry_idx);
+                continue;
+            }
+            remove(shard, entry_idx);
+            shard.free_entries.push_back(entry_idx);
+            read_caches_stats().evictions.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+  public:
+    read_cache_t(std::size_t capacity_bytes) noexcept : shard_capacity_(capacity_bytes / shards_k) {}
+    read_cache_t(read_cache_t const&) = delete;
+    ~read_cache_t() noexcept { clear(); }
+
+    tickets_t tickets() const noexcept {
+        tickets_t tickets;
+        for (std::size_t i = 0; i != shards_k; ++i)
+            tickets[i] = shards_[i].generation.load(std::memory_order_acquire);
+        return tickets;
+    }
+
+    /**
+     * @brief Passes the cached value to the `callback` under the lock of its shard.
+     * @return `false` if the key isn't cached.
+     */
+    template <typename callback_at>
+    bool find(ustore_collection_t collection, ustore_key_t key, callback_at&& callback) noexcept(false) {
+        entry_key_t const entry_key {collection, key};
+        shard_t& shard = shards_[shard_idx(entry_key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(entry_key);
+        if (it == shard.index.end())
+            return false;
+        entry_t& entry = shard.entries[it->second];
+        entry.frequency += entry.frequency != frequency_max_k;
+        callback(value_view_t {entry.value});
+        return true;
+    }
+
+    /**
+     * @brief Caches a value, read from the engine after the `tickets` were taken.
+     * Values larger than a quarter of a shard are never cached, not to flush it entirely.
+     */
+    void insert(ustore_collection_t collection,
+                ustore_key_t key,
+                value_view_t value,
+                tickets_t const& tickets) noexcept(false) {
+        std::size_t const charged = charge(value.size());
+        if (charged > shard_capacity_ / 4)
+            return;
+
+        entry_key_t const entry_key {collection, key};
+        std::size_t const idx = shard_idx(entry_key);
+        shard_t& shard = shards_[idx];
+        std::string copy(value.c_str(), value.size());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.generation.load(std::memory_order_relaxed) != tickets[idx])
+            return;
+        if (shard.index.count(entry_key))
+            return;
+        if (shard.invalidated > shard.index.size())
+            purge(shard);
+        while (shard.charged + charged > shard_capacity_)
+            evict_one(shard);
+
+        std::size_t entry_idx = shard.entries.size();
+        if (shard.free_entries.empty())
+            shard.entries.emplace_back();
+        else
+            entry_idx = shard.free_entries.back(), shard.free_entries.pop_back();
+        shard.index.emplace(entry_key, entry_idx);
+        entry_t& entry = shard.entries[entry_idx];
+        entry.value = std::move(copy);
+        entry.key = entry_key;
+        entry.frequency = 0;
+        entry.occupied = true;
+        entry.in_main = false;
+        shard.small.push_back(entry_idx);
+        shard.small_charged += charged;
+        shard.charged += charged;
+        read_caches_stats().charged_bytes += charged;
+        read_caches_stats().insertions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void invalidate(ustore_collection_t collection, ustore_key_t key) noexcept {
+        entry_key_t const entry_key {collection, key};
+        shard_t& shard = shards_[shard_idx(entry_key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.generation.fetch_add(1, std::memory_order_release);
+        auto it = shard.index.find(entry_key);
+        if (it == shard.index.end())
+            return;
+        remove(shard, it->second);
+        ++shard.invalidated;
+        read_caches_stats().invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void clear() noexcept {
+        for (shard_t& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.generation.fetch_add(1, std::memory_order_release);
+            read_caches_stats().charged_bytes -= shard.charged;
+            shard.index.clear();
+            shard.entries.clear();
+            shard.free_entries.clear();
+            shard.small.clear();
+            shard.main.clear();
+            shard.small_charged = 0;
+            shard.charged = 0;
+            shard.invalidated = 0;
+        }
+    }
+
+    static void account(std::size_t hits, std::size_t misses) noexcept {
+        read_caches_stats().hits.fetch_add(hits, std::memory_order_relaxed);
+        read_caches_stats().misses.fetch_add(misses, std::memory_order_relaxed);
+    }
+};
+
+} // namespace unum::ustore
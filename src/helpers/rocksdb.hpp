@@ -0,0 +1,127 @@
+/**
+ * @file rocksdb.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Extensions of RocksDB, shared by the engines on top of it.
+ *
+ * Both the RocksDB and the Tiered engines must resolve merges and expire values
+ * the same way, so that either of them can open the directories of the other.
+ */
+#pragma once
+#include <algorithm> // `std::max`
+#include <cstdint>   // `std::uint64_t`
+#include <string>    // `std::string`
+#include <utility>   // `std::pair`
+#include <vector>    // `std::vector`
+
+#include <rocksdb/compaction_filter.h>
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/write_batch.h>
+
+#include "ustore/db.h"
+#include "helpers/merge.hpp"      // `merge_operand`
+#include "helpers/expiration.hpp" // `is_expired`
+
+namespace unum::ustore {
+
+inline value_view_t to_view(rocksdb::Slice const& slice) noexcept {
+    return value_view_t {reinterpret_cast<byte_t const*>(slice.data()), slice.size()};
+}
+
+/**
+ * @brief Applies the operands of `ustore_option_write_merge_k` writes, like Docs modifications,
+ * inside RocksDB, so that concurrent writers don't conflict on the same keys.
+ * Merges are resolved lazily, on reads and compactions, long after the write has succeeded,
+ * so the operands, that can't be applied, are skipped instead of corrupting the value.
+ */
+struct merge_operator_t final : public rocksdb::MergeOperator {
+    bool FullMergeV2(MergeOperationInput const& merge_in, MergeOperationOutput* merge_out) const override {
+        // Every merged value becomes the input of the next operand, so the buffers alternate
+        std::string buffers[2];
+        value_view_t current = merge_in.existing_value ? to_view(*merge_in.existing_value) : value_view_t {};
+        for (std::size_t i = 0; i != merge_in.operand_list.size(); ++i) {
+            std::string& merged = buffers[i % 2];
+            if (merge_operand(current, to_view(merge_in.operand_list[i]), merged))
+                merged.assign(current.c_str(), current.size());
+            current = to_view(merged);
+        }
+        merge_out->new_value = std::move(buffers[(merge_in.operand_list.size() - 1) % 2]);
+        return true;
+    }
+    const char* Name() const override { return "ustore"; }
+};
+
+/**
+ * @brief Drops the expired values of collections with a TTL, while compacting their files.
+ * Only installed for such collections, so doesn't check the TTL itself.
+ * Merge operands are never written into those collections, so only full values are filtered.
+ */
+struct expiration_filter_t final : public rocksdb::CompactionFilter {
+    bool Filter(int, rocksdb::Slice const&, rocksdb::Slice const& value, std::string*, bool*) const override {
+        return is_expired(to_view(value), now_ms());
+    }
+    const char* Name() const override { return "ustore_expiration"; }
+};
+
+/**
+ * @brief RocksDB only compacts the files, that reach the size thresholds of their levels.
+ * With a TTL, files are also compacted once they get older, but not more often than this,
+ * to keep short-lived collections from rewriting their files continuously.
+ */
+constexpr std::uint64_t expiration_compaction_min_seconds_k = 10 * 60;
+
+/**
+ * @brief Configures the column family of a collection, which values live for `ttl_ms`,
+ * to drop them during compactions.
+ */
+inline void expire_on_compaction(rocksdb::ColumnFamilyOptions& options, std::uint64_t ttl_ms) noexcept {
+    static expiration_filter_t expiration_filter;
+    options.compaction_filter = &expiration_filter;
+    options.ttl = std::max(ttl_ms / 1000, expiration_compaction_min_seconds_k);
+}
+
+/**
+ * @return TTL in milliseconds, or zero, if the values of the collection never expire.
+ * The `rocks_collection(db, collection)` lookup is provided by the engine.
+ */
+template <typename db_at>
+std::uint64_t ttl_of(db_at& db, ustore_collection_t collection) noexcept {
+    return db.ttls.any() ? db.ttls.find(rocks_collection(db, collection)->GetID()) : 0;
+}
+
+/**
+ * @brief Collects the keys, updated in the write batch of a transaction,
+ * to be dropped from the caches of the engine once it's committed.
+ */
+template <typename db_at>
+struct written_keys_gt final : public rocksdb::WriteBatch::Handler {
+    db_at const& db;
+    std::vector<std::pair<std::uint32_t, ustore_key_t>> keys;
+
+    written_keys_gt(db_at const& db) noexcept : db(db) {}
+    void append(std::uint32_t collection_id, rocksdb::Slice const& key) {
+        // Native string keys are never cached
+        if (!db.string_keyed.contains(collection_id))
+            keys.emplace_back(collection_id, db.decode(key));
+    }
+
+    rocksdb::Status PutCF(std::uint32_t id, rocksdb::Slice const& key, rocksdb::Slice const&) override {
+        append(id, key);
+        return {};
+    }
+    rocksdb::Status MergeCF(std::uint32_t id, rocksdb::Slice const& key, rocksdb::Slice const&) override {
+        append(id, key);
+        return {};
+    }
+    rocksdb::Status DeleteCF(std::uint32_t id, rocksdb::Slice const& key) override {
+        append(id, key);
+        return {};
+    }
+    rocksdb::Status SingleDeleteCF(std::uint32_t id, rocksdb::Slice const& key) override {
+        append(id, key);
+        return {};
+    }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,109 @@
+/**
+ * @file helpers/sampling.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Cheap random generators and streaming samplers.
+ */
+#pragma once
+#include <cmath>     // `std::log1p`
+#include <cstdint>   // `std::uint64_t`
+#include <algorithm> // `std::min`
+#include <limits>    // `std::numeric_limits`
+#include <random>    // `std::random_device`
+
+namespace unum::ustore {
+
+/**
+ * @brief Small and fast "xoshiro256**" PRNG, compatible with STL distributions.
+ * Unlike `std::mt19937`, its state is just 32 bytes, so it's cheap to keep per thread.
+ * @see https://prng.di.unimi.it
+ */
+class random_generator_t {
+    std::uint64_t state_[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k) noexcept { return (x << k) | (x >> (64 - k)); }
+
+  public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+    /** @brief Expands the `seed` into the full state with "SplitMix64". */
+    explicit random_generator_t(std::uint64_t seed) noexcept {
+        for (std::uint64_t& word : state_) {
+            std::uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() noexcept {
+        std::uint64_t const result = rotl(state_[1] * 5, 7) * 9;
+        std::uint64_t const t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    /** @brief Uniformly distributed in (0, 1]. */
+    double uniform() noexcept { return static_cast<double>(((*this)() >> 11) + 1) * 0x1.0p-53; }
+};
+
+/**
+ * @brief Generator seeded once per thread, to avoid querying `std::random_device` on every call.
+ */
+inline random_generator_t& thread_random_generator() noexcept {
+    thread_local random_generator_t generator {(std::uint64_t(std::random_device {}()) << 32) ^
+                                               std::uint64_t(std::random_device {}())};
+    return generator;
+}
+
+/**
+ * @brief Reservoir sampling of a stream of unknown length with geometrically distributed skips,
+ * known as "Algorithm L". Needs a few random numbers per replaced entry, instead of one per visited.
+ * @see https://dl.acm.org/doi/10.1145/198429.198435
+ */
+template <typename element_at>
+class reservoir_sampler_gt {
+    element_at* reservoir_;
+    std::size_t capacity_;
+    random_generator_t& generator_;
+    std::size_t seen_ = 0;
+    std::size_t next_ = 0;
+    double weight_ = 1;
+
+    void skip() noexcept {
+        weight_ *= std::exp(std::log(generator_.uniform()) / capacity_);
+        double const gap = std::floor(std::log(generator_.uniform()) / std::log1p(-weight_));
+        std::size_t const left = std::numeric_limits<std::size_t>::max() - seen_;
+        next_ = gap < static_cast<double>(left) ? seen_ + static_cast<std::size_t>(gap) : seen_ + left;
+    }
+
+  public:
+    reservoir_sampler_gt(element_at* reservoir, std::size_t capacity, random_generator_t& generator) noexcept
+        : reservoir_(reservoir), capacity_(capacity), generator_(generator) {}
+
+    void operator()(element_at const& element) noexcept {
+        if (seen_ < capacity_) {
+            reservoir_[seen_++] = element;
+            if (seen_ == capacity_)
+                skip();
+            return;
+        }
+        if (!capacity_ || seen_++ != next_)
+            return;
+        reservoir_[generator_() % capacity_] = element;
+        skip();
+    }
+
+    /** @brief Number of sampled entries, that is smaller than the capacity for short streams. */
+    std::size_t size() const noexcept { return std::min(seen_, capacity_); }
+    std::size_t seen() const noexcept { return seen_; }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,277 @@
+/**
+ * @file helpers/slab_allocator.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Thread-safe size-classed allocator for many small blobs.
+ */
+#pragma once
+#include <cstdint>       // `std::size_t`
+#include <memory>        // `std::allocator`
+#include <mutex>         // `std::mutex`
+#include <atomic>        // `std::atomic`
+#include <iterator>      // `std::next`
+#include <new>           // `std::align_val_t`
+#include <cstddef>       // `std::max_align_t`
+#include <unordered_map> // `std::unordered_map`
+
+#include "ustore/cpp/types.hpp" // `byte_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Carves small blobs from large "slabs", grouping them into power-of-two
+ * size classes. Every class keeps an intrusive free-list of released blocks,
+ * so that repeated updates reuse memory instead of fragmenting the heap.
+ * Blobs bigger than the largest class are forwarded to `std::allocator`.
+ *
+ * Slabs are aligned to their size, so the slab of any block is found by masking its address.
+ * Under update-heavy loads, free-lists end up spread over many sparsely occupied slabs.
+ * Those can be "evacuated": their free blocks are withdrawn from the free-lists, so that
+ * nothing new is placed there, and the slab is returned to the system, once its last live
+ * block is released. Owners of the blocks are expected to relocate them in the meantime.
+ *
+ * Every slab starts with a header, naming the allocator, that owns it, and the blobs bigger
+ * than the largest class are prefixed with the same header. So a block can be released through
+ * `owner_of`, without knowing its allocator, and every database can have its own one.
+ *
+ * Both the bytes handed out and the bytes taken from the system are tracked,
+ * to allow enforcing memory limits on top.
+ */
+class slab_allocator_t {
+  public:
+    static constexpr std::size_t smallest_class_k = 32;
+    static constexpr std::size_t classes_count_k = 8;
+    static constexpr std::size_t largest_class_k = smallest_class_k << (classes_count_k - 1);
+    static constexpr std::size_t slab_size_k = 256 * 1024;
+
+  private:
+    using base_t = std::allocator<byte_t>;
+
+    struct free_block_t {
+        free_block_t* next;
+    };
+
+    struct header_t {
+        slab_allocator_t* owner;
+    };
+
+    /** @brief Space before every big blob for its `header_t`, keeping the blob itself aligned. */
+    static constexpr std::size_t big_header_k = alignof(std::max_align_t);
+
+    struct slab_t {
+        std::size_t live_blocks = 0;
+        bool evacuating = false;
+    };
+
+    struct size_class_t {
+        std::mutex mutex;
+        free_block_t* free_list = nullptr;
+        byte_t* slab_tail = nullptr;
+        byte_t* slab_end = nullptr;
+        std::unordered_map<byte_t*, slab_t> slabs;
+    };
+
+    size_class_t classes_[classes_count_k];
+    std::atomic<std::size_t> used_bytes_ {0};
+    std::atomic<std::size_t> reserved_bytes_ {0};
+    std::atomic<std::size_t> evacuating_slabs_ {0};
+    std::atomic<std::size_t> released_bytes_ {0};
+
+    static std::size_t class_of(std::size_t size) noexcept {
+        std::size_t class_idx = 0;
+        std::size_t class_size = smallest_class_k;
+        while (class_size < size)
+            class_size <<= 1, ++class_idx;
+        return class_idx;
+    }
+
+    static byte_t* slab_of(byte_t const* ptr) noexcept {
+        return reinterpret_cast<byte_t*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_size_k - 1));
+    }
+
+    /**
+     * @brief Returns an empty slab to the system. Expects the class to be locked,
+     * and none of its blocks to be in the free-list.
+     */
+    void release(size_class_t& size_class, byte_t* slab) noexcept {
+        auto it = size_class.slabs.find(slab);
+        if (it->second.evacuating)
+            --evacuating_slabs_;
+        size_class.slabs.erase(it);
+        ::operator delete(slab, std::align_val_t {slab_size_k});
+        reserved_bytes_ -= slab_size_k;
+        released_bytes_ += slab_size_k;
+    }
+
+  public:
+    slab_allocator_t() = default;
+    slab_allocator_t(slab_allocator_t const&) = delete;
+    slab_allocator_t& operator=(slab_allocator_t const&) = delete;
+
+    ~slab_allocator_t() noexcept {
+        for (size_class_t& size_class : classes_)
+            for (auto const& [slab, _] : size_class.slabs)
+                ::operator delete(slab, std::align_val_t {slab_size_k});
+    }
+
+    /**
+     * @brief Finds the allocator, that handed out the block of the given `size`.
+     */
+    static slab_allocator_t& owner_of(void const* ptr, std::size_t size) noexcept {
+        byte_t const* block = static_cast<byte_t const*>(ptr);
+        byte_t const* header = size > largest_class_k ? block - big_header_k : slab_of(block);
+        return *reinterpret_cast<header_t const*>(header)->owner;
+    }
+
+    /**
+     * @brief Number of bytes actually reserved for a blob of the given `size`.
+     */
+    static std::size_t capacity_for(std::size_t size) noexcept {
+        return size > largest_class_k ? size : smallest_class_k << class_of(size);
+    }
+
+    /**
+     * @return NULL if memory couldn't be acquired.
+     */
+    byte_t* allocate(std::size_t size) noexcept {
+        if (size > largest_class_k) {
+            byte_t* result = nullptr;
+            try {
+                result = base_t {}.allocate(big_header_k + size);
+            }
+            catch (...) {
+                return nullptr;
+            }
+            new (result) header_t {this};
+            used_bytes_ += size;
+            reserved_bytes_ += big_header_k + size;
+            return result + big_header_k;
+        }
+
+        std::size_t const class_idx = class_of(size);
+        std::size_t const class_size = smallest_class_k << class_idx;
+        size_class_t& size_class = classes_[class_idx];
+        std::unique_lock _ {size_class.mutex};
+        if (size_class.free_list) {
+            free_block_t* block = size_class.free_list;
+            size_class.free_list = block->next;
+            ++size_class.slabs.find(slab_of(reinterpret_cast<byte_t*>(block)))->second.live_blocks;
+            used_bytes_ += class_size;
+            return reinterpret_cast<byte_t*>(block);
+        }
+
+        if (size_class.slab_tail == size_class.slab_end) {
+            auto slab = static_cast<byte_t*>(::operator new(slab_size_k, std::align_val_t {slab_size_k}, std::nothrow));
+            if (!slab)
+                return nullptr;
+            try {
+                size_class.slabs.emplace(slab, slab_t {});
+            }
+            catch (...) {
+                ::operator delete(slab, std::align_val_t {slab_size_k});
+                return nullptr;
+            }
+            // The first block of every slab is taken by its header
+            new (slab) header_t {this};
+            size_class.slab_tail = slab + class_size;
+            size_class.slab_end = slab + slab_size_k;
+            reserved_bytes_ += slab_size_k;
+        }
+
+        byte_t* result = size_class.slab_tail;
+        size_class.slab_tail += class_size;
+        ++size_class.slabs.find(slab_of(result))->second.live_blocks;
+        used_bytes_ += class_size;
+        return result;
+    }
+
+    void deallocate(byte_t* ptr, std::size_t size) noexcept {
+        if (!ptr)
+            return;
+        if (size > largest_class_k) {
+            base_t {}.deallocate(ptr - big_header_k, big_header_k + size);
+            used_bytes_ -= size;
+            reserved_bytes_ -= big_header_k + size;
+            return;
+        }
+
+        std::size_t const class_idx = class_of(size);
+        size_class_t& size_class = classes_[class_idx];
+        std::unique_lock _ {size_class.mutex};
+        used_bytes_ -= smallest_class_k << class_idx;
+        auto slab_it = size_class.slabs.find(slab_of(ptr));
+        slab_t& slab = slab_it->second;
+        --slab.live_blocks;
+        if (slab.evacuating) {
+            if (!slab.live_blocks)
+                release(size_class, slab_it->first);
+            return;
+        }
+        free_block_t* block = reinterpret_cast<free_block_t*>(ptr);
+        block->next = size_class.free_list;
+        size_class.free_list = block;
+    }
+
+    /**
+     * @brief Starts evacuating the slabs, where live blocks occupy at most `max_occupancy`
+     * of the space, except for the ones still being carved. Empty slabs are released right away.
+     * Walks the free-lists of the affected classes, so shouldn't be called too often.
+     * @return The number of slabs, that still have live blocks, and are awaiting their relocation.
+     */
+    std::size_t evacuate(double max_occupancy) noexcept {
+        for (std::size_t class_idx = 0; class_idx != classes_count_k; ++class_idx) {
+            std::size_t const class_size = smallest_class_k << class_idx;
+            std::size_t const max_live_blocks = static_cast<std::size_t>(max_occupancy * slab_size_k / class_size);
+            size_class_t& size_class = classes_[class_idx];
+            std::unique_lock _ {size_class.mutex};
+
+            byte_t* carved_slab = size_class.slab_tail != size_class.slab_end ? slab_of(size_class.slab_tail) : nullptr;
+            std::size_t newly_evacuating = 0;
+            for (auto& [slab_ptr, slab] : size_class.slabs)
+                if (!slab.evacuating && slab_ptr != carved_slab && slab.live_blocks <= max_live_blocks)
+                    slab.evacuating = true, ++newly_evacuating;
+            if (!newly_evacuating)
+                continue;
+            evacuating_slabs_ += newly_evacuating;
+
+            // Nothing new may land in the evacuated slabs
+            free_block_t** link = &size_class.free_list;
+            while (*link)
+                if (size_class.slabs.find(slab_of(reinterpret_cast<byte_t*>(*link)))->second.evacuating)
+                    *link = (*link)->next;
+                else
+                    link = &(*link)->next;
+
+            for (auto it = size_class.slabs.begin(); it != size_class.slabs.end();) {
+                auto next = std::next(it);
+                if (it->second.evacuating && !it->second.live_blocks)
+                    release(size_class, it->first);
+                it = next;
+            }
+        }
+        return evacuating_slabs_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Checks if a block of the given `size` should be relocated by its owner.
+     */
+    bool evacuating(byte_t const* ptr, std::size_t size) noexcept {
+        if (size > largest_class_k)
+            return false;
+        size_class_t& size_class = classes_[class_of(size)];
+        std::unique_lock _ {size_class.mutex};
+        auto it = size_class.slabs.find(slab_of(ptr));
+        return it != size_class.slabs.end() && it->second.evacuating;
+    }
+
+    /** @brief Bytes currently handed out, including the rounding to size classes. */
+    std::size_t used_bytes() const noexcept { return used_bytes_.load(std::memory_order_relaxed); }
+    /** @brief Bytes currently taken from the system, including unused parts of slabs. */
+    std::size_t reserved_bytes() const noexcept { return reserved_bytes_.load(std::memory_order_relaxed); }
+    /** @brief Slabs, that are being evacuated, but still have live blocks. */
+    std::size_t evacuating_slabs() const noexcept { return evacuating_slabs_.load(std::memory_order_relaxed); }
+    /** @brief Bytes of evacuated slabs, returned to the system so far. */
+    std::size_t released_bytes() const noexcept { return released_bytes_.load(std::memory_order_relaxed); }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,182 @@
+/**
+ * @file statistics.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Statistics of collections, maintained by the engines on every update,
+ * so that `ustore_measure` can answer without walking the data.
+ *
+ * Engines first build the statistics of a collection with a full pass, and then apply
+ * the differences between the replaced and the new entries. Every key has to be updated
+ * by a single thread at a time, and the counters are atomic, so that the updates of
+ * different keys can be applied concurrently without a shared lock.
+ */
+#pragma once
+#include <array>         // `std::array`
+#include <atomic>        // `std::atomic`
+#include <cmath>         // `std::ldexp`
+#include <cstdint>       // `std::uint64_t`
+#include <limits>        // `std::numeric_limits`
+#include <memory>        // `std::shared_ptr`
+#include <mutex>         // `std::unique_lock`
+#include <shared_mutex>  // `std::shared_mutex`
+#include <string_view>   // `std::hash<std::string_view>`
+#include <unordered_map> // `std::unordered_map`
+
+#include "ustore/db.h"
+#include "ustore/cpp/types.hpp" // `value_view_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief HyperLogLog sketch with 4096 one-byte registers, estimating the number of distinct
+ * hashes with a standard error of about 1.6%. Registers only grow, so removals aren't reflected.
+ */
+class hyperloglog_t {
+    static constexpr std::size_t precision_k = 12;
+    static constexpr std::size_t registers_k = std::size_t(1) << precision_k;
+    std::array<std::atomic<std::uint8_t>, registers_k> registers_ {};
+
+  public:
+    void insert(std::uint64_t hash) noexcept {
+        std::size_t const idx = hash >> (64 - precision_k);
+        // The guard bit bounds the rank, if the remaining bits are all zeros
+        std::uint64_t const rest = (hash << precision_k) | (std::uint64_t(1) << (precision_k - 1));
+        std::uint8_t const rank = static_cast<std::uint8_t>(__builtin_clzll(rest) + 1);
+        std::uint8_t current = registers_[idx].load(std::memory_order_relaxed);
+        while (current < rank && !registers_[idx].compare_exchange_weak(current, rank, std::memory_order_relaxed))
+            ;
+    }
+
+    double estimate() const noexcept {
+        double const alpha = 0.7213 / (1.0 + 1.079 / registers_k);
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (auto const& reg : registers_) {
+            std::uint8_t rank = reg.load(std::memory_order_relaxed);
+            sum += std::ldexp(1.0, -rank);
+            zeros += rank == 0;
+        }
+        double const raw = alpha * registers_k * registers_k / sum;
+        // Linear counting is more accurate for small cardinalities
+        if (raw <= 2.5 * registers_k && zeros)
+            return registers_k * std::log(double(registers_k) / zeros);
+        return raw;
+    }
+};
+
+/**
+ * @brief What the statistics need to know about an entry, before it's replaced or moved.
+ */
+struct entry_summary_t {
+    /** @brief Whether the entry is stored at all, if only as a marker of a deletion. */
+    bool stored = false;
+    bool present = false;
+    std::size_t length = 0;
+    std::size_t space = 0;
+    std::uint64_t hash = 0;
+};
+
+inline entry_summary_t summarize(value_view_t value, std::size_t space) noexcept {
+    entry_summary_t summary;
+    summary.stored = true;
+    summary.present = bool(value);
+    summary.length = value.size();
+    summary.space = space;
+    if (value)
+        summary.hash = std::hash<std::string_view> {}(std::string_view(value.c_str(), value.size()));
+    return summary;
+}
+
+/**
+ * @brief Entries of a collection, including the deleted ones, that still occupy memory.
+ * Key bounds only widen, so they stay valid, but may be loose after deletions.
+ */
+struct collection_stats_t {
+    std::atomic<std::int64_t> keys {0};
+    std::atomic<std::int64_t> value_bytes {0};
+    std::atomic<std::int64_t> space_usage {0};
+    std::atomic<ustore_key_t> min_key {std::numeric_limits<ustore_key_t>::max()};
+    std::atomic<ustore_key_t> max_key {std::numeric_limits<ustore_key_t>::min()};
+    /** @brief Distinct values, that were ever written, for the modalities to estimate selectivity. */
+    hyperloglog_t distinct_values;
+
+    /** @brief Checks if there were no entries, since the statistics were built. */
+    bool empty() const noexcept {
+        return min_key.load(std::memory_order_relaxed) > max_key.load(std::memory_order_relaxed);
+    }
+
+    /** @brief Checks if all the entries lie in the `[start, end)` range. */
+    bool within(ustore_key_t start, ustore_key_t end) const noexcept {
+        return empty() ||
+               (start <= min_key.load(std::memory_order_relaxed) && max_key.load(std::memory_order_relaxed) < end);
+    }
+
+    void replace(ustore_key_t key, entry_summary_t const& replaced, entry_summary_t const& replacing) noexcept {
+        if (replaced.stored) {
+            space_usage -= static_cast<std::int64_t>(replaced.space);
+            if (replaced.present) {
+                keys -= 1;
+                value_bytes -= static_cast<std::int64_t>(replaced.length);
+            }
+        }
+        if (!replacing.stored)
+            return;
+
+        ustore_key_t min = min_key.load(std::memory_order_relaxed);
+        while (key < min && !min_key.compare_exchange_weak(min, key, std::memory_order_relaxed))
+            ;
+        ustore_key_t max = max_key.load(std::memory_order_relaxed);
+        while (key > max && !max_key.compare_exchange_weak(max, key, std::memory_order_relaxed))
+            ;
+        space_usage += static_cast<std::int64_t>(replacing.space);
+        if (!replacing.present)
+            return;
+        keys += 1;
+        value_bytes += static_cast<std::int64_t>(replacing.length);
+        distinct_values.insert(replacing.hash);
+    }
+};
+
+/**
+ * @brief Statistics of the collections, that were built so far. Lookups only take
+ * a shared lock, and are skipped entirely, until some collection is tracked.
+ */
+template <typename collection_at>
+class statistics_gt {
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<collection_at, std::shared_ptr<collection_stats_t>> stats_;
+    std::atomic<bool> any_ {false};
+
+  public:
+    bool any() const noexcept { return any_.load(std::memory_order_relaxed); }
+
+    /** @return NULL, if the collection isn't tracked. Updates of forgotten statistics are harmless. */
+    std::shared_ptr<collection_stats_t> find(collection_at collection) const noexcept {
+        if (!any())
+            return nullptr;
+        std::shared_lock _ {mutex_};
+        auto it = stats_.find(collection);
+        return it != stats_.end() ? it->second : nullptr;
+    }
+
+    void track(collection_at collection, std::shared_ptr<collection_stats_t> stats) noexcept(false) {
+        std::unique_lock _ {mutex_};
+        stats_[collection] = std::move(stats);
+        any_.store(true, std::memory_order_relaxed);
+    }
+
+    void forget(collection_at collection) noexcept {
+        std::unique_lock _ {mutex_};
+        stats_.erase(collection);
+        any_.store(!stats_.empty(), std::memory_order_relaxed);
+    }
+
+    template <typename callback_at>
+    void for_each(callback_at&& callback) const noexcept(false) {
+        std::shared_lock _ {mutex_};
+        for (auto const& [collection, stats] : stats_)
+            callback(collection, *stats);
+    }
+};
+
+} // namespace unum::ustore
@@ -0,0 +1,169 @@
+/**
+ * @file string_keys.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Collections with native variable-length keys, created with a `{"keys": "strings"}` config.
+ *
+ * Engines with ordered byte-string keys store the paths of such collections as is, instead of
+ * the Paths modality hashing them into buckets of integer keys. Point operations skip the hashing
+ * and the parsing of buckets, and prefix matches become range scans in lexicographic order.
+ * Such collections hold nothing but paths, so they can't be addressed with integer keys.
+ *
+ * Every engine defines the functions below. The Paths modality also provides weak definitions,
+ * for engines without native string keys, which report no such collections.
+ */
+#pragma once
+#include <atomic>        // `std::atomic`
+#include <cstring>       // `std::strlen`
+#include <filesystem>    // `std::filesystem::path`
+#include <fstream>       // `std::ifstream`
+#include <mutex>         // `std::unique_lock`
+#include <set>           // `std::set`
+#include <shared_mutex>  // `std::shared_mutex`
+#include <string>        // `std::string`
+#include <string_view>   // `std::string_view`
+#include <unordered_set> // `std::unordered_set`
+
+#include <nlohmann/json.hpp> // `nlohmann::json`
+
+#include "ustore/db.h"
+#include "ustore/cpp/ranges_args.hpp" // `contents_arg_t`
+#include "helpers/linked_array.hpp"   // `growing_tape_t`
+
+namespace unum::ustore {
+
+/**
+ * @brief Checks if the `collection` was created with native string keys.
+ */
+bool has_string_keys(ustore_database_t db, ustore_collection_t collection) noexcept;
+
+/**
+ * @brief Appends the values of the `keys` to the `values` tape, the missing ones included.
+ * Collections are optional, defaulting to the main one.
+ */
+void read_strings( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_snapshot_t snapshot,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    ustore_options_t options,
+    growing_tape_t& values,
+    ustore_error_t* error) noexcept;
+
+/**
+ * @brief Upserts the `values` of the `keys`, removing the ones with missing values.
+ * Collections are optional, defaulting to the main one.
+ */
+void write_strings( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    contents_arg_t const& keys,
+    contents_arg_t const& values,
+    ustore_options_t options,
+    ustore_error_t* error) noexcept;
+
+/**
+ * @brief Appends up to `count_limit` keys of the `collection`, that aren't smaller than `start_key`,
+ * to the `keys` tape in lexicographic order. Fewer keys are exported only at the end of the collection.
+ */
+void scan_strings( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_collection_t collection,
+    std::string_view start_key,
+    ustore_length_t count_limit,
+    ustore_options_t options,
+    growing_tape_t& keys,
+    ustore_error_t* error) noexcept;
+
+/**
+ * @brief Checks if the config of a collection requests native string keys.
+ * Leaves `string_keys` false, if the config is empty or has no "keys" field.
+ */
+inline void parse_string_keys(ustore_str_view_t config, bool& string_keys, ustore_error_t* c_error) noexcept {
+    string_keys = false;
+    if (!config || !std::strlen(config))
+        return;
+    auto js = nlohmann::json::parse(config, nullptr, false);
+    if (js.is_discarded() || !js.is_object() || !js.contains("keys"))
+        return;
+    auto const& j_keys = js["keys"];
+    return_error_if_m(j_keys == "strings" || j_keys == "integers",
+                      c_error,
+                      args_wrong_k,
+                      "Keys can be either \"strings\" or \"integers\"");
+    string_keys = j_keys == "strings";
+}
+
+/**
+ * @brief Collections with native string keys, consulted by every paths request. Lookups only take
+ * a shared lock, and are skipped entirely, until some collection has string keys.
+ */
+template <typename collection_at>
+class string_keyed_gt {
+    mutable std::shared_mutex mutex_;
+    std::unordered_set<collection_at> collections_;
+    std::atomic<bool> any_ {false};
+
+  public:
+    bool any() const noexcept { return any_.load(std::memory_order_relaxed); }
+
+    bool contains(collection_at collection) const noexcept {
+        if (!any())
+            return false;
+        std::shared_lock _ {mutex_};
+        return collections_.count(collection) != 0;
+    }
+
+    void set(collection_at collection, bool string_keys) noexcept(false) {
+        std::unique_lock _ {mutex_};
+        if (string_keys)
+            collections_.insert(collection);
+        else
+            collections_.erase(collection);
+        any_.store(!collections_.empty(), std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Like the TTLs, the kinds of keys are part of the collection configs, which the engines
+ * don't persist on their own. So the names of such collections are kept in a small JSON file.
+ */
+inline std::filesystem::path string_keyed_path(std::filesystem::path const& directory) noexcept(false) {
+    return directory / "string_keys.json";
+}
+
+inline std::set<std::string> load_string_keyed(std::filesystem::path const& directory) noexcept(false) {
+    std::set<std::string> names;
+    std::ifstream ifs(string_keyed_path(directory));
+    if (!ifs)
+        return names;
+    auto js = nlohmann::json::parse(ifs, nullptr, false);
+    if (js.is_array())
+        for (auto const& name : js)
+            if (name.is_string())
+                names.insert(name.get<std::string>());
+    return names;
+}
+
+/**
+ * @brief Replaces the file atomically, so that a crash never leaves a half-written one.
+ */
+inline void save_string_keyed(std::filesystem::path const& directory,
+                              std::set<std::string> const& names) noexcept(false) {
+    nlohmann::json js = nlohmann::json::array();
+    for (auto const& name : names)
+        js.push_back(name);
+    std::filesystem::path path = string_keyed_path(directory);
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream ofs(temporary_path, std::ios::trunc);
+        ofs << js.dump();
+    }
+    std::filesystem::rename(temporary_path, path);
+}
+
+} // namespace unum::ustore
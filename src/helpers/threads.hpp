@@ -0,0 +1,114 @@
+/**
+ * @file threads.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Concurrency settings of open databases, shared by engines and modalities.
+ */
+#pragma once
+#include <algorithm>     // `std::min`, `std::find`
+#include <mutex>         // `std::mutex`
+#include <thread>        // `std::thread`
+#include <unordered_map> // `std::unordered_map`
+#include <unordered_set> // `std::unordered_set`
+#include <vector>        // `std::vector`
+
+#include "ustore/db.h"
+
+namespace unum::ustore {
+
+/**
+ * @brief Maps open database handles to the number of threads, that modalities
+ * can use to parallelize analytical queries. Engines register the value from the
+ * "threads_count" field of the DBMS config on init with `register_threads`, and forget it on free.
+ * Same goes for the "accelerator", that modalities may offload batched kernels to.
+ */
+class threads_registry_t {
+  public:
+    /** @brief Called on free, to release the resources modalities attached to the database. */
+    using forget_callback_t = void (*)(ustore_database_t) noexcept;
+
+  private:
+    std::mutex mutex_;
+    std::unordered_map<ustore_database_t, std::size_t> counts_;
+    std::unordered_set<ustore_database_t> accelerated_;
+    std::vector<forget_callback_t> forget_callbacks_;
+
+  public:
+    static threads_registry_t& global() noexcept {
+        static threads_registry_t registry;
+        return registry;
+    }
+
+    void set(ustore_database_t db, std::size_t threads_count, bool accelerated = false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (threads_count > 1)
+            counts_[db] = threads_count;
+        else
+            counts_.erase(db);
+        if (accelerated)
+            accelerated_.insert(db);
+        else
+            accelerated_.erase(db);
+    }
+
+    void forget(ustore_database_t db) noexcept {
+        std::vector<forget_callback_t> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            counts_.erase(db);
+            accelerated_.erase(db);
+            callbacks = forget_callbacks_;
+        }
+        for (forget_callback_t callback : callbacks)
+            callback(db);
+    }
+
+    void on_forget(forget_callback_t callback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::find(forget_callbacks_.begin(), forget_callbacks_.end(), callback) == forget_callbacks_.end())
+            forget_callbacks_.push_back(callback);
+    }
+
+    std::size_t get(ustore_database_t db) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = counts_.find(db);
+        return it != counts_.end() ? it->second : 1;
+    }
+
+    bool accelerated(ustore_database_t db) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return accelerated_.count(db) != 0;
+    }
+};
+
+/**
+ * @brief Splits `count` tasks into continuous ranges between up to `threads_count` threads,
+ * calling `callback(begin, end, thread_idx)` for every one of them.
+ * The calling thread takes the first range.
+ */
+template <typename callback_at>
+void parallel_for(std::size_t threads_count, std::size_t count, callback_at&& callback) noexcept(false) {
+    threads_count = std::max<std::size_t>(1, std::min(threads_count, count));
+    std::size_t const chunk = (count + threads_count - 1) / threads_count;
+    if (threads_count == 1)
+        return callback(std::size_t(0), count, std::size_t(0));
+
+    std::vector<std::thread> threads;
+    auto join = [&] {
+        for (std::thread& thread : threads)
+            thread.join();
+    };
+    try {
+        threads.reserve(threads_count - 1);
+        for (std::size_t t = 1; t != threads_count; ++t)
+            threads.emplace_back([&, t] { callback(std::min(t * chunk, count), std::min(t * chunk + chunk, count), t); });
+    }
+    catch (...) {
+        join();
+        throw;
+    }
+    callback(std::size_t(0), std::min(chunk, count), std::size_t(0));
+    join();
+}
+
+} // namespace unum::ustore
@@ -0,0 +1,96 @@
+/**
+ * @file vectors_cuda.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Batched exact vector search on Nvidia GPUs, defined in `modality_vectors_cuda.cu`,
+ * only compiled with the `USTORE_USE_CUDA` build option.
+ *
+ * The quantized half of a collection is pinned in device memory on the first search, and
+ * stays there until the next vectors write into that collection, or until the database is freed.
+ * Vectors written inside transactions only reach the device copy after the next write outside of them.
+ */
+#pragma once
+#include <cstddef> // `std::size_t`
+#include <cstdint> // `std::int8_t`
+#include <vector>  // `std::vector`
+
+#include "ustore/db.h"
+#include "ustore/vectors.h"
+
+namespace unum::ustore {
+
+/**
+ * @brief Largest number of candidates per query, that the device can select in one pass.
+ * Searches with bigger heaps stay on the host.
+ */
+constexpr std::size_t cuda_top_limit_k = 256;
+
+/**
+ * @brief Device rows are padded with zeros to whole 32-bit words, which don't affect any metric.
+ */
+constexpr std::size_t cuda_stride(std::size_t dimensions) noexcept { return (dimensions + 3) / 4 * 4; }
+
+/**
+ * @brief Checks if the quantized half of the `collection` is already in device memory.
+ */
+bool cuda_pinned(ustore_database_t db, ustore_collection_t collection, std::size_t dimensions) noexcept;
+
+/**
+ * @brief Counts the invalidations of the `collection`. Pinning is skipped, if the counter changed
+ * while the vectors were scanned, as they may already be outdated.
+ */
+std::size_t cuda_generation(ustore_database_t db, ustore_collection_t collection) noexcept;
+
+/**
+ * @brief Uploads the scanned quantized vectors, replacing the previous copy.
+ *
+ * @param keys Sorted mirrored keys of the quantized entries.
+ * @param quants Vectors of `cuda_stride(dimensions)` bytes each, in the same order as the `keys`.
+ * @param norms Norms of the vectors, in the units of the cosine kernel.
+ */
+void cuda_pin( //
+    ustore_database_t db,
+    ustore_collection_t collection,
+    std::size_t generation,
+    std::vector<ustore_key_t>&& keys,
+    std::int8_t const* quants,
+    float const* norms,
+    std::size_t dimensions,
+    ustore_error_t* error) noexcept;
+
+/**
+ * @brief Releases the device copy of a modified `collection`.
+ */
+void cuda_unpin(ustore_database_t db, ustore_collection_t collection) noexcept;
+
+/**
+ * @brief Releases the device copies of all the collections of a freed database.
+ */
+void cuda_unpin_all(ustore_database_t db) noexcept;
+
+/**
+ * @brief Scores all the pinned vectors with mirrored keys in `[start_key, end_key)` against every query,
+ * exporting up to `top` best matches for each one, higher similarities first. The similarities of the
+ * Euclidean metric are negated, so that the higher is always better, like on the host.
+ *
+ * @param found_counts Output for the number of exported matches of every query.
+ * @param found_keys Output for `top` mirrored keys per query.
+ * @param found_similarities Output for `top` similarities per query.
+ * @return False, if the collection isn't pinned anymore, and nothing was searched.
+ */
+bool cuda_search( //
+    ustore_database_t db,
+    ustore_collection_t collection,
+    ustore_vector_metric_t metric,
+    std::int8_t const* const* queries,
+    float const* queries_norms,
+    std::size_t queries_count,
+    ustore_key_t start_key,
+    ustore_key_t end_key,
+    std::size_t top,
+    ustore_length_t* found_counts,
+    ustore_key_t* found_keys,
+    float* found_similarities,
+    ustore_error_t* error) noexcept;
+
+} // namespace unum::ustore
@@ -0,0 +1,207 @@
+/**
+ * @file helpers/write_ahead_log.hpp
+ * @author Ashot Vardanian
+ *
+ * @brief Append-only log of checksummed records with group commit.
+ */
+#pragma once
+#include <fcntl.h>  // `::open`
+#include <unistd.h> // `::write`, `::fsync`
+
+#include <cerrno>             // `errno`
+#include <cstdint>            // `std::uint32_t`
+#include <cstring>            // `std::memcpy`
+#include <algorithm>          // `std::max`
+#include <mutex>              // `std::unique_lock`
+#include <condition_variable> // `std::condition_variable`
+#include <string>             // `std::string`
+#include <string_view>        // `std::string_view`
+
+#include "ustore/cpp/status.hpp" // `return_error_if_m`
+
+namespace unum::ustore {
+
+/**
+ * @brief Sequentially appends opaque records into a single file.
+ * Every record is prefixed with its length and a checksum, so that a
+ * torn tail, left after a crash in the middle of a write, can be detected.
+ *
+ * Records are first accumulated in memory, under the log's mutex, which
+ * callers also use to order their in-memory updates the same way as in the log.
+ * Making them durable is done outside of the mutex, in groups: the first thread
+ * to request a flush becomes the leader and writes everything accumulated so far,
+ * while the others wait for it to finish. This way concurrent committers share
+ * a single `fsync`.
+ */
+class write_ahead_log_t {
+  public:
+    /** @brief Upper bound for the unflushed records, after which they are passed to the OS. */
+    static constexpr std::size_t buffer_limit_k = 1024 * 1024;
+    static constexpr std::size_t header_size_k = sizeof(std::uint32_t) * 2;
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::string pending_;
+    std::uint64_t appended_ = 0;
+    std::uint64_t written_ = 0;
+    std::uint64_t synced_ = 0;
+    std::uint64_t sync_requested_ = 0;
+    std::size_t file_size_ = 0;
+    bool flushing_ = false;
+    int file_ = -1;
+    ustore_error_t failure_ = nullptr;
+
+    static std::uint32_t checksum(std::string_view payload) noexcept {
+        std::uint32_t hash = 2166136261u;
+        for (char c : payload)
+            hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        return hash;
+    }
+
+    static bool write_all(int file, char const* data, std::size_t length) noexcept {
+        while (length) {
+            ssize_t written = ::write(file, data, length);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            length -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Passes all the pending records to the file, releasing the lock during IO.
+     * Expects no other flush to be in progress.
+     */
+    void flush_pending(std::unique_lock<std::mutex>& lock, bool sync) noexcept {
+        std::string batch;
+        batch.swap(pending_);
+        std::uint64_t const batch_last = appended_;
+        sync |= sync_requested_ > synced_;
+        flushing_ = true;
+        lock.unlock();
+
+        bool ok = write_all(file_, batch.data(), batch.size());
+        if (ok && sync)
+            ok = ::fsync(file_) == 0;
+
+        lock.lock();
+        flushing_ = false;
+        if (!ok)
+            failure_ = "Failed to write the log";
+        written_ = batch_last;
+        if (sync)
+            synced_ = batch_last;
+        // Reuse the capacity of the larger buffer
+        if (pending_.empty() && batch.capacity() > pending_.capacity()) {
+            batch.clear();
+            pending_.swap(batch);
+        }
+        flushed_.notify_all();
+    }
+
+  public:
+    write_ahead_log_t() = default;
+    write_ahead_log_t(write_ahead_log_t const&) = delete;
+    write_ahead_log_t& operator=(write_ahead_log_t const&) = delete;
+
+    ~write_ahead_log_t() noexcept {
+        if (file_ >= 0)
+            ::close(file_);
+    }
+
+    /** @brief Guards appends. Should be held while applying the logged updates in memory. */
+    std::unique_lock<std::mutex> lock() noexcept { return std::unique_lock {mutex_}; }
+
+    bool is_open() const noexcept { return file_ >= 0; }
+
+    /** @brief Bytes in the current file, including the ones not yet flushed. */
+    std::size_t size() const noexcept { return file_size_; }
+
+    /**
+     * @brief Durably flushes and closes the current file, switching to a new empty one.
+     * Must be called under the `lock()`.
+     */
+    void open(std::unique_lock<std::mutex>& lock, char const* path, ustore_error_t* c_error) noexcept {
+        flushed_.wait(lock, [&] { return !flushing_; });
+        if (file_ >= 0) {
+            if (!pending_.empty() || synced_ != appended_)
+                flush_pending(lock, true);
+            return_error_if_m(!failure_, c_error, error_unknown_k, failure_);
+            ::close(file_);
+            file_ = -1;
+        }
+
+        file_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        return_error_if_m(file_ >= 0, c_error, error_unknown_k, "Failed to create a log file");
+        file_size_ = 0;
+    }
+
+    /**
+     * @brief Buffers a new record. Must be called under the `lock()`.
+     * @return Sequence number of the record, to be passed to `commit()`.
+     */
+    std::uint64_t append(std::string_view payload, ustore_error_t* c_error) noexcept {
+        if (failure_) {
+            log_error_m(c_error, error_unknown_k, failure_);
+            return 0;
+        }
+        std::uint32_t header[2] = {static_cast<std::uint32_t>(payload.size()), checksum(payload)};
+        try {
+            pending_.append(reinterpret_cast<char const*>(header), header_size_k);
+            pending_.append(payload.data(), payload.size());
+        }
+        catch (...) {
+            log_error_m(c_error, out_of_memory_k, "Failed to buffer a log record");
+            return 0;
+        }
+        file_size_ += header_size_k + payload.size();
+        return ++appended_;
+    }
+
+    /**
+     * @brief Makes sure that the record `sequence_number` reaches the disk, if `sync`,
+     * or at least the OS, if the buffer is full. Must be called under the `lock()`,
+     * which is released while waiting for IO.
+     */
+    void commit(std::unique_lock<std::mutex>& lock,
+                std::uint64_t sequence_number,
+                bool sync,
+                ustore_error_t* c_error) noexcept {
+        if (!sync && pending_.size() < buffer_limit_k)
+            return;
+        if (sync)
+            sync_requested_ = std::max(sync_requested_, sequence_number);
+
+        while (sync ? synced_ < sequence_number : written_ < sequence_number) {
+            if (flushing_)
+                flushed_.wait(lock);
+            else
+                flush_pending(lock, sync);
+            return_error_if_m(!failure_, c_error, error_unknown_k, failure_);
+        }
+    }
+
+    /**
+     * @brief Extracts the next valid record from the contents of a log file.
+     * @return False, when the end or a corrupted record is reached.
+     */
+    static bool next(std::string_view& log, std::string_view& payload) noexcept {
+        if (log.size() < header_size_k)
+            return false;
+        std::uint32_t header[2];
+        std::memcpy(header, log.data(), header_size_k);
+        if (log.size() - header_size_k < header[0])
+            return false;
+        payload = log.substr(header_size_k, header[0]);
+        if (checksum(payload) != header[1])
+            return false;
+        log.remove_prefix(header_size_k + header[0]);
+        return true;
+    }
+};
+
+} // namespace unum::ustore
@@ -7,8 +7,15 @@
  */
 #include <cstdio>      // `std::snprintf`
 #include <cctype>      // `std::isdigit`
+#include <cstring>     // `std::strchr`
 #include <charconv>    // `std::to_chars`
 #include <string_view> // `std::string_view`
+#include <string>      // `std::string`
+#include <mutex>       // `std::unique_lock`
+#include <memory>      // `std::uninitialized_default_construct`
+#include <numeric>     // `std::iota`
+#include <tuple>       // `std::tie`
+#include <cmath>       // `std::isnan`
 
 #include <fmt/format.h> // `fmt::format_int`
 
@@ -21,6 +28,12 @@
 #include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
 #include "helpers/linked_array.hpp"  // `growing_tape_t`
 #include "helpers/algorithm.hpp"     // `transform_n`
+#include "helpers/lru.hpp"           // `lru_cache_gt`
+#include "helpers/threads.hpp"       // `parallel_for`
+#include "helpers/full_scan.hpp"     // `scan_range_collection`
+#include "helpers/merge.hpp"         // `merge_operand`
+#include "helpers/metrics.hpp"       // `operation_timer_t`
+#include "helpers/compression.hpp"   // `zstd_compress`
 #include "ustore/cpp/ranges_args.hpp"   // `places_arg_t`
 
 /*********************************************************/
@@ -55,6 +68,7 @@ enum class doc_modification_t {
     insert_k = ustore_doc_modify_insert_k,
     patch_k = ustore_doc_modify_patch_k,
     merge_k = ustore_doc_modify_merge_k,
+    increment_k = ustore_doc_modify_increment_k,
 };
 
 /// The length of buffer to be used to convert/format/print numerical values into strings.
@@ -235,7 +249,10 @@ simdjson::ondemand::object& reset(simdjson::ondemand::object& doc) noexcept {
     return doc;
 }
 
-json_t json_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+/**
+ * @brief Parses an immutable document, for when it will only be sampled.
+ */
+json_t json_read(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
 
     if (bytes.empty())
         return {};
@@ -245,6 +262,16 @@ json_t json_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_
     yyjson_read_flag flg = YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_INF_AND_NAN;
     result.handle = yyjson_read_opts((char*)bytes.data(), (size_t)bytes.size(), flg, &allocator, NULL);
     log_error_if_m(result.handle, c_error, 0, "Failed to parse document!");
+    return result;
+}
+
+json_t json_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+
+    json_t result = json_read(bytes, arena, c_error);
+    if (!result.handle)
+        return result;
+
+    yyjson_alc allocator = wrap_allocator(arena);
     result.mut_handle = yyjson_doc_mut_copy(result.handle, &allocator);
     return result;
 }
@@ -1036,6 +1063,533 @@ value_view_t any_dump(json_branch_t json,
     return {};
 }
 
+/*********************************************************/
+/*****************	 Indexed Documents	  ****************/
+/*********************************************************/
+
+/**
+ * Documents are stored as compact JSON, prefixed with an index of their nested members,
+ * so that single fields can be sampled without parsing the whole document:
+ * 1. NULL byte, which can't start a valid JSON, followed by the format version.
+ * 2. Number of indexed members and the offset of the JSON body.
+ * 3. Entries sorted by JSON-Pointer paths: offsets and lengths of the path and the value.
+ * 4. Concatenated JSON-Pointer paths of the members.
+ * 5. The JSON body itself, which is what the users see.
+ * Values without the leading NULL byte are plain JSON documents, written by older versions.
+ * Members of nested objects are indexed up to `stored_indexed_depth_k`, but not the array elements.
+ */
+constexpr std::uint8_t stored_version_k = 1;
+constexpr std::size_t stored_indexed_depth_k = 8;
+
+struct stored_header_t {
+    char marker;
+    std::uint8_t version;
+    std::uint16_t reserved;
+    ustore_length_t members_count;
+    ustore_length_t body_offset;
+};
+
+struct stored_member_t {
+    ustore_length_t path_offset;
+    ustore_length_t path_length;
+    ustore_length_t value_offset;
+    ustore_length_t value_length;
+};
+
+/**
+ * @brief Read-only view of a stored document.
+ * Headers and entries are copied out with `std::memcpy`, as the values aren't aligned.
+ */
+class stored_doc_t {
+    value_view_t bytes_;
+
+  public:
+    stored_doc_t(value_view_t bytes) noexcept : bytes_(bytes) {}
+
+    stored_header_t header() const noexcept {
+        stored_header_t header;
+        std::memcpy(&header, bytes_.data(), sizeof(header));
+        return header;
+    }
+
+    stored_member_t member(std::size_t idx) const noexcept {
+        stored_member_t member;
+        std::memcpy(&member, bytes_.data() + sizeof(stored_header_t) + idx * sizeof(member), sizeof(member));
+        return member;
+    }
+
+    std::string_view path(stored_member_t const& member) const noexcept {
+        return {bytes_.c_str() + member.path_offset, member.path_length};
+    }
+
+    bool is_indexed() const noexcept { return bytes_.size() >= sizeof(stored_header_t) && bytes_.c_str()[0] == 0; }
+
+    value_view_t body() const noexcept {
+        if (!is_indexed())
+            return bytes_;
+        auto offset = header().body_offset;
+        return {bytes_.data() + offset, bytes_.size() - offset};
+    }
+
+    /**
+     * @brief Binary-searches the member with exactly the given `path`.
+     * @return The index of the member or the `members_count`, if it isn't indexed.
+     */
+    std::size_t find(std::string_view path) const noexcept {
+        std::size_t const count = header().members_count;
+        std::size_t lower = 0, upper = count;
+        while (lower < upper) {
+            std::size_t middle = lower + (upper - lower) / 2;
+            if (this->path(member(middle)) < path)
+                lower = middle + 1;
+            else
+                upper = middle;
+        }
+        return lower != count && this->path(member(lower)) == path ? lower : count;
+    }
+
+    /**
+     * @brief Finds the deepest indexed member on the way to the `pointer`.
+     * @return The JSON slice of that member and the remaining part of the pointer,
+     * that must be resolved within that slice. Falls back to the entire body.
+     */
+    std::pair<value_view_t, std::string_view> locate(std::string_view pointer) const noexcept {
+        value_view_t body = this->body();
+        if (!is_indexed())
+            return {body, pointer};
+
+        std::size_t const count = header().members_count;
+        for (std::string_view prefix = pointer; !prefix.empty(); prefix = prefix.substr(0, prefix.rfind('/'))) {
+            std::size_t const idx = find(prefix);
+            if (idx == count)
+                continue;
+            stored_member_t found = member(idx);
+            return {value_view_t {body.data() + found.value_offset, found.value_length},
+                    pointer.substr(prefix.size())};
+        }
+        return {body, pointer};
+    }
+};
+
+/**
+ * @brief Converts the field name into a JSON-Pointer, escaping it, unless it already is one.
+ */
+std::string_view field_to_pointer(ustore_str_view_t field, std::string& buffer) {
+    if (!field || field[0] == '/')
+        return field ? std::string_view(field) : std::string_view();
+
+    buffer = "/";
+    for (char c : std::string_view(field))
+        c == '~' ? buffer.append("~0") : c == '/' ? buffer.append("~1") : buffer.append(1, c);
+    return buffer;
+}
+
+inline ustore_str_view_t pointer_or_root(std::string_view pointer) noexcept {
+    // Suffixes of NULL-terminated strings remain NULL-terminated
+    return pointer.empty() ? nullptr : pointer.data();
+}
+
+inline bool json_is_obj(yyjson_val* value) noexcept { return yyjson_is_obj(value); }
+inline bool json_is_obj(yyjson_mut_val* value) noexcept { return yyjson_mut_is_obj(value); }
+inline std::string_view json_get_str(yyjson_val* value) noexcept {
+    return {yyjson_get_str(value), yyjson_get_len(value)};
+}
+inline std::string_view json_get_str(yyjson_mut_val* value) noexcept {
+    return {yyjson_mut_get_str(value), yyjson_mut_get_len(value)};
+}
+inline char* json_write(yyjson_val* value, yyjson_alc* allocator, size_t* length) noexcept {
+    return yyjson_val_write_opts(value, 0, allocator, length, NULL);
+}
+inline char* json_write(yyjson_mut_val* value, yyjson_alc* allocator, size_t* length) noexcept {
+    return yyjson_mut_val_write_opts(value, 0, allocator, length, NULL);
+}
+template <typename callback_at>
+void json_for_each_member(yyjson_val* object, callback_at&& callback) noexcept {
+    size_t idx, max;
+    yyjson_val *key, *value;
+    yyjson_obj_foreach(object, idx, max, key, value) callback(key, value);
+}
+template <typename callback_at>
+void json_for_each_member(yyjson_mut_val* object, callback_at&& callback) noexcept {
+    size_t idx, max;
+    yyjson_mut_val *key, *value;
+    yyjson_mut_obj_foreach(object, idx, max, key, value) callback(key, value);
+}
+
+struct stored_builder_t {
+    yyjson_alc allocator;
+    string_t body;
+    string_t paths;
+    uninitialized_array_gt<stored_member_t> members;
+    std::string path;
+
+    stored_builder_t(linked_memory_lock_t& arena) noexcept
+        : allocator(wrap_allocator(arena)), body(arena), paths(arena), members(arena) {}
+
+    template <typename value_at>
+    void append_leaf(value_at* value, ustore_error_t* c_error) noexcept {
+        size_t length = 0;
+        char* begin = json_write(value, &allocator, &length);
+        return_error_if_m(begin, c_error, 0, "Failed to serialize the document!");
+        body.insert(body.size(), begin, begin + length, c_error);
+    }
+
+    /**
+     * @brief Serializes the `value` into the `body`, recording the offsets of object members.
+     * Keys are written as standalone strings, to reuse the escaping logic of the library.
+     */
+    template <typename value_at>
+    void append(value_at* value, std::size_t depth, ustore_error_t* c_error) noexcept {
+        if (!json_is_obj(value) || depth == stored_indexed_depth_k)
+            return append_leaf(value, c_error);
+
+        body.push_back('{', c_error);
+        bool is_first = true;
+        json_for_each_member(value, [&](value_at* key, value_at* member) {
+            return_if_error_m(c_error);
+            if (!is_first)
+                body.push_back(',', c_error);
+            is_first = false;
+            append_leaf(key, c_error);
+            body.push_back(':', c_error);
+            return_if_error_m(c_error);
+
+            std::size_t const parent_length = path.size();
+            path.push_back('/');
+            for (char c : json_get_str(key))
+                c == '~' ? path.append("~0") : c == '/' ? path.append("~1") : path.append(1, c);
+
+            stored_member_t entry {};
+            entry.path_offset = static_cast<ustore_length_t>(paths.size());
+            entry.path_length = static_cast<ustore_length_t>(path.size());
+            entry.value_offset = static_cast<ustore_length_t>(body.size());
+            paths.insert(paths.size(), path.data(), path.data() + path.size(), c_error);
+            append(member, depth + 1, c_error);
+            return_if_error_m(c_error);
+            entry.value_length = static_cast<ustore_length_t>(body.size()) - entry.value_offset;
+            members.push_back(entry, c_error);
+            path.resize(parent_length);
+        });
+        body.push_back('}', c_error);
+    }
+};
+
+/**
+ * @brief Serializes a JSON document into the indexed storage format.
+ */
+value_view_t stored_dump(json_branch_t json,
+                         linked_memory_lock_t& arena,
+                         growing_tape_t& output,
+                         ustore_error_t* c_error) noexcept {
+
+    if (!json)
+        return output.push_back(value_view_t {}, c_error);
+
+    stored_builder_t builder {arena};
+    safe_section("Indexing the document", c_error, [&] {
+        if (json.mut_handle)
+            builder.append(json.mut_handle, 0, c_error);
+        else
+            builder.append(json.handle, 0, c_error);
+    });
+    if (*c_error)
+        return {};
+
+    char const* paths = builder.paths.data();
+    std::sort(builder.members.begin(), builder.members.end(), [=](stored_member_t const& a, stored_member_t const& b) {
+        return std::string_view(paths + a.path_offset, a.path_length) <
+               std::string_view(paths + b.path_offset, b.path_length);
+    });
+
+    // Shift the offsets from the parts to the entire serialized value
+    stored_header_t header {};
+    header.version = stored_version_k;
+    std::size_t const paths_offset = sizeof(header) + builder.members.size() * sizeof(stored_member_t);
+    header.members_count = static_cast<ustore_length_t>(builder.members.size());
+    header.body_offset = static_cast<ustore_length_t>(paths_offset + builder.paths.size());
+    for (stored_member_t& member : builder.members)
+        member.path_offset += static_cast<ustore_length_t>(paths_offset);
+
+    string_t stored(arena);
+    stored.reserve(header.body_offset + builder.body.size(), c_error);
+    if (*c_error)
+        return {};
+    auto header_begin = reinterpret_cast<char const*>(&header);
+    auto members_begin = reinterpret_cast<char const*>(builder.members.begin());
+    auto members_end = reinterpret_cast<char const*>(builder.members.end());
+    stored.insert(stored.size(), header_begin, header_begin + sizeof(header), c_error);
+    stored.insert(stored.size(), members_begin, members_end, c_error);
+    stored.insert(stored.size(), paths, paths + builder.paths.size(), c_error);
+    stored.insert(stored.size(), builder.body.begin(), builder.body.end(), c_error);
+    if (*c_error)
+        return {};
+
+    auto result = value_view_t {reinterpret_cast<byte_t const*>(stored.data()), stored.size()};
+    result = output.push_back(result, c_error);
+    output.add_terminator(byte_t {0}, c_error);
+    return result;
+}
+
+/**
+ * @brief Parses the JSON body of a stored document, whether it has an index or not.
+ */
+json_t stored_parse(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    return json_parse(stored_doc_t {bytes}.body(), arena, c_error);
+}
+
+inline bool json_is_scalar(value_view_t json) noexcept {
+    return !json.empty() && json.c_str()[0] != '{' && json.c_str()[0] != '[';
+}
+
+/**
+ * @brief Replaces a scalar member of an indexed document with another serialized scalar.
+ * Only splices the body and shifts the offsets of the following and enclosing members,
+ * without parsing or re-serializing the rest of the document.
+ * @return Empty view, if the member isn't an indexed scalar, so the document must be parsed.
+ */
+value_view_t stored_splice(value_view_t bytes,
+                           std::string_view pointer,
+                           std::string_view replacement,
+                           linked_memory_lock_t& arena,
+                           ustore_error_t* c_error) noexcept {
+
+    stored_doc_t stored {bytes};
+    if (!stored.is_indexed() || pointer.empty())
+        return {};
+
+    // Duplicate keys would be ambiguous, as the entries aren't sorted stably
+    stored_header_t const header = stored.header();
+    std::size_t const found_idx = stored.find(pointer);
+    if (found_idx == header.members_count)
+        return {};
+    if (found_idx + 1 != header.members_count && stored.path(stored.member(found_idx + 1)) == pointer)
+        return {};
+    stored_member_t const found = stored.member(found_idx);
+    value_view_t body = stored.body();
+    if (!json_is_scalar({body.data() + found.value_offset, found.value_length}))
+        return {};
+
+    string_t spliced(arena);
+    spliced.reserve(bytes.size() - found.value_length + replacement.size(), c_error);
+    if (*c_error)
+        return {};
+
+    auto const delta =
+        static_cast<std::ptrdiff_t>(replacement.size()) - static_cast<std::ptrdiff_t>(found.value_length);
+    ustore_length_t const found_end = found.value_offset + found.value_length;
+    spliced.insert(0, bytes.c_str(), bytes.c_str() + sizeof(stored_header_t), c_error);
+    for (std::size_t member_idx = 0; member_idx != header.members_count && !*c_error; ++member_idx) {
+        stored_member_t member = stored.member(member_idx);
+        if (member.value_offset >= found_end)
+            member.value_offset = static_cast<ustore_length_t>(member.value_offset + delta);
+        else if (member.value_offset <= found.value_offset && member.value_offset + member.value_length >= found_end)
+            member.value_length = static_cast<ustore_length_t>(member.value_length + delta);
+        auto member_begin = reinterpret_cast<char const*>(&member);
+        spliced.insert(spliced.size(), member_begin, member_begin + sizeof(member), c_error);
+    }
+    char const* paths_begin = bytes.c_str() + spliced.size();
+    char const* body_begin = reinterpret_cast<char const*>(body.data());
+    spliced.insert(spliced.size(), paths_begin, body_begin + found.value_offset, c_error);
+    spliced.insert(spliced.size(), replacement.data(), replacement.data() + replacement.size(), c_error);
+    spliced.insert(spliced.size(), body_begin + found_end, body_begin + body.size(), c_error);
+    if (*c_error)
+        return {};
+    return {reinterpret_cast<byte_t const*>(spliced.data()), spliced.size()};
+}
+
+/*********************************************************/
+/*****************	 Compressed Documents	  ****************/
+/*********************************************************/
+
+/**
+ * Documents of compressed collections are written in a packed form, wrapping an entire stored document:
+ * 1. NULL byte, followed by the `stored_packed_version_k`, instead of the `stored_version_k`.
+ * 2. The codec, the identifier of its dictionary and the length of the unpacked document.
+ * 3. The compressed bytes of the stored document.
+ * Everything read from the engine is unpacked right away, so the rest of the modality never sees them.
+ * Documents, that don't shrink, are written unpacked even into compressed collections.
+ */
+constexpr std::uint8_t stored_packed_version_k = 2;
+
+struct stored_packed_header_t {
+    char marker;
+    std::uint8_t version;
+    codec_t codec;
+    std::uint8_t reserved;
+    std::uint32_t dictionary_id;
+    ustore_length_t stored_length;
+};
+
+inline bool stored_is_packed(value_view_t bytes) noexcept {
+    return bytes.size() >= sizeof(stored_packed_header_t) && bytes.c_str()[0] == 0 &&
+           bytes.data()[1] == stored_packed_version_k;
+}
+
+inline stored_packed_header_t stored_packed_header(value_view_t bytes) noexcept {
+    stored_packed_header_t header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    return header;
+}
+
+/**
+ * @brief Decompresses a packed document into the `arena`, passing the other ones through.
+ * Its dictionary must have been registered, by reading the schema of its collection.
+ * Like the documents read from the engines, the output is followed by the SIMDJSON padding.
+ */
+value_view_t stored_unpack(value_view_t bytes, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    if (!stored_is_packed(bytes))
+        return bytes;
+
+    stored_packed_header_t const header = stored_packed_header(bytes);
+    std::shared_ptr<zstd_dictionary_t> dictionary;
+    if (header.dictionary_id)
+        dictionary = zstd_dictionaries().find(header.dictionary_id);
+    if (header.codec != codec_t::zstd_k || (header.dictionary_id && !dictionary)) {
+        log_error_m(c_error, consistency_k, "Unknown compression of the document");
+        return {};
+    }
+
+    auto unpacked = arena.alloc<byte_t>(header.stored_length + sj::SIMDJSON_PADDING, c_error);
+    if (*c_error)
+        return {};
+    value_view_t payload {bytes.data() + sizeof(header), bytes.size() - sizeof(header)};
+    std::size_t length = zstd_decompress(payload, unpacked.begin(), header.stored_length, dictionary.get());
+    if (length != header.stored_length) {
+        log_error_m(c_error, consistency_k, "Corrupted compressed document");
+        return {};
+    }
+    std::memset(unpacked.begin() + length, 0, sj::SIMDJSON_PADDING);
+    return {unpacked.begin(), length};
+}
+
+/**
+ * Dictionaries are kept in the JSON schemas of their collections, encoded with Base64.
+ */
+static constexpr char const* base64_alphabet_k = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void base64_encode(std::string_view input, string_t& output, ustore_error_t* c_error) noexcept {
+    output.resize((input.size() + 2) / 3 * 4, c_error);
+    return_if_error_m(c_error);
+    char* output_it = output.data();
+    for (std::size_t i = 0; i < input.size(); i += 3) {
+        std::size_t const remaining = std::min<std::size_t>(input.size() - i, 3);
+        std::uint32_t triple = 0;
+        for (std::size_t j = 0; j != remaining; ++j)
+            triple |= std::uint32_t(static_cast<std::uint8_t>(input[i + j])) << (16 - 8 * j);
+        for (std::size_t j = 0; j != 4; ++j)
+            *output_it++ = j <= remaining ? base64_alphabet_k[(triple >> (18 - 6 * j)) & 63] : '=';
+    }
+}
+
+/**
+ * @return False, if the `input` isn't a valid padded Base64 string.
+ */
+bool base64_decode(std::string_view input, string_t& output, ustore_error_t* c_error) noexcept {
+    if (input.size() % 4)
+        return false;
+    output.resize(input.size() / 4 * 3, c_error);
+    if (*c_error)
+        return false;
+
+    auto decode = [](char symbol) -> int {
+        char const* found = std::strchr(base64_alphabet_k, symbol);
+        return symbol && found ? static_cast<int>(found - base64_alphabet_k) : -1;
+    };
+    std::size_t output_length = 0;
+    for (std::size_t i = 0; i != input.size(); i += 4) {
+        bool const is_last = i + 4 == input.size();
+        std::size_t const padding = is_last ? (input[i + 3] == '=') + (input[i + 2] == '=') : 0;
+        std::uint32_t triple = 0;
+        for (std::size_t j = 0; j != 4 - padding; ++j) {
+            int sextet = decode(input[i + j]);
+            if (sextet < 0)
+                return false;
+            triple |= std::uint32_t(sextet) << (18 - 6 * j);
+        }
+        for (std::size_t j = 0; j != 3 - padding; ++j)
+            output[output_length++] = static_cast<char>((triple >> (16 - 8 * j)) & 0xFF);
+    }
+    output.resize(output_length, c_error);
+    return true;
+}
+
+/**
+ * @brief Registers the dictionaries of the collections among the tasks of a `read`. @see `read_schemas`.
+ */
+void load_dictionaries(ustore_read_t const& read, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept;
+
+/**
+ * @brief Unpacks the documents among the outputs of a finished `read`, that must export the `offsets`,
+ * re-assembling its `values` tape with the same layout. Offsets and lengths are updated in-place.
+ */
+void stored_unpack(ustore_read_t const& read, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    if (*c_error || !read.offsets || !read.values || !read.tasks_count)
+        return;
+
+    ustore_length_t* offsets = *read.offsets;
+    ustore_length_t* lengths = read.lengths ? *read.lengths : nullptr;
+    ustore_byte_t const* values = *read.values;
+    auto found = [&](std::size_t task_idx) -> value_view_t {
+        if (!lengths)
+            return {values + offsets[task_idx], offsets[task_idx + 1] - offsets[task_idx]};
+        if (lengths[task_idx] == ustore_length_missing_k)
+            return {};
+        return {values + offsets[task_idx], lengths[task_idx]};
+    };
+
+    std::size_t unpacked_length = 0;
+    bool has_packed = false;
+    bool has_unknown_dictionaries = false;
+    for (std::size_t task_idx = 0; task_idx != read.tasks_count; ++task_idx) {
+        value_view_t bytes = found(task_idx);
+        if (!stored_is_packed(bytes)) {
+            unpacked_length += bytes.size();
+            continue;
+        }
+        stored_packed_header_t const header = stored_packed_header(bytes);
+        unpacked_length += header.stored_length;
+        has_packed = true;
+        has_unknown_dictionaries |= header.dictionary_id && !zstd_dictionaries().find(header.dictionary_id);
+    }
+    if (!has_packed)
+        return;
+    if (has_unknown_dictionaries)
+        load_dictionaries(read, arena, c_error);
+    return_if_error_m(c_error);
+
+    auto tape = arena.alloc<byte_t>(unpacked_length + sj::SIMDJSON_PADDING, c_error);
+    return_if_error_m(c_error);
+    ustore_length_t tape_offset = 0;
+    for (std::size_t task_idx = 0; task_idx != read.tasks_count; ++task_idx) {
+        value_view_t bytes = found(task_idx);
+        ustore_length_t length = static_cast<ustore_length_t>(bytes.size());
+        offsets[task_idx] = tape_offset;
+        if (stored_is_packed(bytes)) {
+            stored_packed_header_t const header = stored_packed_header(bytes);
+            auto dictionary = zstd_dictionaries().find(header.dictionary_id);
+            return_error_if_m(header.codec == codec_t::zstd_k && (dictionary || !header.dictionary_id),
+                              c_error,
+                              consistency_k,
+                              "Unknown compression of the document");
+            value_view_t payload {bytes.data() + sizeof(header), bytes.size() - sizeof(header)};
+            length = header.stored_length;
+            return_error_if_m(zstd_decompress(payload, tape.begin() + tape_offset, length, dictionary.get()) == length,
+                              c_error,
+                              consistency_k,
+                              "Corrupted compressed document");
+        }
+        else if (bytes.size())
+            std::memcpy(tape.begin() + tape_offset, bytes.data(), bytes.size());
+
+        if (lengths && lengths[task_idx] != ustore_length_missing_k)
+            lengths[task_idx] = length;
+        tape_offset += length;
+    }
+    offsets[read.tasks_count] = tape_offset;
+    std::memset(tape.begin() + tape_offset, 0, sj::SIMDJSON_PADDING);
+    *read.values = reinterpret_cast<ustore_byte_t*>(tape.begin());
+}
+
 /*********************************************************/
 /*****************	 Primary Functions	  ****************/
 /*********************************************************/
@@ -1224,6 +1778,30 @@ void patch( //
     }
 }
 
+/**
+ * @brief Sums two JSON numbers, keeping the integers integral, unless either of them is real.
+ * Mutable values can be passed by punning, like in `json_branch_t::punned()`.
+ * @return NULL, if either of the values isn't a number.
+ */
+yyjson_mut_val* json_add(yyjson_mut_doc* doc, yyjson_val* lhs, yyjson_val* rhs) noexcept {
+    if (!yyjson_is_num(lhs) || !yyjson_is_num(rhs))
+        return nullptr;
+
+    auto to_f64 = [](yyjson_val* value) {
+        return yyjson_is_real(value)   ? yyjson_get_real(value)
+               : yyjson_is_sint(value) ? static_cast<double>(yyjson_get_sint(value))
+                                       : static_cast<double>(yyjson_get_uint(value));
+    };
+    if (yyjson_is_real(lhs) || yyjson_is_real(rhs))
+        return yyjson_mut_real(doc, to_f64(lhs) + to_f64(rhs));
+
+    auto to_i64 = [](yyjson_val* value) {
+        return yyjson_is_sint(value) ? yyjson_get_sint(value) : static_cast<std::int64_t>(yyjson_get_uint(value));
+    };
+    std::int64_t const sum = to_i64(lhs) + to_i64(rhs);
+    return sum < 0 ? yyjson_mut_sint(doc, sum) : yyjson_mut_uint(doc, static_cast<std::uint64_t>(sum));
+}
+
 void modify( //
     json_t& original,
     yyjson_mut_val* modifier,
@@ -1238,6 +1816,21 @@ void modify( //
         return;
     }
 
+    if (c_modification == doc_modification_t::increment_k) {
+        yyjson_mut_val* current = json_lookup(original.mut_handle->root, field);
+        if (current) {
+            modifier = json_add(original.mut_handle, (yyjson_val*)current, (yyjson_val*)modifier);
+            return_error_if_m(modifier, c_error, args_wrong_k, "Only numbers can be incremented!");
+        }
+        if (!field) {
+            original.mut_handle->root = yyjson_mut_val_mut_copy(original.mut_handle, modifier);
+            return_error_if_m(original.mut_handle->root, c_error, 0, "Failed To Modify!");
+            return;
+        }
+        modify_field(original.mut_handle, modifier, field, doc_modification_t::upsert_k, c_error);
+        return;
+    }
+
     if (field && c_modification != doc_modification_t::patch_k) {
         modify_field(original.mut_handle, modifier, field, c_modification, c_error);
         return_error_if_m(original.mut_handle->root, c_error, 0, "Failed To Modify!");
@@ -1256,6 +1849,88 @@ void modify( //
     return_error_if_m(original.mut_handle->root, c_error, 0, "Failed To Modify!");
 }
 
+/**
+ * @brief Applies the modifications, that only replace scalar members, without parsing the document.
+ * Covers updates, upserts, merges and increments of existing fields with scalars,
+ * as well as JSON Patches consisting only of such "replace" operations.
+ * @return Empty view, if the document must be modified as a parsed tree.
+ */
+value_view_t modify_in_place( //
+    value_view_t binary_doc,
+    yyjson_mut_val* modifier,
+    ustore_str_view_t field,
+    doc_modification_t const c_modification,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    if (!stored_doc_t {binary_doc}.is_indexed() || !modifier)
+        return {};
+
+    yyjson_alc allocator = wrap_allocator(arena);
+    std::string field_pointer;
+    auto replace = [&](value_view_t doc, std::string_view pointer, yyjson_mut_val* value) -> value_view_t {
+        if (yyjson_mut_is_arr(value) || yyjson_mut_is_obj(value))
+            return {};
+        size_t length = 0;
+        char* serialized = json_write(value, &allocator, &length);
+        log_error_if_m(serialized, c_error, 0, "Failed to serialize the document!");
+        if (*c_error)
+            return {};
+        return stored_splice(doc, pointer, {serialized, length}, arena, c_error);
+    };
+
+    switch (c_modification) {
+    case doc_modification_t::update_k:
+    case doc_modification_t::upsert_k:
+    case doc_modification_t::merge_k: return replace(binary_doc, field_to_pointer(field, field_pointer), modifier);
+
+    case doc_modification_t::increment_k: {
+        std::string_view pointer = field_to_pointer(field, field_pointer);
+        auto [current_bytes, suffix] = stored_doc_t {binary_doc}.locate(pointer);
+        if (pointer.empty() || !suffix.empty() || !json_is_scalar(current_bytes))
+            return {};
+        json_t current = json_read(current_bytes, arena, c_error);
+        if (*c_error)
+            return {};
+        yyjson_mut_doc* sum_doc = yyjson_mut_doc_new(&allocator);
+        log_error_if_m(sum_doc, c_error, out_of_memory_k, "Failed to allocate the sum");
+        if (*c_error)
+            return {};
+        yyjson_mut_val* sum = json_add(sum_doc, yyjson_doc_get_root(current.handle), (yyjson_val*)modifier);
+        return sum ? replace(binary_doc, pointer, sum) : value_view_t {};
+    }
+
+    case doc_modification_t::patch_k: {
+        // Every operation must qualify, before anything is spliced
+        if (!yyjson_mut_is_arr(modifier) || !yyjson_mut_arr_size(modifier))
+            return {};
+        std::string_view prefix = field_to_pointer(field, field_pointer);
+        size_t idx, max;
+        yyjson_mut_val* operation;
+        yyjson_mut_arr_foreach(modifier, idx, max, operation) {
+            yyjson_mut_val* op = yyjson_mut_obj_get(operation, "op");
+            yyjson_mut_val* path = yyjson_mut_obj_get(operation, "path");
+            yyjson_mut_val* value = yyjson_mut_obj_get(operation, "value");
+            if (!yyjson_mut_equals_str(op, "replace") || !yyjson_mut_is_str(path) || !value ||
+                yyjson_mut_obj_size(operation) != 3)
+                return {};
+        }
+        value_view_t patched = binary_doc;
+        std::string pointer;
+        yyjson_mut_arr_foreach(modifier, idx, max, operation) {
+            pointer = prefix;
+            pointer += json_get_str(yyjson_mut_obj_get(operation, "path"));
+            patched = replace(patched, pointer, yyjson_mut_obj_get(operation, "value"));
+            if (!patched)
+                return {};
+        }
+        return patched;
+    }
+
+    default: return {};
+    }
+}
+
 template <typename callback_at>
 void read_unique_docs( //
     ustore_database_t const c_db,
@@ -1286,6 +1961,8 @@ void read_unique_docs( //
     read.values = &found_binary_begin;
 
     ustore_read(&read);
+    stored_unpack(read, arena, c_error);
+    return_if_error_m(c_error);
 
     auto found_binaries = joined_blobs_t(places.count, found_binary_offs, found_binary_begin);
     auto found_binary_it = found_binaries.begin();
@@ -1331,8 +2008,9 @@ void read_modify_unique_docs( //
         return read_unique_docs(c_db, c_txn, places, c_options, arena, unique_places, c_error, callback);
 
     auto has_fields = places.fields_begin && (!places.fields_begin.repeats() || *places.fields_begin);
-    bool need_values =
-        has_fields || c_modification == doc_modification_t::patch_k || c_modification == doc_modification_t::merge_k;
+    bool need_values = has_fields || c_modification == doc_modification_t::patch_k ||
+                       c_modification == doc_modification_t::merge_k ||
+                       c_modification == doc_modification_t::increment_k;
 
     if (need_values) {
         ustore_byte_t* found_binary_begin {};
@@ -1352,6 +2030,7 @@ void read_modify_unique_docs( //
         read.values = &found_binary_begin;
 
         ustore_read(&read);
+        stored_unpack(read, arena, c_error);
         return_if_error_m(c_error);
 
         auto found_binaries = joined_blobs_t(places.count, found_binary_offs, found_binary_begin);
@@ -1475,6 +2154,7 @@ void read_modify_docs( //
     read.values = &found_binary_begin;
 
     ustore_read(&read);
+    stored_unpack(read, arena, c_error);
     return_if_error_m(c_error);
 
     // We will later need to locate the data for every separate request.
@@ -1496,6 +2176,65 @@ void read_modify_docs( //
     }
 }
 
+struct docs_schema_t;
+
+/**
+ * @brief Columns and secondary indexes of the collections, that a write touches.
+ * Both are derived from the documents, so they are updated after every write.
+ * Indexes also need the previous revisions of the documents, to remove their stale entries.
+ */
+struct docs_derived_t {
+    ptr_range_gt<docs_schema_t> schemas;
+    joined_blobs_t old_docs;
+    bool has_columns = false;
+    bool has_indexes = false;
+    bool has_compression = false;
+};
+
+docs_derived_t read_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept;
+
+void read_old_docs( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t& derived,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept;
+
+void update_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    joined_blobs_t docs,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept;
+
+void refresh_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept;
+
+bool stored_pack( //
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    growing_tape_t& docs,
+    growing_tape_t& packed,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept;
+
 void read_modify_write( //
     ustore_database_t const c_db,
     ustore_transaction_t const c_txn,
@@ -1504,6 +2243,7 @@ void read_modify_write( //
     ustore_options_t const c_options,
     doc_modification_t const c_modification,
     ustore_doc_field_type_t const c_type,
+    docs_derived_t& derived,
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) noexcept {
 
@@ -1513,9 +2253,24 @@ void read_modify_write( //
 
     yyjson_alc allocator = wrap_allocator(arena);
     auto safe_callback = [&](ustore_size_t task_idx, ustore_str_view_t field, value_view_t binary_doc) {
-        json_t parsed = any_parse(binary_doc, internal_format_k, arena, c_error);
+        // Scalar replacements are spliced into the stored bytes, skipping the whole-document round-trip
+        json_t parsed_task;
+        if (contents[task_idx]) {
+            parsed_task = any_parse(contents[task_idx], c_type, arena, c_error);
+            return_if_error_m(c_error);
+            value_view_t modified =
+                modify_in_place(binary_doc, parsed_task.mut_handle->root, field, c_modification, arena, c_error);
+            return_if_error_m(c_error);
+            if (modified) {
+                growing_tape.push_back(modified, c_error);
+                growing_tape.add_terminator(byte_t {0}, c_error);
+                return;
+            }
+        }
+
+        json_t parsed = stored_parse(binary_doc, arena, c_error);
         if (!contents[task_idx]) {
-            any_dump({nullptr, parsed.mut_handle->root}, internal_format_k, arena, growing_tape, c_error);
+            stored_dump({nullptr, parsed.mut_handle->root}, arena, growing_tape, c_error);
             return;
         }
 
@@ -1524,12 +2279,9 @@ void read_modify_write( //
         if (!parsed.mut_handle)
             parsed.mut_handle = yyjson_doc_mut_copy(parsed.handle, &allocator);
 
-        json_t parsed_task = any_parse(contents[task_idx], c_type, arena, c_error);
-        return_if_error_m(c_error);
-
         // Perform modifications
         modify(parsed, parsed_task.mut_handle->root, field, c_modification, arena, c_error);
-        any_dump({nullptr, parsed.mut_handle->root}, internal_format_k, arena, growing_tape, c_error);
+        stored_dump({nullptr, parsed.mut_handle->root}, arena, growing_tape, c_error);
         return_if_error_m(c_error);
     };
 
@@ -1537,9 +2289,15 @@ void read_modify_write( //
     auto opts = c_txn ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
     read_modify_docs(c_db, c_txn, places, opts, c_modification, arena, unique_places, c_error, safe_callback);
     return_if_error_m(c_error);
+    read_old_docs(c_db, c_txn, unique_places, derived, c_options, arena, c_error);
+    return_if_error_m(c_error);
 
-    // By now, the tape contains concatenated updates docs:
-    ustore_byte_t* tape_begin = reinterpret_cast<ustore_byte_t*>(growing_tape.contents().begin().get());
+    // By now, the tape contains concatenated updates docs, that may need compression
+    growing_tape_t packed_tape {arena};
+    bool const is_packed = stored_pack(unique_places, derived, growing_tape, packed_tape, arena, c_error);
+    return_if_error_m(c_error);
+    growing_tape_t& written_tape = is_packed ? packed_tape : growing_tape;
+    ustore_byte_t* tape_begin = reinterpret_cast<ustore_byte_t*>(written_tape.contents().begin().get());
     ustore_write_t write {};
     write.db = c_db;
     write.error = c_error;
@@ -1551,18 +2309,222 @@ void read_modify_write( //
     write.collections_stride = unique_places.collections_begin.stride();
     write.keys = unique_places.keys_begin.get();
     write.keys_stride = unique_places.keys_begin.stride();
-    write.offsets = growing_tape.offsets().begin().get();
-    write.offsets_stride = growing_tape.offsets().stride();
-    write.lengths = growing_tape.lengths().begin().get();
-    write.lengths_stride = growing_tape.lengths().stride();
+    write.offsets = written_tape.offsets().begin().get();
+    write.offsets_stride = written_tape.offsets().stride();
+    write.lengths = written_tape.lengths().begin().get();
+    write.lengths_stride = written_tape.lengths().stride();
     write.values = &tape_begin;
 
     ustore_write(&write);
+    return_if_error_m(c_error);
+    update_derived(c_db, c_txn, unique_places, derived, growing_tape, c_options, arena, c_error);
 }
 
-void ustore_docs_write(ustore_docs_write_t* c_ptr) {
+/*********************************************************/
+/*****************	    Merge Operands	  ****************/
+/*********************************************************/
+
+/**
+ * Modifications written with `ustore_option_write_merge_k` are applied by the engines.
+ * Every operand starts with the `doc_modification_t` byte, followed by the NULL-terminated
+ * JSON-Pointer of the field, which is empty for the whole document, and the modifier JSON.
+ */
+void merge_doc(value_view_t stored,
+               value_view_t operand,
+               std::string& merged,
+               linked_memory_lock_t& arena,
+               ustore_error_t* c_error) noexcept {
+
+    return_error_if_m(operand.size() > 1, c_error, args_wrong_k, "Invalid merge operand!");
+    char const* field_begin = operand.c_str() + 1;
+    char const* field_end = std::find(field_begin, operand.c_str() + operand.size(), '\0');
+    std::size_t const field_length = static_cast<std::size_t>(field_end - field_begin);
+    return_error_if_m(field_length + 1 < operand.size(), c_error, args_wrong_k, "Invalid merge operand!");
+    auto modification = static_cast<doc_modification_t>(static_cast<std::int8_t>(operand.c_str()[0]));
+    ustore_str_view_t field = field_length ? field_begin : nullptr;
+    value_view_t modifier_json {operand.data() + field_length + 2, operand.size() - field_length - 2};
+
+    json_t modifier = json_parse(modifier_json, arena, c_error);
+    return_if_error_m(c_error);
+    return_error_if_m(modifier, c_error, args_wrong_k, "Invalid merge operand!");
+    stored = stored_unpack(stored, arena, c_error);
+    return_if_error_m(c_error);
+
+    value_view_t result = modify_in_place(stored, modifier.mut_handle->root, field, modification, arena, c_error);
+    return_if_error_m(c_error);
+    growing_tape_t tape(arena);
+    if (!result) {
+        json_t parsed = stored_parse(stored, arena, c_error);
+        return_if_error_m(c_error);
+        modify(parsed, modifier.mut_handle->root, field, modification, arena, c_error);
+        return_if_error_m(c_error);
+        result = stored_dump({nullptr, parsed.mut_handle->root}, arena, tape, c_error);
+        return_if_error_m(c_error);
+    }
+    merged.assign(result.c_str(), result.size());
+}
+
+ustore_error_t unum::ustore::merge_operand(value_view_t stored, value_view_t operand, std::string& merged) noexcept {
+    ustore_error_t error = nullptr;
+    merged.clear();
+    if (is_splice_operand(operand)) {
+        safe_section("Splicing values", &error, [&] { splice_operand(stored, operand, merged); });
+        return error;
+    }
+
+    ustore_arena_t arena_handle = nullptr;
+    safe_section("Merging documents", &error, [&] {
+        linked_memory_lock_t arena = linked_memory(&arena_handle, ustore_options_default_k, &error);
+        if (!error)
+            merge_doc(stored, operand, merged, arena, &error);
+    });
+    ustore_arena_free(arena_handle);
+    return error;
+}
+
+/**
+ * @brief Passes the modifications to the engine as merge operands, so that they are applied
+ * at the storage layer, without reading the documents first.
+ */
+void merge_write( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_options_t const c_options,
+    doc_modification_t const c_modification,
+    ustore_doc_field_type_t const c_type,
+    docs_derived_t& derived,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    return_error_if_m(c_modification != doc_modification_t::insert_k,
+                      c_error,
+                      args_combo_k,
+                      "Inserts must fail on existing keys, so can't be merged!");
+
+    growing_tape_t operands {arena};
+    operands.reserve(places.size(), c_error);
+    return_if_error_m(c_error);
+
+    yyjson_alc allocator = wrap_allocator(arena);
+    string_t operand(arena);
+    std::string field_pointer;
+    for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
+        return_error_if_m(contents[task_idx], c_error, args_wrong_k, "Merged modifications need values!");
+        json_t modifier = any_parse(contents[task_idx], c_type, arena, c_error);
+        return_if_error_m(c_error);
+        size_t modifier_length = 0;
+        char* modifier_json = json_write(modifier.mut_handle->root, &allocator, &modifier_length);
+        return_error_if_m(modifier_json, c_error, 0, "Failed to serialize the modifier!");
+
+        ustore_str_view_t field = places.fields_begin ? places.fields_begin[task_idx] : nullptr;
+        std::string_view pointer = field_to_pointer(field, field_pointer);
+        operand.clear();
+        operand.push_back(static_cast<char>(c_modification), c_error);
+        operand.insert(operand.size(), pointer.data(), pointer.data() + pointer.size(), c_error);
+        operand.push_back('\0', c_error);
+        operand.insert(operand.size(), modifier_json, modifier_json + modifier_length, c_error);
+        operands.push_back(value_view_t {reinterpret_cast<byte_t const*>(operand.data()), operand.size()}, c_error);
+        return_if_error_m(c_error);
+    }
+
+    read_old_docs(c_db, c_txn, places, derived, c_options, arena, c_error);
+    return_if_error_m(c_error);
+
+    ustore_byte_t* operands_begin = reinterpret_cast<ustore_byte_t*>(operands.contents().begin().get());
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_txn;
+    write.arena = arena;
+    write.options = ustore_options_t(c_options | ustore_option_write_merge_k);
+    write.tasks_count = places.count;
+    write.collections = places.collections_begin.get();
+    write.collections_stride = places.collections_begin.stride();
+    write.keys = places.keys_begin.get();
+    write.keys_stride = places.keys_begin.stride();
+    write.offsets = operands.offsets().begin().get();
+    write.offsets_stride = operands.offsets().stride();
+    write.lengths = operands.lengths().begin().get();
+    write.lengths_stride = operands.lengths().stride();
+    write.values = &operands_begin;
+
+    ustore_write(&write);
+    return_if_error_m(c_error);
+    refresh_derived(c_db, c_txn, places, derived, c_options, arena, c_error);
+}
+
+/**
+ * @brief Writes whole documents in the internal format, passing them almost directly to the engine.
+ */
+void write_docs( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    contents_arg_t const& contents,
+    ustore_options_t const c_options,
+    docs_derived_t& derived,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    // Validate and index the JSONs before write
+    growing_tape_t growing_tape {arena};
+    growing_tape.reserve(places.size(), c_error);
+    return_if_error_m(c_error);
+
+    for (std::size_t i = 0; i != contents.size(); ++i) {
+        if (!contents[i]) {
+            growing_tape.push_back(value_view_t {}, c_error);
+            return_if_error_m(c_error);
+            continue;
+        }
+        json_t parsed = json_parse(contents[i], arena, c_error);
+        return_error_if_m(parsed, c_error, 0, "Invalid Json!");
+        stored_dump({yyjson_doc_get_root(parsed.handle), nullptr}, arena, growing_tape, c_error);
+        return_if_error_m(c_error);
+    }
+
+    read_old_docs(c_db, c_txn, places, derived, c_options, arena, c_error);
+    return_if_error_m(c_error);
+
+    growing_tape_t packed_tape {arena};
+    bool const is_packed = stored_pack(places, derived, growing_tape, packed_tape, arena, c_error);
+    return_if_error_m(c_error);
+    growing_tape_t& written_tape = is_packed ? packed_tape : growing_tape;
+    ustore_byte_t* tape_begin = reinterpret_cast<ustore_byte_t*>(written_tape.contents().begin().get());
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_txn;
+    write.arena = arena;
+    write.options = c_options;
+    write.tasks_count = places.count;
+    write.collections = places.collections_begin.get();
+    write.collections_stride = places.collections_begin.stride();
+    write.keys = places.keys_begin.get();
+    write.keys_stride = places.keys_begin.stride();
+    write.offsets = written_tape.offsets().begin().get();
+    write.offsets_stride = written_tape.offsets().stride();
+    write.lengths = written_tape.lengths().begin().get();
+    write.lengths_stride = written_tape.lengths().stride();
+    write.values = &tape_begin;
+
+    ustore_write(&write);
+    return_if_error_m(c_error);
+    update_derived(c_db, c_txn, places, derived, growing_tape, c_options, arena, c_error);
+}
+
+/**
+ * @brief Number of times the writes into indexed collections are attempted,
+ * when they run in internal transactions, that fail to commit.
+ */
+constexpr std::size_t docs_write_attempts_k = 8;
+
+void ustore_docs_write(ustore_docs_write_t* c_ptr) {
 
     ustore_docs_write_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::docs_write_k, c.tasks_count, c.error};
     if (!c.tasks_count)
         return;
 
@@ -1607,60 +2569,161 @@ void ustore_docs_write(ustore_docs_write_t* c_ptr) {
     places_arg_t places {collections, keys, fields, c.tasks_count};
     contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
 
-    if (has_fields || c.type != internal_format_k || c.modification != ustore_doc_modify_upsert_k)
-        return read_modify_write(c.db,
-                                 c.transaction,
-                                 places,
-                                 contents,
-                                 c.options,
-                                 static_cast<doc_modification_t>(c.modification),
-                                 c.type,
-                                 arena,
-                                 c.error);
-
-    // Validate JSONs Before Write
-    ustore_length_t max_length = 0;
-    for (std::size_t i = 0; i != contents.size(); ++i) {
-        if (max_length < contents[i].size() && contents[i].size() != ustore_length_missing_k)
-            max_length = contents[i].size();
-    }
-
-    auto document = arena.alloc<byte_t>(max_length + sj::SIMDJSON_PADDING, c.error);
+    bool const is_modification =
+        has_fields || c.type != internal_format_k || c.modification != ustore_doc_modify_upsert_k;
+    ustore_options_t const options = ustore_options_t(c.options & ~ustore_option_write_merge_k);
+    docs_derived_t derived = read_derived(c.db, c.transaction, places, options, arena, c.error);
     return_if_error_m(c.error);
 
-    sj::dom::parser parser;
-    for (std::size_t i = 0; i < contents.size(); ++i) {
-        std::memcpy(document.begin(), contents[i].data(), contents[i].size());
-        std::memset(document.begin() + contents[i].size(), 0, sj::SIMDJSON_PADDING);
-        auto result = parser.parse((const char*)document.begin(), contents[i].size(), false);
-        return_error_if_m(result.error() == sj::SUCCESS, c.error, 0, "Invalid Json!");
+    auto write = [&](ustore_transaction_t txn) {
+        // Engines can't apply the merge operands to compressed documents, so those are read and modified here
+        if (is_modification && (c.options & ustore_option_write_merge_k) && !derived.has_compression)
+            merge_write(c.db,
+                        txn,
+                        places,
+                        contents,
+                        options,
+                        static_cast<doc_modification_t>(c.modification),
+                        c.type,
+                        derived,
+                        arena,
+                        c.error);
+        else if (is_modification)
+            read_modify_write(c.db,
+                              txn,
+                              places,
+                              contents,
+                              options,
+                              static_cast<doc_modification_t>(c.modification),
+                              c.type,
+                              derived,
+                              arena,
+                              c.error);
+        else
+            write_docs(c.db, txn, places, contents, options, derived, arena, c.error);
+    };
+
+    // Index entries must change atomically with the documents, so if the user
+    // hasn't started a transaction, we start our own, unless the engine has none,
+    // or the user has explicitly traded atomicity for speed with a bulk write.
+    bool const needs_txn = derived.has_indexes && !(options & ustore_option_write_bulk_k);
+    if (!needs_txn || c.transaction || !ustore_supports_transactions_k)
+        return write(c.transaction);
+
+    // Concurrent writes into the same buckets conflict, so those are retried.
+    // The schemas are read again within the transaction, so it also conflicts
+    // with the changes of indexes, while the documents are being written.
+    ustore_transaction_t txn = nullptr;
+    for (std::size_t attempt = 0; attempt != docs_write_attempts_k; ++attempt) {
+        *c.error = nullptr;
+        ustore_transaction_init_t txn_init {};
+        txn_init.db = c.db;
+        txn_init.error = c.error;
+        txn_init.transaction = &txn;
+        ustore_transaction_init(&txn_init);
+        if (*c.error)
+            break;
+
+        derived = read_derived(c.db, txn, places, options, arena, c.error);
+        if (!*c.error)
+            write(txn);
+        if (*c.error)
+            break;
+
+        ustore_transaction_commit_t txn_commit {};
+        txn_commit.db = c.db;
+        txn_commit.error = c.error;
+        txn_commit.transaction = txn;
+        txn_commit.options = ustore_options_t(options & ustore_option_write_flush_k);
+        ustore_transaction_commit(&txn_commit);
+        if (!*c.error)
+            break;
     }
+    ustore_transaction_free(txn);
+}
 
-    ustore_write_t write {};
-    write.db = c.db;
-    write.error = c.error;
-    write.transaction = c.transaction;
-    write.arena = arena;
-    write.options = c.options;
-    write.tasks_count = c.tasks_count;
-    write.collections = c.collections;
-    write.collections_stride = c.collections_stride;
-    write.keys = c.keys ? c.keys : tape.begin();
-    write.keys_stride = c.keys_stride;
-    write.presences = c.presences;
-    write.offsets = c.offsets;
-    write.offsets_stride = c.offsets_stride;
-    write.lengths = c.lengths;
-    write.lengths_stride = c.lengths_stride;
-    write.values = c.values;
-    write.values_stride = c.values_stride;
+/*********************************************************/
+/*****************	 Extracted Fields Cache	  ****************/
+/*********************************************************/
 
-    ustore_write(&write);
+constexpr std::size_t docs_cache_capacity_k = 64 * 1024;
+constexpr std::size_t docs_cache_entry_limit_k = 4 * 1024;
+
+/**
+ * @brief Docs-specific options are consumed here and not forwarded to the engine.
+ */
+inline ustore_options_t engine_options(ustore_options_t options) noexcept {
+    return ustore_options_t(options & ~ustore_option_docs_cache_k);
 }
 
+/**
+ * @brief Bounded process-wide cache of the fields extracted from documents,
+ * enabled with `ustore_option_docs_cache_k`. Entries are keyed by the document,
+ * the field and the requested type. They remain valid only while the fingerprint
+ * of the stored document matches, so any write, from any modality or transaction,
+ * invalidates them without having to be tracked here.
+ */
+class docs_cache_t {
+  public:
+    struct entry_t {
+        std::size_t doc_fingerprint = 0;
+        /// @brief Validity, conversion and collision bits of `ustore_docs_gather` cells.
+        ustore_octet_t flags = 0;
+        std::string bytes;
+    };
+
+  private:
+    std::mutex mutex_;
+    lru_cache_gt<std::string, entry_t> lru_ {docs_cache_capacity_k};
+
+  public:
+    static std::size_t fingerprint(value_view_t doc) noexcept {
+        return std::hash<std::string_view> {}(std::string_view(doc.c_str(), doc.size()));
+    }
+
+    static void key(ustore_collection_t collection,
+                    ustore_key_t key,
+                    ustore_str_view_t field,
+                    ustore_doc_field_type_t type,
+                    std::string& output) {
+        output.clear();
+        output.append(reinterpret_cast<char const*>(&collection), sizeof(collection));
+        output.append(reinterpret_cast<char const*>(&key), sizeof(key));
+        output.push_back(static_cast<char>(type));
+        if (field)
+            output.append(field);
+    }
+
+    /**
+     * @brief Passes the entry into the `callback` under the lock, if it is still valid.
+     * @return True, if the entry was found.
+     */
+    template <typename callback_at>
+    bool find(std::string const& key, std::size_t doc_fingerprint, callback_at callback) {
+        std::unique_lock _ {mutex_};
+        entry_t const* entry = lru_.get_ptr(key);
+        if (!entry || entry->doc_fingerprint != doc_fingerprint)
+            return false;
+        callback(*entry);
+        return true;
+    }
+
+    void insert(std::string const& key, std::size_t doc_fingerprint, ustore_octet_t flags, std::string_view bytes) {
+        if (bytes.size() > docs_cache_entry_limit_k)
+            return;
+        entry_t entry {doc_fingerprint, flags, std::string(bytes)};
+        std::unique_lock _ {mutex_};
+        lru_.pop(key);
+        lru_.insert(key, std::move(entry));
+    }
+};
+
+static docs_cache_t docs_cache;
+
 void ustore_docs_read(ustore_docs_read_t* c_ptr) {
 
     ustore_docs_read_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::docs_read_k, c.tasks_count, c.error};
     if (!c.tasks_count)
         return;
 
@@ -1668,28 +2731,58 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
     return_if_error_m(c.error);
 
     // If user wants the entire doc in the same format, as the one we use internally,
-    // this request can be passed entirely to the underlying Key-Value store.
+    // this request can be passed entirely to the underlying Key-Value store,
+    // only stripping the indexes from the fetched documents.
     strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
     auto has_fields = fields && (!fields.repeats() || *fields);
     if (!has_fields && c.type == internal_format_k) {
+        ustore_length_t* found_offsets = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_byte_t* found_values = nullptr;
         ustore_read_t read {};
         read.db = c.db;
         read.error = c.error;
         read.transaction = c.transaction;
         read.snapshot = c.snapshot;
         read.arena = arena;
-        read.options = c.options;
+        read.options = engine_options(c.options);
         read.tasks_count = c.tasks_count;
         read.collections = c.collections;
         read.collections_stride = c.collections_stride;
         read.keys = c.keys;
         read.keys_stride = c.keys_stride;
         read.presences = c.presences;
-        read.offsets = c.offsets;
-        read.lengths = c.lengths;
-        read.values = c.values;
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+
+        ustore_read(&read);
+        stored_unpack(read, arena, c.error);
+        return_if_error_m(c.error);
 
-        return ustore_read(&read);
+        // Bodies are compacted in-place, as they only move towards the beginning of the tape
+        ustore_length_t exported_length = 0;
+        for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
+            ustore_length_t found_length = found_lengths[task_idx];
+            value_view_t body;
+            if (found_length != ustore_length_missing_k)
+                body = stored_doc_t {{found_values + found_offsets[task_idx], found_length}}.body();
+            if (!body.empty())
+                std::memmove(found_values + exported_length, body.data(), body.size());
+            found_offsets[task_idx] = exported_length;
+            if (found_length != ustore_length_missing_k)
+                found_lengths[task_idx] = static_cast<ustore_length_t>(body.size());
+            exported_length += static_cast<ustore_length_t>(body.size());
+        }
+        found_offsets[c.tasks_count] = exported_length;
+
+        if (c.offsets)
+            *c.offsets = found_offsets;
+        if (c.lengths)
+            *c.lengths = found_lengths;
+        if (c.values)
+            *c.values = found_values;
+        return;
     }
 
     return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
@@ -1704,16 +2797,45 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
     growing_tape.reserve(places.size(), c.error);
     return_if_error_m(c.error);
     sj::ondemand::parser parser;
+    bool const use_cache = c.options & ustore_option_docs_cache_k;
+    std::string cache_key;
+    std::string field_pointer;
+    std::size_t doc_fingerprint = 0;
 
-    auto safe_callback = [&](ustore_size_t, ustore_str_view_t field, value_view_t binary_doc) {
+    auto safe_callback = [&](ustore_size_t task_idx, ustore_str_view_t field, value_view_t binary_doc) {
         if (binary_doc.empty()) {
             growing_tape.push_back(binary_doc, c.error);
             return;
         }
 
+        auto export_result = [&](std::string_view result) {
+            growing_tape.push_back(result, c.error);
+            return_if_error_m(c.error);
+            growing_tape.add_terminator(byte_t {0}, c.error);
+            return_if_error_m(c.error);
+            if (use_cache)
+                docs_cache.insert(cache_key, doc_fingerprint, 0, result);
+        };
+
+        // Hot documents, that haven't changed since the last read, don't have to be parsed again
+        if (use_cache) {
+            place_t place = places[task_idx];
+            docs_cache_t::key(place.collection, place.key, field, c.type, cache_key);
+            doc_fingerprint = docs_cache_t::fingerprint(binary_doc);
+            bool const found = docs_cache.find(cache_key, doc_fingerprint, [&](docs_cache_t::entry_t const& entry) {
+                growing_tape.push_back(entry.bytes, c.error);
+                if (!*c.error)
+                    growing_tape.add_terminator(byte_t {0}, c.error);
+            });
+            if (found)
+                return;
+        }
+
+        // Documents are followed by the padding, so any slice of them can be passed to SIMDJSON
         std::string_view result;
-        auto padded_doc =
-            sj::padded_string_view(binary_doc.c_str(), binary_doc.size(), binary_doc.size() + sj::SIMDJSON_PADDING);
+        stored_doc_t stored {binary_doc};
+        value_view_t body = stored.body();
+        auto padded_doc = sj::padded_string_view(body.c_str(), body.size(), body.size() + sj::SIMDJSON_PADDING);
 
         string_t output {arena};
         if (c.type == ustore_doc_field_msgpack_k) {
@@ -1722,36 +2844,36 @@ void ustore_docs_read(ustore_docs_read_t* c_ptr) {
         }
         else if (c.type == ustore_doc_field_bson_k) {
             bson_error_t error;
-            bson_t* b = bson_new_from_json((uint8_t*)binary_doc.c_str(), -1, &error);
+            bson_t* b = bson_new_from_json((uint8_t*)body.c_str(), static_cast<ssize_t>(body.size()), &error);
             result = {(const char*)bson_get_data(b), b->len};
-            growing_tape.push_back(result, c.error);
-            growing_tape.add_terminator(byte_t {0}, c.error);
-            return_if_error_m(c.error);
+            export_result(result);
             bson_clear(&b);
             return;
         }
         else {
-            auto maybe_doc = parser.iterate(padded_doc);
+            // Only the deepest indexed member on the way to the field is parsed
+            auto [member, suffix] = stored.locate(field_to_pointer(field, field_pointer));
+            auto padded_member =
+                sj::padded_string_view(member.c_str(), member.size(), member.size() + sj::SIMDJSON_PADDING);
+            auto maybe_doc = parser.iterate(padded_member);
             return_error_if_m(maybe_doc.error() == sj::SUCCESS, c.error, 0, "Fail To Parse Document!");
             printed_number_buffer_t print_buffer;
             if (maybe_doc.value().is_scalar())
                 result = get_value(maybe_doc.value(), c.type, print_buffer);
             else {
                 auto parsed = maybe_doc.value().get_value();
-                auto branch = simdjson_lookup(parsed.value(), field);
+                auto branch = simdjson_lookup(parsed.value(), pointer_or_root(suffix));
                 result = get_value(branch, c.type, print_buffer);
             }
         }
-        growing_tape.push_back(result, c.error);
-        growing_tape.add_terminator(byte_t {0}, c.error);
-        return_if_error_m(c.error);
+        export_result(result);
     };
 
     places_arg_t unique_places;
     read_modify_docs(c.db,
                      c.transaction,
                      places,
-                     c.options,
+                     engine_options(c.options),
                      doc_modification_t::nothing_k,
                      arena,
                      unique_places,
@@ -1854,7 +2976,7 @@ void ustore_docs_gist(ustore_docs_gist_t* c_ptr) {
     read.transaction = c.transaction;
     read.snapshot = c.snapshot;
     read.arena = arena;
-    read.options = c.options;
+    read.options = engine_options(c.options);
     read.tasks_count = c.docs_count;
     read.collections = c.collections;
     read.collections_stride = c.collections_stride;
@@ -1866,6 +2988,7 @@ void ustore_docs_gist(ustore_docs_gist_t* c_ptr) {
     read.values = &found_binary_begin;
 
     ustore_read(&read);
+    stored_unpack(read, arena, c.error);
     return_if_error_m(c.error);
 
     strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
@@ -1883,7 +3006,7 @@ void ustore_docs_gist(ustore_docs_gist_t* c_ptr) {
         if (!binary_doc)
             continue;
 
-        json_t doc = any_parse(binary_doc, internal_format_k, arena, c.error);
+        json_t doc = stored_parse(binary_doc, arena, c.error);
         return_if_error_m(c.error);
         if (!doc)
             continue;
@@ -1961,7 +3084,6 @@ struct column_begin_t {
                         printed_number_buffer_t& print_buffer,
                         string_t& output,
                         bool with_separator,
-                        bool is_last,
                         ustore_error_t* c_error) noexcept {
 
         ustore_octet_t mask = static_cast<ustore_octet_t>(1 << (doc_idx % CHAR_BIT));
@@ -1978,209 +3100,2479 @@ struct column_begin_t {
         return_if_error_m(c_error);
         if (with_separator)
             output.push_back('\0', c_error);
-        if (is_last)
-            str_offsets[doc_idx + 1] = static_cast<ustore_length_t>(output.size());
     }
-};
-
-void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
 
-    ustore_docs_gather_t& c = *c_ptr;
-    if (!c.docs_count || !c.fields_count)
-        return;
+    /** @brief Exports the `value` in the requested `type`, if it is supported. */
+    inline void set_any(std::size_t doc_idx,
+                        ustore_doc_field_type_t type,
+                        yyjson_val* value,
+                        printed_number_buffer_t& print_buffer,
+                        string_t& output,
+                        ustore_error_t* c_error) noexcept {
+        switch (type) {
 
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+        case ustore_doc_field_bool_k: set<bool>(doc_idx, value); break;
 
-    // Retrieve the entire documents before we can sample internal fields
-    ustore_byte_t* found_binary_begin {};
-    ustore_length_t* found_binary_offs {};
-    ustore_read_t read {};
-    read.db = c.db;
-    read.error = c.error;
-    read.transaction = c.transaction;
-    read.snapshot = c.snapshot;
-    read.arena = arena;
-    read.options = c.options;
-    read.tasks_count = c.docs_count;
-    read.collections = c.collections;
-    read.collections_stride = c.collections_stride;
-    read.keys = c.keys;
-    read.keys_stride = c.keys_stride;
-    read.offsets = &found_binary_offs;
-    read.values = &found_binary_begin;
+        case ustore_doc_field_i8_k: set<std::int8_t>(doc_idx, value); break;
+        case ustore_doc_field_i16_k: set<std::int16_t>(doc_idx, value); break;
+        case ustore_doc_field_i32_k: set<std::int32_t>(doc_idx, value); break;
+        case ustore_doc_field_i64_k: set<std::int64_t>(doc_idx, value); break;
 
-    ustore_read(&read);
-    return_if_error_m(c.error);
+        case ustore_doc_field_u8_k: set<std::uint8_t>(doc_idx, value); break;
+        case ustore_doc_field_u16_k: set<std::uint16_t>(doc_idx, value); break;
+        case ustore_doc_field_u32_k: set<std::uint32_t>(doc_idx, value); break;
+        case ustore_doc_field_u64_k: set<std::uint64_t>(doc_idx, value); break;
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
-    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
-    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+        case ustore_doc_field_f32_k: set<float>(doc_idx, value); break;
+        case ustore_doc_field_f64_k: set<double>(doc_idx, value); break;
 
-    joined_blobs_t found_binaries {c.docs_count, found_binary_offs, found_binary_begin};
-    joined_blobs_iterator_t found_binary_it = found_binaries.begin();
+        case ustore_doc_field_str_k: set_str(doc_idx, value, print_buffer, output, true, c_error); break;
+        case ustore_doc_field_bin_k: set_str(doc_idx, value, print_buffer, output, false, c_error); break;
 
-    // Estimate the amount of memory needed to store at least scalars and columns addresses
-    // TODO: Align offsets of bitmaps to 64-byte boundaries for Arrow
-    // https://arrow.apache.org/docs/format/Columnar.html#buffer-alignment-and-padding
-    // TODO: Align offsets of bitmaps to 64-byte boundaries for Arrow
-    // https://arrow.apache.org/docs/format/Columnar.html#buffer-alignment-and-padding
-    bool wants_conversions = c.columns_conversions;
-    bool wants_collisions = c.columns_collisions;
-    std::size_t slots_per_bitmap = divide_round_up<std::size_t>(c.docs_count, bits_in_byte_k);
-    std::size_t count_bitmaps = 1ul + wants_conversions + wants_collisions;
-    std::size_t bytes_per_bitmap = sizeof(ustore_octet_t) * slots_per_bitmap;
-    std::size_t bytes_per_addresses_row = sizeof(void*) * c.fields_count;
-    std::size_t bytes_for_addresses = bytes_per_addresses_row * 6 + sizeof(ustore_length_t);
-    std::size_t bytes_for_bitmaps = bytes_per_bitmap * count_bitmaps * c.fields_count * c.fields_count;
-    std::size_t bytes_per_scalars_row = transform_reduce_n(types, c.fields_count, 0ul, &doc_field_size_bytes);
-    std::size_t bytes_for_scalars = bytes_per_scalars_row * c.docs_count;
+        default: break;
+        }
+    }
 
-    std::size_t string_columns = transform_reduce_n(types, c.fields_count, 0ul, doc_field_is_variable_length);
-    bool has_string_columns = string_columns != 0;
-    bool has_scalar_columns = string_columns != c.fields_count;
+    /** @brief Packs the validity, conversion and collision bits of a cell into one byte. */
+    inline ustore_octet_t flags(std::size_t doc_idx) const noexcept {
+        auto bit = [=](ustore_octet_t const* bitmap) {
+            return static_cast<ustore_octet_t>((bitmap[doc_idx / CHAR_BIT] >> (doc_idx % CHAR_BIT)) & 1u);
+        };
+        return static_cast<ustore_octet_t>(bit(validities) | (bit(conversions) << 1) | (bit(collisions) << 2));
+    }
 
-    // Preallocate at least a minimum amount of memory.
-    // It will be organized in the following way:
-    // 1. validity bitmaps for all fields
-    // 2. optional conversion bitmaps for all fields
-    // 3. optional collision bitmaps for all fields
-    // 4. offsets of all strings
-    // 5. lengths of all strings
-    // 6. scalars for all fields
+    /** @brief Views the exported contents of a cell, excluding the strings separator. */
+    inline std::string_view cell(std::size_t doc_idx, ustore_doc_field_type_t type, string_t const& output) const {
+        if (!doc_field_is_variable_length(type)) {
+            std::size_t size = doc_field_size_bytes(type);
+            return {reinterpret_cast<char const*>(scalars) + doc_idx * size, size};
+        }
+        return {output.data() + str_offsets[doc_idx], str_lengths[doc_idx]};
+    }
 
-    auto tape = arena.alloc<byte_t>(bytes_for_addresses + bytes_for_bitmaps + bytes_for_scalars, c.error);
-    byte_t* const tape_ptr = tape.begin();
+    /** @brief Exports a cell previously extracted from the same document, bypassing the parser. */
+    inline void restore(std::size_t doc_idx,
+                        ustore_doc_field_type_t type,
+                        ustore_octet_t cell_flags,
+                        std::string_view bytes,
+                        string_t& output,
+                        ustore_error_t* c_error) noexcept {
 
-    // If those pointers were not provided, we can reuse the validity bitmap
-    // It will allow us to avoid extra checks later.
-    // ! Still, in every sequence of updates, validity is the last bit to be set,
-    // ! to avoid overwriting.
-    auto first_collection_validities = reinterpret_cast<ustore_octet_t*>(tape_ptr + bytes_for_addresses);
-    auto first_collection_conversions = wants_conversions //
-                                            ? first_collection_validities + slots_per_bitmap * c.fields_count
-                                            : first_collection_validities;
-    auto first_collection_collisions = wants_collisions //
-                                           ? first_collection_conversions + slots_per_bitmap * c.fields_count
-                                           : first_collection_validities;
-    auto first_collection_scalars = reinterpret_cast<ustore_byte_t*>(tape_ptr + bytes_for_addresses + bytes_for_bitmaps);
+        if (!doc_field_is_variable_length(type))
+            std::memcpy(scalars + doc_idx * bytes.size(), bytes.data(), bytes.size());
+        else {
+            str_offsets[doc_idx] = static_cast<ustore_length_t>(output.size());
+            str_lengths[doc_idx] = static_cast<ustore_length_t>(bytes.size());
+            output.insert(output.size(), bytes.begin(), bytes.end(), c_error);
+            return_if_error_m(c_error);
+            if (type == ustore_doc_field_str_k)
+                output.push_back('\0', c_error);
+        }
 
-    // 1, 2, 3. Export validity maps addresses
-    std::size_t tape_progress = 0;
-    {
-        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
-        if (c.columns_validities)
-            *c.columns_validities = addresses;
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
-            addresses[field_idx] = first_collection_validities + field_idx * slots_per_bitmap;
-        tape_progress += bytes_per_addresses_row;
-    }
-    if (wants_conversions) {
-        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
-        if (c.columns_conversions)
-            *c.columns_conversions = addresses;
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
-            addresses[field_idx] = first_collection_conversions + field_idx * slots_per_bitmap;
-        tape_progress += bytes_per_addresses_row;
-    }
-    if (wants_collisions) {
-        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
-        if (c.columns_collisions)
-            *c.columns_collisions = addresses;
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
-            addresses[field_idx] = first_collection_collisions + field_idx * slots_per_bitmap;
-        tape_progress += bytes_per_addresses_row;
+        // Validity goes last, as the other bitmaps may alias it
+        ustore_octet_t mask = static_cast<ustore_octet_t>(1 << (doc_idx % CHAR_BIT));
+        auto assign = [&](ustore_octet_t* bitmap, bool value) {
+            ustore_octet_t& slot = bitmap[doc_idx / CHAR_BIT];
+            slot = value ? (slot | mask) : (slot & ~mask);
+        };
+        assign(conversions, cell_flags & 2u);
+        assign(collisions, cell_flags & 4u);
+        assign(validities, cell_flags & 1u);
     }
+};
 
-    // 4, 5, 6. Export addresses for scalars, strings offsets and strings lengths
-    auto addresses_offs = reinterpret_cast<ustore_length_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 0);
-    if (c.columns_offsets)
-        *c.columns_offsets = addresses_offs;
-    auto addresses_lens = reinterpret_cast<ustore_length_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 1);
-    if (c.columns_lengths)
-        *c.columns_lengths = addresses_lens;
-    auto addresses_scalars = reinterpret_cast<ustore_byte_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 2);
-    if (c.columns_scalars)
-        *c.columns_scalars = addresses_scalars;
+/*********************************************************/
+/*****************	 Columnar Collections	  ****************/
+/*********************************************************/
 
-    {
-        auto scalars_tape = first_collection_scalars;
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
-            ustore_doc_field_type_t type = types[field_idx];
-            switch (type) {
-            case ustore_doc_field_str_k:
-            case ustore_doc_field_bin_k:
-                addresses_offs[field_idx] = reinterpret_cast<ustore_length_t*>(scalars_tape);
-                addresses_lens[field_idx] = addresses_offs[field_idx] + c.docs_count + 1;
-                addresses_scalars[field_idx] = nullptr;
-                break;
-            default:
-                addresses_offs[field_idx] = nullptr;
-                addresses_lens[field_idx] = nullptr;
-                addresses_scalars[field_idx] = reinterpret_cast<ustore_byte_t*>(scalars_tape);
-                break;
+ustore_key_t ustore_docs_schema_key_k = std::numeric_limits<ustore_key_t>::min();
+
+constexpr std::size_t columns_batch_k = 1024;
+
+/**
+ * @brief One column of a collection in the "columnar" mode.
+ * Stores a cell for every document, keyed by the document key, in the `collection`.
+ * Cells have the same layout as the `docs_cache` entries: a byte of validity,
+ * conversion and collision flags, followed by the value exported by `ustore_docs_gather`.
+ */
+struct docs_column_t {
+    /** @brief NULL-terminated JSON-Pointer. */
+    std::string_view field;
+    ustore_doc_field_type_t type = ustore_doc_field_null_k;
+    ustore_collection_t collection = ustore_collection_main_k;
+};
+
+/**
+ * @brief Secondary index of a collection. @see `ustore_docs_index`.
+ * Has the same members as a column, but its `collection` keeps buckets of document keys.
+ */
+using docs_index_t = docs_column_t;
+
+/**
+ * @brief Everything derived from the documents of a collection, as listed in its schema document.
+ */
+struct docs_schema_t {
+    ustore_collection_t collection = ustore_collection_main_k;
+    ptr_range_gt<docs_column_t> columns;
+    ptr_range_gt<docs_index_t> indexes;
+    /** @brief Codec of the newly written documents. @see `ustore_docs_compress`. */
+    codec_t codec = codec_t::none_k;
+    int level = zstd_default_level_k;
+    /** @brief Registered dictionary of the codec, or zero, if it has none. */
+    std::uint32_t dictionary_id = 0;
+
+    bool is_empty() const noexcept { return !columns.size() && !indexes.size() && codec == codec_t::none_k; }
+};
+
+/**
+ * @brief Reads, that writes issue to maintain the columns and indexes, only keep the options reads accept.
+ */
+inline ustore_options_t read_options(ustore_options_t options) noexcept {
+    return ustore_options_t((options & ustore_option_transaction_dont_watch_k) | ustore_option_dont_discard_memory_k);
+}
+
+/**
+ * @brief Parses one of the arrays of the schema document.
+ * Fields point into the parsed document, allocated in the `arena`.
+ */
+ptr_range_gt<docs_column_t> parse_columns(yyjson_val* array,
+                                          linked_memory_lock_t& arena,
+                                          ustore_error_t* c_error) noexcept {
+    if (!yyjson_arr_size(array))
+        return {};
+
+    auto columns = arena.alloc<docs_column_t>(yyjson_arr_size(array), c_error);
+    if (*c_error)
+        return {};
+
+    size_t idx, max;
+    yyjson_val* column;
+    yyjson_arr_foreach(array, idx, max, column) {
+        yyjson_val* field = yyjson_obj_get(column, "field");
+        columns[idx].field = {yyjson_get_str(field), yyjson_get_len(field)};
+        columns[idx].type = static_cast<ustore_doc_field_type_t>(yyjson_get_uint(yyjson_obj_get(column, "type")));
+        columns[idx].collection = yyjson_get_uint(yyjson_obj_get(column, "collection"));
+    }
+    return columns;
+}
+
+void parse_schema(value_view_t schema_doc,
+                  docs_schema_t& schema,
+                  linked_memory_lock_t& arena,
+                  ustore_error_t* c_error) noexcept {
+    json_t parsed = json_read(stored_doc_t {schema_doc}.body(), arena, c_error);
+    if (*c_error || !parsed)
+        return;
+
+    yyjson_val* root = yyjson_doc_get_root(parsed.handle);
+    schema.columns = parse_columns(yyjson_obj_get(root, "columns"), arena, c_error);
+    return_if_error_m(c_error);
+    schema.indexes = parse_columns(yyjson_obj_get(root, "indexes"), arena, c_error);
+    return_if_error_m(c_error);
+
+    // Dictionaries are only decoded, when they are seen for the first time since the start of the process
+    yyjson_val* compression = yyjson_obj_get(root, "compression");
+    if (!compression)
+        return;
+    schema.codec = codec_t::zstd_k;
+    schema.level = static_cast<int>(yyjson_get_int(yyjson_obj_get(compression, "level")));
+    schema.dictionary_id = static_cast<std::uint32_t>(yyjson_get_uint(yyjson_obj_get(compression, "dictionary_id")));
+    if (!schema.dictionary_id || zstd_dictionaries().find(schema.dictionary_id))
+        return;
+
+    yyjson_val* encoded = yyjson_obj_get(compression, "dictionary");
+    string_t dictionary(arena);
+    bool const is_valid = base64_decode({yyjson_get_str(encoded), yyjson_get_len(encoded)}, dictionary, c_error);
+    return_if_error_m(c_error);
+    return_error_if_m(is_valid, c_error, consistency_k, "Corrupted compression dictionary");
+    safe_section("Registering dictionary", c_error, [&] {
+        std::uint32_t id = zstd_dictionaries().insert({dictionary.data(), dictionary.size()});
+        log_error_if_m(id == schema.dictionary_id, c_error, consistency_k, "Corrupted compression dictionary");
+    });
+}
+
+/**
+ * @brief Reads the schemas of all the distinct collections among the `places`.
+ * Collections without columns and indexes are exported with empty lists.
+ */
+ptr_range_gt<docs_schema_t> read_schemas( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    ustore_snapshot_t const c_snapshot,
+    places_arg_t const& places,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    uninitialized_array_gt<docs_schema_t> schemas(arena);
+    for (std::size_t i = 0; i != places.size() && !*c_error; ++i) {
+        ustore_collection_t collection = places[i].collection;
+        auto it = std::find_if(schemas.begin(), schemas.end(), [=](docs_schema_t const& schema) {
+            return schema.collection == collection;
+        });
+        if (it == schemas.end())
+            schemas.push_back(docs_schema_t {collection, {}, {}, codec_t::none_k, zstd_default_level_k, 0}, c_error);
+    }
+    if (*c_error || !schemas.size())
+        return {};
+
+    ustore_length_t* found_offsets {};
+    ustore_length_t* found_lengths {};
+    ustore_byte_t* found_values {};
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_txn;
+    read.snapshot = c_snapshot;
+    read.arena = arena;
+    read.options = read_options(c_options);
+    read.tasks_count = schemas.size();
+    read.collections = &schemas.begin()->collection;
+    read.collections_stride = sizeof(docs_schema_t);
+    read.keys = &ustore_docs_schema_key_k;
+    read.keys_stride = 0;
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    if (*c_error)
+        return {};
+
+    for (std::size_t i = 0; i != schemas.size() && !*c_error; ++i)
+        if (found_lengths[i] != ustore_length_missing_k)
+            parse_schema({found_values + found_offsets[i], found_lengths[i]}, schemas[i], arena, c_error);
+    return {schemas.begin(), schemas.end()};
+}
+
+/**
+ * @brief Registers the dictionaries of all the collections, that a `read` addresses.
+ */
+void load_dictionaries(ustore_read_t const& read, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept {
+    strided_iterator_gt<ustore_collection_t const> collections {read.collections, read.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {read.keys, read.keys_stride};
+    places_arg_t places {collections, keys, {}, read.tasks_count};
+    read_schemas(read.db, read.transaction, read.snapshot, places, read.options, arena, c_error);
+}
+
+/**
+ * @brief Stores the schema document of a collection, or removes it, if it has no columns,
+ * no indexes and isn't compressed.
+ */
+void write_schema( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    docs_schema_t const& schema,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    growing_tape_t schema_tape(arena);
+    if (!schema.is_empty()) {
+        yyjson_alc allocator = wrap_allocator(arena);
+        json_t json;
+        json.mut_handle = yyjson_mut_doc_new(&allocator);
+        return_error_if_m(json.mut_handle, c_error, out_of_memory_k, "Failed to allocate the schema");
+        yyjson_mut_doc* doc = json.mut_handle;
+        yyjson_mut_val* root = yyjson_mut_obj(doc);
+        yyjson_mut_doc_set_root(doc, root);
+        auto add_array = [&](char const* name, ptr_range_gt<docs_column_t> columns) {
+            if (!columns.size())
+                return;
+            yyjson_mut_val* array = yyjson_mut_arr(doc);
+            yyjson_mut_obj_add(root, yyjson_mut_str(doc, name), array);
+            for (docs_column_t const& column : columns) {
+                yyjson_mut_val* object = yyjson_mut_obj(doc);
+                yyjson_mut_obj_add(object,
+                                   yyjson_mut_str(doc, "field"),
+                                   yyjson_mut_strn(doc, column.field.data(), column.field.size()));
+                yyjson_mut_obj_add(object, yyjson_mut_str(doc, "type"), yyjson_mut_uint(doc, column.type));
+                yyjson_mut_obj_add(object, yyjson_mut_str(doc, "collection"), yyjson_mut_uint(doc, column.collection));
+                yyjson_mut_arr_append(array, object);
+            }
+        };
+        add_array("columns", schema.columns);
+        add_array("indexes", schema.indexes);
+        if (schema.codec != codec_t::none_k) {
+            yyjson_mut_val* object = yyjson_mut_obj(doc);
+            yyjson_mut_obj_add(root, yyjson_mut_str(doc, "compression"), object);
+            yyjson_mut_obj_add(object, yyjson_mut_str(doc, "codec"), yyjson_mut_str(doc, "zstd"));
+            yyjson_mut_obj_add(object, yyjson_mut_str(doc, "level"), yyjson_mut_int(doc, schema.level));
+            yyjson_mut_obj_add(object, yyjson_mut_str(doc, "dictionary_id"), yyjson_mut_uint(doc, schema.dictionary_id));
+            if (auto dictionary = zstd_dictionaries().find(schema.dictionary_id); dictionary) {
+                string_t encoded(arena);
+                base64_encode(dictionary->bytes(), encoded, c_error);
+                return_if_error_m(c_error);
+                yyjson_mut_obj_add(object,
+                                   yyjson_mut_str(doc, "dictionary"),
+                                   yyjson_mut_strn(doc, encoded.data(), encoded.size()));
             }
-            scalars_tape += doc_field_size_bytes(type) * c.docs_count + sizeof(ustore_length_t);
         }
+        stored_dump({nullptr, root}, arena, schema_tape, c_error);
     }
+    else
+        schema_tape.push_back(value_view_t {}, c_error);
+    return_if_error_m(c_error);
 
-    // Go though all the documents extracting and type-checking the relevant parts
-    printed_number_buffer_t print_buffer;
-    string_t string_tape(arena);
-    for (ustore_size_t doc_idx = 0; doc_idx != c.docs_count; ++doc_idx, ++found_binary_it) {
-        value_view_t binary_doc = *found_binary_it;
-        json_t doc = any_parse(binary_doc, internal_format_k, arena, c.error);
-        return_if_error_m(c.error);
-        if (!doc)
-            continue;
+    ustore_byte_t* schema_begin = reinterpret_cast<ustore_byte_t*>(schema_tape.contents().begin().get());
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_txn;
+    write.arena = arena;
+    write.options = c_options;
+    write.tasks_count = 1;
+    write.collections = &schema.collection;
+    write.keys = &ustore_docs_schema_key_k;
+    write.offsets = schema_tape.offsets().begin().get();
+    write.lengths = schema_tape.lengths().begin().get();
+    write.values = &schema_begin;
+    ustore_write(&write);
+}
+
+/**
+ * @brief Accumulates the cells of the shredded documents, until they are written into columns.
+ */
+struct columns_batch_t {
+    uninitialized_array_gt<ustore_collection_t> collections;
+    uninitialized_array_gt<ustore_key_t> keys;
+    growing_tape_t cells;
+    string_t strings;
+    string_t cell;
+
+    columns_batch_t(linked_memory_lock_t& arena) noexcept
+        : collections(arena), keys(arena), cells(arena), strings(arena), cell(arena) {}
+
+    std::size_t size() const noexcept { return keys.size(); }
+
+    /**
+     * @brief Exports the cells of all the `columns` from a stored document.
+     * Missing documents remove their cells.
+     */
+    void shred(ustore_key_t key,
+               value_view_t binary_doc,
+               ptr_range_gt<docs_column_t> columns,
+               linked_memory_lock_t& arena,
+               ustore_error_t* c_error) noexcept {
+
+        json_t doc = json_read(stored_doc_t {binary_doc}.body(), arena, c_error);
+        return_if_error_m(c_error);
         yyjson_val* root = yyjson_doc_get_root(doc.handle);
 
-        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        printed_number_buffer_t print_buffer;
+        for (docs_column_t const& column : columns) {
+            collections.push_back(column.collection, c_error);
+            keys.push_back(key, c_error);
+            return_if_error_m(c_error);
+            if (!root) {
+                cells.push_back(value_view_t {}, c_error);
+                return_if_error_m(c_error);
+                continue;
+            }
 
-            // Find this field within document
-            ustore_doc_field_type_t type = types[field_idx];
-            ustore_str_view_t field = fields[field_idx];
-            yyjson_val* found_value = json_lookup(root, field);
-
-            column_begin_t column {};
-            column.validities = (*c.columns_validities)[field_idx];
-            column.conversions = (*(c.columns_conversions ? c.columns_conversions : c.columns_validities))[field_idx];
-            column.collisions = (*(c.columns_collisions ? c.columns_collisions : c.columns_validities))[field_idx];
-            column.scalars = addresses_scalars[field_idx];
-            column.str_offsets = addresses_offs[field_idx];
-            column.str_lengths = addresses_lens[field_idx];
-
-            bool is_last = doc_idx == c.docs_count - 1;
-            // Export the types
-            switch (type) {
+            // Export a single-row column, the same way `ustore_docs_gather` would
+            ustore_octet_t validity = 0, conversion = 0, collision = 0;
+            alignas(std::uint64_t) ustore_byte_t scalar[sizeof(std::uint64_t)];
+            ustore_length_t offsets[2] = {0, 0};
+            ustore_length_t lengths[1] = {0};
+            column_begin_t exported {&validity, &conversion, &collision, scalar, offsets, lengths};
+            yyjson_val* value = json_lookupn(root, column.field.data(), column.field.size());
+            strings.clear();
+            exported.set_any(0, column.type, value, print_buffer, strings, c_error);
+            return_if_error_m(c_error);
 
-            case ustore_doc_field_bool_k: column.set<bool>(doc_idx, found_value); break;
+            std::string_view bytes = exported.cell(0, column.type, strings);
+            cell.clear();
+            cell.push_back(static_cast<char>(exported.flags(0)), c_error);
+            cell.insert(cell.size(), bytes.data(), bytes.data() + bytes.size(), c_error);
+            cells.push_back(value_view_t {reinterpret_cast<byte_t const*>(cell.data()), cell.size()}, c_error);
+            return_if_error_m(c_error);
+        }
+    }
 
-            case ustore_doc_field_i8_k: column.set<std::int8_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i16_k: column.set<std::int16_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i32_k: column.set<std::int32_t>(doc_idx, found_value); break;
-            case ustore_doc_field_i64_k: column.set<std::int64_t>(doc_idx, found_value); break;
+    void write(ustore_database_t const c_db,
+               ustore_transaction_t const c_txn,
+               ustore_options_t const c_options,
+               ustore_arena_t* c_arena,
+               ustore_error_t* c_error) noexcept {
 
-            case ustore_doc_field_u8_k: column.set<std::uint8_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u16_k: column.set<std::uint16_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u32_k: column.set<std::uint32_t>(doc_idx, found_value); break;
-            case ustore_doc_field_u64_k: column.set<std::uint64_t>(doc_idx, found_value); break;
+        if (!size())
+            return;
 
-            case ustore_doc_field_f32_k: column.set<float>(doc_idx, found_value); break;
-            case ustore_doc_field_f64_k: column.set<double>(doc_idx, found_value); break;
+        ustore_byte_t* cells_begin = reinterpret_cast<ustore_byte_t*>(cells.contents().begin().get());
+        ustore_write_t write {};
+        write.db = c_db;
+        write.error = c_error;
+        write.transaction = c_txn;
+        write.arena = c_arena;
+        write.options = c_options;
+        write.tasks_count = size();
+        write.collections = collections.begin();
+        write.collections_stride = sizeof(ustore_collection_t);
+        write.keys = keys.begin();
+        write.keys_stride = sizeof(ustore_key_t);
+        write.offsets = cells.offsets().begin().get();
+        write.offsets_stride = cells.offsets().stride();
+        write.lengths = cells.lengths().begin().get();
+        write.lengths_stride = cells.lengths().stride();
+        write.values = &cells_begin;
+        ustore_write(&write);
+
+        collections.clear();
+        keys.clear();
+        cells.clear();
+    }
+};
 
-            case ustore_doc_field_str_k:
-                column.set_str(doc_idx, found_value, print_buffer, string_tape, true, is_last, c.error);
-                break;
-            case ustore_doc_field_bin_k:
-                column.set_str(doc_idx, found_value, print_buffer, string_tape, false, is_last, c.error);
-                break;
+/**
+ * @brief Infers the type of a column from one of its values.
+ * @return `::ustore_doc_field_null_k`, if the value doesn't hint the type.
+ */
+ustore_doc_field_type_t infer_column_type(yyjson_val* value) noexcept {
+    switch (yyjson_get_type(value)) {
+    case YYJSON_TYPE_BOOL: return ustore_doc_field_bool_k;
+    case YYJSON_TYPE_NUM:
+        return yyjson_get_subtype(value) == YYJSON_SUBTYPE_REAL ? ustore_doc_field_f64_k : ustore_doc_field_i64_k;
+    case YYJSON_TYPE_STR:
+    case YYJSON_TYPE_ARR:
+    case YYJSON_TYPE_OBJ: return ustore_doc_field_str_k;
+    default: return ustore_doc_field_null_k;
+    }
+}
 
-            default: break;
+constexpr std::size_t gather_alignment_k = 64;
+constexpr std::size_t gather_docs_per_block_k = gather_alignment_k * CHAR_BIT;
+
+/**
+ * @brief Per-thread state of `ustore_docs_gather`.
+ * Strings are exported into a private arena and appended to the shared tape in the end.
+ */
+struct gather_worker_t {
+    ustore_arena_t arena = nullptr;
+    ustore_error_t error = nullptr;
+    std::size_t docs_begin = 0;
+    std::size_t docs_end = 0;
+    std::string_view strings;
+};
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+/*********************************************************/
+/*****************	      Filters	      ****************/
+/*********************************************************/
+
+/**
+ * @brief Node of a parsed filter. Comparisons reference a `column` gathered from the documents,
+ * while logical operators reference other nodes of the same filter by their indexes.
+ */
+struct filter_node_t {
+    enum kind_t { compare_k, and_k, or_k, not_k };
+    enum operator_t { equal_k, not_equal_k, less_k, less_equal_k, greater_k, greater_equal_k };
+
+    kind_t kind = compare_k;
+    operator_t op = equal_k;
+    std::size_t left = 0;
+    std::size_t right = 0;
+    std::size_t column = 0;
+
+    double number = 0;
+    bool boolean = false;
+    std::string_view string;
+};
+
+/**
+ * @brief Columns of all the fields compared in a filter, gathered with a single `ustore_docs_gather`.
+ */
+struct filter_columns_t {
+    ustore_octet_t** validities = nullptr;
+    ustore_octet_t** conversions = nullptr;
+    ustore_byte_t** scalars = nullptr;
+    ustore_length_t** offsets = nullptr;
+    ustore_length_t** lengths = nullptr;
+    ustore_byte_t* strings = nullptr;
+};
+
+/**
+ * @brief Recursive-descent parser and evaluator of the filters of `ustore_docs_gather`.
+ * Every distinct combination of a field and the type of a literal becomes one gathered column:
+ * reals for numbers, strings and booleans for the rest.
+ */
+class docs_filter_t {
+    uninitialized_array_gt<filter_node_t> nodes_;
+    uninitialized_array_gt<ustore_str_view_t> fields_;
+    uninitialized_array_gt<ustore_doc_field_type_t> types_;
+    linked_memory_lock_t& arena_;
+    std::string_view text_;
+    std::size_t progress_ = 0;
+    ustore_error_t* c_error_;
+
+    static bool is_field_char(char c) noexcept {
+        return !std::isspace(static_cast<unsigned char>(c)) && !std::strchr("=!<>()&|\"", c);
+    }
+
+    void skip_spaces() noexcept {
+        while (progress_ != text_.size() && std::isspace(static_cast<unsigned char>(text_[progress_])))
+            ++progress_;
+    }
+
+    /** @brief Consumes the `token`, if it follows. Keywords must also end before the next field. */
+    bool consume(std::string_view token) noexcept {
+        skip_spaces();
+        if (text_.substr(progress_, token.size()) != token)
+            return false;
+        std::size_t const token_end = progress_ + token.size();
+        if (std::isalpha(static_cast<unsigned char>(token[0])) && token_end != text_.size() &&
+            is_field_char(text_[token_end]))
+            return false;
+        progress_ = token_end;
+        return true;
+    }
+
+    std::size_t add(filter_node_t node) noexcept {
+        nodes_.push_back(node, c_error_);
+        return nodes_.size() - 1;
+    }
+
+    std::size_t add_column(std::string_view field, ustore_doc_field_type_t type) noexcept {
+        for (std::size_t column = 0; column != fields_.size(); ++column)
+            if (types_[column] == type && field == fields_[column])
+                return column;
+
+        auto name = arena_.alloc<char>(field.size() + 1, c_error_);
+        if (*c_error_)
+            return 0;
+        std::memcpy(name.begin(), field.data(), field.size());
+        name[field.size()] = '\0';
+        fields_.push_back(name.begin(), c_error_);
+        types_.push_back(type, c_error_);
+        return fields_.size() - 1;
+    }
+
+    std::size_t parse_or() noexcept {
+        std::size_t left = parse_and();
+        while (!*c_error_ && (consume("||") || consume("OR") || consume("or"))) {
+            std::size_t right = parse_and();
+            left = add({filter_node_t::or_k, filter_node_t::equal_k, left, right});
+        }
+        return left;
+    }
+
+    std::size_t parse_and() noexcept {
+        std::size_t left = parse_unary();
+        while (!*c_error_ && (consume("&&") || consume("AND") || consume("and"))) {
+            std::size_t right = parse_unary();
+            left = add({filter_node_t::and_k, filter_node_t::equal_k, left, right});
+        }
+        return left;
+    }
+
+    std::size_t parse_unary() noexcept {
+        if (consume("!") || consume("NOT") || consume("not")) {
+            std::size_t child = parse_unary();
+            return add({filter_node_t::not_k, filter_node_t::equal_k, child});
+        }
+        if (consume("(")) {
+            std::size_t child = parse_or();
+            if (!*c_error_ && !consume(")"))
+                log_error_m(c_error_, args_wrong_k, "Unbalanced parentheses in the filter");
+            return child;
+        }
+        return parse_comparison();
+    }
+
+    std::size_t parse_comparison() noexcept {
+        filter_node_t node;
+        skip_spaces();
+        std::size_t const field_begin = progress_;
+        while (progress_ != text_.size() && is_field_char(text_[progress_]))
+            ++progress_;
+        std::string_view field = text_.substr(field_begin, progress_ - field_begin);
+        if (field.empty()) {
+            log_error_m(c_error_, args_wrong_k, "Expected a field in the filter");
+            return 0;
+        }
+
+        if (consume("=="))
+            node.op = filter_node_t::equal_k;
+        else if (consume("!="))
+            node.op = filter_node_t::not_equal_k;
+        else if (consume("<="))
+            node.op = filter_node_t::less_equal_k;
+        else if (consume(">="))
+            node.op = filter_node_t::greater_equal_k;
+        else if (consume("<"))
+            node.op = filter_node_t::less_k;
+        else if (consume(">"))
+            node.op = filter_node_t::greater_k;
+        else {
+            log_error_m(c_error_, args_wrong_k, "Expected a comparison operator in the filter");
+            return 0;
+        }
+
+        ustore_doc_field_type_t type = ustore_doc_field_f64_k;
+        skip_spaces();
+        if (consume("\"")) {
+            // Escaped characters are copied into the arena, the rest are referenced from the text
+            auto unescaped = arena_.alloc<char>(text_.size() - progress_, c_error_);
+            if (*c_error_)
+                return 0;
+            std::size_t length = 0;
+            while (progress_ != text_.size() && text_[progress_] != '"') {
+                if (text_[progress_] == '\\' && progress_ + 1 != text_.size())
+                    ++progress_;
+                unescaped[length++] = text_[progress_++];
             }
+            if (!consume("\"")) {
+                log_error_m(c_error_, args_wrong_k, "Unterminated string in the filter");
+                return 0;
+            }
+            node.string = {unescaped.begin(), length};
+            type = ustore_doc_field_str_k;
+        }
+        else if (consume("true")) {
+            node.boolean = true;
+            type = ustore_doc_field_bool_k;
+        }
+        else if (consume("false")) {
+            node.boolean = false;
+            type = ustore_doc_field_bool_k;
+        }
+        else {
+            // The text is NULL-terminated, so it can be passed to `std::strtod` as is
+            char const* number_begin = text_.data() + progress_;
+            char* number_end = nullptr;
+            node.number = std::strtod(number_begin, &number_end);
+            if (number_end == number_begin) {
+                log_error_m(c_error_, args_wrong_k, "Expected a number, a string or a boolean in the filter");
+                return 0;
+            }
+            progress_ += number_end - number_begin;
         }
+
+        node.column = add_column(field, type);
+        return add(node);
     }
 
-    *c.joined_strings = reinterpret_cast<ustore_byte_t*>(string_tape.data());
+    template <typename element_at>
+    static element_at scalar(filter_columns_t const& columns, std::size_t column, std::size_t doc_idx) noexcept {
+        return reinterpret_cast<element_at const*>(columns.scalars[column])[doc_idx];
+    }
+
+    bool compare(filter_node_t const& node, filter_columns_t const& columns, std::size_t doc_idx) const noexcept {
+        std::size_t const column = node.column;
+        if (!bits_view_t {columns.validities[column]}[doc_idx])
+            return false;
+
+        int order = 0;
+        switch (types_.data()[column]) {
+        case ustore_doc_field_f64_k: {
+            double value = scalar<double>(columns, column, doc_idx);
+            if (std::isnan(value))
+                return false;
+            order = (value > node.number) - (value < node.number);
+            break;
+        }
+        case ustore_doc_field_bool_k: {
+            if (bits_view_t {columns.conversions[column]}[doc_idx])
+                return false;
+            order = int(scalar<bool>(columns, column, doc_idx)) - int(node.boolean);
+            break;
+        }
+        default: {
+            if (bits_view_t {columns.conversions[column]}[doc_idx])
+                return false;
+            auto begin = reinterpret_cast<char const*>(columns.strings) + columns.offsets[column][doc_idx];
+            int const comparison = std::string_view {begin, columns.lengths[column][doc_idx]}.compare(node.string);
+            order = (comparison > 0) - (comparison < 0);
+            break;
+        }
+        }
+
+        switch (node.op) {
+        case filter_node_t::equal_k: return order == 0;
+        case filter_node_t::not_equal_k: return order != 0;
+        case filter_node_t::less_k: return order < 0;
+        case filter_node_t::less_equal_k: return order <= 0;
+        case filter_node_t::greater_k: return order > 0;
+        case filter_node_t::greater_equal_k: return order >= 0;
+        }
+        return false;
+    }
+
+    bool matches(std::size_t node_idx, filter_columns_t const& columns, std::size_t doc_idx) const noexcept {
+        filter_node_t const& node = nodes_.data()[node_idx];
+        switch (node.kind) {
+        case filter_node_t::and_k: return matches(node.left, columns, doc_idx) && matches(node.right, columns, doc_idx);
+        case filter_node_t::or_k: return matches(node.left, columns, doc_idx) || matches(node.right, columns, doc_idx);
+        case filter_node_t::not_k: return !matches(node.left, columns, doc_idx);
+        default: return compare(node, columns, doc_idx);
+        }
+    }
+
+  public:
+    docs_filter_t(ustore_str_view_t text, linked_memory_lock_t& arena, ustore_error_t* c_error) noexcept
+        : nodes_(arena), fields_(arena), types_(arena), arena_(arena), text_(text), c_error_(c_error) {
+        parse_or();
+        skip_spaces();
+        if (!*c_error_ && progress_ != text_.size())
+            log_error_m(c_error_, args_wrong_k, "Unexpected characters in the filter");
+    }
+
+    std::size_t columns_count() const noexcept { return fields_.size(); }
+    ustore_str_view_t const* fields() const noexcept { return fields_.data(); }
+    ustore_doc_field_type_t const* types() const noexcept { return types_.data(); }
+
+    /** @brief Checks if the document matches, with the root being the last parsed node. */
+    bool matches(filter_columns_t const& columns, std::size_t doc_idx) const noexcept {
+        return matches(nodes_.size() - 1, columns, doc_idx);
+    }
+};
+
+/**
+ * @brief Evaluates the `filter` of a gather, exporting the matches. Then gathers the requested
+ * fields from the matching documents alone, with a nested gather without a filter.
+ * Collections in the "columnar" mode serve the compared fields from their cells.
+ */
+void gather_filtered(ustore_docs_gather_t& c, linked_memory_lock_t& arena) noexcept {
+
+    docs_filter_t filter {c.filter, arena, c.error};
+    return_if_error_m(c.error);
+
+    // 1. Gather all the compared fields at once
+    ustore_options_t const nested_options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    filter_columns_t columns;
+    ustore_docs_gather_t compared = c;
+    compared.arena = arena;
+    compared.options = nested_options;
+    compared.filter = nullptr;
+    compared.fields_count = filter.columns_count();
+    compared.fields = filter.fields();
+    compared.fields_stride = sizeof(ustore_str_view_t);
+    compared.types = filter.types();
+    compared.types_stride = sizeof(ustore_doc_field_type_t);
+    compared.matches_count = nullptr;
+    compared.matches = nullptr;
+    compared.columns_validities = &columns.validities;
+    compared.columns_conversions = &columns.conversions;
+    compared.columns_collisions = nullptr;
+    compared.columns_scalars = &columns.scalars;
+    compared.columns_offsets = &columns.offsets;
+    compared.columns_lengths = &columns.lengths;
+    compared.joined_strings = &columns.strings;
+    ustore_docs_gather(&compared);
+    return_if_error_m(c.error);
+
+    // 2. Evaluate the filter, document by document
+    auto matches = arena.alloc<ustore_length_t>(c.docs_count, c.error);
+    return_if_error_m(c.error);
+    std::size_t matches_count = 0;
+    for (std::size_t doc_idx = 0; doc_idx != c.docs_count; ++doc_idx)
+        if (filter.matches(columns, doc_idx))
+            matches[matches_count++] = static_cast<ustore_length_t>(doc_idx);
+    if (c.matches_count)
+        *c.matches_count = static_cast<ustore_length_t>(matches_count);
+    if (c.matches)
+        *c.matches = matches.begin();
+    if (!c.fields_count || !matches_count)
+        return;
+
+    // 3. Gather the requested fields from the matching documents
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    auto matched_keys = arena.alloc<ustore_key_t>(matches_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t match_idx = 0; match_idx != matches_count; ++match_idx)
+        matched_keys[match_idx] = keys[matches[match_idx]];
+
+    ustore_docs_gather_t matched = c;
+    matched.arena = arena;
+    matched.options = nested_options;
+    matched.filter = nullptr;
+    matched.docs_count = matches_count;
+    matched.keys = matched_keys.begin();
+    matched.keys_stride = sizeof(ustore_key_t);
+    matched.matches_count = nullptr;
+    matched.matches = nullptr;
+    if (collections && !collections.repeats()) {
+        auto matched_collections = arena.alloc<ustore_collection_t>(matches_count, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t match_idx = 0; match_idx != matches_count; ++match_idx)
+            matched_collections[match_idx] = collections[matches[match_idx]];
+        matched.collections = matched_collections.begin();
+        matched.collections_stride = sizeof(ustore_collection_t);
+    }
+    ustore_docs_gather(&matched);
+}
+
+void ustore_docs_gather(ustore_docs_gather_t* c_ptr) {
+
+    ustore_docs_gather_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::docs_gather_k, c.docs_count, c.error};
+    if (c.filter && c.matches_count)
+        *c.matches_count = 0;
+    if (!c.docs_count || (!c.fields_count && !c.filter))
+        return;
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    if (c.filter)
+        return gather_filtered(c, arena);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+
+    // Collections in the "columnar" mode export the declared fields from their cells,
+    // so the documents are only fetched, if some of the fields have no matching column
+    auto field_cells = arena.alloc<joined_blobs_t>(c.fields_count, c.error);
+    return_if_error_m(c.error);
+    std::uninitialized_default_construct(field_cells.begin(), field_cells.end());
+    bool needs_docs = true;
+    if (!collections || collections.repeats()) {
+        places_arg_t places {collections, keys, {}, 1};
+        auto schemas = read_schemas(c.db, c.transaction, c.snapshot, places, engine_options(c.options), arena, c.error);
+        return_if_error_m(c.error);
+
+        needs_docs = false;
+        std::string field_pointer;
+        auto columns = schemas.size() ? schemas[0].columns : ptr_range_gt<docs_column_t> {};
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+            std::string_view pointer = field_to_pointer(fields[field_idx], field_pointer);
+            auto column = std::find_if(columns.begin(), columns.end(), [&](docs_column_t const& column) {
+                return column.field == pointer && column.type == types[field_idx];
+            });
+            if (column == columns.end()) {
+                needs_docs = true;
+                continue;
+            }
+
+            ustore_byte_t* found_cells_begin {};
+            ustore_length_t* found_cells_offs {};
+            ustore_read_t read {};
+            read.db = c.db;
+            read.error = c.error;
+            read.transaction = c.transaction;
+            read.snapshot = c.snapshot;
+            read.arena = arena;
+            read.options = engine_options(c.options);
+            read.tasks_count = c.docs_count;
+            read.collections = &column->collection;
+            read.collections_stride = 0;
+            read.keys = c.keys;
+            read.keys_stride = c.keys_stride;
+            read.offsets = &found_cells_offs;
+            read.values = &found_cells_begin;
+
+            ustore_read(&read);
+            return_if_error_m(c.error);
+            field_cells[field_idx] = joined_blobs_t {c.docs_count, found_cells_offs, found_cells_begin};
+        }
+    }
+
+    // Retrieve the entire documents before we can sample internal fields
+    joined_blobs_t found_binaries;
+    if (needs_docs) {
+        ustore_byte_t* found_binary_begin {};
+        ustore_length_t* found_binary_offs {};
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = c.error;
+        read.transaction = c.transaction;
+        read.snapshot = c.snapshot;
+        read.arena = arena;
+        read.options = engine_options(c.options);
+        read.tasks_count = c.docs_count;
+        read.collections = c.collections;
+        read.collections_stride = c.collections_stride;
+        read.keys = c.keys;
+        read.keys_stride = c.keys_stride;
+        read.offsets = &found_binary_offs;
+        read.values = &found_binary_begin;
+
+        ustore_read(&read);
+        stored_unpack(read, arena, c.error);
+        return_if_error_m(c.error);
+        found_binaries = joined_blobs_t {c.docs_count, found_binary_offs, found_binary_begin};
+    }
+
+    // Estimate the amount of memory needed to store at least scalars and columns addresses.
+    // Every bitmap and column starts at a 64-byte boundary, so they can be passed to Arrow as is.
+    // https://arrow.apache.org/docs/format/Columnar.html#buffer-alignment-and-padding
+    bool wants_conversions = c.columns_conversions;
+    bool wants_collisions = c.columns_collisions;
+    std::size_t slots_per_bitmap = divide_round_up<std::size_t>(c.docs_count, bits_in_byte_k);
+    std::size_t count_bitmaps = 1ul + wants_conversions + wants_collisions;
+    std::size_t bytes_per_bitmap = next_multiple(sizeof(ustore_octet_t) * slots_per_bitmap, gather_alignment_k);
+    std::size_t bytes_per_addresses_row = sizeof(void*) * c.fields_count;
+    std::size_t bytes_for_addresses = next_multiple(bytes_per_addresses_row * 6, gather_alignment_k);
+    std::size_t bytes_for_bitmaps = bytes_per_bitmap * count_bitmaps * c.fields_count;
+    auto bytes_per_column = [&](ustore_doc_field_type_t type) {
+        return next_multiple(doc_field_size_bytes(type) * c.docs_count + sizeof(ustore_length_t), gather_alignment_k);
+    };
+    std::size_t bytes_for_scalars = transform_reduce_n(types, c.fields_count, 0ul, bytes_per_column);
+
+    // Preallocate at least a minimum amount of memory.
+    // It will be organized in the following way:
+    // 1. validity bitmaps for all fields
+    // 2. optional conversion bitmaps for all fields
+    // 3. optional collision bitmaps for all fields
+    // 4. offsets of all strings
+    // 5. lengths of all strings
+    // 6. scalars for all fields
+
+    auto tape = arena.alloc<byte_t>(bytes_for_addresses + bytes_for_bitmaps + bytes_for_scalars,
+                                    c.error,
+                                    gather_alignment_k);
+    return_if_error_m(c.error);
+    byte_t* const tape_ptr = tape.begin();
+
+    // If those pointers were not provided, we can reuse the validity bitmap
+    // It will allow us to avoid extra checks later.
+    // ! Still, in every sequence of updates, validity is the last bit to be set,
+    // ! to avoid overwriting.
+    auto first_collection_validities = reinterpret_cast<ustore_octet_t*>(tape_ptr + bytes_for_addresses);
+    auto first_collection_conversions = wants_conversions //
+                                            ? first_collection_validities + bytes_per_bitmap * c.fields_count
+                                            : first_collection_validities;
+    auto first_collection_collisions = wants_collisions //
+                                           ? first_collection_conversions + bytes_per_bitmap * c.fields_count
+                                           : first_collection_validities;
+    auto first_collection_scalars = reinterpret_cast<ustore_byte_t*>(tape_ptr + bytes_for_addresses + bytes_for_bitmaps);
+
+    // 1, 2, 3. Export validity maps addresses
+    std::size_t tape_progress = 0;
+    {
+        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
+        if (c.columns_validities)
+            *c.columns_validities = addresses;
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+            addresses[field_idx] = first_collection_validities + field_idx * bytes_per_bitmap;
+        tape_progress += bytes_per_addresses_row;
+    }
+    if (wants_conversions) {
+        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
+        if (c.columns_conversions)
+            *c.columns_conversions = addresses;
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+            addresses[field_idx] = first_collection_conversions + field_idx * bytes_per_bitmap;
+        tape_progress += bytes_per_addresses_row;
+    }
+    if (wants_collisions) {
+        auto addresses = reinterpret_cast<ustore_octet_t**>(tape_ptr + tape_progress);
+        if (c.columns_collisions)
+            *c.columns_collisions = addresses;
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+            addresses[field_idx] = first_collection_collisions + field_idx * bytes_per_bitmap;
+        tape_progress += bytes_per_addresses_row;
+    }
+
+    // 4, 5, 6. Export addresses for scalars, strings offsets and strings lengths
+    auto addresses_offs = reinterpret_cast<ustore_length_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 0);
+    if (c.columns_offsets)
+        *c.columns_offsets = addresses_offs;
+    auto addresses_lens = reinterpret_cast<ustore_length_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 1);
+    if (c.columns_lengths)
+        *c.columns_lengths = addresses_lens;
+    auto addresses_scalars = reinterpret_cast<ustore_byte_t**>(tape_ptr + tape_progress + bytes_per_addresses_row * 2);
+    if (c.columns_scalars)
+        *c.columns_scalars = addresses_scalars;
+
+    {
+        auto scalars_tape = first_collection_scalars;
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+            ustore_doc_field_type_t type = types[field_idx];
+            switch (type) {
+            case ustore_doc_field_str_k:
+            case ustore_doc_field_bin_k:
+                addresses_offs[field_idx] = reinterpret_cast<ustore_length_t*>(scalars_tape);
+                addresses_lens[field_idx] = addresses_offs[field_idx] + c.docs_count + 1;
+                addresses_scalars[field_idx] = nullptr;
+                break;
+            default:
+                addresses_offs[field_idx] = nullptr;
+                addresses_lens[field_idx] = nullptr;
+                addresses_scalars[field_idx] = reinterpret_cast<ustore_byte_t*>(scalars_tape);
+                break;
+            }
+            scalars_tape += bytes_per_column(type);
+        }
+    }
+
+    // Go though all the documents extracting and type-checking the relevant parts.
+    // Documents are split between threads in blocks, so that no two threads share a bitmap cache line.
+    bool const use_cache = c.options & ustore_option_docs_cache_k;
+    bool const parse_members = c.fields_count == 1;
+    ustore_options_t const worker_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    auto gather_docs = [&](std::size_t docs_begin, std::size_t docs_end, gather_worker_t& worker) {
+        worker.docs_begin = docs_begin;
+        worker.docs_end = docs_end;
+        linked_memory_lock_t worker_arena = linked_memory(&worker.arena, worker_options, &worker.error);
+        return_if_error_m(&worker.error);
+
+        printed_number_buffer_t print_buffer;
+        string_t string_tape(worker_arena);
+        std::string cache_key;
+        std::string field_pointer;
+        for (std::size_t doc_idx = docs_begin; doc_idx != docs_end; ++doc_idx) {
+            value_view_t binary_doc = needs_docs ? found_binaries[doc_idx] : value_view_t {};
+            stored_doc_t stored {binary_doc};
+
+            // The document is parsed at most once, and only if some of the fields aren't cached
+            json_t doc;
+            yyjson_val* root = nullptr;
+            bool is_parsed = binary_doc.empty();
+            bool const is_cached = use_cache && !binary_doc.empty();
+            std::size_t doc_fingerprint = is_cached ? docs_cache_t::fingerprint(binary_doc) : 0;
+            for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+
+                ustore_doc_field_type_t type = types[field_idx];
+                ustore_str_view_t field = fields[field_idx];
+                column_begin_t column {};
+                column.validities = (*c.columns_validities)[field_idx];
+                column.conversions =
+                    (*(c.columns_conversions ? c.columns_conversions : c.columns_validities))[field_idx];
+                column.collisions = (*(c.columns_collisions ? c.columns_collisions : c.columns_validities))[field_idx];
+                column.scalars = addresses_scalars[field_idx];
+                column.str_offsets = addresses_offs[field_idx];
+                column.str_lengths = addresses_lens[field_idx];
+
+                // Columnar fields are restored from their cells without touching the document
+                joined_blobs_t const& cells = field_cells[field_idx];
+                if (cells.size()) {
+                    value_view_t cell = cells[doc_idx];
+                    if (cell.size()) {
+                        auto cell_flags = static_cast<ustore_octet_t>(cell.data()[0]);
+                        std::string_view bytes {cell.c_str() + 1, cell.size() - 1};
+                        column.restore(doc_idx, type, cell_flags, bytes, string_tape, &worker.error);
+                    }
+                    else
+                        column.set_any(doc_idx, type, nullptr, print_buffer, string_tape, &worker.error);
+                    return_if_error_m(&worker.error);
+                    continue;
+                }
+
+                if (is_cached) {
+                    docs_cache_t::key(collections ? collections[doc_idx] : ustore_collection_main_k,
+                                      keys[doc_idx],
+                                      field,
+                                      type,
+                                      cache_key);
+                    bool const found =
+                        docs_cache.find(cache_key, doc_fingerprint, [&](docs_cache_t::entry_t const& entry) {
+                            column.restore(doc_idx, type, entry.flags, entry.bytes, string_tape, &worker.error);
+                        });
+                    return_if_error_m(&worker.error);
+                    if (found)
+                        continue;
+                }
+
+                // Find this field within document.
+                // With a single field, parsing just the indexed member containing it is cheaper.
+                json_t member;
+                yyjson_val* found_value = nullptr;
+                if (parse_members && stored.is_indexed()) {
+                    auto [member_bytes, suffix] = stored.locate(field_to_pointer(field, field_pointer));
+                    member = json_read(member_bytes, worker_arena, &worker.error);
+                    return_if_error_m(&worker.error);
+                    found_value = json_lookup(yyjson_doc_get_root(member.handle), pointer_or_root(suffix));
+                }
+                else {
+                    if (!is_parsed) {
+                        doc = json_read(stored.body(), worker_arena, &worker.error);
+                        return_if_error_m(&worker.error);
+                        root = yyjson_doc_get_root(doc.handle);
+                        is_parsed = true;
+                    }
+                    found_value = root ? json_lookup(root, field) : nullptr;
+                }
+
+                // Export the types
+                column.set_any(doc_idx, type, found_value, print_buffer, string_tape, &worker.error);
+                return_if_error_m(&worker.error);
+
+                if (is_cached) {
+                    std::string_view bytes = column.cell(doc_idx, type, string_tape);
+                    docs_cache.insert(cache_key, doc_fingerprint, column.flags(doc_idx), bytes);
+                }
+            }
+        }
+        worker.strings = {string_tape.data(), string_tape.size()};
+    };
+
+    std::size_t const blocks_count = divide_round_up(std::size_t(c.docs_count), gather_docs_per_block_k);
+    std::size_t const threads_count = c.threads_count ? c.threads_count : threads_registry_t::global().get(c.db);
+    std::size_t const workers_count = std::min(threads_count, blocks_count);
+    auto workers = arena.alloc<gather_worker_t>(workers_count, c.error);
+    return_if_error_m(c.error);
+    std::uninitialized_default_construct(workers.begin(), workers.end());
+    safe_section("Gathering documents", c.error, [&] {
+        parallel_for(workers_count, blocks_count, [&](std::size_t begin, std::size_t end, std::size_t thread_idx) {
+            gather_worker_t& worker = workers[thread_idx];
+            safe_section("Gathering documents", &worker.error, [&] {
+                gather_docs(std::min<std::size_t>(begin * gather_docs_per_block_k, c.docs_count),
+                            std::min<std::size_t>(end * gather_docs_per_block_k, c.docs_count),
+                            worker);
+            });
+        });
+    });
+
+    // Concatenate the strings of all workers in the order of documents, shifting their offsets
+    string_t string_tape(arena);
+    for (gather_worker_t& worker : workers) {
+        if (worker.error && !*c.error)
+            *c.error = worker.error;
+        if (*c.error)
+            continue;
+        auto shift = static_cast<ustore_length_t>(string_tape.size());
+        string_tape.insert(string_tape.size(), worker.strings.begin(), worker.strings.end(), c.error);
+        for (ustore_size_t field_idx = 0; field_idx != c.fields_count && shift; ++field_idx)
+            if (doc_field_is_variable_length(types[field_idx]))
+                for (std::size_t doc_idx = worker.docs_begin; doc_idx != worker.docs_end; ++doc_idx)
+                    addresses_offs[field_idx][doc_idx] += shift;
+    }
+    for (gather_worker_t& worker : workers)
+        ustore_arena_free(worker.arena);
+    return_if_error_m(c.error);
+
+    for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+        if (doc_field_is_variable_length(types[field_idx]))
+            addresses_offs[field_idx][c.docs_count] = static_cast<ustore_length_t>(string_tape.size());
+    *c.joined_strings = reinterpret_cast<ustore_byte_t*>(string_tape.data());
+}
+
+#endif
+
+/**
+ * @brief Number of keys scanned and filtered at once by `ustore_docs_scan`.
+ */
+constexpr ustore_length_t docs_scan_batch_k = 4096;
+
+void ustore_docs_scan(ustore_docs_scan_t* c_ptr) {
+
+    ustore_docs_scan_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::docs_scan_k, 1, c.error};
+    return_error_if_m(c.filter, c.error, args_wrong_k, "Filter must be provided");
+    return_error_if_m(c.count && c.keys, c.error, args_wrong_k, "Outputs must be provided");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    // Batches are filtered in a separate arena, which is recycled between them.
+    // With remote databases, every batch is filtered on the server, and only the matches come back.
+    uninitialized_array_gt<ustore_key_t> found_keys(arena);
+    ustore_arena_t batch_arena = nullptr;
+    ustore_options_t const batch_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    ustore_key_t start_key = c.start_key;
+    while (found_keys.size() < c.count_limit && !*c.error) {
+        ustore_length_t batch_limit = docs_scan_batch_k;
+        ustore_length_t* scanned_counts = nullptr;
+        ustore_key_t* scanned_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.snapshot = c.snapshot;
+        scan.arena = &batch_arena;
+        scan.options = batch_options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &batch_limit;
+        scan.counts = &scanned_counts;
+        scan.keys = &scanned_keys;
+        ustore_scan(&scan);
+        if (*c.error || !scanned_counts[0])
+            break;
+
+        ustore_length_t const scanned_count = scanned_counts[0];
+        ustore_length_t matches_count = 0;
+        ustore_length_t* matches = nullptr;
+        ustore_docs_gather_t gather {};
+        gather.db = c.db;
+        gather.error = c.error;
+        gather.transaction = c.transaction;
+        gather.snapshot = c.snapshot;
+        gather.arena = &batch_arena;
+        gather.options = ustore_options_t(batch_options | ustore_option_dont_discard_memory_k);
+        gather.docs_count = scanned_count;
+        gather.collections = &c.collection;
+        gather.keys = scanned_keys;
+        gather.keys_stride = sizeof(ustore_key_t);
+        gather.filter = c.filter;
+        gather.matches_count = &matches_count;
+        gather.matches = &matches;
+        ustore_docs_gather(&gather);
+        if (*c.error)
+            break;
+
+        // The schema of a collection is a document, but not one of the scanned ones
+        for (ustore_length_t i = 0; i != matches_count && found_keys.size() < c.count_limit; ++i)
+            if (ustore_key_t key = scanned_keys[matches[i]]; key != ustore_docs_schema_key_k)
+                found_keys.push_back(key, c.error);
+
+        ustore_key_t const last_key = scanned_keys[scanned_count - 1];
+        if (scanned_count < batch_limit || last_key == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = last_key + 1;
+    }
+    ustore_arena_free(batch_arena);
+    return_if_error_m(c.error);
+
+    *c.count = static_cast<ustore_length_t>(found_keys.size());
+    *c.keys = found_keys.begin();
+}
+
+void ustore_docs_columns(ustore_docs_columns_t* c_ptr) {
+
+    ustore_docs_columns_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(!c.fields_count || c.fields, c.error, args_wrong_k, "Fields must be provided");
+    return_error_if_m(!c.fields_count || c.columns, c.error, args_wrong_k, "Column collections must be provided");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+    strided_iterator_gt<ustore_collection_t const> column_collections {c.columns, c.columns_stride};
+    ustore_options_t const options = engine_options(c.options);
+
+    // Normalize the fields into NULL-terminated JSON-Pointers
+    growing_tape_t pointers(arena);
+    auto columns = arena.alloc<docs_column_t>(c.fields_count, c.error);
+    return_if_error_m(c.error);
+    std::string field_pointer;
+    for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        std::string_view pointer = field_to_pointer(fields[field_idx], field_pointer);
+        pointers.push_back(value_view_t {reinterpret_cast<byte_t const*>(pointer.data()), pointer.size()}, c.error);
+        pointers.add_terminator(byte_t {0}, c.error);
+        return_if_error_m(c.error);
+        columns[field_idx].type = types ? types[field_idx] : ustore_doc_field_null_k;
+        columns[field_idx].collection = column_collections[field_idx];
+    }
+    for (ustore_size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        value_view_t pointer = pointers[field_idx];
+        columns[field_idx].field = {reinterpret_cast<char const*>(pointer.data()), pointer.size()};
+    }
+
+    // Reading the schema before the scans also registers the dictionary of a compressed collection
+    places_arg_t schema_place {{&c.collection, 0}, {&ustore_docs_schema_key_k, 0}, {}, 1};
+    auto schemas = read_schemas(c.db, c.transaction, {}, schema_place, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Infer the missing types from the first documents, that contain those fields.
+    // The scanned batches and the parsed documents use a separate arena, which is recycled
+    // between batches, but not between the documents of the same batch.
+    ustore_arena_t scan_arena = nullptr;
+    ustore_options_t const scan_options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    auto is_untyped = [](docs_column_t const& column) { return column.type == ustore_doc_field_null_k; };
+    if (std::any_of(columns.begin(), columns.end(), is_untyped)) {
+        auto untyped_count = static_cast<ustore_size_t>(std::count_if(columns.begin(), columns.end(), is_untyped));
+        scan_range_collection( //
+            c.db,
+            c.transaction,
+            c.collection,
+            options,
+            std::numeric_limits<ustore_key_t>::min(),
+            std::numeric_limits<ustore_key_t>::max(),
+            columns_batch_k,
+            &scan_arena,
+            c.error,
+            [&](ustore_key_t key, value_view_t binary_doc) {
+                if (key == ustore_docs_schema_key_k)
+                    return true;
+                linked_memory_lock_t doc_arena = linked_memory(&scan_arena, scan_options, c.error);
+                binary_doc = stored_unpack(binary_doc, doc_arena, c.error);
+                if (*c.error)
+                    return false;
+                json_t doc = json_read(stored_doc_t {binary_doc}.body(), doc_arena, c.error);
+                if (*c.error)
+                    return false;
+                yyjson_val* root = yyjson_doc_get_root(doc.handle);
+                for (docs_column_t& column : columns) {
+                    if (!is_untyped(column))
+                        continue;
+                    column.type = infer_column_type(json_lookupn(root, column.field.data(), column.field.size()));
+                    untyped_count -= !is_untyped(column);
+                }
+                return untyped_count != 0;
+            });
+        for (docs_column_t& column : columns)
+            if (is_untyped(column))
+                column.type = ustore_doc_field_str_k;
+    }
+
+    // Backfill the columns with the cells of the existing documents
+    columns_batch_t batch {arena};
+    if (!*c.error && c.fields_count)
+        scan_range_collection( //
+            c.db,
+            c.transaction,
+            c.collection,
+            options,
+            std::numeric_limits<ustore_key_t>::min(),
+            std::numeric_limits<ustore_key_t>::max(),
+            columns_batch_k,
+            &scan_arena,
+            c.error,
+            [&](ustore_key_t key, value_view_t binary_doc) {
+                if (key == ustore_docs_schema_key_k)
+                    return true;
+                linked_memory_lock_t doc_arena = linked_memory(&scan_arena, scan_options, c.error);
+                binary_doc = stored_unpack(binary_doc, doc_arena, c.error);
+                if (!*c.error)
+                    batch.shred(key, binary_doc, columns, doc_arena, c.error);
+                if (!*c.error && batch.size() >= columns_batch_k)
+                    batch.write(c.db, c.transaction, options, arena, c.error);
+                return !*c.error;
+            });
+    if (!*c.error)
+        batch.write(c.db, c.transaction, options, arena, c.error);
+    ustore_arena_free(scan_arena);
+    return_if_error_m(c.error);
+
+    // Store the schema, so that the following writes and gathers can find the columns.
+    // The indexes of the collection are listed in the same document, so they are preserved.
+    docs_schema_t schema = schemas[0];
+    schema.columns = columns;
+    write_schema(c.db, c.transaction, schema, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    if (c.columns_types) {
+        auto exported_types = arena.alloc<ustore_doc_field_type_t>(c.fields_count, c.error);
+        return_if_error_m(c.error);
+        transform_n(columns.begin(), c.fields_count, exported_types.begin(), [](docs_column_t const& column) {
+            return column.type;
+        });
+        *c.columns_types = exported_types.begin();
+    }
+}
+
+/*********************************************************/
+/*****************	 Secondary Indexes	  ****************/
+/*********************************************************/
+
+/**
+ * Every index maps the values of one field to the keys of the documents, that contain them.
+ * Values are grouped into buckets under order-preserving 64-bit keys, so that ranges of values
+ * become ranges of keys. Numbers share the buckets with the same highest 56 bits, and strings -
+ * with the same 7-byte prefix. A bucket is a list of entries, sorted by value and document key, where
+ * every entry is a `ustore_key_t` document key, a `ustore_length_t` length and the value bytes.
+ * Entries are compared exactly, so collisions in buckets never produce false positives.
+ *
+ * The lowest 8 bits of the keys address the pages of buckets, that outgrow `index_page_entries_k`
+ * entries, as happens with low-cardinality fields. The first key of such a bucket keeps just the
+ * number of its pages, and the entries are spread between the following keys by the document key.
+ * So every write rewrites a single page, instead of all the documents with the same value.
+ */
+
+constexpr ustore_length_t index_scan_read_ahead_k = 64;
+constexpr ustore_key_t index_page_mask_k = 0xFF;
+constexpr ustore_length_t index_page_entries_k = 4096;
+constexpr ustore_length_t index_max_pages_k = 128;
+
+inline bool index_supports(ustore_doc_field_type_t type) noexcept {
+    return type == ustore_doc_field_i64_k || type == ustore_doc_field_f64_k || type == ustore_doc_field_str_k;
+}
+
+/**
+ * @brief Appends the comparable binary form of an indexed value to the `output`.
+ * @return False, if the value can't be indexed with this type, like strings in numeric indexes.
+ */
+bool index_value(ustore_doc_field_type_t type, yyjson_val* value, string_t& output, ustore_error_t* c_error) noexcept {
+    char const* begin = nullptr;
+    std::size_t length = 0;
+    std::int64_t integer = 0;
+    double real = 0;
+    switch (type) {
+    case ustore_doc_field_i64_k:
+        if (yyjson_is_sint(value))
+            integer = yyjson_get_sint(value);
+        else if (yyjson_is_uint(value) &&
+                 yyjson_get_uint(value) <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+            integer = static_cast<std::int64_t>(yyjson_get_uint(value));
+        else
+            return false;
+        begin = reinterpret_cast<char const*>(&integer);
+        length = sizeof(integer);
+        break;
+    case ustore_doc_field_f64_k:
+        if (!yyjson_is_num(value))
+            return false;
+        real = yyjson_is_real(value)   ? yyjson_get_real(value)
+               : yyjson_is_sint(value) ? static_cast<double>(yyjson_get_sint(value))
+                                       : static_cast<double>(yyjson_get_uint(value));
+        if (std::isnan(real))
+            return false;
+        // Negative zeros would otherwise land in a different bucket, than the positive ones
+        if (real == 0)
+            real = 0;
+        begin = reinterpret_cast<char const*>(&real);
+        length = sizeof(real);
+        break;
+    case ustore_doc_field_str_k:
+        if (!yyjson_is_str(value))
+            return false;
+        begin = yyjson_get_str(value);
+        length = yyjson_get_len(value);
+        break;
+    default: return false;
+    }
+    output.insert(output.size(), begin, begin + length, c_error);
+    return !*c_error;
+}
+
+int index_compare(ustore_doc_field_type_t type, value_view_t a, value_view_t b) noexcept {
+    if (type == ustore_doc_field_str_k)
+        return std::string_view {a.c_str(), a.size()}.compare(std::string_view {b.c_str(), b.size()});
+    if (type == ustore_doc_field_f64_k) {
+        double a_real, b_real;
+        std::memcpy(&a_real, a.data(), sizeof(double));
+        std::memcpy(&b_real, b.data(), sizeof(double));
+        return (a_real > b_real) - (a_real < b_real);
+    }
+    std::int64_t a_integer, b_integer;
+    std::memcpy(&a_integer, a.data(), sizeof(std::int64_t));
+    std::memcpy(&b_integer, b.data(), sizeof(std::int64_t));
+    return (a_integer > b_integer) - (a_integer < b_integer);
+}
+
+/**
+ * @brief Maps a value in its binary form to the key of its bucket, preserving the order.
+ */
+ustore_key_t index_bucket(ustore_doc_field_type_t type, value_view_t value) noexcept {
+    constexpr std::uint64_t sign_k = std::uint64_t(1) << 63;
+    std::uint64_t ordered = 0;
+    if (type == ustore_doc_field_str_k)
+        for (std::size_t i = 0; i != sizeof(ordered); ++i)
+            ordered = (ordered << 8) | (i < value.size() ? static_cast<std::uint8_t>(value.c_str()[i]) : 0u);
+    else {
+        std::memcpy(&ordered, value.data(), sizeof(ordered));
+        // Positive floats are ordered by their bits, while the negative ones - in reverse
+        if (type == ustore_doc_field_f64_k)
+            ordered = (ordered & sign_k) ? ~ordered : (ordered | sign_k);
+        else
+            ordered ^= sign_k;
+    }
+
+    // Flipping the sign bit maps the unsigned order onto the signed one.
+    // The lowest bits are left for the pages of the bucket.
+    auto key = static_cast<ustore_key_t>(ordered ^ sign_k);
+    return key & ~index_page_mask_k;
+}
+
+/**
+ * @brief Number of pages of the bucket, which first key holds the `head`, or zero if it isn't paged.
+ * Such heads are shorter than any entry, so they can't be confused with regular buckets.
+ */
+inline ustore_length_t index_pages(value_view_t head) noexcept {
+    ustore_length_t pages = 0;
+    if (head.size() == sizeof(pages))
+        std::memcpy(&pages, head.data(), sizeof(pages));
+    return pages;
+}
+
+/**
+ * @brief Key of the page of the `bucket`, that holds the entries of the `doc`.
+ */
+inline ustore_key_t index_page(ustore_key_t bucket, ustore_key_t doc, ustore_length_t pages) noexcept {
+    auto const mixed = static_cast<std::uint64_t>(doc) * 0x9E3779B97F4A7C15ull;
+    return bucket + 1 + static_cast<ustore_key_t>((mixed >> 32) % pages);
+}
+
+struct index_entry_t {
+    ustore_key_t doc;
+    value_view_t value;
+};
+
+template <typename callback_at>
+void for_each_index_entry(value_view_t bucket, callback_at&& callback) noexcept {
+    constexpr std::size_t header_k = sizeof(ustore_key_t) + sizeof(ustore_length_t);
+    byte_t const* it = bucket.data();
+    byte_t const* const end = it + bucket.size();
+    while (static_cast<std::size_t>(end - it) >= header_k) {
+        index_entry_t entry;
+        ustore_length_t length;
+        std::memcpy(&entry.doc, it, sizeof(ustore_key_t));
+        std::memcpy(&length, it + sizeof(ustore_key_t), sizeof(ustore_length_t));
+        it += header_k;
+        if (static_cast<std::size_t>(end - it) < length)
+            break;
+        entry.value = value_view_t {it, static_cast<std::size_t>(length)};
+        callback(entry);
+        it += length;
+    }
+}
+
+/**
+ * @brief Orders the entries of buckets by value and then by document key.
+ */
+inline auto index_entry_less(ustore_doc_field_type_t type) noexcept {
+    return [=](index_entry_t const& a, index_entry_t const& b) {
+        int const order = index_compare(type, a.value, b.value);
+        return order != 0 ? order < 0 : a.doc < b.doc;
+    };
+}
+
+/**
+ * @brief Accumulates the additions and removals of index entries, until they are applied.
+ * Edits are grouped by buckets, or their pages, so that every one is read and written just once.
+ */
+struct index_edits_t {
+    struct edit_t {
+        ustore_collection_t index;
+        ustore_key_t bucket;
+        /** @brief Key of the bucket or of its page, that the edit lands in. */
+        ustore_key_t page;
+        /** @brief Number of pages of the bucket, or zero if it isn't paged. */
+        ustore_length_t pages;
+        ustore_key_t doc;
+        ustore_doc_field_type_t type;
+        ustore_length_t value_offset;
+        ustore_length_t value_length;
+        bool is_addition;
+    };
+
+    uninitialized_array_gt<edit_t> edits;
+    string_t values;
+
+    index_edits_t(linked_memory_lock_t& arena) noexcept : edits(arena), values(arena) {}
+
+    std::size_t size() const noexcept { return edits.size(); }
+
+    value_view_t value(edit_t const& edit) const noexcept {
+        return {reinterpret_cast<byte_t const*>(values.data()) + edit.value_offset, edit.value_length};
+    }
+
+    /**
+     * @brief Lists the entries of a stored document in all of the `indexes`.
+     * Missing documents and values of other types have no entries.
+     */
+    void add(ustore_key_t key,
+             value_view_t binary_doc,
+             ptr_range_gt<docs_index_t> indexes,
+             bool is_addition,
+             linked_memory_lock_t& arena,
+             ustore_error_t* c_error) noexcept {
+
+        if (!binary_doc.size())
+            return;
+        json_t doc = json_read(stored_doc_t {binary_doc}.body(), arena, c_error);
+        return_if_error_m(c_error);
+        yyjson_val* root = yyjson_doc_get_root(doc.handle);
+        if (!root)
+            return;
+
+        for (docs_index_t const& index : indexes) {
+            yyjson_val* field_value = json_lookupn(root, index.field.data(), index.field.size());
+            std::size_t const offset = values.size();
+            bool const is_indexed = index_value(index.type, field_value, values, c_error);
+            return_if_error_m(c_error);
+            if (!is_indexed)
+                continue;
+
+            edit_t edit;
+            edit.index = index.collection;
+            edit.doc = key;
+            edit.type = index.type;
+            edit.value_offset = static_cast<ustore_length_t>(offset);
+            edit.value_length = static_cast<ustore_length_t>(values.size() - offset);
+            edit.is_addition = is_addition;
+            edit.bucket = index_bucket(index.type, value(edit));
+            edit.page = edit.bucket;
+            edit.pages = 0;
+            edits.push_back(edit, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+    static joined_blobs_t read_keys(ustore_database_t const c_db,
+                                    ustore_transaction_t const c_txn,
+                                    ustore_options_t const c_options,
+                                    ptr_range_gt<collection_key_t> keys,
+                                    linked_memory_lock_t& arena,
+                                    ustore_error_t* c_error) noexcept {
+        ustore_length_t* found_offsets {};
+        ustore_byte_t* found_values {};
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.transaction = c_txn;
+        read.arena = arena;
+        read.options = read_options(c_options);
+        read.tasks_count = keys.size();
+        read.collections = &keys.begin()->collection;
+        read.collections_stride = sizeof(collection_key_t);
+        read.keys = &keys.begin()->key;
+        read.keys_stride = sizeof(collection_key_t);
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
+        return {keys.size(), found_offsets, found_values};
+    }
+
+    static void write_keys(ustore_database_t const c_db,
+                           ustore_transaction_t const c_txn,
+                           ustore_options_t const c_options,
+                           ptr_range_gt<collection_key_t> keys,
+                           growing_tape_t& values,
+                           linked_memory_lock_t& arena,
+                           ustore_error_t* c_error) noexcept {
+        ustore_byte_t* values_begin = reinterpret_cast<ustore_byte_t*>(values.contents().begin().get());
+        ustore_write_t write {};
+        write.db = c_db;
+        write.error = c_error;
+        write.transaction = c_txn;
+        write.arena = arena;
+        write.options = c_options;
+        write.tasks_count = keys.size();
+        write.collections = &keys.begin()->collection;
+        write.collections_stride = sizeof(collection_key_t);
+        write.keys = &keys.begin()->key;
+        write.keys_stride = sizeof(collection_key_t);
+        write.offsets = values.offsets().begin().get();
+        write.offsets_stride = values.offsets().stride();
+        write.lengths = values.lengths().begin().get();
+        write.lengths_stride = values.lengths().stride();
+        write.values = &values_begin;
+        ustore_write(&write);
+    }
+
+    /**
+     * @brief Serializes the sorted `entries` into the `updated` value of a bucket or a page,
+     * removing the ones, that are left empty.
+     */
+    static void export_entries(ptr_range_gt<index_entry_t const> entries,
+                               string_t& bytes,
+                               growing_tape_t& updated,
+                               ustore_error_t* c_error) noexcept {
+        if (entries.empty()) {
+            updated.push_back(value_view_t {}, c_error);
+            return;
+        }
+        bytes.clear();
+        for (index_entry_t const& entry : entries) {
+            auto const length = static_cast<ustore_length_t>(entry.value.size());
+            auto const doc = reinterpret_cast<char const*>(&entry.doc);
+            auto const length_bytes = reinterpret_cast<char const*>(&length);
+            bytes.insert(bytes.size(), doc, doc + sizeof(ustore_key_t), c_error);
+            bytes.insert(bytes.size(), length_bytes, length_bytes + sizeof(length), c_error);
+            bytes.insert(bytes.size(), entry.value.c_str(), entry.value.c_str() + length, c_error);
+            return_if_error_m(c_error);
+        }
+        updated.push_back(value_view_t {reinterpret_cast<byte_t const*>(bytes.data()), bytes.size()}, c_error);
+    }
+
+    /**
+     * @brief Spreads all the sorted `entries` of a bucket between enough pages,
+     * replacing its `old_pages`, if it was already paged.
+     */
+    static void spread(edit_t const& bucket,
+                       ptr_range_gt<index_entry_t> entries,
+                       ustore_length_t old_pages,
+                       uninitialized_array_gt<collection_key_t>& written,
+                       growing_tape_t& updated,
+                       string_t& bytes,
+                       ustore_error_t* c_error) noexcept {
+
+        ustore_length_t pages = std::max<ustore_length_t>(old_pages * 2, 2);
+        while (pages < index_max_pages_k && entries.size() > std::size_t(pages) * index_page_entries_k / 2)
+            pages *= 2;
+        pages = std::min(pages, index_max_pages_k);
+
+        // Stable sorting keeps the entries within every page in order
+        auto page_of = [&](index_entry_t const& entry) { return index_page(bucket.bucket, entry.doc, pages); };
+        std::stable_sort(entries.begin(), entries.end(), [&](index_entry_t const& a, index_entry_t const& b) {
+            return page_of(a) < page_of(b);
+        });
+
+        written.push_back(collection_key_t {bucket.index, bucket.bucket}, c_error);
+        return_if_error_m(c_error);
+        updated.push_back(value_view_t {reinterpret_cast<byte_t const*>(&pages), sizeof(pages)}, c_error);
+        return_if_error_m(c_error);
+        index_entry_t* page_begin = entries.begin();
+        for (ustore_length_t page_idx = 0; page_idx != pages; ++page_idx) {
+            ustore_key_t const page = bucket.bucket + 1 + page_idx;
+            index_entry_t* page_end = std::find_if(page_begin, entries.end(), [&](index_entry_t const& entry) {
+                return page_of(entry) != page;
+            });
+            written.push_back(collection_key_t {bucket.index, page}, c_error);
+            return_if_error_m(c_error);
+            export_entries({page_begin, page_end}, bytes, updated, c_error);
+            return_if_error_m(c_error);
+            page_begin = page_end;
+        }
+    }
+
+    /**
+     * @brief Sorts the edits by the keys they land in, removals first, and lists those keys.
+     */
+    void group(uninitialized_array_gt<collection_key_t>& keys, ustore_error_t* c_error) noexcept {
+        std::sort(edits.begin(), edits.end(), [](edit_t const& a, edit_t const& b) {
+            return std::tie(a.index, a.page, a.is_addition) < std::tie(b.index, b.page, b.is_addition);
+        });
+        keys.clear();
+        for (edit_t const& edit : edits) {
+            collection_key_t key {edit.index, edit.page};
+            if (!keys.size() || keys[keys.size() - 1] != key)
+                keys.push_back(key, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+    /**
+     * @brief Routes the edits of paged buckets into the pages of their documents,
+     * reading the values of the keys, that the edits land in.
+     */
+    joined_blobs_t locate(ustore_database_t const c_db,
+                          ustore_transaction_t const c_txn,
+                          ustore_options_t const c_options,
+                          uninitialized_array_gt<collection_key_t>& keys,
+                          linked_memory_lock_t& arena,
+                          ustore_error_t* c_error) noexcept {
+
+        group(keys, c_error);
+        if (*c_error)
+            return {};
+        joined_blobs_t found = read_keys(c_db, c_txn, c_options, {keys.begin(), keys.end()}, arena, c_error);
+        if (*c_error)
+            return {};
+
+        bool has_pages = false;
+        edit_t* edit = edits.begin();
+        for (std::size_t key_idx = 0; key_idx != keys.size(); ++key_idx) {
+            ustore_length_t const pages = index_pages(found[key_idx]);
+            has_pages |= pages != 0;
+            for (; edit != edits.end() && collection_key_t {edit->index, edit->page} == keys[key_idx]; ++edit)
+                if (pages)
+                    edit->page = index_page(edit->bucket, edit->doc, pages), edit->pages = pages;
+        }
+        if (!has_pages)
+            return found;
+
+        group(keys, c_error);
+        if (*c_error)
+            return {};
+        return read_keys(c_db, c_txn, c_options, {keys.begin(), keys.end()}, arena, c_error);
+    }
+
+    void apply(ustore_database_t const c_db,
+               ustore_transaction_t const c_txn,
+               ustore_options_t const c_options,
+               linked_memory_lock_t& arena,
+               ustore_error_t* c_error) noexcept {
+
+        if (!size())
+            return;
+
+        uninitialized_array_gt<collection_key_t> keys(arena);
+        joined_blobs_t found = locate(c_db, c_txn, c_options, keys, arena, c_error);
+        return_if_error_m(c_error);
+
+        uninitialized_array_gt<collection_key_t> written(arena);
+        uninitialized_array_gt<edit_t> overflown(arena);
+        growing_tape_t updated(arena);
+        uninitialized_array_gt<index_entry_t> entries(arena);
+        string_t bucket_bytes(arena);
+        edit_t const* edit = edits.begin();
+        for (std::size_t key_idx = 0; key_idx != keys.size(); ++key_idx) {
+            edit_t const first = *edit;
+            entries.clear();
+            for_each_index_entry(found[key_idx], [&](index_entry_t entry) { entries.push_back(entry, c_error); });
+            return_if_error_m(c_error);
+
+            auto less = index_entry_less(first.type);
+            auto equal = [&](index_entry_t const& a, index_entry_t const& b) { return !less(a, b) && !less(b, a); };
+
+            // Stored entries are sorted, so the removals can use binary search
+            for (; edit != edits.end() && collection_key_t {edit->index, edit->page} == keys[key_idx]; ++edit) {
+                index_entry_t edited {edit->doc, value(*edit)};
+                if (edit->is_addition) {
+                    entries.push_back(edited, c_error);
+                    return_if_error_m(c_error);
+                    continue;
+                }
+                auto it = std::lower_bound(entries.begin(), entries.end(), edited, less);
+                if (it != entries.end() && equal(*it, edited))
+                    entries.erase(static_cast<std::size_t>(it - entries.begin()), 1, c_error);
+                return_if_error_m(c_error);
+            }
+            std::sort(entries.begin(), entries.end(), less);
+            auto unique_end = std::unique(entries.begin(), entries.end(), equal);
+            entries.resize(static_cast<std::size_t>(unique_end - entries.begin()), c_error);
+            return_if_error_m(c_error);
+
+            // Buckets, that outgrow a page, are split into pages right away,
+            // but pages, that overflow, need the rest of the bucket to be split further
+            bool const is_full = entries.size() > index_page_entries_k;
+            if (is_full && !first.pages) {
+                spread(first, {entries.begin(), entries.end()}, 0, written, updated, bucket_bytes, c_error);
+                return_if_error_m(c_error);
+                continue;
+            }
+            bool const is_new_overflow =
+                !overflown.size() || overflown[overflown.size() - 1].bucket != first.bucket ||
+                overflown[overflown.size() - 1].index != first.index;
+            if (is_full && first.pages < index_max_pages_k && is_new_overflow)
+                overflown.push_back(first, c_error);
+            written.push_back(keys[key_idx], c_error);
+            return_if_error_m(c_error);
+            export_entries({entries.begin(), entries.end()}, bucket_bytes, updated, c_error);
+            return_if_error_m(c_error);
+        }
+        write_keys(c_db, c_txn, c_options, {written.begin(), written.end()}, updated, arena, c_error);
+        return_if_error_m(c_error);
+
+        // Overflown buckets are re-read entirely and spread between more pages
+        for (edit_t const& bucket : overflown) {
+            keys.clear();
+            for (ustore_length_t page_idx = 0; page_idx != bucket.pages; ++page_idx) {
+                keys.push_back(collection_key_t {bucket.index, bucket.bucket + 1 + page_idx}, c_error);
+                return_if_error_m(c_error);
+            }
+            found = read_keys(c_db, c_txn, c_options, {keys.begin(), keys.end()}, arena, c_error);
+            return_if_error_m(c_error);
+            entries.clear();
+            for (std::size_t key_idx = 0; key_idx != keys.size(); ++key_idx)
+                for_each_index_entry(found[key_idx], [&](index_entry_t entry) { entries.push_back(entry, c_error); });
+            return_if_error_m(c_error);
+            std::sort(entries.begin(), entries.end(), index_entry_less(bucket.type));
+
+            written.clear();
+            updated.clear();
+            spread(bucket, {entries.begin(), entries.end()}, bucket.pages, written, updated, bucket_bytes, c_error);
+            return_if_error_m(c_error);
+            write_keys(c_db, c_txn, c_options, {written.begin(), written.end()}, updated, arena, c_error);
+            return_if_error_m(c_error);
+        }
+
+        edits.clear();
+        values.clear();
+    }
+};
+
+/**
+ * @brief Reads the schemas of the collections, that the `places` write into.
+ */
+docs_derived_t read_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    docs_derived_t derived;
+    derived.schemas = read_schemas(c_db, c_txn, {}, places, c_options, arena, c_error);
+    for (docs_schema_t const& schema : derived.schemas) {
+        derived.has_columns |= schema.columns.size() != 0;
+        derived.has_indexes |= schema.indexes.size() != 0;
+        derived.has_compression |= schema.codec != codec_t::none_k;
+    }
+    return derived;
+}
+
+/**
+ * @brief Compresses the documents, that the `places` write into compressed collections.
+ * @return True, if the `packed` tape was filled and must be written instead of the `docs`.
+ */
+bool stored_pack( //
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    growing_tape_t& docs,
+    growing_tape_t& packed,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    if (!derived.has_compression)
+        return false;
+    packed.reserve(places.size(), c_error);
+    if (*c_error)
+        return false;
+
+    auto offsets = docs.offsets();
+    auto lengths = docs.lengths();
+    byte_t const* contents = docs.contents().begin().get();
+    uninitialized_array_gt<byte_t> buffer(arena);
+    for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
+        place_t place = places[task_idx];
+        value_view_t doc;
+        if (lengths[task_idx] != ustore_length_missing_k)
+            doc = value_view_t {contents + offsets[task_idx], lengths[task_idx]};
+        auto schema = std::find_if(derived.schemas.begin(), derived.schemas.end(), [&](docs_schema_t const& schema) {
+            return schema.collection == place.collection;
+        });
+        if (doc.empty() || schema->codec == codec_t::none_k || place.key == ustore_docs_schema_key_k) {
+            packed.push_back(doc, c_error);
+            if (*c_error)
+                return false;
+            continue;
+        }
+
+        auto dictionary = zstd_dictionaries().find(schema->dictionary_id);
+        buffer.resize(sizeof(stored_packed_header_t) + compress_bound(codec_t::zstd_k, doc.size()), c_error);
+        if (*c_error)
+            return false;
+        byte_t* payload = buffer.begin() + sizeof(stored_packed_header_t);
+        std::size_t const payload_length =
+            zstd_compress(doc, payload, buffer.size() - sizeof(stored_packed_header_t), dictionary.get(), schema->level);
+        std::size_t const packed_length = sizeof(stored_packed_header_t) + payload_length;
+        if (!payload_length || packed_length >= doc.size()) {
+            packed.push_back(doc, c_error);
+            if (*c_error)
+                return false;
+            continue;
+        }
+
+        stored_packed_header_t header {};
+        header.version = stored_packed_version_k;
+        header.codec = codec_t::zstd_k;
+        header.dictionary_id = dictionary ? schema->dictionary_id : 0;
+        header.stored_length = static_cast<ustore_length_t>(doc.size());
+        std::memcpy(buffer.begin(), &header, sizeof(header));
+        packed.push_back(value_view_t {buffer.begin(), packed_length}, c_error);
+        if (*c_error)
+            return false;
+    }
+    return true;
+}
+
+joined_blobs_t read_stored_docs( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    ustore_byte_t* found_binary_begin {};
+    ustore_length_t* found_binary_offs {};
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_txn;
+    read.arena = arena;
+    read.options = read_options(c_options);
+    read.tasks_count = places.count;
+    read.collections = places.collections_begin.get();
+    read.collections_stride = places.collections_begin.stride();
+    read.keys = places.keys_begin.get();
+    read.keys_stride = places.keys_begin.stride();
+    read.offsets = &found_binary_offs;
+    read.values = &found_binary_begin;
+    ustore_read(&read);
+    stored_unpack(read, arena, c_error);
+    if (*c_error)
+        return {};
+    return {places.count, found_binary_offs, found_binary_begin};
+}
+
+/**
+ * @brief Reads the revisions of the documents, that the `places` are about to overwrite,
+ * so that their stale index entries can be removed. Skipped, if nothing is indexed.
+ */
+void read_old_docs( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t& derived,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    if (derived.has_indexes)
+        derived.old_docs = read_stored_docs(c_db, c_txn, places, c_options, arena, c_error);
+}
+
+/**
+ * @brief Shreds the written documents into columns and moves their index entries.
+ */
+void update_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    joined_blobs_t docs,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    auto schema_of = [&](ustore_collection_t collection) {
+        return std::find_if(derived.schemas.begin(), derived.schemas.end(), [=](docs_schema_t const& schema) {
+            return schema.collection == collection;
+        });
+    };
+
+    if (derived.has_columns) {
+        columns_batch_t batch {arena};
+        for (std::size_t task_idx = 0; task_idx != places.size(); ++task_idx) {
+            place_t place = places[task_idx];
+            if (place.key == ustore_docs_schema_key_k)
+                continue;
+            auto schema = schema_of(place.collection);
+            if (!schema->columns.size())
+                continue;
+            batch.shred(place.key, docs[task_idx], schema->columns, arena, c_error);
+            return_if_error_m(c_error);
+        }
+        batch.write(c_db, c_txn, c_options, arena, c_error);
+        return_if_error_m(c_error);
+    }
+    if (!derived.has_indexes)
+        return;
+
+    // Only the last write into every document remains visible, so only its values are indexed
+    uninitialized_array_gt<ustore_size_t> order(places.size(), arena, c_error);
+    return_if_error_m(c_error);
+    std::iota(order.begin(), order.end(), ustore_size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](ustore_size_t a, ustore_size_t b) {
+        return places[a].collection_key() < places[b].collection_key();
+    });
+
+    index_edits_t edits {arena};
+    for (std::size_t i = 0; i != order.size(); ++i) {
+        ustore_size_t const task_idx = order[i];
+        place_t place = places[task_idx];
+        bool const is_overwritten =
+            i + 1 != order.size() && places[order[i + 1]].collection_key() == place.collection_key();
+        if (is_overwritten || place.key == ustore_docs_schema_key_k)
+            continue;
+        auto schema = schema_of(place.collection);
+        if (!schema->indexes.size())
+            continue;
+        edits.add(place.key, derived.old_docs[task_idx], schema->indexes, false, arena, c_error);
+        edits.add(place.key, docs[task_idx], schema->indexes, true, arena, c_error);
+        return_if_error_m(c_error);
+    }
+    edits.apply(c_db, c_txn, c_options, arena, c_error);
+}
+
+/**
+ * @brief Updates the columns and indexes after the documents were modified by the engine.
+ * Only reads the documents back, if some of the `places` belong to columnar or indexed collections.
+ */
+void refresh_derived( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    places_arg_t const& places,
+    docs_derived_t const& derived,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    if (!derived.has_columns && !derived.has_indexes)
+        return;
+
+    joined_blobs_t docs = read_stored_docs(c_db, c_txn, places, c_options, arena, c_error);
+    return_if_error_m(c_error);
+    update_derived(c_db, c_txn, places, derived, docs, c_options, arena, c_error);
+}
+
+void ustore_docs_index(ustore_docs_index_t* c_ptr) {
+
+    ustore_docs_index_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.field, c.error, args_wrong_k, "Field must be provided");
+    bool const is_drop = c.type == ustore_doc_field_null_k;
+    return_error_if_m(is_drop || index_supports(c.type),
+                      c.error,
+                      args_wrong_k,
+                      "Only integer, real and string fields can be indexed");
+    return_error_if_m(is_drop || c.index != c.collection,
+                      c.error,
+                      args_wrong_k,
+                      "Index must be stored in a separate collection");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    ustore_options_t const options = engine_options(c.options);
+
+    places_arg_t schema_place {{&c.collection, 0}, {&ustore_docs_schema_key_k, 0}, {}, 1};
+    auto schemas = read_schemas(c.db, c.transaction, {}, schema_place, options, arena, c.error);
+    return_if_error_m(c.error);
+    docs_schema_t schema = schemas[0];
+
+    // The new declaration replaces the previous index of the same field, if any
+    std::string field_pointer;
+    docs_index_t declared;
+    declared.field = field_to_pointer(c.field, field_pointer);
+    declared.type = c.type;
+    declared.collection = c.index;
+    auto indexes = arena.alloc<docs_index_t>(schema.indexes.size() + 1, c.error);
+    return_if_error_m(c.error);
+    auto indexes_end = std::copy_if(schema.indexes.begin(),
+                                    schema.indexes.end(),
+                                    indexes.begin(),
+                                    [&](docs_index_t const& index) { return index.field != declared.field; });
+    if (!is_drop)
+        *indexes_end++ = declared;
+    schema.indexes = {indexes.begin(), indexes_end};
+
+    // Backfill the index with the entries of the existing documents.
+    // Like in `ustore_docs_columns`, the scanned batches use a separate arena,
+    // which also hosts the temporary state of applying every batch of edits.
+    if (!is_drop) {
+        ustore_arena_t scan_arena = nullptr;
+        ustore_options_t const scan_options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+        index_edits_t edits {arena};
+        scan_range_collection( //
+            c.db,
+            c.transaction,
+            c.collection,
+            options,
+            std::numeric_limits<ustore_key_t>::min(),
+            std::numeric_limits<ustore_key_t>::max(),
+            columns_batch_k,
+            &scan_arena,
+            c.error,
+            [&](ustore_key_t key, value_view_t binary_doc) {
+                if (key == ustore_docs_schema_key_k)
+                    return true;
+                linked_memory_lock_t doc_arena = linked_memory(&scan_arena, scan_options, c.error);
+                binary_doc = stored_unpack(binary_doc, doc_arena, c.error);
+                if (!*c.error)
+                    edits.add(key, binary_doc, {&declared, std::size_t(1)}, true, doc_arena, c.error);
+                if (!*c.error && edits.size() >= columns_batch_k)
+                    edits.apply(c.db, c.transaction, options, doc_arena, c.error);
+                return !*c.error;
+            });
+        if (!*c.error)
+            edits.apply(c.db, c.transaction, options, arena, c.error);
+        ustore_arena_free(scan_arena);
+        return_if_error_m(c.error);
+    }
+
+    write_schema(c.db, c.transaction, schema, options, arena, c.error);
+}
+
+/**
+ * @brief Exports the keys of documents, which values in the `index` are within the bounds.
+ * Bounds are JSON scalars, and NULL ones are open. Keys are exported in the order of values.
+ */
+void find_in_index( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_txn,
+    docs_index_t const& index,
+    ustore_str_view_t min_json,
+    ustore_str_view_t max_json,
+    ustore_length_t count_limit,
+    ustore_options_t const c_options,
+    uninitialized_array_gt<ustore_key_t>& found_keys,
+    linked_memory_lock_t& arena,
+    ustore_arena_t* scan_arena,
+    ustore_error_t* c_error) noexcept {
+
+    // Bounds are converted into the same binary form, as the indexed values
+    string_t bounds(arena);
+    auto export_bound = [&](ustore_str_view_t json) {
+        if (!json)
+            return false;
+        json_t parsed = json_read(value_view_t {json}, arena, c_error);
+        if (*c_error)
+            return false;
+        bool const is_valid = index_value(index.type, yyjson_doc_get_root(parsed.handle), bounds, c_error);
+        log_error_if_m(is_valid || *c_error, c_error, args_wrong_k, "Bounds must match the type of the index");
+        return is_valid;
+    };
+    bool const has_min = export_bound(min_json);
+    std::size_t const min_length = bounds.size();
+    bool const has_max = !*c_error && export_bound(max_json);
+    return_if_error_m(c_error);
+    value_view_t min_value {reinterpret_cast<byte_t const*>(bounds.data()), min_length};
+    value_view_t max_value {reinterpret_cast<byte_t const*>(bounds.data()) + min_length, bounds.size() - min_length};
+
+    ustore_key_t const min_bucket =
+        has_min ? index_bucket(index.type, min_value) : std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t const max_bucket =
+        has_max ? index_bucket(index.type, max_value) : std::numeric_limits<ustore_key_t>::max() & ~index_page_mask_k;
+    if (!count_limit || min_bucket > max_bucket)
+        return;
+
+    // Pages of a bucket are ordered by document keys, rather than values, so their entries
+    // are gathered, until the next bucket starts, and exported together. The scan reuses
+    // its memory between batches, so the values of gathered entries are copied.
+    std::size_t const count_begin = found_keys.size();
+    uninitialized_array_gt<index_entry_t> paged_entries(arena);
+    uninitialized_array_gt<std::size_t> paged_offsets(arena);
+    string_t paged_values(arena);
+    auto is_in_range = [&](index_entry_t const& entry) {
+        return (!has_min || index_compare(index.type, entry.value, min_value) >= 0) &&
+               (!has_max || index_compare(index.type, entry.value, max_value) <= 0);
+    };
+    auto export_entry = [&](index_entry_t const& entry) {
+        found_keys.push_back(entry.doc, c_error);
+        return !*c_error && found_keys.size() - count_begin < count_limit;
+    };
+    auto export_paged = [&]() {
+        bool should_continue = true;
+        auto values_begin = reinterpret_cast<byte_t const*>(paged_values.data());
+        for (std::size_t i = 0; i != paged_entries.size(); ++i)
+            paged_entries[i].value = value_view_t {values_begin + paged_offsets[i], paged_entries[i].value.size()};
+        std::sort(paged_entries.begin(), paged_entries.end(), index_entry_less(index.type));
+        for (index_entry_t const& entry : paged_entries)
+            if (should_continue)
+                should_continue = export_entry(entry);
+        paged_entries.clear();
+        paged_offsets.clear();
+        paged_values.clear();
+        return should_continue;
+    };
+
+    scan_range_collection( //
+        c_db,
+        c_txn,
+        index.collection,
+        c_options,
+        min_bucket,
+        max_bucket + index_max_pages_k + 1,
+        index_scan_read_ahead_k,
+        scan_arena,
+        c_error,
+        [&](ustore_key_t key, value_view_t bucket) {
+            bool const is_page = key & index_page_mask_k;
+            if (!is_page && paged_entries.size() && !export_paged())
+                return false;
+            if (!is_page && index_pages(bucket))
+                return true;
+
+            bool should_continue = true;
+            for_each_index_entry(bucket, [&](index_entry_t entry) {
+                if (!should_continue || !is_in_range(entry))
+                    return;
+                if (!is_page) {
+                    should_continue = export_entry(entry);
+                    return;
+                }
+                // Until the values stop growing, they are addressed by offsets
+                char const* value = entry.value.c_str();
+                paged_offsets.push_back(paged_values.size(), c_error);
+                if (!*c_error)
+                    paged_entries.push_back(entry, c_error);
+                if (!*c_error)
+                    paged_values.insert(paged_values.size(), value, value + entry.value.size(), c_error);
+                should_continue = !*c_error;
+            });
+            return should_continue;
+        });
+    if (!*c_error && paged_entries.size())
+        export_paged();
+}
+
+void ustore_docs_find(ustore_docs_find_t* c_ptr) {
+
+    ustore_docs_find_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::docs_find_k, c.tasks_count, c.error};
+    if (!c.tasks_count)
+        return;
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.fields, c.error, args_wrong_k, "Fields must be provided");
+    return_error_if_m(c.keys, c.error, args_wrong_k, "Output for keys must be provided");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    strided_iterator_gt<ustore_str_view_t const> min_values {c.min_values, c.min_values_stride};
+    strided_iterator_gt<ustore_str_view_t const> max_values {c.max_values, c.max_values_stride};
+    strided_iterator_gt<ustore_length_t const> limits {c.count_limits, c.count_limits_stride};
+    places_arg_t places {collections, {&ustore_docs_schema_key_k, 0}, {}, c.tasks_count};
+    ustore_options_t const options = engine_options(c.options);
+    auto schemas = read_schemas(c.db, c.transaction, {}, places, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    auto offsets = arena.alloc<ustore_length_t>(c.tasks_count + 1, c.error);
+    return_if_error_m(c.error);
+    uninitialized_array_gt<ustore_key_t> found_keys(arena);
+    ustore_arena_t scan_arena = nullptr;
+    std::string field_pointer;
+    for (ustore_size_t task_idx = 0; task_idx != c.tasks_count && !*c.error; ++task_idx) {
+        offsets[task_idx] = static_cast<ustore_length_t>(found_keys.size());
+        ustore_collection_t const collection = places[task_idx].collection;
+        auto schema = std::find_if(schemas.begin(), schemas.end(), [=](docs_schema_t const& schema) {
+            return schema.collection == collection;
+        });
+        std::string_view pointer = field_to_pointer(fields[task_idx], field_pointer);
+        auto index = std::find_if(schema->indexes.begin(), schema->indexes.end(), [&](docs_index_t const& index) {
+            return index.field == pointer;
+        });
+        log_error_if_m(index != schema->indexes.end(), c.error, args_wrong_k, "Field isn't indexed");
+        if (*c.error)
+            break;
+
+        find_in_index(c.db,
+                      c.transaction,
+                      *index,
+                      min_values ? min_values[task_idx] : nullptr,
+                      max_values ? max_values[task_idx] : nullptr,
+                      limits ? limits[task_idx] : std::numeric_limits<ustore_length_t>::max(),
+                      options,
+                      found_keys,
+                      arena,
+                      &scan_arena,
+                      c.error);
+    }
+    ustore_arena_free(scan_arena);
+    return_if_error_m(c.error);
+    offsets[c.tasks_count] = static_cast<ustore_length_t>(found_keys.size());
+
+    if (c.counts) {
+        auto counts = arena.alloc<ustore_length_t>(c.tasks_count, c.error);
+        return_if_error_m(c.error);
+        for (ustore_size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx)
+            counts[task_idx] = offsets[task_idx + 1] - offsets[task_idx];
+        *c.counts = counts.begin();
+    }
+    if (c.offsets)
+        *c.offsets = offsets.begin();
+    *c.keys = found_keys.begin();
+}
+
+/*********************************************************/
+/*****************	     Compression	  ****************/
+/*********************************************************/
+
+constexpr ustore_length_t compression_default_samples_k = 4096;
+constexpr ustore_length_t compression_default_dictionary_k = 16 * 1024;
+
+void ustore_docs_compress(ustore_docs_compress_t* c_ptr) {
+
+    ustore_docs_compress_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    ustore_options_t const options = engine_options(c.options);
+
+    places_arg_t schema_place {{&c.collection, 0}, {&ustore_docs_schema_key_k, 0}, {}, 1};
+    auto schemas = read_schemas(c.db, c.transaction, {}, schema_place, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Train the dictionary on a sample of documents, decompressing them, if they are re-trained
+    ustore_length_t const samples_limit = c.samples_count ? c.samples_count : compression_default_samples_k;
+    ustore_length_t* sampled_counts {};
+    ustore_key_t* sampled_keys {};
+    ustore_sample_t sample {};
+    sample.db = c.db;
+    sample.error = c.error;
+    sample.transaction = c.transaction;
+    sample.arena = arena;
+    sample.options = ustore_options_t(read_options(options) | ustore_option_dont_discard_memory_k);
+    sample.tasks_count = 1;
+    sample.collections = &c.collection;
+    sample.count_limits = &samples_limit;
+    sample.counts = &sampled_counts;
+    sample.keys = &sampled_keys;
+    ustore_sample(&sample);
+    return_if_error_m(c.error);
+
+    uninitialized_array_gt<ustore_key_t> samples_keys(arena);
+    for (std::size_t i = 0; i != sampled_counts[0]; ++i) {
+        if (sampled_keys[i] == ustore_docs_schema_key_k)
+            continue;
+        samples_keys.push_back(sampled_keys[i], c.error);
+        return_if_error_m(c.error);
+    }
+    places_arg_t samples_places {{&c.collection, 0}, {samples_keys.begin(), sizeof(ustore_key_t)}, {}, 0};
+    samples_places.count = static_cast<ustore_size_t>(samples_keys.size());
+    joined_blobs_t samples = read_stored_docs(c.db, c.transaction, samples_places, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Missing documents take no space in the joined tape, so only their lengths are skipped
+    uninitialized_array_gt<std::size_t> samples_lengths(arena);
+    byte_t const* samples_begin = nullptr;
+    for (value_view_t doc : samples) {
+        if (doc.empty())
+            continue;
+        if (!samples_begin)
+            samples_begin = doc.data();
+        samples_lengths.push_back(doc.size(), c.error);
+        return_if_error_m(c.error);
+    }
+
+    docs_schema_t schema = schemas[0];
+    schema.codec = codec_t::zstd_k;
+    schema.level = c.level ? static_cast<int>(c.level) : zstd_default_level_k;
+    schema.dictionary_id = 0;
+    if (samples_lengths.size())
+        safe_section("Training dictionary", c.error, [&] {
+            std::size_t const capacity = c.dictionary_capacity ? c.dictionary_capacity : compression_default_dictionary_k;
+            std::string dictionary = zstd_train(samples_begin, samples_lengths.begin(), samples_lengths.size(), capacity);
+            if (!dictionary.empty())
+                schema.dictionary_id = zstd_dictionaries().insert(dictionary);
+        });
+    return_if_error_m(c.error);
+
+    // Store the schema first, so that the documents written concurrently are compressed as well
+    write_schema(c.db, c.transaction, schema, options, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Re-compress the existing documents with the new dictionary
+    docs_derived_t derived;
+    derived.schemas = {&schema, 1};
+    derived.has_compression = true;
+    uninitialized_array_gt<ustore_key_t> batch_keys(arena);
+    growing_tape_t batch_docs(arena);
+    growing_tape_t batch_packed(arena);
+    auto write_batch = [&] {
+        if (!batch_keys.size())
+            return;
+        places_arg_t batch_places {{&c.collection, 0}, {batch_keys.begin(), sizeof(ustore_key_t)}, {}, 0};
+        batch_places.count = static_cast<ustore_size_t>(batch_keys.size());
+        stored_pack(batch_places, derived, batch_docs, batch_packed, arena, c.error);
+        return_if_error_m(c.error);
+
+        ustore_byte_t* packed_begin = reinterpret_cast<ustore_byte_t*>(batch_packed.contents().begin().get());
+        ustore_write_t write {};
+        write.db = c.db;
+        write.error = c.error;
+        write.transaction = c.transaction;
+        write.arena = arena;
+        write.options = options;
+        write.tasks_count = batch_places.count;
+        write.collections = &c.collection;
+        write.collections_stride = 0;
+        write.keys = batch_keys.begin();
+        write.keys_stride = sizeof(ustore_key_t);
+        write.offsets = batch_packed.offsets().begin().get();
+        write.offsets_stride = batch_packed.offsets().stride();
+        write.lengths = batch_packed.lengths().begin().get();
+        write.lengths_stride = batch_packed.lengths().stride();
+        write.values = &packed_begin;
+        ustore_write(&write);
+
+        batch_keys.clear();
+        batch_docs.clear();
+        batch_packed.clear();
+    };
+
+    ustore_arena_t scan_arena = nullptr;
+    ustore_options_t const scan_options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    scan_range_collection( //
+        c.db,
+        c.transaction,
+        c.collection,
+        options,
+        std::numeric_limits<ustore_key_t>::min(),
+        std::numeric_limits<ustore_key_t>::max(),
+        columns_batch_k,
+        &scan_arena,
+        c.error,
+        [&](ustore_key_t key, value_view_t binary_doc) {
+            if (key == ustore_docs_schema_key_k)
+                return true;
+            linked_memory_lock_t doc_arena = linked_memory(&scan_arena, scan_options, c.error);
+            binary_doc = stored_unpack(binary_doc, doc_arena, c.error);
+            if (!*c.error)
+                batch_keys.push_back(key, c.error);
+            if (!*c.error)
+                batch_docs.push_back(binary_doc, c.error);
+            if (!*c.error && batch_keys.size() >= columns_batch_k)
+                write_batch();
+            return !*c.error;
+        });
+    if (!*c.error)
+        write_batch();
+    ustore_arena_free(scan_arena);
 }
@@ -10,15 +10,28 @@
  * - output degree
  * - inbound neighborships: neighbor ID + edge ID
  * - outbound neighborships: neighbor ID + edge ID
+ *
+ * High-degree vertices, called "hubs", instead store a directory of sorted chunks
+ * of neighborships, each kept under a separate key of a sibling collection, so that
+ * vertices can use the whole range of keys. Updating a hub only rewrites the affected
+ * chunks and the directory.
+ *
+ * With `ustore_option_graph_compact_k` regular vertices are stored in a compact form:
+ * delta- and varint-encoded neighbor IDs, with edge IDs omitted, if all are default.
+ * Those are decoded lazily on lookups and fully only when being updated.
  */
 
 #include <numeric>  // `std::accumulate`
 #include <optional> // `std::optional`
 #include <limits>   // `std::numeric_limits`
+#include <string_view> // `std::string_view`
 
 #include "ustore/ustore.hpp"
 #include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
+#include "helpers/linked_array.hpp"  // `uninitialized_array_gt`
 #include "helpers/algorithm.hpp"     // `equal_subrange`
+#include "helpers/threads.hpp"       // `parallel_for`
+#include "helpers/metrics.hpp"       // `operation_timer_t`
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -32,10 +45,244 @@ ustore_vertex_degree_t ustore_vertex_degree_missing_k = std::numeric_limits<usto
 
 constexpr std::size_t bytes_in_degrees_header_k = 2 * sizeof(ustore_vertex_degree_t);
 
+/**
+ * @brief Vertices with more neighborships are converted into hubs.
+ * Below this size rewriting the whole entry is cheaper than an extra round-trip.
+ */
+constexpr std::size_t hub_degree_k = 4096;
+/**
+ * @brief Chunks of hubs growing beyond this size are split in halves.
+ * Chunks that become empty are removed, but small ones aren't merged.
+ */
+constexpr std::size_t chunk_capacity_k = 4096;
+/**
+ * @brief Edge batches of this size are merged into neighborhoods in parallel,
+ * if the database was configured with more than one thread.
+ */
+constexpr std::size_t parallel_updates_min_k = 64 * 1024;
+/** @brief Replaces the outgoing degree in the beginning of hub entries. */
+constexpr ustore_vertex_degree_t hub_marker_k = std::numeric_limits<ustore_vertex_degree_t>::max();
+/** @brief Stores the next unused chunk key in every sibling collection. */
+constexpr ustore_key_t chunks_counter_key_k = std::numeric_limits<ustore_key_t>::max() - 1;
+/** @brief Stores the sorted `tombstone_t` records in every sibling collection. */
+constexpr ustore_key_t tombstones_key_k = std::numeric_limits<ustore_key_t>::max() - 2;
+
+/**
+ * @brief Leading part of the hub entries, followed by references to
+ * its chunks: first the outgoing ones, then the incoming.
+ */
+struct hub_header_t {
+    ustore_vertex_degree_t marker;
+    ustore_vertex_degree_t degrees[2];
+    ustore_vertex_degree_t chunks[2];
+    ustore_vertex_degree_t padding;
+};
+
+/**
+ * @brief Locates a chunk of a hub. Neighborships of the chunk are
+ * no smaller than its `first` and smaller than the `first` of the next one.
+ */
+struct chunk_ref_t {
+    neighborship_t first;
+    ustore_key_t key;
+    ustore_vertex_degree_t size;
+    ustore_vertex_degree_t padding;
+};
+
+inline std::size_t role_idx(ustore_vertex_role_t role) noexcept {
+    return role == ustore_vertex_target_k;
+}
+
+inline bool is_hub(value_view_t bytes) noexcept {
+    return bytes.size() >= sizeof(hub_header_t) &&
+           *reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin()) == hub_marker_k;
+}
+
+inline hub_header_t const& hub_header(value_view_t bytes) noexcept {
+    return *reinterpret_cast<hub_header_t const*>(bytes.begin());
+}
+
+ptr_range_gt<chunk_ref_t const> hub_chunks(value_view_t bytes, ustore_vertex_role_t role = ustore_vertex_role_any_k) {
+    hub_header_t const& header = hub_header(bytes);
+    auto refs = reinterpret_cast<chunk_ref_t const*>(bytes.begin() + sizeof(hub_header_t));
+    switch (role) {
+    case ustore_vertex_source_k: return {refs, refs + header.chunks[0]};
+    case ustore_vertex_target_k: return {refs + header.chunks[0], refs + header.chunks[0] + header.chunks[1]};
+    case ustore_vertex_role_any_k: return {refs, refs + header.chunks[0] + header.chunks[1]};
+    case ustore_vertex_role_unknown_k: return {};
+    }
+    __builtin_unreachable();
+}
+
+/**
+ * @brief Finds the chunk, that contains or should contain the given neighborship.
+ */
+inline std::size_t chunk_for(ptr_range_gt<chunk_ref_t const> refs, neighborship_t ship) noexcept {
+    auto it = std::upper_bound(refs.begin(), refs.end(), ship, [](neighborship_t ship, chunk_ref_t const& ref) {
+        return ship < ref.first;
+    });
+    return it == refs.begin() ? 0 : it - refs.begin() - 1;
+}
+
+/** @brief Replaces the outgoing degree in the beginning of compact entries. */
+constexpr ustore_vertex_degree_t compact_marker_k = hub_marker_k - 1;
+/** @brief Set in `compact_header_t::flags`, unless all the edge IDs are default. */
+constexpr ustore_vertex_degree_t compact_with_edges_k = 1;
+
+/**
+ * @brief Leading part of the compact entries, followed by two streams of varints:
+ * first for the outgoing neighborships, then for the incoming. In every stream the
+ * first neighbor ID is ZigZag-encoded and the following ones are deltas from the
+ * previous. Edge IDs follow their neighbors, delta-encoded within the same neighbor.
+ */
+struct compact_header_t {
+    ustore_vertex_degree_t marker;
+    ustore_vertex_degree_t degrees[2];
+    ustore_vertex_degree_t bytes_outgoing;
+    ustore_vertex_degree_t flags;
+};
+
+inline bool is_compact(value_view_t bytes) noexcept {
+    return bytes.size() >= sizeof(compact_header_t) &&
+           *reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin()) == compact_marker_k;
+}
+
+inline compact_header_t const& compact_header(value_view_t bytes) noexcept {
+    return *reinterpret_cast<compact_header_t const*>(bytes.begin());
+}
+
+/** @brief Leading bytes of any entry, enough to determine the degrees of the vertex. */
+constexpr std::size_t bytes_in_any_header_k = std::max(sizeof(hub_header_t), sizeof(compact_header_t));
+
+inline std::uint8_t* write_varint(std::uint8_t* output, std::uint64_t value) noexcept {
+    for (; value >= 0x80; value >>= 7)
+        *output++ = static_cast<std::uint8_t>(value | 0x80);
+    *output++ = static_cast<std::uint8_t>(value);
+    return output;
+}
+
+inline std::uint8_t const* read_varint(std::uint8_t const* input, std::uint64_t& value) noexcept {
+    value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        std::uint8_t next = *input++;
+        value |= std::uint64_t(next & 0x7F) << shift;
+        if (!(next & 0x80))
+            return input;
+    }
+}
+
+inline std::uint64_t zigzag(ustore_key_t value) noexcept {
+    return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+}
+
+inline ustore_key_t unzigzag(std::uint64_t value) noexcept {
+    return ustore_key_t(value >> 1) ^ -ustore_key_t(value & 1);
+}
+
+/**
+ * @brief Lazily decodes neighborships from a varint stream of a compact entry.
+ */
+class compact_neighbors_iterator_t {
+    std::uint8_t const* input_ = nullptr;
+    std::size_t remaining_ = 0;
+    bool with_edges_ = false;
+    neighborship_t current_ {};
+
+    void decode(bool first) noexcept {
+        std::uint64_t neighbor_delta, edge;
+        input_ = read_varint(input_, neighbor_delta);
+        if (first)
+            current_.neighbor_id = unzigzag(neighbor_delta);
+        else
+            current_.neighbor_id = ustore_key_t(std::uint64_t(current_.neighbor_id) + neighbor_delta);
+        if (!with_edges_) {
+            current_.edge_id = ustore_default_edge_id_k;
+            return;
+        }
+        input_ = read_varint(input_, edge);
+        if (first || neighbor_delta)
+            current_.edge_id = unzigzag(edge);
+        else
+            current_.edge_id = ustore_key_t(std::uint64_t(current_.edge_id) + edge);
+    }
+
+  public:
+    compact_neighbors_iterator_t() noexcept = default;
+    compact_neighbors_iterator_t(std::uint8_t const* input, std::size_t count, bool with_edges) noexcept
+        : input_(input), remaining_(count), with_edges_(with_edges) {
+        if (remaining_)
+            decode(true);
+    }
+
+    neighborship_t operator*() const noexcept { return current_; }
+    compact_neighbors_iterator_t& operator++() noexcept {
+        if (--remaining_)
+            decode(false);
+        return *this;
+    }
+    bool operator==(compact_neighbors_iterator_t const& other) const noexcept {
+        return remaining_ == other.remaining_;
+    }
+    bool operator!=(compact_neighbors_iterator_t const& other) const noexcept {
+        return remaining_ != other.remaining_;
+    }
+};
+
+struct compact_neighbors_t {
+    compact_neighbors_iterator_t begin_;
+    std::size_t size_ = 0;
+
+    compact_neighbors_iterator_t begin() const noexcept { return begin_; }
+    compact_neighbors_iterator_t end() const noexcept { return {}; }
+    std::size_t size() const noexcept { return size_; }
+};
+
+/**
+ * @brief Neighborships of a compact entry with a specific role.
+ * Unlike `neighbors()`, can't be used for `ustore_vertex_role_any_k`.
+ */
+compact_neighbors_t compact_neighbors(value_view_t bytes, ustore_vertex_role_t role) noexcept {
+    compact_header_t const& header = compact_header(bytes);
+    bool with_edges = header.flags & compact_with_edges_k;
+    auto streams = reinterpret_cast<std::uint8_t const*>(bytes.begin()) + sizeof(compact_header_t);
+    switch (role) {
+    case ustore_vertex_source_k: return {{streams, header.degrees[0], with_edges}, header.degrees[0]};
+    case ustore_vertex_target_k:
+        return {{streams + header.bytes_outgoing, header.degrees[1], with_edges}, header.degrees[1]};
+    default: return {};
+    }
+}
+
+/**
+ * @brief Encodes sorted neighborships into a varint stream.
+ * @return The end of the written stream.
+ */
+std::uint8_t* compact_encode(neighborship_t const* ships,
+                             std::size_t count,
+                             bool with_edges,
+                             std::uint8_t* output) noexcept {
+    for (std::size_t i = 0; i != count; ++i) {
+        bool first = i == 0;
+        std::uint64_t neighbor_delta =
+            first ? zigzag(ships[i].neighbor_id)
+                  : std::uint64_t(ships[i].neighbor_id) - std::uint64_t(ships[i - 1].neighbor_id);
+        output = write_varint(output, neighbor_delta);
+        if (!with_edges)
+            continue;
+        if (first || neighbor_delta)
+            output = write_varint(output, zigzag(ships[i].edge_id));
+        else
+            output = write_varint(output, std::uint64_t(ships[i].edge_id) - std::uint64_t(ships[i - 1].edge_id));
+    }
+    return output;
+}
+
 struct updated_entry_t : public collection_key_t {
     ustore_bytes_ptr_t content = nullptr;
     ustore_length_t length = ustore_length_missing_k;
     ustore_vertex_degree_t degree_delta = 0;
+    /** @brief Was pulled in the compact form, so it's written back compacted. */
+    bool compact = false;
     inline operator value_view_t() const noexcept { return {content, length}; }
 };
 
@@ -55,14 +302,431 @@ ptr_range_gt<neighborship_t const> neighbors( //
 }
 
 ptr_range_gt<neighborship_t const> neighbors(value_view_t bytes, ustore_vertex_role_t role = ustore_vertex_role_any_k) {
-    // Handle missing vertices
-    if (bytes.size() < bytes_in_degrees_header_k)
+    // Handle missing vertices, compact entries, which have to be decoded,
+    // and hubs, which have to be traversed chunk-by-chunk
+    if (bytes.size() < bytes_in_degrees_header_k || is_hub(bytes) || is_compact(bytes))
         return {};
 
     auto degrees = reinterpret_cast<ustore_vertex_degree_t const*>(bytes.begin());
     return neighbors(degrees, reinterpret_cast<ustore_key_t const*>(degrees + 2), role);
 }
 
+/**
+ * @brief Number of neighborships of a regular vertex, a compact one or a hub.
+ */
+ustore_vertex_degree_t degree(value_view_t bytes, ustore_vertex_role_t role = ustore_vertex_role_any_k) {
+    ustore_vertex_degree_t const* degrees = nullptr;
+    if (is_hub(bytes))
+        degrees = hub_header(bytes).degrees;
+    else if (is_compact(bytes))
+        degrees = compact_header(bytes).degrees;
+    else
+        return static_cast<ustore_vertex_degree_t>(neighbors(bytes, role).size());
+    switch (role) {
+    case ustore_vertex_source_k: return degrees[0];
+    case ustore_vertex_target_k: return degrees[1];
+    case ustore_vertex_role_any_k: return degrees[0] + degrees[1];
+    case ustore_vertex_role_unknown_k: return 0;
+    }
+    __builtin_unreachable();
+}
+
+/**
+ * @brief Decodes a compact entry into the regular layout, so it can be updated in-place.
+ */
+void decompact_entry(updated_entry_t& entry, linked_memory_lock_t& arena, ustore_error_t* c_error) {
+    ustore_vertex_degree_t degrees[2] = {degree(entry, ustore_vertex_source_k), degree(entry, ustore_vertex_target_k)};
+    std::size_t length = bytes_in_degrees_header_k + (degrees[0] + degrees[1]) * sizeof(neighborship_t);
+    auto content = arena.alloc<std::uint8_t>(length, c_error);
+    return_if_error_m(c_error);
+
+    std::memcpy(content.begin(), degrees, bytes_in_degrees_header_k);
+    auto ships = reinterpret_cast<neighborship_t*>(content.begin() + bytes_in_degrees_header_k);
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k})
+        for (neighborship_t ship : compact_neighbors(entry, role))
+            *ships++ = ship;
+
+    entry.content = content.begin();
+    entry.length = static_cast<ustore_length_t>(length);
+    entry.compact = true;
+}
+
+/**
+ * @brief Encodes a regular entry into the compact layout, omitting the edge IDs if all are default.
+ */
+void compact_entry(updated_entry_t& entry, linked_memory_lock_t& arena, ustore_error_t* c_error) {
+    auto ships = neighbors(entry);
+    bool with_edges = std::any_of(ships.begin(), ships.end(), [](neighborship_t ship) {
+        return ship.edge_id != ustore_default_edge_id_k;
+    });
+    std::size_t max_bytes_per_ship = (with_edges ? 2 : 1) * 10;
+    auto content = arena.alloc<std::uint8_t>(sizeof(compact_header_t) + ships.size() * max_bytes_per_ship, c_error);
+    return_if_error_m(c_error);
+
+    compact_header_t header;
+    header.marker = compact_marker_k;
+    header.flags = with_edges ? compact_with_edges_k : 0;
+    std::uint8_t* const streams = content.begin() + sizeof(compact_header_t);
+    std::uint8_t* streams_end = streams;
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k}) {
+        auto role_ships = neighbors(entry, role);
+        header.degrees[role_idx(role)] = static_cast<ustore_vertex_degree_t>(role_ships.size());
+        streams_end = compact_encode(role_ships.begin(), role_ships.size(), with_edges, streams_end);
+        if (role == ustore_vertex_source_k)
+            header.bytes_outgoing = static_cast<ustore_vertex_degree_t>(streams_end - streams);
+    }
+    std::memcpy(content.begin(), &header, sizeof(compact_header_t));
+
+    entry.content = content.begin();
+    entry.length = static_cast<ustore_length_t>(streams_end - content.begin());
+}
+
+/**
+ * @brief Compacts the regular entries, that were compact before or are requested to be.
+ * Empty and missing entries, as well as hubs, remain unchanged.
+ */
+void compact_entries(ptr_range_gt<updated_entry_t> entries,
+                     bool compact,
+                     linked_memory_lock_t& arena,
+                     ustore_error_t* c_error) {
+    for (updated_entry_t& entry : entries) {
+        if (!(compact || entry.compact) || entry.length == ustore_length_missing_k ||
+            entry.length < bytes_in_degrees_header_k || is_hub(entry) || neighbors(entry).empty())
+            continue;
+        compact_entry(entry, arena, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Graph-specific options are consumed here and not forwarded to the engine.
+ */
+inline ustore_options_t engine_options(ustore_options_t options) noexcept {
+    return ustore_options_t(options & ~(ustore_option_graph_compact_k | ustore_option_graph_lazy_k));
+}
+
+/**
+ * @brief Graph collection and its sibling, which holds the chunks of hubs, the tombstones
+ * and the entries of buried vertices, as well as the counter of keys handed out for those.
+ */
+struct sibling_t {
+    ustore_collection_t collection;
+    ustore_collection_t sibling;
+    std::string_view name;
+    bool named;
+    bool exists;
+};
+
+/**
+ * @brief Resolves the siblings of the graph collections addressed by a request. The sibling of the
+ * main collection is named "ustore.graph", and the one of the collection "name" - "ustore.graph.name".
+ * Siblings are created on demand, once the first hub or tombstone appears in a collection.
+ * On engines without named collections there are no siblings: adjacency lists are kept whole,
+ * and vertices are removed eagerly.
+ */
+class siblings_t {
+
+    static constexpr std::string_view prefix_k = "ustore.graph";
+
+    ustore_database_t db_ = nullptr;
+    ptr_range_gt<sibling_t> siblings_;
+
+    static bool is_sibling_name(std::string_view candidate, sibling_t const& sibling) noexcept {
+        std::size_t const separator = sibling.collection != ustore_collection_main_k;
+        return candidate.size() == prefix_k.size() + separator + sibling.name.size() &&
+               candidate.substr(0, prefix_k.size()) == prefix_k &&
+               candidate.substr(prefix_k.size() + separator) == sibling.name &&
+               (!separator || candidate[prefix_k.size()] == '.');
+    }
+
+    sibling_t* find(ustore_collection_t collection) const noexcept {
+        auto it = std::lower_bound(siblings_.begin(),
+                                   siblings_.end(),
+                                   collection,
+                                   [](sibling_t const& s, ustore_collection_t wanted) { return s.collection < wanted; });
+        return it != siblings_.end() && it->collection == collection ? it : nullptr;
+    }
+
+    /**
+     * @brief Finds the names of the graph collections, and their existing siblings.
+     */
+    void lookup(linked_memory_lock_t& arena, ustore_error_t* c_error) {
+        ustore_size_t count = 0;
+        ustore_collection_t* ids = nullptr;
+        ustore_length_t* offsets = nullptr;
+        ustore_char_t* names = nullptr;
+        ustore_collection_list_t list {};
+        list.db = db_;
+        list.error = c_error;
+        list.arena = arena;
+        list.options = ustore_option_dont_discard_memory_k;
+        list.count = &count;
+        list.ids = &ids;
+        list.offsets = &offsets;
+        list.names = &names;
+        ustore_collection_list(&list);
+        return_if_error_m(c_error);
+
+        for (sibling_t& sibling : siblings_) {
+            if (sibling.collection != ustore_collection_main_k) {
+                auto id_it = std::find(ids, ids + count, sibling.collection);
+                if (id_it == ids + count)
+                    continue;
+                sibling.name = names + offsets[id_it - ids];
+            }
+            sibling.named = true;
+            for (std::size_t i = 0; i != count && !sibling.exists; ++i)
+                if (is_sibling_name(names + offsets[i], sibling))
+                    sibling.sibling = ids[i], sibling.exists = true;
+        }
+    }
+
+  public:
+    static bool available() noexcept { return ustore_supports_named_collections_k; }
+
+    void resolve(ustore_database_t const c_db,
+                 ustore_size_t const c_tasks_count,
+                 ustore_collection_t const* c_collections,
+                 ustore_size_t const c_collections_stride,
+                 linked_memory_lock_t& arena,
+                 ustore_error_t* c_error) {
+
+        db_ = c_db;
+        siblings_ = {};
+        if (!available() || !c_tasks_count)
+            return;
+
+        strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
+        std::size_t unique_count = collections && c_collections_stride ? c_tasks_count : 1;
+        auto unique = arena.alloc<sibling_t>(unique_count, c_error);
+        return_if_error_m(c_error);
+        for (std::size_t i = 0; i != unique_count; ++i)
+            unique[i] = sibling_t {collections ? collections[i] : ustore_collection_main_k, 0, {}, false, false};
+        std::sort(unique.begin(), unique.end(), [](sibling_t const& a, sibling_t const& b) {
+            return a.collection < b.collection;
+        });
+        auto unique_end = std::unique(unique.begin(), unique.end(), [](sibling_t const& a, sibling_t const& b) {
+            return a.collection == b.collection;
+        });
+        siblings_ = {unique.begin(), unique_end};
+        lookup(arena, c_error);
+    }
+
+    /** @brief Resolved graph collections, sorted. */
+    ptr_range_gt<sibling_t const> all() const noexcept { return {siblings_.begin(), siblings_.end()}; }
+
+    bool exists(ustore_collection_t collection) const noexcept {
+        sibling_t const* sibling = find(collection);
+        return sibling && sibling->exists;
+    }
+
+    /**
+     * @brief Collection, where the chunks of hubs from the given `collection` are kept.
+     * Siblings map to themselves, as the entries of buried hubs are moved into them.
+     */
+    ustore_collection_t of(ustore_collection_t collection) const noexcept {
+        sibling_t const* sibling = find(collection);
+        return sibling && sibling->exists ? sibling->sibling : collection;
+    }
+
+    /**
+     * @brief Creates the sibling of the `collection`, unless it already exists.
+     */
+    void ensure(ustore_collection_t collection, linked_memory_lock_t& arena, ustore_error_t* c_error) {
+        sibling_t* sibling = find(collection);
+        return_error_if_m(sibling && sibling->named, c_error, args_wrong_k, "Unknown graph collection");
+        if (sibling->exists)
+            return;
+
+        std::size_t const separator = collection != ustore_collection_main_k;
+        auto name = arena.alloc<char>(prefix_k.size() + separator + sibling->name.size() + 1, c_error);
+        return_if_error_m(c_error);
+        char* name_end = std::copy(prefix_k.begin(), prefix_k.end(), name.begin());
+        if (separator)
+            *name_end++ = '.';
+        name_end = std::copy(sibling->name.begin(), sibling->name.end(), name_end);
+        *name_end = '\0';
+
+        ustore_error_t create_error = nullptr;
+        ustore_collection_create_t create {};
+        create.db = db_;
+        create.error = &create_error;
+        create.name = name.begin();
+        create.id = &sibling->sibling;
+        ustore_collection_create(&create);
+        if (!create_error) {
+            sibling->exists = true;
+            return;
+        }
+
+        // Someone else may have created it concurrently
+        lookup(arena, c_error);
+        return_if_error_m(c_error);
+        if (!sibling->exists)
+            *c_error = create_error;
+    }
+};
+
+/**
+ * @brief Vertex removed with `ustore_option_graph_lazy_k`. Its entry is moved under
+ * the `entry_key` of the sibling collection, until the references to it are purged from its neighbors.
+ */
+struct tombstone_t {
+    ustore_key_t vertex_id;
+    ustore_key_t entry_key;
+
+    friend inline bool operator<(tombstone_t const& a, ustore_key_t b) noexcept { return a.vertex_id < b; }
+    friend inline bool operator<(ustore_key_t a, tombstone_t const& b) noexcept { return a < b.vertex_id; }
+};
+
+struct collection_tombstones_t {
+    ustore_collection_t collection;
+    ptr_range_gt<tombstone_t const> tombstones;
+
+    tombstone_t const* find(ustore_key_t vertex_id) const noexcept {
+        auto it = std::lower_bound(tombstones.begin(), tombstones.end(), vertex_id);
+        return it != tombstones.end() && it->vertex_id == vertex_id ? it : nullptr;
+    }
+};
+
+/**
+ * @brief Tombstones of the collections, addressed by a request, sorted by collections.
+ * Reads filter the buried vertices out of the neighborhoods, until those are purged.
+ */
+struct tombstones_t {
+    ptr_range_gt<collection_tombstones_t> collections;
+
+    bool empty() const noexcept {
+        return std::all_of(collections.begin(), collections.end(), [](collection_tombstones_t const& c) {
+            return c.tombstones.empty();
+        });
+    }
+
+    ptr_range_gt<tombstone_t const> in(ustore_collection_t collection) const noexcept {
+        auto it = std::lower_bound(collections.begin(),
+                                   collections.end(),
+                                   collection,
+                                   [](collection_tombstones_t const& c, ustore_collection_t wanted) {
+                                       return c.collection < wanted;
+                                   });
+        return it != collections.end() && it->collection == collection ? it->tombstones
+                                                                       : ptr_range_gt<tombstone_t const> {};
+    }
+};
+
+/**
+ * @brief Pulls the tombstones of every collection resolved in `siblings`.
+ * Within transactions those are watched, so concurrent removals are detected.
+ */
+void read_tombstones( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    siblings_t const& siblings,
+    ustore_options_t const c_options,
+    tombstones_t& tombstones,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    tombstones = {};
+    auto collections = siblings.all();
+    if (collections.empty())
+        return;
+
+    // Collections without siblings have no tombstones
+    auto existing = arena.alloc<ustore_collection_t>(collections.size(), c_error);
+    return_if_error_m(c_error);
+    std::size_t existing_count = 0;
+    for (sibling_t const& sibling : collections)
+        if (sibling.exists)
+            existing[existing_count++] = sibling.sibling;
+
+    joined_blobs_t found;
+    if (existing_count) {
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.transaction = c_transaction;
+        read.snapshot = c_snapshot;
+        read.arena = arena;
+        read.options = c_options;
+        read.tasks_count = existing_count;
+        read.collections = existing.begin();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = &tombstones_key_k;
+        read.keys_stride = 0;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+
+        ustore_read(&read);
+        return_if_error_m(c_error);
+        found = joined_blobs_t {existing_count, found_offsets, found_values};
+    }
+
+    auto exported = arena.alloc<collection_tombstones_t>(collections.size(), c_error);
+    return_if_error_m(c_error);
+    joined_blobs_iterator_t found_it = found.begin();
+    for (std::size_t i = 0; i != collections.size(); ++i) {
+        value_view_t value;
+        if (collections[i].exists)
+            value = *found_it, ++found_it;
+        auto first = reinterpret_cast<tombstone_t const*>(value.begin());
+        exported[i].collection = collections[i].collection;
+        exported[i].tombstones = {first, first + value.size() / sizeof(tombstone_t)};
+    }
+    tombstones.collections = exported;
+}
+
+/**
+ * @brief Prepares the replacement of the tombstones in a sibling collection, removing the empty ones.
+ */
+void write_tombstones(ustore_collection_t sibling,
+                      ptr_range_gt<tombstone_t const> replacement,
+                      uninitialized_array_gt<updated_entry_t>& writes,
+                      ustore_error_t* c_error) {
+    updated_entry_t write;
+    write.collection = sibling;
+    write.key = tombstones_key_k;
+    if (replacement.size()) {
+        write.content = ustore_bytes_ptr_t(replacement.begin());
+        write.length = static_cast<ustore_length_t>(replacement.size_bytes());
+    }
+    writes.push_back(write, c_error);
+}
+
+void write_entries(ustore_database_t const c_db,
+                   ustore_transaction_t const c_transaction,
+                   strided_range_gt<updated_entry_t> updates,
+                   ustore_options_t const c_options,
+                   linked_memory_lock_t& arena,
+                   ustore_error_t* c_error) {
+
+    auto collections = updates.immutable().members(&updated_entry_t::collection);
+    auto keys = updates.immutable().members(&updated_entry_t::key);
+    auto lengths = updates.immutable().members(&updated_entry_t::length);
+    auto contents = updates.immutable().members(&updated_entry_t::content);
+
+    ustore_write_t write {};
+    write.db = c_db;
+    write.error = c_error;
+    write.transaction = c_transaction;
+    write.arena = arena;
+    write.options = c_options;
+    write.tasks_count = updates.size();
+    write.collections = collections.begin().get();
+    write.collections_stride = collections.begin().stride();
+    write.keys = keys.begin().get();
+    write.keys_stride = keys.begin().stride();
+    write.lengths = lengths.begin().get();
+    write.lengths_stride = lengths.begin().stride();
+    write.values = contents.begin().get();
+    write.values_stride = contents.begin().stride();
+
+    ustore_write(&write);
+}
+
 struct neighborhood_t {
     ustore_key_t center = 0;
     ptr_range_gt<neighborship_t const> targets;
@@ -216,6 +880,9 @@ void count_inserts_into_entry( //
     ustore_key_t neighbor_id,
     ustore_key_t edge_id) {
 
+    // Hubs are updated separately, chunk-by-chunk
+    if (is_hub(entry))
+        return;
     auto ship = neighborship_t {neighbor_id, edge_id};
     if (entry.length > bytes_in_degrees_header_k) {
         auto neighbors_range = neighbors(entry, role);
@@ -238,6 +905,8 @@ void insert_into_entry( //
     ustore_key_t neighbor_id,
     ustore_key_t edge_id) {
 
+    if (is_hub(entry))
+        return;
     auto ship = neighborship_t {neighbor_id, edge_id};
     auto degrees = reinterpret_cast<ustore_vertex_degree_t*>(entry.content);
     auto ships = reinterpret_cast<neighborship_t*>(degrees + 2);
@@ -270,7 +939,7 @@ void erase_from_entry(updated_entry_t& entry,
                       ustore_key_t neighbor_id,
                       std::optional<ustore_key_t> edge_id = {}) {
 
-    if (entry.length < bytes_in_degrees_header_k || entry.length == ustore_length_missing_k)
+    if (entry.length < bytes_in_degrees_header_k || entry.length == ustore_length_missing_k || is_hub(entry))
         return;
 
     std::size_t off = 0;
@@ -303,40 +972,692 @@ void erase_from_entry(updated_entry_t& entry,
     entry.length -= sizeof(neighborship_t) * len;
 }
 
-template <bool export_center_ak = true, bool export_neighbor_ak = true, bool export_edge_ak = true>
-void export_edge_tuples( //
-    ustore_database_t const c_db,
-    ustore_transaction_t const c_transaction,
-    ustore_snapshot_t const c_snapshot,
-    ustore_size_t const c_vertices_count,
-
-    ustore_collection_t const* c_collections,
-    ustore_size_t const c_collections_stride,
-
-    ustore_key_t const* c_vertices,
-    ustore_size_t const c_vertices_stride,
+/**
+ * @brief A neighbor to be inserted into a vertex, ordered by its final placement:
+ * outgoing neighborships come before incoming ones.
+ */
+struct role_ship_t {
+    ustore_vertex_role_t role;
+    neighborship_t ship;
 
-    ustore_vertex_role_t const* c_roles,
-    ustore_size_t const c_roles_stride,
+    friend inline bool operator<(role_ship_t const& a, role_ship_t const& b) noexcept {
+        return a.role != b.role ? a.role < b.role : a.ship < b.ship;
+    }
+    friend inline bool operator==(role_ship_t const& a, role_ship_t const& b) noexcept {
+        return a.role == b.role && a.ship == b.ship;
+    }
+};
 
-    ustore_options_t const c_options,
+/**
+ * @brief Merges sorted and deduplicated `insertions` into the neighbors of a regular vertex,
+ * exporting into the `output` buffer, that has enough space for all of them.
+ * Unlike `insert_into_entry`, costs a single pass, regardless of the number of insertions.
+ */
+void merge_into_entry(updated_entry_t& entry, ptr_range_gt<role_ship_t const> insertions, byte_t* output) noexcept {
+
+    bool const present = entry.length != ustore_length_missing_k && entry.length >= bytes_in_degrees_header_k;
+    ustore_vertex_degree_t degrees[2] = {0, 0};
+    auto ships = reinterpret_cast<neighborship_t*>(output + bytes_in_degrees_header_k);
+    auto ships_end = ships;
+    auto insertions_it = insertions.begin();
+    for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k}) {
+        auto existing = present ? neighbors(entry, role) : ptr_range_gt<neighborship_t const> {};
+        auto existing_it = existing.begin();
+        auto insertions_end = std::find_if(insertions_it, insertions.end(), [=](role_ship_t const& insertion) {
+            return insertion.role != role;
+        });
+        auto role_begin = ships_end;
+        while (existing_it != existing.end() && insertions_it != insertions_end) {
+            if (insertions_it->ship < *existing_it)
+                *ships_end++ = (insertions_it++)->ship, ++entry.degree_delta;
+            else if (*existing_it < insertions_it->ship)
+                *ships_end++ = *existing_it++;
+            else
+                *ships_end++ = *existing_it++, ++insertions_it;
+        }
+        ships_end = std::copy(existing_it, existing.end(), ships_end);
+        for (; insertions_it != insertions_end; ++insertions_it, ++entry.degree_delta)
+            *ships_end++ = insertions_it->ship;
+        degrees[role == ustore_vertex_target_k] = static_cast<ustore_vertex_degree_t>(ships_end - role_begin);
+    }
 
-    ustore_vertex_degree_t** c_degrees_per_vertex,
-    ustore_key_t** c_neighborships_per_vertex,
+    std::memcpy(output, degrees, bytes_in_degrees_header_k);
+    entry.content = reinterpret_cast<ustore_bytes_ptr_t>(output);
+    entry.length = static_cast<ustore_length_t>(bytes_in_degrees_header_k + (ships_end - ships) * sizeof(neighborship_t));
+}
 
+/**
+ * @brief Groups the insertions by vertex with a counting sort, and merges them into
+ * neighborhoods of different vertices on different threads. Hubs are skipped.
+ * The `for_each_task` must call its argument with every updated entry, role, neighbor and edge.
+ */
+template <typename for_each_task_at>
+void merge_into_entries( //
+    ptr_range_gt<updated_entry_t> entries,
+    for_each_task_at&& for_each_task,
+    std::size_t threads_count,
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) {
 
-    // Even if we need just the node degrees, we can't limit ourselves to just entry lengths.
-    // Those may be compressed. We need to read the first bytes to parse the degree of the node.
-    ustore_bytes_ptr_t c_found_values {};
-    ustore_length_t* c_found_offsets {};
-    ustore_read_t read {};
-    read.db = c_db;
-    read.error = c_error;
-    read.transaction = c_transaction;
-    read.snapshot = c_snapshot;
-    read.arena = arena;
+    std::size_t const count = entries.size();
+    auto insertions_offsets = arena.alloc<std::size_t>(count + 1, c_error);
+    return_if_error_m(c_error);
+    std::fill(insertions_offsets.begin(), insertions_offsets.end(), 0);
+    for_each_task([&](updated_entry_t& entry, ustore_vertex_role_t, ustore_key_t, ustore_key_t) {
+        if (!is_hub(entry))
+            ++insertions_offsets[&entry - entries.begin() + 1];
+    });
+    std::partial_sum(insertions_offsets.begin(), insertions_offsets.end(), insertions_offsets.begin());
+
+    auto insertions = arena.alloc<role_ship_t>(insertions_offsets[count], c_error);
+    return_if_error_m(c_error);
+    auto insertions_fill = arena.alloc<std::size_t>(count, c_error);
+    return_if_error_m(c_error);
+    std::copy(insertions_offsets.begin(), insertions_offsets.end() - 1, insertions_fill.begin());
+    for_each_task([&](updated_entry_t& entry, ustore_vertex_role_t role, ustore_key_t neighbor_id, ustore_key_t edge_id) {
+        if (!is_hub(entry))
+            insertions[insertions_fill[&entry - entries.begin()]++] = {role, neighbor_id, edge_id};
+    });
+
+    // Every vertex gets a new buffer, big enough to fit all of the insertions
+    auto outputs_offsets = arena.alloc<std::size_t>(count + 1, c_error);
+    return_if_error_m(c_error);
+    outputs_offsets[0] = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        auto const& entry = entries[i];
+        std::size_t const count_insertions = insertions_offsets[i + 1] - insertions_offsets[i];
+        bool const present = entry.length != ustore_length_missing_k && entry.length >= bytes_in_degrees_header_k;
+        std::size_t const bytes_present = present ? entry.length - bytes_in_degrees_header_k : 0;
+        outputs_offsets[i + 1] = outputs_offsets[i] + (count_insertions ? bytes_in_degrees_header_k + bytes_present +
+                                                                              count_insertions * sizeof(neighborship_t)
+                                                                        : 0);
+    }
+    auto outputs = arena.alloc<byte_t>(outputs_offsets[count], c_error);
+    return_if_error_m(c_error);
+
+    safe_section("Merging neighborhoods", c_error, [&] {
+        parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i != end; ++i) {
+                auto entry_insertions_begin = insertions.begin() + insertions_offsets[i];
+                auto entry_insertions_end = insertions.begin() + insertions_offsets[i + 1];
+                if (entry_insertions_begin == entry_insertions_end)
+                    continue;
+                std::sort(entry_insertions_begin, entry_insertions_end);
+                entry_insertions_end = std::unique(entry_insertions_begin, entry_insertions_end);
+                merge_into_entry(entries[i],
+                                 {entry_insertions_begin, entry_insertions_end},
+                                 outputs.begin() + outputs_offsets[i]);
+            }
+        });
+    });
+}
+
+/**
+ * @brief Accumulates the updates of hubs to apply them chunk-by-chunk:
+ * pulling only the affected chunks, splitting the overflowing ones,
+ * and rewriting the directories of the updated hubs.
+ * All the produced writes are exported via `merge()`, to be applied together
+ * with the updates of regular vertices. Until then the chunks are addressed
+ * by the graph collections, which are replaced with their siblings on IO.
+ */
+class hubs_update_t {
+
+    static constexpr std::size_t missing_k = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Inserts the `low` neighborship, or erases all in the `[low, high]` range.
+     */
+    struct task_t {
+        std::size_t entry_idx;
+        std::size_t role_idx;
+        neighborship_t low;
+        neighborship_t high;
+        bool erase;
+    };
+
+    /** @brief Affected chunk of a hub, or a new one, if the `key` is unknown. */
+    struct edit_t {
+        std::size_t entry_idx;
+        std::size_t role_idx;
+        std::size_t ref_idx;
+        ustore_key_t key;
+        neighborship_t* ships;
+        std::size_t size;
+        std::size_t inserts;
+        bool changed;
+    };
+
+    /** @brief Chunk of a rebuilt hub, that may be pending a newly allocated key. */
+    struct piece_t {
+        chunk_ref_t ref;
+        std::size_t write_idx;
+    };
+
+    struct rebuild_t {
+        std::size_t entry_idx;
+        std::size_t pieces_begin;
+        std::size_t pieces_counts[2];
+    };
+
+    siblings_t& siblings_;
+    linked_memory_lock_t& arena_;
+    uninitialized_array_gt<task_t> tasks_;
+    uninitialized_array_gt<edit_t> edits_;
+    uninitialized_array_gt<piece_t> pieces_;
+    uninitialized_array_gt<rebuild_t> rebuilds_;
+    uninitialized_array_gt<updated_entry_t> writes_;
+
+    static bool same_group(task_t const& a, task_t const& b) noexcept {
+        return a.entry_idx == b.entry_idx && a.role_idx == b.role_idx;
+    }
+
+    static ustore_vertex_role_t role_of(std::size_t role_idx) noexcept {
+        return role_idx ? ustore_vertex_target_k : ustore_vertex_source_k;
+    }
+
+    void remove_chunk(ustore_collection_t collection, ustore_key_t key, ustore_error_t* c_error) {
+        updated_entry_t write;
+        write.collection = collection;
+        write.key = key;
+        writes_.push_back(write, c_error);
+    }
+
+    /**
+     * @brief Appends pieces covering the sorted `ships`, splitting them if needed.
+     * The first piece reuses the `key`, if it's known, others will get new keys.
+     * @return Number of appended pieces.
+     */
+    std::size_t emit_pieces( //
+        ustore_collection_t collection,
+        ustore_key_t key,
+        neighborship_t const* ships,
+        std::size_t count,
+        ustore_error_t* c_error) {
+
+        if (!count) {
+            if (key != ustore_key_unknown_k)
+                remove_chunk(collection, key, c_error);
+            return 0;
+        }
+
+        std::size_t pieces = count <= chunk_capacity_k ? 1 : divide_round_up(count, chunk_capacity_k / 2);
+        std::size_t per_piece = divide_round_up(count, pieces);
+        for (std::size_t offset = 0; offset < count; offset += per_piece) {
+            std::size_t length = std::min(per_piece, count - offset);
+            updated_entry_t write;
+            write.collection = collection;
+            write.key = offset ? ustore_key_unknown_k : key;
+            write.content = ustore_bytes_ptr_t(ships + offset);
+            write.length = static_cast<ustore_length_t>(length * sizeof(neighborship_t));
+
+            piece_t piece;
+            piece.ref.first = ships[offset];
+            piece.ref.key = write.key;
+            piece.ref.size = static_cast<ustore_vertex_degree_t>(length);
+            piece.ref.padding = 0;
+            piece.write_idx = writes_.size();
+            writes_.push_back(write, c_error);
+            pieces_.push_back(piece, c_error);
+            if (*c_error)
+                return 0;
+        }
+        return pieces;
+    }
+
+    void pull_chunks( //
+        ustore_database_t const c_db,
+        ustore_transaction_t const c_transaction,
+        ptr_range_gt<updated_entry_t> entries,
+        ustore_options_t const c_options,
+        ustore_error_t* c_error) {
+
+        std::size_t count_pulled = 0;
+        for (edit_t const& edit : edits_)
+            count_pulled += edit.key != ustore_key_unknown_k;
+
+        joined_blobs_t found_chunks;
+        if (count_pulled) {
+            auto collections = arena_.alloc<ustore_collection_t>(count_pulled, c_error);
+            return_if_error_m(c_error);
+            auto keys = arena_.alloc<ustore_key_t>(count_pulled, c_error);
+            return_if_error_m(c_error);
+            std::size_t i = 0;
+            for (edit_t const& edit : edits_)
+                if (edit.key != ustore_key_unknown_k)
+                    collections[i] = siblings_.of(entries[edit.entry_idx].collection), keys[i] = edit.key, ++i;
+
+            ustore_bytes_ptr_t found_values = nullptr;
+            ustore_length_t* found_offsets = nullptr;
+            ustore_read_t read {};
+            read.db = c_db;
+            read.error = c_error;
+            read.transaction = c_transaction;
+            read.arena = arena_;
+            read.options = c_options;
+            read.tasks_count = count_pulled;
+            read.collections = collections.begin();
+            read.collections_stride = sizeof(ustore_collection_t);
+            read.keys = keys.begin();
+            read.keys_stride = sizeof(ustore_key_t);
+            read.offsets = &found_offsets;
+            read.values = &found_values;
+
+            ustore_read(&read);
+            return_if_error_m(c_error);
+            found_chunks = joined_blobs_t {count_pulled, found_offsets, found_values};
+        }
+
+        // Copy into buffers large enough to fit the insertions
+        joined_blobs_iterator_t found_it = found_chunks.begin();
+        for (edit_t& edit : edits_) {
+            value_view_t found;
+            if (edit.key != ustore_key_unknown_k)
+                found = *found_it, ++found_it;
+            edit.size = found.size() / sizeof(neighborship_t);
+            edit.ships = arena_.alloc<neighborship_t>(edit.size + edit.inserts, c_error).begin();
+            return_if_error_m(c_error);
+            if (edit.size)
+                std::memcpy(edit.ships, found.begin(), edit.size * sizeof(neighborship_t));
+        }
+    }
+
+    /**
+     * @brief Assigns keys to new chunks, advancing the counters in the affected collections.
+     */
+    void allocate_keys( //
+        ustore_database_t const c_db,
+        ustore_transaction_t const c_transaction,
+        ustore_options_t const c_options,
+        ustore_error_t* c_error) {
+
+        uninitialized_array_gt<ustore_collection_t> collections(arena_);
+        for (updated_entry_t const& write : writes_)
+            if (write.key == ustore_key_unknown_k &&
+                std::find(collections.begin(), collections.end(), write.collection) == collections.end()) {
+                collections.push_back(write.collection, c_error);
+                return_if_error_m(c_error);
+            }
+        if (!collections.size())
+            return;
+
+        auto counters_keys = arena_.alloc<ustore_key_t>(collections.size(), c_error);
+        return_if_error_m(c_error);
+        std::fill(counters_keys.begin(), counters_keys.end(), chunks_counter_key_k);
+        auto counters_collections = arena_.alloc<ustore_collection_t>(collections.size(), c_error);
+        return_if_error_m(c_error);
+        for (std::size_t i = 0; i != collections.size(); ++i)
+            counters_collections[i] = siblings_.of(collections[i]);
+
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_read_t read {};
+        read.db = c_db;
+        read.error = c_error;
+        read.transaction = c_transaction;
+        read.arena = arena_;
+        read.options = c_options;
+        read.tasks_count = collections.size();
+        read.collections = counters_collections.begin();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = counters_keys.begin();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+
+        ustore_read(&read);
+        return_if_error_m(c_error);
+
+        auto counters = arena_.alloc<ustore_key_t>(collections.size(), c_error);
+        return_if_error_m(c_error);
+        joined_blobs_t found_counters {collections.size(), found_offsets, found_values};
+        for (std::size_t i = 0; i != collections.size(); ++i) {
+            value_view_t found = found_counters[i];
+            counters[i] = 0;
+            if (found.size() == sizeof(ustore_key_t))
+                std::memcpy(&counters[i], found.begin(), sizeof(ustore_key_t));
+        }
+
+        for (updated_entry_t& write : writes_) {
+            if (write.key != ustore_key_unknown_k)
+                continue;
+            auto counter_idx = std::find(collections.begin(), collections.end(), write.collection) - collections.begin();
+            write.key = counters[counter_idx]++;
+            return_error_if_m(write.key < tombstones_key_k, c_error, error_unknown_k, "Out of chunk keys");
+        }
+        for (piece_t& piece : pieces_)
+            if (piece.write_idx != missing_k)
+                piece.ref.key = writes_[piece.write_idx].key;
+
+        for (std::size_t i = 0; i != collections.size(); ++i) {
+            updated_entry_t write;
+            write.collection = collections[i];
+            write.key = chunks_counter_key_k;
+            write.content = ustore_bytes_ptr_t(&counters[i]);
+            write.length = sizeof(ustore_key_t);
+            writes_.push_back(write, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+  public:
+    hubs_update_t(siblings_t& siblings, linked_memory_lock_t& arena) noexcept
+        : siblings_(siblings), arena_(arena), tasks_(arena), edits_(arena), pieces_(arena), rebuilds_(arena),
+          writes_(arena) {}
+
+    void insert(std::size_t entry_idx, ustore_vertex_role_t role, neighborship_t ship, ustore_error_t* c_error) {
+        tasks_.push_back({entry_idx, role_idx(role), ship, ship, false}, c_error);
+    }
+
+    void erase(std::size_t entry_idx,
+               ustore_vertex_role_t role,
+               neighborship_t low,
+               neighborship_t high,
+               ustore_error_t* c_error) {
+        tasks_.push_back({entry_idx, role_idx(role), low, high, true}, c_error);
+    }
+
+    /**
+     * @brief Schedules the removal of all the chunks of a hub, which is being removed.
+     * Must be called before the content of the `entry` is discarded.
+     */
+    void drop(updated_entry_t const& entry, ustore_error_t* c_error) {
+        if (!is_hub(entry))
+            return;
+        for (chunk_ref_t const& ref : hub_chunks(entry)) {
+            remove_chunk(entry.collection, ref.key, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+
+    /**
+     * @brief Converts a grown regular vertex into a hub, if its chunks can be placed into a sibling.
+     * Its neighborships must remain valid until the `merge()`.
+     */
+    void promote(std::size_t entry_idx, updated_entry_t const& entry, ustore_error_t* c_error) {
+        if (!siblings_.available())
+            return;
+        rebuild_t rebuild;
+        rebuild.entry_idx = entry_idx;
+        rebuild.pieces_begin = pieces_.size();
+        for (std::size_t role_idx = 0; role_idx != 2; ++role_idx) {
+            auto ships = neighbors(entry, role_of(role_idx));
+            rebuild.pieces_counts[role_idx] =
+                emit_pieces(entry.collection, ustore_key_unknown_k, ships.begin(), ships.size(), c_error);
+            return_if_error_m(c_error);
+        }
+        rebuilds_.push_back(rebuild, c_error);
+    }
+
+    /**
+     * @brief Applies the planned insertions and removals to the chunks of hubs
+     * and rewrites the directories in `entries`.
+     */
+    void apply( //
+        ustore_database_t const c_db,
+        ustore_transaction_t const c_transaction,
+        ptr_range_gt<updated_entry_t> entries,
+        ustore_options_t const c_options,
+        ustore_error_t* c_error) {
+
+        // Similar to regular vertices, the chunks are watched within transactions
+        auto opts = c_transaction ? ustore_options_t(c_options & ~ustore_option_transaction_dont_watch_k) : c_options;
+
+        // Entries may have been removed after the tasks were planned
+        auto tasks_end = std::remove_if(tasks_.begin(), tasks_.end(), [&](task_t const& task) {
+            return !is_hub(entries[task.entry_idx]);
+        });
+        std::sort(tasks_.begin(), tasks_end, [](task_t const& a, task_t const& b) {
+            if (a.entry_idx != b.entry_idx)
+                return a.entry_idx < b.entry_idx;
+            if (a.role_idx != b.role_idx)
+                return a.role_idx < b.role_idx;
+            return a.low < b.low;
+        });
+        ptr_range_gt<task_t> tasks {tasks_.begin(), tasks_end};
+
+        // 1. Locate the affected chunks, keeping them sorted alongside the tasks
+        for (std::size_t group_begin = 0, group_end = 0; group_begin != tasks.size(); group_begin = group_end) {
+            task_t const& head = tasks[group_begin];
+            group_end = group_begin + 1;
+            while (group_end != tasks.size() && same_group(head, tasks[group_end]))
+                ++group_end;
+
+            updated_entry_t const& entry = entries[head.entry_idx];
+            auto refs = hub_chunks(entry, role_of(head.role_idx));
+            std::size_t const edits_begin = edits_.size();
+            std::size_t next_ref = 0;
+            for (std::size_t i = group_begin; i != group_end; ++i) {
+                task_t const& task = tasks[i];
+                if (refs.empty()) {
+                    if (task.erase)
+                        continue;
+                    if (edits_.size() == edits_begin) {
+                        edits_.push_back({head.entry_idx, head.role_idx, 0, ustore_key_unknown_k}, c_error);
+                        return_if_error_m(c_error);
+                    }
+                    ++edits_[edits_begin].inserts;
+                    continue;
+                }
+
+                std::size_t first_ref = chunk_for(refs, task.low);
+                std::size_t last_ref = task.erase ? chunk_for(refs, task.high) : first_ref;
+                for (std::size_t ref_idx = std::max(first_ref, next_ref); ref_idx <= last_ref; ++ref_idx) {
+                    edits_.push_back({head.entry_idx, head.role_idx, ref_idx, refs[ref_idx].key}, c_error);
+                    return_if_error_m(c_error);
+                }
+                next_ref = std::max(next_ref, last_ref + 1);
+                if (!task.erase)
+                    std::lower_bound(edits_.begin() + edits_begin, edits_.end(), first_ref, [](edit_t const& edit, std::size_t ref_idx) {
+                        return edit.ref_idx < ref_idx;
+                    })->inserts++;
+            }
+        }
+        if (!edits_.size() && !rebuilds_.size() && !writes_.size())
+            return;
+
+        // Promoted vertices may be the first hubs in their collections
+        for (rebuild_t const& rebuild : rebuilds_) {
+            siblings_.ensure(entries[rebuild.entry_idx].collection, arena_, c_error);
+            return_if_error_m(c_error);
+        }
+
+        // 2. Pull the affected chunks
+        pull_chunks(c_db, c_transaction, entries, opts, c_error);
+        return_if_error_m(c_error);
+
+        // 3. Update the chunks in memory
+        for (std::size_t group_begin = 0, group_end = 0, edits_begin = 0; group_begin != tasks.size();
+             group_begin = group_end) {
+            task_t const& head = tasks[group_begin];
+            group_end = group_begin + 1;
+            while (group_end != tasks.size() && same_group(head, tasks[group_end]))
+                ++group_end;
+
+            std::size_t edits_end = edits_begin;
+            while (edits_end != edits_.size() && edits_[edits_end].entry_idx == head.entry_idx &&
+                   edits_[edits_end].role_idx == head.role_idx)
+                ++edits_end;
+            ptr_range_gt<edit_t> edits {edits_.begin() + edits_begin, edits_.begin() + edits_end};
+            edits_begin = edits_end;
+            if (edits.empty())
+                continue;
+
+            auto refs = hub_chunks(entries[head.entry_idx], role_of(head.role_idx));
+            auto edit_for = [&](std::size_t ref_idx) {
+                return std::lower_bound(edits.begin(), edits.end(), ref_idx, [](edit_t const& edit, std::size_t i) {
+                    return edit.ref_idx < i;
+                });
+            };
+            for (std::size_t i = group_begin; i != group_end; ++i) {
+                task_t const& task = tasks[i];
+                if (refs.empty()) {
+                    if (task.erase)
+                        continue;
+                    edit_t& edit = edits[0];
+                    auto it = std::lower_bound(edit.ships, edit.ships + edit.size, task.low);
+                    if (it != edit.ships + edit.size && *it == task.low)
+                        continue;
+                    edit.size = trivial_insert(edit.ships, edit.size, it - edit.ships, &task.low, &task.low + 1);
+                    edit.changed = true;
+                    continue;
+                }
+
+                std::size_t first_ref = chunk_for(refs, task.low);
+                if (!task.erase) {
+                    edit_t& edit = *edit_for(first_ref);
+                    auto it = std::lower_bound(edit.ships, edit.ships + edit.size, task.low);
+                    if (it != edit.ships + edit.size && *it == task.low)
+                        continue;
+                    edit.size = trivial_insert(edit.ships, edit.size, it - edit.ships, &task.low, &task.low + 1);
+                    edit.changed = true;
+                    continue;
+                }
+
+                std::size_t last_ref = chunk_for(refs, task.high);
+                for (auto edit_it = edit_for(first_ref); edit_it != edits.end() && edit_it->ref_idx <= last_ref;
+                     ++edit_it) {
+                    edit_t& edit = *edit_it;
+                    auto begin = std::lower_bound(edit.ships, edit.ships + edit.size, task.low);
+                    auto end = std::upper_bound(begin, edit.ships + edit.size, task.high);
+                    if (begin == end)
+                        continue;
+                    edit.size = trivial_erase(edit.ships, edit.size, begin - edit.ships, end - begin);
+                    edit.changed = true;
+                }
+            }
+        }
+
+        // 4. Replace the changed chunks with their updated pieces
+        for (std::size_t edits_begin = 0, edits_end = 0; edits_begin != edits_.size(); edits_begin = edits_end) {
+            std::size_t const entry_idx = edits_[edits_begin].entry_idx;
+            edits_end = edits_begin;
+            while (edits_end != edits_.size() && edits_[edits_end].entry_idx == entry_idx)
+                ++edits_end;
+
+            updated_entry_t const& entry = entries[entry_idx];
+            rebuild_t rebuild;
+            rebuild.entry_idx = entry_idx;
+            rebuild.pieces_begin = pieces_.size();
+            std::size_t edit_idx = edits_begin;
+            for (std::size_t role_idx = 0; role_idx != 2; ++role_idx) {
+                auto refs = hub_chunks(entry, role_of(role_idx));
+                std::size_t pieces_count = 0;
+                for (std::size_t ref_idx = 0; ref_idx < std::max<std::size_t>(refs.size(), 1); ++ref_idx) {
+                    bool const edited = edit_idx != edits_end && edits_[edit_idx].role_idx == role_idx &&
+                                        edits_[edit_idx].ref_idx == ref_idx;
+                    if (edited) {
+                        edit_t const& edit = edits_[edit_idx++];
+                        if (edit.changed) {
+                            pieces_count += emit_pieces(entry.collection, edit.key, edit.ships, edit.size, c_error);
+                            return_if_error_m(c_error);
+                            continue;
+                        }
+                    }
+                    if (ref_idx == refs.size())
+                        continue;
+                    pieces_.push_back({refs[ref_idx], missing_k}, c_error);
+                    return_if_error_m(c_error);
+                    ++pieces_count;
+                }
+                rebuild.pieces_counts[role_idx] = pieces_count;
+            }
+            rebuilds_.push_back(rebuild, c_error);
+            return_if_error_m(c_error);
+        }
+
+        // 5. Assign keys to new chunks
+        allocate_keys(c_db, c_transaction, opts, c_error);
+        return_if_error_m(c_error);
+
+        // 6. Rewrite the directories
+        for (rebuild_t const& rebuild : rebuilds_) {
+            std::size_t const pieces_count = rebuild.pieces_counts[0] + rebuild.pieces_counts[1];
+            std::size_t const length = sizeof(hub_header_t) + pieces_count * sizeof(chunk_ref_t);
+            byte_t* content = arena_.alloc<byte_t>(length, c_error).begin();
+            return_if_error_m(c_error);
+
+            hub_header_t header;
+            header.marker = hub_marker_k;
+            header.padding = 0;
+            auto refs = reinterpret_cast<chunk_ref_t*>(content + sizeof(hub_header_t));
+            piece_t const* pieces = pieces_.begin() + rebuild.pieces_begin;
+            for (std::size_t role_idx = 0; role_idx != 2; ++role_idx) {
+                header.chunks[role_idx] = static_cast<ustore_vertex_degree_t>(rebuild.pieces_counts[role_idx]);
+                header.degrees[role_idx] = 0;
+                for (std::size_t i = 0; i != rebuild.pieces_counts[role_idx]; ++i, ++pieces, ++refs) {
+                    *refs = pieces->ref;
+                    header.degrees[role_idx] += pieces->ref.size;
+                }
+            }
+            std::memcpy(content, &header, sizeof(hub_header_t));
+
+            updated_entry_t& entry = entries[rebuild.entry_idx];
+            entry.content = ustore_bytes_ptr_t(content);
+            entry.length = static_cast<ustore_length_t>(length);
+            entry.degree_delta += 1;
+        }
+    }
+
+    /**
+     * @brief Concatenates the updated `entries` with the planned chunk updates.
+     */
+    ptr_range_gt<updated_entry_t> merge(ptr_range_gt<updated_entry_t> entries, ustore_error_t* c_error) {
+        if (!writes_.size())
+            return entries;
+        for (updated_entry_t& write : writes_)
+            write.collection = siblings_.of(write.collection);
+        auto merged = arena_.alloc<updated_entry_t>(entries.size() + writes_.size(), c_error);
+        if (*c_error)
+            return {};
+        std::memcpy(merged.begin(), entries.begin(), entries.size() * sizeof(updated_entry_t));
+        std::memcpy(merged.begin() + entries.size(), writes_.begin(), writes_.size() * sizeof(updated_entry_t));
+        return merged;
+    }
+};
+
+/**
+ * @param siblings Locate the chunks of hubs.
+ * @param tombstones Filters out the buried neighbors.
+ * NULL only while the entries of buried vertices are being purged.
+ */
+template <bool export_center_ak = true, bool export_neighbor_ak = true, bool export_edge_ak = true>
+void export_edge_tuples( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_snapshot_t const c_snapshot,
+    ustore_size_t const c_vertices_count,
+
+    ustore_collection_t const* c_collections,
+    ustore_size_t const c_collections_stride,
+
+    ustore_key_t const* c_vertices,
+    ustore_size_t const c_vertices_stride,
+
+    ustore_vertex_role_t const* c_roles,
+    ustore_size_t const c_roles_stride,
+
+    ustore_options_t const c_options,
+
+    ustore_vertex_degree_t** c_degrees_per_vertex,
+    ustore_key_t** c_neighborships_per_vertex,
+
+    siblings_t const& siblings,
+    tombstones_t const* tombstones,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    // Even if we need just the node degrees, we can't limit ourselves to just entry lengths.
+    // Those may be compressed. We need to read the first bytes to parse the degree of the node,
+    // but there is no need to pull the rest of the neighborships.
+    constexpr std::size_t tuple_size_k = export_center_ak + export_neighbor_ak + export_edge_ak;
+    ustore_bytes_ptr_t c_found_values {};
+    ustore_length_t* c_found_offsets {};
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.snapshot = c_snapshot;
+    read.arena = arena;
     read.options = c_options;
     read.tasks_count = c_vertices_count;
     read.collections = c_collections;
@@ -345,6 +1666,7 @@ void export_edge_tuples( //
     read.keys_stride = c_vertices_stride;
     read.offsets = &c_found_offsets;
     read.values = &c_found_values;
+    read.values_limit = tuple_size_k == 0 ? bytes_in_any_header_k : 0;
 
     ustore_read(&read);
     return_if_error_m(c_error);
@@ -353,21 +1675,56 @@ void export_edge_tuples( //
     strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
     strided_range_gt<ustore_key_t const> vertices {{c_vertices, c_vertices_stride}, c_vertices_count};
     strided_iterator_gt<ustore_vertex_role_t const> roles {c_roles, c_roles_stride};
-    constexpr std::size_t tuple_size_k = export_center_ak + export_neighbor_ak + export_edge_ak;
 
     find_edges_t find_edges {collections, vertices.begin(), roles, c_vertices_count};
 
     // Estimate the amount of memory we will need for the arena
     std::size_t count_ids = 0;
+    std::size_t count_chunks = 0;
     if constexpr (tuple_size_k != 0) {
         joined_blobs_iterator_t values_it = values.begin();
         for (ustore_size_t i = 0; i != c_vertices_count; ++i, ++values_it) {
             value_view_t value = *values_it;
-            count_ids += neighbors(value, find_edges[i].role).size();
+            count_ids += degree(value, find_edges[i].role);
+            count_chunks += is_hub(value) ? hub_chunks(value, find_edges[i].role).size() : 0;
         }
         count_ids *= tuple_size_k;
     }
 
+    // Hubs keep their neighborships in chunks, which need another round-trip
+    joined_blobs_t chunks;
+    if (count_chunks) {
+        auto chunks_collections = arena.alloc<ustore_collection_t>(count_chunks, c_error);
+        return_if_error_m(c_error);
+        auto chunks_keys = arena.alloc<ustore_key_t>(count_chunks, c_error);
+        return_if_error_m(c_error);
+
+        std::size_t passed_chunks = 0;
+        joined_blobs_iterator_t values_it = values.begin();
+        for (ustore_size_t i = 0; i != c_vertices_count; ++i, ++values_it) {
+            value_view_t value = *values_it;
+            if (!is_hub(value))
+                continue;
+            ustore_collection_t const sibling = siblings.of(find_edges[i].collection);
+            for (chunk_ref_t const& ref : hub_chunks(value, find_edges[i].role))
+                chunks_collections[passed_chunks] = sibling, chunks_keys[passed_chunks] = ref.key, ++passed_chunks;
+        }
+
+        ustore_bytes_ptr_t c_found_chunks {};
+        ustore_length_t* c_found_chunks_offsets {};
+        read.tasks_count = count_chunks;
+        read.collections = chunks_collections.begin();
+        read.collections_stride = sizeof(ustore_collection_t);
+        read.keys = chunks_keys.begin();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &c_found_chunks_offsets;
+        read.values = &c_found_chunks;
+
+        ustore_read(&read);
+        return_if_error_m(c_error);
+        chunks = joined_blobs_t {count_chunks, c_found_chunks_offsets, c_found_chunks};
+    }
+
     // Export into arena
     auto ids = arena.alloc_or_dummy(count_ids, c_error, c_neighborships_per_vertex);
     return_if_error_m(c_error);
@@ -376,6 +1733,7 @@ void export_edge_tuples( //
 
     std::size_t passed_ids = 0;
     joined_blobs_iterator_t values_it = values.begin();
+    joined_blobs_iterator_t chunks_it = chunks.begin();
     for (std::size_t i = 0; i != c_vertices_count; ++i, ++values_it) {
         value_view_t value = *values_it;
         find_edge_t find_edge = find_edges[i];
@@ -386,36 +1744,54 @@ void export_edge_tuples( //
             continue;
         }
 
-        ustore_vertex_degree_t degree = 0;
-        if (find_edge.role & ustore_vertex_source_k) {
-            auto ns = neighbors(value, ustore_vertex_source_k);
-            if constexpr (tuple_size_k != 0)
+        degrees[i] = degree(value, find_edge.role);
+        if constexpr (tuple_size_k != 0) {
+            std::size_t const vertex_ids_begin = passed_ids;
+            auto buried = tombstones ? tombstones->in(find_edge.collection) : ptr_range_gt<tombstone_t const> {};
+            auto export_ships = [&](auto const& ns, ustore_vertex_role_t role) {
                 for (neighborship_t n : ns) {
-                    if constexpr (export_center_ak)
-                        ids[passed_ids + 0] = find_edge.vertex_id;
-                    if constexpr (export_neighbor_ak)
-                        ids[passed_ids + export_center_ak] = n.neighbor_id;
+                    if (buried && std::binary_search(buried.begin(), buried.end(), n.neighbor_id))
+                        continue;
+                    if (role == ustore_vertex_source_k) {
+                        if constexpr (export_center_ak)
+                            ids[passed_ids + 0] = find_edge.vertex_id;
+                        if constexpr (export_neighbor_ak)
+                            ids[passed_ids + export_center_ak] = n.neighbor_id;
+                    }
+                    else {
+                        if constexpr (export_neighbor_ak)
+                            ids[passed_ids + 0] = n.neighbor_id;
+                        if constexpr (export_center_ak)
+                            ids[passed_ids + export_neighbor_ak] = find_edge.vertex_id;
+                    }
                     if constexpr (export_edge_ak)
                         ids[passed_ids + export_center_ak + export_neighbor_ak] = n.edge_id;
                     passed_ids += tuple_size_k;
                 }
-            degree += static_cast<ustore_vertex_degree_t>(ns.size());
-        }
-        if (find_edge.role & ustore_vertex_target_k) {
-            auto ns = neighbors(value, ustore_vertex_target_k);
-            if constexpr (tuple_size_k != 0)
-                for (neighborship_t n : ns) {
-                    if constexpr (export_neighbor_ak)
-                        ids[passed_ids + 0] = n.neighbor_id;
-                    if constexpr (export_center_ak)
-                        ids[passed_ids + export_neighbor_ak] = find_edge.vertex_id;
-                    if constexpr (export_edge_ak)
-                        ids[passed_ids + export_center_ak + export_neighbor_ak] = n.edge_id;
-                    passed_ids += tuple_size_k;
+            };
+            for (ustore_vertex_role_t role : {ustore_vertex_source_k, ustore_vertex_target_k}) {
+                if (!(find_edge.role & role))
+                    continue;
+                if (is_compact(value)) {
+                    export_ships(compact_neighbors(value, role), role);
+                    continue;
+                }
+                if (!is_hub(value)) {
+                    export_ships(neighbors(value, role), role);
+                    continue;
+                }
+                // Outside of transactions chunks may change after the directory was read,
+                // so we never export more, than was accounted for
+                for (chunk_ref_t const& ref : hub_chunks(value, role)) {
+                    value_view_t chunk = *chunks_it;
+                    ++chunks_it;
+                    auto ships = reinterpret_cast<neighborship_t const*>(chunk.begin());
+                    std::size_t count = std::min<std::size_t>(ref.size, chunk.size() / sizeof(neighborship_t));
+                    export_ships(ptr_range_gt<neighborship_t const> {ships, ships + count}, role);
                 }
-            degree += static_cast<ustore_vertex_degree_t>(ns.size());
+            }
+            degrees[i] = static_cast<ustore_vertex_degree_t>((passed_ids - vertex_ids_begin) / tuple_size_k);
         }
-        degrees[i] = degree;
     }
 }
 
@@ -458,9 +1834,401 @@ void pull_and_link_for_updates( //
         unique_entries[i].content = ustore_bytes_ptr_t(found_binary.data());
         unique_entries[i].length =
             found_binary ? static_cast<ustore_length_t>(found_binary.size()) : ustore_length_missing_k;
+        if (is_compact(unique_entries[i])) {
+            decompact_entry(unique_entries[i], arena, c_error);
+            return_if_error_m(c_error);
+        }
     }
 }
 
+/**
+ * @brief Unlinks the vertices from all of their neighbors, and removes their entries together with
+ * the chunks of hubs. The entries are read from `c_entries_collections` and `c_entries_keys`, which only
+ * differ from the vertex locations for the buried vertices, whose entries were moved into siblings.
+ */
+void remove_vertices( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_size_t const c_tasks_count,
+
+    ustore_collection_t const* c_collections,
+    ustore_size_t const c_collections_stride,
+
+    ustore_key_t const* c_vertices,
+    ustore_size_t const c_vertices_stride,
+
+    ustore_collection_t const* c_entries_collections,
+    ustore_size_t const c_entries_collections_stride,
+
+    ustore_key_t const* c_entries_keys,
+    ustore_size_t const c_entries_keys_stride,
+
+    ustore_vertex_role_t const* c_roles,
+    ustore_size_t const c_roles_stride,
+
+    siblings_t& siblings,
+    ustore_options_t const c_options,
+
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    bool const compact = c_options & ustore_option_graph_compact_k;
+    bool const buried = c_entries_keys != c_vertices;
+    ustore_options_t const options = engine_options(c_options);
+
+    strided_iterator_gt<ustore_collection_t const> vertex_collections {c_collections, c_collections_stride};
+    strided_range_gt<ustore_key_t const> vertices {{c_vertices, c_vertices_stride}, c_tasks_count};
+    strided_iterator_gt<ustore_collection_t const> entries_collections {c_entries_collections,
+                                                                        c_entries_collections_stride};
+    strided_range_gt<ustore_key_t const> entries_keys {{c_entries_keys, c_entries_keys_stride}, c_tasks_count};
+    strided_iterator_gt<ustore_vertex_role_t const> vertex_roles {c_roles, c_roles_stride};
+
+    // Initially, just retrieve the bare minimum information about the vertices
+    tombstones_t no_tombstones;
+    ustore_vertex_degree_t* degrees_per_vertex = nullptr;
+    ustore_key_t* neighbors_per_vertex = nullptr;
+    export_edge_tuples<false, true, false>( //
+        c_db,
+        c_transaction,
+        0,
+        c_tasks_count,
+        c_entries_collections,
+        c_entries_collections_stride,
+        c_entries_keys,
+        c_entries_keys_stride,
+        c_roles,
+        c_roles_stride,
+        options,
+        &degrees_per_vertex,
+        &neighbors_per_vertex,
+        siblings,
+        buried ? nullptr : &no_tombstones,
+        arena,
+        c_error);
+    return_if_error_m(c_error);
+
+    // Missing vertices have no neighbors to update.
+    for (std::size_t i = 0; i != c_tasks_count; ++i)
+        if (degrees_per_vertex[i] == ustore_vertex_degree_missing_k)
+            degrees_per_vertex[i] = 0;
+
+    // Enumerate the opposite ends, from which that same reference must be removed.
+    // Here all the keys will be in the sorted order.
+    auto unique_count = std::accumulate(degrees_per_vertex, degrees_per_vertex + c_tasks_count, c_tasks_count);
+    auto unique_entries = arena.alloc<updated_entry_t>(unique_count, c_error);
+    return_if_error_m(c_error);
+    std::fill(unique_entries.begin(), unique_entries.end(), updated_entry_t {});
+
+    // Sorting the tasks would help us faster locate them in the future.
+    // We may also face repetitions when connected vertices are removed.
+    {
+        auto planned_entries = unique_entries.begin();
+        auto planned_neighbors = neighbors_per_vertex;
+        for (std::size_t i = 0; i != c_tasks_count; ++i) {
+            auto collection = vertex_collections[i];
+            planned_entries->collection = entries_collections[i];
+            planned_entries->key = entries_keys[i];
+            ++planned_entries;
+            for (std::size_t j = 0; j != degrees_per_vertex[i]; ++j, ++planned_neighbors, ++planned_entries)
+                planned_entries->collection = collection, planned_entries->key = *planned_neighbors;
+        }
+        unique_count = sort_and_deduplicate(unique_entries.begin(), planned_entries);
+        unique_entries = {unique_entries.begin(), unique_count};
+    }
+
+    // Fetch the opposite ends, from which that same reference must be removed.
+    // Here all the keys will be in the sorted order.
+    auto unique_strided = unique_entries.strided();
+    pull_and_link_for_updates(c_db, c_transaction, unique_strided, options, arena, c_error);
+    return_if_error_m(c_error);
+
+    // From every opposite end - remove a match, and only then - the content itself.
+    // Neighbors are taken from the export, as those of hubs are scattered across chunks.
+    hubs_update_t hubs(siblings, arena);
+    auto erase_from = [&](std::size_t neighbor_idx, ustore_vertex_role_t role, ustore_key_t vertex_id) {
+        updated_entry_t& neighbor_value = unique_entries[neighbor_idx];
+        if (!is_hub(neighbor_value))
+            return erase_from_entry(neighbor_value, role, vertex_id);
+        neighborship_t low {vertex_id, std::numeric_limits<ustore_key_t>::min()};
+        neighborship_t high {vertex_id, std::numeric_limits<ustore_key_t>::max()};
+        hubs.erase(neighbor_idx, role, low, high, c_error);
+    };
+    ustore_key_t const* vertex_neighbors = neighbors_per_vertex;
+    for (std::size_t i = 0; i != c_tasks_count; ++i) {
+        auto vertex_collection = vertex_collections[i];
+        auto vertex_id = vertices[i];
+        auto vertex_role = vertex_roles ? vertex_roles[i] : ustore_vertex_role_any_k;
+
+        auto vertex_idx = offset_in_sorted(unique_entries, collection_key_t {entries_collections[i], entries_keys[i]});
+        updated_entry_t& vertex_value = unique_entries[vertex_idx];
+
+        for (std::size_t j = 0; j != degrees_per_vertex[i]; ++j, ++vertex_neighbors) {
+            auto neighbor_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, *vertex_neighbors});
+            if (vertex_role == ustore_vertex_role_any_k) {
+                erase_from(neighbor_idx, ustore_vertex_source_k, vertex_id);
+                erase_from(neighbor_idx, ustore_vertex_target_k, vertex_id);
+            }
+            else
+                erase_from(neighbor_idx, invert(vertex_role), vertex_id);
+            return_if_error_m(c_error);
+        }
+
+        hubs.drop(vertex_value, c_error);
+        return_if_error_m(c_error);
+        vertex_value.content = nullptr;
+        vertex_value.length = ustore_length_missing_k;
+    }
+
+    hubs.apply(c_db, c_transaction, unique_entries, options, c_error);
+    return_if_error_m(c_error);
+
+    compact_entries(unique_entries, compact, arena, c_error);
+    return_if_error_m(c_error);
+
+    // Now we will go through all the explicitly deleted vertices, and the chunks of hubs
+    auto updates = hubs.merge(unique_entries, c_error).strided();
+    return_if_error_m(c_error);
+    write_entries(c_db, c_transaction, updates, options, arena, c_error);
+}
+
+/**
+ * @brief Completes the removal of the buried vertices among the `touched` ones, purging the references
+ * to them from their neighbors. Must precede any update of those vertices, as otherwise they would be
+ * linked to the neighbors, that haven't been purged yet, once their tombstones are gone.
+ */
+void purge_tombstones( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ptr_range_gt<updated_entry_t> touched,
+    siblings_t& siblings,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    if (touched.empty())
+        return;
+
+    tombstones_t tombstones;
+    ustore_options_t const options = engine_options(c_options);
+    read_tombstones(c_db, c_transaction, {}, siblings, options, tombstones, arena, c_error);
+    return_if_error_m(c_error);
+    if (tombstones.empty())
+        return;
+
+    uninitialized_array_gt<collection_key_t> purged(arena);
+    for (updated_entry_t const& entry : touched) {
+        auto buried = tombstones.in(entry.collection);
+        if (buried && std::binary_search(buried.begin(), buried.end(), entry.key)) {
+            purged.push_back(entry, c_error);
+            return_if_error_m(c_error);
+        }
+    }
+    if (!purged.size())
+        return;
+    std::size_t purged_count = sort_and_deduplicate(purged.begin(), purged.end());
+
+    auto collections = arena.alloc<ustore_collection_t>(purged_count, c_error);
+    return_if_error_m(c_error);
+    auto vertices = arena.alloc<ustore_key_t>(purged_count, c_error);
+    return_if_error_m(c_error);
+    auto entries_collections = arena.alloc<ustore_collection_t>(purged_count, c_error);
+    return_if_error_m(c_error);
+    auto entries_keys = arena.alloc<ustore_key_t>(purged_count, c_error);
+    return_if_error_m(c_error);
+    for (std::size_t i = 0; i != purged_count; ++i) {
+        auto buried = tombstones.in(purged[i].collection);
+        collections[i] = purged[i].collection;
+        vertices[i] = purged[i].key;
+        entries_collections[i] = siblings.of(purged[i].collection);
+        entries_keys[i] = std::lower_bound(buried.begin(), buried.end(), purged[i].key)->entry_key;
+    }
+
+    remove_vertices(c_db,
+                    c_transaction,
+                    purged_count,
+                    collections.begin(),
+                    sizeof(ustore_collection_t),
+                    vertices.begin(),
+                    sizeof(ustore_key_t),
+                    entries_collections.begin(),
+                    sizeof(ustore_collection_t),
+                    entries_keys.begin(),
+                    sizeof(ustore_key_t),
+                    nullptr,
+                    0,
+                    siblings,
+                    c_options,
+                    arena,
+                    c_error);
+    return_if_error_m(c_error);
+
+    // Both the tombstones and the purged vertices are sorted
+    uninitialized_array_gt<updated_entry_t> writes(arena);
+    for (collection_tombstones_t const& collection : tombstones.collections) {
+        auto purged_begin = std::find_if(purged.begin(), purged.begin() + purged_count, [&](collection_key_t const& k) {
+            return k.collection == collection.collection;
+        });
+        auto purged_end = std::find_if(purged_begin, purged.begin() + purged_count, [&](collection_key_t const& k) {
+            return k.collection != collection.collection;
+        });
+        if (purged_begin == purged_end)
+            continue;
+        auto remaining = arena.alloc<tombstone_t>(collection.tombstones.size(), c_error);
+        return_if_error_m(c_error);
+        auto remaining_end = std::copy_if( //
+            collection.tombstones.begin(),
+            collection.tombstones.end(),
+            remaining.begin(),
+            [&](tombstone_t const& tombstone) {
+                collection_key_t buried {collection.collection, tombstone.vertex_id};
+                return !std::binary_search(purged_begin, purged_end, buried);
+            });
+        write_tombstones(siblings.of(collection.collection), {remaining.begin(), remaining_end}, writes, c_error);
+        return_if_error_m(c_error);
+    }
+    auto updates = ptr_range_gt<updated_entry_t> {writes.begin(), writes.end()}.strided();
+    write_entries(c_db, c_transaction, updates, options, arena, c_error);
+}
+
+/**
+ * @brief Removes the vertices in constant time, independent of their degrees. Their entries are moved
+ * into the sibling collections, and the references from the neighbors are skipped on reads, until purged.
+ */
+void bury_vertices( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_size_t const c_tasks_count,
+
+    ustore_collection_t const* c_collections,
+    ustore_size_t const c_collections_stride,
+
+    ustore_key_t const* c_vertices,
+    ustore_size_t const c_vertices_stride,
+
+    siblings_t& siblings,
+    ustore_options_t const c_options,
+
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    ustore_options_t const options = engine_options(c_options);
+    tombstones_t tombstones;
+    read_tombstones(c_db, c_transaction, {}, siblings, options, tombstones, arena, c_error);
+    return_if_error_m(c_error);
+
+    // Vertices, that are already buried, are skipped
+    strided_iterator_gt<ustore_collection_t const> collections {c_collections, c_collections_stride};
+    strided_range_gt<ustore_key_t const> vertices {{c_vertices, c_vertices_stride}, c_tasks_count};
+    auto unique_entries = arena.alloc<updated_entry_t>(c_tasks_count, c_error);
+    return_if_error_m(c_error);
+    std::size_t unique_count = 0;
+    for (std::size_t i = 0; i != c_tasks_count; ++i) {
+        ustore_collection_t collection = collections ? collections[i] : ustore_collection_main_k;
+        auto buried = tombstones.in(collection);
+        if (std::binary_search(buried.begin(), buried.end(), vertices[i]))
+            continue;
+        unique_entries[unique_count] = updated_entry_t {};
+        unique_entries[unique_count].collection = collection;
+        unique_entries[unique_count].key = vertices[i];
+        ++unique_count;
+    }
+    unique_count = sort_and_deduplicate(unique_entries.begin(), unique_entries.begin() + unique_count);
+    if (!unique_count)
+        return;
+
+    // The first tombstones of a collection come with its sibling
+    for (std::size_t i = 0; i != unique_count; ++i) {
+        siblings.ensure(unique_entries[i].collection, arena, c_error);
+        return_if_error_m(c_error);
+    }
+
+    // Pull the entries together with the chunk counters, which will provide their new keys
+    std::size_t const collections_count = tombstones.collections.size();
+    auto keys = arena.alloc<collection_key_t>(unique_count + collections_count, c_error);
+    return_if_error_m(c_error);
+    for (std::size_t i = 0; i != unique_count; ++i)
+        keys[i] = unique_entries[i];
+    for (std::size_t i = 0; i != collections_count; ++i)
+        keys[unique_count + i] =
+            collection_key_t {siblings.of(tombstones.collections[i].collection), chunks_counter_key_k};
+
+    ustore_bytes_ptr_t found_values = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.arena = arena;
+    read.options = c_transaction ? ustore_options_t(options & ~ustore_option_transaction_dont_watch_k) : options;
+    read.tasks_count = keys.size();
+    read.collections = &keys.begin()->collection;
+    read.collections_stride = sizeof(collection_key_t);
+    read.keys = &keys.begin()->key;
+    read.keys_stride = sizeof(collection_key_t);
+    read.offsets = &found_offsets;
+    read.values = &found_values;
+
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    joined_blobs_t found {keys.size(), found_offsets, found_values};
+    auto counters = arena.alloc<ustore_key_t>(collections_count, c_error);
+    return_if_error_m(c_error);
+    for (std::size_t i = 0; i != collections_count; ++i) {
+        value_view_t counter = found[unique_count + i];
+        counters[i] = 0;
+        if (counter.size() == sizeof(ustore_key_t))
+            std::memcpy(&counters[i], counter.begin(), sizeof(ustore_key_t));
+    }
+
+    // Every present entry is moved, and every collection gets its merged tombstones and counter
+    uninitialized_array_gt<updated_entry_t> writes(arena);
+    for (std::size_t collection_idx = 0; collection_idx != collections_count; ++collection_idx) {
+        collection_tombstones_t const& collection = tombstones.collections[collection_idx];
+        ustore_collection_t const sibling = siblings.of(collection.collection);
+        auto merged = arena.alloc<tombstone_t>(collection.tombstones.size() + unique_count, c_error);
+        return_if_error_m(c_error);
+        std::size_t merged_count = 0;
+        tombstone_t const* old_it = collection.tombstones.begin();
+        for (std::size_t i = 0; i != unique_count; ++i) {
+            value_view_t entry = found[i];
+            if (unique_entries[i].collection != collection.collection || !entry)
+                continue;
+
+            ustore_key_t& counter = counters[collection_idx];
+            return_error_if_m(counter < tombstones_key_k, c_error, error_unknown_k, "Out of chunk keys");
+            updated_entry_t moved;
+            moved.collection = sibling;
+            moved.key = counter++;
+            moved.content = ustore_bytes_ptr_t(entry.data());
+            moved.length = static_cast<ustore_length_t>(entry.size());
+            writes.push_back(moved, c_error);
+            writes.push_back(unique_entries[i], c_error);
+            return_if_error_m(c_error);
+
+            for (; old_it != collection.tombstones.end() && old_it->vertex_id < unique_entries[i].key; ++old_it)
+                merged[merged_count++] = *old_it;
+            merged[merged_count++] = tombstone_t {unique_entries[i].key, moved.key};
+        }
+        if (merged_count == static_cast<std::size_t>(old_it - collection.tombstones.begin()))
+            continue;
+        for (; old_it != collection.tombstones.end(); ++old_it)
+            merged[merged_count++] = *old_it;
+
+        updated_entry_t counter;
+        counter.collection = sibling;
+        counter.key = chunks_counter_key_k;
+        counter.content = ustore_bytes_ptr_t(&counters[collection_idx]);
+        counter.length = sizeof(ustore_key_t);
+        writes.push_back(counter, c_error);
+        return_if_error_m(c_error);
+        write_tombstones(sibling, {merged.begin(), merged_count}, writes, c_error);
+        return_if_error_m(c_error);
+    }
+    auto updates = ptr_range_gt<updated_entry_t> {writes.begin(), writes.end()}.strided();
+    write_entries(c_db, c_transaction, updates, options, arena, c_error);
+}
+
 template <bool erase_ak>
 void update_neighborhoods( //
     ustore_database_t const c_db,
@@ -479,34 +2247,57 @@ void update_neighborhoods( //
     ustore_key_t const* c_targets_ids,
     ustore_size_t const c_targets_stride,
 
+    ustore_vertex_role_t const* c_roles,
+    ustore_size_t const c_roles_stride,
+
     ustore_options_t const c_options,
 
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) {
 
+    // The compact layout is requested per call, but the entries that are already compact remain so
+    bool const compact = c_options & ustore_option_graph_compact_k;
+    ustore_options_t const options = engine_options(c_options);
+
     strided_iterator_gt<ustore_collection_t const> edge_collections {c_collections, c_collections_stride};
     strided_iterator_gt<ustore_key_t const> edges_ids {c_edges_ids, c_edges_stride};
     strided_iterator_gt<ustore_key_t const> sources_ids {c_sources_ids, c_sources_stride};
     strided_iterator_gt<ustore_key_t const> targets_ids {c_targets_ids, c_targets_stride};
+    strided_iterator_gt<ustore_vertex_role_t const> roles {c_roles, c_roles_stride};
+    auto updates_role = [&](std::size_t i, ustore_vertex_role_t role) {
+        return !roles || (roles[i] & role);
+    };
+
+    siblings_t siblings;
+    siblings.resolve(c_db, c_tasks_count, c_collections, c_collections_stride, arena, c_error);
+    return_if_error_m(c_error);
 
     // Fetch all the data related to touched vertices, and deduplicate them
     auto unique_entries = arena.alloc<updated_entry_t>(c_tasks_count * 2, c_error);
     return_if_error_m(c_error);
     std::fill(unique_entries.begin(), unique_entries.end(), updated_entry_t {});
+    std::size_t touched_count = 0;
     for (ustore_size_t i = 0; i != c_tasks_count; ++i)
-        unique_entries[i].collection = edge_collections[i], unique_entries[i].key = sources_ids[i];
+        if (updates_role(i, ustore_vertex_source_k))
+            unique_entries[touched_count].collection = edge_collections[i],
+            unique_entries[touched_count].key = sources_ids[i], ++touched_count;
     for (ustore_size_t i = 0; i != c_tasks_count; ++i)
-        unique_entries[c_tasks_count + i].collection = edge_collections[i],
-                                       unique_entries[c_tasks_count + i].key = targets_ids[i];
+        if (updates_role(i, ustore_vertex_target_k))
+            unique_entries[touched_count].collection = edge_collections[i],
+            unique_entries[touched_count].key = targets_ids[i], ++touched_count;
 
     // Lets put all the unique IDs in the beginning of the range,
     // and then refill the tail with replicas
-    auto unique_count = sort_and_deduplicate(unique_entries.begin(), unique_entries.end());
+    auto unique_count = sort_and_deduplicate(unique_entries.begin(), unique_entries.begin() + touched_count);
     unique_entries = {unique_entries.begin(), unique_count};
 
+    // Buried vertices must be purged, before new edges can reach them
+    purge_tombstones(c_db, c_transaction, unique_entries, siblings, c_options, arena, c_error);
+    return_if_error_m(c_error);
+
     // Fetch the existing entries
     auto unique_strided = unique_entries.strided();
-    pull_and_link_for_updates(c_db, c_transaction, unique_strided, c_options, arena, c_error);
+    pull_and_link_for_updates(c_db, c_transaction, unique_strided, options, arena, c_error);
     return_if_error_m(c_error);
 
     // Define our primary for-loop
@@ -516,15 +2307,43 @@ void update_neighborhoods( //
             auto source_id = sources_ids[i];
             auto target_id = targets_ids[i];
             auto edge_id = edges_ids ? edges_ids[i] : ustore_key_unknown_k;
-            auto source_idx = offset_in_sorted(unique_entries, collection_key_t {collection, source_id});
-            auto target_idx = offset_in_sorted(unique_entries, collection_key_t {collection, target_id});
-            entry_role_target_edge_callback(unique_entries[source_idx], ustore_vertex_source_k, target_id, edge_id);
-            entry_role_target_edge_callback(unique_entries[target_idx], ustore_vertex_target_k, source_id, edge_id);
+            if (updates_role(i, ustore_vertex_source_k)) {
+                auto source_idx = offset_in_sorted(unique_entries, collection_key_t {collection, source_id});
+                entry_role_target_edge_callback(unique_entries[source_idx], ustore_vertex_source_k, target_id, edge_id);
+            }
+            if (updates_role(i, ustore_vertex_target_k)) {
+                auto target_idx = offset_in_sorted(unique_entries, collection_key_t {collection, target_id});
+                entry_role_target_edge_callback(unique_entries[target_idx], ustore_vertex_target_k, source_id, edge_id);
+            }
         }
     };
 
+    // Hubs are updated separately, after the regular vertices
+    hubs_update_t hubs(siblings, arena);
+    for_each_task([&](updated_entry_t& entry, ustore_vertex_role_t role, ustore_key_t neighbor_id, ustore_key_t edge_id) {
+        if (!is_hub(entry))
+            return;
+        auto entry_idx = static_cast<std::size_t>(&entry - unique_entries.begin());
+        auto ship = neighborship_t {neighbor_id, edge_id};
+        if constexpr (erase_ak)
+            hubs.erase(entry_idx, role, ship, ship, c_error);
+        else
+            hubs.insert(entry_idx, role, ship, c_error);
+    });
+    return_if_error_m(c_error);
+
     if constexpr (erase_ak)
         for_each_task(&erase_from_entry);
+    else if (std::size_t threads_count = threads_registry_t::global().get(c_db);
+             threads_count > 1 && c_tasks_count >= parallel_updates_min_k) {
+        // Big batches are grouped by vertex, and merged into different vertices in parallel
+        merge_into_entries(unique_entries, for_each_task, threads_count, arena, c_error);
+        return_if_error_m(c_error);
+        for (std::size_t i = 0; i != unique_count; ++i)
+            if (!is_hub(unique_entries[i]) && degree(unique_entries[i]) > hub_degree_k)
+                hubs.promote(i, unique_entries[i], c_error);
+        return_if_error_m(c_error);
+    }
     else {
         // Unlike erasing, which can reuse the memory, her we need three passes:
         // 1. estimating final size
@@ -532,6 +2351,8 @@ void update_neighborhoods( //
         // 2. reallocating into bigger buffers
         for (std::size_t i = 0; i != unique_count; ++i) {
             auto& unique_entry = unique_entries[i];
+            if (is_hub(unique_entry))
+                continue;
             auto bytes_present = unique_entry.length != ustore_length_missing_k ? unique_entry.length : 0;
             auto bytes_for_relations = unique_entry.degree_delta * sizeof(neighborship_t);
             auto bytes_for_degrees = bytes_present > bytes_in_degrees_header_k ? 0 : bytes_in_degrees_header_k;
@@ -546,52 +2367,56 @@ void update_neighborhoods( //
         }
         // 3. performing insertions
         for_each_task(&insert_into_entry);
+        // 4. converting the grown vertices into hubs
+        for (std::size_t i = 0; i != unique_count; ++i)
+            if (!is_hub(unique_entries[i]) && degree(unique_entries[i]) > hub_degree_k)
+                hubs.promote(i, unique_entries[i], c_error);
+        return_if_error_m(c_error);
     }
 
+    hubs.apply(c_db, c_transaction, unique_entries, options, c_error);
+    return_if_error_m(c_error);
+
     // Some of the requested updates may have been completely useless, like:
     // > upserting an existing relation.
     // > removing a missing relation.
     // So we can further optimize by cancelling those writes.
     std::partition(unique_entries.begin(), unique_entries.end(), std::mem_fn(&updated_entry_t::degree_delta));
 
-    // Dump the data back to disk!
-    auto collections = unique_strided.immutable().members(&updated_entry_t::collection);
-    auto keys = unique_strided.immutable().members(&updated_entry_t::key);
-    auto contents = unique_strided.immutable().members(&updated_entry_t::content);
-    auto lengths = unique_strided.immutable().members(&updated_entry_t::length);
-
-    ustore_write_t write {};
-    write.db = c_db;
-    write.error = c_error;
-    write.transaction = c_transaction;
-    write.arena = arena;
-    write.options = c_options;
-    write.tasks_count = unique_count;
-    write.collections = collections.begin().get();
-    write.collections_stride = collections.begin().stride();
-    write.keys = keys.begin().get();
-    write.keys_stride = keys.begin().stride();
-    write.lengths = lengths.begin().get();
-    write.lengths_stride = lengths.begin().stride();
-    write.values = contents.begin().get();
-    write.values_stride = contents.begin().stride();
+    compact_entries(unique_entries, compact, arena, c_error);
+    return_if_error_m(c_error);
 
-    ustore_write(&write);
+    // Dump the data back to disk, together with the chunks of hubs!
+    auto updates = hubs.merge(unique_entries, c_error).strided();
+    return_if_error_m(c_error);
+    write_entries(c_db, c_transaction, updates, options, arena, c_error);
 }
 
 void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
 
     ustore_graph_find_edges_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::graph_find_edges_k, c.tasks_count, c.error};
     if (!c.tasks_count)
         return;
 
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
+    siblings_t siblings;
+    siblings.resolve(c.db, c.tasks_count, c.collections, c.collections_stride, arena, c.error);
+    return_if_error_m(c.error);
+
+    tombstones_t tombstones;
+    ustore_options_t const options = engine_options(c.options);
+    read_tombstones(c.db, c.transaction, c.snapshot, siblings, options, tombstones, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Degrees in the headers still account for the buried neighbors, so those have to be counted
     bool only_degrees = !c.edges_per_vertex;
-    auto func = only_degrees //
-                    ? &export_edge_tuples<false, false, false>
-                    : &export_edge_tuples<true, true, true>;
+    ustore_key_t* neighbors_per_vertex = nullptr;
+    auto func = &export_edge_tuples<true, true, true>;
+    if (only_degrees)
+        func = tombstones.empty() ? &export_edge_tuples<false, false, false> : &export_edge_tuples<false, true, false>;
     return func( //
         c.db,
         c.transaction,
@@ -603,9 +2428,11 @@ void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
         c.vertices_stride,
         c.roles,
         c.roles_stride,
-        c.options,
+        options,
         c.degrees_per_vertex,
-        c.edges_per_vertex,
+        only_degrees ? &neighbors_per_vertex : c.edges_per_vertex,
+        siblings,
+        &tombstones,
         arena,
         c.error);
 }
@@ -613,6 +2440,7 @@ void ustore_graph_find_edges(ustore_graph_find_edges_t* c_ptr) {
 void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
 
     ustore_graph_upsert_edges_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::graph_upsert_edges_k, c.tasks_count, c.error};
     if (!c.tasks_count)
         return;
 
@@ -631,6 +2459,8 @@ void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
         c.sources_stride,
         c.targets_ids,
         c.targets_stride,
+        c.roles,
+        c.roles_stride,
         c.options,
         arena,
         c.error);
@@ -639,6 +2469,7 @@ void ustore_graph_upsert_edges(ustore_graph_upsert_edges_t* c_ptr) {
 void ustore_graph_remove_edges(ustore_graph_remove_edges_t* c_ptr) {
 
     ustore_graph_remove_edges_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::graph_remove_edges_k, c.tasks_count, c.error};
     if (!c.tasks_count)
         return;
 
@@ -657,6 +2488,8 @@ void ustore_graph_remove_edges(ustore_graph_remove_edges_t* c_ptr) {
         c.sources_stride,
         c.targets_ids,
         c.targets_stride,
+        nullptr,
+        0,
         c.options,
         arena,
         c.error);
@@ -671,13 +2504,29 @@ void ustore_graph_upsert_vertices(ustore_graph_upsert_vertices_t* c_ptr) {
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
+    // Buried vertices are purged, before they are recreated
+    auto touched = arena.alloc<updated_entry_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.vertices, c.vertices_stride};
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        touched[i] = updated_entry_t {};
+        touched[i].collection = collections ? collections[i] : ustore_collection_main_k;
+        touched[i].key = keys[i];
+    }
+    siblings_t siblings;
+    siblings.resolve(c.db, c.tasks_count, c.collections, c.collections_stride, arena, c.error);
+    return_if_error_m(c.error);
+    purge_tombstones(c.db, c.transaction, touched, siblings, c.options, arena, c.error);
+    return_if_error_m(c.error);
+
     ustore_length_t* c_found_lengths {};
     ustore_read_t read {};
     read.db = c.db;
     read.error = c.error;
     read.transaction = c.transaction;
     read.arena = arena;
-    read.options = c.options;
+    read.options = engine_options(c.options);
     read.tasks_count = c.tasks_count;
     read.collections = c.collections;
     read.collections_stride = c.collections_stride;
@@ -725,104 +2574,178 @@ void ustore_graph_remove_vertices(ustore_graph_remove_vertices_t* c_ptr) {
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
-    strided_iterator_gt<ustore_collection_t const> vertex_collections {c.collections, c.collections_stride};
-    strided_range_gt<ustore_key_t const> vertices {{c.vertices, c.vertices_stride}, c.tasks_count};
-    strided_iterator_gt<ustore_vertex_role_t const> vertex_roles {c.roles, c.roles_stride};
-
-    // Initially, just retrieve the bare minimum information about the vertices
-    ustore_vertex_degree_t* degrees_per_vertex = nullptr;
-    ustore_key_t* neighbors_per_vertex = nullptr;
-    export_edge_tuples<false, true, false>( //
-        c.db,
-        c.transaction,
-        0,
-        c.tasks_count,
-        c.collections,
-        c.collections_stride,
-        c.vertices,
-        c.vertices_stride,
-        c.roles,
-        c.roles_stride,
-        c.options,
-        &degrees_per_vertex,
-        &neighbors_per_vertex,
-        arena,
-        c.error);
+    siblings_t siblings;
+    siblings.resolve(c.db, c.tasks_count, c.collections, c.collections_stride, arena, c.error);
     return_if_error_m(c.error);
 
-    // Enumerate the opposite ends, from which that same reference must be removed.
-    // Here all the keys will be in the sorted order.
-    auto unique_count = std::accumulate(degrees_per_vertex, degrees_per_vertex + c.tasks_count, c.tasks_count);
-    auto unique_entries = arena.alloc<updated_entry_t>(unique_count, c.error);
+    // Without siblings to move the entries into, vertices are removed eagerly
+    if ((c.options & ustore_option_graph_lazy_k) && siblings.available())
+        return bury_vertices(c.db,
+                             c.transaction,
+                             c.tasks_count,
+                             c.collections,
+                             c.collections_stride,
+                             c.vertices,
+                             c.vertices_stride,
+                             siblings,
+                             c.options,
+                             arena,
+                             c.error);
+
+    // Removing a buried vertex again completes its removal
+    auto touched = arena.alloc<updated_entry_t>(c.tasks_count, c.error);
     return_if_error_m(c.error);
-    std::fill(unique_entries.begin(), unique_entries.end(), updated_entry_t {});
-
-    // Sorting the tasks would help us faster locate them in the future.
-    // We may also face repetitions when connected vertices are removed.
-    {
-        auto planned_entries = unique_entries.begin();
-        for (std::size_t i = 0; i != c.tasks_count; ++i) {
-            auto collection = planned_entries->collection = vertex_collections[i];
-            planned_entries->key = vertices[i];
-            ++planned_entries;
-            for (std::size_t j = 0; j != degrees_per_vertex[i]; ++j, ++neighbors_per_vertex, ++planned_entries)
-                planned_entries->collection = collection, planned_entries->key = *neighbors_per_vertex;
-        }
-        unique_count = sort_and_deduplicate(unique_entries.begin(), planned_entries);
-        unique_entries = {unique_entries.begin(), unique_count};
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> vertices {c.vertices, c.vertices_stride};
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        touched[i] = updated_entry_t {};
+        touched[i].collection = collections ? collections[i] : ustore_collection_main_k;
+        touched[i].key = vertices[i];
     }
+    purge_tombstones(c.db, c.transaction, touched, siblings, c.options, arena, c.error);
+    return_if_error_m(c.error);
 
-    // Fetch the opposite ends, from which that same reference must be removed.
-    // Here all the keys will be in the sorted order.
-    auto unique_strided = unique_entries.strided();
-    pull_and_link_for_updates(c.db, c.transaction, unique_strided, c.options, arena, c.error);
+    remove_vertices(c.db,
+                    c.transaction,
+                    c.tasks_count,
+                    c.collections,
+                    c.collections_stride,
+                    c.vertices,
+                    c.vertices_stride,
+                    c.collections,
+                    c.collections_stride,
+                    c.vertices,
+                    c.vertices_stride,
+                    c.roles,
+                    c.roles_stride,
+                    siblings,
+                    c.options,
+                    arena,
+                    c.error);
+}
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+void ustore_graph_traverse(ustore_graph_traverse_t* c_ptr) {
+
+    ustore_graph_traverse_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::graph_traverse_k, c.starts_count, c.error};
+    return_error_if_m(c.vertices_offsets && c.vertices, c.error, args_combo_k, "Visited vertices must be exported");
+    return_error_if_m(!c.edges_offsets == !c.edges, c.error, args_combo_k, "Edges need both offsets and IDs");
+    return_error_if_m(c.role != ustore_vertex_role_unknown_k, c.error, args_wrong_k, "Role must be specified");
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
-    // From every opposite end - remove a match, and only then - the content itself
-    for (std::size_t i = 0; i != unique_strided.size(); ++i) {
-        auto vertex_collection = vertex_collections[i];
-        auto vertex_id = vertices[i];
-        auto vertex_role = vertex_roles ? vertex_roles[i] : ustore_vertex_role_any_k;
+    bool const export_edges = c.edges != nullptr;
+    auto vertices_offsets = arena.alloc<ustore_length_t>(c.hops + 2, c.error);
+    return_if_error_m(c.error);
+    auto edges_offsets = arena.alloc_or_dummy(c.hops + 1, c.error, c.edges_offsets);
+    return_if_error_m(c.error);
+    uninitialized_array_gt<ustore_key_t> vertices(arena);
+    uninitialized_array_gt<ustore_key_t> edges(arena);
 
-        auto vertex_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, vertex_id});
-        updated_entry_t& vertex_value = unique_entries[vertex_idx];
+    // The first frontier is formed by the deduplicated starting vertices
+    strided_iterator_gt<ustore_key_t const> starts {c.starts, c.starts_stride};
+    vertices.resize(c.starts_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.starts_count; ++i)
+        vertices[i] = starts[i];
+    vertices.resize(sort_and_deduplicate(vertices.begin(), vertices.end()), c.error);
+    vertices_offsets[0] = 0;
+    vertices_offsets[1] = static_cast<ustore_length_t>(vertices.size());
+    edges_offsets[0] = 0;
+
+    // Buried vertices are never reached, even if their neighbors weren't purged yet
+    siblings_t siblings;
+    siblings.resolve(c.db, 1, &c.collection, 0, arena, c.error);
+    return_if_error_m(c.error);
+    tombstones_t tombstones;
+    ustore_options_t const options = engine_options(c.options);
+    read_tombstones(c.db, c.transaction, c.snapshot, siblings, options, tombstones, arena, c.error);
+    return_if_error_m(c.error);
 
-        for (neighborship_t n : neighbors(vertex_value, vertex_role)) {
-            auto neighbor_idx = offset_in_sorted(unique_entries, collection_key_t {vertex_collection, n.neighbor_id});
-            updated_entry_t& neighbor_value = unique_entries[neighbor_idx];
-            if (vertex_role == ustore_vertex_role_any_k) {
-                erase_from_entry(neighbor_value, ustore_vertex_source_k, vertex_id);
-                erase_from_entry(neighbor_value, ustore_vertex_target_k, vertex_id);
-            }
-            else
-                erase_from_entry(neighbor_value, invert(vertex_role), vertex_id);
+    // All the visited vertices are kept sorted, to be skipped on further hops
+    auto visited = arena.alloc<ustore_key_t>(vertices.size(), c.error);
+    return_if_error_m(c.error);
+    std::copy(vertices.begin(), vertices.end(), visited.begin());
+
+    for (std::size_t hop = 1; hop <= c.hops; ++hop) {
+        std::size_t const frontier_begin = vertices_offsets[hop - 1];
+        std::size_t const frontier_size = vertices_offsets[hop] - frontier_begin;
+
+        ustore_vertex_degree_t* degrees_per_vertex = nullptr;
+        ustore_key_t* edges_per_vertex = nullptr;
+        if (frontier_size) {
+            // The frontier may be relocated, while the vertices of the next hop are appended
+            auto frontier = arena.alloc<ustore_key_t>(frontier_size, c.error);
+            return_if_error_m(c.error);
+            std::memcpy(frontier.begin(), vertices.begin() + frontier_begin, frontier_size * sizeof(ustore_key_t));
+            export_edge_tuples<true, true, true>( //
+                c.db,
+                c.transaction,
+                c.snapshot,
+                static_cast<ustore_size_t>(frontier_size),
+                &c.collection,
+                0,
+                frontier.begin(),
+                sizeof(ustore_key_t),
+                &c.role,
+                0,
+                options,
+                &degrees_per_vertex,
+                &edges_per_vertex,
+                siblings,
+                &tombstones,
+                arena,
+                c.error);
+            return_if_error_m(c.error);
         }
 
-        vertex_value.content = nullptr;
-        vertex_value.length = ustore_length_missing_k;
+        // Collect the opposite ends of all the found edges
+        std::size_t const next_begin = vertices.size();
+        ustore_key_t const* frontier_edges = edges_per_vertex;
+        for (std::size_t i = 0; i != frontier_size; ++i) {
+            if (degrees_per_vertex[i] == ustore_vertex_degree_missing_k)
+                continue;
+            ustore_key_t const center = vertices[frontier_begin + i];
+            std::size_t const count_edges = degrees_per_vertex[i];
+            if (export_edges) {
+                edges.insert(edges.size(), frontier_edges, frontier_edges + count_edges * 3, c.error);
+                return_if_error_m(c.error);
+            }
+            for (std::size_t j = 0; j != count_edges; ++j, frontier_edges += 3) {
+                ustore_key_t const neighbor = frontier_edges[0] == center ? frontier_edges[1] : frontier_edges[0];
+                vertices.push_back(neighbor, c.error);
+                return_if_error_m(c.error);
+            }
+        }
+        edges_offsets[hop] = static_cast<ustore_length_t>(edges.size() / 3);
+
+        // Deduplicate the next frontier, drop the visited vertices and apply the limit
+        auto next_first = vertices.begin() + next_begin;
+        auto next_last = next_first + sort_and_deduplicate(next_first, vertices.end());
+        if (!c.revisit)
+            next_last = std::remove_if(next_first, next_last, [&](ustore_key_t vertex) {
+                return std::binary_search(visited.begin(), visited.end(), vertex);
+            });
+        if (c.frontier_limit && static_cast<std::size_t>(next_last - next_first) > c.frontier_limit)
+            next_last = next_first + c.frontier_limit;
+        vertices.resize(next_last - vertices.begin(), c.error);
+        vertices_offsets[hop + 1] = static_cast<ustore_length_t>(vertices.size());
+
+        if (!c.revisit) {
+            auto merged = arena.alloc<ustore_key_t>(visited.size() + (next_last - next_first), c.error);
+            return_if_error_m(c.error);
+            std::merge(visited.begin(), visited.end(), next_first, next_last, merged.begin());
+            visited = merged;
+        }
     }
 
-    // Now we will go through all the explicitly deleted vertices
-    auto collections = unique_strided.immutable().members(&updated_entry_t::collection);
-    auto keys = unique_strided.immutable().members(&updated_entry_t::key);
-    auto lengths = unique_strided.immutable().members(&updated_entry_t::length);
-    auto contents = unique_strided.immutable().members(&updated_entry_t::content);
-
-    ustore_write_t write {};
-    write.db = c.db;
-    write.error = c.error;
-    write.transaction = c.transaction;
-    write.arena = arena;
-    write.options = c.options;
-    write.tasks_count = unique_count;
-    write.collections = collections.begin().get();
-    write.collections_stride = collections.begin().stride();
-    write.keys = keys.begin().get();
-    write.keys_stride = keys.begin().stride();
-    write.lengths = lengths.begin().get();
-    write.lengths_stride = lengths.begin().stride();
-    write.values = contents.begin().get();
-    write.values_stride = contents.begin().stride();
+    *c.vertices_offsets = vertices_offsets.begin();
+    *c.vertices = vertices.begin();
+    if (export_edges)
+        *c.edges = edges.begin();
+}
 
-    ustore_write(&write);
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,656 @@
+/**
+ * @file modality_graph_analytics.cpp
+ * @author Ashot Vardanian
+ *
+ * @brief Whole-graph analytics on top of "ustore/graph.h".
+ *
+ * Instead of querying the Key-Value Store on every step of an algorithm,
+ * the adjacency of a graph collection is streamed in batches into a
+ * Compressed Sparse Row snapshot, addressing vertices by 32-bit offsets
+ * in the sorted list of their IDs. PageRank and Weakly Connected Components
+ * split the snapshot between threads, while Louvain Communities iteratively
+ * aggregate it into smaller graphs of communities. The same snapshots,
+ * optionally of induced subgraphs, can be exported for external libraries.
+ */
+#include <algorithm> // `std::lower_bound`
+#include <atomic>    // `std::atomic`
+#include <cmath>     // `std::abs`
+#include <limits>    // `std::numeric_limits`
+#include <numeric>   // `std::accumulate`
+#include <vector>    // `std::vector`
+
+#include "ustore/graph.h"
+#include "ustore/cpp/types.hpp" // `arena_t`
+
+#include "helpers/linked_memory.hpp" // `linked_memory_lock_t`
+#include "helpers/threads.hpp"       // `parallel_for`
+
+/*********************************************************/
+/*****************	 C++ Implementation	  ****************/
+/*********************************************************/
+
+using namespace unum::ustore;
+using namespace unum;
+
+using vertex_idx_t = std::uint32_t;
+using edge_idx_t = std::uint64_t;
+
+/**
+ * @brief Number of vertices, which adjacency is fetched at once.
+ */
+static constexpr ustore_length_t csr_read_ahead_k = 4096;
+
+static constexpr std::size_t default_iterations_k = 100;
+static constexpr double default_damping_k = 0.85;
+static constexpr double default_pagerank_tolerance_k = 1e-6;
+static constexpr double default_louvain_tolerance_k = 1e-7;
+
+/**
+ * @brief Compressed Sparse Row adjacency of a graph.
+ * Neighbors of the vertex with offset `i` are `neighbors[offsets[i] : offsets[i + 1]]`.
+ * The optional `weights` are only present in aggregated graphs, otherwise all are one.
+ * The optional `edges_ids` are only collected for exported snapshots.
+ */
+struct csr_graph_t {
+    std::vector<ustore_key_t> ids;
+    std::vector<edge_idx_t> offsets;
+    std::vector<vertex_idx_t> neighbors;
+    std::vector<double> weights;
+    std::vector<ustore_key_t> edges_ids;
+
+    std::size_t size() const noexcept { return offsets.empty() ? 0 : offsets.size() - 1; }
+    double weight(edge_idx_t edge) const noexcept { return weights.empty() ? 1.0 : weights[edge]; }
+};
+
+/**
+ * @brief Appends the adjacency of a sorted batch of existing vertices to a @b CSR.
+ * Neighbors are kept as IDs in `neighbor_ids`, until all the vertices are known.
+ */
+template <typename context_at>
+void csr_append(context_at& c,
+                ustore_vertex_role_t role,
+                ustore_key_t const* vertices,
+                std::size_t count,
+                bool export_edges_ids,
+                std::vector<ustore_key_t>& neighbor_ids,
+                csr_graph_t& graph) noexcept(false) {
+
+    ustore_vertex_degree_t* degrees_per_vertex = nullptr;
+    ustore_key_t* edges_per_vertex = nullptr;
+
+    ustore_graph_find_edges_t find {};
+    find.db = c.db;
+    find.error = c.error;
+    find.transaction = c.transaction;
+    find.snapshot = c.snapshot;
+    find.arena = c.arena;
+    find.options = c.options;
+    find.tasks_count = count;
+    find.collections = &c.collection;
+    find.vertices = vertices;
+    find.vertices_stride = sizeof(ustore_key_t);
+    find.roles = &role;
+    find.degrees_per_vertex = &degrees_per_vertex;
+    find.edges_per_vertex = &edges_per_vertex;
+    ustore_graph_find_edges(&find);
+    return_if_error_m(c.error);
+
+    ustore_key_t const* edge = edges_per_vertex;
+    for (std::size_t i = 0; i != count; ++i) {
+        ustore_key_t const vertex = vertices[i];
+        ustore_vertex_degree_t const degree = degrees_per_vertex[i];
+        if (degree == ustore_vertex_degree_missing_k)
+            continue;
+        graph.ids.push_back(vertex);
+        for (ustore_vertex_degree_t j = 0; j != degree; ++j, edge += 3) {
+            neighbor_ids.push_back(edge[0] == vertex ? edge[1] : edge[0]);
+            if (export_edges_ids)
+                graph.edges_ids.push_back(edge[2]);
+        }
+        graph.offsets.push_back(neighbor_ids.size());
+    }
+
+    return_error_if_m(graph.ids.size() < std::numeric_limits<vertex_idx_t>::max(),
+                      c.error,
+                      args_wrong_k,
+                      "Graph is too large for an in-memory snapshot");
+}
+
+/**
+ * @brief Maps the IDs of neighbors into offsets with a binary search over the sorted vertex IDs.
+ * In induced subgraphs, the edges leading outside of it are dropped afterwards.
+ */
+void csr_link(std::vector<ustore_key_t> const& neighbor_ids,
+              std::size_t threads_count,
+              bool induced,
+              csr_graph_t& graph) noexcept(false) {
+
+    constexpr vertex_idx_t outside_k = std::numeric_limits<vertex_idx_t>::max();
+    graph.neighbors.resize(neighbor_ids.size());
+    parallel_for(threads_count, neighbor_ids.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i != end; ++i) {
+            auto it = std::lower_bound(graph.ids.begin(), graph.ids.end(), neighbor_ids[i]);
+            bool const found = it != graph.ids.end() && *it == neighbor_ids[i];
+            graph.neighbors[i] = found ? static_cast<vertex_idx_t>(it - graph.ids.begin()) : outside_k;
+        }
+    });
+    if (!induced)
+        return;
+
+    edge_idx_t kept = 0;
+    bool const has_edges_ids = !graph.edges_ids.empty();
+    for (std::size_t i = 0; i != graph.size(); ++i) {
+        edge_idx_t const begin = graph.offsets[i];
+        edge_idx_t const end = graph.offsets[i + 1];
+        graph.offsets[i] = kept;
+        for (edge_idx_t e = begin; e != end; ++e) {
+            if (graph.neighbors[e] == outside_k)
+                continue;
+            graph.neighbors[kept] = graph.neighbors[e];
+            if (has_edges_ids)
+                graph.edges_ids[kept] = graph.edges_ids[e];
+            ++kept;
+        }
+    }
+    graph.offsets.back() = kept;
+    graph.neighbors.resize(kept);
+    if (has_edges_ids)
+        graph.edges_ids.resize(kept);
+}
+
+/**
+ * @brief Streams the adjacency of all vertices, exporting the neighbors in the given `role`,
+ * into a @b CSR snapshot.
+ */
+template <typename context_at>
+void csr_snapshot(context_at& c,
+                  ustore_vertex_role_t role,
+                  std::size_t threads_count,
+                  bool export_edges_ids,
+                  csr_graph_t& graph) noexcept(false) {
+
+    // Scanned keys are kept in a separate arena, as the graph lookups reuse the provided one
+    arena_t scan_arena(c.db);
+    std::vector<ustore_key_t> neighbor_ids;
+    graph.offsets.push_back(0);
+
+    ustore_key_t next_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_length_t const batch_limit = csr_read_ahead_k;
+    ustore_options_t const scan_options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+    while (next_key != ustore_key_unknown_k) {
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.transaction = c.transaction;
+        scan.snapshot = c.snapshot;
+        scan.arena = scan_arena.member_ptr();
+        scan.options = scan_options;
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &next_key;
+        scan.count_limits = &batch_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+
+        std::size_t count = found_counts[0];
+        next_key = count < batch_limit ? ustore_key_unknown_k : found_keys[count - 1] + 1;
+        if (!count)
+            break;
+
+        csr_append(c, role, found_keys, count, export_edges_ids, neighbor_ids, graph);
+        return_if_error_m(c.error);
+    }
+
+    // Edges can only link existing vertices, so every neighbor will be found
+    csr_link(neighbor_ids, threads_count, false, graph);
+}
+
+/**
+ * @brief Fetches the adjacency of the given vertices in batches, exporting the neighbors
+ * in the given `role`, into a @b CSR snapshot of the induced subgraph.
+ */
+template <typename context_at>
+void csr_subgraph_snapshot(context_at& c,
+                           ustore_vertex_role_t role,
+                           std::size_t threads_count,
+                           strided_range_gt<ustore_key_t const> vertices,
+                           bool export_edges_ids,
+                           csr_graph_t& graph) noexcept(false) {
+
+    std::vector<ustore_key_t> sorted_vertices(vertices.begin(), vertices.end());
+    std::sort(sorted_vertices.begin(), sorted_vertices.end());
+    sorted_vertices.erase(std::unique(sorted_vertices.begin(), sorted_vertices.end()), sorted_vertices.end());
+
+    std::vector<ustore_key_t> neighbor_ids;
+    graph.offsets.push_back(0);
+    for (std::size_t first = 0; first < sorted_vertices.size(); first += csr_read_ahead_k) {
+        std::size_t const count = std::min<std::size_t>(csr_read_ahead_k, sorted_vertices.size() - first);
+        csr_append(c, role, sorted_vertices.data() + first, count, export_edges_ids, neighbor_ids, graph);
+        return_if_error_m(c.error);
+    }
+
+    csr_link(neighbor_ids, threads_count, true, graph);
+}
+
+/**
+ * @brief Pull-based PageRank over a @b CSR of incoming edges.
+ * The mass of vertices without outgoing edges is evenly spread across the graph.
+ */
+void pagerank(csr_graph_t const& graph,
+              std::size_t threads_count,
+              std::size_t iterations,
+              double damping,
+              double tolerance,
+              ustore_float_t* scores) noexcept(false) {
+
+    std::size_t const count = graph.size();
+    if (!count)
+        return;
+
+    std::vector<vertex_idx_t> out_degrees(count, 0);
+    for (vertex_idx_t neighbor : graph.neighbors)
+        ++out_degrees[neighbor];
+
+    std::vector<double> ranks(count, 1.0 / count);
+    std::vector<double> next_ranks(count);
+    std::vector<double> contributions(count);
+    std::vector<double> partial_sums(threads_count);
+    auto reset_partial_sums = [&] { std::fill(partial_sums.begin(), partial_sums.end(), 0.0); };
+    auto sum_partial_sums = [&] { return std::accumulate(partial_sums.begin(), partial_sums.end(), 0.0); };
+
+    for (std::size_t iteration = 0; iteration != iterations; ++iteration) {
+
+        reset_partial_sums();
+        parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t thread_idx) {
+            double dangling = 0;
+            for (std::size_t i = begin; i != end; ++i) {
+                contributions[i] = out_degrees[i] ? ranks[i] / out_degrees[i] : 0.0;
+                dangling += out_degrees[i] ? 0.0 : ranks[i];
+            }
+            partial_sums[thread_idx] = dangling;
+        });
+        double const base = (1.0 - damping + damping * sum_partial_sums()) / count;
+
+        reset_partial_sums();
+        parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t thread_idx) {
+            double change = 0;
+            for (std::size_t i = begin; i != end; ++i) {
+                double incoming = 0;
+                for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e)
+                    incoming += contributions[graph.neighbors[e]];
+                next_ranks[i] = base + damping * incoming;
+                change += std::abs(next_ranks[i] - ranks[i]);
+            }
+            partial_sums[thread_idx] = change;
+        });
+
+        std::swap(ranks, next_ranks);
+        if (sum_partial_sums() < tolerance)
+            break;
+    }
+
+    std::copy(ranks.begin(), ranks.end(), scores);
+}
+
+/**
+ * @brief Concurrent Union-Find over the edges of a @b CSR.
+ * Roots are always hooked under smaller ones, so every component ends up
+ * labeled by the smallest vertex ID within it.
+ */
+void weakly_connected_components(csr_graph_t const& graph, std::size_t threads_count, ustore_key_t* labels) noexcept(
+    false) {
+
+    std::size_t const count = graph.size();
+    std::vector<std::atomic<vertex_idx_t>> parents(count);
+    parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i != end; ++i)
+            parents[i].store(static_cast<vertex_idx_t>(i), std::memory_order_relaxed);
+    });
+
+    // Parents never exceed children, which keeps the path halving safe with concurrent hooks
+    auto find_root = [&](vertex_idx_t i) noexcept {
+        while (true) {
+            vertex_idx_t parent = parents[i].load(std::memory_order_relaxed);
+            if (parent == i)
+                return i;
+            vertex_idx_t grand_parent = parents[parent].load(std::memory_order_relaxed);
+            if (grand_parent != parent)
+                parents[i].compare_exchange_weak(parent, grand_parent, std::memory_order_relaxed);
+            i = grand_parent;
+        }
+    };
+    auto unite = [&](vertex_idx_t a, vertex_idx_t b) noexcept {
+        while (true) {
+            a = find_root(a);
+            b = find_root(b);
+            if (a == b)
+                return;
+            if (a < b)
+                std::swap(a, b);
+            vertex_idx_t expected = a;
+            if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                return;
+        }
+    };
+
+    parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i != end; ++i)
+            for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e)
+                unite(static_cast<vertex_idx_t>(i), graph.neighbors[e]);
+    });
+    parallel_for(threads_count, count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i != end; ++i)
+            labels[i] = graph.ids[find_root(static_cast<vertex_idx_t>(i))];
+    });
+}
+
+/**
+ * @brief Computes the modularity of a partition, where `totals` are the sums of degrees
+ * of vertices in every community, and `degrees_sum` is twice the weight of all edges.
+ */
+double modularity(csr_graph_t const& graph,
+                  std::vector<vertex_idx_t> const& communities,
+                  std::vector<double> const& totals,
+                  double degrees_sum) noexcept {
+
+    double internal = 0;
+    for (std::size_t i = 0; i != graph.size(); ++i)
+        for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e)
+            internal += communities[graph.neighbors[e]] == communities[i] ? graph.weight(e) : 0.0;
+
+    double expected = 0;
+    for (double total : totals)
+        expected += (total / degrees_sum) * (total / degrees_sum);
+    return internal / degrees_sum - expected;
+}
+
+/**
+ * @brief Greedily moves vertices between neighboring communities, while the modularity
+ * grows by more than `tolerance` per pass. Returns the number of formed communities,
+ * renumbering them from zero, or zero if no vertex has moved.
+ */
+std::size_t louvain_local_moving(csr_graph_t const& graph,
+                                 double tolerance,
+                                 std::vector<vertex_idx_t>& communities,
+                                 double& result_modularity) noexcept(false) {
+
+    std::size_t const count = graph.size();
+    std::vector<double> degrees(count, 0.0);
+    for (std::size_t i = 0; i != count; ++i)
+        for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e)
+            degrees[i] += graph.weight(e);
+    double const degrees_sum = std::accumulate(degrees.begin(), degrees.end(), 0.0);
+    if (degrees_sum == 0)
+        return 0;
+
+    std::vector<double> totals(degrees);
+    communities.resize(count);
+    std::iota(communities.begin(), communities.end(), vertex_idx_t(0));
+
+    // Weights of links into neighboring communities, and the list of those to reset
+    std::vector<double> links(count, 0.0);
+    std::vector<vertex_idx_t> touched;
+
+    bool moved_any = false;
+    double current_modularity = modularity(graph, communities, totals, degrees_sum);
+    while (true) {
+        bool moved = false;
+        for (std::size_t i = 0; i != count; ++i) {
+            vertex_idx_t const old_community = communities[i];
+            for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e) {
+                vertex_idx_t const neighbor = graph.neighbors[e];
+                if (neighbor == i)
+                    continue;
+                vertex_idx_t const neighbor_community = communities[neighbor];
+                if (links[neighbor_community] == 0)
+                    touched.push_back(neighbor_community);
+                links[neighbor_community] += graph.weight(e);
+            }
+
+            // Take the vertex out of its community, and find the best one to put it in
+            double const share = degrees[i] / degrees_sum;
+            totals[old_community] -= degrees[i];
+            vertex_idx_t best_community = old_community;
+            double best_gain = links[old_community] - totals[old_community] * share;
+            for (vertex_idx_t community : touched) {
+                double gain = links[community] - totals[community] * share;
+                if (gain > best_gain)
+                    best_gain = gain, best_community = community;
+            }
+            totals[best_community] += degrees[i];
+            communities[i] = best_community;
+            moved |= best_community != old_community;
+
+            for (vertex_idx_t community : touched)
+                links[community] = 0;
+            links[old_community] = 0;
+            touched.clear();
+        }
+
+        if (!moved)
+            break;
+        moved_any = true;
+        double next_modularity = modularity(graph, communities, totals, degrees_sum);
+        bool const converged = next_modularity - current_modularity <= tolerance;
+        current_modularity = next_modularity;
+        if (converged)
+            break;
+    }
+
+    result_modularity = current_modularity;
+    if (!moved_any)
+        return 0;
+
+    // Renumber the remaining communities, to address them by offsets
+    std::vector<vertex_idx_t> renumbered(count, std::numeric_limits<vertex_idx_t>::max());
+    vertex_idx_t count_communities = 0;
+    for (vertex_idx_t& community : communities) {
+        if (renumbered[community] == std::numeric_limits<vertex_idx_t>::max())
+            renumbered[community] = count_communities++;
+        community = renumbered[community];
+    }
+    return count_communities;
+}
+
+/**
+ * @brief Collapses every community into a single vertex, summing up the weights of links.
+ * Links within a community become a weighted self-loop.
+ */
+csr_graph_t louvain_aggregate(csr_graph_t const& graph,
+                              std::vector<vertex_idx_t> const& communities,
+                              std::size_t count_communities) noexcept(false) {
+
+    // Group the vertices by community
+    std::vector<edge_idx_t> members_offsets(count_communities + 1, 0);
+    for (vertex_idx_t community : communities)
+        ++members_offsets[community + 1];
+    std::partial_sum(members_offsets.begin(), members_offsets.end(), members_offsets.begin());
+    std::vector<vertex_idx_t> members(graph.size());
+    std::vector<edge_idx_t> members_fill(members_offsets.begin(), members_offsets.end() - 1);
+    for (std::size_t i = 0; i != graph.size(); ++i)
+        members[members_fill[communities[i]]++] = static_cast<vertex_idx_t>(i);
+
+    csr_graph_t aggregated;
+    aggregated.offsets.reserve(count_communities + 1);
+    aggregated.offsets.push_back(0);
+    std::vector<double> links(count_communities, 0.0);
+    std::vector<vertex_idx_t> touched;
+    for (std::size_t community = 0; community != count_communities; ++community) {
+        for (edge_idx_t m = members_offsets[community]; m != members_offsets[community + 1]; ++m) {
+            vertex_idx_t const i = members[m];
+            for (edge_idx_t e = graph.offsets[i]; e != graph.offsets[i + 1]; ++e) {
+                vertex_idx_t const neighbor_community = communities[graph.neighbors[e]];
+                if (links[neighbor_community] == 0)
+                    touched.push_back(neighbor_community);
+                links[neighbor_community] += graph.weight(e);
+            }
+        }
+        for (vertex_idx_t neighbor_community : touched) {
+            aggregated.neighbors.push_back(neighbor_community);
+            aggregated.weights.push_back(links[neighbor_community]);
+            links[neighbor_community] = 0;
+        }
+        touched.clear();
+        aggregated.offsets.push_back(aggregated.neighbors.size());
+    }
+    return aggregated;
+}
+
+/**
+ * @brief Louvain Communities over a @b CSR of undirected edges, where every
+ * edge is present in the adjacency of both of its members.
+ */
+void louvain(csr_graph_t const& graph, std::size_t levels, double tolerance, ustore_key_t* labels) noexcept(false) {
+
+    std::size_t const count = graph.size();
+    std::vector<vertex_idx_t> memberships(count);
+    std::iota(memberships.begin(), memberships.end(), vertex_idx_t(0));
+
+    csr_graph_t aggregated;
+    csr_graph_t const* level_graph = &graph;
+    std::vector<vertex_idx_t> communities;
+    double last_modularity = -std::numeric_limits<double>::infinity();
+    for (std::size_t level = 0; level != levels; ++level) {
+        double level_modularity = 0;
+        std::size_t count_communities = louvain_local_moving(*level_graph, tolerance, communities, level_modularity);
+        if (!count_communities)
+            break;
+
+        for (vertex_idx_t& membership : memberships)
+            membership = communities[membership];
+        if (level_modularity - last_modularity <= tolerance || count_communities == level_graph->size())
+            break;
+
+        last_modularity = level_modularity;
+        aggregated = louvain_aggregate(*level_graph, communities, count_communities);
+        level_graph = &aggregated;
+    }
+
+    // Vertices are sorted, so the first member of every community has the smallest ID
+    std::vector<ustore_key_t> community_labels(count, ustore_key_unknown_k);
+    for (std::size_t i = 0; i != count; ++i) {
+        ustore_key_t& label = community_labels[memberships[i]];
+        if (label == ustore_key_unknown_k)
+            label = graph.ids[i];
+        labels[i] = label;
+    }
+}
+
+/*********************************************************/
+/*****************	    C Interface 	  ****************/
+/*********************************************************/
+
+void ustore_graph_analyze(ustore_graph_analyze_t* c_ptr) {
+
+    ustore_graph_analyze_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count && c.vertices, c.error, args_combo_k, "Analyzed vertices must be exported");
+    bool const ranks = c.algorithm == ustore_graph_pagerank_k;
+    bool const groups = c.algorithm == ustore_graph_components_k || c.algorithm == ustore_graph_communities_k;
+    return_error_if_m(ranks || groups, c.error, args_wrong_k, "Unknown graph algorithm");
+    return_error_if_m(!ranks || c.scores, c.error, args_combo_k, "PageRank exports scores");
+    return_error_if_m(!groups || c.labels, c.error, args_combo_k, "Components and Communities export labels");
+
+    std::size_t const iterations = c.iterations ? c.iterations : default_iterations_k;
+    std::size_t const threads_count = c.threads_count ? c.threads_count : threads_registry_t::global().get(c.db);
+    double const damping = c.damping != 0 ? c.damping : default_damping_k;
+    double const tolerance = c.tolerance != 0 ? c.tolerance
+                             : ranks          ? default_pagerank_tolerance_k
+                                              : default_louvain_tolerance_k;
+
+    // PageRank pulls the scores through incoming edges, Components need every edge once,
+    // and Communities need every edge in the adjacency of both of its members
+    ustore_vertex_role_t const role = c.algorithm == ustore_graph_pagerank_k     ? ustore_vertex_target_k
+                                      : c.algorithm == ustore_graph_components_k ? ustore_vertex_source_k
+                                                                                 : ustore_vertex_role_any_k;
+    csr_graph_t graph;
+    safe_section("Building a snapshot", c.error, [&] { csr_snapshot(c, role, threads_count, false, graph); });
+    return_if_error_m(c.error);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    std::size_t const count = graph.size();
+    auto vertices = arena.alloc<ustore_key_t>(count, c.error);
+    return_if_error_m(c.error);
+    std::copy(graph.ids.begin(), graph.ids.end(), vertices.begin());
+    *c.count = count;
+    *c.vertices = vertices.begin();
+
+    if (ranks) {
+        auto scores = arena.alloc<ustore_float_t>(count, c.error);
+        return_if_error_m(c.error);
+        safe_section("PageRank", c.error, [&] {
+            pagerank(graph, threads_count, iterations, damping, tolerance, scores.begin());
+        });
+        *c.scores = scores.begin();
+    }
+    else {
+        auto labels = arena.alloc<ustore_key_t>(count, c.error);
+        return_if_error_m(c.error);
+        if (c.algorithm == ustore_graph_components_k)
+            safe_section("Components", c.error, [&] {
+                weakly_connected_components(graph, threads_count, labels.begin());
+            });
+        else
+            safe_section("Communities", c.error, [&] { louvain(graph, iterations, tolerance, labels.begin()); });
+        *c.labels = labels.begin();
+    }
+}
+
+void ustore_graph_export_csr(ustore_graph_export_csr_t* c_ptr) {
+
+    ustore_graph_export_csr_t& c = *c_ptr;
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.count && c.vertices_ids && c.offsets && c.neighbors,
+                      c.error,
+                      args_combo_k,
+                      "Vertices, offsets and neighbors must be exported");
+    return_error_if_m(c.role == ustore_vertex_source_k || c.role == ustore_vertex_target_k ||
+                          c.role == ustore_vertex_role_any_k,
+                      c.error,
+                      args_wrong_k,
+                      "Unknown vertex role");
+
+    std::size_t const threads_count = c.threads_count ? c.threads_count : threads_registry_t::global().get(c.db);
+    bool const export_edges_ids = c.edges_ids;
+    csr_graph_t graph;
+    safe_section("Building a snapshot", c.error, [&] {
+        if (!c.vertices)
+            return csr_snapshot(c, c.role, threads_count, export_edges_ids, graph);
+        strided_iterator_gt<ustore_key_t const> vertices {c.vertices, c.vertices_stride};
+        csr_subgraph_snapshot(c, c.role, threads_count, {vertices, c.vertices_count}, export_edges_ids, graph);
+    });
+    return_if_error_m(c.error);
+
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    std::size_t const count = graph.size();
+    std::size_t const count_edges = graph.neighbors.size();
+    auto vertices = arena.alloc<ustore_key_t>(count, c.error);
+    return_if_error_m(c.error);
+    auto offsets = arena.alloc<ustore_size_t>(count + 1, c.error);
+    return_if_error_m(c.error);
+    auto neighbors = arena.alloc<ustore_length_t>(count_edges, c.error);
+    return_if_error_m(c.error);
+
+    static_assert(sizeof(ustore_length_t) == sizeof(vertex_idx_t), "Offsets of vertices are exported as is");
+    std::copy(graph.ids.begin(), graph.ids.end(), vertices.begin());
+    std::copy(graph.neighbors.begin(), graph.neighbors.end(), neighbors.begin());
+    std::copy(graph.offsets.begin(), graph.offsets.end(), offsets.begin());
+    *c.count = count;
+    *c.vertices_ids = vertices.begin();
+    *c.offsets = offsets.begin();
+    *c.neighbors = neighbors.begin();
+
+    if (export_edges_ids) {
+        auto edges_ids = arena.alloc<ustore_key_t>(count_edges, c.error);
+        return_if_error_m(c.error);
+        std::copy(graph.edges_ids.begin(), graph.edges_ids.end(), edges_ids.begin());
+        *c.edges_ids = edges_ids.begin();
+    }
+}
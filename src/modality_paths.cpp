@@ -7,24 +7,52 @@
  *
  * For every string key hash we store:
  * - N = number of entries (1 if no collisions appeared)
- * - N key offsets
+ * - N key lengths
  * - N value lengths
+ * - N one-byte fingerprints from an independent hash
  * - N concatenated keys
  * - N concatenated values
  *
+ * Lookups compare the fingerprints first, 16 at a time with SIMD,
+ * and only compare the keys of the members with matching fingerprints.
+ *
  * ## Mirror "Directory" Entries for Nested Paths
  *
- * Furthermore, we need to store mirror entries, that will
- * store the directory tree. In other words, for an input
- * like @b home/user/media/name we would keep:
- * - home/: @b home/user
- * - home/user/: @b home/user/media
- * - home/user/media/: @b home/user/media/name
+ * If a `path_separator` is passed on writes, we also store mirror
+ * entries, that store the directory tree. In other words, for an
+ * input like @b home/user/media/name we would keep:
+ * - home/: @b user/
+ * - home/user/: @b media/
+ * - home/user/media/: @b name
+ *
+ * Mirror entries live in the same hash buckets as regular paths,
+ * but their keys start with a NULL character, so they can't collide.
+ * Their values list the direct children in sorted order, each as
+ * a kind byte (file or directory), followed by a NULL-terminated name.
+ * Prefix matches, that contain the separator, walk that tree instead
+ * of scanning the whole collection.
+ *
+ * ## Native String Keys
  *
- * The mirror "directory" entries can have negative IDs.
- * Their values would be structured differently.
+ * Collections, created with a `{"keys": "strings"}` config on engines with ordered
+ * byte-string keys, store the paths as is, without buckets or mirror entries.
+ * Matches become range scans from their literal prefix, as the paths are sorted.
+ * A single request can't mix such collections with the hashed ones.
  */
 
+#include <string> // `std::string`
+#include <vector> // `std::vector`
+#include <memory> // `std::unique_ptr`
+#include <mutex>  // `std::unique_lock`
+#include <cctype> // `std::ispunct`
+#include <cstdint> // `std::uint64_t`
+
+#if defined(__SSE2__)
+#include <immintrin.h> // `_mm_cmpeq_epi8`
+#elif defined(__ARM_NEON)
+#include <arm_neon.h> // `vceqq_u8`
+#endif
+
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
 
@@ -35,6 +63,9 @@
 #include "helpers/linked_array.hpp"  // `uninitialized_array_gt`
 #include "helpers/algorithm.hpp"     // `sort_and_deduplicate`
 #include "helpers/full_scan.hpp"     // `full_scan_collection`
+#include "helpers/lru.hpp"           // `lru_cache_gt`
+#include "helpers/metrics.hpp"       // `operation_timer_t`
+#include "helpers/string_keys.hpp"   // `has_string_keys`
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -43,20 +74,121 @@
 using namespace unum::ustore;
 using namespace unum;
 
+using fingerprint_t = std::uint8_t;
+
+/**
+ * @brief Hashes the paths into bucket keys, following the structure of "wyhash".
+ * Independently derives a single-byte fingerprint, to tell apart the members of one bucket,
+ * as all of them share the same key.
+ */
 struct hash_t {
+    static constexpr std::uint64_t secret_k[4] = {
+        0xa0761d6478bd642full,
+        0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull,
+        0x589965cc75374cc3ull,
+    };
+
+    static std::uint64_t read8(char const* ptr) noexcept {
+        std::uint64_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
+
+    static std::uint64_t read4(char const* ptr) noexcept {
+        std::uint32_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
+
+    static std::uint64_t read3(char const* ptr, std::size_t length) noexcept {
+        auto byte = [=](std::size_t i) { return static_cast<std::uint64_t>(static_cast<std::uint8_t>(ptr[i])); };
+        return (byte(0) << 16) | (byte(length >> 1) << 8) | byte(length - 1);
+    }
+
+    /** @brief Replaces `a` and `b` with the low and high halves of their full product. */
+    static void multiply(std::uint64_t& a, std::uint64_t& b) noexcept {
+#if defined(__SIZEOF_INT128__)
+        __extension__ using uint128_t = unsigned __int128;
+        uint128_t product = static_cast<uint128_t>(a) * b;
+        a = static_cast<std::uint64_t>(product);
+        b = static_cast<std::uint64_t>(product >> 64);
+#else
+        std::uint64_t a_high = a >> 32, a_low = static_cast<std::uint32_t>(a);
+        std::uint64_t b_high = b >> 32, b_low = static_cast<std::uint32_t>(b);
+        std::uint64_t high = a_high * b_high, middle0 = a_high * b_low, middle1 = a_low * b_high, low = a_low * b_low;
+        std::uint64_t middle = (low >> 32) + static_cast<std::uint32_t>(middle0) + static_cast<std::uint32_t>(middle1);
+        a = (middle << 32) | static_cast<std::uint32_t>(low);
+        b = high + (middle0 >> 32) + (middle1 >> 32) + (middle >> 32);
+#endif
+    }
+
+    static std::uint64_t mix(std::uint64_t a, std::uint64_t b) noexcept {
+        multiply(a, b);
+        return a ^ b;
+    }
+
+    /** @brief Reduces a string into two words, from which both the key and the fingerprint are derived. */
+    static std::pair<std::uint64_t, std::uint64_t> absorb(std::string_view str) noexcept {
+        char const* ptr = str.data();
+        std::size_t const length = str.size();
+        std::uint64_t seed = secret_k[0];
+        std::uint64_t a = 0, b = 0;
+        if (length <= 16) {
+            if (length >= 4) {
+                std::size_t const shift = (length >> 3) << 2;
+                a = (read4(ptr) << 32) | read4(ptr + shift);
+                b = (read4(ptr + length - 4) << 32) | read4(ptr + length - 4 - shift);
+            }
+            else if (length > 0)
+                a = read3(ptr, length);
+        }
+        else {
+            std::size_t remaining = length;
+            if (remaining > 48) {
+                std::uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = mix(read8(ptr) ^ secret_k[1], read8(ptr + 8) ^ seed);
+                    seed1 = mix(read8(ptr + 16) ^ secret_k[2], read8(ptr + 24) ^ seed1);
+                    seed2 = mix(read8(ptr + 32) ^ secret_k[3], read8(ptr + 40) ^ seed2);
+                    ptr += 48, remaining -= 48;
+                } while (remaining > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            for (; remaining > 16; ptr += 16, remaining -= 16)
+                seed = mix(read8(ptr) ^ secret_k[1], read8(ptr + 8) ^ seed);
+            a = read8(ptr + remaining - 16);
+            b = read8(ptr + remaining - 8);
+        }
+        a ^= secret_k[1];
+        b ^= seed;
+        multiply(a, b);
+        return {a ^ secret_k[0] ^ length, b ^ secret_k[1]};
+    }
+
     ustore_key_t operator()(std::string_view key_str) const noexcept {
-        using ucset_t = std::hash<std::string_view>;
-        auto result = ucset_t {}(key_str);
+        auto [a, b] = absorb(key_str);
+        auto result = mix(a, b);
 #ifdef USTORE_DEBUG
         result %= 10ul;
 #endif
         return static_cast<ustore_key_t>(result);
     }
+
+    fingerprint_t fingerprint(std::string_view key_str) const noexcept {
+        auto [a, b] = absorb(key_str);
+        return static_cast<fingerprint_t>(mix(a ^ secret_k[2], b ^ secret_k[3]) >> 56);
+    }
 };
 
 constexpr std::size_t counter_size_k = sizeof(ustore_length_t);
 constexpr std::size_t bytes_in_header_k = counter_size_k;
 
+/** @brief Bytes preceding the keys: the header, the lengths counters and the fingerprints. */
+constexpr std::size_t bytes_for_metadata(std::size_t size) noexcept {
+    return bytes_in_header_k + size * (2u * counter_size_k + sizeof(fingerprint_t));
+}
+
 ustore_length_t get_bucket_size(value_view_t bucket) noexcept {
     auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
     return bucket.size() > bytes_in_header_k ? *lengths : 0u;
@@ -67,17 +199,19 @@ ptr_range_gt<ustore_length_t const> get_bucket_counters(value_view_t bucket, ust
     return {lengths, lengths + size * 2u + 1u};
 }
 
+fingerprint_t const* get_bucket_fingerprints(value_view_t bucket, ustore_length_t size) noexcept {
+    return reinterpret_cast<fingerprint_t const*>(bucket.data() + bytes_in_header_k + size * 2u * counter_size_k);
+}
+
 consecutive_strs_iterator_t get_bucket_keys(value_view_t bucket, ustore_length_t size) noexcept {
     auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    auto bytes_for_counters = size * 2u * counter_size_k;
-    return {lengths + 1u, bucket.data() + bytes_in_header_k + bytes_for_counters};
+    return {lengths + 1u, bucket.data() + bytes_for_metadata(size)};
 }
 
 consecutive_blobs_iterator_t get_bucket_vals(value_view_t bucket, ustore_length_t size) noexcept {
     auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
-    auto bytes_for_counters = size * 2u * counter_size_k;
     auto bytes_for_keys = std::accumulate(lengths + 1u, lengths + 1u + size, 0ul);
-    return {lengths + 1u + size, bucket.data() + bytes_in_header_k + bytes_for_counters + bytes_for_keys};
+    return {lengths + 1u + size, bucket.data() + bytes_for_metadata(size) + bytes_for_keys};
 }
 
 struct bucket_member_t {
@@ -99,25 +233,150 @@ void for_each_in_bucket(value_view_t bucket, bucket_member_callback_at member_ca
         member_callback(bucket_member_t {i, *bucket_keys, *bucket_vals});
 }
 
-bucket_member_t find_in_bucket(value_view_t bucket, std::string_view key_str) noexcept {
+/**
+ * @brief Passes the indexes of `fingerprints` equal to the `fingerprint` into the `callback`,
+ * until it returns true. Compares 16 fingerprints at a time, where SIMD is available.
+ */
+template <typename callback_at>
+void for_each_fingerprint_match(fingerprint_t const* fingerprints,
+                                std::size_t count,
+                                fingerprint_t fingerprint,
+                                callback_at callback) noexcept {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+    for (; i + 16 <= count; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(fingerprints + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        for (; mask; mask &= mask - 1u)
+            if (callback(i + __builtin_ctz(mask)))
+                return;
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t needle = vdupq_n_u8(fingerprint);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t matches = vceqq_u8(vld1q_u8(fingerprints + i), needle);
+        // Narrow every matching byte into a nibble of a 64-bit mask
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+        auto mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ull;
+        for (; mask; mask &= mask - 1u)
+            if (callback(i + (__builtin_ctzll(mask) >> 2)))
+                return;
+    }
+#endif
+    for (; i != count; ++i)
+        if (fingerprints[i] == fingerprint && callback(i))
+            return;
+}
+
+bucket_member_t find_in_bucket(value_view_t bucket, std::string_view key_str, fingerprint_t fingerprint) noexcept {
     bucket_member_t result;
-    for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
-        if (member.key == key_str)
-            result = member;
+    auto bucket_size = get_bucket_size(bucket);
+    if (!bucket_size)
+        return result;
+
+    // Only the members with matching fingerprints are compared in full
+    auto lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
+    auto keys_lengths = lengths + 1u;
+    auto vals_lengths = lengths + 1u + bucket_size;
+    auto keys_begin = bucket.data() + bytes_for_metadata(bucket_size);
+    auto fingerprints = get_bucket_fingerprints(bucket, bucket_size);
+    for_each_fingerprint_match(fingerprints, bucket_size, fingerprint, [&](std::size_t idx) noexcept {
+        if (keys_lengths[idx] != key_str.size())
+            return false;
+        auto key_offset = std::accumulate(keys_lengths, keys_lengths + idx, 0ul);
+        std::string_view key {reinterpret_cast<char const*>(keys_begin + key_offset), key_str.size()};
+        if (key != key_str)
+            return false;
+
+        auto bytes_for_keys = std::accumulate(keys_lengths + idx, keys_lengths + bucket_size, key_offset);
+        auto val_offset = std::accumulate(vals_lengths, vals_lengths + idx, 0ul);
+        result = {idx, key, value_view_t {keys_begin + bytes_for_keys + val_offset, vals_lengths[idx]}};
+        return true;
     });
     return result;
 }
 
+bucket_member_t find_in_bucket(value_view_t bucket, std::string_view key_str) noexcept {
+    return find_in_bucket(bucket, key_str, hash_t {}.fingerprint(key_str));
+}
+
 bool starts_with(std::string_view str, std::string_view prefix) noexcept {
     return str.size() >= prefix.size() && str.substr(0, prefix.size()) == prefix;
 }
 
-std::size_t path_segments_counts(std::string_view key_str, ustore_char_t const c_separator) noexcept {
-    return 0;
+/** @brief Starts the keys of mirror "directory" entries. */
+constexpr char directory_marker_k = '\0';
+
+/** @brief Number of compiled RegEx patterns kept between requests. */
+constexpr std::size_t regex_cache_capacity_k = 64;
+
+enum child_kind_t : char {
+    file_k = 1,
+    directory_k = 2,
+};
+
+inline bool is_directory_entry(std::string_view key_str) noexcept {
+    return !key_str.empty() && key_str.front() == directory_marker_k;
+}
+
+/**
+ * @brief The longest proper prefix of `path` ending with a `separator`,
+ * or an empty view, if the path is at the top level.
+ */
+std::string_view parent_directory(std::string_view path, ustore_char_t separator) noexcept {
+    if (path.size() < 2)
+        return {};
+    auto pos = path.rfind(separator, path.size() - 2);
+    return pos == std::string_view::npos ? std::string_view {} : path.substr(0, pos + 1);
 }
 
-template <typename keys_callback_at>
-void path_segments_enumerate(std::string_view key_str) noexcept {
+/** @brief Forms the key of the mirror entry of a `directory` in the reusable `output`. */
+std::string_view directory_entry_key(std::string_view directory, std::string& output) {
+    output.assign(1, directory_marker_k);
+    output.append(directory);
+    return output;
+}
+
+struct directory_child_t {
+    std::string_view name;
+    child_kind_t kind = file_k;
+
+    bool operator<(directory_child_t const& other) const noexcept {
+        return name != other.name ? name < other.name : kind < other.kind;
+    }
+    bool operator==(directory_child_t const& other) const noexcept {
+        return name == other.name && kind == other.kind;
+    }
+};
+
+/**
+ * @brief Sequentially decodes the children from the value of a mirror entry.
+ */
+class children_cursor_t {
+    char const* it_ = nullptr;
+    char const* end_ = nullptr;
+
+  public:
+    children_cursor_t(value_view_t listing) noexcept : it_(listing.c_str()), end_(listing.c_str() + listing.size()) {}
+
+    bool next(directory_child_t& child) noexcept {
+        if (it_ >= end_)
+            return false;
+        child.kind = static_cast<child_kind_t>(*it_++);
+        auto name_end = std::find(it_, end_, '\0');
+        child.name = {it_, static_cast<std::size_t>(name_end - it_)};
+        it_ = name_end + 1;
+        return true;
+    }
+};
+
+inline byte_t* append_child(byte_t* output, directory_child_t const& child) noexcept {
+    *output++ = static_cast<byte_t>(child.kind);
+    std::memcpy(output, child.name.data(), child.name.size());
+    output += child.name.size();
+    *output++ = byte_t {0};
+    return output;
 }
 
 bool is_prefix(std::string_view prefix_or_pattern) noexcept {
@@ -151,7 +410,7 @@ bool is_prefix(std::string_view prefix_or_pattern) noexcept {
  */
 value_view_t remove_part(value_view_t full, value_view_t part) noexcept {
     auto removed_length = part.size();
-    auto moved_length = full.size() - part.size();
+    auto moved_length = static_cast<std::size_t>(full.end() - part.end());
     std::memmove((void*)part.begin(), (void*)part.end(), moved_length);
     return {full.begin(), full.size() - removed_length};
 }
@@ -173,8 +432,13 @@ void remove_from_bucket(value_view_t& bucket, std::string_view key_str) noexcept
     bucket = remove_part(bucket, old_val);
     bucket = remove_part(bucket, old_key);
 
-    // Remove the value counter
+    // Remove the fingerprint
     auto begin = bucket.data();
+    value_view_t fingerprint_bytes {begin + bytes_in_header_k + counter_size_k * old_size * 2u + old_idx,
+                                    sizeof(fingerprint_t)};
+    bucket = remove_part(bucket, fingerprint_bytes);
+
+    // Remove the value counter
     value_view_t value_length_bytes {begin + counter_size_k * (old_size + old_idx + 1u), counter_size_k};
     bucket = remove_part(bucket, value_length_bytes);
     value_view_t key_length_bytes {begin + counter_size_k * (old_idx + 1u), counter_size_k};
@@ -193,19 +457,29 @@ void upsert_in_bucket( //
     ustore_error_t* c_error) noexcept {
 
     auto old_size = get_bucket_size(bucket);
-    auto old_bytes_for_counters = old_size * 2u * counter_size_k;
     auto old_lengths = reinterpret_cast<ustore_length_t const*>(bucket.data());
     auto old_bytes_for_keys = bucket ? std::accumulate(old_lengths + 1u, old_lengths + 1u + old_size, 0ul) : 0ul;
     auto old_bytes_for_vals =
         bucket ? std::accumulate(old_lengths + 1u + old_size, old_lengths + 1u + old_size * 2ul, 0ul) : 0ul;
-    auto [old_idx, old_key, old_val] = find_in_bucket(bucket, key);
+    auto fingerprint = hash_t {}.fingerprint(key);
+    auto [old_idx, old_key, old_val] = find_in_bucket(bucket, key, fingerprint);
     bool is_missing = !old_val;
 
+    // If the new value fits, patch the bucket in place, shifting the following values
+    if (!is_missing && val.size() <= old_val.size()) {
+        auto old_val_begin = const_cast<byte_t*>(old_val.begin());
+        std::memcpy(old_val_begin, val.begin(), val.size());
+        std::memmove(old_val_begin + val.size(), old_val.end(), static_cast<std::size_t>(bucket.end() - old_val.end()));
+        auto lengths = const_cast<ustore_length_t*>(old_lengths);
+        lengths[1u + old_size + old_idx] = static_cast<ustore_length_t>(val.size());
+        bucket = {bucket.begin(), bucket.size() - (old_val.size() - val.size())};
+        return;
+    }
+
     auto new_size = old_size + is_missing;
-    auto new_bytes_for_counters = new_size * 2u * counter_size_k;
     auto new_bytes_for_keys = old_bytes_for_keys - old_key.size() + key.size();
     auto new_bytes_for_vals = old_bytes_for_vals - old_val.size() + val.size();
-    auto new_bytes = bytes_in_header_k + new_bytes_for_counters + new_bytes_for_keys + new_bytes_for_vals;
+    auto new_bytes = bytes_for_metadata(new_size) + new_bytes_for_keys + new_bytes_for_vals;
 
     auto new_begin = arena.alloc<byte_t>(new_bytes, c_error).begin();
     return_if_error_m(c_error);
@@ -213,11 +487,14 @@ void upsert_in_bucket( //
     new_lengths[0] = new_size;
     auto new_keys_lengths = new_lengths + 1ul;
     auto new_vals_lengths = new_lengths + 1ul + new_size;
-    auto new_keys_output = new_begin + bytes_in_header_k + new_bytes_for_counters;
-    auto new_vals_output = new_begin + bytes_in_header_k + new_bytes_for_counters + new_bytes_for_keys;
+    auto new_fingerprints_begin = new_begin + bytes_in_header_k + new_size * 2u * counter_size_k;
+    auto new_fingerprints = reinterpret_cast<fingerprint_t*>(new_fingerprints_begin);
+    auto new_keys_output = new_begin + bytes_for_metadata(new_size);
+    auto new_vals_output = new_keys_output + new_bytes_for_keys;
 
     auto old_keys = get_bucket_keys(bucket, old_size);
     auto old_vals = get_bucket_vals(bucket, old_size);
+    auto old_fingerprints = get_bucket_fingerprints(bucket, old_size);
     std::size_t new_idx = 0;
     for (std::size_t i = 0; i != old_size; ++i, ++old_keys, ++old_vals) {
         if (!is_missing && i == old_idx)
@@ -227,6 +504,7 @@ void upsert_in_bucket( //
         value_view_t old_val = *old_vals;
         new_keys_lengths[new_idx] = static_cast<ustore_length_t>(old_key.size());
         new_vals_lengths[new_idx] = static_cast<ustore_length_t>(old_val.size());
+        new_fingerprints[new_idx] = old_fingerprints[i];
         std::memcpy(new_keys_output, old_key.data(), old_key.size());
         std::memcpy(new_vals_output, old_val.data(), old_val.size());
 
@@ -238,15 +516,187 @@ void upsert_in_bucket( //
     // Append the new entry at the end
     new_keys_lengths[new_idx] = static_cast<ustore_length_t>(key.size());
     new_vals_lengths[new_idx] = static_cast<ustore_length_t>(val.size());
+    new_fingerprints[new_idx] = fingerprint;
     std::memcpy(new_keys_output, key.data(), key.size());
     std::memcpy(new_vals_output, val.data(), val.size());
 
     bucket = {new_begin, new_bytes};
 }
 
+/**
+ * @brief Engines with native string keys override these definitions,
+ * while the others, like UDisk, keep hashing the paths into buckets.
+ */
+__attribute__((weak)) bool unum::ustore::has_string_keys(ustore_database_t, ustore_collection_t) noexcept {
+    return false;
+}
+
+__attribute__((weak)) void unum::ustore::read_strings(ustore_database_t,
+                                                      ustore_transaction_t,
+                                                      ustore_snapshot_t,
+                                                      strided_iterator_gt<ustore_collection_t const>,
+                                                      contents_arg_t const&,
+                                                      ustore_options_t,
+                                                      growing_tape_t&,
+                                                      ustore_error_t* c_error) noexcept {
+    log_error_m(c_error, missing_feature_k, "Engine has no native string keys!");
+}
+
+__attribute__((weak)) void unum::ustore::write_strings(ustore_database_t,
+                                                       ustore_transaction_t,
+                                                       strided_iterator_gt<ustore_collection_t const>,
+                                                       contents_arg_t const&,
+                                                       contents_arg_t const&,
+                                                       ustore_options_t,
+                                                       ustore_error_t* c_error) noexcept {
+    log_error_m(c_error, missing_feature_k, "Engine has no native string keys!");
+}
+
+__attribute__((weak)) void unum::ustore::scan_strings(ustore_database_t,
+                                                      ustore_transaction_t,
+                                                      ustore_collection_t,
+                                                      std::string_view,
+                                                      ustore_length_t,
+                                                      ustore_options_t,
+                                                      growing_tape_t&,
+                                                      ustore_error_t* c_error) noexcept {
+    log_error_m(c_error, missing_feature_k, "Engine has no native string keys!");
+}
+
+/**
+ * @brief Checks if the paths of a batch are stored with native string keys.
+ * Batches mixing such collections with the hashed ones are rejected.
+ */
+bool uses_string_keys(ustore_database_t c_db,
+                      strided_iterator_gt<ustore_collection_t const> collections,
+                      std::size_t count,
+                      ustore_error_t* c_error) noexcept {
+    auto collection_at = [&](std::size_t i) {
+        return collections ? collections[i] : ustore_collection_main_k;
+    };
+    bool const native = count && has_string_keys(c_db, collection_at(0));
+    for (std::size_t i = 1; i < count; ++i) {
+        if (collection_at(i) == collection_at(i - 1) || has_string_keys(c_db, collection_at(i)) == native)
+            continue;
+        log_error_m(c_error, args_combo_k, "Can't mix collections with and without string keys!");
+        return false;
+    }
+    return native;
+}
+
+/**
+ * @brief Pending change in the list of children of a directory.
+ */
+struct listing_update_t {
+    ustore_collection_t collection;
+    std::string_view directory;
+    directory_child_t child;
+    bool present;
+};
+
+/**
+ * @brief Applies the `updates` to the mirror entries in `buckets`, deepest directories first.
+ * Directories, that became empty or appeared, are then removed from or added to their parents.
+ * All the ancestors must already be present among the `buckets`.
+ */
+void update_directories( //
+    std::vector<listing_update_t>& updates,
+    ustore_char_t const c_separator,
+    ptr_range_gt<collection_key_t const> buckets_keys,
+    ptr_range_gt<value_view_t> buckets,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    hash_t hash;
+    std::string entry_key;
+    auto same_listing = [](listing_update_t const& a, listing_update_t const& b) noexcept {
+        return a.collection == b.collection && a.directory == b.directory;
+    };
+    auto deeper = [](listing_update_t const& a, listing_update_t const& b) noexcept {
+        if (a.directory.size() != b.directory.size())
+            return a.directory.size() > b.directory.size();
+        if (a.directory != b.directory)
+            return a.directory < b.directory;
+        if (a.collection != b.collection)
+            return a.collection < b.collection;
+        return a.child < b.child;
+    };
+
+    std::vector<listing_update_t> parents_updates;
+    while (!updates.empty()) {
+        // The sort is stable, so the last change of every child comes last
+        std::stable_sort(updates.begin(), updates.end(), deeper);
+        auto depth = updates.front().directory.size();
+        auto level_end = std::find_if(updates.begin(), updates.end(), [=](listing_update_t const& update) {
+            return update.directory.size() != depth;
+        });
+
+        for (auto group_begin = updates.begin(); group_begin != level_end;) {
+            auto group_end = std::find_if_not(group_begin, level_end, [&](listing_update_t const& update) {
+                return same_listing(update, *group_begin);
+            });
+            auto collection = group_begin->collection;
+            auto directory = group_begin->directory;
+            auto key_str = directory_entry_key(directory, entry_key);
+            auto bucket_idx = offset_in_sorted(buckets_keys, collection_key_t {collection, hash(key_str)});
+            value_view_t& bucket = buckets[bucket_idx];
+            value_view_t old_listing = find_in_bucket(bucket, key_str).value;
+
+            std::size_t max_length = old_listing.size();
+            for (auto it = group_begin; it != group_end; ++it)
+                max_length += it->child.name.size() + 2;
+            auto new_listing = arena.alloc<byte_t>(max_length, c_error);
+            return_if_error_m(c_error);
+
+            // Merge the sorted old children with the sorted changes
+            byte_t* output = new_listing.begin();
+            children_cursor_t old_children {old_listing};
+            directory_child_t old_child;
+            bool has_old = old_children.next(old_child);
+            for (auto it = group_begin; it != group_end; ++it) {
+                if (it + 1 != group_end && it[1].child == it->child)
+                    continue;
+                for (; has_old && old_child < it->child; has_old = old_children.next(old_child))
+                    output = append_child(output, old_child);
+                if (has_old && old_child == it->child)
+                    has_old = old_children.next(old_child);
+                if (it->present)
+                    output = append_child(output, it->child);
+            }
+            for (; has_old; has_old = old_children.next(old_child))
+                output = append_child(output, old_child);
+
+            bool const was_present = !old_listing.empty();
+            bool const is_present = output != new_listing.begin();
+            if (is_present) {
+                value_view_t listing {new_listing.begin(), output};
+                upsert_in_bucket(bucket, key_str, listing, arena, c_error);
+                return_if_error_m(c_error);
+            }
+            else
+                remove_from_bucket(bucket, key_str);
+
+            auto parent = parent_directory(directory, c_separator);
+            if (was_present != is_present && !parent.empty())
+                parents_updates.push_back(listing_update_t {
+                    collection,
+                    parent,
+                    directory_child_t {directory.substr(parent.size()), directory_k},
+                    is_present,
+                });
+            group_begin = group_end;
+        }
+
+        updates.erase(updates.begin(), level_end);
+        updates.insert(updates.end(), parents_updates.begin(), parents_updates.end());
+        parents_updates.clear();
+    }
+}
+
 void ustore_paths_write(ustore_paths_write_t* c_ptr) {
 
     ustore_paths_write_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::paths_write_k, c.tasks_count, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -256,16 +706,50 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     keys_str_args.contents_begin = {(ustore_bytes_cptr_t const*)c.paths, c.paths_stride};
     keys_str_args.count = c.tasks_count;
 
-    auto unique_col_keys = arena.alloc<collection_key_t>(c.tasks_count, c.error);
+    bits_view_t presences {c.values_presences};
+    strided_iterator_gt<ustore_length_t const> offs {c.values_offsets, c.values_offsets_stride};
+    strided_iterator_gt<ustore_length_t const> lens {c.values_lengths, c.values_lengths_stride};
+    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values_bytes, c.values_bytes_stride};
+    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    bool const native = uses_string_keys(c.db, collections, c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    if (native) {
+        // Sorted paths need no listings of directories
+        for (std::size_t i = 0; i != c.tasks_count; ++i) {
+            std::string_view key_str = keys_str_args[i];
+            return_error_if_m(!is_directory_entry(key_str), c.error, args_wrong_k, "Paths can't start with NULL");
+        }
+        write_strings(c.db, c.transaction, collections, keys_str_args, contents, c.options, c.error);
+        return;
+    }
+
+    uninitialized_array_gt<collection_key_t> col_keys(arena);
+    col_keys.reserve(c.tasks_count, c.error);
     return_if_error_m(c.error);
 
-    // Parse and hash input string unique_col_keys
+    // Parse and hash input string unique_col_keys,
+    // together with the mirror entries of all of their directories
     hash_t hash;
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    for (std::size_t i = 0; i != c.tasks_count; ++i)
-        unique_col_keys[i] = {collections ? collections[i] : ustore_collection_main_k, hash(keys_str_args[i])};
+    std::string entry_key;
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        std::string_view key_str = keys_str_args[i];
+        return_error_if_m(!is_directory_entry(key_str), c.error, args_wrong_k, "Paths can't start with NULL");
+        auto collection = collections ? collections[i] : ustore_collection_main_k;
+        col_keys.push_back({collection, hash(key_str)}, c.error);
+        return_if_error_m(c.error);
+        if (!c.path_separator)
+            continue;
+        for (auto dir = parent_directory(key_str, c.path_separator); !dir.empty();
+             dir = parent_directory(dir, c.path_separator)) {
+            col_keys.push_back({collection, hash(directory_entry_key(dir, entry_key))}, c.error);
+            return_if_error_m(c.error);
+        }
+    }
 
     // We must sort and deduplicate this bucket IDs
+    ptr_range_gt<collection_key_t> unique_col_keys {col_keys.begin(), col_keys.end()};
     unique_col_keys = {unique_col_keys.begin(), sort_and_deduplicate(unique_col_keys.begin(), unique_col_keys.end())};
 
     // Read from disk
@@ -304,28 +788,49 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     return_if_error_m(c.error);
     transform_n(joined_buckets.begin(), unique_places.count, updated_buckets.begin());
 
-    bits_view_t presences {c.values_presences};
-    strided_iterator_gt<ustore_length_t const> offs {c.values_offsets, c.values_offsets_stride};
-    strided_iterator_gt<ustore_length_t const> lens {c.values_lengths, c.values_lengths_stride};
-    strided_iterator_gt<ustore_bytes_cptr_t const> vals {c.values_bytes, c.values_bytes_stride};
-    contents_arg_t contents {presences, offs, lens, vals, c.tasks_count};
-
     // Update every unique bucket
-    for (std::size_t i = 0; i != c.tasks_count; ++i) {
-        std::string_view key_str = keys_str_args[i];
-        ustore_key_t key = hash(key_str);
-        value_view_t new_val = contents[i];
-        collection_key_t collection_key {collections ? collections[i] : ustore_collection_main_k, key};
-        auto bucket_idx = offset_in_sorted(unique_col_keys, collection_key);
-        value_view_t& bucket = updated_buckets[bucket_idx];
-
-        if (new_val) {
-            upsert_in_bucket(bucket, key_str, new_val, arena, c.error);
-            return_if_error_m(c.error);
+    std::vector<listing_update_t> listings_updates;
+    safe_section("Updating buckets", c.error, [&] {
+        for (std::size_t i = 0; i != c.tasks_count; ++i) {
+            std::string_view key_str = keys_str_args[i];
+            ustore_key_t key = hash(key_str);
+            value_view_t new_val = contents[i];
+            collection_key_t collection_key {collections ? collections[i] : ustore_collection_main_k, key};
+            auto bucket_idx = offset_in_sorted(unique_col_keys, collection_key);
+            value_view_t& bucket = updated_buckets[bucket_idx];
+            bool const existed = c.path_separator && find_in_bucket(bucket, key_str);
+
+            if (new_val) {
+                upsert_in_bucket(bucket, key_str, new_val, arena, c.error);
+                return_if_error_m(c.error);
+            }
+            else
+                remove_from_bucket(bucket, key_str);
+
+            // Files, that appeared or disappeared, must be reflected in their directories
+            auto parent = parent_directory(key_str, c.path_separator);
+            if (c.path_separator && existed != bool(new_val) && !parent.empty())
+                listings_updates.push_back(listing_update_t {
+                    collection_key.collection,
+                    parent,
+                    directory_child_t {key_str.substr(parent.size()), file_k},
+                    bool(new_val),
+                });
         }
-        else
-            remove_from_bucket(bucket, key_str);
-    }
+
+        update_directories(listings_updates,
+                           c.path_separator,
+                           {unique_col_keys.begin(), unique_col_keys.end()},
+                           {updated_buckets.begin(), updated_buckets.end()},
+                           arena,
+                           c.error);
+    });
+    return_if_error_m(c.error);
+
+    // Missing buckets, that remained empty, are exported as empty strings
+    for (value_view_t& bucket : updated_buckets)
+        if (bucket.empty())
+            bucket = {};
 
     ustore_write_t write {};
     write.db = c.db;
@@ -347,29 +852,30 @@ void ustore_paths_write(ustore_paths_write_t* c_ptr) {
     ustore_write(&write);
 }
 
-void ustore_paths_read(ustore_paths_read_t* c_ptr) {
-
-    ustore_paths_read_t& c = *c_ptr;
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
-
-    contents_arg_t keys_str_args;
-    keys_str_args.offsets_begin = {c.paths_offsets, c.paths_offsets_stride};
-    keys_str_args.lengths_begin = {c.paths_lengths, c.paths_lengths_stride};
-    keys_str_args.contents_begin = {(ustore_bytes_cptr_t const*)c.paths, c.paths_stride};
-    keys_str_args.count = c.tasks_count;
-
-    // Getting hash-collisions is such a rare case, that we will not
-    // optimize for it in the current implementation. Sorting and
-    // deduplicating the IDs will cost more overall, than a repeated
-    // read every once in a while.
-    auto buckets_keys = arena.alloc<ustore_key_t>(c.tasks_count, c.error);
+/**
+ * @brief Finds the values of the paths in their hash buckets.
+ */
+void read_in_buckets( //
+    ustore_paths_read_t const& c,
+    contents_arg_t const& keys_str_args,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    ptr_range_gt<value_view_t> found_values,
+    linked_memory_lock_t& arena) {
+
+    // Parse and hash input strings, sorting and deduplicating the buckets,
+    // so that every bucket is fetched and parsed once, regardless of
+    // the number of requested members and repetitions
+    auto col_keys = arena.alloc<collection_key_t>(c.tasks_count, c.error);
     return_if_error_m(c.error);
-
-    // Parse and hash input string buckets_keys
     hash_t hash;
     for (std::size_t i = 0; i != c.tasks_count; ++i)
-        buckets_keys[i] = hash(keys_str_args[i]);
+        col_keys[i] = {collections ? collections[i] : ustore_collection_main_k, hash(keys_str_args[i])};
+
+    auto unique_col_keys_copy = arena.alloc<collection_key_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    std::copy(col_keys.begin(), col_keys.end(), unique_col_keys_copy.begin());
+    ptr_range_gt<collection_key_t> unique_col_keys {unique_col_keys_copy.begin(), unique_col_keys_copy.end()};
+    unique_col_keys = {unique_col_keys.begin(), sort_and_deduplicate(unique_col_keys.begin(), unique_col_keys.end())};
 
     // Read from disk
     // We don't need:
@@ -378,17 +884,18 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     // We can infer those and export differently.
     ustore_length_t* buckets_offsets {};
     ustore_byte_t* buckets_values {};
+    auto unique_col_keys_strided = strided_range(unique_col_keys.begin(), unique_col_keys.end()).immutable();
     ustore_read_t read {};
     read.db = c.db;
     read.error = c.error;
     read.transaction = c.transaction;
     read.arena = arena;
     read.options = c.options;
-    read.tasks_count = c.tasks_count;
-    read.collections = c.collections;
-    read.collections_stride = c.collections_stride;
-    read.keys = buckets_keys.begin();
-    read.keys_stride = sizeof(ustore_key_t);
+    read.tasks_count = static_cast<ustore_size_t>(unique_col_keys.size());
+    read.collections = unique_col_keys_strided.members(&collection_key_t::collection).begin().get();
+    read.collections_stride = unique_col_keys_strided.members(&collection_key_t::collection).begin().stride();
+    read.keys = unique_col_keys_strided.members(&collection_key_t::key).begin().get();
+    read.keys_stride = unique_col_keys_strided.members(&collection_key_t::key).begin().stride();
     read.offsets = &buckets_offsets;
     read.values = &buckets_values;
 
@@ -396,38 +903,83 @@ void ustore_paths_read(ustore_paths_read_t* c_ptr) {
     return_if_error_m(c.error);
 
     // Some of the entries will contain more then one key-value pair in case of collisions.
-    ustore_length_t exported_volume = 0;
-    joined_blobs_t buckets {c.tasks_count, buckets_offsets, buckets_values};
-    auto presences =
-        arena.alloc_or_dummy(divide_round_up<std::size_t>(c.tasks_count, bits_in_byte_k), c.error, c.presences);
+    // Several tasks may share a bucket, so the values are gathered into a separate tape.
+    joined_blobs_t buckets {read.tasks_count, buckets_offsets, buckets_values};
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        value_view_t bucket = buckets[offset_in_sorted(unique_col_keys, col_keys[i])];
+        found_values[i] = find_in_bucket(bucket, keys_str_args[i]).value;
+    }
+}
+
+void ustore_paths_read(ustore_paths_read_t* c_ptr) {
+
+    ustore_paths_read_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::paths_read_k, c.tasks_count, c.error};
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    contents_arg_t keys_str_args;
+    keys_str_args.offsets_begin = {c.paths_offsets, c.paths_offsets_stride};
+    keys_str_args.lengths_begin = {c.paths_lengths, c.paths_lengths_stride};
+    keys_str_args.contents_begin = {(ustore_bytes_cptr_t const*)c.paths, c.paths_stride};
+    keys_str_args.count = c.tasks_count;
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    bool const native = uses_string_keys(c.db, collections, c.tasks_count, c.error);
+    return_if_error_m(c.error);
+
+    auto found_values = arena.alloc<value_view_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    if (native) {
+        growing_tape_t found_tape(arena);
+        found_tape.reserve(c.tasks_count, c.error);
+        return_if_error_m(c.error);
+        read_strings(c.db, c.transaction, c.snapshot, collections, keys_str_args, c.options, found_tape, c.error);
+        return_if_error_m(c.error);
+        embedded_blobs_t found = found_tape;
+        for (std::size_t i = 0; i != found.size(); ++i)
+            found_values[i] = found[i];
+    }
+    else {
+        read_in_buckets(c, keys_str_args, collections, found_values, arena);
+        return_if_error_m(c.error);
+    }
+
+    std::size_t exported_volume = 0;
+    for (value_view_t val : found_values)
+        exported_volume += val ? val.size() + 1 : 0;
+
+    auto presences = arena.alloc_or_dummy(c.tasks_count, c.error, c.presences);
+    return_if_error_m(c.error);
     auto lengths = arena.alloc_or_dummy(c.tasks_count, c.error, c.lengths);
-    auto offsets = arena.alloc_or_dummy(c.tasks_count, c.error, c.offsets);
+    return_if_error_m(c.error);
+    auto offsets = arena.alloc_or_dummy(c.tasks_count + 1, c.error, c.offsets);
+    return_if_error_m(c.error);
+    auto values = c.values ? arena.alloc<byte_t>(exported_volume, c.error) : ptr_range_gt<byte_t> {};
+    return_if_error_m(c.error);
 
+    exported_volume = 0;
     for (std::size_t i = 0; i != c.tasks_count; ++i) {
-        std::string_view key_str = keys_str_args[i];
-        value_view_t bucket = buckets[i];
-
-        // Now that we have found our match - clamp everything else.
-        value_view_t val = find_in_bucket(bucket, key_str).value;
+        value_view_t val = found_values[i];
+        offsets[i] = static_cast<ustore_length_t>(exported_volume);
         if (val) {
             presences[i] = true;
-            offsets[i] = exported_volume;
             lengths[i] = static_cast<ustore_length_t>(val.size());
-            if (c.values)
-                std::memmove(buckets_values + exported_volume, val.data(), val.size());
-            buckets_values[exported_volume + val.size()] = ustore_byte_t {0};
-            exported_volume += static_cast<ustore_length_t>(val.size()) + 1;
+            if (c.values) {
+                std::memcpy(values.begin() + exported_volume, val.data(), val.size());
+                values[exported_volume + val.size()] = byte_t {0};
+            }
+            exported_volume += val.size() + 1;
         }
         else {
             presences[i] = false;
-            offsets[i] = exported_volume;
             lengths[i] = ustore_length_missing_k;
         }
     }
 
-    offsets[c.tasks_count] = exported_volume;
+    offsets[c.tasks_count] = static_cast<ustore_length_t>(exported_volume);
     if (c.values)
-        *c.values = buckets_values;
+        *c.values = reinterpret_cast<ustore_byte_t*>(values.begin());
 }
 
 /**
@@ -456,7 +1008,7 @@ void full_scan_collection_w_predicate( //
     paths_count = 0;
     auto scan_in_bucket = [&](ustore_key_t, value_view_t bucket) noexcept {
         for_each_in_bucket(bucket, [&](bucket_member_t const& member) {
-            if (!predicate(member.key))
+            if (is_directory_entry(member.key) || !predicate(member.key))
                 // Skip irrelevant entries
                 return;
             if (member.key == previous_path) {
@@ -520,20 +1072,255 @@ void full_scan_w_prefix( //
         [=](std::string_view body) { return starts_with(body, prefix); });
 }
 
-struct pcre2_ctx_t {
-    linked_memory_lock_t& arena;
-    ustore_error_t* c_error;
-};
+/**
+ * @brief Reads a single member of a hash bucket, be it a regular path or a mirror entry.
+ * The result remains valid until the `arena` is discarded.
+ */
+value_view_t read_in_bucket( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_collection_t c_collection,
+    std::string_view key_str,
+    ustore_options_t const c_options,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) {
+
+    hash_t hash;
+    ustore_key_t key = hash(key_str);
+    ustore_length_t* bucket_offsets {};
+    ustore_byte_t* bucket_values {};
+    ustore_read_t read {};
+    read.db = c_db;
+    read.error = c_error;
+    read.transaction = c_transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(c_options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = 1;
+    read.collections = &c_collection;
+    read.keys = &key;
+    read.offsets = &bucket_offsets;
+    read.values = &bucket_values;
+    ustore_read(&read);
+    if (*c_error)
+        return {};
 
-static void* pcre2_malloc(PCRE2_SIZE length, void* ctx_ptr) noexcept {
-    pcre2_ctx_t& ctx = *reinterpret_cast<pcre2_ctx_t*>(ctx_ptr);
-    return ctx.arena.alloc<byte_t>(static_cast<std::size_t>(length), ctx.c_error).begin();
+    joined_blobs_t buckets {1, bucket_offsets, bucket_values};
+    return find_in_bucket(*buckets.begin(), key_str).value;
 }
 
-static void pcre2_free(void*, void*) noexcept {
-    // Our arenas only grow, we don't dealloc!
+/**
+ * @brief Lists the paths starting with a `prefix`, that contains the `separator`, walking
+ * the mirror "directory" entries. Starts from the deepest directory mentioned in the prefix.
+ * Children are sorted, so the paths are exported in lexicographic order, and the
+ * subtrees preceding the `previous_path` are skipped without being read.
+ * Only the paths passing the `predicate` are exported and counted.
+ */
+template <typename predicate_at>
+void directory_walk_w_prefix( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_collection_t c_collection,
+    ustore_char_t const c_separator,
+    std::string_view prefix,
+    std::string_view previous_path,
+    ustore_length_t c_count_limit,
+    ustore_options_t const c_options,
+    ustore_length_t& count,
+    growing_tape_t& paths,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error,
+    predicate_at predicate) {
+
+    count = 0;
+    std::string_view root = prefix.substr(0, prefix.rfind(c_separator) + 1);
+    auto export_path = [&](std::string_view path) {
+        if (!predicate(path))
+            return;
+        paths.push_back(path, c_error);
+        return_if_error_m(c_error);
+        paths.add_terminator(byte_t {0}, c_error);
+        return_if_error_m(c_error);
+        ++count;
+    };
+
+    // The directory itself can also be a path, which is listed in its parent, rather than in itself
+    if (prefix == root && root > previous_path) {
+        value_view_t value = read_in_bucket(c_db, c_transaction, c_collection, root, c_options, arena, c_error);
+        return_if_error_m(c_error);
+        if (value && c_count_limit)
+            export_path(root);
+        return_if_error_m(c_error);
+    }
+
+    // Depth-first traversal, where the top of the stack holds the next path in sorted order
+    struct visit_t {
+        std::string path;
+        child_kind_t kind;
+    };
+    std::vector<visit_t> stack;
+    stack.push_back({std::string(root), directory_k});
+    std::string entry_key;
+    while (!stack.empty() && count < c_count_limit) {
+        visit_t visit = std::move(stack.back());
+        stack.pop_back();
+        if (visit.kind == file_k) {
+            export_path(visit.path);
+            return_if_error_m(c_error);
+            continue;
+        }
+
+        auto key_str = directory_entry_key(visit.path, entry_key);
+        value_view_t listing = read_in_bucket(c_db, c_transaction, c_collection, key_str, c_options, arena, c_error);
+        return_if_error_m(c_error);
+
+        std::size_t const first_child = stack.size();
+        children_cursor_t children {listing};
+        for (directory_child_t child; children.next(child);) {
+            std::string path = visit.path;
+            path.append(child.name);
+            if (!starts_with(path, prefix))
+                continue;
+            bool const is_directory = child.kind == directory_k;
+            bool const is_passed = std::string_view(path) <= previous_path;
+            if (is_passed && !(is_directory && starts_with(previous_path, path)))
+                continue;
+            stack.push_back({std::move(path), child.kind});
+        }
+        std::reverse(stack.begin() + first_child, stack.end());
+    }
 }
 
+/**
+ * @brief Extracts the literal prefix, that every match of an anchored RegEx `pattern` must start with.
+ * Conservative: returns an empty string for unanchored patterns and for patterns with alternations.
+ */
+std::string regex_literal_prefix(std::string_view pattern) {
+    std::string prefix;
+    if (pattern.empty() || pattern.front() != '^' || pattern.find('|') != std::string_view::npos)
+        return prefix;
+
+    for (std::size_t i = 1; i != pattern.size(); ++i) {
+        char c = pattern[i];
+        bool const is_escaped_punctuation =
+            c == '\\' && i + 1 != pattern.size() && std::ispunct(static_cast<unsigned char>(pattern[i + 1]));
+        if (is_escaped_punctuation)
+            c = pattern[++i];
+        else if (!is_prefix(std::string_view(&c, 1)))
+            break;
+
+        // The quantifiers make the preceding character optional
+        char const next = i + 1 != pattern.size() ? pattern[i + 1] : '\0';
+        if (next == '?' || next == '*' || next == '{')
+            break;
+        prefix.push_back(c);
+    }
+    return prefix;
+}
+
+/**
+ * @brief Compiled RegEx pattern with its own matching state.
+ * Allocated with the default PCRE2 allocator, as it outlives the arenas of single requests.
+ */
+struct regex_t {
+    pcre2_code* code = nullptr;
+    pcre2_match_data* match_data = nullptr;
+    bool is_jit = false;
+
+    regex_t() = default;
+    regex_t(regex_t const&) = delete;
+    regex_t& operator=(regex_t const&) = delete;
+    ~regex_t() noexcept {
+        pcre2_match_data_free(match_data);
+        pcre2_code_free(code);
+    }
+
+    bool matches(std::string_view body) const noexcept {
+        // https://www.pcre.org/current/doc/html/pcre2_jit_match.html
+        auto subject = PCRE2_SPTR(body.data());
+        auto length = PCRE2_SIZE(body.size());
+        auto found_matches = is_jit ? pcre2_jit_match(code, subject, length, 0, PCRE2_NO_UTF_CHECK, match_data, NULL)
+                                    : pcre2_match(code, subject, length, 0, PCRE2_NO_UTF_CHECK, match_data, NULL);
+        return found_matches > 0;
+    }
+};
+
+using regex_ptr_t = std::unique_ptr<regex_t>;
+
+/**
+ * @brief Bounded LRU cache of compiled patterns, shared by all the requests.
+ * Patterns are checked out for the duration of a request, so the match data is
+ * never shared between threads. Concurrent requests for the same pattern will
+ * compile their own copies, and only one of them will be returned to the cache.
+ */
+class regex_cache_t {
+    std::mutex mutex_;
+    lru_cache_gt<std::string, regex_ptr_t> lru_ {regex_cache_capacity_k};
+
+    static void compile(std::string_view pattern, regex_ptr_t& result, ustore_error_t* c_error) noexcept {
+        regex_ptr_t regex {new (std::nothrow) regex_t};
+        return_error_if_m(regex, c_error, out_of_memory_k, "Failed to allocate a RegEx pattern");
+
+        // https://www.pcre.org/current/doc/html/pcre2_compile.html
+        int pcre2_pattern_error_code = 0;
+        PCRE2_SIZE pcre2_pattern_error_offset = 0;
+        regex->code = pcre2_compile( //
+            PCRE2_SPTR8(pattern.data()),
+            PCRE2_SIZE(pattern.size()),
+            PCRE2_MATCH_INVALID_UTF,
+            &pcre2_pattern_error_code,
+            &pcre2_pattern_error_offset,
+            NULL);
+        return_error_if_m(regex->code, c_error, args_wrong_k, "Failed to compile the RegEx query");
+
+        // https://www.pcre.org/current/doc/html/pcre2_jit_compile.html
+        // If the JIT isn't available on this platform, we fall back to the interpreter
+        regex->is_jit = pcre2_jit_compile(regex->code, PCRE2_JIT_COMPLETE) == 0;
+        regex->match_data = pcre2_match_data_create_from_pattern(regex->code, NULL);
+        return_error_if_m(regex->match_data,
+                          c_error,
+                          out_of_memory_k,
+                          "Failed to allocate memory for RegEx pattern matches");
+        result = std::move(regex);
+    }
+
+  public:
+    regex_ptr_t acquire(std::string_view pattern, ustore_error_t* c_error) noexcept {
+        std::string key {pattern};
+        {
+            std::unique_lock _ {mutex_};
+            if (auto cached = lru_.pop(key); cached)
+                return std::move(*cached);
+        }
+        regex_ptr_t regex;
+        compile(pattern, regex, c_error);
+        return regex;
+    }
+
+    void release(std::string_view pattern, regex_ptr_t regex) noexcept {
+        std::unique_lock _ {mutex_};
+        lru_.insert(std::string(pattern), std::move(regex));
+    }
+};
+
+static regex_cache_t regex_cache;
+
+/**
+ * @brief Returns the checked out pattern to the `regex_cache`, once the request is done with it.
+ */
+struct regex_lease_t {
+    std::string_view pattern;
+    regex_ptr_t regex;
+
+    regex_lease_t(std::string_view pattern, ustore_error_t* c_error) noexcept
+        : pattern(pattern), regex(regex_cache.acquire(pattern, c_error)) {}
+    ~regex_lease_t() noexcept {
+        if (regex)
+            regex_cache.release(pattern, std::move(regex));
+    }
+    explicit operator bool() const noexcept { return regex != nullptr; }
+    bool operator()(std::string_view body) const noexcept { return regex->matches(body); }
+};
+
 void full_scan_w_regex( //
     ustore_database_t const c_db,
     ustore_transaction_t const c_transaction,
@@ -547,66 +1334,83 @@ void full_scan_w_regex( //
     linked_memory_lock_t& arena,
     ustore_error_t* c_error) {
 
-    pcre2_ctx_t ctx {arena, c_error};
-
-    // https://www.pcre.org/current/doc/html/pcre2_compile.html
-    pcre2_general_context* pcre2_context = pcre2_general_context_create(&pcre2_malloc, &pcre2_free, &ctx);
-    pcre2_compile_context* pcre2_compile_context = pcre2_compile_context_create(pcre2_context);
-    int pcre2_pattern_error_code = 0;
-    PCRE2_SIZE pcre2_pattern_error_offset = 0;
-    pcre2_code* pcre2_code = pcre2_compile( //
-        PCRE2_SPTR8(pattern.data()),
-        PCRE2_SIZE(pattern.size()),
-        PCRE2_MATCH_INVALID_UTF,
-        &pcre2_pattern_error_code,
-        &pcre2_pattern_error_offset,
-        pcre2_compile_context);
-
-    // https://www.pcre.org/current/doc/html/pcre2_jit_compile.html
-    auto jit_status = pcre2_jit_compile(pcre2_code, PCRE2_JIT_COMPLETE);
-    if (jit_status != 0)
-        *c_error = "Failed to JIT-compile the RegEx query";
-
-    pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(pcre2_code, pcre2_context);
-    if (!match_data)
-        *c_error = "Failed to allocate memory for RegEx pattern matches";
-
-    if (!*c_error)
-        full_scan_collection_w_predicate( //
-            c_db,
-            c_transaction,
-            c_collection,
-            previous_path,
-            c_count_limit,
-            c_options,
-            count,
-            paths,
-            arena,
-            c_error,
-            [=](std::string_view body) {
-                // https://www.pcre.org/current/doc/html/pcre2_jit_match.html
-                // pcre2_match_data match_data;
-                // pcre2_match_context match_context;
-                auto found_matches = pcre2_jit_match( //
-                    pcre2_code,
-                    PCRE2_SPTR(body.data()),
-                    PCRE2_SIZE(body.size()),
-                    PCRE2_SIZE(0), // start offset
-                    PCRE2_NO_UTF_CHECK,
-                    match_data,
-                    NULL);
-                return found_matches > 0;
-            });
+    regex_lease_t regex {pattern, c_error};
+    return_if_error_m(c_error);
 
-    pcre2_match_data_free(match_data);
-    pcre2_code_free(pcre2_code);
-    pcre2_compile_context_free(pcre2_compile_context);
-    pcre2_general_context_free(pcre2_context);
+    std::string literal = regex_literal_prefix(pattern);
+    full_scan_collection_w_predicate( //
+        c_db,
+        c_transaction,
+        c_collection,
+        previous_path,
+        c_count_limit,
+        c_options,
+        count,
+        paths,
+        arena,
+        c_error,
+        [&](std::string_view body) { return starts_with(body, literal) && regex(body); });
+}
+
+/**
+ * @brief Lists the paths of a collection with native string keys, that start with a `prefix`,
+ * scanning the sorted keys from the `prefix` or right after the `previous_path`, until the first
+ * path without the `prefix`. Only the paths passing the `predicate` are exported and counted.
+ */
+template <typename predicate_at>
+void range_scan_w_prefix( //
+    ustore_database_t const c_db,
+    ustore_transaction_t const c_transaction,
+    ustore_collection_t c_collection,
+    std::string_view prefix,
+    std::string_view previous_path,
+    ustore_length_t c_count_limit,
+    ustore_options_t const c_options,
+    ustore_length_t& count,
+    growing_tape_t& paths,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error,
+    predicate_at predicate) {
+
+    // Appending a NULL character forms the smallest string following the previous one
+    count = 0;
+    std::string start_key {prefix};
+    if (!previous_path.empty() && previous_path >= prefix) {
+        start_key.assign(previous_path);
+        start_key.push_back('\0');
+    }
+
+    ustore_length_t const read_ahead = std::max<ustore_length_t>(c_count_limit, 2u);
+    growing_tape_t keys(arena);
+    while (count < c_count_limit) {
+        keys.clear();
+        scan_strings(c_db, c_transaction, c_collection, start_key, read_ahead, c_options, keys, c_error);
+        return_if_error_m(c_error);
+
+        embedded_blobs_t found = keys;
+        for (std::size_t i = 0; i != found.size() && count < c_count_limit; ++i) {
+            std::string_view path = found[i];
+            if (!starts_with(path, prefix))
+                return;
+            if (!predicate(path))
+                continue;
+            paths.push_back(path, c_error);
+            return_if_error_m(c_error);
+            paths.add_terminator(byte_t {0}, c_error);
+            return_if_error_m(c_error);
+            ++count;
+        }
+        if (found.size() < read_ahead)
+            return;
+        start_key.assign(std::string_view(found[found.size() - 1]));
+        start_key.push_back('\0');
+    }
 }
 
 void ustore_paths_match(ustore_paths_match_t* c_ptr) {
 
     ustore_paths_match_t const& c = *c_ptr;
+    operation_timer_t timer {operation_t::paths_match_k, c.tasks_count, c.error};
     linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
     return_if_error_m(c.error);
 
@@ -637,6 +1441,86 @@ void ustore_paths_match(ustore_paths_match_t* c_ptr) {
         auto pattern = patterns_args[i];
         auto previous = previous_args[i];
         auto limit = count_limits[i];
+        std::string_view pattern_str = pattern;
+        bool const is_literal = is_prefix(pattern);
+        std::string literal = is_literal ? std::string(pattern_str) : regex_literal_prefix(pattern_str);
+        if (has_string_keys(c.db, col)) {
+            // Sorted paths turn the literal prefix of any pattern into a range
+            safe_section("Scanning string keys", c.error, [&] {
+                if (is_literal) {
+                    range_scan_w_prefix(c.db,
+                                        c.transaction,
+                                        col,
+                                        literal,
+                                        previous,
+                                        limit,
+                                        c.options,
+                                        found_counts[i],
+                                        found_paths,
+                                        arena,
+                                        c.error,
+                                        [](std::string_view) { return true; });
+                    return;
+                }
+
+                regex_lease_t regex {pattern_str, c.error};
+                return_if_error_m(c.error);
+                range_scan_w_prefix(c.db,
+                                    c.transaction,
+                                    col,
+                                    literal,
+                                    previous,
+                                    limit,
+                                    c.options,
+                                    found_counts[i],
+                                    found_paths,
+                                    arena,
+                                    c.error,
+                                    [&](std::string_view path) { return regex(path); });
+            });
+            continue;
+        }
+
+        bool const has_directories = c.path_separator && literal.find(c.path_separator) != std::string::npos;
+        if (has_directories) {
+            // Both plain prefixes and anchored patterns can start from the deepest mentioned directory
+            safe_section("Walking directories", c.error, [&] {
+                if (is_literal) {
+                    directory_walk_w_prefix(c.db,
+                                            c.transaction,
+                                            col,
+                                            c.path_separator,
+                                            literal,
+                                            previous,
+                                            limit,
+                                            c.options,
+                                            found_counts[i],
+                                            found_paths,
+                                            arena,
+                                            c.error,
+                                            [](std::string_view) { return true; });
+                    return;
+                }
+
+                regex_lease_t regex {pattern_str, c.error};
+                return_if_error_m(c.error);
+                directory_walk_w_prefix(c.db,
+                                        c.transaction,
+                                        col,
+                                        c.path_separator,
+                                        literal,
+                                        previous,
+                                        limit,
+                                        c.options,
+                                        found_counts[i],
+                                        found_paths,
+                                        arena,
+                                        c.error,
+                                        [&](std::string_view path) { return regex(path); });
+            });
+            continue;
+        }
+
         auto func = is_prefix(pattern) ? &full_scan_w_prefix : &full_scan_w_regex;
         func(c.db,
              c.transaction,
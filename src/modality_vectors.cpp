@@ -10,15 +10,34 @@
  * During search relies on an algorithm resembling A*, adding a
  * stochastic component.
  */
-#include <cmath> // `std::sqrt`
+#include <cmath>     // `std::sqrt`
+#include <limits>    // `std::numeric_limits`
+#include <algorithm> // `std::push_heap`
+#include <cstring>   // `std::memcpy`
+#include <cstddef>   // `offsetof`
+#include <thread>    // `std::thread`
+#include <vector>    // `std::vector`
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "ustore/vectors.h"
 #include "ustore/cpp/ranges_args.hpp" // `places_arg_t`
 
 #include "helpers/linked_memory.hpp"          // `linked_memory_lock_t`
+#include "helpers/linked_array.hpp"           // `uninitialized_array_gt`
 #include "helpers/algorithm.hpp"              // `transform_n`
 #include "helpers/full_scan.hpp"              // `full_scan_collection`
 #include "helpers/limited_priority_queue.hpp" // `limited_priority_queue_gt`
+#include "helpers/threads.hpp"                // `threads_registry_t`
+#include "helpers/metrics.hpp"                // `operation_timer_t`
+#include "helpers/compression.hpp"            // `shuffle_lz4_compress`
+#if defined(USTORE_USE_CUDA)
+#include "helpers/vectors_cuda.hpp" // `cuda_search`
+#endif
 
 /*********************************************************/
 /*****************	 C++ Implementation	  ****************/
@@ -44,56 +63,321 @@ using pq_t = limited_priority_queue_gt<match_t, lower_similarity_t>;
 
 static constexpr quant_t float_scaling_k = 100;
 static constexpr quant_product_t product_scaling_k = float_scaling_k * float_scaling_k;
+static constexpr ustore_length_t exact_scan_read_ahead_k = 1024;
 
 template <typename number_at>
 number_at square(number_at n) noexcept {
     return n * n;
 }
 
-struct metric_dot_t {
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
+/*********************************************************/
+/*****************	   Distance Kernels	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Serial integer kernels over quantized vectors, the portable fallback.
+ * Every ISA-specific implementation exports the same three accumulators.
+ */
+struct isa_serial_t {
+    static std::int64_t dot(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
         std::int64_t sum = 0;
+        for (std::size_t i = 0; i != dims; ++i)
+            sum += quant_product_t(a[i]) * quant_product_t(b[i]);
+        return sum;
+    }
+
+    static void products(quant_t const* a,
+                         quant_t const* b,
+                         std::size_t dims,
+                         std::int64_t& ab,
+                         std::int64_t& aa,
+                         std::int64_t& bb) noexcept {
+        ab = 0, aa = 0, bb = 0;
         for (std::size_t i = 0; i != dims; ++i) {
             quant_product_t ai = a[i];
             quant_product_t bi = b[i];
-            sum += ai * bi;
+            ab += ai * bi;
+            aa += square(ai);
+            bb += square(bi);
         }
-        return real_t(sum) / product_scaling_k;
+    }
+
+    static std::int64_t l2sq(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i != dims; ++i)
+            sum += square<std::int32_t>(a[i] - b[i]);
+        return sum;
     }
 };
 
-struct metric_cos_t {
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
-        std::int64_t sum = 0, a_norm = 0, b_norm = 0;
-        for (std::size_t i = 0; i != dims; ++i) {
-            quant_product_t ai = a[i];
-            quant_product_t bi = b[i];
-            sum += ai * bi;
-            a_norm += square(ai);
-            b_norm += square(bi);
+#if defined(__x86_64__)
+
+/**
+ * @brief AVX2 kernels, widening 16x `int8` into `int16` and
+ * multiply-adding pairs of them into eight `int32` accumulators.
+ */
+struct isa_avx2_t {
+    __attribute__((target("avx2"))) static std::int64_t reduce(__m256i vec) noexcept {
+        alignas(32) std::int32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vec);
+        return std::int64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    }
+
+    __attribute__((target("avx2"))) static __m256i load(quant_t const* ptr) noexcept {
+        return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr)));
+    }
+
+    __attribute__((target("avx2"))) static std::int64_t dot(quant_t const* a,
+                                                            quant_t const* b,
+                                                            std::size_t dims) noexcept {
+        __m256i ab_vec = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 16 <= dims; i += 16)
+            ab_vec = _mm256_add_epi32(ab_vec, _mm256_madd_epi16(load(a + i), load(b + i)));
+        return reduce(ab_vec) + isa_serial_t::dot(a + i, b + i, dims - i);
+    }
+
+    __attribute__((target("avx2"))) static void products(quant_t const* a,
+                                                         quant_t const* b,
+                                                         std::size_t dims,
+                                                         std::int64_t& ab,
+                                                         std::int64_t& aa,
+                                                         std::int64_t& bb) noexcept {
+        __m256i ab_vec = _mm256_setzero_si256();
+        __m256i aa_vec = _mm256_setzero_si256();
+        __m256i bb_vec = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 16 <= dims; i += 16) {
+            __m256i a_vec = load(a + i);
+            __m256i b_vec = load(b + i);
+            ab_vec = _mm256_add_epi32(ab_vec, _mm256_madd_epi16(a_vec, b_vec));
+            aa_vec = _mm256_add_epi32(aa_vec, _mm256_madd_epi16(a_vec, a_vec));
+            bb_vec = _mm256_add_epi32(bb_vec, _mm256_madd_epi16(b_vec, b_vec));
+        }
+        isa_serial_t::products(a + i, b + i, dims - i, ab, aa, bb);
+        ab += reduce(ab_vec), aa += reduce(aa_vec), bb += reduce(bb_vec);
+    }
+
+    __attribute__((target("avx2"))) static std::int64_t l2sq(quant_t const* a,
+                                                             quant_t const* b,
+                                                             std::size_t dims) noexcept {
+        __m256i sum_vec = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 16 <= dims; i += 16) {
+            __m256i diff_vec = _mm256_sub_epi16(load(a + i), load(b + i));
+            sum_vec = _mm256_add_epi32(sum_vec, _mm256_madd_epi16(diff_vec, diff_vec));
+        }
+        return reduce(sum_vec) + isa_serial_t::l2sq(a + i, b + i, dims - i);
+    }
+};
+
+/**
+ * @brief AVX-512 kernels, processing 32x `int8` scalars per iteration.
+ */
+struct isa_avx512_t {
+    __attribute__((target("avx512f,avx512bw"))) static std::int64_t reduce(__m512i vec) noexcept {
+        alignas(64) std::int32_t lanes[16];
+        _mm512_store_si512(lanes, vec);
+        std::int64_t sum = 0;
+        for (std::int32_t lane : lanes)
+            sum += lane;
+        return sum;
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) static __m512i load(quant_t const* ptr) noexcept {
+        return _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr)));
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) static std::int64_t dot(quant_t const* a,
+                                                                        quant_t const* b,
+                                                                        std::size_t dims) noexcept {
+        __m512i ab_vec = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 32 <= dims; i += 32)
+            ab_vec = _mm512_add_epi32(ab_vec, _mm512_madd_epi16(load(a + i), load(b + i)));
+        return reduce(ab_vec) + isa_avx2_t::dot(a + i, b + i, dims - i);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) static void products(quant_t const* a,
+                                                                     quant_t const* b,
+                                                                     std::size_t dims,
+                                                                     std::int64_t& ab,
+                                                                     std::int64_t& aa,
+                                                                     std::int64_t& bb) noexcept {
+        __m512i ab_vec = _mm512_setzero_si512();
+        __m512i aa_vec = _mm512_setzero_si512();
+        __m512i bb_vec = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 32 <= dims; i += 32) {
+            __m512i a_vec = load(a + i);
+            __m512i b_vec = load(b + i);
+            ab_vec = _mm512_add_epi32(ab_vec, _mm512_madd_epi16(a_vec, b_vec));
+            aa_vec = _mm512_add_epi32(aa_vec, _mm512_madd_epi16(a_vec, a_vec));
+            bb_vec = _mm512_add_epi32(bb_vec, _mm512_madd_epi16(b_vec, b_vec));
+        }
+        isa_avx2_t::products(a + i, b + i, dims - i, ab, aa, bb);
+        ab += reduce(ab_vec), aa += reduce(aa_vec), bb += reduce(bb_vec);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) static std::int64_t l2sq(quant_t const* a,
+                                                                         quant_t const* b,
+                                                                         std::size_t dims) noexcept {
+        __m512i sum_vec = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 32 <= dims; i += 32) {
+            __m512i diff_vec = _mm512_sub_epi16(load(a + i), load(b + i));
+            sum_vec = _mm512_add_epi32(sum_vec, _mm512_madd_epi16(diff_vec, diff_vec));
+        }
+        return reduce(sum_vec) + isa_avx2_t::l2sq(a + i, b + i, dims - i);
+    }
+};
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+/**
+ * @brief NEON kernels, widening-multiplying 8x `int8` scalars into
+ * `int16` products and pairwise accumulating into `int32` lanes.
+ */
+struct isa_neon_t {
+    static std::int64_t dot(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        int32x4_t ab_vec = vdupq_n_s32(0);
+        std::size_t i = 0;
+        for (; i + 8 <= dims; i += 8)
+            ab_vec = vpadalq_s16(ab_vec, vmull_s8(vld1_s8(a + i), vld1_s8(b + i)));
+        return vaddlvq_s32(ab_vec) + isa_serial_t::dot(a + i, b + i, dims - i);
+    }
+
+    static void products(quant_t const* a,
+                         quant_t const* b,
+                         std::size_t dims,
+                         std::int64_t& ab,
+                         std::int64_t& aa,
+                         std::int64_t& bb) noexcept {
+        int32x4_t ab_vec = vdupq_n_s32(0);
+        int32x4_t aa_vec = vdupq_n_s32(0);
+        int32x4_t bb_vec = vdupq_n_s32(0);
+        std::size_t i = 0;
+        for (; i + 8 <= dims; i += 8) {
+            int8x8_t a_vec = vld1_s8(a + i);
+            int8x8_t b_vec = vld1_s8(b + i);
+            ab_vec = vpadalq_s16(ab_vec, vmull_s8(a_vec, b_vec));
+            aa_vec = vpadalq_s16(aa_vec, vmull_s8(a_vec, a_vec));
+            bb_vec = vpadalq_s16(bb_vec, vmull_s8(b_vec, b_vec));
+        }
+        isa_serial_t::products(a + i, b + i, dims - i, ab, aa, bb);
+        ab += vaddlvq_s32(ab_vec), aa += vaddlvq_s32(aa_vec), bb += vaddlvq_s32(bb_vec);
+    }
+
+    static std::int64_t l2sq(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        int32x4_t sum_vec = vdupq_n_s32(0);
+        std::size_t i = 0;
+        for (; i + 8 <= dims; i += 8) {
+            int16x8_t diff_vec = vsubl_s8(vld1_s8(a + i), vld1_s8(b + i));
+            sum_vec = vmlal_s16(sum_vec, vget_low_s16(diff_vec), vget_low_s16(diff_vec));
+            sum_vec = vmlal_high_s16(sum_vec, diff_vec, diff_vec);
         }
-        auto nominator = real_t(sum) / product_scaling_k;
-        auto denominator = std::sqrt(real_t(a_norm) / product_scaling_k) * //
-                           std::sqrt(real_t(b_norm) / product_scaling_k);
+        return vaddlvq_s32(sum_vec) + isa_serial_t::l2sq(a + i, b + i, dims - i);
+    }
+};
+
+#endif
+
+using metric_t = real_t (*)(quant_t const*, quant_t const*, std::size_t) noexcept;
+
+/**
+ * @brief Rescales the integer accumulators of any ISA into the final metrics.
+ */
+template <typename isa_at>
+struct metrics_gt {
+    static real_t dot(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        return real_t(isa_at::dot(a, b, dims)) / product_scaling_k;
+    }
+
+    static real_t cos(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        std::int64_t ab, aa, bb;
+        isa_at::products(a, b, dims, ab, aa, bb);
+        auto nominator = real_t(ab) / product_scaling_k;
+        auto denominator = std::sqrt(real_t(aa) / product_scaling_k) * //
+                           std::sqrt(real_t(bb) / product_scaling_k);
         return nominator / denominator;
     }
+
+    static real_t l2(quant_t const* a, quant_t const* b, std::size_t dims) noexcept {
+        return std::sqrt(real_t(isa_at::l2sq(a, b, dims)) / product_scaling_k);
+    }
 };
 
-struct metric_l2_t {
+struct metric_kernels_t {
+    metric_t dot = nullptr;
+    metric_t cos = nullptr;
+    metric_t l2 = nullptr;
+};
 
-    real_t operator()(quant_t const* a, std::size_t dims) const noexcept {
-        std::int64_t sum = 0;
-        for (std::size_t i = 0; i != dims; ++i)
-            sum += square<quant_product_t>(a[i]);
-        return std::sqrt(real_t(sum) / product_scaling_k);
+template <typename isa_at>
+metric_kernels_t make_metric_kernels() noexcept {
+    return {&metrics_gt<isa_at>::dot, &metrics_gt<isa_at>::cos, &metrics_gt<isa_at>::l2};
+}
+
+/**
+ * @brief Picks the widest kernels supported by the current CPU.
+ * The detection happens only once per process, on first use.
+ */
+metric_kernels_t const& metric_kernels() noexcept {
+    static metric_kernels_t const kernels = []() noexcept {
+#if defined(__x86_64__)
+        if (__builtin_cpu_supports("avx512bw"))
+            return make_metric_kernels<isa_avx512_t>();
+        if (__builtin_cpu_supports("avx2"))
+            return make_metric_kernels<isa_avx2_t>();
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+        return make_metric_kernels<isa_neon_t>();
+#endif
+        return make_metric_kernels<isa_serial_t>();
+    }();
+    return kernels;
+}
+
+metric_t metric_kernel(ustore_vector_metric_t kind) noexcept {
+    metric_kernels_t const& kernels = metric_kernels();
+    switch (kind) {
+    case ustore_vector_metric_dot_k: return kernels.dot;
+    case ustore_vector_metric_cos_k: return kernels.cos;
+    case ustore_vector_metric_l2_k: return kernels.l2;
+    default: return nullptr;
     }
+}
 
-    real_t operator()(quant_t const* a, quant_t const* b, std::size_t dims) const noexcept {
-        std::int64_t sum = 0;
-        for (std::size_t i = 0; i != dims; ++i)
-            sum += square<quant_product_t>(a[i] - b[i]);
-        return std::sqrt(real_t(sum) / product_scaling_k);
+/**
+ * @brief Computes the norm of a quantized vector in the same units, as the `cos` kernel.
+ */
+real_t quant_norm(quant_t const* quants, std::size_t dims) noexcept {
+    return std::sqrt(metric_kernels().dot(quants, quants, dims));
+}
+
+/**
+ * @brief Scores candidates so that higher is always better, flipping the sign
+ * of the Euclidean distance. The kernel is resolved once per request.
+ * With cached norms, the cosine similarity reduces to a single dot-product.
+ */
+struct similarity_t {
+    metric_t kernel = nullptr;
+    metric_t dot_kernel = nullptr;
+    real_t sign = 1;
+    std::size_t dimensions = 0;
+    bool normalized = false;
+
+    similarity_t(ustore_vector_metric_t kind, std::size_t dims) noexcept
+        : kernel(metric_kernel(kind)), dot_kernel(metric_kernels().dot),
+          sign(kind == ustore_vector_metric_l2_k ? -1 : 1), dimensions(dims),
+          normalized(kind == ustore_vector_metric_cos_k) {}
+
+    explicit operator bool() const noexcept { return kernel; }
+    bool needs_norms() const noexcept { return normalized; }
+    real_t operator()(quant_t const* a, quant_t const* b) const noexcept { return sign * kernel(a, b, dimensions); }
+    real_t operator()(quant_t const* a, real_t a_norm, quant_t const* b, real_t b_norm) const noexcept {
+        return normalized ? dot_kernel(a, b, dimensions) / (a_norm * b_norm) : operator()(a, b);
     }
+    real_t to_metric(real_t similarity) const noexcept { return sign * similarity; }
 };
 
 struct entry_t {
@@ -101,27 +385,45 @@ struct entry_t {
     value_view_t value;
 };
 
+/**
+ * @brief Converts IEEE 754 half-precision bits into a single-precision float.
+ */
+inline real_t f16_to_f32(std::uint16_t half) noexcept {
+    std::uint32_t sign = std::uint32_t(half & 0x8000u) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1Fu;
+    std::uint32_t mantissa = half & 0x3FFu;
+    if (!exponent) {
+        // Zeros and sub-normal numbers
+        real_t magnitude = std::ldexp(real_t(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    std::uint32_t bits = exponent == 0x1Fu //
+                             ? sign | 0x7F800000u | (mantissa << 13)
+                             : sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    real_t result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
 template <typename float_at = real_t>
 void quantize(float_at const* originals, std::size_t dims, quant_t* quants) noexcept {
     for (std::size_t i = 0; i != dims; ++i)
         quants[i] = static_cast<quant_t>(originals[i] * float_scaling_k);
 }
 
+void quantize_f16(std::uint16_t const* originals, std::size_t dims, quant_t* quants) noexcept {
+    for (std::size_t i = 0; i != dims; ++i)
+        quants[i] = static_cast<quant_t>(f16_to_f32(originals[i]) * float_scaling_k);
+}
+
 void quantize(byte_t const* bytes, ustore_vector_scalar_t scalar_type, std::size_t dims, quant_t* quants) noexcept {
     switch (scalar_type) {
     case ustore_vector_scalar_f32_k: return quantize((real_t const*)bytes, dims, quants);
     case ustore_vector_scalar_f64_k: return quantize((double const*)bytes, dims, quants);
-    case ustore_vector_scalar_f16_k: return quantize((std::int16_t const*)bytes, dims, quants);
-    case ustore_vector_scalar_i8_k: return quantize((quant_t const*)bytes, dims, quants);
-    }
-}
-
-real_t metric(quant_t const* a, quant_t const* b, std::size_t dims, ustore_vector_metric_t kind) noexcept {
-    switch (kind) {
-    case ustore_vector_metric_dot_k: return metric_dot_t {}(a, b, dims);
-    case ustore_vector_metric_cos_k: return metric_cos_t {}(a, b, dims);
-    case ustore_vector_metric_l2_k: return metric_l2_t {}(a, b, dims);
-    default: return 0;
+    case ustore_vector_scalar_f16_k: return quantize_f16((std::uint16_t const*)bytes, dims, quants);
+    // Integer inputs are considered to be already quantized
+    case ustore_vector_scalar_i8_k: std::memcpy(quants, bytes, dims); return;
     }
 }
 
@@ -153,229 +455,2361 @@ struct vectors_arg_t {
     }
 };
 
-void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
+/*********************************************************/
+/*****************	 Product Quantization	  ****************/
+/*********************************************************/
 
-    ustore_vectors_write_t& c = *c_ptr;
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+using pq_code_t = std::uint8_t;
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
-    places_arg_t places_args {collections, keys, {}, c.tasks_count};
+static constexpr std::size_t pq_centroids_k = 256;
+static constexpr std::size_t pq_training_iterations_k = 16;
+static constexpr ustore_length_t pq_default_samples_k = 16 * pq_centroids_k;
 
-    strided_iterator_gt<ustore_bytes_cptr_t const> starts {c.vectors_starts, c.vectors_starts_stride};
-    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
-    vectors_arg_t vectors_args {starts, offs, c.vectors_stride, c.scalar_type, c.dimensions, c.tasks_count};
+/**
+ * @brief Converts any supported scalars into floats, undoing the scaling of integer inputs.
+ */
+void dequantize(byte_t const* bytes, ustore_vector_scalar_t scalar_type, std::size_t dims, real_t* output) noexcept {
+    switch (scalar_type) {
+    case ustore_vector_scalar_f32_k: std::memcpy(output, bytes, dims * sizeof(real_t)); return;
+    case ustore_vector_scalar_f64_k:
+        for (std::size_t i = 0; i != dims; ++i) {
+            double scalar;
+            std::memcpy(&scalar, bytes + i * sizeof(double), sizeof(double));
+            output[i] = static_cast<real_t>(scalar);
+        }
+        return;
+    case ustore_vector_scalar_f16_k:
+        for (std::size_t i = 0; i != dims; ++i) {
+            std::uint16_t half;
+            std::memcpy(&half, bytes + i * sizeof(half), sizeof(half));
+            output[i] = f16_to_f32(half);
+        }
+        return;
+    case ustore_vector_scalar_i8_k:
+        for (std::size_t i = 0; i != dims; ++i)
+            output[i] = real_t(quant_t(bytes[i])) / float_scaling_k;
+        return;
+    }
+}
 
-    // For each input key we must get its
-    auto quantized_entries = arena.alloc<entry_t>(c.tasks_count * 2u, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Infers the type of stored original scalars from the length of the entry,
+ * as different writes into the same collection may use different types.
+ */
+bool scalar_type_of(ustore_length_t length, ustore_length_t dims, ustore_vector_scalar_t& scalar_type) noexcept {
+    if (length == dims * sizeof(real_t))
+        scalar_type = ustore_vector_scalar_f32_k;
+    else if (length == dims * sizeof(double))
+        scalar_type = ustore_vector_scalar_f64_k;
+    else if (length == dims * sizeof(std::uint16_t))
+        scalar_type = ustore_vector_scalar_f16_k;
+    else if (length == dims * sizeof(quant_t))
+        scalar_type = ustore_vector_scalar_i8_k;
+    else
+        return false;
+    return true;
+}
 
-    auto quantized_vectors = arena.alloc<quant_t>(c.tasks_count * c.dimensions, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Prefix of original vectors, compressed with `codec_t::shuffle_lz4_k`.
+ * Such entries are only stored, if their length can't be confused with any
+ * of the uncompressed ones, so older entries are read as they are.
+ */
+struct packed_original_t {
+    codec_t codec = codec_t::shuffle_lz4_k;
+    std::uint8_t scalar_size = 0;
+    std::uint16_t reserved = 0;
+    ustore_length_t length = 0;
+};
 
-    // Add the original entries
-    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
-        entry_t& entry = quantized_entries[task_idx];
-        entry.collection_key.collection = places_args[task_idx].collection;
-        entry.collection_key.key = places_args[task_idx].key;
-        entry.value = vectors_args[task_idx];
-    }
+bool original_is_packed(value_view_t bytes, ustore_length_t dims) noexcept {
+    ustore_vector_scalar_t scalar_type;
+    if (bytes.size() <= sizeof(packed_original_t) || scalar_type_of(bytes.size(), dims, scalar_type))
+        return false;
+    return static_cast<codec_t>(bytes.data()[0]) == codec_t::shuffle_lz4_k;
+}
 
-    // Add the mirror tasks for quantized copies
-    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
-        auto original_begin = vectors_args[task_idx].begin();
-        auto quantized_begin = quantized_vectors.begin() + task_idx * c.dimensions;
-        entry_t& entry = quantized_entries[c.tasks_count + task_idx];
-        entry.collection_key.collection = places_args[task_idx].collection;
-        entry.collection_key.key = -places_args[task_idx].key;
-        entry.value = value_view_t {(ustore_bytes_cptr_t)quantized_begin, c.dimensions};
-        quantize(original_begin, c.scalar_type, c.dimensions, quantized_begin);
-    }
+/**
+ * @brief Compresses the `original` vector into the `arena`, using a `scratch` space of its size.
+ * @return The `original` itself, if compression doesn't save space.
+ */
+value_view_t pack_original( //
+    value_view_t original,
+    ustore_length_t dims,
+    byte_t* scratch,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
 
-#if 0 // Future Complex Index Logic
+    ustore_vector_scalar_t scalar_type;
+    if (!scalar_type_of(original.size(), dims, scalar_type))
+        return original;
+    auto packed = arena.alloc<byte_t>( //
+        sizeof(packed_original_t) + compress_bound(codec_t::shuffle_lz4_k, original.size()),
+        c_error);
+    if (*c_error)
+        return {};
 
-    // Search greedily for closest entries to the provided vectors.
-    ustore_length_t starting_samples_limit = 128;
-    std::size_t max_search_rounds = 10;
-    std::size_t max_neighbors = 4;
+    packed_original_t header;
+    header.scalar_size = static_cast<std::uint8_t>(size_bytes(scalar_type));
+    header.length = static_cast<ustore_length_t>(original.size());
+    std::memcpy(packed.begin(), &header, sizeof(header));
+    std::size_t const payload_length = shuffle_lz4_compress(original,
+                                                            header.scalar_size,
+                                                            packed.begin() + sizeof(header),
+                                                            packed.size() - sizeof(header),
+                                                            scratch);
+    value_view_t result {packed.begin(), sizeof(header) + payload_length};
+    if (!payload_length || result.size() >= original.size() || !original_is_packed(result, dims))
+        return original;
+    return result;
+}
 
-    // First, we need to random sample some starting points.
-    ustore_length_t* starting_samples_offsets = NULL;
-    ustore_length_t* starting_samples_counts = NULL;
-    ustore_key_t* starting_samples_keys = NULL;
-    ustore_sample_t sample {};
-    sample.db = c.db;
-    sample.error = c.error;
-    sample.transaction = c.transaction;
-    sample.arena = c.arena;
-    sample.options = c.options;
-    sample.collections = &first.collection_key.collection;
-    sample.collections_stride = sizeof(entry_t);
-    sample.count_limits = &starting_samples_limit;
-    sample.count_limits_stride = 0;
-    sample.offsets = &starting_samples_offsets;
-    sample.counts = &starting_samples_counts;
-    sample.keys = &starting_samples_keys;
-    ustore_sample(&sample);
-    return_if_error_m(c.error);
+/**
+ * @brief Decompresses a single `stored` original into the `arena`, using a `scratch` space
+ * large enough for any vector of `dims` scalars.
+ * @return The `stored` value itself, if it wasn't compressed.
+ */
+value_view_t unpack_original( //
+    value_view_t stored,
+    ustore_length_t dims,
+    byte_t* scratch,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
 
-    // Allocate two priority queues per request.
-    // One will be used for top candidates, the other one for top results.
-    std::size_t bytes_per_queue = pq_t::implicit_memory_usage(max_neighbors);
-    std::size_t bytes_for_queues = c.tasks_count * 2ul * bytes_per_queue;
-    auto buffer_for_queues = arena.alloc<byte_t>(bytes_for_queues, c.error);
-    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
-        implicit_init(buffer_for_queues + bytes_per_queue * (task_idx * 2ul), max_neighbors);
-        implicit_init(buffer_for_queues + bytes_per_queue * (task_idx * 2ul + 1ul), max_neighbors);
-    }
-
-    // First organize connections between the vectors in
-    // the current batch mapping into the same space.
-    // ! This is a quadratic complexity step.
-    for (std::size_t a_idx = 0; a_idx != c.tasks_count; ++a_idx) {
-        auto a_place = places_args[a_idx];
-        auto a_quants = quantized_vectors.begin() + a_idx * c.dimensions;
-        for (std::size_t b_idx = 0; b_idx != c.tasks_count; ++b_idx) {
-            auto b_place = places_args[b_idx];
-            auto b_quants = quantized_vectors.begin() + b_idx * c.dimensions;
-            if (a_place.collection != b_place.collection)
-                continue;
+    if (!original_is_packed(stored, dims))
+        return stored;
+    packed_original_t header;
+    std::memcpy(&header, stored.data(), sizeof(header));
+    ustore_vector_scalar_t scalar_type;
+    if (!header.scalar_size || !scalar_type_of(header.length, dims, scalar_type)) {
+        log_error_m(c_error, consistency_k, "Corrupted compressed vector");
+        return {};
+    }
+    auto unpacked = arena.alloc<byte_t>(header.length, c_error);
+    if (*c_error)
+        return {};
+    value_view_t payload {stored.data() + sizeof(header), stored.size() - sizeof(header)};
+    if (!shuffle_lz4_decompress(payload, header.scalar_size, unpacked.begin(), header.length, scratch)) {
+        log_error_m(c_error, consistency_k, "Corrupted compressed vector");
+        return {};
+    }
+    return {unpacked.begin(), unpacked.size()};
+}
 
-            match_t match;
-            match.key = key;
-            match.metric = metric(a_quants, b_quants, c.dimensions, c.metric);
-            pq.push(match);
+/**
+ * @brief Decompresses the packed originals among the results of a read, that exported
+ * both `offsets` and `lengths`, replacing the `values` tape, if anything was packed.
+ */
+void unpack_originals( //
+    std::size_t count,
+    ustore_length_t dims,
+    ustore_length_t* offsets,
+    ustore_length_t* lengths,
+    ustore_byte_t** values,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    std::size_t unpacked_length = 0;
+    std::size_t scratch_length = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        if (lengths[i] == ustore_length_missing_k)
+            continue;
+        value_view_t bytes {*values + offsets[i], lengths[i]};
+        if (!original_is_packed(bytes, dims)) {
+            unpacked_length += bytes.size();
+            continue;
         }
+        packed_original_t header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        unpacked_length += header.length;
+        scratch_length = std::max<std::size_t>(scratch_length, header.length);
     }
+    if (!scratch_length)
+        return;
 
-    // Greedily search for multiple rounds.
+    auto tape = arena.alloc<byte_t>(unpacked_length, c_error);
+    return_if_error_m(c_error);
+    auto scratch = arena.alloc<byte_t>(scratch_length, c_error);
+    return_if_error_m(c_error);
+    ustore_length_t tape_offset = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        value_view_t bytes;
+        if (lengths[i] != ustore_length_missing_k)
+            bytes = value_view_t {*values + offsets[i], lengths[i]};
+        offsets[i] = tape_offset;
+        if (original_is_packed(bytes, dims)) {
+            packed_original_t header;
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            value_view_t payload {bytes.data() + sizeof(header), bytes.size() - sizeof(header)};
+            bool const unpacked = header.scalar_size && shuffle_lz4_decompress(payload,
+                                                                               header.scalar_size,
+                                                                               tape.begin() + tape_offset,
+                                                                               header.length,
+                                                                               scratch.begin());
+            return_error_if_m(unpacked, c_error, consistency_k, "Corrupted compressed vector");
+            lengths[i] = header.length;
+        }
+        else if (bytes.size())
+            std::memcpy(tape.begin() + tape_offset, bytes.data(), bytes.size());
+        tape_offset += lengths[i] != ustore_length_missing_k ? lengths[i] : 0;
+    }
+    offsets[count] = tape_offset;
+    *values = reinterpret_cast<ustore_byte_t*>(tape.begin());
+}
 
-    // Introduce bidirectional links.
-#endif
+real_t dot_floats(real_t const* a, real_t const* b, std::size_t dims) noexcept {
+    real_t sum = 0;
+    for (std::size_t i = 0; i != dims; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
 
-    // Submit both original and quantized entries
-    entry_t& first = quantized_entries[0];
-    ustore_write_t write {};
-    write.db = c.db;
-    write.error = c.error;
-    write.transaction = c.transaction;
-    write.arena = c.arena;
-    write.options = c.options;
-    write.tasks_count = c.tasks_count * 2u;
-    write.collections = &first.collection_key.collection;
-    write.collections_stride = sizeof(entry_t);
-    write.keys = &first.collection_key.key;
-    write.keys_stride = sizeof(entry_t);
-    write.lengths = first.value.member_length();
-    write.lengths_stride = sizeof(entry_t);
-    write.values = first.value.member_ptr();
-    write.values_stride = sizeof(entry_t);
-    ustore_write(&write);
+real_t l2sq_floats(real_t const* a, real_t const* b, std::size_t dims) noexcept {
+    real_t sum = 0;
+    for (std::size_t i = 0; i != dims; ++i)
+        sum += square(a[i] - b[i]);
+    return sum;
 }
 
-void ustore_vectors_read(ustore_vectors_read_t* c_ptr) {
+/**
+ * @brief Full-precision similarity, used to re-rank the results of compressed search.
+ */
+real_t similarity_floats(ustore_vector_metric_t kind, real_t const* a, real_t const* b, std::size_t dims) noexcept {
+    switch (kind) {
+    case ustore_vector_metric_dot_k: return dot_floats(a, b, dims);
+    case ustore_vector_metric_cos_k:
+        return dot_floats(a, b, dims) / std::sqrt(dot_floats(a, a, dims) * dot_floats(b, b, dims));
+    case ustore_vector_metric_l2_k: return -std::sqrt(l2sq_floats(a, b, dims));
+    default: return 0;
+    }
+}
 
-    ustore_vectors_read_t& c = *c_ptr;
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+/**
+ * @brief Codebooks of a compressed collection, with `pq_centroids_k` centroids per subspace.
+ * Compressed entries contain one code per subspace, followed by the norm of the original.
+ */
+struct pq_codebook_t {
+    real_t const* centroids = nullptr;
+    std::size_t subspaces = 0;
+    std::size_t subspace_dims = 0;
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
-    places_arg_t places_args {collections, keys, {}, c.tasks_count};
+    static std::size_t size_bytes(std::size_t dimensions) noexcept {
+        return pq_centroids_k * dimensions * sizeof(real_t);
+    }
 
-    auto vector_size = c.dimensions * size_bytes(c.scalar_type);
+    explicit operator bool() const noexcept { return centroids; }
+    std::size_t codes_bytes() const noexcept { return subspaces * sizeof(pq_code_t) + sizeof(real_t); }
+    real_t const* centroid(std::size_t subspace, std::size_t code) const noexcept {
+        return centroids + (subspace * pq_centroids_k + code) * subspace_dims;
+    }
 
-    // Read from disk, but potentially re-layout the data response.
-    ustore_read_t read {};
-    read.db = c.db;
-    read.error = c.error;
-    read.transaction = c.transaction;
-    read.arena = arena;
-    read.options = c.options;
-    read.tasks_count = c.tasks_count;
-    read.collections = c.collections;
-    read.collections_stride = c.collections_stride;
-    read.keys = keys.get();
-    read.keys_stride = keys.stride();
-    read.offsets = c.offsets;
-    read.presences = c.presences;
-    read.values = c.vectors;
-    ustore_read(&read);
-    return_if_error_m(c.error);
+    void encode(real_t const* vector, byte_t* output) const noexcept {
+        auto codes = reinterpret_cast<pq_code_t*>(output);
+        for (std::size_t subspace = 0; subspace != subspaces; ++subspace) {
+            real_t const* part = vector + subspace * subspace_dims;
+            std::size_t closest_code = 0;
+            real_t closest_distance = std::numeric_limits<real_t>::max();
+            for (std::size_t code = 0; code != pq_centroids_k; ++code) {
+                real_t distance = l2sq_floats(part, centroid(subspace, code), subspace_dims);
+                if (distance < closest_distance)
+                    closest_code = code, closest_distance = distance;
+            }
+            codes[subspace] = static_cast<pq_code_t>(closest_code);
+        }
+        real_t norm = std::sqrt(dot_floats(vector, vector, subspaces * subspace_dims));
+        std::memcpy(output + subspaces, &norm, sizeof(real_t));
+    }
 
-    // From here on, if we have the offsets don't form identical-length chunks,
-    // we must compact the range:
-}
+    /**
+     * @brief Approximates the original vector, concatenating the centroids of its codes.
+     */
+    void decode(byte_t const* entry, real_t* output) const noexcept {
+        auto codes = reinterpret_cast<pq_code_t const*>(entry);
+        for (std::size_t subspace = 0; subspace != subspaces; ++subspace)
+            std::memcpy(output + subspace * subspace_dims,
+                        centroid(subspace, codes[subspace]),
+                        subspace_dims * sizeof(real_t));
+    }
 
-void ustore_vectors_search(ustore_vectors_search_t* c_ptr) {
+    /**
+     * @brief Fills the asymmetric distance lookup table of a single query, with partial
+     * dot-products or squared distances between its parts and every centroid.
+     */
+    void fill_table(ustore_vector_metric_t kind, real_t const* query, real_t* table) const noexcept {
+        for (std::size_t subspace = 0; subspace != subspaces; ++subspace) {
+            real_t const* part = query + subspace * subspace_dims;
+            for (std::size_t code = 0; code != pq_centroids_k; ++code) {
+                real_t const* center = centroid(subspace, code);
+                table[subspace * pq_centroids_k + code] = kind == ustore_vector_metric_l2_k
+                                                              ? l2sq_floats(part, center, subspace_dims)
+                                                              : dot_floats(part, center, subspace_dims);
+            }
+        }
+    }
 
-    ustore_vectors_search_t const& c = *c_ptr;
-    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
-    return_if_error_m(c.error);
+    /**
+     * @brief Estimates the similarity between a query and a compressed entry,
+     * with a single table lookup per subspace. Higher is always better.
+     */
+    real_t score(ustore_vector_metric_t kind, real_t const* table, real_t query_norm, byte_t const* entry) const noexcept {
+        auto codes = reinterpret_cast<pq_code_t const*>(entry);
+        real_t sum = 0;
+        for (std::size_t subspace = 0; subspace != subspaces; ++subspace)
+            sum += table[subspace * pq_centroids_k + codes[subspace]];
+        switch (kind) {
+        case ustore_vector_metric_l2_k: return -std::sqrt(std::max(sum, real_t(0)));
+        case ustore_vector_metric_cos_k: {
+            real_t norm;
+            std::memcpy(&norm, codes + subspaces, sizeof(real_t));
+            return sum / (query_norm * norm);
+        }
+        default: return sum;
+        }
+    }
+};
 
-    strided_iterator_gt<ustore_bytes_cptr_t const> starts {c.queries_starts, c.queries_starts_stride};
-    strided_iterator_gt<ustore_length_t const> offs {c.queries_offsets, c.queries_offsets_stride};
-    vectors_arg_t queries_args {starts, offs, c.queries_stride, c.scalar_type, c.dimensions, c.tasks_count};
+/**
+ * @brief Trains the codebooks with Lloyd's K-Means algorithm, independently in every subspace.
+ * Centroids are initialized with evenly spaced samples.
+ */
+void pq_train( //
+    real_t const* samples,
+    std::size_t samples_count,
+    std::size_t dims,
+    std::size_t subspaces,
+    real_t* centroids,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
 
-    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
-    strided_range_gt<ustore_length_t const> count_limits {{c.match_counts_limits, c.match_counts_limits_stride},
-                                                       c.tasks_count};
+    std::size_t const subspace_dims = dims / subspaces;
+    auto sums = arena.alloc<real_t>(pq_centroids_k * subspace_dims, c_error);
+    return_if_error_m(c_error);
+    auto counts = arena.alloc<std::size_t>(pq_centroids_k, c_error);
+    return_if_error_m(c_error);
 
-    auto count_limits_max = ustore_length_t {0};
-    auto count_limits_sum = transform_reduce_n(count_limits.begin(), c.tasks_count, 0ul, [&](ustore_length_t l) {
-        count_limits_max = std::max(count_limits_max, l);
-        return l;
-    });
+    pq_codebook_t codebook {centroids, subspaces, subspace_dims};
+    for (std::size_t subspace = 0; subspace != subspaces; ++subspace) {
+        real_t* subspace_centroids = centroids + subspace * pq_centroids_k * subspace_dims;
+        auto part_of = [&](std::size_t sample) noexcept {
+            return samples + sample * dims + subspace * subspace_dims;
+        };
+        for (std::size_t code = 0; code != pq_centroids_k; ++code)
+            std::memcpy(subspace_centroids + code * subspace_dims,
+                        part_of(code * samples_count / pq_centroids_k),
+                        subspace_dims * sizeof(real_t));
 
-    auto found_counts = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_counts);
-    return_if_error_m(c.error);
-    auto found_offsets = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_offsets);
-    return_if_error_m(c.error);
-    auto found_keys = arena.alloc_or_dummy(count_limits_sum, c.error, c.match_keys);
+        for (std::size_t iteration = 0; iteration != pq_training_iterations_k; ++iteration) {
+            std::fill(sums.begin(), sums.end(), real_t(0));
+            std::fill(counts.begin(), counts.end(), std::size_t(0));
+            for (std::size_t sample = 0; sample != samples_count; ++sample) {
+                real_t const* part = part_of(sample);
+                std::size_t closest_code = 0;
+                real_t closest_distance = std::numeric_limits<real_t>::max();
+                for (std::size_t code = 0; code != pq_centroids_k; ++code) {
+                    real_t distance = l2sq_floats(part, codebook.centroid(subspace, code), subspace_dims);
+                    if (distance < closest_distance)
+                        closest_code = code, closest_distance = distance;
+                }
+                for (std::size_t i = 0; i != subspace_dims; ++i)
+                    sums[closest_code * subspace_dims + i] += part[i];
+                ++counts[closest_code];
+            }
+
+            // Empty clusters keep their previous centroids
+            for (std::size_t code = 0; code != pq_centroids_k; ++code)
+                for (std::size_t i = 0; counts[code] && i != subspace_dims; ++i)
+                    subspace_centroids[code * subspace_dims + i] = sums[code * subspace_dims + i] / counts[code];
+        }
+    }
+}
+
+/*********************************************************/
+/*****************	   Collection Schema	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Reserved key in the quantized half of every collection, that keeps its
+ * schema, including the parameters of the index and the entry point for the graph traversals.
+ * Its mirror would overflow, so it can't clash with user-provided keys.
+ */
+static constexpr ustore_key_t schema_key_k = std::numeric_limits<ustore_key_t>::min();
+static constexpr std::size_t index_initial_slots_k = 64;
+
+/**
+ * @brief Schemes of compressing vectors in the quantized half of a collection.
+ */
+enum quantization_t : std::uint32_t {
+    /** @brief Every scalar is scaled by `float_scaling_k` and truncated to `quant_t`. */
+    quantization_i8_k = 0,
+    /** @brief Parts of vectors are replaced with identifiers of the closest trained centroids. */
+    quantization_pq_k = 1,
+};
+
+/**
+ * @brief Written once per collection, on the first write into it. Quantized entries
+ * start with `dimensions` scalars, followed by their norm, so that the cosine similarity
+ * doesn't have to recompute it for every candidate. If the collection is indexed,
+ * the norm is followed by the adjacency list of the vertex. Collections compressed
+ * with Product Quantization store the codebooks right after the schema.
+ */
+struct schema_t {
+    /** @brief Mirrored key of the graph entry point, or `schema_key_k`, if the graph is empty. */
+    ustore_key_t entry_key = schema_key_k;
+    ustore_length_t dimensions = 0;
+    ustore_vector_scalar_t scalar_type = ustore_vector_scalar_f32_k;
+    quantization_t quantization = quantization_i8_k;
+    ustore_vector_metric_t metric = ustore_vector_metric_cos_k;
+    /** @brief Max degree of any vertex in the proximity graph, or zero, if the collection isn't indexed. */
+    ustore_length_t connectivity = 0;
+    /** @brief Number of codes per entry, if compressed with `quantization_pq_k`. */
+    ustore_length_t subspaces = 0;
+    /** @brief Compression of the original vectors. Missing in the schemas of older collections. */
+    codec_t originals_codec = codec_t::none_k;
+    /** @brief Set, if the originals were dropped by the compression, and only the codes are kept. */
+    bool originals_dropped = false;
+    /** @brief Set while the collection is being compressed, rejecting concurrent writes. */
+    bool compressing = false;
+    std::uint8_t reserved = 0;
+    /** @brief Incremented by every compression, so that it can detect being overtaken by another one. */
+    std::uint32_t version = 0;
+
+    bool has_graph() const noexcept { return connectivity && entry_key != schema_key_k; }
+};
+
+/**
+ * @brief Size of the schemas, written before the originals could be compressed.
+ */
+static constexpr std::size_t schema_legacy_bytes_k = offsetof(schema_t, originals_codec);
+
+/**
+ * @brief Per-collection schema state within a single batch.
+ */
+struct schema_state_t {
+    ustore_collection_t collection = ustore_collection_main_k;
+    schema_t schema;
+    real_t const* centroids = nullptr;
+    bool present = false;
+    bool modified = false;
+    /** @brief Set, if the index was just requested for a collection, that already has vectors. */
+    bool unindexed = false;
+};
+
+/**
+ * @brief Reads the schemas of all the collections involved in a batch.
+ * Missing schemas are exported with `present` set to false.
+ */
+ptr_range_gt<schema_state_t> read_schemas( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_options_t options,
+    strided_iterator_gt<ustore_collection_t const> collections,
+    std::size_t tasks_count,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    uninitialized_array_gt<schema_state_t> states(arena);
+    for (std::size_t i = 0; i != tasks_count; ++i) {
+        auto collection = collections ? collections[i] : ustore_collection_main_k;
+        auto it = std::find_if(states.begin(), states.end(), [=](schema_state_t const& state) {
+            return state.collection == collection;
+        });
+        if (it != states.end())
+            continue;
+        schema_state_t state;
+        state.collection = collection;
+        states.push_back(state, c_error);
+        if (*c_error)
+            return {};
+    }
+    if (!states.size())
+        return {};
+
+    ustore_length_t* found_offsets {};
+    ustore_length_t* found_lengths {};
+    ustore_byte_t* found_values {};
+    ustore_read_t read {};
+    read.db = db;
+    read.error = c_error;
+    read.transaction = transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = states.size();
+    read.collections = &states[0].collection;
+    read.collections_stride = sizeof(schema_state_t);
+    read.keys = &schema_key_k;
+    read.keys_stride = 0;
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    if (*c_error)
+        return {};
+
+    for (std::size_t i = 0; i != states.size(); ++i) {
+        schema_state_t& state = states[i];
+        ustore_length_t const length = found_lengths[i];
+        state.present = length != ustore_length_missing_k && length >= schema_legacy_bytes_k;
+        if (!state.present)
+            continue;
+
+        // Schemas of older collections lack the trailing fields, which keep their defaults
+        std::memcpy(&state.schema, found_values + found_offsets[i], schema_legacy_bytes_k);
+        std::size_t const centroids_count =
+            state.schema.quantization == quantization_pq_k ? state.schema.dimensions * pq_centroids_k : 0;
+        std::size_t const schema_bytes = length - std::min<std::size_t>(length, centroids_count * sizeof(real_t));
+        if (schema_bytes != schema_legacy_bytes_k && schema_bytes != sizeof(schema_t)) {
+            log_error_m(c_error, consistency_k, "Corrupted schema");
+            return {};
+        }
+        std::memcpy(&state.schema, found_values + found_offsets[i], schema_bytes);
+        if (!centroids_count)
+            continue;
+
+        // Copy the codebooks, as the values in the arena aren't aligned
+        auto centroids = arena.alloc<real_t>(centroids_count, c_error);
+        if (*c_error)
+            return {};
+        std::memcpy(centroids.begin(), found_values + found_offsets[i] + schema_bytes, length - schema_bytes);
+        state.centroids = centroids.begin();
+    }
+    return {states.begin(), states.end()};
+}
+
+schema_state_t* find_schema(ptr_range_gt<schema_state_t> states, ustore_collection_t collection) noexcept {
+    for (schema_state_t& state : states)
+        if (state.collection == collection)
+            return &state;
+    return nullptr;
+}
+
+/*********************************************************/
+/*****************	 Navigable Small World	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Vertex of the proximity graph. Serialized under the mirrored key, as quantized
+ * coordinates and their norm, followed by the degree and the mirrored keys of neighbors.
+ * So the exact search can still interpret the beginning of the entry as a vector.
+ */
+struct index_node_t {
+    ustore_collection_t collection = ustore_collection_main_k;
+    ustore_key_t key = 0;
+    quant_t const* quants = nullptr;
+    real_t norm = 0;
+    ustore_key_t* neighbors = nullptr;
+    ustore_length_t degree = 0;
+    std::size_t visited_round = 0;
+    bool missing = true;
+    bool modified = false;
+
+    ustore_length_t size_bytes(ustore_length_t dimensions) const noexcept {
+        return dimensions + sizeof(real_t) + sizeof(ustore_length_t) + degree * sizeof(ustore_key_t);
+    }
+};
+
+/**
+ * @brief Open-addressing hash-table of graph nodes, allocated in the arena.
+ * Lazily pulls missing nodes from the underlying BLOB store in batches and
+ * accumulates the modifications, until they are exported with a single write.
+ * Node addresses are stable, as they are allocated separately.
+ */
+class index_nodes_t {
+    ustore_database_t db_;
+    ustore_transaction_t transaction_;
+    ustore_options_t options_;
+    linked_memory_lock_t& arena_;
+    ustore_error_t* error_;
+    ustore_length_t dimensions_;
+
+    ptr_range_gt<index_node_t*> slots_;
+    std::size_t count_ = 0;
+    std::size_t round_ = 0;
+
+    static std::size_t hash(ustore_collection_t collection, ustore_key_t key) noexcept {
+        return collection_key_hash_t {}(collection_key_t {collection, key});
+    }
+
+    void rehash(std::size_t new_capacity) noexcept {
+        auto new_slots = arena_.alloc<index_node_t*>(new_capacity, error_);
+        return_if_error_m(error_);
+        std::fill(new_slots.begin(), new_slots.end(), nullptr);
+        std::size_t mask = new_capacity - 1;
+        for (index_node_t* node : slots_) {
+            if (!node)
+                continue;
+            std::size_t i = hash(node->collection, node->key) & mask;
+            while (new_slots[i])
+                i = (i + 1) & mask;
+            new_slots[i] = node;
+        }
+        slots_ = new_slots;
+    }
+
+  public:
+    index_nodes_t(ustore_database_t db,
+                  ustore_transaction_t transaction,
+                  ustore_options_t options,
+                  linked_memory_lock_t& arena,
+                  ustore_error_t* error,
+                  ustore_length_t dimensions) noexcept
+        : db_(db), transaction_(transaction), options_(options), arena_(arena), error_(error), dimensions_(dimensions) {}
+
+    std::size_t next_round() noexcept { return ++round_; }
+    ptr_range_gt<index_node_t* const> slots() const noexcept { return {slots_.begin(), slots_.end()}; }
+
+    index_node_t* find(ustore_collection_t collection, ustore_key_t key) const noexcept {
+        if (slots_.empty())
+            return nullptr;
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = hash(collection, key) & mask;; i = (i + 1) & mask) {
+            index_node_t* node = slots_[i];
+            if (!node || (node->key == key && node->collection == collection))
+                return node;
+        }
+    }
+
+    /**
+     * @brief Finds an existing node or allocates a missing one,
+     * reserving space for `connectivity + 1` neighbors.
+     */
+    index_node_t* emplace(ustore_collection_t collection, ustore_key_t key, ustore_length_t connectivity) noexcept {
+        if (index_node_t* node = find(collection, key))
+            return node;
+
+        if ((count_ + 1) * 2 > slots_.size()) {
+            rehash(std::max(slots_.size() * 2, index_initial_slots_k));
+            if (*error_)
+                return nullptr;
+        }
+
+        auto node = arena_.alloc<index_node_t>(1, error_);
+        if (*error_)
+            return nullptr;
+        auto neighbors = arena_.alloc<ustore_key_t>(connectivity + 1, error_);
+        if (*error_)
+            return nullptr;
+
+        index_node_t* node_ptr = new (node.begin()) index_node_t {};
+        node_ptr->collection = collection;
+        node_ptr->key = key;
+        node_ptr->neighbors = neighbors.begin();
+
+        std::size_t mask = slots_.size() - 1;
+        std::size_t i = hash(collection, key) & mask;
+        while (slots_[i])
+            i = (i + 1) & mask;
+        slots_[i] = node_ptr;
+        ++count_;
+        return node_ptr;
+    }
+
+    /**
+     * @brief Pulls all of the requested nodes, that aren't cached yet, with a single read.
+     */
+    void fetch(ustore_collection_t collection,
+               ustore_length_t connectivity,
+               ustore_key_t const* keys,
+               std::size_t count) noexcept {
+
+        uninitialized_array_gt<ustore_key_t> missing_keys(arena_);
+        for (std::size_t i = 0; i != count; ++i) {
+            if (find(collection, keys[i]))
+                continue;
+            missing_keys.push_back(keys[i], error_);
+            return_if_error_m(error_);
+        }
+        if (!missing_keys.size())
+            return;
+
+        ustore_length_t* found_offsets {};
+        ustore_length_t* found_lengths {};
+        ustore_byte_t* found_values {};
+        ustore_read_t read {};
+        read.db = db_;
+        read.error = error_;
+        read.transaction = transaction_;
+        read.arena = arena_;
+        read.options = ustore_options_t(options_ | ustore_option_dont_discard_memory_k);
+        read.tasks_count = missing_keys.size();
+        read.collections = &collection;
+        read.collections_stride = 0;
+        read.keys = missing_keys.begin();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        ustore_read(&read);
+        return_if_error_m(error_);
+
+        for (std::size_t i = 0; i != missing_keys.size(); ++i) {
+            index_node_t* node = emplace(collection, missing_keys[i], connectivity);
+            return_if_error_m(error_);
+
+            ustore_length_t const head_bytes = dimensions_ + sizeof(real_t) + sizeof(ustore_length_t);
+            ustore_length_t length = found_lengths[i];
+            if (length == ustore_length_missing_k || length < head_bytes)
+                continue;
+
+            auto begin = reinterpret_cast<byte_t const*>(found_values + found_offsets[i]);
+            ustore_length_t degree = 0;
+            std::memcpy(&node->norm, begin + dimensions_, sizeof(real_t));
+            std::memcpy(&degree, begin + dimensions_ + sizeof(real_t), sizeof(ustore_length_t));
+            degree = std::min(degree, connectivity);
+            degree = std::min<ustore_length_t>(degree, (length - head_bytes) / sizeof(ustore_key_t));
+
+            node->quants = reinterpret_cast<quant_t const*>(begin);
+            node->degree = degree;
+            node->missing = false;
+            std::memcpy(node->neighbors, begin + head_bytes, degree * sizeof(ustore_key_t));
+        }
+    }
+
+    void serialize(index_node_t const& node, byte_t* output) const noexcept {
+        std::memcpy(output, node.quants, dimensions_);
+        output += dimensions_;
+        std::memcpy(output, &node.norm, sizeof(real_t));
+        output += sizeof(real_t);
+        std::memcpy(output, &node.degree, sizeof(ustore_length_t));
+        output += sizeof(ustore_length_t);
+        std::memcpy(output, node.neighbors, node.degree * sizeof(ustore_key_t));
+    }
+};
+
+/**
+ * @brief Best-first beam search over the proximity graph, gathering up to
+ * `results.capacity()` nodes most similar to the `query` into `results`.
+ * The `excluded_key` is traversed, but never exported.
+ */
+void index_search( //
+    index_nodes_t& nodes,
+    ustore_collection_t collection,
+    schema_t const& header,
+    quant_t const* query,
+    real_t query_norm,
+    ustore_key_t excluded_key,
+    pq_t& results,
+    uninitialized_array_gt<match_t>& candidates,
+    ustore_error_t* c_error) noexcept {
+
+    std::size_t const round = nodes.next_round();
+    similarity_t const similarity {header.metric, header.dimensions};
+    candidates.clear();
+
+    nodes.fetch(collection, header.connectivity, &header.entry_key, 1);
+    return_if_error_m(c_error);
+    index_node_t* entry = nodes.find(collection, header.entry_key);
+    if (!entry || entry->missing)
+        return;
+
+    entry->visited_round = round;
+    match_t first {entry->key, similarity(query, query_norm, entry->quants, entry->norm)};
+    candidates.push_back(first, c_error);
+    return_if_error_m(c_error);
+    if (first.key != excluded_key)
+        results.push(first);
+
+    while (candidates.size()) {
+        std::pop_heap(candidates.begin(), candidates.end(), lower_similarity_t {});
+        match_t closest = candidates[candidates.size() - 1];
+        candidates.resize(candidates.size() - 1, c_error);
+        if (results.full() && closest.metric < results.back().metric)
+            break;
+
+        index_node_t* node = nodes.find(collection, closest.key);
+        nodes.fetch(collection, header.connectivity, node->neighbors, node->degree);
+        return_if_error_m(c_error);
+
+        for (ustore_length_t i = 0; i != node->degree; ++i) {
+            index_node_t* neighbor = nodes.find(collection, node->neighbors[i]);
+            if (!neighbor || neighbor->missing || neighbor->visited_round == round)
+                continue;
+
+            neighbor->visited_round = round;
+            match_t match {neighbor->key, similarity(query, query_norm, neighbor->quants, neighbor->norm)};
+            if (results.full() && match.metric <= results.back().metric)
+                continue;
+
+            candidates.push_back(match, c_error);
+            return_if_error_m(c_error);
+            std::push_heap(candidates.begin(), candidates.end(), lower_similarity_t {});
+            if (match.key != excluded_key)
+                results.push(match);
+        }
+    }
+}
+
+/**
+ * @brief Adds a @b back-link from `node` to `key`, evicting the
+ * least similar neighbor, if the connectivity limit is exceeded.
+ */
+void index_link( //
+    index_nodes_t& nodes,
+    schema_t const& header,
+    index_node_t& node,
+    ustore_key_t key,
+    ustore_error_t* c_error) noexcept {
+
+    if (std::find(node.neighbors, node.neighbors + node.degree, key) != node.neighbors + node.degree)
+        return;
+
+    node.neighbors[node.degree++] = key;
+    node.modified = true;
+    if (node.degree <= header.connectivity)
+        return;
+
+    nodes.fetch(node.collection, header.connectivity, node.neighbors, node.degree);
+    return_if_error_m(c_error);
+
+    similarity_t const similarity {header.metric, header.dimensions};
+    std::size_t worst_idx = 0;
+    real_t worst_similarity = std::numeric_limits<real_t>::max();
+    for (ustore_length_t i = 0; i != node.degree; ++i) {
+        index_node_t* neighbor = nodes.find(node.collection, node.neighbors[i]);
+        real_t neighbor_similarity = !neighbor || neighbor->missing
+                                         ? std::numeric_limits<real_t>::lowest()
+                                         : similarity(node.quants, node.norm, neighbor->quants, neighbor->norm);
+        if (neighbor_similarity < worst_similarity)
+            worst_idx = i, worst_similarity = neighbor_similarity;
+    }
+    node.neighbors[worst_idx] = node.neighbors[--node.degree];
+}
+
+/**
+ * @brief Inserts or updates a node in the proximity graph, connecting
+ * it to the closest present nodes, found with a beam search.
+ */
+void index_insert( //
+    index_nodes_t& nodes,
+    schema_state_t& state,
+    ustore_key_t key,
+    quant_t const* quants,
+    real_t norm,
+    uninitialized_array_gt<match_t>& results_buffer,
+    uninitialized_array_gt<match_t>& candidates,
+    ustore_error_t* c_error) noexcept {
+
+    schema_t& header = state.schema;
+    ustore_length_t const expansion = header.connectivity * 2u;
+    results_buffer.resize(expansion, c_error);
+    return_if_error_m(c_error);
+
+    pq_t results {results_buffer.begin(), results_buffer.begin() + expansion};
+    if (header.has_graph()) {
+        index_search(nodes, state.collection, header, quants, norm, key, results, candidates, c_error);
+        return_if_error_m(c_error);
+    }
+    else {
+        header.entry_key = key;
+        state.modified = true;
+    }
+
+    index_node_t* node = nodes.emplace(state.collection, key, header.connectivity);
+    return_if_error_m(c_error);
+    node->quants = quants;
+    node->norm = norm;
+    node->missing = false;
+    node->modified = true;
+    node->degree = static_cast<ustore_length_t>(std::min<std::size_t>(results.size(), header.connectivity));
+    for (ustore_length_t i = 0; i != node->degree; ++i)
+        node->neighbors[i] = results[i].key;
+
+    for (ustore_length_t i = 0; i != node->degree; ++i) {
+        index_node_t* neighbor = nodes.find(state.collection, node->neighbors[i]);
+        index_link(nodes, header, *neighbor, key, c_error);
+        return_if_error_m(c_error);
+    }
+}
+
+/**
+ * @brief Inserts the vectors, that were written into the collection before the index was requested,
+ * reusing their quantized copies. The whole collection is indexed within the same write.
+ */
+void index_backfill( //
+    ustore_vectors_write_t const& c,
+    index_nodes_t& nodes,
+    schema_state_t& state,
+    ustore_options_t read_options,
+    linked_memory_lock_t& arena,
+    uninitialized_array_gt<match_t>& results_buffer,
+    uninitialized_array_gt<match_t>& candidates) noexcept {
+
+    // Quantized copies are exported into the graph nodes, so they must outlive the scan arena
+    ustore_length_t const quantized_bytes = c.dimensions + sizeof(real_t);
+    ustore_arena_t scan_arena = nullptr;
+    auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
+        if (vector.size() < c.dimensions)
+            return true;
+        auto quantized = arena.alloc<byte_t>(quantized_bytes, c.error);
+        if (*c.error)
+            return false;
+
+        // Entries written before the schemas were introduced have no cached norms
+        auto quants = reinterpret_cast<quant_t const*>(quantized.begin());
+        real_t norm = 0;
+        std::memcpy(quantized.begin(), vector.data(), c.dimensions);
+        if (vector.size() >= quantized_bytes)
+            std::memcpy(&norm, vector.data() + c.dimensions, sizeof(real_t));
+        else
+            norm = quant_norm(quants, c.dimensions);
+        std::memcpy(quantized.begin() + c.dimensions, &norm, sizeof(real_t));
+
+        index_insert(nodes, state, key, quants, norm, results_buffer, candidates, c.error);
+        return !*c.error;
+    };
+    scan_range_collection(c.db,
+                          c.transaction,
+                          state.collection,
+                          read_options,
+                          schema_key_k + 1,
+                          0,
+                          exact_scan_read_ahead_k,
+                          &scan_arena,
+                          c.error,
+                          callback);
+    ustore_arena_free(scan_arena);
+}
+
+void write_vectors(ustore_vectors_write_t const& c, linked_memory_lock_t& arena) noexcept {
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    places_arg_t places_args {collections, keys, {}, c.tasks_count};
+
+    strided_iterator_gt<ustore_bytes_cptr_t const> starts {c.vectors_starts, c.vectors_starts_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.offsets, c.offsets_stride};
+    vectors_arg_t vectors_args {starts, offs, c.vectors_stride, c.scalar_type, c.dimensions, c.tasks_count};
+
+    // Validate the vectors against the schemas of collections, defining them on first write
+    auto read_options = ustore_options_t(c.options & ustore_option_transaction_dont_watch_k);
+    auto states = read_schemas(c.db, c.transaction, read_options, collections, c.tasks_count, arena, c.error);
     return_if_error_m(c.error);
-    auto found_metrics = arena.alloc_or_dummy(count_limits_sum, c.error, c.match_metrics);
+    for (schema_state_t& state : states) {
+        schema_t& schema = state.schema;
+        return_error_if_m(!schema.compressing, c.error, args_combo_k, "Collection is being compressed");
+        state.unindexed = state.present;
+        if (!state.present) {
+            schema.dimensions = c.dimensions;
+            schema.scalar_type = c.scalar_type;
+            schema.metric = c.metric;
+            state.present = true;
+            state.modified = true;
+        }
+        return_error_if_m(schema.dimensions == c.dimensions,
+                          c.error,
+                          args_combo_k,
+                          "Vectors dimensions don't match the collection schema");
+        if (!schema.connectivity && c.index_connectivity) {
+            return_error_if_m(schema.quantization != quantization_pq_k,
+                              c.error,
+                              args_combo_k,
+                              "Compressed collections can't be indexed");
+            schema.connectivity = c.index_connectivity;
+            schema.metric = c.metric;
+            state.modified = true;
+        }
+        else
+            state.unindexed = false;
+    }
+
+    // Quantize or compress all the vectors, following every one of them with its norm
+    ustore_length_t const quantized_bytes = c.dimensions + sizeof(real_t);
+    auto quantized_vectors = arena.alloc<byte_t>(c.tasks_count * quantized_bytes, c.error);
+    return_if_error_m(c.error);
+    auto quantized_norms = arena.alloc<real_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto quantized_lengths = arena.alloc<ustore_length_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto decoded_vector = arena.alloc<real_t>(c.dimensions, c.error);
     return_if_error_m(c.error);
+    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
+        auto original_begin = vectors_args[task_idx].begin();
+        auto quantized_begin = quantized_vectors.begin() + task_idx * quantized_bytes;
+        schema_state_t const& state = *find_schema(states, places_args[task_idx].collection);
+        if (state.centroids) {
+            pq_codebook_t codebook {state.centroids, state.schema.subspaces, c.dimensions / state.schema.subspaces};
+            dequantize(original_begin, c.scalar_type, c.dimensions, decoded_vector.begin());
+            codebook.encode(decoded_vector.begin(), quantized_begin);
+            quantized_lengths[task_idx] = codebook.codes_bytes();
+            continue;
+        }
 
-    auto temp_matches = arena.alloc<match_t>(count_limits_max, c.error);
+        quantize(original_begin, c.scalar_type, c.dimensions, (quant_t*)quantized_begin);
+        quantized_norms[task_idx] = quant_norm((quant_t const*)quantized_begin, c.dimensions);
+        std::memcpy(quantized_begin + c.dimensions, &quantized_norms[task_idx], sizeof(real_t));
+        quantized_lengths[task_idx] = quantized_bytes;
+    }
+
+    // Update the approximate search index, if it exists or was requested
+    index_nodes_t nodes {c.db, c.transaction, read_options, arena, c.error, c.dimensions};
+    uninitialized_array_gt<match_t> results_buffer(arena);
+    uninitialized_array_gt<match_t> candidates(arena);
+    for (schema_state_t& state : states) {
+        if (!state.unindexed)
+            continue;
+        index_backfill(c, nodes, state, read_options, arena, results_buffer, candidates);
+        return_if_error_m(c.error);
+    }
+    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
+        schema_state_t& state = *find_schema(states, places_args[task_idx].collection);
+        if (!state.schema.connectivity)
+            continue;
+
+        auto quantized_begin = (quant_t const*)(quantized_vectors.begin() + task_idx * quantized_bytes);
+        index_insert(nodes,
+                     state,
+                     -places_args[task_idx].key,
+                     quantized_begin,
+                     quantized_norms[task_idx],
+                     results_buffer,
+                     candidates,
+                     c.error);
+        return_if_error_m(c.error);
+    }
+
+    // Add the original entries, compressing them, if the collection asks for it
+    uninitialized_array_gt<entry_t> entries(arena);
+    auto pack_scratch = arena.alloc<byte_t>(c.dimensions * sizeof(double), c.error);
     return_if_error_m(c.error);
-    auto quant_query = arena.alloc<quant_t>(c.dimensions, c.error);
+    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
+        schema_state_t const& state = *find_schema(states, places_args[task_idx].collection);
+        if (state.schema.originals_dropped)
+            continue;
+        entry_t entry;
+        entry.collection_key.collection = places_args[task_idx].collection;
+        entry.collection_key.key = places_args[task_idx].key;
+        entry.value = vectors_args[task_idx];
+        if (state.schema.originals_codec == codec_t::shuffle_lz4_k)
+            entry.value = pack_original(entry.value, c.dimensions, pack_scratch.begin(), arena, c.error);
+        return_if_error_m(c.error);
+        entries.push_back(entry, c.error);
+        return_if_error_m(c.error);
+    }
+
+    // Add the mirror tasks for quantized or compressed copies in collections without an index
+    for (std::size_t task_idx = 0; task_idx != c.tasks_count; ++task_idx) {
+        if (find_schema(states, places_args[task_idx].collection)->schema.connectivity)
+            continue;
+        auto quantized_begin = quantized_vectors.begin() + task_idx * quantized_bytes;
+        entry_t entry;
+        entry.collection_key.collection = places_args[task_idx].collection;
+        entry.collection_key.key = -places_args[task_idx].key;
+        entry.value = value_view_t {quantized_begin, quantized_lengths[task_idx]};
+        entries.push_back(entry, c.error);
+        return_if_error_m(c.error);
+    }
+
+    // Add the updated nodes of the graph, that already include the quantized copies
+    std::size_t nodes_bytes = 0;
+    for (index_node_t const* node : nodes.slots())
+        nodes_bytes += node && node->modified ? node->size_bytes(c.dimensions) : 0;
+    auto nodes_tape = arena.alloc<byte_t>(nodes_bytes, c.error);
     return_if_error_m(c.error);
 
-    ustore_length_t total_exported_matches = 0;
-    for (std::size_t i = 0; i != c.tasks_count && !*c.error; ++i) {
-        auto col = collections ? collections[i] : ustore_collection_main_k;
-        auto query = queries_args[i];
-        auto limit = count_limits[i];
-        quantize(query.begin(), c.scalar_type, c.dimensions, quant_query.begin());
+    byte_t* nodes_output = nodes_tape.begin();
+    for (index_node_t const* node : nodes.slots()) {
+        if (!node || !node->modified)
+            continue;
+        nodes.serialize(*node, nodes_output);
+        entry_t entry;
+        entry.collection_key.collection = node->collection;
+        entry.collection_key.key = node->key;
+        entry.value = value_view_t {nodes_output, node->size_bytes(c.dimensions)};
+        entries.push_back(entry, c.error);
+        return_if_error_m(c.error);
+        nodes_output += node->size_bytes(c.dimensions);
+    }
 
-        pq_t pq {temp_matches.begin(), temp_matches.begin() + limit};
+    for (schema_state_t const& state : states) {
+        if (!state.modified)
+            continue;
+        entry_t entry;
+        entry.collection_key.collection = state.collection;
+        entry.collection_key.key = schema_key_k;
+        entry.value = value_view_t {(ustore_bytes_cptr_t)&state.schema, sizeof(schema_t)};
+        entries.push_back(entry, c.error);
+        return_if_error_m(c.error);
+    }
 
-        auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
-            if (key >= 0)
-                return false;
+    // Submit both original and quantized entries
+    entry_t& first = entries[0];
+    ustore_write_t write {};
+    write.db = c.db;
+    write.error = c.error;
+    write.transaction = c.transaction;
+    write.arena = arena;
+    write.options = c.options;
+    write.tasks_count = entries.size();
+    write.collections = &first.collection_key.collection;
+    write.collections_stride = sizeof(entry_t);
+    write.keys = &first.collection_key.key;
+    write.keys_stride = sizeof(entry_t);
+    write.lengths = first.value.member_length();
+    write.lengths_stride = sizeof(entry_t);
+    write.values = first.value.member_ptr();
+    write.values_stride = sizeof(entry_t);
+    ustore_write(&write);
+
+#if defined(USTORE_USE_CUDA)
+    // Device copies of the modified collections are uploaded again by the next search
+    for (schema_state_t const& state : states)
+        cuda_unpin(c.db, state.collection);
+#endif
+}
+
+/**
+ * @brief Number of times the writes are attempted, when they run in internal
+ * transactions, that fail to commit.
+ */
+constexpr std::size_t vectors_write_attempts_k = 8;
+
+void ustore_vectors_write(ustore_vectors_write_t* c_ptr) {
+
+    ustore_vectors_write_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::vectors_write_k, c.tasks_count, c.error};
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+    if (c.transaction || !ustore_supports_transactions_k)
+        return write_vectors(c, arena);
+
+    // Quantized copies depend on the schema, so outside of transactions we start our own,
+    // watching the schemas. The writes, that race with a compression, conflict with it,
+    // and are retried, to be rejected, until the compression completes.
+    ustore_vectors_write_t attempt_c = c;
+    attempt_c.options = ustore_options_t(c.options & ~ustore_option_transaction_dont_watch_k);
+    ustore_transaction_t txn = nullptr;
+    for (std::size_t attempt = 0; attempt != vectors_write_attempts_k; ++attempt) {
+        *c.error = nullptr;
+        ustore_transaction_init_t txn_init {};
+        txn_init.db = c.db;
+        txn_init.error = c.error;
+        txn_init.transaction = &txn;
+        ustore_transaction_init(&txn_init);
+        if (*c.error)
+            break;
+
+        attempt_c.transaction = txn;
+        write_vectors(attempt_c, arena);
+        if (*c.error)
+            break;
+
+        ustore_transaction_commit_t txn_commit {};
+        txn_commit.db = c.db;
+        txn_commit.error = c.error;
+        txn_commit.transaction = txn;
+        txn_commit.options = ustore_options_t(c.options & ustore_option_write_flush_k);
+        ustore_transaction_commit(&txn_commit);
+        if (!*c.error)
+            break;
+    }
+    ustore_transaction_free(txn);
+}
+
+/**
+ * @brief Replaces the missing originals of collections, compressed without keeping them,
+ * with `ustore_vector_scalar_f32_k` vectors, reconstructed from their codes.
+ * Expects the results of a read, that exported both `offsets` and `lengths`.
+ */
+void reconstruct_originals( //
+    ustore_vectors_read_t const& c,
+    places_arg_t const& places,
+    ptr_range_gt<schema_state_t> states,
+    ustore_length_t* offsets,
+    ustore_length_t* lengths,
+    ustore_byte_t** values,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    uninitialized_array_gt<collection_key_t> mirrors(arena);
+    for (std::size_t i = 0; i != places.size(); ++i) {
+        place_t place = places[i];
+        if (!find_schema(states, place.collection)->schema.originals_dropped)
+            continue;
+        mirrors.push_back(collection_key_t {place.collection, -place.key}, c_error);
+        return_if_error_m(c_error);
+    }
+
+    ustore_length_t* found_offsets {};
+    ustore_length_t* found_lengths {};
+    ustore_byte_t* found_values {};
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c_error;
+    read.transaction = c.transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = mirrors.size();
+    read.collections = &mirrors[0].collection;
+    read.collections_stride = sizeof(collection_key_t);
+    read.keys = &mirrors[0].key;
+    read.keys_stride = sizeof(collection_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c_error);
+
+    // Reconstructed vectors are appended to the copies of the other entries on a new tape
+    std::size_t const reconstructed_bytes = c.dimensions * sizeof(real_t);
+    std::size_t tape_length = 0;
+    for (std::size_t i = 0, mirror_idx = 0; i != places.size(); ++i)
+        if (find_schema(states, places[i].collection)->schema.originals_dropped)
+            tape_length += found_lengths[mirror_idx++] != ustore_length_missing_k ? reconstructed_bytes : 0;
+        else
+            tape_length += lengths[i] != ustore_length_missing_k ? lengths[i] : 0;
+    auto tape = arena.alloc<byte_t>(tape_length, c_error);
+    return_if_error_m(c_error);
+    auto decoded_vector = arena.alloc<real_t>(c.dimensions, c_error);
+    return_if_error_m(c_error);
+
+    bits_span_t presences {c.presences ? *c.presences : nullptr};
+    ustore_length_t tape_offset = 0;
+    for (std::size_t i = 0, mirror_idx = 0; i != places.size(); ++i) {
+        schema_state_t const& state = *find_schema(states, places[i].collection);
+        value_view_t bytes;
+        if (!state.schema.originals_dropped) {
+            if (lengths[i] != ustore_length_missing_k)
+                bytes = value_view_t {*values + offsets[i], lengths[i]};
+            if (bytes.size())
+                std::memcpy(tape.begin() + tape_offset, bytes.data(), bytes.size());
+        }
+        else if (std::size_t const idx = mirror_idx++; found_lengths[idx] != ustore_length_missing_k) {
+            pq_codebook_t codebook {state.centroids, state.schema.subspaces, c.dimensions / state.schema.subspaces};
+            return_error_if_m(state.centroids && found_lengths[idx] == codebook.codes_bytes(),
+                              c_error,
+                              consistency_k,
+                              "Corrupted compressed vector");
+            codebook.decode(reinterpret_cast<byte_t const*>(found_values + found_offsets[idx]), decoded_vector.begin());
+            std::memcpy(tape.begin() + tape_offset, decoded_vector.begin(), reconstructed_bytes);
+            bytes = value_view_t {tape.begin() + tape_offset, reconstructed_bytes};
+        }
+        offsets[i] = tape_offset;
+        lengths[i] = bytes ? static_cast<ustore_length_t>(bytes.size()) : ustore_length_missing_k;
+        if (presences)
+            presences.at(i) = bool(bytes);
+        tape_offset += static_cast<ustore_length_t>(bytes.size());
+    }
+    offsets[places.size()] = tape_offset;
+    *values = reinterpret_cast<ustore_byte_t*>(tape.begin());
+}
+
+void ustore_vectors_read(ustore_vectors_read_t* c_ptr) {
+
+    ustore_vectors_read_t& c = *c_ptr;
+    operation_timer_t timer {operation_t::vectors_read_k, c.tasks_count, c.error};
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_iterator_gt<ustore_key_t const> keys {c.keys, c.keys_stride};
+    places_arg_t places_args {collections, keys, {}, c.tasks_count};
+
+    auto vector_size = c.dimensions * size_bytes(c.scalar_type);
+
+    // Read from disk, but potentially re-layout the data response.
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c.error;
+    read.transaction = c.transaction;
+    read.arena = arena;
+    read.options = c.options;
+    read.tasks_count = c.tasks_count;
+    read.collections = c.collections;
+    read.collections_stride = c.collections_stride;
+    read.keys = keys.get();
+    read.keys_stride = keys.stride();
+    ustore_length_t* found_offsets {};
+    ustore_length_t* found_lengths {};
+    ustore_byte_t* found_values {};
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.presences = c.presences;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c.error);
+
+    // Compressed originals are restored into a new tape, keeping the order of entries
+    unpack_originals(c.tasks_count, c.dimensions, found_offsets, found_lengths, &found_values, arena, c.error);
+    return_if_error_m(c.error);
+
+    // Collections, compressed without keeping the originals, export their approximations
+    auto read_options = ustore_options_t(c.options & ustore_option_transaction_dont_watch_k);
+    auto states = read_schemas(c.db, c.transaction, read_options, collections, c.tasks_count, arena, c.error);
+    return_if_error_m(c.error);
+    bool const reconstruct = std::any_of(states.begin(), states.end(), [](schema_state_t const& state) {
+        return state.schema.originals_dropped;
+    });
+    if (reconstruct)
+        reconstruct_originals(c, places_args, states, found_offsets, found_lengths, &found_values, arena, c.error);
+    return_if_error_m(c.error);
+    if (c.offsets)
+        *c.offsets = found_offsets;
+    if (c.vectors)
+        *c.vectors = found_values;
+
+    // From here on, if we have the offsets don't form identical-length chunks,
+    // we must compact the range:
+}
+
+/*********************************************************/
+/*****************	     Exact Search	  ****************/
+/*********************************************************/
+
+/**
+ * @brief State of a thread, scanning a part of the collection in exact search.
+ * Has its own arena and heaps for every query in the group, unless it's the only one.
+ */
+struct exact_search_worker_t {
+    ustore_key_t start_key = 0;
+    ustore_key_t end_key = 0;
+    /** @brief Part of the allow-list of mirrored keys to read, instead of scanning the range. */
+    ptr_range_gt<ustore_key_t const> keys;
+    ustore_arena_t arena = nullptr;
+    ustore_error_t error = nullptr;
+    pq_t** heaps = nullptr;
+};
+
+/**
+ * @brief Splits the `[start_key, end_key)` range of the quantized half of a collection into up
+ * to `partitions_limit` ranges of similar cardinality. Only scans the keys, remembering the first
+ * key of every batch. The exported boundaries start with `start_key` and end with `end_key`.
+ */
+void partition_quantized_keys( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    ustore_key_t const start_key,
+    ustore_key_t const end_key,
+    std::size_t partitions_limit,
+    linked_memory_lock_t& arena,
+    uninitialized_array_gt<ustore_key_t>& boundaries,
+    ustore_error_t* c_error) noexcept {
+
+    uninitialized_array_gt<ustore_key_t> batches_starts(arena);
+    ustore_arena_t scan_arena = nullptr;
+    ustore_key_t batch_start_key = start_key;
+    ustore_length_t read_ahead = exact_scan_read_ahead_k;
+    while (partitions_limit > 1 && !*c_error) {
+        ustore_length_t* found_counts {};
+        ustore_key_t* found_keys {};
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = c_error;
+        scan.transaction = transaction;
+        scan.arena = &scan_arena;
+        scan.options = options;
+        scan.tasks_count = 1;
+        scan.collections = &collection;
+        scan.start_keys = &batch_start_key;
+        scan.count_limits = &read_ahead;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        if (*c_error || !found_counts[0] || found_keys[0] >= end_key)
+            break;
+
+        batches_starts.push_back(found_keys[0], c_error);
+        ustore_key_t const last_key = found_keys[found_counts[0] - 1];
+        if (*c_error || found_counts[0] < read_ahead || last_key >= end_key)
+            break;
+        batch_start_key = last_key + 1;
+    }
+    ustore_arena_free(scan_arena);
+    return_if_error_m(c_error);
+
+    std::size_t const partitions_count = std::max<std::size_t>(std::min(partitions_limit, batches_starts.size()), 1);
+    boundaries.clear();
+    boundaries.push_back(start_key, c_error);
+    for (std::size_t i = 1; i < partitions_count && !*c_error; ++i)
+        boundaries.push_back(batches_starts[i * batches_starts.size() / partitions_count], c_error);
+    boundaries.push_back(end_key, c_error);
+}
+
+/**
+ * @brief Scores every vector in the range of the `worker` against all the `queries` of the group.
+ * In compressed collections, the `tables` of queries are used instead of quantized `queries`.
+ */
+void exact_search( //
+    ustore_vectors_search_t const& c,
+    similarity_t const& similarity,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    ptr_range_gt<quant_t const*> queries,
+    ptr_range_gt<real_t> queries_norms,
+    pq_codebook_t const& codebook,
+    ptr_range_gt<real_t const*> tables,
+    exact_search_worker_t& worker) noexcept {
+
+    auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
+        if (key == schema_key_k)
+            return true;
+        if (codebook) {
+            if (vector.size() < codebook.codes_bytes())
+                return true;
+            for (std::size_t j = 0; j != tables.size(); ++j) {
+                match_t match;
+                match.key = key;
+                match.metric = codebook.score(c.metric, tables[j], queries_norms[j], vector.data());
+                if (similarity.to_metric(match.metric) < c.metric_threshold)
+                    continue;
+                worker.heaps[j]->push(match);
+            }
+            return true;
+        }
+
+        auto vector_quants = (quant_t const*)vector.data();
+        real_t vector_norm = 0;
+        if (similarity.needs_norms()) {
+            // Entries written before the schemas were introduced have no cached norms
+            if (vector.size() >= c.dimensions + sizeof(real_t))
+                std::memcpy(&vector_norm, vector.data() + c.dimensions, sizeof(real_t));
+            else
+                vector_norm = quant_norm(vector_quants, c.dimensions);
+        }
+        for (std::size_t j = 0; j != queries.size(); ++j) {
             match_t match;
             match.key = key;
-            match.metric = metric(quant_query.begin(), (quant_t const*)vector.data(), c.dimensions, c.metric);
-            if (match.metric < c.metric_threshold)
-                return true;
+            match.metric = similarity(queries[j], queries_norms[j], vector_quants, vector_norm);
+            if (similarity.to_metric(match.metric) < c.metric_threshold)
+                continue;
+            worker.heaps[j]->push(match);
+        }
+        return true;
+    };
+
+    if (!worker.keys.size())
+        return scan_range_collection(c.db,
+                                     c.transaction,
+                                     collection,
+                                     options,
+                                     worker.start_key,
+                                     worker.end_key,
+                                     exact_scan_read_ahead_k,
+                                     &worker.arena,
+                                     &worker.error,
+                                     callback);
 
-            pq.push(match);
+    // Only visit the allowed entries, so the cost is proportional to their number
+    for (std::size_t batch_begin = 0; batch_begin < worker.keys.size() && !worker.error;) {
+        std::size_t const batch_size = std::min<std::size_t>(worker.keys.size() - batch_begin, exact_scan_read_ahead_k);
+        ustore_length_t* found_offsets {};
+        ustore_length_t* found_lengths {};
+        ustore_byte_t* found_values {};
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = &worker.error;
+        read.transaction = c.transaction;
+        read.arena = &worker.arena;
+        read.options = ustore_options_t(options & ~ustore_option_dont_discard_memory_k);
+        read.tasks_count = batch_size;
+        read.collections = &collection;
+        read.collections_stride = 0;
+        read.keys = worker.keys.begin() + batch_begin;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets;
+        read.lengths = &found_lengths;
+        read.values = &found_values;
+        ustore_read(&read);
+        if (worker.error)
+            return;
+
+        for (std::size_t i = 0; i != batch_size; ++i) {
+            if (found_lengths[i] == ustore_length_missing_k)
+                continue;
+            auto begin = reinterpret_cast<byte_t const*>(found_values + found_offsets[i]);
+            callback(worker.keys[batch_begin + i], value_view_t {begin, found_lengths[i]});
+        }
+        batch_begin += batch_size;
+    }
+}
+
+#if defined(USTORE_USE_CUDA)
+
+/*********************************************************/
+/*****************	    GPU Offloading	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Uploads the quantized half of a collection to the device, unless it's already there.
+ * The entries are scanned outside of transactions, as the device copy is shared by all of them.
+ */
+void cuda_pin_collection( //
+    ustore_database_t db,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    std::size_t dims,
+    ustore_error_t* c_error) noexcept {
+
+    if (cuda_pinned(db, collection, dims))
+        return;
+
+    std::size_t const generation = cuda_generation(db, collection);
+    std::size_t const stride = cuda_stride(dims);
+    std::vector<ustore_key_t> keys;
+    std::vector<quant_t> quants;
+    std::vector<real_t> norms;
+    ustore_arena_t scan_arena = nullptr;
+    auto callback = [&](ustore_key_t key, value_view_t vector) noexcept {
+        if (key == schema_key_k || vector.size() < dims)
             return true;
-        };
+        safe_section("Staging vectors", c_error, [&] {
+            auto vector_quants = (quant_t const*)vector.data();
+            real_t vector_norm;
+            if (vector.size() >= dims + sizeof(real_t))
+                std::memcpy(&vector_norm, vector.data() + dims, sizeof(real_t));
+            else
+                vector_norm = quant_norm(vector_quants, dims);
+            keys.push_back(key);
+            norms.push_back(vector_norm);
+            quants.resize(quants.size() + stride, quant_t(0));
+            std::memcpy(quants.data() + quants.size() - stride, vector_quants, dims);
+        });
+        return !*c_error;
+    };
+    scan_range_collection(db,
+                          nullptr,
+                          collection,
+                          options,
+                          std::numeric_limits<ustore_key_t>::min(),
+                          0,
+                          exact_scan_read_ahead_k,
+                          &scan_arena,
+                          c_error,
+                          callback);
+    ustore_arena_free(scan_arena);
+    return_if_error_m(c_error);
+    cuda_pin(db, collection, generation, std::move(keys), quants.data(), norms.data(), dims, c_error);
+}
+
+/**
+ * @brief Offloads a group of exact queries into the same collection to the GPU.
+ * @return False, if the device can't serve the group, and the host scan must be used.
+ */
+bool cuda_exact_search( //
+    ustore_vectors_search_t const& c,
+    similarity_t const& similarity,
+    ustore_collection_t collection,
+    ustore_options_t options,
+    ustore_key_t start_key,
+    ustore_key_t end_key,
+    ptr_range_gt<quant_t const*> queries,
+    ptr_range_gt<real_t> queries_norms,
+    ptr_range_gt<pq_t*> heaps,
+    linked_memory_lock_t& arena) noexcept {
+
+    std::size_t top = 0;
+    for (pq_t* heap : heaps)
+        top = std::max<std::size_t>(top, heap->capacity());
+    if (top > cuda_top_limit_k)
+        return false;
+
+    cuda_pin_collection(c.db, collection, options, c.dimensions, c.error);
+    if (*c.error)
+        return true;
+
+    auto found_counts = arena.alloc<ustore_length_t>(queries.size(), c.error);
+    if (*c.error)
+        return true;
+    auto found_keys = arena.alloc<ustore_key_t>(queries.size() * top, c.error);
+    if (*c.error)
+        return true;
+    auto found_similarities = arena.alloc<real_t>(queries.size() * top, c.error);
+    if (*c.error)
+        return true;
+
+    bool const served = cuda_search(c.db,
+                                    collection,
+                                    c.metric,
+                                    queries.begin(),
+                                    queries_norms.begin(),
+                                    queries.size(),
+                                    start_key,
+                                    end_key,
+                                    top,
+                                    found_counts.begin(),
+                                    found_keys.begin(),
+                                    found_similarities.begin(),
+                                    c.error);
+    if (!served || *c.error)
+        return served;
+
+    for (std::size_t j = 0; j != queries.size(); ++j) {
+        for (std::size_t k = 0; k != found_counts[j]; ++k) {
+            match_t match;
+            match.key = found_keys[j * top + k];
+            match.metric = found_similarities[j * top + k];
+            if (similarity.to_metric(match.metric) < c.metric_threshold)
+                continue;
+            heaps[j]->push(match);
+        }
+    }
+    return true;
+}
+
+#endif
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+
+void ustore_vectors_search(ustore_vectors_search_t* c_ptr) {
+
+    ustore_vectors_search_t const& c = *c_ptr;
+    operation_timer_t timer {operation_t::vectors_search_k, c.tasks_count, c.error};
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    strided_iterator_gt<ustore_bytes_cptr_t const> starts {c.queries_starts, c.queries_starts_stride};
+    strided_iterator_gt<ustore_length_t const> offs {c.queries_offsets, c.queries_offsets_stride};
+    vectors_arg_t queries_args {starts, offs, c.queries_stride, c.scalar_type, c.dimensions, c.tasks_count};
+
+    strided_iterator_gt<ustore_collection_t const> collections {c.collections, c.collections_stride};
+    strided_range_gt<ustore_length_t const> count_limits {{c.match_counts_limits, c.match_counts_limits_stride},
+                                                       c.tasks_count};
+
+    auto count_limits_sum = reduce_n(count_limits.begin(), c.tasks_count, 0ul);
+
+    auto found_counts = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_counts);
+    return_if_error_m(c.error);
+    auto found_offsets = arena.alloc_or_dummy(c.tasks_count, c.error, c.match_offsets);
+    return_if_error_m(c.error);
+    auto found_keys = arena.alloc_or_dummy(count_limits_sum, c.error, c.match_keys);
+    return_if_error_m(c.error);
+    auto found_metrics = arena.alloc_or_dummy(count_limits_sum, c.error, c.match_metrics);
+    return_if_error_m(c.error);
+
+    similarity_t const similarity {c.metric, c.dimensions};
+    return_error_if_m(similarity, c.error, args_wrong_k, "Unsupported metric");
+
+    // Every query gets its own heap, as some of them will be answered in a single shared pass
+    auto heap_capacity = [&](ustore_length_t limit) noexcept {
+        return std::max({limit, c.index_expansion, c.rerank_count});
+    };
+    auto heaps_capacities_sum = transform_reduce_n(count_limits.begin(), c.tasks_count, 0ul, heap_capacity);
+    auto temp_matches = arena.alloc<match_t>(heaps_capacities_sum, c.error);
+    return_if_error_m(c.error);
+    auto heaps = arena.alloc<pq_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto quant_queries = arena.alloc<quant_t const*>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto quant_norms = arena.alloc<real_t>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+
+    // Integer queries are already quantized, and can be used in-place
+    bool const quantize_queries = c.scalar_type != ustore_vector_scalar_i8_k;
+    auto quant_buffer = arena.alloc<quant_t>(quantize_queries ? c.tasks_count * c.dimensions : 0, c.error);
+    return_if_error_m(c.error);
+
+    for (std::size_t i = 0, heap_offset = 0; i != c.tasks_count; ++i) {
+        auto capacity = heap_capacity(count_limits[i]);
+        auto heap_begin = temp_matches.begin() + heap_offset;
+        new (&heaps[i]) pq_t {heap_begin, heap_begin + capacity};
+        heap_offset += capacity;
+
+        auto query_begin = queries_args[i].begin();
+        if (quantize_queries) {
+            quant_t* quant_query = quant_buffer.begin() + i * c.dimensions;
+            quantize(query_begin, c.scalar_type, c.dimensions, quant_query);
+            quant_queries[i] = quant_query;
+        }
+        else
+            quant_queries[i] = reinterpret_cast<quant_t const*>(query_begin);
+        quant_norms[i] = similarity.needs_norms() ? quant_norm(quant_queries[i], c.dimensions) : 0;
+    }
+
+    // The schemas are validated once per collection, instead of every entry.
+    // The index can only be used, if it was organized with the same metric.
+    auto read_options = ustore_options_t(c.options & ustore_option_transaction_dont_watch_k);
+    auto states = read_schemas(c.db, c.transaction, read_options, collections, c.tasks_count, arena, c.error);
+    return_if_error_m(c.error);
+    for (schema_state_t const& state : states)
+        return_error_if_m(!state.present || state.schema.dimensions == c.dimensions,
+                          c.error,
+                          args_combo_k,
+                          "Queries dimensions don't match the collection schema");
+
+    // Compressed collections are searched with lookup tables, built from full-precision queries
+    auto pq_queries = arena.alloc<real_t const*>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    auto pq_tables = arena.alloc<real_t const*>(c.tasks_count, c.error);
+    return_if_error_m(c.error);
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto col = collections ? collections[i] : ustore_collection_main_k;
+        schema_state_t const& state = *find_schema(states, col);
+        pq_queries[i] = nullptr;
+        pq_tables[i] = nullptr;
+        if (!state.centroids)
+            continue;
+
+        pq_codebook_t codebook {state.centroids, state.schema.subspaces, c.dimensions / state.schema.subspaces};
+        auto query = arena.alloc<real_t>(c.dimensions, c.error);
+        return_if_error_m(c.error);
+        auto table = arena.alloc<real_t>(codebook.subspaces * pq_centroids_k, c.error);
+        return_if_error_m(c.error);
+        dequantize(queries_args[i].begin(), c.scalar_type, c.dimensions, query.begin());
+        codebook.fill_table(c.metric, query.begin(), table.begin());
+        quant_norms[i] = std::sqrt(dot_floats(query.begin(), query.begin(), c.dimensions));
+        pq_queries[i] = query.begin();
+        pq_tables[i] = table.begin();
+    }
+
+    // Filters are applied to mirrored keys inside the exact search, before any distances are computed.
+    // The allow-list is served with point reads, so its cost is proportional to its own size.
+    bool const filtered = c.allowed_keys || c.keys_min || c.keys_max;
+    ustore_key_t const filter_start_key = c.keys_max > 0 ? -c.keys_max : std::numeric_limits<ustore_key_t>::min();
+    ustore_key_t const filter_end_key = c.keys_min > 1 ? 1 - c.keys_min : 0;
+    uninitialized_array_gt<ustore_key_t> allowed_keys(arena);
+    for (std::size_t i = 0; c.allowed_keys && i != c.allowed_keys_count; ++i) {
+        ustore_key_t const key = c.allowed_keys[i];
+        if (key <= 0 || -key < filter_start_key || -key >= filter_end_key)
+            continue;
+        allowed_keys.push_back(-key, c.error);
+        return_if_error_m(c.error);
+    }
+    std::sort(allowed_keys.begin(), allowed_keys.end());
+    allowed_keys.resize(std::unique(allowed_keys.begin(), allowed_keys.end()) - allowed_keys.begin(), c.error);
+    return_if_error_m(c.error);
 
-        auto min_key = std::numeric_limits<ustore_key_t>::min();
-        full_scan_collection(c.db, c.transaction, col, c.options, min_key, limit, arena, c.error, callback);
-        auto count = pq.size();
+    index_nodes_t nodes {c.db, c.transaction, read_options, arena, c.error, c.dimensions};
+    uninitialized_array_gt<match_t> candidates(arena);
+    uninitialized_array_gt<std::size_t> exact_tasks(arena);
+
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        auto col = collections ? collections[i] : ustore_collection_main_k;
+        schema_state_t const& state = *find_schema(states, col);
+        bool const use_index = c.index_expansion && !filtered && state.present && state.schema.has_graph() &&
+                               state.schema.metric == c.metric;
+        if (!use_index) {
+            exact_tasks.push_back(i, c.error);
+            return_if_error_m(c.error);
+            continue;
+        }
+
+        index_search(nodes,
+                     col,
+                     state.schema,
+                     quant_queries[i],
+                     quant_norms[i],
+                     schema_key_k,
+                     heaps[i],
+                     candidates,
+                     c.error);
+        return_if_error_m(c.error);
+    }
+
+    // Group the remaining queries by collection, and score every scanned chunk against all
+    // of them at once, instead of passing through the same collection for every query.
+    std::sort(exact_tasks.begin(), exact_tasks.end(), [&](std::size_t a, std::size_t b) {
+        auto a_col = collections ? collections[a] : ustore_collection_main_k;
+        auto b_col = collections ? collections[b] : ustore_collection_main_k;
+        return a_col != b_col ? a_col < b_col : a < b;
+    });
+    // Transactions aren't thread-safe, so the parallel mode is only available outside of them
+    std::size_t const threads_count = c.transaction ? 1
+                                      : c.threads_count ? c.threads_count
+                                                        : threads_registry_t::global().get(c.db);
+#if defined(USTORE_USE_CUDA)
+    bool const accelerated = threads_registry_t::global().accelerated(c.db);
+#endif
+    for (std::size_t group_begin = 0; group_begin != exact_tasks.size();) {
+        auto col = collections ? collections[exact_tasks[group_begin]] : ustore_collection_main_k;
+        std::size_t group_end = group_begin + 1;
+        while (group_end != exact_tasks.size() &&
+               (collections ? collections[exact_tasks[group_end]] : ustore_collection_main_k) == col)
+            ++group_end;
+
+        std::size_t const group_size = group_end - group_begin;
+        auto group_queries = arena.alloc<quant_t const*>(group_size, c.error);
+        return_if_error_m(c.error);
+        auto group_norms = arena.alloc<real_t>(group_size, c.error);
+        return_if_error_m(c.error);
+        auto group_tables = arena.alloc<real_t const*>(group_size, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t j = 0; j != group_size; ++j) {
+            group_queries[j] = quant_queries[exact_tasks[group_begin + j]];
+            group_norms[j] = quant_norms[exact_tasks[group_begin + j]];
+            group_tables[j] = pq_tables[exact_tasks[group_begin + j]];
+        }
+        schema_state_t const& state = *find_schema(states, col);
+        pq_codebook_t codebook;
+        if (state.centroids)
+            codebook = {state.centroids, state.schema.subspaces, c.dimensions / state.schema.subspaces};
+
+#if defined(USTORE_USE_CUDA)
+        // The device keeps its own copy of the collection, so transactions and allow-lists stay on the host
+        if (accelerated && !c.transaction && !c.allowed_keys && !state.centroids) {
+            auto group_heaps = arena.alloc<pq_t*>(group_size, c.error);
+            return_if_error_m(c.error);
+            for (std::size_t j = 0; j != group_size; ++j)
+                group_heaps[j] = &heaps[exact_tasks[group_begin + j]];
+            bool const served = cuda_exact_search(c,
+                                                  similarity,
+                                                  col,
+                                                  read_options,
+                                                  filter_start_key,
+                                                  filter_end_key,
+                                                  group_queries,
+                                                  group_norms,
+                                                  group_heaps,
+                                                  arena);
+            return_if_error_m(c.error);
+            if (served) {
+                group_begin = group_end;
+                continue;
+            }
+        }
+#endif
+
+        // Split the key range or the allow-list between workers, each with its own heaps, if there is more than one
+        uninitialized_array_gt<ustore_key_t> boundaries(arena);
+        std::size_t workers_count = 1;
+        if (c.allowed_keys) {
+            if (!allowed_keys.size()) {
+                group_begin = group_end;
+                continue;
+            }
+            std::size_t const batches_count = divide_round_up<std::size_t>(allowed_keys.size(), exact_scan_read_ahead_k);
+            workers_count = std::max<std::size_t>(std::min(threads_count, batches_count), 1);
+        }
+        else {
+            partition_quantized_keys(c.db,
+                                     c.transaction,
+                                     col,
+                                     read_options,
+                                     filter_start_key,
+                                     filter_end_key,
+                                     threads_count,
+                                     arena,
+                                     boundaries,
+                                     c.error);
+            return_if_error_m(c.error);
+            workers_count = boundaries.size() - 1;
+        }
+
+        auto workers = arena.alloc<exact_search_worker_t>(workers_count, c.error);
+        return_if_error_m(c.error);
+        auto workers_heaps = arena.alloc<pq_t*>(workers_count * group_size, c.error);
+        return_if_error_m(c.error);
+        for (std::size_t w = 0; w != workers_count; ++w) {
+            exact_search_worker_t& worker = *new (&workers[w]) exact_search_worker_t {};
+            if (c.allowed_keys) {
+                std::size_t const keys_begin = w * allowed_keys.size() / workers_count;
+                std::size_t const keys_end = (w + 1) * allowed_keys.size() / workers_count;
+                worker.keys = {allowed_keys.begin() + keys_begin, allowed_keys.begin() + keys_end};
+            }
+            else {
+                worker.start_key = boundaries[w];
+                worker.end_key = boundaries[w + 1];
+            }
+            worker.heaps = workers_heaps.begin() + w * group_size;
+            for (std::size_t j = 0; j != group_size; ++j) {
+                pq_t& output_heap = heaps[exact_tasks[group_begin + j]];
+                if (workers_count == 1) {
+                    worker.heaps[j] = &output_heap;
+                    continue;
+                }
+                auto heap_buffer = arena.alloc<match_t>(output_heap.capacity(), c.error);
+                return_if_error_m(c.error);
+                auto heap_memory = arena.alloc<pq_t>(1, c.error);
+                return_if_error_m(c.error);
+                worker.heaps[j] = new (heap_memory.begin()) pq_t {heap_buffer.begin(), heap_buffer.end()};
+            }
+        }
+
+        std::vector<std::thread> threads;
+        safe_section("Spawning threads", c.error, [&] {
+            threads.reserve(workers_count - 1);
+            for (std::size_t w = 1; w < workers_count; ++w)
+                threads.emplace_back([&, w] {
+                    exact_search(c,
+                                 similarity,
+                                 col,
+                                 read_options,
+                                 group_queries,
+                                 group_norms,
+                                 codebook,
+                                 group_tables,
+                                 workers[w]);
+                });
+        });
+        if (!*c.error)
+            exact_search(c,
+                         similarity,
+                         col,
+                         read_options,
+                         group_queries,
+                         group_norms,
+                         codebook,
+                         group_tables,
+                         workers[0]);
+        for (std::thread& thread : threads)
+            thread.join();
+
+        // Merge the heaps of different workers
+        for (std::size_t w = 0; w != workers_count; ++w) {
+            exact_search_worker_t& worker = workers[w];
+            if (worker.error && !*c.error)
+                *c.error = worker.error;
+            for (std::size_t j = 0; j != group_size && workers_count != 1; ++j)
+                for (match_t const& match : *worker.heaps[j])
+                    heaps[exact_tasks[group_begin + j]].push(match);
+            ustore_arena_free(worker.arena);
+        }
+        return_if_error_m(c.error);
+        group_begin = group_end;
+    }
+
+    // Re-rank the best candidates from compressed collections against the full-precision originals,
+    // unless those were dropped, leaving the approximate metrics as they are
+    auto is_reranked = [&](std::size_t i) noexcept {
+        auto col = collections ? collections[i] : ustore_collection_main_k;
+        return pq_queries[i] && !find_schema(states, col)->schema.originals_dropped;
+    };
+    if (c.rerank_count) {
+        uninitialized_array_gt<collection_key_t> rerank_places(arena);
+        for (std::size_t i = 0; i != c.tasks_count; ++i) {
+            auto col = collections ? collections[i] : ustore_collection_main_k;
+            std::size_t const rerank_count = std::max(count_limits[i], c.rerank_count);
+            for (std::size_t j = 0; is_reranked(i) && j != heaps[i].size() && j != rerank_count; ++j) {
+                rerank_places.push_back(collection_key_t {col, std::abs(heaps[i].begin()[j].key)}, c.error);
+                return_if_error_m(c.error);
+            }
+        }
+
+        ustore_length_t* found_offsets {};
+        ustore_length_t* found_lengths {};
+        ustore_byte_t* found_values {};
+        if (rerank_places.size()) {
+            ustore_read_t read {};
+            read.db = c.db;
+            read.error = c.error;
+            read.transaction = c.transaction;
+            read.arena = arena;
+            read.options = ustore_options_t(read_options | ustore_option_dont_discard_memory_k);
+            read.tasks_count = rerank_places.size();
+            read.collections = &rerank_places[0].collection;
+            read.collections_stride = sizeof(collection_key_t);
+            read.keys = &rerank_places[0].key;
+            read.keys_stride = sizeof(collection_key_t);
+            read.offsets = &found_offsets;
+            read.lengths = &found_lengths;
+            read.values = &found_values;
+            ustore_read(&read);
+            return_if_error_m(c.error);
+            unpack_originals(rerank_places.size(),
+                             c.dimensions,
+                             found_offsets,
+                             found_lengths,
+                             &found_values,
+                             arena,
+                             c.error);
+            return_if_error_m(c.error);
+        }
+
+        auto original = arena.alloc<real_t>(c.dimensions, c.error);
+        return_if_error_m(c.error);
+        uninitialized_array_gt<match_t> candidates_copy(arena);
+        for (std::size_t i = 0, place_idx = 0; i != c.tasks_count; ++i) {
+            if (!is_reranked(i))
+                continue;
+            pq_t& heap = heaps[i];
+            std::size_t const rerank_count = std::min<std::size_t>(heap.size(), std::max(count_limits[i], c.rerank_count));
+            candidates_copy.resize(rerank_count, c.error);
+            return_if_error_m(c.error);
+            std::copy_n(heap.begin(), rerank_count, candidates_copy.begin());
+            heap.clear();
+
+            // Candidates, that weren't re-ranked, are dropped, as their metrics aren't comparable
+            for (match_t match : candidates_copy) {
+                std::size_t const idx = place_idx++;
+                ustore_vector_scalar_t scalar_type;
+                if (found_lengths[idx] == ustore_length_missing_k ||
+                    !scalar_type_of(found_lengths[idx], c.dimensions, scalar_type))
+                    continue;
+                auto original_begin = reinterpret_cast<byte_t const*>(found_values + found_offsets[idx]);
+                dequantize(original_begin, scalar_type, c.dimensions, original.begin());
+                match.metric = similarity_floats(c.metric, pq_queries[i], original.begin(), c.dimensions);
+                heap.push(match);
+            }
+        }
+    }
+
+    // Export the best matches, that pass the threshold
+    ustore_length_t total_exported_matches = 0;
+    for (std::size_t i = 0; i != c.tasks_count; ++i) {
+        pq_t const& heap = heaps[i];
+        auto limit = count_limits[i];
+        ustore_length_t count = 0;
+        for (std::size_t j = 0; j != heap.size() && count != limit; ++j) {
+            match_t const& match = heap.begin()[j];
+            real_t exported_metric = similarity.to_metric(match.metric);
+            if (exported_metric < c.metric_threshold)
+                continue;
+            found_keys[total_exported_matches + count] = std::abs(match.key);
+            found_metrics[total_exported_matches + count] = exported_metric;
+            ++count;
+        }
 
         found_counts[i] = count;
         found_offsets[i] = total_exported_matches;
+        total_exported_matches += count;
+    }
+}
 
-        for (std::size_t j = 0; j != count; ++j)
-            found_keys[total_exported_matches + j] = std::abs(temp_matches[j].key), //
-                found_metrics[total_exported_matches + j] = temp_matches[j].metric;
+#endif
 
-        total_exported_matches += count;
-        pq.clear();
+/**
+ * @brief Trains the codebooks of Product Quantization on a random sample of the originals.
+ */
+void pq_train_on_sample( //
+    ustore_vectors_compress_t const& c,
+    std::size_t dims,
+    ustore_options_t read_options,
+    real_t* centroids,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    // Half of the sampled keys are expected to be mirrors of the originals
+    ustore_length_t const samples_limit = c.samples_count ? c.samples_count : pq_default_samples_k;
+    ustore_length_t const sampled_keys_limit = samples_limit * 2;
+    ustore_length_t* sampled_counts {};
+    ustore_key_t* sampled_keys {};
+    ustore_sample_t sample {};
+    sample.db = c.db;
+    sample.error = c_error;
+    sample.transaction = c.transaction;
+    sample.arena = arena;
+    sample.options = ustore_options_t(read_options | ustore_option_dont_discard_memory_k);
+    sample.tasks_count = 1;
+    sample.collections = &c.collection;
+    sample.count_limits = &sampled_keys_limit;
+    sample.counts = &sampled_counts;
+    sample.keys = &sampled_keys;
+    ustore_sample(&sample);
+    return_if_error_m(c_error);
+
+    uninitialized_array_gt<ustore_key_t> originals_keys(arena);
+    for (std::size_t i = 0; i != sampled_counts[0]; ++i) {
+        if (sampled_keys[i] == schema_key_k || sampled_keys[i] == 0)
+            continue;
+        originals_keys.push_back(std::abs(sampled_keys[i]), c_error);
+        return_if_error_m(c_error);
     }
-}
\ No newline at end of file
+    std::sort(originals_keys.begin(), originals_keys.end());
+    auto unique_end = std::unique(originals_keys.begin(), originals_keys.end());
+    std::size_t const originals_count = std::min<std::size_t>(unique_end - originals_keys.begin(), samples_limit);
+    return_error_if_m(originals_count, c_error, args_wrong_k, "Not enough vectors to train on");
+
+    ustore_length_t* found_offsets {};
+    ustore_length_t* found_lengths {};
+    ustore_byte_t* found_values {};
+    ustore_read_t read {};
+    read.db = c.db;
+    read.error = c_error;
+    read.transaction = c.transaction;
+    read.arena = arena;
+    read.options = ustore_options_t(read_options | ustore_option_dont_discard_memory_k);
+    read.tasks_count = originals_count;
+    read.collections = &c.collection;
+    read.collections_stride = 0;
+    read.keys = originals_keys.begin();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.lengths = &found_lengths;
+    read.values = &found_values;
+    ustore_read(&read);
+    return_if_error_m(c_error);
+    unpack_originals(originals_count, dims, found_offsets, found_lengths, &found_values, arena, c_error);
+    return_if_error_m(c_error);
+
+    auto samples = arena.alloc<real_t>(originals_count * dims, c_error);
+    return_if_error_m(c_error);
+    std::size_t samples_count = 0;
+    for (std::size_t i = 0; i != originals_count; ++i) {
+        ustore_vector_scalar_t scalar_type;
+        if (found_lengths[i] == ustore_length_missing_k || !scalar_type_of(found_lengths[i], dims, scalar_type))
+            continue;
+        auto original_begin = reinterpret_cast<byte_t const*>(found_values + found_offsets[i]);
+        dequantize(original_begin, scalar_type, dims, samples.begin() + samples_count * dims);
+        ++samples_count;
+    }
+    return_error_if_m(samples_count, c_error, args_wrong_k, "Not enough vectors to train on");
+
+    pq_train(samples.begin(), samples_count, dims, c.subspaces, centroids, arena, c_error);
+}
+
+/**
+ * @brief Serializes the schema, followed by the codebooks, if the collection is compressed.
+ */
+value_view_t export_schema( //
+    schema_t const& schema,
+    real_t const* centroids,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    std::size_t const codebooks_bytes =
+        schema.quantization == quantization_pq_k ? pq_codebook_t::size_bytes(schema.dimensions) : 0;
+    auto tape = arena.alloc<byte_t>(sizeof(schema_t) + codebooks_bytes, c_error);
+    if (*c_error)
+        return {};
+    std::memcpy(tape.begin(), &schema, sizeof(schema_t));
+    if (codebooks_bytes)
+        std::memcpy(tape.begin() + sizeof(schema_t), centroids, codebooks_bytes);
+    return {tape.begin(), tape.size()};
+}
+
+void write_entries( //
+    ustore_database_t db,
+    ustore_transaction_t transaction,
+    ustore_options_t options,
+    ptr_range_gt<entry_t> entries,
+    linked_memory_lock_t& arena,
+    ustore_error_t* c_error) noexcept {
+
+    entry_t& first = entries[0];
+    ustore_write_t write {};
+    write.db = db;
+    write.error = c_error;
+    write.transaction = transaction;
+    write.arena = arena;
+    write.options = options;
+    write.tasks_count = entries.size();
+    write.collections = &first.collection_key.collection;
+    write.collections_stride = sizeof(entry_t);
+    write.keys = &first.collection_key.key;
+    write.keys_stride = sizeof(entry_t);
+    write.lengths = first.value.member_length();
+    write.lengths_stride = sizeof(entry_t);
+    write.values = first.value.member_ptr();
+    write.values_stride = sizeof(entry_t);
+    ustore_write(&write);
+}
+
+void validate_compression(ustore_vectors_compress_t const& c, schema_state_t const& state) noexcept {
+    schema_t const& schema = state.schema;
+    std::size_t const dims = schema.dimensions;
+    return_error_if_m(state.present, c.error, args_wrong_k, "Collection has no vectors");
+    return_error_if_m(c.subspaces || c.originals, c.error, args_wrong_k, "Nothing to compress");
+    return_error_if_m(!schema.originals_dropped,
+                      c.error,
+                      args_combo_k,
+                      "Collection was compressed without keeping the originals");
+    return_error_if_m(!c.subspaces || !schema.connectivity,
+                      c.error,
+                      args_combo_k,
+                      "Indexed collections can't be compressed");
+    return_error_if_m(!c.subspaces || (c.subspaces <= dims && dims % c.subspaces == 0),
+                      c.error,
+                      args_wrong_k,
+                      "Subspaces must evenly divide the dimensions");
+}
+
+/**
+ * @brief Re-encodes all the vectors of a collection, appending the new originals,
+ * the codes and the updated schema, that must replace them in a single write, to the `entries`.
+ */
+void compress_vectors( //
+    ustore_vectors_compress_t const& c,
+    ustore_transaction_t transaction,
+    schema_state_t state,
+    ustore_options_t read_options,
+    uninitialized_array_gt<entry_t>& entries,
+    linked_memory_lock_t& arena) noexcept {
+
+    schema_t& schema = state.schema;
+    std::size_t const dims = schema.dimensions;
+    ustore_vectors_compress_t scan_c = c;
+    scan_c.transaction = transaction;
+
+    // Codebooks are only re-trained on request, but are always preserved
+    auto centroids = arena.alloc<real_t>(dims * pq_centroids_k, c.error);
+    return_if_error_m(c.error);
+    if (c.subspaces) {
+        pq_train_on_sample(scan_c, dims, read_options, centroids.begin(), arena, c.error);
+        return_if_error_m(c.error);
+        schema.quantization = quantization_pq_k;
+        schema.subspaces = c.subspaces;
+        schema.originals_dropped = !c.keep_originals;
+    }
+    else if (state.centroids)
+        std::memcpy(centroids.begin(), state.centroids, pq_codebook_t::size_bytes(dims));
+    if (c.originals)
+        schema.originals_codec = codec_t::shuffle_lz4_k;
+    schema.compressing = false;
+
+    // Re-encode all the originals, keeping their keys and codes in separate growing arrays,
+    // and the re-compressed originals in the main arena, until they are written
+    pq_codebook_t codebook {centroids.begin(), c.subspaces, c.subspaces ? dims / c.subspaces : 0};
+    uninitialized_array_gt<ustore_key_t> encoded_keys(arena);
+    uninitialized_array_gt<byte_t> encoded_codes(arena);
+    auto decoded_vector = arena.alloc<real_t>(dims, c.error);
+    return_if_error_m(c.error);
+    auto pack_scratch = arena.alloc<byte_t>(dims * sizeof(double), c.error);
+    return_if_error_m(c.error);
+    ustore_arena_t scan_arena = nullptr;
+    auto callback = [&](ustore_key_t key, value_view_t stored) noexcept {
+        value_view_t vector = unpack_original(stored, dims, pack_scratch.begin(), arena, c.error);
+        ustore_vector_scalar_t scalar_type;
+        if (*c.error)
+            return false;
+        if (!scalar_type_of(vector.size(), dims, scalar_type))
+            return true;
+
+        // Dropped originals are removed, leaving just the codes
+        if (schema.originals_dropped || c.originals) {
+            value_view_t packed;
+            if (!schema.originals_dropped)
+                packed = pack_original(vector, dims, pack_scratch.begin(), arena, c.error);
+            if (*c.error)
+                return false;
+            if (packed.data() != stored.data()) {
+                entry_t entry;
+                entry.collection_key.collection = c.collection;
+                entry.collection_key.key = key;
+                entry.value = packed;
+                entries.push_back(entry, c.error);
+            }
+            if (*c.error)
+                return false;
+        }
+        if (!c.subspaces)
+            return true;
+
+        dequantize(vector.data(), scalar_type, dims, decoded_vector.begin());
+        std::size_t const codes_offset = encoded_codes.size();
+        encoded_keys.push_back(-key, c.error);
+        if (!*c.error)
+            encoded_codes.resize(codes_offset + codebook.codes_bytes(), c.error);
+        if (*c.error)
+            return false;
+        codebook.encode(decoded_vector.begin(), encoded_codes.begin() + codes_offset);
+        return true;
+    };
+    scan_range_collection(c.db,
+                          transaction,
+                          c.collection,
+                          read_options,
+                          1,
+                          std::numeric_limits<ustore_key_t>::max(),
+                          exact_scan_read_ahead_k,
+                          &scan_arena,
+                          c.error,
+                          callback);
+    ustore_arena_free(scan_arena);
+    return_if_error_m(c.error);
+
+    for (std::size_t i = 0; i != encoded_keys.size(); ++i) {
+        entry_t entry;
+        entry.collection_key.collection = c.collection;
+        entry.collection_key.key = encoded_keys[i];
+        entry.value = value_view_t {encoded_codes.begin() + i * codebook.codes_bytes(), codebook.codes_bytes()};
+        entries.push_back(entry, c.error);
+        return_if_error_m(c.error);
+    }
+    entry_t schema_entry;
+    schema_entry.collection_key.collection = c.collection;
+    schema_entry.collection_key.key = schema_key_k;
+    schema_entry.value = export_schema(schema, centroids.begin(), arena, c.error);
+    return_if_error_m(c.error);
+    entries.push_back(schema_entry, c.error);
+}
+
+void ustore_vectors_compress(ustore_vectors_compress_t* c_ptr) {
+
+    ustore_vectors_compress_t& c = *c_ptr;
+    linked_memory_lock_t arena = linked_memory(c.arena, c.options, c.error);
+    return_if_error_m(c.error);
+
+    auto read_options = ustore_options_t(c.options & ustore_option_transaction_dont_watch_k);
+    auto write_options = ustore_options_t(c.options & ~ustore_option_transaction_dont_watch_k);
+    strided_iterator_gt<ustore_collection_t const> collections {&c.collection, 0};
+    uninitialized_array_gt<entry_t> entries(arena);
+
+    // Inside of transactions, or without them, everything is replaced in a single pass
+    if (c.transaction || !ustore_supports_transactions_k) {
+        auto states = read_schemas(c.db, c.transaction, read_options, collections, 1, arena, c.error);
+        return_if_error_m(c.error);
+        validate_compression(c, states[0]);
+        return_if_error_m(c.error);
+        compress_vectors(c, c.transaction, states[0], read_options, entries, arena);
+        return_if_error_m(c.error);
+        write_entries(c.db, c.transaction, write_options, {entries.begin(), entries.end()}, arena, c.error);
+        return_if_error_m(c.error);
+#if defined(USTORE_USE_CUDA)
+        cuda_unpin(c.db, c.collection);
+#endif
+        return;
+    }
+
+    // Otherwise the collection is locked with a flag in its schema, that rejects concurrent writes.
+    // Writers read the schema in transactions, so the ones, that started before the lock, conflict
+    // with it. The version tells if another compression took over an abandoned lock in the meantime.
+    ustore_transaction_t txn = nullptr;
+    auto transact = [&](auto&& callback) noexcept {
+        ustore_transaction_init_t txn_init {};
+        txn_init.db = c.db;
+        txn_init.error = c.error;
+        txn_init.transaction = &txn;
+        ustore_transaction_init(&txn_init);
+        return_if_error_m(c.error);
+
+        auto states = read_schemas(c.db, txn, ustore_options_default_k, collections, 1, arena, c.error);
+        return_if_error_m(c.error);
+        callback(states[0]);
+        return_if_error_m(c.error);
+
+        ustore_transaction_commit_t txn_commit {};
+        txn_commit.db = c.db;
+        txn_commit.error = c.error;
+        txn_commit.transaction = txn;
+        txn_commit.options = ustore_options_t(c.options & ustore_option_write_flush_k);
+        ustore_transaction_commit(&txn_commit);
+    };
+
+    schema_state_t locked;
+    transact([&](schema_state_t const& state) noexcept {
+        validate_compression(c, state);
+        return_if_error_m(c.error);
+        locked = state;
+        locked.schema.compressing = true;
+        locked.schema.version++;
+        entry_t schema_entry;
+        schema_entry.collection_key.collection = c.collection;
+        schema_entry.collection_key.key = schema_key_k;
+        schema_entry.value = export_schema(locked.schema, locked.centroids, arena, c.error);
+        return_if_error_m(c.error);
+        write_entries(c.db, txn, write_options, {&schema_entry, &schema_entry + 1}, arena, c.error);
+    });
+    if (*c.error) {
+        ustore_transaction_free(txn);
+        return;
+    }
+
+    // Failed compressions only release the lock, keeping the previous schema
+    compress_vectors(c, nullptr, locked, read_options, entries, arena);
+    ustore_error_t compression_error = *c.error;
+    if (compression_error) {
+        *c.error = nullptr;
+        locked.schema.compressing = false;
+        entry_t schema_entry;
+        schema_entry.collection_key.collection = c.collection;
+        schema_entry.collection_key.key = schema_key_k;
+        schema_entry.value = export_schema(locked.schema, locked.centroids, arena, c.error);
+        entries.clear();
+        if (!*c.error)
+            entries.push_back(schema_entry, c.error);
+    }
+
+    transact([&](schema_state_t const& state) noexcept {
+        return_error_if_m(state.present && state.schema.compressing && state.schema.version == locked.schema.version,
+                          c.error,
+                          args_combo_k,
+                          "Collection was compressed concurrently");
+        write_entries(c.db, txn, write_options, {entries.begin(), entries.end()}, arena, c.error);
+    });
+    ustore_transaction_free(txn);
+    if (compression_error)
+        *c.error = compression_error;
+
+#if defined(USTORE_USE_CUDA)
+    cuda_unpin(c.db, c.collection);
+#endif
+}
@@ -0,0 +1,435 @@
+/**
+ * @file modality_vectors_cuda.cu
+ * @author Ashot Vardanian
+ *
+ * @brief Batched exact vector search on Nvidia GPUs.
+ * Complements @see "modality_vectors.cpp", which falls back to the host scan,
+ * whenever the device can't serve the request.
+ *
+ * Every block scores a tile of pinned vectors against one query with `__dp4a` instructions,
+ * and sorts the tile in shared memory with a bitonic network, keeping only the best candidates.
+ * The same tiled selection is repeated over the candidates, until just the top ones remain,
+ * so only a handful of matches per query ever leaves the device.
+ */
+#include <algorithm> // `std::lower_bound`
+#include <cmath>     // `INFINITY`
+#include <map>       // `std::map`
+#include <memory>    // `std::shared_ptr`
+#include <mutex>     // `std::mutex`
+#include <utility>   // `std::pair`
+#include <vector>    // `std::vector`
+
+#include <cuda_runtime.h>
+
+#include "helpers/linked_memory.hpp" // `safe_section`
+#include "helpers/threads.hpp"       // `threads_registry_t`
+#include "helpers/vectors_cuda.hpp"
+
+using namespace unum::ustore;
+using namespace unum;
+
+using quant_t = std::int8_t;
+using real_t = float;
+
+static constexpr unsigned tile_size_k = 1024;
+static constexpr unsigned block_threads_k = 256;
+static constexpr unsigned grid_queries_limit_k = 65535;
+static constexpr std::size_t candidates_budget_k = 256ul * 1024ul * 1024ul;
+static constexpr real_t product_scaling_k = 100 * 100;
+static constexpr unsigned missing_index_k = ~0u;
+
+/*********************************************************/
+/*****************	    Device Memory	  ****************/
+/*********************************************************/
+
+struct device_free_t {
+    void operator()(void* ptr) const noexcept { cudaFree(ptr); }
+};
+
+template <typename at>
+using device_ptr_gt = std::unique_ptr<at, device_free_t>;
+
+template <typename at>
+device_ptr_gt<at> device_alloc(std::size_t count, cudaError_t& status) noexcept {
+    void* ptr = nullptr;
+    status = cudaMalloc(&ptr, std::max<std::size_t>(count, 1) * sizeof(at));
+    return device_ptr_gt<at>(status == cudaSuccess ? static_cast<at*>(ptr) : nullptr);
+}
+
+/**
+ * @brief Quantized half of a collection in device memory. Keys stay on the host,
+ * as the device only works with positions in the sorted array.
+ */
+struct pinned_t {
+    std::vector<ustore_key_t> keys;
+    device_ptr_gt<quant_t> quants;
+    device_ptr_gt<real_t> norms;
+    std::size_t dimensions = 0;
+};
+
+using pinned_key_t = std::pair<ustore_database_t, ustore_collection_t>;
+
+/**
+ * @brief Searches hold shared ownership of the copies, so that they can be
+ * safely replaced or released by concurrent writes.
+ */
+struct pinned_registry_t {
+    std::mutex mutex;
+    std::map<pinned_key_t, std::shared_ptr<pinned_t>> pinned;
+    std::map<pinned_key_t, std::size_t> generations;
+
+    static pinned_registry_t& global() noexcept {
+        static pinned_registry_t registry;
+        return registry;
+    }
+
+    std::shared_ptr<pinned_t> find(pinned_key_t key) noexcept {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pinned.find(key);
+        return it != pinned.end() ? it->second : nullptr;
+    }
+};
+
+/*********************************************************/
+/*****************	   Device Kernels	  ****************/
+/*********************************************************/
+
+/**
+ * @brief Sorts `tile_size_k` candidates in shared memory by decreasing similarity.
+ * Must be called by all the threads of the block.
+ */
+__device__ void sort_tile(real_t* similarities, unsigned* indices) {
+    for (unsigned size = 2; size <= tile_size_k; size <<= 1) {
+        for (unsigned stride = size >> 1; stride > 0; stride >>= 1) {
+            for (unsigned i = threadIdx.x; i < tile_size_k; i += blockDim.x) {
+                unsigned const j = i ^ stride;
+                if (j <= i)
+                    continue;
+                bool const decreasing = (i & size) == 0;
+                bool const misordered =
+                    decreasing ? similarities[i] < similarities[j] : similarities[i] > similarities[j];
+                if (!misordered)
+                    continue;
+                real_t const similarity = similarities[i];
+                similarities[i] = similarities[j];
+                similarities[j] = similarity;
+                unsigned const index = indices[i];
+                indices[i] = indices[j];
+                indices[j] = index;
+            }
+            __syncthreads();
+        }
+    }
+}
+
+/**
+ * @brief Exports the `top` candidates of a sorted tile into its own slot of the output.
+ */
+__device__ void export_tile(real_t const* similarities,
+                            unsigned const* indices,
+                            unsigned top,
+                            real_t* output_similarities,
+                            unsigned* output_indices) {
+    std::size_t const offset = (std::size_t(blockIdx.y) * gridDim.x + blockIdx.x) * top;
+    for (unsigned i = threadIdx.x; i < top; i += blockDim.x) {
+        output_similarities[offset + i] = similarities[i];
+        output_indices[offset + i] = indices[i];
+    }
+}
+
+/**
+ * @brief Scores the `[begin, end)` range of pinned vectors against a batch of queries.
+ * The grid spans the tiles of vectors along X, and the queries along Y.
+ */
+__global__ void score_tiles_kernel( //
+    quant_t const* vectors,
+    real_t const* norms,
+    std::size_t stride,
+    std::size_t begin,
+    std::size_t end,
+    quant_t const* queries,
+    real_t const* queries_norms,
+    ustore_vector_metric_t metric,
+    unsigned top,
+    real_t* output_similarities,
+    unsigned* output_indices) {
+
+    __shared__ real_t similarities[tile_size_k];
+    __shared__ unsigned indices[tile_size_k];
+
+    std::size_t const words = stride / 4;
+    int const* query = reinterpret_cast<int const*>(queries + std::size_t(blockIdx.y) * stride);
+    for (unsigned i = threadIdx.x; i < tile_size_k; i += blockDim.x) {
+        std::size_t const idx = begin + std::size_t(blockIdx.x) * tile_size_k + i;
+        similarities[i] = -INFINITY;
+        indices[i] = missing_index_k;
+        if (idx >= end)
+            continue;
+
+        int const* vector = reinterpret_cast<int const*>(vectors + idx * stride);
+        int ab = 0, aa = 0, bb = 0;
+        for (std::size_t w = 0; w != words; ++w) {
+            ab = __dp4a(query[w], vector[w], ab);
+            if (metric == ustore_vector_metric_l2_k) {
+                aa = __dp4a(query[w], query[w], aa);
+                bb = __dp4a(vector[w], vector[w], bb);
+            }
+        }
+
+        real_t similarity = real_t(ab) / product_scaling_k;
+        if (metric == ustore_vector_metric_cos_k)
+            similarity /= queries_norms[blockIdx.y] * norms[idx];
+        else if (metric == ustore_vector_metric_l2_k)
+            similarity = -sqrtf(real_t(max(0ll, (long long)aa + bb - 2ll * ab)) / product_scaling_k);
+        similarities[i] = similarity;
+        indices[i] = static_cast<unsigned>(idx);
+    }
+    __syncthreads();
+
+    sort_tile(similarities, indices);
+    export_tile(similarities, indices, top, output_similarities, output_indices);
+}
+
+/**
+ * @brief Shrinks `count` candidates of every query to `top` per tile of them.
+ * The grid spans the tiles of candidates along X, and the queries along Y.
+ */
+__global__ void select_tiles_kernel( //
+    real_t const* candidates_similarities,
+    unsigned const* candidates_indices,
+    std::size_t count,
+    unsigned top,
+    real_t* output_similarities,
+    unsigned* output_indices) {
+
+    __shared__ real_t similarities[tile_size_k];
+    __shared__ unsigned indices[tile_size_k];
+
+    std::size_t const offset = std::size_t(blockIdx.y) * count;
+    for (unsigned i = threadIdx.x; i < tile_size_k; i += blockDim.x) {
+        std::size_t const idx = std::size_t(blockIdx.x) * tile_size_k + i;
+        similarities[i] = idx < count ? candidates_similarities[offset + idx] : -INFINITY;
+        indices[i] = idx < count ? candidates_indices[offset + idx] : missing_index_k;
+    }
+    __syncthreads();
+
+    sort_tile(similarities, indices);
+    export_tile(similarities, indices, top, output_similarities, output_indices);
+}
+
+/*********************************************************/
+/*****************	   C++ Interface	  ****************/
+/*********************************************************/
+
+bool unum::ustore::cuda_pinned(ustore_database_t db, ustore_collection_t collection, std::size_t dimensions) noexcept {
+    std::shared_ptr<pinned_t> pinned = pinned_registry_t::global().find({db, collection});
+    return pinned && pinned->dimensions == dimensions;
+}
+
+std::size_t unum::ustore::cuda_generation(ustore_database_t db, ustore_collection_t collection) noexcept {
+    pinned_registry_t& registry = pinned_registry_t::global();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.generations.find({db, collection});
+    return it != registry.generations.end() ? it->second : 0;
+}
+
+void unum::ustore::cuda_pin( //
+    ustore_database_t db,
+    ustore_collection_t collection,
+    std::size_t generation,
+    std::vector<ustore_key_t>&& keys,
+    quant_t const* quants,
+    real_t const* norms,
+    std::size_t dimensions,
+    ustore_error_t* c_error) noexcept {
+
+    std::size_t const count = keys.size();
+    std::size_t const stride = cuda_stride(dimensions);
+    std::shared_ptr<pinned_t> pinned;
+    safe_section("Allocating pinned vectors", c_error, [&] { pinned = std::make_shared<pinned_t>(); });
+    return_if_error_m(c_error);
+
+    cudaError_t status = cudaSuccess;
+    pinned->quants = device_alloc<quant_t>(count * stride, status);
+    return_error_if_m(status == cudaSuccess, c_error, out_of_memory_k, "Couldn't allocate device memory");
+    pinned->norms = device_alloc<real_t>(count, status);
+    return_error_if_m(status == cudaSuccess, c_error, out_of_memory_k, "Couldn't allocate device memory");
+    status = cudaMemcpy(pinned->quants.get(), quants, count * stride, cudaMemcpyHostToDevice);
+    return_error_if_m(status == cudaSuccess, c_error, error_unknown_k, cudaGetErrorString(status));
+    status = cudaMemcpy(pinned->norms.get(), norms, count * sizeof(real_t), cudaMemcpyHostToDevice);
+    return_error_if_m(status == cudaSuccess, c_error, error_unknown_k, cudaGetErrorString(status));
+    pinned->keys = std::move(keys);
+    pinned->dimensions = dimensions;
+
+    // Copies of freed databases must be released, as their handles may be reused
+    safe_section("Subscribing to frees", c_error, [&] { threads_registry_t::global().on_forget(&cuda_unpin_all); });
+    return_if_error_m(c_error);
+    pinned_registry_t& registry = pinned_registry_t::global();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto generation_it = registry.generations.find({db, collection});
+    std::size_t const current_generation = generation_it != registry.generations.end() ? generation_it->second : 0;
+    if (current_generation == generation)
+        registry.pinned[{db, collection}] = std::move(pinned);
+}
+
+void unum::ustore::cuda_unpin(ustore_database_t db, ustore_collection_t collection) noexcept {
+    std::shared_ptr<pinned_t> released;
+    pinned_registry_t& registry = pinned_registry_t::global();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    ++registry.generations[{db, collection}];
+    auto it = registry.pinned.find({db, collection});
+    if (it == registry.pinned.end())
+        return;
+    released = std::move(it->second);
+    registry.pinned.erase(it);
+}
+
+void unum::ustore::cuda_unpin_all(ustore_database_t db) noexcept {
+    pinned_registry_t& registry = pinned_registry_t::global();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto belongs = [=](auto const& pair) noexcept { return pair.first.first == db; };
+    for (auto it = registry.pinned.begin(); it != registry.pinned.end();)
+        it = belongs(*it) ? registry.pinned.erase(it) : std::next(it);
+    for (auto it = registry.generations.begin(); it != registry.generations.end();)
+        it = belongs(*it) ? registry.generations.erase(it) : std::next(it);
+}
+
+bool unum::ustore::cuda_search( //
+    ustore_database_t db,
+    ustore_collection_t collection,
+    ustore_vector_metric_t metric,
+    quant_t const* const* queries,
+    real_t const* queries_norms,
+    std::size_t queries_count,
+    ustore_key_t start_key,
+    ustore_key_t end_key,
+    std::size_t top,
+    ustore_length_t* found_counts,
+    ustore_key_t* found_keys,
+    real_t* found_similarities,
+    ustore_error_t* c_error) noexcept {
+
+    std::shared_ptr<pinned_t> pinned = pinned_registry_t::global().find({db, collection});
+    if (!pinned)
+        return false;
+
+    std::fill_n(found_counts, queries_count, 0);
+    std::vector<ustore_key_t> const& keys = pinned->keys;
+    std::size_t const begin = std::lower_bound(keys.begin(), keys.end(), start_key) - keys.begin();
+    std::size_t const end = std::lower_bound(keys.begin(), keys.end(), end_key) - keys.begin();
+    if (begin >= end || !top)
+        return true;
+
+    // Both the scored tiles and the following selections fit into two buffers of candidates,
+    // so the batch of queries is limited by their size
+    std::size_t const stride = cuda_stride(pinned->dimensions);
+    std::size_t const tiles_count = (end - begin + tile_size_k - 1) / tile_size_k;
+    std::size_t const candidates_per_query = tiles_count * top;
+    std::size_t const candidate_bytes = 2 * (sizeof(real_t) + sizeof(unsigned));
+    std::size_t const batch_limit = std::clamp<std::size_t>( //
+        candidates_budget_k / (candidates_per_query * candidate_bytes),
+        1,
+        grid_queries_limit_k);
+    std::size_t const batch_size = std::min(batch_limit, queries_count);
+
+    std::vector<quant_t> batch_quants;
+    std::vector<real_t> batch_similarities;
+    std::vector<unsigned> batch_indices;
+    safe_section("Allocating host buffers", c_error, [&] {
+        batch_quants.resize(batch_size * stride);
+        batch_similarities.resize(batch_size * top);
+        batch_indices.resize(batch_size * top);
+    });
+    if (*c_error)
+        return true;
+
+    cudaError_t status = cudaSuccess;
+    auto queries_quants = device_alloc<quant_t>(batch_size * stride, status);
+    auto norms = device_alloc<real_t>(batch_size, status);
+    auto similarities = device_alloc<real_t>(batch_size * candidates_per_query, status);
+    auto indices = device_alloc<unsigned>(batch_size * candidates_per_query, status);
+    auto next_similarities = device_alloc<real_t>(batch_size * candidates_per_query, status);
+    auto next_indices = device_alloc<unsigned>(batch_size * candidates_per_query, status);
+    if (!queries_quants || !norms || !similarities || !indices || !next_similarities || !next_indices) {
+        log_error_m(c_error, out_of_memory_k, "Couldn't allocate device memory");
+        return true;
+    }
+
+    for (std::size_t batch_begin = 0; batch_begin < queries_count; batch_begin += batch_size) {
+        std::size_t const batch_count = std::min(batch_size, queries_count - batch_begin);
+        std::fill(batch_quants.begin(), batch_quants.end(), quant_t(0));
+        for (std::size_t i = 0; i != batch_count; ++i)
+            std::copy_n(queries[batch_begin + i], pinned->dimensions, batch_quants.data() + i * stride);
+
+        status = cudaMemcpy(queries_quants.get(), batch_quants.data(), batch_count * stride, cudaMemcpyHostToDevice);
+        if (status == cudaSuccess)
+            status = cudaMemcpy(norms.get(),
+                                queries_norms + batch_begin,
+                                batch_count * sizeof(real_t),
+                                cudaMemcpyHostToDevice);
+        if (status != cudaSuccess) {
+            log_error_m(c_error, error_unknown_k, cudaGetErrorString(status));
+            return true;
+        }
+
+        dim3 const score_grid(static_cast<unsigned>(tiles_count), static_cast<unsigned>(batch_count));
+        score_tiles_kernel<<<score_grid, block_threads_k>>>(pinned->quants.get(),
+                                                           pinned->norms.get(),
+                                                           stride,
+                                                           begin,
+                                                           end,
+                                                           queries_quants.get(),
+                                                           norms.get(),
+                                                           metric,
+                                                           static_cast<unsigned>(top),
+                                                           similarities.get(),
+                                                           indices.get());
+
+        // Every pass shrinks the candidates at least four-fold, as the `top` is limited
+        std::size_t count = candidates_per_query;
+        while (count > top) {
+            std::size_t const selected_tiles = (count + tile_size_k - 1) / tile_size_k;
+            dim3 const select_grid(static_cast<unsigned>(selected_tiles), static_cast<unsigned>(batch_count));
+            select_tiles_kernel<<<select_grid, block_threads_k>>>(similarities.get(),
+                                                                 indices.get(),
+                                                                 count,
+                                                                 static_cast<unsigned>(top),
+                                                                 next_similarities.get(),
+                                                                 next_indices.get());
+            std::swap(similarities, next_similarities);
+            std::swap(indices, next_indices);
+            count = selected_tiles * top;
+        }
+
+        status = cudaGetLastError();
+        if (status == cudaSuccess)
+            status = cudaMemcpy(batch_similarities.data(),
+                                similarities.get(),
+                                batch_count * top * sizeof(real_t),
+                                cudaMemcpyDeviceToHost);
+        if (status == cudaSuccess)
+            status = cudaMemcpy(batch_indices.data(),
+                                indices.get(),
+                                batch_count * top * sizeof(unsigned),
+                                cudaMemcpyDeviceToHost);
+        if (status != cudaSuccess) {
+            log_error_m(c_error, error_unknown_k, cudaGetErrorString(status));
+            return true;
+        }
+
+        // Positions in the pinned array are translated back into keys
+        for (std::size_t i = 0; i != batch_count; ++i) {
+            std::size_t const query_idx = batch_begin + i;
+            ustore_length_t& found_count = found_counts[query_idx];
+            for (std::size_t j = 0; j != top; ++j) {
+                unsigned const index = batch_indices[i * top + j];
+                if (index == missing_index_k)
+                    break;
+                found_keys[query_idx * top + found_count] = keys[index];
+                found_similarities[query_idx * top + found_count] = batch_similarities[i * top + j];
+                ++found_count;
+            }
+        }
+    }
+    return true;
+}
@@ -6,6 +6,9 @@
  * @brief A web server implementing @b REST backend on top of any other
  * UStore implementation using pre-release draft of C++23 Networking TS,
  * through the means of @b Boost.Beast, @b Boost.ASIO and @b NLohmann.JSON.
+ *
+ * With `--per-core` every thread owns its `io_context` and a `SO_REUSEPORT`
+ * listener, avoiding cross-thread handoffs under heavy fan-in.
  */
 
 #include <cstdlib>
@@ -16,8 +19,15 @@
 #include <functional>
 #include <thread>   // Thread pool
 #include <charconv> // Parsing integers
+#include <cctype>   // `std::isspace`
 #include <iostream> // Logging to `std::cerr`
 #include <fstream>  // Parsing config file
+#include <cstring>  // `std::strcmp`
+
+#if defined(__linux__)
+#include <pthread.h> // `pthread_setaffinity_np`
+#include <sched.h>   // `cpu_set_t`
+#endif
 
 // Boost files are quite noisy in terms of warnings,
 // so let's silence them a bit.
@@ -47,6 +57,7 @@
 #endif
 
 #include "ustore/ustore.hpp"
+#include "helpers/linked_memory.hpp" // `linked_memory_t`
 
 namespace beast = boost::beast;   // from <boost/beast.hpp>
 namespace http = beast::http;     // from <boost/beast/http.hpp>
@@ -63,6 +74,11 @@ static constexpr char const* mime_msgpack_k = "application/msgpack";
 static constexpr char const* mime_cbor_k = "application/cbor";
 static constexpr char const* mime_bson_k = "application/bson";
 static constexpr char const* mime_ubjson_k = "application/ubjson";
+static constexpr char const* mime_ndjson_k = "application/x-ndjson";
+
+/// Batched requests are executed in slices of this many entries,
+/// which bounds the memory used per call, regardless of the body size.
+static constexpr std::size_t batch_slice_k = 4096;
 
 ustore_doc_field_type_t mime_to_format(beast::string_view mime) {
     if (mime == mime_json_k)
@@ -129,6 +145,37 @@ std::optional<beast::string_view> param_value(beast::string_view query_params, b
     return beast::string_view {value_begin, static_cast<size_t>(value_end - value_begin)};
 }
 
+/**
+ * @brief Memory reused by all the requests, served by one thread of the `io_context`.
+ * Between requests it is reset to a single block, fitted to the recent request sizes,
+ * so the steady state doesn't touch the allocator at all. Every request keeps all of
+ * its allocations, like with `::ustore_option_dont_discard_memory_k`, until the reset.
+ */
+class thread_arena_t {
+    linked_memory_t memory_;
+
+  public:
+    thread_arena_t() noexcept = default;
+    thread_arena_t(thread_arena_t const&) = delete;
+    ~thread_arena_t() noexcept { memory_.release_all(); }
+
+    ustore_arena_t* member_ptr() noexcept { return reinterpret_cast<ustore_arena_t*>(&memory_); }
+
+    /**
+     * @brief Prepares the arena for the next request.
+     * @see `linked_memory_t::release_partially()` for the fitting policy.
+     */
+    void reset() noexcept { memory_.release_partially(); }
+};
+
+inline thread_arena_t& thread_arena() noexcept {
+    thread_local thread_arena_t arena;
+    return arena;
+}
+
+/// Requests share the arena of their thread, and don't discard each others data.
+static constexpr ustore_options_t request_options_k = ustore_option_dont_discard_memory_k;
+
 template <typename body_at, typename allocator_at, typename send_response_at>
 void respond_to_one(db_session_t& session,
                     http::request<body_at, http::basic_fields<allocator_at>>&& req,
@@ -137,10 +184,13 @@ void respond_to_one(db_session_t& session,
     http::verb received_verb = req.method();
     beast::string_view received_path = req.target();
 
-    transaction_t txn(session.db());
-    blobs_collection_t collection;
+    // Nothing is constructed for requests outside of transactions,
+    // they directly address the HEAD state.
+    ustore_transaction_t txn = nullptr;
+    ustore_collection_t collection = ustore_collection_main_k;
     ustore_key_t key = 0;
-    ustore_options_t options = ustore_options_default_k;
+    ustore_arena_t* arena = thread_arena().member_ptr();
+    status_t status;
 
     // Parse the `key`
     auto key_begin = received_path.substr(5).begin();
@@ -163,19 +213,42 @@ void respond_to_one(db_session_t& session,
         char collection_name_buffer[65] = {0};
         std::memcpy(collection_name_buffer, collection_val->data(), std::min(collection_val->size(), 64ul));
 
-        status_t status;
-        ustore_collection_create_t collection_init {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .name = collection_name_buffer,
-            .id = &collection.raw,
-        };
+        ustore_collection_create_t collection_init {};
+        collection_init.db = session.db();
+        collection_init.error = status.member_ptr();
+        collection_init.name = collection_name_buffer;
+        collection_init.id = &collection;
 
         ustore_collection_create(&collection_init);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
     }
 
+    // Reads the length of the value, and optionally its content
+    ustore_length_t found_length = ustore_length_missing_k;
+    ustore_bytes_ptr_t found_value = nullptr;
+    auto read_one = [&](bool with_content) {
+        ustore_length_t* found_lengths = nullptr;
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_read_t read {};
+        read.db = session.db();
+        read.error = status.member_ptr();
+        read.transaction = txn;
+        read.arena = arena;
+        read.options = request_options_k;
+        read.tasks_count = 1;
+        read.collections = &collection;
+        read.keys = &key;
+        read.lengths = &found_lengths;
+        read.values = with_content ? &found_values : nullptr;
+        ustore_read(&read);
+        if (!status)
+            return false;
+        found_length = found_lengths[0];
+        found_value = found_values;
+        return true;
+    };
+
     // Once we know, which collection, key and transaction user is
     // interested in - perform the actions depending on verbs.
     switch (received_verb) {
@@ -183,42 +256,21 @@ void respond_to_one(db_session_t& session,
         // Read the data:
     case http::verb::get: {
 
-        arena_t tape(session.db());
-        status_t status;
-        ustore_read_t read {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-        };
-
-        ustore_read(&read);
-        if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
-
-        ustore_bytes_ptr_t begin = tape.ptr + sizeof(ustore_length_t);
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (!len)
+        if (!read_one(true))
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+        if (found_length == ustore_length_missing_k)
             return send_response(make_error(req, http::status::not_found, "Missing key"));
 
-        http::buffer_body::value_type body;
-        body.data = begin;
-        body.size = len;
-        body.more = false;
-
-        http::response<http::buffer_body> res {
+        // The arena is reused by the following requests, while the response
+        // is being sent asynchronously, so the content is copied out of it.
+        http::response<http::string_body> res {
             std::piecewise_construct,
-            std::make_tuple(std::move(body)),
+            std::make_tuple(std::string(reinterpret_cast<char const*>(found_value), found_length)),
             std::make_tuple(http::status::ok, req.version()),
         };
         res.set(http::field::server, server_name_k);
         res.set(http::field::content_type, mime_binary_k);
-        res.content_length(len);
+        res.content_length(found_length);
         res.keep_alive(req.keep_alive());
         return send_response(std::move(res));
     }
@@ -226,60 +278,25 @@ void respond_to_one(db_session_t& session,
         // Check the data:
     case http::verb::head: {
 
-        arena_t tape(session.db());
-        status_t status;
-        options = ustore_option_read_lengths_k;
-        ustore_read_t read {
-            .db = session.db(),
-            .transaction = txn.raw,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .options = options,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-            .error = error.member_ptr(),
-        };
-
-        ustore_read(&read);
-        if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
-
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (!len)
+        if (!read_one(false))
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+        if (found_length == ustore_length_missing_k)
             return send_response(make_error(req, http::status::not_found, "Missing key"));
 
         http::response<http::empty_body> res;
         res.set(http::field::server, server_name_k);
         res.set(http::field::content_type, mime_binary_k);
-        res.content_length(len);
+        res.content_length(found_length);
         res.keep_alive(req.keep_alive());
         return send_response(std::move(res));
     }
 
     // Insert data if it's missing:
     case http::verb::post: {
-        arena_t tape(session.db());
-        status_t status;
-        options = ustore_option_read_lengths_k;
-        ustore_read_t read {
-            .db = session.db(),
-            .transaction = txn.raw,
-            .collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .options = options,
-            .lengths = &tape.capacity,
-            .values = &tape.ptr,
-            .error = error.member_ptr(),
-        };
-
-        ustore_read(&read);
-        if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
 
-        ustore_length_t len = reinterpret_cast<ustore_length_t*>(tape.ptr)[0];
-        if (len)
+        if (!read_one(false))
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+        if (found_length != ustore_length_missing_k)
             return send_response(make_error(req, http::status::conflict, "Duplicate key"));
 
         [[fallthrough]];
@@ -299,27 +316,25 @@ void respond_to_one(db_session_t& session,
             return send_response(
                 make_error(req, http::status::unsupported_media_type, "Only binary payload is allowed"));
 
-        status_t status;
-        auto value = req.body();
-        auto value_ptr = reinterpret_cast<ustore_bytes_ptr_t>(value.data());
+        auto& value = req.body();
+        auto value_ptr = reinterpret_cast<ustore_bytes_cptr_t>(value.data());
         auto value_len = static_cast<ustore_length_t>(*opt_payload_len);
-        ustore_length_t value_off = 0;
 
-        ustore_write_t write {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options.collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .offsets = &value_off,
-            .lengths = &value_len,
-            .values = &value_ptr,
-        };
+        ustore_write_t write {};
+        write.db = session.db();
+        write.error = status.member_ptr();
+        write.transaction = txn;
+        write.arena = arena;
+        write.options = request_options_k;
+        write.tasks_count = 1;
+        write.collections = &collection;
+        write.keys = &key;
+        write.lengths = &value_len;
+        write.values = &value_ptr;
 
         ustore_write(&write);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
         http::response<http::empty_body> res;
         res.set(http::field::server, server_name_k);
@@ -328,29 +343,22 @@ void respond_to_one(db_session_t& session,
         return send_response(std::move(res));
     }
 
-        // Upsert data:
+        // Remove data:
     case http::verb::delete_: {
 
-        status_t status;
-        ustore_bytes_ptr_t value_ptr = nullptr;
-        ustore_length_t value_len = 0;
-        ustore_length_t value_off = 0;
-
-        ustore_write_t write {
-            .db = session.db(),
-            .error = error.member_ptr(),
-            .transaction = txn.raw,
-            .options = options.collections = &collection.raw,
-            .keys = &key,
-            .keys_stride = 1,
-            .offsets = &value_off,
-            .lengths = &value_len,
-            .values = &value_ptr,
-        };
+        ustore_write_t write {};
+        write.db = session.db();
+        write.error = status.member_ptr();
+        write.transaction = txn;
+        write.arena = arena;
+        write.options = request_options_k;
+        write.tasks_count = 1;
+        write.collections = &collection;
+        write.keys = &key;
 
         ustore_write(&write);
         if (!status)
-            return send_response(make_error(req, http::status::internal_server_error, error.raw));
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
 
         http::response<http::empty_body> res;
         res.set(http::field::server, server_name_k);
@@ -374,7 +382,7 @@ void respond_to_aos(db_session_t& session,
     http::verb received_verb = req.method();
     beast::string_view received_path = req.target();
 
-    transaction_t txn(session.db());
+    ustore_transaction_t txn = nullptr;
     std::vector<blobs_collection_t> collections(session.db());
     ustore_options_t options = ustore_options_default_k;
     std::vector<ustore_key_t> keys;
@@ -542,6 +550,351 @@ void respond_to_aos(db_session_t& session,
     return send_response(std::move(res));
 }
 
+/**
+ * @brief Reads one signed integer from a MessagePack stream.
+ * @return Number of consumed bytes, or zero if the next value isn't an integer.
+ */
+std::size_t msgpack_read_key(char const* begin, char const* end, ustore_key_t& key) noexcept {
+    if (begin == end)
+        return 0;
+
+    auto const marker = static_cast<std::uint8_t>(*begin);
+    auto read_big_endian = [&](std::size_t bytes, bool is_signed) -> std::size_t {
+        if (static_cast<std::size_t>(end - begin) < bytes + 1)
+            return 0;
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i != bytes; ++i)
+            value = (value << 8) | static_cast<std::uint8_t>(begin[1 + i]);
+        if (is_signed && bytes < 8 && (value >> (bytes * 8 - 1)))
+            value |= ~std::uint64_t(0) << (bytes * 8);
+        key = static_cast<ustore_key_t>(value);
+        return bytes + 1;
+    };
+
+    if (marker <= 0x7f)
+        return key = marker, 1;
+    if (marker >= 0xe0)
+        return key = static_cast<std::int8_t>(marker), 1;
+    switch (marker) {
+    case 0xcc: return read_big_endian(1, false);
+    case 0xcd: return read_big_endian(2, false);
+    case 0xce: return read_big_endian(4, false);
+    case 0xcf: return read_big_endian(8, false);
+    case 0xd0: return read_big_endian(1, true);
+    case 0xd1: return read_big_endian(2, true);
+    case 0xd2: return read_big_endian(4, true);
+    case 0xd3: return read_big_endian(8, true);
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Measures the length of the next MessagePack value in a stream,
+ * so that documents can be sliced without being parsed.
+ * @return Number of bytes in the value, or zero if it is malformed.
+ */
+std::size_t msgpack_value_length(char const* begin, char const* end) noexcept {
+    // Containers are skipped iteratively, counting the values still to be visited
+    char const* it = begin;
+    std::size_t remaining = 1;
+    auto big_endian = [&](std::size_t bytes) -> std::size_t {
+        std::size_t value = 0;
+        for (std::size_t i = 0; i != bytes; ++i)
+            value = (value << 8) | static_cast<std::uint8_t>(it[1 + i]);
+        return value;
+    };
+
+    while (remaining) {
+        if (it == end)
+            return 0;
+        auto const marker = static_cast<std::uint8_t>(*it);
+        std::size_t const available = static_cast<std::size_t>(end - it);
+        std::size_t header = 1, payload = 0, children = 0;
+        if (marker <= 0x7f || marker >= 0xe0 || (marker >= 0xc0 && marker <= 0xc3))
+            ;
+        else if (marker >= 0x80 && marker <= 0x8f)
+            children = 2 * (marker & 0x0f);
+        else if (marker >= 0x90 && marker <= 0x9f)
+            children = marker & 0x0f;
+        else if (marker >= 0xa0 && marker <= 0xbf)
+            payload = marker & 0x1f;
+        else {
+            // Extensions and sized headers, followed by the lengths of their payloads
+            std::size_t length_bytes = 0, fixed_payload = 0, children_per_entry = 0;
+            switch (marker) {
+            case 0xc4: case 0xc7: case 0xd9: length_bytes = 1; break;
+            case 0xc5: case 0xc8: case 0xda: length_bytes = 2; break;
+            case 0xc6: case 0xc9: case 0xdb: length_bytes = 4; break;
+            case 0xcc: case 0xd0: fixed_payload = 1; break;
+            case 0xcd: case 0xd1: fixed_payload = 2; break;
+            case 0xca: case 0xce: case 0xd2: fixed_payload = 4; break;
+            case 0xcb: case 0xcf: case 0xd3: fixed_payload = 8; break;
+            case 0xd4: fixed_payload = 2; break;
+            case 0xd5: fixed_payload = 3; break;
+            case 0xd6: fixed_payload = 5; break;
+            case 0xd7: fixed_payload = 9; break;
+            case 0xd8: fixed_payload = 17; break;
+            case 0xdc: length_bytes = 2, children_per_entry = 1; break;
+            case 0xdd: length_bytes = 4, children_per_entry = 1; break;
+            case 0xde: length_bytes = 2, children_per_entry = 2; break;
+            case 0xdf: length_bytes = 4, children_per_entry = 2; break;
+            default: return 0;
+            }
+            if (available < 1 + length_bytes)
+                return 0;
+            std::size_t const length = big_endian(length_bytes);
+            bool const is_extension = marker >= 0xc7 && marker <= 0xc9;
+            header = 1 + length_bytes + is_extension;
+            payload = children_per_entry ? 0 : fixed_payload + length;
+            children = children_per_entry * length;
+        }
+        if (available < header + payload)
+            return 0;
+        it += header + payload;
+        remaining += children;
+        --remaining;
+    }
+    return static_cast<std::size_t>(it - begin);
+}
+
+/**
+ * @brief Splits a batched request body into entries: lines of NDJSON
+ * or consecutive values of MessagePack. Empty lines are skipped.
+ * @return False, if the body is malformed.
+ */
+template <typename callback_at>
+bool for_each_batch_entry(beast::string_view body, bool is_msgpack, callback_at&& callback) {
+    char const* it = body.data();
+    char const* const end = body.data() + body.size();
+    while (it != end) {
+        char const* entry_end = nullptr;
+        if (is_msgpack) {
+            std::size_t length = msgpack_value_length(it, end);
+            if (!length)
+                return false;
+            entry_end = it + length;
+        }
+        else {
+            entry_end = std::find(it, end, '\n');
+            bool const is_blank = std::all_of(it, entry_end, [](char c) { return std::isspace(c); });
+            if (is_blank) {
+                it = entry_end + (entry_end != end);
+                continue;
+            }
+        }
+        if (!callback(beast::string_view {it, static_cast<std::size_t>(entry_end - it)}))
+            return false;
+        it = entry_end + (!is_msgpack && entry_end != end);
+    }
+    return true;
+}
+
+/**
+ * @brief Handles many keys or documents per request, amortizing the per-request overhead.
+ *
+ * - GET: Body lists keys, response lists the documents or nulls, for missing ones.
+ * - PUT: Body lists documents, each with an "_id" key.
+ * - DELETE: Body lists keys to remove.
+ *
+ * Entries are NDJSON lines or consecutive MessagePack values, depending on the
+ * content type. Results follow the same format and are sent with chunked encoding,
+ * while the connection is kept alive for the following requests.
+ */
+template <typename body_at, typename allocator_at, typename send_response_at>
+void respond_to_batch(db_session_t& session,
+                      http::request<body_at, http::basic_fields<allocator_at>>&& req,
+                      send_response_at&& send_response) {
+
+    http::verb received_verb = req.method();
+    beast::string_view received_path = req.target();
+    auto params_begin = std::find(received_path.begin(), received_path.end(), '?');
+    auto params_str = beast::string_view {params_begin, static_cast<size_t>(received_path.end() - params_begin)};
+
+    auto payload_type = req[http::field::content_type];
+    bool const is_msgpack = payload_type == mime_msgpack_k;
+    if (!is_msgpack && payload_type != mime_ndjson_k)
+        return send_response(make_error(req,
+                                        http::status::unsupported_media_type,
+                                        "Batches must be encoded as NDJSON or MessagePack"));
+
+    status_t status;
+    ustore_collection_t collection = ustore_collection_main_k;
+    if (auto collection_val = param_value(params_str, "col="); collection_val) {
+        std::string collection_name(collection_val->data(), collection_val->size());
+        ustore_collection_create_t collection_init {};
+        collection_init.db = session.db();
+        collection_init.error = status.member_ptr();
+        collection_init.name = collection_name.c_str();
+        collection_init.id = &collection;
+        ustore_collection_create(&collection_init);
+        if (!status)
+            return send_response(make_error(req, http::status::internal_server_error, status.message()));
+    }
+
+    // Documents are passed to the engine as they are, keys are parsed
+    beast::string_view body = req.body();
+    std::vector<ustore_key_t> keys;
+    std::vector<ustore_bytes_cptr_t> docs_begins;
+    std::vector<ustore_length_t> docs_lengths;
+    bool const expects_docs = received_verb == http::verb::put;
+    bool const is_valid = for_each_batch_entry(body, is_msgpack, [&](beast::string_view entry) {
+        if (expects_docs) {
+            docs_begins.push_back(reinterpret_cast<ustore_bytes_cptr_t>(entry.data()));
+            docs_lengths.push_back(static_cast<ustore_length_t>(entry.size()));
+            return true;
+        }
+        ustore_key_t key = 0;
+        if (is_msgpack)
+            return msgpack_read_key(entry.data(), entry.data() + entry.size(), key) == entry.size() &&
+                   (keys.push_back(key), true);
+        auto trimmed_end = entry.data() + entry.size();
+        while (trimmed_end != entry.data() && std::isspace(trimmed_end[-1]))
+            --trimmed_end;
+        auto result = std::from_chars(entry.data(), trimmed_end, key);
+        return result.ec == std::errc() && result.ptr == trimmed_end && (keys.push_back(key), true);
+    });
+    if (!is_valid)
+        return send_response(make_error(req, http::status::bad_request, "Couldn't parse the batch entries"));
+
+    ustore_arena_t* arena = thread_arena().member_ptr();
+    ustore_doc_field_type_t const format = is_msgpack ? ustore_doc_field_msgpack_k : ustore_doc_field_json_k;
+    std::string response_str;
+
+    switch (received_verb) {
+
+    case http::verb::get: {
+        for (std::size_t slice_begin = 0; slice_begin < keys.size(); slice_begin += batch_slice_k) {
+            std::size_t const slice_length = std::min(batch_slice_k, keys.size() - slice_begin);
+            ustore_length_t* found_offsets = nullptr;
+            ustore_length_t* found_lengths = nullptr;
+            ustore_bytes_ptr_t found_values = nullptr;
+            ustore_docs_read_t docs_read {};
+            docs_read.db = session.db();
+            docs_read.error = status.member_ptr();
+            docs_read.arena = arena;
+            docs_read.type = format;
+            docs_read.tasks_count = slice_length;
+            docs_read.collections = &collection;
+            docs_read.keys = keys.data() + slice_begin;
+            docs_read.keys_stride = sizeof(ustore_key_t);
+            docs_read.offsets = &found_offsets;
+            docs_read.lengths = &found_lengths;
+            docs_read.values = &found_values;
+            ustore_docs_read(&docs_read);
+            if (!status)
+                return send_response(make_error(req, http::status::internal_server_error, status.message()));
+
+            // Converted documents are exported without presences, so the missing ones are told by lengths
+            for (std::size_t i = 0; i != slice_length; ++i) {
+                bool const is_present = found_lengths[i] != ustore_length_missing_k;
+                if (is_present)
+                    response_str.append(reinterpret_cast<char const*>(found_values) + found_offsets[i],
+                                        found_lengths[i]);
+                else if (is_msgpack)
+                    response_str.push_back(static_cast<char>(0xc0));
+                else
+                    response_str.append("null");
+                if (!is_msgpack)
+                    response_str.push_back('\n');
+            }
+        }
+        break;
+    }
+
+    case http::verb::put: {
+        for (std::size_t slice_begin = 0; slice_begin < docs_begins.size(); slice_begin += batch_slice_k) {
+            std::size_t const slice_length = std::min(batch_slice_k, docs_begins.size() - slice_begin);
+            ustore_docs_write_t docs_write {};
+            docs_write.db = session.db();
+            docs_write.error = status.member_ptr();
+            docs_write.arena = arena;
+            docs_write.tasks_count = slice_length;
+            docs_write.type = format;
+            docs_write.modification = ustore_doc_modify_upsert_k;
+            docs_write.collections = &collection;
+            docs_write.lengths = docs_lengths.data() + slice_begin;
+            docs_write.lengths_stride = sizeof(ustore_length_t);
+            docs_write.values = docs_begins.data() + slice_begin;
+            docs_write.values_stride = sizeof(ustore_bytes_cptr_t);
+            docs_write.id_field = "_id";
+            ustore_docs_write(&docs_write);
+            if (!status)
+                return send_response(make_error(req, http::status::internal_server_error, status.message()));
+        }
+        break;
+    }
+
+    case http::verb::delete_: {
+        for (std::size_t slice_begin = 0; slice_begin < keys.size(); slice_begin += batch_slice_k) {
+            std::size_t const slice_length = std::min(batch_slice_k, keys.size() - slice_begin);
+            ustore_write_t write {};
+            write.db = session.db();
+            write.error = status.member_ptr();
+            write.arena = arena;
+            write.tasks_count = slice_length;
+            write.collections = &collection;
+            write.keys = keys.data() + slice_begin;
+            write.keys_stride = sizeof(ustore_key_t);
+            ustore_write(&write);
+            if (!status)
+                return send_response(make_error(req, http::status::internal_server_error, status.message()));
+        }
+        break;
+    }
+
+    default: return send_response(make_error(req, http::status::bad_request, "Unsupported HTTP verb"));
+    }
+
+    http::response<http::string_body> res {
+        std::piecewise_construct,
+        std::make_tuple(std::move(response_str)),
+        std::make_tuple(http::status::ok, req.version()),
+    };
+    res.set(http::field::server, server_name_k);
+    res.set(http::field::content_type, payload_type);
+    res.keep_alive(req.keep_alive());
+    res.chunked(req.version() >= 11);
+    if (!res.chunked())
+        res.prepare_payload();
+    return send_response(std::move(res));
+}
+
+/**
+ * @brief Exports the counters and latency histograms of the underlying engine.
+ * Prometheus text format is used by default, and JSON with `?format=json`.
+ */
+template <typename body_at, typename allocator_at, typename send_response_at>
+void respond_to_metrics(db_session_t& session,
+                        http::request<body_at, http::basic_fields<allocator_at>>&& req,
+                        send_response_at&& send_response) {
+
+    if (req.method() != http::verb::get)
+        return send_response(make_error(req, http::status::method_not_allowed, "Metrics can only be read"));
+
+    beast::string_view received_path = req.target();
+    bool const is_json = param_value(received_path, "format=") == beast::string_view {"json"};
+
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = session.db();
+    control.arena = thread_arena().member_ptr();
+    control.error = status.member_ptr();
+    control.request = is_json ? "metrics" : "metrics.prometheus";
+    control.response = &response;
+    ustore_database_control(&control);
+    if (!status)
+        return send_response(make_error(req, http::status::internal_server_error, status.message()));
+
+    http::response<http::string_body> res {http::status::ok, req.version()};
+    res.set(http::field::server, server_name_k);
+    res.set(http::field::content_type, is_json ? mime_json_k : "text/plain; version=0.0.4");
+    res.keep_alive(req.keep_alive());
+    res.body() = response;
+    res.prepare_payload();
+    return send_response(std::move(res));
+}
+
 /**
  * @brief Primary dispatch point, routing incoming HTTP requests
  *        into underlying UStore calls, preparing results and sending back.
@@ -557,8 +910,15 @@ void route_request(db_session_t& session,
                std::string(beast::http::to_string(received_verb)),
                std::string(received_path));
 
+    // Responses never reference the arena, so it is safe to reset before every request
+    thread_arena().reset();
+
+    // Scraping the metrics:
+    if (received_path.starts_with("/metrics"))
+        return respond_to_metrics(session, std::move(req), send_response);
+
     // Modifying single entries:
-    if (received_path.starts_with("/one/"))
+    else if (received_path.starts_with("/one/"))
         return respond_to_one(session, std::move(req), send_response);
 
     // Modifying collections:
@@ -577,6 +937,10 @@ void route_request(db_session_t& session,
     else if (received_path.starts_with("/aos/"))
         return respond_to_aos(session, std::move(req), send_response);
 
+    // Many keys or documents at once:
+    else if (received_path.starts_with("/batch/"))
+        return respond_to_batch(session, std::move(req), send_response);
+
     // Structure-of-Arrays:
     else if (received_path.starts_with("/soa/"))
         return send_response(make_error(req, http::status::bad_request, "Batch API aren't implemented yet"));
@@ -697,18 +1061,32 @@ class web_db_session_t : public std::enable_shared_from_this<web_db_session_t> {
 
 //------------------------------------------------------------------------------
 
+/// Lets several listeners bind the same port, with the kernel balancing connections between them.
+using reuse_port_t = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
 /**
  * @brief Spins on sockets, listening for new connection requests.
  *        Once accepted, allocates and dispatches a new @c web_db_session_t.
+ *
+ * In the "per-core" mode every thread runs its own single-threaded `io_context`,
+ * with a separate listener on a shared port. Connections never leave the thread,
+ * that accepted them, so no strands are needed.
  */
 class listener_t : public std::enable_shared_from_this<listener_t> {
     net::io_context& io_context_;
     tcp::acceptor acceptor_;
     std::shared_ptr<db_w_clients_t> db_;
+    bool per_core_ = false;
 
   public:
-    listener_t(net::io_context& io_context, tcp::endpoint endpoint, std::shared_ptr<db_w_clients_t> const& session)
-        : io_context_(io_context), acceptor_(net::make_strand(io_context)), db_(session) {
+    listener_t(net::io_context& io_context,
+               tcp::endpoint endpoint,
+               std::shared_ptr<db_w_clients_t> const& session,
+               bool per_core = false)
+        : io_context_(io_context),
+          acceptor_(per_core ? net::any_io_executor(io_context.get_executor())
+                             : net::any_io_executor(net::make_strand(io_context))),
+          db_(session), per_core_(per_core) {
         connect_to(endpoint);
     }
 
@@ -717,9 +1095,10 @@ class listener_t : public std::enable_shared_from_this<listener_t> {
 
   private:
     void do_accept() {
-        // The new connection gets its own strand
-        acceptor_.async_accept(net::make_strand(io_context_),
-                               beast::bind_front_handler(&listener_t::on_accept, shared_from_this()));
+        // The new connection gets its own strand, unless the thread is only serving this listener
+        auto executor = per_core_ ? net::any_io_executor(io_context_.get_executor())
+                                  : net::any_io_executor(net::make_strand(io_context_));
+        acceptor_.async_accept(executor, beast::bind_front_handler(&listener_t::on_accept, shared_from_this()));
     }
 
     void on_accept(beast::error_code ec, tcp::socket socket) {
@@ -746,6 +1125,11 @@ class listener_t : public std::enable_shared_from_this<listener_t> {
         if (ec)
             return log_failure(ec, "set_option");
 
+        if (per_core_)
+            acceptor_.set_option(reuse_port_t(true), ec);
+        if (ec)
+            return log_failure(ec, "set_option");
+
         // Bind to the server address
         acceptor_.bind(endpoint, ec);
         if (ec)
@@ -758,16 +1142,62 @@ class listener_t : public std::enable_shared_from_this<listener_t> {
     }
 };
 
+/**
+ * @brief Runs a separate single-threaded `io_context` and listener on every core.
+ * The kernel spreads incoming connections across listeners of the same port,
+ * and every connection is served by the thread that accepted it. When Boost.ASIO
+ * is compiled with `BOOST_ASIO_HAS_IO_URING` and `BOOST_ASIO_DISABLE_EPOLL`,
+ * sockets are driven by `io_uring` instead of `epoll`.
+ */
+int serve_per_core(tcp::endpoint endpoint, int threads, std::shared_ptr<db_w_clients_t> const& session) {
+
+    std::vector<std::unique_ptr<net::io_context>> io_contexts;
+    io_contexts.reserve(threads);
+    for (int i = 0; i != threads; ++i) {
+        // The concurrency hint of one disables the locking within the `io_context`
+        io_contexts.push_back(std::make_unique<net::io_context>(1));
+        std::make_shared<listener_t>(*io_contexts.back(), endpoint, session, true)->run();
+    }
+
+    unsigned const cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> v;
+    v.reserve(threads);
+    for (int i = 0; i != threads; ++i) {
+        v.emplace_back([&io_context = *io_contexts[i]] { io_context.run(); });
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i % cores, &cpus);
+        pthread_setaffinity_np(v.back().native_handle(), sizeof(cpu_set_t), &cpus);
+#endif
+    }
+    for (std::thread& thread : v)
+        thread.join();
+    return EXIT_SUCCESS;
+}
+
 //------------------------------------------------------------------------------
 
 int main(int argc, char* argv[]) {
 
+    // The optional flag may appear anywhere, and is removed from positional arguments
+    bool per_core = false;
+    argc = static_cast<int>(std::remove_if(argv + 1,
+                                           argv + argc,
+                                           [&](char const* arg) {
+                                               bool is_flag = std::strcmp(arg, "--per-core") == 0;
+                                               per_core |= is_flag;
+                                               return is_flag;
+                                           }) -
+                            argv);
+
     // Check command line arguments
     if (argc < 4) {
-        std::cerr << "Usage: ustore_beast_server <address> <port> <threads> <db_config_path>?\n"
+        std::cerr << "Usage: ustore_beast_server <address> <port> <threads> <db_config_path>? [--per-core]\n"
                   << "Example:\n"
                   << "    ustore_beast_server 0.0.0.0 8080 1\n"
                   << "    ustore_beast_server 0.0.0.0 8080 1 ./config.json\n"
+                  << "    ustore_beast_server 0.0.0.0 8080 16 ./config.json --per-core\n"
                   << "";
         return EXIT_FAILURE;
     }
@@ -802,6 +1232,9 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (per_core)
+        return serve_per_core(tcp::endpoint {address, port}, threads, session);
+
     // Create and launch a listening port
     auto io_context = net::io_context {threads};
     std::make_shared<listener_t>(io_context, tcp::endpoint {address, port}, session)->run();
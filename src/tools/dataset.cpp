@@ -4,13 +4,20 @@
 #include <sys/mman.h> // `mmap` to read datasets faster
 #include <unistd.h>   // `close` files
 
+#include <map>
 #include <ctime>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <cstdio>
 #include <vector>
 #include <cstring>
 #include <numeric>
-#include <fstream>
+#include <thread>
+#include <optional>
 #include <algorithm>
 #include <filesystem>
+#include <condition_variable>
 
 #include <arrow/api.h>
 #include <arrow/array.h>
@@ -22,7 +29,10 @@
 #include <arrow/csv/writer.h>
 #include <arrow/io/api.h>
 #include <arrow/io/file.h>
+#include <arrow/ipc/api.h>
+#include <arrow/c/bridge.h>
 #include <arrow/compute/api_aggregate.h>
+#include <arrow/compute/cast.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/stream_writer.h>
 
@@ -30,6 +40,7 @@
 #include <fmt/format.h>
 
 #include <ustore/ustore.hpp>
+#include <ustore/arrow.h>
 #include <ustore/cpp/ranges.hpp>
 #include <ustore/cpp/blobs_range.hpp>      // `keys_stream_t`
 #include <../helpers/linked_memory.hpp> // `linked_memory_lock_t`
@@ -42,6 +53,8 @@ using namespace unum::ustore;
 constexpr ustore_size_t symbols_count_k = 4;
 // Json object open brackets for json and parquet
 constexpr ustore_str_view_t prefix_k = "{";
+// Smallest chunk of NDJSON, that a single thread parses at once
+constexpr ustore_size_t ndjson_chunk_min_k = 1024ul * 1024ul;
 
 std::mutex gen_mtx;
 
@@ -51,7 +64,6 @@ using lengths_t = strided_iterator_gt<ustore_length_t const>;
 using keys_length_t = std::pair<ustore_key_t*, ustore_size_t>;
 using val_t = std::pair<ustore_bytes_ptr_t, ustore_size_t>;
 using counts_t = ptr_range_gt<ustore_size_t>;
-using chunked_array_t = std::shared_ptr<arrow::ChunkedArray>;
 using array_t = std::shared_ptr<arrow::Array>;
 using int_builder_t = arrow::NumericBuilder<arrow::Int64Type>;
 using docs_t = ptr_range_gt<value_view_t>;
@@ -595,18 +607,120 @@ void fields_parser( //
     }
 }
 
+/**
+ * @brief Keeps the Parquet reader alive, while its batches are consumed.
+ */
+struct batches_reader_t {
+    std::unique_ptr<parquet::arrow::FileReader> parquet;
+    std::shared_ptr<arrow::RecordBatchReader> batches;
+};
+
 #pragma endregion - Helpers
 
-#pragma region - Upserting
+#pragma region - Pipelining
+
+/**
+ * @brief Documents parsed from one chunk of the input.
+ * Views either point into the mapped file, or into the `jsons` of the batch itself.
+ */
+struct docs_batch_t {
+    std::vector<value_view_t> docs;
+    std::string jsons;
+    std::vector<std::size_t> jsons_ends;
+
+    void push_json(std::string_view json) {
+        jsons.append(json);
+        jsons_ends.push_back(jsons.size());
+    }
+
+    /**
+     * @brief Exports the views of the pushed JSONs, once the `jsons` stop growing.
+     */
+    void seal() {
+        docs.reserve(docs.size() + jsons_ends.size());
+        std::size_t begin = 0;
+        for (std::size_t end : jsons_ends) {
+            docs.emplace_back(jsons.data() + begin, end - begin);
+            begin = end;
+        }
+    }
+};
+
+/**
+ * @brief Passes the parsed batches from the parsing threads to the writing one.
+ * Batches are popped in the order of input chunks, so the later duplicates of IDs
+ * still overwrite the earlier ones. Parsers block, once they get `capacity` chunks
+ * ahead of the writer, which bounds the memory usage.
+ */
+class docs_batches_queue_t {
+    std::mutex mutex_;
+    std::condition_variable parsed_;
+    std::condition_variable written_;
+    std::map<std::size_t, docs_batch_t> batches_;
+    std::size_t capacity_ = 0;
+    std::size_t next_chunk_ = 0;
+    std::size_t parsers_count_ = 0;
+    bool cancelled_ = false;
 
-void upsert_docs(ustore_docs_import_t& c, docs_t& docs, ustore_size_t task_count) {
+  public:
+    docs_batches_queue_t(std::size_t capacity, std::size_t parsers_count)
+        : capacity_(capacity), parsers_count_(parsers_count) {}
+
+    /**
+     * @return false, if the import was cancelled.
+     */
+    bool push(std::size_t chunk_idx, docs_batch_t&& batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        written_.wait(lock, [&] { return cancelled_ || chunk_idx < next_chunk_ + capacity_; });
+        if (cancelled_)
+            return false;
+        batches_.emplace(chunk_idx, std::move(batch));
+        parsed_.notify_all();
+        return true;
+    }
+
+    /**
+     * @return false, if the import was cancelled, or all the parsers finished and no batches are left.
+     */
+    bool pop(docs_batch_t& batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        parsed_.wait(lock, [&] { return cancelled_ || batches_.count(next_chunk_) || !parsers_count_; });
+        auto it = batches_.find(next_chunk_);
+        if (cancelled_ || it == batches_.end())
+            return false;
+        batch = std::move(it->second);
+        batches_.erase(it);
+        ++next_chunk_;
+        written_.notify_all();
+        return true;
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --parsers_count_;
+        parsed_.notify_all();
+    }
+
+    /**
+     * @brief Unblocks everyone after a failure. Otherwise the chunk,
+     * that failed to parse, would keep the writer waiting forever.
+     */
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        parsed_.notify_all();
+        written_.notify_all();
+    }
+};
+
+void upsert_docs(ustore_docs_import_t& c, ustore_arena_t* arena, docs_t docs) {
 
     ustore_docs_write_t docs_write {
         .db = c.db,
         .error = c.error,
-        .arena = c.arena,
-        .options = ustore_option_dont_discard_memory_k,
-        .tasks_count = task_count,
+        .arena = arena,
+        .options = ustore_options_t(c.options & ustore_option_write_bulk_k),
+        .tasks_count = docs.size(),
         .type = ustore_doc_field_json_k,
         .modification = ustore_doc_modify_upsert_k,
         .collections = &c.collection,
@@ -620,30 +734,128 @@ void upsert_docs(ustore_docs_import_t& c, docs_t& docs, ustore_size_t task_count
     ustore_docs_write(&docs_write);
 }
 
-#pragma endregion - Upserting
+/**
+ * @brief Imports the input on all the hardware threads, overlapping parsing with writes.
+ *
+ * Parsing threads take turns calling `claim`, which grabs the next chunk of the input,
+ * like a slice of a mapped file or a record batch, and returns false once there are none left.
+ * Then `parse` converts every claimed chunk into a batch of documents concurrently with others.
+ * The calling thread writes the batches in slices of at most `max_batch_size` bytes,
+ * reporting the progress through the `callback` after every slice.
+ */
+template <typename chunk_at, typename claim_at, typename parse_at>
+void import_pipelined(ustore_docs_import_t& c, ustore_arena_t* arena, claim_at&& claim, parse_at&& parse) {
+
+    std::size_t const threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+    docs_batches_queue_t queue(2 * threads_count, threads_count);
+    std::mutex claim_mutex;
+    std::size_t claimed_chunks = 0;
+    std::vector<ustore_error_t> errors(threads_count, nullptr);
+
+    auto parse_chunks = [&](std::size_t thread_idx) {
+        ustore_error_t* error = &errors[thread_idx];
+        chunk_at chunk;
+        while (true) {
+            std::size_t chunk_idx = 0;
+            {
+                std::lock_guard<std::mutex> lock(claim_mutex);
+                if (!claim(chunk, error))
+                    break;
+                chunk_idx = claimed_chunks++;
+            }
+
+            docs_batch_t batch;
+            try {
+                parse(chunk, batch, error);
+            }
+            catch (simdjson::simdjson_error const& ex) {
+                *error = ex.what();
+            }
+            catch (std::bad_alloc const&) {
+                *error = "Failed to allocate memory for parsed documents";
+            }
+            if (*error)
+                break;
+            batch.seal();
+            if (!queue.push(chunk_idx, std::move(batch)))
+                break;
+        }
+        if (*error)
+            queue.cancel();
+        queue.finish();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threads_count);
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back(parse_chunks, thread_idx);
+
+    docs_batch_t batch;
+    while (!*c.error && queue.pop(batch)) {
+        std::size_t slice_begin = 0;
+        std::size_t slice_size = 0;
+        for (std::size_t doc_idx = 0; doc_idx != batch.docs.size() && !*c.error; ++doc_idx) {
+            slice_size += batch.docs[doc_idx].size();
+            bool const is_last = doc_idx + 1 == batch.docs.size();
+            if (slice_size < c.max_batch_size && !is_last)
+                continue;
+
+            upsert_docs(c, arena, {batch.docs.data() + slice_begin, batch.docs.data() + doc_idx + 1});
+            if (!*c.error && c.callback)
+                c.callback(c.callback_payload);
+            slice_begin = doc_idx + 1;
+            slice_size = 0;
+        }
+    }
+    if (*c.error)
+        queue.cancel();
+
+    for (std::thread& thread : threads)
+        thread.join();
+    for (ustore_error_t error : errors)
+        if (!*c.error && error)
+            *c.error = error;
+}
+
+#pragma endregion - Pipelining
 
 #pragma region - Docs
 
-void import_parquet(ustore_docs_import_t& c, std::shared_ptr<arrow::Table>& table, ustore_size_t& rows_count) {
+void open_docs_parquet(ustore_docs_import_t& c, batches_reader_t& reader) {
 
     arrow::Status status;
     arrow::MemoryPool* pool = arrow::default_memory_pool();
 
-    // Open File
     auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
-    return_error_if_m(maybe_input.ok(), c.error, 0, status.ToString().c_str());
+    return_error_if_m(maybe_input.ok(), c.error, 0, "Can't open file");
     auto input = *maybe_input;
 
-    std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-    status = parquet::arrow::OpenFile(input, pool, &arrow_reader);
-    return_error_if_m(status.ok(), c.error, 0, status.ToString().c_str());
+    status = parquet::arrow::OpenFile(input, pool, &reader.parquet);
+    return_error_if_m(status.ok(), c.error, 0, "Can't instantiate reader");
 
-    // Read File into table
-    status = arrow_reader->ReadTable(&table);
-    return_error_if_m(status.ok(), c.error, 0, status.ToString().c_str());
+    // Only the requested columns are decoded
+    std::shared_ptr<arrow::Schema> schema;
+    status = reader.parquet->GetSchema(&schema);
+    return_error_if_m(status.ok(), c.error, 0, "Can't read schema");
+    std::vector<int> columns_indices(schema->num_fields());
+    std::iota(columns_indices.begin(), columns_indices.end(), 0);
+    if (c.fields) {
+        fields_t fields {c.fields, c.fields_stride};
+        columns_indices.clear();
+        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx) {
+            int column_idx = schema->GetFieldIndex(fields[idx]);
+            return_error_if_m(column_idx >= 0, c.error, args_wrong_k, "Missing column");
+            columns_indices.push_back(column_idx);
+        }
+    }
+
+    std::vector<int> row_groups_indices(reader.parquet->num_row_groups());
+    std::iota(row_groups_indices.begin(), row_groups_indices.end(), 0);
+    status = reader.parquet->GetRecordBatchReader(row_groups_indices, columns_indices, &reader.batches);
+    return_error_if_m(status.ok(), c.error, 0, "Can't instantiate reader");
 }
 
-void import_csv(ustore_docs_import_t& c, std::shared_ptr<arrow::Table>& table) {
+void open_docs_csv(ustore_docs_import_t& c, batches_reader_t& reader) {
 
     arrow::io::IOContext io_context = arrow::io::default_io_context();
     auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
@@ -653,203 +865,178 @@ void import_csv(ustore_docs_import_t& c, std::shared_ptr<arrow::Table>& table) {
     auto read_options = arrow::csv::ReadOptions::Defaults();
     auto parse_options = arrow::csv::ParseOptions::Defaults();
     auto convert_options = arrow::csv::ConvertOptions::Defaults();
+    if (c.fields) {
+        fields_t fields {c.fields, c.fields_stride};
+        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
+            convert_options.include_columns.emplace_back(fields[idx]);
+    }
 
-    // Instantiate TableReader from input stream and options
-    auto maybe_reader = arrow::csv::TableReader::Make(io_context, input, read_options, parse_options, convert_options);
+    // Unlike the `TableReader`, parses the file incrementally, one block at a time
+    auto maybe_reader =
+        arrow::csv::StreamingReader::Make(io_context, input, read_options, parse_options, convert_options);
     return_error_if_m(maybe_reader.ok(), c.error, 0, "Can't instantiate reader");
-    std::shared_ptr<arrow::csv::TableReader> reader = *maybe_reader;
-
-    // Read table from CSV file
-    auto maybe_table = reader->Read();
-    return_error_if_m(maybe_table.ok(), c.error, 0, "Can't read file");
-    table = *maybe_table;
+    reader.batches = *maybe_reader;
 }
 
-void parse_arrow_table(ustore_docs_import_t& c, std::shared_ptr<arrow::Table> const& table) {
-
-    fields_t fields;
-    ustore_size_t used_mem = 0;
-    ustore_char_t* field = nullptr;
-    std::string json = "{";
-    ustore_char_t* json_cstr = nullptr;
-    arrow_visitor_t visitor(json);
-    auto arena = linked_memory(c.arena, c.options, c.error);
-
-    if (!c.fields) {
-        auto clmn_names = table->ColumnNames();
-        c.fields_count = clmn_names.size();
-        auto names = arena.alloc<ustore_str_view_t>(c.fields_count, c.error);
-
-        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx) {
-            field = arena.alloc<ustore_char_t>(clmn_names[idx].size() + 1, c.error).begin();
-            std::memcpy(field, clmn_names[idx].data(), clmn_names[idx].size() + 1);
-            names[idx] = field;
-        }
-
-        c.fields_stride = sizeof(ustore_str_view_t);
-        fields = fields_t {names.begin(), c.fields_stride};
-    }
-    else {
-        fields = fields_t {c.fields, c.fields_stride};
-        c.fields_count = c.fields_count;
-    }
-
-    auto columns = arena.alloc<chunked_array_t>(c.fields_count, c.error);
-    auto chunks = arena.alloc<array_t>(c.fields_count, c.error);
-
-    auto columns_begin = columns.begin();
-    auto chunks_begin = chunks.begin();
-
-    for (ustore_size_t idx = 0; idx < c.fields_count; ++idx, ++columns_begin, ++chunks_begin) {
-        new (columns_begin) chunked_array_t();
-        new (chunks_begin) array_t();
-        chunked_array_t column = table->GetColumnByName(fields[idx]);
-        return_error_if_m(column, c.error, 0, fmt::format("{} is not exist", fields[idx]).c_str());
-        columns[idx] = column;
-    }
-
-    ustore_size_t count = columns[0]->num_chunks();
-    auto values = arena.alloc<value_view_t>(table->num_rows(), c.error);
+void parse_arrow_batch(fields_t fields,
+                       ustore_size_t fields_count,
+                       arrow::RecordBatch const& record_batch,
+                       docs_batch_t& batch,
+                       ustore_error_t* error) {
 
-    ustore_size_t idx = 0;
-    for (ustore_size_t chunk_idx = 0, g_idx = 0; chunk_idx != count; ++chunk_idx, g_idx = 0) {
-
-        for (auto column : columns) {
-            chunks[g_idx] = column->chunk(chunk_idx);
-            ++g_idx;
-        }
-
-        for (ustore_size_t value_idx = 0; value_idx < columns[0]->chunk(chunk_idx)->length(); ++value_idx) {
-
-            g_idx = 0;
-            for (auto it = fields; g_idx < c.fields_count; ++g_idx, ++it) {
-                fmt::format_to(std::back_inserter(json), "\"{}\":", *it);
-                visitor.idx = value_idx;
-                arrow::VisitArrayInline(*chunks[g_idx].get(), &visitor);
-            }
-
-            json[json.size() - 1] = '}';
-            json.push_back('\n');
-            json_cstr = arena.alloc<ustore_char_t>(json.size() + 1, c.error).begin();
-            std::memcpy(json_cstr, json.data(), json.size() + 1);
-
-            values[idx] = json_cstr;
-            used_mem += json.size();
-            json = "{";
-            ++idx;
-
-            if (used_mem >= c.max_batch_size) {
-                upsert_docs(c, values, idx);
-                used_mem = 0;
-                idx = 0;
-            }
-        }
+    std::vector<array_t> columns(fields_count);
+    for (ustore_size_t idx = 0; idx < fields_count; ++idx) {
+        columns[idx] = record_batch.GetColumnByName(fields[idx]);
+        return_error_if_m(columns[idx], error, args_wrong_k, "Missing column");
     }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
-}
-
-void import_whole_ndjson(ustore_docs_import_t& c, simdjson::ondemand::document_stream& docs, ustore_size_t rows_count) {
-
-    ustore_size_t idx = 0;
-    ustore_size_t used_mem = 0;
-
-    auto arena = linked_memory(c.arena, c.options, c.error);
-    auto values = arena.alloc<value_view_t>(rows_count, c.error);
 
-    for (auto doc : docs) {
-        simdjson::ondemand::object object = doc.get_object().value();
-        values[idx] = rewinded(object).raw_json().value();
-        used_mem += values[idx].size();
-        ++idx;
-        if (used_mem >= c.max_batch_size) {
-            upsert_docs(c, values, idx);
-            idx = 0;
+    std::string json;
+    arrow_visitor_t visitor(json);
+    for (std::int64_t row_idx = 0; row_idx != record_batch.num_rows(); ++row_idx) {
+        json = "{";
+        for (ustore_size_t idx = 0; idx < fields_count; ++idx) {
+            fmt::format_to(std::back_inserter(json), "\"{}\":", fields[idx]);
+            visitor.idx = row_idx;
+            arrow::VisitArrayInline(*columns[idx], &visitor);
         }
+        json.back() = '}';
+        json.push_back('\n');
+        batch.push_json(json);
     }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
 }
 
-void import_sub_ndjson(ustore_docs_import_t& c,
-                       simdjson::ondemand::document_stream& docs,
-                       ustore_size_t rows_count) noexcept {
-
-    auto arena = linked_memory(c.arena, c.options, c.error);
-    auto fields = prepare_fields(c, arena);
-    ustore_size_t max_size = c.fields_count * symbols_count_k;
-    for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
-        max_size += strlen(fields[idx]);
-
-    auto values = arena.alloc<value_view_t>(rows_count, c.error);
+void import_arrow_docs(ustore_docs_import_t& c, ustore_arena_t* arena) {
 
-    ustore_size_t used_mem = 0;
-    std::string json = "{";
-    ustore_char_t* json_cstr = nullptr;
-
-    counts_t counts = arena.alloc<ustore_size_t>(c.fields_count, c.error);
-    return_if_error_m(c.error);
-
-    auto tape = arena.alloc<ustore_char_t>(max_size, c.error);
+    batches_reader_t reader;
+    auto ext = std::filesystem::path(c.paths_pattern).extension();
+    if (ext == ".parquet")
+        open_docs_parquet(c, reader);
+    else
+        open_docs_csv(c, reader);
     return_if_error_m(c.error);
-    fields_parser(c.error, arena, c.fields_count, fields, counts, tape);
 
-    ustore_size_t idx = 0;
-    for (auto doc : docs) {
-        simdjson::ondemand::object object = doc.get_object().value();
-
-        try {
-            simdjson_object_parser(object, counts, fields, c.fields_count, tape, json);
-        }
-        catch (simdjson::simdjson_error const& ex) {
-            *c.error = ex.what();
-            return_if_error_m(c.error);
-        }
+    // Without explicit fields, every column becomes a field
+    std::vector<std::string> names;
+    std::vector<ustore_str_view_t> names_ptrs;
+    fields_t fields {c.fields, c.fields_stride};
+    ustore_size_t fields_count = c.fields_count;
+    if (!c.fields) {
+        names = reader.batches->schema()->field_names();
+        for (std::string const& name : names)
+            names_ptrs.push_back(name.c_str());
+        fields = fields_t {names_ptrs.data(), sizeof(ustore_str_view_t)};
+        fields_count = names_ptrs.size();
+    }
 
-        json.push_back('\n');
-        json_cstr = arena.alloc<ustore_char_t>(json.size() + 1, c.error).begin();
-        std::memcpy(json_cstr, json.data(), json.size() + 1);
+    using record_batch_t = std::shared_ptr<arrow::RecordBatch>;
+    import_pipelined<record_batch_t>(
+        c,
+        arena,
+        [&](record_batch_t& record_batch, ustore_error_t* error) {
+            arrow::Status status = reader.batches->ReadNext(&record_batch);
+            log_error_if_m(status.ok(), error, 0, "Can't read file");
+            return status.ok() && record_batch;
+        },
+        [&](record_batch_t const& record_batch, docs_batch_t& batch, ustore_error_t* error) {
+            parse_arrow_batch(fields, fields_count, *record_batch, batch, error);
+        });
+}
 
-        values[idx] = json_cstr;
-        used_mem += json.size();
-        json = "{";
-        ++idx;
+/**
+ * @brief Splits the mapped NDJSON file into chunks, that end on line boundaries.
+ */
+class ndjson_chunks_t {
+    std::string_view remaining_;
+    std::size_t chunk_size_ = 0;
 
-        if (used_mem >= c.max_batch_size) {
-            upsert_docs(c, values, idx);
-            idx = 0;
+  public:
+    ndjson_chunks_t(std::string_view content, std::size_t chunk_size) noexcept
+        : remaining_(content), chunk_size_(std::max<std::size_t>(chunk_size, 1)) {}
+
+    bool next(std::string_view& chunk) noexcept {
+        if (remaining_.empty())
+            return false;
+        std::size_t length = remaining_.size();
+        if (chunk_size_ < length) {
+            void const* line_end = std::memchr(remaining_.data() + chunk_size_, '\n', length - chunk_size_);
+            if (line_end)
+                length = static_cast<char const*>(line_end) - remaining_.data() + 1;
         }
+        chunk = remaining_.substr(0, length);
+        remaining_.remove_prefix(length);
+        return true;
     }
-    if (idx != 0)
-        upsert_docs(c, values, idx);
-}
+};
 
-void import_ndjson_docs(ustore_docs_import_t& c) {
+void import_ndjson_docs(ustore_docs_import_t& c, ustore_arena_t* arena) {
 
     auto handle = open(c.paths_pattern, O_RDONLY);
     return_error_if_m(handle != -1, c.error, 0, "Can't open file");
 
     ustore_size_t file_size = std::filesystem::file_size(std::filesystem::path(c.paths_pattern));
+    if (!file_size) {
+        close(handle);
+        return;
+    }
     auto begin = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    if (begin == MAP_FAILED) {
+        close(handle);
+        *c.error = "Can't map file";
+        return;
+    }
     std::string_view mapped_content = std::string_view(reinterpret_cast<ustore_char_t const*>(begin), file_size);
     madvise(begin, file_size, MADV_SEQUENTIAL);
 
-    std::ifstream file(c.paths_pattern);
-    ustore_size_t rows_count =
-        std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n') + 1;
-
-    simdjson::ondemand::parser parser;
-    simdjson::ondemand::document_stream docs = parser.iterate_many( //
-        mapped_content.data(),
-        mapped_content.size(),
-        1000000ul);
+    // Fields are parsed into a tape of JSON prefixes once, and then shared by all the threads.
+    // Writes release the memory of the `arena` between batches, so the tape lives elsewhere.
+    arena_t fields_memory(c.db);
+    linked_memory_lock_t fields_arena = linked_memory(fields_memory.member_ptr(), c.options, c.error);
+    fields_t fields;
+    counts_t counts;
+    tape_t tape;
+    if (c.fields && !*c.error) {
+        fields = prepare_fields(c, fields_arena);
+        ustore_size_t max_size = c.fields_count * symbols_count_k;
+        for (ustore_size_t idx = 0; idx < c.fields_count; ++idx)
+            max_size += strlen(fields[idx]);
+        counts = fields_arena.alloc<ustore_size_t>(c.fields_count, c.error);
+        if (!*c.error)
+            tape = fields_arena.alloc<ustore_char_t>(max_size, c.error);
+        if (!*c.error)
+            fields_parser(c.error, fields_arena, c.fields_count, fields, counts, tape);
+    }
 
-    if (!c.fields)
-        import_whole_ndjson(c, docs, rows_count);
-    else
-        import_sub_ndjson(c, docs, rows_count);
+    // Chunks are small enough to keep all threads busy, but never exceed a single batch
+    std::size_t const threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+    std::size_t const balanced_size = std::max<std::size_t>(file_size / (4 * threads_count), ndjson_chunk_min_k);
+    std::size_t const chunk_size = std::min<std::size_t>(c.max_batch_size, balanced_size);
+    ndjson_chunks_t chunks(mapped_content, chunk_size);
+
+    if (!*c.error)
+        import_pipelined<std::string_view>(
+            c,
+            arena,
+            [&](std::string_view& chunk, ustore_error_t*) { return chunks.next(chunk); },
+            [&](std::string_view chunk, docs_batch_t& batch, ustore_error_t*) {
+                // Every thread reuses its parser and its buffers across chunks
+                thread_local simdjson::ondemand::parser parser;
+                thread_local std::string json;
+                std::size_t const window_size = std::max<std::size_t>(chunk.size(), ndjson_chunk_min_k);
+                simdjson::ondemand::document_stream docs = parser.iterate_many(chunk.data(), chunk.size(), window_size);
+                for (auto doc : docs) {
+                    simdjson::ondemand::object object = doc.get_object().value();
+                    if (!c.fields) {
+                        batch.docs.push_back(rewinded(object).raw_json().value());
+                        continue;
+                    }
+                    json = "{";
+                    simdjson_object_parser(object, counts, fields, c.fields_count, tape, json);
+                    json.push_back('\n');
+                    batch.push_json(json);
+                }
+            });
 
-    munmap((void*)mapped_content.data(), mapped_content.size());
+    munmap(begin, file_size);
     close(handle);
 }
 
@@ -1106,22 +1293,16 @@ void ustore_docs_import(ustore_docs_import_t* c_ptr) noexcept(false) {
     return_error_if_m(c.max_batch_size, c.error, uninitialized_state_k, "Max batch size is 0");
     return_error_if_m(c.paths_pattern, c.error, uninitialized_state_k, "Paths pattern is uninitialized");
 
-    if (!c.arena)
-        c.arena = arena_t(c.db).member_ptr();
+    arena_t own_arena(c.db);
+    ustore_arena_t* arena = c.arena ? c.arena : own_arena.member_ptr();
 
     auto ext = std::filesystem::path(c.paths_pattern).extension();
-    ustore_size_t rows_count = 0;
     if (ext == ".ndjson")
-        import_ndjson_docs(c);
-    else {
-        std::shared_ptr<arrow::Table> table;
-        if (ext == ".parquet")
-            import_parquet(c, table, rows_count);
-        else if (ext == ".csv")
-            import_csv(c, table);
-        return_if_error_m(c.error);
-        parse_arrow_table(c, table);
-    }
+        import_ndjson_docs(c, arena);
+    else if (ext == ".parquet" || ext == ".csv")
+        import_arrow_docs(c, arena);
+    else
+        *c.error = "Not supported format";
 }
 
 void ustore_docs_export(ustore_docs_export_t* c_ptr) noexcept(false) {
@@ -1253,4 +1434,640 @@ void ustore_docs_export(ustore_docs_export_t* c_ptr) noexcept(false) {
 }
 
 #pragma endregion - Main Functions(Docs)
-#pragma endregion - Docs
\ No newline at end of file
+#pragma endregion - Docs
+#pragma region - Graph
+
+/**
+ * @brief Half of an edge, as seen from one of its vertices. Sorting them groups
+ * the neighborships of every vertex by role, in the order graph entries keep them.
+ */
+struct half_edge_t {
+    ustore_key_t vertex;
+    ustore_key_t neighbor;
+    ustore_key_t edge;
+    ustore_vertex_role_t role;
+
+    bool operator<(half_edge_t const& other) const noexcept {
+        return std::tie(vertex, role, neighbor, edge) < std::tie(other.vertex, other.role, other.neighbor, other.edge);
+    }
+    bool operator==(half_edge_t const& other) const noexcept {
+        return vertex == other.vertex && role == other.role && neighbor == other.neighbor && edge == other.edge;
+    }
+};
+
+/**
+ * @brief External merge sort for edge lists, that don't fit into memory.
+ * Every filled buffer is sorted and spilled into a temporary file,
+ * and all of those runs are merged in a single pass in the end.
+ */
+class half_edges_sorter_t {
+    std::vector<half_edge_t> buffer_;
+    std::vector<std::FILE*> runs_;
+    std::size_t capacity_ = 0;
+
+  public:
+    half_edges_sorter_t(std::size_t capacity) : capacity_(capacity) { buffer_.reserve(capacity); }
+    half_edges_sorter_t(half_edges_sorter_t const&) = delete;
+    ~half_edges_sorter_t() {
+        for (std::FILE* run : runs_)
+            std::fclose(run);
+    }
+
+    void push(half_edge_t const& half_edge, ustore_error_t* c_error) {
+        buffer_.push_back(half_edge);
+        if (buffer_.size() == capacity_)
+            spill(c_error);
+    }
+
+    void spill(ustore_error_t* c_error) {
+        std::sort(buffer_.begin(), buffer_.end());
+        std::FILE* run = std::tmpfile();
+        return_error_if_m(run, c_error, error_unknown_k, "Can't create a temporary file");
+        runs_.push_back(run);
+        std::size_t written = std::fwrite(buffer_.data(), sizeof(half_edge_t), buffer_.size(), run);
+        return_error_if_m(written == buffer_.size(), c_error, error_unknown_k, "Can't write a temporary file");
+        buffer_.clear();
+    }
+
+    /**
+     * @brief Passes all the pushed half-edges to `callback` in sorted order.
+     * Small inputs, that never filled the buffer, don't touch the disk at all.
+     */
+    template <typename callback_at>
+    void merge(callback_at&& callback, ustore_error_t* c_error) {
+        if (runs_.empty()) {
+            std::sort(buffer_.begin(), buffer_.end());
+            for (half_edge_t const& half_edge : buffer_) {
+                callback(half_edge);
+                return_if_error_m(c_error);
+            }
+            return;
+        }
+
+        if (!buffer_.empty())
+            spill(c_error);
+        return_if_error_m(c_error);
+        std::vector<half_edge_t>().swap(buffer_);
+
+        // Every run is streamed through its own slice of the memory budget
+        std::size_t const run_capacity = std::max<std::size_t>(capacity_ / runs_.size(), 1);
+        std::vector<std::vector<half_edge_t>> run_buffers(runs_.size());
+        std::vector<std::size_t> run_offsets(runs_.size());
+        auto refill = [&](std::size_t run_idx) {
+            auto& run_buffer = run_buffers[run_idx];
+            run_buffer.resize(run_capacity);
+            run_buffer.resize(std::fread(run_buffer.data(), sizeof(half_edge_t), run_capacity, runs_[run_idx]));
+            run_offsets[run_idx] = 0;
+            if (std::ferror(runs_[run_idx]))
+                *c_error = "Can't read a temporary file";
+            return !run_buffer.empty();
+        };
+
+        using head_t = std::pair<half_edge_t, std::size_t>;
+        auto greater = [](head_t const& a, head_t const& b) noexcept { return b.first < a.first; };
+        std::priority_queue<head_t, std::vector<head_t>, decltype(greater)> heads(greater);
+        for (std::size_t run_idx = 0; run_idx != runs_.size(); ++run_idx) {
+            std::rewind(runs_[run_idx]);
+            if (refill(run_idx))
+                heads.push({run_buffers[run_idx].front(), run_idx});
+            return_if_error_m(c_error);
+        }
+
+        while (!heads.empty()) {
+            auto [half_edge, run_idx] = heads.top();
+            heads.pop();
+            callback(half_edge);
+            return_if_error_m(c_error);
+            if (++run_offsets[run_idx] != run_buffers[run_idx].size() || refill(run_idx))
+                heads.push({run_buffers[run_idx][run_offsets[run_idx]], run_idx});
+            return_if_error_m(c_error);
+        }
+    }
+};
+
+struct half_edges_batch_t {
+    std::vector<ustore_key_t> sources;
+    std::vector<ustore_key_t> targets;
+    std::vector<ustore_key_t> edges;
+    std::vector<ustore_vertex_role_t> roles;
+
+    std::size_t size() const noexcept { return roles.size(); }
+    void clear() noexcept {
+        sources.clear();
+        targets.clear();
+        edges.clear();
+        roles.clear();
+    }
+    void push_back(half_edge_t const& half_edge) {
+        bool outgoing = half_edge.role == ustore_vertex_source_k;
+        sources.push_back(outgoing ? half_edge.vertex : half_edge.neighbor);
+        targets.push_back(outgoing ? half_edge.neighbor : half_edge.vertex);
+        edges.push_back(half_edge.edge);
+        roles.push_back(half_edge.role);
+    }
+};
+
+void open_edges_parquet(ustore_graph_import_t& c, std::vector<std::string> const& fields, batches_reader_t& reader) {
+
+    arrow::Status status;
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+
+    auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
+    return_error_if_m(maybe_input.ok(), c.error, 0, "Can't open file");
+    auto input = *maybe_input;
+
+    status = parquet::arrow::OpenFile(input, pool, &reader.parquet);
+    return_error_if_m(status.ok(), c.error, 0, "Can't instantiate reader");
+
+    // Only the columns with IDs are decoded
+    std::shared_ptr<arrow::Schema> schema;
+    status = reader.parquet->GetSchema(&schema);
+    return_error_if_m(status.ok(), c.error, 0, "Can't read schema");
+    std::vector<int> columns_indices;
+    for (auto const& field : fields) {
+        int column_idx = schema->GetFieldIndex(field);
+        return_error_if_m(column_idx >= 0, c.error, args_wrong_k, "Missing ID column");
+        columns_indices.push_back(column_idx);
+    }
+
+    std::vector<int> row_groups_indices(reader.parquet->num_row_groups());
+    std::iota(row_groups_indices.begin(), row_groups_indices.end(), 0);
+    status = reader.parquet->GetRecordBatchReader(row_groups_indices, columns_indices, &reader.batches);
+    return_error_if_m(status.ok(), c.error, 0, "Can't instantiate reader");
+}
+
+void open_edges_csv(ustore_graph_import_t& c, std::vector<std::string> const& fields, batches_reader_t& reader) {
+
+    arrow::io::IOContext io_context = arrow::io::default_io_context();
+    auto maybe_input = arrow::io::ReadableFile::Open(c.paths_pattern);
+    return_error_if_m(maybe_input.ok(), c.error, 0, "Can't open file");
+    std::shared_ptr<arrow::io::InputStream> input = *maybe_input;
+
+    auto read_options = arrow::csv::ReadOptions::Defaults();
+    auto parse_options = arrow::csv::ParseOptions::Defaults();
+    auto convert_options = arrow::csv::ConvertOptions::Defaults();
+    convert_options.include_columns = fields;
+    for (auto const& field : fields)
+        convert_options.column_types[field] = arrow::int64();
+
+    // Unlike the `TableReader`, parses the file incrementally, one block at a time
+    auto maybe_reader =
+        arrow::csv::StreamingReader::Make(io_context, input, read_options, parse_options, convert_options);
+    return_error_if_m(maybe_reader.ok(), c.error, 0, "Can't instantiate reader");
+    reader.batches = *maybe_reader;
+}
+
+void ids_column(ustore_graph_import_t& c,
+                arrow::RecordBatch const& batch,
+                ustore_str_view_t field,
+                std::shared_ptr<arrow::Int64Array>& ids) {
+
+    array_t column = batch.GetColumnByName(field);
+    return_error_if_m(column, c.error, args_wrong_k, "Missing ID column");
+    if (column->type_id() != arrow::Type::INT64) {
+        auto maybe_casted = arrow::compute::Cast(*column, arrow::int64());
+        return_error_if_m(maybe_casted.ok(), c.error, args_wrong_k, "ID columns must contain integers");
+        column = *maybe_casted;
+    }
+    ids = std::static_pointer_cast<arrow::Int64Array>(column);
+}
+
+void upsert_half_edges(ustore_graph_import_t& c, ustore_arena_t* arena, half_edges_batch_t const& batch) {
+
+    ustore_graph_upsert_edges_t graph_upsert {
+        .db = c.db,
+        .error = c.error,
+        .arena = arena,
+        .options = c.options,
+        .tasks_count = batch.size(),
+        .collections = &c.collection,
+        .edges_ids = batch.edges.data(),
+        .edges_stride = sizeof(ustore_key_t),
+        .sources_ids = batch.sources.data(),
+        .sources_stride = sizeof(ustore_key_t),
+        .targets_ids = batch.targets.data(),
+        .targets_stride = sizeof(ustore_key_t),
+        .roles = batch.roles.data(),
+        .roles_stride = sizeof(ustore_vertex_role_t),
+    };
+
+    ustore_graph_upsert_edges(&graph_upsert);
+}
+
+#pragma endregion - Graph
+
+#pragma region - Main Functions(Graph)
+
+void ustore_graph_import(ustore_graph_import_t* c_ptr) noexcept(false) {
+
+    ustore_graph_import_t& c = *c_ptr;
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.max_batch_size, c.error, uninitialized_state_k, "Max batch size is 0");
+    return_error_if_m(c.paths_pattern, c.error, uninitialized_state_k, "Paths pattern is uninitialized");
+    return_error_if_m(c.source_id_field && c.target_id_field,
+                      c.error,
+                      uninitialized_state_k,
+                      "Source and target fields must be initialized");
+
+    arena_t own_arena(c.db);
+    ustore_arena_t* arena = c.arena ? c.arena : own_arena.member_ptr();
+
+    std::vector<std::string> fields {c.source_id_field, c.target_id_field};
+    if (c.edge_id_field)
+        fields.emplace_back(c.edge_id_field);
+
+    batches_reader_t reader;
+    auto ext = std::filesystem::path(c.paths_pattern).extension();
+    if (ext == ".parquet")
+        open_edges_parquet(c, fields, reader);
+    else if (ext == ".csv")
+        open_edges_csv(c, fields, reader);
+    else
+        *c.error = "Not supported format";
+    return_if_error_m(c.error);
+
+    // 1. Split every edge into two halves, one per vertex, and sort them out of core
+    std::size_t const capacity = std::max<std::size_t>(c.max_batch_size / sizeof(half_edge_t), 2);
+    half_edges_sorter_t sorter(capacity);
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (true) {
+        arrow::Status status = reader.batches->ReadNext(&batch);
+        return_error_if_m(status.ok(), c.error, 0, "Can't read file");
+        if (!batch)
+            break;
+
+        std::shared_ptr<arrow::Int64Array> sources, targets, edges;
+        ids_column(c, *batch, c.source_id_field, sources);
+        return_if_error_m(c.error);
+        ids_column(c, *batch, c.target_id_field, targets);
+        return_if_error_m(c.error);
+        if (c.edge_id_field)
+            ids_column(c, *batch, c.edge_id_field, edges);
+        return_if_error_m(c.error);
+
+        for (std::int64_t row_idx = 0; row_idx != batch->num_rows(); ++row_idx) {
+            if (sources->IsNull(row_idx) || targets->IsNull(row_idx))
+                continue;
+            ustore_key_t source = sources->Value(row_idx);
+            ustore_key_t target = targets->Value(row_idx);
+            ustore_key_t edge = edges && !edges->IsNull(row_idx) ? edges->Value(row_idx) : ustore_default_edge_id_k;
+            sorter.push({source, target, edge, ustore_vertex_source_k}, c.error);
+            sorter.push({target, source, edge, ustore_vertex_target_k}, c.error);
+            return_if_error_m(c.error);
+        }
+    }
+    reader.batches.reset();
+    reader.parquet.reset();
+
+    // 2. Assemble the neighborhoods vertex by vertex. Batches end on vertex boundaries,
+    // so every entry is written once, unless its degree exceeds the batch capacity.
+    half_edges_batch_t half_edges;
+    std::optional<half_edge_t> previous;
+    auto flush = [&] {
+        upsert_half_edges(c, arena, half_edges);
+        half_edges.clear();
+        if (c.callback)
+            c.callback(c.callback_payload);
+    };
+    sorter.merge(
+        [&](half_edge_t const& half_edge) {
+            if (previous && *previous == half_edge)
+                return;
+            bool const vertex_ends = previous && previous->vertex != half_edge.vertex;
+            if (half_edges.size() >= capacity && (vertex_ends || half_edges.size() >= 2 * capacity))
+                flush();
+            half_edges.push_back(half_edge);
+            previous = half_edge;
+        },
+        c.error);
+    return_if_error_m(c.error);
+    if (half_edges.size())
+        flush();
+}
+
+#pragma endregion - Main Functions(Graph)
+
+#pragma region - Arrow
+
+/// Arrow expects non-NULL buffers even for empty columns.
+static std::int64_t arrow_empty_buffer_k[1] = {0};
+
+/**
+ * @brief Output stream into a memory-mapped file, that doubles its size whenever
+ * it runs out of space, and is truncated to the written length, when closed.
+ */
+class mapped_output_stream_t final : public arrow::io::OutputStream {
+    std::shared_ptr<arrow::io::MemoryMappedFile> file_;
+    std::int64_t position_ = 0;
+    std::int64_t capacity_ = 0;
+
+  public:
+    static arrow::Result<std::shared_ptr<mapped_output_stream_t>> open(std::string const& path,
+                                                                      std::int64_t capacity) {
+        auto maybe_file = arrow::io::MemoryMappedFile::Create(path, capacity);
+        if (!maybe_file.ok())
+            return maybe_file.status();
+        auto stream = std::make_shared<mapped_output_stream_t>();
+        stream->file_ = maybe_file.MoveValueUnsafe();
+        stream->capacity_ = capacity;
+        return stream;
+    }
+
+    arrow::Status Write(void const* data, std::int64_t length) override {
+        if (position_ + length > capacity_) {
+            while (capacity_ < position_ + length)
+                capacity_ *= 2;
+            arrow::Status status = file_->Resize(capacity_);
+            if (!status.ok())
+                return status;
+        }
+        arrow::Status status = file_->WriteAt(position_, data, length);
+        position_ += status.ok() ? length : 0;
+        return status;
+    }
+
+    arrow::Result<std::int64_t> Tell() const override { return position_; }
+    bool closed() const override { return file_->closed(); }
+    arrow::Status Close() override {
+        arrow::Status status = file_->Resize(position_);
+        return status.ok() ? file_->Close() : status;
+    }
+};
+
+/**
+ * @brief Fills the "value" column with contents of the `keys`, either fetched by the scan,
+ * or read separately, if the engine couldn't fetch them in the same pass.
+ */
+void export_values_column( //
+    ustore_arrow_export_t& c,
+    ptr_range_gt<ustore_key_t const> keys,
+    ustore_length_t const* scanned_offsets,
+    ustore_byte_t const* scanned_values,
+    ArrowSchema& schema_c,
+    ArrowArray& array_c) {
+
+    ustore_octet_t* presences = nullptr;
+    ustore_length_t const* offsets = scanned_offsets;
+    ustore_byte_t const* values = scanned_values;
+    if (keys.empty())
+        offsets = reinterpret_cast<ustore_length_t const*>(arrow_empty_buffer_k);
+    else if (!offsets) {
+        ustore_length_t* found_offsets = nullptr;
+        ustore_bytes_ptr_t found_values = nullptr;
+        ustore_read_t read {};
+        read.db = c.db;
+        read.error = c.error;
+        read.snapshot = c.snapshot;
+        read.arena = c.arena;
+        read.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+        read.tasks_count = keys.size();
+        read.collections = &c.collection;
+        read.keys = keys.begin();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.presences = &presences;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
+        return_if_error_m(c.error);
+        offsets = found_offsets;
+        values = found_values;
+    }
+
+    ustore_to_arrow_column( //
+        keys.size(),
+        "value",
+        ustore_doc_field_bin_k,
+        presences,
+        offsets,
+        values ? (void const*)values : (void const*)arrow_empty_buffer_k,
+        schema_c.children[1],
+        array_c.children[1],
+        c.error);
+}
+
+/**
+ * @brief Fills the columns after the "_id" with fields gathered from the documents.
+ * Strings are joined in the order of documents, but Arrow needs every column
+ * to be continuous, so they are compacted column by column.
+ */
+void export_fields_columns( //
+    ustore_arrow_export_t& c,
+    ptr_range_gt<ustore_key_t const> keys,
+    linked_memory_lock_t& arena,
+    ArrowSchema& schema_c,
+    ArrowArray& array_c) {
+
+    std::size_t const docs_count = keys.size();
+    strided_iterator_gt<ustore_str_view_t const> fields {c.fields, c.fields_stride};
+    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+
+    // Empty batches only carry the schema, but Arrow still expects the buffers
+    if (!docs_count) {
+        for (std::size_t field_idx = 0; field_idx != c.fields_count && !*c.error; ++field_idx)
+            ustore_to_arrow_column( //
+                0,
+                fields[field_idx],
+                types[field_idx] == ustore_doc_field_bool_k ? ustore_doc_field_u8_k : types[field_idx],
+                nullptr,
+                reinterpret_cast<ustore_length_t const*>(arrow_empty_buffer_k),
+                arrow_empty_buffer_k,
+                schema_c.children[1 + field_idx],
+                array_c.children[1 + field_idx],
+                c.error);
+        return;
+    }
+
+    ustore_octet_t** found_validities = nullptr;
+    ustore_byte_t** found_scalars = nullptr;
+    ustore_length_t** found_offsets = nullptr;
+    ustore_length_t** found_lengths = nullptr;
+    ustore_byte_t* found_strings = nullptr;
+    ustore_docs_gather_t gather {};
+    gather.db = c.db;
+    gather.error = c.error;
+    gather.snapshot = c.snapshot;
+    gather.arena = c.arena;
+    gather.options = ustore_options_t(c.options | ustore_option_dont_discard_memory_k);
+    gather.docs_count = docs_count;
+    gather.fields_count = c.fields_count;
+    gather.collections = &c.collection;
+    gather.keys = keys.begin();
+    gather.keys_stride = sizeof(ustore_key_t);
+    gather.fields = c.fields;
+    gather.fields_stride = c.fields_stride;
+    gather.types = c.types;
+    gather.types_stride = c.types_stride;
+    gather.columns_validities = &found_validities;
+    gather.columns_scalars = &found_scalars;
+    gather.columns_offsets = &found_offsets;
+    gather.columns_lengths = &found_lengths;
+    gather.joined_strings = &found_strings;
+    ustore_docs_gather(&gather);
+    return_if_error_m(c.error);
+
+    auto is_string = [](ustore_doc_field_type_t type) {
+        return type == ustore_doc_field_str_k || type == ustore_doc_field_bin_k;
+    };
+    auto string_length = [&](std::size_t field_idx, std::size_t doc_idx) {
+        return check_presence(found_validities[field_idx], doc_idx) ? found_lengths[field_idx][doc_idx] : 0u;
+    };
+
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx) {
+        void const* contents = found_scalars[field_idx];
+        ustore_length_t* offsets = nullptr;
+        if (is_string(types[field_idx])) {
+            std::size_t strings_length = 0;
+            for (std::size_t doc_idx = 0; doc_idx != docs_count; ++doc_idx)
+                strings_length += string_length(field_idx, doc_idx);
+            auto strings = arena.alloc<ustore_byte_t>(strings_length, c.error);
+            offsets = arena.alloc<ustore_length_t>(docs_count + 1, c.error).begin();
+            return_if_error_m(c.error);
+
+            std::size_t strings_progress = 0;
+            for (std::size_t doc_idx = 0; doc_idx != docs_count; ++doc_idx) {
+                ustore_length_t const length = string_length(field_idx, doc_idx);
+                offsets[doc_idx] = static_cast<ustore_length_t>(strings_progress);
+                std::memcpy(strings.begin() + strings_progress,
+                            found_strings + found_offsets[field_idx][doc_idx],
+                            length);
+                strings_progress += length;
+            }
+            offsets[docs_count] = static_cast<ustore_length_t>(strings_progress);
+            contents = strings_length ? (void const*)strings.begin() : (void const*)arrow_empty_buffer_k;
+        }
+
+        // Booleans are gathered as bytes, not bits
+        ustore_to_arrow_column( //
+            docs_count,
+            fields[field_idx],
+            types[field_idx] == ustore_doc_field_bool_k ? ustore_doc_field_u8_k : types[field_idx],
+            found_validities[field_idx],
+            offsets,
+            contents,
+            schema_c.children[1 + field_idx],
+            array_c.children[1 + field_idx],
+            c.error);
+        return_if_error_m(c.error);
+    }
+}
+
+#pragma endregion - Arrow
+
+#pragma region - Main Functions(Arrow)
+
+void ustore_arrow_export(ustore_arrow_export_t* c_ptr) noexcept(false) {
+
+    ustore_arrow_export_t& c = *c_ptr;
+
+    return_error_if_m(c.db, c.error, uninitialized_state_k, "DataBase is uninitialized");
+    return_error_if_m(c.batch_size, c.error, uninitialized_state_k, "Batch size is 0");
+    return_error_if_m(!c.fields_count || (c.fields && c.types),
+                      c.error,
+                      uninitialized_state_k,
+                      "Fields must be provided with their types");
+    strided_iterator_gt<ustore_doc_field_type_t const> types {c.types, c.types_stride};
+    for (std::size_t field_idx = 0; field_idx != c.fields_count; ++field_idx)
+        return_error_if_m(types[field_idx] != ustore_doc_field_null_k &&
+                              *ustore_doc_field_type_to_arrow_format(types[field_idx]),
+                          c.error,
+                          args_wrong_k,
+                          "Field type can't be exported into Arrow");
+
+    arena_t own_arena(c.db);
+    if (!c.arena)
+        c.arena = own_arena.member_ptr();
+
+    std::string const path = c.path ? std::string(c.path) : fmt::format("{}.arrow", generate_file_name());
+    std::shared_ptr<arrow::io::OutputStream> file;
+    if (c.memory_map) {
+        auto maybe_file = mapped_output_stream_t::open(path, std::max<std::int64_t>(c.batch_size * 64, 4096));
+        return_error_if_m(maybe_file.ok(), c.error, error_unknown_k, "Can't map file");
+        file = maybe_file.MoveValueUnsafe();
+    }
+    else {
+        auto maybe_file = arrow::io::FileOutputStream::Open(path);
+        return_error_if_m(maybe_file.ok(), c.error, error_unknown_k, "Can't open file");
+        file = maybe_file.MoveValueUnsafe();
+    }
+
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+    ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_length_t const count_limit = static_cast<ustore_length_t>(c.batch_size);
+    bool const needs_values = !c.fields_count;
+    while (true) {
+        // The previous batch is already written, so its memory can be discarded
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_length_t* found_values_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_scan_t scan {};
+        scan.db = c.db;
+        scan.error = c.error;
+        scan.snapshot = c.snapshot;
+        scan.arena = c.arena;
+        scan.options = ustore_options_t(c.options & ~ustore_option_dont_discard_memory_k);
+        scan.tasks_count = 1;
+        scan.collections = &c.collection;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        scan.values_offsets = needs_values ? &found_values_offsets : nullptr;
+        scan.values = needs_values ? &found_values : nullptr;
+        ustore_scan(&scan);
+        return_if_error_m(c.error);
+
+        ptr_range_gt<ustore_key_t const> keys {found_keys, found_counts[0]};
+        if (keys.size() == 0 && writer)
+            break;
+
+        auto arena = linked_memory(c.arena, ustore_options_t(c.options | ustore_option_dont_discard_memory_k), c.error);
+        return_if_error_m(c.error);
+
+        ArrowSchema schema_c;
+        ArrowArray array_c;
+        ustore_to_arrow_schema(keys.size(), 1 + (needs_values ? 1 : c.fields_count), &schema_c, &array_c, c.error);
+        return_if_error_m(c.error);
+        ustore_to_arrow_column( //
+            keys.size(),
+            "_id",
+            ustore_doc_field_i64_k,
+            nullptr,
+            nullptr,
+            keys.size() ? (void const*)keys.begin() : (void const*)arrow_empty_buffer_k,
+            schema_c.children[0],
+            array_c.children[0],
+            c.error);
+        if (!*c.error && needs_values)
+            export_values_column(c, keys, found_values_offsets, found_values, schema_c, array_c);
+        else if (!*c.error)
+            export_fields_columns(c, keys, arena, schema_c, array_c);
+        return_if_error_m(c.error);
+
+        auto maybe_batch = arrow::ImportRecordBatch(&array_c, &schema_c);
+        return_error_if_m(maybe_batch.ok(), c.error, error_unknown_k, "Can't import batch");
+        std::shared_ptr<arrow::RecordBatch> batch = maybe_batch.MoveValueUnsafe();
+        if (!writer) {
+            auto maybe_writer = arrow::ipc::MakeFileWriter(file, batch->schema());
+            return_error_if_m(maybe_writer.ok(), c.error, error_unknown_k, "Can't start the IPC file");
+            writer = maybe_writer.MoveValueUnsafe();
+        }
+        if (keys.size()) {
+            arrow::Status status = writer->WriteRecordBatch(*batch);
+            return_error_if_m(status.ok(), c.error, error_unknown_k, "Can't write batch");
+            if (c.callback)
+                c.callback(c.callback_payload);
+        }
+        if (keys.size() < c.batch_size || keys[keys.size() - 1] == std::numeric_limits<ustore_key_t>::max())
+            break;
+        start_key = keys[keys.size() - 1] + 1;
+    }
+
+    arrow::Status status = writer->Close();
+    return_error_if_m(status.ok(), c.error, error_unknown_k, "Can't finish the IPC file");
+    status = file->Close();
+    return_error_if_m(status.ok(), c.error, error_unknown_k, "Can't close file");
+}
+
+#pragma endregion - Main Functions(Arrow)
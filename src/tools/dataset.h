@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <ustore/db.h>
+#include <ustore/docs.h> // `ustore_doc_field_type_t`
 
 typedef struct ustore_docs_import_t {
 
@@ -52,6 +53,57 @@ typedef struct ustore_docs_export_t {
 
 void ustore_docs_export(ustore_docs_export_t*);
 
+typedef struct ustore_graph_import_t {
+
+    ustore_database_t db;
+    ustore_error_t* error;
+    ustore_arena_t* arena; // optional
+    ustore_options_t options; // ustore_options_default_k
+
+    ustore_collection_t collection; // ustore_collection_main_k
+    ustore_str_view_t paths_pattern; // ".*\\.(csv|parquet)"
+    ustore_size_t max_batch_size; // 1024ul * 1024ul * 1024ul
+    ustore_callback_t callback; // optional
+    ustore_callback_payload_t callback_payload; // optional
+
+    ustore_str_view_t source_id_field; // "source"
+    ustore_str_view_t target_id_field; // "target"
+    ustore_str_view_t edge_id_field; // optional
+
+} ustore_graph_import_t;
+
+void ustore_graph_import(ustore_graph_import_t*);
+
+/**
+ * @brief Streams a whole collection into an Arrow IPC file, also known as Feather V2,
+ * one record batch at a time. Without `fields` the columns are "_id" and binary "value",
+ * otherwise "_id" and the gathered `fields`, like in `ustore_docs_gather()`.
+ */
+typedef struct ustore_arrow_export_t {
+
+    ustore_database_t db;
+    ustore_error_t* error;
+    ustore_arena_t* arena; // optional
+    ustore_options_t options; // ustore_options_default_k
+
+    ustore_collection_t collection; // ustore_collection_main_k
+    ustore_snapshot_t snapshot; // optional
+    ustore_str_view_t path; // optional, generated with ".arrow" extension
+    ustore_size_t batch_size; // 64ul * 1024ul
+    bool memory_map; // false
+    ustore_callback_t callback; // optional
+    ustore_callback_payload_t callback_payload; // optional
+
+    ustore_size_t fields_count; // optional
+    ustore_str_view_t const* fields; // optional
+    ustore_size_t fields_stride; // optional
+    ustore_doc_field_type_t const* types; // required with `fields`
+    ustore_size_t types_stride; // optional
+
+} ustore_arrow_export_t;
+
+void ustore_arrow_export(ustore_arrow_export_t*);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
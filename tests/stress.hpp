@@ -0,0 +1,112 @@
+/**
+ * @file stress.hpp
+ * @brief Workloads of the stress tests, shared with the `contention.cpp` benchmark.
+ *
+ * The tests validate the outcomes of those concurrent transactions,
+ * while the benchmark measures how fast and how often they commit.
+ */
+#pragma once
+#include <cstdlib>  // `std::getenv`
+#include <cstring>  // `std::strlen`
+#include <cstdint>  // `std::uint64_t`
+#include <numeric>  // `std::iota`
+#include <string>   // `std::string`
+#include <vector>   // `std::vector`
+
+#include <fmt/format.h>
+
+#include "ustore/ustore.hpp"
+
+namespace unum::ustore::stress {
+
+inline char const* path() {
+    char* path = std::getenv("USTORE_TEST_PATH");
+    if (path)
+        return std::strlen(path) ? path : nullptr;
+
+#if defined(USTORE_FLIGHT_CLIENT)
+    return nullptr;
+#elif defined(USTORE_TEST_PATH)
+    return USTORE_TEST_PATH;
+#else
+    return nullptr;
+#endif
+}
+
+inline std::string config() {
+    auto dir = path();
+    if (!dir)
+        return {};
+    return fmt::format(R"({{"version": "1.0", "directory": "{}"}})", dir);
+}
+
+/**
+ * @brief Transaction of the atomicity workload. Assigns the same value to a range of consecutive keys,
+ * or removes all of them, so that every range is either entirely overwritten by one transaction or not at all.
+ */
+class consecutive_batch_t {
+    std::vector<ustore_key_t> keys_;
+    std::uint64_t value_ = 0;
+    bool will_delete_ = false;
+
+  public:
+    consecutive_batch_t(std::size_t batch_size) : keys_(batch_size) {}
+
+    void prepare(ustore_key_t first_key, std::uint64_t value, bool will_delete) noexcept {
+        std::iota(keys_.begin(), keys_.end(), first_key);
+        value_ = value;
+        will_delete_ = will_delete;
+    }
+
+    status_t apply(blobs_collection_t& collection) noexcept {
+        value_view_t value {reinterpret_cast<byte_t const*>(&value_), sizeof(value_)};
+        return !will_delete_ ? collection[keys_].assign(value) : collection[keys_].erase();
+    }
+
+    std::vector<ustore_key_t> const& keys() const noexcept { return keys_; }
+};
+
+enum class operation_code_t : std::uint8_t {
+    insert_k,
+    remove_k,
+    select_k,
+};
+
+using payload_t = std::size_t;
+
+/**
+ * @brief Operation of the linearizability workload. Many of them form a transaction,
+ * and are replayed in the order of sequence numbers, when validating the outcomes.
+ */
+struct operation_t {
+    ustore_key_t key;
+    payload_t value;
+    ustore_sequence_number_t sequence;
+    operation_code_t code;
+    bool commited;
+
+    value_view_t value_view() const noexcept {
+        auto value_ptr = reinterpret_cast<byte_t const*>(&value);
+        return value_view_t {value_ptr, sizeof(payload_t)};
+    }
+
+    /**
+     * @brief Picks the key with the `keys` distribution, and a random value to insert.
+     */
+    template <typename generator_at, typename keys_distribution_at>
+    void randomize(operation_code_t new_code, generator_at& generator, keys_distribution_at& keys) noexcept {
+        code = new_code;
+        key = keys(generator);
+        value = generator();
+    }
+
+    status_t apply(transaction_t& txn) noexcept {
+        switch (code) {
+        case operation_code_t::insert_k: return txn[key].assign(value_view());
+        case operation_code_t::remove_k: return txn[key].erase();
+        default: return {};
+        }
+    }
+};
+
+} // namespace unum::ustore::stress
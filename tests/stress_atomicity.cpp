@@ -11,31 +11,12 @@
 #include <fmt/format.h>
 
 #include "ustore/ustore.hpp"
+#include "stress.hpp"
 
 using namespace unum::ustore;
+using namespace unum::ustore::stress;
 using namespace unum;
 
-static char const* path() {
-    char* path = std::getenv("USTORE_TEST_PATH");
-    if (path)
-        return std::strlen(path) ? path : nullptr;
-
-#if defined(USTORE_FLIGHT_CLIENT)
-    return nullptr;
-#elif defined(USTORE_TEST_PATH)
-    return USTORE_TEST_PATH;
-#else
-    return nullptr;
-#endif
-}
-
-static std::string config() {
-    auto dir = path();
-    if (!dir)
-        return {};
-    return fmt::format(R"({{"version": "1.0", "directory": "{}"}})", dir);
-}
-
 /**
  * @brief Tests the atomicity of transactions.
  *
@@ -57,20 +38,18 @@ void insert_atomic_isolated(std::size_t count_batches) {
         std::random_device random_device;
         std::mt19937 random_generator(random_device());
 
+        consecutive_batch_t batch(batch_size_ak);
         for (std::size_t idx_batch = 0; idx_batch != count_batches; ++idx_batch) {
 
-            std::array<ustore_key_t, batch_size_ak> keys;
             ustore_key_t const first_key_in_batch = idx_batch * batch_size_ak;
-            std::iota(keys.begin(), keys.end(), first_key_in_batch);
-
             bool const will_delete = deletes_periodicity_ak ? random_generator() % deletes_periodicity_ak == 0 : 0;
             std::uint64_t const num_value = idx_batch * threads_count_ak + thread_idx;
-            value_view_t value((byte_t const*)&num_value, sizeof(num_value));
+            batch.prepare(first_key_in_batch, num_value, will_delete);
 
             while (true) {
                 transaction_t txn = db.transact().throw_or_release();
                 auto collection = txn.main();
-                status_t status = !will_delete ? collection[keys].assign(value) : collection[keys].erase();
+                status_t status = batch.apply(collection);
                 if (!status)
                     continue;
                 status = txn.commit();
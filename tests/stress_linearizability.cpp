@@ -13,51 +13,12 @@
 #include <fmt/format.h>
 
 #include "ustore/ustore.hpp"
+#include "stress.hpp"
 
 using namespace unum::ustore;
+using namespace unum::ustore::stress;
 using namespace unum;
 
-static char const* path() {
-    char* path = std::getenv("USTORE_TEST_PATH");
-    if (path)
-        return std::strlen(path) ? path : nullptr;
-
-#if defined(USTORE_FLIGHT_CLIENT)
-    return nullptr;
-#elif defined(USTORE_TEST_PATH)
-    return USTORE_TEST_PATH;
-#else
-    return nullptr;
-#endif
-}
-
-static std::string config() {
-    auto dir = path();
-    if (!dir)
-        return {};
-    return fmt::format(R"({{"version": "1.0", "directory": "{}"}})", dir);
-}
-
-enum class operation_code_t : std::uint8_t {
-    insert_k,
-    remove_k,
-    select_k,
-};
-
-using payload_t = std::size_t;
-struct operation_t {
-    ustore_key_t key;
-    payload_t value;
-    ustore_sequence_number_t sequence;
-    operation_code_t code;
-    bool commited;
-
-    value_view_t value_view() const noexcept {
-        auto value_ptr = reinterpret_cast<byte_t const*>(&value);
-        return value_view_t {value_ptr, sizeof(payload_t)};
-    }
-};
-
 class barrier_t {
 
     mutable std::mutex mutex_;
@@ -201,16 +162,11 @@ void linear_writes( //
                 txn.reset().throw_unhandled();
                 for (std::size_t part = 0; part != parts_total_k; ++part) {
                     operation_t& op = operations[iteration * parts_total_k + part];
-                    op.code = (random_generator() % parts_total_k) > part_inserts_ak //
-                                  ? operation_code_t::insert_k
-                                  : operation_code_t::remove_k;
-                    op.key = dist_keys(random_generator);
-                    op.value = random_generator();
-                    switch (op.code) {
-                    case operation_code_t::insert_k: txn[op.key].assign(op.value_view()).throw_unhandled(); break;
-                    case operation_code_t::remove_k: txn[op.key].erase().throw_unhandled(); break;
-                    default: break;
-                    }
+                    auto code = (random_generator() % parts_total_k) > part_inserts_ak //
+                                    ? operation_code_t::insert_k
+                                    : operation_code_t::remove_k;
+                    op.randomize(code, random_generator, dist_keys);
+                    op.apply(txn).throw_unhandled();
                 }
                 auto maybe_sequence = txn.sequenced_commit();
                 auto commited = bool(maybe_sequence);
@@ -3,8 +3,11 @@
 #include <sys/mman.h> // `mmap` to read datasets faster
 #include <unistd.h>
 
+#include <set>
+#include <tuple>
 #include <string>
 #include <cstring>
+#include <fstream>
 #include <filesystem>
 #include <unordered_map>
 
@@ -19,9 +22,11 @@
 #include <arrow/io/api.h>
 #include <arrow/csv/api.h>
 #include <arrow/io/file.h>
+#include <arrow/ipc/api.h>
 #include <arrow/csv/writer.h>
 #include <arrow/memory_pool.h>
 #include <parquet/arrow/reader.h>
+#include <parquet/arrow/writer.h>
 #include <parquet/stream_writer.h>
 #include <arrow/compute/api_aggregate.h>
 #pragma GCC diagnostic pop
@@ -1037,6 +1042,240 @@ bool test_crash_cases_docs_export(ustore_str_view_t ext) {
     return true;
 }
 
+constexpr ustore_str_view_t edges_path_k = "sample_edges";
+constexpr size_t edges_count_k = 3000;
+
+/**
+ * Every fifth edge starts in the same vertex, so its neighborhood doesn't fit into
+ * a single batch, and the last edge repeats the first one.
+ */
+std::vector<edge_t> make_sample_edges() {
+    std::vector<edge_t> edges;
+    for (ustore_key_t idx = 0; idx != static_cast<ustore_key_t>(edges_count_k); ++idx)
+        edges.push_back(edge_t {idx % 5 ? idx % 97 + 1 : 0, (idx * 31) % 89 + 100, idx});
+    edges.push_back(edges.front());
+    return edges;
+}
+
+void write_sample_edges(std::vector<edge_t> const& edges, std::string const& file) {
+    if (fs::path(file).extension() == ext_csv_k) {
+        std::ofstream out(file);
+        out << "source,target,edge\n";
+        for (edge_t const& edge : edges)
+            out << edge.source_id << ',' << edge.target_id << ',' << edge.id << '\n';
+        return;
+    }
+
+    arrow::Int64Builder sources, targets, ids;
+    for (edge_t const& edge : edges) {
+        ASSERT_TRUE(sources.Append(edge.source_id).ok());
+        ASSERT_TRUE(targets.Append(edge.target_id).ok());
+        ASSERT_TRUE(ids.Append(edge.id).ok());
+    }
+    std::shared_ptr<arrow::Array> sources_array, targets_array, ids_array;
+    ASSERT_TRUE(sources.Finish(&sources_array).ok());
+    ASSERT_TRUE(targets.Finish(&targets_array).ok());
+    ASSERT_TRUE(ids.Finish(&ids_array).ok());
+    auto schema = arrow::schema({
+        arrow::field("source", arrow::int64()),
+        arrow::field("target", arrow::int64()),
+        arrow::field("edge", arrow::int64()),
+    });
+    auto table = arrow::Table::Make(schema, {sources_array, targets_array, ids_array});
+    auto maybe_output = arrow::io::FileOutputStream::Open(file);
+    ASSERT_TRUE(maybe_output.ok());
+    // Small row groups, to be streamed in a few record batches
+    ASSERT_TRUE(parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), *maybe_output, 500).ok());
+    ASSERT_TRUE((*maybe_output)->Close().ok());
+}
+
+/**
+ * Imports an edge list with a tiny memory budget, so that the half-edges are spilled
+ * into many sorted runs, and compares the neighborhoods of all vertices with the list.
+ */
+void test_graph_import(ustore_str_view_t ext) {
+
+    std::vector<edge_t> edges = make_sample_edges();
+    std::string file = std::string(edges_path_k) + ext;
+    write_sample_edges(edges, file);
+
+    auto collection = db.main();
+    arena_t arena(db);
+    status_t status;
+    ustore_graph_import_t graph {
+        .db = db,
+        .error = status.member_ptr(),
+        .arena = arena.member_ptr(),
+        .options = ustore_options_default_k,
+        .collection = collection,
+        .paths_pattern = file.c_str(),
+        .max_batch_size = 1024,
+        .callback = nullptr,
+        .callback_payload = nullptr,
+        .source_id_field = "source",
+        .target_id_field = "target",
+        .edge_id_field = "edge",
+    };
+    ustore_graph_import(&graph);
+    EXPECT_TRUE(status);
+
+    using neighborship_t = std::tuple<ustore_key_t, ustore_key_t, ustore_key_t>;
+    std::set<neighborship_t> expected_outgoing, expected_incoming;
+    for (edge_t const& edge : edges) {
+        expected_outgoing.emplace(edge.source_id, edge.target_id, edge.id);
+        expected_incoming.emplace(edge.target_id, edge.source_id, edge.id);
+    }
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    std::set<neighborship_t> outgoing, incoming;
+    std::set<ustore_key_t> vertices;
+    for (edge_t const& edge : edges) {
+        vertices.insert(edge.source_id);
+        vertices.insert(edge.target_id);
+    }
+    for (ustore_key_t vertex : vertices) {
+        edges_span_t vertex_outgoing = *net.edges_containing(vertex, ustore_vertex_source_k);
+        for (std::size_t i = 0; i != vertex_outgoing.size(); ++i)
+            outgoing.emplace(vertex_outgoing[i].source_id, vertex_outgoing[i].target_id, vertex_outgoing[i].id);
+        edges_span_t vertex_incoming = *net.edges_containing(vertex, ustore_vertex_target_k);
+        for (std::size_t i = 0; i != vertex_incoming.size(); ++i)
+            incoming.emplace(vertex_incoming[i].target_id, vertex_incoming[i].source_id, vertex_incoming[i].id);
+    }
+    EXPECT_EQ(outgoing, expected_outgoing);
+    EXPECT_EQ(incoming, expected_incoming);
+    EXPECT_EQ(*net.degree(0, ustore_vertex_source_k), edges_count_k / 5);
+
+    std::remove(file.c_str());
+    db.clear().throw_unhandled();
+}
+
+constexpr ustore_str_view_t arrow_path_k = "sample_export.arrow";
+
+std::shared_ptr<arrow::Table> read_arrow_file(ustore_str_view_t path, int& batches_count) {
+    auto maybe_input = arrow::io::ReadableFile::Open(path);
+    EXPECT_TRUE(maybe_input.ok());
+    auto maybe_reader = arrow::ipc::RecordBatchFileReader::Open(*maybe_input);
+    EXPECT_TRUE(maybe_reader.ok());
+    auto reader = *maybe_reader;
+    batches_count = reader->num_record_batches();
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    for (int batch_idx = 0; batch_idx != batches_count; ++batch_idx)
+        batches.push_back(*reader->ReadRecordBatch(batch_idx));
+    return *arrow::Table::FromRecordBatches(reader->schema(), batches);
+}
+
+/**
+ * Exports binary values into an Arrow IPC file in several record batches,
+ * either through buffered writes or a memory mapping, and reads them back.
+ */
+void test_arrow_export_values(bool memory_map) {
+
+    constexpr std::size_t count_k = 2500;
+    constexpr std::size_t batch_size_k = 1000;
+    std::vector<ustore_key_t> keys(count_k);
+    std::vector<std::string> values(count_k);
+    std::vector<value_view_t> values_views(count_k);
+    for (std::size_t i = 0; i != count_k; ++i) {
+        keys[i] = static_cast<ustore_key_t>(i * 3) - 1000;
+        values[i] = std::string(i % 100, static_cast<char>(i));
+        values_views[i] = value_view_t {values[i].data(), values[i].size()};
+    }
+    auto collection = db.main();
+    EXPECT_TRUE(collection[keys].assign(values_views));
+
+    arena_t arena(db);
+    status_t status;
+    ustore_arrow_export_t exp {
+        .db = db,
+        .error = status.member_ptr(),
+        .arena = arena.member_ptr(),
+        .options = ustore_options_default_k,
+        .collection = collection,
+        .snapshot = nullptr,
+        .path = arrow_path_k,
+        .batch_size = batch_size_k,
+        .memory_map = memory_map,
+    };
+    ustore_arrow_export(&exp);
+    EXPECT_TRUE(status);
+
+    int batches_count = 0;
+    auto table = read_arrow_file(arrow_path_k, batches_count);
+    EXPECT_EQ(batches_count, 3);
+    EXPECT_EQ(table->num_rows(), static_cast<std::int64_t>(count_k));
+    EXPECT_EQ(table->num_columns(), 2);
+    std::int64_t row_idx = 0;
+    auto ids = table->GetColumnByName(id_k);
+    auto exported_values = table->GetColumnByName("value");
+    for (int chunk_idx = 0; chunk_idx != ids->num_chunks(); ++chunk_idx) {
+        auto ids_chunk = std::static_pointer_cast<arrow::Int64Array>(ids->chunk(chunk_idx));
+        auto values_chunk = std::static_pointer_cast<arrow::BinaryArray>(exported_values->chunk(chunk_idx));
+        for (std::int64_t i = 0; i != ids_chunk->length(); ++i, ++row_idx) {
+            EXPECT_EQ(ids_chunk->Value(i), keys[row_idx]);
+            EXPECT_EQ(values_chunk->GetView(i), values[row_idx]);
+        }
+    }
+
+    std::remove(arrow_path_k);
+    db.clear().throw_unhandled();
+}
+
+/**
+ * Exports chosen fields of documents, some of which miss them, into typed columns.
+ */
+void test_arrow_export_fields() {
+
+    constexpr std::size_t count_k = 100;
+    auto collection = db.main<docs_collection_t>();
+    for (std::size_t i = 0; i != count_k; ++i)
+        collection[ustore_key_t(i)] = i % 10 ? fmt::format(R"({{"name":"User {}","age":{}}})", i, i).c_str()
+                                             : fmt::format(R"({{"name":"User {}"}})", i).c_str();
+
+    ustore_str_view_t fields[2] = {"age", "name"};
+    ustore_doc_field_type_t types[2] = {ustore_doc_field_i64_k, ustore_doc_field_str_k};
+    arena_t arena(db);
+    status_t status;
+    ustore_arrow_export_t exp {
+        .db = db,
+        .error = status.member_ptr(),
+        .arena = arena.member_ptr(),
+        .options = ustore_options_default_k,
+        .collection = collection,
+        .snapshot = nullptr,
+        .path = arrow_path_k,
+        .batch_size = 32,
+        .memory_map = false,
+        .callback = nullptr,
+        .callback_payload = nullptr,
+        .fields_count = 2,
+        .fields = fields,
+        .fields_stride = sizeof(ustore_str_view_t),
+        .types = types,
+        .types_stride = sizeof(ustore_doc_field_type_t),
+    };
+    ustore_arrow_export(&exp);
+    EXPECT_TRUE(status);
+
+    int batches_count = 0;
+    auto table = read_arrow_file(arrow_path_k, batches_count);
+    EXPECT_EQ(batches_count, 4);
+    EXPECT_EQ(table->num_rows(), static_cast<std::int64_t>(count_k));
+    auto combined = *table->CombineChunks();
+    auto ids = std::static_pointer_cast<arrow::Int64Array>(combined->GetColumnByName(id_k)->chunk(0));
+    auto ages = std::static_pointer_cast<arrow::Int64Array>(combined->GetColumnByName("age")->chunk(0));
+    auto names = std::static_pointer_cast<arrow::StringArray>(combined->GetColumnByName("name")->chunk(0));
+    for (std::int64_t i = 0; i != combined->num_rows(); ++i) {
+        EXPECT_EQ(ids->Value(i), i);
+        EXPECT_EQ(ages->IsNull(i), i % 10 == 0);
+        if (i % 10)
+            EXPECT_EQ(ages->Value(i), i);
+        EXPECT_EQ(names->GetView(i), fmt::format("User {}", i));
+    }
+
+    std::remove(arrow_path_k);
+    db.clear().throw_unhandled();
+}
+
 TEST(import_export_docs_whole, ndjosn_ndjson) {
     test_whole_docs(ndjson_path_k, ext_ndjson_k, cmp_ndjson_docs_whole);
 }
@@ -1097,6 +1336,23 @@ TEST(import_export_docs_sub, csv_csv) {
     test_sub_docs(csv_path_k, ext_csv_k, cmp_table_docs_sub, true);
 }
 
+TEST(import_graph, csv) {
+    test_graph_import(ext_csv_k);
+}
+TEST(import_graph, parquet) {
+    test_graph_import(ext_parquet_k);
+}
+
+TEST(export_arrow, values) {
+    test_arrow_export_values(false);
+}
+TEST(export_arrow, values_mapped) {
+    test_arrow_export_values(true);
+}
+TEST(export_arrow, fields) {
+    test_arrow_export_fields();
+}
+
 TEST(crash_cases, docs_import) {
     test_crash_cases_docs_import(ndjson_path_k);
     test_crash_cases_docs_import(ndjson_path_k);
@@ -7,6 +7,8 @@
  */
 
 #include <vector>
+#include <map>
+#include <set>
 #include <unordered_set>
 #include <filesystem>
 #include <fstream>
@@ -14,7 +16,11 @@
 #include <unistd.h>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <shared_mutex>
+#include <random>
+#include <optional>
+#include <numeric>
 
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
@@ -114,6 +120,39 @@ void clear_environment() {
     }
 }
 
+#if defined(USTORE_FLIGHT_CLIENT)
+/**
+ * Starts one more server next to the one of `clear_environment()`, listening on another `port`
+ * and persisting into its own empty directory, with optional extra command-line `arguments`.
+ */
+static pid_t start_server(int port, std::vector<std::string> const& arguments = {}) {
+    std::string directory = fmt::format("./tmp/ustore_{}/", port);
+    std::string config_path = fmt::format("./tmp/ustore_{}.json", port);
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(config_path) << fmt::format(R"({{"version": "1.0", "directory": "{}"}})", directory);
+
+    std::vector<std::string> args {srv_path, "--quiet", "--config", config_path, "--port", std::to_string(port)};
+    args.insert(args.end(), arguments.begin(), arguments.end());
+    pid_t id = fork();
+    if (id == 0) {
+        std::vector<char*> argv;
+        for (std::string& arg : args)
+            argv.push_back(arg.data());
+        argv.push_back(nullptr);
+        execv(srv_path.c_str(), argv.data());
+        exit(0);
+    }
+    usleep(100000); // 0.1 sec
+    return id;
+}
+
+static void stop_server(pid_t id) {
+    kill(id, SIGKILL);
+    waitpid(id, nullptr, 0);
+}
+#endif
+
 inline std::ostream& operator<<(std::ostream& os, collection_key_t obj) {
     return os << obj.collection << obj.key;
 }
@@ -568,1648 +607,5339 @@ TEST(db, presences) {
     }
 }
 
-TEST(db, scan) {
-    clear_environment();
-    database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
-    blobs_collection_t collection = db.main();
-
-    constexpr std::size_t keys_size = 1000;
-    std::array<ustore_key_t, keys_size> keys;
-    std::iota(std::begin(keys), std::end(keys), 0);
-    auto ref = collection[keys];
-    value_view_t value("value");
-    EXPECT_TRUE(ref.assign(value));
-    keys_stream_t stream(db, collection, 256);
-
-    EXPECT_TRUE(stream.seek_to_first());
-    ustore_key_t key = 0;
-    while (!stream.is_end()) {
-        EXPECT_EQ(stream.key(), key++);
-        ++stream;
-    }
-    EXPECT_EQ(key, keys_size);
-}
-
 /**
- * Ordered batched scan over the main collection.
+ * Values of collections with a TTL are exported without their deadlines,
+ * and are reported missing by reads and scans, once they expire.
  */
-TEST(db, batch_scan) {
+TEST(db, collection_ttl) {
+    if (!ustore_supports_named_collections_k)
+        return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    blobs_collection_t collection = db.main();
 
-    std::array<ustore_key_t, 512> keys;
-    std::iota(std::begin(keys), std::end(keys), 0);
-    auto ref = collection[keys];
-    value_view_t value("value");
-    EXPECT_TRUE(ref.assign(value));
-    keys_stream_t stream(db, collection, 256);
+    blobs_collection_t expiring = db.create("expiring", R"({"ttl": 1})").throw_or_release();
+    blobs_collection_t lasting = db.create("lasting").throw_or_release();
+    for (ustore_key_t key = 0; key != 10; ++key) {
+        expiring[key] = "short";
+        lasting[key] = "long";
+    }
+    EXPECT_EQ(*expiring[5].value(), "short");
+    EXPECT_EQ(*lasting[5].value(), "long");
 
+    usleep(1500000); // 1.5 sec
+    EXPECT_FALSE(*expiring[5].present());
+    EXPECT_EQ(*lasting[5].value(), "long");
+
+    keys_stream_t stream(db, expiring, 256);
     EXPECT_TRUE(stream.seek_to_first());
-    auto batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 256);
-    EXPECT_FALSE(stream.is_end());
-    for (ustore_key_t i = 0; i != 256; ++i)
-        EXPECT_EQ(batch[i], i);
+    EXPECT_TRUE(stream.is_end());
 
-    EXPECT_TRUE(stream.seek_to_next_batch());
-    batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 256);
-    EXPECT_FALSE(stream.is_end());
-    for (ustore_key_t i = 0; i != 256; ++i)
-        EXPECT_EQ(batch[i], i + 256);
+    // Rewritten keys get new deadlines
+    expiring[5] = "again";
+    EXPECT_EQ(*expiring[5].value(), "again");
 
-    EXPECT_TRUE(stream.seek_to_next_batch());
-    batch = stream.keys_batch();
-    EXPECT_EQ(batch.size(), 0);
-    EXPECT_TRUE(stream.is_end());
+    EXPECT_TRUE(db.drop("expiring"));
+    EXPECT_TRUE(db.drop("lasting"));
+    EXPECT_TRUE(db.clear());
 }
 
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_UCSET) || defined(USTORE_ENGINE_IS_TIERED)
 /**
- * Checks the "Read Commited" consistency guarantees of transactions.
- * Readers can't see the contents of pending (not committed) transactions.
- * https://jepsen.io/consistency/models/read-committed
+ * Paths of collections with native string keys are read back and matched by prefixes in order.
  */
-TEST(db, transaction_read_commited) {
-    if (!ustore_supports_transactions_k)
-        return;
-
+TEST(db, paths_string_keys) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn = *db.transact();
 
-    triplet_t triplet;
+    blobs_collection_t strings = db.create("strings", R"({"keys": "strings"})").throw_or_release();
+    ustore_collection_t collection = strings;
 
-    auto txn_ref = txn[triplet.keys];
-    round_trip(txn_ref, triplet);
+    char const* keys[] {"Netflix", "Apple", "Nvidia", "Amazon"};
+    char const* vals[] {"N", "A", "V", "Z"};
+    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
 
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+    arena_t arena(db);
+    status_t status {};
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = keys_count;
+    paths_write.collections = &collection;
+    paths_write.paths = keys;
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
+    paths_write.values_bytes_stride = sizeof(char const*);
+    ustore_paths_write(&paths_write);
+    EXPECT_TRUE(status);
 
-    // Check for missing values before commit
-    check_length(collection_ref, ustore_length_missing_k);
-    EXPECT_TRUE(txn.commit());
-    EXPECT_TRUE(txn.reset());
+    char* vals_recovered {};
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = keys_count;
+    paths_read.collections = &collection;
+    paths_read.paths = keys;
+    paths_read.paths_stride = sizeof(char const*);
+    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+    ustore_paths_read(&paths_read);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(std::string_view(vals_recovered, keys_count * 2), std::string_view("N\0A\0V\0Z\0", keys_count * 2));
 
-    // Validate that values match after commit
-    check_equalities(collection_ref, triplet);
+    ustore_str_view_t prefix = "N";
+    ustore_length_t max_count = 10;
+    ustore_length_t* results_counts {};
+    ustore_length_t* tape_offsets {};
+    ustore_char_t* tape_begin {};
+    ustore_paths_match_t paths_match {};
+    paths_match.db = db;
+    paths_match.error = status.member_ptr();
+    paths_match.arena = arena.member_ptr();
+    paths_match.tasks_count = 1;
+    paths_match.collections = &collection;
+    paths_match.match_counts_limits = &max_count;
+    paths_match.patterns = &prefix;
+    paths_match.match_counts = &results_counts;
+    paths_match.paths_offsets = &tape_offsets;
+    paths_match.paths_strings = &tape_begin;
+    ustore_paths_match(&paths_match);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(results_counts[0], 2);
+    EXPECT_EQ(std::string_view(tape_begin), "Netflix");
+    EXPECT_EQ(std::string_view(tape_begin + tape_offsets[1]), "Nvidia");
+
+    EXPECT_TRUE(db.drop("strings"));
+    EXPECT_TRUE(db.clear());
 }
+#endif
 
+#if !defined(USTORE_ENGINE_IS_LEVELDB) && !defined(USTORE_ENGINE_IS_UDISK)
 /**
- * Checks the "Snapshot Isolation" consistency guarantees of transactions.
- * If needed, readers can initiate snapshot-backed transactions.
- * All the reads, directed to that snapshot will not see newer operations,
- * affecting the HEAD state. From a consistency standpoint, it is a downgrade
- * from "Strictly Serializable" ACID transactions, but it is extremely useful
- * for numerous Business Intelligence applications.
- * https://jepsen.io/consistency/models/snapshot-isolation
+ * Reads byte ranges of values, and overwrites and appends to them in-place.
  */
-TEST(db, transaction_snapshot_isolation) {
-    if (!ustore_supports_snapshots_k)
-        return;
-
+TEST(db, partial_values) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
+    blobs_collection_t main = db.main();
+    main[1] = "header:payload";
+    EXPECT_EQ(*main[1].slice(0, 6), "header");
+    EXPECT_EQ(*main[1].slice(7, 100), "payload");
+    EXPECT_EQ(*main[1].slice(100, 4), "");
+    EXPECT_FALSE(*main[2].slice(0, 4));
+
+    EXPECT_TRUE(main[1].assign_at(0, "HEADER"));
+    EXPECT_TRUE(main[1].append("!"));
+    EXPECT_EQ(*main[1].value(), "HEADER:payload!");
+
+    // Missing values are created and padded with zeros
+    EXPECT_TRUE(main[2].assign_at(2, "ab"));
+    EXPECT_EQ(*main[2].value(), value_view_t("\0\0ab", 4));
+    EXPECT_TRUE(main[2].erase());
+    EXPECT_FALSE(*main[2].present());
+    EXPECT_TRUE(db.clear());
+}
+#endif
 
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_LEVELDB) || defined(USTORE_ENGINE_IS_UCSET)
+static json_t control(database_t& db, char const* request) {
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.error = status.member_ptr();
+    control.arena = arena.member_ptr();
+    control.request = request;
+    control.response = &response;
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
+    return response ? json_t::parse(response) : json_t {};
+}
+#endif
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_LEVELDB)
+static std::string config_with_read_cache() {
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    return fmt::format(
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"ReadCache": {{"capacity": "1MB"}}}}}}}})",
+        path());
+#else
+    return fmt::format(
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"read_cache_size": 1048576}}}}}})",
+        path());
+#endif
+}
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
-    round_trip(snap_ref, triplet);
-    round_trip(collection_ref, triplet_same_v);
+/**
+ * Repeatedly reads the same keys through the read cache, expecting hits after the first pass.
+ * Then updates them with single, batched and transactional writes, erasures and clears,
+ * expecting every following read to see the latest value, rather than the cached one.
+ */
+TEST(db, read_cache) {
+    if (!path())
+        return;
 
-    // Validate that values match
-    auto maybe_retrieved = snap_ref.value();
-    auto const& retrieved = *maybe_retrieved;
-    auto it = retrieved.begin();
-    auto cont = triplet_same_v.contents_full();
-    for (std::size_t i = 0; i != cont.size(); ++i, ++it) {
-        auto expected_len = cont[i].size();
-        auto expected_begin = cont[i].begin();
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config_with_read_cache().c_str()));
+    auto hits = [&] {
+        return control(db, "metrics")["read_cache"]["hits"].get<std::size_t>();
+    };
 
-        value_view_t retrieved_view = *it;
-        value_view_t expected_view(expected_begin, expected_begin + expected_len);
-        EXPECT_EQ(retrieved_view.size(), expected_view.size());
-        EXPECT_NE(retrieved_view, expected_view);
+    constexpr ustore_key_t keys_count = 100;
+    std::vector<ustore_key_t> keys(keys_count);
+    std::iota(keys.begin(), keys.end(), 0);
+    blobs_collection_t main = db.main();
+    for (ustore_key_t key : keys)
+        main[key] = std::to_string(key).c_str();
+    for (ustore_key_t key : keys)
+        EXPECT_EQ(*main[key].value(), std::to_string(key).c_str());
+
+    std::size_t const hits_before = hits();
+    for (ustore_key_t key : keys)
+        EXPECT_EQ(*main[key].value(), std::to_string(key).c_str());
+    EXPECT_TRUE(main[keys].value());
+    EXPECT_GE(hits() - hits_before, 2u * keys_count);
+
+    main[0] = "single";
+    EXPECT_EQ(*main[0].value(), "single");
+
+    EXPECT_TRUE(main[keys].assign(value_view_t("batched")));
+    for (ustore_key_t key : keys)
+        EXPECT_EQ(*main[key].value(), "batched");
+
+    EXPECT_TRUE(main[1].erase());
+    EXPECT_EQ(main.at(1).value(), value_view_t {});
+
+    if (ustore_supports_transactions_k) {
+        transaction_t txn = *db.transact();
+        txn.main()[2] = "transactional";
+        EXPECT_EQ(*main[2].value(), "batched");
+        EXPECT_TRUE(txn.commit());
+        EXPECT_EQ(*main[2].value(), "transactional");
     }
 
-    snap = *db.snapshot();
-    auto ref = snap[triplet_same_v.keys];
-    round_trip(ref, triplet_same_v);
-
     EXPECT_TRUE(db.clear());
+    EXPECT_EQ(main.at(3).value(), value_view_t {});
 }
-TEST(db, snapshots_list) {
-    if (!ustore_supports_snapshots_k)
-        return;
+#endif
 
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+/**
+ * Writes enough entries across two collections with `ustore_option_write_bulk_k`, to be ingested
+ * as SST files. A repeated key must keep its last value, and a missing value must delete the pair.
+ */
+TEST(db, write_bulk) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
+    blobs_collection_t named = *db.create("named");
+    main[7] = "existing";
+
+    constexpr std::size_t per_collection_k = 10'000;
+    std::vector<ustore_collection_t> collections;
+    std::vector<ustore_key_t> keys;
+    std::vector<std::string> values;
+    for (ustore_collection_t collection : {ustore_collection_t(main), ustore_collection_t(named)})
+        for (std::size_t i = 0; i != per_collection_k; ++i) {
+            collections.push_back(collection);
+            keys.push_back(static_cast<ustore_key_t>(per_collection_k - i));
+            values.push_back(fmt::format("{}:{}", collection == main ? "main" : "named", per_collection_k - i));
+        }
+    collections.push_back(main);
+    keys.push_back(42);
+    values.push_back("repeated");
+
+    std::vector<ustore_bytes_cptr_t> values_ptrs(values.size());
+    std::vector<ustore_length_t> lengths(values.size());
+    for (std::size_t i = 0; i != values.size(); ++i) {
+        values_ptrs[i] = reinterpret_cast<ustore_bytes_cptr_t>(values[i].c_str());
+        lengths[i] = static_cast<ustore_length_t>(values[i].size());
+    }
+    collections.push_back(main);
+    keys.push_back(7);
+    values_ptrs.push_back(nullptr);
+    lengths.push_back(ustore_length_missing_k);
 
-    auto snap_1 = *db.snapshot();
-    auto snapshots = snap_1.snapshots();
-    auto snaps = *snapshots;
-
-    EXPECT_EQ(snaps.size(), 1u);
-
-    auto snap_2 = *db.snapshot();
-    snapshots = snap_2.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 2u);
-
-    auto snap_3 = *db.snapshot();
-    snapshots = snap_3.snapshots();
-    snaps = *snapshots;
-
-    EXPECT_EQ(snaps.size(), 3u);
-
-    snap_1 = *db.snapshot();
-    snapshots = snap_1.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 3u);
+    arena_t arena(db);
+    status_t status;
+    ustore_write_t write {};
+    write.db = db;
+    write.error = status.member_ptr();
+    write.arena = arena.member_ptr();
+    write.options = ustore_option_write_bulk_k;
+    write.tasks_count = keys.size();
+    write.collections = collections.data();
+    write.collections_stride = sizeof(ustore_collection_t);
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.values = values_ptrs.data();
+    write.values_stride = sizeof(ustore_bytes_cptr_t);
+    write.lengths = lengths.data();
+    write.lengths_stride = sizeof(ustore_length_t);
+    ustore_write(&write);
+    EXPECT_TRUE(status);
 
+    EXPECT_FALSE(*main[7].present());
+    EXPECT_EQ(*main[42].value(), "repeated");
+    EXPECT_EQ(*named[42].value(), "named:42");
+    for (ustore_key_t key = 1; key <= static_cast<ustore_key_t>(per_collection_k); ++key) {
+        if (key != 7 && key != 42)
+            EXPECT_EQ(*main[key].value(), fmt::format("main:{}", key).c_str());
+        EXPECT_EQ(*named[key].value(), fmt::format("named:{}", key).c_str());
+    }
+    EXPECT_EQ(main.keys().size(), per_collection_k - 1);
+    EXPECT_EQ(named.keys().size(), per_collection_k);
     EXPECT_TRUE(db.clear());
+}
+#endif
 
-    snapshots = snap_1.snapshots();
-    snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 0u);
+#if defined(USTORE_ENGINE_IS_UCSET)
+/**
+ * Measures a collection, so that its statistics are built, and checks
+ * that they stay exact after further insertions, updates and deletions.
+ */
+TEST(db, collection_statistics) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
+    blobs_collection_t main = db.main();
+    for (ustore_key_t key = 0; key != 100; ++key)
+        main[key] = "value";
+    size_range_t cardinality = main.size_range().throw_or_release();
+    EXPECT_EQ(cardinality.min, 100u);
+    EXPECT_EQ(cardinality.max, 100u);
+
+    for (ustore_key_t key = 50; key != 150; ++key)
+        main[key] = "updated";
+    for (ustore_key_t key = 0; key != 10; ++key)
+        EXPECT_TRUE(main[key].erase());
+    cardinality = main.size_range().throw_or_release();
+    EXPECT_EQ(cardinality.min, 140u);
+    EXPECT_EQ(cardinality.max, 140u);
+
+    size_estimates_t estimates = main.members().size_estimates().throw_or_release();
+    EXPECT_EQ(estimates.bytes_in_values.min, 40u * 5u + 100u * 7u);
+    EXPECT_EQ(estimates.bytes_in_values.max, 40u * 5u + 100u * 7u);
     EXPECT_TRUE(db.clear());
 }
 
-TEST(db, transaction_with_snapshot) {
-    if (!ustore_supports_snapshots_k)
-        return;
-
+/**
+ * Opens two databases in the same process and checks, that the memory
+ * usage of one of them doesn't account for the values of the other.
+ */
+TEST(db, memory_usage_per_database) {
     clear_environment();
     database_t db;
+    database_t other;
     EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(other.open());
 
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
-
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+    ustore_key_t const keys_count = 1'000;
+    std::string const value(100, 'v');
+    blobs_collection_t other_main = other.main();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        other_main[key] = value.c_str();
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+    EXPECT_EQ(control(db, "usage")["used_bytes"].get<std::size_t>(), 0u);
+    EXPECT_GE(control(other, "usage")["used_bytes"].get<std::size_t>(), keys_count * value.size());
+    EXPECT_TRUE(db.clear());
+    EXPECT_TRUE(other.clear());
+}
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
-    check_equalities(snap_ref, triplet);
+/**
+ * Issues a known number of batched reads and checks, that the "metrics" control reports
+ * exactly as many calls and tasks, and that the latency histogram accounts for every call.
+ * Counters are process-wide, so only their growth is compared.
+ */
+TEST(db, metrics_histograms) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
+    for (ustore_key_t key = 0; key != 10; ++key)
+        main[key] = "value";
+
+    auto read_stats = [&] {
+        json_t metrics = control(db, "metrics");
+        std::size_t calls = 0, tasks = 0, bucketed = 0;
+        if (metrics.contains("read")) {
+            json_t const& read = metrics["read"];
+            calls = read["calls"].get<std::size_t>();
+            tasks = read["tasks"].get<std::size_t>();
+            for (json_t const& bucket : read["buckets"])
+                bucketed += bucket[1].get<std::size_t>();
+            EXPECT_LE(read["p50"].get<std::size_t>(), read["p99"].get<std::size_t>());
+        }
+        return std::array<std::size_t, 3> {calls, tasks, bucketed};
+    };
 
-    round_trip(collection_ref, triplet_same_v);
+    std::array<std::size_t, 3> const before = read_stats();
+    std::size_t const reads_count = 100;
+    std::size_t const batch_size = 4;
+    std::array<ustore_key_t, batch_size> keys {1, 3, 5, 20};
+    arena_t arena(db);
+    status_t status;
+    for (std::size_t i = 0; i != reads_count; ++i) {
+        ustore_octet_t* found_presences = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.tasks_count = batch_size;
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.presences = &found_presences;
+        ustore_read(&read);
+        EXPECT_TRUE(status);
+    }
+    std::array<std::size_t, 3> const after = read_stats();
 
-    transaction_t txn = *db.transact();
-    auto txn_ref_1 = txn[triplet.keys];
-    check_equalities(txn_ref_1, triplet_same_v);
+    EXPECT_EQ(after[0] - before[0], reads_count);
+    EXPECT_EQ(after[1] - before[1], reads_count * batch_size);
+    EXPECT_EQ(after[2] - before[2], reads_count);
+    EXPECT_EQ(after[2], after[0]);
+    EXPECT_TRUE(db.clear());
+}
 
-    txn.set_snapshot(snap.snap());
-    auto txn_ref_2 = txn[triplet.keys];
-    check_equalities(txn_ref_2, triplet);
+/**
+ * Repeatedly reads a batch, that doesn't fit into the initial arena, asking for huge pages.
+ * The results must stay intact, while the arena is refitted to the peak of the workload,
+ * which must be reflected in the "arena" section of the "metrics" control.
+ */
+TEST(db, arena_refits_with_huge_pages) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
 
-    snap = *db.snapshot();
-    txn.set_snapshot(snap.snap());
+    std::size_t const values_count = 8;
+    std::size_t const value_size = 512 * 1024;
+    std::vector<ustore_key_t> keys(values_count);
+    std::iota(keys.begin(), keys.end(), 0);
+    for (ustore_key_t key : keys)
+        main[key] = std::string(value_size, 'a' + key).c_str();
 
-    auto txn_ref_3 = txn[triplet.keys];
-    check_equalities(txn_ref_3, triplet_same_v);
+    json_t const before = control(db, "metrics")["arena"];
+    arena_t arena(db);
+    status_t status;
+    for (std::size_t round = 0; round != 4; ++round) {
+        ustore_length_t* found_lengths = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.options = ustore_option_huge_pages_k;
+        read.tasks_count = values_count;
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.lengths = &found_lengths;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
+        EXPECT_TRUE(status);
+
+        for (std::size_t i = 0; i != values_count; ++i) {
+            std::string_view found {reinterpret_cast<char const*>(found_values) + found_offsets[i], found_lengths[i]};
+            EXPECT_EQ(found, std::string(value_size, 'a' + keys[i]));
+        }
+    }
+
+#if !defined(USTORE_FLIGHT_CLIENT)
+    // Remote clients allocate their arenas in a different process, than the one reporting metrics
+    json_t const after = control(db, "metrics")["arena"];
+    EXPECT_GT(after["refits"].get<std::size_t>(), before["refits"].get<std::size_t>());
+    EXPECT_GE(after["max_peak"].get<std::size_t>(), values_count * value_size);
+    EXPECT_LE(after["huge_allocations"].get<std::size_t>(), after["allocations"].get<std::size_t>());
+#endif
     EXPECT_TRUE(db.clear());
 }
 
-TEST(db, set_wrong_snapshot) {
-    if (!ustore_supports_snapshots_k)
-        return;
-
+/**
+ * Leaves the slabs of one database sparsely occupied and checks, that compacting
+ * another one neither evacuates them, nor relocates anything, unlike compacting the owner.
+ */
+TEST(db, compaction_per_database) {
     clear_environment();
     database_t db;
+    database_t other;
     EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(other.open());
+
+    ustore_key_t const keys_count = 10'000;
+    std::string const value(100, 'v');
+    blobs_collection_t other_main = other.main();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        other_main[key] = value.c_str();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        if (key % 10)
+            EXPECT_TRUE(other_main[key].erase());
+
+    control(db, "compact");
+    json_t progress = control(db, "compaction");
+    EXPECT_EQ(progress["relocated_values"].get<std::size_t>(), 0u);
+    EXPECT_EQ(progress["evacuating_slabs"].get<std::size_t>(), 0u);
+    EXPECT_EQ(control(other, "compaction")["evacuating_slabs"].get<std::size_t>(), 0u);
+
+    control(other, "compact");
+    EXPECT_GE(control(other, "compaction")["relocated_values"].get<std::size_t>(), 1u);
+    for (ustore_key_t key = 0; key < keys_count; key += 10)
+        EXPECT_EQ(*other_main[key].value(), value.c_str());
+    EXPECT_TRUE(db.clear());
+    EXPECT_TRUE(other.clear());
+}
 
-    triplet_t triplet;
-    blobs_collection_t collection = db.main();
-    auto collection_ref = collection[triplet.keys];
+/**
+ * Persists several collections at once, one of them spanning a few row groups,
+ * with binary and empty values, and checks that reopening restores all of them.
+ */
+TEST(db, persistency_row_groups) {
+    if (!path())
+        return;
 
-    check_length(collection_ref, ustore_length_missing_k);
-    round_trip(collection_ref, triplet);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    auto snap = *db.snapshot();
+    // Values embed their own keys, including the zero bytes, and every tenth one is empty
+    std::size_t const keys_count = 150'000;
+    std::vector<ustore_key_t> keys(keys_count);
+    std::iota(keys.begin(), keys.end(), -static_cast<ustore_key_t>(keys_count / 2));
+    std::vector<value_view_t> values(keys_count);
+    for (std::size_t i = 0; i != keys_count; ++i)
+        values[i] = i % 10 ? value_view_t {reinterpret_cast<byte_t const*>(&keys[i]), sizeof(ustore_key_t)}
+                           : value_view_t {"", 0};
+    EXPECT_TRUE(db.main()[keys].assign(values));
+
+    std::size_t const collections_count = 8;
+    for (std::size_t collection_idx = 0; collection_idx != collections_count; ++collection_idx) {
+        blobs_collection_t named = *db.create(fmt::format("collection{}", collection_idx).c_str());
+        for (ustore_key_t key = 0; key != static_cast<ustore_key_t>(collection_idx * 100); ++key)
+            named[key] = fmt::format("{}:{}", collection_idx, key).c_str();
+    }
+    db.close();
 
-    auto snap_ref = snap[triplet.keys];
-    check_equalities(snap_ref, triplet);
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
+    EXPECT_EQ(main.keys().size(), keys_count);
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        EXPECT_TRUE(*main[keys[i]].present());
+        EXPECT_EQ(*main[keys[i]].value(), values[i]);
+    }
+    for (std::size_t collection_idx = 0; collection_idx != collections_count; ++collection_idx) {
+        blobs_collection_t named = *db[fmt::format("collection{}", collection_idx).c_str()];
+        EXPECT_EQ(named.keys().size(), collection_idx * 100);
+        for (ustore_key_t key = 0; key != static_cast<ustore_key_t>(collection_idx * 100); ++key)
+            EXPECT_EQ(*named[key].value(), fmt::format("{}:{}", collection_idx, key).c_str());
+    }
+    EXPECT_TRUE(db.clear());
+}
 
-    auto snapshots = snap.snapshots();
-    auto snaps = *snapshots;
-    EXPECT_EQ(snaps.size(), 1u);
+static std::string config_with_memory_policy(char const* policy) {
+    return fmt::format(
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"memory_limit": 65536, "memory_policy": "{}"}}}}}})",
+        path(),
+        policy);
+}
 
-    auto snapshot = snap.snap();
+/**
+ * Writes values, that don't fit into the inline storage of pairs, until the memory limit is reached.
+ * With the "reject" policy the write, that would exceed it, must fail, leaving the earlier ones intact.
+ */
+TEST(db, memory_policy_reject) {
+    if (!path())
+        return;
 
-    ustore_snapshot_t wrong_snap = 1u;
-    snap.set_snapshot(wrong_snap);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config_with_memory_policy("reject").c_str()));
+    EXPECT_EQ(control(db, "usage")["memory_limit"].get<std::size_t>(), 65536u);
 
-    auto wrong_snap_ref = snap[triplet.keys];
-    EXPECT_FALSE(wrong_snap_ref.value());
+    blobs_collection_t main = db.main();
+    std::string const value(1000, 'v');
+    status_t status;
+    std::size_t written = 0;
+    for (; written != 100 && status; ++written)
+        status = main[ustore_key_t(written)].assign(value.c_str());
+    EXPECT_FALSE(status);
+    EXPECT_STREQ(status.message(), "Memory limit exceeded");
+    EXPECT_GT(written, 1u);
+    EXPECT_LT(written, 100u);
+    EXPECT_LE(control(db, "usage")["used_bytes"].get<std::size_t>(), 65536u);
+
+    for (std::size_t i = 0; i + 1 != written; ++i)
+        EXPECT_EQ(*main[ustore_key_t(i)].value(), value.c_str());
+    EXPECT_FALSE(*main[ustore_key_t(written - 1)].present());
+    EXPECT_TRUE(db.clear());
+}
 
-    snap.set_snapshot(snapshot);
-    auto right_snap_ref = snap[triplet.keys];
-    EXPECT_TRUE(right_snap_ref.value());
+/**
+ * Fills a cold collection, and then writes more into a hot one, than both can hold together.
+ * With the "evict" policy the cold collection is moved to disk, to make room, and must read back intact.
+ */
+TEST(db, memory_policy_evict) {
+    if (!path())
+        return;
 
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config_with_memory_policy("evict").c_str()));
+
+    blobs_collection_t cold = *db.create("cold");
+    std::string const cold_value(1000, 'c');
+    for (ustore_key_t key = 0; key != 40; ++key)
+        EXPECT_TRUE(cold[key].assign(cold_value.c_str()));
+    std::size_t const cold_bytes = control(db, "usage")["used_bytes"].get<std::size_t>();
+    EXPECT_GT(cold_bytes, 40'000u);
+
+    blobs_collection_t hot = db.main();
+    std::string const hot_value(1000, 'h');
+    for (ustore_key_t key = 0; key != 30; ++key)
+        EXPECT_TRUE(hot[key].assign(hot_value.c_str()));
+    std::size_t const hot_bytes = control(db, "usage")["used_bytes"].get<std::size_t>();
+    EXPECT_LE(hot_bytes, 65536u);
+    EXPECT_LT(hot_bytes, cold_bytes);
+
+    for (ustore_key_t key = 0; key != 40; ++key)
+        EXPECT_EQ(*cold[key].value(), cold_value.c_str());
+    for (ustore_key_t key = 0; key != 30; ++key)
+        EXPECT_EQ(*hot[key].value(), hot_value.c_str());
+    EXPECT_EQ(cold.keys().size(), 40u);
     EXPECT_TRUE(db.clear());
 }
 
+static std::string config_with_sealed_files() {
+    return fmt::format(R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"sealed_files": true}}}}}})",
+                       path());
+}
+
 /**
- * Creates news collection under unique names.
- * Fill data in collection. Checking/dropping/checking collection data by thread.
+ * Persists collections as sealed files and reopens them, expecting reads, scans and measurements
+ * to be served from the mappings. Then reads one through a transaction and updates another,
+ * expecting only those to be moved into memory, and the update to survive the next reopen.
  */
-TEST(db, snapshot_with_threads) {
-    if (!ustore_supports_snapshots_k)
+TEST(db, sealed_collections) {
+    if (!path())
         return;
 
     clear_environment();
-
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.open(config_with_sealed_files().c_str()));
 
-    triplet_t triplet;
-    triplet_t triplet_same_v;
-    triplet_same_v.vals = {'D', 'D', 'D'};
+    std::size_t const keys_count = 10'000;
+    std::vector<ustore_key_t> keys(keys_count);
+    std::vector<std::string> values(keys_count);
+    std::vector<value_view_t> values_views(keys_count);
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        keys[i] = static_cast<ustore_key_t>(i * 2);
+        values[i] = i % 10 ? fmt::format("value{}", i) : std::string();
+        values_views[i] = value_view_t {values[i].data(), values[i].size()};
+    }
+    EXPECT_TRUE(db.main()[keys].assign(values_views));
+    blobs_collection_t named = *db.create("named");
+    for (ustore_key_t key = 0; key != 100; ++key)
+        named[key] = fmt::format("named{}", key).c_str();
+    EXPECT_TRUE(db.create("empty"));
+    db.close();
 
-    blobs_collection_t collection = db.main();
-    auto ref = collection[triplet.keys];
-    round_trip(ref, triplet);
+    for (auto const& entry : std::filesystem::directory_iterator {path()})
+        EXPECT_NE(entry.path().extension(), ".parquet");
+    EXPECT_TRUE(std::filesystem::exists(std::filesystem::path(path()) / "named.sealed"));
 
-    auto snap = *db.snapshot();
-    auto snap_ref = snap[triplet.keys];
+    EXPECT_TRUE(db.open(config_with_sealed_files().c_str()));
+    std::size_t const sealed_bytes = control(db, "usage")["sealed_bytes"].get<std::size_t>();
+    EXPECT_GT(sealed_bytes, keys_count * sizeof(ustore_key_t));
 
-    round_trip(ref, triplet_same_v);
+    blobs_collection_t main = db.main();
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        EXPECT_TRUE(*main[keys[i]].present());
+        EXPECT_EQ(*main[keys[i]].value(), values_views[i]);
+        EXPECT_FALSE(*main[keys[i] + 1].present());
+    }
+    EXPECT_EQ(main.keys().size(), keys_count);
+    EXPECT_EQ(main.keys(1000, 2000).size(), 500u);
+    EXPECT_EQ(main.members(1000, 2000).size_estimates()->cardinality.max, 500u);
+    EXPECT_EQ((*db["empty"]).keys().size(), 0u);
+    EXPECT_EQ(control(db, "usage")["sealed_bytes"].get<std::size_t>(), sealed_bytes);
+
+    // Transactions only track the in-memory sets, so the collection is moved there
+    named = *db["named"];
+    {
+        transaction_t txn = *db.transact();
+        blobs_collection_t txn_named = *txn["named"];
+        EXPECT_EQ(*txn_named[42].value(), "named42");
+    }
+    EXPECT_LT(control(db, "usage")["sealed_bytes"].get<std::size_t>(), sealed_bytes);
+    EXPECT_EQ(named.keys().size(), 100u);
 
-    std::shared_mutex mutex;
-    bool is_deleted = false;
+    EXPECT_TRUE(main[keys[1]].assign("updated"));
+    EXPECT_TRUE(main[1].assign("inserted"));
+    EXPECT_EQ(*main[keys[1]].value(), "updated");
+    EXPECT_EQ(main.keys().size(), keys_count + 1);
+    db.close();
+
+    EXPECT_TRUE(db.open(config_with_sealed_files().c_str()));
+    main = db.main();
+    EXPECT_EQ(main.keys().size(), keys_count + 1);
+    EXPECT_EQ(*main[keys[1]].value(), "updated");
+    EXPECT_EQ(*main[1].value(), "inserted");
+    EXPECT_EQ(*main[keys[2]].value(), values_views[2]);
+    named = *db["named"];
+    EXPECT_EQ(*named[99].value(), "named99");
+    EXPECT_TRUE(db.clear());
+}
+
+static std::string config_with_partitions(std::size_t partitions) {
+    return fmt::format(R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"partitions": {}}}}}}})",
+                       path(),
+                       partitions);
+}
+
+/**
+ * Writes a batch, where every key repeats with different values, into a partitioned
+ * engine, and checks that the regrouping by partitions keeps the last value of every key.
+ */
+TEST(db, partitions_duplicate_keys) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config_with_partitions(4).c_str()));
+
+    std::size_t const unique_count = 64;
+    std::size_t const repeats = 4;
+    std::vector<ustore_key_t> keys(unique_count * repeats);
+    std::vector<std::uint64_t> values(keys.size());
+    std::vector<value_view_t> values_views(keys.size());
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        keys[i] = static_cast<ustore_key_t>(i % unique_count);
+        values[i] = i;
+        values_views[i] = value_view_t {reinterpret_cast<byte_t const*>(&values[i]), sizeof(std::uint64_t)};
+    }
+
+    blobs_collection_t main = db.main();
+    EXPECT_TRUE(main[keys].assign(values_views));
+    for (std::size_t i = 0; i != unique_count; ++i) {
+        std::uint64_t expected = (repeats - 1) * unique_count + i;
+        value_view_t expected_view {reinterpret_cast<byte_t const*>(&expected), sizeof(expected)};
+        EXPECT_EQ(*main[static_cast<ustore_key_t>(i)].value(), expected_view);
+    }
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Overwrites a group of keys, spread across all the partitions, with the same value, both in
+ * transactions and in plain batches, while other threads read the group with batch reads.
+ * Checks that readers never observe a half-applied write.
+ */
+TEST(db, partitions_atomic_commits) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config_with_partitions(8).c_str()));
+
+    std::vector<ustore_key_t> keys(32);
+    std::iota(keys.begin(), keys.end(), 0);
+    blobs_collection_t main = db.main();
+    value_view_t initial {"0000"};
+    EXPECT_TRUE(main[keys].assign(initial));
+
+    std::atomic<bool> stop = false;
+    std::atomic<std::size_t> torn_reads = 0;
+    auto task_transact = [&](char symbol) {
+        std::string value(4, symbol);
+        value_view_t value_view {value};
+        std::vector<ustore_key_t> txn_keys = keys;
+        for (std::size_t i = 0; i != 200; ++i) {
+            transaction_t txn = *db.transact();
+            EXPECT_TRUE(txn[txn_keys].assign(value_view));
+            txn.commit(); // Conflicts with other writers are expected
+        }
+    };
+    auto task_batch = [&](char symbol) {
+        std::string value(4, symbol);
+        value_view_t value_view {value};
+        std::vector<ustore_key_t> batch_keys = keys;
+        blobs_collection_t collection = db.main();
+        for (std::size_t i = 0; i != 200; ++i)
+            EXPECT_TRUE(collection[batch_keys].assign(value_view));
+    };
     auto task_read = [&]() {
-        while (true) {
-            std::shared_lock _ {mutex};
-            if (is_deleted) {
-                auto ref = snap[triplet.keys];
-                check_equalities(ref, triplet_same_v);
-                break;
-            }
-            check_equalities(snap_ref, triplet);
+        std::vector<ustore_key_t> read_keys = keys;
+        blobs_collection_t collection = db.main();
+        while (!stop) {
+            auto maybe_values = collection[read_keys].value();
+            EXPECT_TRUE(maybe_values);
+            auto values = *maybe_values;
+            value_view_t first = *values.begin();
+            for (value_view_t value : values)
+                torn_reads += value != first;
         }
     };
 
-    auto task_reset = [&]() {
-        std::unique_lock _ {mutex};
-        snap.set_snapshot(0);
-        is_deleted = true;
+    std::thread reader1(task_read);
+    std::thread reader2(task_read);
+    std::thread writer1(task_transact, 'a');
+    std::thread writer2(task_transact, 'b');
+    std::thread writer3(task_batch, 'c');
+    writer1.join();
+    writer2.join();
+    writer3.join();
+    stop = true;
+    reader1.join();
+    reader2.join();
+
+    EXPECT_EQ(torn_reads.load(), 0u);
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Removes most of the values, leaving the slabs sparsely occupied,
+ * and checks that the compaction relocates the remaining ones intact.
+ */
+TEST(db, compaction) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    ustore_key_t const keys_count = 20'000;
+    auto value_of = [](ustore_key_t key) {
+        return fmt::format("{:0>100}", key);
     };
+    blobs_collection_t main = db.main();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        main[key] = value_of(key).c_str();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        if (key % 10)
+            EXPECT_TRUE(main[key].erase());
 
-    std::thread t1(task_read);
-    std::thread t2(task_reset);
-    t1.join();
-    t2.join();
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t response = nullptr;
+    ustore_database_control_t control {};
+    control.db = db;
+    control.error = status.member_ptr();
+    control.arena = arena.member_ptr();
+    control.request = "compact";
+    control.response = &response;
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
 
+    control.request = "compaction";
+    ustore_database_control(&control);
+    EXPECT_TRUE(status);
+    auto progress = nlohmann::json::parse(response);
+    EXPECT_FALSE(progress["running"].get<bool>());
+    EXPECT_GE(progress["passes"].get<std::size_t>(), 1u);
+    EXPECT_GE(progress["relocated_values"].get<std::size_t>(), 1u);
+
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        if (key % 10)
+            EXPECT_FALSE(*main[key].present());
+        else
+            EXPECT_EQ(*main[key].value(), value_of(key).c_str());
     EXPECT_TRUE(db.clear());
 }
+/**
+ * Copies the files of an open database, as if its process crashed before the
+ * checkpoint on close, and returns the directory of the copy.
+ */
+static std::string crashed_copy() {
+    namespace stdfs = std::filesystem;
+    std::string directory = path();
+    while (directory.size() > 1 && directory.back() == '/')
+        directory.pop_back();
+    std::string copy = directory + ".crashed";
+    stdfs::remove_all(copy);
+    stdfs::copy(directory, copy, stdfs::copy_options::recursive);
+    return copy;
+}
 
-TEST(db, transaction_erase_missing) {
-    if (!ustore_supports_transactions_k)
+static std::string config_in(std::string const& directory) {
+    return fmt::format(R"({{"version": "1.0", "directory": "{}"}})", directory);
+}
+
+/**
+ * Finds the segment of the write-ahead log, that was written last.
+ */
+static std::filesystem::path last_log_segment(std::string const& directory) {
+    std::filesystem::path last;
+    std::size_t last_number = 0;
+    for (auto const& entry : std::filesystem::directory_iterator {directory}) {
+        std::string name = entry.path().filename();
+        if (name.rfind("journal.", 0) != 0 || entry.path().extension() != ".wal")
+            continue;
+        std::size_t number = std::stoull(name.substr(std::strlen("journal.")));
+        if (last.empty() || number > last_number)
+            last = entry.path(), last_number = number;
+    }
+    return last;
+}
+
+/**
+ * Writes to the main and a named collection, and reopens a copy of the database,
+ * taken before the close, so that the updates can only be restored from the log.
+ */
+TEST(db, wal_replay_writes) {
+    if (!path())
         return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn1 = *db.transact();
-    transaction_t txn2 = *db.transact();
-
-    EXPECT_TRUE(txn2.main().at(-7297309151944849401).erase());
-    EXPECT_TRUE(txn1.main().at(-8640850744835793378).erase());
-    EXPECT_TRUE(txn1.commit());
-    EXPECT_TRUE(txn2.commit());
+    blobs_collection_t main = db.main();
+    blobs_collection_t named = *db.create("named");
+    for (ustore_key_t key = 0; key != 100; ++key)
+        main[key] = "value";
+    main[100] = "rewritten";
+    main[100] = "final";
+    EXPECT_TRUE(main[0].erase());
+    EXPECT_TRUE(named[1].assign("named", true));
+    std::string copy = crashed_copy();
+    EXPECT_TRUE(db.clear());
+    db.close();
 
-    EXPECT_EQ(db.main().at(-8640850744835793378).value(), value_view_t {});
-    EXPECT_EQ(db.main().at(-7297309151944849401).value(), value_view_t {});
-    EXPECT_EQ(db.main().keys().size(), 0u);
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    main = db.main();
+    EXPECT_FALSE(*main[0].present());
+    for (ustore_key_t key = 1; key != 100; ++key)
+        EXPECT_EQ(*main[key].value(), "value");
+    EXPECT_EQ(*main[100].value(), "final");
+    EXPECT_TRUE(*db.contains("named"));
+    named = *db["named"];
+    EXPECT_EQ(*named[1].value(), "named");
+    EXPECT_TRUE(db.clear());
+    db.close();
+    std::filesystem::remove_all(copy);
 }
 
-TEST(db, transaction_write_conflicting) {
-    if (!ustore_supports_transactions_k)
+/**
+ * Writes to a collection with native string keys, and reopens both a copy of the database,
+ * taken before the close, and the database itself. Both must restore the latest values.
+ */
+TEST(db, wal_replay_string_keys) {
+    if (!path())
         return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    EXPECT_TRUE(db.transact());
-    transaction_t txn1 = *db.transact();
-    transaction_t txn2 = *db.transact();
+    ustore_collection_t collection = *db.create("strings", R"({"keys": "strings"})");
 
-    EXPECT_TRUE(txn2.main().at(6).assign("a"));
-    EXPECT_TRUE(txn1.main().at(6).assign("b"));
-    EXPECT_TRUE(txn1.commit());
-    EXPECT_FALSE(txn2.commit());
+    char const* keys[] {"Netflix", "Apple", "Nvidia"};
+    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
+    auto write = [&](char const** vals) {
+        arena_t arena(db);
+        status_t status;
+        ustore_paths_write_t paths_write {};
+        paths_write.db = db;
+        paths_write.error = status.member_ptr();
+        paths_write.arena = arena.member_ptr();
+        paths_write.tasks_count = keys_count;
+        paths_write.collections = &collection;
+        paths_write.paths = keys;
+        paths_write.paths_stride = sizeof(char const*);
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
+        paths_write.values_bytes_stride = sizeof(char const*);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+    };
+    auto read = [&]() {
+        arena_t arena(db);
+        status_t status;
+        char* vals_recovered {};
+        ustore_paths_read_t paths_read {};
+        paths_read.db = db;
+        paths_read.error = status.member_ptr();
+        paths_read.arena = arena.member_ptr();
+        paths_read.tasks_count = keys_count;
+        paths_read.collections = &collection;
+        paths_read.paths = keys;
+        paths_read.paths_stride = sizeof(char const*);
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        return std::string(vals_recovered, keys_count * 2);
+    };
+
+    char const* vals[] {"N", "A", "V"};
+    char const* rewritten[] {"N", "B", "W"};
+    write(vals);
+    write(rewritten);
+    std::string copy = crashed_copy();
+    db.close();
+
+    for (std::string const& config : {config_in(copy), config()}) {
+        EXPECT_TRUE(db.open(config.c_str()));
+        collection = *db["strings"];
+        EXPECT_EQ(read(), std::string("N\0B\0W\0", keys_count * 2));
+        EXPECT_TRUE(db.clear());
+        db.close();
+    }
+    std::filesystem::remove_all(copy);
 }
 
 /**
- *
+ * Commits one transaction and leaves another one pending, checking that only
+ * the committed one is restored from the log of a copy, taken before the close.
  */
-TEST(db, transaction_sequenced_commit) {
-    if (!ustore_supports_transactions_k)
+TEST(db, wal_replay_transactions) {
+    if (!path())
         return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
+    main[1] = "before";
 
-    EXPECT_TRUE(db.transact());
-    transaction_t txn = *db.transact();
+    std::string copy;
+    {
+        transaction_t committed = db.transact().throw_or_release();
+        blobs_collection_t committed_main = committed.main();
+        committed_main[1] = "committed";
+        committed_main[2] = "committed";
+        transaction_t pending = db.transact().throw_or_release();
+        blobs_collection_t pending_main = pending.main();
+        pending_main[3] = "pending";
+        EXPECT_TRUE(committed.commit(true));
+        copy = crashed_copy();
+    }
+    EXPECT_TRUE(db.clear());
+    db.close();
 
-    triplet_t triplet;
-    auto txn_ref = txn[triplet.keys];
-
-    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
-    auto maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    auto current_sequence_number = *maybe_sequence_number;
-    EXPECT_GT(current_sequence_number, 0);
-    EXPECT_TRUE(txn.reset());
-#if 0
-    auto previous_sequence_number = current_sequence_number;
-    EXPECT_TRUE(txn_ref.value());
-    maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    current_sequence_number = *maybe_sequence_number;
-    EXPECT_EQ(current_sequence_number, previous_sequence_number);
-    EXPECT_TRUE(txn.reset());
-
-    previous_sequence_number = current_sequence_number;
-    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
-    maybe_sequence_number = txn.sequenced_commit();
-    EXPECT_TRUE(maybe_sequence_number);
-    current_sequence_number = *maybe_sequence_number;
-    EXPECT_GT(current_sequence_number, previous_sequence_number);
-#endif
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    main = db.main();
+    EXPECT_EQ(*main[1].value(), "committed");
+    EXPECT_EQ(*main[2].value(), "committed");
+    EXPECT_FALSE(*main[3].present());
+    EXPECT_TRUE(db.clear());
+    db.close();
+    std::filesystem::remove_all(copy);
 }
 
-#pragma region Paths Modality
-
 /**
- * Tests "Paths" Modality, with variable length keys.
- * Reads, writes, prefix matching and pattern matching.
+ * Commits flushed transactions from many threads at once, so that they are grouped,
+ * each writing its own keys and incrementing a shared counter. Checks that conflicts
+ * between the members of a group are detected, so no increment is lost, and that
+ * the log of a copy, taken before the close, restores every commit.
  */
-TEST(db, paths) {
+TEST(db, wal_replay_grouped_commits) {
+    if (!path())
+        return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    db.main()[0] = "0";
+
+    std::size_t const threads_count = 8;
+    std::size_t const commits_per_thread = 50;
+    std::atomic<std::size_t> increments = 0;
+    auto task = [&](std::size_t thread_idx) {
+        for (std::size_t i = 0; i != commits_per_thread; ++i) {
+            ustore_key_t key = static_cast<ustore_key_t>(1 + thread_idx * commits_per_thread + i);
+            transaction_t txn = *db.transact();
+            blobs_collection_t txn_main = txn.main();
+            EXPECT_TRUE(txn_main[key].assign("private"));
+            EXPECT_TRUE(txn.commit(true));
+
+            // Conflicting increments are retried, until they succeed
+            while (true) {
+                transaction_t counter_txn = *db.transact();
+                blobs_collection_t counter_main = counter_txn.main();
+                value_view_t counter = *counter_main[0].value();
+                std::string next = std::to_string(std::stoull(std::string(counter.c_str(), counter.size())) + 1);
+                EXPECT_TRUE(counter_main[0].assign(next.c_str()));
+                if (counter_txn.commit(true))
+                    break;
+            }
+            ++increments;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back(task, thread_idx);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::size_t const keys_count = threads_count * commits_per_thread;
+    std::string const expected_counter = std::to_string(increments.load());
+    EXPECT_EQ(increments.load(), keys_count);
+    EXPECT_EQ(*db.main()[0].value(), expected_counter.c_str());
+    std::string copy = crashed_copy();
+    EXPECT_TRUE(db.clear());
+    db.close();
 
-    char const* keys[] {"Facebook", "Apple", "Amazon", "Netflix", "Google", "Nvidia", "Adobe"};
-    char const* vals[] {"F", "A", "A", "N", "G", "N", "A"};
-    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
-    ustore_char_t separator = '\0';
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    blobs_collection_t main = db.main();
+    EXPECT_EQ(*main[0].value(), expected_counter.c_str());
+    for (ustore_key_t key = 1; key <= static_cast<ustore_key_t>(keys_count); ++key)
+        EXPECT_EQ(*main[key].value(), "private");
+    EXPECT_TRUE(db.clear());
+    db.close();
+    std::filesystem::remove_all(copy);
+}
 
-    arena_t arena(db);
-    status_t status {};
-    ustore_paths_write_t paths_write {};
-    paths_write.db = db;
-    paths_write.error = status.member_ptr();
-    paths_write.arena = arena.member_ptr();
-    paths_write.tasks_count = keys_count;
-    paths_write.path_separator = separator;
-    paths_write.paths = keys;
-    paths_write.paths_stride = sizeof(char const*);
-    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
-    paths_write.values_bytes_stride = sizeof(char const*);
+/**
+ * Logs three separate writes and returns a copy of the database, taken before the close,
+ * so that the last of them is the last record of the last log segment.
+ */
+static std::string crashed_after_three_writes() {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t main = db.main();
+    EXPECT_TRUE(main[1].assign("one", true));
+    EXPECT_TRUE(main[2].assign("two", true));
+    EXPECT_TRUE(main[3].assign("three", true));
+    std::string copy = crashed_copy();
+    EXPECT_TRUE(db.clear());
+    return copy;
+}
 
-    ustore_paths_write(&paths_write);
-    char* vals_recovered {};
-    ustore_paths_read_t paths_read {};
-    paths_read.db = db;
-    paths_read.error = status.member_ptr();
-    paths_read.arena = arena.member_ptr();
-    paths_read.tasks_count = keys_count;
-    paths_read.path_separator = separator;
-    paths_read.paths = keys;
-    paths_read.paths_stride = sizeof(char const*);
-    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+/**
+ * Cuts the last record of the log short, as if the crash interrupted its write,
+ * checking that replay keeps the preceding records and that the log stays usable.
+ */
+TEST(db, wal_replay_truncated_record) {
+    if (!path())
+        return;
 
-    ustore_paths_read(&paths_read);
-    EXPECT_TRUE(status);
-    EXPECT_EQ(std::string_view(vals_recovered, keys_count * 2),
-              std::string_view("F\0A\0A\0N\0G\0N\0A\0", keys_count * 2));
+    std::string copy = crashed_after_three_writes();
+    std::filesystem::path segment = last_log_segment(copy);
+    ASSERT_FALSE(segment.empty());
+    std::filesystem::resize_file(segment, std::filesystem::file_size(segment) - 2);
 
-    // Try getting either "Netflix" or "Nvidia" as one of the keys with "N" prefix
-    ustore_str_view_t prefix = "N";
-    ustore_length_t max_count = 1;
-    ustore_length_t* results_counts {};
-    ustore_length_t* tape_offsets {};
-    ustore_char_t* tape_begin {};
-    ustore_paths_match_t paths_match {};
-    paths_match.db = db;
-    paths_match.error = status.member_ptr();
-    paths_match.arena = arena.member_ptr();
-    paths_match.tasks_count = 1;
-    paths_match.match_counts_limits = &max_count;
-    paths_match.patterns = &prefix;
-    paths_match.match_counts = &results_counts;
-    paths_match.paths_offsets = &tape_offsets;
-    paths_match.paths_strings = &tape_begin;
+    database_t db;
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    blobs_collection_t main = db.main();
+    EXPECT_EQ(*main[1].value(), "one");
+    EXPECT_EQ(*main[2].value(), "two");
+    EXPECT_FALSE(*main[3].present());
 
-    ustore_paths_match(&paths_match);
-    auto first_match_for_a = std::string_view(tape_begin);
-    EXPECT_EQ(results_counts[0], 1);
-    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Nvidia");
+    // New records must not be appended after the torn one
+    EXPECT_TRUE(main[4].assign("four", true));
+    db.close();
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    main = db.main();
+    EXPECT_EQ(*main[2].value(), "two");
+    EXPECT_FALSE(*main[3].present());
+    EXPECT_EQ(*main[4].value(), "four");
+    EXPECT_TRUE(db.clear());
+    db.close();
+    std::filesystem::remove_all(copy);
+}
 
-    // Try getting the remaining results, which is the other one from that same pair
-    max_count = 10;
-    paths_match.previous = &tape_begin;
-    paths_match.options = ustore_option_dont_discard_memory_k;
-    ustore_paths_match(&paths_match);
-    auto second_match_for_a = std::string_view(tape_begin);
-    EXPECT_EQ(results_counts[0], 1);
-    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Nvidia");
-    EXPECT_NE(first_match_for_a, second_match_for_a);
+/**
+ * Corrupts the payload of the last record of the log, checking that replay
+ * detects the mismatching checksum, and drops only that record.
+ */
+TEST(db, wal_replay_bad_checksum) {
+    if (!path())
+        return;
 
-    // Try performing parallel queries in the same collection
-    ustore_str_view_t prefixes[2] = {"A", "N"};
-    std::size_t prefixes_count = sizeof(prefixes) / sizeof(prefixes[0]);
-    max_count = 10;
-    paths_match.tasks_count = prefixes_count;
-    paths_match.patterns = prefixes;
-    paths_match.patterns_stride = sizeof(ustore_str_view_t);
-    paths_match.previous = nullptr;
-    ustore_paths_match(&paths_match);
-    auto total_count = std::accumulate(results_counts, results_counts + prefixes_count, 0ul);
-    strings_tape_iterator_t tape_iterator {total_count, tape_begin};
-    std::set<std::string> tape_parts;
-    while (!tape_iterator.is_end()) {
-        tape_parts.insert(*tape_iterator);
-        ++tape_iterator;
+    std::string copy = crashed_after_three_writes();
+    std::filesystem::path segment = last_log_segment(copy);
+    ASSERT_FALSE(segment.empty());
+    {
+        std::fstream file(segment, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(-1, std::ios::end);
+        char last = static_cast<char>(file.get());
+        file.seekp(-1, std::ios::end);
+        file.put(static_cast<char>(last ^ 0x5A));
     }
-    EXPECT_EQ(results_counts[0], 3);
-    EXPECT_EQ(results_counts[1], 2);
-    EXPECT_NE(tape_parts.find("Netflix"), tape_parts.end());
-    EXPECT_NE(tape_parts.find("Adobe"), tape_parts.end());
 
-    // Now try matching a Regular Expression
-    prefix = "Netflix|Google";
-    paths_match.tasks_count = 1;
-    paths_match.patterns = &prefix;
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 2);
-    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Google");
-    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Google");
+    database_t db;
+    EXPECT_TRUE(db.open(config_in(copy).c_str()));
+    blobs_collection_t main = db.main();
+    EXPECT_EQ(*main[1].value(), "one");
+    EXPECT_EQ(*main[2].value(), "two");
+    EXPECT_FALSE(*main[3].present());
+    EXPECT_TRUE(db.clear());
+    db.close();
+    std::filesystem::remove_all(copy);
+}
+#endif
 
-    // Try a more complex regular expression
-    prefix = "A.*e";
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 2);
-    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe");
-    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe");
+#if defined(USTORE_ENGINE_IS_TIERED)
+/**
+ * Overflows a tiny hot tier with both write policies, so that most keys
+ * are demoted, and checks that none of the values is lost, even after reopening.
+ */
+TEST(db, tiered_demotion) {
+    if (!path())
+        return;
 
-    // Existing single letter prefix
-    prefix = "A";
-    ustore_paths_match(&paths_match);
-    first_match_for_a = std::string_view(tape_begin);
-    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
-    EXPECT_EQ(results_counts[0], 3);
-    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe" || first_match_for_a == "Amazon");
-    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe" || second_match_for_a == "Amazon");
+    ustore_key_t const keys_count = 10'000;
+    auto value_of = [](ustore_key_t key) {
+        return fmt::format("{:0>100}", key);
+    };
 
-    // Missing single letter prefix
-    prefix = "X";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    for (char const* policy : {"through", "back"}) {
+        clear_environment();
+        std::string tiered_config = fmt::format( //
+            R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"memory_limit": "64KB", "write_policy": "{}"}}}}}})",
+            path(),
+            policy);
+
+        database_t db;
+        EXPECT_TRUE(db.open(tiered_config.c_str()));
+        blobs_collection_t main = db.main();
+        for (ustore_key_t key = 0; key != keys_count; ++key)
+            main[key] = value_of(key).c_str();
+        for (ustore_key_t key = 0; key != keys_count; ++key)
+            EXPECT_EQ(*main[key].value(), value_of(key).c_str());
+
+        // Rewritten values must not be shadowed by their demoted versions
+        main[0] = "rewritten";
+        EXPECT_EQ(*main[0].value(), "rewritten");
+        db.close();
+
+        EXPECT_TRUE(db.open(tiered_config.c_str()));
+        main = db.main();
+        EXPECT_EQ(*main[0].value(), "rewritten");
+        for (ustore_key_t key = 1; key != keys_count; ++key)
+            EXPECT_EQ(*main[key].value(), value_of(key).c_str());
+        EXPECT_TRUE(db.clear());
+    }
+}
+#endif
 
-    // Missing pattern
-    prefix = "X.*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+/**
+ * Read a batch of keys in descending order, with repetitions and missing entries,
+ * checking that the values are exported in the requested order.
+ */
+TEST(db, unordered_batch_read) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    auto main = db.main();
 
-    // Try a more complex regular expression
-    prefix = "oo:18:\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    for (ustore_key_t k = 0; k != 1000; k += 2)
+        main[k] = std::to_string(k).c_str();
 
-    // Try an even more complex regular expression
-    prefix = "oo:18:\\\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    std::vector<ustore_key_t> keys;
+    for (ustore_key_t k = 1100; k >= 0; k -= 3)
+        keys.push_back(k);
+    keys.insert(keys.begin() + 10, {42, 42, 43, 42});
 
-    EXPECT_TRUE(db.clear());
+    auto maybe_retrieved = main[keys].value();
+    EXPECT_TRUE(maybe_retrieved);
+    auto const& retrieved = *maybe_retrieved;
+    EXPECT_EQ(retrieved.size(), keys.size());
 
-    // Try an even more complex regular expression on empty DB
-    prefix = "oo:18:\\\\*";
-    ustore_paths_match(&paths_match);
-    EXPECT_EQ(results_counts[0], 0);
-    EXPECT_EQ(*paths_match.error, nullptr);
+    auto it = retrieved.begin();
+    for (std::size_t i = 0; i != keys.size(); ++i, ++it) {
+        value_view_t retrieved_view = *it;
+        if (keys[i] % 2 || keys[i] >= 1000)
+            EXPECT_FALSE(retrieved_view);
+        else
+            EXPECT_EQ(retrieved_view, value_view_t(std::to_string(keys[i])));
+    }
 }
 
 /**
- * Tests "Paths" Modality, by forming bidirectional linked lists from string-to-string mappings.
- * Uses different-length unique strings. As the underlying modality may be implemented as a bucketed hash-map,
- * this test helps catch problems in bucket reorganization.
+ * Reads the same unordered batch with `ustore_option_read_deduplicate_k`, checking that the
+ * repeated and missing keys are scattered back into their positions, with and without lengths.
  */
-TEST(db, paths_linked_list) {
-    constexpr std::size_t count = 1000;
+TEST(db, deduplicated_batch_read) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    auto main = db.main();
+
+    for (ustore_key_t k = 0; k != 100; k += 2)
+        main[k] = std::to_string(k).c_str();
+
+    std::vector<ustore_key_t> keys;
+    for (ustore_key_t k = 110; k >= 0; k -= 3)
+        keys.push_back(k);
+    keys.insert(keys.begin() + 10, {42, 42, 43, 42});
 
     arena_t arena(db);
-    ustore_char_t separator = '\0';
     status_t status;
+    for (bool export_lengths : {false, true}) {
+        ustore_octet_t* found_presences = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.options = ustore_option_read_deduplicate_k;
+        read.tasks_count = keys.size();
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.presences = &found_presences;
+        read.lengths = export_lengths ? &found_lengths : nullptr;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
+        EXPECT_TRUE(status);
 
-    ustore_paths_write_t paths_write {};
-    paths_write.db = db;
-    paths_write.error = status.member_ptr();
-    paths_write.arena = arena.member_ptr();
-    paths_write.tasks_count = 1;
-    paths_write.path_separator = separator;
+        for (std::size_t i = 0; i != keys.size(); ++i) {
+            bool const expected = keys[i] % 2 == 0 && keys[i] < 100;
+            EXPECT_EQ(check_presence(found_presences, i), expected);
+            std::size_t length = export_lengths ? found_lengths[i] : found_offsets[i + 1] - found_offsets[i];
+            if (!expected) {
+                EXPECT_TRUE(!export_lengths || found_lengths[i] == ustore_length_missing_k);
+                continue;
+            }
+            std::string_view found {reinterpret_cast<char const*>(found_values) + found_offsets[i], length};
+            EXPECT_EQ(found, std::to_string(keys[i]));
+        }
+    }
+}
 
-    ustore_paths_read_t paths_read {};
-    paths_read.db = db;
-    paths_read.error = status.member_ptr();
-    paths_read.arena = arena.member_ptr();
-    paths_read.tasks_count = 1;
-    paths_read.path_separator = separator;
+/**
+ * Reads the same batch into shared memory and into a regular arena, expecting identical
+ * presences, lengths and contents. The shared arena is reused for several rounds, so the
+ * buffers of previous reads must be released without invalidating the current one.
+ */
+TEST(db, shared_memory_batch_read) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    auto main = db.main();
 
-    // Generate some random strings for our tests
-    constexpr auto alphabet = "abcdefghijklmnop";
-    auto make_random_str = []() {
-        auto str = std::string();
-        auto len = static_cast<std::size_t>(std::rand() % 100) + 8;
-        for (std::size_t i = 0; i != len; ++i)
-            str.push_back(alphabet[std::rand() % 16]);
-        return str;
+    for (ustore_key_t k = 0; k != 100; k += 2)
+        main[k] = std::to_string(k).c_str();
+    std::string const large_value(1024 * 1024, 'x');
+    main[1000] = large_value.c_str();
+
+    std::vector<ustore_key_t> keys;
+    for (ustore_key_t k = 110; k >= 0; k -= 3)
+        keys.push_back(k);
+    keys.push_back(1000);
+
+    auto read_into = [&](arena_t& arena, ustore_options_t options) {
+        status_t status;
+        ustore_octet_t* found_presences = nullptr;
+        ustore_length_t* found_lengths = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.options = options;
+        read.tasks_count = keys.size();
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.presences = &found_presences;
+        read.lengths = &found_lengths;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
+        EXPECT_TRUE(status);
+
+        std::vector<std::optional<std::string>> results(keys.size());
+        for (std::size_t i = 0; i != keys.size(); ++i) {
+            EXPECT_EQ(check_presence(found_presences, i), found_lengths[i] != ustore_length_missing_k);
+            if (found_lengths[i] != ustore_length_missing_k)
+                results[i].emplace(reinterpret_cast<char const*>(found_values) + found_offsets[i], found_lengths[i]);
+        }
+        return results;
     };
-    std::set<std::string> unique;
-    while (unique.size() != count)
-        unique.insert(make_random_str());
 
-    // Lets form a linked list, where every key maps into the the next key.
-    // Then we will traverse the linked list from start to end.
-    // Then we will re-link it in reverse order and traverse again.
-    std::vector<ustore_str_view_t> begins(unique.size());
-    std::transform(unique.begin(), unique.end(), begins.begin(), [](std::string const& str) { return str.c_str(); });
+    arena_t regular_arena(db);
+    auto expected = read_into(regular_arena, ustore_options_default_k);
+    EXPECT_EQ(expected.back(), large_value);
 
-    // Link forward
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        paths_write.paths = &smaller;
-        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&bigger);
-        ustore_paths_write(&paths_write);
-        EXPECT_TRUE(status);
+    arena_t shared_arena(db);
+    for (std::size_t round = 0; round != 3; ++round) {
+        auto found = read_into(shared_arena, ustore_option_read_shared_memory_k);
+        EXPECT_EQ(found, expected);
+    }
+    EXPECT_TRUE(db.clear());
+}
 
-        // Check if it was successfully written:
-        ustore_str_span_t bigger_received = nullptr;
-        paths_read.paths = &smaller;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+/**
+ * Submits batches of writes and reads through a completion queue, collecting the writes
+ * through futures and the reads through polling, while they execute on several threads.
+ * Requests of unknown kinds must be rejected on submission.
+ */
+TEST(db, async_requests) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    completion_queue_t queue;
+    EXPECT_TRUE(queue.open(db, 4));
+
+    std::size_t const batches_count = 64;
+    std::size_t const batch_size = 100;
+    std::vector<ustore_key_t> keys(batches_count * batch_size);
+    std::vector<std::string> values(keys.size());
+    std::vector<ustore_length_t> lengths(keys.size());
+    std::vector<ustore_bytes_cptr_t> contents(keys.size());
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        keys[i] = static_cast<ustore_key_t>(i);
+        values[i] = fmt::format("async{}", i);
+        lengths[i] = static_cast<ustore_length_t>(values[i].size());
+        contents[i] = reinterpret_cast<ustore_bytes_cptr_t>(values[i].data());
     }
 
-    // Traverse forward, counting the entries and checking the order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        ustore_str_span_t bigger_received = nullptr;
-        paths_read.paths = &smaller;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
-        ustore_paths_read(&paths_read);
+    std::vector<ustore_write_t> writes(batches_count);
+    std::vector<std::future<status_t>> written;
+    for (std::size_t batch_idx = 0; batch_idx != batches_count; ++batch_idx) {
+        std::size_t const offset = batch_idx * batch_size;
+        ustore_write_t& write = writes[batch_idx];
+        write.db = db;
+        write.tasks_count = batch_size;
+        write.keys = keys.data() + offset;
+        write.keys_stride = sizeof(ustore_key_t);
+        write.lengths = lengths.data() + offset;
+        write.lengths_stride = sizeof(ustore_length_t);
+        write.values = contents.data() + offset;
+        write.values_stride = sizeof(ustore_bytes_cptr_t);
+        written.push_back(queue.write(write));
+    }
+    for (auto& future : written)
+        EXPECT_TRUE(future.get());
+
+    // Every read gets its own arena, as they are executed concurrently
+    std::vector<arena_t> arenas;
+    arenas.reserve(batches_count);
+    std::vector<ustore_read_t> reads(batches_count);
+    std::vector<status_t> statuses(batches_count);
+    std::vector<ustore_length_t*> found_offsets(batches_count);
+    std::vector<ustore_length_t*> found_lengths(batches_count);
+    std::vector<ustore_bytes_ptr_t> found_values(batches_count);
+    for (std::size_t batch_idx = 0; batch_idx != batches_count; ++batch_idx) {
+        arenas.emplace_back(db);
+        ustore_read_t& read = reads[batch_idx];
+        read.db = db;
+        read.error = statuses[batch_idx].member_ptr();
+        read.arena = arenas.back().member_ptr();
+        read.tasks_count = batch_size;
+        read.keys = keys.data() + batch_idx * batch_size;
+        read.keys_stride = sizeof(ustore_key_t);
+        read.offsets = &found_offsets[batch_idx];
+        read.lengths = &found_lengths[batch_idx];
+        read.values = &found_values[batch_idx];
+
+        status_t status;
+        ustore_async_submit_t submit {};
+        submit.queue = queue;
+        submit.error = status.member_ptr();
+        submit.kind = ustore_async_read_k;
+        submit.request = &read;
+        submit.callback_payload = &read;
+        ustore_async_submit(&submit);
         EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
     }
 
-    // Re-link in reverse order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        paths_write.paths = &bigger;
-        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&smaller);
-        ustore_paths_write(&paths_write);
+    std::set<ustore_read_t*> completed;
+    std::vector<ustore_callback_payload_t> payloads(batches_count);
+    while (completed.size() != batches_count) {
+        status_t status;
+        ustore_size_t count = 0;
+        ustore_async_poll_t poll {};
+        poll.queue = queue;
+        poll.error = status.member_ptr();
+        poll.count_limit = batches_count;
+        poll.timeout_microseconds = 1'000'000;
+        poll.payloads = payloads.data();
+        poll.count = &count;
+        ustore_async_poll(&poll);
         EXPECT_TRUE(status);
+        EXPECT_NE(count, 0u);
+        if (!count)
+            break;
+        for (std::size_t i = 0; i != count; ++i)
+            EXPECT_TRUE(completed.insert(reinterpret_cast<ustore_read_t*>(payloads[i])).second);
+    }
 
-        // Check if it was successfully over-written:
-        ustore_str_span_t smaller_received = nullptr;
-        paths_read.paths = &bigger;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
-        ustore_paths_read(&paths_read);
-        EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    for (std::size_t batch_idx = 0; batch_idx != batches_count; ++batch_idx) {
+        EXPECT_TRUE(statuses[batch_idx]);
+        for (std::size_t i = 0; i != batch_size; ++i) {
+            std::size_t const key_idx = batch_idx * batch_size + i;
+            EXPECT_EQ(found_lengths[batch_idx][i], lengths[key_idx]);
+            std::string_view found {reinterpret_cast<char const*>(found_values[batch_idx]) +
+                                        found_offsets[batch_idx][i],
+                                    found_lengths[batch_idx][i]};
+            EXPECT_EQ(found, values[key_idx]);
+        }
     }
 
-    // Traverse backwards, counting the entries and checking the order
-    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
-        ustore_str_view_t smaller = begins[i];
-        ustore_str_view_t bigger = begins[i + 1];
-        ustore_str_span_t smaller_received = nullptr;
-        paths_read.paths = &bigger;
-        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
-        ustore_paths_read(&paths_read);
+    ustore_read_t unknown {};
+    EXPECT_FALSE(queue.submit(ustore_async_kind_t(100), unknown).get());
+    queue.close();
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Batches are dispatched to loops specialized for the layouts of their arguments.
+ * Writes the same entries with broadcast collections and keys strided within structs,
+ * reading them back with contiguous keys and with per-task collections.
+ */
+TEST(db, strided_batches) {
+    if (!ustore_supports_named_collections_k)
+        return;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t col = *db["col"];
+    ustore_collection_t col_handle = col;
+
+    struct entry_t {
+        ustore_key_t key;
+        ustore_bytes_cptr_t value;
+        ustore_length_t length;
+    };
+    constexpr std::size_t keys_count = 100;
+    std::vector<std::string> values(keys_count);
+    std::vector<entry_t> entries(keys_count);
+    for (std::size_t i = 0; i != keys_count; ++i) {
+        values[i] = std::to_string(i * 3);
+        entries[i] = {static_cast<ustore_key_t>(i * 3),
+                      reinterpret_cast<ustore_bytes_cptr_t>(values[i].data()),
+                      static_cast<ustore_length_t>(values[i].size())};
+    }
+
+    arena_t arena(db);
+    status_t status;
+    ustore_write_t write {};
+    write.db = db;
+    write.error = status.member_ptr();
+    write.arena = arena.member_ptr();
+    write.tasks_count = keys_count;
+    write.collections = &col_handle;
+    write.keys = &entries[0].key;
+    write.keys_stride = sizeof(entry_t);
+    write.values = &entries[0].value;
+    write.values_stride = sizeof(entry_t);
+    write.lengths = &entries[0].length;
+    write.lengths_stride = sizeof(entry_t);
+    ustore_write(&write);
+    EXPECT_TRUE(status);
+
+    std::vector<ustore_key_t> keys(keys_count);
+    std::vector<ustore_collection_t> collections(keys_count, col_handle);
+    for (std::size_t i = 0; i != keys_count; ++i)
+        keys[i] = static_cast<ustore_key_t>(i * 3);
+
+    for (bool per_task_collections : {false, true}) {
+        ustore_length_t* found_lengths = nullptr;
+        ustore_length_t* found_offsets = nullptr;
+        ustore_byte_t* found_values = nullptr;
+        ustore_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.tasks_count = keys_count;
+        read.collections = per_task_collections ? collections.data() : &col_handle;
+        read.collections_stride = per_task_collections ? sizeof(ustore_collection_t) : 0;
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.lengths = &found_lengths;
+        read.offsets = &found_offsets;
+        read.values = &found_values;
+        ustore_read(&read);
         EXPECT_TRUE(status);
-        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+
+        for (std::size_t i = 0; i != keys_count; ++i) {
+            std::string_view found {reinterpret_cast<char const*>(found_values) + found_offsets[i], found_lengths[i]};
+            EXPECT_EQ(found, values[i]);
+        }
     }
+
+    // The main collection stays empty
+    EXPECT_FALSE(*db.main()[keys[1]].present());
+    EXPECT_TRUE(db.clear());
 }
 
-#pragma region Documents Modality
+TEST(db, scan) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-std::vector<std::string> make_three_flat_docs() {
-    auto json1 = R"( {"person": "Alice", "age": 24} )"_json.dump();
-    auto json2 = R"( {"person": "Bob", "age": 25} )"_json.dump();
-    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
-    return {json1, json2, json3};
-}
+    constexpr std::size_t keys_size = 1000;
+    std::array<ustore_key_t, keys_size> keys;
+    std::iota(std::begin(keys), std::end(keys), 0);
+    auto ref = collection[keys];
+    value_view_t value("value");
+    EXPECT_TRUE(ref.assign(value));
+    keys_stream_t stream(db, collection, 256);
 
-std::vector<std::string> make_three_nested_docs() {
-    auto json1 = R"( {"person": {"name":"Alice", "age": 24}} )"_json.dump();
-    auto json2 = R"( {"person": [{"name":"Bob", "age": 25}]} )"_json.dump();
-    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
-    return {json1, json2, json3};
+    EXPECT_TRUE(stream.seek_to_first());
+    ustore_key_t key = 0;
+    while (!stream.is_end()) {
+        EXPECT_EQ(stream.key(), key++);
+        ++stream;
+    }
+    EXPECT_EQ(key, keys_size);
 }
 
 /**
- * Tests "Documents" Modality, mapping integers to structured hierarchical documents.
- * Takes a basic flat JSON document, and checks if it can be imported in JSON, BSON
- * and MessagePack forms, and later be properly accessed at field-level.
+ * Ordered batched scan over the main collection.
  */
-TEST(db, docs_flat) {
+TEST(db, batch_scan) {
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
+    blobs_collection_t collection = db.main();
 
-    // JSON
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto jsons = make_three_flat_docs();
-    collection[1] = jsons[0].c_str();
-    collection[2] = jsons[1].c_str();
-    collection[3] = jsons[2].c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), "\"Bob\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(3, "age")].value(), "26");
+    std::array<ustore_key_t, 512> keys;
+    std::iota(std::begin(keys), std::end(keys), 0);
+    auto ref = collection[keys];
+    value_view_t value("value");
+    EXPECT_TRUE(ref.assign(value));
+    keys_stream_t stream(db, collection, 256);
 
-    // Binary
-    auto maybe_person = collection[ckf(1, "person")].value(ustore_doc_field_str_k);
-    EXPECT_EQ(std::string_view(maybe_person->c_str(), maybe_person->size()), std::string_view("Alice"));
+    EXPECT_TRUE(stream.seek_to_first());
+    auto batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 256);
+    EXPECT_FALSE(stream.is_end());
+    for (ustore_key_t i = 0; i != 256; ++i)
+        EXPECT_EQ(batch[i], i);
 
-    // BSON
-    bson_error_t error;
-    bson_t* bson = bson_new_from_json((uint8_t*)jsons[0].c_str(), -1, &error);
-    uint8_t const* buffer = bson_get_data(bson);
-    auto view = value_view_t(buffer, bson->len);
-    collection.at(4, ustore_doc_field_bson_k) = view;
-    M_EXPECT_EQ_JSON(*collection[4].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(4, "person")].value(), "\"Alice\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(4, "age")].value(), "24");
-    bson_clear(&bson);
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 256);
+    EXPECT_FALSE(stream.is_end());
+    for (ustore_key_t i = 0; i != 256; ++i)
+        EXPECT_EQ(batch[i], i + 256);
 
-    // MsgPack
-    auto message_pack = *collection[1].value(ustore_doc_field_msgpack_k);
-    collection.at(5, ustore_doc_field_msgpack_k) = message_pack;
-    M_EXPECT_EQ_JSON(*collection[5].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[ckf(5, "person")].value(), "\"Alice\"");
-    M_EXPECT_EQ_JSON(*collection[ckf(5, "age")].value(), "24");
+    EXPECT_TRUE(stream.seek_to_next_batch());
+    batch = stream.keys_batch();
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_TRUE(stream.is_end());
 }
 
 /**
- * Tries adding 3 simple nested JSONs, using JSON-Pointers
- * to retrieve specific fields across multiple keys.
+ * Samples plain collections, with and without a TTL, expecting the requested number
+ * of distinct present keys from every one of them.
  */
-TEST(db, docs_nested_batch) {
+TEST(db, sample) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    std::vector<blobs_collection_t> collections {db.main()};
+    if (ustore_supports_named_collections_k)
+        collections.push_back(db.create("expiring", R"({"ttl": 3600})").throw_or_release());
+
+    std::vector<ustore_key_t> keys(1000);
+    std::iota(keys.begin(), keys.end(), 0);
+    for (blobs_collection_t& collection : collections) {
+        EXPECT_TRUE(collection[keys].assign(value_view_t("value")));
+
+        arena_t arena(db);
+        auto maybe_sample = collection.keys().sample(100, arena.member_ptr());
+        EXPECT_TRUE(maybe_sample);
+        std::set<ustore_key_t> sampled(maybe_sample->begin(), maybe_sample->end());
+        EXPECT_EQ(maybe_sample->size(), 100u);
+        EXPECT_EQ(sampled.size(), 100u);
+        for (ustore_key_t key : sampled)
+            EXPECT_TRUE(key >= 0 && key < 1000);
+    }
+    EXPECT_TRUE(db.clear());
+}
 
+/**
+ * Samples a collection smaller than the requested sample in HEAD, in a snapshot and in a transaction.
+ * Every present key must be exported exactly once, and the reported count must match it.
+ * Keys, sampled in a transaction, are watched and must fail the commit, if changed externally.
+ */
+TEST(db, sample_small) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
 
-    auto jsons = make_three_nested_docs();
-    std::string continuous_jsons = jsons[0] + jsons[1] + jsons[2];
-    auto vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
-    std::array<ustore_length_t, 4> offsets = {
-        0,
-        static_cast<ustore_length_t>(jsons[0].size()),
-        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size()),
-        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size() + jsons[2].size()),
+    std::vector<ustore_key_t> keys(10);
+    std::iota(keys.begin(), keys.end(), 0);
+    EXPECT_TRUE(db.main()[keys].assign(value_view_t("value")));
+
+    auto expect_all_keys = [&](blobs_collection_t collection) {
+        arena_t arena(db);
+        auto maybe_sample = collection.keys().sample(100, arena.member_ptr());
+        EXPECT_TRUE(maybe_sample);
+        std::set<ustore_key_t> sampled(maybe_sample->begin(), maybe_sample->end());
+        EXPECT_EQ(maybe_sample->size(), keys.size());
+        EXPECT_EQ(sampled, std::set<ustore_key_t>(keys.begin(), keys.end()));
     };
-    contents_arg_t values {};
-    values.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
-    values.contents_begin = {&vals_begin, 0};
+    expect_all_keys(db.main());
 
-    std::array<ustore_key_t, 3> keys = {1, 2, 3};
-    auto ref = collection[keys];
-    EXPECT_TRUE(ref.assign(values));
+    if (ustore_supports_snapshots_k) {
+        auto snap = *db.snapshot();
+        EXPECT_TRUE(db.main()[ustore_key_t(keys.size())].assign("after"));
+        expect_all_keys(snap.main());
+        EXPECT_TRUE(db.main()[ustore_key_t(keys.size())].erase());
+    }
 
-    // Read One By One
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-    M_EXPECT_EQ_JSON(*collection[2].value(), jsons[1]);
-    M_EXPECT_EQ_JSON(*collection[3].value(), jsons[2]);
+    if (ustore_supports_transactions_k) {
+        transaction_t txn = *db.transact();
+        expect_all_keys(txn.main());
+        EXPECT_TRUE(txn.main()[ustore_key_t(100)].assign("written"));
+#if defined(USTORE_ENGINE_IS_UCSET)
+        EXPECT_TRUE(db.main()[keys.front()].assign("changed"));
+        EXPECT_FALSE(txn.commit());
+#else
+        EXPECT_TRUE(txn.commit());
+#endif
+    }
+    EXPECT_TRUE(db.clear());
+}
 
-    auto expected = R"({"name":"Alice", "age": 24})"_json.dump();
-    M_EXPECT_EQ_JSON(*collection[ckf(1, "person")].value(), expected);
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_LEVELDB)
+static std::string config_with_key_encoding(char const* option) {
+#if defined(USTORE_ENGINE_IS_ROCKSDB)
+    return fmt::format(
+        R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"KeyEncoding": {{"{}": true}}}}}}}})",
+        path(),
+        option);
+#else
+    return fmt::format(R"({{"version": "1.0", "directory": "{}", "engine": {{"config": {{"{}_keys": true}}}}}})",
+                       path(),
+                       option);
+#endif
+}
 
-    expected = R"([{"name":"Bob", "age": 25}])"_json.dump();
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), expected);
-    M_EXPECT_EQ_JSON(*collection[ckf(2, "/person/0/name")].value(), "\"Bob\"");
+/**
+ * Writes negative and positive keys in a shuffled order with both the ordered and the legacy
+ * key encodings, expecting scans to export them in the numeric order, even after reopening.
+ * Then migrates the legacy database, expecting the same order and values after it.
+ */
+TEST(db, key_encodings) {
+    if (!path())
+        return;
 
-    // Read sorted keys
-    check_equalities(ref, values);
+    std::vector<ustore_key_t> const keys {
+        std::numeric_limits<ustore_key_t>::min() + 1,
+        -(ustore_key_t(1) << 40),
+        -257,
+        -256,
+        -255,
+        -2,
+        -1,
+        0,
+        1,
+        2,
+        255,
+        256,
+        257,
+        ustore_key_t(1) << 40,
+        std::numeric_limits<ustore_key_t>::max() - 1,
+    };
+    std::vector<ustore_key_t> shuffled_keys = keys;
+    std::shuffle(shuffled_keys.begin(), shuffled_keys.end(), std::mt19937(42));
+
+    auto expect_ordered = [&](database_t& db) {
+        blobs_collection_t main = db.main();
+        keys_stream_t stream(db, main, 4);
+        EXPECT_TRUE(stream.seek_to_first());
+        std::size_t count = 0;
+        for (; !stream.is_end() && count != keys.size(); ++stream, ++count)
+            EXPECT_EQ(stream.key(), keys[count]);
+        EXPECT_TRUE(stream.is_end());
+        EXPECT_EQ(count, keys.size());
+
+        EXPECT_TRUE(stream.seek(-256));
+        EXPECT_EQ(stream.key(), -256);
+        for (ustore_key_t key : keys)
+            EXPECT_EQ(*main[key].value(), std::to_string(key).c_str());
+    };
 
-    // Read not sorted keys
-    std::array<ustore_key_t, 3> not_sorted_keys = {1, 3, 2};
-    auto not_sorted_ref = collection[not_sorted_keys];
-    std::string not_sorted_jsons = jsons[0] + jsons[2] + jsons[1];
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(not_sorted_jsons.data());
-    offsets[2] = jsons[0].size() + jsons[2].size();
-    offsets[3] = jsons[0].size() + jsons[2].size() + jsons[1].size();
-    check_equalities(not_sorted_ref, values);
+    database_t db;
+    for (bool legacy : {false, true}) {
+        clear_environment();
+        EXPECT_TRUE(db.open((legacy ? config_with_key_encoding("legacy") : config()).c_str()));
+        blobs_collection_t main = db.main();
+        for (ustore_key_t key : shuffled_keys)
+            main[key] = std::to_string(key).c_str();
+        expect_ordered(db);
+        db.close();
+
+        // The encoding of an existing database is detected on open
+        EXPECT_TRUE(db.open(config().c_str()));
+        expect_ordered(db);
+        db.close();
+    }
 
-    // Read duplicate keys
-    std::array<ustore_key_t, 3> duplicate_keys = {1, 2, 1};
-    auto duplicate_ref = collection[duplicate_keys];
-    std::string duplicate_jsons = jsons[0] + jsons[1] + jsons[0];
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(duplicate_jsons.data());
-    offsets[2] = jsons[0].size() + jsons[1].size();
-    offsets[3] = jsons[0].size() + jsons[1].size() + jsons[0].size();
-    check_equalities(duplicate_ref, values);
-
-    // Read with fields
-    std::array<collection_key_field_t, 3> keys_with_fields = {
-        ckf(1, "person"),
-        ckf(2, "/person/0/name"),
-        ckf(3, "age"),
-    };
-    auto ref_with_fields = collection[keys_with_fields];
-    auto field_value1 = R"({"name":"Alice", "age": 24})"_json.dump();
-    auto field_value2 = R"("Bob")"_json.dump();
-    auto field_value3 = R"(26)"_json.dump();
-    std::string field_values = field_value1 + field_value2 + field_value3;
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(field_values.data());
-    offsets[1] = field_value1.size();
-    offsets[2] = field_value1.size() + field_value2.size();
-    offsets[3] = field_value1.size() + field_value2.size() + field_value3.size();
-    check_equalities(ref_with_fields, values);
+    // The legacy database is rewritten, and kept as a backup
+    EXPECT_TRUE(db.open(config_with_key_encoding("migrate").c_str()));
+    expect_ordered(db);
+    db.close();
 
-    // Check Invalid Json Write
-    std::string invalid_json = R"({"name":"Alice", } "age": 24})";
-    offsets[1] = jsons[0].size();
-    offsets[2] = jsons[0].size() + jsons[1].size();
-    offsets[3] = jsons[0].size() + jsons[1].size() + invalid_json.size();
-    continuous_jsons = jsons[0] + jsons[1] + invalid_json;
-    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
+    std::string backup = path();
+    while (backup.back() == '/')
+        backup.pop_back();
+    backup += ".legacy";
+    EXPECT_TRUE(std::filesystem::is_directory(backup));
+    std::filesystem::remove_all(backup);
 
-    EXPECT_FALSE(ref.assign(values));
+    EXPECT_FALSE(db.open(config_with_key_encoding("legacy").c_str()));
+    EXPECT_TRUE(db.open(config().c_str()));
+    expect_ordered(db);
+    EXPECT_TRUE(db.clear());
 }
+#endif
 
 /**
- * Performs basic JSON Pathes, JSON Merge-Patches, and sub-document level updates.
+ * Scans keys together with their values, if the engine supports that.
  */
-TEST(db, docs_modify) {
+TEST(db, scan_with_values) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto jsons = make_three_nested_docs();
-    collection[1] = jsons[0].c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
-
-    // Update
-    auto modifier = R"( {"person": {"name":"Charles", "age": 28}} )"_json.dump();
-    EXPECT_TRUE(collection[1].update(modifier.c_str()));
-    auto result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), modifier.c_str());
-
-    // Update By Field
-    modifier = R"( {"name": "Alice", "age": 24} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/person")].update(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[0].c_str());
-
-    // Insert
-    EXPECT_FALSE(collection[1].insert(jsons[1].c_str()));
-    EXPECT_TRUE(collection[2].insert(jsons[1].c_str()));
-    result = collection[2].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[1].c_str());
-
-    // Insert By Field
-    modifier = R"("Doe" )"_json.dump();
-    auto expected = R"({"person": [{"name":"Bob", "age": 25, "surname" : "Doe"}]})"_json.dump();
-    EXPECT_TRUE(collection[ckf(2, "/person/0/surname")].insert(modifier.c_str()));
-    result = collection[2].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    auto main = db.main();
 
-    // Upsert
-    EXPECT_TRUE(collection[1].upsert(jsons[2].c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), jsons[2].c_str());
+    constexpr std::size_t keys_count = 100;
+    for (std::size_t i = 0; i != keys_count; ++i)
+        main[i * 2] = std::to_string(i).c_str();
 
-    // Upsert By Field
-    modifier = R"("Charles")"_json.dump();
-    expected = R"( {"person": "Charles", "age": 26} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/person")].upsert(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    arena_t arena(db);
+    status_t status {};
+    ustore_key_t start_key = 10;
+    ustore_length_t count_limit = 20;
+    ustore_length_t* found_counts = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_length_t* found_lengths = nullptr;
+    ustore_byte_t* found_values = nullptr;
+    ustore_scan_t scan {};
+    scan.db = db;
+    scan.error = status.member_ptr();
+    scan.arena = arena.member_ptr();
+    scan.tasks_count = 1;
+    scan.start_keys = &start_key;
+    scan.count_limits = &count_limit;
+    scan.counts = &found_counts;
+    scan.keys = &found_keys;
+    scan.values_offsets = &found_offsets;
+    scan.values_lengths = &found_lengths;
+    scan.values = &found_values;
+
+    ustore_scan(&scan);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(found_counts[0], count_limit);
+    if (!found_offsets)
+        return;
 
-    modifier = R"(70)"_json.dump();
-    expected = R"( {"person": "Charles", "age": 26, "weight" : 70} )"_json.dump();
-    EXPECT_TRUE(collection[ckf(1, "/weight")].upsert(modifier.c_str()));
-    result = collection[1].value();
-    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+    for (std::size_t i = 0; i != count_limit; ++i) {
+        EXPECT_EQ(found_keys[i], static_cast<ustore_key_t>(10 + i * 2));
+        std::string expected = std::to_string(5 + i);
+        std::string_view value {reinterpret_cast<char const*>(found_values) + found_offsets[i], found_lengths[i]};
+        EXPECT_EQ(value, expected);
+    }
 }
 
 /**
- * Uses a well-known repository of JSON-Patches and JSON-MergePatches,
- * to validate that document modifications work adequately in corner cases.
+ * Checks the "Read Commited" consistency guarantees of transactions.
+ * Readers can't see the contents of pending (not committed) transactions.
+ * https://jepsen.io/consistency/models/read-committed
  */
-TEST(db, docs_merge_and_patch) {
-    using json_t = nlohmann::json;
+TEST(db, transaction_read_commited) {
+    if (!ustore_supports_transactions_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    docs_collection_t collection = db.main<docs_collection_t>();
+    EXPECT_TRUE(db.transact());
+    transaction_t txn = *db.transact();
 
-    std::ifstream f_patch("tests/patch.json");
-    json_t j_object = json_t::parse(f_patch);
-    for (auto it : j_object) {
-        auto doc = it["doc"].dump();
-        auto patch = it["patch"].dump();
-        auto expected = it["expected"].dump();
-        collection[1] = doc.c_str();
-        EXPECT_TRUE(collection[1].patch(patch.c_str()));
-        auto maybe_value = collection[1].value();
-        EXPECT_TRUE(maybe_value);
-        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
-    }
+    triplet_t triplet;
 
-    std::ifstream f_merge("tests/merge.json");
-    j_object = json_t::parse(f_merge);
-    for (auto it : j_object) {
-        auto doc = it["doc"].dump();
-        auto merge = it["merge"].dump();
-        auto expected = it["expected"].dump();
-        collection[1] = doc.c_str();
-        EXPECT_TRUE(collection[1].merge(merge.c_str()));
-        auto maybe_value = collection[1].value();
-        EXPECT_TRUE(maybe_value);
-        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
-    }
+    auto txn_ref = txn[triplet.keys];
+    round_trip(txn_ref, triplet);
+
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
+
+    // Check for missing values before commit
+    check_length(collection_ref, ustore_length_missing_k);
+    EXPECT_TRUE(txn.commit());
+    EXPECT_TRUE(txn.reset());
+
+    // Validate that values match after commit
+    check_equalities(collection_ref, triplet);
 }
 
 /**
- * Fills document collection with info about Alice, Bob and Carl,
- * sampling it later in a form of a table, using both low-level APIs,
- * and higher-level compile-time C++ meta-programming abstractions.
+ * Checks the "Snapshot Isolation" consistency guarantees of transactions.
+ * If needed, readers can initiate snapshot-backed transactions.
+ * All the reads, directed to that snapshot will not see newer operations,
+ * affecting the HEAD state. From a consistency standpoint, it is a downgrade
+ * from "Strictly Serializable" ACID transactions, but it is extremely useful
+ * for numerous Business Intelligence applications.
+ * https://jepsen.io/consistency/models/snapshot-isolation
  */
-TEST(db, docs_table) {
-    using json_t = nlohmann::json;
+TEST(db, transaction_snapshot_isolation) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    // Inject basic data
-    docs_collection_t collection = db.main<docs_collection_t>();
-    auto json_alice = R"( { "person": "Alice", "age": 27, "height": 1 } )"_json.dump();
-    auto json_bob = R"( { "person": "Bob", "age": "27", "weight": 2 } )"_json.dump();
-    auto json_carl = R"( { "person": "Carl", "age": 24 } )"_json.dump();
-    collection[1] = json_alice.c_str();
-    collection[2] = json_bob.c_str();
-    collection[3] = json_carl.c_str();
-    M_EXPECT_EQ_JSON(*collection[1].value(), json_alice.c_str());
-    M_EXPECT_EQ_JSON(*collection[2].value(), json_bob.c_str());
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
 
-    // Just column names
-    {
-        auto maybe_fields = collection[1].gist();
-        auto fields = *maybe_fields;
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
 
-        std::vector<std::string> parsed;
-        for (auto field : fields)
-            parsed.emplace_back(field.data());
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
 
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/person"), parsed.end());
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/height"), parsed.end());
-        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/age"), parsed.end());
-        EXPECT_EQ(std::find(parsed.begin(), parsed.end(), "/weight"), parsed.end());
-    }
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+    round_trip(snap_ref, triplet);
+    round_trip(collection_ref, triplet_same_v);
 
-    // Single cell
-    {
-        auto header = table_header().with<std::uint32_t>("age");
-        auto maybe_table = collection[1].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
+    // Validate that values match
+    auto maybe_retrieved = snap_ref.value();
+    auto const& retrieved = *maybe_retrieved;
+    auto it = retrieved.begin();
+    auto cont = triplet_same_v.contents_full();
+    for (std::size_t i = 0; i != cont.size(); ++i, ++it) {
+        auto expected_len = cont[i].size();
+        auto expected_begin = cont[i].begin();
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_FALSE(col0[0].converted);
+        value_view_t retrieved_view = *it;
+        value_view_t expected_view(expected_begin, expected_begin + expected_len);
+        EXPECT_EQ(retrieved_view.size(), expected_view.size());
+        EXPECT_NE(retrieved_view, expected_view);
     }
 
-    // Single row
-    {
-        auto header = table_header() //
-                          .with<std::uint32_t>("age")
-                          .with<std::int32_t>("age")
-                          .with<std::string_view>("age");
+    snap = *db.snapshot();
+    auto ref = snap[triplet_same_v.keys];
+    round_trip(ref, triplet_same_v);
 
-        auto maybe_table = collection[1].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
-        auto col1 = table.column<1>();
-        auto col2 = table.column<2>();
+    EXPECT_TRUE(db.clear());
+}
+TEST(db, snapshots_list) {
+    if (!ustore_supports_snapshots_k)
+        return;
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_FALSE(col0[0].converted);
-        EXPECT_EQ(col1[0].value, 27);
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col2[0].value.data(), "27");
-        EXPECT_TRUE(col2[0].converted);
-    }
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Single column
-    {
-        auto header = table_header().with<std::int32_t>("age");
-        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
+    auto snap_1 = *db.snapshot();
+    auto snapshots = snap_1.snapshots();
+    auto snaps = *snapshots;
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
-    }
+    EXPECT_EQ(snaps.size(), 1u);
 
-    // Single strings column
-    {
-        auto header = table_header().with<std::string_view>("age");
-        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
+    auto snap_2 = *db.snapshot();
+    snapshots = snap_2.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 2u);
 
-        EXPECT_STREQ(col0[0].value.data(), "27");
-        EXPECT_TRUE(col0[0].converted);
-        EXPECT_STREQ(col0[1].value.data(), "27");
-        EXPECT_STREQ(col0[2].value.data(), "24");
-    }
+    auto snap_3 = *db.snapshot();
+    snapshots = snap_3.snapshots();
+    snaps = *snapshots;
 
-    // Multi-column
-    {
-        auto header = table_header() //
-                          .with<std::int32_t>("age")
-                          .with<std::string_view>("age")
-                          .with<std::string_view>("person")
-                          .with<float>("person")
-                          .with<std::int32_t>("height")
-                          .with<std::uint64_t>("weight");
+    EXPECT_EQ(snaps.size(), 3u);
 
-        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column<0>();
-        auto col1 = table.column<1>();
-        auto col2 = table.column<2>();
-        auto col3 = table.column<3>();
-        auto col4 = table.column<4>();
-        auto col5 = table.column<5>();
+    snap_1 = *db.snapshot();
+    snapshots = snap_1.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 3u);
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
+    EXPECT_TRUE(db.clear());
 
-        EXPECT_STREQ(col1[0].value.data(), "27");
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col1[1].value.data(), "27");
-        EXPECT_STREQ(col1[2].value.data(), "24");
-    }
+    snapshots = snap_1.snapshots();
+    snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 0u);
 
-    // Multi-column Type-punned exports
-    {
-        table_header_t header {{
-            field_type_t {"age", ustore_doc_field_i32_k},
-            field_type_t {"age", ustore_doc_field_str_k},
-            field_type_t {"person", ustore_doc_field_str_k},
-            field_type_t {"person", ustore_doc_field_f32_k},
-            field_type_t {"height", ustore_doc_field_i32_k},
-            field_type_t {"weight", ustore_doc_field_u64_k},
-        }};
+    EXPECT_TRUE(db.clear());
+}
 
-        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
-        auto table = *maybe_table;
-        auto col0 = table.column(0).as<std::int32_t>();
-        auto col1 = table.column(1).as<value_view_t>();
-        auto col2 = table.column(2).as<value_view_t>();
-        auto col3 = table.column(3).as<float>();
-        auto col4 = table.column(4).as<std::int32_t>();
-        auto col5 = table.column(5).as<std::uint64_t>();
+TEST(db, transaction_with_snapshot) {
+    if (!ustore_supports_snapshots_k)
+        return;
 
-        EXPECT_EQ(col0[0].value, 27);
-        EXPECT_EQ(col0[1].value, 27);
-        EXPECT_TRUE(col0[1].converted);
-        EXPECT_EQ(col0[2].value, 24);
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-        EXPECT_STREQ(col1[0].value.c_str(), "27");
-        EXPECT_TRUE(col1[0].converted);
-        EXPECT_STREQ(col1[1].value.c_str(), "27");
-        EXPECT_STREQ(col1[2].value.c_str(), "24");
-    }
-}
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
 
-#pragma region Graph Modality
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
 
-edge_t make_edge(ustore_key_t edge_id, ustore_key_t v1, ustore_key_t v2) {
-    return {v1, v2, edge_id};
-}
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
 
-std::vector<edge_t> make_edges(std::size_t vertices_count = 2, std::size_t next_connect = 1) {
-    std::vector<edge_t> es;
-    ustore_key_t edge_id = 0;
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        ustore_key_t connect_with = vertex_id + next_connect;
-        while (connect_with < vertices_count) {
-            edge_id++;
-            es.push_back(make_edge(edge_id, vertex_id, connect_with));
-            connect_with = connect_with + next_connect;
-        }
-    }
-    return es;
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+    check_equalities(snap_ref, triplet);
+
+    round_trip(collection_ref, triplet_same_v);
+
+    transaction_t txn = *db.transact();
+    auto txn_ref_1 = txn[triplet.keys];
+    check_equalities(txn_ref_1, triplet_same_v);
+
+    txn.set_snapshot(snap.snap());
+    auto txn_ref_2 = txn[triplet.keys];
+    check_equalities(txn_ref_2, triplet);
+
+    snap = *db.snapshot();
+    txn.set_snapshot(snap.snap());
+
+    auto txn_ref_3 = txn[triplet.keys];
+    check_equalities(txn_ref_3, triplet_same_v);
+    EXPECT_TRUE(db.clear());
 }
 
-/**
- * Upserts disconnected vertices into the graph.
- */
-TEST(db, graph_upsert_vertices) {
+TEST(db, set_wrong_snapshot) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
-    std::vector<ustore_key_t> vertices {1, 4, 5, 2};
-    EXPECT_TRUE(net.upsert_vertices(vertices));
+    triplet_t triplet;
+    blobs_collection_t collection = db.main();
+    auto collection_ref = collection[triplet.keys];
 
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_TRUE(*net.contains(4));
-    EXPECT_TRUE(*net.contains(5));
+    check_length(collection_ref, ustore_length_missing_k);
+    round_trip(collection_ref, triplet);
+
+    auto snap = *db.snapshot();
+
+    auto snap_ref = snap[triplet.keys];
+    check_equalities(snap_ref, triplet);
+
+    auto snapshots = snap.snapshots();
+    auto snaps = *snapshots;
+    EXPECT_EQ(snaps.size(), 1u);
+
+    auto snapshot = snap.snap();
+
+    ustore_snapshot_t wrong_snap = 1u;
+    snap.set_snapshot(wrong_snap);
+
+    auto wrong_snap_ref = snap[triplet.keys];
+    EXPECT_FALSE(wrong_snap_ref.value());
+
+    snap.set_snapshot(snapshot);
+    auto right_snap_ref = snap[triplet.keys];
+    EXPECT_TRUE(right_snap_ref.value());
+
+    EXPECT_TRUE(db.clear());
 }
 
 /**
- * Upserts an edge and its member vertices into the graph.
+ * Creates news collection under unique names.
+ * Fill data in collection. Checking/dropping/checking collection data by thread.
  */
-TEST(db, graph_upsert_edge) {
+TEST(db, snapshot_with_threads) {
+    if (!ustore_supports_snapshots_k)
+        return;
+
     clear_environment();
+
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
-    edge_t edge {1, 2, 9};
-    EXPECT_TRUE(net.upsert_edge(edge));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(3));
+    triplet_t triplet;
+    triplet_t triplet_same_v;
+    triplet_same_v.vals = {'D', 'D', 'D'};
 
-    auto neighbors = net.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 1);
-    EXPECT_EQ(neighbors[0], 2);
+    blobs_collection_t collection = db.main();
+    auto ref = collection[triplet.keys];
+    round_trip(ref, triplet);
+
+    auto snap = *db.snapshot();
+    auto snap_ref = snap[triplet.keys];
+
+    round_trip(ref, triplet_same_v);
+
+    std::shared_mutex mutex;
+    bool is_deleted = false;
+    auto task_read = [&]() {
+        while (true) {
+            std::shared_lock _ {mutex};
+            if (is_deleted) {
+                auto ref = snap[triplet.keys];
+                check_equalities(ref, triplet_same_v);
+                break;
+            }
+            check_equalities(snap_ref, triplet);
+        }
+    };
+
+    auto task_reset = [&]() {
+        std::unique_lock _ {mutex};
+        snap.set_snapshot(0);
+        is_deleted = true;
+    };
+
+    std::thread t1(task_read);
+    std::thread t2(task_reset);
+    t1.join();
+    t2.join();
+
+    EXPECT_TRUE(db.clear());
 }
 
 /**
- * Tests "Graphs" Modality, with on of the simplest network designs - a triangle.
- * Three vertices, three connections between them, forming 3 undirected, or 6 directed edges.
- * Tests edge upserts, existence checks, degree computation, vertex removals.
+ * Scans the main collection with the given snapshot, in small batches.
  */
-TEST(db, graph_triangle) {
+static std::vector<ustore_key_t> scan_keys(database_t& db, ustore_snapshot_t snapshot) {
+    std::vector<ustore_key_t> keys;
+    arena_t arena(db);
+    status_t status;
+    ustore_key_t start_key = std::numeric_limits<ustore_key_t>::min();
+    ustore_length_t count_limit = 16;
+    while (true) {
+        ustore_length_t* found_counts = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_scan_t scan {};
+        scan.db = db;
+        scan.error = status.member_ptr();
+        scan.snapshot = snapshot;
+        scan.arena = arena.member_ptr();
+        scan.tasks_count = 1;
+        scan.start_keys = &start_key;
+        scan.count_limits = &count_limit;
+        scan.counts = &found_counts;
+        scan.keys = &found_keys;
+        ustore_scan(&scan);
+        EXPECT_TRUE(status);
+        if (!status)
+            break;
+        keys.insert(keys.end(), found_keys, found_keys + found_counts[0]);
+        if (found_counts[0] < count_limit)
+            break;
+        start_key = found_keys[found_counts[0] - 1] + 1;
+    }
+    return keys;
+}
+
+/**
+ * Erases, overwrites and inserts keys after taking a snapshot, expecting the reads
+ * and the scans of the snapshot to see all the original keys and values, while the
+ * HEAD state only sees the new ones. Every change goes through a different path:
+ * single writes, batched writes and transactions.
+ */
+TEST(db, snapshot_retention) {
+    if (!ustore_supports_snapshots_k)
+        return;
 
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t net = db.main<graph_collection_t>();
+    constexpr ustore_key_t keys_count = 100;
+    blobs_collection_t main = db.main();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        main[key] = std::to_string(key).c_str();
 
-    // triangle
-    edge_t edge1 {1, 2, 9};
-    edge_t edge2 {2, 3, 10};
-    edge_t edge3 {3, 1, 11};
+    auto snap = *db.snapshot();
+    for (ustore_key_t key = 0; key < keys_count; key += 2)
+        EXPECT_TRUE(main[key].erase());
 
-    EXPECT_TRUE(net.upsert_edge(edge1));
-    EXPECT_TRUE(net.upsert_edge(edge2));
-    EXPECT_TRUE(net.upsert_edge(edge3));
+    std::vector<ustore_key_t> overwritten_keys;
+    for (ustore_key_t key = 1; key < keys_count; key += 6)
+        overwritten_keys.push_back(key);
+    EXPECT_TRUE(main[overwritten_keys].assign(value_view_t("overwritten")));
 
-    auto neighbors = net.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
+    transaction_t txn = *db.transact();
+    for (ustore_key_t key = keys_count; key != keys_count * 3 / 2; ++key)
+        txn.main()[key] = "inserted";
+    EXPECT_TRUE(txn.commit());
+
+    std::vector<ustore_key_t> snapshot_keys(keys_count);
+    std::iota(snapshot_keys.begin(), snapshot_keys.end(), 0);
+    EXPECT_EQ(scan_keys(db, snap.snap()), snapshot_keys);
+
+    std::vector<ustore_key_t> head_keys;
+    for (ustore_key_t key = 1; key < keys_count; key += 2)
+        head_keys.push_back(key);
+    for (ustore_key_t key = keys_count; key != keys_count * 3 / 2; ++key)
+        head_keys.push_back(key);
+    EXPECT_EQ(scan_keys(db, 0), head_keys);
+
+    blobs_collection_t snap_main = snap.main();
+    for (ustore_key_t key = 0; key != keys_count; ++key)
+        EXPECT_EQ(*snap_main[key].value(), std::to_string(key).c_str());
+    EXPECT_EQ(snap_main.at(keys_count).value(), value_view_t {});
+    EXPECT_EQ(*main[1].value(), "overwritten");
+
+    // Newer snapshots start from the current HEAD state
+    auto newer_snap = *db.snapshot();
+    EXPECT_EQ(scan_keys(db, newer_snap.snap()), head_keys);
+    EXPECT_TRUE(db.clear());
+}
+
+TEST(db, transaction_erase_missing) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.transact());
+    transaction_t txn1 = *db.transact();
+    transaction_t txn2 = *db.transact();
+
+    EXPECT_TRUE(txn2.main().at(-7297309151944849401).erase());
+    EXPECT_TRUE(txn1.main().at(-8640850744835793378).erase());
+    EXPECT_TRUE(txn1.commit());
+    EXPECT_TRUE(txn2.commit());
+
+    EXPECT_EQ(db.main().at(-8640850744835793378).value(), value_view_t {});
+    EXPECT_EQ(db.main().at(-7297309151944849401).value(), value_view_t {});
+    EXPECT_EQ(db.main().keys().size(), 0u);
+}
+
+TEST(db, transaction_write_conflicting) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    EXPECT_TRUE(db.transact());
+    transaction_t txn1 = *db.transact();
+    transaction_t txn2 = *db.transact();
+
+    EXPECT_TRUE(txn2.main().at(6).assign("a"));
+    EXPECT_TRUE(txn1.main().at(6).assign("b"));
+    EXPECT_TRUE(txn1.commit());
+    EXPECT_FALSE(txn2.commit());
+}
+
+/**
+ *
+ */
+TEST(db, transaction_sequenced_commit) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    EXPECT_TRUE(db.transact());
+    transaction_t txn = *db.transact();
+
+    triplet_t triplet;
+    auto txn_ref = txn[triplet.keys];
+
+    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
+    auto maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    auto current_sequence_number = *maybe_sequence_number;
+    EXPECT_GT(current_sequence_number, 0);
+    EXPECT_TRUE(txn.reset());
+#if 0
+    auto previous_sequence_number = current_sequence_number;
+    EXPECT_TRUE(txn_ref.value());
+    maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    current_sequence_number = *maybe_sequence_number;
+    EXPECT_EQ(current_sequence_number, previous_sequence_number);
+    EXPECT_TRUE(txn.reset());
+
+    previous_sequence_number = current_sequence_number;
+    EXPECT_TRUE(txn_ref.assign(triplet.contents()));
+    maybe_sequence_number = txn.sequenced_commit();
+    EXPECT_TRUE(maybe_sequence_number);
+    current_sequence_number = *maybe_sequence_number;
+    EXPECT_GT(current_sequence_number, previous_sequence_number);
+#endif
+}
+
+#pragma region Paths Modality
+
+/**
+ * Tests "Paths" Modality, with variable length keys.
+ * Reads, writes, prefix matching and pattern matching.
+ */
+TEST(db, paths) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    char const* keys[] {"Facebook", "Apple", "Amazon", "Netflix", "Google", "Nvidia", "Adobe"};
+    char const* vals[] {"F", "A", "A", "N", "G", "N", "A"};
+    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
+    ustore_char_t separator = '\0';
+
+    arena_t arena(db);
+    status_t status {};
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = keys_count;
+    paths_write.path_separator = separator;
+    paths_write.paths = keys;
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
+    paths_write.values_bytes_stride = sizeof(char const*);
+
+    ustore_paths_write(&paths_write);
+    char* vals_recovered {};
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = keys_count;
+    paths_read.path_separator = separator;
+    paths_read.paths = keys;
+    paths_read.paths_stride = sizeof(char const*);
+    paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&vals_recovered);
+
+    ustore_paths_read(&paths_read);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(std::string_view(vals_recovered, keys_count * 2),
+              std::string_view("F\0A\0A\0N\0G\0N\0A\0", keys_count * 2));
+
+    // Try getting either "Netflix" or "Nvidia" as one of the keys with "N" prefix
+    ustore_str_view_t prefix = "N";
+    ustore_length_t max_count = 1;
+    ustore_length_t* results_counts {};
+    ustore_length_t* tape_offsets {};
+    ustore_char_t* tape_begin {};
+    ustore_paths_match_t paths_match {};
+    paths_match.db = db;
+    paths_match.error = status.member_ptr();
+    paths_match.arena = arena.member_ptr();
+    paths_match.tasks_count = 1;
+    paths_match.match_counts_limits = &max_count;
+    paths_match.patterns = &prefix;
+    paths_match.match_counts = &results_counts;
+    paths_match.paths_offsets = &tape_offsets;
+    paths_match.paths_strings = &tape_begin;
+
+    ustore_paths_match(&paths_match);
+    auto first_match_for_a = std::string_view(tape_begin);
+    EXPECT_EQ(results_counts[0], 1);
+    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Nvidia");
+
+    // Try getting the remaining results, which is the other one from that same pair
+    max_count = 10;
+    paths_match.previous = &tape_begin;
+    paths_match.options = ustore_option_dont_discard_memory_k;
+    ustore_paths_match(&paths_match);
+    auto second_match_for_a = std::string_view(tape_begin);
+    EXPECT_EQ(results_counts[0], 1);
+    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Nvidia");
+    EXPECT_NE(first_match_for_a, second_match_for_a);
+
+    // Try performing parallel queries in the same collection
+    ustore_str_view_t prefixes[2] = {"A", "N"};
+    std::size_t prefixes_count = sizeof(prefixes) / sizeof(prefixes[0]);
+    max_count = 10;
+    paths_match.tasks_count = prefixes_count;
+    paths_match.patterns = prefixes;
+    paths_match.patterns_stride = sizeof(ustore_str_view_t);
+    paths_match.previous = nullptr;
+    ustore_paths_match(&paths_match);
+    auto total_count = std::accumulate(results_counts, results_counts + prefixes_count, 0ul);
+    strings_tape_iterator_t tape_iterator {total_count, tape_begin};
+    std::set<std::string> tape_parts;
+    while (!tape_iterator.is_end()) {
+        tape_parts.insert(*tape_iterator);
+        ++tape_iterator;
+    }
+    EXPECT_EQ(results_counts[0], 3);
+    EXPECT_EQ(results_counts[1], 2);
+    EXPECT_NE(tape_parts.find("Netflix"), tape_parts.end());
+    EXPECT_NE(tape_parts.find("Adobe"), tape_parts.end());
+
+    // Now try matching a Regular Expression
+    prefix = "Netflix|Google";
+    paths_match.tasks_count = 1;
+    paths_match.patterns = &prefix;
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 2);
+    EXPECT_TRUE(first_match_for_a == "Netflix" || first_match_for_a == "Google");
+    EXPECT_TRUE(second_match_for_a == "Netflix" || second_match_for_a == "Google");
+
+    // Try a more complex regular expression
+    prefix = "A.*e";
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 2);
+    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe");
+    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe");
+
+    // Existing single letter prefix
+    prefix = "A";
+    ustore_paths_match(&paths_match);
+    first_match_for_a = std::string_view(tape_begin);
+    second_match_for_a = std::string_view(tape_begin + tape_offsets[1]);
+    EXPECT_EQ(results_counts[0], 3);
+    EXPECT_TRUE(first_match_for_a == "Apple" || first_match_for_a == "Adobe" || first_match_for_a == "Amazon");
+    EXPECT_TRUE(second_match_for_a == "Apple" || second_match_for_a == "Adobe" || second_match_for_a == "Amazon");
+
+    // Missing single letter prefix
+    prefix = "X";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Missing pattern
+    prefix = "X.*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Try a more complex regular expression
+    prefix = "oo:18:\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    // Try an even more complex regular expression
+    prefix = "oo:18:\\\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+
+    EXPECT_TRUE(db.clear());
+
+    // Try an even more complex regular expression on empty DB
+    prefix = "oo:18:\\\\*";
+    ustore_paths_match(&paths_match);
+    EXPECT_EQ(results_counts[0], 0);
+    EXPECT_EQ(*paths_match.error, nullptr);
+}
+
+/**
+ * Writes nested paths with a separator, so that mirror "directory" entries are maintained,
+ * and checks that prefix matches walking them return sorted results, support pagination,
+ * follow removals, and never expose the mirror entries to full scans.
+ */
+TEST(db, paths_directories) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    ustore_char_t separator = '/';
+    char const* keys[] {
+        "home/user/media/b",
+        "home/user/media/a",
+        "home/user/docs/x",
+        "home/other/y",
+        "homework",
+        "var/log",
+    };
+    char const* vals[] {"b", "a", "x", "y", "w", "l"};
+    std::size_t keys_count = sizeof(keys) / sizeof(keys[0]);
+
+    arena_t arena(db);
+    status_t status {};
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = keys_count;
+    paths_write.path_separator = separator;
+    paths_write.paths = keys;
+    paths_write.paths_stride = sizeof(char const*);
+    paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(vals);
+    paths_write.values_bytes_stride = sizeof(char const*);
+    ustore_paths_write(&paths_write);
+    EXPECT_TRUE(status);
+
+    auto match = [&](char const* prefix, ustore_char_t match_separator, char const* previous = nullptr) {
+        ustore_length_t max_count = previous ? 1 : 100;
+        ustore_length_t* results_counts {};
+        ustore_length_t* tape_offsets {};
+        ustore_char_t* tape_begin {};
+        ustore_paths_match_t paths_match {};
+        paths_match.db = db;
+        paths_match.error = status.member_ptr();
+        paths_match.arena = arena.member_ptr();
+        paths_match.tasks_count = 1;
+        paths_match.path_separator = match_separator;
+        paths_match.match_counts_limits = &max_count;
+        paths_match.patterns = &prefix;
+        paths_match.previous = previous ? &previous : nullptr;
+        paths_match.match_counts = &results_counts;
+        paths_match.paths_offsets = &tape_offsets;
+        paths_match.paths_strings = &tape_begin;
+        ustore_paths_match(&paths_match);
+        EXPECT_TRUE(status);
+
+        std::vector<std::string> results;
+        strings_tape_iterator_t tape_iterator {results_counts[0], tape_begin};
+        for (; !tape_iterator.is_end(); ++tape_iterator)
+            results.emplace_back(*tape_iterator);
+        return results;
+    };
+    using strings_t = std::vector<std::string>;
+
+    // Walks are ordered lexicographically, unlike the insertions
+    EXPECT_EQ(match("home/user/", separator), (strings_t {"home/user/docs/x", "home/user/media/a", "home/user/media/b"}));
+    EXPECT_EQ(match("home/user/m", separator), (strings_t {"home/user/media/a", "home/user/media/b"}));
+    EXPECT_EQ(match("home/", separator).size(), 4u);
+    EXPECT_EQ(match("home/missing/", separator).size(), 0u);
+
+    // Paginating one path at a time skips the subtrees, that were already exported
+    EXPECT_EQ(match("home/", separator, "home/other/y"), (strings_t {"home/user/docs/x"}));
+    EXPECT_EQ(match("home/", separator, "home/user/docs/x"), (strings_t {"home/user/media/a"}));
+    EXPECT_EQ(match("home/", separator, "home/user/media/b"), (strings_t {}));
+
+    // Full scans, without the separator, only see the regular paths
+    std::set<std::string> scanned;
+    for (std::string const& path : match("", '\0'))
+        scanned.insert(path);
+    EXPECT_EQ(scanned, std::set<std::string>(keys, keys + keys_count));
+
+    // Removing all files of a directory also removes it from the listing of its parent
+    char const* removed[] {"home/user/media/a", "home/user/media/b"};
+    paths_write.tasks_count = 2;
+    paths_write.paths = removed;
+    paths_write.values_bytes = nullptr;
+    ustore_paths_write(&paths_write);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(match("home/user/", separator), (strings_t {"home/user/docs/x"}));
+    EXPECT_EQ(match("home/user/m", separator).size(), 0u);
+    EXPECT_EQ(match("home/", separator), (strings_t {"home/other/y", "home/user/docs/x"}));
+
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Fills the hash buckets of paths, then overwrites the values with shorter ones, which are
+ * patched in place, with ones of the same length and with longer ones, removes some of them,
+ * and checks every path, as well as the missing paths, that only differ by a suffix.
+ */
+TEST(db, paths_overwrites) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    arena_t arena(db);
+    status_t status;
+    auto write = [&](std::vector<ustore_str_view_t> const& paths, std::vector<ustore_str_view_t> const& values) {
+        ustore_paths_write_t paths_write {};
+        paths_write.db = db;
+        paths_write.error = status.member_ptr();
+        paths_write.arena = arena.member_ptr();
+        paths_write.tasks_count = paths.size();
+        paths_write.paths = paths.data();
+        paths_write.paths_stride = sizeof(ustore_str_view_t);
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t const*>(values.data());
+        paths_write.values_bytes_stride = sizeof(ustore_str_view_t);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+    };
+    auto read = [&](std::vector<ustore_str_view_t> const& paths) {
+        ustore_octet_t* presences {};
+        ustore_length_t* offsets {};
+        ustore_length_t* lengths {};
+        ustore_byte_t* values {};
+        ustore_paths_read_t paths_read {};
+        paths_read.db = db;
+        paths_read.error = status.member_ptr();
+        paths_read.arena = arena.member_ptr();
+        paths_read.tasks_count = paths.size();
+        paths_read.paths = paths.data();
+        paths_read.paths_stride = sizeof(ustore_str_view_t);
+        paths_read.presences = &presences;
+        paths_read.offsets = &offsets;
+        paths_read.lengths = &lengths;
+        paths_read.values = &values;
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+
+        bits_view_t presences_view {presences};
+        std::vector<std::optional<std::string>> results(paths.size());
+        for (std::size_t i = 0; i != paths.size(); ++i)
+            if (presences_view[i])
+                results[i] = std::string(reinterpret_cast<char const*>(values) + offsets[i], lengths[i]);
+        return results;
+    };
+
+    // Paths of different lengths, many of which are prefixes of one another
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<std::size_t> lengths_distribution {1, 64};
+    std::set<std::string> unique;
+    while (unique.size() != 10'000) {
+        std::string path(lengths_distribution(generator), 'a');
+        for (char& c : path)
+            c = static_cast<char>('a' + generator() % 4);
+        unique.insert(std::move(path));
+    }
+    std::vector<std::string> paths_strings {unique.begin(), unique.end()};
+    std::vector<std::string> values_strings(paths_strings.size());
+    std::vector<ustore_str_view_t> paths(paths_strings.size());
+    std::vector<ustore_str_view_t> values(paths_strings.size());
+    for (std::size_t i = 0; i != paths_strings.size(); ++i) {
+        values_strings[i] = "value:" + paths_strings[i];
+        paths[i] = paths_strings[i].c_str();
+        values[i] = values_strings[i].c_str();
+    }
+    write(paths, values);
+
+    std::map<std::string, std::string> expected;
+    for (std::size_t i = 0; i != paths_strings.size(); ++i) {
+        switch (i % 8) {
+        case 0: values_strings[i] = "short"; break;
+        case 1: values_strings[i].back() = '!'; break;
+        case 2: values_strings[i] += values_strings[i]; break;
+        case 3: values[i] = nullptr; continue;
+        default: break;
+        }
+        values[i] = values_strings[i].c_str();
+        expected[paths_strings[i]] = values_strings[i];
+    }
+    write(paths, values);
+
+    // Every path is checked together with a longer missing one, sharing its prefix
+    std::vector<std::string> missing_strings(paths_strings.size());
+    std::vector<ustore_str_view_t> queries;
+    for (std::size_t i = 0; i != paths_strings.size(); ++i) {
+        missing_strings[i] = paths_strings[i] + "z";
+        queries.push_back(paths[i]);
+        queries.push_back(missing_strings[i].c_str());
+    }
+    auto results = read(queries);
+    for (std::size_t i = 0; i != paths_strings.size(); ++i) {
+        auto it = expected.find(paths_strings[i]);
+        if (it == expected.end())
+            EXPECT_FALSE(results[i * 2]);
+        else
+            EXPECT_EQ(results[i * 2], it->second);
+        EXPECT_FALSE(results[i * 2 + 1]);
+    }
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Tests "Paths" Modality, by forming bidirectional linked lists from string-to-string mappings.
+ * Uses different-length unique strings. As the underlying modality may be implemented as a bucketed hash-map,
+ * this test helps catch problems in bucket reorganization.
+ */
+TEST(db, paths_linked_list) {
+    constexpr std::size_t count = 1000;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    arena_t arena(db);
+    ustore_char_t separator = '\0';
+    status_t status;
+
+    ustore_paths_write_t paths_write {};
+    paths_write.db = db;
+    paths_write.error = status.member_ptr();
+    paths_write.arena = arena.member_ptr();
+    paths_write.tasks_count = 1;
+    paths_write.path_separator = separator;
+
+    ustore_paths_read_t paths_read {};
+    paths_read.db = db;
+    paths_read.error = status.member_ptr();
+    paths_read.arena = arena.member_ptr();
+    paths_read.tasks_count = 1;
+    paths_read.path_separator = separator;
+
+    // Generate some random strings for our tests
+    constexpr auto alphabet = "abcdefghijklmnop";
+    auto make_random_str = []() {
+        auto str = std::string();
+        auto len = static_cast<std::size_t>(std::rand() % 100) + 8;
+        for (std::size_t i = 0; i != len; ++i)
+            str.push_back(alphabet[std::rand() % 16]);
+        return str;
+    };
+    std::set<std::string> unique;
+    while (unique.size() != count)
+        unique.insert(make_random_str());
+
+    // Lets form a linked list, where every key maps into the the next key.
+    // Then we will traverse the linked list from start to end.
+    // Then we will re-link it in reverse order and traverse again.
+    std::vector<ustore_str_view_t> begins(unique.size());
+    std::transform(unique.begin(), unique.end(), begins.begin(), [](std::string const& str) { return str.c_str(); });
+
+    // Link forward
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        paths_write.paths = &smaller;
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&bigger);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+
+        // Check if it was successfully written:
+        ustore_str_span_t bigger_received = nullptr;
+        paths_read.paths = &smaller;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    }
+
+    // Traverse forward, counting the entries and checking the order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        ustore_str_span_t bigger_received = nullptr;
+        paths_read.paths = &smaller;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&bigger_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(bigger), std::string_view(bigger_received));
+    }
+
+    // Re-link in reverse order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        paths_write.paths = &bigger;
+        paths_write.values_bytes = reinterpret_cast<ustore_bytes_cptr_t*>(&smaller);
+        ustore_paths_write(&paths_write);
+        EXPECT_TRUE(status);
+
+        // Check if it was successfully over-written:
+        ustore_str_span_t smaller_received = nullptr;
+        paths_read.paths = &bigger;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    }
+
+    // Traverse backwards, counting the entries and checking the order
+    for (std::size_t i = 0; i + 1 != begins.size(); ++i) {
+        ustore_str_view_t smaller = begins[i];
+        ustore_str_view_t bigger = begins[i + 1];
+        ustore_str_span_t smaller_received = nullptr;
+        paths_read.paths = &bigger;
+        paths_read.values = reinterpret_cast<ustore_bytes_ptr_t*>(&smaller_received);
+        ustore_paths_read(&paths_read);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(std::string_view(smaller), std::string_view(smaller_received));
+    }
+}
+
+#pragma region Documents Modality
+
+std::vector<std::string> make_three_flat_docs() {
+    auto json1 = R"( {"person": "Alice", "age": 24} )"_json.dump();
+    auto json2 = R"( {"person": "Bob", "age": 25} )"_json.dump();
+    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
+    return {json1, json2, json3};
+}
+
+std::vector<std::string> make_three_nested_docs() {
+    auto json1 = R"( {"person": {"name":"Alice", "age": 24}} )"_json.dump();
+    auto json2 = R"( {"person": [{"name":"Bob", "age": 25}]} )"_json.dump();
+    auto json3 = R"( {"person": "Carl", "age": 26} )"_json.dump();
+    return {json1, json2, json3};
+}
+
+/**
+ * Tests "Documents" Modality, mapping integers to structured hierarchical documents.
+ * Takes a basic flat JSON document, and checks if it can be imported in JSON, BSON
+ * and MessagePack forms, and later be properly accessed at field-level.
+ */
+TEST(db, docs_flat) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    // JSON
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto jsons = make_three_flat_docs();
+    collection[1] = jsons[0].c_str();
+    collection[2] = jsons[1].c_str();
+    collection[3] = jsons[2].c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), "\"Bob\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(3, "age")].value(), "26");
+
+    // Binary
+    auto maybe_person = collection[ckf(1, "person")].value(ustore_doc_field_str_k);
+    EXPECT_EQ(std::string_view(maybe_person->c_str(), maybe_person->size()), std::string_view("Alice"));
+
+    // BSON
+    bson_error_t error;
+    bson_t* bson = bson_new_from_json((uint8_t*)jsons[0].c_str(), -1, &error);
+    uint8_t const* buffer = bson_get_data(bson);
+    auto view = value_view_t(buffer, bson->len);
+    collection.at(4, ustore_doc_field_bson_k) = view;
+    M_EXPECT_EQ_JSON(*collection[4].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(4, "person")].value(), "\"Alice\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(4, "age")].value(), "24");
+    bson_clear(&bson);
+
+    // MsgPack
+    auto message_pack = *collection[1].value(ustore_doc_field_msgpack_k);
+    collection.at(5, ustore_doc_field_msgpack_k) = message_pack;
+    M_EXPECT_EQ_JSON(*collection[5].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[ckf(5, "person")].value(), "\"Alice\"");
+    M_EXPECT_EQ_JSON(*collection[ckf(5, "age")].value(), "24");
+}
+
+/**
+ * Tries adding 3 simple nested JSONs, using JSON-Pointers
+ * to retrieve specific fields across multiple keys.
+ */
+TEST(db, docs_nested_batch) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+
+    auto jsons = make_three_nested_docs();
+    std::string continuous_jsons = jsons[0] + jsons[1] + jsons[2];
+    auto vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
+    std::array<ustore_length_t, 4> offsets = {
+        0,
+        static_cast<ustore_length_t>(jsons[0].size()),
+        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size()),
+        static_cast<ustore_length_t>(jsons[0].size() + jsons[1].size() + jsons[2].size()),
+    };
+    contents_arg_t values {};
+    values.offsets_begin = {offsets.data(), sizeof(ustore_length_t)};
+    values.contents_begin = {&vals_begin, 0};
+
+    std::array<ustore_key_t, 3> keys = {1, 2, 3};
+    auto ref = collection[keys];
+    EXPECT_TRUE(ref.assign(values));
+
+    // Read One By One
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+    M_EXPECT_EQ_JSON(*collection[2].value(), jsons[1]);
+    M_EXPECT_EQ_JSON(*collection[3].value(), jsons[2]);
+
+    auto expected = R"({"name":"Alice", "age": 24})"_json.dump();
+    M_EXPECT_EQ_JSON(*collection[ckf(1, "person")].value(), expected);
+
+    expected = R"([{"name":"Bob", "age": 25}])"_json.dump();
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "person")].value(), expected);
+    M_EXPECT_EQ_JSON(*collection[ckf(2, "/person/0/name")].value(), "\"Bob\"");
+
+    // Read sorted keys
+    check_equalities(ref, values);
+
+    // Read not sorted keys
+    std::array<ustore_key_t, 3> not_sorted_keys = {1, 3, 2};
+    auto not_sorted_ref = collection[not_sorted_keys];
+    std::string not_sorted_jsons = jsons[0] + jsons[2] + jsons[1];
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(not_sorted_jsons.data());
+    offsets[2] = jsons[0].size() + jsons[2].size();
+    offsets[3] = jsons[0].size() + jsons[2].size() + jsons[1].size();
+    check_equalities(not_sorted_ref, values);
+
+    // Read duplicate keys
+    std::array<ustore_key_t, 3> duplicate_keys = {1, 2, 1};
+    auto duplicate_ref = collection[duplicate_keys];
+    std::string duplicate_jsons = jsons[0] + jsons[1] + jsons[0];
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(duplicate_jsons.data());
+    offsets[2] = jsons[0].size() + jsons[1].size();
+    offsets[3] = jsons[0].size() + jsons[1].size() + jsons[0].size();
+    check_equalities(duplicate_ref, values);
+
+    // Read with fields
+    std::array<collection_key_field_t, 3> keys_with_fields = {
+        ckf(1, "person"),
+        ckf(2, "/person/0/name"),
+        ckf(3, "age"),
+    };
+    auto ref_with_fields = collection[keys_with_fields];
+    auto field_value1 = R"({"name":"Alice", "age": 24})"_json.dump();
+    auto field_value2 = R"("Bob")"_json.dump();
+    auto field_value3 = R"(26)"_json.dump();
+    std::string field_values = field_value1 + field_value2 + field_value3;
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(field_values.data());
+    offsets[1] = field_value1.size();
+    offsets[2] = field_value1.size() + field_value2.size();
+    offsets[3] = field_value1.size() + field_value2.size() + field_value3.size();
+    check_equalities(ref_with_fields, values);
+
+    // Check Invalid Json Write
+    std::string invalid_json = R"({"name":"Alice", } "age": 24})";
+    offsets[1] = jsons[0].size();
+    offsets[2] = jsons[0].size() + jsons[1].size();
+    offsets[3] = jsons[0].size() + jsons[1].size() + invalid_json.size();
+    continuous_jsons = jsons[0] + jsons[1] + invalid_json;
+    vals_begin = reinterpret_cast<ustore_bytes_ptr_t>(continuous_jsons.data());
+
+    EXPECT_FALSE(ref.assign(values));
+}
+
+/**
+ * Performs basic JSON Pathes, JSON Merge-Patches, and sub-document level updates.
+ */
+TEST(db, docs_modify) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto jsons = make_three_nested_docs();
+    collection[1] = jsons[0].c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), jsons[0]);
+
+    // Update
+    auto modifier = R"( {"person": {"name":"Charles", "age": 28}} )"_json.dump();
+    EXPECT_TRUE(collection[1].update(modifier.c_str()));
+    auto result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), modifier.c_str());
+
+    // Update By Field
+    modifier = R"( {"name": "Alice", "age": 24} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/person")].update(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[0].c_str());
+
+    // Insert
+    EXPECT_FALSE(collection[1].insert(jsons[1].c_str()));
+    EXPECT_TRUE(collection[2].insert(jsons[1].c_str()));
+    result = collection[2].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[1].c_str());
+
+    // Insert By Field
+    modifier = R"("Doe" )"_json.dump();
+    auto expected = R"({"person": [{"name":"Bob", "age": 25, "surname" : "Doe"}]})"_json.dump();
+    EXPECT_TRUE(collection[ckf(2, "/person/0/surname")].insert(modifier.c_str()));
+    result = collection[2].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+
+    // Upsert
+    EXPECT_TRUE(collection[1].upsert(jsons[2].c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), jsons[2].c_str());
+
+    // Upsert By Field
+    modifier = R"("Charles")"_json.dump();
+    expected = R"( {"person": "Charles", "age": 26} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/person")].upsert(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+
+    modifier = R"(70)"_json.dump();
+    expected = R"( {"person": "Charles", "age": 26, "weight" : 70} )"_json.dump();
+    EXPECT_TRUE(collection[ckf(1, "/weight")].upsert(modifier.c_str()));
+    result = collection[1].value();
+    M_EXPECT_EQ_JSON(result->c_str(), expected.c_str());
+}
+
+/**
+ * Uses a well-known repository of JSON-Patches and JSON-MergePatches,
+ * to validate that document modifications work adequately in corner cases.
+ */
+TEST(db, docs_merge_and_patch) {
+    using json_t = nlohmann::json;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+
+    std::ifstream f_patch("tests/patch.json");
+    json_t j_object = json_t::parse(f_patch);
+    for (auto it : j_object) {
+        auto doc = it["doc"].dump();
+        auto patch = it["patch"].dump();
+        auto expected = it["expected"].dump();
+        collection[1] = doc.c_str();
+        EXPECT_TRUE(collection[1].patch(patch.c_str()));
+        auto maybe_value = collection[1].value();
+        EXPECT_TRUE(maybe_value);
+        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
+    }
+
+    std::ifstream f_merge("tests/merge.json");
+    j_object = json_t::parse(f_merge);
+    for (auto it : j_object) {
+        auto doc = it["doc"].dump();
+        auto merge = it["merge"].dump();
+        auto expected = it["expected"].dump();
+        collection[1] = doc.c_str();
+        EXPECT_TRUE(collection[1].merge(merge.c_str()));
+        auto maybe_value = collection[1].value();
+        EXPECT_TRUE(maybe_value);
+        M_EXPECT_EQ_JSON(maybe_value->c_str(), expected.c_str());
+    }
+}
+
+/**
+ * Replaces scalar members of a nested document with longer and shorter ones, increments numbers
+ * and applies patches of "replace" operations, which are spliced into the stored document in place.
+ * After every step the whole document, the following members and the enclosing ones must read back intact.
+ */
+TEST(db, docs_splice) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t collection = db.main<docs_collection_t>();
+
+    json_t expected = R"({"a":1,"nested":{"name":"Al","zip":"123","deep":{"n":5}},"tail":"end","list":[1,2]})"_json;
+    collection[1] = expected.dump().c_str();
+    auto expect_intact = [&] {
+        M_EXPECT_EQ_JSON(*collection[1].value(), expected.dump());
+        for (char const* field : {"/a", "/nested", "/nested/zip", "/nested/deep", "/nested/deep/n", "/tail", "/list"})
+            M_EXPECT_EQ_JSON(*collection[ckf(1, field)].value(), expected[json_t::json_pointer(field)].dump());
+    };
+
+    EXPECT_TRUE(collection[ckf(1, "/nested/name")].update(R"("Alexander")"));
+    expected["nested"]["name"] = "Alexander";
+    expect_intact();
+
+    EXPECT_TRUE(collection[ckf(1, "/nested/zip")].update(R"("1")"));
+    expected["nested"]["zip"] = "1";
+    expect_intact();
+
+    EXPECT_TRUE(collection[ckf(1, "/a")].update("123456789"));
+    expected["a"] = 123456789;
+    expect_intact();
+
+    EXPECT_TRUE(collection[ckf(1, "/nested/deep/n")].increment("1000"));
+    expected["nested"]["deep"]["n"] = 1005;
+    expect_intact();
+
+    auto patch = R"([{"op":"replace","path":"/tail","value":"the very end"},{"op":"replace","path":"/a","value":7}])";
+    EXPECT_TRUE(collection[1].patch(patch));
+    expected["tail"] = "the very end";
+    expected["a"] = 7;
+    expect_intact();
+
+    EXPECT_TRUE(collection[ckf(1, "/nested/deep/n")].upsert("true"));
+    expected["nested"]["deep"]["n"] = true;
+    expect_intact();
+
+    EXPECT_TRUE(collection[ckf(1, "/a")].increment("0.5"));
+    expected["a"] = 7.5;
+    expect_intact();
+    EXPECT_TRUE(db.clear());
+}
+
+#if defined(USTORE_ENGINE_IS_ROCKSDB) || defined(USTORE_ENGINE_IS_UCSET)
+/**
+ * Applies the same modifications to two collections, one through the merge operator of the engine,
+ * and the other through the regular read-modify-write path, expecting the same documents in both.
+ * Then increments a shared counter from several threads, expecting no lost or conflicting updates.
+ */
+TEST(db, docs_merge_operator) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    docs_collection_t merged = db.create<docs_collection_t>("merged").throw_or_release();
+    docs_collection_t rewritten = db.create<docs_collection_t>("rewritten").throw_or_release();
+
+    auto modify = [&](ustore_collection_t collection,
+                      ustore_key_t key,
+                      ustore_str_view_t field,
+                      ustore_doc_modification_t modification,
+                      std::string const& modifier,
+                      ustore_options_t options) {
+        arena_t arena(db);
+        status_t status;
+        auto value = reinterpret_cast<ustore_bytes_cptr_t>(modifier.c_str());
+        auto length = static_cast<ustore_length_t>(modifier.size());
+        ustore_docs_write_t write {};
+        write.db = db;
+        write.error = status.member_ptr();
+        write.arena = arena.member_ptr();
+        write.options = options;
+        write.tasks_count = 1;
+        write.modification = modification;
+        write.collections = &collection;
+        write.keys = &key;
+        write.fields = field ? &field : nullptr;
+        write.lengths = &length;
+        write.values = &value;
+        ustore_docs_write(&write);
+        EXPECT_TRUE(status);
+    };
+    auto modify_both = [&](ustore_key_t key,
+                           ustore_str_view_t field,
+                           ustore_doc_modification_t modification,
+                           std::string const& modifier) {
+        modify(merged, key, field, modification, modifier, ustore_option_write_merge_k);
+        modify(rewritten, key, field, modification, modifier, ustore_options_default_k);
+        for (ustore_key_t checked_key : {1, 2, 3}) {
+            auto merged_doc = *merged[checked_key].value();
+            auto rewritten_doc = *rewritten[checked_key].value();
+            EXPECT_EQ(merged_doc.size() != 0, rewritten_doc.size() != 0);
+            if (merged_doc.size() && rewritten_doc.size())
+                M_EXPECT_EQ_JSON(merged_doc, rewritten_doc.c_str());
+        }
+    };
+
+    modify_both(1, nullptr, ustore_doc_modify_upsert_k, R"({"name":"Alice","age":30})");
+    modify_both(1, "/name", ustore_doc_modify_upsert_k, R"("Bob")");
+    modify_both(1, "/age", ustore_doc_modify_update_k, "31");
+    modify_both(1, nullptr, ustore_doc_modify_merge_k, R"({"tags":{"a":1},"age":null})");
+    modify_both(1, nullptr, ustore_doc_modify_patch_k, R"([{"op":"add","path":"/tags/b","value":2}])");
+    modify_both(1, "/visits", ustore_doc_modify_increment_k, "3");
+    modify_both(1, "/visits", ustore_doc_modify_increment_k, "2");
+    modify_both(2, nullptr, ustore_doc_modify_upsert_k, R"({"name":"Carol"})");
+    modify_both(3, "/count", ustore_doc_modify_increment_k, "1");
+    M_EXPECT_EQ_JSON(*merged[1].value(), R"({"name":"Bob","tags":{"a":1,"b":2},"visits":5})");
+
+    // Concurrent increments of the same field are serialized by the engine
+    constexpr std::size_t threads_count = 4;
+    constexpr std::size_t increments_per_thread = 250;
+    modify(merged, 4, nullptr, ustore_doc_modify_upsert_k, R"({"counter":0})", ustore_options_default_k);
+    std::vector<std::thread> threads;
+    for (std::size_t thread_idx = 0; thread_idx != threads_count; ++thread_idx)
+        threads.emplace_back([&] {
+            for (std::size_t i = 0; i != increments_per_thread; ++i)
+                modify(merged, 4, "/counter", ustore_doc_modify_increment_k, "1", ustore_option_write_merge_k);
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    M_EXPECT_EQ_JSON(*merged[ckf(4, "/counter")].value(), std::to_string(threads_count * increments_per_thread));
+    EXPECT_TRUE(db.clear());
+}
+#endif
+
+/**
+ * Fills document collection with info about Alice, Bob and Carl,
+ * sampling it later in a form of a table, using both low-level APIs,
+ * and higher-level compile-time C++ meta-programming abstractions.
+ */
+TEST(db, docs_table) {
+    using json_t = nlohmann::json;
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    // Inject basic data
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto json_alice = R"( { "person": "Alice", "age": 27, "height": 1 } )"_json.dump();
+    auto json_bob = R"( { "person": "Bob", "age": "27", "weight": 2 } )"_json.dump();
+    auto json_carl = R"( { "person": "Carl", "age": 24 } )"_json.dump();
+    collection[1] = json_alice.c_str();
+    collection[2] = json_bob.c_str();
+    collection[3] = json_carl.c_str();
+    M_EXPECT_EQ_JSON(*collection[1].value(), json_alice.c_str());
+    M_EXPECT_EQ_JSON(*collection[2].value(), json_bob.c_str());
+
+    // Just column names
+    {
+        auto maybe_fields = collection[1].gist();
+        auto fields = *maybe_fields;
+
+        std::vector<std::string> parsed;
+        for (auto field : fields)
+            parsed.emplace_back(field.data());
+
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/person"), parsed.end());
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/height"), parsed.end());
+        EXPECT_NE(std::find(parsed.begin(), parsed.end(), "/age"), parsed.end());
+        EXPECT_EQ(std::find(parsed.begin(), parsed.end(), "/weight"), parsed.end());
+    }
+
+    // Single cell
+    {
+        auto header = table_header().with<std::uint32_t>("age");
+        auto maybe_table = collection[1].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_FALSE(col0[0].converted);
+    }
+
+    // Single row
+    {
+        auto header = table_header() //
+                          .with<std::uint32_t>("age")
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("age");
+
+        auto maybe_table = collection[1].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_FALSE(col0[0].converted);
+        EXPECT_EQ(col1[0].value, 27);
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col2[0].value.data(), "27");
+        EXPECT_TRUE(col2[0].converted);
+    }
+
+    // Single column
+    {
+        auto header = table_header().with<std::int32_t>("age");
+        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+    }
+
+    // Single strings column
+    {
+        auto header = table_header().with<std::string_view>("age");
+        auto maybe_table = collection[{1, 2, 3, 123456}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+
+        EXPECT_STREQ(col0[0].value.data(), "27");
+        EXPECT_TRUE(col0[0].converted);
+        EXPECT_STREQ(col0[1].value.data(), "27");
+        EXPECT_STREQ(col0[2].value.data(), "24");
+    }
+
+    // Multi-column
+    {
+        auto header = table_header() //
+                          .with<std::int32_t>("age")
+                          .with<std::string_view>("age")
+                          .with<std::string_view>("person")
+                          .with<float>("person")
+                          .with<std::int32_t>("height")
+                          .with<std::uint64_t>("weight");
+
+        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column<0>();
+        auto col1 = table.column<1>();
+        auto col2 = table.column<2>();
+        auto col3 = table.column<3>();
+        auto col4 = table.column<4>();
+        auto col5 = table.column<5>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+
+        EXPECT_STREQ(col1[0].value.data(), "27");
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col1[1].value.data(), "27");
+        EXPECT_STREQ(col1[2].value.data(), "24");
+    }
+
+    // Multi-column Type-punned exports
+    {
+        table_header_t header {{
+            field_type_t {"age", ustore_doc_field_i32_k},
+            field_type_t {"age", ustore_doc_field_str_k},
+            field_type_t {"person", ustore_doc_field_str_k},
+            field_type_t {"person", ustore_doc_field_f32_k},
+            field_type_t {"height", ustore_doc_field_i32_k},
+            field_type_t {"weight", ustore_doc_field_u64_k},
+        }};
+
+        auto maybe_table = collection[{1, 2, 3, 123456, 654321}].gather(header);
+        auto table = *maybe_table;
+        auto col0 = table.column(0).as<std::int32_t>();
+        auto col1 = table.column(1).as<value_view_t>();
+        auto col2 = table.column(2).as<value_view_t>();
+        auto col3 = table.column(3).as<float>();
+        auto col4 = table.column(4).as<std::int32_t>();
+        auto col5 = table.column(5).as<std::uint64_t>();
+
+        EXPECT_EQ(col0[0].value, 27);
+        EXPECT_EQ(col0[1].value, 27);
+        EXPECT_TRUE(col0[1].converted);
+        EXPECT_EQ(col0[2].value, 24);
+
+        EXPECT_STREQ(col1[0].value.c_str(), "27");
+        EXPECT_TRUE(col1[0].converted);
+        EXPECT_STREQ(col1[1].value.c_str(), "27");
+        EXPECT_STREQ(col1[2].value.c_str(), "24");
+    }
+}
+
+/**
+ * Compresses a collection of similar documents with a trained dictionary,
+ * expecting both the existing and the newly written documents to read back intact.
+ * Both collections hold fewer documents, than are sampled by default.
+ */
+TEST(db, docs_compress) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t count_k = 1000;
+    docs_collection_t collection = db.main<docs_collection_t>();
+    auto make_doc = [](std::size_t i) {
+        return fmt::format(R"({{"person":"User {}","age":{},"address":{{"city":"City {}","zip":"{:05}"}}}})",
+                           i,
+                           20 + i % 50,
+                           i % 7,
+                           i);
+    };
+    for (std::size_t i = 0; i != count_k; ++i)
+        collection[ustore_key_t(i)] = make_doc(i).c_str();
+
+    arena_t arena(db);
+    status_t status;
+    ustore_docs_compress_t compress {};
+    compress.db = db;
+    compress.error = status.member_ptr();
+    compress.arena = arena.member_ptr();
+    compress.collection = ustore_collection_main_k;
+    ustore_docs_compress(&compress);
+    EXPECT_TRUE(status);
+
+    collection[ustore_key_t(count_k)] = make_doc(count_k).c_str();
+    for (std::size_t i = 0; i <= count_k; i += 37)
+        M_EXPECT_EQ_JSON(*collection[ustore_key_t(i)].value(), make_doc(i));
+    M_EXPECT_EQ_JSON(*collection[ckf(ustore_key_t(count_k), "person")].value(), fmt::format("\"User {}\"", count_k));
+    M_EXPECT_EQ_JSON(*collection[ckf(5, "/address/city")].value(), "\"City 5\"");
+
+    // Collections, smaller than the default sample, are compressed as well
+    if (!ustore_supports_named_collections_k)
+        return;
+    docs_collection_t small = db.create<docs_collection_t>("small").throw_or_release();
+    for (std::size_t i = 0; i != 3; ++i)
+        small[ustore_key_t(i)] = make_doc(i).c_str();
+    compress.collection = small;
+    ustore_docs_compress(&compress);
+    EXPECT_TRUE(status);
+    for (std::size_t i = 0; i != 3; ++i)
+        M_EXPECT_EQ_JSON(*small[ustore_key_t(i)].value(), make_doc(i));
+}
+
+/**
+ * Filters documents by their fields on the side of the data,
+ * both scanning the whole collection and gathering a batch of them.
+ */
+TEST(db, docs_filter) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t count_k = 1000;
+    docs_collection_t collection = db.main<docs_collection_t>();
+    for (std::size_t i = 0; i != count_k; ++i)
+        collection[ustore_key_t(i)] =
+            fmt::format(R"({{"person":"User {}","age":{},"address":{{"city":"City {}"}}}})", i, 20 + i % 50, i % 7)
+                .c_str();
+
+    ustore_str_view_t filter = R"(age > 60 AND /address/city == "City 3")";
+    std::vector<ustore_key_t> expected;
+    for (std::size_t i = 0; i != count_k; ++i)
+        if (20 + i % 50 > 60 && i % 7 == 3)
+            expected.push_back(ustore_key_t(i));
+
+    arena_t arena(db);
+    status_t status;
+    ustore_length_t found_count = 0;
+    ustore_key_t* found_keys = nullptr;
+    ustore_docs_scan_t scan {};
+    scan.db = db;
+    scan.error = status.member_ptr();
+    scan.arena = arena.member_ptr();
+    scan.collection = ustore_collection_main_k;
+    scan.start_key = std::numeric_limits<ustore_key_t>::min();
+    scan.count_limit = count_k;
+    scan.filter = filter;
+    scan.count = &found_count;
+    scan.keys = &found_keys;
+    ustore_docs_scan(&scan);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(std::vector<ustore_key_t>(found_keys, found_keys + found_count), expected);
+
+    // Gathering every other document only exports the names of the matching ones
+    std::vector<ustore_key_t> keys;
+    for (std::size_t i = 0; i < count_k; i += 2)
+        keys.push_back(ustore_key_t(i));
+    ustore_str_view_t field = "person";
+    ustore_doc_field_type_t type = ustore_doc_field_str_k;
+    ustore_length_t matches_count = 0;
+    ustore_length_t* matches = nullptr;
+    ustore_octet_t** validities = nullptr;
+    ustore_length_t** offsets = nullptr;
+    ustore_byte_t* strings = nullptr;
+    ustore_docs_gather_t gather {};
+    gather.db = db;
+    gather.error = status.member_ptr();
+    gather.arena = arena.member_ptr();
+    gather.docs_count = keys.size();
+    gather.fields_count = 1;
+    gather.keys = keys.data();
+    gather.keys_stride = sizeof(ustore_key_t);
+    gather.fields = &field;
+    gather.types = &type;
+    gather.filter = filter;
+    gather.matches_count = &matches_count;
+    gather.matches = &matches;
+    gather.columns_validities = &validities;
+    gather.columns_offsets = &offsets;
+    gather.joined_strings = &strings;
+    ustore_docs_gather(&gather);
+    EXPECT_TRUE(status);
+
+    std::size_t expected_idx = 0;
+    for (ustore_length_t match_idx = 0; match_idx != matches_count; ++match_idx) {
+        ustore_key_t key = keys[matches[match_idx]];
+        while (expected_idx != expected.size() && expected[expected_idx] % 2)
+            ++expected_idx;
+        ASSERT_NE(expected_idx, expected.size());
+        EXPECT_EQ(key, expected[expected_idx++]);
+        EXPECT_EQ(std::string_view(reinterpret_cast<char const*>(strings) + offsets[0][match_idx]),
+                  fmt::format("User {}", key));
+    }
+    auto is_even = [](ustore_key_t key) { return key % 2 == 0; };
+    EXPECT_EQ(matches_count, std::count_if(expected.begin(), expected.end(), is_even));
+
+    // Malformed filters are reported
+    scan.filter = "age >";
+    ustore_docs_scan(&scan);
+    EXPECT_FALSE(status);
+}
+
+/**
+ * Keeps a secondary index in sync with inserts, updates and removals,
+ * including values shared by so many documents, that their buckets get paged.
+ */
+TEST(db, docs_index) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t people = db.create<docs_collection_t>("people").throw_or_release();
+    blobs_collection_t ages = db.create("people.age").throw_or_release();
+    EXPECT_TRUE(people.index("age", ustore_doc_field_i64_k, ages));
+
+    // Three ages are shared by thousands of people, while the rest are rare
+    constexpr std::size_t count_k = 15'000;
+    auto age_of = [](std::size_t i) { return i % 100 ? 20 + 10 * (i % 3) : 50 + i / 100 % 10; };
+    for (std::size_t i = 0; i != count_k; ++i)
+        people[ustore_key_t(i)] = fmt::format(R"({{"name":"User {}","age":{}}})", i, age_of(i)).c_str();
+
+    std::map<std::size_t, std::vector<ustore_key_t>> expected;
+    auto expect_found = [&](std::size_t min, std::size_t max) {
+        std::vector<ustore_key_t> keys;
+        for (auto it = expected.lower_bound(min); it != expected.end() && it->first <= max; ++it)
+            keys.insert(keys.end(), it->second.begin(), it->second.end());
+        auto found = people.find("age", std::to_string(min).c_str(), std::to_string(max).c_str()).throw_or_release();
+        EXPECT_EQ(std::vector<ustore_key_t>(found.begin(), found.end()), keys);
+    };
+    auto refill = [&](auto&& is_present, auto&& age) {
+        expected.clear();
+        for (std::size_t i = 0; i != count_k; ++i)
+            if (is_present(i))
+                expected[age(i)].push_back(ustore_key_t(i));
+    };
+
+    refill([](std::size_t) { return true; }, age_of);
+    expect_found(20, 20);
+    expect_found(30, 30);
+    expect_found(25, 55);
+    expect_found(0, 100);
+    EXPECT_EQ(people.find("age", "20", "20", 10)->size(), 10u);
+
+    // Move some people between the crowded ages, and remove others
+    auto new_age_of = [&](std::size_t i) { return i % 10 == 1 && age_of(i) == 20 ? 30 : age_of(i); };
+    auto is_kept = [](std::size_t i) { return i % 7 != 0; };
+    for (std::size_t i = 0; i != count_k; ++i)
+        if (!is_kept(i))
+            EXPECT_TRUE(people[ustore_key_t(i)].erase());
+        else if (new_age_of(i) != age_of(i))
+            people[ustore_key_t(i)] = fmt::format(R"({{"name":"User {}","age":{}}})", i, new_age_of(i)).c_str();
+
+    refill(is_kept, new_age_of);
+    expect_found(20, 20);
+    expect_found(30, 30);
+    expect_found(20, 59);
+    expect_found(51, 51);
+
+    // Dropping the index stops the lookups
+    EXPECT_TRUE(people.index("age", ustore_doc_field_null_k, ages));
+    EXPECT_FALSE(people.find("age", "20", "20"));
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Declares columns on a populated collection, so that they are backfilled, and then overwrites
+ * and removes documents, expecting the gathers of the declared fields to follow every update.
+ */
+TEST(db, docs_columns) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    docs_collection_t people = db.create<docs_collection_t>("people").throw_or_release();
+    blobs_collection_t ages = db.create("people.age").throw_or_release();
+    blobs_collection_t names = db.create("people.name").throw_or_release();
+    constexpr std::size_t count_k = 100;
+    for (std::size_t i = 0; i != count_k; ++i)
+        people[ustore_key_t(i)] = fmt::format(R"({{"name":"User {}","age":{}}})", i, 20 + i).c_str();
+
+    arena_t arena(db);
+    status_t status;
+    ustore_str_view_t fields[] {"age", "name"};
+    ustore_collection_t columns[] {ages, names};
+    ustore_doc_field_type_t* columns_types = nullptr;
+    ustore_docs_columns_t docs_columns {};
+    docs_columns.db = db;
+    docs_columns.error = status.member_ptr();
+    docs_columns.arena = arena.member_ptr();
+    docs_columns.collection = people;
+    docs_columns.fields_count = 2;
+    docs_columns.fields = fields;
+    docs_columns.fields_stride = sizeof(ustore_str_view_t);
+    docs_columns.columns = columns;
+    docs_columns.columns_stride = sizeof(ustore_collection_t);
+    docs_columns.columns_types = &columns_types;
+    ustore_docs_columns(&docs_columns);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(columns_types[0], ustore_doc_field_i64_k);
+    EXPECT_EQ(columns_types[1], ustore_doc_field_str_k);
+
+    // Remove every fifth document, and rename and age every third of the rest
+    auto is_kept = [](std::size_t i) { return i % 5 != 0; };
+    auto is_changed = [](std::size_t i) { return i % 3 == 0; };
+    for (std::size_t i = 0; i != count_k; ++i)
+        if (!is_kept(i))
+            EXPECT_TRUE(people[ustore_key_t(i)].erase());
+        else if (is_changed(i))
+            people[ustore_key_t(i)] = fmt::format(R"({{"name":"Renamed {}","age":{}}})", i, 70 + i).c_str();
+
+    std::vector<ustore_key_t> keys(count_k);
+    std::iota(keys.begin(), keys.end(), 0);
+    auto header = table_header().with<std::int64_t>("age").with<std::string_view>("name");
+    auto table = people[keys].gather(header).throw_or_release();
+    auto ages_column = table.column<0>();
+    auto names_column = table.column<1>();
+    for (std::size_t i = 0; i != count_k; ++i) {
+        EXPECT_EQ(ages_column[i].valid, is_kept(i));
+        EXPECT_EQ(names_column[i].valid, is_kept(i));
+        if (!is_kept(i))
+            continue;
+        EXPECT_EQ(ages_column[i].value, std::int64_t(is_changed(i) ? 70 + i : 20 + i));
+        EXPECT_EQ(names_column[i].value, fmt::format("{} {}", is_changed(i) ? "Renamed" : "User", i));
+    }
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Gathers the same fields of hot documents repeatedly through the cache of extracted fields,
+ * expecting the following gathers and field reads to see the fields overwritten in between.
+ */
+TEST(db, docs_cache) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t count_k = 10;
+    docs_collection_t collection = db.main<docs_collection_t>();
+    for (std::size_t i = 0; i != count_k; ++i)
+        collection[ustore_key_t(i)] = fmt::format(R"({{"name":"User {}","age":{}}})", i, 20 + i).c_str();
+
+    std::vector<ustore_key_t> keys(count_k);
+    std::iota(keys.begin(), keys.end(), 0);
+    ustore_str_view_t fields[] {"age", "name"};
+    ustore_doc_field_type_t types[] {ustore_doc_field_i64_k, ustore_doc_field_str_k};
+    auto expect_gathered = [&](auto&& age_of, auto&& name_of) {
+        arena_t arena(db);
+        status_t status;
+        ustore_octet_t** validities = nullptr;
+        ustore_byte_t** scalars = nullptr;
+        ustore_length_t** offsets = nullptr;
+        ustore_byte_t* strings = nullptr;
+        ustore_docs_gather_t gather {};
+        gather.db = db;
+        gather.error = status.member_ptr();
+        gather.arena = arena.member_ptr();
+        gather.options = ustore_option_docs_cache_k;
+        gather.docs_count = keys.size();
+        gather.fields_count = 2;
+        gather.keys = keys.data();
+        gather.keys_stride = sizeof(ustore_key_t);
+        gather.fields = fields;
+        gather.fields_stride = sizeof(ustore_str_view_t);
+        gather.types = types;
+        gather.types_stride = sizeof(ustore_doc_field_type_t);
+        gather.columns_validities = &validities;
+        gather.columns_scalars = &scalars;
+        gather.columns_offsets = &offsets;
+        gather.joined_strings = &strings;
+        ustore_docs_gather(&gather);
+        EXPECT_TRUE(status);
+        for (std::size_t i = 0; i != count_k; ++i) {
+            EXPECT_TRUE(bits_view_t {validities[0]}[i]);
+            EXPECT_EQ(reinterpret_cast<std::int64_t const*>(scalars[0])[i], age_of(i));
+            EXPECT_EQ(std::string_view(reinterpret_cast<char const*>(strings) + offsets[1][i]), name_of(i));
+        }
+
+        // Single fields are served from the same cache
+        ustore_length_t* read_offsets = nullptr;
+        ustore_length_t* read_lengths = nullptr;
+        ustore_bytes_ptr_t read_values = nullptr;
+        ustore_docs_read_t read {};
+        read.db = db;
+        read.error = status.member_ptr();
+        read.arena = arena.member_ptr();
+        read.options = ustore_option_docs_cache_k;
+        read.type = ustore_doc_field_json_k;
+        read.tasks_count = keys.size();
+        read.keys = keys.data();
+        read.keys_stride = sizeof(ustore_key_t);
+        read.fields = fields;
+        read.fields_stride = 0;
+        read.offsets = &read_offsets;
+        read.lengths = &read_lengths;
+        read.values = &read_values;
+        ustore_docs_read(&read);
+        EXPECT_TRUE(status);
+        auto read_begin = reinterpret_cast<char const*>(read_values);
+        for (std::size_t i = 0; i != count_k; ++i) {
+            std::string_view age {read_begin + read_offsets[i], read_lengths[i]};
+            M_EXPECT_EQ_JSON(age, std::to_string(age_of(i)));
+        }
+    };
+
+    auto age_of = [](std::size_t i) { return std::int64_t(20 + i); };
+    auto name_of = [](std::size_t i) { return fmt::format("User {}", i); };
+    expect_gathered(age_of, name_of);
+    expect_gathered(age_of, name_of);
+
+    // Overwrite the ages of odd documents with longer numbers, and rename every third one
+    auto new_age_of = [](std::size_t i) { return std::int64_t(i % 2 ? 1000 + i : 20 + i); };
+    auto new_name_of = [](std::size_t i) { return fmt::format("{} {}", i % 3 ? "User" : "Renamed", i); };
+    for (std::size_t i = 0; i != count_k; ++i)
+        if (new_age_of(i) != age_of(i) || new_name_of(i) != name_of(i))
+            collection[ustore_key_t(i)] =
+                fmt::format(R"({{"name":"{}","age":{}}})", new_name_of(i), new_age_of(i)).c_str();
+    expect_gathered(new_age_of, new_name_of);
+    expect_gathered(new_age_of, new_name_of);
+    EXPECT_TRUE(db.clear());
+}
+
+#pragma region Graph Modality
+
+edge_t make_edge(ustore_key_t edge_id, ustore_key_t v1, ustore_key_t v2) {
+    return {v1, v2, edge_id};
+}
+
+std::vector<edge_t> make_edges(std::size_t vertices_count = 2, std::size_t next_connect = 1) {
+    std::vector<edge_t> es;
+    ustore_key_t edge_id = 0;
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        ustore_key_t connect_with = vertex_id + next_connect;
+        while (connect_with < vertices_count) {
+            edge_id++;
+            es.push_back(make_edge(edge_id, vertex_id, connect_with));
+            connect_with = connect_with + next_connect;
+        }
+    }
+    return es;
+}
+
+/**
+ * Upserts disconnected vertices into the graph.
+ */
+TEST(db, graph_upsert_vertices) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    std::vector<ustore_key_t> vertices {1, 4, 5, 2};
+    EXPECT_TRUE(net.upsert_vertices(vertices));
+
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_TRUE(*net.contains(4));
+    EXPECT_TRUE(*net.contains(5));
+}
+
+/**
+ * Upserts an edge and its member vertices into the graph.
+ */
+TEST(db, graph_upsert_edge) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+    edge_t edge {1, 2, 9};
+    EXPECT_TRUE(net.upsert_edge(edge));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(3));
+
+    auto neighbors = net.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 1);
+    EXPECT_EQ(neighbors[0], 2);
+}
+
+/**
+ * Tests "Graphs" Modality, with on of the simplest network designs - a triangle.
+ * Three vertices, three connections between them, forming 3 undirected, or 6 directed edges.
+ * Tests edge upserts, existence checks, degree computation, vertex removals.
+ */
+TEST(db, graph_triangle) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    // triangle
+    edge_t edge1 {1, 2, 9};
+    edge_t edge2 {2, 3, 10};
+    edge_t edge3 {3, 1, 11};
+
+    EXPECT_TRUE(net.upsert_edge(edge1));
+    EXPECT_TRUE(net.upsert_edge(edge2));
+    EXPECT_TRUE(net.upsert_edge(edge3));
+
+    auto neighbors = net.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 2);
+    EXPECT_EQ(neighbors[1], 3);
+
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(9));
+    EXPECT_FALSE(*net.contains(10));
+    EXPECT_FALSE(*net.contains(1000));
+
+    EXPECT_EQ(*net.degree(1), 2u);
+    EXPECT_EQ(*net.degree(2), 2u);
+    EXPECT_EQ(*net.degree(3), 2u);
+    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+
+    EXPECT_TRUE(net.edges_containing(1));
+    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+
+    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
+    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+
+    // Check scans
+    EXPECT_TRUE(net.edges());
+    {
+        std::vector<edge_t> expected_edges {edge1, edge2, edge3};
+        std::vector<edge_t> exported_edges;
+
+        auto present_edges = *net.edges(ustore_vertex_source_k);
+        auto present_it = std::move(present_edges).begin();
+        auto count_results = 0;
+        while (!present_it.is_end()) {
+            exported_edges.push_back(*present_it);
+            ++present_it;
+            ++count_results;
+        }
+        EXPECT_EQ(count_results, 3);
+        EXPECT_EQ(exported_edges, expected_edges);
+    }
+
+    // Remove a single edge, making sure that the nodes info persists
+    EXPECT_TRUE(net.remove_edges({
+        {{&edge1.source_id}, 1},
+        {{&edge1.target_id}, 1},
+        {{&edge1.id}, 1},
+    }));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+
+    // Bring that edge back
+    EXPECT_TRUE(net.upsert_edges({
+        {{&edge1.source_id}, 1},
+        {{&edge1.target_id}, 1},
+        {{&edge1.id}, 1},
+    }));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+
+    // Remove a vertex
+    ustore_key_t vertex_to_remove = 2;
+    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
+    EXPECT_FALSE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+
+    // Bring back the whole graph
+    EXPECT_TRUE(net.upsert_edge(edge1));
+    EXPECT_TRUE(net.upsert_edge(edge2));
+    EXPECT_TRUE(net.upsert_edge(edge3));
+    EXPECT_TRUE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+}
+
+/**
+ * Further complicates the `graph_triangle` test by performing all of the updates
+ * and lookups in batches. This detects inconsistencies in concurrent updates to
+ * the underlying binary representation, triggered from a single high-level
+ * graph operation.
+ */
+TEST(db, graph_triangle_batch) {
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    blobs_collection_t main = db.main();
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    std::vector<edge_t> triangle {
+        {1, 2, 9},
+        {2, 3, 10},
+        {3, 1, 11},
+    };
+
+    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_FALSE(*net.contains(9));
+    EXPECT_FALSE(*net.contains(10));
+    EXPECT_FALSE(*net.contains(1000));
+
+    EXPECT_EQ(*net.degree(1), 2u);
+    EXPECT_EQ(*net.degree(2), 2u);
+    EXPECT_EQ(*net.degree(3), 2u);
+    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
+    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+
+    EXPECT_TRUE(net.edges_containing(1));
+    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+
+    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
+    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
+    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
+    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+
+    // Check scans
+    EXPECT_TRUE(net.edges());
+    {
+        std::vector<edge_t> expected_edges {triangle.begin(), triangle.end()};
+        std::vector<edge_t> exported_edges;
+
+        auto present_edges = *net.edges(ustore_vertex_source_k);
+        auto present_it = std::move(present_edges).begin();
+        size_t count_results = 0ul;
+        while (!present_it.is_end()) {
+            exported_edges.push_back(*present_it);
+            ++present_it;
+            ++count_results;
+        }
+        EXPECT_EQ(count_results, triangle.size());
+        EXPECT_EQ(exported_edges, expected_edges);
+    }
+
+    // Remove a single edge, making sure that the nodes info persists
+    EXPECT_TRUE(net.remove_edges(edges_view_t {
+        {{&triangle[0].source_id}, 1},
+        {{&triangle[0].target_id}, 1},
+        {{&triangle[0].id}, 1},
+    }));
+    EXPECT_TRUE(*net.contains(1));
+    EXPECT_TRUE(*net.contains(2));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+
+    // Bring that edge back
+    EXPECT_TRUE(net.upsert_edges(edges_view_t {
+        {{&triangle[0].source_id}, 1},
+        {{&triangle[0].target_id}, 1},
+        {{&triangle[0].id}, 1},
+    }));
+    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+
+    // Remove a vertex
+    ustore_key_t vertex_to_remove = 2;
+    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
+    EXPECT_FALSE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+
+    // Bring back the whole graph
+    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
+    EXPECT_TRUE(*net.contains(vertex_to_remove));
+    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
+    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
+    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+}
+
+/**
+ * Tries to make a transaction on a graph, that must fail to `commit`.
+ * Creates a "wedge": A-B-C. If a transaction changes the B-C edge,
+ * while A-B is updated externally, the commit will fail.
+ */
+TEST(db, graph_transaction_watch) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+    graph_collection_t net = db.main<graph_collection_t>();
+
+    edge_t edge_ab {'A', 'B', 19};
+    edge_t edge_bc {'B', 'C', 31};
+    EXPECT_TRUE(net.upsert_edge(edge_ab));
+    EXPECT_TRUE(net.upsert_edge(edge_bc));
+
+    transaction_t txn = *db.transact();
+    graph_collection_t txn_net = txn.main<graph_collection_t>();
+    EXPECT_EQ(txn_net.degree('B'), 2);
+    EXPECT_TRUE(txn_net.remove_edge(edge_bc));
+    EXPECT_TRUE(net.remove_edge(edge_ab));
+
+    EXPECT_FALSE(txn.commit());
+}
+
+/**
+ * Constructs a larger graph, validating the degrees in a resulting network afterward.
+ */
+TEST(db, graph_random_fill) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_EQ(*graph.degree(vertex_id), 9u);
+    }
+}
+
+/**
+ * Inserts two edges with a shared vertex in two separate transactions.
+ * The latter insert must fail, as it depends on the preceding state of the vertex.
+ */
+TEST(db, graph_conflicting_transactions) {
+    if (!ustore_supports_transactions_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    transaction_t txn = *db.transact();
+    graph_collection_t txn_net = txn.main<graph_collection_t>();
+    transaction_t txn2 = *db.transact();
+    graph_collection_t txn_net2 = txn2.main<graph_collection_t>();
+
+    edge_t edge4 {4, 5, 15};
+    edge_t edge5 {5, 6, 16};
+
+    EXPECT_TRUE(txn_net.upsert_edge(edge4));
+    EXPECT_TRUE(txn_net2.upsert_edge(edge5));
+    EXPECT_TRUE(txn.commit());
+    EXPECT_FALSE(txn2.commit());
+}
+
+/**
+ * Takes a single Graph Store and populates it with various 5-vertex shapes:
+ * a star, a pentagon, and five self-loops.
+ */
+TEST(db, graph_layering_shapes) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    std::vector<ustore_key_t> vertices = {1, 2, 3, 4, 5};
+    auto over_the_vertices = [&](bool exist, size_t degree) {
+        for (auto& vertex_id : vertices) {
+            EXPECT_EQ(*graph.contains(vertex_id), exist);
+            EXPECT_EQ(*graph.degree(vertex_id), degree);
+        }
+    };
+
+    // Before insertions, the graph is empty.
+    over_the_vertices(false, 0);
+
+    std::vector<edge_t> star {
+        {1, 3, 1},
+        {1, 4, 2},
+        {2, 4, 3},
+        {2, 5, 4},
+        {3, 5, 5},
+    };
+    std::vector<edge_t> pentagon {
+        {1, 2, 6},
+        {2, 3, 7},
+        {3, 4, 8},
+        {4, 5, 9},
+        {5, 1, 10},
+    };
+    std::vector<edge_t> self_loops {
+        {1, 1, 11},
+        {2, 2, 12},
+        {3, 3, 13},
+        {4, 4, 14},
+        {5, 5, 15},
+    };
+
+    EXPECT_TRUE(graph.upsert_edges(edges(star)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.remove_edges(edges(star)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(star)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
+    over_the_vertices(true, 4u);
+    EXPECT_TRUE(graph.upsert_edges(edges(self_loops)));
+    over_the_vertices(true, 6u);
+    EXPECT_TRUE(graph.remove_edges(edges(star)));
+    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
+    over_the_vertices(true, 2u);
+    EXPECT_TRUE(graph.remove_edges(edges(self_loops)));
+    over_the_vertices(true, 0);
+    EXPECT_TRUE(db.clear());
+    over_the_vertices(false, 0);
+}
+
+/**
+ * Tests vertex removals, which are the hardest operations on Graphs,
+ * as they trigger updates in all nodes connected to the removed one.
+ */
+TEST(db, graph_remove_vertices) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
+        EXPECT_TRUE(graph.remove_vertex(vertex_id));
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_FALSE(*graph.contains(vertex_id));
+    }
+
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    std::vector<ustore_key_t> vertices(vertices_count);
+    std::iota(vertices.begin(), vertices.end(), 0);
+    EXPECT_TRUE(graph.remove_vertices(vertices));
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_FALSE(*graph.contains(vertex_id));
+    }
+}
+
+/**
+ * Removes vertices lazily, checking that their neighbors stop seeing them at once,
+ * and that the buried vertices can be recreated without resurrecting the old edges.
+ */
+TEST(db, graph_remove_vertices_lazy) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 10;
+    auto edges_vec = make_edges(vertices_count, 1);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+
+    ustore_key_t const buried[] = {0};
+    EXPECT_TRUE(graph.remove_vertices({{buried}, 1}, {}, false, true));
+    EXPECT_FALSE(*graph.contains(0));
+    EXPECT_EQ(*graph.degree(1), 8u);
+    auto neighbors = graph.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 8u);
     EXPECT_EQ(neighbors[0], 2);
-    EXPECT_EQ(neighbors[1], 3);
 
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(9));
-    EXPECT_FALSE(*net.contains(10));
-    EXPECT_FALSE(*net.contains(1000));
+    // Recreating the vertex purges its old edges first
+    EXPECT_TRUE(graph.upsert_edge(edge_t {0, 5, 100}));
+    EXPECT_EQ(*graph.degree(0), 1u);
+    EXPECT_EQ(*graph.degree(5), 9u);
+    EXPECT_EQ(*graph.degree(1), 8u);
+
+    // Removing a buried vertex again completes its removal
+    ustore_key_t const reburied[] = {2};
+    EXPECT_TRUE(graph.remove_vertices({{reburied}, 1}, {}, false, true));
+    EXPECT_EQ(*graph.degree(3), 7u);
+    EXPECT_TRUE(graph.remove_vertex(2));
+    EXPECT_FALSE(*graph.contains(2));
+    EXPECT_EQ(*graph.degree(3), 7u);
+    EXPECT_TRUE(graph.upsert_edge(edge_t {2, 3, 200}));
+    EXPECT_EQ(*graph.degree(2), 1u);
+    EXPECT_EQ(*graph.degree(3), 8u);
+}
 
-    EXPECT_EQ(*net.degree(1), 2u);
-    EXPECT_EQ(*net.degree(2), 2u);
-    EXPECT_EQ(*net.degree(3), 2u);
-    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+/**
+ * Grows a hub vertex past a single chunk of neighborships, splitting, emptying
+ * and burying its chunks. Those must live in a sibling collection, leaving every
+ * key of the graph collection free for vertices, including the largest ones.
+ */
+TEST(db, graph_hub_chunks) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+    blobs_collection_t main = db.main();
+    ustore_key_t const hub = std::numeric_limits<ustore_key_t>::max() - 5;
+    auto spokes = [&](ustore_key_t first, ustore_key_t last) {
+        std::vector<edge_t> es;
+        for (ustore_key_t i = first; i != last; ++i)
+            es.push_back(edge_t {hub, i + 100, i});
+        return es;
+    };
+
+    // Promotion into a hub, and splits of its chunks
+    auto first_edges = spokes(0, 10'000);
+    EXPECT_TRUE(graph.upsert_edges(edges(first_edges)));
+    EXPECT_TRUE(*db.contains("ustore.graph"));
+    blobs_collection_t chunks = *db.find("ustore.graph");
+    std::size_t const promoted_chunks = chunks.keys().size();
+    EXPECT_GT(promoted_chunks, 2u);
+    auto more_edges = spokes(10'000, 30'000);
+    EXPECT_TRUE(graph.upsert_edges(edges(more_edges)));
+    std::size_t const split_chunks = chunks.keys().size();
+    EXPECT_GT(split_chunks, promoted_chunks);
+    EXPECT_EQ(*graph.degree(hub, ustore_vertex_source_k), 30'000u);
+    EXPECT_EQ(main.keys().size(), 30'001u);
+    EXPECT_EQ(graph.successors(hub)->size(), 30'000u);
+
+    // Emptied chunks are removed
+    auto removed_edges = spokes(0, 25'000);
+    EXPECT_TRUE(graph.remove_edges(edges(removed_edges)));
+    EXPECT_LT(chunks.keys().size(), split_chunks);
+    EXPECT_EQ(*graph.degree(hub, ustore_vertex_source_k), 5'000u);
+    EXPECT_EQ(*graph.degree(150), 0u);
+    auto successors = *graph.successors(hub);
+    EXPECT_EQ(successors[0], 25'100);
+
+    // Burying a neighbor hides it from the hub, burying the hub drops its chunks
+    EXPECT_TRUE(graph.remove_vertices({{&successors[0]}, 1}, {}, false, true));
+    EXPECT_EQ(*graph.degree(hub, ustore_vertex_source_k), 4'999u);
+    EXPECT_TRUE(graph.remove_vertices({{&hub}, 1}, {}, false, true));
+    EXPECT_FALSE(*graph.contains(hub));
+    EXPECT_EQ(*graph.degree(25'200), 0u);
+    EXPECT_TRUE(graph.upsert_edge(edge_t {hub, 1, 1}));
+    EXPECT_EQ(*graph.degree(hub), 1u);
+    EXPECT_EQ(*graph.degree(25'200), 0u);
+    EXPECT_EQ(*graph.degree(1), 1u);
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Mixes vertices with compact, varint-encoded neighbor lists and regular ones,
+ * including negative and distant IDs, checking that they round-trip through
+ * upserts and removals with and without the compacting option.
+ */
+TEST(db, graph_compact_mixed) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+    blobs_collection_t main = db.main();
+    ustore_key_t const far = ustore_key_t(1) << 40;
+
+    // Identical stars, but only the second one is compact
+    std::vector<edge_t> regular_star, compact_star;
+    for (ustore_key_t i = 1; i != 11; ++i) {
+        regular_star.push_back(edge_t {100, 100 + i});
+        compact_star.push_back(edge_t {200, 200 + i});
+    }
+    EXPECT_TRUE(graph.upsert_edges(edges(regular_star)));
+    EXPECT_TRUE(graph.upsert_edges(edges(compact_star), true));
+    EXPECT_LT(main[200].value()->size(), main[100].value()->size() / 4);
+    EXPECT_EQ(*graph.degree(200), 10u);
+    EXPECT_EQ(graph.successors(200)->size(), 10u);
+    EXPECT_EQ((*graph.predecessors(205))[0], 200);
+
+    std::vector<edge_t> regular_edges {{1, 2}, {1, 3, 10}, {2, 3, 11}, {-5, 1}};
+    std::vector<edge_t> compact_edges {{1, 4, 12}, {1, far}, {-5, -1'000'000, 13}};
+    EXPECT_TRUE(graph.upsert_edges(edges(regular_edges)));
+    EXPECT_TRUE(graph.upsert_edges(edges(compact_edges), true));
+    auto neighbors = *graph.neighbors(1);
+    std::vector<ustore_key_t> expected {-5, 2, 3, 4, far};
+    EXPECT_TRUE(std::equal(neighbors.begin(), neighbors.end(), expected.begin(), expected.end()));
+    EXPECT_EQ(graph.edges_between(1, 3)->edge_ids[0], 10);
+    EXPECT_EQ(graph.edges_between(1, 4)->edge_ids[0], 12);
+    EXPECT_EQ(graph.edges_between(-5, -1'000'000)->edge_ids[0], 13);
+    EXPECT_EQ(graph.edges_between(1, far)->edge_ids[0], ustore_default_edge_id_k);
+
+    // Compact vertices remain readable after regular updates
+    EXPECT_TRUE(graph.upsert_edge(edge_t {1, 5}));
+    EXPECT_EQ(*graph.degree(1), 6u);
+    EXPECT_EQ(*graph.degree(5), 1u);
+
+    // Removals from compact vertices
+    std::vector<edge_t> removed_edges {{1, far}, {-5, -1'000'000, 13}};
+    EXPECT_TRUE(graph.remove_edges(edges(removed_edges)));
+    EXPECT_EQ(*graph.degree(far), 0u);
+    EXPECT_TRUE(*graph.contains(-1'000'000));
+    EXPECT_EQ(*graph.degree(-5), 1u);
+    EXPECT_TRUE(graph.remove_vertex(4));
+    neighbors = *graph.neighbors(1);
+    expected = {-5, 2, 3, 5};
+    EXPECT_TRUE(std::equal(neighbors.begin(), neighbors.end(), expected.begin(), expected.end()));
+    EXPECT_EQ(graph.edges_between(1, 3)->edge_ids[0], 10);
+    EXPECT_TRUE(graph.remove_edges(edges(compact_star)));
+    EXPECT_EQ(*graph.degree(200), 0u);
+    EXPECT_EQ(*graph.degree(205), 0u);
+    EXPECT_TRUE(db.clear());
+}
+
+/**
+ * Removes just the known list of edges, checking that vertices remain
+ * in the graph, even though entirely disconnected.
+ */
+TEST(db, graph_remove_edges_keep_vertices) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    EXPECT_TRUE(graph.remove_edges(edges(edges_vec)));
+
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
+    }
+}
+/**
+ * Add edges to the graph. Checks how many edges each vertex has.
+ * Then remove the edges, making sure that the vertices aren't
+ * connected to each other anymore.
+ */
+TEST(db, graph_get_vertex_edges) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 1000;
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+
+    std::vector<edge_t> received_edges;
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        auto es = *graph.edges_containing(vertex_id);
+        EXPECT_EQ(es.size(), 9u);
+        for (size_t i = 0; i != es.size(); ++i)
+            received_edges.push_back(es[i]);
+    }
+    EXPECT_TRUE(graph.remove_edges(edges(received_edges)));
+
+    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
+        EXPECT_TRUE(graph.contains(vertex_id));
+        EXPECT_TRUE(*graph.contains(vertex_id));
+        EXPECT_EQ(graph.edges_containing(vertex_id)->size(), 0);
+    }
+}
+
+/**
+ * Getting the degrees of multiple vertices simultaneously.
+ */
+TEST(db, graph_degrees) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+
+    constexpr std::size_t vertices_count = 1000;
+    std::vector<ustore_key_t> vertices(vertices_count);
+    std::iota(vertices.begin(), vertices.end(), 0);
+
+    auto edges_vec = make_edges(vertices_count, 100);
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+
+    auto degrees = *graph.degrees(strided_range(vertices).immutable());
+    EXPECT_EQ(degrees.size(), vertices_count);
+}
 
-    EXPECT_TRUE(net.edges_containing(1));
-    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+TEST(db, graph_neighbors) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
-    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+    graph_collection_t graph = db.main<graph_collection_t>();
+    edge_t edge1 {1, 1, 17};
+    edge_t edge2 {1, 2, 15};
+    edge_t edge3 {2, 3, 16};
 
-    // Check scans
-    EXPECT_TRUE(net.edges());
-    {
-        std::vector<edge_t> expected_edges {edge1, edge2, edge3};
-        std::vector<edge_t> exported_edges;
+    EXPECT_TRUE(graph.upsert_edge(edge1));
+    EXPECT_TRUE(graph.upsert_edge(edge2));
+    EXPECT_TRUE(graph.upsert_edge(edge3));
 
-        auto present_edges = *net.edges(ustore_vertex_source_k);
-        auto present_it = std::move(present_edges).begin();
-        auto count_results = 0;
-        while (!present_it.is_end()) {
-            exported_edges.push_back(*present_it);
-            ++present_it;
-            ++count_results;
-        }
-        EXPECT_EQ(count_results, 3);
-        EXPECT_EQ(exported_edges, expected_edges);
-    }
+    auto neighbors = graph.neighbors(1).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 1);
+    EXPECT_EQ(neighbors[1], 2);
 
-    // Remove a single edge, making sure that the nodes info persists
-    EXPECT_TRUE(net.remove_edges({
-        {{&edge1.source_id}, 1},
-        {{&edge1.target_id}, 1},
-        {{&edge1.id}, 1},
-    }));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+    neighbors = graph.neighbors(2).throw_or_release();
+    EXPECT_EQ(neighbors.size(), 2);
+    EXPECT_EQ(neighbors[0], 1);
+    EXPECT_EQ(neighbors[1], 3);
+}
 
-    // Bring that edge back
-    EXPECT_TRUE(net.upsert_edges({
-        {{&edge1.source_id}, 1},
-        {{&edge1.target_id}, 1},
-        {{&edge1.id}, 1},
-    }));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+struct analyzed_graph_t {
+    std::vector<ustore_key_t> vertices;
+    std::vector<ustore_float_t> scores;
+    std::vector<ustore_key_t> labels;
+};
 
-    // Remove a vertex
-    ustore_key_t vertex_to_remove = 2;
-    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
-    EXPECT_FALSE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+static analyzed_graph_t analyze_graph(database_t& db, ustore_graph_algorithm_t algorithm) {
+    arena_t arena(db);
+    status_t status;
+    ustore_size_t count = 0;
+    ustore_key_t* vertices = nullptr;
+    ustore_float_t* scores = nullptr;
+    ustore_key_t* labels = nullptr;
+
+    ustore_graph_analyze_t analyze {};
+    analyze.db = db;
+    analyze.error = status.member_ptr();
+    analyze.arena = arena.member_ptr();
+    analyze.collection = ustore_collection_main_k;
+    analyze.algorithm = algorithm;
+    analyze.threads_count = 2;
+    analyze.count = &count;
+    analyze.vertices = &vertices;
+    analyze.scores = &scores;
+    analyze.labels = &labels;
+    ustore_graph_analyze(&analyze);
+    EXPECT_TRUE(status);
 
-    // Bring back the whole graph
-    EXPECT_TRUE(net.upsert_edge(edge1));
-    EXPECT_TRUE(net.upsert_edge(edge2));
-    EXPECT_TRUE(net.upsert_edge(edge3));
-    EXPECT_TRUE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+    analyzed_graph_t analyzed;
+    analyzed.vertices.assign(vertices, vertices + count);
+    if (algorithm == ustore_graph_pagerank_k)
+        analyzed.scores.assign(scores, scores + count);
+    else
+        analyzed.labels.assign(labels, labels + count);
+    return analyzed;
 }
 
 /**
- * Further complicates the `graph_triangle` test by performing all of the updates
- * and lookups in batches. This detects inconsistencies in concurrent updates to
- * the underlying binary representation, triggered from a single high-level
- * graph operation.
+ * Compares PageRank against the reference results of NetworkX on a small
+ * directed graph, where the mass of the dangling vertices is spread evenly.
  */
-TEST(db, graph_triangle_batch) {
+TEST(db, graph_pagerank) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    graph_collection_t graph = db.main<graph_collection_t>();
+    std::vector<edge_t> edges_vec {{1, 2, 1}, {1, 3, 2}, {2, 3, 3}, {3, 1, 4}, {4, 3, 5}};
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    EXPECT_TRUE(graph.upsert_vertex(5));
+
+    auto analyzed = analyze_graph(db, ustore_graph_pagerank_k);
+    std::vector<ustore_key_t> expected_vertices {1, 2, 3, 4, 5};
+    std::vector<ustore_float_t> expected_scores {0.359062, 0.188746, 0.379903, 0.036145, 0.036145};
+    EXPECT_EQ(analyzed.vertices, expected_vertices);
+    ASSERT_EQ(analyzed.scores.size(), expected_scores.size());
+    for (std::size_t i = 0; i != expected_scores.size(); ++i)
+        EXPECT_NEAR(analyzed.scores[i], expected_scores[i], 1e-4);
+    EXPECT_TRUE(db.clear());
+}
 
+/**
+ * Labels the weakly connected components, including an isolated vertex,
+ * by the smallest vertex ID within each.
+ */
+TEST(db, graph_connected_components) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    blobs_collection_t main = db.main();
-    graph_collection_t net = db.main<graph_collection_t>();
+    graph_collection_t graph = db.main<graph_collection_t>();
+    std::vector<edge_t> edges_vec {{1, 2, 1}, {2, 3, 2}, {3, 1, 3}, {11, 10, 4}};
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    EXPECT_TRUE(graph.upsert_vertex(20));
 
-    std::vector<edge_t> triangle {
-        {1, 2, 9},
-        {2, 3, 10},
-        {3, 1, 11},
-    };
+    auto analyzed = analyze_graph(db, ustore_graph_components_k);
+    std::vector<ustore_key_t> expected_vertices {1, 2, 3, 10, 11, 20};
+    std::vector<ustore_key_t> expected_labels {1, 1, 1, 10, 10, 20};
+    EXPECT_EQ(analyzed.vertices, expected_vertices);
+    EXPECT_EQ(analyzed.labels, expected_labels);
+    EXPECT_TRUE(db.clear());
+}
 
-    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_FALSE(*net.contains(9));
-    EXPECT_FALSE(*net.contains(10));
-    EXPECT_FALSE(*net.contains(1000));
+/**
+ * Splits two cliques, joined by a single bridge, into two Louvain communities.
+ */
+TEST(db, graph_communities) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    EXPECT_EQ(*net.degree(1), 2u);
-    EXPECT_EQ(*net.degree(2), 2u);
-    EXPECT_EQ(*net.degree(3), 2u);
-    EXPECT_EQ(*net.degree(1, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(2, ustore_vertex_source_k), 1u);
-    EXPECT_EQ(*net.degree(3, ustore_vertex_source_k), 1u);
+    graph_collection_t graph = db.main<graph_collection_t>();
+    std::vector<edge_t> edges_vec {{4, 11, 999}};
+    for (ustore_key_t first : {1, 11})
+        for (ustore_key_t i = 0; i != 4; ++i)
+            for (ustore_key_t j = i + 1; j != 4; ++j)
+                edges_vec.push_back(edge_t {first + i, first + j, first * 100 + i * 10 + j});
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
 
-    EXPECT_TRUE(net.edges_containing(1));
-    EXPECT_EQ(net.edges_containing(1)->size(), 2ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(1, ustore_vertex_target_k)->size(), 1ul);
+    auto analyzed = analyze_graph(db, ustore_graph_communities_k);
+    std::vector<ustore_key_t> expected_vertices {1, 2, 3, 4, 11, 12, 13, 14};
+    std::vector<ustore_key_t> expected_labels {1, 1, 1, 1, 11, 11, 11, 11};
+    EXPECT_EQ(analyzed.vertices, expected_vertices);
+    EXPECT_EQ(analyzed.labels, expected_labels);
+    EXPECT_TRUE(db.clear());
+}
 
-    EXPECT_EQ(net.edges_containing(3, ustore_vertex_target_k)->size(), 1ul);
-    EXPECT_EQ(net.edges_containing(2, ustore_vertex_source_k)->size(), 1ul);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].source_id, 2);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].target_id, 3);
-    EXPECT_EQ((*net.edges_containing(3, ustore_vertex_target_k))[0].id, 10);
-    EXPECT_EQ(net.edges_between(3, 1)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(1, 3)->size(), 0ul);
+struct traversed_graph_t {
+    /** @brief Vertices first reached on every hop, starting from the deduplicated starts. */
+    std::vector<std::vector<ustore_key_t>> vertices;
+    /** @brief Sorted IDs of edges found on every hop, counting from one. */
+    std::vector<std::vector<ustore_key_t>> edges;
+};
 
-    // Check scans
-    EXPECT_TRUE(net.edges());
-    {
-        std::vector<edge_t> expected_edges {triangle.begin(), triangle.end()};
-        std::vector<edge_t> exported_edges;
+static traversed_graph_t traverse_graph( //
+    database_t& db,
+    std::vector<ustore_key_t> const& starts,
+    std::size_t hops,
+    ustore_vertex_role_t role,
+    std::size_t frontier_limit = 0,
+    bool revisit = false) {
 
-        auto present_edges = *net.edges(ustore_vertex_source_k);
-        auto present_it = std::move(present_edges).begin();
-        size_t count_results = 0ul;
-        while (!present_it.is_end()) {
-            exported_edges.push_back(*present_it);
-            ++present_it;
-            ++count_results;
-        }
-        EXPECT_EQ(count_results, triangle.size());
-        EXPECT_EQ(exported_edges, expected_edges);
+    arena_t arena(db);
+    status_t status;
+    ustore_length_t* vertices_offsets = nullptr;
+    ustore_key_t* vertices = nullptr;
+    ustore_length_t* edges_offsets = nullptr;
+    ustore_key_t* edges = nullptr;
+
+    ustore_graph_traverse_t traverse {};
+    traverse.db = db;
+    traverse.error = status.member_ptr();
+    traverse.arena = arena.member_ptr();
+    traverse.collection = ustore_collection_main_k;
+    traverse.starts_count = starts.size();
+    traverse.starts = starts.data();
+    traverse.starts_stride = sizeof(ustore_key_t);
+    traverse.hops = hops;
+    traverse.role = role;
+    traverse.frontier_limit = frontier_limit;
+    traverse.revisit = revisit;
+    traverse.vertices_offsets = &vertices_offsets;
+    traverse.vertices = &vertices;
+    traverse.edges_offsets = &edges_offsets;
+    traverse.edges = &edges;
+    ustore_graph_traverse(&traverse);
+    EXPECT_TRUE(status);
+
+    traversed_graph_t traversed;
+    if (!status)
+        return traversed;
+    EXPECT_EQ(vertices_offsets[0], 0u);
+    EXPECT_EQ(edges_offsets[0], 0u);
+    for (std::size_t distance = 0; distance <= hops; ++distance)
+        traversed.vertices.emplace_back(vertices + vertices_offsets[distance],
+                                        vertices + vertices_offsets[distance + 1]);
+    for (std::size_t hop = 1; hop <= hops; ++hop) {
+        std::vector<ustore_key_t> ids;
+        for (std::size_t i = edges_offsets[hop - 1]; i != edges_offsets[hop]; ++i)
+            ids.push_back(edges[i * 3 + 2]);
+        std::sort(ids.begin(), ids.end());
+        traversed.edges.push_back(std::move(ids));
     }
+    return traversed;
+}
 
-    // Remove a single edge, making sure that the nodes info persists
-    EXPECT_TRUE(net.remove_edges(edges_view_t {
-        {{&triangle[0].source_id}, 1},
-        {{&triangle[0].target_id}, 1},
-        {{&triangle[0].id}, 1},
-    }));
-    EXPECT_TRUE(*net.contains(1));
-    EXPECT_TRUE(*net.contains(2));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 0ul);
+/**
+ * Expands the neighborhood of a vertex in Breadth-First order, following outgoing,
+ * incoming or all edges, limiting the number of hops and the size of every frontier,
+ * and optionally revisiting the vertices reached on earlier hops.
+ */
+TEST(db, graph_traverse) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
 
-    // Bring that edge back
-    EXPECT_TRUE(net.upsert_edges(edges_view_t {
-        {{&triangle[0].source_id}, 1},
-        {{&triangle[0].target_id}, 1},
-        {{&triangle[0].id}, 1},
-    }));
-    EXPECT_EQ(net.edges_between(1, 2)->size(), 1ul);
+    // A cycle of five vertices with a shortcut and a tail leading into it
+    graph_collection_t graph = db.main<graph_collection_t>();
+    std::vector<edge_t> edges_vec {
+        {1, 2, 100}, {1, 3, 101}, {2, 4, 102}, {3, 4, 103}, {4, 5, 104}, {5, 1, 105}, {6, 1, 106}};
+    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    using ids_t = std::vector<std::vector<ustore_key_t>>;
+
+    // Outgoing edges, with starts deduplicated
+    auto traversed = traverse_graph(db, {1, 1}, 3, ustore_vertex_source_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2, 3}, {4}, {5}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101}, {102, 103}, {104}}));
+
+    // Fewer hops stop earlier
+    traversed = traverse_graph(db, {1}, 1, ustore_vertex_source_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2, 3}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101}}));
+
+    // Incoming edges lead backwards, and in both directions all the neighbors are reached
+    traversed = traverse_graph(db, {1}, 2, ustore_vertex_target_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {5, 6}, {4}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{105, 106}, {104}}));
+    traversed = traverse_graph(db, {1}, 1, ustore_vertex_role_any_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2, 3, 5, 6}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101, 105, 106}}));
+
+    // Only the smallest IDs of every frontier are expanded
+    traversed = traverse_graph(db, {1}, 3, ustore_vertex_source_k, 1);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2}, {4}, {5}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101}, {102}, {104}}));
+
+    // Closing the cycle reaches the start again, which is only exported when revisiting
+    traversed = traverse_graph(db, {1}, 5, ustore_vertex_source_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2, 3}, {4}, {5}, {}, {}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101}, {102, 103}, {104}, {105}, {}}));
+    traversed = traverse_graph(db, {1}, 5, ustore_vertex_source_k, 0, true);
+    EXPECT_EQ(traversed.vertices, (ids_t {{1}, {2, 3}, {4}, {5}, {1}, {2, 3}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{100, 101}, {102, 103}, {104}, {105}, {100, 101}}));
+
+    // Missing starts are exported, but have no neighbors
+    traversed = traverse_graph(db, {42}, 1, ustore_vertex_role_any_k);
+    EXPECT_EQ(traversed.vertices, (ids_t {{42}, {}}));
+    EXPECT_EQ(traversed.edges, (ids_t {{}}));
+    EXPECT_TRUE(db.clear());
+}
 
-    // Remove a vertex
-    ustore_key_t vertex_to_remove = 2;
-    EXPECT_TRUE(net.remove_vertex(vertex_to_remove));
-    EXPECT_FALSE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 0ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+#pragma region Vectors Modality
 
-    // Bring back the whole graph
-    EXPECT_TRUE(net.upsert_edges(edges(triangle)));
-    EXPECT_TRUE(*net.contains(vertex_to_remove));
-    EXPECT_EQ(net.edges_containing(vertex_to_remove)->size(), 2ul);
-    EXPECT_EQ(net.edges_between(1, vertex_to_remove)->size(), 1ul);
-    EXPECT_EQ(net.edges_between(vertex_to_remove, 1)->size(), 0ul);
+/**
+ * Tests "Vector Modality", including both CRUD and more analytical approximate search
+ * operations with just three distinctly different vectors in R3 space with Cosine metric.
+ */
+TEST(db, vectors) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t dims_k = 3;
+    ustore_key_t keys[3] = {'a', 'b', 'c'};
+    float vectors[3][dims_k] = {
+        {0.3, 0.1, 0.2},
+        {0.35, 0.1, 0.2},
+        {-0.1, 0.2, 0.5},
+    };
+
+    arena_t arena(db);
+    status_t status;
+
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = 3;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    ustore_length_t max_results = 2;
+    ustore_length_t* found_results = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_distances = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = 1;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    search.queries_stride = sizeof(float) * dims_k;
+    search.match_counts = &found_results;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_distances;
+    search.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    EXPECT_EQ(found_results[0], max_results);
+    EXPECT_EQ(found_keys[0], ustore_key_t('a'));
+    EXPECT_EQ(found_keys[1], ustore_key_t('b'));
 }
 
 /**
- * Tries to make a transaction on a graph, that must fail to `commit`.
- * Creates a "wedge": A-B-C. If a transaction changes the B-C edge,
- * while A-B is updated externally, the commit will fail.
+ * Searches for all three vectors in R3 space in a single batch,
+ * expecting every query to find itself first.
  */
-TEST(db, graph_transaction_watch) {
-    if (!ustore_supports_transactions_k)
-        return;
-
+TEST(db, vectors_batch) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
-    graph_collection_t net = db.main<graph_collection_t>();
 
-    edge_t edge_ab {'A', 'B', 19};
-    edge_t edge_bc {'B', 'C', 31};
-    EXPECT_TRUE(net.upsert_edge(edge_ab));
-    EXPECT_TRUE(net.upsert_edge(edge_bc));
+    constexpr std::size_t dims_k = 3;
+    ustore_key_t keys[3] = {'a', 'b', 'c'};
+    float vectors[3][dims_k] = {
+        {0.3, 0.1, 0.2},
+        {0.1, 0.35, 0.2},
+        {-0.1, 0.2, 0.5},
+    };
 
-    transaction_t txn = *db.transact();
-    graph_collection_t txn_net = txn.main<graph_collection_t>();
-    EXPECT_EQ(txn_net.degree('B'), 2);
-    EXPECT_TRUE(txn_net.remove_edge(edge_bc));
-    EXPECT_TRUE(net.remove_edge(edge_ab));
+    arena_t arena(db);
+    status_t status;
 
-    EXPECT_FALSE(txn.commit());
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = 3;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    ustore_length_t max_results = 1;
+    ustore_length_t* found_results = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_distances = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = 3;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    search.queries_stride = sizeof(float) * dims_k;
+    search.match_counts = &found_results;
+    search.match_offsets = &found_offsets;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_distances;
+    search.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    for (std::size_t i = 0; i != 3; ++i) {
+        EXPECT_EQ(found_results[i], max_results);
+        EXPECT_EQ(found_keys[found_offsets[i]], keys[i]);
+    }
 }
 
 /**
- * Constructs a larger graph, validating the degrees in a resulting network afterward.
+ * Searches two collections in one batch, with strided arguments and different limits
+ * for every query, including an empty one and one exceeding the size of the collection.
+ * Over Flight, this checks that the results of every row are unpacked into their own slices.
  */
-TEST(db, graph_random_fill) {
+TEST(db, vectors_batch_collections) {
+    if (!ustore_supports_named_collections_k)
+        return;
+
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 4;
+    constexpr std::size_t count_k = 100;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<ustore_key_t> keys(count_k);
+    std::iota(keys.begin(), keys.end(), 1);
+    std::vector<float> vectors[2] = {std::vector<float>(count_k * dims_k), std::vector<float>(count_k * dims_k)};
+    for (auto& collection_vectors : vectors)
+        for (auto& scalar : collection_vectors)
+            scalar = distribution(random_generator);
+
+    blobs_collection_t other = *db.create("other");
+    ustore_collection_t collections_ids[2] = {ustore_collection_main_k, other};
+    arena_t arena(db);
+    status_t status;
+    for (std::size_t collection_idx = 0; collection_idx != 2; ++collection_idx) {
+        float const* vector_first_begin = vectors[collection_idx].data();
+        ustore_vectors_write_t write {};
+        write.db = db;
+        write.arena = arena.member_ptr();
+        write.error = status.member_ptr();
+        write.collections = &collections_ids[collection_idx];
+        write.dimensions = dims_k;
+        write.keys = keys.data();
+        write.keys_stride = sizeof(ustore_key_t);
+        write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+        write.vectors_stride = sizeof(float) * dims_k;
+        write.tasks_count = count_k;
+        ustore_vectors_write(&write);
+        EXPECT_TRUE(status);
+    }
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    // Every query is a copy of a vector from the collection it is searched in
+    struct query_t {
+        ustore_collection_t collection;
+        ustore_length_t limit;
+        float vector[dims_k];
+    };
+    std::vector<query_t> queries(4);
+    std::size_t const queries_collections[4] = {0, 1, 0, 1};
+    ustore_length_t const queries_limits[4] = {0, 1, 7, count_k * 2};
+    std::size_t const queries_offsets[4] = {5, 15, 25, 35};
+    for (std::size_t i = 0; i != queries.size(); ++i) {
+        queries[i].collection = collections_ids[queries_collections[i]];
+        queries[i].limit = queries_limits[i];
+        float const* vector = vectors[queries_collections[i]].data() + queries_offsets[i] * dims_k;
+        std::copy(vector, vector + dims_k, queries[i].vector);
+    }
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_EQ(*graph.degree(vertex_id), 9u);
+    ustore_length_t* found_results = nullptr;
+    ustore_length_t* found_offsets = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_distances = nullptr;
+    float const* queries_begin = queries.front().vector;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = dims_k;
+    search.tasks_count = queries.size();
+    search.collections = &queries.front().collection;
+    search.collections_stride = sizeof(query_t);
+    search.match_counts_limits = &queries.front().limit;
+    search.match_counts_limits_stride = sizeof(query_t);
+    search.queries_starts = (ustore_bytes_cptr_t*)&queries_begin;
+    search.queries_stride = sizeof(query_t);
+    search.match_counts = &found_results;
+    search.match_offsets = &found_offsets;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_distances;
+    search.metric = ustore_vector_metric_l2_k;
+    search.metric_threshold = -std::numeric_limits<ustore_float_t>::max();
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+
+    // Vectors are quantized for the search, so only the nearest neighbor is certain
+    for (std::size_t i = 0; i != queries.size(); ++i) {
+        ustore_length_t const expected_count = std::min<ustore_length_t>(queries[i].limit, count_k);
+        EXPECT_EQ(found_results[i], expected_count);
+        if (!found_results[i])
+            continue;
+        ustore_key_t const* found_begin = found_keys + found_offsets[i];
+        ustore_float_t const* found_metrics = found_distances + found_offsets[i];
+        EXPECT_EQ(found_begin[0], keys[queries_offsets[i]]);
+        EXPECT_TRUE(std::is_sorted(found_metrics, found_metrics + found_results[i]));
+        std::set<ustore_key_t> unique_keys(found_begin, found_begin + found_results[i]);
+        EXPECT_EQ(unique_keys.size(), expected_count);
     }
+    EXPECT_TRUE(db.clear());
 }
 
 /**
- * Inserts two edges with a shared vertex in two separate transactions.
- * The latter insert must fail, as it depends on the preceding state of the vertex.
+ * Checks Euclidean and Inner-Product metrics on vectors with enough
+ * dimensions to pass through both the vectorized and the serial tails.
  */
-TEST(db, graph_conflicting_transactions) {
-    if (!ustore_supports_transactions_k)
-        return;
-
+TEST(db, vectors_metrics) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    transaction_t txn = *db.transact();
-    graph_collection_t txn_net = txn.main<graph_collection_t>();
-    transaction_t txn2 = *db.transact();
-    graph_collection_t txn_net2 = txn2.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 37;
+    ustore_key_t keys[3] = {'a', 'b', 'c'};
+    float vectors[3][dims_k];
+    for (std::size_t i = 0; i != dims_k; ++i)
+        vectors[0][i] = 0.5f, vectors[1][i] = 0.4f, vectors[2][i] = -0.5f;
 
-    edge_t edge4 {4, 5, 15};
-    edge_t edge5 {5, 6, 16};
+    arena_t arena(db);
+    status_t status;
 
-    EXPECT_TRUE(txn_net.upsert_edge(edge4));
-    EXPECT_TRUE(txn_net2.upsert_edge(edge5));
-    EXPECT_TRUE(txn.commit());
-    EXPECT_FALSE(txn2.commit());
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = 3;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    for (auto metric : {ustore_vector_metric_l2_k, ustore_vector_metric_dot_k}) {
+        ustore_length_t max_results = 3;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_metrics = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_metrics;
+        search.metric = metric;
+        search.metric_threshold = -std::numeric_limits<ustore_float_t>::max();
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+
+        EXPECT_EQ(found_results[0], max_results);
+        EXPECT_EQ(found_keys[0], ustore_key_t('a'));
+        EXPECT_EQ(found_keys[1], ustore_key_t('b'));
+        EXPECT_EQ(found_keys[2], ustore_key_t('c'));
+        if (metric == ustore_vector_metric_l2_k) {
+            EXPECT_NEAR(found_metrics[0], 0, 1e-3);
+            EXPECT_NEAR(found_metrics[1], std::sqrt(dims_k * 0.01), 1e-3);
+        }
+    }
 }
 
 /**
- * Takes a single Graph Store and populates it with various 5-vertex shapes:
- * a star, a pentagon, and five self-loops.
+ * Fills a collection with random vectors, organizing them into an approximate search index,
+ * and checks that querying with the stored vectors finds the same vectors first.
  */
-TEST(db, graph_layering_shapes) {
+TEST(db, vectors_index) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 500;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
 
-    std::vector<ustore_key_t> vertices = {1, 2, 3, 4, 5};
-    auto over_the_vertices = [&](bool exist, size_t degree) {
-        for (auto& vertex_id : vertices) {
-            EXPECT_EQ(*graph.contains(vertex_id), exist);
-            EXPECT_EQ(*graph.degree(vertex_id), degree);
-        }
-    };
+    arena_t arena(db);
+    status_t status;
 
-    // Before insertions, the graph is empty.
-    over_the_vertices(false, 0);
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k;
+    write.index_connectivity = 16;
+    write.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    std::vector<edge_t> star {
-        {1, 3, 1},
-        {1, 4, 2},
-        {2, 4, 3},
-        {2, 5, 4},
-        {3, 5, 5},
-    };
-    std::vector<edge_t> pentagon {
-        {1, 2, 6},
-        {2, 3, 7},
-        {3, 4, 8},
-        {4, 5, 9},
-        {5, 1, 10},
-    };
-    std::vector<edge_t> self_loops {
-        {1, 1, 11},
-        {2, 2, 12},
-        {3, 3, 13},
-        {4, 4, 14},
-        {5, 5, 15},
-    };
+    for (std::size_t i = 0; i != count_k; i += 50) {
+        ustore_length_t max_results = 4;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        float* query_begin = vectors.data() + i * dims_k;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_cos_k;
+        search.metric_threshold = -1;
+        search.index_expansion = 32;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
 
-    EXPECT_TRUE(graph.upsert_edges(edges(star)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.remove_edges(edges(star)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(star)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.upsert_edges(edges(pentagon)));
-    over_the_vertices(true, 4u);
-    EXPECT_TRUE(graph.upsert_edges(edges(self_loops)));
-    over_the_vertices(true, 6u);
-    EXPECT_TRUE(graph.remove_edges(edges(star)));
-    EXPECT_TRUE(graph.remove_edges(edges(pentagon)));
-    over_the_vertices(true, 2u);
-    EXPECT_TRUE(graph.remove_edges(edges(self_loops)));
-    over_the_vertices(true, 0);
-    EXPECT_TRUE(db.clear());
-    over_the_vertices(false, 0);
+        EXPECT_EQ(found_results[0], max_results);
+        EXPECT_EQ(found_keys[0], keys[i]);
+    }
 }
 
 /**
- * Tests vertex removals, which are the hardest operations on Graphs,
- * as they trigger updates in all nodes connected to the removed one.
+ * Requests the approximate search index for a collection, that already has vectors,
+ * expecting the earlier vectors to be indexed together with the new ones.
  */
-TEST(db, graph_remove_vertices) {
+TEST(db, vectors_index_backfill) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 500;
+    constexpr std::size_t indexed_count_k = 10;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    arena_t arena(db);
+    status_t status;
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
-        EXPECT_TRUE(graph.remove_vertex(vertex_id));
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_FALSE(*graph.contains(vertex_id));
-    }
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k - indexed_count_k;
+    write.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
-    std::vector<ustore_key_t> vertices(vertices_count);
-    std::iota(vertices.begin(), vertices.end(), 0);
-    EXPECT_TRUE(graph.remove_vertices(vertices));
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_FALSE(*graph.contains(vertex_id));
+    vector_first_begin = vectors.data() + (count_k - indexed_count_k) * dims_k;
+    write.keys = keys.data() + count_k - indexed_count_k;
+    write.tasks_count = indexed_count_k;
+    write.index_connectivity = 16;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    for (std::size_t i = 0; i != count_k; i += 50) {
+        ustore_length_t max_results = 4;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        float* query_begin = vectors.data() + i * dims_k;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &max_results;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_cos_k;
+        search.metric_threshold = -1;
+        search.index_expansion = 32;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+
+        EXPECT_EQ(found_results[0], max_results);
+        EXPECT_EQ(found_keys[0], keys[i]);
     }
 }
 
 /**
- * Removes just the known list of edges, checking that vertices remain
- * in the graph, even though entirely disconnected.
+ * Splits an exact vector search between several threads and checks
+ * that the results match the single-threaded search.
  */
-TEST(db, graph_remove_edges_keep_vertices) {
+TEST(db, vectors_parallel) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    constexpr std::size_t dims_k = 8;
+    constexpr std::size_t count_k = 5000;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
+
+    arena_t arena(db);
+    status_t status;
+
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
-    EXPECT_TRUE(graph.remove_edges(edges(edges_vec)));
+    constexpr ustore_length_t max_results = 8;
+    auto search = [&](ustore_size_t threads_count) {
+        ustore_length_t limit = max_results;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &limit;
+        search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_l2_k;
+        search.threads_count = threads_count;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(found_results[0], max_results);
+        return std::vector<ustore_key_t>(found_keys, found_keys + found_results[0]);
+    };
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
-    }
+    std::vector<ustore_key_t> serial_keys = search(1);
+    std::vector<ustore_key_t> parallel_keys = search(4);
+    EXPECT_EQ(serial_keys.front(), keys.front());
+    EXPECT_EQ(serial_keys, parallel_keys);
 }
+
+#if defined(USTORE_USE_CUDA) && !defined(USTORE_FLIGHT_CLIENT)
 /**
- * Add edges to the graph. Checks how many edges each vertex has.
- * Then remove the edges, making sure that the vertices aren't
- * connected to each other anymore.
+ * Searches offloaded to the GPU find the same matches, as the host scan,
+ * which still serves the searches limited to an allow-list.
  */
-TEST(db, graph_get_vertex_edges) {
+TEST(db, vectors_cuda) {
     clear_environment();
     database_t db;
-    EXPECT_TRUE(db.open(config().c_str()));
+    auto accelerated_config = fmt::format(R"({{"version": "1.0", "directory": "{}", "accelerator": "cuda"}})",
+                                          path() ? path() : "");
+    EXPECT_TRUE(db.open(accelerated_config.c_str()));
+
+    constexpr std::size_t dims_k = 13;
+    constexpr std::size_t count_k = 5000;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    arena_t arena(db);
+    status_t status;
 
-    constexpr std::size_t vertices_count = 1000;
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    std::vector<edge_t> received_edges;
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        auto es = *graph.edges_containing(vertex_id);
-        EXPECT_EQ(es.size(), 9u);
-        for (size_t i = 0; i != es.size(); ++i)
-            received_edges.push_back(es[i]);
-    }
-    EXPECT_TRUE(graph.remove_edges(edges(received_edges)));
+    constexpr ustore_length_t max_results = 8;
+    auto search = [&](ustore_vector_metric_t metric, bool on_host) {
+        ustore_length_t limit = max_results;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &limit;
+        search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = metric;
+        search.allowed_keys = on_host ? keys.data() : nullptr;
+        search.allowed_keys_count = on_host ? count_k : 0;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(found_results[0], max_results);
+        return std::vector<ustore_key_t>(found_keys, found_keys + found_results[0]);
+    };
 
-    for (ustore_key_t vertex_id = 0; vertex_id != vertices_count; ++vertex_id) {
-        EXPECT_TRUE(graph.contains(vertex_id));
-        EXPECT_TRUE(*graph.contains(vertex_id));
-        EXPECT_EQ(graph.edges_containing(vertex_id)->size(), 0);
+    // Rounding may reorder equally similar matches, but not change the set of them
+    for (auto metric : {ustore_vector_metric_dot_k, ustore_vector_metric_cos_k, ustore_vector_metric_l2_k}) {
+        std::vector<ustore_key_t> device_keys = search(metric, false);
+        std::vector<ustore_key_t> host_keys = search(metric, true);
+        std::sort(device_keys.begin(), device_keys.end());
+        std::sort(host_keys.begin(), host_keys.end());
+        EXPECT_EQ(device_keys, host_keys);
     }
+    EXPECT_EQ(search(ustore_vector_metric_l2_k, false).front(), keys.front());
+
+    // Rewritten vectors reach the device with the next search
+    std::copy_n(vectors.begin(), dims_k, vectors.begin() + dims_k);
+    vectors[dims_k] += 0.02f;
+    write.tasks_count = 2;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(search(ustore_vector_metric_l2_k, false)[1], keys[1]);
+    EXPECT_TRUE(db.clear());
 }
+#endif
 
 /**
- * Getting the degrees of multiple vertices simultaneously.
+ * The first write defines the schema of the collection,
+ * rejecting vectors and queries of different dimensionality.
  */
-TEST(db, graph_degrees) {
+TEST(db, vectors_schema) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
+    ustore_key_t keys[2] = {'a', 'b'};
+    float vectors[2][4] = {
+        {0.3, 0.1, 0.2, 0.1},
+        {-0.1, 0.2, 0.5, 0.1},
+    };
 
-    constexpr std::size_t vertices_count = 1000;
-    std::vector<ustore_key_t> vertices(vertices_count);
-    std::iota(vertices.begin(), vertices.end(), 0);
+    arena_t arena(db);
+    status_t status;
 
-    auto edges_vec = make_edges(vertices_count, 100);
-    EXPECT_TRUE(graph.upsert_edges(edges(edges_vec)));
+    float* vector_first_begin = &vectors[0][0];
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = 3;
+    write.keys = keys;
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * 4;
+    write.tasks_count = 1;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    auto degrees = *graph.degrees(strided_range(vertices).immutable());
-    EXPECT_EQ(degrees.size(), vertices_count);
+    write.dimensions = 4;
+    write.keys = keys + 1;
+    ustore_vectors_write(&write);
+    EXPECT_FALSE(status);
+    status.release_error();
+
+    ustore_length_t max_results = 1;
+    ustore_length_t* found_results = nullptr;
+    ustore_key_t* found_keys = nullptr;
+    ustore_float_t* found_distances = nullptr;
+    ustore_vectors_search_t search {};
+    search.db = db;
+    search.arena = arena.member_ptr();
+    search.error = status.member_ptr();
+    search.dimensions = 4;
+    search.tasks_count = 1;
+    search.match_counts_limits = &max_results;
+    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    search.queries_stride = sizeof(float) * 4;
+    search.match_counts = &found_results;
+    search.match_keys = &found_keys;
+    search.match_metrics = &found_distances;
+    search.metric = ustore_vector_metric_cos_k;
+    ustore_vectors_search(&search);
+    EXPECT_FALSE(status);
+    status.release_error();
+
+    search.dimensions = 3;
+    ustore_vectors_search(&search);
+    EXPECT_TRUE(status);
+    EXPECT_EQ(found_results[0], max_results);
+    EXPECT_EQ(found_keys[0], ustore_key_t('a'));
+    EXPECT_NEAR(found_distances[0], 1, 0.01);
 }
 
-TEST(db, graph_neighbors) {
+/**
+ * Compresses a collection with Product Quantization, keeping the originals, expecting every vector
+ * to find itself among the approximate matches, and first after re-ranking.
+ */
+TEST(db, vectors_compress) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    graph_collection_t graph = db.main<graph_collection_t>();
-    edge_t edge1 {1, 1, 17};
-    edge_t edge2 {1, 2, 15};
-    edge_t edge3 {2, 3, 16};
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 1000;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
 
-    EXPECT_TRUE(graph.upsert_edge(edge1));
-    EXPECT_TRUE(graph.upsert_edge(edge2));
-    EXPECT_TRUE(graph.upsert_edge(edge3));
+    arena_t arena(db);
+    status_t status;
 
-    auto neighbors = graph.neighbors(1).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
-    EXPECT_EQ(neighbors[0], 1);
-    EXPECT_EQ(neighbors[1], 2);
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
 
-    neighbors = graph.neighbors(2).throw_or_release();
-    EXPECT_EQ(neighbors.size(), 2);
-    EXPECT_EQ(neighbors[0], 1);
-    EXPECT_EQ(neighbors[1], 3);
-}
+    ustore_vectors_compress_t compress {};
+    compress.db = db;
+    compress.arena = arena.member_ptr();
+    compress.error = status.member_ptr();
+    compress.subspaces = 3;
+    ustore_vectors_compress(&compress);
+    EXPECT_FALSE(status);
+    status.release_error();
+
+    compress.subspaces = 4;
+    compress.keep_originals = true;
+    ustore_vectors_compress(&compress);
+    EXPECT_TRUE(status);
 
-#pragma region Vectors Modality
+    for (ustore_length_t rerank_count : {0u, 16u}) {
+        ustore_length_t max_results = 8;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &max_results;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_l2_k;
+        search.metric_threshold = -std::numeric_limits<ustore_float_t>::max();
+        search.rerank_count = rerank_count;
+        for (std::size_t i = 0; i != count_k; i += 97) {
+            float* query_begin = vectors.data() + i * dims_k;
+            search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+            ustore_vectors_search(&search);
+            EXPECT_TRUE(status);
+            EXPECT_EQ(found_results[0], max_results);
+            if (rerank_count)
+                EXPECT_EQ(found_keys[0], keys[i]);
+            else
+                EXPECT_NE(std::find(found_keys, found_keys + max_results, keys[i]), found_keys + max_results);
+        }
+    }
+}
 
 /**
- * Tests "Vector Modality", including both CRUD and more analytical approximate search
- * operations with just three distinctly different vectors in R3 space with Cosine metric.
+ * Compresses a collection with Product Quantization, dropping the originals,
+ * expecting reads to export approximations, that are close to the written vectors,
+ * and the collection to reject further compressions.
  */
-TEST(db, vectors) {
+TEST(db, vectors_compress_codes) {
     clear_environment();
     database_t db;
     EXPECT_TRUE(db.open(config().c_str()));
 
-    constexpr std::size_t dims_k = 3;
-    ustore_key_t keys[3] = {'a', 'b', 'c'};
-    float vectors[3][dims_k] = {
-        {0.3, 0.1, 0.2},
-        {0.35, 0.1, 0.2},
-        {-0.1, 0.2, 0.5},
-    };
+    constexpr std::size_t dims_k = 16;
+    constexpr std::size_t count_k = 1000;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
 
     arena_t arena(db);
     status_t status;
 
-    float* vector_first_begin = &vectors[0][0];
+    float* vector_first_begin = vectors.data();
     ustore_vectors_write_t write {};
     write.db = db;
     write.arena = arena.member_ptr();
     write.error = status.member_ptr();
     write.dimensions = dims_k;
-    write.keys = keys;
+    write.keys = keys.data();
     write.keys_stride = sizeof(ustore_key_t);
     write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
     write.vectors_stride = sizeof(float) * dims_k;
-    write.tasks_count = 3;
+    write.tasks_count = count_k;
     ustore_vectors_write(&write);
     EXPECT_TRUE(status);
 
-    ustore_length_t max_results = 2;
+    ustore_vectors_compress_t compress {};
+    compress.db = db;
+    compress.arena = arena.member_ptr();
+    compress.error = status.member_ptr();
+    compress.subspaces = 4;
+    ustore_vectors_compress(&compress);
+    EXPECT_TRUE(status);
+
+    // Without the originals, only the codes can be compared
+    ustore_length_t max_results = 8;
     ustore_length_t* found_results = nullptr;
     ustore_key_t* found_keys = nullptr;
     ustore_float_t* found_distances = nullptr;
@@ -2220,19 +5950,388 @@ TEST(db, vectors) {
     search.dimensions = dims_k;
     search.tasks_count = 1;
     search.match_counts_limits = &max_results;
-    search.queries_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
     search.queries_stride = sizeof(float) * dims_k;
     search.match_counts = &found_results;
     search.match_keys = &found_keys;
     search.match_metrics = &found_distances;
-    search.metric = ustore_vector_metric_cos_k;
-    ustore_vectors_search(&search);
+    search.metric = ustore_vector_metric_l2_k;
+    search.metric_threshold = -std::numeric_limits<ustore_float_t>::max();
+    search.rerank_count = 16;
+    for (std::size_t i = 0; i != count_k; i += 97) {
+        float* query_begin = vectors.data() + i * dims_k;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query_begin;
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+        EXPECT_EQ(found_results[0], max_results);
+        EXPECT_NE(std::find(found_keys, found_keys + max_results, keys[i]), found_keys + max_results);
+    }
+
+    ustore_length_t* found_offsets = nullptr;
+    ustore_byte_t* found_vectors = nullptr;
+    ustore_octet_t* found_presences = nullptr;
+    ustore_vectors_read_t read {};
+    read.db = db;
+    read.arena = arena.member_ptr();
+    read.error = status.member_ptr();
+    read.tasks_count = count_k;
+    read.dimensions = dims_k;
+    read.scalar_type = ustore_vector_scalar_f32_k;
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.vectors = &found_vectors;
+    read.presences = &found_presences;
+    ustore_vectors_read(&read);
     EXPECT_TRUE(status);
+    double squared_errors = 0, squared_norms = 0;
+    for (std::size_t i = 0; i != count_k; ++i) {
+        EXPECT_TRUE(found_presences[i / 8] & (1 << (i % 8)));
+        EXPECT_EQ(found_offsets[i + 1] - found_offsets[i], sizeof(float) * dims_k);
+        float const* approximation = reinterpret_cast<float const*>(found_vectors + found_offsets[i]);
+        for (std::size_t j = 0; j != dims_k; ++j) {
+            float original = vectors[i * dims_k + j];
+            squared_errors += (approximation[j] - original) * (approximation[j] - original);
+            squared_norms += original * original;
+        }
+    }
+    EXPECT_LT(squared_errors, squared_norms / 4);
 
-    EXPECT_EQ(found_results[0], max_results);
-    EXPECT_EQ(found_keys[0], ustore_key_t('a'));
-    EXPECT_EQ(found_keys[1], ustore_key_t('b'));
+    ustore_vectors_compress(&compress);
+    EXPECT_FALSE(status);
+    status.release_error();
+}
+
+/**
+ * Compresses the original vectors with coarse values, that are easy to compress,
+ * expecting the old and the newly written ones to read back bit-exact.
+ */
+TEST(db, vectors_compress_originals) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t dims_k = 64;
+    constexpr std::size_t count_k = 100;
+    std::mt19937 random_generator(42);
+    std::uniform_int_distribution<int> distribution(-255, 255);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator) / 256.f;
+    std::iota(keys.begin(), keys.end(), 1);
+
+    arena_t arena(db);
+    status_t status;
+
+    // Write the first half before the compression, and the second one after it
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k / 2;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    ustore_vectors_compress_t compress {};
+    compress.db = db;
+    compress.arena = arena.member_ptr();
+    compress.error = status.member_ptr();
+    compress.originals = true;
+    ustore_vectors_compress(&compress);
+    EXPECT_TRUE(status);
+
+    vector_first_begin = vectors.data() + count_k / 2 * dims_k;
+    write.keys = keys.data() + count_k / 2;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    ustore_length_t* found_offsets = nullptr;
+    ustore_byte_t* found_vectors = nullptr;
+    ustore_vectors_read_t read {};
+    read.db = db;
+    read.arena = arena.member_ptr();
+    read.error = status.member_ptr();
+    read.tasks_count = count_k;
+    read.dimensions = dims_k;
+    read.scalar_type = ustore_vector_scalar_f32_k;
+    read.keys = keys.data();
+    read.keys_stride = sizeof(ustore_key_t);
+    read.offsets = &found_offsets;
+    read.vectors = &found_vectors;
+    ustore_vectors_read(&read);
+    EXPECT_TRUE(status);
+    for (std::size_t i = 0; i != count_k; ++i) {
+        EXPECT_EQ(found_offsets[i + 1] - found_offsets[i], sizeof(float) * dims_k);
+        EXPECT_EQ(std::memcmp(found_vectors + found_offsets[i], vectors.data() + i * dims_k, sizeof(float) * dims_k),
+                  0);
+    }
+}
+
+/**
+ * Restricts the search to a range of keys and to an allow-list,
+ * expecting only the matching keys in results.
+ */
+TEST(db, vectors_filtered) {
+    clear_environment();
+    database_t db;
+    EXPECT_TRUE(db.open(config().c_str()));
+
+    constexpr std::size_t dims_k = 8;
+    constexpr std::size_t count_k = 1000;
+    std::mt19937 random_generator(42);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> vectors(count_k * dims_k);
+    std::vector<ustore_key_t> keys(count_k);
+    for (auto& scalar : vectors)
+        scalar = distribution(random_generator);
+    std::iota(keys.begin(), keys.end(), 1);
+
+    arena_t arena(db);
+    status_t status;
+
+    float* vector_first_begin = vectors.data();
+    ustore_vectors_write_t write {};
+    write.db = db;
+    write.arena = arena.member_ptr();
+    write.error = status.member_ptr();
+    write.dimensions = dims_k;
+    write.keys = keys.data();
+    write.keys_stride = sizeof(ustore_key_t);
+    write.vectors_starts = (ustore_bytes_cptr_t*)&vector_first_begin;
+    write.vectors_stride = sizeof(float) * dims_k;
+    write.tasks_count = count_k;
+    ustore_vectors_write(&write);
+    EXPECT_TRUE(status);
+
+    std::vector<ustore_key_t> allowed_keys;
+    for (ustore_key_t key = 2; key <= 200; key += 2)
+        allowed_keys.push_back(key);
+
+    constexpr ustore_length_t max_results = 10;
+    auto search = [&](float const* query, auto&& configure) {
+        ustore_length_t limit = max_results;
+        ustore_length_t* found_results = nullptr;
+        ustore_key_t* found_keys = nullptr;
+        ustore_float_t* found_distances = nullptr;
+        ustore_vectors_search_t search {};
+        search.db = db;
+        search.arena = arena.member_ptr();
+        search.error = status.member_ptr();
+        search.dimensions = dims_k;
+        search.tasks_count = 1;
+        search.match_counts_limits = &limit;
+        search.queries_starts = (ustore_bytes_cptr_t*)&query;
+        search.queries_stride = sizeof(float) * dims_k;
+        search.match_counts = &found_results;
+        search.match_keys = &found_keys;
+        search.match_metrics = &found_distances;
+        search.metric = ustore_vector_metric_l2_k;
+        search.metric_threshold = -std::numeric_limits<ustore_float_t>::max();
+        configure(search);
+        ustore_vectors_search(&search);
+        EXPECT_TRUE(status);
+        return std::vector<ustore_key_t>(found_keys, found_keys + found_results[0]);
+    };
+
+    auto in_range = search(vectors.data() + 500 * dims_k, [](ustore_vectors_search_t& search) {
+        search.keys_min = 400;
+        search.keys_max = 600;
+    });
+    EXPECT_EQ(in_range.size(), max_results);
+    EXPECT_EQ(in_range.front(), keys[500]);
+    for (ustore_key_t key : in_range)
+        EXPECT_TRUE(key >= 400 && key <= 600);
+
+    auto in_list = search(vectors.data(), [&](ustore_vectors_search_t& search) {
+        search.allowed_keys = allowed_keys.data();
+        search.allowed_keys_count = allowed_keys.size();
+    });
+    EXPECT_EQ(in_list.size(), max_results);
+    for (ustore_key_t key : in_list)
+        EXPECT_TRUE(key % 2 == 0 && key <= 200);
+
+    auto in_both = search(vectors.data(), [&](ustore_vectors_search_t& search) {
+        search.allowed_keys = allowed_keys.data();
+        search.allowed_keys_count = allowed_keys.size();
+        search.keys_min = 400;
+    });
+    EXPECT_TRUE(in_both.empty());
+}
+
+#if defined(USTORE_FLIGHT_CLIENT)
+/**
+ * Routes batches across three servers, partitioned by hashes and by ranges, checking that
+ * every key lands on exactly one shard, while reads, scans, named collections and transactions
+ * see the union of all shards, and snapshots are rejected.
+ */
+TEST(db, sharded_servers) {
+    clear_environment();
+    std::vector<pid_t> servers {start_server(38710), start_server(38711)};
+    std::vector<std::string> const urls {"grpc://0.0.0.0:38709", "grpc://0.0.0.0:38710", "grpc://0.0.0.0:38711"};
+    std::vector<ustore_key_t> const start_keys {0, 1000, 2000};
+    std::vector<std::size_t> const range_counts {1500, 1000, 500};
+
+    std::vector<ustore_key_t> keys(3000);
+    std::iota(keys.begin(), keys.end(), -500);
+    std::vector<std::string> values(keys.size());
+    std::vector<value_view_t> values_views(keys.size());
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        values[i] = std::to_string(keys[i]);
+        values_views[i] = value_view_t {values[i].data(), values[i].size()};
+    }
+
+    for (char const* partitioning : {"hash", "range"}) {
+        json_t config = {{"partitioning", partitioning}, {"shards", json_t::array()}};
+        for (std::size_t shard_idx = 0; shard_idx != urls.size(); ++shard_idx)
+            config["shards"].push_back({{"url", urls[shard_idx]}, {"start_key", start_keys[shard_idx]}});
+        database_t db;
+        EXPECT_TRUE(db.open(config.dump().c_str()));
+        blobs_collection_t main = db.main();
+        EXPECT_TRUE(main[keys].assign(values_views));
+
+        // Values are merged back in the order of the batch, including the missing ones
+        std::vector<ustore_key_t> shuffled = keys;
+        shuffled.push_back(-1000);
+        shuffled.push_back(5000);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937 {42});
+        auto maybe_retrieved = main[shuffled].value();
+        EXPECT_TRUE(maybe_retrieved);
+        auto it = maybe_retrieved->begin();
+        for (std::size_t i = 0; i != shuffled.size(); ++i, ++it) {
+            value_view_t retrieved = *it;
+            if (shuffled[i] == -1000 || shuffled[i] == 5000)
+                EXPECT_FALSE(retrieved);
+            else
+                EXPECT_EQ(retrieved, value_view_t(std::to_string(shuffled[i])));
+        }
+
+        // Scans of all shards are merged in the order of keys
+        std::vector<ustore_key_t> scanned;
+        for (ustore_key_t key : main.keys(900, 2100))
+            scanned.push_back(key);
+        EXPECT_EQ(scanned.size(), 1200u);
+        for (std::size_t i = 0; i != scanned.size(); ++i)
+            EXPECT_EQ(scanned[i], static_cast<ustore_key_t>(900 + i));
+        EXPECT_EQ(main.keys().size(), keys.size());
+
+        // Every key is stored once, and the first range also owns the negative keys
+        std::size_t stored_count = 0;
+        for (std::size_t shard_idx = 0; shard_idx != urls.size(); ++shard_idx) {
+            database_t shard;
+            EXPECT_TRUE(shard.open(urls[shard_idx].c_str()));
+            std::size_t shard_count = shard.main().keys().size();
+            stored_count += shard_count;
+            if (std::strcmp(partitioning, "hash") == 0)
+                EXPECT_GT(shard_count, keys.size() / 10);
+            else
+                EXPECT_EQ(shard_count, range_counts[shard_idx]);
+        }
+        EXPECT_EQ(stored_count, keys.size());
+
+        blobs_collection_t named = *db.create("named");
+        for (ustore_key_t key = 0; key != 100; ++key)
+            named[key * 100] = std::to_string(key).c_str();
+        EXPECT_EQ(named.keys().size(), 100u);
+        EXPECT_EQ(*named[4200].value(), "42");
+
+        // Transactions span shards, even if their commits aren't atomic
+        {
+            transaction_t txn = *db.transact();
+            blobs_collection_t txn_main = txn.main();
+            EXPECT_TRUE(txn_main[-100].assign("first"));
+            EXPECT_TRUE(txn_main[2100].assign("last"));
+            EXPECT_EQ(*txn_main[-100].value(), "first");
+            EXPECT_EQ(*main[-100].value(), "-100");
+            EXPECT_TRUE(txn.commit());
+        }
+        EXPECT_EQ(*main[-100].value(), "first");
+        EXPECT_EQ(*main[2100].value(), "last");
+
+        EXPECT_FALSE(db.snapshot());
+        EXPECT_TRUE(db.clear());
+        EXPECT_EQ(main.keys().size(), 0u);
+    }
+
+    for (pid_t server : servers)
+        stop_server(server);
+}
+#endif
+
+#if defined(USTORE_FLIGHT_CLIENT)
+/**
+ * Replicates plain writes, erasures, transactions and collections from a primary server
+ * into a read replica, which rejects the writes of its own clients, and fails the reads,
+ * that can't tolerate its staleness, once the primary is gone.
+ */
+TEST(db, replicated_servers) {
+    clear_environment();
+    pid_t primary_server = start_server(38712, {"--replication-log", "16"});
+    pid_t replica_server =
+        start_server(38713, {"--replicate-from", "grpc://0.0.0.0:38712", "--replication-interval", "10"});
+
+    database_t primary;
+    EXPECT_TRUE(primary.open("grpc://0.0.0.0:38712"));
+    blobs_collection_t main = primary.main();
+    for (ustore_key_t key = 0; key != 1000; ++key)
+        main[key] = std::to_string(key).c_str();
+    EXPECT_TRUE(main[500].erase());
+    blobs_collection_t named = *primary.create("named");
+    named[42] = "named";
+    {
+        transaction_t txn = *primary.transact();
+        blobs_collection_t txn_main = txn.main();
+        EXPECT_TRUE(txn_main[1000].assign("committed"));
+        EXPECT_TRUE(txn.commit());
+    }
+    {
+        transaction_t txn = *primary.transact();
+        blobs_collection_t txn_main = txn.main();
+        EXPECT_TRUE(txn_main[1001].assign("abandoned"));
+    }
+    main[1002] = "last";
+
+    // Changes are applied in order, so the last one marks the end
+    database_t replica;
+    EXPECT_TRUE(replica.open("grpc://0.0.0.0:38713"));
+    blobs_collection_t replica_main = replica.main();
+    for (std::size_t attempt = 0; attempt != 100 && !*replica_main[1002].present(); ++attempt)
+        usleep(50000); // 0.05 sec
+    EXPECT_EQ(*replica_main[1002].value(), "last");
+    for (ustore_key_t key = 0; key != 1000; ++key)
+        if (key == 500)
+            EXPECT_FALSE(*replica_main[key].present());
+        else
+            EXPECT_EQ(*replica_main[key].value(), std::to_string(key).c_str());
+    EXPECT_EQ(*replica_main[1000].value(), "committed");
+    EXPECT_FALSE(*replica_main[1001].present());
+    blobs_collection_t replica_named = *replica["named"];
+    EXPECT_EQ(*replica_named[42].value(), "named");
+
+    EXPECT_FALSE(replica_main[0].assign("rejected"));
+    EXPECT_FALSE(replica.create("unknown"));
+    EXPECT_EQ(*replica_main[0].value(), "0");
+
+    // Reads with bounded staleness pass, until the replica stops hearing from the primary
+    database_t tolerant;
+    EXPECT_TRUE(tolerant.open("grpc://0.0.0.0:38713?max_staleness=60000"));
+    EXPECT_TRUE(tolerant.main()[0].value());
+    stop_server(primary_server);
+    usleep(500000); // 0.5 sec
+    database_t strict;
+    EXPECT_TRUE(strict.open("grpc://0.0.0.0:38713?max_staleness=100"));
+    EXPECT_FALSE(strict.main()[0].value());
+    EXPECT_TRUE(tolerant.main()[0].value());
+    EXPECT_EQ(*replica_main[0].value(), "0");
+
+    stop_server(replica_server);
 }
+#endif
 
 int main(int argc, char** argv) {
 